@@ -0,0 +1,12 @@
+if(ENABLE_CATALYST2)
+  # the implementation, such as ParaView's, is loaded by libcatalyst at run
+  # time, only the catalyst library is linked
+  find_package(catalyst 2.0 REQUIRED)
+
+  add_library(sCatalyst2 INTERFACE)
+
+  target_link_libraries(sCatalyst2 INTERFACE catalyst::catalyst)
+
+  install(TARGETS sCatalyst2 EXPORT sCatalyst2)
+  install(EXPORT sCatalyst2 DESTINATION lib/cmake EXPORT_LINK_INTERFACE_LIBRARIES)
+endif()
@@ -32,6 +32,10 @@ cmake_dependent_option(ENABLE_ASCENT
   "Enable analysis methods that use Ascent" OFF
   "ENABLE_SENSEI" OFF)
 
+cmake_dependent_option(ENABLE_CATALYST2
+  "Enable analysis methods that use the Catalyst 2 API" OFF
+  "ENABLE_CONDUIT" OFF)
+
 cmake_dependent_option(ENABLE_ASCENT
   "Enable analysis methods that use ASCENT" OFF
   "ENABLE_SENSEI" OFF)
@@ -75,6 +79,9 @@ cmake_dependent_option(ENABLE_VTKM_RENDERING
 option(ENABLE_OPTS "A version of the getopt function" ON)
 option(ENABLE_PROFILER "Enable the internal profiler" OFF)
 option(ENABLE_OSCILLATORS "Enable Oscillators miniapp" ON)
+cmake_dependent_option(ENABLE_OSCILLATORS_CUDA
+  "Build the Oscillators miniapp with its fields in CUDA device memory" OFF
+  "ENABLE_OSCILLATORS;ENABLE_SENSEI" OFF)
 option(ENABLE_MANDELBROT "Enable Mandelbrot AMR miniapp" ON)
 option(ENABLE_VORTEX "Enable Vortex miniapp (experimental)" OFF)
 option(ENABLE_CONDUITTEST "Enable Conduit miniapp (experimental)" OFF)
@@ -89,6 +96,7 @@ message(STATUS "ENABLE_ADIOS2=${ENABLE_ADIOS2}")
 message(STATUS "ENABLE_HDF5=${ENABLE_HDF5}")
 message(STATUS "ENABLE_CONDUIT=${ENABLE_CONDUIT}")
 message(STATUS "ENABLE_ASCENT=${ENABLE_ASCENT}")
+message(STATUS "ENABLE_CATALYST2=${ENABLE_CATALYST2}")
 message(STATUS "ENABLE_LIBSIM=${ENABLE_LIBSIM}")
 message(STATUS "ENABLE_VTK_GENERIC_ARRAYS=${ENABLE_VTK_GENERIC_ARRAYS}")
 message(STATUS "ENABLE_VTK_IO=${ENABLE_VTK_IO}")
@@ -101,6 +109,7 @@ message(STATUS "ENABLE_VTKM_RENDERING=${ENABLE_VTKM_RENDERING}")
 message(STATUS "ENABLE_PROFILER=${ENABLE_PROFILER}")
 message(STATUS "ENABLE_OPTS=${ENABLE_OPTS}")
 message(STATUS "ENABLE_OSCILLATORS=${ENABLE_OSCILLATORS}")
+message(STATUS "ENABLE_OSCILLATORS_CUDA=${ENABLE_OSCILLATORS_CUDA}")
 message(STATUS "ENABLE_CONDUITTEST=${ENABLE_CONDUITTEST}")
 message(STATUS "ENABLE_KRIPKE=${ENABLE_KRIPKE}")
 
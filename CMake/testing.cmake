@@ -15,11 +15,12 @@ math(EXPR TEST_NP_HALF "${TEST_NP}/2")
 #   COMMAND -- required, test command
 #   FEATURES -- optional, boolean condition decribing feature dependencies
 #   REQ_SENSEI_DATA -- flag whose presence indicates the test needs the data repo
+#   LABELS -- optional, ctest labels, select with ctest -L
 #   )
 function (senseiAddTest T_NAME)
   set(opt_args REQ_SENSEI_DATA)
   set(val_args EXEC_NAME)
-  set(array_args SOURCES LIBS COMMAND FEATURES)
+  set(array_args SOURCES LIBS COMMAND FEATURES LABELS)
   cmake_parse_arguments(T "${opt_args}" "${val_args}" "${array_args}" ${ARGN})
   set(TEST_ENABLED ON)
   if (NOT DEFINED T_FEATURES)
@@ -47,6 +48,9 @@ function (senseiAddTest T_NAME)
         WORKING_DIRECTORY ${CMAKE_RUNTIME_OUTPUT_DIRECTORY})
       set_tests_properties(${T_NAME}
         PROPERTIES FAIL_REGULAR_EXPRESSION "[Ee][Rr][Rr][Oo][Rr]")
+      if (T_LABELS)
+        set_tests_properties(${T_NAME} PROPERTIES LABELS "${T_LABELS}")
+      endif()
     endif()
   endif()
 endfunction()
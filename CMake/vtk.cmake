@@ -21,8 +21,8 @@ if (ENABLE_VTK_IO)
   endif()
 endif()
 if (ENABLE_VTK_RENDERING)
-  list(APPEND sensei_vtk_components_legacy vtkRenderingCore)
-  list(APPEND sensei_vtk_components_modern RenderingCore)
+  list(APPEND sensei_vtk_components_legacy vtkRenderingCore vtkIOImage)
+  list(APPEND sensei_vtk_components_modern RenderingCore IOImage)
   if (TARGET vtkRenderingOpenGL2)
     list(APPEND sensei_vtk_components_legacy vtkRenderingOpenGL2)
     list(APPEND sensei_vtk_components_modern RenderingOpenGL2)
@@ -1,19 +1,25 @@
 #include "ConfigurableInTransitDataAdaptor.h"
 #include "ConfigurableAnalysis.h"
+#include "DataRequirements.h"
 #include "MPIManager.h"
+#include "MPISchema.h"
 #include "Profiler.h"
+#include "XMLUtils.h"
 #include "Error.h"
 
 #include <opts/opts.h>
+#include <pugixml.hpp>
 
 #include <mpi.h>
 #include <iostream>
+#include <vector>
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
 #include <vtkDataSet.h>
 
 using DataAdaptorPtr = vtkSmartPointer<sensei::ConfigurableInTransitDataAdaptor>;
 using AnalysisAdaptorPtr = vtkSmartPointer<sensei::ConfigurableAnalysis>;
+using StepPtr = vtkSmartPointer<sensei::DataAdaptor>;
 
 int main(int argc, char **argv)
 {
@@ -23,6 +29,8 @@ int main(int argc, char **argv)
   std::string transportXml;
   std::string analysisXml;
   std::string connectionInfo;
+  unsigned int batchSize = 1;
+  unsigned long batchMemory = 0;
 
   opts::Options ops(argc, argv);
 
@@ -33,7 +41,19 @@ int main(int argc, char **argv)
       "SENSEI analysis XML configuration file")
 
     >> opts::Option('c', "connection-info", connectionInfo,
-       "transport specific connection information");
+       "transport specific connection information")
+
+    >> opts::Option('b', "batch", batchSize,
+       "number of steps gathered and handed to the analyses at once")
+
+    >> opts::Option("batch-memory", batchMemory,
+       "memory in MiB a batch may use, 0 for no limit");
+
+  // when launched with the simulation as one MPMD job the end point
+  // runs on its own part of MPI_COMM_WORLD
+  MPI_Comm comm = MPI_COMM_WORLD;
+  if (ops >> opts::Present('m', "mpmd", "run as one application of an MPMD job"))
+    senseiMPI::GetAppCommunicator(comm);
 
   if (ops >> opts::Present('h', "help", "show help"))
     {
@@ -50,11 +70,35 @@ int main(int argc, char **argv)
     MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
+  // the analysis XML may split the ranks into groups. each group reads the
+  // stream on its own, its partitioner spreading the blocks over the
+  // group's ranks, and runs its analyses at the same time as the others
+  pugi::xml_document analysisDoc;
+  if (sensei::XMLUtils::Parse(comm, analysisXml, analysisDoc))
+    {
+    SENSEI_ERROR("Failed to load, parse, and share \"" << analysisXml << "\"")
+    MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+  pugi::xml_node analysisRoot = analysisDoc.child("sensei");
+
+  MPI_Comm groupComm = MPI_COMM_NULL;
+  std::string groupName;
+  if (sensei::ConfigurableAnalysis::SplitGroups(comm, analysisRoot,
+    groupComm, groupName))
+    {
+    SENSEI_ERROR("Failed to split the ranks into analysis groups")
+    MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+  MPI_Comm runComm = (groupComm == MPI_COMM_NULL) ? comm : groupComm;
+
   // create the reead side of the transport
   SENSEI_STATUS("Creating transport data adaptor. transport-xml=\""
     << transportXml << "\"")
 
   DataAdaptorPtr dataAdaptor = DataAdaptorPtr::New();
+  dataAdaptor->SetCommunicator(runComm);
   if (dataAdaptor->SetConnectionInfo(connectionInfo) ||
     dataAdaptor->Initialize(transportXml))
     {
@@ -62,49 +106,130 @@ int main(int argc, char **argv)
     MPI_Abort(MPI_COMM_WORLD, -1);
     }
 
-  // connect and open the stream
-  if (dataAdaptor->OpenStream())
-    {
-    SENSEI_ERROR("Failed to open stream. connection-info=\""
-      << connectionInfo << "\"")
-    MPI_Abort(MPI_COMM_WORLD, -1);
-    }
-
   // initlaize the analysis using the XML configurable adaptor
   SENSEI_STATUS("Creating the analysis adaptor. analysis-xml=\""
     << analysisXml << "\"")
 
   AnalysisAdaptorPtr analysisAdaptor = AnalysisAdaptorPtr::New();
-  if (analysisAdaptor->Initialize(analysisXml))
+  analysisAdaptor->SetCommunicator(runComm);
+  analysisAdaptor->SetGroup(groupName);
+  analysisAdaptor->SetEndPoint(1);
+  if (analysisAdaptor->Initialize(analysisRoot))
     {
     SENSEI_ERROR("Failed to initialize analysis adaptor")
     MPI_Abort(MPI_COMM_WORLD, -1);
     }
 
+  // read only the data the analyses access, unless the transport's XML
+  // names it
+  sensei::DataRequirements reqs;
+  bool complete = false;
+  if (analysisAdaptor->GetAllDataRequirements(reqs, complete))
+    {
+    SENSEI_ERROR("Failed to get the data requirements of the analyses")
+    MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+  if (complete && dataAdaptor->GetDataRequirements().Empty())
+    dataAdaptor->SetDataRequirements(reqs);
+
+  // connect and open the stream. this is done once the requirements are
+  // set since the transport may start reading ahead when the stream opens
+  if (dataAdaptor->OpenStream())
+    {
+    SENSEI_ERROR("Failed to open stream. connection-info=\""
+      << connectionInfo << "\"")
+    MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
   // read from the stream until all steps have been
   // processed
   unsigned int nSteps = 0;
-  do
+  if (batchSize > 1)
     {
-    // gte the current simulation time and time step
-    long timeStep = dataAdaptor->GetDataTimeStep();
-    double time = dataAdaptor->GetDataTime();
-    nSteps += 1;
+    // gather copies of up to batchSize steps, within the memory budget,
+    // and execute them together. analyses that accept batches amortize
+    // their per-step costs over the batch. at least one step is held
+    // irrespective of the budget
+    std::vector<StepPtr> batch;
+    unsigned long batchBytes = 0;
+    bool more = true;
+    do
+      {
+      long timeStep = dataAdaptor->GetDataTimeStep();
+      double time = dataAdaptor->GetDataTime();
+      nSteps += 1;
 
-    SENSEI_STATUS("Processing time step " << timeStep << " time " << time)
+      SENSEI_STATUS("Gathering time step " << timeStep << " time " << time)
 
-    // execute the analysis
-    if (!analysisAdaptor->Execute(dataAdaptor.Get()))
-      {
-      SENSEI_ERROR("Execute failed")
-      MPI_Abort(MPI_COMM_WORLD, -1);
+      sensei::DataAdaptor *step = nullptr;
+      unsigned long stepBytes = 0;
+      if (dataAdaptor->NewStepSnapshot(step, stepBytes))
+        {
+        SENSEI_ERROR("Failed to copy time step " << timeStep)
+        MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+
+      StepPtr stepPtr;
+      stepPtr.TakeReference(step);
+      batch.push_back(stepPtr);
+      batchBytes += stepBytes;
+
+      dataAdaptor->ReleaseData();
+
+      more = !dataAdaptor->AdvanceStream();
+
+      // the decision is made collectively so that all ranks of the group
+      // execute batches of the same steps
+      int full = (batch.size() >= batchSize) ||
+        (batchMemory && (batchBytes >= 1024ul*1024ul*batchMemory));
+
+      MPI_Allreduce(MPI_IN_PLACE, &full, 1, MPI_INT, MPI_MAX, runComm);
+
+      if (full || !more)
+        {
+        SENSEI_STATUS("Processing a batch of " << batch.size() << " time steps")
+
+        std::vector<sensei::DataAdaptor*> steps(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i)
+          steps[i] = batch[i].Get();
+
+        if (!analysisAdaptor->ExecuteBatch(steps))
+          {
+          SENSEI_ERROR("ExecuteBatch failed")
+          MPI_Abort(MPI_COMM_WORLD, -1);
+          }
+
+        batch.clear();
+        batchBytes = 0;
+        }
       }
+    while (more);
+    }
+  else
+    {
+    do
+      {
+      // gte the current simulation time and time step
+      long timeStep = dataAdaptor->GetDataTimeStep();
+      double time = dataAdaptor->GetDataTime();
+      nSteps += 1;
+
+      SENSEI_STATUS("Processing time step " << timeStep << " time " << time)
+
+      // execute the analysis
+      if (!analysisAdaptor->Execute(dataAdaptor.Get()))
+        {
+        SENSEI_ERROR("Execute failed")
+        MPI_Abort(MPI_COMM_WORLD, -1);
+        }
 
-    // let the data adaptor release the mesh and data from this
-    // time step
-    dataAdaptor->ReleaseData();
+      // let the data adaptor release the mesh and data from this
+      // time step
+      dataAdaptor->ReleaseData();
+      }
+    while (!dataAdaptor->AdvanceStream());
     }
-  while (!dataAdaptor->AdvanceStream());
 
   SENSEI_STATUS("Finished processing " << nSteps << " time steps")
 
@@ -112,6 +237,17 @@ int main(int argc, char **argv)
   dataAdaptor->CloseStream();
   dataAdaptor->Finalize();
 
+  // report how well the end point kept up with the sender
+  unsigned long nProcessed = 0;
+  unsigned long nSkipped = 0;
+  dataAdaptor->GetStepCounters(nProcessed, nSkipped);
+
+  sensei::Profiler::LogCounter("SENSEIEndPoint::StepsProcessed", nProcessed);
+  sensei::Profiler::LogCounter("SENSEIEndPoint::StepsSkipped", nSkipped);
+
+  if (nSkipped)
+    SENSEI_STATUS("The step policy skipped " << nSkipped << " time steps")
+
   analysisAdaptor->Finalize();
 
   // we must force these to be destroyed before mpi finalize some of the analysis
@@ -119,5 +255,11 @@ int main(int argc, char **argv)
   dataAdaptor = nullptr;
   analysisAdaptor = nullptr;
 
+  if (groupComm != MPI_COMM_NULL)
+    MPI_Comm_free(&groupComm);
+
+  if (comm != MPI_COMM_WORLD)
+    MPI_Comm_free(&comm);
+
   return 0;
 }
@@ -0,0 +1,274 @@
+#include "ConfigurableInTransitDataAdaptor.h"
+#include "ConfigurableAnalysis.h"
+#include "MPIManager.h"
+#include "MPISchema.h"
+#include "Error.h"
+
+#include <opts/opts.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <vtkSmartPointer.h>
+
+using DataAdaptorPtr = vtkSmartPointer<sensei::ConfigurableInTransitDataAdaptor>;
+using AnalysisAdaptorPtr = vtkSmartPointer<sensei::ConfigurableAnalysis>;
+using StepPtr = vtkSmartPointer<sensei::DataAdaptor>;
+
+// Replays stored time steps through the analyses as fast as they can take
+// them. The steps are read by the configured transport, typically the
+// ADIOS2 BP or HDF5 file readers, with the prefetch of the transport XML
+// applied. The steps may be held in memory so that the analyses are timed
+// without the reads, and may be played more than once.
+
+namespace
+{
+// execute the analyses on the current step
+int execute(const AnalysisAdaptorPtr &analysisAdaptor,
+  sensei::DataAdaptor *data, unsigned long &nSteps)
+{
+  SENSEI_STATUS("Replaying time step " << data->GetDataTimeStep()
+    << " time " << data->GetDataTime())
+
+  if (!analysisAdaptor->Execute(data))
+    {
+    SENSEI_ERROR("Execute failed")
+    return -1;
+    }
+
+  nSteps += 1;
+
+  return 0;
+}
+
+// report the throughput of each analysis. the time of the slowest rank
+// bounds the rate of a collective analysis
+void report(MPI_Comm comm, const AnalysisAdaptorPtr &analysisAdaptor,
+  unsigned long nSteps, double wallTime)
+{
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  std::ostringstream oss;
+  oss << std::setprecision(4)
+    << "Replayed " << nSteps << " time steps in " << wallTime << " s, "
+    << (wallTime > 0.0 ? nSteps/wallTime : 0.0) << " steps/s" << std::endl;
+
+  unsigned int nAnalyses = analysisAdaptor->GetNumberOfAnalyses();
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    sensei::ConfigurableAnalysis::AnalysisCost cost;
+    analysisAdaptor->GetAnalysisCost(i, cost);
+
+    double times[2] = {cost.TotalTime, cost.MaxTime};
+    long long bytes = cost.TotalBytes;
+
+    MPI_Allreduce(MPI_IN_PLACE, times, 2, MPI_DOUBLE, MPI_MAX, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &bytes, 1, MPI_LONG_LONG, MPI_SUM, comm);
+
+    double stepRate = times[0] > 0.0 ? cost.NumExecutions/times[0] : 0.0;
+    double byteRate = times[0] > 0.0 ? bytes/times[0]/(1024.0*1024.0) : 0.0;
+
+    oss << "  " << cost.Name << ": " << cost.NumExecutions
+      << " executions in " << times[0] << " s, " << stepRate << " steps/s, "
+      << byteRate << " MiB/s, slowest step " << times[1] << " s" << std::endl;
+    }
+
+  if (rank == 0)
+    std::cerr << oss.str();
+}
+}
+
+int main(int argc, char **argv)
+{
+  sensei::MPIManager mpiMan(argc, argv);
+  int rank = mpiMan.GetCommRank();
+
+  std::string transportXml;
+  std::string analysisXml;
+  std::string connectionInfo;
+  unsigned int nLoops = 1;
+  unsigned long maxSteps = 0;
+  unsigned long cacheMemory = 0;
+
+  opts::Options ops(argc, argv);
+
+  ops >> opts::Option('t', "transport-xml", transportXml,
+         "SENSEI transport XML configuration file")
+
+    >> opts::Option('a', "analysis-xml", analysisXml,
+      "SENSEI analysis XML configuration file")
+
+    >> opts::Option('c', "connection-info", connectionInfo,
+       "transport specific connection information, the file name")
+
+    >> opts::Option('l', "loop", nLoops,
+       "number of times the steps are played")
+
+    >> opts::Option('n', "max-steps", maxSteps,
+       "number of steps read from the stream, 0 for all")
+
+    >> opts::Option("cache-memory", cacheMemory,
+       "memory in MiB the cached steps may use, 0 for no limit");
+
+  bool cache = ops >> opts::Present("cache",
+    "read the steps into memory before playing them");
+
+  if (ops >> opts::Present('h', "help", "show help"))
+    {
+    if (rank == 0)
+      cerr << "Usage: SENSEIReplay [OPTIONS]\n\n" << ops << endl;
+    MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+  if (transportXml.empty() || analysisXml.empty())
+    {
+    SENSEI_ERROR("Missing " << (transportXml.empty() ?
+      (analysisXml.empty() ? "transport and analysis XML" :
+      "transport XML") : "analysis XML"))
+    MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+  MPI_Comm comm = MPI_COMM_WORLD;
+
+  // create the read side of the transport
+  SENSEI_STATUS("Creating transport data adaptor. transport-xml=\""
+    << transportXml << "\"")
+
+  DataAdaptorPtr dataAdaptor = DataAdaptorPtr::New();
+  dataAdaptor->SetCommunicator(comm);
+  if (dataAdaptor->SetConnectionInfo(connectionInfo) ||
+    dataAdaptor->Initialize(transportXml))
+    {
+    SENSEI_ERROR("Failed to initialize the transport data adaptor")
+    MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+  SENSEI_STATUS("Creating the analysis adaptor. analysis-xml=\""
+    << analysisXml << "\"")
+
+  AnalysisAdaptorPtr analysisAdaptor = AnalysisAdaptorPtr::New();
+  analysisAdaptor->SetCommunicator(comm);
+  if (analysisAdaptor->Initialize(analysisXml))
+    {
+    SENSEI_ERROR("Failed to initialize analysis adaptor")
+    MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+  std::vector<StepPtr> steps;
+  unsigned long nSteps = 0;
+  double wallTime = 0.0;
+
+  if (cache)
+    {
+    // copy the steps the analyses need into memory, the time of the
+    // replay does not include the reads
+    if (dataAdaptor->OpenStream())
+      {
+      SENSEI_ERROR("Failed to open stream. connection-info=\""
+        << connectionInfo << "\"")
+      MPI_Abort(MPI_COMM_WORLD, -1);
+      }
+
+    unsigned long cacheBytes = 0;
+    int full = 0;
+    do
+      {
+      sensei::DataAdaptor *step = nullptr;
+      unsigned long stepBytes = 0;
+      if (dataAdaptor->NewStepSnapshot(step, stepBytes))
+        {
+        SENSEI_ERROR("Failed to copy time step "
+          << dataAdaptor->GetDataTimeStep())
+        MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+
+      StepPtr stepPtr;
+      stepPtr.TakeReference(step);
+      steps.push_back(stepPtr);
+      cacheBytes += stepBytes;
+
+      dataAdaptor->ReleaseData();
+
+      // the decision is made collectively so that all ranks hold the
+      // same steps
+      full = (maxSteps && (steps.size() >= maxSteps)) ||
+        (cacheMemory && (cacheBytes >= 1024ul*1024ul*cacheMemory));
+
+      MPI_Allreduce(MPI_IN_PLACE, &full, 1, MPI_INT, MPI_MAX, comm);
+      }
+    while (!full && !dataAdaptor->AdvanceStream());
+
+    dataAdaptor->CloseStream();
+
+    SENSEI_STATUS("Cached " << steps.size() << " time steps in "
+      << cacheBytes/(1024ul*1024ul) << " MiB")
+
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+
+    for (unsigned int l = 0; l < nLoops; ++l)
+      {
+      for (size_t i = 0; i < steps.size(); ++i)
+        {
+        if (execute(analysisAdaptor, steps[i].Get(), nSteps))
+          MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+      }
+
+    MPI_Barrier(comm);
+    wallTime = MPI_Wtime() - t0;
+    }
+  else
+    {
+    // read the steps as they are played, the stream is opened again for
+    // each loop
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+
+    for (unsigned int l = 0; l < nLoops; ++l)
+      {
+      if (dataAdaptor->OpenStream())
+        {
+        SENSEI_ERROR("Failed to open stream. connection-info=\""
+          << connectionInfo << "\"")
+        MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+
+      unsigned long nRead = 0;
+      do
+        {
+        if (execute(analysisAdaptor, dataAdaptor.Get(), nSteps))
+          MPI_Abort(MPI_COMM_WORLD, -1);
+
+        dataAdaptor->ReleaseData();
+        nRead += 1;
+        }
+      while (!(maxSteps && (nRead >= maxSteps)) &&
+        !dataAdaptor->AdvanceStream());
+
+      dataAdaptor->CloseStream();
+      }
+
+    MPI_Barrier(comm);
+    wallTime = MPI_Wtime() - t0;
+    }
+
+  steps.clear();
+
+  dataAdaptor->Finalize();
+
+  // asynchronous analyses are accounted for once they complete
+  analysisAdaptor->Finalize();
+
+  report(comm, analysisAdaptor, nSteps, wallTime);
+
+  // we must force these to be destroyed before mpi finalize some of the analysis
+  // adaptors (eg Catalyst) make MPI calls in the destructor
+  dataAdaptor = nullptr;
+  analysisAdaptor = nullptr;
+
+  return 0;
+}
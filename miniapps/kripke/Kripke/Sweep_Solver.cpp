@@ -8,6 +8,7 @@
 #include <Kripke/ParallelComm.h>
 #include <Kripke/Grid.h>
 #include <vector>
+#include <string>
 #include <stdio.h>
 
 /*--------------------------------------------------------------------------
@@ -23,9 +24,38 @@ using namespace conduit;
 static int count = 0;
 static int max_backlog = 0;
 
+// The distance, in elements, between consecutive values of the external
+// index dim (0 group, 1 direction or moment, 2 zone) for the vector's
+// nesting order.
+static conduit::index_t subtvec_stride(SubTVec const &v, int dim)
+{
+  conduit::index_t stride = 1;
+  for(int i = v.ext_to_int[dim]+1; i < 3; ++i)
+  {
+    stride *= v.size_int[i];
+  }
+  return stride;
+}
+
+// Point the Conduit node at the zone values of one group and direction or
+// moment of the vector. The values are strided in every nesting order but
+// GDZ and DGZ, Conduit describes that without a copy.
+static void set_external_zones(conduit::Node &n, SubTVec &v, int g, int d)
+{
+  n.set_external(v.ptr(g, d, 0), v.zones, 0,
+    subtvec_stride(v, 2)*sizeof(conduit::float64));
+}
+
 void writeData(Grid_Data *grid_data, int timeStep, const std::string& file)
 {
-  
+  // SENSEI is initialized on the first step. After that the moments and
+  // the Conduit description are only made on steps that are analyzed
+  conduit::float64 time = 3.1415;
+  if(timeStep > 0 && !will_analyze(timeStep, time))
+  {
+    return;
+  }
+
   grid_data->kernel->LTimes(grid_data);
   conduit::Node data;
   
@@ -44,7 +74,7 @@ void writeData(Grid_Data *grid_data, int timeStep, const std::string& file)
     //create coords array
     conduit::float64 *coords[3];
 
-    data["state/time"]   = (conduit::float64)3.1415;
+    data["state/time"]   = time;
     data["state/domain_id"] = (conduit::uint64) myid;
     data["state/cycle"]  = (conduit::uint64) timeStep;
 
@@ -73,32 +103,43 @@ void writeData(Grid_Data *grid_data, int timeStep, const std::string& file)
         coords[dim][1+z] = coords[dim][z] + sdom.deltas[dim][z];
       }
     }
-    data["fields/phi/association"] = "element";
-    data["fields/phi/topology"] = "mesh";
-    data["fields/phi/type"] = "scalar";
-  
-    data["fields/phi/values"].set(conduit::DataType::float64(sdom.num_zones));
-    conduit::float64 * phi_scalars = data["fields/phi/values"].value();
-
-    // TODO can we do this with strides and not copy?
-    for(int i = 0; i < sdom.num_zones; i++)
+    // The zeroth moment of the flux is passed in place, for the first
+    // group as phi and for each group as phi_<group> when there are more.
+    SubTVec &phi = *sdom.phi;
+    int num_fields = phi.groups > 1 ? phi.groups + 1 : 1;
+    for(int f = 0; f < num_fields; ++f)
     {
-      phi_scalars[i] = (*sdom.phi)(0,0,i);  
-    } 
+      int group = f ? f - 1 : 0;
+      std::string path = "fields/phi";
+      if(f)
+      {
+        path += "_" + std::to_string(group);
+      }
+
+      conduit::Node &field = data[path];
+      field["association"] = "element";
+      field["topology"] = "mesh";
+      field["type"] = "scalar";
+      set_external_zones(field["values"], phi, group, 0);
+    }
 
   }//each sdom
   
    //------- end wrapping with Conduit here -------//
-  conduit::Node verify_info;
-  if(!conduit::blueprint::mesh::verify(data,verify_info))
-  {
-      CONDUIT_INFO("blueprint verify failed!" + verify_info.to_json());
-  }
-  else
+  // The layout is the same every step, check it once.
+  if(timeStep == 0)
   {
-      CONDUIT_INFO("blueprint verify succeeded");
+    conduit::Node verify_info;
+    if(!conduit::blueprint::mesh::verify(data,verify_info))
+    {
+        CONDUIT_INFO("blueprint verify failed!" + verify_info.to_json());
+    }
+    else
+    {
+        CONDUIT_INFO("blueprint verify succeeded");
+    }
+    data.print();
   }
-  data.print();
 
   //Pass data to SENSEI
   if(timeStep == 0)
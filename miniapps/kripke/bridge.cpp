@@ -35,6 +35,11 @@ void initialize(MPI_Comm comm,
   BridgeGuts::AnalysisAdaptor->Initialize(config_file); 
 }
 
+bool will_analyze(int timeStep, double time)
+{
+  return BridgeGuts::AnalysisAdaptor->WillExecute(timeStep, time);
+}
+
 void analyze(conduit::Node* node)
 {
   BridgeGuts::DataAdaptor->SetNode(node);
@@ -10,6 +10,9 @@
                   conduit::Node* node, 
                   const std::string& config_file);
 
+  //called during simulation loop, false when no analysis runs on the step
+  bool will_analyze(int timeStep, double time);
+
   //called during simulation loop to update node
   void analyze(conduit::Node* node); 
 
@@ -6,6 +6,10 @@
 #include <sstream>
 #include <string>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 #include <mpi.h>
 
@@ -66,10 +70,13 @@ mandelbrot(const complex &C)
     return 0;
 }
 
+// -----------------------------------------------------------------------------
+// @brief Compute rows j0 to j1-1 of the patch's data.
+//
 void
-calculate_data(patch_t *patch)
+calculate_rows(patch_t *patch, int j0, int j1)
 {
-    unsigned char *data = patch->data;
+    unsigned char *data = patch->data + j0*patch->nx;
 
     // Compute x0, x1 and y0,y1 which help us locate cell centers.
     float cellWidth = (patch->window[1] - patch->window[0]) / ((float)patch->nx);
@@ -78,7 +85,7 @@ calculate_data(patch_t *patch)
     float cellHeight = (patch->window[3] - patch->window[2]) / ((float)patch->ny);
     float y0 = patch->window[2] + cellHeight / 2.f;
     float y1 = patch->window[3] - cellHeight / 2.f;
-    for(int j = 0; j < patch->ny; ++j)
+    for(int j = j0; j < j1; ++j)
     {
         float ty = (float)j / (float)(patch->ny - 1);
         float y = y0 + ty * (y1 - y0);
@@ -92,6 +99,68 @@ calculate_data(patch_t *patch)
     }
 }
 
+void
+calculate_data(patch_t *patch)
+{
+    calculate_rows(patch, 0, patch->ny);
+}
+
+// Below this many cells the patches are computed on the calling thread.
+#define MIN_THREADED_CELLS 16384
+
+// -----------------------------------------------------------------------------
+// @brief Allocate and compute the data on a list of patches using sim->nthreads
+//        threads. The cost of a cell varies a lot with its distance to the
+//        set, so the rows of all of the patches are dealt out in small chunks
+//        to whichever thread is free.
+//
+void
+calculate_patches(simulation_data *sim, patch_t **patches, int npatches)
+{
+    // Make the list of chunks of rows.
+    const int chunk_cells = 1024;
+    std::vector<int> chunks; // patch, j0, j1
+    long long ncells = 0;
+    for(int i = 0; i < npatches; ++i)
+    {
+        patch_t *p = patches[i];
+        patch_alloc_data(p, p->nx, p->ny);
+        ncells += (long long)p->nx * p->ny;
+
+        int rows = std::max(1, chunk_cells / std::max(1, p->nx));
+        for(int j = 0; j < p->ny; j += rows)
+        {
+            chunks.push_back(i);
+            chunks.push_back(j);
+            chunks.push_back(std::min(j + rows, p->ny));
+        }
+    }
+
+    int nchunks = chunks.size() / 3;
+    int nthreads = std::min(sim->nthreads, nchunks);
+    if(nthreads < 2 || ncells < MIN_THREADED_CELLS)
+    {
+        for(int i = 0; i < npatches; ++i)
+            calculate_data(patches[i]);
+        return;
+    }
+
+    std::atomic<int> next(0);
+    auto work = [&]()
+    {
+        int c;
+        while((c = next++) < nchunks)
+            calculate_rows(patches[chunks[3*c]], chunks[3*c+1], chunks[3*c+2]);
+    };
+
+    std::vector<std::thread> threads;
+    for(int i = 1; i < nthreads; ++i)
+        threads.push_back(std::thread(work));
+    work();
+    for(size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+}
+
 //*****************************************************************************
 // Code for helping calculate AMR refinement
 //*****************************************************************************
@@ -165,34 +234,33 @@ log_patches(patch_t *patch, const char *msg)
 #endif
 
 #if 1
-int
-count_local_patches(simulation_data *sim)
+// -----------------------------------------------------------------------------
+// @brief Returns true if this rank is the one that owns the patch from a vis
+//        perspective, and so is charged for its work.
+//
+inline bool
+owns_patch(simulation_data *sim, patch_t *patch)
 {
-    int np = 0;
-    patch_t **patches_this_rank = patch_flat_array(&sim->patch, &np);
-    int count = 0;
-    for(int i = 0; i < np; ++i)
-    {
-        if(patches_this_rank[i]->nowners > 1)
-        {
-            if(patches_this_rank[i]->owners[0] == sim->par_rank)
-                count++;
-        }
-        else
-            count++;
-    }
-    FREE(patches_this_rank);
-    return count;
+    return (patch->nowners == 1) || (patch->owners[0] == sim->par_rank);
+}
+
+// -----------------------------------------------------------------------------
+// @brief The work, in cells, that one patch adds to its owner.
+//
+inline long long
+patch_work(patch_t *patch)
+{
+    return (long long)patch->nx * patch->ny;
 }
 
 int compare_workload(const void *a, const void *b)
 {
-    const int *A = (const int *)a;
-    const int *B = (const int *)b;
+    const long long *A = (const long long *)a;
+    const long long *B = (const long long *)b;
     if(A[1] < B[1])
         return -1;
     else if(A[1] == B[1])
-        return 0;
+        return (A[0] < B[0]) ? -1 : ((A[0] == B[0]) ? 0 : 1);
     else
         return 1;
 }
@@ -201,55 +269,97 @@ int compare_workload(const void *a, const void *b)
 // @brief This routine is called among the owners of a patch to decide who has
 //        the most work. The owner list is sorted so ranks with less work appear
 //        first in the list so they can get a little more work when we assign
-//        patches to ranks.
+//        patches to ranks. The work of each owner, in the sorted order, is
+//        returned in workload.
 //
 void
-sort_owners_by_workload(MPI_Comm comm, simulation_data *sim, patch_t *patch)
+sort_owners_by_workload(MPI_Comm comm, simulation_data *sim, patch_t *patch,
+    std::vector<long long> &workload)
 {
-    // How much work do we have?
-    int nlocal_patches = count_local_patches(sim);
+    // How much work do we have? The number of cells computed on this rank
+    // so far is kept up to date as patches are computed.
+    long long nlocal_cells = sim->local_work;
 
     // We need to among just the processors in the owner list for this patch.
     // Let's do point 2 point.
     int tag = 1000, tag2 = 1001;
-    int *counts = new int[patch->nowners];
+    long long *counts = new long long[patch->nowners];
     if(sim->par_rank == patch->owners[0])
     {
-        counts[0] = nlocal_patches;
+        counts[0] = nlocal_cells;
         // Gather to the first
         MPI_Status status;
         for(int i = 1; i < patch->nowners; ++i)
-            MPI_Recv(counts + i, 1, MPI_INT, patch->owners[i], tag, comm, &status);
+            MPI_Recv(counts + i, 1, MPI_LONG_LONG, patch->owners[i], tag, comm, &status);
         // Send to the rest
         for(int i = 1; i < patch->nowners; ++i)
-            MPI_Send(counts, patch->nowners, MPI_INT, patch->owners[i], tag2, comm);
+            MPI_Send(counts, patch->nowners, MPI_LONG_LONG, patch->owners[i], tag2, comm);
     }
     else
     {
-        MPI_Send(&nlocal_patches, 1, MPI_INT, patch->owners[0], tag, comm);
+        MPI_Send(&nlocal_cells, 1, MPI_LONG_LONG, patch->owners[0], tag, comm);
         MPI_Status status;
-        MPI_Recv(counts, patch->nowners, MPI_INT, patch->owners[0], tag2, comm, &status);
+        MPI_Recv(counts, patch->nowners, MPI_LONG_LONG, patch->owners[0], tag2, comm, &status);
     }
 
     // Now we have counts on all ranks. Sort according to workload so the low
     // work ranks are first where they are more likely to get assigned work
     // due to the mod assignment.
-    int *s = new int[patch->nowners * 2];
+    long long *s = new long long[patch->nowners * 2];
     for(int i = 0; i < patch->nowners; ++i)
     {
         s[2*i]   = patch->owners[i]; // owner
         s[2*i+1] = counts[i]; // workload
     }
-    qsort(s, patch->nowners, 2*sizeof(int), compare_workload);
+    qsort(s, patch->nowners, 2*sizeof(long long), compare_workload);
     delete [] counts;
 
     // We've sorted based on the workload.
+    workload.resize(patch->nowners);
     for(int i = 0; i < patch->nowners; ++i)
-        patch->owners[i] = s[2*i];
+    {
+        patch->owners[i] = (int)s[2*i];
+        workload[i] = s[2*i+1];
+    }
     delete [] s;
 }
 #endif
 
+// -----------------------------------------------------------------------------
+// @brief Assign each subpatch to a single owner such that the owners' work is
+//        as even as possible. The largest subpatches are placed first, each on
+//        the owner with the least work so far. Every owner of the patch makes
+//        the same decisions since they have the same subpatches and workloads.
+//
+void
+assign_patches_by_workload(patch_t *patch, std::vector<long long> &workload,
+    std::vector<int> &owner_of)
+{
+    std::vector<int> order(patch->nsubpatches);
+    for(int i = 0; i < patch->nsubpatches; ++i)
+        order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(),
+        [patch](int a, int b) -> bool
+        {
+            return patch_work(&patch->subpatches[a]) >
+                patch_work(&patch->subpatches[b]);
+        });
+
+    owner_of.resize(patch->nsubpatches);
+    for(int i = 0; i < patch->nsubpatches; ++i)
+    {
+        int sp = order[i];
+        int least = 0;
+        for(int j = 1; j < patch->nowners; ++j)
+            if(workload[j] < workload[least])
+                least = j;
+
+        owner_of[sp] = patch->owners[least];
+        workload[least] += patch_work(&patch->subpatches[sp]);
+    }
+}
+
 // -----------------------------------------------------------------------------
 // @brief Takes the input patch and doles out the subpatches it contains to the
 //        ranks that own the input patch.
@@ -268,27 +378,44 @@ assign_patches(MPI_Comm comm, simulation_data *sim, patch_t *patch)
 #if 1
         // Sort the owner list by the total amount of work so the least loaded
         // ranks are first in the list.
+        std::vector<long long> workload;
         if(sim->balance)
-            sort_owners_by_workload(comm, sim, patch);
+            sort_owners_by_workload(comm, sim, patch, workload);
 #endif
-        // The current patch exists on more than one rank. Divide the
-        // refined patch list among those ranks.
-        int n = std::max(patch->nowners, patch->nsubpatches);
         std::vector<int> patches_owned_by_this_rank;
-        for(int i = 0; i < n; ++i)
+        if(sim->balance && patch->nsubpatches > patch->nowners)
         {
-            int owner = patch->owners[i % patch->nowners];
-            int subpatchIndex = i % patch->nsubpatches;
-            patch_add_owner(&patch->subpatches[subpatchIndex], owner);
-
-            if(owner == sim->par_rank)
+            // There are more subpatches than owners. Give each subpatch to
+            // one owner, evening out the work.
+            std::vector<int> owner_of;
+            assign_patches_by_workload(patch, workload, owner_of);
+            for(int i = 0; i < patch->nsubpatches; ++i)
             {
-                patches_owned_by_this_rank.push_back(subpatchIndex);
-#ifdef DO_LOG
-                fprintf(debuglog, "assign_patches: patches owned by this rank: %d\n", subpatchIndex);
-#endif
+                patch_add_owner(&patch->subpatches[i], owner_of[i]);
+                if(owner_of[i] == sim->par_rank)
+                    patches_owned_by_this_rank.push_back(i);
             }
         }
+        else
+        {
+            // The current patch exists on more than one rank. Divide the
+            // refined patch list among those ranks.
+            int n = patch->nsubpatches ?
+                std::max(patch->nowners, patch->nsubpatches) : 0;
+            for(int i = 0; i < n; ++i)
+            {
+                int owner = patch->owners[i % patch->nowners];
+                int subpatchIndex = i % patch->nsubpatches;
+                patch_add_owner(&patch->subpatches[subpatchIndex], owner);
+
+                if(owner == sim->par_rank)
+                    patches_owned_by_this_rank.push_back(subpatchIndex);
+            }
+        }
+#ifdef DO_LOG
+        for(size_t i = 0; i < patches_owned_by_this_rank.size(); ++i)
+            fprintf(debuglog, "assign_patches: patches owned by this rank: %d\n", patches_owned_by_this_rank[i]);
+#endif
 
         // Keep just the ones we want on this rank.
         int *keep = ALLOC(patch->nsubpatches, int);
@@ -320,20 +447,14 @@ assign_patches(MPI_Comm comm, simulation_data *sim, patch_t *patch)
 }
 
 // -----------------------------------------------------------------------------
-// @brief Compute data for a patch. Refine the patch if we're not beyond max levels.
-//        The subpatches are divided among ranks that own patch. Then we recurse to
-//        compute data for the subpatches.
+// @brief Refine a patch whose data has been computed if we're not beyond max
+//        levels. The subpatches are divided among ranks that own patch. Then
+//        we compute data for the subpatches this rank kept, all at once so
+//        the threads have plenty of work, and recurse to refine them.
 //
 void
 calculate_amr_helper(MPI_Comm comm, simulation_data *sim, patch_t *patch, int level)
 {
-    // Save the level
-    patch->level = level;
-
-    // Calculate the data on this patch
-    patch_alloc_data(patch, patch->nx, patch->ny);
-    calculate_data(patch);
-
     if(level+1 > sim->max_levels)
         return;
 
@@ -351,13 +472,21 @@ calculate_amr_helper(MPI_Comm comm, simulation_data *sim, patch_t *patch, int le
     log_patches(patch, "AFTER assign_patches");
 #endif
 
-    // Recurse and compute data on subpatches.
+    // Calculate the data on the subpatches.
+    std::vector<patch_t *> subpatches(patch->nsubpatches);
     for(int i = 0; i < patch->nsubpatches; ++i)
     {
         patch_t *p = &patch->subpatches[i];
-        //patch_alloc_data(p, p->nx, p->ny);
-        calculate_amr_helper(comm, sim, p, level+1);
+        p->level = level+1;
+        subpatches[i] = p;
+        if(owns_patch(sim, p))
+            sim->local_work += patch_work(p);
     }
+    calculate_patches(sim, subpatches.data(), patch->nsubpatches);
+
+    // Recurse and refine the subpatches.
+    for(int i = 0; i < patch->nsubpatches; ++i)
+        calculate_amr_helper(comm, sim, &patch->subpatches[i], level+1);
 }
 
 // -----------------------------------------------------------------------------
@@ -471,8 +600,12 @@ calculate_amr(MPI_Comm comm, simulation_data *sim)
     debuglog = fopen(filename, "wt");
 #endif
 
-    // Compute the AMR patches.
-    calculate_amr_helper(comm, sim, &sim->patch, 0);
+    // Calculate the data on the root patch, then compute the AMR patches.
+    patch_t *root = &sim->patch;
+    root->level = 0;
+    sim->local_work = owns_patch(sim, root) ? patch_work(root) : 0;
+    calculate_patches(sim, &root, 1);
+    calculate_amr_helper(comm, sim, root, 0);
 
     // Assign ids to all of the AMR patches.
     assign_unique_patch_ids(comm, sim);
@@ -498,7 +631,8 @@ handle_command_line(int argc, char **argv, simulation_data *sim,
         if (strcmp(argv[i], "-h") == 0)
         {
             std::cerr << "usage: mandelbrot [-i num iterations] "
-                << "[-f SENSEI analysis XML] [-l max level] [-b balance]"
+                << "[-f SENSEI analysis XML] [-l max level] [-b balance] "
+                << "[-t num threads]"
                 << std::endl;
             exit(0);
         }
@@ -541,6 +675,12 @@ handle_command_line(int argc, char **argv, simulation_data *sim,
         {
             sim->balance = true;
         }
+        else if((strcmp(argv[i], "-t") == 0 ||
+                 strcmp(argv[i], "-threads") == 0) && (i+1)<argc)
+        {
+            sim->nthreads = std::max(1, atoi(argv[i+1]));
+            i++;
+        }
         else if(strcmp(argv[i], "-log") == 0)
         {
             sim->log = true;
@@ -10,9 +10,11 @@ simulation_data::simulation_data()
     refinement_ratio = 2;
     balance = false;
     log = false;
+    nthreads = 1;
     patch_ctor(&patch);
     npatches_per_rank = NULL;
     npatches_per_level = NULL;
+    local_work = 0;
 }
 
 simulation_data::~simulation_data()
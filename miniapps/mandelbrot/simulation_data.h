@@ -20,11 +20,13 @@ public:
     int     refinement_ratio;
     bool    balance;
     bool    log;
+    int     nthreads;
 
     patch_t patch;
 
     int     *npatches_per_rank;  // [par_size]
     int     *npatches_per_level; // [max_levels]
+    long long local_work;        // cells computed on this rank
 };
 
 #endif
@@ -1,49 +1,74 @@
 #include "Block.h"
 
+#include <algorithm>
+#include <thread>
+
 // --------------------------------------------------------------------------
 void Block::update_fields(float t)
 {
     // update the scalar oscillator field
     const Vertex &shape = grid.shape();
-    int ni = shape[0];
-    int nj = shape[1];
-    int nk = shape[2];
-    int nij = ni*nj;
-    int i0 = bounds.min[0];
-    int j0 = bounds.min[1];
-    int k0 = bounds.min[2];
-    float dx = spacing[0];
-    float dy = spacing[1];
-    float dz = spacing[2];
-    float x0 = origin[0] + dx;
-    float y0 = origin[1] + dy;
-    float z0 = origin[2] + dz;
+    int n[3] = {int(shape[0]), int(shape[1]), int(shape[2])};
+
+    // the spatial factors are tabulated on the first step, cell centers
+    // are offset by one spacing from the origin
+    if (osc.size != int(oscillators.size()))
+    {
+        float x0[3];
+        float dx[3];
+        for (int q = 0; q < 3; ++q)
+        {
+            dx[q] = spacing[q];
+            x0[q] = origin[q] + dx[q] + dx[q]*bounds.min[q];
+        }
+        osc.initialize(oscillators, x0, dx, n);
+#if defined(OSCILLATOR_CUDA)
+        if (dev.initialize(osc, device))
+            abort();
+#endif
+    }
+
+    osc.update(oscillators, t);
+
+#if defined(OSCILLATOR_CUDA)
+    // the field is evaluated on the device, see OscillatorDevice
+    if (dev.evaluate(osc))
+        abort();
+#else
+    // the planes are split over the threads given to this block
     float *pdata = grid.data();
-    for (int k = 0; k < nk; ++k)
+    int nk = n[2];
+    int nt = std::max(1, std::min(nthreads, nk));
+    if (nt > 1)
     {
-        float z = z0 + dz*(k0 + k);
-        float *pdk = pdata + k*nij;
-        for (int j = 0; j < nj; ++j)
+        std::vector<std::thread> workers;
+        for (int q = 0; q < nt; ++q)
         {
-            float y = y0 + dy*(j0 + j);
-            float *pd = pdk + j*ni;
-            for (int i = 0; i < ni; ++i)
-            {
-                float x = x0 + dx*(i0 + i);
-                pd[i] = 0.f;
-                for (auto& o : oscillators)
-                    pd[i] += o.evaluate({x,y,z}, t);
-            }
+            int k0 = (long(q)*nk)/nt;
+            int k1 = (long(q + 1)*nk)/nt;
+            workers.emplace_back([this, pdata, k0, k1]()
+              { osc.evaluate(pdata, k0, k1); });
         }
+        for (auto &w : workers)
+            w.join();
+    }
+    else
+    {
+        osc.evaluate(pdata, 0, nk);
     }
+#endif
 
     // update the velocity field on the particle mesh
     for (auto& particle : particles)
     {
+        // see Oscillator::evaluateGradient, the time dependent factors
+        // were computed above
         particle.velocity = { 0, 0, 0 };
-        for (auto& o : oscillators)
+        for (int q = 0; q < osc.size; ++q)
         {
-            particle.velocity += o.evaluateGradient(particle.position, t);
+            const Oscillator &o = oscillators[q];
+            float f = osc.amplitude[q] * o.damping(particle.position);
+            particle.velocity += f * ((o.center - particle.position)/(o.radius * o.radius));
         }
         // scale the gradient to get "units" right for velocity
         particle.velocity *= velocity_scale;
@@ -9,6 +9,9 @@
 
 #include "Oscillator.h"
 #include "Particles.h"
+#if defined(OSCILLATOR_CUDA)
+#include "OscillatorDevice.h"
+#endif
 
 #include <vector>
 #include <ostream>
@@ -23,7 +26,7 @@ struct Block
                 gid(gid_), velocity_scale(velocity_scale_), bounds(bounds_),
                 domain(domain_), origin(origin_), spacing(spacing_), nghost(nghost_),
                 grid(Vertex(&bounds.max[0]) - Vertex(&bounds.min[0]) + Vertex::one()),
-                oscillators(oscillators_)
+                oscillators(oscillators_), nthreads(1), device(0)
     {}
 
     // update scalar and vector fields
@@ -49,10 +52,16 @@ struct Block
     sdiy::Grid<float,3>              grid;   // container for the gridded data arrays
     std::vector<Particle>           particles;
     std::vector<Oscillator>         oscillators;
+    OscillatorArray                 osc;    // oscillators in SOA layout, tabulated on the grid
+    int                             nthreads; // threads used to update the fields
+    int                             device; // the CUDA device the fields are updated on
+#if defined(OSCILLATOR_CUDA)
+    OscillatorDevice                dev;    // the scalar field in device memory, the grid is not updated
+#endif
 
  private:
     // for create; to let Master manage the blocks
-    Block() : gid(-1), velocity_scale(1.0f), nghost(0)
+    Block() : gid(-1), velocity_scale(1.0f), nghost(0), nthreads(1), device(0)
     {
         origin[0] = origin[1] = origin[2] = 0.0f;
         spacing[0] = spacing[1] = spacing[2] = 1.0f;
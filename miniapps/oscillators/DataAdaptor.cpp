@@ -1,5 +1,9 @@
 #include "DataAdaptor.h"
 #include "MeshMetadata.h"
+#include "LazyDataArray.h"
+#include "StridedDataArray.h"
+#include "BufferPool.h"
+#include "GhostArrayCache.h"
 #include "Error.h"
 
 #include <vtkCellArray.h>
@@ -19,6 +23,8 @@
 
 #include <sdiy/master.hpp>
 
+#include <cstddef>
+
 
 static
 long getBlockNumCells(const sdiy::DiscreteBounds &ext)
@@ -163,6 +169,25 @@ vtkUnstructuredGrid *newUnstructuredBlock(const double *origin,
   return ug;
 }
 
+// view a 3 component member of the particles, at offset bytes from the
+// start of a Particle, without copying it
+static
+sensei::StridedDataArray<float> *newParticleView(
+  const std::vector<Particle> &particles, size_t offset)
+{
+  sensei::StridedDataArray<float> *sa = sensei::StridedDataArray<float>::New();
+
+  // the view is read only in practice, the particles are not changed
+  // until ReleaseData
+  unsigned char *base = reinterpret_cast<unsigned char*>(
+    const_cast<Particle*>(particles.data())) + offset;
+
+  sa->SetArray(reinterpret_cast<float*>(base), particles.size(), 3,
+    sizeof(Particle));
+
+  return sa;
+}
+
 static
 vtkPolyData *newParticleBlock(const std::vector<Particle> *particles,
   bool structureOnly)
@@ -172,18 +197,22 @@ vtkPolyData *newParticleBlock(const std::vector<Particle> *particles,
   if (structureOnly)
     return block;
 
+  // the positions are viewed in place
+  vtkIdType np = particles->size();
+
+  sensei::StridedDataArray<float> *pos = newParticleView(*particles,
+    offsetof(Particle, position));
+  pos->SetName("position");
+
   vtkNew<vtkPoints> points;
-  vtkNew<vtkCellArray> cells;
-  points->Allocate(particles->size());
-  cells->Allocate(particles->size());
+  points->SetData(pos);
+  pos->Delete();
 
-  vtkIdType pointId = 0;
-  for (const auto &p : *particles)
-    {
-    points->InsertNextPoint(p.position[0], p.position[1], p.position[2]);
+  vtkNew<vtkCellArray> cells;
+  cells->Allocate(np);
+  for (vtkIdType pointId = 0; pointId < np; ++pointId)
     cells->InsertNextCell(1, &pointId);
-    ++pointId;
-    }
+
   block->SetPoints(points.Get());
   block->SetVerts(cells.Get());
 
@@ -196,17 +225,18 @@ int newParticleArray(const std::vector<Particle> &particles,
 {
   enum {PID, VEL, VELMAG};
 
-  fa = vtkFloatArray::New();
+  fa = nullptr;
 
   int aid = PID;
-  if (arrayName == "pid")
+  int nComps = 1;
+  if ((arrayName == "pid") || (arrayName == "id"))
     {
     aid = PID;
     }
   else if (arrayName == "velocity")
     {
     aid = VEL;
-    fa->SetNumberOfComponents(3);
+    nComps = 3;
     }
   else if (arrayName == "velocityMagnitude")
     {
@@ -220,8 +250,10 @@ int newParticleArray(const std::vector<Particle> &particles,
 
   unsigned int np = particles.size();
 
+  // the particle arrays are made each step, their buffers are reused
+  fa = static_cast<vtkFloatArray*>(
+    sensei::BufferPool::NewDataArray(VTK_FLOAT, nComps, np));
   fa->SetName(arrayName.c_str());
-  fa->SetNumberOfTuples(np);
 
   float *pfa = fa->GetPointer(0);
 
@@ -251,82 +283,6 @@ int newParticleArray(const std::vector<Particle> &particles,
   return 0;
 }
 
-static
-vtkUnsignedCharArray *newGhostCellsArray(int *shape,
-  sdiy::DiscreteBounds &cellExt, int ng)
-{
-    // This sim is a:lways 3D.
-    int imin = cellExt.min[0];
-    int jmin = cellExt.min[1];
-    int kmin = cellExt.min[2];
-    int imax = cellExt.max[0];
-    int jmax = cellExt.max[1];
-    int kmax = cellExt.max[2];
-    int nx = imax - imin + 1;
-    int ny = jmax - jmin + 1;
-    int nz = kmax - kmin + 1;
-    int nxny = nx*ny;
-    int ncells = nx*ny*nz;
-
-    vtkUnsignedCharArray *g = vtkUnsignedCharArray::New();
-    g->SetNumberOfTuples(ncells);
-    memset(g->GetVoidPointer(0), 0, sizeof(unsigned char) * ncells);
-    g->SetName("vtkGhostType");
-    unsigned char *gptr = (unsigned char *)g->GetVoidPointer(0);
-    unsigned char ghost = 1;
-
-    if(imin > 0)
-    {
-        // Set the low I faces to ghosts.
-        for(int k = 0; k < nz; ++k)
-        for(int j = 0; j < ny; ++j)
-        for(int i = 0; i < ng; ++i)
-            gptr[k * nxny + j*nx + i] = ghost;
-    }
-    if(imax < shape[0]-1)
-    {
-        // Set the high I faces to ghosts.
-        for(int k = 0; k < nz; ++k)
-        for(int j = 0; j < ny; ++j)
-        for(int i = nx-ng; i < nx; ++i)
-            gptr[k * nxny + j*nx + i] = ghost;
-    }
-    if(jmin > 0)
-    {
-        // Set the low J faces to ghosts.
-        for(int k = 0; k < nz; ++k)
-        for(int j = 0; j < ng; ++j)
-        for(int i = 0; i < nx; ++i)
-            gptr[k * nxny + j*nx + i] = ghost;
-    }
-    if(jmax < shape[1]-1)
-    {
-        // Set the high J faces to ghosts.
-        for(int k = 0; k < nz; ++k)
-        for(int j = ny-ng; j < ny; ++j)
-        for(int i = 0; i < nx; ++i)
-            gptr[k * nxny + j*nx + i] = ghost;
-    }
-    if(kmin > 0)
-    {
-        // Set the low K faces to ghosts.
-        for(int k = 0; k < ng; ++k)
-        for(int j = 0; j < ny; ++j)
-        for(int i = 0; i < nx; ++i)
-            gptr[k * nxny + j*nx + i] = ghost;
-    }
-    if(kmax < shape[2]-1)
-    {
-        // Set the high K faces to ghosts.
-        for(int k = nz-ng; k < nz; ++k)
-        for(int j = 0; j < ny; ++j)
-        for(int i = 0; i < nx; ++i)
-            gptr[k * nxny + j*nx + i] = ghost;
-    }
-
-    return g;
-}
-
 namespace oscillators
 {
 
@@ -339,6 +295,7 @@ struct DataAdaptor::InternalsType
   sdiy::DiscreteBounds DomainExtent;                 // global index space
   std::map<long, sdiy::DiscreteBounds> BlockExtents; // local block extents, indexed by global block id
   std::map<long, float*> BlockData;                 // local data array, indexed by block id
+  std::map<long, sensei::DeviceArray> DeviceData;   // local data in device memory, indexed by block id
   std::map<long, const std::vector<Particle>*> ParticleData;
 
   double Origin[3];                                 // lower left corner of simulation domain
@@ -355,6 +312,102 @@ senseiNewMacro(DataAdaptor);
 DataAdaptor::DataAdaptor() :
   Internals(new DataAdaptor::InternalsType())
 {
+  // the Cartesian and unstructured blocks have the same number of cells
+  // in the same order and share the cell data. it is zero copied
+  ArrayProvider data = [this](int gid) -> vtkDataArray*
+    {
+    auto it = this->Internals->BlockData.find(gid);
+    if (it == this->Internals->BlockData.end())
+      {
+      // data in device memory is copied, the copy is shared by the
+      // analyses of the step
+      vtkDataArray *da = this->GetBlockHostData(gid);
+      if (da)
+        da->Register(nullptr);
+      return da;
+      }
+
+    vtkIdType nCells = getBlockNumCells(this->Internals->BlockExtents[gid]);
+
+    vtkFloatArray *fa = vtkFloatArray::New();
+    fa->SetName("data");
+    fa->SetArray(it->second, nCells, 1);
+    return fa;
+    };
+
+  this->SetArrayProvider("mesh", vtkDataObject::CELL, "data", data);
+  this->SetArrayProvider("ucdmesh", vtkDataObject::CELL, "data", data);
+
+  // the particle arrays are taken from the particles
+  const char *particleArrays[] = {"velocity", "id"};
+  for (const char *arrayName : particleArrays)
+    {
+    std::string name = arrayName;
+    ArrayProvider particle = [this,name](int gid) -> vtkDataArray*
+      {
+      auto it = this->Internals->ParticleData.find(gid);
+      if (it == this->Internals->ParticleData.end())
+        {
+        SENSEI_ERROR("No particles for block " << gid)
+        return nullptr;
+        }
+
+      // the velocity is viewed in place, the ids are converted
+      if (name == "velocity")
+        {
+        sensei::StridedDataArray<float> *sa = newParticleView(*it->second,
+          offsetof(Particle, velocity));
+        sa->SetName("velocity");
+        return sa;
+        }
+
+      vtkFloatArray *fa = nullptr;
+      if (newParticleArray(*it->second, name, fa))
+        {
+        fa->Delete();
+        return nullptr;
+        }
+      return fa;
+      };
+
+    this->SetArrayProvider("particles", vtkDataObject::POINT, name, particle);
+    }
+
+  // the velocity magnitude is derived, it is computed only for the
+  // particles an analysis accesses. the particles must not change until
+  // ReleaseData is called
+  ArrayProvider velocityMagnitude = [this](int gid) -> vtkDataArray*
+    {
+    auto it = this->Internals->ParticleData.find(gid);
+    if (it == this->Internals->ParticleData.end())
+      {
+      SENSEI_ERROR("No particles for block " << gid)
+      return nullptr;
+      }
+
+    const std::vector<Particle> *particles = it->second;
+
+    sensei::LazyDataArray<float> *la = sensei::LazyDataArray<float>::New();
+    la->SetName("velocityMagnitude");
+    la->SetFillFunction(particles->size(),
+      [particles](vtkIdType first, vtkIdType n, float *vals) -> int
+      {
+      for (vtkIdType i = 0; i < n; ++i)
+        {
+        const Particle &p = (*particles)[first + i];
+        float vx = p.velocity[0];
+        float vy = p.velocity[1];
+        float vz = p.velocity[2];
+        vals[i] = sqrt(vx*vx + vy*vy + vz*vz);
+        }
+      return 0;
+      });
+
+    return la;
+    };
+
+  this->SetArrayProvider("particles", vtkDataObject::POINT,
+    "velocityMagnitude", velocityMagnitude);
 }
 
 //-----------------------------------------------------------------------------
@@ -425,6 +478,49 @@ void DataAdaptor::SetBlockData(int gid, float* data)
   this->Internals->BlockData[gid] = data;
 }
 
+//-----------------------------------------------------------------------------
+void DataAdaptor::SetBlockDeviceData(int gid, float *data, int device,
+  const sensei::DeviceArray::CopyFunction &copy)
+{
+  sensei::DeviceArray &da = this->Internals->DeviceData[gid];
+  da.Data = data;
+  da.MemorySpace = sensei::MEMORY_SPACE_CUDA;
+  da.DeviceId = device;
+  da.DataType = VTK_FLOAT;
+  da.NumTuples = getBlockNumCells(this->Internals->BlockExtents[gid]);
+  da.NumComponents = 1;
+  da.CopyToHost = copy;
+}
+
+//-----------------------------------------------------------------------------
+int DataAdaptor::GetDeviceArray(const std::string &meshName, int association,
+  const std::string &arrayName, int blockId, sensei::DeviceArray &array)
+{
+  // the Cartesian and unstructured blocks share the cell data
+  if (((meshName != "mesh") && (meshName != "ucdmesh")) ||
+    (association != vtkDataObject::CELL) || (arrayName != "data"))
+    return 1;
+
+  auto it = this->Internals->DeviceData.find(blockId);
+  if (it == this->Internals->DeviceData.end())
+    return 1;
+
+  array = it->second;
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+vtkDataArray *DataAdaptor::GetBlockHostData(int gid)
+{
+  vtkDataArray *da = nullptr;
+  if (this->GetHostArray("mesh", vtkDataObject::CELL, "data", gid, da))
+    {
+    SENSEI_ERROR("No data for block " << gid)
+    return nullptr;
+    }
+  return da;
+}
+
 //-----------------------------------------------------------------------------
 void DataAdaptor::SetParticleData(int gid, const std::vector<Particle> &particles)
 {
@@ -434,6 +530,21 @@ void DataAdaptor::SetParticleData(int gid, const std::vector<Particle> &particle
 //-----------------------------------------------------------------------------
 int DataAdaptor::GetMesh(const std::string &meshName, bool structureOnly,
     vtkDataObject *&mesh)
+{
+  return this->NewMesh(meshName, structureOnly, nullptr, mesh);
+}
+
+//-----------------------------------------------------------------------------
+int DataAdaptor::GetMesh(const std::string &meshName, bool structureOnly,
+    const std::vector<int> &blockIds, vtkDataObject *&mesh)
+{
+  std::set<int> ids(blockIds.begin(), blockIds.end());
+  return this->NewMesh(meshName, structureOnly, &ids, mesh);
+}
+
+//-----------------------------------------------------------------------------
+int DataAdaptor::NewMesh(const std::string &meshName, bool structureOnly,
+    const std::set<int> *blockIds, vtkDataObject *&mesh)
 {
   mesh = nullptr;
 
@@ -454,6 +565,10 @@ int DataAdaptor::GetMesh(const std::string &meshName, bool structureOnly,
   auto end = this->Internals->BlockExtents.end();
   for (; it != end; ++it)
     {
+    // only the requested blocks are constructed
+    if (blockIds && !blockIds->count(it->first))
+      continue;
+
     if (particleBlocks)
       {
       vtkPolyData *pd =
@@ -486,92 +601,6 @@ int DataAdaptor::GetMesh(const std::string &meshName, bool structureOnly,
   return 0;
 }
 
-//-----------------------------------------------------------------------------
-int DataAdaptor::AddArray(vtkDataObject* mesh, const std::string &meshName,
-    int association, const std::string &arrayName)
-{
-  vtkMultiBlockDataSet *mb = dynamic_cast<vtkMultiBlockDataSet*>(mesh);
-  if (!mb)
-    {
-    SENSEI_ERROR("unexpected mesh type "
-      << (mesh ? mesh->GetClassName() : "nullptr"))
-    return -1;
-    }
-
-  enum {BLOCK, PARTICLE};
-  int meshId = BLOCK;
-  if ((meshName == "mesh") || (meshName == "ucdmesh"))
-    {
-    meshId = BLOCK;
-    if ((arrayName != "data") || (association != vtkDataObject::CELL))
-      {
-      SENSEI_ERROR("mesh \"" << meshName
-        << "\" only has cell data array named \"data\"")
-      return -1;
-      }
-    }
-  else if (meshName == "particles")
-    {
-    meshId = PARTICLE;
-    if (association != vtkDataObject::POINT)
-      {
-      SENSEI_ERROR("mesh \"particles\" only has point data")
-      return -1;
-      }
-    if ((arrayName != "velocity") && (arrayName != "velocityMagnitude") &&
-      (arrayName != "id"))
-      {
-      SENSEI_ERROR("Invalid particle mesh array \"" << arrayName << "\"")
-      return -1;
-      }
-    }
-  else
-    {
-    SENSEI_ERROR("Invalid mesh name \"" << meshName << "\"")
-    return -1;
-    }
-
-  auto it = this->Internals->BlockData.begin();
-  auto end = this->Internals->BlockData.end();
-  for (; it != end; ++it)
-    {
-    // this code is the same for the Cartesian and unstructured blocks
-    // because they both have the same number of cells and are in the
-    // same order
-    vtkDataObject *blk = mb->GetBlock(it->first);
-    if (!blk)
-      {
-      SENSEI_ERROR("encountered empty block at index " << it->first)
-      return -1;
-      }
-
-    vtkFloatArray *fa = nullptr;
-    vtkDataSetAttributes *dsa = nullptr;
-
-    if (meshId == BLOCK)
-      {
-      dsa = blk->GetAttributes(vtkDataObject::CELL);
-      vtkIdType nCells = getBlockNumCells(this->Internals->BlockExtents[it->first]);
-
-      // zero coopy the array
-      fa = vtkFloatArray::New();
-      fa->SetName("data");
-      fa->SetArray(it->second, nCells, 1);
-      }
-    else
-      {
-      dsa = blk->GetAttributes(vtkDataObject::POINT);
-      newParticleArray(*this->Internals->ParticleData[it->first], arrayName, fa);
-      }
-
-    dsa->AddArray(fa);
-    fa->Delete();
-    }
-
-  return 0;
-}
-
-
 //----------------------------------------------------------------------------
 int DataAdaptor::AddGhostCellsArray(vtkDataObject *mesh, const std::string &meshName)
 {
@@ -589,6 +618,15 @@ int DataAdaptor::AddGhostCellsArray(vtkDataObject *mesh, const std::string &mesh
     return -1;
     }
 
+  // the ghost cells are the layers next to faces that are not on the
+  // domain boundary
+  const int *shape = this->Internals->Shape;
+  int domainExt[6] = {0, shape[0]-1, 0, shape[1]-1, 0, shape[2]-1};
+
+  // blocks with the same size and neighbors share an array that is made
+  // once
+  sensei::GhostArrayCache &ghosts = sensei::GhostArrayCache::GetGlobalCache();
+
   auto it = this->Internals->BlockExtents.begin();
   auto end = this->Internals->BlockExtents.end();
   for (; it != end; ++it)
@@ -596,20 +634,18 @@ int DataAdaptor::AddGhostCellsArray(vtkDataObject *mesh, const std::string &mesh
     // this code is the same for the Cartesian and unstructured blocks
     // because they both have the same number of cells and are in the
     // same order
+    // blocks that were not requested are empty
     vtkDataObject *blk = mb->GetBlock(it->first);
     if (!blk)
-      {
-      SENSEI_ERROR("encountered empty block at index " << it->first)
-      return -1;
-      }
+      continue;
 
     vtkDataSetAttributes *dsa = blk->GetAttributes(vtkDataObject::CELL);
 
-    vtkUnsignedCharArray *ga = newGhostCellsArray(this->Internals->Shape,
-      it->second, this->Internals->NumGhostCells);
+    int blockExt[6];
+    getBlockExtent(it->second, blockExt);
 
-    dsa->AddArray(ga);
-    ga->Delete();
+    dsa->AddArray(ghosts.GetGhostCells(blockExt, domainExt,
+      this->Internals->NumGhostCells));
     }
 
   return 0;
@@ -641,7 +677,7 @@ int DataAdaptor::GetMeshMetadata(unsigned int id, sensei::MeshMetadataPtr &metad
   // mesh 0 is a multiblock with uniform Cartesian blocks
   // mesh 1 is a multiblock with unstructured blocks
   // otherwise the meshes are identical
-  int nBlocks = this->Internals->BlockData.size();
+  int nBlocks = this->Internals->BlockExtents.size();
 
   metadata->MeshName = (id == 0 ? "mesh" : "ucdmesh");
 
@@ -727,12 +763,31 @@ int DataAdaptor::GetMeshMetadata(unsigned int id, sensei::MeshMetadataPtr &metad
     {
     float gmin = std::numeric_limits<float>::max();
     float gmax = std::numeric_limits<float>::lowest();
-    std::map<long, float*>::iterator it = this->Internals->BlockData.begin();
-    std::map<long, float*>::iterator end = this->Internals->BlockData.end();
+    std::map<long, sdiy::DiscreteBounds>::iterator it = this->Internals->BlockExtents.begin();
+    std::map<long, sdiy::DiscreteBounds>::iterator end = this->Internals->BlockExtents.end();
     for (; it != end; ++it)
       {
-      unsigned long nCells = getBlockNumCells(this->Internals->BlockExtents[it->first]);
-      float *pdata = it->second;
+      unsigned long nCells = getBlockNumCells(it->second);
+
+      // data in device memory is copied to the host
+      const float *pdata = nullptr;
+      std::map<long, float*>::iterator dit = this->Internals->BlockData.find(it->first);
+      if (dit != this->Internals->BlockData.end())
+        {
+        pdata = dit->second;
+        }
+      else if (this->Internals->DeviceData.count(it->first))
+        {
+        vtkDataArray *da = this->GetBlockHostData(it->first);
+        if (!da)
+          return -1;
+        pdata = static_cast<float*>(da->GetVoidPointer(0));
+        }
+      else
+        {
+        continue;
+        }
+
       float bmin = std::numeric_limits<float>::max();
       float bmax = std::numeric_limits<float>::lowest();
       for (unsigned long i = 0; i < nCells; ++i)
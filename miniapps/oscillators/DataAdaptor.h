@@ -1,20 +1,23 @@
 #ifndef OSCILLATORS_DATAADAPTOR_H
 #define OSCILLATORS_DATAADAPTOR_H
 
-#include <DataAdaptor.h>
+#include <ArrayProviderDataAdaptor.h>
 
 #include "Particles.h"
 
+#include <set>
+#include <vector>
+
 class vtkDataArray;
 
 namespace oscillators
 {
 
-class DataAdaptor : public sensei::DataAdaptor
+class DataAdaptor : public sensei::ArrayProviderDataAdaptor
 {
 public:
   static DataAdaptor* New();
-  senseiTypeMacro(DataAdaptor, sensei::DataAdaptor);
+  senseiTypeMacro(DataAdaptor, sensei::ArrayProviderDataAdaptor);
 
   /// @brief Initialize the data adaptor.
   ///
@@ -36,6 +39,12 @@ public:
   /// Set data for a specific block.
   void SetBlockData(int gid, float* data);
 
+  /// Set data for a specific block that lives in CUDA device memory. It is
+  /// exposed by GetDeviceArray, and copied to the host by copy, once per
+  /// step, for the analyses that need it there.
+  void SetBlockDeviceData(int gid, float *data, int device,
+    const sensei::DeviceArray::CopyFunction &copy);
+
   /// Set particles for a specific block
   void SetParticleData(int gid, const std::vector<Particle> &particles);
 
@@ -47,11 +56,17 @@ public:
   int GetMesh(const std::string &meshName, bool structureOnly,
     vtkDataObject *&mesh) override;
 
-  int AddArray(vtkDataObject* mesh, const std::string &meshName,
-    int association, const std::string &arrayName) override;
+  int GetMesh(const std::string &meshName, bool structureOnly,
+    const std::vector<int> &blockIds, vtkDataObject *&mesh) override;
+
+  using sensei::ArrayProviderDataAdaptor::GetMesh;
 
   int AddGhostCellsArray(vtkDataObject* mesh, const std::string &meshName) override;
 
+  int GetDeviceArray(const std::string &meshName, int association,
+    const std::string &arrayName, int blockId,
+    sensei::DeviceArray &array) override;
+
   int ReleaseData() override;
 
 protected:
@@ -62,6 +77,15 @@ protected:
 
   vtkDataObject* GetParticlesBlock(int gid, bool structureOnly);
 
+  // get the data of a block in host memory, copied from the device when
+  // it lives there. the array is owned by the data adaptor
+  vtkDataArray *GetBlockHostData(int gid);
+
+  // construct the blocks listed in blockIds, or all of them when it is
+  // null
+  int NewMesh(const std::string &meshName, bool structureOnly,
+    const std::set<int> *blockIds, vtkDataObject *&mesh);
+
 private:
   DataAdaptor(const DataAdaptor&); // not implemented.
   void operator=(const DataAdaptor&); // not implemented.
@@ -20,6 +20,78 @@ static inline std::string &rtrim(std::string &s)
 
 static inline std::string &trim(std::string &s)  { return ltrim(rtrim(s)); }
 
+// --------------------------------------------------------------------------
+void OscillatorArray::initialize(const std::vector<Oscillator> &oscillators,
+    const float *x0, const float *dx, const int *n)
+{
+    size = oscillators.size();
+    amplitude.assign(size, 0.0f);
+
+    for (int q = 0; q < 3; ++q)
+    {
+        shape[q] = n[q];
+        factor[q].resize(size*n[q]);
+
+        for (int o = 0; o < size; ++o)
+        {
+            const Oscillator &osc = oscillators[o];
+            float scale = -1.0f/(2*osc.radius*osc.radius);
+            float *f = factor[q].data() + o*n[q];
+            for (int i = 0; i < n[q]; ++i)
+            {
+                float d = x0[q] + dx[q]*i - osc.center[q];
+                f[i] = exp(d*d*scale);
+            }
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+void OscillatorArray::update(const std::vector<Oscillator> &oscillators, float t)
+{
+    for (int o = 0; o < size; ++o)
+        amplitude[o] = oscillators[o].amplitude(t);
+}
+
+// --------------------------------------------------------------------------
+void OscillatorArray::evaluate(float *data, int k0, int k1) const
+{
+    int ni = shape[0];
+    int nj = shape[1];
+    int nk = shape[2];
+    long nij = long(ni)*nj;
+
+    const float *fx = factor[0].data();
+    const float *fy = factor[1].data();
+    const float *fz = factor[2].data();
+    const float *amp = amplitude.data();
+
+    for (int k = k0; k < k1; ++k)
+    {
+        for (int j = 0; j < nj; ++j)
+        {
+            float *pd = data + k*nij + long(j)*ni;
+
+            for (int i = 0; i < ni; ++i)
+                pd[i] = 0.0f;
+
+            for (int o = 0; o < size; ++o)
+            {
+                float w = amp[o] * fy[o*nj + j] * fz[o*nk + k];
+
+                // the Gaussian has underflowed, the oscillator is far away
+                if (w == 0.0f)
+                    continue;
+
+                const float *fxo = fx + o*ni;
+                for (int i = 0; i < ni; ++i)
+                    pd[i] += w * fxo[i];
+            }
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
 std::vector<Oscillator> read_oscillators(std::string fn)
 {
     std::vector<Oscillator> res;
@@ -2,6 +2,7 @@
 #define Oscillator_h
 
 #include <string>
+#include <vector>
 #include <cmath>
 #include <sdiy/point.hpp>
 
@@ -11,35 +12,45 @@ struct Oscillator
 
     static constexpr float pi = 3.14159265358979323846;
 
-    float evaluate(const Vertex &v, float t) const
+    // the time dependent factor
+    float amplitude(float t) const
     {
         t *= 2*pi;
 
-        float dist2 = (center - v).norm();
-        float dist_damp = exp(-dist2/(2*radius*radius));
-
         if (type == damped)
         {
             float phi   = acos(zeta);
             float val   = 1. - exp(-zeta*omega0*t) * (sin(sqrt(1-zeta*zeta)*omega0*t + phi) / sin(phi));
-            return val * dist_damp;
+            return val;
         }
         else if (type == decaying)
         {
             t += 1. / omega0;
             float val = sin(t / omega0) / (omega0 * t);
-            return val * dist_damp;
+            return val;
         }
         else if (type == periodic)
         {
             t += 1. / omega0;
             float val = sin(t / omega0);
-            return val * dist_damp;
+            return val;
         }
 
         return 0.0f; // impossible
     }
 
+    // the spatial factor, a Gaussian about the center
+    float damping(const Vertex &v) const
+    {
+        float dist2 = (center - v).norm();
+        return exp(-dist2/(2*radius*radius));
+    }
+
+    float evaluate(const Vertex &v, float t) const
+    {
+        return amplitude(t) * damping(v);
+    }
+
     Vertex evaluateGradient(const Vertex& x, float t) const
     {
         // let f(x, t) = this->evaluate(x,t) = o(t) * g(x)
@@ -59,6 +70,34 @@ struct Oscillator
     enum { damped, decaying, periodic } type;
 };
 
+// The oscillators in a structure of arrays layout, for evaluating all of
+// them on the points of a Cartesian grid. The spatial factor is separable,
+// exp(-|v - c|^2/(2 r^2)) = gx(x) gy(y) gz(z), so its factors are tabulated
+// once per axis and the grid is updated by a sum of products, with the
+// time dependent factors computed once per step. The innermost loop runs
+// over contiguous points and vectorizes.
+struct OscillatorArray
+{
+    OscillatorArray() : size(0), shape{0,0,0} {}
+
+    // tabulate the spatial factors at the grid points x0[q] + dx[q]*i,
+    // i in [0, n[q]), of each axis q
+    void initialize(const std::vector<Oscillator> &oscillators,
+        const float *x0, const float *dx, const int *n);
+
+    // compute the time dependent factors at time t
+    void update(const std::vector<Oscillator> &oscillators, float t);
+
+    // write the sum of the oscillators to the planes k0 to k1 - 1 of the
+    // grid, which is ordered with i fastest
+    void evaluate(float *data, int k0, int k1) const;
+
+    int size;
+    int shape[3];
+    std::vector<float> amplitude;   // indexed by oscillator
+    std::vector<float> factor[3];   // indexed by oscillator*shape[q] + i
+};
+
 std::vector<Oscillator> read_oscillators(std::string fn);
 
 #endif
@@ -0,0 +1,136 @@
+#include "OscillatorDevice.h"
+#include "Oscillator.h"
+
+#include <cuda_runtime.h>
+
+#include <iostream>
+
+#define OSCILLATOR_CUDA_CHECK(_call)                                    \
+    {                                                                   \
+        cudaError_t ierr = _call;                                       \
+        if (ierr != cudaSuccess)                                        \
+        {                                                               \
+            std::cerr << "Error: " #_call " failed. "                   \
+                << cudaGetErrorString(ierr) << std::endl;               \
+            return -1;                                                  \
+        }                                                               \
+    }
+
+// --------------------------------------------------------------------------
+// each thread evaluates grid points, striding by the number of threads
+// launched. neighboring threads write neighboring points
+__global__
+void evaluate_oscillators(float *data, const float *fx, const float *fy,
+    const float *fz, const float *amp, int size, int ni, int nj, int nk)
+{
+    long nij = long(ni)*nj;
+    long n = nij*nk;
+    long stride = long(blockDim.x)*gridDim.x;
+
+    for (long p = long(blockIdx.x)*blockDim.x + threadIdx.x; p < n; p += stride)
+    {
+        int i = p % ni;
+        int j = (p / ni) % nj;
+        int k = p / nij;
+
+        float val = 0.0f;
+        for (int o = 0; o < size; ++o)
+            val += amp[o] * fx[o*ni + i] * fy[o*nj + j] * fz[o*nk + k];
+
+        data[p] = val;
+    }
+}
+
+// --------------------------------------------------------------------------
+int OscillatorDevice::get_device_count()
+{
+    int n = 0;
+    if (cudaGetDeviceCount(&n) != cudaSuccess)
+        return 0;
+    return n;
+}
+
+// --------------------------------------------------------------------------
+int OscillatorDevice::initialize(const OscillatorArray &osc, int dev)
+{
+    release();
+
+    device = dev;
+    size = osc.size;
+    for (int q = 0; q < 3; ++q)
+        shape[q] = osc.shape[q];
+
+    OSCILLATOR_CUDA_CHECK(cudaSetDevice(device))
+
+    long n = long(shape[0])*shape[1]*shape[2];
+    OSCILLATOR_CUDA_CHECK(cudaMalloc(&data, n*sizeof(float)))
+    OSCILLATOR_CUDA_CHECK(cudaMalloc(&amplitude, (size ? size : 1)*sizeof(float)))
+
+    for (int q = 0; q < 3; ++q)
+    {
+        size_t nBytes = osc.factor[q].size()*sizeof(float);
+        OSCILLATOR_CUDA_CHECK(cudaMalloc(&factor[q], nBytes ? nBytes : sizeof(float)))
+        OSCILLATOR_CUDA_CHECK(cudaMemcpy(factor[q], osc.factor[q].data(),
+            nBytes, cudaMemcpyHostToDevice))
+    }
+
+    return 0;
+}
+
+// --------------------------------------------------------------------------
+int OscillatorDevice::evaluate(const OscillatorArray &osc)
+{
+    OSCILLATOR_CUDA_CHECK(cudaSetDevice(device))
+
+    OSCILLATOR_CUDA_CHECK(cudaMemcpy(amplitude, osc.amplitude.data(),
+        size*sizeof(float), cudaMemcpyHostToDevice))
+
+    long n = long(shape[0])*shape[1]*shape[2];
+    if (n == 0)
+        return 0;
+
+    int threads = 256;
+    long blocks = (n + threads - 1)/threads;
+    if (blocks > 65535)
+        blocks = 65535;
+
+    evaluate_oscillators<<<blocks, threads>>>(data, factor[0], factor[1],
+        factor[2], amplitude, size, shape[0], shape[1], shape[2]);
+
+    OSCILLATOR_CUDA_CHECK(cudaGetLastError())
+
+    // the analyses may read the grid from other streams
+    OSCILLATOR_CUDA_CHECK(cudaDeviceSynchronize())
+
+    return 0;
+}
+
+// --------------------------------------------------------------------------
+int OscillatorDevice::copy_to_host(float *dest) const
+{
+    OSCILLATOR_CUDA_CHECK(cudaSetDevice(device))
+
+    long n = long(shape[0])*shape[1]*shape[2];
+    OSCILLATOR_CUDA_CHECK(cudaMemcpy(dest, data, n*sizeof(float),
+        cudaMemcpyDeviceToHost))
+
+    return 0;
+}
+
+// --------------------------------------------------------------------------
+void OscillatorDevice::release()
+{
+    if (!data)
+        return;
+
+    cudaSetDevice(device);
+
+    cudaFree(data);
+    cudaFree(amplitude);
+    for (int q = 0; q < 3; ++q)
+        cudaFree(factor[q]);
+
+    data = nullptr;
+    amplitude = nullptr;
+    factor[0] = factor[1] = factor[2] = nullptr;
+}
@@ -0,0 +1,48 @@
+#ifndef OscillatorDevice_h
+#define OscillatorDevice_h
+
+struct OscillatorArray;
+
+// The grid of a block in CUDA device memory. The spatial factors of the
+// oscillators are copied to the device once, and each step only their time
+// dependent factors are copied and the grid is evaluated by a kernel, so
+// that the field is computed where it is analyzed and crosses the bus only
+// when an analysis needs it on the host. The interface is free of CUDA
+// types so that the rest of the miniapp is compiled by the host compiler.
+struct OscillatorDevice
+{
+    OscillatorDevice() : device(0), size(0), shape{0,0,0}, data(nullptr),
+        amplitude(nullptr), factor{nullptr,nullptr,nullptr} {}
+
+    ~OscillatorDevice() { release(); }
+
+    OscillatorDevice(const OscillatorDevice&) = delete;
+    void operator=(const OscillatorDevice&) = delete;
+
+    // allocate the grid on the device and copy the spatial factors of
+    // osc to it. returns zero if successful
+    int initialize(const OscillatorArray &osc, int device);
+
+    // evaluate the sum of the oscillators on the grid, with the time
+    // dependent factors of osc. returns once the grid is written
+    int evaluate(const OscillatorArray &osc);
+
+    // copy the grid to the host buffer dest, which holds the
+    // shape[0]*shape[1]*shape[2] values
+    int copy_to_host(float *dest) const;
+
+    // free the device memory
+    void release();
+
+    // the number of CUDA devices on the node
+    static int get_device_count();
+
+    int     device;     // the CUDA device the grid lives on
+    int     size;       // the number of oscillators
+    int     shape[3];   // the grid's shape
+    float  *data;       // the grid, ordered with i fastest
+    float  *amplitude;  // indexed by oscillator
+    float  *factor[3];  // indexed by oscillator*shape[q] + i
+};
+
+#endif
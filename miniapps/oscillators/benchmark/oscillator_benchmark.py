@@ -0,0 +1,214 @@
+#!/usr/bin/env python
+
+""" measures the per step overhead of SENSEI analyses and transports using
+the oscillator miniapp. each analysis configuration is run over a sweep of
+blocks per rank, ghost cells and particle counts, once with bridge::execute
+and once without. the Profiler and MemoryProfiler logs of each run are
+reduced to a summary written in JSON """
+
+import sys
+import os
+import glob
+import json
+import argparse
+import itertools
+import subprocess
+
+
+def read_timer_log(file_name):
+    """ reads the Profiler's CSV log. returns a list of events, each a tuple
+    (rank, name, delta, bytes) """
+    events = []
+    for fn in sorted(glob.glob(file_name + '*')):
+        with open(fn) as f:
+            for line in f:
+                if line.startswith('#'):
+                    continue
+                cols = line.split(',')
+                if len(cols) < 8:
+                    continue
+                events.append((int(cols[0]), cols[2].strip().strip('"'),
+                    float(cols[5]), int(cols[6])))
+    return events
+
+
+def read_mem_log(file_name):
+    """ reads the MemoryProfiler's CSV log. returns the largest resident set
+    size in KiB seen on any rank """
+    peak = 0
+    if not os.path.exists(file_name):
+        return peak
+    with open(file_name) as f:
+        for line in f:
+            if line.startswith('#'):
+                continue
+            cols = line.split(',')
+            if len(cols) < 4:
+                continue
+            peak = max(peak, int(cols[2]), int(cols[3]))
+    return peak
+
+
+def step_times(events, name):
+    """ the duration of each step of the named event, the slowest rank's """
+    per_rank = {}
+    for rank, evt, delta, nbytes in events:
+        if evt == name:
+            per_rank.setdefault(rank, []).append(delta)
+    if not per_rank:
+        return []
+    n_steps = min(len(t) for t in per_rank.values())
+    return [max(t[i] for t in per_rank.values()) for i in range(n_steps)]
+
+
+def bytes_moved(events):
+    """ the bytes reported by SENSEI's events, summed over the ranks """
+    total = 0
+    per_event = {}
+    for rank, evt, delta, nbytes in events:
+        if nbytes > 0 and not evt.startswith('oscillators::'):
+            total += nbytes
+            per_event[evt] = per_event.get(evt, 0) + nbytes
+    return total, per_event
+
+
+def mean(vals):
+    return sum(vals)/len(vals) if vals else 0.0
+
+
+def run_case(args, config, n_ranks, blocks_per_rank, ghosts, particles,
+    execute, run_dir):
+    """ run the oscillator once and reduce its logs """
+    run_dir = os.path.abspath(run_dir)
+    os.makedirs(run_dir, exist_ok=True)
+
+    timer_log = os.path.join(run_dir, 'timer.csv')
+    mem_log = os.path.join(run_dir, 'mem_prof.csv')
+
+    env = dict(os.environ)
+    env['PROFILER_ENABLE'] = '3'
+    env['PROFILER_LOG_FILE'] = timer_log
+    env['PROFILER_LOG_FORMAT'] = 'csv'
+    env['MEMPROF_LOG_FILE'] = mem_log
+    env['MEMPROF_INTERVAL'] = str(args.mem_interval)
+    env['MEMPROF_TRACK_PEAK'] = '1'
+
+    cmd = [args.mpiexec, args.np_flag, str(n_ranks), args.oscillator,
+        '-b', str(n_ranks*blocks_per_rank), '-g', str(ghosts),
+        '-p', str(particles), '-s'] + [str(s) for s in args.shape] + \
+        ['-t', str(args.dt), '--t-end', str(args.dt*args.steps),
+        '-f', os.path.abspath(config), '--sync']
+
+    if not execute:
+        cmd.append('--no-execute')
+
+    cmd.append(os.path.abspath(args.input))
+
+    if args.verbose:
+        sys.stderr.write('%s\n'%(' '.join(cmd)))
+
+    with open(os.path.join(run_dir, 'output.txt'), 'w') as out:
+        ierr = subprocess.call(cmd, cwd=run_dir, env=env, stdout=out,
+            stderr=subprocess.STDOUT)
+
+    events = read_timer_log(timer_log)
+    analysis = step_times(events, 'oscillators::analysis')
+    total_bytes, event_bytes = bytes_moved(events)
+
+    return {'status': ierr, 'num_steps': len(analysis),
+        'analysis_time_per_step': mean(analysis),
+        'bytes_moved': total_bytes, 'bytes_moved_by_event': event_bytes,
+        'peak_memory_kib': read_mem_log(mem_log)}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='measure the per step '
+        'overhead of SENSEI analyses using the oscillator miniapp.')
+
+    parser.add_argument('--oscillator', required=True,
+        help='path to the oscillator executable')
+    parser.add_argument('--input', required=True,
+        help='oscillator input deck')
+    parser.add_argument('--configs', nargs='+', required=True,
+        help='SENSEI XML configurations, one per analysis or transport')
+    parser.add_argument('--mpiexec', default='mpiexec',
+        help='MPI launcher')
+    parser.add_argument('--np-flag', default='-n',
+        help='the launcher\'s flag setting the number of ranks')
+    parser.add_argument('--ranks', type=int, nargs='+', default=[2],
+        help='numbers of MPI ranks to sweep')
+    parser.add_argument('--blocks-per-rank', type=int, nargs='+', default=[1, 4],
+        help='numbers of blocks per rank to sweep')
+    parser.add_argument('--ghosts', type=int, nargs='+', default=[0, 1],
+        help='numbers of ghost cells to sweep')
+    parser.add_argument('--particles', type=int, nargs='+', default=[0],
+        help='numbers of particles to sweep')
+    parser.add_argument('--shape', type=int, nargs=3, default=[64, 64, 64],
+        help='global number of cells')
+    parser.add_argument('--steps', type=int, default=10,
+        help='number of time steps per run')
+    parser.add_argument('--dt', type=float, default=0.01,
+        help='time step')
+    parser.add_argument('--mem-interval', type=float, default=0.05,
+        help='memory sampling interval in seconds')
+    parser.add_argument('--work-dir', default='oscillator_benchmark',
+        help='where the runs are made')
+    parser.add_argument('--output', default='oscillator_benchmark.json',
+        help='the summary file')
+    parser.add_argument('--verbose', action='store_true',
+        help='print the commands run')
+
+    args = parser.parse_args()
+
+    # the runs are made in their own directories
+    if os.path.exists(args.oscillator):
+        args.oscillator = os.path.abspath(args.oscillator)
+
+    results = []
+    n_errors = 0
+
+    for config, n_ranks, bpr, ghosts, particles in itertools.product(
+        args.configs, args.ranks, args.blocks_per_rank, args.ghosts,
+        args.particles):
+
+        name = os.path.splitext(os.path.basename(config))[0]
+        case = '%s_r%d_b%d_g%d_p%d'%(name, n_ranks, bpr, ghosts, particles)
+        case_dir = os.path.join(args.work_dir, case)
+
+        base = run_case(args, config, n_ranks, bpr, ghosts, particles,
+            False, os.path.join(case_dir, 'baseline'))
+
+        insitu = run_case(args, config, n_ranks, bpr, ghosts, particles,
+            True, os.path.join(case_dir, 'execute'))
+
+        ok = (base['status'] == 0) and (insitu['status'] == 0)
+        if not ok:
+            n_errors += 1
+
+        overhead = insitu['analysis_time_per_step'] - \
+            base['analysis_time_per_step']
+
+        results.append({'config': config, 'ranks': n_ranks,
+            'blocks_per_rank': bpr, 'ghost_cells': ghosts,
+            'particles': particles, 'ok': ok,
+            'overhead_per_step': overhead,
+            'bytes_moved_per_step': insitu['bytes_moved']/max(1,
+                insitu['num_steps']),
+            'peak_memory_kib': insitu['peak_memory_kib'],
+            'peak_memory_overhead_kib': insitu['peak_memory_kib'] -
+                base['peak_memory_kib'],
+            'baseline': base, 'execute': insitu})
+
+        sys.stderr.write('%s %s overhead/step=%g s bytes/step=%g '
+            'peak=%d KiB\n'%(case, 'ok' if ok else 'FAILED', overhead,
+            results[-1]['bytes_moved_per_step'], insitu['peak_memory_kib']))
+
+    with open(args.output, 'w') as f:
+        json.dump({'shape': args.shape, 'steps': args.steps,
+            'results': results}, f, indent=2)
+
+    return 1 if n_errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,355 @@
+#!/usr/bin/env python
+
+""" measures how SENSEI's in transit transports scale. the oscillator miniapp
+writes through each transport on M ranks and the SENSEIEndPoint reads on N
+ranks, with each of the receive side partitioners. M is swept, N follows
+from the M:N ratios. in weak scaling the grid grows with M, in strong scaling
+it is fixed. the receiver's Profiler logs are reduced to step latency,
+sustained bandwidth and receiver imbalance, written in JSON together with a
+description of the machine """
+
+import sys
+import os
+import glob
+import json
+import time
+import shutil
+import socket
+import platform
+import argparse
+import itertools
+import subprocess
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from oscillator_benchmark import read_timer_log, read_mem_log
+
+
+# the writer's and the reader's transport elements. concurrent transports
+# stream from the writer to the reader, for the others the reader starts
+# once the writer is done
+TRANSPORTS = {
+    'adios2_bp4': {'concurrent': False,
+        'write': '<transport type="adios2" filename="%(file)s.bp" engine="bp4" enabled="1"/>',
+        'read': '<transport type="adios2" filename="%(file)s.bp" engine="bp4">%(part)s</transport>',
+        'ready': None},
+    'adios2_sst': {'concurrent': True,
+        'write': '<transport type="adios2" filename="%(file)s.bp" engine="sst" enabled="1"/>',
+        'read': '<transport type="adios2" filename="%(file)s.bp" engine="sst">%(part)s</transport>',
+        'ready': '%(file)s.bp.sst'},
+    'hdf5': {'concurrent': False,
+        'write': '<transport type="hdf5" filename="%(file)s.h5" enabled="1"/>',
+        'read': '<transport type="hdf5" file_name="%(file)s.h5">%(part)s</transport>',
+        'ready': None},
+    'adios1_bp': {'concurrent': False,
+        'write': '<transport type="adios1" filename="%(file)s.bp" method="MPI" enabled="1"/>',
+        'read': '<transport type="adios1" filename="%(file)s.bp" method="BP">%(part)s</transport>',
+        'ready': None},
+    'adios1_flexpath': {'concurrent': True,
+        'write': '<transport type="adios1" filename="%(file)s.bp" method="FLEXPATH" enabled="1"/>',
+        'read': '<transport type="adios1" filename="%(file)s.bp" method="FLEXPATH">%(part)s</transport>',
+        'ready': '%(file)s.bp_writer_info.txt'},
+    }
+
+# the receive side partitioners. those needing a block map or a slice
+# plane are configured with XML passed through --partitioner-xml
+PARTITIONERS = {
+    'block': '<partitioner type="block"/>',
+    'planar': '<partitioner type="planar" plane_size="2"/>',
+    'hilbert': '<partitioner type="hilbert"/>',
+    'locality': '<partitioner type="locality"/>',
+    'adaptive': '<partitioner type="adaptive"/>',
+    }
+
+# the receiver's analysis, pulls the whole array each step
+DEFAULT_ANALYSIS = '<sensei>\n  <analysis type="histogram" mesh="mesh" ' \
+    'array="data" association="cell" bins="64" enabled="1"/>\n</sensei>\n'
+
+
+def write_file(file_name, text):
+    with open(file_name, 'w') as f:
+        f.write(text)
+
+
+def per_rank_events(events, match):
+    """ the events whose name passes match, by rank, in log order """
+    per_rank = {}
+    for rank, name, delta, nbytes in events:
+        if match(name):
+            per_rank.setdefault(rank, []).append((delta, nbytes))
+    return per_rank
+
+
+def median(vals):
+    if not vals:
+        return 0.0
+    vals = sorted(vals)
+    n = len(vals)
+    return vals[n//2] if n % 2 else 0.5*(vals[n//2 - 1] + vals[n//2])
+
+
+def reduce_receiver(events, wall_time):
+    """ step latency, bandwidth and imbalance from the receiver's events """
+    # a step on the receiver is the advance to it plus the analysis, which
+    # pulls the data
+    advance = per_rank_events(events,
+        lambda n: n.endswith('DataAdaptor::AdvanceStream') or
+        n == 'HDF5DataAdaptor::Advance')
+
+    execute = per_rank_events(events,
+        lambda n: n == 'ConfigurableAnalysis::Execute')
+
+    ranks = sorted(execute.keys())
+    if not ranks:
+        return None
+
+    n_steps = min(len(execute[r]) for r in ranks)
+
+    # the slowest rank sets each step's latency
+    latency = []
+    for i in range(n_steps):
+        step = 0.0
+        for r in ranks:
+            t = execute[r][i][0]
+            adv = advance.get(r, [])
+            if i < len(adv):
+                t += adv[i][0]
+            step = max(step, t)
+        latency.append(step)
+
+    # the bytes read, as reported by the transport's read events
+    read = per_rank_events(events,
+        lambda n: ('::Read' in n) or n.endswith('::ReadVar'))
+
+    rank_bytes = [sum(b for d, b in read.get(r, []) if b > 0) for r in ranks]
+    total_bytes = sum(rank_bytes)
+
+    # imbalance, the busiest rank over the average, less one
+    busy = [sum(d for d, b in execute[r][:n_steps]) for r in ranks]
+    mean_busy = sum(busy)/len(busy)
+    mean_bytes = total_bytes/float(len(ranks))
+
+    recv_time = sum(latency)
+
+    return {'num_steps': n_steps,
+        'step_latency_mean': sum(latency)/max(1, n_steps),
+        'step_latency_median': median(latency),
+        'step_latency_max': max(latency) if latency else 0.0,
+        'bytes_read': total_bytes,
+        'bytes_read_per_step': total_bytes/max(1, n_steps),
+        'bandwidth': total_bytes/recv_time if recv_time > 0 else None,
+        'bandwidth_per_rank': total_bytes/recv_time/len(ranks)
+            if recv_time > 0 else None,
+        'wall_time': wall_time,
+        'time_imbalance': max(busy)/mean_busy - 1.0 if mean_busy > 0 else 0.0,
+        'bytes_imbalance': max(rank_bytes)/mean_bytes - 1.0
+            if mean_bytes > 0 else 0.0}
+
+
+def profile_env(run_dir, prefix, mem_interval):
+    env = dict(os.environ)
+    env['PROFILER_ENABLE'] = '3'
+    env['PROFILER_LOG_FILE'] = os.path.join(run_dir, prefix + '_timer.csv')
+    env['PROFILER_LOG_FORMAT'] = 'csv'
+    env['MEMPROF_LOG_FILE'] = os.path.join(run_dir, prefix + '_mem_prof.csv')
+    env['MEMPROF_INTERVAL'] = str(mem_interval)
+    env['MEMPROF_TRACK_PEAK'] = '1'
+    return env
+
+
+def wait_ready(file_name, proc, max_wait):
+    """ wait for the writer of a concurrent transport to publish its
+    connection info """
+    t0 = time.time()
+    while not os.path.exists(file_name):
+        if proc.poll() is not None or time.time() - t0 > max_wait:
+            return -1
+        time.sleep(0.1)
+    return 0
+
+
+def run_case(args, transport, part, n_writers, n_readers, shape, run_dir):
+    """ run the writer and the reader once and reduce the reader's logs """
+    run_dir = os.path.abspath(run_dir)
+    if os.path.exists(run_dir):
+        shutil.rmtree(run_dir)
+    os.makedirs(run_dir)
+
+    tdesc = TRANSPORTS[transport]
+    file_base = os.path.join(run_dir, 'scaling')
+    subs = {'file': file_base, 'part': PARTITIONERS[part]}
+
+    write_xml = os.path.join(run_dir, 'write.xml')
+    write_file(write_xml, '<sensei>\n  %s\n</sensei>\n'%(tdesc['write']%subs))
+
+    read_xml = os.path.join(run_dir, 'read.xml')
+    write_file(read_xml, '<sensei>\n  %s\n</sensei>\n'%(tdesc['read']%subs))
+
+    if args.analysis:
+        analysis_xml = os.path.abspath(args.analysis)
+    else:
+        analysis_xml = os.path.join(run_dir, 'analysis.xml')
+        write_file(analysis_xml, DEFAULT_ANALYSIS)
+
+    write_cmd = [args.mpiexec, args.np_flag, str(n_writers), args.oscillator,
+        '-b', str(n_writers*args.blocks_per_rank), '-s'] + \
+        [str(s) for s in shape] + ['-t', str(args.dt),
+        '--t-end', str(args.dt*args.steps), '-f', write_xml,
+        os.path.abspath(args.input)]
+
+    read_cmd = [args.mpiexec, args.np_flag, str(n_readers), args.endpoint,
+        '-t', read_xml, '-a', analysis_xml]
+
+    if args.verbose:
+        sys.stderr.write('%s\n%s\n'%(' '.join(write_cmd), ' '.join(read_cmd)))
+
+    wout = open(os.path.join(run_dir, 'writer.txt'), 'w')
+    rout = open(os.path.join(run_dir, 'reader.txt'), 'w')
+
+    t0 = time.time()
+    writer = subprocess.Popen(write_cmd, cwd=run_dir, stdout=wout,
+        stderr=subprocess.STDOUT, env=profile_env(run_dir, 'writer',
+        args.mem_interval))
+
+    werr = 0
+    rerr = 0
+    if tdesc['concurrent']:
+        if wait_ready(tdesc['ready']%subs, writer, args.max_wait):
+            writer.kill()
+            rerr = -1
+    else:
+        werr = writer.wait()
+
+    t1 = time.time()
+    if rerr == 0 and werr == 0:
+        rerr = subprocess.call(read_cmd, cwd=run_dir, stdout=rout,
+            stderr=subprocess.STDOUT, env=profile_env(run_dir, 'reader',
+            args.mem_interval))
+    t2 = time.time()
+
+    if tdesc['concurrent']:
+        werr = writer.wait()
+
+    wout.close()
+    rout.close()
+
+    events = read_timer_log(os.path.join(run_dir, 'reader_timer.csv'))
+    result = reduce_receiver(events, t2 - (t0 if tdesc['concurrent'] else t1))
+
+    return werr, rerr, result, \
+        read_mem_log(os.path.join(run_dir, 'reader_mem_prof.csv'))
+
+
+def machine_info(args):
+    """ what is needed to compare results across machines """
+    info = {'hostname': socket.gethostname(), 'platform': platform.platform(),
+        'processor': platform.processor(), 'mpiexec': args.mpiexec}
+    try:
+        info['cpu_count'] = os.cpu_count()
+    except AttributeError:
+        import multiprocessing
+        info['cpu_count'] = multiprocessing.cpu_count()
+    return info
+
+
+def main():
+    parser = argparse.ArgumentParser(description='measure the weak or strong '
+        'scaling of SENSEI\'s in transit transports at M:N ratios.')
+
+    parser.add_argument('--oscillator', required=True,
+        help='path to the oscillator executable')
+    parser.add_argument('--endpoint', required=True,
+        help='path to the SENSEIEndPoint executable')
+    parser.add_argument('--input', required=True,
+        help='oscillator input deck')
+    parser.add_argument('--transports', nargs='+',
+        default=['adios2_bp4', 'adios2_sst', 'hdf5'],
+        choices=sorted(TRANSPORTS.keys()), help='transports to measure')
+    parser.add_argument('--partitioners', nargs='+', default=['block'],
+        choices=sorted(PARTITIONERS.keys()),
+        help='receive side partitioners to measure')
+    parser.add_argument('--writers', type=int, nargs='+', default=[4],
+        help='numbers of writer ranks (M) to sweep')
+    parser.add_argument('--ratios', type=int, nargs='+', default=[1, 2, 4],
+        help='M:N ratios to sweep, N = max(1, M/ratio)')
+    parser.add_argument('--mode', choices=['weak', 'strong'], default='weak',
+        help='in weak scaling the grid grows with M')
+    parser.add_argument('--shape', type=int, nargs=3, default=[64, 64, 64],
+        help='global number of cells in strong scaling, cells per writer '
+        'rank in weak scaling')
+    parser.add_argument('--blocks-per-rank', type=int, default=1,
+        help='writer blocks per rank')
+    parser.add_argument('--analysis',
+        help='the receiver\'s analysis XML, by default a histogram')
+    parser.add_argument('--mpiexec', default='mpiexec',
+        help='MPI launcher')
+    parser.add_argument('--np-flag', default='-n',
+        help='the launcher\'s flag setting the number of ranks')
+    parser.add_argument('--steps', type=int, default=10,
+        help='number of time steps per run')
+    parser.add_argument('--dt', type=float, default=0.01,
+        help='time step')
+    parser.add_argument('--mem-interval', type=float, default=0.05,
+        help='memory sampling interval in seconds')
+    parser.add_argument('--max-wait', type=float, default=60.0,
+        help='seconds to wait for a streaming writer to start')
+    parser.add_argument('--work-dir', default='transport_scaling',
+        help='where the runs are made')
+    parser.add_argument('--output', default='transport_scaling.json',
+        help='the summary file')
+    parser.add_argument('--verbose', action='store_true',
+        help='print the commands run')
+
+    args = parser.parse_args()
+
+    # the runs are made in their own directories
+    for exe in ('oscillator', 'endpoint'):
+        if os.path.exists(getattr(args, exe)):
+            setattr(args, exe, os.path.abspath(getattr(args, exe)))
+
+    results = []
+    n_errors = 0
+
+    for transport, part, n_writers, ratio in itertools.product(
+        args.transports, args.partitioners, args.writers, args.ratios):
+
+        n_readers = max(1, n_writers//ratio)
+
+        # weak scaling stacks a shape per writer rank along z
+        shape = list(args.shape)
+        if args.mode == 'weak':
+            shape[2] *= n_writers
+
+        case = '%s_%s_m%d_n%d'%(transport, part, n_writers, n_readers)
+
+        werr, rerr, recv, peak = run_case(args, transport, part, n_writers,
+            n_readers, shape, os.path.join(args.work_dir, case))
+
+        ok = (werr == 0) and (rerr == 0) and (recv is not None)
+        if not ok:
+            n_errors += 1
+
+        ncells = shape[0]*shape[1]*shape[2]
+
+        results.append({'transport': transport, 'partitioner': part,
+            'writers': n_writers, 'readers': n_readers, 'ratio': ratio,
+            'shape': shape, 'cells_per_writer': ncells//n_writers,
+            'ok': ok, 'writer_status': werr, 'reader_status': rerr,
+            'receiver': recv, 'reader_peak_memory_kib': peak})
+
+        if recv:
+            sys.stderr.write('%s %s latency=%g s bandwidth=%s B/s '
+                'imbalance=%g\n'%(case, 'ok' if ok else 'FAILED',
+                recv['step_latency_mean'], recv['bandwidth'],
+                recv['time_imbalance']))
+        else:
+            sys.stderr.write('%s FAILED\n'%(case))
+
+    with open(args.output, 'w') as f:
+        json.dump({'mode': args.mode, 'steps': args.steps,
+            'machine': machine_info(args), 'results': results}, f, indent=2)
+
+    return 1 if n_errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -45,12 +45,25 @@ void set_data(int gid, float* data)
   DataAdaptor->SetBlockData(gid, data);
 }
 
+//-----------------------------------------------------------------------------
+void set_device_data(int gid, float *data, int device,
+  const std::function<int(void*)> &copy)
+{
+  DataAdaptor->SetBlockDeviceData(gid, data, device, copy);
+}
+
 //-----------------------------------------------------------------------------
 void set_particles(int gid, const std::vector<Particle> &particles)
 {
   DataAdaptor->SetParticleData(gid, particles);
 }
 
+//-----------------------------------------------------------------------------
+bool will_execute(long step, float time)
+{
+  return AnalysisAdaptor->WillExecute(step, time);
+}
+
 //-----------------------------------------------------------------------------
 void execute(long step, float time)
 {
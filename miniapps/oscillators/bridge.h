@@ -3,6 +3,7 @@
 
 #include <mpi.h>
 #include <string>
+#include <functional>
 
 #include "Particles.h"
 
@@ -14,8 +15,17 @@ namespace bridge
     int *to_z, int *shape, int ghostLevels, const std::string& config_file);
 
   void set_data(int gid, float* data);
+
+  // set the data of a block that lives in CUDA device memory. copy
+  // transfers it to a host buffer
+  void set_device_data(int gid, float *data, int device,
+    const std::function<int(void*)> &copy);
   void set_particles(int gid, const std::vector<Particle> &particles);
 
+  // returns false when no analysis will run on the step, the data need
+  // not be set
+  bool will_execute(long step, float time);
+
   void execute(long step, float time);
 
   void finalize();
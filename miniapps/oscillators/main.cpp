@@ -1,6 +1,8 @@
 #include <vector>
 #include <chrono>
 #include <ctime>
+#include <thread>
+#include <algorithm>
 
 #include <opts/opts.h>
 
@@ -14,6 +16,9 @@
 #include "Oscillator.h"
 #include "Particles.h"
 #include "Block.h"
+#if defined(OSCILLATOR_CUDA)
+#include "OscillatorDevice.h"
+#endif
 
 #include "senseiConfig.h"
 #include "MPIManager.h"
@@ -79,7 +84,7 @@ int main(int argc, char** argv)
         >> Option('k', "k-max",  k_max,     "number of strongest autocorrelations to report")
 #endif
         >> Option(     "t-end",  t_end,     "end time")
-        >> Option('j', "jobs",   threads,   "number of threads to use")
+        >> Option('j', "jobs",   threads,   "number of threads to use, to run blocks concurrently and within a block")
         >> Option('o', "output", out_prefix, "prefix to save output")
         >> Option('g', "ghost-cells", ghostCells, "number of ghost cells")
         >> Option('p', "particles", numberOfParticles, "number of random particles to generate")
@@ -88,6 +93,9 @@ int main(int argc, char** argv)
     ;
     bool sync = ops >> Present("sync", "synchronize after each time step");
     bool verbose = ops >> Present("verbose", "print debugging messages");
+#ifdef ENABLE_SENSEI
+    bool noExecute = ops >> Present("no-execute", "skip bridge::execute, for measuring the overhead of the analyses");
+#endif
 
     std::string infn;
     if (  ops >> Present('h', "help", "show help") ||
@@ -239,6 +247,38 @@ int main(int argc, char** argv)
                    },
                    share_face, wrap, ghosts);
 
+    // the threads not used to run blocks concurrently are used within them
+    int nthreads = threads < 1 ? int(std::thread::hardware_concurrency()) : threads;
+    int blockThreads = std::max(1, nthreads/std::max(1, int(gids.size())));
+
+    // the ranks on a node share its devices round robin
+    int device = 0;
+#if defined(OSCILLATOR_CUDA)
+    int nDevices = OscillatorDevice::get_device_count();
+    if (nDevices < 1)
+    {
+        std::cerr << "Error: no CUDA devices were found" << std::endl;
+        return 1;
+    }
+
+    MPI_Comm nodeComm;
+    MPI_Comm_split_type(world, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+    int nodeRank = 0;
+    MPI_Comm_rank(nodeComm, &nodeRank);
+    MPI_Comm_free(&nodeComm);
+
+    device = nodeRank % nDevices;
+
+    if (verbose)
+        std::cerr << world.rank() << " device = " << device << std::endl;
+#endif
+
+    master.foreach([=](Block* b, const Proxy&)
+                          {
+                            b->nthreads = blockThreads;
+                            b->device = device;
+                          });
+
     sensei::Profiler::EndEvent("oscillators::initialize");
 
     sensei::Profiler::StartEvent("oscillators::analysis::initialize");
@@ -293,15 +333,26 @@ int main(int argc, char** argv)
 
         sensei::Profiler::StartEvent("oscillators::analysis");
 #ifdef ENABLE_SENSEI
-        // do the analysis using sensei
-        // update data adaptor with new data
-        master.foreach([=](Block* b, const Proxy&)
-                              {
-                              bridge::set_data(b->gid, b->grid.data());
-                              bridge::set_particles(b->gid, b->particles);
-                              });
-        // push data to sensei
-        bridge::execute(t_count, t);
+        // do the analysis using sensei. steps on which no analysis runs
+        // are skipped
+        if (noExecute || bridge::will_execute(t_count, t))
+        {
+            // update data adaptor with new data
+            master.foreach([=](Block* b, const Proxy&)
+                                  {
+#if defined(OSCILLATOR_CUDA)
+                                  bridge::set_device_data(b->gid, b->dev.data, b->dev.device,
+                                    [b](void *dest) -> int
+                                    { return b->dev.copy_to_host(static_cast<float*>(dest)); });
+#else
+                                  bridge::set_data(b->gid, b->grid.data());
+#endif
+                                  bridge::set_particles(b->gid, b->particles);
+                                  });
+            // push data to sensei
+            if (!noExecute)
+                bridge::execute(t_count, t);
+        }
 #else
         // do the analysis without using sensei
         // call the analysis function for each block
@@ -324,6 +375,9 @@ int main(int argc, char** argv)
             sdiy::io::BOV writer(out, shape);
             master.foreach([&writer](Block* b, const sdiy::Master::ProxyWithLink& cp)
                                            {
+#if defined(OSCILLATOR_CUDA)
+                                             b->dev.copy_to_host(b->grid.data());
+#endif
                                              auto link = static_cast<Link*>(cp.link());
                                              writer.write(link->bounds(), b->grid.data(), true);
                                            });
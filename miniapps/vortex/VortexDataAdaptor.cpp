@@ -1,6 +1,7 @@
 #include "VortexDataAdaptor.h"
 #include "MeshMetadata.h"
 #include "Error.h"
+#include "Profiler.h"
 
 #include <vtkCellArray.h>
 #include <vtkCellData.h>
@@ -23,8 +24,73 @@
 #include "simulation_data.h"
 #include "patch.h"
 
+#include <vector>
+#include <cstring>
+
 static const char *arrname = "vortex";
 
+namespace
+{
+// returns true if this rank exposes the patch. Duplicate patches are
+// exposed by their first owner.
+bool ownsPatch(simulation_data *sim, patch_t *patch)
+{
+  return (patch->nowners < 2) || (patch->owners[0] == sim->par_rank);
+}
+
+// describe the patches exposed by this rank, their ids, levels, extents,
+// and blanking. When this does not change between steps neither does the
+// mesh.
+void getLayout(simulation_data *sim, patch_t **patches, int np,
+  std::vector<long long> &layout)
+{
+  layout.clear();
+
+  for (int i = 0; i < sim->max_levels+1; ++i)
+    layout.push_back(sim->npatches_per_level[i]);
+
+  for (int i = 0; i < np; ++i)
+    {
+    patch_t *patch = patches[i];
+    if (!ownsPatch(sim, patch))
+      continue;
+
+    layout.push_back(patch->id);
+    layout.push_back(patch->level);
+    layout.insert(layout.end(), patch->logical_extents,
+      patch->logical_extents + 6);
+
+    // the blanking depends on the refinement of the patch, which may be
+    // made on another rank
+    unsigned long long h = 14695981039346656037ull;
+    if (patch->blank)
+      {
+      long sz = long(patch->nx)*patch->ny*patch->nz;
+      for (long j = 0; j < sz; ++j)
+        h = (h ^ patch->blank[j]) * 1099511628211ull;
+      }
+    layout.push_back((long long)h);
+    }
+}
+
+// remove the simulation's field from the blocks. the mesh references the
+// simulation's memory which is released at the end of the step.
+void removeField(vtkOverlappingAMR *mesh)
+{
+  unsigned int nLevels = mesh->GetNumberOfLevels();
+  for (unsigned int i = 0; i < nLevels; ++i)
+    {
+    unsigned int nBlocks = mesh->GetNumberOfDataSets(i);
+    for (unsigned int j = 0; j < nBlocks; ++j)
+      {
+      vtkDataSet *block = mesh->GetDataSet(i, j);
+      if (block)
+        block->GetCellData()->RemoveArray(arrname);
+      }
+    }
+}
+}
+
 struct VortexDataAdaptor::DInternals
 {
 #ifdef REPRESENT_VTK_AMR
@@ -32,6 +98,7 @@ struct VortexDataAdaptor::DInternals
 #else
   vtkSmartPointer<vtkMultiBlockDataSet> Mesh;
 #endif
+  std::vector<long long> Layout;
   simulation_data *sim;
 };
 
@@ -55,7 +122,9 @@ void VortexDataAdaptor::Initialize(simulation_data *sim)
 {
   DInternals& internals = (*this->Internals);
   internals.sim = sim;
- 
+  internals.Mesh = nullptr;
+  internals.Layout.clear();
+
   this->ReleaseData();
 }
 
@@ -70,8 +139,25 @@ int VortexDataAdaptor::GetMesh(const std::string &meshName, bool /*structureOnly
     return -1;
     }
 
+  sensei::TimeEvent<64> event("VortexDataAdaptor::GetMesh");
+
   DInternals& internals = (*this->Internals);
-  if (!internals.Mesh)
+
+  // The grid is the same from step to step unless the refinement changed.
+  // When the patches are laid out as in the previous step the mesh is
+  // reused and only the field is passed again in AddArray.
+  int np = 0;
+  patch_t **patches_this_rank = patch_flat_array(&internals.sim->patch, &np);
+
+  std::vector<long long> layout;
+  getLayout(internals.sim, patches_this_rank, np, layout);
+
+  if (internals.Mesh && (layout == internals.Layout))
+    {
+    removeField(internals.Mesh);
+    internals.Mesh->Modified();
+    }
+  else
     {
 //#define DEBUG_GET_MESH
 #ifdef DEBUG_GET_MESH
@@ -111,8 +197,6 @@ int VortexDataAdaptor::GetMesh(const std::string &meshName, bool /*structureOnly
         spacingSet[i] = false;
 
     // Now, let's insert local patches into the AMR dataset.
-    int np = 0;
-    patch_t **patches_this_rank = patch_flat_array(&internals.sim->patch, &np);
 #ifdef DEBUG_GET_MESH
     if(f != NULL)
       {
@@ -210,18 +294,20 @@ int VortexDataAdaptor::GetMesh(const std::string &meshName, bool /*structureOnly
         }
 #endif
       // If the patch has children, and blank data then expose that data as
-      // vtkGhostType.
+      // vtkGhostType. It is copied since the mesh outlives the patch when
+      // it is reused in the next step.
       vtkUnsignedCharArray *arr = vtkUnsignedCharArray::New();
       arr->SetName("vtkGhostType");
       int sz = patches_this_rank[i]->nx*patches_this_rank[i]->ny*patches_this_rank[i]->nz;
+      arr->SetNumberOfTuples(sz);
       if(patches_this_rank[i]->blank != nullptr)
         {
-        arr->SetArray(patches_this_rank[i]->blank, sz, 1);
+        memcpy(arr->GetVoidPointer(0), patches_this_rank[i]->blank,
+          sz * sizeof(unsigned char));
         }
       else
         {
         // leaf patches won't have a blank array.
-        arr->SetNumberOfTuples(sz);
         memset(arr->GetVoidPointer(0), 0, sz * sizeof(unsigned char));
         }
       p->GetCellData()->AddArray(arr);
@@ -251,10 +337,16 @@ int VortexDataAdaptor::GetMesh(const std::string &meshName, bool /*structureOnly
         fclose(f);
 #endif
     delete [] spacingSet;
-    FREE(patches_this_rank);
+
+    internals.Layout.swap(layout);
     }
 
+  FREE(patches_this_rank);
+
+  // the caller takes a reference
   mesh = internals.Mesh;
+  mesh->Register(nullptr);
+
   return 0;
 }
 
@@ -275,6 +367,8 @@ int VortexDataAdaptor::AddArray(vtkDataObject* mesh, const std::string &meshName
   (void)association;
   (void)arrayName;
 #endif
+  sensei::TimeEvent<64> event("VortexDataAdaptor::AddArray");
+
   int retVal = 1;
   DInternals& internals = (*this->Internals);
   vtkOverlappingAMR *ds = vtkOverlappingAMR::SafeDownCast(mesh);
@@ -328,63 +422,134 @@ int VortexDataAdaptor::GetNumberOfMeshes(unsigned int &numMeshes)
 int VortexDataAdaptor::GetMeshMetadata(unsigned int id,
   sensei::MeshMetadataPtr &metadata)
 {
-  if (id == 0)
+  if (id != 0)
+    {
+    SENSEI_ERROR("Failed to get mesh name")
+    return -1;
+    }
+
+  sensei::TimeEvent<64> event("VortexDataAdaptor::GetMeshMetadata");
+
+  DInternals& internals = (*this->Internals);
+  simulation_data *sim = internals.sim;
+
+  metadata->MeshName = "AMR_mesh";
+  metadata->MeshType = VTK_OVERLAPPING_AMR;
+  metadata->BlockType = VTK_UNIFORM_GRID;
+
+  // without refinement the root patch is the whole mesh, and it covers the
+  // same window every step
+  metadata->StaticMesh = (sim->max_levels == 0);
+
+  metadata->NumGhostCells = 0;
+  metadata->NumGhostNodes = 0;
+
+  metadata->NumArrays = 1;
+  metadata->ArrayName = {arrname};
+  metadata->ArrayCentering = {vtkDataObject::CELL};
+  metadata->ArrayType = {VTK_FLOAT};
+  metadata->ArrayComponents = {1};
+
+  metadata->NumLevels = sim->max_levels + 1;
+
+  int rr = sim->refinement_ratio;
+  metadata->RefRatio.resize(metadata->NumLevels,
+    std::array<int,3>({rr, rr, (sim->patch.nz > 1 ? rr : 1)}));
+
+  metadata->NumBlocks = 0;
+  metadata->NumBlocksLocal.resize(1);
+
+  if (metadata->Flags.BlockExtentsSet())
+    metadata->Extent = {sim->patch.logical_extents[0],
+      sim->patch.logical_extents[1], sim->patch.logical_extents[2],
+      sim->patch.logical_extents[3], sim->patch.logical_extents[4],
+      sim->patch.logical_extents[5]};
+
+  if (metadata->Flags.BlockBoundsSet())
+    metadata->Bounds = {sim->patch.window[0], sim->patch.window[1],
+      sim->patch.window[2], sim->patch.window[3], sim->patch.window[4],
+      sim->patch.window[5]};
+
+  if (metadata->Flags.BlockSizeSet())
     {
-    metadata->MeshName = "AMR_mesh";
-    metadata->GlobalView = true;
-    metadata->MeshType = VTK_OVERLAPPING_AMR;
-    metadata->BlockType = VTK_IMAGE_DATA;
+    metadata->NumPoints = 0;
+    metadata->NumCells = 0;
+    }
 
-    // TODO -- fill these in
-    /*
-    metadata->NumBlocks = ; // total number of patches
-    metadata->NumBlocksLocal = ; // num pacthes on this rank
+  int np = 0;
+  patch_t **local_patches = patch_flat_array(&sim->patch, &np);
 
-    metadata->NumLevels = ;
-    metadata->RefRatio = ; // refinement on each level (use amrex convention)
+  metadata->BlocksPerLevel.resize(metadata->NumLevels);
 
-    if (metadata->Flags.BlockExtentsSet())
+  for (int j = 0; j < metadata->NumLevels; ++j)
+    {
+    for (int i = 0; i < np; ++i)
       {
-      metadata->Extent = ; // level zero index space bounding box
-      metadata->BlockExtents = ; // index space bounds of all blocks on all ranks
-      }
+      patch_t *patch = local_patches[i];
 
-    if (metadata->Flags.BlockBoundsSet())
-      {
-      metadata->Bounds = ; // level zero bounding box
-      metadata->BlockBounds = ; // index space bounds of all blocks on all ranks
-      }
+      // skip duplicate patches not owned by this rank, and work level by
+      // level.
+      if (!ownsPatch(sim, patch) || (patch->level != j))
+        continue;
 
-    if (metadata->Flags.BlockSizesSet())
-      {
-      metadata->NumPoints = ; // total num points all blocks
-      metadata->NumCells = ; // total num cells all bocks
-      metadata->BlockNumPoints = ; // num points each block
-      metadata->BlockNumCells = ; // num cells each blocks
-      }
+      metadata->NumBlocks += 1;
+      metadata->NumBlocksLocal[0] += 1;
 
-    if (metadata->Flags.BlockOwnerSet())
-      {
-      metadata->BlockOwner = ; // rank for each block
+      metadata->BlocksPerLevel[j] += 1;
+      metadata->BlockLevel.push_back(j);
+
+      if (metadata->Flags.BlockDecompSet())
+        {
+        metadata->BlockOwner.push_back(sim->par_rank);
+        metadata->BlockIds.push_back(patch->id);
+        }
+
+      if (metadata->Flags.BlockSizeSet())
+        {
+        long long nc = (long long)patch->nx*patch->ny*patch->nz;
+        long long npts = (long long)(patch->nx + 1)*(patch->ny + 1)*
+          (patch->nz > 1 ? patch->nz + 1 : 1);
+
+        metadata->BlockNumPoints.push_back(npts);
+        metadata->NumPoints += npts;
+
+        metadata->BlockNumCells.push_back(nc);
+        metadata->NumCells += nc;
+        }
+
+      if (metadata->Flags.BlockExtentsSet())
+        metadata->BlockExtents.push_back(std::array<int,6>{{
+          patch->logical_extents[0], patch->logical_extents[1],
+          patch->logical_extents[2], patch->logical_extents[3],
+          patch->logical_extents[4], patch->logical_extents[5]}});
+
+      if (metadata->Flags.BlockBoundsSet())
+        metadata->BlockBounds.push_back(std::array<double,6>{{
+          patch->window[0], patch->window[1], patch->window[2],
+          patch->window[3], patch->window[4], patch->window[5]}});
       }
-    */
-
-    metadata->NumArrays = 1;
-    metadata->ArrayName = {"mandelbrot"};
-    metadata->ArrayCentering = {vtkDataObject::CELL};
-    metadata->ArrayType = {VTK_UNSIGNED_CHAR};
-    metadata->ArrayComponents = {1};
-    return 0;
     }
 
-  SENSEI_ERROR("Failed to get mesh name")
-  return -1;
+  FREE(local_patches);
+
+  // AMR data is always to be a global view.
+  metadata->GlobalizeView(this->GetCommunicator());
+
+  return 0;
 }
 
 //-----------------------------------------------------------------------------
 int VortexDataAdaptor::ReleaseData()
 {
+  sensei::TimeEvent<64> event("VortexDataAdaptor::ReleaseData");
+
+  // The mesh is kept for the next step. The field is removed since the
+  // simulation releases it when the patches are recomputed.
   DInternals& internals = (*this->Internals);
-  internals.Mesh = NULL;
+  if (internals.Mesh)
+    removeField(internals.Mesh);
+
+  this->ReleaseCachedMeshArrays();
+
   return 0;
 }
@@ -51,6 +51,7 @@ template <> struct NumpyTT<CPP_T>                  \
   { return PyArray_TYPE(arr) == CODE; }            \
 };
 senseiPyArray_NumpyTT_declare(NPY_BYTE, char)
+senseiPyArray_NumpyTT_declare(NPY_BYTE, signed char)
 senseiPyArray_NumpyTT_declare(NPY_INT16, short)
 senseiPyArray_NumpyTT_declare(NPY_INT32, int)
 senseiPyArray_NumpyTT_declare(NPY_LONG, long)
@@ -0,0 +1,272 @@
+#ifndef senseiPyArrayView_h
+#define senseiPyArrayView_h
+
+#include "senseiPyArray.h"
+#include "MeshMetadata.h"
+#include "BinaryStream.h"
+
+#include <vtkAbstractArray.h>
+#include <vtkDataArray.h>
+#include <vtkSetGet.h>
+#include <vtkSOADataArrayTemplate.h>
+
+#include <Python.h>
+#include <array>
+#include <string>
+#include <vector>
+
+namespace senseiPyArray
+{
+// the capsule holds a reference to the VTK array for as long as
+// a view of its memory exists
+static void ReleaseViewBase(PyObject *capsule)
+{
+  vtkDataArray *arr = static_cast<vtkDataArray*>(
+    PyCapsule_GetPointer(capsule, "vtkDataArray"));
+  if (arr)
+    arr->UnRegister(nullptr);
+}
+
+// the capsule holds a copy of the metadata's shared pointer for as
+// long as a view of its memory exists
+static void ReleaseMetadataViewBase(PyObject *capsule)
+{
+  delete static_cast<sensei::MeshMetadataPtr*>(
+    PyCapsule_GetPointer(capsule, "MeshMetadataPtr"));
+}
+
+// ****************************************************************************
+// make a view of nRows by nCols values at data. the view steals the
+// reference to base, the object that keeps the memory alive.
+template <typename cpp_t>
+PyObject *NewView(PyObject *base, cpp_t *data, npy_intp nRows, int nCols)
+{
+  if (!base)
+    return nullptr;
+
+  npy_intp dims[2] = {nRows, nCols};
+  int nDims = nCols > 1 ? 2 : 1;
+
+  PyObject *view = PyArray_SimpleNewFromData(nDims, dims,
+    NumpyTT<cpp_t>::code, data);
+  if (!view)
+    {
+    Py_DECREF(base);
+    return nullptr;
+    }
+
+  if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(view), base))
+    {
+    Py_DECREF(base);
+    Py_DECREF(view);
+    return nullptr;
+    }
+
+  return view;
+}
+
+// ****************************************************************************
+template <typename cpp_t>
+PyObject *NewView(vtkDataArray *arr, cpp_t *data, int nComps)
+{
+  // the view keeps the array alive
+  PyObject *base = PyCapsule_New(arr, "vtkDataArray", ReleaseViewBase);
+  if (!base)
+    return nullptr;
+
+  arr->Register(nullptr);
+
+  return NewView(base, data, arr->GetNumberOfTuples(), nComps);
+}
+
+// ****************************************************************************
+static PyObject *NewMetadataViewBase(const sensei::MeshMetadataPtr &md)
+{
+  return PyCapsule_New(new sensei::MeshMetadataPtr(md),
+    "MeshMetadataPtr", ReleaseMetadataViewBase);
+}
+
+// ****************************************************************************
+template <typename cpp_t>
+PyObject *NewView(const sensei::MeshMetadataPtr &md, std::vector<cpp_t> &vec)
+{
+  return NewView(NewMetadataViewBase(md), vec.data(), vec.size(), 1);
+}
+
+// ****************************************************************************
+template <typename cpp_t, size_t N>
+PyObject *NewView(const sensei::MeshMetadataPtr &md, std::array<cpp_t,N> &arr)
+{
+  return NewView(NewMetadataViewBase(md), arr.data(), N, 1);
+}
+
+// ****************************************************************************
+template <typename cpp_t, size_t N>
+PyObject *NewView(const sensei::MeshMetadataPtr &md,
+  std::vector<std::array<cpp_t,N>> &vec)
+{
+  // the values of the std::array's are contiguous in the vector
+  static_assert(sizeof(std::array<cpp_t,N>) == N*sizeof(cpp_t),
+    "std::array is padded");
+
+  return NewView(NewMetadataViewBase(md),
+    vec.empty() ? nullptr : vec[0].data(), vec.size(), N);
+}
+
+// ****************************************************************************
+template <typename cpp_t, size_t N>
+PyObject *NewView(const sensei::MeshMetadataPtr &md,
+  std::vector<std::vector<std::array<cpp_t,N>>> &vec)
+{
+  // the inner vectors are not contiguous, each gets its own view
+  size_t n = vec.size();
+  PyObject *views = PyList_New(n);
+  for (size_t i = 0; i < n; ++i)
+    {
+    PyObject *view = NewView(md, vec[i]);
+    if (!view)
+      {
+      Py_DECREF(views);
+      return nullptr;
+      }
+    // the list steals the reference
+    PyList_SET_ITEM(views, i, view);
+    }
+  return views;
+}
+
+/// NewView -- expose a member of MeshMetadata to NumPy without copying
+/**
+Vectors of scalars, such as BlockNumCells, are returned as 1D arrays.
+Vectors of std::array, such as BlockBounds, are returned as 2D arrays with
+a row per block. BlockArrayRange is returned as a list of 2D arrays, one
+per block. The views hold a reference to the metadata and are valid until
+the member is resized or assigned to. A KeyError is raised for members
+that are not arrays of numbers.
+*/
+static PyObject *NewView(const sensei::MeshMetadataPtr &md,
+  const std::string &member)
+{
+  if (!md)
+    {
+    PyErr_Format(PyExc_TypeError, "A MeshMetadata is required");
+    return nullptr;
+    }
+
+#define senseiPyArray_MetadataView(MEMBER)  \
+  if (member == #MEMBER)                    \
+    return NewView(md, md->MEMBER);
+
+  senseiPyArray_MetadataView(NumBlocksLocal)
+  senseiPyArray_MetadataView(Extent)
+  senseiPyArray_MetadataView(Bounds)
+  senseiPyArray_MetadataView(ArrayCentering)
+  senseiPyArray_MetadataView(ArrayComponents)
+  senseiPyArray_MetadataView(ArrayType)
+  senseiPyArray_MetadataView(ArrayRange)
+  senseiPyArray_MetadataView(BlockOwner)
+  senseiPyArray_MetadataView(BlockIds)
+  senseiPyArray_MetadataView(BlockNumPoints)
+  senseiPyArray_MetadataView(BlockNumCells)
+  senseiPyArray_MetadataView(BlockCellArraySize)
+  senseiPyArray_MetadataView(BlockExtents)
+  senseiPyArray_MetadataView(BlockBounds)
+  senseiPyArray_MetadataView(BlockArrayRange)
+  senseiPyArray_MetadataView(RefRatio)
+  senseiPyArray_MetadataView(BlocksPerLevel)
+  senseiPyArray_MetadataView(BlockLevel)
+  senseiPyArray_MetadataView(PeriodicBoundary)
+
+#undef senseiPyArray_MetadataView
+
+  PyErr_Format(PyExc_KeyError, "MeshMetadata has no array member \"%s\"",
+    member.c_str());
+
+  return nullptr;
+}
+
+/// NewView -- expose the contents of a BinaryStream to NumPy without copying
+/**
+The bytes between the head of the stream and its write position are
+returned as a 1D array of unsigned char. The view holds a reference to
+owner, the Python object wrapping the stream. It is valid until the
+stream is resized, grown by a write, or cleared.
+*/
+static PyObject *NewView(PyObject *owner, sensei::BinaryStream *str)
+{
+  if (!str)
+    {
+    PyErr_Format(PyExc_TypeError, "A BinaryStream is required");
+    return nullptr;
+    }
+
+  Py_INCREF(owner);
+
+  return NewView(owner, str->GetData(), str->Size(), 1);
+}
+
+/// NewView -- expose the memory of a VTK array to NumPy without copying
+/**
+An array with the standard (AOS) memory layout is returned as a single
+NumPy array with one row per tuple, or a 1D array when there is a single
+component. A vtkSOADataArrayTemplate is returned as a tuple holding a 1D
+array for each component. The views hold a reference to the VTK array.
+When the VTK array wraps simulation memory the views are only valid until
+the data adaptor's ReleaseData is called. Arrays with other layouts are
+not copied, a TypeError is raised instead.
+*/
+static PyObject *NewView(vtkDataArray *arr)
+{
+  if (!arr)
+    {
+    PyErr_Format(PyExc_TypeError, "A vtkDataArray is required");
+    return nullptr;
+    }
+
+  int nComps = arr->GetNumberOfComponents();
+
+  if (arr->HasStandardMemoryLayout())
+    {
+    switch (arr->GetDataType())
+      {
+      vtkTemplateMacro(
+        return NewView(arr, static_cast<VTK_TT*>(arr->GetVoidPointer(0)),
+          nComps);
+        );
+      }
+    }
+  else if (arr->GetArrayType() == vtkAbstractArray::SoADataArrayTemplate)
+    {
+    PyObject *comps = PyTuple_New(nComps);
+    switch (arr->GetDataType())
+      {
+      vtkTemplateMacro(
+        vtkSOADataArrayTemplate<VTK_TT> *soa =
+          static_cast<vtkSOADataArrayTemplate<VTK_TT>*>(arr);
+
+        for (int i = 0; i < nComps; ++i)
+          {
+          PyObject *view = NewView(arr, soa->GetComponentArrayPointer(i), 1);
+          if (!view)
+            {
+            Py_DECREF(comps);
+            return nullptr;
+            }
+          // the tuple steals the reference
+          PyTuple_SET_ITEM(comps, i, view);
+          }
+        return comps;
+        );
+      }
+    Py_DECREF(comps);
+    }
+
+  PyErr_Format(PyExc_TypeError, "A %s of type %s can not be viewed without"
+    " a copy", arr->GetClassName(), arr->GetDataTypeAsString());
+
+  return nullptr;
+}
+
+}
+
+#endif
@@ -9,8 +9,11 @@
 #include <Python.h>
 
 #include <vtkDataObject.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkAOSDataArrayTemplate.h>
 #include <vtkPythonUtil.h>
 #include <string>
+#include <vector>
 #include <iostream>
 using std::cerr;
 using std::endl;
@@ -251,6 +254,178 @@ private:
   senseiPyObject::PyCallablePointer Callback;
 };
 
+// wrap the memory of an object exposing the buffer protocol, such as a
+// NumPy array, in a VTK array without copying. The array must be C
+// contiguous, one dimensional, or two dimensional with a column per
+// component. returns a new reference or nullptr if the object can not be
+// wrapped.
+template <typename T>
+vtkDataArray *NewArrayView(const Py_buffer &buf)
+{
+  vtkIdType nTuples = buf.ndim > 0 ? buf.shape[0] : 1;
+  int nComps = buf.ndim > 1 ? buf.shape[1] : 1;
+
+  vtkAOSDataArrayTemplate<T> *da = vtkAOSDataArrayTemplate<T>::New();
+  da->SetNumberOfComponents(nComps);
+  da->SetArray(static_cast<T*>(buf.buf), nTuples*nComps, 1);
+  return da;
+}
+
+inline
+vtkDataArray *NewArrayView(PyObject *obj)
+{
+  Py_buffer buf;
+  if (PyObject_GetBuffer(obj, &buf, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT))
+    return nullptr;
+
+  vtkDataArray *da = nullptr;
+  if (buf.ndim <= 2)
+    {
+    // skip the byte order and alignment prefix
+    const char *fmt = buf.format ? buf.format : "B";
+    if ((*fmt == '@') || (*fmt == '=') || (*fmt == '<'))
+      ++fmt;
+
+    switch (*fmt)
+      {
+      case 'b': da = NewArrayView<signed char>(buf); break;
+      case 'B': da = NewArrayView<unsigned char>(buf); break;
+      case 'h': da = NewArrayView<short>(buf); break;
+      case 'H': da = NewArrayView<unsigned short>(buf); break;
+      case 'i': da = NewArrayView<int>(buf); break;
+      case 'I': da = NewArrayView<unsigned int>(buf); break;
+      case 'l': da = NewArrayView<long>(buf); break;
+      case 'L': da = NewArrayView<unsigned long>(buf); break;
+      case 'q': da = NewArrayView<long long>(buf); break;
+      case 'Q': da = NewArrayView<unsigned long long>(buf); break;
+      case 'f': da = NewArrayView<float>(buf); break;
+      case 'd': da = NewArrayView<double>(buf); break;
+      }
+    }
+
+  // the VTK array does not hold the buffer. the caller keeps the object
+  // alive for as long as the VTK array is in use
+  PyBuffer_Release(&buf);
+
+  return da;
+}
+
+// a container for the DataAdaptor::AddArrays callable. The callable is
+// invoked once with the list of array names. It may add the arrays to the
+// mesh itself, or return a dict mapping the names to NumPy arrays, or any
+// object exposing the buffer protocol. Returned arrays are added to the
+// mesh without copying.
+class PyAddArraysCallback
+{
+public:
+  PyAddArraysCallback(PyObject *f) : Callback(f) {}
+
+  void SetObject(PyObject *f)
+  { this->Callback.SetObject(f); }
+
+  explicit operator bool() const
+  { return static_cast<bool>(this->Callback); }
+
+  int operator()(vtkDataObject* mesh, const std::string &meshName,
+    int association, const std::vector<std::string> &arrayNames)
+    {
+    // lock the GIL, once for all of the arrays
+    senseiPyGILState gil;
+
+    // get the callback
+    PyObject *f = this->Callback.GetObject();
+    if (!f)
+      {
+      PyErr_Format(PyExc_TypeError,
+        "A AddArraysCallback was not provided");
+      return -1;
+      }
+
+    // build arguments list and call the callback
+    PyObject *pyMesh = vtkPythonUtil::GetObjectFromPointer(
+      static_cast<vtkObjectBase*>(mesh));
+
+    unsigned int nArrays = arrayNames.size();
+    PyObject *pyNames = PyList_New(nArrays);
+    for (unsigned int i = 0; i < nArrays; ++i)
+      PyList_SET_ITEM(pyNames, i, senseiPyObject::PyTT<std::string>::NewObject(arrayNames[i]));
+
+    PyObject *args = Py_BuildValue("NsiN", pyMesh, meshName.c_str(),
+      association, pyNames);
+
+    PyObject *ret = nullptr;
+    if (!(ret = PyObject_CallObject(f, args)) || PyErr_Occurred())
+      {
+      SENSEI_PY_CALLBACK_ERROR(DataAdaptor::AddArraysCallback, f)
+      Py_XDECREF(args);
+      return -1;
+      }
+
+    Py_DECREF(args);
+
+    // the callback added the arrays itself
+    if (ret == Py_None)
+      {
+      Py_DECREF(ret);
+      return 0;
+      }
+
+    if (!PyDict_Check(ret))
+      {
+      PyErr_Format(PyExc_TypeError,
+        "Bad return type from AddArraysCallback (not None or a dict)");
+      Py_DECREF(ret);
+      return -1;
+      }
+
+    vtkDataSetAttributes *atts = mesh ? mesh->GetAttributes(association) : nullptr;
+    if (!atts)
+      {
+      PyErr_Format(PyExc_TypeError, "AddArraysCallback returned arrays"
+        " for a mesh without %d attributes", association);
+      Py_DECREF(ret);
+      return -1;
+      }
+
+    int ierr = 0;
+    PyObject *key = nullptr;
+    PyObject *value = nullptr;
+    Py_ssize_t pos = 0;
+    while (!ierr && PyDict_Next(ret, &pos, &key, &value))
+      {
+      vtkDataArray *da = NewArrayView(value);
+      if (!da)
+        {
+        PyErr_Format(PyExc_TypeError, "AddArraysCallback returned an array"
+          " that can not be wrapped. Arrays must be C contiguous with at"
+          " most two dimensions and a numeric type");
+        ierr = -1;
+        break;
+        }
+
+      PyObject *name = PyObject_Str(key);
+      da->SetName(senseiPyObject::CppTT<char*>::Value(name).c_str());
+      Py_XDECREF(name);
+
+      // keep the Python array alive for as long as the VTK array, this is
+      // how vtk.util.numpy_support does it
+      PyObject *pyArray = vtkPythonUtil::GetObjectFromPointer(da);
+      PyObject_SetAttrString(pyArray, "_numpy_reference", value);
+      Py_DECREF(pyArray);
+
+      atts->AddArray(da);
+      da->Delete();
+      }
+
+    Py_DECREF(ret);
+
+    return ierr;
+    }
+
+private:
+  senseiPyObject::PyCallablePointer Callback;
+};
+
 // a container for the DataAdaptor::GetNumberOfArrays callable
 class PyGetNumberOfArraysCallback
 {
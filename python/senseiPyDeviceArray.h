@@ -0,0 +1,212 @@
+#ifndef senseiPyDeviceArray_h
+#define senseiPyDeviceArray_h
+
+#include "DeviceArray.h"
+
+#include <vtkSetGet.h>
+#include <vtkType.h>
+
+#include <Python.h>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+
+namespace senseiPyDeviceArray
+{
+// the DLPack ABI, see https://github.com/dmlc/dlpack. it is declared here
+// so that the bindings do not depend on the header or a device runtime
+enum DLDeviceType
+{
+  kDLCPU = 1,
+  kDLCUDA = 2,
+  kDLROCM = 10
+};
+
+enum DLDataTypeCode
+{
+  kDLInt = 0,
+  kDLUInt = 1,
+  kDLFloat = 2
+};
+
+struct DLDevice
+{
+  int device_type;
+  int32_t device_id;
+};
+
+struct DLDataType
+{
+  uint8_t code;
+  uint8_t bits;
+  uint16_t lanes;
+};
+
+struct DLTensor
+{
+  void *data;
+  DLDevice device;
+  int32_t ndim;
+  DLDataType dtype;
+  int64_t *shape;
+  int64_t *strides;
+  uint64_t byte_offset;
+};
+
+struct DLManagedTensor
+{
+  DLTensor dl_tensor;
+  void *manager_ctx;
+  void (*deleter)(DLManagedTensor *self);
+};
+
+// a tensor and the storage for its shape
+struct ManagedTensor
+{
+  DLManagedTensor Tensor;
+  int64_t Shape[2];
+};
+
+// ****************************************************************************
+static void DeleteManagedTensor(DLManagedTensor *self)
+{
+  delete static_cast<ManagedTensor*>(self->manager_ctx);
+}
+
+// ****************************************************************************
+// a consumer renames the capsule to "used_dltensor" and becomes responsible
+// for calling the deleter, otherwise it was never consumed and we call it
+static void ReleaseDLPackCapsule(PyObject *capsule)
+{
+  if (PyCapsule_IsValid(capsule, "dltensor"))
+    {
+    DLManagedTensor *tensor = static_cast<DLManagedTensor*>(
+      PyCapsule_GetPointer(capsule, "dltensor"));
+    tensor->deleter(tensor);
+    }
+}
+
+// ****************************************************************************
+// get the kind ('f', 'i', or 'u') and the size in bytes of a VTK type.
+// returns zero if successful
+static int GetTypeInfo(int vtkType, char &kind, int &size)
+{
+  switch (vtkType)
+    {
+    vtkTemplateMacro(
+      kind = std::is_floating_point<VTK_TT>::value ? 'f' :
+        std::is_signed<VTK_TT>::value ? 'i' : 'u';
+      size = sizeof(VTK_TT);
+      return 0;
+      );
+    }
+  return -1;
+}
+
+// ****************************************************************************
+// get the shape of the array, (nTuples,) when there is one component
+static PyObject *NewShape(const sensei::DeviceArray &da)
+{
+  if (da.NumComponents > 1)
+    return Py_BuildValue("(li)", da.NumTuples, da.NumComponents);
+  return Py_BuildValue("(l)", da.NumTuples);
+}
+
+/// NewCudaArrayInterface -- describe a CUDA array to Numba and CuPy
+/**
+Returns a dict following version 3 of the __cuda_array_interface__
+protocol, without copying. Arrays with a single component are 1D, others
+have a row per tuple. A TypeError is raised for arrays that are not in
+CUDA memory.
+*/
+static PyObject *NewCudaArrayInterface(const sensei::DeviceArray &da)
+{
+  if (da.MemorySpace != sensei::MEMORY_SPACE_CUDA)
+    {
+    PyErr_Format(PyExc_TypeError, "__cuda_array_interface__ is not"
+      " available for arrays in %s memory",
+      sensei::GetMemorySpaceName(da.MemorySpace));
+    return nullptr;
+    }
+
+  char kind = 0;
+  int size = 0;
+  if (GetTypeInfo(da.DataType, kind, size))
+    {
+    PyErr_Format(PyExc_TypeError, "Unsupported data type %d", da.DataType);
+    return nullptr;
+    }
+
+  char typestr[8] = {0};
+  snprintf(typestr, sizeof(typestr), "<%c%d", kind, size);
+
+  // the values are owned by the simulation and are not read only
+  return Py_BuildValue("{s:N,s:s,s:(NO),s:O,s:i}",
+    "shape", NewShape(da), "typestr", typestr,
+    "data", PyLong_FromVoidPtr(da.Data), Py_False,
+    "strides", Py_None, "version", 3);
+}
+
+/// NewDLPackDevice -- the device tuple of the DLPack protocol
+/**
+Returns (device type, device id) as __dlpack_device__ does.
+*/
+static PyObject *NewDLPackDevice(const sensei::DeviceArray &da)
+{
+  int type = da.MemorySpace == sensei::MEMORY_SPACE_CUDA ? kDLCUDA :
+    da.MemorySpace == sensei::MEMORY_SPACE_HIP ? kDLROCM : kDLCPU;
+
+  return Py_BuildValue("(ii)", type, da.DeviceId);
+}
+
+/// NewDLPackCapsule -- expose an array to DLPack consumers without copying
+/**
+Returns a "dltensor" capsule as __dlpack__ does. Each capsule may be
+consumed once, for instance by cupy.from_dlpack or torch.from_dlpack. The
+memory is owned by the simulation, like the array itself the tensor is
+only valid until the data adaptor's ReleaseData is called.
+*/
+static PyObject *NewDLPackCapsule(const sensei::DeviceArray &da)
+{
+  char kind = 0;
+  int size = 0;
+  if (GetTypeInfo(da.DataType, kind, size))
+    {
+    PyErr_Format(PyExc_TypeError, "Unsupported data type %d", da.DataType);
+    return nullptr;
+    }
+
+  ManagedTensor *mt = new ManagedTensor;
+  mt->Shape[0] = da.NumTuples;
+  mt->Shape[1] = da.NumComponents;
+
+  DLTensor &t = mt->Tensor.dl_tensor;
+  t.data = da.Data;
+  t.device.device_type = da.MemorySpace == sensei::MEMORY_SPACE_CUDA ? kDLCUDA :
+    da.MemorySpace == sensei::MEMORY_SPACE_HIP ? kDLROCM : kDLCPU;
+  t.device.device_id = da.DeviceId;
+  t.ndim = da.NumComponents > 1 ? 2 : 1;
+  t.dtype.code = kind == 'f' ? kDLFloat : kind == 'i' ? kDLInt : kDLUInt;
+  t.dtype.bits = 8*size;
+  t.dtype.lanes = 1;
+  t.shape = mt->Shape;
+  t.strides = nullptr; // compact, row major
+  t.byte_offset = 0;
+
+  mt->Tensor.manager_ctx = mt;
+  mt->Tensor.deleter = DeleteManagedTensor;
+
+  PyObject *capsule = PyCapsule_New(&mt->Tensor, "dltensor",
+    ReleaseDLPackCapsule);
+  if (!capsule)
+    {
+    delete mt;
+    return nullptr;
+    }
+
+  return capsule;
+}
+
+}
+
+#endif
@@ -22,4 +22,26 @@ private:
     PyGILState_STATE m_state;
 };
 
+// RAII helper for releasing the Python GIL
+// The class releases the GIL during construction
+// and re-aquires it during destruction. Use it around
+// calls into C++ that do not touch Python objects,
+// such as fetching data or MPI collectives, so that
+// other threads may run Python code meanwhile.
+class senseiPyThreadState
+{
+public:
+    senseiPyThreadState()
+    { m_state = PyEval_SaveThread(); }
+
+    ~senseiPyThreadState()
+    { PyEval_RestoreThread(m_state); }
+
+    senseiPyThreadState(const senseiPyThreadState&) = delete;
+    void operator=(const senseiPyThreadState&) = delete;
+
+private:
+    PyThreadState *m_state;
+};
+
 #endif
@@ -17,6 +17,7 @@
 #include "MeshMetadata.h"
 #include "VTKUtils.h"
 #include "Profiler.h"
+#include "ParticleIndex.h"
 #include <sstream>
 %}
 
@@ -134,6 +135,12 @@ SENSEI_DATA_ADAPTOR(VTKDataAdaptor)
       senseiPyDataAdaptor::PyAddArrayCallback(f));
   }
 
+  void SetAddArraysCallback(PyObject *f)
+  {
+    self->SetAddArraysCallback(
+      senseiPyDataAdaptor::PyAddArraysCallback(f));
+  }
+
   void SetReleaseDataCallback(PyObject *f)
   {
     self->SetReleaseDataCallback(
@@ -144,6 +151,7 @@ SENSEI_DATA_ADAPTOR(VTKDataAdaptor)
 %ignore sensei::ProgrammableDataAdaptor::SetGetMeshMetadataCallback;
 %ignore sensei::ProgrammableDataAdaptor::SetGetMeshCallback;
 %ignore sensei::ProgrammableDataAdaptor::SetAddArrayCallback;
+%ignore sensei::ProgrammableDataAdaptor::SetAddArraysCallback;
 %ignore sensei::ProgrammableDataAdaptor::SetReleaseDataCallback;
 SENSEI_DATA_ADAPTOR(ProgrammableDataAdaptor)
 
@@ -185,6 +193,60 @@ VTK_DERIVED(ConfigurableAnalysis)
 %ignore sensei::Histogram::GetHistogram;
 VTK_DERIVED(Histogram)
 
+/****************************************************************************
+ * ParticleIndex
+ ***************************************************************************/
+%extend sensei::ParticleIndex
+{
+  /* return the results in lists rather than through references */
+  PyObject *RadiusQuery(double x, double y, double z, double r)
+  {
+    double pt[3] = {x, y, z};
+    std::vector<long> ids;
+    if (self->RadiusQuery(pt, r, ids))
+      {
+      PyErr_Format(PyExc_RuntimeError,
+        "Failed to query the particle index");
+      return nullptr;
+      }
+    return senseiPySequence::NewList<long>(ids);
+  }
+
+  PyObject *CountNeighbors(double r, int nThreads = 1)
+  {
+    std::vector<long> counts;
+    if (self->CountNeighbors(r, counts, nThreads))
+      {
+      PyErr_Format(PyExc_RuntimeError,
+        "Failed to count the neighbors");
+      return nullptr;
+      }
+    return senseiPySequence::NewList<long>(counts);
+  }
+
+  PyObject *GetPoints()
+  {
+    return senseiPySequence::NewList<double>(self->GetPoints());
+  }
+
+  PyObject *GetSourceRanks()
+  {
+    return senseiPySequence::NewList<int>(self->GetSourceRanks());
+  }
+
+  PyObject *GetSourceIds()
+  {
+    return senseiPySequence::NewList<long long>(self->GetSourceIds());
+  }
+}
+%ignore sensei::ParticleIndex::RadiusQuery;
+%ignore sensei::ParticleIndex::CountNeighbors;
+%ignore sensei::ParticleIndex::GetPoints;
+%ignore sensei::ParticleIndex::GetSourceRanks;
+%ignore sensei::ParticleIndex::GetSourceIds;
+%ignore sensei::ParticleIndex::GetBounds;
+%include "ParticleIndex.h"
+
 /****************************************************************************
  * Autocorrelation
  ***************************************************************************/
@@ -109,9 +109,10 @@ bool ADIOS1AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
 
   while (mit)
     {
-    // get metadata
+    // get metadata. everything we do from here on out depends on
+    // having the global view.
     MeshMetadataPtr md;
-    if (mdm.GetMeshMetadata(mit.MeshName(), md))
+    if (mdm.GetGlobalMeshMetadata(mit.MeshName(), md))
       {
       SENSEI_ERROR("Failed to get mesh metadata for mesh \""
         << mit.MeshName() << "\"")
@@ -145,25 +146,22 @@ bool ADIOS1AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
     ArrayRequirementsIterator ait =
       this->Requirements.GetArrayRequirementsIterator(mit.MeshName());
 
+    ait.SetMode(ArrayRequirementsIterator::MODE_ASSOCIATION);
+
     while (ait)
       {
-      if (dataAdaptor->AddArray(dobj, mit.MeshName(),
-         ait.Association(), ait.Array()))
+      if (dataAdaptor->AddArrays(dobj, mit.MeshName(),
+         ait.Association(), ait.Arrays()))
         {
         SENSEI_ERROR("Failed to add "
           << VTKUtils::GetAttributesName(ait.Association())
-          << " data array \"" << ait.Array() << "\" to mesh \""
-          << mit.MeshName() << "\"")
+          << " data arrays to mesh \"" << mit.MeshName() << "\"")
         return false;
         }
 
       ++ait;
       }
 
-    // generate a global view of the metadata. everything we do from here
-    // on out depends on having the global view.
-    md->GlobalizeView(this->GetCommunicator());
-
     // add to the collection
     objects.push_back(dobj);
     metadata.push_back(md);
@@ -103,6 +103,10 @@ int ADIOS1DataAdaptor::OpenStream()
 {
   TimeEvent<128> mark("ADIOS1DataAdaptor::OpenStream");
 
+  if (this->GetStepPolicy() == STEP_POLICY_LATEST)
+    SENSEI_WARNING("The latest step policy is not supported by ADIOS1."
+      " Every step will be processed")
+
   if (this->Internals->Stream.Open(this->GetCommunicator()))
     {
     SENSEI_ERROR("Failed to open stream")
@@ -113,6 +117,8 @@ int ADIOS1DataAdaptor::OpenStream()
   if (this->UpdateTimeStep())
     return -1;
 
+  this->CountSteps(1, 0);
+
   return 0;
 }
 
@@ -137,12 +143,19 @@ int ADIOS1DataAdaptor::AdvanceStream()
 {
   TimeEvent<128> mark("ADIOS1DataAdaptor::AdvanceStream");
 
-  if (this->Internals->Stream.AdvanceTimeStep())
-    return -1;
+  // move past the steps skipped by the step policy
+  unsigned int stride = this->GetStepStride();
+  for (unsigned int i = 0; i < stride; ++i)
+    {
+    if (this->Internals->Stream.AdvanceTimeStep())
+      return -1;
+    }
 
   if (this->UpdateTimeStep())
     return -1;
 
+  this->CountSteps(1, stride - 1);
+
   return 0;
 }
 
@@ -226,7 +239,7 @@ int ADIOS1DataAdaptor::GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadat
 
     // we did this already, return cached layout
     if (metadata)
-       return 0;
+      return this->ApplyDataRequirements(metadata);
 
     // first time through. use the partitioner to figure it out.
     // get the sender layout.
@@ -253,12 +266,21 @@ int ADIOS1DataAdaptor::GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadat
       this->CloseStream();
       }
 
+    // leave the AMR levels the analyses do not need on the sender
+    if (this->ApplyLevelRequirements(receiverMd))
+      {
+      SENSEI_ERROR("Failed to select the required levels")
+      this->CloseStream();
+      return -1;
+      }
+
     // cache and return the new layout
     this->Internals->Schema.SetReceiverMeshMetadata(id, receiverMd);
     metadata = receiverMd;
     }
 
-  return 0;
+  // pass only the arrays the analyses require
+  return this->ApplyDataRequirements(metadata);
 }
 
 //----------------------------------------------------------------------------
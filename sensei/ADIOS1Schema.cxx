@@ -6,6 +6,7 @@
 #include "MPIUtils.h"
 #include "Error.h"
 #include "Profiler.h"
+#include "BlockReadPlan.h"
 
 #include <vtkCellTypes.h>
 #include <vtkCellData.h>
@@ -51,6 +52,9 @@
 
 #include <vector>
 #include <map>
+#include <memory>
+#include <list>
+#include <array>
 #include <set>
 #include <string>
 #include <functional>
@@ -575,6 +579,117 @@ int InputStream::Close()
 
 
 
+// --------------------------------------------------------------------------
+// collects the reads made for a mesh or an array so that they are issued
+// with a single adios_perform_reads, rather than one per block and variable.
+// a BlockReadPlan merges the reads of adjacent ranges of the same variable,
+// such as those of a rank's consecutive blocks. work that needs the values
+// read is deferred until the reads complete.
+class ReadBatch
+{
+public:
+  // schedule the read of count elements of elemSize bytes of the 1D
+  // variable at path, starting at start, into dest. dest must remain valid
+  // until Perform returns
+  void Add(const std::string &path, uint64_t start, uint64_t count,
+    size_t elemSize, void *dest);
+
+  // add work to run, in the order added, once the reads have completed
+  void Defer(const std::function<int()> &func);
+
+  // perform the reads then the deferred work
+  int Perform(ADIOS_FILE *fh);
+
+private:
+  std::map<std::string, int> VarIds;
+  std::vector<std::string> Vars;
+  sensei::BlockReadPlan Plan;
+  std::vector<void*> Dests;
+  std::vector<std::function<int()>> Deferred;
+};
+
+// --------------------------------------------------------------------------
+void ReadBatch::Add(const std::string &path, uint64_t start, uint64_t count,
+  size_t elemSize, void *dest)
+{
+  if (!count)
+    return;
+
+  auto it = this->VarIds.find(path);
+  if (it == this->VarIds.end())
+    {
+    it = this->VarIds.insert(std::make_pair(path, int(this->Vars.size()))).first;
+    this->Vars.push_back(path);
+    }
+
+  this->Plan.Add(it->second, start, count, elemSize);
+  this->Dests.push_back(dest);
+}
+
+// --------------------------------------------------------------------------
+void ReadBatch::Defer(const std::function<int()> &func)
+{
+  this->Deferred.push_back(func);
+}
+
+// --------------------------------------------------------------------------
+int ReadBatch::Perform(ADIOS_FILE *fh)
+{
+  sensei::TimeEvent<128> mark("senseiADIOS1::ReadBatch::Perform");
+
+  // the selections, and the start and count they were made from, live
+  // until the reads complete
+  std::list<std::array<uint64_t,2>> ranges;
+  std::vector<ADIOS_SELECTION*> sels;
+
+  int ierr = this->Plan.Execute(this->Dests,
+    [&](int var, unsigned long long start, unsigned long long count,
+      void *dest) -> int
+    {
+    ranges.push_back({{start, count}});
+    std::array<uint64_t,2> &range = ranges.back();
+
+    ADIOS_SELECTION *sel = adios_selection_boundingbox(1, &range[0], &range[1]);
+    sels.push_back(sel);
+
+    return adios_schedule_read(fh, sel, this->Vars[var].c_str(), 0, 1, dest);
+    },
+    [&]() -> int
+    {
+    if (sels.empty())
+      return 0;
+    return adios_perform_reads(fh, 1);
+    });
+
+  size_t nSels = sels.size();
+  for (size_t i = 0; i < nSels; ++i)
+    adios_selection_delete(sels[i]);
+
+  this->Plan.Clear();
+  this->Dests.clear();
+
+  if (ierr)
+    {
+    SENSEI_ERROR("Failed to read " << this->Vars.size() << " variables")
+    this->Deferred.clear();
+    return -1;
+    }
+
+  // finish off the objects that need the values
+  size_t nDeferred = this->Deferred.size();
+  for (size_t i = 0; i < nDeferred; ++i)
+    {
+    if (this->Deferred[i]())
+      ierr = -1;
+    }
+
+  this->Deferred.clear();
+
+  return ierr;
+}
+
+
+
 struct ArraySchema
 {
   int DefineVariables(MPI_Comm comm, int64_t gh,
@@ -595,11 +710,11 @@ struct ArraySchema
     unsigned int num_blocks, const std::vector<int> &block_owner,
     const std::vector<int64_t> &writeIds);
 
-  int Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
+  int Read(MPI_Comm comm, ReadBatch &batch, const std::string &ons,
     const std::string &array_name, int centering,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
-  int Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
+  int Read(MPI_Comm comm, ReadBatch &batch, const std::string &ons,
     unsigned int i, const std::string &array_name, int array_type,
     unsigned long long num_components, int array_cen, unsigned int num_blocks,
     const std::vector<long> &block_num_points,
@@ -828,7 +943,7 @@ int ArraySchema::Write(MPI_Comm comm, int64_t fh,
 }
 
 // --------------------------------------------------------------------------
-int ArraySchema::Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
+int ArraySchema::Read(MPI_Comm comm, ReadBatch &batch, const std::string &ons,
   unsigned int i, const std::string &array_name, int array_type,
   unsigned long long num_components, int array_cen, unsigned int num_blocks,
   const std::vector<long> &block_num_points,
@@ -845,6 +960,9 @@ int ArraySchema::Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
   std::ostringstream ans;
   ans << ons << "data_array_" << i << "/";
 
+  // /data_object_<id>/data_array_<id>/data
+  std::string path = ans.str() + "data";
+
   vtkCompositeDataIterator *it = dobj->NewIterator();
   it->SetSkipEmptyNodes(0);
   it->InitTraversal();
@@ -854,42 +972,32 @@ int ArraySchema::Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
   for (unsigned int j = 0; j < num_blocks; ++j)
     {
     // get the block size
-    unsigned long long num_elem_local = (array_cen == vtkDataObject::POINT ?
-      block_num_points[j] : block_num_cells[j])*num_components;
+    unsigned long long num_tuples_local = (array_cen == vtkDataObject::POINT ?
+      block_num_points[j] : block_num_cells[j]);
+
+    unsigned long long num_elem_local = num_tuples_local*num_components;
 
     // define the variable for a local block
     if (block_owner[j] ==  rank)
       {
-      uint64_t start = block_offset;
-      uint64_t count = num_elem_local;;
-      ADIOS_SELECTION *sel = adios_selection_boundingbox(1, &start, &count);
-
-      vtkDataArray *array = vtkDataArray::CreateDataArray(array_type);
-      array->SetNumberOfComponents(num_components);
-      array->SetNumberOfTuples(num_elem_local);
-      array->SetName(array_name.c_str());
-
-      // /data_object_<id>/data_array_<id>/data
-      std::string path = ans.str() + "data";
-      adios_schedule_read(fh, sel, path.c_str(),
-        0, 1, array->GetVoidPointer(0));
-
-      if (adios_perform_reads(fh, 1))
-        {
-        SENSEI_ERROR("Failed to read points")
-        return -1;
-        }
-
-      adios_selection_delete(sel);
-
-      // pass to vtk
       vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
       if (!ds)
         {
         SENSEI_ERROR("Failed to get block " << j)
+        it->Delete();
         return -1;
         }
 
+      vtkDataArray *array = vtkDataArray::CreateDataArray(array_type);
+      array->SetNumberOfComponents(num_components);
+      array->SetNumberOfTuples(num_tuples_local);
+      array->SetName(array_name.c_str());
+
+      // the values arrive when the batch is performed
+      batch.Add(path, block_offset, num_elem_local,
+        sensei::VTKUtils::Size(array_type), array->GetVoidPointer(0));
+
+      // pass to vtk
       vtkDataSetAttributes *dsa = array_cen == vtkDataObject::POINT ?
         dynamic_cast<vtkDataSetAttributes*>(ds->GetPointData()) :
         dynamic_cast<vtkDataSetAttributes*>(ds->GetCellData());
@@ -914,7 +1022,7 @@ int ArraySchema::Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
 }
 
 // --------------------------------------------------------------------------
-int ArraySchema::Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
+int ArraySchema::Read(MPI_Comm comm, ReadBatch &batch, const std::string &ons,
   const std::string &name, int centering, const sensei::MeshMetadataPtr &md,
   vtkCompositeDataSet *dobj)
 {
@@ -929,7 +1037,7 @@ int ArraySchema::Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
     unsigned int i = centering == vtkDataObject::CELL ?
       num_arrays : num_arrays + 1;
 
-    return this->Read(comm, fh, ons, i, "vtkGhostType", VTK_UNSIGNED_CHAR,
+    return this->Read(comm, batch, ons, i, "vtkGhostType", VTK_UNSIGNED_CHAR,
       1, centering, num_blocks, md->BlockNumPoints, md->BlockNumCells,
       md->BlockOwner, dobj);
     }
@@ -944,7 +1052,7 @@ int ArraySchema::Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
     if ((centering != array_cen) || (name != array_name))
       continue;
 
-    return this->Read(comm, fh, ons, i, array_name, md->ArrayType[i],
+    return this->Read(comm, batch, ons, i, array_name, md->ArrayType[i],
       md->ArrayComponents[i], array_cen, num_blocks, md->BlockNumPoints,
       md->BlockNumCells, md->BlockOwner, dobj);
     }
@@ -961,7 +1069,7 @@ struct PointSchema
   int Write(MPI_Comm comm, int64_t fh,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
-  int Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
+  int Read(MPI_Comm comm, ReadBatch &batch, const std::string &ons,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
   std::map<std::string, std::vector<int64_t>> WriteIds;
@@ -1083,7 +1191,7 @@ int PointSchema::Write(MPI_Comm comm, int64_t fh,
 }
 
 // --------------------------------------------------------------------------
-int PointSchema::Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
+int PointSchema::Read(MPI_Comm comm, ReadBatch &batch, const std::string &ons,
   const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj)
 {
   if (sensei::VTKUtils::Unstructured(md) || sensei::VTKUtils::Structured(md)
@@ -1095,6 +1203,9 @@ int PointSchema::Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
+    std::string path = ons + "points";
+    size_t elem_size = sensei::VTKUtils::Size(md->CoordinateType);
+
     vtkCompositeDataIterator *it = dobj->NewIterator();
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
@@ -1110,43 +1221,34 @@ int PointSchema::Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
       // read local block
       if (md->BlockOwner[j] ==  rank)
         {
+        vtkPointSet *ds = dynamic_cast<vtkPointSet*>(it->GetCurrentDataObject());
+        if (!ds)
+          {
+          SENSEI_ERROR("Failed to get block " << j)
+          it->Delete();
+          return -1;
+          }
+
         uint64_t start = 3*block_offset;
-        uint64_t count = 3*num_local;;
-        ADIOS_SELECTION *sel = adios_selection_boundingbox(1, &start, &count);
+        uint64_t count = 3*num_local;
 
         vtkDataArray *points = vtkDataArray::CreateDataArray(md->CoordinateType);
         points->SetNumberOfComponents(3);
         points->SetNumberOfTuples(num_local);
         points->SetName("points");
 
-        std::string path = ons + "points";
-        adios_schedule_read(fh, sel, path.c_str(),
-          0, 1, points->GetVoidPointer(0));
-
-        if (adios_perform_reads(fh, 1))
-          {
-          SENSEI_ERROR("Failed to read points")
-          return -1;
-          }
-
-        adios_selection_delete(sel);
+        // the values arrive when the batch is performed
+        batch.Add(path, start, count, elem_size, points->GetVoidPointer(0));
 
         // pass into vtk
         vtkPoints *pts = vtkPoints::New();
         pts->SetData(points);
         points->Delete();
 
-        vtkPointSet *ds = dynamic_cast<vtkPointSet*>(it->GetCurrentDataObject());
-        if (!ds)
-          {
-          SENSEI_ERROR("Failed to get block " << j)
-          return -1;
-          }
-
         ds->SetPoints(pts);
         pts->Delete();
 
-        numBytes += count*sensei::VTKUtils::Size(md->CoordinateType);
+        numBytes += count*elem_size;
         }
 
       // update the block offset
@@ -1174,7 +1276,7 @@ struct UnstructuredCellSchema
   int Write(MPI_Comm comm, int64_t fh,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
-  int Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
+  int Read(MPI_Comm comm, ReadBatch &batch, const std::string &ons,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
   std::map<std::string, std::vector<int64_t>> TypeWriteIds;
@@ -1331,7 +1433,7 @@ int UnstructuredCellSchema::Write(MPI_Comm comm, int64_t fh,
 }
 
 // --------------------------------------------------------------------------
-int UnstructuredCellSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
+int UnstructuredCellSchema::Read(MPI_Comm comm, ReadBatch &batch,
   const std::string &ons, const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj)
 {
   if (sensei::VTKUtils::Unstructured(md))
@@ -1342,6 +1444,12 @@ int UnstructuredCellSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
+    // /data_object_<id>/cell_types
+    std::string ct_path = ons + "cell_types";
+
+    // /data_object_<id>/cell_array
+    std::string ca_path = ons + "cell_array";
+
     vtkCompositeDataIterator *it = dobj->NewIterator();
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
@@ -1360,85 +1468,71 @@ int UnstructuredCellSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
       // define the variable for a local block
       if (md->BlockOwner[j] ==  rank)
         {
-        // /data_object_<id>/cell_types
-        uint64_t ct_start = cell_types_block_offset;
-        uint64_t ct_count = num_cells_local;;
-        ADIOS_SELECTION *ct_sel = adios_selection_boundingbox(1, &ct_start, &ct_count);
-
-        vtkUnsignedCharArray *cell_types = vtkUnsignedCharArray::New();
-        cell_types->SetNumberOfComponents(1);
-        cell_types->SetNumberOfTuples(num_cells_local);
-        cell_types->SetName("cell_types");
-
-        std::string ct_path = ons + "cell_types";
-        adios_schedule_read(fh, ct_sel, ct_path.c_str(),
-          0, 1, cell_types->GetVoidPointer(0));
-
-        if (adios_perform_reads(fh, 1))
+        vtkUnstructuredGrid *ds =
+          dynamic_cast<vtkUnstructuredGrid*>(it->GetCurrentDataObject());
+        if (!ds)
           {
-          SENSEI_ERROR("Failed to read cell types")
+          SENSEI_ERROR("Failed to get block " << j)
+          it->Delete();
           return -1;
           }
 
-        adios_selection_delete(ct_sel);
+        vtkSmartPointer<vtkUnsignedCharArray> cell_types =
+          vtkSmartPointer<vtkUnsignedCharArray>::New();
+        cell_types->SetNumberOfComponents(1);
+        cell_types->SetNumberOfTuples(num_cells_local);
+        cell_types->SetName("cell_types");
 
-        // /data_object_<id>/cell_array
-        uint64_t ca_start = cell_array_block_offset;
-        uint64_t ca_count = cell_array_size_local;;
-        ADIOS_SELECTION *ca_sel = adios_selection_boundingbox(1, &ca_start, &ca_count);
+        batch.Add(ct_path, cell_types_block_offset, num_cells_local,
+          sizeof(unsigned char), cell_types->GetVoidPointer(0));
 
-        vtkIdTypeArray *cell_array = vtkIdTypeArray::New();
+        vtkSmartPointer<vtkIdTypeArray> cell_array =
+          vtkSmartPointer<vtkIdTypeArray>::New();
         cell_array->SetNumberOfComponents(1);
         cell_array->SetNumberOfTuples(cell_array_size_local);
         cell_array->SetName("cell_array");
 
-        std::string ca_path = ons + "cell_array";
-        adios_schedule_read(fh, ca_sel, ca_path.c_str(),
-          0, 1, cell_array->GetVoidPointer(0));
-
-        if (adios_perform_reads(fh, 1))
-          {
-          SENSEI_ERROR("Failed to read cell_types")
-          return -1;
-          }
-
-        adios_selection_delete(ca_sel);
+        batch.Add(ca_path, cell_array_block_offset, cell_array_size_local,
+          sizeof(vtkIdType), cell_array->GetVoidPointer(0));
 
-        vtkUnstructuredGrid *ds =
-          dynamic_cast<vtkUnstructuredGrid*>(it->GetCurrentDataObject());
-        if (!ds)
+        // the cells are passed to vtk once they have been read
+        batch.Defer([ds, cell_types, cell_array, num_cells_local]() -> int
           {
-          SENSEI_ERROR("Failed to get block " << j)
-          return -1;
-          }
-        // build locations
-        vtkIdTypeArray *cell_locs = vtkIdTypeArray::New();
-        cell_locs->SetNumberOfTuples(num_cells_local);
-        vtkIdType *p_locs = cell_locs->GetPointer(0);
-        vtkIdType *p_cells = cell_array->GetPointer(0);
-        p_locs[0] = 0;
-        for (unsigned long i = 1; i < num_cells_local; ++i)
-          p_locs[i] = p_locs[i-1] + p_cells[p_locs[i-1]] + 1;
-
-        // pass types, cell_locs, and cells
-        vtkCellArray *ca = vtkCellArray::New();
-        ca->SetCells(num_cells_local, cell_array);
-        cell_array->Delete();
-
-        ds->SetCells(cell_types, cell_locs, ca);
-
-        cell_locs->Delete();
-        cell_array->Delete();
-        cell_types->Delete();
-
-        numBytes += ct_count*sizeof(unsigned char) + ca_count*sizeof(vtkIdType);
+          // build locations
+          vtkIdTypeArray *cell_locs = vtkIdTypeArray::New();
+          cell_locs->SetNumberOfTuples(num_cells_local);
+          vtkIdType *p_locs = cell_locs->GetPointer(0);
+          vtkIdType *p_cells = cell_array->GetPointer(0);
+          if (num_cells_local)
+            p_locs[0] = 0;
+          for (unsigned long i = 1; i < num_cells_local; ++i)
+            p_locs[i] = p_locs[i-1] + p_cells[p_locs[i-1]] + 1;
+
+          // pass types, cell_locs, and cells
+          vtkCellArray *ca = vtkCellArray::New();
+          ca->SetCells(num_cells_local, cell_array);
+
+          ds->SetCells(cell_types, cell_locs, ca);
+
+          ca->Delete();
+          cell_locs->Delete();
+          return 0;
+          });
+
+        numBytes += num_cells_local*sizeof(unsigned char) +
+          cell_array_size_local*sizeof(vtkIdType);
         }
 
       // update the block offset
       cell_types_block_offset += num_cells_local;
       cell_array_block_offset += cell_array_size_local;
+
+      // next block
+      it->GoToNextItem();
       }
 
+    it->Delete();
+
     sensei::Profiler::EndEvent("senseiADIOS1::UnstructuredCellSchema::Read", numBytes);
     }
 
@@ -1455,7 +1549,7 @@ struct PolydataCellSchema
   int Write(MPI_Comm comm, int64_t fh,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
-  int Read(MPI_Comm comm, ADIOS_FILE *fh,
+  int Read(MPI_Comm comm, ReadBatch &batch,
     const std::string &ons, const sensei::MeshMetadataPtr &md,
     vtkCompositeDataSet *dobj);
 
@@ -1648,7 +1742,7 @@ int PolydataCellSchema::Write(MPI_Comm comm, int64_t fh,
 }
 
 // --------------------------------------------------------------------------
-int PolydataCellSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
+int PolydataCellSchema::Read(MPI_Comm comm, ReadBatch &batch,
   const std::string &ons, const sensei::MeshMetadataPtr &md,
   vtkCompositeDataSet *dobj)
 {
@@ -1660,6 +1754,12 @@ int PolydataCellSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
+    // /data_object_<id>/cell_types
+    std::string ct_path = ons + "cell_types";
+
+    // /data_object_<id>/cell_array
+    std::string ca_path = ons + "cell_array";
+
     vtkCompositeDataIterator *it = dobj->NewIterator();
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
@@ -1677,169 +1777,151 @@ int PolydataCellSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
 
       if (md->BlockOwner[j] == rank)
         {
-        std::vector<vtkIdType> cell_array(cell_array_size_local);
-        std::vector<unsigned char> cell_types(num_cells_local);
-
-        uint64_t ct_start = cell_block_offset;
-        uint64_t ct_count = num_cells_local;;
-        ADIOS_SELECTION *ct_sel = adios_selection_boundingbox(1, &ct_start, &ct_count);
-
-        // /data_object_<id>/cell_types
-        std::string ct_path = ons + "cell_types";
-        adios_schedule_read(fh, ct_sel, ct_path.c_str(),
-          0, 1, cell_types.data());
-
-        if (adios_perform_reads(fh, 1))
-          {
-          SENSEI_ERROR("Failed to read cell types")
-          return -1;
-          }
-
-        adios_selection_delete(ct_sel);
-
-        uint64_t ca_start = cell_array_block_offset;
-        uint64_t ca_count = cell_array_size_local;;
-        ADIOS_SELECTION *ca_sel = adios_selection_boundingbox(1, &ca_start, &ca_count);
-
-        // /data_object_<id>/cell_array
-        std::string ca_path = ons + "cell_array";
-        adios_schedule_read(fh, ca_sel, ca_path.c_str(),
-          0, 1, cell_array.data());
-
-        if (adios_perform_reads(fh, 1))
-          {
-          SENSEI_ERROR("Failed to read cell_types")
-          return -1;
-          }
-
-        adios_selection_delete(ca_sel);
-
-        unsigned char *p_types = cell_types.data();
-        vtkIdType *p_cells = cell_array.data();
-
-        // assumptions made here:
-        // data is serialized in the order verts, lines, polys, strips
-
-        // find first and last vert and number of verts
-        unsigned long i = 0;
-        unsigned long n_verts = 0;
-        vtkIdType *vert_begin = p_cells;
-        while ((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
-          {
-          p_cells += p_cells[0] + 1;
-          ++n_verts;
-          ++i;
-          }
-        vtkIdType *vert_end = p_cells;
-
-        // find first and last line and number of lines
-        unsigned long n_lines = 0;
-        vtkIdType *line_begin = p_cells;
-        while ((i < num_cells_local) && (p_types[i] == VTK_LINE))
-          {
-          p_cells += p_cells[0] + 1;
-          ++n_lines;
-          ++i;
-          }
-        vtkIdType *line_end = p_cells;
-
-        // find first and last poly and number of polys
-        unsigned long n_polys = 0;
-        vtkIdType *poly_begin = p_cells;
-        while ((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
-          {
-          p_cells += p_cells[0] + 1;
-          ++n_polys;
-          ++i;
-          }
-        vtkIdType *poly_end = p_cells;
-
-        // find first and last strip and number of strips
-        unsigned long n_strips = 0;
-        vtkIdType *strip_begin = p_cells;
-        while ((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
-          {
-          p_cells += p_cells[0] + 1;
-          ++n_strips;
-          ++i;
-          }
-        vtkIdType *strip_end = p_cells;
-
-        // pass into vtk
         vtkPolyData *pd = dynamic_cast<vtkPolyData*>(it->GetCurrentDataObject());
         if (!pd)
           {
           SENSEI_ERROR("Failed to get block " << j)
+          it->Delete();
           return -1;
           }
 
-        // pass verts
-        unsigned long n_tups = vert_end - vert_begin;
-        vtkIdTypeArray *verts = vtkIdTypeArray::New();
-        verts->SetNumberOfTuples(n_tups);
-        vtkIdType *p_verts = verts->GetPointer(0);
-
-        for (unsigned long j = 0; j < n_tups; ++j)
-          p_verts[j] = vert_begin[j];
-
-        vtkCellArray *ca = vtkCellArray::New();
-        ca->SetCells(n_verts, verts);
-        verts->Delete();
-
-        pd->SetVerts(ca);
-        ca->Delete();
-
-        // pass lines
-        n_tups = line_end - line_begin;
-        vtkIdTypeArray *lines = vtkIdTypeArray::New();
-        lines->SetNumberOfTuples(n_tups);
-        vtkIdType *p_lines = lines->GetPointer(0);
-
-        for (unsigned long j = 0; j < n_tups; ++j)
-          p_lines[j] = line_begin[j];
-
-        ca = vtkCellArray::New();
-        ca->SetCells(n_lines, lines);
-        lines->Delete();
-
-        pd->SetLines(ca);
-        ca->Delete();
+        std::shared_ptr<std::vector<vtkIdType>> cell_array =
+          std::make_shared<std::vector<vtkIdType>>(cell_array_size_local);
 
-        // pass polys
-        n_tups = poly_end - poly_begin;
-        vtkIdTypeArray *polys = vtkIdTypeArray::New();
-        polys->SetNumberOfTuples(n_tups);
-        vtkIdType *p_polys = polys->GetPointer(0);
+        std::shared_ptr<std::vector<unsigned char>> cell_types =
+          std::make_shared<std::vector<unsigned char>>(num_cells_local);
 
-        for (unsigned long j = 0; j < n_tups; ++j)
-          p_polys[j] = poly_begin[j];
+        batch.Add(ct_path, cell_block_offset, num_cells_local,
+          sizeof(unsigned char), cell_types->data());
 
-        ca = vtkCellArray::New();
-        ca->SetCells(n_polys, polys);
-        polys->Delete();
+        batch.Add(ca_path, cell_array_block_offset, cell_array_size_local,
+          sizeof(vtkIdType), cell_array->data());
 
-        pd->SetPolys(ca);
-        ca->Delete();
-
-        // pass strips
-        n_tups = strip_end - strip_begin;
-        vtkIdTypeArray *strips = vtkIdTypeArray::New();
-        strips->SetNumberOfTuples(n_tups);
-        vtkIdType *p_strips = strips->GetPointer(0);
-
-        for (unsigned long j = 0; j < n_tups; ++j)
-          p_strips[j] = strip_begin[j];
-
-        ca = vtkCellArray::New();
-        ca->SetCells(n_strips, strips);
-        strips->Delete();
-
-        pd->SetStrips(ca);
-        ca->Delete();
-
-        pd->BuildCells();
-
-        numBytes += ct_count*sizeof(unsigned char) + ca_count*sizeof(vtkIdType);
+        // the cells are passed to vtk once they have been read
+        batch.Defer([pd, cell_types, cell_array, num_cells_local]() -> int
+          {
+          unsigned char *p_types = cell_types->data();
+          vtkIdType *p_cells = cell_array->data();
+
+          // assumptions made here:
+          // data is serialized in the order verts, lines, polys, strips
+
+          // find first and last vert and number of verts
+          unsigned long i = 0;
+          unsigned long n_verts = 0;
+          vtkIdType *vert_begin = p_cells;
+          while ((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
+            {
+            p_cells += p_cells[0] + 1;
+            ++n_verts;
+            ++i;
+            }
+          vtkIdType *vert_end = p_cells;
+
+          // find first and last line and number of lines
+          unsigned long n_lines = 0;
+          vtkIdType *line_begin = p_cells;
+          while ((i < num_cells_local) && (p_types[i] == VTK_LINE))
+            {
+            p_cells += p_cells[0] + 1;
+            ++n_lines;
+            ++i;
+            }
+          vtkIdType *line_end = p_cells;
+
+          // find first and last poly and number of polys
+          unsigned long n_polys = 0;
+          vtkIdType *poly_begin = p_cells;
+          while ((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
+            {
+            p_cells += p_cells[0] + 1;
+            ++n_polys;
+            ++i;
+            }
+          vtkIdType *poly_end = p_cells;
+
+          // find first and last strip and number of strips
+          unsigned long n_strips = 0;
+          vtkIdType *strip_begin = p_cells;
+          while ((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
+            {
+            p_cells += p_cells[0] + 1;
+            ++n_strips;
+            ++i;
+            }
+          vtkIdType *strip_end = p_cells;
+
+          // pass into vtk
+          // pass verts
+          unsigned long n_tups = vert_end - vert_begin;
+          vtkIdTypeArray *verts = vtkIdTypeArray::New();
+          verts->SetNumberOfTuples(n_tups);
+          vtkIdType *p_verts = verts->GetPointer(0);
+
+          for (unsigned long j = 0; j < n_tups; ++j)
+            p_verts[j] = vert_begin[j];
+
+          vtkCellArray *ca = vtkCellArray::New();
+          ca->SetCells(n_verts, verts);
+          verts->Delete();
+
+          pd->SetVerts(ca);
+          ca->Delete();
+
+          // pass lines
+          n_tups = line_end - line_begin;
+          vtkIdTypeArray *lines = vtkIdTypeArray::New();
+          lines->SetNumberOfTuples(n_tups);
+          vtkIdType *p_lines = lines->GetPointer(0);
+
+          for (unsigned long j = 0; j < n_tups; ++j)
+            p_lines[j] = line_begin[j];
+
+          ca = vtkCellArray::New();
+          ca->SetCells(n_lines, lines);
+          lines->Delete();
+
+          pd->SetLines(ca);
+          ca->Delete();
+
+          // pass polys
+          n_tups = poly_end - poly_begin;
+          vtkIdTypeArray *polys = vtkIdTypeArray::New();
+          polys->SetNumberOfTuples(n_tups);
+          vtkIdType *p_polys = polys->GetPointer(0);
+
+          for (unsigned long j = 0; j < n_tups; ++j)
+            p_polys[j] = poly_begin[j];
+
+          ca = vtkCellArray::New();
+          ca->SetCells(n_polys, polys);
+          polys->Delete();
+
+          pd->SetPolys(ca);
+          ca->Delete();
+
+          // pass strips
+          n_tups = strip_end - strip_begin;
+          vtkIdTypeArray *strips = vtkIdTypeArray::New();
+          strips->SetNumberOfTuples(n_tups);
+          vtkIdType *p_strips = strips->GetPointer(0);
+
+          for (unsigned long j = 0; j < n_tups; ++j)
+            p_strips[j] = strip_begin[j];
+
+          ca = vtkCellArray::New();
+          ca->SetCells(n_strips, strips);
+          strips->Delete();
+
+          pd->SetStrips(ca);
+          ca->Delete();
+
+          pd->BuildCells();
+          return 0;
+          });
+
+        numBytes += num_cells_local*sizeof(unsigned char) +
+          cell_array_size_local*sizeof(vtkIdType);
         }
       // go to the next block
       it->GoToNextItem();
@@ -1867,7 +1949,7 @@ struct LogicallyCartesianSchema
   int Write(MPI_Comm comm, int64_t fh,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
-  int Read(MPI_Comm comm, ADIOS_FILE *fh,
+  int Read(MPI_Comm comm, ReadBatch &batch,
     const std::string &ons, const sensei::MeshMetadataPtr &md,
     vtkCompositeDataSet *dobj);
 
@@ -1984,7 +2066,7 @@ int LogicallyCartesianSchema::Write(MPI_Comm comm, int64_t fh,
 }
 
 // --------------------------------------------------------------------------
-int LogicallyCartesianSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
+int LogicallyCartesianSchema::Read(MPI_Comm comm, ReadBatch &batch,
   const std::string &ons, const sensei::MeshMetadataPtr &md,
   vtkCompositeDataSet *dobj)
 {
@@ -1996,55 +2078,52 @@ int LogicallyCartesianSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
+    // /data_object_<id>/data_array_<id>/extent
+    std::string extent_path = ons + "extent";
+
     vtkCompositeDataIterator *it = dobj->NewIterator();
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
 
     // read each block
     unsigned int num_blocks = md->NumBlocks;
+    int block_type = md->BlockType;
     for (unsigned int j = 0; j < num_blocks; ++j)
       {
       // read the variable for a local block
       if (md->BlockOwner[j] ==  rank)
         {
-        // /data_object_<id>/data_array_<id>/extent
-        uint64_t hexplet_start = 6*j;
-        uint64_t hexplet_count = 6;
-        ADIOS_SELECTION *hexplet_sel =
-          adios_selection_boundingbox(1, &hexplet_start, &hexplet_count);
-
-        int ext[6] = {0};
-        std::string extent_path = ons + "extent";
-        adios_schedule_read(fh, hexplet_sel, extent_path.c_str(), 0, 1, ext);
-
-        if (adios_perform_reads(fh, 1))
-          {
-          SENSEI_ERROR("Failed to read cell_types")
-          return -1;
-          }
-
-        adios_selection_delete(hexplet_sel);
-
-        // update the vtk object
         vtkDataObject *dobj = it->GetCurrentDataObject();
         if (!dobj)
           {
           SENSEI_ERROR("Failed to get block " << j)
+          it->Delete();
           return -1;
           }
-        switch (md->BlockType)
+
+        std::shared_ptr<std::vector<int>> ext =
+          std::make_shared<std::vector<int>>(6, 0);
+
+        batch.Add(extent_path, 6*j, 6, sizeof(int), ext->data());
+
+        // update the vtk object once the extent has been read
+        batch.Defer([dobj, ext, block_type]() -> int
           {
-          case VTK_RECTILINEAR_GRID:
-            dynamic_cast<vtkRectilinearGrid*>(dobj)->SetExtent(ext);
-            break;
-          case VTK_IMAGE_DATA:
-          case VTK_UNIFORM_GRID:
-              dynamic_cast<vtkImageData*>(dobj)->SetExtent(ext);
-            break;
-          case VTK_STRUCTURED_GRID:
-              dynamic_cast<vtkStructuredGrid*>(dobj)->SetExtent(ext);
-            break;
-          }
+          switch (block_type)
+            {
+            case VTK_RECTILINEAR_GRID:
+              dynamic_cast<vtkRectilinearGrid*>(dobj)->SetExtent(ext->data());
+              break;
+            case VTK_IMAGE_DATA:
+            case VTK_UNIFORM_GRID:
+                dynamic_cast<vtkImageData*>(dobj)->SetExtent(ext->data());
+              break;
+            case VTK_STRUCTURED_GRID:
+                dynamic_cast<vtkStructuredGrid*>(dobj)->SetExtent(ext->data());
+              break;
+            }
+          return 0;
+          });
 
         numBytes += 6*sizeof(int);
         }
@@ -2069,7 +2148,7 @@ struct UniformCartesianSchema
   int Write(MPI_Comm comm, int64_t fh,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
-  int Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
+  int Read(MPI_Comm comm, ReadBatch &batch, const std::string &ons,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
   std::map<std::string, std::vector<int64_t>> OriginWriteIds;
@@ -2187,7 +2266,7 @@ int UniformCartesianSchema::Write(MPI_Comm comm, int64_t fh,
 }
 
 // --------------------------------------------------------------------------
-int UniformCartesianSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
+int UniformCartesianSchema::Read(MPI_Comm comm, ReadBatch &batch,
   const std::string &ons, const sensei::MeshMetadataPtr &md,
   vtkCompositeDataSet *dobj)
 {
@@ -2199,6 +2278,12 @@ int UniformCartesianSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
+    // /data_object_<id>/data_array_<id>/origin
+    std::string origin_path = ons + "origin";
+
+    // /data_object_<id>/data_array_<id>/spacing
+    std::string spacing_path = ons + "spacing";
+
     vtkCompositeDataIterator *it = dobj->NewIterator();
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
@@ -2210,39 +2295,28 @@ int UniformCartesianSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
       // define the variable for a local block
       if (md->BlockOwner[j] ==  rank)
         {
-        uint64_t triplet_start = 3*j;
-        uint64_t triplet_count = 3;
-        ADIOS_SELECTION *triplet_sel =
-          adios_selection_boundingbox(1, &triplet_start, &triplet_count);
-
-        // /data_object_<id>/data_array_<id>/origin
-        double x0[3] = {0.0};
-        std::string origin_path = ons + "origin";
-        adios_schedule_read(fh, triplet_sel, origin_path.c_str(), 0, 1, x0);
-
-        // /data_object_<id>/data_array_<id>/spacing
-        double dx[3] = {0.0};
-        std::string spacing_path = ons + "spacing";
-        adios_schedule_read(fh, triplet_sel, spacing_path.c_str(), 0, 1, dx);
-
-        if (adios_perform_reads(fh, 1))
-          {
-          SENSEI_ERROR("Failed to read cell_types")
-          return -1;
-          }
-
-        adios_selection_delete(triplet_sel);
-
-        // update the vtk object
         vtkImageData *ds = dynamic_cast<vtkImageData*>(it->GetCurrentDataObject());
         if (!ds)
           {
           SENSEI_ERROR("Failed to get block " << j << " not image data")
+          it->Delete();
           return -1;
           }
 
-        ds->SetOrigin(x0);
-        ds->SetSpacing(dx);
+        // the origin followed by the spacing
+        std::shared_ptr<std::vector<double>> x0dx =
+          std::make_shared<std::vector<double>>(6, 0.0);
+
+        batch.Add(origin_path, 3*j, 3, sizeof(double), x0dx->data());
+        batch.Add(spacing_path, 3*j, 3, sizeof(double), x0dx->data() + 3);
+
+        // update the vtk object once they have been read
+        batch.Defer([ds, x0dx]() -> int
+          {
+          ds->SetOrigin(x0dx->data());
+          ds->SetSpacing(x0dx->data() + 3);
+          return 0;
+          });
 
         numBytes += 6*sizeof(double);
         }
@@ -2267,7 +2341,7 @@ struct StretchedCartesianSchema
   int Write(MPI_Comm comm, int64_t fh,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
-  int Read(MPI_Comm comm, ADIOS_FILE *fh, const std::string &ons,
+  int Read(MPI_Comm comm, ReadBatch &batch, const std::string &ons,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
   std::map<std::string, std::vector<int64_t>> XCoordWriteIds;
@@ -2452,7 +2526,7 @@ int StretchedCartesianSchema::Write(MPI_Comm comm, int64_t fh,
 }
 
 // --------------------------------------------------------------------------
-int StretchedCartesianSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
+int StretchedCartesianSchema::Read(MPI_Comm comm, ReadBatch &batch,
   const std::string &ons, const sensei::MeshMetadataPtr &md,
   vtkCompositeDataSet *dobj)
 {
@@ -2464,6 +2538,17 @@ int StretchedCartesianSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
+    // /data_object_<id>/data_array_<id>/x_coords
+    std::string xc_path = ons + "x_coords";
+
+    // /data_object_<id>/data_array_<id>/y_coords
+    std::string yc_path = ons + "y_coords";
+
+    // /data_object_<id>/data_array_<id>/z_coords
+    std::string zc_path = ons + "z_coords";
+
+    long long cts = sensei::VTKUtils::Size(md->CoordinateType);
+
     vtkCompositeDataIterator *it = dobj->NewIterator();
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
@@ -2484,66 +2569,37 @@ int StretchedCartesianSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
       // define the variable for a local block
       if (md->BlockOwner[j] ==  rank)
         {
-        // /data_object_<id>/data_array_<id>/x_coords
-        uint64_t x_start = xc_offset;
-        uint64_t x_count = nx_local;;
-        ADIOS_SELECTION *xc_sel = adios_selection_boundingbox(1, &x_start, &x_count);
+        vtkRectilinearGrid *ds = dynamic_cast<vtkRectilinearGrid*>(it->GetCurrentDataObject());
+        if (!ds)
+          {
+          SENSEI_ERROR("Failed to get block " << j)
+          it->Delete();
+          return -1;
+          }
 
         vtkDataArray *x_coords = vtkDataArray::CreateDataArray(md->CoordinateType);
         x_coords->SetNumberOfComponents(1);
         x_coords->SetNumberOfTuples(nx_local);
         x_coords->SetName("x_coords");
 
-        std::string xc_path = ons + "x_coords";
-        adios_schedule_read(fh, xc_sel, xc_path.c_str(),
-          0, 1, x_coords->GetVoidPointer(0));
-
-        // /data_object_<id>/data_array_<id>/y_coords
-        uint64_t y_start = yc_offset;
-        uint64_t y_count = ny_local;;
-        ADIOS_SELECTION *yc_sel = adios_selection_boundingbox(1, &y_start, &y_count);
+        batch.Add(xc_path, xc_offset, nx_local, cts, x_coords->GetVoidPointer(0));
 
         vtkDataArray *y_coords = vtkDataArray::CreateDataArray(md->CoordinateType);
         y_coords->SetNumberOfComponents(1);
         y_coords->SetNumberOfTuples(ny_local);
         y_coords->SetName("y_coords");
 
-        std::string yc_path = ons + "y_coords";
-        adios_schedule_read(fh, yc_sel, yc_path.c_str(),
-          0, 1, y_coords->GetVoidPointer(0));
-
-        // /data_object_<id>/data_array_<id>/z_coords
-        uint64_t z_start = zc_offset;
-        uint64_t z_count = nz_local;;
-        ADIOS_SELECTION *zc_sel = adios_selection_boundingbox(1, &z_start, &z_count);
+        batch.Add(yc_path, yc_offset, ny_local, cts, y_coords->GetVoidPointer(0));
 
         vtkDataArray *z_coords = vtkDataArray::CreateDataArray(md->CoordinateType);
         z_coords->SetNumberOfComponents(1);
         z_coords->SetNumberOfTuples(nz_local);
         z_coords->SetName("z_coords");
 
-        std::string zc_path = ons + "z_coords";
-        adios_schedule_read(fh, zc_sel, zc_path.c_str(),
-          0, 1, z_coords->GetVoidPointer(0));
-
-        if (adios_perform_reads(fh, 1))
-          {
-          SENSEI_ERROR("Failed to read stretched Cartesian block " << j)
-          return -1;
-          }
-
-        adios_selection_delete(xc_sel);
-        adios_selection_delete(yc_sel);
-        adios_selection_delete(zc_sel);
-
-        // update the vtk object
-        vtkRectilinearGrid *ds = dynamic_cast<vtkRectilinearGrid*>(it->GetCurrentDataObject());
-        if (!ds)
-          {
-          SENSEI_ERROR("Failed to get block " << j)
-          return -1;
-          }
+        batch.Add(zc_path, zc_offset, nz_local, cts, z_coords->GetVoidPointer(0));
 
+        // update the vtk object, the values arrive when the batch is
+        // performed
         ds->SetXCoordinates(x_coords);
         ds->SetYCoordinates(y_coords);
         ds->SetZCoordinates(z_coords);
@@ -2552,8 +2608,7 @@ int StretchedCartesianSchema::Read(MPI_Comm comm, ADIOS_FILE *fh,
         y_coords->Delete();
         z_coords->Delete();
 
-        long long cts = sensei::VTKUtils::Size(md->CoordinateType);
-        numBytes += x_count*cts + y_count*cts + z_count*cts;
+        numBytes += nx_local*cts + ny_local*cts + nz_local*cts;
         }
 
       // next block
@@ -2669,13 +2724,17 @@ int DataObjectSchema::ReadMesh(MPI_Comm comm, ADIOS_FILE *fh,
   std::ostringstream ons;
   ons << "data_object_" << doid << "/";
 
+  // the reads of all of the parts of the mesh are made together
+  ReadBatch batch;
+
   if ((!structure_only &&
-    (this->Points.Read(comm, fh, ons.str(), md, dobj) ||
-    this->UnstructuredCells.Read(comm, fh, ons.str(), md, dobj) ||
-    this->PolydataCells.Read(comm, fh, ons.str(), md, dobj))) ||
-    this->UniformCartesian.Read(comm, fh, ons.str(), md, dobj) ||
-    this->StretchedCartesian.Read(comm, fh, ons.str(), md, dobj) ||
-    this->LogicallyCartesian.Read(comm, fh, ons.str(), md, dobj))
+    (this->Points.Read(comm, batch, ons.str(), md, dobj) ||
+    this->UnstructuredCells.Read(comm, batch, ons.str(), md, dobj) ||
+    this->PolydataCells.Read(comm, batch, ons.str(), md, dobj))) ||
+    this->UniformCartesian.Read(comm, batch, ons.str(), md, dobj) ||
+    this->StretchedCartesian.Read(comm, batch, ons.str(), md, dobj) ||
+    this->LogicallyCartesian.Read(comm, batch, ons.str(), md, dobj) ||
+    batch.Perform(fh))
     {
     SENSEI_ERROR("Failed to define variables for object "
       << doid << " \"" << md->MeshName << "\"")
@@ -2695,7 +2754,11 @@ int DataObjectSchema::ReadArray(MPI_Comm comm, ADIOS_FILE *fh,
   std::ostringstream ons;
   ons << "data_object_" << doid << "/";
 
-  if (this->DataArrays.Read(comm, fh, ons.str(), name, association, md, dobj))
+  // the reads of all of the blocks are made together
+  ReadBatch batch;
+
+  if (this->DataArrays.Read(comm, batch, ons.str(), name, association, md,
+    dobj) || batch.Perform(fh))
     {
     SENSEI_ERROR("Failed to define variables for object "
       << doid << " \"" << md->MeshName << "\"")
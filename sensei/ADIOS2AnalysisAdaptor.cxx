@@ -6,6 +6,7 @@
 #include "VTKUtils.h"
 #include "MPIUtils.h"
 #include "Profiler.h"
+#include "TaskRuntime.h"
 #include "Error.h"
 
 #include <vtkCellTypes.h>
@@ -32,16 +33,64 @@
 
 #include <mpi.h>
 #include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using vtkCompositeDataSetPtr = vtkSmartPointer<vtkCompositeDataSet>;
 
 namespace sensei
 {
 
+// state of the background writer used when writing asynchronously
+struct ADIOS2AnalysisAdaptor::WriterType
+{
+  WriterType() : QueueDepth(0), Policy(QUEUE_BLOCK), Comm(MPI_COMM_NULL),
+    Running(false), Stop(false), Error(false), NumWritten(0),
+    NumFailed(0), NumDiscarded(0) {}
+
+  // a copy of one step's data waiting to be written
+  struct Step
+  {
+    unsigned long TimeStep;
+    double Time;
+    std::vector<MeshMetadataPtr> Metadata;
+    std::vector<vtkCompositeDataSetPtr> Objects;
+    std::vector<std::vector<int>> Changed;
+  };
+
+  unsigned int QueueDepth;
+  int Policy;
+
+  // used by the calling thread to agree on which steps are discarded.
+  // the writer thread uses the adaptor's communicator
+  MPI_Comm Comm;
+
+  bool Running;
+  bool Stop;
+  bool Error;
+  unsigned long NumWritten;
+  unsigned long NumFailed;
+  unsigned long NumDiscarded;
+
+  std::deque<Step> Queue;
+  std::mutex Mutex;
+  std::condition_variable Cond;
+  std::thread Thread;
+};
+
 //----------------------------------------------------------------------------
 senseiNewMacro(ADIOS2AnalysisAdaptor);
 
 //----------------------------------------------------------------------------
 ADIOS2AnalysisAdaptor::ADIOS2AnalysisAdaptor() : Schema(nullptr),
-    FileName("sensei.bp"), DebugMode(0)
+    FileName("sensei.bp"), DebugMode(0), AggregateBlocks(0),
+    ProgressiveLevels(0), MetadataKeyFrames(0), TrackChanges(false),
+    NodeAggregation(false),
+    Writer(new WriterType),
+    StepPolicy(STEP_POLICY_ALL), StepPolicyCount(1), NumSteps(0),
+    NumStepsSkipped(0)
 {
   this->Handles.io = nullptr;
   this->Handles.engine = nullptr;
@@ -50,9 +99,26 @@ ADIOS2AnalysisAdaptor::ADIOS2AnalysisAdaptor() : Schema(nullptr),
 //----------------------------------------------------------------------------
 ADIOS2AnalysisAdaptor::~ADIOS2AnalysisAdaptor()
 {
+  this->StopWriter();
+  delete this->Writer;
   delete this->Schema;
 }
 
+//-----------------------------------------------------------------------------
+void ADIOS2AnalysisAdaptor::SetAsynchronous(unsigned int queueDepth,
+  int policy)
+{
+  this->Writer->QueueDepth = queueDepth;
+  this->Writer->Policy = policy;
+}
+
+//-----------------------------------------------------------------------------
+void ADIOS2AnalysisAdaptor::SetStepPolicy(int policy, unsigned int count)
+{
+  this->StepPolicy = policy;
+  this->StepPolicyCount = count ? count : 1;
+}
+
 //-----------------------------------------------------------------------------
 int ADIOS2AnalysisAdaptor::SetDataRequirements(const DataRequirements &reqs)
 {
@@ -73,6 +139,15 @@ bool ADIOS2AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
 {
   TimeEvent<128> mark("ADIOS2AnalysisAdaptor::Execute");
 
+  // skip the steps the step policy says not to write
+  unsigned long step = this->NumSteps++;
+  if ((this->StepPolicy == STEP_POLICY_EVERY_KTH) &&
+    (step % this->StepPolicyCount))
+    {
+    ++this->NumStepsSkipped;
+    return true;
+    }
+
   // figure out what the simulation can provide. include the full
   // suite of metadata for the end-point partitioners
   MeshMetadataFlags flags;
@@ -101,6 +176,9 @@ bool ADIOS2AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
     SENSEI_WARNING("No subset specified. Writing all available data")
     }
 
+  unsigned long timeStep = dataAdaptor->GetDataTimeStep();
+  double time = dataAdaptor->GetDataTime();
+
   // collect the specified data objects and metadata
   std::vector<vtkCompositeDataSet*> objects;
   std::vector<MeshMetadataPtr> metadata;
@@ -110,9 +188,10 @@ bool ADIOS2AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
 
   while (mit)
     {
-    // get metadata
+    // get metadata. everything we do from here on out depends on
+    // having the global view.
     MeshMetadataPtr md;
-    if (mdm.GetMeshMetadata(mit.MeshName(), md))
+    if (mdm.GetGlobalMeshMetadata(mit.MeshName(), md))
       {
       SENSEI_ERROR("Failed to get mesh metadata for mesh \""
         << mit.MeshName() << "\"")
@@ -142,28 +221,37 @@ bool ADIOS2AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
       return false;
       }
 
-    // add the required arrays
+    // add the required arrays that are due at this step
     ArrayRequirementsIterator ait =
       this->Requirements.GetArrayRequirementsIterator(mit.MeshName());
 
+    ait.SetMode(ArrayRequirementsIterator::MODE_ASSOCIATION);
+
     while (ait)
       {
-      if (dataAdaptor->AddArray(dobj, mit.MeshName(),
-         ait.Association(), ait.Array()))
+      std::vector<std::string> arrays;
+      this->Requirements.GetRequiredArrays(mit.MeshName(),
+        ait.Association(), timeStep, arrays);
+
+      if (dataAdaptor->AddArrays(dobj, mit.MeshName(),
+         ait.Association(), arrays))
         {
         SENSEI_ERROR("Failed to add "
           << VTKUtils::GetAttributesName(ait.Association())
-          << " data array \"" << ait.Array() << "\" to mesh \""
-          << mit.MeshName() << "\"")
+          << " data arrays to mesh \"" << mit.MeshName() << "\"")
         return false;
         }
 
       ++ait;
       }
 
-    // generate a global view of the metadata. everything we do from here
-    // on out depends on having the global view.
-    md->GlobalizeView(this->GetCommunicator());
+    // the metadata written lists the arrays written, readers find the
+    // arrays available at each step there
+    if (this->Requirements.SelectArrays(timeStep, md))
+      {
+      SENSEI_ERROR("Failed to select the arrays of mesh \"" << mit.MeshName() << "\"")
+      return false;
+      }
 
     // add to the collection
     objects.push_back(dobj);
@@ -172,11 +260,50 @@ bool ADIOS2AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
     ++mit;
     }
 
-  unsigned long timeStep = dataAdaptor->GetDataTimeStep();
-  double time = dataAdaptor->GetDataTime();
+  // the engine drops steps the readers never see, an array skipped after
+  // one of them could not be recovered
+  if (this->TrackChanges && (this->StepPolicy == STEP_POLICY_LATEST))
+    {
+    SENSEI_WARNING("Tracking changed arrays is not supported with the"
+      " latest step policy. All arrays will be written")
+    this->TrackChanges = false;
+    }
 
-  if (this->InitializeADIOS2(metadata) ||
-    this->WriteTimestep(timeStep, time, metadata, objects))
+  // when aggregating the changes are found before the discard decision,
+  // which is made by the leaders
+  if (this->TrackChanges && this->NodeAggregation &&
+    this->Writer->QueueDepth && (this->Writer->Policy == QUEUE_DISCARD))
+    {
+    SENSEI_WARNING("Tracking changed arrays is not supported with node"
+      " aggregation and a discarding writer queue. All arrays will be written")
+    this->TrackChanges = false;
+    }
+
+  // the changes are found on the simulation's blocks, those gathered to
+  // the leaders are new each step. only the leaders go on to write
+  std::vector<std::vector<int>> changed;
+  if (this->NodeAggregation)
+    {
+    if (this->GetChangedArrays(this->GetCommunicator(), metadata,
+      objects, changed) || this->GatherToLeaders(metadata, objects))
+      return false;
+
+    if (!this->Aggregator.IsLeader())
+      return true;
+    }
+
+  // the changes of a step written asynchronously are found once it is
+  // known not to be discarded
+  if (this->Writer->QueueDepth)
+    {
+    if (this->WriteTimestepAsynchronous(timeStep, time, metadata, objects,
+      changed))
+      return false;
+    }
+  else if ((!this->NodeAggregation && this->GetChangedArrays(
+    this->GetCommunicator(), metadata, objects, changed)) ||
+    this->InitializeADIOS2(metadata) ||
+    this->WriteTimestep(timeStep, time, metadata, objects, changed))
     return false;
 
   unsigned int n_objects = objects.size();
@@ -195,7 +322,7 @@ int ADIOS2AnalysisAdaptor::InitializeADIOS2(
   if (!this->Schema)
     {
     // initialize adios2
-    this->Adios = adios2_init(this->GetCommunicator(),
+    this->Adios = adios2_init(this->GetWriterCommunicator(),
       adios2_debug_mode(this->DebugMode));
 
     if (this->Adios == nullptr)
@@ -214,6 +341,39 @@ int ADIOS2AnalysisAdaptor::InitializeADIOS2(
 
     // create space for ADIOS2 variables
     this->Schema = new senseiADIOS2::DataObjectCollectionSchema;
+    this->Schema->SetAggregateBlocks(this->AggregateBlocks);
+    this->Schema->SetArrayPrecision(this->Requirements);
+    this->Schema->SetProgressiveLevels(this->ProgressiveLevels);
+    this->Schema->SetMetadataKeyFrames(this->MetadataKeyFrames);
+
+    // define the operators that reduce the arrays
+    std::vector<senseiADIOS2::ArrayOperation> ops;
+    unsigned int nOps = this->Operations.size();
+    for (unsigned int i = 0; i < nOps; ++i)
+      {
+      const OperationSpec &spec = this->Operations[i];
+
+      std::string opName = "SENSEIOperator" + std::to_string(i);
+
+      senseiADIOS2::ArrayOperation op;
+      op.ArrayName = spec.ArrayName;
+      op.Parameters = spec.Parameters;
+      op.Lossy = (spec.Type == "zfp") || (spec.Type == "sz") ||
+        (spec.Type == "mgard");
+      op.Operator = adios2_define_operator(this->Adios, opName.c_str(),
+        spec.Type.c_str());
+
+      if (!op.Operator)
+        {
+        SENSEI_ERROR("Failed to define the ADIOS2 \"" << spec.Type
+          << "\" operator. Check that ADIOS2 was built with it")
+        return -1;
+        }
+
+      ops.push_back(op);
+      }
+
+    this->Schema->SetArrayOperations(ops);
 
     // Open the engine now variables are declared
     if (adios2_set_engine(this->Handles.io, this->EngineName.c_str()))
@@ -223,17 +383,9 @@ int ADIOS2AnalysisAdaptor::InitializeADIOS2(
       }
     }
 
-  // On subsequent ts we need to clear the existing variables so we don't try to
-  // redefine existing variables
-  adios2_error clearErr = adios2_remove_all_variables(this->Handles.io);
-  if (clearErr != 0)
-    {
-    SENSEI_ERROR("adios2_remove_all_variables failed " << clearErr )
-    return -1;
-    }
-
-  // (re)define variables to support meshes that evovle in time
-  if (this->Schema->DefineVariables(this->GetCommunicator(),
+  // (re)define variables to support meshes that evovle in time. variables
+  // are kept across steps and only redefined when the metadata changes
+  if (this->Schema->DefineVariables(this->GetWriterCommunicator(),
     this->Handles, metadata))
     {
     SENSEI_ERROR("Failed to define variables")
@@ -260,6 +412,12 @@ int ADIOS2AnalysisAdaptor::Finalize()
 {
   TimeEvent<128> mark("ADIOS2AnalysisAdaptor::Finalize");
 
+  // write the steps that are still queued
+  int ierr = this->StopWriter();
+
+  Profiler::LogCounter("ADIOS2AnalysisAdaptor::StepsSkipped",
+    this->NumStepsSkipped + this->Writer->NumDiscarded);
+
   if (this->Schema)
     {
     adios2_error err = adios2_close(this->Handles.engine);
@@ -275,22 +433,299 @@ int ADIOS2AnalysisAdaptor::Finalize()
 
   delete this->Schema;
   this->Schema = nullptr;
+  this->ChangeTracker.Clear();
+  this->Aggregator.Free();
   this->Handles.io = nullptr;
   this->Handles.engine = nullptr;
 
+  return ierr;
+}
+
+//----------------------------------------------------------------------------
+int ADIOS2AnalysisAdaptor::WriteTimestepAsynchronous(unsigned long timeStep,
+  double time, const std::vector<MeshMetadataPtr> &metadata,
+  const std::vector<vtkCompositeDataSet*> &objects,
+  const std::vector<std::vector<int>> &changed)
+{
+  TimeEvent<128> mark("ADIOS2AnalysisAdaptor::WriteTimestepAsynchronous");
+
+  WriterType *writer = this->Writer;
+
+  if (!writer->Running)
+    {
+    // the writer thread makes MPI calls while the simulation does
+    int threadLevel = MPI_THREAD_SINGLE;
+    MPI_Query_thread(&threadLevel);
+    if (threadLevel < MPI_THREAD_MULTIPLE)
+      {
+      SENSEI_WARNING("Asynchronous writes require MPI_THREAD_MULTIPLE."
+        " Steps will be written synchronously")
+      writer->QueueDepth = 0;
+      std::vector<std::vector<int>> stepChanged(changed);
+      if ((!this->NodeAggregation && this->GetChangedArrays(
+        this->GetCommunicator(), metadata, objects, stepChanged)) ||
+        this->InitializeADIOS2(metadata) ||
+        this->WriteTimestep(timeStep, time, metadata, objects, stepChanged))
+        return -1;
+      return 0;
+      }
+
+    MPI_Comm_dup(this->GetWriterCommunicator(), &writer->Comm);
+
+    writer->Stop = false;
+    writer->Error = false;
+    writer->Running = true;
+
+    writer->Thread = std::thread([this, writer]()
+      {
+      TaskRuntime::BindThread("ADIOS2AnalysisAdaptor::Writer");
+
+      std::unique_lock<std::mutex> lock(writer->Mutex);
+      while (true)
+        {
+        writer->Cond.wait(lock, [writer]() -> bool
+          { return writer->Stop || !writer->Queue.empty(); });
+
+        if (writer->Queue.empty())
+          return;
+
+        WriterType::Step step = std::move(writer->Queue.front());
+        writer->Queue.pop_front();
+        writer->Cond.notify_all();
+
+        lock.unlock();
+
+        std::vector<vtkCompositeDataSet*> objs(step.Objects.begin(),
+          step.Objects.end());
+
+        int ierr = this->InitializeADIOS2(step.Metadata) ||
+          this->WriteTimestep(step.TimeStep, step.Time, step.Metadata, objs,
+            step.Changed);
+
+        // release the copy before taking the lock
+        objs.clear();
+        step.Objects.clear();
+
+        lock.lock();
+        if (ierr)
+          {
+          ++writer->NumFailed;
+          writer->Error = true;
+          writer->Cond.notify_all();
+          }
+        else
+          {
+          ++writer->NumWritten;
+          }
+        }
+      });
+    }
+
+  // discard the step everywhere if any rank's writer has fallen behind
+  if (writer->Policy == QUEUE_DISCARD)
+    {
+    int full = 0;
+    {
+    std::lock_guard<std::mutex> lock(writer->Mutex);
+    full = writer->Queue.size() >= writer->QueueDepth;
+    }
+
+    int anyFull = 0;
+    MPI_Allreduce(&full, &anyFull, 1, MPI_INT, MPI_MAX, writer->Comm);
+
+    if (anyFull)
+      {
+      ++writer->NumDiscarded;
+      return 0;
+      }
+    }
+
+  // copy the data, the simulation may modify it as soon as we return.
+  // changes are found on the simulation's arrays, the copies are new. the
+  // writer thread uses the adaptor's communicator
+  WriterType::Step step;
+  step.TimeStep = timeStep;
+  step.Time = time;
+  step.Metadata = metadata;
+
+  if (this->NodeAggregation)
+    step.Changed = changed;
+  else if (this->GetChangedArrays(writer->Comm, metadata, objects,
+    step.Changed))
+    return -1;
+
+  unsigned int nObjects = objects.size();
+  for (unsigned int i = 0; i < nObjects; ++i)
+    {
+    vtkCompositeDataSetPtr copy;
+    copy.TakeReference(objects[i]->NewInstance());
+    copy->DeepCopy(objects[i]);
+    step.Objects.push_back(copy);
+    }
+
+  // wait for room in the queue
+  std::unique_lock<std::mutex> lock(writer->Mutex);
+  writer->Cond.wait(lock, [writer]() -> bool
+    { return writer->Error || (writer->Queue.size() < writer->QueueDepth); });
+
+  if (writer->Error)
+    {
+    SENSEI_ERROR("The asynchronous writer failed")
+    return -1;
+    }
+
+  writer->Queue.push_back(std::move(step));
+  writer->Cond.notify_all();
+
+  Profiler::LogCounter("ADIOS2AnalysisAdaptor::QueueDepth",
+    writer->Queue.size());
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int ADIOS2AnalysisAdaptor::StopWriter()
+{
+  WriterType *writer = this->Writer;
+
+  if (!writer->Running)
+    return 0;
+
+  {
+  std::lock_guard<std::mutex> lock(writer->Mutex);
+  writer->Stop = true;
+  }
+  writer->Cond.notify_all();
+
+  writer->Thread.join();
+  writer->Running = false;
+
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+  if (finalized)
+    return writer->Error ? -1 : 0;
+
+  int rank = 0;
+  MPI_Comm_rank(writer->Comm, &rank);
+  if (rank == 0)
+    {
+    SENSEI_STATUS("ADIOS2AnalysisAdaptor wrote " << writer->NumWritten
+      << " steps asynchronously, discarded " << writer->NumDiscarded
+      << " and failed to write " << writer->NumFailed)
+    }
+
+  MPI_Comm_free(&writer->Comm);
+
+  return writer->Error ? -1 : 0;
+}
+
+//----------------------------------------------------------------------------
+MPI_Comm ADIOS2AnalysisAdaptor::GetWriterCommunicator()
+{
+  return this->NodeAggregation ? this->Aggregator.GetLeaderCommunicator() :
+    this->GetCommunicator();
+}
+
+//----------------------------------------------------------------------------
+int ADIOS2AnalysisAdaptor::GatherToLeaders(
+  std::vector<MeshMetadataPtr> &metadata,
+  std::vector<vtkCompositeDataSet*> &objects)
+{
+  TimeEvent<128> mark("ADIOS2AnalysisAdaptor::GatherToLeaders");
+
+  if (!this->Aggregator.Initialized() &&
+    this->Aggregator.Initialize(this->GetCommunicator()))
+    {
+    SENSEI_ERROR("Failed to initialize node aggregation")
+    return -1;
+    }
+
+  int ierr = 0;
+  unsigned int nObjects = objects.size();
+  for (unsigned int i = 0; i < nObjects; ++i)
+    {
+    MeshMetadataPtr leaderMd;
+    vtkCompositeDataSet *leaderMesh = nullptr;
+
+    if (!ierr && this->Aggregator.Gather(metadata[i], objects[i],
+      leaderMd, leaderMesh))
+      {
+      SENSEI_ERROR("Failed to gather mesh \"" << metadata[i]->MeshName
+        << "\" to the node leaders")
+      ierr = -1;
+      }
+
+    if (objects[i])
+      objects[i]->Delete();
+    objects[i] = leaderMesh;
+    metadata[i] = leaderMd;
+    }
+
+  if (ierr || !this->Aggregator.IsLeader())
+    {
+    for (unsigned int i = 0; i < nObjects; ++i)
+      {
+      if (objects[i])
+        objects[i]->Delete();
+      }
+    objects.clear();
+    metadata.clear();
+    }
+
+  return ierr;
+}
+
+//----------------------------------------------------------------------------
+int ADIOS2AnalysisAdaptor::GetChangedArrays(MPI_Comm comm,
+  const std::vector<MeshMetadataPtr> &metadata,
+  const std::vector<vtkCompositeDataSet*> &objects,
+  std::vector<std::vector<int>> &changed)
+{
+  changed.clear();
+
+  if (!this->TrackChanges)
+    return 0;
+
+  TimeEvent<128> mark("ADIOS2AnalysisAdaptor::GetChangedArrays");
+
+  unsigned int nObjects = objects.size();
+  changed.resize(nObjects);
+
+  for (unsigned int i = 0; i < nObjects; ++i)
+    {
+    if (this->ChangeTracker.Update(comm, metadata[i], objects[i], changed[i]))
+      {
+      SENSEI_ERROR("Failed to find the changed arrays of mesh \""
+        << metadata[i]->MeshName << "\"")
+      return -1;
+      }
+    }
+
   return 0;
 }
 
 //----------------------------------------------------------------------------
 int ADIOS2AnalysisAdaptor::WriteTimestep(unsigned long timeStep,
   double time, const std::vector<MeshMetadataPtr> &metadata,
-  const std::vector<vtkCompositeDataSet*> &objects)
+  const std::vector<vtkCompositeDataSet*> &objects,
+  const std::vector<std::vector<int>> &changed)
 {
   TimeEvent<128> mark("ADIOS2AnalysisAdaptor::WriteTimestep");
 
   int ierr = 0;
   if (!this->Handles.engine)
     {
+    // configure the SST queue according to the step policy
+    if ((this->StepPolicy == STEP_POLICY_LATEST) ||
+      (this->StepPolicy == STEP_POLICY_BLOCK))
+      {
+      std::string queueLimit = std::to_string(this->StepPolicyCount);
+      adios2_set_parameter(this->Handles.io, "QueueLimit", queueLimit.c_str());
+
+      adios2_set_parameter(this->Handles.io, "QueueFullPolicy",
+        this->StepPolicy == STEP_POLICY_LATEST ? "Discard" : "Block");
+      }
+
     // If the user set additional parameters, add them now to ADIOS2
     for (unsigned int j = 0; j < this->Parameters.size(); j++)
       {
@@ -321,8 +756,8 @@ int ADIOS2AnalysisAdaptor::WriteTimestep(unsigned long timeStep,
     }
 
 
-  if (this->Schema->Write(this->GetCommunicator(),
-    this->Handles, timeStep, time, metadata, objects))
+  if (this->Schema->Write(this->GetWriterCommunicator(),
+    this->Handles, timeStep, time, metadata, objects, changed))
     {
     SENSEI_ERROR("Failed to write step " << timeStep
       << " to \"" << this->FileName << "\"")
@@ -348,4 +783,16 @@ void ADIOS2AnalysisAdaptor::AddParameter(const std::string &key,
   this->Parameters.emplace_back(key, value);
 }
 
+//----------------------------------------------------------------------------
+void ADIOS2AnalysisAdaptor::AddArrayOperation(const std::string &arrayName,
+  const std::string &type,
+  const std::vector<std::pair<std::string,std::string>> &params)
+{
+  OperationSpec spec;
+  spec.ArrayName = arrayName.empty() ? std::string("*") : arrayName;
+  spec.Type = type;
+  spec.Parameters = params;
+  this->Operations.push_back(spec);
+}
+
 }
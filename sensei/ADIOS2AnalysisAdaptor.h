@@ -2,8 +2,10 @@
 #define ADIOS2AnalysisAdaptor_h
 
 #include "AnalysisAdaptor.h"
+#include "ArrayChangeTracker.h"
 #include "DataRequirements.h"
 #include "MeshMetadata.h"
+#include "NodeAggregator.h"
 
 #include <ADIOS2Schema.h>
 
@@ -50,8 +52,141 @@ public:
   void SetDebugMode(int mode)
   { this->DebugMode = mode; }
 
+  /// @brief Coalesce small blocks before they are sent.
+  ///
+  /// When many small blocks are placed on each rank the per block costs
+  /// of the engine dominate. With a non-zero value, a rank's adjacent
+  /// blocks of at most maxTuples tuples are written with a single put per
+  /// data array. The stream's layout and the block decomposition seen by
+  /// readers and partitioners are unchanged. The default, 0, writes each
+  /// block separately.
+  void SetAggregateBlocks(unsigned long maxTuples)
+  { this->AggregateBlocks = maxTuples; }
+
+  unsigned long GetAggregateBlocks() const
+  { return this->AggregateBlocks; }
+
+  /// Progressive streaming of uniform meshes
+  ///
+  /// Along with the data arrays of image data blocks, levels subsampled
+  /// copies are written in the same step, copy l keeping every 2^l-th
+  /// point or cell in each direction. A reader given a refinement budget
+  /// reads the coarsest copy first and refines while time remains, see
+  /// ADIOS2DataAdaptor::SetRefinementBudget. Other meshes are written in
+  /// full only. The default, 0, writes no copies.
+  void SetProgressiveLevels(unsigned int levels)
+  { this->ProgressiveLevels = levels; }
+
+  unsigned int GetProgressiveLevels() const
+  { return this->ProgressiveLevels; }
+
+  /// Metadata deltas
+  ///
+  /// The metadata of a mesh that changed since the last step is written
+  /// as the difference to that of the last step, the fields and blocks
+  /// that changed, with all of it written every interval steps. For meshes
+  /// that change slowly, such as AMR with infrequent regridding, this makes
+  /// the metadata of most steps a few bytes. Readers that miss a step,
+  /// because of their step policy or because the engine dropped it, skip
+  /// to the next key frame. The default, 0, writes all of it every step.
+  void SetMetadataKeyFrames(unsigned int interval)
+  { this->MetadataKeyFrames = interval; }
+
+  unsigned int GetMetadataKeyFrames() const
+  { return this->MetadataKeyFrames; }
+
+  /// Node aggregation
+  ///
+  /// When enabled the ranks of each shared memory node gather their
+  /// blocks to the lowest rank of the node and only these leaders open
+  /// the engine, see NodeAggregator. Readers see one writer per node, the
+  /// blocks' metadata is kept with their owners set to the leaders.
+  /// Changed arrays are found on all ranks before the gather. AMR meshes
+  /// are not supported. The default is disabled.
+  void SetNodeAggregation(bool val)
+  { this->NodeAggregation = val; }
+
+  bool GetNodeAggregation() const
+  { return this->NodeAggregation; }
+
+  /// what to do with a step when the asynchronous writer's queue is full
+  enum {QUEUE_BLOCK=0, QUEUE_DISCARD=1};
+
+  /// @brief Write in a background thread.
+  ///
+  /// When the queue depth is non-zero Execute copies the data to be
+  /// written and hands it to a background thread which writes it while
+  /// the simulation continues. At most queueDepth steps wait to be written.
+  /// When the queue is full QUEUE_BLOCK makes Execute wait for the writer,
+  /// QUEUE_DISCARD skips the step. A step is skipped on all ranks if the
+  /// queue is full on any rank. Requires MPI_THREAD_MULTIPLE, otherwise
+  /// steps are written synchronously. The default, 0, writes synchronously.
+  void SetAsynchronous(unsigned int queueDepth, int policy = QUEUE_BLOCK);
+
+  /// step policies, see SetStepPolicy
+  enum {STEP_POLICY_ALL=0, STEP_POLICY_LATEST=1,
+    STEP_POLICY_EVERY_KTH=2, STEP_POLICY_BLOCK=3};
+
+  /// @brief Control what happens when the readers fall behind.
+  ///
+  /// STEP_POLICY_ALL, the default, leaves it to the engine.
+  /// STEP_POLICY_LATEST never makes the simulation wait. It queues up to
+  /// count steps and drops new ones while the queue is full. The
+  /// readers should use the latest policy too, so that each time they
+  /// advance they get the newest step.
+  /// STEP_POLICY_EVERY_KTH writes every count'th step. The readers'
+  /// every_kth policy strides over the steps written, so when both sides
+  /// use it the strides multiply. Use it on one side only: here to cut the
+  /// data sent, on the reader to thin a stream written in full.
+  /// STEP_POLICY_BLOCK queues up to count steps and blocks when the queue
+  /// is full. The latest and block policies configure the SST queue.
+  /// Parameters set with AddParameter take precedence.
+  void SetStepPolicy(int policy, unsigned int count = 1);
+
+  /// @brief Reduce data arrays with an ADIOS2 operator before they are sent.
+  ///
+  /// The operator type is one of those ADIOS2 was built with. The lossy
+  /// zfp, sz and mgard, take an error bound such as accuracy, they are
+  /// applied to floating point arrays only. The lossless blosc and bzip2,
+  /// blosc taking compressor (e.g. lz4), clevel and doshuffle (e.g.
+  /// BLOSC_SHUFFLE), apply to all arrays. The arrays named arrayName are
+  /// reduced, "*" matches all of them. The first matching call applies.
+  /// Readers decompress transparently. The array ranges in the metadata
+  /// are those of the unreduced data.
+  void AddArrayOperation(const std::string &arrayName, const std::string &type,
+    const std::vector<std::pair<std::string,std::string>> &params);
+
+  /// @brief Skip the data arrays that did not change since the last step.
+  ///
+  /// When enabled a data array is sent only when it changed, see
+  /// ArrayChangeTracker, and the readers reuse the copy they read at the
+  /// step it was last sent at. The readers must read each array at every
+  /// step, from the first, over the same partition. Steps discarded by the
+  /// asynchronous writer are accounted for, the latest step policy discards
+  /// steps in the engine and disables tracking. The ghost arrays are always
+  /// sent. The points and cells of meshes flagged StaticMesh, and the mesh
+  /// metadata when it is unchanged, are likewise sent once. The default is
+  /// disabled.
+  void SetTrackChanges(bool val)
+  { this->TrackChanges = val; }
+
+  bool GetTrackChanges() const
+  { return this->TrackChanges; }
+
+  /// flag an array as unchanged at the next step, for data adaptors that
+  /// make their VTK arrays anew each step. see ArrayChangeTracker
+  void SetArrayUnchanged(const std::string &meshName, int association,
+    const std::string &arrayName)
+  { this->ChangeTracker.SetArrayUnchanged(meshName, association, arrayName); }
+
   /// data requirements tell the adaptor what to push
-  /// if none are given then all data is pushed.
+  /// if none are given then all data is pushed. floating point arrays are
+  /// stored at the precision the requirements give them, see
+  /// DataRequirements::SetArrayPrecision. ADIOS2 has no 16 bit type,
+  /// float16 is stored as float32. arrays are written at the steps their
+  /// cadence gives, see DataRequirements::SetArrayCadence, and the metadata
+  /// of each step lists those written. the stream's variables are
+  /// redefined at the steps where the list changes.
   int SetDataRequirements(const DataRequirements &reqs);
 
   int AddDataRequirement(const std::string &meshName,
@@ -68,14 +203,42 @@ protected:
   // intializes ADIOS2 in no-xml mode, allocate buffers, and declares a group
   int InitializeADIOS2(const std::vector<MeshMetadataPtr> &metadata);
 
-  // writes the data collection
+  // writes the data collection. changed flags the data arrays of each
+  // object to write, when empty all are written
   int WriteTimestep(unsigned long timeStep, double time,
     const std::vector<MeshMetadataPtr> &metadata,
-    const std::vector<vtkCompositeDataSet*> &dobjects);
+    const std::vector<vtkCompositeDataSet*> &dobjects,
+    const std::vector<std::vector<int>> &changed);
+
+  // finds the data arrays of each object that changed since the last step
+  // written. changed is left empty when changes are not tracked. collective
+  // over comm
+  int GetChangedArrays(MPI_Comm comm,
+    const std::vector<MeshMetadataPtr> &metadata,
+    const std::vector<vtkCompositeDataSet*> &dobjects,
+    std::vector<std::vector<int>> &changed);
 
   // shuts down ADIOS2
   int FinalizeADIOS2();
 
+  // the ranks that write, the node leaders when aggregating
+  MPI_Comm GetWriterCommunicator();
+
+  // replaces the objects and their metadata by those gathered to the node
+  // leaders, on the other ranks they are released and cleared. collective
+  int GatherToLeaders(std::vector<MeshMetadataPtr> &metadata,
+    std::vector<vtkCompositeDataSet*> &dobjects);
+
+  // hands a step to the background writer, applying the queue policy.
+  // changed holds the changes found before the gather when aggregating
+  int WriteTimestepAsynchronous(unsigned long timeStep, double time,
+    const std::vector<MeshMetadataPtr> &metadata,
+    const std::vector<vtkCompositeDataSet*> &dobjects,
+    const std::vector<std::vector<int>> &changed);
+
+  // stops the background writer after the queued steps have been written
+  int StopWriter();
+
   senseiADIOS2::DataObjectCollectionSchema *Schema;
   sensei::DataRequirements Requirements;
   std::string EngineName;
@@ -84,6 +247,30 @@ protected:
   adios2_adios *Adios;
   std::vector<std::pair<std::string,std::string>> Parameters;
   int DebugMode;
+  unsigned long AggregateBlocks;
+  unsigned int ProgressiveLevels;
+  unsigned int MetadataKeyFrames;
+  bool TrackChanges;
+  ArrayChangeTracker ChangeTracker;
+  bool NodeAggregation;
+  NodeAggregator Aggregator;
+
+  // the array operations, see AddArrayOperation
+  struct OperationSpec
+  {
+    std::string ArrayName;
+    std::string Type;
+    std::vector<std::pair<std::string,std::string>> Parameters;
+  };
+  std::vector<OperationSpec> Operations;
+
+  struct WriterType;
+  WriterType *Writer;
+
+  int StepPolicy;
+  unsigned int StepPolicyCount;
+  unsigned long NumSteps;
+  unsigned long NumStepsSkipped;
 
 private:
   ADIOS2AnalysisAdaptor(const ADIOS2AnalysisAdaptor&) = delete;
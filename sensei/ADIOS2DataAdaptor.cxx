@@ -63,6 +63,24 @@ int ADIOS2DataAdaptor::SetDebugMode(int mode)
   return this->Internals->Stream.SetDebugMode(mode);
 }
 
+//----------------------------------------------------------------------------
+void ADIOS2DataAdaptor::SetStructureOfArrays(int val)
+{
+  this->Internals->Stream.StructureOfArrays = val;
+}
+
+//----------------------------------------------------------------------------
+void ADIOS2DataAdaptor::SetRefinementBudget(double seconds)
+{
+  this->Internals->Schema.SetRefinementBudget(seconds);
+}
+
+//----------------------------------------------------------------------------
+void ADIOS2DataAdaptor::SetNumberOfThreads(int nThreads)
+{
+  this->Internals->Schema.SetNumberOfThreads(nThreads);
+}
+
 //----------------------------------------------------------------------------
 int ADIOS2DataAdaptor::AddParameter(const std::string &name,
   const std::string &value)
@@ -103,6 +121,12 @@ int ADIOS2DataAdaptor::Initialize(pugi::xml_node &node)
 
   this->SetDebugMode(node.attribute("debug_mode").as_int(0));
 
+  this->SetStructureOfArrays(node.attribute("structure_of_arrays").as_int(0));
+
+  this->SetRefinementBudget(node.attribute("refinement_budget").as_double(-1.0));
+
+  this->SetNumberOfThreads(node.attribute("threads").as_int(1));
+
   return 0;
 }
 
@@ -118,6 +142,10 @@ int ADIOS2DataAdaptor::OpenStream()
 {
   TimeEvent<128> mark("ADIOS2DataAdaptor::OpenStream");
 
+  // have the SST engine skip to the newest step on each advance
+  if (this->GetStepPolicy() == STEP_POLICY_LATEST)
+    this->Internals->Stream.AddParameter("AlwaysProvideLatestTimestep", "true");
+
   if (this->Internals->Stream.Open(this->GetCommunicator()))
     {
     SENSEI_ERROR("Failed to open stream")
@@ -128,6 +156,8 @@ int ADIOS2DataAdaptor::OpenStream()
   if (this->UpdateTimeStep())
     return -1;
 
+  this->CountSteps(1, 0);
+
   return 0;
 }
 
@@ -152,12 +182,20 @@ int ADIOS2DataAdaptor::AdvanceStream()
 {
   TimeEvent<128> mark("ADIOS2DataAdaptor::AdvanceStream");
 
-  if (this->Internals->Stream.AdvanceTimeStep())
-    return -1;
+  // steps skipped by the step policy are opened and closed without
+  // reading anything
+  unsigned int stride = this->GetStepStride();
+  for (unsigned int i = 0; i < stride; ++i)
+    {
+    if (this->Internals->Stream.AdvanceTimeStep())
+      return -1;
+    }
 
   if (this->UpdateTimeStep())
     return -1;
 
+  this->CountSteps(1, stride - 1);
+
   return 0;
 }
 
@@ -166,28 +204,41 @@ int ADIOS2DataAdaptor::UpdateTimeStep()
 {
   TimeEvent<128> mark("ADIOS2DataAdaptor::UpdateTimeStep");
 
-  // update data object time and time step
-  unsigned long timeStep = 0;
-  double time = 0.0;
-
-  if (this->Internals->Schema.ReadTimeStep(this->GetCommunicator(),
-    this->Internals->Stream, timeStep, time))
+  // steps whose metadata can't be decoded because an earlier step was
+  // missed are moved past until a key frame is found
+  int ierr = 0;
+  do
     {
-    SENSEI_ERROR("Failed to update time step")
-    return -1;
-    }
+    if ((ierr > 0) && this->Internals->Stream.AdvanceTimeStep())
+      return -1;
 
-  this->SetDataTimeStep(timeStep);
+    // update data object time and time step
+    unsigned long timeStep = 0;
+    double time = 0.0;
 
-  this->SetDataTime(time);
+    if (this->Internals->Schema.ReadTimeStep(this->GetCommunicator(),
+      this->Internals->Stream, timeStep, time))
+      {
+      SENSEI_ERROR("Failed to update time step")
+      return -1;
+      }
 
-  // read metadata
-  if (this->Internals->Schema.ReadMeshMetadata(this->GetCommunicator(),
-    this->Internals->Stream))
-    {
-    SENSEI_ERROR("Failed to read metadata")
-    return -1;
+    this->SetDataTimeStep(timeStep);
+
+    this->SetDataTime(time);
+
+    // read metadata
+    if ((ierr = this->Internals->Schema.ReadMeshMetadata(
+      this->GetCommunicator(), this->Internals->Stream)) < 0)
+      {
+      SENSEI_ERROR("Failed to read metadata")
+      return -1;
+      }
+
+    if (ierr > 0)
+      this->CountSteps(0, 1);
     }
+  while (ierr > 0);
 
   // set up the name-object map
   unsigned int nMeshes = 0;
@@ -242,7 +293,7 @@ int ADIOS2DataAdaptor::GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadat
 
     // we did this already, return cached layout
     if (metadata)
-       return 0;
+      return this->ApplyDataRequirements(metadata);
 
     // first time through. use the partitioner to figure it out.
     // get the sender layout.
@@ -269,12 +320,21 @@ int ADIOS2DataAdaptor::GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadat
       this->CloseStream();
       }
 
+    // leave the AMR levels the analyses do not need on the sender
+    if (this->ApplyLevelRequirements(receiverMd))
+      {
+      SENSEI_ERROR("Failed to select the required levels")
+      this->CloseStream();
+      return -1;
+      }
+
     // cache and return the new layout
     this->Internals->Schema.SetReceiverMeshMetadata(id, receiverMd);
     metadata = receiverMd;
     }
 
-  return 0;
+  // pass only the arrays the analyses require
+  return this->ApplyDataRequirements(metadata);
 }
 
 //----------------------------------------------------------------------------
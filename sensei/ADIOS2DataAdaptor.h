@@ -30,6 +30,26 @@ public:
   // enable/disable adios internal debug messages
   int SetDebugMode(int mode);
 
+  // when set multi-component arrays are read into vtkSOADataArrayTemplate,
+  // one buffer per component, rather than interleaved. requires VTK
+  // generic arrays. default off
+  void SetStructureOfArrays(int val);
+
+  // limit the time spent reading the data arrays of uniform meshes written
+  // with subsampled copies, see ADIOS2AnalysisAdaptor::SetProgressiveLevels.
+  // the coarsest copy is always read, finer ones and then the full array
+  // while the seconds since the step's metadata was read remain below the
+  // budget. otherwise the finest copy read is expanded onto the blocks, the
+  // arrays keep their size and analyses see a smoothed field. negative, the
+  // default, reads the full arrays
+  void SetRefinementBudget(double seconds);
+
+  // the number of threads of the TaskRuntime the received blocks are
+  // built on, converting arrays and assembling cells once the reads of
+  // all of the local blocks complete. a value less than 1 uses all of
+  // them. the default is 1
+  void SetNumberOfThreads(int nThreads);
+
   // add name value pairs to pass into ADIOS after the
   // engine has been created
   int AddParameter(const std::string &name, const std::string &value);
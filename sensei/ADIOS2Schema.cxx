@@ -4,6 +4,10 @@
 #include "Partitioner.h"
 #include "VTKUtils.h"
 #include "MPIUtils.h"
+#include "DataRequirements.h"
+#include "BlockReadPlan.h"
+#include "BufferPool.h"
+#include "TaskRuntime.h"
 #include "Error.h"
 #include "Profiler.h"
 
@@ -11,6 +15,7 @@
 #include <vtkCellData.h>
 #include <vtkCompositeDataIterator.h>
 #include <vtkCompositeDataSet.h>
+#include <vtkDataSet.h>
 #include <vtkDataSetAttributes.h>
 #include <vtkDoubleArray.h>
 #include <vtkFloatArray.h>
@@ -43,11 +48,14 @@
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
 #include <vtkSmartPointer.h>
+#include <vtkIdList.h>
 
 #include <mpi.h>
 #include <adios2_c.h>
 
 #include <vector>
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <set>
 #include <string>
@@ -235,6 +243,173 @@ unsigned int size(int vtkt)
     }
   return 0;
 }
+
+// --------------------------------------------------------------------------
+// define a variable. variables persist across steps, when the variable was
+// defined on an earlier step with the same type it is reused and only its
+// shape is updated, so that the engine's metadata is not rebuilt. the
+// selection is set by the writer before each put
+adios2_variable *defineVariable(adios2_io *io, const char *path,
+  adios2_type type, size_t ndims, const size_t *shape, const size_t *start,
+  const size_t *count, adios2_constant_dims constant_dims)
+{
+  adios2_variable *var = adios2_inquire_variable(io, path);
+  if (var)
+    {
+    adios2_type var_type = adios2_type_unknown;
+    if (!adios2_variable_type(&var_type, var) && (var_type == type))
+      {
+      if (ndims && !constant_dims && adios2_set_shape(var, ndims, shape))
+        {
+        SENSEI_ERROR("adios2_set_shape \"" << path << "\" failed")
+        return nullptr;
+        }
+      return var;
+      }
+
+    // the type changed
+    adios2_bool removed = adios2_false;
+    adios2_remove_variable(&removed, io, path);
+    }
+
+  return adios2_define_variable(io, path, type, ndims, shape,
+    start, count, constant_dims);
+}
+
+// --------------------------------------------------------------------------
+// the variables of the step being read, each looked up once by path. the
+// engine may replace its variables when a step begins, so the table is
+// cleared when the step's metadata is read
+struct VariableTable
+{
+  adios2_variable *Get(adios2_io *io, const std::string &path)
+  {
+    std::map<std::string, adios2_variable*>::iterator it =
+      this->Variables.find(path);
+
+    if (it != this->Variables.end())
+      return it->second;
+
+    adios2_variable *var = adios2_inquire_variable(io, path.c_str());
+    if (var)
+      this->Variables[path] = var;
+
+    return var;
+  }
+
+  void Clear() { this->Variables.clear(); }
+
+  std::map<std::string, adios2_variable*> Variables;
+};
+
+// --------------------------------------------------------------------------
+// write the values of a VTK array to the current selection of var. Arrays
+// with the standard contiguous layout are passed to the engine in deferred
+// mode, the caller keeps them alive until the step ends, so that the engine
+// copies them once into its buffers. Other layouts, such as structure of
+// arrays, are interleaved in a single pass into a temporary that is written
+// in sync mode and released immediately. This avoids GetVoidPointer, which
+// for such arrays caches an interleaved copy for the life of the array.
+// When the variable is of another type, vtkt, the values are converted in
+// the same pass.
+int putArray(adios2_engine *engine, adios2_variable *var, vtkDataArray *da,
+  int vtkt = -1)
+{
+  if ((vtkt >= 0) && (vtkt != da->GetDataType()))
+    {
+    std::vector<unsigned char> tmp(da->GetNumberOfValues()*size(vtkt));
+    if (sensei::VTKUtils::ExportToType(da, vtkt, tmp.data()))
+      return -1;
+    return adios2_put(engine, var, tmp.data(), adios2_mode_sync) ? -1 : 0;
+    }
+#if defined(ENABLE_VTK_GENERIC_ARRAYS)
+  if (!da->HasStandardMemoryLayout())
+    {
+    std::vector<unsigned char> tmp(da->GetNumberOfValues()*da->GetDataTypeSize());
+    da->ExportToVoidPointer(tmp.data());
+    return adios2_put(engine, var, tmp.data(), adios2_mode_sync) ? -1 : 0;
+    }
+#endif
+  return adios2_put(engine, var, da->GetVoidPointer(0),
+    adios2_mode_deferred) ? -1 : 0;
+}
+
+// --------------------------------------------------------------------------
+// the dimensions of a block of a uniform mesh in points or cells
+void blockDims(const int *ext, int cen, long dims[3])
+{
+  for (int d = 0; d < 3; ++d)
+    {
+    long n = ext[2*d + 1] - ext[2*d];
+    dims[d] = cen == vtkDataObject::POINT ? n + 1 : std::max(n, 1l);
+    }
+}
+
+// --------------------------------------------------------------------------
+// the number of tuples of a block subsampled by stride in each direction
+size_t coarseTuples(const int *ext, int cen, long stride)
+{
+  long dims[3];
+  blockDims(ext, cen, dims);
+
+  size_t n = 1;
+  for (int d = 0; d < 3; ++d)
+    n *= (dims[d] + stride - 1)/stride;
+
+  return n;
+}
+
+// --------------------------------------------------------------------------
+// subsample the array of a block of a uniform mesh by stride, coarse tuple
+// c taking the value of fine tuple c*stride in each direction. when
+// prolong is set the array is coarse and each fine tuple takes the value
+// of the coarse tuple that sampled its group. the caller takes the
+// reference. returns nullptr if the array does not match the extent
+vtkDataArray *resample(vtkDataArray *da, const int *ext, int cen,
+  long stride, bool prolong)
+{
+  long fdims[3];
+  blockDims(ext, cen, fdims);
+
+  long cdims[3];
+  for (int d = 0; d < 3; ++d)
+    cdims[d] = (fdims[d] + stride - 1)/stride;
+
+  const long *src = prolong ? cdims : fdims;
+  const long *dst = prolong ? fdims : cdims;
+
+  if (da->GetNumberOfTuples() != src[0]*src[1]*src[2])
+    return nullptr;
+
+  vtkIdList *ids = vtkIdList::New();
+  ids->SetNumberOfIds(dst[0]*dst[1]*dst[2]);
+
+  vtkIdType q = 0;
+  for (long k = 0; k < dst[2]; ++k)
+    {
+    for (long j = 0; j < dst[1]; ++j)
+      {
+      for (long i = 0; i < dst[0]; ++i)
+        {
+        vtkIdType id = prolong ?
+          (i/stride) + src[0]*((j/stride) + src[1]*(k/stride)) :
+          (i*stride) + src[0]*((j*stride) + src[1]*(k*stride));
+        ids->SetId(q++, id);
+        }
+      }
+    }
+
+  vtkDataArray *out = vtkDataArray::CreateDataArray(da->GetDataType());
+  out->SetNumberOfComponents(da->GetNumberOfComponents());
+  out->SetNumberOfTuples(q);
+  out->SetName(da->GetName());
+  da->GetTuples(ids, out);
+
+  ids->Delete();
+
+  return out;
+}
+
 // --------------------------------------------------------------------------
 int isLegacyDataObject(int code)
 {
@@ -417,6 +592,15 @@ int adiosInq(InputStream &iStream, const std::string &path, val_t &val)
   return 0;
 }
 
+// --------------------------------------------------------------------------
+// get a scalar that writers of earlier revisions do not write. returns
+// false when it is not in the stream
+template <typename val_t>
+bool adiosInqOptional(InputStream &iStream, const std::string &path, val_t &val)
+{
+  adios2_variable *var = adios2_inquire_variable(iStream.Handles.io, path.c_str());
+  return var && !adios2_get(iStream.Handles.engine, var, &val, adios2_mode_sync);
+}
 
 
 
@@ -443,7 +627,7 @@ int BinaryStreamSchema::DefineVariables(AdiosHandle handles,
 
   // define the stream
   size_t defaultSize = 1024;
-  if (!adios2_define_variable(handles.io, path.c_str(),
+  if (!defineVariable(handles.io, path.c_str(),
     adios2_type_int8_t, 1, &defaultSize, &defaultSize,
     &defaultSize, adios2_constant_dims_false))
     {
@@ -536,7 +720,7 @@ int BinaryStreamSchema::Write(AdiosHandle handles, const std::string &path,
 class VersionSchema
 {
 public:
-  VersionSchema() : Revision(3), LowestCompatibleRevision(3) {}
+  VersionSchema() : Revision(6), LowestCompatibleRevision(6) {}
 
   int DefineVariables(AdiosHandle handles);
 
@@ -555,7 +739,7 @@ int VersionSchema::DefineVariables(AdiosHandle handles)
   sensei::TimeEvent<128> mark(
     "senseiADIOS2::VersionSchema::DefineVariables");
 
-  if (!adios2_define_variable(handles.io, "DataObjectSchema",
+  if (!defineVariable(handles.io, "DataObjectSchema",
     adios2_type_uint32_t, 0, NULL, NULL, NULL, adios2_constant_dims_true))
     {
     SENSEI_ERROR("adios2_define_variable DataObjectSchema failed")
@@ -799,6 +983,42 @@ int InputStream::Close()
 
 
 
+// --------------------------------------------------------------------------
+// the number of levels whose blocks are stored in separate variables
+unsigned int numLevels(const sensei::MeshMetadataPtr &md)
+{
+  return sensei::VTKUtils::AMR(md) ? std::max(1, md->NumLevels) : 1;
+}
+
+// --------------------------------------------------------------------------
+// the levels of the blocks, empty when the blocks are not stored level by
+// level
+const std::vector<int> &blockLevels(const sensei::MeshMetadataPtr &md)
+{
+  static const std::vector<int> none;
+  return numLevels(md) > 1 ? md->BlockLevel : none;
+}
+
+// --------------------------------------------------------------------------
+int blockLevel(const std::vector<int> &block_level, unsigned int j)
+{
+  return block_level.empty() ? 0 : block_level[j];
+}
+
+// --------------------------------------------------------------------------
+// the namespace of a level's variables
+std::string levelPath(const std::string &ans, unsigned int level,
+  unsigned int num_levels)
+{
+  if (num_levels < 2)
+    return ans;
+
+  std::ostringstream lns;
+  lns << ans << "level_" << level << "/";
+  return lns.str();
+}
+
+
 struct ArraySchema
 {
   int DefineVariables(MPI_Comm comm, AdiosHandle handles,
@@ -806,198 +1026,377 @@ struct ArraySchema
 
   int DefineVariable(MPI_Comm comm, AdiosHandle handles, const std::string &ons,
     int i, int array_type, int num_components, int array_cen,
-    unsigned long long num_points_total, unsigned long long num_cells_total,
     unsigned int num_blocks, const std::vector<long> &block_num_points,
     const std::vector<long> &block_num_cells,
-    const std::vector<int> &block_owner, std::vector<size_t> &putVarsStart,
-    std::vector<size_t> &putVarsCount, adios2_variable *&putVar);
-
-  int Write(MPI_Comm comm, AdiosHandle handles,
-    const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
-
+    const std::vector<int> &block_owner, const std::vector<int> &block_level,
+    unsigned int num_levels, std::vector<size_t> &putVarsStart,
+    std::vector<size_t> &putVarsCount, adios2_variable **putVar);
+
+  // when changed is given the data arrays flagged 0 that were written
+  // earlier are skipped, readers reuse the copy they read then
+  int Write(MPI_Comm comm, AdiosHandle handles, const std::string &ons,
+    const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj,
+    const std::vector<int> *changed);
+
+  // array_type is the type of the variable, the arrays are converted to
+  // it when they differ
   int Write(MPI_Comm comm, AdiosHandle handles, unsigned int i,
-    const std::string &array_name, int array_cen, vtkCompositeDataSet *dobj,
-    unsigned int num_blocks, const std::vector<int> &block_owner,
-    const std::vector<size_t> &putVarsStart, const std::vector<size_t> &putVarsCount,
-    adios2_variable *putVar);
-
+    const std::string &array_name, int array_type, int num_components,
+    int array_cen, vtkCompositeDataSet *dobj, unsigned int num_blocks,
+    const std::vector<int> &block_owner, const std::vector<int> &block_level,
+    const std::vector<size_t> &putVarsStart,
+    const std::vector<size_t> &putVarsCount, adios2_variable *const *putVar);
+
+  // write runs of adjacent small blocks with a single put each
+  int WriteAggregated(MPI_Comm comm, AdiosHandle handles, unsigned int i,
+    const std::string &array_name, int array_type, int num_components,
+    int array_cen, vtkCompositeDataSet *dobj, unsigned int num_blocks,
+    const std::vector<int> &block_owner, const std::vector<int> &block_level,
+    const std::vector<size_t> &putVarsStart,
+    const std::vector<size_t> &putVarsCount, adios2_variable *const *putVar);
+
+  // when soa is set multi-component arrays are read into
+  // vtkSOADataArrayTemplate
   int Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons,
     const std::string &array_name, int centering,
-    const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
+    const sensei::MeshMetadataPtr &md, int soa, vtkCompositeDataSet *dobj);
 
+  // block_extents are given for the data arrays of uniform meshes, whose
+  // subsampled copies may be read in place of the array
   int Read(MPI_Comm comm, AdiosHandle handles , const std::string &ons,
     unsigned int i, const std::string &array_name, int array_type,
     unsigned long long num_components, int array_cen, unsigned int num_blocks,
     const std::vector<long> &block_num_points,
     const std::vector<long> &block_num_cells, const std::vector<int> &block_owner,
+    const std::vector<int> &block_level, unsigned int num_levels,
+    int soa, vtkCompositeDataSet *dobj,
+    const std::vector<std::array<int,6>> *block_extents = nullptr);
+
+  // true when subsampled copies of the mesh's data arrays are written
+  bool Progressive(const sensei::MeshMetadataPtr &md) const;
+
+  // define and write the subsampled copies of data array i
+  int DefineCoarseVariables(AdiosHandle handles, const std::string &ons,
+    const sensei::MeshMetadataPtr &md, unsigned int i, int array_type);
+
+  int WriteCoarse(MPI_Comm comm, AdiosHandle handles, const std::string &ons,
+    const sensei::MeshMetadataPtr &md, unsigned int i, int array_type,
     vtkCompositeDataSet *dobj);
 
+  // read the subsampled copies of a data array, coarsest first, while the
+  // refinement budget lasts. when it runs out before the full array is
+  // read the finest copy read is prolonged onto the local blocks, arrays
+  // is set to them and done is set
+  int ReadCoarse(MPI_Comm comm, AdiosHandle handles, const std::string &ans,
+    const std::string &array_name, int array_type,
+    unsigned long long num_components, int array_cen, unsigned int num_blocks,
+    const std::vector<int> &block_owner,
+    const std::vector<std::array<int,6>> &block_extents,
+    vtkCompositeDataSet *dobj,
+    std::vector<std::pair<vtkDataSetAttributes*, vtkDataArray*>> &arrays,
+    bool &done);
+
+  // true when the step's refinement budget is spent on any rank. collective
+  bool BudgetSpent(MPI_Comm comm) const;
+
+  // the first tuple and number of tuples of each local block, and the
+  // variables of each array, one per level for AMR, indexed by
+  // array*num_levels + level
   std::map<std::string,std::vector<size_t>> PutVarsStart;
   std::map<std::string,std::vector<size_t>> PutVarsCount;
   std::map<std::string,std::vector<adios2_variable*>> PutVars;
+  std::map<std::string,sensei::BlockReadPlan> ReadPlans;
+  VariableTable ReadVariables;
+
+  // blocks of at most this many tuples are coalesced, 0 disables
+  unsigned long AggregateBlocks = 0;
+
+  // the precision at which each array is stored
+  sensei::DataRequirements Precision;
+
+  // the steps each mesh was written at, counted from 1, and the step at
+  // which each of its data arrays was last written, 0 when it has not
+  // been since its variables were defined
+  std::map<std::string,unsigned long> DataStep;
+  std::map<std::string,std::vector<unsigned long>> WrittenStep;
+
+  // the arrays read for the local blocks, kept for the steps in which the
+  // writer skips them
+  struct CachedArray
+  {
+    CachedArray() : Valid(false), Step(0) {}
+    bool Valid;
+    unsigned long Step;
+    std::vector<unsigned int> Blocks;
+    std::vector<vtkSmartPointer<vtkDataArray>> Arrays;
+  };
+
+  std::map<std::string,CachedArray> ReadCache;
+
+  // keep the arrays read for the steps in which they are not written
+  void CacheArrays(CachedArray &cache, unsigned long step,
+    std::vector<unsigned int> &local_blocks,
+    const std::vector<std::pair<vtkDataSetAttributes*, vtkDataArray*>> &arrays);
+
+  // the number of subsampled copies of the data arrays of uniform meshes
+  // that are written, copy l is subsampled by 2^l in each direction
+  unsigned int ProgressiveLevels = 0;
+
+  // the seconds from the start of a step during which finer copies are
+  // read. when negative the full arrays are read
+  double RefinementBudget = -1.0;
+  double StepStart = 0.0;
+
+  // the threads the arrays read at another type are converted on
+  int Threads = 1;
 };
 
+// --------------------------------------------------------------------------
+bool ArraySchema::Progressive(const sensei::MeshMetadataPtr &md) const
+{
+  return this->ProgressiveLevels && sensei::VTKUtils::UniformCartesian(md) &&
+    !sensei::VTKUtils::AMR(md) && (md->BlockExtents.size() ==
+    static_cast<unsigned int>(md->NumBlocks));
+}
 
 // --------------------------------------------------------------------------
-int ArraySchema::DefineVariable(MPI_Comm comm, AdiosHandle handles,
-  const std::string &ons, int i, int array_type, int num_components,
-  int array_cen, unsigned long long num_points_total,
-  unsigned long long num_cells_total, unsigned int num_blocks,
-  const std::vector<long> &block_num_points,
-  const std::vector<long> &block_num_cells,
-  const std::vector<int> &block_owner,
-  std::vector<size_t> &putVarsStart,
-  std::vector<size_t> &putVarsCount,
-  adios2_variable *&putVar)
+bool ArraySchema::BudgetSpent(MPI_Comm comm) const
 {
-  sensei::TimeEvent<128> mark("senseiADIOS2::ArraySchema::DefineVariable");
+  // the ranks agree so that all of the blocks are at the same resolution
+  double elapsed = MPI_Wtime() - this->StepStart;
+  MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, comm);
+  return elapsed > this->RefinementBudget;
+}
 
-  int rank = 0;
-  MPI_Comm_rank(comm, &rank);
+// --------------------------------------------------------------------------
+int ArraySchema::DefineCoarseVariables(AdiosHandle handles,
+  const std::string &ons, const sensei::MeshMetadataPtr &md, unsigned int i,
+  int array_type)
+{
+  int array_cen = md->ArrayCentering[i];
+  unsigned int num_blocks = md->NumBlocks;
 
-  // validate centering
-  if ((array_cen != vtkDataObject::POINT) && (array_cen != vtkDataObject::CELL))
+  for (unsigned int l = 1; l <= this->ProgressiveLevels; ++l)
     {
-    SENSEI_ERROR("Invalid array centering at array " << i)
-    return -1;
-    }
+    long stride = 1l << l;
 
-  // put each data array in its own namespace
-  std::ostringstream ans;
-  ans << ons << "data_array_" << i << "/";
+    size_t num_tuples = 0;
+    for (unsigned int j = 0; j < num_blocks; ++j)
+      num_tuples += coarseTuples(md->BlockExtents[j].data(), array_cen, stride);
 
-   // /data_object_<id>/data_array_<id>/data
-  std::string path = ans.str() + "data";
+    // /data_object_<id>/data_array_<id>/coarse_<l>/data
+    std::ostringstream path;
+    path << ons << "data_array_" << i << "/coarse_" << l << "/data";
 
-  // select global size either point or cell data
-  unsigned long num_elem_total = (array_cen == vtkDataObject::POINT ?
-    num_points_total : num_cells_total)*num_components;
+    size_t shape[2] = {num_tuples, size_t(md->ArrayComponents[i])};
+    size_t start[2] = {0, 0};
+    size_t count[2] = {0, 0};
 
-  // adios2 type of the array
-  adios2_type elem_type = adiosType(array_type);
+    if (!defineVariable(handles.io, path.str().c_str(), adiosType(array_type),
+      2, shape, start, count, adios2_constant_dims_false))
+      {
+      SENSEI_ERROR("adios2_define_variable \"" << path.str() << "\" failed")
+      return -1;
+      }
+    }
 
-  // unlike ADIOS1 in ADIOS2 you can't define the variable once for
-  // each write. Instead define it once with an empty size. and calculate
-  // all the book keeping info to later write each block's chunk of
-  // the array in the correct spot.
+  return 0;
+}
 
-  size_t localStart = 0;
-  size_t localCount = 0;
+// --------------------------------------------------------------------------
+int ArraySchema::WriteCoarse(MPI_Comm comm, AdiosHandle handles,
+  const std::string &ons, const sensei::MeshMetadataPtr &md, unsigned int i,
+  int array_type, vtkCompositeDataSet *dobj)
+{
+  sensei::TimeEvent<128> mark("senseiADIOS2::ArraySchema::WriteCoarse");
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
 
-  putVar = adios2_define_variable(handles.io,
-     path.c_str(), elem_type, 1, &num_elem_total, &localStart,
-     &localCount, adios2_constant_dims_false);
+  const std::string &array_name = md->ArrayName[i];
+  int array_cen = md->ArrayCentering[i];
+  size_t num_components = md->ArrayComponents[i];
+  unsigned int num_blocks = md->NumBlocks;
 
-  if (!putVar)
+  for (unsigned int l = 1; l <= this->ProgressiveLevels; ++l)
     {
-    SENSEI_ERROR("adios2_define_variable failed with "
-      << "num_elem_total=" << num_elem_total << " path=\""
-      << path << "\"")
-    }
+    long stride = 1l << l;
 
-  unsigned long block_offset = 0;
-  for (unsigned int j = 0; j < num_blocks; ++j)
-    {
-    // get the block size
-    unsigned long num_elem_local = (array_cen == vtkDataObject::POINT ?
-      block_num_points[j] : block_num_cells[j])*num_components;
+    std::ostringstream path;
+    path << ons << "data_array_" << i << "/coarse_" << l << "/data";
 
-    // define the variable for a local block
-    if (block_owner[j] == rank)
+    adios2_variable *var = adios2_inquire_variable(handles.io, path.str().c_str());
+    if (!var)
       {
-      // save the var attr. to use later for putting
-      putVarsStart[i*num_blocks + j] = block_offset;
-      putVarsCount[i*num_blocks + j] = num_elem_local;
+      SENSEI_ERROR("adios2_inquire_variable \"" << path.str() << "\" failed")
+      return -1;
       }
 
-    // update the block offset
-    block_offset += num_elem_local;
-    }
+    vtkCompositeDataIterator *it = dobj->NewIterator();
+    it->SetSkipEmptyNodes(0);
+    it->InitTraversal();
 
-  return 0;
-}
+    // the copies are temporary and written in sync mode
+    size_t offset = 0;
+    for (unsigned int j = 0; j < num_blocks; ++j)
+      {
+      const int *ext = md->BlockExtents[j].data();
+      size_t num_tuples = coarseTuples(ext, array_cen, stride);
 
-// --------------------------------------------------------------------------
-int ArraySchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
-  const std::string &ons, const sensei::MeshMetadataPtr &md)
-{
-  sensei::TimeEvent<128> mark(
-    "senseiADIOS2::ArraySchema::DefineVariables");
+      if (md->BlockOwner[j] == rank)
+        {
+        vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+        vtkDataSetAttributes *dsa = !ds ? nullptr :
+          array_cen == vtkDataObject::POINT ?
+          dynamic_cast<vtkDataSetAttributes*>(ds->GetPointData()) :
+          dynamic_cast<vtkDataSetAttributes*>(ds->GetCellData());
 
-  std::vector<size_t> &putVarsStart = this->PutVarsStart[md->MeshName];
-  std::vector<size_t> &putVarsCount = this->PutVarsCount[md->MeshName];
-  std::vector<adios2_variable*> &putVars = this->PutVars[md->MeshName];
+        vtkDataArray *da = dsa ? dsa->GetArray(array_name.c_str()) : nullptr;
 
-  // allocate write ids
-  unsigned int num_blocks = md->NumBlocks;
-  unsigned int num_arrays = md->NumArrays;
+        vtkDataArray *coarse = nullptr;
+        if (!da || !(coarse = resample(da, ext, array_cen, stride, false)))
+          {
+          SENSEI_ERROR("Failed to subsample array \"" << array_name
+            << "\" block " << j)
+          it->Delete();
+          return -1;
+          }
 
-  bool have_ghost_cells = md->NumGhostCells || sensei::VTKUtils::AMR(md);
+        vtkDataArray *stored = sensei::VTKUtils::NewArrayOfType(coarse, array_type);
+        coarse->Delete();
 
-  unsigned int num_ghost_arrays =
-    (have_ghost_cells ? 1 : 0) + (md->NumGhostNodes ? 1 : 0);
+        size_t start[2] = {offset, 0};
+        size_t count[2] = {num_tuples, num_components};
 
-  unsigned int num_arrays_total = num_arrays + num_ghost_arrays;
+        if (!stored || adios2_set_selection(var, 2, start, count) ||
+          adios2_put(handles.engine, var, stored->GetVoidPointer(0),
+            adios2_mode_sync))
+          {
+          SENSEI_ERROR("adios2_put \"" << path.str() << "\" block "
+            << j << " failed")
+          if (stored)
+            stored->Delete();
+          it->Delete();
+          return -1;
+          }
 
-  putVarsStart.resize(num_blocks*num_arrays_total);
-  putVarsCount.resize(num_blocks*num_arrays_total);
-  putVars.resize(num_arrays_total);
+        stored->Delete();
+        }
 
-  // compute global sizes
-  unsigned long long num_points_total = 0;
-  unsigned long long num_cells_total = 0;
-  for (unsigned int j = 0; j < num_blocks; ++j)
-    {
-    num_points_total += md->BlockNumPoints[j];
-    num_cells_total += md->BlockNumCells[j];
-    }
+      offset += num_tuples;
+      it->GoToNextItem();
+      }
 
-  // define data arrays
-  for (unsigned int i = 0; i < num_arrays; ++i)
-    {
-    if (this->DefineVariable(comm, handles, ons, i, md->ArrayType[i],
-      md->ArrayComponents[i], md->ArrayCentering[i], num_points_total,
-      num_cells_total, num_blocks, md->BlockNumPoints, md->BlockNumCells,
-      md->BlockOwner, putVarsStart, putVarsCount, putVars[i]))
-      return -1;
+    it->Delete();
     }
 
-  // define ghost arrays
-  if (have_ghost_cells && this->DefineVariable(comm, handles, ons,
-      num_arrays, VTK_UNSIGNED_CHAR, 1, vtkDataObject::CELL, num_points_total,
-      num_cells_total, num_blocks, md->BlockNumPoints, md->BlockNumCells,
-      md->BlockOwner, putVarsStart, putVarsCount, putVars[num_arrays]))
-      return -1;
-
-  if (md->NumGhostNodes && this->DefineVariable(comm, handles, ons,
-      num_arrays, VTK_UNSIGNED_CHAR, 1, vtkDataObject::POINT, num_points_total,
-      num_cells_total, num_blocks, md->BlockNumPoints, md->BlockNumCells,
-      md->BlockOwner, putVarsStart, putVarsCount,
-      putVars[num_arrays + (have_ghost_cells ? 1 : 0)]))
-      return -1;
-
   return 0;
 }
 
 // --------------------------------------------------------------------------
-int ArraySchema::Write(MPI_Comm comm, AdiosHandle handles, unsigned int i,
-  const std::string &array_name, int array_cen, vtkCompositeDataSet *dobj,
-  unsigned int num_blocks, const std::vector<int> &block_owner,
-  const std::vector<size_t> &putVarsStart,
-  const std::vector<size_t> &putVarsCount,
-  adios2_variable *putVar)
+int ArraySchema::ReadCoarse(MPI_Comm comm, AdiosHandle handles,
+  const std::string &ans, const std::string &array_name, int array_type,
+  unsigned long long num_components, int array_cen, unsigned int num_blocks,
+  const std::vector<int> &block_owner,
+  const std::vector<std::array<int,6>> &block_extents,
+  vtkCompositeDataSet *dobj,
+  std::vector<std::pair<vtkDataSetAttributes*, vtkDataArray*>> &arrays,
+  bool &done)
 {
-  sensei::Profiler::StartEvent("senseiADIOS2::ArraySchema::Write");
-  long long numBytes = 0ll;
+  done = false;
+
+  if ((this->RefinementBudget < 0.0) ||
+    (block_extents.size() != num_blocks))
+    return 0;
+
+  // the copies written in this step
+  // /data_object_<id>/data_array_<id>/coarse_<l>/data
+  std::vector<adios2_variable*> vars(1, nullptr);
+  while (true)
+    {
+    std::ostringstream path;
+    path << ans << "coarse_" << vars.size() << "/data";
+    adios2_variable *var = this->ReadVariables.Get(handles.io, path.str());
+    if (!var)
+      break;
+    vars.push_back(var);
+    }
+
+  unsigned int num_coarse = vars.size() - 1;
+  if (!num_coarse)
+    return 0;
+
+  sensei::TimeEvent<128> mark("senseiADIOS2::ArraySchema::ReadCoarse");
 
   int rank = 0;
   MPI_Comm_rank(comm, &rank);
 
+  // an array stored at reduced precision is converted once prolonged
+  int stored_type = array_type;
+  adios2_type var_type = adios2_type_unknown;
+  if ((array_type == VTK_DOUBLE) && !adios2_variable_type(&var_type, vars[1]) &&
+    (var_type == adios2_type_float))
+    stored_type = VTK_FLOAT;
+
+  // the coarsest copy is always read, each finer one while time remains
+  std::vector<vtkSmartPointer<vtkDataArray>> coarse;
+  unsigned int level = 0;
+  for (unsigned int l = num_coarse; l > 0; --l)
+    {
+    if ((l < num_coarse) && this->BudgetSpent(comm))
+      break;
+
+    long stride = 1l << l;
+
+    std::vector<vtkSmartPointer<vtkDataArray>> level_arrays;
+    size_t offset = 0;
+    for (unsigned int j = 0; j < num_blocks; ++j)
+      {
+      size_t num_tuples = coarseTuples(block_extents[j].data(), array_cen, stride);
+
+      if (block_owner[j] == rank)
+        {
+        vtkDataArray *da = vtkDataArray::CreateDataArray(stored_type);
+        da->SetNumberOfComponents(num_components);
+        da->SetNumberOfTuples(num_tuples);
+        da->SetName(array_name.c_str());
+        level_arrays.push_back(da);
+        da->Delete();
+
+        size_t start[2] = {offset, 0};
+        size_t count[2] = {num_tuples, size_t(num_components)};
+        if (adios2_set_selection(vars[l], 2, start, count) ||
+          adios2_get(handles.engine, vars[l], da->GetVoidPointer(0),
+            adios2_mode_deferred))
+          {
+          SENSEI_ERROR("adios2_get \"" << array_name << "\" level " << l
+            << " block " << j << " failed")
+          return -1;
+          }
+        }
+
+      offset += num_tuples;
+      }
+
+    if (!level_arrays.empty() && adios2_perform_gets(handles.engine))
+      {
+      SENSEI_ERROR("Failed to read array \"" << array_name << "\" level " << l)
+      return -1;
+      }
+
+    coarse.swap(level_arrays);
+    level = l;
+    }
+
+  // the full array is read when time remains
+  if (!this->BudgetSpent(comm))
+    return 0;
+
   vtkCompositeDataIterator *it = dobj->NewIterator();
   it->SetSkipEmptyNodes(0);
   it->InitTraversal();
 
-  for (unsigned int j = 0; j < num_blocks; ++j)
+  for (unsigned int j = 0, k = 0; j < num_blocks; ++j)
     {
     if (block_owner[j] == rank)
       {
@@ -1005,6 +1404,7 @@ int ArraySchema::Write(MPI_Comm comm, AdiosHandle handles, unsigned int i,
       if (!ds)
         {
         SENSEI_ERROR("Failed to get block " << j)
+        it->Delete();
         return -1;
         }
 
@@ -1012,36 +1412,27 @@ int ArraySchema::Write(MPI_Comm comm, AdiosHandle handles, unsigned int i,
         dynamic_cast<vtkDataSetAttributes*>(ds->GetPointData()) :
         dynamic_cast<vtkDataSetAttributes*>(ds->GetCellData());
 
-      vtkDataArray *da = dsa->GetArray(array_name.c_str());
-      if (!da)
-        {
-        SENSEI_ERROR("Failed to get array \"" << array_name
-          << "\" block " << j << " array " << i)
-        return -1;
-        }
+      vtkDataArray *fine = resample(coarse[k++], block_extents[j].data(),
+        array_cen, 1l << level, true);
 
-      // select the spot in the global array that this block's
-      // data will land
-      size_t start = putVarsStart[i*num_blocks + j];
-      size_t count = putVarsCount[i*num_blocks + j];
-      if (adios2_set_selection(putVar, 1, &start, &count))
+      if (fine && (stored_type != array_type))
         {
-        SENSEI_ERROR("adios2_set_selection start=" << start
-          << " count=" << count << " block " << j << " array "
-          << i << " failed")
-        return -1;
+        vtkDataArray *tmp = sensei::VTKUtils::NewArrayOfType(fine, array_type);
+        fine->Delete();
+        fine = tmp;
         }
 
-      // do the write
-      if (adios2_put(handles.engine, putVar,
-        da->GetVoidPointer(0), adios2_mode_sync))
+      if (!fine)
         {
-        SENSEI_ERROR("adios2_put block " << j << " array "
-          << i << " failed")
+        SENSEI_ERROR("Failed to prolong array \"" << array_name
+          << "\" block " << j)
+        it->Delete();
         return -1;
         }
 
-      numBytes += count*size(da->GetDataType());
+      dsa->AddArray(fine);
+      arrays.push_back(std::make_pair(dsa, fine));
+      fine->Delete();
       }
 
     it->GoToNextItem();
@@ -1049,44 +1440,516 @@ int ArraySchema::Write(MPI_Comm comm, AdiosHandle handles, unsigned int i,
 
   it->Delete();
 
-  sensei::Profiler::EndEvent("senseiADIOS2::ArraySchema::Write", numBytes);
+  done = true;
   return 0;
 }
 
-// --------------------------------------------------------------------------
-int ArraySchema::Write(MPI_Comm comm, AdiosHandle handles,
-  const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj)
-{
-  sensei::TimeEvent<128> mark("senseiADIOS2::ArraySchema::Write");
 
-  int rank = 0;
+// --------------------------------------------------------------------------
+int ArraySchema::DefineVariable(MPI_Comm comm, AdiosHandle handles,
+  const std::string &ons, int i, int array_type, int num_components,
+  int array_cen, unsigned int num_blocks,
+  const std::vector<long> &block_num_points,
+  const std::vector<long> &block_num_cells,
+  const std::vector<int> &block_owner,
+  const std::vector<int> &block_level,
+  unsigned int num_levels,
+  std::vector<size_t> &putVarsStart,
+  std::vector<size_t> &putVarsCount,
+  adios2_variable **putVar)
+{
+  sensei::TimeEvent<128> mark("senseiADIOS2::ArraySchema::DefineVariable");
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  // validate centering
+  if ((array_cen != vtkDataObject::POINT) && (array_cen != vtkDataObject::CELL))
+    {
+    SENSEI_ERROR("Invalid array centering at array " << i)
+    return -1;
+    }
+
+  // put each data array in its own namespace
+  std::ostringstream ans;
+  ans << ons << "data_array_" << i << "/";
+
+  // adios2 type of the array
+  adios2_type elem_type = adiosType(array_type);
+
+  // unlike ADIOS1 in ADIOS2 you can't define the variable once for
+  // each write. Instead define it once with an empty size. and calculate
+  // all the book keeping info to later write each block's chunk of
+  // the array in the correct spot.
+
+  // an AMR mesh's blocks are stored level by level, each level in its own
+  // variable, so that readers may skip the finer levels. a block's start
+  // is relative to its level
+  std::vector<unsigned long> level_offset(num_levels, 0);
+  for (unsigned int j = 0; j < num_blocks; ++j)
+    {
+    // get the block size
+    unsigned long num_tuples_local = (array_cen == vtkDataObject::POINT ?
+      block_num_points[j] : block_num_cells[j]);
+
+    unsigned long &block_offset = level_offset[blockLevel(block_level, j)];
+
+    // define the variable for a local block
+    if (block_owner[j] == rank)
+      {
+      // save the var attr. to use later for putting
+      putVarsStart[i*num_blocks + j] = block_offset;
+      putVarsCount[i*num_blocks + j] = num_tuples_local;
+      }
+
+    // update the block offset
+    block_offset += num_tuples_local;
+    }
+
+  for (unsigned int l = 0; l < num_levels; ++l)
+    {
+    // /data_object_<id>/data_array_<id>/data
+    // /data_object_<id>/data_array_<id>/level_<l>/data
+    std::string path = levelPath(ans.str(), l, num_levels) + "data";
+
+    // the array is a 2D variable with a row per tuple and a column per
+    // component. a block is a range of rows. structure of arrays layouts
+    // are written and read one column at a time
+    size_t shape[2] = {level_offset[l], size_t(num_components)};
+    size_t localStart[2] = {0, 0};
+    size_t localCount[2] = {0, 0};
+
+    putVar[l] = defineVariable(handles.io,
+       path.c_str(), elem_type, 2, shape, localStart,
+       localCount, adios2_constant_dims_false);
+
+    if (!putVar[l])
+      {
+      SENSEI_ERROR("adios2_define_variable failed with "
+        << "num_tuples_total=" << level_offset[l] << " num_components="
+        << num_components << " path=\"" << path << "\"")
+      return -1;
+      }
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ArraySchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
+  const std::string &ons, const sensei::MeshMetadataPtr &md)
+{
+  sensei::TimeEvent<128> mark(
+    "senseiADIOS2::ArraySchema::DefineVariables");
+
+  std::vector<size_t> &putVarsStart = this->PutVarsStart[md->MeshName];
+  std::vector<size_t> &putVarsCount = this->PutVarsCount[md->MeshName];
+  std::vector<adios2_variable*> &putVars = this->PutVars[md->MeshName];
+
+  // allocate write ids
+  unsigned int num_blocks = md->NumBlocks;
+  unsigned int num_arrays = md->NumArrays;
+
+  bool have_ghost_cells = md->NumGhostCells || sensei::VTKUtils::AMR(md);
+
+  unsigned int num_ghost_arrays =
+    (have_ghost_cells ? 1 : 0) + (md->NumGhostNodes ? 1 : 0);
+
+  unsigned int num_arrays_total = num_arrays + num_ghost_arrays;
+
+  // AMR meshes have a variable per level
+  unsigned int num_levels = numLevels(md);
+  const std::vector<int> &block_level = blockLevels(md);
+
+  putVarsStart.resize(num_blocks*num_arrays_total);
+  putVarsCount.resize(num_blocks*num_arrays_total);
+  putVars.resize(num_arrays_total*num_levels);
+
+  // the arrays are written in full at the next step
+  this->WrittenStep.erase(md->MeshName);
+
+  // /data_object_<id>/data_step
+  std::string path = ons + "data_step";
+  if (!defineVariable(handles.io, path.c_str(), adios2_type_uint64_t, 0,
+    NULL, NULL, NULL, adios2_constant_dims_true))
+    {
+    SENSEI_ERROR("adios2_define_variable \"" << path << "\" failed")
+    return -1;
+    }
+
+  // define data arrays. an array stored at reduced precision keeps its
+  // type in the metadata, readers convert back to it
+  for (unsigned int i = 0; i < num_arrays; ++i)
+    {
+    int stored_type = sensei::VTKUtils::GetStorageType(md->ArrayType[i],
+      this->Precision.GetArrayPrecision(md->MeshName, md->ArrayCentering[i],
+      md->ArrayName[i]));
+
+    if (this->DefineVariable(comm, handles, ons, i, stored_type,
+      md->ArrayComponents[i], md->ArrayCentering[i], num_blocks,
+      md->BlockNumPoints, md->BlockNumCells, md->BlockOwner, block_level,
+      num_levels, putVarsStart, putVarsCount, &putVars[i*num_levels]))
+      return -1;
+
+    // /data_object_<id>/data_array_<id>/step
+    std::ostringstream ans;
+    ans << ons << "data_array_" << i << "/step";
+    if (!defineVariable(handles.io, ans.str().c_str(), adios2_type_uint64_t,
+      0, NULL, NULL, NULL, adios2_constant_dims_true))
+      {
+      SENSEI_ERROR("adios2_define_variable \"" << ans.str() << "\" failed")
+      return -1;
+      }
+
+    // /data_object_<id>/data_array_<id>/coarse_<l>/data
+    if (this->Progressive(md) &&
+      this->DefineCoarseVariables(handles, ons, md, i, stored_type))
+      return -1;
+    }
+
+  // define ghost arrays. the node ghosts follow the cell ghosts
+  unsigned int gc = num_arrays;
+  if (have_ghost_cells && this->DefineVariable(comm, handles, ons,
+      gc, VTK_UNSIGNED_CHAR, 1, vtkDataObject::CELL, num_blocks,
+      md->BlockNumPoints, md->BlockNumCells, md->BlockOwner, block_level,
+      num_levels, putVarsStart, putVarsCount, &putVars[gc*num_levels]))
+      return -1;
+
+  unsigned int gn = num_arrays + (have_ghost_cells ? 1 : 0);
+  if (md->NumGhostNodes && this->DefineVariable(comm, handles, ons,
+      gn, VTK_UNSIGNED_CHAR, 1, vtkDataObject::POINT, num_blocks,
+      md->BlockNumPoints, md->BlockNumCells, md->BlockOwner, block_level,
+      num_levels, putVarsStart, putVarsCount, &putVars[gn*num_levels]))
+      return -1;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ArraySchema::Write(MPI_Comm comm, AdiosHandle handles, unsigned int i,
+  const std::string &array_name, int array_type, int num_components,
+  int array_cen, vtkCompositeDataSet *dobj, unsigned int num_blocks,
+  const std::vector<int> &block_owner, const std::vector<int> &block_level,
+  const std::vector<size_t> &putVarsStart,
+  const std::vector<size_t> &putVarsCount, adios2_variable *const *putVar)
+{
+  if (this->AggregateBlocks)
+    return this->WriteAggregated(comm, handles, i, array_name, array_type,
+      num_components, array_cen, dobj, num_blocks, block_owner, block_level, putVarsStart,
+      putVarsCount, putVar);
+
+  sensei::Profiler::StartEvent("senseiADIOS2::ArraySchema::Write");
+  long long numBytes = 0ll;
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  vtkCompositeDataIterator *it = dobj->NewIterator();
+  it->SetSkipEmptyNodes(0);
+  it->InitTraversal();
+
+  for (unsigned int j = 0; j < num_blocks; ++j)
+    {
+    if (block_owner[j] == rank)
+      {
+      vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+      if (!ds)
+        {
+        SENSEI_ERROR("Failed to get block " << j)
+        return -1;
+        }
+
+      vtkDataSetAttributes *dsa = array_cen == vtkDataObject::POINT ?
+        dynamic_cast<vtkDataSetAttributes*>(ds->GetPointData()) :
+        dynamic_cast<vtkDataSetAttributes*>(ds->GetCellData());
+
+      vtkDataArray *da = dsa->GetArray(array_name.c_str());
+      if (!da)
+        {
+        SENSEI_ERROR("Failed to get array \"" << array_name
+          << "\" block " << j << " array " << i)
+        return -1;
+        }
+
+      // the variable of the block's level
+      adios2_variable *var = putVar[blockLevel(block_level, j)];
+
+      // select the rows in the global array that this block's
+      // data will land
+      size_t start[2] = {putVarsStart[i*num_blocks + j], 0};
+      size_t count[2] = {putVarsCount[i*num_blocks + j], size_t(num_components)};
+
+      // a structure of arrays is written a column at a time directly from
+      // the component buffers, avoiding the interleaved copy. arrays that
+      // are converted are interleaved by the conversion
+      std::vector<void*> comps;
+      if ((num_components > 1) && (da->GetDataType() == array_type) &&
+        !sensei::VTKUtils::GetComponentPointers(da, comps))
+        {
+        for (int c = 0; c < num_components; ++c)
+          {
+          size_t col_start[2] = {start[0], size_t(c)};
+          size_t col_count[2] = {count[0], 1};
+          if (adios2_set_selection(var, 2, col_start, col_count) ||
+            adios2_put(handles.engine, var, comps[c], adios2_mode_deferred))
+            {
+            SENSEI_ERROR("adios2_put block " << j << " array "
+              << i << " component " << c << " failed")
+            return -1;
+            }
+          }
+        }
+      else
+        {
+        if (adios2_set_selection(var, 2, start, count))
+          {
+          SENSEI_ERROR("adios2_set_selection start=" << start[0]
+            << " count=" << count[0] << " block " << j << " array "
+            << i << " failed")
+          return -1;
+          }
+
+        // do the write
+        if (putArray(handles.engine, var, da, array_type))
+          {
+          SENSEI_ERROR("adios2_put block " << j << " array "
+            << i << " failed")
+          return -1;
+          }
+        }
+
+      numBytes += count[0]*count[1]*size(array_type);
+      }
+
+    it->GoToNextItem();
+    }
+
+  it->Delete();
+
+  sensei::Profiler::EndEvent("senseiADIOS2::ArraySchema::Write", numBytes);
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+// the blocks are laid out in the global variable in block id order, those
+// a rank owns with consecutive ids, and for AMR of the same level, occupy
+// adjacent rows. a run of such blocks, each no larger than AggregateBlocks
+// tuples, is packed into one buffer and written by one put, saving the
+// engine's per block costs. the layout is unchanged, readers locate each
+// block from its tuple count in the metadata as before. larger blocks are
+// written directly.
+int ArraySchema::WriteAggregated(MPI_Comm comm, AdiosHandle handles,
+  unsigned int i, const std::string &array_name, int array_type,
+  int num_components, int array_cen, vtkCompositeDataSet *dobj, unsigned int num_blocks,
+  const std::vector<int> &block_owner, const std::vector<int> &block_level,
+  const std::vector<size_t> &putVarsStart,
+  const std::vector<size_t> &putVarsCount, adios2_variable *const *putVar)
+{
+  sensei::Profiler::StartEvent("senseiADIOS2::ArraySchema::WriteAggregated");
+  long long numBytes = 0ll;
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  // get the local blocks' arrays
+  std::vector<vtkDataArray*> arrays(num_blocks, nullptr);
+
+  vtkCompositeDataIterator *it = dobj->NewIterator();
+  it->SetSkipEmptyNodes(0);
+  it->InitTraversal();
+
+  for (unsigned int j = 0; j < num_blocks; ++j)
+    {
+    if (block_owner[j] == rank)
+      {
+      vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+      if (!ds)
+        {
+        SENSEI_ERROR("Failed to get block " << j)
+        it->Delete();
+        return -1;
+        }
+
+      vtkDataSetAttributes *dsa = array_cen == vtkDataObject::POINT ?
+        dynamic_cast<vtkDataSetAttributes*>(ds->GetPointData()) :
+        dynamic_cast<vtkDataSetAttributes*>(ds->GetCellData());
+
+      if (!(arrays[j] = dsa->GetArray(array_name.c_str())))
+        {
+        SENSEI_ERROR("Failed to get array \"" << array_name
+          << "\" block " << j << " array " << i)
+        it->Delete();
+        return -1;
+        }
+      }
+
+    it->GoToNextItem();
+    }
+
+  it->Delete();
+
+  std::vector<unsigned char> buffer;
+  for (unsigned int j = 0; j < num_blocks;)
+    {
+    vtkDataArray *da = arrays[j];
+    if (!da)
+      {
+      ++j;
+      continue;
+      }
+
+    size_t start[2] = {putVarsStart[i*num_blocks + j], 0};
+    size_t count[2] = {putVarsCount[i*num_blocks + j], size_t(num_components)};
+
+    // extend the run over the following small adjacent blocks of the
+    // same level
+    int level = blockLevel(block_level, j);
+    adios2_variable *putVarL = putVar[level];
+
+    unsigned int k = j + 1;
+    if (count[0] <= this->AggregateBlocks)
+      {
+      for (; (k < num_blocks) && arrays[k] &&
+        (blockLevel(block_level, k) == level) &&
+        (putVarsCount[i*num_blocks + k] <= this->AggregateBlocks) &&
+        (putVarsStart[i*num_blocks + k] == start[0] + count[0]); ++k)
+        count[0] += putVarsCount[i*num_blocks + k];
+      }
+
+    if (adios2_set_selection(putVarL, 2, start, count))
+      {
+      SENSEI_ERROR("adios2_set_selection start=" << start[0]
+        << " count=" << count[0] << " block " << j << " array "
+        << i << " failed")
+      return -1;
+      }
+
+    size_t elemSize = size(array_type);
+
+    if (k == j + 1)
+      {
+      // a single block is written in place
+      if (putArray(handles.engine, putVarL, da, array_type))
+        {
+        SENSEI_ERROR("adios2_put block " << j << " array "
+          << i << " failed")
+        return -1;
+        }
+      }
+    else
+      {
+      // pack the run, interleaving any structure of arrays and converting
+      // to the stored type on the way. the put is made in sync mode so that
+      // the buffer may be reused
+      buffer.resize(count[0]*count[1]*elemSize);
+      unsigned char *dest = buffer.data();
+      for (unsigned int q = j; q < k; ++q)
+        {
+        if (sensei::VTKUtils::ExportToType(arrays[q], array_type, dest))
+          {
+          SENSEI_ERROR("Failed to convert block " << q << " array " << i)
+          return -1;
+          }
+        dest += putVarsCount[i*num_blocks + q]*count[1]*elemSize;
+        }
+
+      if (adios2_put(handles.engine, putVarL, buffer.data(), adios2_mode_sync))
+        {
+        SENSEI_ERROR("adios2_put blocks " << j << " to " << k - 1
+          << " array " << i << " failed")
+        return -1;
+        }
+      }
+
+    numBytes += count[0]*count[1]*elemSize;
+    j = k;
+    }
+
+  sensei::Profiler::EndEvent("senseiADIOS2::ArraySchema::WriteAggregated", numBytes);
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ArraySchema::Write(MPI_Comm comm, AdiosHandle handles,
+  const std::string &ons, const sensei::MeshMetadataPtr &md,
+  vtkCompositeDataSet *dobj, const std::vector<int> *changed)
+{
+  sensei::TimeEvent<128> mark("senseiADIOS2::ArraySchema::Write");
+
+  int rank = 0;
   MPI_Comm_rank(comm, &rank);
 
   std::vector<size_t> &putVarsStart = this->PutVarsStart[md->MeshName];
   std::vector<size_t> &putVarsCount = this->PutVarsCount[md->MeshName];
   std::vector<adios2_variable*> &putVars = this->PutVars[md->MeshName];
 
-  // write data arrays
-  unsigned int num_arrays = md->NumArrays;
-  bool have_ghost_cells = md->NumGhostCells || sensei::VTKUtils::AMR(md);
+  // write data arrays
+  unsigned int num_arrays = md->NumArrays;
+  bool have_ghost_cells = md->NumGhostCells || sensei::VTKUtils::AMR(md);
+
+  unsigned int num_levels = numLevels(md);
+  const std::vector<int> &block_level = blockLevels(md);
+
+  // each array records the step it was last written at, an array that is
+  // not written keeps its step and readers reuse the copy read then
+  unsigned long &data_step = ++this->DataStep[md->MeshName];
+
+  std::vector<unsigned long> &written = this->WrittenStep[md->MeshName];
+  written.resize(num_arrays, 0);
+
+  // /data_object_<id>/data_step
+  std::string path = ons + "data_step";
+  if (adios2_put_by_name(handles.engine, path.c_str(), &data_step,
+    adios2_mode_sync))
+    {
+    SENSEI_ERROR("adios2_put_by_name \"" << path << "\" failed")
+    return -1;
+    }
+
+  for (unsigned int i = 0; i < num_arrays; ++i)
+    {
+    bool skip = changed && (i < changed->size()) && !(*changed)[i] &&
+      written[i];
+
+    int stored_type = sensei::VTKUtils::GetStorageType(md->ArrayType[i],
+      this->Precision.GetArrayPrecision(md->MeshName, md->ArrayCentering[i],
+      md->ArrayName[i]));
+
+    if (!skip && this->Write(comm, handles, i, md->ArrayName[i], stored_type,
+      md->ArrayComponents[i], md->ArrayCentering[i], dobj, md->NumBlocks, md->BlockOwner, block_level,
+      putVarsStart, putVarsCount, &putVars[i*num_levels]))
+      return -1;
+
+    if (!skip && this->Progressive(md) && this->WriteCoarse(comm, handles,
+      ons, md, i, stored_type, dobj))
+      return -1;
+
+    if (!skip)
+      written[i] = data_step;
 
-  for (unsigned int i = 0; i < num_arrays; ++i)
-    {
-    if (this->Write(comm, handles, i, md->ArrayName[i], md->ArrayCentering[i],
-      dobj, md->NumBlocks, md->BlockOwner, putVarsStart, putVarsCount, putVars[i]))
+    // /data_object_<id>/data_array_<id>/step
+    std::ostringstream ans;
+    ans << ons << "data_array_" << i << "/step";
+    if (adios2_put_by_name(handles.engine, ans.str().c_str(), &written[i],
+      adios2_mode_sync))
+      {
+      SENSEI_ERROR("adios2_put_by_name \"" << ans.str() << "\" failed")
       return -1;
+      }
     }
 
-  // write ghost arrays
-  if (have_ghost_cells && this->Write(comm, handles, num_arrays, "vtkGhostType",
-    vtkDataObject::CELL, dobj, md->NumBlocks, md->BlockOwner, putVarsStart,
-    putVarsCount, putVars[num_arrays]))
+  // write ghost arrays. the node ghosts follow the cell ghosts
+  unsigned int gc = num_arrays;
+  if (have_ghost_cells && this->Write(comm, handles, gc, "vtkGhostType",
+    VTK_UNSIGNED_CHAR, 1, vtkDataObject::CELL, dobj, md->NumBlocks, md->BlockOwner, block_level,
+    putVarsStart, putVarsCount, &putVars[gc*num_levels]))
       return -1;
 
-  if (md->NumGhostNodes && this->Write(comm, handles, num_arrays,
-    "vtkGhostType", vtkDataObject::POINT, dobj, md->NumBlocks,
-    md->BlockOwner, putVarsStart, putVarsCount,
-    putVars[num_arrays + (have_ghost_cells ? 1 : 0)]))
+  unsigned int gn = num_arrays + (have_ghost_cells ? 1 : 0);
+  if (md->NumGhostNodes && this->Write(comm, handles, gn,
+    "vtkGhostType", VTK_UNSIGNED_CHAR, 1, vtkDataObject::POINT, dobj, md->NumBlocks,
+    md->BlockOwner, block_level, putVarsStart, putVarsCount,
+    &putVars[gn*num_levels]))
     return -1;
 
   return 0;
@@ -1098,7 +1961,9 @@ int ArraySchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons
   unsigned long long num_components, int array_cen, unsigned int num_blocks,
   const std::vector<long> &block_num_points,
   const std::vector<long> &block_num_cells, const std::vector<int> &block_owner,
-  vtkCompositeDataSet *dobj)
+  const std::vector<int> &block_level, unsigned int num_levels,
+  int soa, vtkCompositeDataSet *dobj,
+  const std::vector<std::array<int,6>> *block_extents)
 {
   sensei::Profiler::StartEvent("senseiADIOS2::ArraySchema::Read");
   long long numBytes = 0ll;
@@ -1110,53 +1975,173 @@ int ArraySchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons
   std::ostringstream ans;
   ans << ons << "data_array_" << i << "/";
 
+  // a data array that did not change is written only at the step it last
+  // changed, the copy read then is reused. streams without the steps and
+  // the ghost arrays are read every step
+  unsigned long data_step = 0;
+  unsigned long array_step = 0;
+
+  adios2_variable *data_step_var =
+    this->ReadVariables.Get(handles.io, ons + "data_step");
+
+  adios2_variable *array_step_var =
+    this->ReadVariables.Get(handles.io, ans.str() + "step");
+
+  bool tracked = data_step_var && array_step_var &&
+    !adios2_get(handles.engine, data_step_var, &data_step, adios2_mode_sync) &&
+    !adios2_get(handles.engine, array_step_var, &array_step, adios2_mode_sync);
+
+  std::vector<unsigned int> local_blocks;
+  for (unsigned int j = 0; j < num_blocks; ++j)
+    {
+    if (block_owner[j] == rank)
+      local_blocks.push_back(j);
+    }
+
+  CachedArray &cache = this->ReadCache[ans.str()];
+  if (tracked && (array_step != data_step))
+    {
+    if (!cache.Valid || (cache.Step != array_step) ||
+      (cache.Blocks != local_blocks))
+      {
+      SENSEI_ERROR("Array \"" << array_name << "\" was last written at step "
+        << array_step << " which was not read for the local blocks. Readers "
+        "of a stream with unchanged arrays skipped must read each array at "
+        "every step with the same partition")
+      return -1;
+      }
+
+    vtkCompositeDataIterator *it = dobj->NewIterator();
+    it->SetSkipEmptyNodes(0);
+    it->InitTraversal();
+
+    for (unsigned int j = 0, k = 0; j < num_blocks; ++j)
+      {
+      if (block_owner[j] == rank)
+        {
+        vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+        if (!ds)
+          {
+          SENSEI_ERROR("Failed to get block " << j)
+          it->Delete();
+          return -1;
+          }
+
+        vtkDataSetAttributes *dsa = array_cen == vtkDataObject::POINT ?
+          dynamic_cast<vtkDataSetAttributes*>(ds->GetPointData()) :
+          dynamic_cast<vtkDataSetAttributes*>(ds->GetCellData());
+
+        dsa->AddArray(cache.Arrays[k++]);
+        }
+
+      it->GoToNextItem();
+      }
+
+    it->Delete();
+
+    sensei::Profiler::EndEvent("senseiADIOS2::ArraySchema::Read", numBytes);
+    return 0;
+    }
+
+  cache.Valid = false;
+
+  // the arrays of the local blocks, those read at another type are
+  // converted once the reads are done
+  std::vector<std::pair<vtkDataSetAttributes*, vtkDataArray*>> arrays;
+
+  // with a refinement budget the subsampled copies are read first, the
+  // full array only when time remains
+  bool done = false;
+  if (block_extents && this->ReadCoarse(comm, handles, ans.str(), array_name,
+    array_type, num_components, array_cen, num_blocks, block_owner,
+    *block_extents, dobj, arrays, done))
+    return -1;
+
+  if (done)
+    {
+    if (tracked)
+      this->CacheArrays(cache, array_step, local_blocks, arrays);
+
+    sensei::Profiler::EndEvent("senseiADIOS2::ArraySchema::Read", numBytes);
+    return 0;
+    }
+
   vtkCompositeDataIterator *it = dobj->NewIterator();
   it->SetSkipEmptyNodes(0);
   it->InitTraversal();
 
-  // read each block
-  unsigned long long block_offset = 0;
-  for (unsigned int j = 0; j < num_blocks; ++j)
+  // allocate each local block and collect the requests for its data
+  std::vector<int> req_var;
+  std::vector<unsigned long long> req_start;
+  std::vector<unsigned long long> req_count;
+  std::vector<void*> req_dest;
+
+  // the requests are for rows of the 2D variable of the block's level.
+  // with a structure of arrays each component's column is requested
+  // separately, otherwise all of the columns are read. the request's
+  // variable encodes both, level*(num_components + 1) + column + 1, where
+  // a column of -1 selects all of them
+  soa = soa && (num_components > 1);
+
+  // an array stored at reduced precision is read at the stored type and
+  // converted to the type given in the metadata
+  int stored_type = array_type;
+  if (array_type == VTK_DOUBLE)
     {
-    std::string path = ans.str() + "data";
+    std::string path = levelPath(ans.str(), 0, num_levels) + "data";
+    adios2_variable *var = this->ReadVariables.Get(handles.io, path);
+    adios2_type var_type = adios2_type_unknown;
+    if (var && !adios2_variable_type(&var_type, var) &&
+      (var_type == adios2_type_float))
+      stored_type = VTK_FLOAT;
+    }
+
+  unsigned long long row_size = (soa ? 1 : num_components)*size(stored_type);
+  int var_stride = num_components + 1;
 
+  // a block's start is relative to its level. blocks of levels that are
+  // not read locally are skipped
+  std::vector<unsigned long long> level_offset(num_levels, 0);
+  for (unsigned int j = 0; j < num_blocks; ++j)
+    {
     // get the block size
-    unsigned long long num_elem_local = (array_cen == vtkDataObject::POINT ?
-      block_num_points[j] : block_num_cells[j])*num_components;
+    unsigned long long num_tuples_local = (array_cen == vtkDataObject::POINT ?
+      block_num_points[j] : block_num_cells[j]);
+
+    int level = blockLevel(block_level, j);
+    unsigned long long &block_offset = level_offset[level];
 
     // define the variable for a local block
     if (block_owner[j] ==  rank)
       {
-      adios2_variable *vinfo = adios2_inquire_variable(handles.io, path.c_str());
-      if (!vinfo)
+      std::vector<void*> comps;
+      vtkDataArray *array = nullptr;
+      if (soa && (array = sensei::VTKUtils::NewSOAArray(stored_type,
+        num_components, num_tuples_local, comps)))
         {
-        SENSEI_ERROR("adios2_inquire_variable \"" << path
-          << "\" block " << j << " array " << i << " failed")
-        return -1;
+        for (unsigned long long c = 0; c < num_components; ++c)
+          {
+          req_var.push_back(level*var_stride + c + 1);
+          req_start.push_back(block_offset);
+          req_count.push_back(num_tuples_local);
+          req_dest.push_back(comps[c]);
+          }
         }
-
-      size_t start = block_offset;
-      size_t count = num_elem_local;
-      if (adios2_set_selection(vinfo, 1, &start, &count))
+      else
         {
-        SENSEI_ERROR("adios2_set_selection start=" << start
-          << " count=" << count << " block " << j << " array " << i << " failed")
-        return -1;
-        }
+        soa = 0;
+        row_size = num_components*size(stored_type);
 
-      vtkDataArray *array = vtkDataArray::CreateDataArray(array_type);
-      array->SetNumberOfComponents(num_components);
-      array->SetNumberOfTuples(num_elem_local);
-      array->SetName(array_name.c_str());
+        // the buffer is reused in later steps
+        array = sensei::BufferPool::NewDataArray(stored_type,
+          num_components, num_tuples_local);
 
-      // /data_object_<id>/data_array_<id>/data
-      if (adios2_get(handles.engine, vinfo, array->GetVoidPointer(0),
-        adios2_mode_sync))
-        {
-        SENSEI_ERROR("adios2_get \"" << array_name
-          << "\" block " << j << " array " << i << " failed")
-        return -1;
+        req_var.push_back(level*var_stride);
+        req_start.push_back(block_offset);
+        req_count.push_back(num_tuples_local);
+        req_dest.push_back(array->GetVoidPointer(0));
         }
+      array->SetName(array_name.c_str());
 
       // pass to vtk
       vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
@@ -1173,11 +2158,13 @@ int ArraySchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons
       dsa->AddArray(array);
       array->Delete();
 
-      numBytes += num_elem_local*size(array_type);
+      arrays.push_back(std::make_pair(dsa, array));
+
+      numBytes += num_tuples_local*num_components*size(stored_type);
       }
 
     // update the block offset
-    block_offset += num_elem_local;
+    block_offset += num_tuples_local;
 
     // next block
     it->GoToNextItem();
@@ -1185,14 +2172,123 @@ int ArraySchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons
 
   it->Delete();
 
+  // the plan is reused as long as the local blocks are the same
+  sensei::BlockReadPlan &plan = this->ReadPlans[ans.str()];
+  if (!plan.Matches(req_var, req_start, req_count))
+    {
+    plan.Clear();
+    size_t n_req = req_var.size();
+    for (size_t j = 0; j < n_req; ++j)
+      plan.Add(req_var[j], req_start[j], req_count[j], row_size);
+    }
+
+  // the variables of the levels that are read
+  std::vector<adios2_variable*> vinfo(num_levels, nullptr);
+
+  // issue the reads of all local blocks together, merging adjacent blocks
+  // /data_object_<id>/data_array_<id>/data
+  // /data_object_<id>/data_array_<id>/level_<l>/data
+  if (plan.Execute(req_dest,
+    [&](int var, unsigned long long start, unsigned long long count, void *dest) -> int
+    {
+    unsigned int level = var/var_stride;
+    int col = var%var_stride - 1;
+
+    if (!vinfo[level])
+      {
+      std::string path = levelPath(ans.str(), level, num_levels) + "data";
+      if (!(vinfo[level] = this->ReadVariables.Get(handles.io, path)))
+        {
+        SENSEI_ERROR("adios2_inquire_variable \"" << path
+          << "\" array " << i << " failed")
+        return -1;
+        }
+      }
+
+    size_t sel_start[2] = {start, col < 0 ? 0 : size_t(col)};
+    size_t sel_count[2] = {count, col < 0 ? num_components : 1};
+    if (adios2_set_selection(vinfo[level], 2, sel_start, sel_count) ||
+      adios2_get(handles.engine, vinfo[level], dest, adios2_mode_deferred))
+      {
+      SENSEI_ERROR("adios2_get \"" << array_name << "\" start=" << start
+        << " count=" << count << " array " << i << " failed")
+      return -1;
+      }
+    return 0;
+    },
+    [&]() -> int
+    {
+    if (req_var.empty())
+      return 0;
+    return adios2_perform_gets(handles.engine) ? -1 : 0;
+    }))
+    {
+    SENSEI_ERROR("Failed to read array \"" << array_name << "\"")
+    return -1;
+    }
+
+  // convert to the array's type, replacing the array read. the blocks
+  // are converted in parallel and passed to VTK on this thread
+  size_t n_arrays = arrays.size();
+  if ((stored_type != array_type) && n_arrays)
+    {
+    std::vector<vtkDataArray*> converted(n_arrays, nullptr);
+    sensei::TaskRuntime::ParallelFor(n_arrays, this->Threads,
+      [&](int, long j) -> int
+      {
+      converted[j] = sensei::VTKUtils::NewArrayOfType(arrays[j].second,
+        array_type);
+      return 0;
+      });
+
+    int ierr = 0;
+    for (size_t j = 0; j < n_arrays; ++j)
+      {
+      vtkDataArray *array = converted[j];
+      if (!array)
+        {
+        ierr = -1;
+        continue;
+        }
+      arrays[j].first->AddArray(array);
+      arrays[j].second = array;
+      array->Delete();
+      }
+
+    if (ierr)
+      {
+      SENSEI_ERROR("Failed to convert array \"" << array_name << "\"")
+      return -1;
+      }
+    }
+
+  // keep the arrays for the steps in which they are not written
+  if (tracked)
+    this->CacheArrays(cache, array_step, local_blocks, arrays);
+
   sensei::Profiler::EndEvent("senseiADIOS2::ArraySchema::Read", numBytes);
   return 0;
 }
 
+// --------------------------------------------------------------------------
+void ArraySchema::CacheArrays(CachedArray &cache, unsigned long step,
+  std::vector<unsigned int> &local_blocks,
+  const std::vector<std::pair<vtkDataSetAttributes*, vtkDataArray*>> &arrays)
+{
+  size_t n_arrays = arrays.size();
+  cache.Valid = true;
+  cache.Step = step;
+  cache.Blocks.swap(local_blocks);
+  cache.Arrays.clear();
+  cache.Arrays.resize(n_arrays);
+  for (size_t j = 0; j < n_arrays; ++j)
+    cache.Arrays[j] = arrays[j].second;
+}
+
 // --------------------------------------------------------------------------
 int ArraySchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons,
   const std::string &name, int centering, const sensei::MeshMetadataPtr &md,
-  vtkCompositeDataSet *dobj)
+  int soa, vtkCompositeDataSet *dobj)
 {
   sensei::TimeEvent<128> mark("senseiADIOS2::ArraySchema::Read");
 
@@ -1201,6 +2297,9 @@ int ArraySchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons
 
   bool have_ghost_cells = md->NumGhostCells || sensei::VTKUtils::AMR(md);
 
+  unsigned int num_levels = numLevels(md);
+  const std::vector<int> &block_level = blockLevels(md);
+
   // read ghost arrays
   if (name == "vtkGhostType")
     {
@@ -1209,7 +2308,7 @@ int ArraySchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons
 
     return this->Read(comm, handles, ons, i, "vtkGhostType",
       VTK_UNSIGNED_CHAR, 1, centering, num_blocks, md->BlockNumPoints,
-      md->BlockNumCells, md->BlockOwner, dobj);
+      md->BlockNumCells, md->BlockOwner, block_level, num_levels, 0, dobj);
     }
 
   // read data arrays
@@ -1222,15 +2321,19 @@ int ArraySchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons
     if ((centering != array_cen) || (name != array_name))
       continue;
 
+    // the subsampled copies are written only for uniform meshes
+    bool uniform = sensei::VTKUtils::UniformCartesian(md) &&
+      !sensei::VTKUtils::AMR(md) && (md->BlockExtents.size() == num_blocks);
+
     return this->Read(comm, handles, ons, i, array_name, md->ArrayType[i],
       md->ArrayComponents[i], array_cen, num_blocks, md->BlockNumPoints,
-      md->BlockNumCells, md->BlockOwner, dobj);
+      md->BlockNumCells, md->BlockOwner, block_level, num_levels, soa, dobj,
+      uniform ? &md->BlockExtents : nullptr);
     }
 
   return 0;
 }
 
-
 struct PointSchema
 {
   int DefineVariables(MPI_Comm comm, AdiosHandle handles,
@@ -1245,6 +2348,9 @@ struct PointSchema
   std::map<std::string, std::vector<size_t>> Starts;
   std::map<std::string, std::vector<size_t>> Counts;
   std::map<std::string, adios2_variable*> PutVars;
+  std::map<std::string, sensei::BlockReadPlan> ReadPlans;
+
+  VariableTable ReadVariables;
 };
 
 // --------------------------------------------------------------------------
@@ -1277,7 +2383,7 @@ int PointSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
     // /data_object_<id>/points
     std::string path_pts = ons + "points";
 
-    adios2_variable *var = adios2_define_variable(
+    adios2_variable *var = defineVariable(
       handles.io, path_pts.c_str(), type, 1,  &gdims, &loffs,
       &ldims, adios2_constant_dims_false);
 
@@ -1358,8 +2464,7 @@ int PointSchema::Write(MPI_Comm comm, AdiosHandle handles,
           }
 
         vtkDataArray *da = ds->GetPoints()->GetData();
-        if (adios2_put(handles.engine, putVar,
-          da->GetVoidPointer(0), adios2_mode_sync))
+        if (putArray(handles.engine, putVar, da))
           {
           SENSEI_ERROR("adios2_put \"" << md->MeshName
             << "\" block " << j << " points failed")
@@ -1392,11 +2497,18 @@ int PointSchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
+    std::string path = ons + "points";
+
     vtkCompositeDataIterator *it = dobj->NewIterator();
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
 
-    // read local blocks
+    // allocate local blocks and collect the requests for their points
+    std::vector<int> req_var;
+    std::vector<unsigned long long> req_start;
+    std::vector<unsigned long long> req_count;
+    std::vector<void*> req_dest;
+
     unsigned long long block_offset = 0;
     unsigned int num_blocks = md->NumBlocks;
     for (unsigned int j = 0; j < num_blocks; ++j)
@@ -1407,37 +2519,17 @@ int PointSchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons
       // read local block
       if (md->BlockOwner[j] ==  rank)
         {
-        std::string path = ons + "points";
-        adios2_variable *vinfo = adios2_inquire_variable(handles.io, path.c_str());
-        if (!vinfo)
-          {
-          SENSEI_ERROR("ADIOS2 stream is missing \"" << path << "\"")
-          return -1;
-          }
-
-        size_t start = 3*block_offset;
         size_t count = 3*num_local;
-        if (adios2_set_selection(vinfo, 1, &start, &count))
-          {
-          SENSEI_ERROR("adios2_set_selection points block " << j
-            << " start=" << start << " count=" << count << " failed")
-          return -1;
-          }
 
         vtkDataArray *points = vtkDataArray::CreateDataArray(md->CoordinateType);
         points->SetNumberOfComponents(3);
         points->SetNumberOfTuples(num_local);
         points->SetName("points");
 
-        adios2_error getErr = adios2_get(handles.engine,
-          vinfo, points->GetVoidPointer(0), adios2_mode_sync);
-
-        if (getErr != 0)
-          {
-          SENSEI_ERROR("adios2_get points "
-            << " block " << j <<  " failed. " << getErr)
-          return -1;
-          }
+        req_var.push_back(0);
+        req_start.push_back(3*block_offset);
+        req_count.push_back(count);
+        req_dest.push_back(points->GetVoidPointer(0));
 
         // pass into vtk
         vtkPoints *pts = vtkPoints::New();
@@ -1466,6 +2558,51 @@ int PointSchema::Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons
 
     it->Delete();
 
+    // the plan is reused as long as the local blocks are the same
+    sensei::BlockReadPlan &plan = this->ReadPlans[path];
+    if (!plan.Matches(req_var, req_start, req_count))
+      {
+      plan.Clear();
+      size_t n_req = req_var.size();
+      for (size_t j = 0; j < n_req; ++j)
+        plan.Add(req_var[j], req_start[j], req_count[j],
+          size(md->CoordinateType));
+      }
+
+    adios2_variable *vinfo = nullptr;
+    if (!req_var.empty() &&
+      !(vinfo = this->ReadVariables.Get(handles.io, path)))
+      {
+      SENSEI_ERROR("ADIOS2 stream is missing \"" << path << "\"")
+      return -1;
+      }
+
+    // issue the reads of all local blocks together, merging adjacent blocks
+    if (plan.Execute(req_dest,
+      [&](int, unsigned long long start, unsigned long long count, void *dest) -> int
+      {
+      size_t sel_start = start;
+      size_t sel_count = count;
+      if (adios2_set_selection(vinfo, 1, &sel_start, &sel_count) ||
+        adios2_get(handles.engine, vinfo, dest, adios2_mode_deferred))
+        {
+        SENSEI_ERROR("adios2_get points start=" << start
+          << " count=" << count << " failed")
+        return -1;
+        }
+      return 0;
+      },
+      [&]() -> int
+      {
+      if (req_var.empty())
+        return 0;
+      return adios2_perform_gets(handles.engine) ? -1 : 0;
+      }))
+      {
+      SENSEI_ERROR("Failed to read points")
+      return -1;
+      }
+
     sensei::Profiler::EndEvent("senseiADIOS2::PointSchema::Read", numBytes);
     }
 
@@ -1485,13 +2622,25 @@ struct UnstructuredCellSchema
   int Read(MPI_Comm comm, AdiosHandle handles, const std::string &ons,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
 
+  // the cells are stored as types, offsets and connectivity. offsets and
+  // point ids are relative to the block, and are 32 bit when every block
+  // fits. a block has one more offset than it has cells
   std::map<std::string, adios2_variable*> CellTypeVars;
   std::map<std::string, std::vector<size_t>> CellTypeStarts;
   std::map<std::string, std::vector<size_t>> CellTypeCounts;
 
-  std::map<std::string, adios2_variable*> CellArrayVars;
-  std::map<std::string, std::vector<size_t>> CellArrayStarts;
-  std::map<std::string, std::vector<size_t>> CellArrayCounts;
+  std::map<std::string, adios2_variable*> CellOffsetVars;
+  std::map<std::string, std::vector<size_t>> CellOffsetStarts;
+  std::map<std::string, std::vector<size_t>> CellOffsetCounts;
+
+  std::map<std::string, adios2_variable*> CellConnVars;
+  std::map<std::string, std::vector<size_t>> CellConnStarts;
+  std::map<std::string, std::vector<size_t>> CellConnCounts;
+
+  VariableTable ReadVariables;
+
+  // the threads the cells of the local blocks are assembled on
+  int Threads = 1;
 };
 
 // --------------------------------------------------------------------------
@@ -1508,87 +2657,98 @@ int UnstructuredCellSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
     // allocate write ids
     unsigned int num_blocks = md->NumBlocks;
 
-    // calculate global size
-    unsigned long long num_cells_total = 0;
-    unsigned long long cell_array_size_total = 0;
+    // calculate start and count for writing each block
+    std::vector<size_t> &cellTypeStarts = this->CellTypeStarts[md->MeshName];
+    std::vector<size_t> &cellTypeCounts = this->CellTypeCounts[md->MeshName];
+    cellTypeStarts.resize(num_blocks);
+    cellTypeCounts.resize(num_blocks);
+
+    std::vector<size_t> &cellOffsetStarts = this->CellOffsetStarts[md->MeshName];
+    std::vector<size_t> &cellOffsetCounts = this->CellOffsetCounts[md->MeshName];
+    cellOffsetStarts.resize(num_blocks);
+    cellOffsetCounts.resize(num_blocks);
 
+    std::vector<size_t> &cellConnStarts = this->CellConnStarts[md->MeshName];
+    std::vector<size_t> &cellConnCounts = this->CellConnCounts[md->MeshName];
+    cellConnStarts.resize(num_blocks);
+    cellConnCounts.resize(num_blocks);
+
+    size_t cellTypeStart = 0;
+    size_t cellOffsetStart = 0;
+    size_t cellConnStart = 0;
     for (unsigned int j = 0; j < num_blocks; ++j)
       {
-      num_cells_total += md->BlockNumCells[j];
-      cell_array_size_total += md->BlockCellArraySize[j];
+      // get the block size. the cell array size is that of the legacy
+      // layout which has a count per cell
+      size_t numCellsLocal = md->BlockNumCells[j];
+      size_t connSizeLocal = md->BlockCellArraySize[j] - numCellsLocal;
+
+      // local size & offset
+      cellTypeCounts[j] = numCellsLocal;
+      cellTypeStarts[j] = cellTypeStart;
+
+      cellOffsetCounts[j] = numCellsLocal + 1;
+      cellOffsetStarts[j] = cellOffsetStart;
+
+      cellConnCounts[j] = connSizeLocal;
+      cellConnStarts[j] = cellConnStart;
+
+      // update the block offset
+      cellTypeStart += numCellsLocal;
+      cellOffsetStart += numCellsLocal + 1;
+      cellConnStart += connSizeLocal;
       }
 
     // data type for cells
-    adios2_type cell_array_type = adiosIdType();
+    adios2_type index_type = sensei::VTKUtils::CellIndices32(md) ?
+      adios2_type_int32_t : adios2_type_int64_t;
 
-    // global sizes
-    size_t cell_type_gdmins = num_cells_total;
-    size_t cell_array_gdims = cell_array_size_total;
     size_t start = 0;
     size_t count = 0;
 
-    // /data_object_<id>/cell_array
-    std::string path_ca = ons + "cell_array";
+    // /data_object_<id>/cell_types
+    std::string path_ct = ons + "cell_types";
 
-    adios2_variable *var = adios2_define_variable(handles.io,
-      path_ca.c_str(), cell_array_type, 1, &cell_array_gdims,
-      &start, &count, adios2_constant_dims_false);
+    adios2_variable *var = defineVariable(handles.io,
+      path_ct.c_str(), adios2_type_uint8_t, 1, &cellTypeStart, &start,
+      &count, adios2_constant_dims_false);
 
     if (var == nullptr)
       {
-      SENSEI_ERROR("adios2_define_variable \"" << path_ca << "\" failed")
+      SENSEI_ERROR("adios2_define_variable \"" << path_ct << "\" failed")
       return -1;
       }
 
     // save the variable for later writes
     this->CellTypeVars[md->MeshName] = var;
 
-    // /data_object_<id>/cell_types
-    std::string path_ct = ons + "cell_types";
+    // /data_object_<id>/cell_offsets
+    std::string path_co = ons + "cell_offsets";
 
-    var = adios2_define_variable(handles.io, path_ct.c_str(),
-      adios2_type_uint8_t, 1, &cell_type_gdmins, &start, &count,
-      adios2_constant_dims_false);
+    var = defineVariable(handles.io, path_co.c_str(), index_type,
+      1, &cellOffsetStart, &start, &count, adios2_constant_dims_false);
 
     if (var == nullptr)
       {
-      SENSEI_ERROR("adios2_define_variable " << path_ct << "\" failed")
+      SENSEI_ERROR("adios2_define_variable \"" << path_co << "\" failed")
       return -1;
       }
 
-    // save the variable for later writes
-    this->CellArrayVars[md->MeshName] = var;
+    this->CellOffsetVars[md->MeshName] = var;
 
-    // calculate start and count for writing each block
-    std::vector<size_t> &cellArrayStarts = this->CellArrayStarts[md->MeshName];
-    std::vector<size_t> &cellArrayCounts = this->CellArrayCounts[md->MeshName];
-    cellArrayStarts.resize(num_blocks);
-    cellArrayCounts.resize(num_blocks);
+    // /data_object_<id>/cell_connectivity
+    std::string path_cc = ons + "cell_connectivity";
 
-    std::vector<size_t> &cellTypeStarts = this->CellTypeStarts[md->MeshName];
-    std::vector<size_t> &cellTypeCounts = this->CellTypeCounts[md->MeshName];
-    cellTypeStarts.resize(num_blocks);
-    cellTypeCounts.resize(num_blocks);
+    var = defineVariable(handles.io, path_cc.c_str(), index_type,
+      1, &cellConnStart, &start, &count, adios2_constant_dims_false);
 
-    size_t cellTypesStart = 0;
-    size_t cellArrayStart = 0;
-    for (unsigned int j = 0; j < num_blocks; ++j)
+    if (var == nullptr)
       {
-      // get the block size
-      size_t numCellsLocal = md->BlockNumCells[j];
-      size_t cellArraySizeLocal = md->BlockCellArraySize[j];
-
-      // local size & offset
-      cellArrayCounts[j]  = cellArraySizeLocal;
-      cellArrayStarts[j] = cellArrayStart;
-
-      cellTypeCounts[j]  = numCellsLocal;
-      cellTypeStarts[j] = cellTypesStart;
-
-      // update the block offset
-      cellTypesStart += numCellsLocal;
-      cellArrayStart += cellArraySizeLocal;
+      SENSEI_ERROR("adios2_define_variable \"" << path_cc << "\" failed")
+      return -1;
       }
+
+    this->CellConnVars[md->MeshName] = var;
     }
 
   return 0;
@@ -1600,20 +2760,26 @@ int UnstructuredCellSchema::Write(MPI_Comm comm, AdiosHandle handles,
 {
   if (sensei::VTKUtils::Unstructured(md))
     {
-    sensei::Profiler::StartEvent("senseiADIOS2::UnstructuredCellSchema");
+    sensei::Profiler::StartEvent("senseiADIOS2::UnstructuredCellSchema::Write");
     long long numBytes = 0ll;
 
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
-    adios2_variable *cellArrayVar = this->CellArrayVars[md->MeshName];
-    std::vector<size_t> &cellArrayStarts = this->CellArrayStarts[md->MeshName];
-    std::vector<size_t> &cellArrayCounts = this->CellArrayCounts[md->MeshName];
-
     adios2_variable *cellTypeVar = this->CellTypeVars[md->MeshName];
     std::vector<size_t> &cellTypeStarts = this->CellTypeStarts[md->MeshName];
     std::vector<size_t> &cellTypeCounts = this->CellTypeCounts[md->MeshName];
 
+    adios2_variable *cellOffsetVar = this->CellOffsetVars[md->MeshName];
+    std::vector<size_t> &cellOffsetStarts = this->CellOffsetStarts[md->MeshName];
+    std::vector<size_t> &cellOffsetCounts = this->CellOffsetCounts[md->MeshName];
+
+    adios2_variable *cellConnVar = this->CellConnVars[md->MeshName];
+    std::vector<size_t> &cellConnStarts = this->CellConnStarts[md->MeshName];
+    std::vector<size_t> &cellConnCounts = this->CellConnCounts[md->MeshName];
+
+    bool use32 = sensei::VTKUtils::CellIndices32(md);
+
     vtkCompositeDataIterator *it = dobj->NewIterator();
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
@@ -1621,7 +2787,7 @@ int UnstructuredCellSchema::Write(MPI_Comm comm, AdiosHandle handles,
     unsigned int num_blocks = md->NumBlocks;
     for (unsigned int j = 0; j < num_blocks; ++j)
       {
-      // read local block
+      // write local block
       if (md->BlockOwner[j] ==  rank)
         {
         vtkUnstructuredGrid *ds =
@@ -1632,50 +2798,55 @@ int UnstructuredCellSchema::Write(MPI_Comm comm, AdiosHandle handles,
           return -1;
           }
 
-        // select the spot in the global cellArray that this block's
-        // data will land
-        size_t ctStart = cellTypeStarts[j];
-        size_t ctCount = cellTypeCounts[j];
-        if (adios2_set_selection(cellTypeVar, 1, &ctStart, &ctCount))
-          {
-          SENSEI_ERROR("adios2_set_selection start=" << ctStart
-            << " count=" << ctCount << " block " << j << " failed")
-          return -1;
-          }
-
-        // write cell cellTypes
-        vtkDataArray *cta = ds->GetCellTypesArray();
-        if (adios2_put(handles.engine, cellTypeVar,
-          cta->GetVoidPointer(0), adios2_mode_sync))
-          {
-          SENSEI_ERROR("adios2_put cell types for mesh \""
-            << md->MeshName << "\" block " << j << " failed")
-          return -1;
-          }
-
-        // select the spot in the global cellArray that this block's
-        // data will land
-        size_t caStart = cellArrayStarts[j];
-        size_t caCount = cellArrayCounts[j];
-        if (adios2_set_selection(cellArrayVar, 1, &caStart, &caCount))
+        // the offsets and connectivity, without a copy when the cell
+        // array's storage has the stream's index type
+        vtkDataArray *offsets = nullptr;
+        vtkDataArray *conn = nullptr;
+        if (sensei::VTKUtils::GetCellArrays(ds->GetCells(), use32,
+          offsets, conn))
           {
-          SENSEI_ERROR("adios2_set_selection start=" << caStart
-            << " count=" << caCount << " block " << j << " failed")
+          SENSEI_ERROR("Failed to get the cells of block " << j)
           return -1;
           }
 
-        // write cell cellArray
-        vtkDataArray *ca = ds->GetCells()->GetData();
-        if (adios2_put(handles.engine, cellArrayVar,
-          ca->GetVoidPointer(0), adios2_mode_sync))
+        vtkDataArray *cta = ds->GetCellTypesArray();
+
+        adios2_variable *vars[3] = {cellTypeVar, cellOffsetVar, cellConnVar};
+        size_t starts[3] = {cellTypeStarts[j], cellOffsetStarts[j], cellConnStarts[j]};
+        size_t counts[3] = {cellTypeCounts[j], cellOffsetCounts[j], cellConnCounts[j]};
+        vtkDataArray *arrays[3] = {cta, offsets, conn};
+        const char *names[3] = {"cell types", "cell offsets", "cell connectivity"};
+
+        for (int q = 0; q < 3; ++q)
           {
-          SENSEI_ERROR("adios2_put cell array for mesh \""
-            << md->MeshName << "\" block " << j << " failed")
-          return -1;
+          if (size_t(arrays[q]->GetNumberOfTuples()) != counts[q])
+            {
+            SENSEI_ERROR("The " << names[q] << " of mesh \"" << md->MeshName
+              << "\" block " << j << " have " << arrays[q]->GetNumberOfTuples()
+              << " values but the metadata specifies " << counts[q])
+            offsets->Delete();
+            conn->Delete();
+            return -1;
+            }
+
+          // select the spot in the global array that this block's
+          // data will land
+          if (adios2_set_selection(vars[q], 1, &starts[q], &counts[q]) ||
+            adios2_put(handles.engine, vars[q], arrays[q]->GetVoidPointer(0),
+              adios2_mode_sync))
+            {
+            SENSEI_ERROR("adios2_put " << names[q] << " for mesh \""
+              << md->MeshName << "\" block " << j << " failed")
+            offsets->Delete();
+            conn->Delete();
+            return -1;
+            }
+
+          numBytes += counts[q]*size(arrays[q]->GetDataType());
           }
 
-        numBytes += ctCount*size(cta->GetDataType()) +
-          caCount*size(ca->GetDataType());
+        offsets->Delete();
+        conn->Delete();
         }
 
       it->GoToNextItem();
@@ -1702,123 +2873,129 @@ int UnstructuredCellSchema::Read(MPI_Comm comm, AdiosHandle handles,
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
+    // /data_object_<id>/cell_types
+    // /data_object_<id>/cell_offsets
+    // /data_object_<id>/cell_connectivity
+    const char *names[3] = {"cell_types", "cell_offsets", "cell_connectivity"};
+    adios2_variable *vars[3] = {nullptr};
+
+    bool use32 = sensei::VTKUtils::CellIndices32(md);
+    size_t index_size = use32 ? sizeof(int32_t) : sizeof(int64_t);
+
+    // the arrays are read directly into the cell array's storage. with
+    // VTK 9 they are used as they are.
+    std::vector<vtkSmartPointer<vtkUnsignedCharArray>> types;
+    std::vector<vtkSmartPointer<vtkDataArray>> offsets;
+    std::vector<vtkSmartPointer<vtkDataArray>> conns;
+    std::vector<vtkUnstructuredGrid*> grids;
+
     vtkCompositeDataIterator *it = dobj->NewIterator();
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
 
     // calc block offsets
-    unsigned long long cell_types_block_offset = 0;
-    unsigned long long cell_array_block_offset = 0;
+    size_t type_offset = 0;
+    size_t offset_offset = 0;
+    size_t conn_offset = 0;
 
     unsigned int num_blocks = md->NumBlocks;
     for (unsigned int j = 0; j < num_blocks; ++j)
       {
       // get the block size
-      unsigned long long num_cells_local = md->BlockNumCells[j];
-      unsigned long long cell_array_size_local = md->BlockCellArraySize[j];
+      size_t num_cells_local = md->BlockNumCells[j];
+      size_t conn_size_local = md->BlockCellArraySize[j] - num_cells_local;
 
-      // define the variable for a local block
+      // read the local block
       if (md->BlockOwner[j] ==  rank)
         {
-        std::string ct_path = ons + "cell_types";
-        adios2_variable *vinfo = adios2_inquire_variable(handles.io, ct_path.c_str());
-        if (!vinfo)
-          {
-          SENSEI_ERROR("ADIOS2 stream is missing \"" << ct_path << "\"")
-          return -1;
-          }
-
-        // /data_object_<id>/cell_types
-        size_t ct_start = cell_types_block_offset;
-        size_t ct_count = num_cells_local;
-
-        if (adios2_set_selection(vinfo, 1, &ct_start, &ct_count))
+        vtkUnstructuredGrid *ds =
+          dynamic_cast<vtkUnstructuredGrid*>(it->GetCurrentDataObject());
+        if (!ds)
           {
-          SENSEI_ERROR("adios2_set_selection start=" << ct_start
-            << " count=" << ct_count << " failed")
+          SENSEI_ERROR("Failed to get block " << j)
+          it->Delete();
           return -1;
           }
 
         vtkUnsignedCharArray *cell_types = vtkUnsignedCharArray::New();
-        cell_types->SetNumberOfComponents(1);
         cell_types->SetNumberOfTuples(num_cells_local);
-        cell_types->SetName("cell_types");
 
-        adios2_error getErr = adios2_get(handles.engine,
-          vinfo, cell_types->GetVoidPointer(0), adios2_mode_sync);
+        vtkDataArray *cell_offsets = nullptr;
+        vtkDataArray *cell_conn = nullptr;
+        sensei::VTKUtils::NewCellArrays(use32, num_cells_local,
+          conn_size_local, cell_offsets, cell_conn);
 
-        if (getErr != 0)
-          {
-          SENSEI_ERROR("adios2_get cell types block " << j <<  " failed")
-          return -1;
-          }
+        size_t starts[3] = {type_offset, offset_offset, conn_offset};
+        size_t counts[3] = {num_cells_local, num_cells_local + 1, conn_size_local};
+        void *dests[3] = {cell_types->GetVoidPointer(0),
+          cell_offsets->GetVoidPointer(0), cell_conn->GetVoidPointer(0)};
 
-        std::string ca_path = ons + "cell_array";
-        adios2_variable *ca_vinfo = adios2_inquire_variable(handles.io, ca_path.c_str());
-        if (!ca_vinfo)
-          {
-          SENSEI_ERROR("adios2_inquire_variable \"" << ca_path
-            << "\" block " << j <<  " failed")
-          return -1;
-          }
+        types.emplace_back(vtkSmartPointer<vtkUnsignedCharArray>::Take(cell_types));
+        offsets.emplace_back(vtkSmartPointer<vtkDataArray>::Take(cell_offsets));
+        conns.emplace_back(vtkSmartPointer<vtkDataArray>::Take(cell_conn));
+        grids.push_back(ds);
 
-        // /data_object_<id>/cell_array
-        size_t ca_start = cell_array_block_offset;
-        size_t ca_count = cell_array_size_local;
-        if (adios2_set_selection(ca_vinfo, 1, &ca_start, &ca_count))
+        for (int q = 0; q < 3; ++q)
           {
-          SENSEI_ERROR("adios2_set_selection start=" << ca_start
-            << " count=" << ca_count << " block " << j <<  " failed")
-          return -1;
+          if (!vars[q])
+            {
+            std::string path = ons + names[q];
+            if (!(vars[q] = this->ReadVariables.Get(handles.io, path)))
+              {
+              SENSEI_ERROR("ADIOS2 stream is missing \"" << path << "\"")
+              it->Delete();
+              return -1;
+              }
+            }
+
+          if (!counts[q])
+            continue;
+
+          if (adios2_set_selection(vars[q], 1, &starts[q], &counts[q]) ||
+            adios2_get(handles.engine, vars[q], dests[q], adios2_mode_deferred))
+            {
+            SENSEI_ERROR("adios2_get " << names[q] << " start=" << starts[q]
+              << " count=" << counts[q] << " block " << j << " failed")
+            it->Delete();
+            return -1;
+            }
           }
 
-        vtkIdTypeArray *cell_array = vtkIdTypeArray::New();
-        cell_array->SetNumberOfComponents(1);
-        cell_array->SetNumberOfTuples(cell_array_size_local);
-        cell_array->SetName("cell_array");
+        numBytes += num_cells_local*sizeof(unsigned char) +
+          (num_cells_local + 1 + conn_size_local)*index_size;
+        }
+
+      // update the block offset
+      type_offset += num_cells_local;
+      offset_offset += num_cells_local + 1;
+      conn_offset += conn_size_local;
 
-        adios2_error ca_getErr = adios2_get(handles.engine,
-          ca_vinfo, cell_array->GetVoidPointer(0), adios2_mode_sync);
+      it->GoToNextItem();
+      }
 
-        if (!ca_getErr)
-          {
-          SENSEI_ERROR("adios2_get cell_array block " << j <<  " failed")
-          return -1;
-          }
+    it->Delete();
 
-        vtkUnstructuredGrid *ds =
-          dynamic_cast<vtkUnstructuredGrid*>(it->GetCurrentDataObject());
-        if (!ds)
-          {
-          SENSEI_ERROR("Failed to get block " << j)
-          return -1;
-          }
-        // build locations
-        vtkIdTypeArray *cell_locs = vtkIdTypeArray::New();
-        cell_locs->SetNumberOfTuples(num_cells_local);
-        vtkIdType *p_locs = cell_locs->GetPointer(0);
-        vtkIdType *p_cells = cell_array->GetPointer(0);
-        p_locs[0] = 0;
-        for (unsigned long i = 1; i < num_cells_local; ++i)
-          p_locs[i] = p_locs[i-1] + p_cells[p_locs[i-1]] + 1;
-
-        // pass types, cell_locs, and cells
-        vtkCellArray *ca = vtkCellArray::New();
-        ca->SetCells(num_cells_local, cell_array);
-        cell_array->Delete();
-
-        ds->SetCells(cell_types, cell_locs, ca);
-
-        cell_locs->Delete();
-        cell_array->Delete();
-        cell_types->Delete();
-
-        numBytes += ct_count*sizeof(unsigned char) + ca_count*sizeof(vtkIdType);
-        }
+    // one transfer for all of the local blocks
+    if (!grids.empty() && adios2_perform_gets(handles.engine))
+      {
+      SENSEI_ERROR("adios2_perform_gets cells of mesh \""
+        << md->MeshName << "\" failed")
+      return -1;
+      }
 
-      // update the block offset
-      cell_types_block_offset += num_cells_local;
-      cell_array_block_offset += cell_array_size_local;
+    // pass types, offsets, and connectivity. each block's cell array is
+    // assembled on its own thread
+    size_t num_local = grids.size();
+    if (sensei::TaskRuntime::ParallelFor(num_local, this->Threads,
+      [&](int, long q) -> int
+      {
+      return sensei::VTKUtils::SetCells(grids[q], types[q], offsets[q],
+        conns[q]) ? -1 : 0;
+      }))
+      {
+      SENSEI_ERROR("Failed to set the cells of mesh \""
+        << md->MeshName << "\"")
+      return -1;
       }
 
     sensei::Profiler::EndEvent("senseiADIOS2::UnstructuredCellSchema::Read", numBytes);
@@ -1848,6 +3025,11 @@ struct PolydataCellSchema
   std::map<std::string, adios2_variable*> CellArrayVars;
   std::map<std::string, std::vector<size_t>> CellArrayStarts;
   std::map<std::string, std::vector<size_t>> CellArrayCounts;
+
+  VariableTable ReadVariables;
+
+  // the threads the cells of the local blocks are assembled on
+  int Threads = 1;
 };
 
 // --------------------------------------------------------------------------
@@ -1885,7 +3067,7 @@ int PolydataCellSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
     // /data_object_<id>/cell_array
     std::string path_ca = ons + "cell_array";
 
-    adios2_variable *var = adios2_define_variable(handles.io,
+    adios2_variable *var = defineVariable(handles.io,
       path_ca.c_str(), cell_array_type, 1, &cell_array_gdims,
       &start, &count, adios2_constant_dims_false);
 
@@ -1901,7 +3083,7 @@ int PolydataCellSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
     // /data_object_<id>/cell_types
     std::string path_ct = ons + "cell_types";
 
-    var = adios2_define_variable(handles.io, path_ct.c_str(),
+    var = defineVariable(handles.io, path_ct.c_str(),
       adios2_type_uint8_t, 1, &cell_type_gdmins, &start, &count,
       adios2_constant_dims_false);
 
@@ -2093,212 +3275,88 @@ int PolydataCellSchema::Read(MPI_Comm comm, AdiosHandle handles,
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
-    vtkCompositeDataIterator *it = dobj->NewIterator();
-    it->SetSkipEmptyNodes(0);
-    it->InitTraversal();
+    // /data_object_<id>/cell_types
+    // /data_object_<id>/cell_array
+    const char *names[2] = {"cell_types", "cell_array"};
+    adios2_variable *vars[2] = {nullptr};
 
-    unsigned long long cell_block_offset = 0;
-    unsigned long long cell_array_block_offset = 0;
+    // the types and cells of all of the local blocks are read with one
+    // transfer, then each block's cell arrays are assembled on its own
+    // thread
+    std::vector<std::vector<unsigned char>> types;
+    std::vector<std::vector<vtkIdType>> cells;
+    std::vector<vtkPolyData*> blocks;
 
-    // read local blocks
     unsigned int num_blocks = md->NumBlocks;
     for (unsigned int j = 0; j < num_blocks; ++j)
       {
-      // get the block size
-      unsigned long long num_cells_local = md->BlockNumCells[j];
-      unsigned long long cell_array_size_local = md->BlockCellArraySize[j];
-
       if (md->BlockOwner[j] == rank)
         {
-        std::string ct_path = ons + "cell_types";
-        adios2_variable *ct_vinfo = adios2_inquire_variable(handles.io, ct_path.c_str());
-        if (!ct_vinfo)
-          {
-          SENSEI_ERROR("adios2_inquire_variable \"" << ct_path
-            << "\" block " << j <<  " failed")
-          return -1;
-          }
-        std::vector<vtkIdType> cell_array(cell_array_size_local);
-        std::vector<unsigned char> cell_types(num_cells_local);
-
-        size_t ct_start = cell_block_offset;
-        size_t ct_count = num_cells_local;
-        if (adios2_set_selection(ct_vinfo, 1, &ct_start, &ct_count))
-          {
-          SENSEI_ERROR("adios2_set_selection start=" << ct_start
-            << " count=" << ct_count << " block " << j <<  " failed")
-          return -1;
-          }
-
-        // /data_object_<id>/cell_types
-        adios2_error ct_getErr = adios2_get(handles.engine,
-          ct_vinfo, cell_types.data(), adios2_mode_sync);
-
-        if (ct_getErr != 0)
-          {
-          SENSEI_ERROR("adios2_get cell_types block " << j <<  " failed")
-          return -1;
-          }
-
-        std::string ca_path = ons + "cell_array";
-
-        adios2_variable *ca_vinfo = adios2_inquire_variable(handles.io,
-          ca_path.c_str());
-
-        if (!ca_vinfo)
-          {
-          SENSEI_ERROR("adios2_inquire_variable \"" << ca_path
-            << "\" block " << j <<  " failed")
-          return -1;
-          }
-
-
-        size_t ca_start = cell_array_block_offset;
-        size_t ca_count = cell_array_size_local;
-        if (adios2_set_selection(ca_vinfo, 1, &ca_start, &ca_count))
-          {
-          SENSEI_ERROR("adios2_set_selection start=" << ca_start
-            << " count=" << ca_count << " block " << j <<  " failed")
-          return -1;
-          }
-
-        // /data_object_<id>/cell_array
-        adios2_error ca_getErr = adios2_get(handles.engine,
-          ca_vinfo, cell_array.data(), adios2_mode_sync);
-
-        if (ca_getErr != 0)
-          {
-          SENSEI_ERROR("adios2_get cell_types block " << j << "failed")
-          return -1;
-          }
-
-        unsigned char *p_types = cell_types.data();
-        vtkIdType *p_cells = cell_array.data();
-
-        // assumptions made here:
-        // data is serialized in the order verts, lines, polys, strips
-
-        // find first and last vert and number of verts
-        unsigned long i = 0;
-        unsigned long n_verts = 0;
-        vtkIdType *vert_begin = p_cells;
-        while ((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
-          {
-          p_cells += p_cells[0] + 1;
-          ++n_verts;
-          ++i;
-          }
-        vtkIdType *vert_end = p_cells;
+        types.emplace_back(md->BlockNumCells[j]);
+        cells.emplace_back(md->BlockCellArraySize[j]);
+        }
+      }
 
-        // find first and last line and number of lines
-        unsigned long n_lines = 0;
-        vtkIdType *line_begin = p_cells;
-        while ((i < num_cells_local) && (p_types[i] == VTK_LINE))
-          {
-          p_cells += p_cells[0] + 1;
-          ++n_lines;
-          ++i;
-          }
-        vtkIdType *line_end = p_cells;
+    vtkCompositeDataIterator *it = dobj->NewIterator();
+    it->SetSkipEmptyNodes(0);
+    it->InitTraversal();
 
-        // find first and last poly and number of polys
-        unsigned long n_polys = 0;
-        vtkIdType *poly_begin = p_cells;
-        while ((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
-          {
-          p_cells += p_cells[0] + 1;
-          ++n_polys;
-          ++i;
-          }
-        vtkIdType *poly_end = p_cells;
+    size_t cell_block_offset = 0;
+    size_t cell_array_block_offset = 0;
 
-        // find first and last strip and number of strips
-        unsigned long n_strips = 0;
-        vtkIdType *strip_begin = p_cells;
-        while ((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
-          {
-          p_cells += p_cells[0] + 1;
-          ++n_strips;
-          ++i;
-          }
-        vtkIdType *strip_end = p_cells;
+    for (unsigned int j = 0, k = 0; j < num_blocks; ++j)
+      {
+      // get the block size
+      size_t num_cells_local = md->BlockNumCells[j];
+      size_t cell_array_size_local = md->BlockCellArraySize[j];
 
-        // pass into vtk
+      if (md->BlockOwner[j] == rank)
+        {
         vtkPolyData *pd = dynamic_cast<vtkPolyData*>(it->GetCurrentDataObject());
         if (!pd)
           {
           SENSEI_ERROR("Failed to get block " << j)
+          it->Delete();
           return -1;
           }
+        blocks.push_back(pd);
 
-        // pass verts
-        unsigned long n_tups = vert_end - vert_begin;
-        vtkIdTypeArray *verts = vtkIdTypeArray::New();
-        verts->SetNumberOfTuples(n_tups);
-        vtkIdType *p_verts = verts->GetPointer(0);
-
-        for (unsigned long j = 0; j < n_tups; ++j)
-          p_verts[j] = vert_begin[j];
-
-        vtkCellArray *ca = vtkCellArray::New();
-        ca->SetCells(n_verts, verts);
-        verts->Delete();
-
-        pd->SetVerts(ca);
-        ca->Delete();
-
-        // pass lines
-        n_tups = line_end - line_begin;
-        vtkIdTypeArray *lines = vtkIdTypeArray::New();
-        lines->SetNumberOfTuples(n_tups);
-        vtkIdType *p_lines = lines->GetPointer(0);
-
-        for (unsigned long j = 0; j < n_tups; ++j)
-          p_lines[j] = line_begin[j];
-
-        ca = vtkCellArray::New();
-        ca->SetCells(n_lines, lines);
-        lines->Delete();
-
-        pd->SetLines(ca);
-        ca->Delete();
-
-        // pass polys
-        n_tups = poly_end - poly_begin;
-        vtkIdTypeArray *polys = vtkIdTypeArray::New();
-        polys->SetNumberOfTuples(n_tups);
-        vtkIdType *p_polys = polys->GetPointer(0);
-
-        for (unsigned long j = 0; j < n_tups; ++j)
-          p_polys[j] = poly_begin[j];
-
-        ca = vtkCellArray::New();
-        ca->SetCells(n_polys, polys);
-        polys->Delete();
-
-        pd->SetPolys(ca);
-        ca->Delete();
-
-        // pass strips
-        n_tups = strip_end - strip_begin;
-        vtkIdTypeArray *strips = vtkIdTypeArray::New();
-        strips->SetNumberOfTuples(n_tups);
-        vtkIdType *p_strips = strips->GetPointer(0);
-
-        for (unsigned long j = 0; j < n_tups; ++j)
-          p_strips[j] = strip_begin[j];
+        size_t starts[2] = {cell_block_offset, cell_array_block_offset};
+        size_t counts[2] = {num_cells_local, cell_array_size_local};
+        void *dests[2] = {types[k].data(), cells[k].data()};
+        ++k;
 
-        ca = vtkCellArray::New();
-        ca->SetCells(n_strips, strips);
-        strips->Delete();
-
-        pd->SetStrips(ca);
-        ca->Delete();
-
-        pd->BuildCells();
+        for (int q = 0; q < 2; ++q)
+          {
+          if (!vars[q])
+            {
+            std::string path = ons + names[q];
+            if (!(vars[q] = this->ReadVariables.Get(handles.io, path)))
+              {
+              SENSEI_ERROR("adios2_inquire_variable \"" << path
+                << "\" block " << j <<  " failed")
+              it->Delete();
+              return -1;
+              }
+            }
+
+          if (!counts[q])
+            continue;
+
+          if (adios2_set_selection(vars[q], 1, &starts[q], &counts[q]) ||
+            adios2_get(handles.engine, vars[q], dests[q], adios2_mode_deferred))
+            {
+            SENSEI_ERROR("adios2_get " << names[q] << " start=" << starts[q]
+              << " count=" << counts[q] << " block " << j <<  " failed")
+            it->Delete();
+            return -1;
+            }
+          }
 
-        numBytes += ct_count*sizeof(unsigned char) + ca_count*sizeof(vtkIdType);
+        numBytes += num_cells_local*sizeof(unsigned char) +
+          cell_array_size_local*sizeof(vtkIdType);
         }
+
       // go to the next block
       it->GoToNextItem();
 
@@ -2309,6 +3367,26 @@ int PolydataCellSchema::Read(MPI_Comm comm, AdiosHandle handles,
 
     it->Delete();
 
+    if (!blocks.empty() && adios2_perform_gets(handles.engine))
+      {
+      SENSEI_ERROR("adios2_perform_gets cells of mesh \""
+        << md->MeshName << "\" failed")
+      return -1;
+      }
+
+    // pass into vtk
+    if (sensei::TaskRuntime::ParallelFor(blocks.size(), this->Threads,
+      [&](int, long q) -> int
+      {
+      return sensei::VTKUtils::SetPolydataCells(blocks[q], types[q].data(),
+        cells[q].data(), types[q].size()) ? -1 : 0;
+      }))
+      {
+      SENSEI_ERROR("Failed to set the cells of mesh \""
+        << md->MeshName << "\"")
+      return -1;
+      }
+
     sensei::Profiler::EndEvent("senseiADIOS2::PolydataCellSchema::Read", numBytes);
     }
 
@@ -2330,6 +3408,8 @@ struct LogicallyCartesianSchema
     vtkCompositeDataSet *dobj);
 
   std::map<std::string, adios2_variable*> WriteVars;
+
+  VariableTable ReadVariables;
 };
 
 // --------------------------------------------------------------------------
@@ -2352,7 +3432,7 @@ int LogicallyCartesianSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles
     // /data_object_<id>/extent
     std::string path_extent = ons + "extent";
 
-    adios2_variable *var = adios2_define_variable(handles.io,
+    adios2_variable *var = defineVariable(handles.io,
        path_extent.c_str(), adios2_type_int32_t, 1, &gdims,
        &start, &count, adios2_constant_dims_false);
 
@@ -2469,51 +3549,65 @@ int LogicallyCartesianSchema::Read(MPI_Comm comm, AdiosHandle handles,
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
-    vtkCompositeDataIterator *it = dobj->NewIterator();
-    it->SetSkipEmptyNodes(0);
-    it->InitTraversal();
+    // /data_object_<id>/extent
+    std::string extent_path = ons + "extent";
+    adios2_variable *vinfo = nullptr;
 
-    // read each block
+    // the extents of all local blocks are requested together
     unsigned int num_blocks = md->NumBlocks;
+    std::vector<std::array<int,6>> exts(num_blocks);
+    bool have_local = false;
+
     for (unsigned int j = 0; j < num_blocks; ++j)
       {
       // read the variable for a local block
       if (md->BlockOwner[j] ==  rank)
         {
-        std::string extent_path = ons + "extent";
-        adios2_variable *vinfo = adios2_inquire_variable(handles.io, extent_path.c_str());
-        if (!vinfo)
+        if (!vinfo && !(vinfo = this->ReadVariables.Get(handles.io, extent_path)))
           {
           SENSEI_ERROR("adios2_inquire_variable \"" << extent_path
             << "\" block " << j <<  " failed")
           return -1;
           }
 
-        // /data_object_<id>/extent
         size_t hexplet_start = 6*j;
         size_t hexplet_count = 6;
-        if (adios2_set_selection(vinfo, 1, &hexplet_start, &hexplet_count))
+        if (adios2_set_selection(vinfo, 1, &hexplet_start, &hexplet_count) ||
+          adios2_get(handles.engine, vinfo, exts[j].data(), adios2_mode_deferred))
           {
-          SENSEI_ERROR("adios2_set_selection start=" << hexplet_start
+          SENSEI_ERROR("adios2_get extent start=" << hexplet_start
             << " count=" << hexplet_count << " block " << j <<  " failed")
           return -1;
           }
 
-        int ext[6] = {0};
-        adios2_error getErr = adios2_get(handles.engine, vinfo, ext, adios2_mode_sync);
-        if (getErr != 0)
-          {
-          SENSEI_ERROR("adios2_get extent block " << j << " failed")
-          return -1;
-          }
+        have_local = true;
+        }
+      }
+
+    if (have_local && adios2_perform_gets(handles.engine))
+      {
+      SENSEI_ERROR("adios2_perform_gets extent failed")
+      return -1;
+      }
+
+    // update the vtk objects
+    vtkCompositeDataIterator *it = dobj->NewIterator();
+    it->SetSkipEmptyNodes(0);
+    it->InitTraversal();
 
-        // update the vtk object
+    for (unsigned int j = 0; j < num_blocks; ++j)
+      {
+      if (md->BlockOwner[j] ==  rank)
+        {
         vtkDataObject *dobj = it->GetCurrentDataObject();
         if (!dobj)
           {
           SENSEI_ERROR("Failed to get block " << j)
+          it->Delete();
           return -1;
           }
+
+        int *ext = exts[j].data();
         switch (md->BlockType)
           {
           case VTK_RECTILINEAR_GRID:
@@ -2556,6 +3650,8 @@ struct UniformCartesianSchema
 
   std::map<std::string, adios2_variable*> OriginWriteVar;
   std::map<std::string, adios2_variable*> SpacingWriteVar;
+
+  VariableTable ReadVariables;
 };
 
 // --------------------------------------------------------------------------
@@ -2581,7 +3677,7 @@ int UniformCartesianSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
     // /data_object_<id>/origin
     std::string path_origin = ons + "origin";
 
-    adios2_variable *var = adios2_define_variable(handles.io,
+    adios2_variable *var = defineVariable(handles.io,
       path_origin.c_str(), adios2_type_double, 1, &gdims,
       &loffs, &ldims, adios2_constant_dims_false);
 
@@ -2597,7 +3693,7 @@ int UniformCartesianSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
     // /data_object_<id>/spacing
     std::string path_spacing = ons + "spacing";
 
-    var = adios2_define_variable(handles.io, path_spacing.c_str(),
+    var = defineVariable(handles.io, path_spacing.c_str(),
        adios2_type_double, 1, &gdims, &loffs,  &ldims,
        adios2_constant_dims_false);
 
@@ -2703,83 +3799,78 @@ int UniformCartesianSchema::Read(MPI_Comm comm, AdiosHandle handles,
     int rank = 0;
     MPI_Comm_rank(comm, &rank);
 
-    vtkCompositeDataIterator *it = dobj->NewIterator();
-    it->SetSkipEmptyNodes(0);
-    it->InitTraversal();
+    // /data_object_<id>/origin
+    // /data_object_<id>/spacing
+    std::string origin_path = ons + "origin";
+    std::string spacing_path = ons + "spacing";
+    adios2_variable *origin_vinfo = nullptr;
+    adios2_variable *spacing_vinfo = nullptr;
 
-    // define for each block
+    // the origin and spacing of all local blocks are requested together
     unsigned int num_blocks = md->NumBlocks;
+    std::vector<std::array<double,6>> x0dx(num_blocks);
+    bool have_local = false;
+
     for (unsigned int j = 0; j < num_blocks; ++j)
       {
-      // define the variable for a local block
       if (md->BlockOwner[j] ==  rank)
         {
-        std::string origin_path = ons + "origin";
-        adios2_variable *origin_vinfo = adios2_inquire_variable(handles.io, origin_path.c_str());
-        if (!origin_vinfo)
+        if (!origin_vinfo &&
+          !(origin_vinfo = this->ReadVariables.Get(handles.io, origin_path)))
           {
           SENSEI_ERROR("adios2_inquire_variable \"" << origin_path
             << "\" block " << j <<  " failed")
           return -1;
           }
 
-        size_t triplet_start = 3*j;
-        size_t triplet_count = 3;
-        if (adios2_set_selection(origin_vinfo, 1, &triplet_start, &triplet_count))
-          {
-          SENSEI_ERROR("adios2_set_selection block " << j << " start=" << triplet_start
-            << " count=" << triplet_count << " failed")
-          return -1;
-          }
-
-        // /data_object_<id>/data_array_<id>/origin
-        double x0[3] = {0.0};
-
-        if (adios2_get(handles.engine, origin_vinfo, x0, adios2_mode_sync))
-          {
-          SENSEI_ERROR("adios2_get origin block " << j << " failed")
-          return -1;
-          }
-
-        // /data_object_<id>/data_array_<id>/spacing
-        double dx[3] = {0.0};
-        std::string spacing_path = ons + "spacing";
-        adios2_variable *spacing_vinfo = adios2_inquire_variable(handles.io, spacing_path.c_str());
-        if (!spacing_vinfo)
+        if (!spacing_vinfo &&
+          !(spacing_vinfo = this->ReadVariables.Get(handles.io, spacing_path)))
           {
           SENSEI_ERROR("ADIOS2 stream is missing \"" << spacing_path << "\"")
           return -1;
           }
 
-        if (adios2_set_selection(spacing_vinfo, 1, &triplet_start, &triplet_count))
+        size_t triplet_start = 3*j;
+        size_t triplet_count = 3;
+        if (adios2_set_selection(origin_vinfo, 1, &triplet_start, &triplet_count) ||
+          adios2_get(handles.engine, origin_vinfo, x0dx[j].data(), adios2_mode_deferred) ||
+          adios2_set_selection(spacing_vinfo, 1, &triplet_start, &triplet_count) ||
+          adios2_get(handles.engine, spacing_vinfo, x0dx[j].data() + 3, adios2_mode_deferred))
           {
-          SENSEI_ERROR("adios2_set_selection block " << j << " start=" << triplet_start
-            << " count=" << triplet_count << " failed")
+          SENSEI_ERROR("adios2_get origin and spacing block " << j << " start="
+            << triplet_start << " count=" << triplet_count << " failed")
           return -1;
           }
 
-        if (adios2_get(handles.engine, spacing_vinfo, dx, adios2_mode_sync))
-          {
-          SENSEI_ERROR("adios2_get spacing block " << j << " failed")
-          return -1;
-          }
+        have_local = true;
+        }
+      }
 
-        if (adios2_perform_gets(handles.engine))
-          {
-          SENSEI_ERROR("adios2_perform_gets block " << j << " failed")
-          return -1;
-          }
+    if (have_local && adios2_perform_gets(handles.engine))
+      {
+      SENSEI_ERROR("adios2_perform_gets origin and spacing failed")
+      return -1;
+      }
+
+    // update the vtk objects
+    vtkCompositeDataIterator *it = dobj->NewIterator();
+    it->SetSkipEmptyNodes(0);
+    it->InitTraversal();
 
-        // update the vtk object
+    for (unsigned int j = 0; j < num_blocks; ++j)
+      {
+      if (md->BlockOwner[j] ==  rank)
+        {
         vtkImageData *ds = dynamic_cast<vtkImageData*>(it->GetCurrentDataObject());
         if (!ds)
           {
           SENSEI_ERROR("Failed to get block " << j << " not image data")
+          it->Delete();
           return -1;
           }
 
-        ds->SetOrigin(x0);
-        ds->SetSpacing(dx);
+        ds->SetOrigin(x0dx[j].data());
+        ds->SetSpacing(x0dx[j].data() + 3);
 
         numBytes += 6*sizeof(double);
         }
@@ -2818,6 +3909,8 @@ struct StretchedCartesianSchema
   std::map<std::string, adios2_variable*> ZCoordWriteVars;
   std::map<std::string, std::vector<size_t>> ZCoordStarts;
   std::map<std::string, std::vector<size_t>> ZCoordCounts;
+
+  VariableTable ReadVariables;
 };
 
 // --------------------------------------------------------------------------
@@ -2858,7 +3951,7 @@ int StretchedCartesianSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles
     // /data_object_<id>/x_coords
     std::string path_xc = ons + "x_coords";
 
-    adios2_variable *var = adios2_define_variable(handles.io,
+    adios2_variable *var = defineVariable(handles.io,
        path_xc.c_str(), point_type, 1, &nx_total, &start, &count,
        adios2_constant_dims_false);
 
@@ -2874,7 +3967,7 @@ int StretchedCartesianSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles
     // /data_object_<id>/y_coords
     std::string path_yc = ons + "y_coords";
 
-    var = adios2_define_variable(handles.io, path_yc.c_str(),
+    var = defineVariable(handles.io, path_yc.c_str(),
        point_type, 1, &ny_total, &start, &count,
        adios2_constant_dims_false);
 
@@ -2890,7 +3983,7 @@ int StretchedCartesianSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles
     // /data_object_<id>/data_array_<id>/z_coords
     std::string path_zc = ons + "z_coords";
 
-    var = adios2_define_variable(handles.io,
+    var = defineVariable(handles.io,
       path_zc.c_str(), point_type, 1, &nz_total, &start, &count,
       adios2_constant_dims_false);
 
@@ -3004,8 +4097,7 @@ int StretchedCartesianSchema::Write(MPI_Comm comm, AdiosHandle handles,
           }
 
         vtkDataArray *xda = ds->GetXCoordinates();
-        if (adios2_put(handles.engine, xcVar,
-          xda->GetVoidPointer(0), adios2_mode_sync))
+        if (putArray(handles.engine, xcVar, xda))
           {
           SENSEI_ERROR("adios2_put x-coordinates block " << j << " failed")
           return -1;
@@ -3022,8 +4114,7 @@ int StretchedCartesianSchema::Write(MPI_Comm comm, AdiosHandle handles,
           }
 
         vtkDataArray *yda = ds->GetYCoordinates();
-        if (adios2_put(handles.engine, ycVar,
-          yda->GetVoidPointer(0), adios2_mode_sync))
+        if (putArray(handles.engine, ycVar, yda))
           {
           SENSEI_ERROR("adios2_put y-coordinates block " << j << " failed")
           return -1;
@@ -3039,8 +4130,7 @@ int StretchedCartesianSchema::Write(MPI_Comm comm, AdiosHandle handles,
           return -1;
           }
 
-        if (adios2_put(handles.engine, zcVar,
-          zda->GetVoidPointer(0), adios2_mode_sync))
+        if (putArray(handles.engine, zcVar, zda))
           {
           SENSEI_ERROR("adios2_put y-coordinates block " << j << " failed")
           return -1;
@@ -3078,152 +4168,97 @@ int StretchedCartesianSchema::Read(MPI_Comm comm, AdiosHandle handles,
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
 
-    unsigned long long xc_offset = 0;
-    unsigned long long yc_offset = 0;
-    unsigned long long zc_offset = 0;
+    // /data_object_<id>/data_array_<id>/x_coords
+    // /data_object_<id>/data_array_<id>/y_coords
+    // /data_object_<id>/data_array_<id>/z_coords
+    const char *names[3] = {"x_coords", "y_coords", "z_coords"};
+    adios2_variable *vars[3] = {nullptr, nullptr, nullptr};
+    unsigned long long offsets[3] = {0, 0, 0};
+    bool have_local = false;
 
+    // the coordinates are read into the arrays passed to vtk. the reads of
+    // all local blocks are issued together
     unsigned int num_blocks = md->NumBlocks;
     for (unsigned int j = 0; j < num_blocks; ++j)
       {
       // get the block size
       int *ext = md->BlockExtents[j].data();
-      unsigned long long nx_local = ext[1] - ext[0] + 2;
-      unsigned long long ny_local = ext[3] - ext[2] + 2;
-      unsigned long long nz_local = ext[5] - ext[4] + 2;
+      unsigned long long n_local[3] = {(unsigned long long)(ext[1] - ext[0] + 2),
+        (unsigned long long)(ext[3] - ext[2] + 2),
+        (unsigned long long)(ext[5] - ext[4] + 2)};
 
       // define the variable for a local block
-      if (md->BlockOwner[j] ==  rank)
-        {
-        std::string xc_path = ons + "x_coords";
-        adios2_variable *xc_vinfo = adios2_inquire_variable(handles.io, xc_path.c_str());
-        if (!xc_vinfo)
-          {
-          SENSEI_ERROR("adios2_inquire_variable \"" << xc_path
-            << "\" block " << j <<  " failed")
-          return -1;
-          }
-
-        // /data_object_<id>/data_array_<id>/x_coords
-        size_t x_start = xc_offset;
-        size_t x_count = nx_local;
-        if (adios2_set_selection(xc_vinfo, 1, &x_start, &x_count))
-          {
-          SENSEI_ERROR("adios2_set_selection block " << j << " start=" << x_start
-            << " count=" << x_count << " failed")
-          return -1;
-          }
-
-        vtkDataArray *x_coords = vtkDataArray::CreateDataArray(md->CoordinateType);
-        x_coords->SetNumberOfComponents(1);
-        x_coords->SetNumberOfTuples(nx_local);
-        x_coords->SetName("x_coords");
-
-        if (adios2_get(handles.engine, xc_vinfo,
-          x_coords->GetVoidPointer(0), adios2_mode_sync))
-          {
-          SENSEI_ERROR("adios2_get x_coords block " << j << " failed")
-          return -1;
-          }
-
-        std::string yc_path = ons + "y_coords";
-        adios2_variable *yc_vinfo = adios2_inquire_variable(handles.io, yc_path.c_str());
-        if (!yc_vinfo)
-          {
-          SENSEI_ERROR("adios2_inquire_variable \"" << yc_path
-            << "\" block " << j <<  " failed")
-          return -1;
-          }
-
-        // /data_object_<id>/data_array_<id>/y_coords
-        size_t y_start = yc_offset;
-        size_t y_count = ny_local;
-        if (adios2_set_selection(yc_vinfo, 1, &y_start, &y_count))
-          {
-          SENSEI_ERROR("adios2_set_selection block " << j << " start=" << y_start
-            << " count=" << y_count << " failed")
-          return -1;
-          }
-
-        vtkDataArray *y_coords = vtkDataArray::CreateDataArray(md->CoordinateType);
-        y_coords->SetNumberOfComponents(1);
-        y_coords->SetNumberOfTuples(ny_local);
-        y_coords->SetName("y_coords");
-
-        if (adios2_get(handles.engine, yc_vinfo,
-          y_coords->GetVoidPointer(0), adios2_mode_sync))
-          {
-          SENSEI_ERROR("adios2_get y_coords block " << j << " failed")
-          return -1;
-          }
-
-        std::string zc_path = ons + "z_coords";
-        adios2_variable *zc_vinfo = adios2_inquire_variable(handles.io, zc_path.c_str());
-        if (!zc_vinfo)
-          {
-          SENSEI_ERROR("adios2_inquire_variable \"" << zc_path
-            << "\" block " << j <<  " failed")
-          return -1;
-          }
-
-        // /data_object_<id>/data_array_<id>/z_coords
-        size_t z_start = zc_offset;
-        size_t z_count = nz_local;
-        if (adios2_set_selection(zc_vinfo, 1, &z_start, &z_count))
-          {
-          SENSEI_ERROR("adios2_set_selection block " << j << " start=" << z_start
-            << " count=" << z_count << " failed")
-          return -1;
-          }
-
-        vtkDataArray *z_coords = vtkDataArray::CreateDataArray(md->CoordinateType);
-        z_coords->SetNumberOfComponents(1);
-        z_coords->SetNumberOfTuples(nz_local);
-        z_coords->SetName("z_coords");
-
-        if (adios2_get(handles.engine, zc_vinfo,
-          z_coords->GetVoidPointer(0), adios2_mode_sync))
-          {
-          SENSEI_ERROR("adios2_get z_coords block " << j << " failed")
-          return -1;
-          }
-
-        if (adios2_perform_gets(handles.engine))
-          {
-          SENSEI_ERROR("Failed to read stretched Cartesian block " << j)
-          return -1;
-          }
-
-        // update the vtk object
+      if (md->BlockOwner[j] ==  rank)
+        {
         vtkRectilinearGrid *ds = dynamic_cast<vtkRectilinearGrid*>(it->GetCurrentDataObject());
         if (!ds)
           {
           SENSEI_ERROR("Failed to get block " << j)
+          it->Delete();
           return -1;
           }
 
-        ds->SetXCoordinates(x_coords);
-        ds->SetYCoordinates(y_coords);
-        ds->SetZCoordinates(z_coords);
-
-        x_coords->Delete();
-        y_coords->Delete();
-        z_coords->Delete();
+        for (int q = 0; q < 3; ++q)
+          {
+          std::string path = ons + names[q];
+          if (!vars[q] && !(vars[q] = this->ReadVariables.Get(handles.io, path)))
+            {
+            SENSEI_ERROR("adios2_inquire_variable \"" << path
+              << "\" block " << j <<  " failed")
+            it->Delete();
+            return -1;
+            }
+
+          vtkDataArray *coords = vtkDataArray::CreateDataArray(md->CoordinateType);
+          coords->SetNumberOfComponents(1);
+          coords->SetNumberOfTuples(n_local[q]);
+          coords->SetName(names[q]);
+
+          size_t start = offsets[q];
+          size_t count = n_local[q];
+          if (adios2_set_selection(vars[q], 1, &start, &count) ||
+            adios2_get(handles.engine, vars[q], coords->GetVoidPointer(0),
+              adios2_mode_deferred))
+            {
+            SENSEI_ERROR("adios2_get " << names[q] << " block " << j
+              << " start=" << start << " count=" << count << " failed")
+            coords->Delete();
+            it->Delete();
+            return -1;
+            }
+
+          // the grid holds the array until the gets are performed
+          if (q == 0)
+            ds->SetXCoordinates(coords);
+          else if (q == 1)
+            ds->SetYCoordinates(coords);
+          else
+            ds->SetZCoordinates(coords);
+
+          coords->Delete();
+
+          numBytes += count*size(md->CoordinateType);
+          }
 
-        long long cts = size(md->CoordinateType);
-        numBytes += x_count*cts + y_count*cts + z_count*cts;
+        have_local = true;
         }
 
       // next block
       it->GoToNextItem();
 
       // update the block offset
-      xc_offset += nx_local;
-      yc_offset += ny_local;
-      zc_offset += nz_local;
+      for (int q = 0; q < 3; ++q)
+        offsets[q] += n_local[q];
       }
 
     it->Delete();
 
+    if (have_local && adios2_perform_gets(handles.engine))
+      {
+      SENSEI_ERROR("Failed to read stretched Cartesian blocks")
+      return -1;
+      }
+
     sensei::Profiler::EndEvent("senseiADIOS2::StretchedCartesianSchema::Read", numBytes);
     }
 
@@ -3238,7 +4273,8 @@ struct DataObjectSchema
     unsigned int doid,  const sensei::MeshMetadataPtr &md);
 
   int Write(MPI_Comm comm, AdiosHandle handles, unsigned int doid,
-    const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
+    const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj,
+    const std::vector<int> *changed);
 
   int ReadMesh(MPI_Comm comm, AdiosHandle handles,
     unsigned int doid, const sensei::MeshMetadataPtr &md,
@@ -3246,11 +4282,39 @@ struct DataObjectSchema
 
   int ReadArray(MPI_Comm comm, AdiosHandle handles,
     unsigned int doid, const std::string &name, int association,
-    const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
+    const sensei::MeshMetadataPtr &md, int soa, vtkCompositeDataSet *dobj);
 
   int InitializeDataObject(MPI_Comm comm,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *&dobj);
 
+  // forget the variables looked up by the readers. this must be called
+  // when a new step is begun
+  void ClearReadVariables();
+
+  // give the local blocks the geometry cached when it was read at step
+  int ReuseGeometry(MPI_Comm comm, const sensei::MeshMetadataPtr &md,
+    unsigned long step, vtkCompositeDataSet *dobj);
+
+  // keep the geometry of the local blocks read at step
+  void CacheGeometry(MPI_Comm comm, const sensei::MeshMetadataPtr &md,
+    unsigned long step, vtkCompositeDataSet *dobj);
+
+  // the step at which the geometry of each static mesh was last written,
+  // 0 when it has not been since its variables were defined
+  std::map<std::string,unsigned long> GeometryStep;
+
+  // the geometry read for the local blocks, shallow copies of the points
+  // and cells, kept for the steps in which the writer skips it
+  struct CachedGeometry
+  {
+    CachedGeometry() : Step(0) {}
+    unsigned long Step;
+    std::vector<unsigned int> Blocks;
+    std::vector<vtkSmartPointer<vtkDataSet>> Structure;
+  };
+
+  std::map<std::string,CachedGeometry> GeometryCache;
+
   ArraySchema DataArrays;
   PointSchema Points;
   UnstructuredCellSchema UnstructuredCells;
@@ -3271,6 +4335,18 @@ int DataObjectSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
   std::ostringstream ons;
   ons << "data_object_" << doid << "/";
 
+  // the geometry is written in full at the next step
+  this->GeometryStep.erase(md->MeshName);
+
+  // /data_object_<id>/geometry_step
+  std::string path = ons.str() + "geometry_step";
+  if (!defineVariable(handles.io, path.c_str(), adios2_type_uint64_t, 0,
+    NULL, NULL, NULL, adios2_constant_dims_true))
+    {
+    SENSEI_ERROR("adios2_define_variable \"" << path << "\" failed")
+    return -1;
+    }
+
   if (this->DataArrays.DefineVariables(comm, handles, ons.str(), md) ||
     this->Points.DefineVariables(comm, handles, ons.str(), md) ||
     this->UnstructuredCells.DefineVariables(comm, handles, ons.str(), md) ||
@@ -3289,14 +4365,26 @@ int DataObjectSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
 
 // --------------------------------------------------------------------------
 int DataObjectSchema::Write(MPI_Comm comm, AdiosHandle handles, unsigned int doid,
-  const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj)
+  const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj,
+  const std::vector<int> *changed)
 {
   sensei::TimeEvent<128> mark("senseiADIOS2::DataObjectSchema::Write");
 
-  if (this->DataArrays.Write(comm, handles, md, dobj) ||
-    this->Points.Write(comm, handles, md, dobj) ||
+  // put each data object in its own namespace
+  std::ostringstream ons;
+  ons << "data_object_" << doid << "/";
+
+  // when changes are tracked the points and cells of a static mesh are
+  // written once, readers reuse the copy they read then. the coordinates
+  // and extents, which are small, are written every step
+  unsigned long &geometry_step = this->GeometryStep[md->MeshName];
+  bool skip_geometry = changed && md->StaticMesh && geometry_step;
+
+  if (this->DataArrays.Write(comm, handles, ons.str(), md, dobj, changed) ||
+    (!skip_geometry &&
+    (this->Points.Write(comm, handles, md, dobj) ||
     this->UnstructuredCells.Write(comm, handles, md, dobj) ||
-    this->PolydataCells.Write(comm, handles, md, dobj) ||
+    this->PolydataCells.Write(comm, handles, md, dobj))) ||
     this->UniformCartesian.Write(comm, handles, md, dobj) ||
     this->StretchedCartesian.Write(comm, handles, md, dobj) ||
     this->LogicallyCartesian.Write(comm, handles, md, dobj))
@@ -3306,6 +4394,19 @@ int DataObjectSchema::Write(MPI_Comm comm, AdiosHandle handles, unsigned int doi
     return -1;
     }
 
+  // the data step was advanced by the data arrays
+  if (!skip_geometry)
+    geometry_step = this->DataArrays.DataStep[md->MeshName];
+
+  // /data_object_<id>/geometry_step
+  std::string path = ons.str() + "geometry_step";
+  if (adios2_put_by_name(handles.engine, path.c_str(), &geometry_step,
+    adios2_mode_sync))
+    {
+    SENSEI_ERROR("adios2_put_by_name \"" << path << "\" failed")
+    return -1;
+    }
+
   return 0;
 }
 
@@ -3328,7 +4429,32 @@ int DataObjectSchema::ReadMesh(MPI_Comm comm, AdiosHandle handles,
   std::ostringstream ons;
   ons << "data_object_" << doid << "/";
 
-  if ((!structure_only &&
+  // the geometry of a static mesh is written once when the writer tracks
+  // changes, the copy read then is reused. streams without the steps are
+  // read every step
+  unsigned long data_step = 0;
+  unsigned long geometry_step = 0;
+
+  adios2_variable *data_step_var =
+    this->DataArrays.ReadVariables.Get(handles.io, ons.str() + "data_step");
+
+  adios2_variable *geometry_step_var =
+    this->DataArrays.ReadVariables.Get(handles.io, ons.str() + "geometry_step");
+
+  bool tracked = data_step_var && geometry_step_var &&
+    !adios2_get(handles.engine, data_step_var, &data_step, adios2_mode_sync) &&
+    !adios2_get(handles.engine, geometry_step_var, &geometry_step, adios2_mode_sync);
+
+  bool reuse = tracked && !structure_only && (geometry_step != data_step);
+
+  if (reuse && this->ReuseGeometry(comm, md, geometry_step, dobj))
+    {
+    SENSEI_ERROR("Failed to reuse the geometry of object "
+      << doid << " \"" << md->MeshName << "\"")
+    return -1;
+    }
+
+  if ((!structure_only && !reuse &&
     (this->Points.Read(comm, handles, ons.str(), md, dobj) ||
     this->UnstructuredCells.Read(comm, handles, ons.str(), md, dobj) ||
     this->PolydataCells.Read(comm, handles, ons.str(), md, dobj))) ||
@@ -3341,13 +4467,110 @@ int DataObjectSchema::ReadMesh(MPI_Comm comm, AdiosHandle handles,
     return -1;
     }
 
+  if (tracked && !reuse && !structure_only && md->StaticMesh)
+    this->CacheGeometry(comm, md, geometry_step, dobj);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int DataObjectSchema::ReuseGeometry(MPI_Comm comm,
+  const sensei::MeshMetadataPtr &md, unsigned long step,
+  vtkCompositeDataSet *dobj)
+{
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  std::vector<unsigned int> local_blocks;
+  for (int j = 0; j < md->NumBlocks; ++j)
+    {
+    if (md->BlockOwner[j] == rank)
+      local_blocks.push_back(j);
+    }
+
+  CachedGeometry &cache = this->GeometryCache[md->MeshName];
+  if ((cache.Step != step) || (cache.Blocks != local_blocks))
+    {
+    SENSEI_ERROR("The geometry of mesh \"" << md->MeshName << "\" was "
+      "last written at step " << step << " which was not read for the local "
+      "blocks. Readers of a stream with static geometry skipped must read "
+      "the mesh at every step with the same partition")
+    return -1;
+    }
+
+  vtkCompositeDataIterator *it = dobj->NewIterator();
+  it->SetSkipEmptyNodes(0);
+  it->InitTraversal();
+
+  for (int j = 0, k = 0; j < md->NumBlocks; ++j)
+    {
+    if (md->BlockOwner[j] == rank)
+      {
+      vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+      if (!ds)
+        {
+        SENSEI_ERROR("Failed to get block " << j)
+        it->Delete();
+        return -1;
+        }
+
+      if (cache.Structure[k])
+        ds->CopyStructure(cache.Structure[k]);
+
+      ++k;
+      }
+
+    it->GoToNextItem();
+    }
+
+  it->Delete();
+
   return 0;
 }
 
+// --------------------------------------------------------------------------
+void DataObjectSchema::CacheGeometry(MPI_Comm comm,
+  const sensei::MeshMetadataPtr &md, unsigned long step,
+  vtkCompositeDataSet *dobj)
+{
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  CachedGeometry &cache = this->GeometryCache[md->MeshName];
+  cache.Step = step;
+  cache.Blocks.clear();
+  cache.Structure.clear();
+
+  vtkCompositeDataIterator *it = dobj->NewIterator();
+  it->SetSkipEmptyNodes(0);
+  it->InitTraversal();
+
+  for (int j = 0; j < md->NumBlocks; ++j)
+    {
+    if (md->BlockOwner[j] == rank)
+      {
+      // the points and cells are shared, not copied
+      vtkSmartPointer<vtkDataSet> structure;
+      if (vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject()))
+        {
+        structure.TakeReference(ds->NewInstance());
+        structure->CopyStructure(ds);
+        }
+
+      cache.Blocks.push_back(j);
+      cache.Structure.push_back(structure);
+      }
+
+    it->GoToNextItem();
+    }
+
+  it->Delete();
+}
+
 // --------------------------------------------------------------------------
 int DataObjectSchema::ReadArray(MPI_Comm comm, AdiosHandle handles,
   unsigned int doid, const std::string &name, int association,
-  const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj)
+  const sensei::MeshMetadataPtr &md, int soa, vtkCompositeDataSet *dobj)
 {
   sensei::TimeEvent<128> mark(
     "senseiADIOS2::DataObjectSchema::ReadArray");
@@ -3355,7 +4578,8 @@ int DataObjectSchema::ReadArray(MPI_Comm comm, AdiosHandle handles,
   std::ostringstream ons;
   ons << "data_object_" << doid << "/";
 
-  if (this->DataArrays.Read(comm, handles, ons.str(), name, association, md, dobj))
+  if (this->DataArrays.Read(comm, handles, ons.str(), name, association, md,
+    soa, dobj))
     {
     SENSEI_ERROR("Failed to define variables for object "
       << doid << " \"" << md->MeshName << "\"")
@@ -3365,6 +4589,18 @@ int DataObjectSchema::ReadArray(MPI_Comm comm, AdiosHandle handles,
   return 0;
 }
 
+// --------------------------------------------------------------------------
+void DataObjectSchema::ClearReadVariables()
+{
+  this->DataArrays.ReadVariables.Clear();
+  this->Points.ReadVariables.Clear();
+  this->UnstructuredCells.ReadVariables.Clear();
+  this->PolydataCells.ReadVariables.Clear();
+  this->UniformCartesian.ReadVariables.Clear();
+  this->StretchedCartesian.ReadVariables.Clear();
+  this->LogicallyCartesian.ReadVariables.Clear();
+}
+
 // --------------------------------------------------------------------------
 int DataObjectSchema::InitializeDataObject(MPI_Comm comm,
   const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *&dobj)
@@ -3396,14 +4632,100 @@ int DataObjectSchema::InitializeDataObject(MPI_Comm comm,
 
 
 
+// --------------------------------------------------------------------------
+// the parts of a mesh's metadata that determine the variables written for
+// it. when the structure changes the variables are redefined, when only
+// the sizes change their shapes are updated
+struct VariableLayout
+{
+  VariableLayout(const sensei::MeshMetadataPtr &md) :
+    MeshName(md->MeshName), MeshType(md->MeshType),
+    BlockType(md->BlockType), CoordinateType(md->CoordinateType),
+    NumBlocks(md->NumBlocks), NumArrays(md->NumArrays),
+    NumGhostCells(md->NumGhostCells), NumGhostNodes(md->NumGhostNodes),
+    NumLevels(md->NumLevels), ArrayName(md->ArrayName),
+    ArrayCentering(md->ArrayCentering), ArrayComponents(md->ArrayComponents),
+    ArrayType(md->ArrayType), BlockOwner(md->BlockOwner),
+    BlockLevel(md->BlockLevel), BlockNumPoints(md->BlockNumPoints),
+    BlockNumCells(md->BlockNumCells),
+    BlockCellArraySize(md->BlockCellArraySize),
+    BlockExtents(md->BlockExtents) {}
+
+  bool SameStructure(const VariableLayout &o) const
+  {
+    return (this->MeshName == o.MeshName) && (this->MeshType == o.MeshType) &&
+      (this->BlockType == o.BlockType) &&
+      (this->CoordinateType == o.CoordinateType) &&
+      (this->NumBlocks == o.NumBlocks) && (this->NumArrays == o.NumArrays) &&
+      (this->NumGhostCells == o.NumGhostCells) &&
+      (this->NumGhostNodes == o.NumGhostNodes) &&
+      (this->NumLevels == o.NumLevels) && (this->ArrayName == o.ArrayName) &&
+      (this->ArrayCentering == o.ArrayCentering) &&
+      (this->ArrayComponents == o.ArrayComponents) &&
+      (this->ArrayType == o.ArrayType) && (this->BlockOwner == o.BlockOwner) &&
+      (this->BlockLevel == o.BlockLevel);
+  }
+
+  bool SameSizes(const VariableLayout &o) const
+  {
+    return (this->BlockNumPoints == o.BlockNumPoints) &&
+      (this->BlockNumCells == o.BlockNumCells) &&
+      (this->BlockCellArraySize == o.BlockCellArraySize) &&
+      (this->BlockExtents == o.BlockExtents);
+  }
+
+  std::string MeshName;
+  int MeshType;
+  int BlockType;
+  int CoordinateType;
+  int NumBlocks;
+  int NumArrays;
+  int NumGhostCells;
+  int NumGhostNodes;
+  int NumLevels;
+  std::vector<std::string> ArrayName;
+  std::vector<int> ArrayCentering;
+  std::vector<int> ArrayComponents;
+  std::vector<int> ArrayType;
+  std::vector<int> BlockOwner;
+  std::vector<int> BlockLevel;
+  std::vector<long> BlockNumPoints;
+  std::vector<long> BlockNumCells;
+  std::vector<long> BlockCellArraySize;
+  std::vector<std::array<int,6>> BlockExtents;
+};
+
+// --------------------------------------------------------------------------
 struct DataObjectCollectionSchema::InternalsType
 {
-  InternalsType() : BlockOwnerArrayMetadata(0) {}
+  InternalsType() : BlockOwnerArrayMetadata(0), MetadataKeyFrames(0) {}
   VersionSchema Version;
   DataObjectSchema DataObject;
   sensei::MeshMetadataMap SenderMdMap;
   sensei::MeshMetadataMap ReceiverMdMap;
   int BlockOwnerArrayMetadata;
+  std::vector<ArrayOperation> ArrayOperations;
+  std::vector<VariableLayout> DefinedLayout; // of the variables last defined
+
+  // the metadata of each object and the data step it was written at, or
+  // read at by readers. writers keep it serialized, when changes are
+  // tracked metadata that is the same as last written is skipped, and,
+  // when deltas are written, a copy of it and the number of deltas
+  // written since the last key frame. readers keep it decoded, it is
+  // reused when skipped and is the base of the deltas
+  struct CachedMetadata
+  {
+    CachedMetadata() : Step(0), BaseStep(0), NumDeltas(0) {}
+    unsigned long Step;
+    unsigned long BaseStep;
+    unsigned int NumDeltas;
+    sensei::BinaryStream Data;
+    sensei::MeshMetadataPtr Metadata;
+  };
+
+  unsigned int MetadataKeyFrames;
+  std::vector<CachedMetadata> WrittenMetadata;
+  std::map<unsigned int,CachedMetadata> ReadMetadata;
 };
 
 // --------------------------------------------------------------------------
@@ -3428,6 +4750,12 @@ int DataObjectCollectionSchema::ReadMeshMetadata(MPI_Comm comm, InputStream &iSt
   this->Internals->SenderMdMap.Clear();
   this->Internals->ReceiverMdMap.Clear();
 
+  // the variables of the previous step may have been replaced
+  this->Internals->DataObject.ClearReadVariables();
+
+  // the refinement budget of the step's arrays starts now
+  this->Internals->DataObject.DataArrays.StepStart = MPI_Wtime();
+
   // /number_of_data_objects
   unsigned int n_objects = 0;
   if (adiosInq(iStream, "number_of_data_objects", n_objects))
@@ -3440,15 +4768,69 @@ int DataObjectCollectionSchema::ReadMeshMetadata(MPI_Comm comm, InputStream &iSt
     oss << "data_object_" << i << "/";
     std::string data_object_id = oss.str();
 
-    // /data_object_<id>/metadata
-    sensei::BinaryStream bs;
-    std::string path = data_object_id + "metadata";
-    if (BinaryStreamSchema::Read(comm, iStream, path, bs))
-      return -1;
+    // /data_object_<id>/metadata. a writer tracking changes skips the
+    // metadata that did not change, the copy read then is reused. streams
+    // without the steps are read every step. metadata written as a delta
+    // is the difference to that written at metadata_base
+    unsigned long data_step = 0;
+    unsigned long metadata_step = 0;
+    bool tracked =
+      adiosInqOptional(iStream, data_object_id + "data_step", data_step) &&
+      adiosInqOptional(iStream, data_object_id + "metadata_step", metadata_step);
+
+    InternalsType::CachedMetadata &cache = this->Internals->ReadMetadata[i];
+
+    sensei::MeshMetadataPtr md;
+    if (tracked && (metadata_step != data_step))
+      {
+      if (!cache.Metadata || (cache.Step != metadata_step))
+        {
+        SENSEI_ERROR("The metadata of object " << i << " was last written at"
+          " step " << metadata_step << " which was not read")
+        return -1;
+        }
+
+      md = cache.Metadata->NewCopy();
+      }
+    else
+      {
+      sensei::BinaryStream bs;
+      std::string path = data_object_id + "metadata";
+      if (BinaryStreamSchema::Read(comm, iStream, path, bs))
+        return -1;
+
+      const sensei::MeshMetadata *base = nullptr;
+      if (sensei::MeshMetadata::IsDeltaStream(bs))
+        {
+        unsigned long metadata_base = 0;
+        adiosInqOptional(iStream, data_object_id + "metadata_base", metadata_base);
+
+        if (!tracked || !cache.Metadata || (cache.Step != metadata_base))
+          {
+          // a reader that missed a step, because of its step policy or
+          // because the engine dropped it, skips to the next key frame
+          SENSEI_WARNING("The metadata of object " << i << " is the difference"
+            " to that written at step " << metadata_base << " which was not"
+            " read. Skipping to the next key frame")
+          return 1;
+          }
 
-    sensei::MeshMetadataPtr md = sensei::MeshMetadata::New();
+        base = cache.Metadata.get();
+        }
+
+      md = sensei::MeshMetadata::New();
+      if (md->FromStream(bs, base))
+        {
+        SENSEI_ERROR("Failed to deserialize the metadata of object " << i)
+        return -1;
+        }
 
-    md->FromStream(bs);
+      if (tracked)
+        {
+        cache.Step = metadata_step;
+        cache.Metadata = md->NewCopy();
+        }
+      }
 
     // FIXME
     // Don't add internally generated arrays, as these
@@ -3551,13 +4933,48 @@ int DataObjectCollectionSchema::GetObjectId(MPI_Comm comm,
 int DataObjectCollectionSchema::DefineVariables(MPI_Comm comm, AdiosHandle handles,
   const std::vector<sensei::MeshMetadataPtr> &metadata)
 {
-  sensei::TimeEvent<128>("DataObjectCollectionSchema::DefineVariables");
+  sensei::TimeEvent<128> mark("DataObjectCollectionSchema::DefineVariables");
+
+  // variables persist across steps. when the metadata that determines them
+  // is unchanged there is nothing to do. when only the block sizes changed
+  // the variables are kept and their shapes updated. when arrays or blocks
+  // were added, removed, or moved all of the variables are redefined
+  std::vector<VariableLayout> layout(metadata.begin(), metadata.end());
+  std::vector<VariableLayout> &defined = this->Internals->DefinedLayout;
+
+  unsigned int n_objects = metadata.size();
+
+  bool same_structure = !defined.empty() && (defined.size() == n_objects);
+  bool same_sizes = same_structure;
+  for (unsigned int i = 0; same_structure && (i < n_objects); ++i)
+    {
+    same_structure = layout[i].SameStructure(defined[i]);
+    same_sizes = same_sizes && layout[i].SameSizes(defined[i]);
+    }
+
+  if (same_structure && same_sizes)
+    return 0;
+
+  if (!same_structure)
+    {
+    adios2_error clearErr = adios2_remove_all_variables(handles.io);
+    if (clearErr != 0)
+      {
+      SENSEI_ERROR("adios2_remove_all_variables failed " << clearErr)
+      return -1;
+      }
+    }
+
+  // the layout is recorded once the variables are defined, and the
+  // metadata is written in full at the next step
+  defined.clear();
+  this->Internals->WrittenMetadata.clear();
 
   // mark the file as ours and declare version it is written with
   this->Internals->Version.DefineVariables(handles);
 
   // /time_step
-  if (!adios2_define_variable(handles.io, "time_step",
+  if (!defineVariable(handles.io, "time_step",
     adios2_type_uint64_t, 0, NULL, NULL, NULL, adios2_constant_dims_true))
     {
     SENSEI_ERROR("adios2_define_variable time_step failed")
@@ -3565,7 +4982,7 @@ int DataObjectCollectionSchema::DefineVariables(MPI_Comm comm, AdiosHandle handl
     }
 
   // /time
-  if (!adios2_define_variable(handles.io, "time",
+  if (!defineVariable(handles.io, "time",
     adios2_type_double, 0, NULL, NULL, NULL, adios2_constant_dims_true))
     {
     SENSEI_ERROR("adios2_define_variable time failed")
@@ -3573,8 +4990,7 @@ int DataObjectCollectionSchema::DefineVariables(MPI_Comm comm, AdiosHandle handl
     }
 
   // /number_of_data_objects
-  unsigned int n_objects = metadata.size();
-  if (!adios2_define_variable(handles.io, "number_of_data_objects",
+  if (!defineVariable(handles.io, "number_of_data_objects",
     adios2_type_int32_t, 0, NULL, NULL, NULL, adios2_constant_dims_true))
     {
     SENSEI_ERROR("adios2_define_variable number_of_data_objects")
@@ -3597,7 +5013,27 @@ int DataObjectCollectionSchema::DefineVariables(MPI_Comm comm, AdiosHandle handl
     // /data_object_<id>/metadata
     BinaryStreamSchema::DefineVariables(handles, object_id + "metadata");
 
-    if (this->Internals->DataObject.DefineVariables(comm, handles, i, metadata[i]))
+    // /data_object_<id>/metadata_step
+    std::string path = object_id + "metadata_step";
+    if (!defineVariable(handles.io, path.c_str(), adios2_type_uint64_t, 0,
+      NULL, NULL, NULL, adios2_constant_dims_true))
+      {
+      SENSEI_ERROR("adios2_define_variable \"" << path << "\" failed")
+      return -1;
+      }
+
+    // /data_object_<id>/metadata_base
+    path = object_id + "metadata_base";
+    if (!defineVariable(handles.io, path.c_str(), adios2_type_uint64_t, 0,
+      NULL, NULL, NULL, adios2_constant_dims_true))
+      {
+      SENSEI_ERROR("adios2_define_variable \"" << path << "\" failed")
+      return -1;
+      }
+
+    // operations stay attached to variables that are kept
+    if (this->Internals->DataObject.DefineVariables(comm, handles, i, metadata[i]) ||
+      (!same_structure && this->ApplyArrayOperations(metadata[i])))
       {
       SENSEI_ERROR("Failed to define variables for object "
         << i << " " << metadata[i]->MeshName)
@@ -3605,6 +5041,118 @@ int DataObjectCollectionSchema::DefineVariables(MPI_Comm comm, AdiosHandle handl
       }
     }
 
+  defined.swap(layout);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+void DataObjectCollectionSchema::SetAggregateBlocks(unsigned long maxTuples)
+{
+  this->Internals->DataObject.DataArrays.AggregateBlocks = maxTuples;
+}
+
+// --------------------------------------------------------------------------
+void DataObjectCollectionSchema::SetArrayPrecision(
+  const sensei::DataRequirements &reqs)
+{
+  this->Internals->DataObject.DataArrays.Precision = reqs;
+}
+
+// --------------------------------------------------------------------------
+void DataObjectCollectionSchema::SetMetadataKeyFrames(unsigned int interval)
+{
+  this->Internals->MetadataKeyFrames = interval;
+}
+
+// --------------------------------------------------------------------------
+void DataObjectCollectionSchema::SetProgressiveLevels(unsigned int levels)
+{
+  this->Internals->DataObject.DataArrays.ProgressiveLevels = levels;
+}
+
+// --------------------------------------------------------------------------
+void DataObjectCollectionSchema::SetRefinementBudget(double seconds)
+{
+  this->Internals->DataObject.DataArrays.RefinementBudget = seconds;
+}
+
+// --------------------------------------------------------------------------
+void DataObjectCollectionSchema::SetNumberOfThreads(int nThreads)
+{
+  this->Internals->DataObject.DataArrays.Threads = nThreads;
+  this->Internals->DataObject.UnstructuredCells.Threads = nThreads;
+  this->Internals->DataObject.PolydataCells.Threads = nThreads;
+}
+
+// --------------------------------------------------------------------------
+void DataObjectCollectionSchema::SetArrayOperations(
+  const std::vector<ArrayOperation> &ops)
+{
+  this->Internals->ArrayOperations = ops;
+}
+
+// --------------------------------------------------------------------------
+int DataObjectCollectionSchema::ApplyArrayOperations(
+  const sensei::MeshMetadataPtr &md)
+{
+  std::vector<ArrayOperation> &ops = this->Internals->ArrayOperations;
+  unsigned int nOps = ops.size();
+  if (!nOps)
+    return 0;
+
+  std::vector<adios2_variable*> &putVars =
+    this->Internals->DataObject.DataArrays.PutVars[md->MeshName];
+
+  // ghost arrays follow the data arrays and are left alone
+  unsigned int nArrays = md->NumArrays;
+  unsigned int nLevels = numLevels(md);
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    bool isFloat = (md->ArrayType[i] == VTK_FLOAT) ||
+      (md->ArrayType[i] == VTK_DOUBLE);
+
+    for (unsigned int j = 0; j < nOps; ++j)
+      {
+      const ArrayOperation &op = ops[j];
+
+      if (((op.ArrayName != "*") && (op.ArrayName != md->ArrayName[i])) ||
+        (op.Lossy && !isFloat))
+        continue;
+
+      const char *key = op.Parameters.empty() ? "" : op.Parameters[0].first.c_str();
+      const char *val = op.Parameters.empty() ? "" : op.Parameters[0].second.c_str();
+
+      // each level of an AMR mesh has its own variable
+      for (unsigned int l = 0; l < nLevels; ++l)
+        {
+        adios2_variable *var = putVars[i*nLevels + l];
+
+        size_t opId = 0;
+        if (adios2_add_operation(&opId, var, op.Operator, key, val))
+          {
+          SENSEI_ERROR("adios2_add_operation failed on array \""
+            << md->ArrayName[i] << "\" of mesh \"" << md->MeshName << "\"")
+          return -1;
+          }
+
+        unsigned int nParams = op.Parameters.size();
+        for (unsigned int k = 1; k < nParams; ++k)
+          {
+          if (adios2_set_operation_parameter(var, opId,
+            op.Parameters[k].first.c_str(), op.Parameters[k].second.c_str()))
+            {
+            SENSEI_ERROR("Failed to set parameter \"" << op.Parameters[k].first
+              << "\" on array \"" << md->ArrayName[i] << "\"")
+            return -1;
+            }
+          }
+        }
+
+      break;
+      }
+    }
+
   return 0;
 }
 
@@ -3612,7 +5160,8 @@ int DataObjectCollectionSchema::DefineVariables(MPI_Comm comm, AdiosHandle handl
 int DataObjectCollectionSchema::Write(MPI_Comm comm, AdiosHandle handles,
   unsigned long time_step, double time,
   const std::vector<sensei::MeshMetadataPtr> &metadata,
-  const std::vector<vtkCompositeDataSet*> &objects)
+  const std::vector<vtkCompositeDataSet*> &objects,
+  const std::vector<std::vector<int>> &changed)
 {
   sensei::Profiler::StartEvent("senseiADIOS2::DataObjectCollectionSchema::Write");
 
@@ -3654,29 +5203,94 @@ int DataObjectCollectionSchema::Write(MPI_Comm comm, AdiosHandle handles,
     return -1;
     }
 
+  std::vector<InternalsType::CachedMetadata> &written =
+    this->Internals->WrittenMetadata;
+  written.resize(n_objects);
+
   for (unsigned int i = 0; i < n_objects; ++i)
     {
-    sensei::BinaryStream bs;
-    metadata[i]->ToStream(bs);
-
     std::ostringstream oss;
     oss << "data_object_" << i << "/";
     std::string object_id = oss.str();
 
+    // write the object
+    if (this->Internals->DataObject.Write(comm, handles, i,
+      metadata[i], objects[i], i < changed.size() ? &changed[i] : nullptr))
+      {
+      SENSEI_ERROR("Failed to write object " << i << " \""
+        << metadata[i]->MeshName << "\"")
+      return -1;
+      }
+
+    sensei::BinaryStream bs;
+    metadata[i]->ToStream(bs, sensei::MeshMetadata::ENCODING_COMPACT);
+
+    // when changes are tracked metadata that is the same as that last
+    // written is skipped. the decision is made over all ranks
+    InternalsType::CachedMetadata &last = written[i];
+
+    int write_md = changed.empty() || !last.Step ||
+      (last.Data.Size() != bs.Size()) ||
+      memcmp(last.Data.GetData(), bs.GetData(), bs.Size());
+
+    if (!changed.empty())
+      MPI_Allreduce(MPI_IN_PLACE, &write_md, 1, MPI_INT, MPI_MAX, comm);
+
+    // metadata that changed may be written as the difference to that last
+    // written. a key frame, holding all of it, is written every
+    // MetadataKeyFrames writes and when the variables were defined. the
+    // metadata is a global view, the same on all ranks
+    unsigned int keyFrames = this->Internals->MetadataKeyFrames;
+    sensei::BinaryStream delta;
+    if (write_md && keyFrames)
+      {
+      if (last.Step && last.Metadata && (last.NumDeltas + 1 < keyFrames))
+        {
+        metadata[i]->ToDeltaStream(delta, *last.Metadata);
+        last.BaseStep = last.Step;
+        last.NumDeltas += 1;
+        }
+      else
+        {
+        last.BaseStep = 0;
+        last.NumDeltas = 0;
+        }
+      }
+
     // /data_object_<id>/metadata
     path = object_id + "metadata";
-    if (BinaryStreamSchema::Write(handles, path, bs))
+    if (write_md && BinaryStreamSchema::Write(handles, path,
+      last.BaseStep ? delta : bs))
       {
       SENSEI_ERROR("Failed to write metadata for object " << i)
       return -1;
       }
 
-    // write the object
-    if (this->Internals->DataObject.Write(comm, handles, i,
-      metadata[i], objects[i]))
+    // the data step was advanced by the object
+    if (write_md)
       {
-      SENSEI_ERROR("Failed to write object " << i << " \""
-        << metadata[i]->MeshName << "\"")
+      last.Step = this->Internals->DataObject.DataArrays.DataStep[metadata[i]->MeshName];
+      last.Data.Swap(bs);
+
+      if (keyFrames)
+        last.Metadata = metadata[i]->NewCopy();
+      }
+
+    // /data_object_<id>/metadata_base
+    path = object_id + "metadata_base";
+    if (adios2_put_by_name(handles.engine, path.c_str(), &last.BaseStep,
+      adios2_mode_sync))
+      {
+      SENSEI_ERROR("adios2_put_by_name \"" << path << "\" failed")
+      return -1;
+      }
+
+    // /data_object_<id>/metadata_step
+    path = object_id + "metadata_step";
+    if (adios2_put_by_name(handles.engine, path.c_str(), &last.Step,
+      adios2_mode_sync))
+      {
+      SENSEI_ERROR("adios2_put_by_name \"" << path << "\" failed")
       return -1;
       }
     }
@@ -3789,8 +5403,8 @@ int DataObjectCollectionSchema::ReadArray(MPI_Comm comm,
     }
 
   // read the array from the stream. this will pull data across the wire
-  if (this->Internals->DataObject.ReadArray(comm,
-    iStream.Handles, doid, array_name, association, md, cds))
+  if (this->Internals->DataObject.ReadArray(comm, iStream.Handles, doid,
+    array_name, association, md, iStream.StructureOfArrays, cds))
     {
     SENSEI_ERROR("Failed to read "
       << sensei::VTKUtils::GetAttributesName(association)
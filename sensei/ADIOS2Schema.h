@@ -5,6 +5,7 @@ class vtkDataSet;
 class vtkDataObject;
 
 #include "MeshMetadata.h"
+#include "DataRequirements.h"
 #include <adios2_c.h>
 #include <adios2.h>
 #include <vtkDataObject.h>
@@ -28,6 +29,18 @@ struct AdiosHandle
 
 struct InputStream;
 
+/// An ADIOS2 operator, such as a compressor, applied to data arrays. The
+/// reader reverses the operation transparently.
+struct ArrayOperation
+{
+  ArrayOperation() : Operator(nullptr), Lossy(false) {}
+
+  std::string ArrayName; // the arrays the operator applies to, "*" for all
+  adios2_operator *Operator;
+  bool Lossy; // lossy operators are applied to floating point arrays only
+  std::vector<std::pair<std::string,std::string>> Parameters;
+};
+
 /// ADIOS representation of collections of vtkDataObject
 // This class provides the user facing API managing the lower level
 // objects internally. The write API defines variables needed for the
@@ -46,7 +59,49 @@ public:
   int DefineVariables(MPI_Comm comm, AdiosHandle handles,
     const std::vector<sensei::MeshMetadataPtr> &metadata);
 
-  // discover names of data objects on disk(or stream)
+  // set the operators applied to the data arrays when they are defined.
+  // the first operation matching an array's name is used
+  void SetArrayOperations(const std::vector<ArrayOperation> &ops);
+
+  // coalesce a rank's adjacent blocks of at most maxTuples tuples into a
+  // single put per data array. the stream's layout is unchanged. 0, the
+  // default, writes each block separately
+  void SetAggregateBlocks(unsigned long maxTuples);
+
+  // store the data arrays at the precision given for each in reqs, see
+  // DataRequirements::SetArrayPrecision. the metadata keeps the arrays'
+  // types and the reader converts back to them. ADIOS2 has no 16 bit
+  // floating point type, float16 is stored as float32
+  void SetArrayPrecision(const sensei::DataRequirements &reqs);
+
+  // write the metadata of each object that changed as the difference to
+  // that last written, see sensei::MeshMetadata::ToDeltaStream, with all
+  // of it written every interval writes. readers decode the deltas in
+  // order, one that misses a step skips to the next key frame. 0,
+  // the default, and 1 write all of it every time
+  void SetMetadataKeyFrames(unsigned int interval);
+
+  // write the data arrays of uniform meshes along with levels subsampled
+  // copies, copy l keeping every 2^l-th point or cell in each direction.
+  // 0, the default, writes the full arrays only
+  void SetProgressiveLevels(unsigned int levels);
+
+  // read the subsampled copies, coarsest first, for at most the given
+  // seconds from the start of the step, see ReadMeshMetadata. when the
+  // time is spent before the full array is read the finest copy read is
+  // expanded onto the blocks. negative, the default, reads the full arrays
+  void SetRefinementBudget(double seconds);
+
+  // build the local blocks, converting arrays read at reduced precision
+  // and assembling the cells, on this many threads of the TaskRuntime.
+  // the reads themselves are issued from the calling thread. a value less
+  // than 1 uses all of them. the default is 1
+  void SetNumberOfThreads(int nThreads);
+
+  // discover names of data objects on disk(or stream). returns 1 when
+  // the metadata of the step is the difference to that of a step that was
+  // not read, see SetMetadataKeyFrames. the step can't be used and the
+  // next key frame can be read
   int ReadMeshMetadata(MPI_Comm comm, InputStream &iStream);
 
   // get cached metadata for object i. Available after ReadMeshMetadata
@@ -62,10 +117,15 @@ public:
   // get the number of meshes available. Available after ReadMeshMetadata
   int GetNumberOfObjects(unsigned int &num);
 
-  // write the object collection
+  // write the object collection. when given, changed holds a flag per data
+  // array of each object, see sensei::ArrayChangeTracker. arrays flagged 0
+  // are not written when they were written at an earlier step, readers
+  // reuse the copy they read then. likewise the points and cells of static
+  // meshes and metadata that did not change
   int Write(MPI_Comm comm, AdiosHandle handles, unsigned long time_step, double time,
     const std::vector<sensei::MeshMetadataPtr> &metadata,
-    const std::vector<vtkCompositeDataSet*> &objects);
+    const std::vector<vtkCompositeDataSet*> &objects,
+    const std::vector<std::vector<int>> &changed = {});
 
   // return true if the file is one of ours and the version the file was
   // written with is compatible with this revision of the schema
@@ -91,6 +151,9 @@ private:
   int GetObjectId(MPI_Comm comm,
     const std::string &object_name, unsigned int &doid);
 
+  // attach the matching operations to the data array variables of a mesh
+  int ApplyArrayOperations(const sensei::MeshMetadataPtr &md);
+
   // generate an array on each block of the object filled with the BlockOwner
   int AddBlockOwnerArray(MPI_Comm comm, const std::string &name, int centering,
     const sensei::MeshMetadataPtr &md, vtkCompositeDataSet *dobj);
@@ -105,7 +168,7 @@ private:
 struct InputStream
 {
   InputStream() : Handles(), Adios(nullptr),
-    ReadEngine(""), FileName(""), DebugMode(0) {}
+    ReadEngine(""), FileName(""), DebugMode(0), StructureOfArrays(0) {}
 
   // pass engine parameters to ADIOS2 in key value pairs
   int AddParameter(const std::string &key, const std::string &value);
@@ -134,6 +197,7 @@ struct InputStream
   std::string FileName;
   std::vector<std::pair<std::string,std::string>> Parameters;
   int DebugMode;
+  int StructureOfArrays; // read multi-component arrays as SOA
 };
 
 }
@@ -0,0 +1,245 @@
+#include "AdaptivePartitioner.h"
+#include "MPIUtils.h"
+#include "Profiler.h"
+
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+AdaptivePartitioner::AdaptivePartitioner() :
+  EventName("ConfigurableAnalysis::Execute"), Smoothing(0.5), Threshold(0.1)
+{
+  Profiler::TrackEvent(this->EventName.c_str());
+}
+
+// --------------------------------------------------------------------------
+void AdaptivePartitioner::SetEventName(const std::string &name)
+{
+  this->EventName = name;
+  Profiler::TrackEvent(name.c_str());
+}
+
+// --------------------------------------------------------------------------
+int AdaptivePartitioner::GetPartition(MPI_Comm comm, const MeshMetadataPtr &mdIn,
+  MeshMetadataPtr &mdOut)
+{
+  TimeEvent<128> mark("AdaptivePartitioner::GetPartition");
+
+  // measure first so that the partitioning is not included. wall time
+  // can't be used instead since it includes time spent waiting on others
+  bool measure = Profiler::Enabled();
+  double now = Profiler::GetTrackedTime(this->EventName.c_str());
+
+  mdOut = mdIn->NewCopy();
+
+  int nBlocks = mdIn->NumBlocks;
+  mdOut->BlockOwner.resize(nBlocks);
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  MeshState &state = this->State[mdIn->MeshName];
+
+  if ((state.NumRanks != nRanks) || (int(state.Owner.size()) != nBlocks))
+    {
+    // no history, start from contiguous pieces of equal size
+    bool haveCells = int(mdIn->BlockNumCells.size()) == nBlocks;
+
+    state = MeshState();
+    state.NumRanks = nRanks;
+    state.Owner.resize(nBlocks);
+    state.Cost.resize(nBlocks, 1.0);
+
+    double total = 0.0;
+    for (int i = 0; i < nBlocks; ++i)
+      {
+      if (haveCells)
+        state.Cost[i] = std::max(double(mdIn->BlockNumCells[i]), 1.0);
+      total += state.Cost[i];
+      }
+
+    double prefix = 0.0;
+    for (int i = 0; i < nBlocks; ++i)
+      {
+      int owner = int((prefix + 0.5*state.Cost[i])/total*nRanks);
+      state.Owner[i] = std::min(owner, nRanks - 1);
+      prefix += state.Cost[i];
+      }
+    }
+  else if (measure)
+    {
+    // divide the time spent since the last step among the blocks this
+    // rank owned, in proportion to their estimated cost
+    double elapsed = std::max(now - state.LastTime, 0.0);
+
+    double localCost = 0.0;
+    int nLocal = 0;
+    for (int i = 0; i < nBlocks; ++i)
+      {
+      if (state.Owner[i] == rank)
+        {
+        localCost += state.Cost[i];
+        ++nLocal;
+        }
+      }
+
+    std::vector<double> measured(nBlocks, 0.0);
+    for (int i = 0; i < nBlocks; ++i)
+      {
+      if (state.Owner[i] == rank)
+        measured[i] = localCost > 0.0 ? elapsed*state.Cost[i]/localCost :
+          elapsed/nLocal;
+      }
+
+    // the same reduction every step, set up once
+    if (!state.MeasurePlan || (state.MeasurePlan->GetSize() != nBlocks) ||
+      (state.MeasurePlan->GetCommunicator() != comm))
+      {
+      state.MeasurePlan = std::make_shared<MPIUtils::AllreducePlan<double>>();
+      state.MeasurePlan->Initialize(comm, nBlocks, MPI_SUM);
+      }
+
+    state.MeasurePlan->Execute(measured);
+
+    // the first measurement replaces the size based estimate
+    double alpha = state.Measured ? this->Smoothing : 1.0;
+
+    double total = 0.0;
+    for (int i = 0; i < nBlocks; ++i)
+      {
+      state.Cost[i] = alpha*measured[i] + (1.0 - alpha)*state.Cost[i];
+      total += state.Cost[i];
+      }
+
+    // keep a floor so that every block continues to receive a share of
+    // the measured time
+    double minCost = nBlocks ? 1.0e-3*total/nBlocks : 0.0;
+    for (int i = 0; i < nBlocks; ++i)
+      state.Cost[i] = std::max(state.Cost[i], minCost);
+
+    state.Measured = true;
+
+    int nMoved = this->Rebalance(state);
+
+    if (this->Verbose && (rank == 0))
+      SENSEI_STATUS("AdaptivePartitioner moved " << nMoved << " blocks of mesh \""
+        << mdIn->MeshName << "\"")
+    }
+
+  state.LastTime = now;
+
+  mdOut->BlockOwner = state.Owner;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int AdaptivePartitioner::Rebalance(MeshState &state)
+{
+  int nRanks = state.NumRanks;
+  int nBlocks = state.Owner.size();
+
+  std::vector<double> load(nRanks, 0.0);
+  std::vector<std::vector<int>> blocks(nRanks);
+
+  double total = 0.0;
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    load[state.Owner[i]] += state.Cost[i];
+    blocks[state.Owner[i]].push_back(i);
+    total += state.Cost[i];
+    }
+
+  double mean = total/nRanks;
+
+  // hysteresis, leave a good enough assignment alone
+  if (*std::max_element(load.begin(), load.end()) <= (1.0 + this->Threshold)*mean)
+    return 0;
+
+  double target = (1.0 + 0.5*this->Threshold)*mean;
+
+  int nMoved = 0;
+  for (int it = 0; it < nBlocks; ++it)
+    {
+    int rMax = std::max_element(load.begin(), load.end()) - load.begin();
+    int rMin = std::min_element(load.begin(), load.end()) - load.begin();
+
+    if (load[rMax] <= target)
+      break;
+
+    // the block whose cost is closest to half the gap. smaller than the
+    // gap, the move lowers the loads of both ranks below the maximum
+    double gap = load[rMax] - load[rMin];
+
+    std::vector<int> &src = blocks[rMax];
+    int best = -1;
+    double bestDist = 0.0;
+    int nSrc = src.size();
+    for (int j = 0; j < nSrc; ++j)
+      {
+      double cost = state.Cost[src[j]];
+      if (cost >= gap)
+        continue;
+
+      double dist = std::fabs(cost - 0.5*gap);
+      if ((best < 0) || (dist < bestDist))
+        {
+        best = j;
+        bestDist = dist;
+        }
+      }
+
+    if (best < 0)
+      break;
+
+    int bid = src[best];
+    src.erase(src.begin() + best);
+    blocks[rMin].push_back(bid);
+
+    load[rMax] -= state.Cost[bid];
+    load[rMin] += state.Cost[bid];
+    state.Owner[bid] = rMin;
+
+    ++nMoved;
+    }
+
+  return nMoved;
+}
+
+// --------------------------------------------------------------------------
+int AdaptivePartitioner::Initialize(pugi::xml_node &node)
+{
+  TimeEvent<128> mark("AdaptivePartitioner::Initialize");
+
+  if (node.attribute("event"))
+    this->SetEventName(node.attribute("event").value());
+
+  this->Smoothing = node.attribute("smoothing").as_double(0.5);
+  this->Threshold = node.attribute("threshold").as_double(0.1);
+
+  if ((this->Smoothing <= 0.0) || (this->Smoothing > 1.0))
+    {
+    SENSEI_ERROR("smoothing must be in (0, 1]")
+    return -1;
+    }
+
+  if (!Profiler::Enabled())
+    SENSEI_WARNING("Event profiling is disabled. AdaptivePartitioner will not"
+      " rebalance. Set PROFILER_ENABLE=1 to enable it.")
+
+  SENSEI_STATUS("Configured AdaptivePartitioner event=\"" << this->EventName
+    << "\" smoothing=" << this->Smoothing << " threshold=" << this->Threshold)
+
+  return 0;
+}
+
+}
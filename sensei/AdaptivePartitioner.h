@@ -0,0 +1,101 @@
+#ifndef sensei_AdaptivePartitioner_h
+#define sensei_AdaptivePartitioner_h
+
+#include "Partitioner.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sensei
+{
+namespace MPIUtils { template <typename cpp_t> class AllreducePlan; }
+
+class AdaptivePartitioner;
+using AdaptivePartitionerPtr = std::shared_ptr<sensei::AdaptivePartitioner>;
+
+/// @class AdaptivePartitioner
+/// @brief balances blocks by the analysis cost measured on previous steps.
+///
+/// On the first step, and whenever the number of blocks or ranks changes,
+/// blocks are distributed in contiguous pieces of equal BlockNumCells. On
+/// subsequent steps each rank measures the time it spent since the previous
+/// partitioning of the same mesh and divides it among the blocks it owned in
+/// proportion to their estimated cost. The per block estimates are shared
+/// and smoothed with an exponential moving average. The time is taken from
+/// the Profiler's accumulated duration of the named event, by default
+/// ConfigurableAnalysis::Execute. When event profiling is disabled no
+/// measurements are made and the initial distribution is kept.
+///
+/// To prevent blocks from moving back and forth the current assignment is
+/// kept as long as the most loaded rank is within the threshold of the
+/// average. Otherwise blocks are moved one at a time from the most to the
+/// least loaded rank until the imbalance is halved or no move helps.
+///
+/// XML attributes:
+///
+///   event     -- the Profiler event whose duration is the analysis cost
+///   smoothing -- weight of the newest measurement, in (0, 1]. default 0.5
+///   threshold -- allowed imbalance before blocks move. default 0.1
+class AdaptivePartitioner : public sensei::Partitioner
+{
+public:
+  static sensei::AdaptivePartitionerPtr New()
+  { return AdaptivePartitionerPtr(new AdaptivePartitioner); }
+
+  const char *GetClassName() override { return "AdaptivePartitioner"; }
+
+  // given an existing partitioning of data passed in the first MeshMetadata
+  // argument,return a new partittioning in the second MeshMetadata argument.
+  // this must be called once per step for each mesh.
+  int GetPartition(MPI_Comm comm, const sensei::MeshMetadataPtr &in,
+     sensei::MeshMetadataPtr &out) override;
+
+  // Set/get the name of the Profiler event that measures analysis cost
+  void SetEventName(const std::string &name);
+  const std::string &GetEventName() { return this->EventName; }
+
+  // Set/get the weight given to the newest measurement
+  void SetSmoothing(double val) { this->Smoothing = val; }
+  double GetSmoothing() { return this->Smoothing; }
+
+  // Set/get the imbalance tolerated before blocks are moved
+  void SetThreshold(double val) { this->Threshold = val; }
+  double GetThreshold() { return this->Threshold; }
+
+  // Initialize from XML
+  int Initialize(pugi::xml_node &node) override;
+
+protected:
+  AdaptivePartitioner();
+  AdaptivePartitioner(const AdaptivePartitioner &) = default;
+
+  // the assignment and cost estimates of a mesh from the previous step
+  struct MeshState
+  {
+    MeshState() : NumRanks(0), Measured(false), LastTime(0.0) {}
+
+    int NumRanks;
+    bool Measured;
+    double LastTime;
+    std::vector<int> Owner;
+    std::vector<double> Cost;
+
+    // the reduction of the measured costs, shared by copies
+    std::shared_ptr<MPIUtils::AllreducePlan<double>> MeasurePlan;
+  };
+
+  // move blocks from the most to the least loaded ranks when the
+  // imbalance exceeds the threshold. returns the number of blocks moved
+  int Rebalance(MeshState &state);
+
+  std::string EventName;
+  double Smoothing;
+  double Threshold;
+  std::map<std::string, MeshState> State;
+};
+
+}
+
+#endif
@@ -23,6 +23,24 @@ int AnalysisAdaptor::SetCommunicator(MPI_Comm comm)
   return 0;
 }
 
+//----------------------------------------------------------------------------
+bool AnalysisAdaptor::ExecuteBatch(const std::vector<DataAdaptor*> &steps)
+{
+  unsigned int nSteps = steps.size();
+  for (unsigned int i = 0; i < nSteps; ++i)
+    {
+    if (!this->Execute(steps[i]))
+      return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int AnalysisAdaptor::ReceiveResult(std::string &, std::string &)
+{
+  return 1;
+}
+
 //----------------------------------------------------------------------------
 void AnalysisAdaptor::PrintSelf(ostream& os, vtkIndent indent)
 {
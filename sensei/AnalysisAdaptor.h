@@ -4,6 +4,8 @@
 #include "senseiConfig.h"
 #include <vtkObjectBase.h>
 #include <mpi.h>
+#include <string>
+#include <vector>
 
 namespace sensei
 {
@@ -15,6 +17,16 @@ class DataAdaptor;
 /// AnalysisAdaptor is an adaptor for any insitu analysis framework or
 /// algorithm. Concrete subclasses use DataAdaptor instance passed to
 /// the Execute() method to access simulation data for further processing.
+///
+/// Thread safety. The methods of an analysis adaptor are called by one
+/// thread at a time, although not necessarily the thread that created it.
+/// When an analysis runs asynchronously or concurrently with others its
+/// Execute runs on a background thread while the simulation and other
+/// analyses continue to make MPI calls, MPI must then provide
+/// MPI_THREAD_MULTIPLE. Collective calls are made over the communicator
+/// returned by GetCommunicator, a duplicate that is not shared with other
+/// adaptors. Analyses that use threads internally should give each thread
+/// a communicator, see MPIUtils::ThreadComms.
 class AnalysisAdaptor : public vtkObjectBase
 {
 public:
@@ -39,6 +51,45 @@ public:
   /// iteration.
   virtual bool Execute(DataAdaptor* data) = 0;
 
+  /// @brief Returns false if Execute would do nothing on the given step.
+  ///
+  /// Bridges may call this before setting up the data adaptor and skip
+  /// the step entirely when no analysis will run, for instance when an
+  /// analysis runs at a fixed frequency. The answer must be the same on
+  /// all ranks. The default returns true.
+  virtual bool WillExecute(long step, double time)
+  { (void)step; (void)time; return true; }
+
+  /// @brief Execute the analysis routine on several steps at once.
+  ///
+  /// This method is called by end points that gather a window of steps,
+  /// in order of increasing time. Each adaptor holds the data of one step
+  /// and remains valid until the call returns. Analyses that can amortize
+  /// per-step work, such as collectives or file opens, over the window
+  /// override this and AcceptsBatches. The default calls Execute on each
+  /// step in turn.
+  virtual bool ExecuteBatch(const std::vector<DataAdaptor*> &steps);
+
+  /// @brief Returns true if ExecuteBatch does better than calling Execute
+  /// once per step.
+  virtual bool AcceptsBatches() { return false; }
+
+  /// @brief Get a result sent back to the simulation by an in transit end
+  /// point.
+  ///
+  /// Analyses on the end point may return small results, such as adaptive
+  /// thresholds or steering flags, with InTransitDataAdaptor::PostResult.
+  /// A write side transport with a return channel collects them as the end
+  /// point moves past a step, and every simulation rank receives all of
+  /// them, in order, from this call. It does not block. The default has no
+  /// results.
+  ///
+  /// @param[out] tag the tag the result was posted with
+  /// @param[out] result the result
+  /// @returns zero if a result was received, one if none is pending, and
+  ///          -1 if an error occurred
+  virtual int ReceiveResult(std::string &tag, std::string &result);
+
   /// @breif Finalize the analyis routine
   ///
   /// This method is called when the run is finsihed clean up
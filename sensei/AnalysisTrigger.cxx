@@ -0,0 +1,441 @@
+#include "AnalysisTrigger.h"
+#include "VTKUtils.h"
+#include "Error.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+namespace sensei
+{
+
+enum
+{
+  TRIGGER_NUMBER, TRIGGER_STEP, TRIGGER_TIME, TRIGGER_MIN, TRIGGER_MAX,
+  TRIGGER_TAIL, TRIGGER_NEG, TRIGGER_NOT, TRIGGER_ADD, TRIGGER_SUB,
+  TRIGGER_MUL, TRIGGER_DIV, TRIGGER_MOD, TRIGGER_LT, TRIGGER_LE, TRIGGER_GT,
+  TRIGGER_GE, TRIGGER_EQ, TRIGGER_NE, TRIGGER_AND, TRIGGER_OR
+};
+
+struct AnalysisTrigger::Node
+{
+  Node(int op) : Op(op), Value(0.0), Association(-1) {}
+
+  int Op;
+  double Value;
+  std::string Mesh;
+  std::string Name;
+  int Association;
+  std::vector<std::shared_ptr<Node>> Args;
+};
+
+namespace
+{
+using NodePtr = std::shared_ptr<AnalysisTrigger::Node>;
+
+// a recursive descent parser. from lowest to highest precedence the
+// levels are ||, &&, comparison, + -, * / %, and unary - and !
+struct Parser
+{
+  Parser(const std::string &expr) : Expr(expr), Pos(0), Data(false) {}
+
+  void SkipSpace()
+  {
+    while ((this->Pos < this->Expr.size()) &&
+      std::isspace(static_cast<unsigned char>(this->Expr[this->Pos])))
+      ++this->Pos;
+  }
+
+  // consume tok if it is next
+  bool Accept(const char *tok)
+  {
+    this->SkipSpace();
+    if (this->Expr.compare(this->Pos, strlen(tok), tok) == 0)
+      {
+      this->Pos += strlen(tok);
+      return true;
+      }
+    return false;
+  }
+
+  bool Expect(const char *tok)
+  {
+    if (this->Accept(tok))
+      return true;
+    this->Error(std::string("expected \"") + tok + "\"");
+    return false;
+  }
+
+  void Error(const std::string &msg)
+  {
+    if (this->Message.empty())
+      {
+      std::ostringstream oss;
+      oss << msg << " at position " << this->Pos;
+      this->Message = oss.str();
+      }
+  }
+
+  static NodePtr Binary(int op, const NodePtr &lhs, const NodePtr &rhs)
+  {
+    NodePtr n(new AnalysisTrigger::Node(op));
+    n->Args = {lhs, rhs};
+    return n;
+  }
+
+  // a word or a quoted string
+  bool Name(std::string &name)
+  {
+    this->SkipSpace();
+    size_t n = this->Expr.size();
+    if ((this->Pos < n) &&
+      ((this->Expr[this->Pos] == '"') || (this->Expr[this->Pos] == '\'')))
+      {
+      char q = this->Expr[this->Pos];
+      size_t end = this->Expr.find(q, this->Pos + 1);
+      if (end == std::string::npos)
+        {
+        this->Error("unterminated string");
+        return false;
+        }
+      name = this->Expr.substr(this->Pos + 1, end - this->Pos - 1);
+      this->Pos = end + 1;
+      return true;
+      }
+
+    size_t start = this->Pos;
+    while ((this->Pos < n) &&
+      (std::isalnum(static_cast<unsigned char>(this->Expr[this->Pos])) ||
+      (this->Expr[this->Pos] == '_') || (this->Expr[this->Pos] == '.')))
+      ++this->Pos;
+
+    if (this->Pos == start)
+      {
+      this->Error("expected a name");
+      return false;
+      }
+
+    name = this->Expr.substr(start, this->Pos - start);
+    return true;
+  }
+
+  NodePtr Or()
+  {
+    NodePtr lhs = this->And();
+    while (lhs && this->Accept("||"))
+      {
+      NodePtr rhs = this->And();
+      lhs = rhs ? Binary(TRIGGER_OR, lhs, rhs) : nullptr;
+      }
+    return lhs;
+  }
+
+  NodePtr And()
+  {
+    NodePtr lhs = this->Compare();
+    while (lhs && this->Accept("&&"))
+      {
+      NodePtr rhs = this->Compare();
+      lhs = rhs ? Binary(TRIGGER_AND, lhs, rhs) : nullptr;
+      }
+    return lhs;
+  }
+
+  NodePtr Compare()
+  {
+    NodePtr lhs = this->Sum();
+    if (!lhs)
+      return nullptr;
+
+    // two character operators are tested first
+    int op = this->Accept("<=") ? TRIGGER_LE : this->Accept(">=") ? TRIGGER_GE :
+      this->Accept("==") ? TRIGGER_EQ : this->Accept("!=") ? TRIGGER_NE :
+      this->Accept("<") ? TRIGGER_LT : this->Accept(">") ? TRIGGER_GT : -1;
+
+    if (op < 0)
+      return lhs;
+
+    NodePtr rhs = this->Sum();
+    return rhs ? Binary(op, lhs, rhs) : nullptr;
+  }
+
+  NodePtr Sum()
+  {
+    NodePtr lhs = this->Product();
+    while (lhs)
+      {
+      int op = this->Accept("+") ? TRIGGER_ADD : this->Accept("-") ? TRIGGER_SUB : -1;
+      if (op < 0)
+        break;
+      NodePtr rhs = this->Product();
+      lhs = rhs ? Binary(op, lhs, rhs) : nullptr;
+      }
+    return lhs;
+  }
+
+  NodePtr Product()
+  {
+    NodePtr lhs = this->Unary();
+    while (lhs)
+      {
+      int op = this->Accept("*") ? TRIGGER_MUL : this->Accept("/") ? TRIGGER_DIV :
+        this->Accept("%") ? TRIGGER_MOD : -1;
+      if (op < 0)
+        break;
+      NodePtr rhs = this->Unary();
+      lhs = rhs ? Binary(op, lhs, rhs) : nullptr;
+      }
+    return lhs;
+  }
+
+  NodePtr Unary()
+  {
+    int op = this->Accept("-") ? TRIGGER_NEG :
+      this->Accept("!") ? TRIGGER_NOT : -1;
+
+    if (op < 0)
+      return this->Primary();
+
+    NodePtr arg = this->Unary();
+    if (!arg)
+      return nullptr;
+
+    NodePtr n(new AnalysisTrigger::Node(op));
+    n->Args = {arg};
+    return n;
+  }
+
+  NodePtr Primary()
+  {
+    this->SkipSpace();
+
+    if (this->Accept("("))
+      {
+      NodePtr n = this->Or();
+      return (n && this->Expect(")")) ? n : nullptr;
+      }
+
+    // a number
+    const char *start = this->Expr.c_str() + this->Pos;
+    char *end = nullptr;
+    double val = strtod(start, &end);
+    if ((end != start) && (std::isdigit(static_cast<unsigned char>(*start)) ||
+      (*start == '.')))
+      {
+      this->Pos += end - start;
+      NodePtr n(new AnalysisTrigger::Node(TRIGGER_NUMBER));
+      n->Value = val;
+      return n;
+      }
+
+    std::string word;
+    if (!this->Name(word))
+      return nullptr;
+
+    if (word == "step")
+      return NodePtr(new AnalysisTrigger::Node(TRIGGER_STEP));
+
+    if (word == "time")
+      return NodePtr(new AnalysisTrigger::Node(TRIGGER_TIME));
+
+    if ((word == "min") || (word == "max"))
+      {
+      NodePtr n(new AnalysisTrigger::Node(word == "min" ? TRIGGER_MIN : TRIGGER_MAX));
+      if (!this->Expect("(") || !this->Name(n->Mesh) || !this->Expect(",") ||
+        !this->Name(n->Name))
+        return nullptr;
+
+      if (this->Accept(","))
+        {
+        std::string assoc;
+        if (!this->Name(assoc))
+          return nullptr;
+
+        if (VTKUtils::GetAssociation(assoc, n->Association))
+          {
+          this->Error("invalid association \"" + assoc + "\"");
+          return nullptr;
+          }
+        }
+
+      if (!this->Expect(")"))
+        return nullptr;
+
+      this->Data = true;
+      return n;
+      }
+
+    if (word == "tail")
+      {
+      NodePtr n(new AnalysisTrigger::Node(TRIGGER_TAIL));
+      if (!this->Expect("(") || !this->Name(n->Name) || !this->Expect(","))
+        return nullptr;
+
+      NodePtr arg = this->Or();
+      if (!arg || !this->Expect(")"))
+        return nullptr;
+
+      n->Args = {arg};
+      this->Data = true;
+      return n;
+      }
+
+    this->Error("unknown term \"" + word + "\"");
+    return nullptr;
+  }
+
+  const std::string &Expr;
+  size_t Pos;
+  bool Data;
+  std::string Message;
+};
+
+// --------------------------------------------------------------------------
+int EvaluateNode(const AnalysisTrigger::Node *n,
+  const AnalysisTrigger::Context &ctx, double &val)
+{
+  double a = 0.0;
+  double b = 0.0;
+
+  switch (n->Op)
+    {
+    case TRIGGER_NUMBER:
+      val = n->Value;
+      return 0;
+
+    case TRIGGER_STEP:
+      val = ctx.Step;
+      return 0;
+
+    case TRIGGER_TIME:
+      val = ctx.Time;
+      return 0;
+
+    case TRIGGER_MIN:
+    case TRIGGER_MAX:
+      {
+      double range[2] = {0.0, 0.0};
+      if (!ctx.Range || ctx.Range(n->Mesh, n->Name, n->Association, range))
+        {
+        SENSEI_ERROR("Failed to get the range of array \"" << n->Name
+          << "\" on mesh \"" << n->Mesh << "\"")
+        return -1;
+        }
+      val = n->Op == TRIGGER_MIN ? range[0] : range[1];
+      return 0;
+      }
+
+    case TRIGGER_TAIL:
+      if (EvaluateNode(n->Args[0].get(), ctx, a))
+        return -1;
+
+      if (!ctx.Tail || ctx.Tail(n->Name, a, val))
+        {
+        SENSEI_ERROR("Failed to get the histogram of \"" << n->Name << "\"")
+        return -1;
+        }
+      return 0;
+
+    // the logical operators short circuit. this is safe for collective
+    // terms since every rank sees the same values
+    case TRIGGER_AND:
+    case TRIGGER_OR:
+      if (EvaluateNode(n->Args[0].get(), ctx, a))
+        return -1;
+
+      if ((n->Op == TRIGGER_AND) == (a == 0.0))
+        {
+        val = a != 0.0;
+        return 0;
+        }
+
+      if (EvaluateNode(n->Args[1].get(), ctx, b))
+        return -1;
+
+      val = b != 0.0;
+      return 0;
+    }
+
+  if (EvaluateNode(n->Args[0].get(), ctx, a) ||
+    ((n->Args.size() > 1) && EvaluateNode(n->Args[1].get(), ctx, b)))
+    return -1;
+
+  switch (n->Op)
+    {
+    case TRIGGER_NEG: val = -a; break;
+    case TRIGGER_NOT: val = a == 0.0; break;
+    case TRIGGER_ADD: val = a + b; break;
+    case TRIGGER_SUB: val = a - b; break;
+    case TRIGGER_MUL: val = a * b; break;
+    case TRIGGER_DIV: val = a / b; break;
+    case TRIGGER_MOD: val = std::fmod(a, b); break;
+    case TRIGGER_LT: val = a < b; break;
+    case TRIGGER_LE: val = a <= b; break;
+    case TRIGGER_GT: val = a > b; break;
+    case TRIGGER_GE: val = a >= b; break;
+    case TRIGGER_EQ: val = a == b; break;
+    case TRIGGER_NE: val = a != b; break;
+    }
+
+  return 0;
+}
+}
+
+// --------------------------------------------------------------------------
+AnalysisTrigger::AnalysisTrigger() : DataDependent(false)
+{
+}
+
+// --------------------------------------------------------------------------
+int AnalysisTrigger::Initialize(const std::string &expression)
+{
+  this->Expression = expression;
+  this->Root = nullptr;
+  this->DataDependent = false;
+
+  Parser parser(expression);
+  parser.SkipSpace();
+  if (parser.Pos == expression.size())
+    return 0;
+
+  NodePtr root = parser.Or();
+  parser.SkipSpace();
+  if (root && (parser.Pos != expression.size()))
+    parser.Error("unexpected input");
+
+  if (!parser.Message.empty())
+    {
+    SENSEI_ERROR("Failed to parse the trigger \"" << expression << "\". "
+      << parser.Message)
+    return -1;
+    }
+
+  this->Root = root;
+  this->DataDependent = parser.Data;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int AnalysisTrigger::Evaluate(const Context &ctx, bool &fire) const
+{
+  fire = true;
+
+  if (!this->Root)
+    return 0;
+
+  double val = 0.0;
+  if (EvaluateNode(this->Root.get(), ctx, val))
+    {
+    SENSEI_ERROR("Failed to evaluate the trigger \"" << this->Expression << "\"")
+    return -1;
+    }
+
+  fire = val != 0.0;
+  return 0;
+}
+
+}
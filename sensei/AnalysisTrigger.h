@@ -0,0 +1,88 @@
+#ifndef sensei_AnalysisTrigger_h
+#define sensei_AnalysisTrigger_h
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace sensei
+{
+
+/// @class AnalysisTrigger
+/// @brief a predicate that decides if an analysis runs in a given step.
+///
+/// A fixed cadence runs an expensive analysis, such as a render or a full
+/// dump of the data, as often in quiescent phases of the simulation as in
+/// eventful ones. A trigger instead runs the analysis when a cheap
+/// condition on the step holds. The condition is an expression with the
+/// usual arithmetic (+ - * / %), comparison (< <= > >= == !=) and logical
+/// (&& || !) operators, and the following terms:
+///
+///   step, time                the simulation's time step and time
+///   min(mesh, array[, assoc]) the global minimum of an array, taken from
+///                             the mesh metadata's array ranges
+///   max(mesh, array[, assoc]) the global maximum of an array
+///   tail(analysis, value)     the fraction of the values at or above value
+///                             in the last histogram computed by the named
+///                             histogram analysis
+///
+/// For example "max(mesh, data) > 0.9 || step % 100 == 0". Names may be
+/// quoted when they contain characters other than letters, digits, '_'
+/// and '.'. The association is "point" or "cell", when it is omitted the
+/// first array with the name is used.
+///
+/// The values of the terms are provided by the caller through a Context.
+/// Evaluation is collective when the context's functions are, and the
+/// functions must return the same value on every rank so that all ranks
+/// make the same decision.
+class AnalysisTrigger
+{
+public:
+  AnalysisTrigger();
+
+  /// supplies the values of the terms of the expression
+  struct Context
+  {
+    long Step;
+    double Time;
+
+    /// get the global range of an array. association is -1 when it was
+    /// not given in the expression. returns zero if successful.
+    std::function<int(const std::string &mesh, const std::string &array,
+      int association, double range[2])> Range;
+
+    /// get the fraction of the values at or above value in the named
+    /// histogram analysis. returns zero if successful.
+    std::function<int(const std::string &analysis, double value,
+      double &fraction)> Tail;
+  };
+
+  /// parse the expression. an empty expression always fires. returns
+  /// zero if successful.
+  int Initialize(const std::string &expression);
+
+  /// the expression passed to Initialize
+  const std::string &GetExpression() const { return this->Expression; }
+
+  /// returns true if no expression was given
+  bool Empty() const { return !this->Root; }
+
+  /// returns true if the expression references data, its value is then
+  /// only known once the step's data is available
+  bool UsesData() const { return this->DataDependent; }
+
+  /// evaluate the expression. fire is set when the analysis should run.
+  /// returns zero if successful.
+  int Evaluate(const Context &ctx, bool &fire) const;
+
+  struct Node;
+
+private:
+  std::string Expression;
+  std::shared_ptr<Node> Root;
+  bool DataDependent;
+};
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include "ArrayChangeTracker.h"
+#include "Error.h"
+
+#include <vtkCompositeDataSet.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkDataSet.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkPointData.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+void ArrayChangeTracker::SetArrayUnchanged(const std::string &meshName,
+  int association, const std::string &arrayName)
+{
+  this->Unchanged[meshName].insert(ArrayKey(association, arrayName));
+}
+
+// --------------------------------------------------------------------------
+int ArrayChangeTracker::Update(MPI_Comm comm, const MeshMetadataPtr &md,
+  vtkCompositeDataSet *mesh, std::vector<int> &changed)
+{
+  int numArrays = md->NumArrays;
+  changed.assign(numArrays, 1);
+
+  // take the flags set by the simulation for this step
+  std::set<ArrayKey> unchanged;
+  std::map<std::string, std::set<ArrayKey>>::iterator uit =
+    this->Unchanged.find(md->MeshName);
+  if (uit != this->Unchanged.end())
+    {
+    unchanged.swap(uit->second);
+    this->Unchanged.erase(uit);
+    }
+
+  if ((md->BlockOwner.size() != static_cast<unsigned int>(md->NumBlocks)) ||
+    (md->BlockIds.size() != static_cast<unsigned int>(md->NumBlocks)))
+    {
+    SENSEI_ERROR("A global view of mesh \"" << md->MeshName
+      << "\" block decomposition is required")
+    return -1;
+    }
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  // get the arrays of the local blocks
+  MeshState state;
+  state.BlockOwner = md->BlockOwner;
+  state.BlockIds = md->BlockIds;
+  state.BlockNumPoints = md->BlockNumPoints;
+  state.BlockNumCells = md->BlockNumCells;
+
+  std::vector<int> found(numArrays, 1);
+  if (mesh)
+    {
+    vtkCompositeDataIterator *it = mesh->NewIterator();
+    it->SetSkipEmptyNodes(0);
+    it->InitTraversal();
+
+    for (int j = 0; j < md->NumBlocks; ++j)
+      {
+      if (md->BlockOwner[j] == rank)
+        {
+        vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+        for (int i = 0; i < numArrays; ++i)
+          {
+          int cen = md->ArrayCentering[i];
+
+          vtkDataSetAttributes *dsa = nullptr;
+          if (ds && (cen == vtkDataObject::POINT))
+            dsa = ds->GetPointData();
+          else if (ds && (cen == vtkDataObject::CELL))
+            dsa = ds->GetCellData();
+
+          vtkDataArray *da = dsa ? dsa->GetArray(md->ArrayName[i].c_str()) : nullptr;
+          if (!da)
+            found[i] = 0;
+
+          state.Arrays[ArrayKey(cen, md->ArrayName[i])].push_back(
+            std::make_pair(da, da ? da->GetMTime() : vtkMTimeType(0)));
+          }
+        }
+
+      it->GoToNextItem();
+      }
+
+    it->Delete();
+    }
+
+  // compare with the previous step
+  std::map<std::string, MeshState>::iterator mit = this->Meshes.find(md->MeshName);
+  if ((mit != this->Meshes.end()) &&
+    (mit->second.BlockOwner == state.BlockOwner) &&
+    (mit->second.BlockIds == state.BlockIds) &&
+    (mit->second.BlockNumPoints == state.BlockNumPoints) &&
+    (mit->second.BlockNumCells == state.BlockNumCells))
+    {
+    for (int i = 0; i < numArrays; ++i)
+      {
+      ArrayKey key(md->ArrayCentering[i], md->ArrayName[i]);
+
+      std::map<ArrayKey, ArrayState>::iterator ait = mit->second.Arrays.find(key);
+      if (!found[i] || (ait == mit->second.Arrays.end()))
+        continue;
+
+      // the simulation's flag is trusted, otherwise the same arrays with
+      // the same modification time are required
+      if (unchanged.count(key) || (ait->second == state.Arrays[key]))
+        changed[i] = 0;
+      }
+    }
+
+  // an array changed on any rank is written by all
+  if (numArrays)
+    MPI_Allreduce(MPI_IN_PLACE, changed.data(), numArrays, MPI_INT,
+      MPI_MAX, comm);
+
+  this->Meshes[md->MeshName] = std::move(state);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+void ArrayChangeTracker::Clear()
+{
+  this->Meshes.clear();
+  this->Unchanged.clear();
+}
+
+}
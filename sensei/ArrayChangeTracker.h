@@ -0,0 +1,77 @@
+#ifndef sensei_ArrayChangeTracker_h
+#define sensei_ArrayChangeTracker_h
+
+#include "MeshMetadata.h"
+
+#include <vtkType.h>
+#include <mpi.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+class vtkCompositeDataSet;
+class vtkDataArray;
+
+namespace sensei
+{
+
+/// @class ArrayChangeTracker
+/// @brief detects the data arrays that did not change since the last step.
+///
+/// Writers that send every array every step move the same values again
+/// for arrays that rarely change, such as material ids or static
+/// coefficients. The tracker lets them skip those. An array is unchanged
+/// when each local block holds the same VTK array as at the previous step
+/// and its modification time is the same, that is when the data adaptor
+/// keeps its VTK arrays between steps and calls Modified when it updates
+/// them. Data adaptors that make their arrays anew each step may instead
+/// flag the arrays that they know did not change with SetArrayUnchanged.
+///
+/// Any change to the blocks of the mesh, their number, owners or sizes,
+/// changes all of its arrays. The decision is made over all ranks, an
+/// array changed on one rank is changed on all of them.
+class ArrayChangeTracker
+{
+public:
+  /// flag an array as unchanged at the next call to Update for its mesh.
+  /// this overrides the modification time, but not a change of the blocks
+  void SetArrayUnchanged(const std::string &meshName, int association,
+    const std::string &arrayName);
+
+  /// compare the data arrays of the mesh, in the order of the metadata,
+  /// with those seen at the previous call. changed[i] is set to 1 when
+  /// array i changed on any rank. the first call for a mesh reports all of
+  /// its arrays as changed. md must be a global view. collective. returns
+  /// zero if successful.
+  int Update(MPI_Comm comm, const MeshMetadataPtr &md,
+    vtkCompositeDataSet *mesh, std::vector<int> &changed);
+
+  /// forget all meshes, their arrays are changed at the next Update
+  void Clear();
+
+private:
+  // identifies an array by association and name
+  using ArrayKey = std::pair<int, std::string>;
+
+  // the array and its modification time on each local block
+  using ArrayState = std::vector<std::pair<vtkDataArray*, vtkMTimeType>>;
+
+  struct MeshState
+  {
+    std::vector<int> BlockOwner;
+    std::vector<int> BlockIds;
+    std::vector<long> BlockNumPoints;
+    std::vector<long> BlockNumCells;
+    std::map<ArrayKey, ArrayState> Arrays;
+  };
+
+  std::map<std::string, MeshState> Meshes;
+  std::map<std::string, std::set<ArrayKey>> Unchanged;
+};
+
+}
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef sensei_ArrayDispatch_h
+#define sensei_ArrayDispatch_h
+
+#include "ArrayView.h"
+
+#include <vtkDataArray.h>
+#include <vtkType.h>
+
+#include <vector>
+
+/// @file ArrayDispatch.h
+/// @brief Calls an analysis kernel with the typed values of a vtkDataArray
+/// or an ArrayView.
+///
+/// The kernels of the analyses are templates on the value type that take a
+/// pointer to the contiguous values of an array. Execute casts the array's
+/// storage to the matching type and calls the kernel with it. Arrays with
+/// other layouts, such as the structure of arrays and implicit arrays, or
+/// with a value type that is not in the dispatch list are passed a null
+/// pointer to double, and the kernel reads their values through
+/// vtkDataArray::GetComponent. A kernel is thus instantiated once per type
+/// in the list plus once for the generic path, rather than for every VTK
+/// type and array layout as vtkTemplateMacro and vtkArrayDispatch do.
+///
+/// The types that get a fast path are set by the X macro
+/// SENSEI_ARRAY_DISPATCH_TYPES, which may be defined before including this
+/// file to trade compile time and code size against the speed of the less
+/// common types.
+
+#ifndef SENSEI_ARRAY_DISPATCH_TYPES
+#define SENSEI_ARRAY_DISPATCH_TYPES(_call)  \
+  _call(VTK_FLOAT, float)                   \
+  _call(VTK_DOUBLE, double)                 \
+  _call(VTK_INT, int)                       \
+  _call(VTK_UNSIGNED_INT, unsigned int)     \
+  _call(VTK_LONG, long)                     \
+  _call(VTK_LONG_LONG, long long)           \
+  _call(VTK_ID_TYPE, vtkIdType)             \
+  _call(VTK_UNSIGNED_CHAR, unsigned char)
+#endif
+
+namespace sensei
+{
+namespace ArrayDispatch
+{
+
+/// @brief Call f(const T *vals) with values of the VTK type dataType.
+///
+/// @returns true if the type is in SENSEI_ARRAY_DISPATCH_TYPES and f was
+///          called
+template <typename kernel_t>
+bool ExecuteTyped(int dataType, const void *data, kernel_t &&f)
+{
+  switch (dataType)
+    {
+#define SENSEI_ARRAY_DISPATCH_CASE(_code, _type)        \
+    case _code:                                         \
+      f(static_cast<const _type*>(data));               \
+      return true;
+    SENSEI_ARRAY_DISPATCH_TYPES(SENSEI_ARRAY_DISPATCH_CASE)
+#undef SENSEI_ARRAY_DISPATCH_CASE
+    default:
+      break;
+    }
+  return false;
+}
+
+/// @brief Call f(const T *vals) with the values of the array.
+///
+/// vals points to the first value when the array has the standard memory
+/// layout and a type in SENSEI_ARRAY_DISPATCH_TYPES, and is a null pointer
+/// to double otherwise. The kernel must then access the values with
+/// GetComponent.
+///
+/// @param[in] da the array
+/// @param[in] f the kernel
+template <typename kernel_t>
+void Execute(vtkDataArray *da, kernel_t &&f)
+{
+  if (da->HasStandardMemoryLayout() &&
+    ExecuteTyped(da->GetDataType(), da->GetVoidPointer(0), f))
+    return;
+
+  f(static_cast<const double*>(nullptr));
+}
+
+// gathers the first component of the tuples of a view to a buffer
+struct GatherKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    for (long i = 0; i < this->NumTuples; ++i)
+      (*this->Out)[i] = static_cast<double>(vals[i*this->Stride]);
+  }
+
+  long NumTuples;
+  long Stride;
+  std::vector<double> *Out;
+};
+
+/// @brief Call f(const T *vals) with the first component of the values of
+/// a view.
+///
+/// Contiguous views of a type in SENSEI_ARRAY_DISPATCH_TYPES are passed in
+/// place. Strided views are gathered to a temporary buffer of doubles.
+/// Views of VTK arrays with other types or layouts are dispatched as the
+/// array is, with a null pointer to double, and the kernel must then
+/// access view.Array with GetComponent.
+///
+/// @param[in] view the values
+/// @param[in] f the kernel
+/// @returns zero if successful, non zero if the view's values could not
+///          be accessed
+template <typename kernel_t>
+int Execute(const ArrayView &view, kernel_t &&f)
+{
+  if (view.Contiguous() && ExecuteTyped(view.DataType, view.Data, f))
+    return 0;
+
+  if (view.Array)
+    {
+    Execute(view.Array, f);
+    return 0;
+    }
+
+  if (view.Data)
+    {
+    std::vector<double> buffer(view.NumTuples);
+    GatherKernel gather{view.NumTuples, view.Stride, &buffer};
+    if (ExecuteTyped(view.DataType, view.Data, gather))
+      {
+      f(static_cast<const double*>(buffer.data()));
+      return 0;
+      }
+    }
+
+  return -1;
+}
+
+/// @brief Get the value i of an array, from its contiguous values if given.
+///
+/// A helper for kernels that do not separate the contiguous and generic
+/// paths.
+template <typename T>
+double GetValue(vtkDataArray *da, const T *vals, vtkIdType i)
+{
+  return vals ? static_cast<double>(vals[i]) : da->GetComponent(i, 0);
+}
+
+}
+}
+
+#endif
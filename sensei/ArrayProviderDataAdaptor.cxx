@@ -0,0 +1,161 @@
+#include "ArrayProviderDataAdaptor.h"
+#include "VTKUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkFieldData.h>
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace sensei
+{
+
+struct ArrayProviderDataAdaptor::InternalsType
+{
+  // mesh name, association, array name
+  using KeyType = std::tuple<std::string, int, std::string>;
+
+  std::map<KeyType, ArrayProvider> Providers;
+};
+
+namespace
+{
+// add the arrays from each of the providers to one block
+int addBlockArrays(vtkDataObject *blk, int blockId, int association,
+  const std::vector<std::string> &arrayNames,
+  const std::vector<const ArrayProviderDataAdaptor::ArrayProvider*> &providers)
+{
+  vtkFieldData *fd = blk->GetAttributesAsFieldData(association);
+  if (!fd)
+    {
+    SENSEI_ERROR("Block " << blockId << " has no "
+      << VTKUtils::GetAttributesName(association) << " data")
+    return -1;
+    }
+
+  unsigned int nArrays = arrayNames.size();
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    if (fd->GetAbstractArray(arrayNames[i].c_str()))
+      continue;
+
+    vtkDataArray *da = (*providers[i])(blockId);
+    if (!da)
+      {
+      SENSEI_ERROR("Failed to get " << VTKUtils::GetAttributesName(association)
+        << " data array \"" << arrayNames[i] << "\" for block " << blockId)
+      return -1;
+      }
+
+    fd->AddArray(da);
+    da->Delete();
+    }
+
+  return 0;
+}
+}
+
+//----------------------------------------------------------------------------
+ArrayProviderDataAdaptor::ArrayProviderDataAdaptor() :
+  Internals(new InternalsType)
+{
+}
+
+//----------------------------------------------------------------------------
+ArrayProviderDataAdaptor::~ArrayProviderDataAdaptor()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+void ArrayProviderDataAdaptor::SetArrayProvider(const std::string &meshName,
+  int association, const std::string &arrayName, const ArrayProvider &provider)
+{
+  InternalsType::KeyType key(meshName, association, arrayName);
+  this->Internals->Providers[key] = provider;
+}
+
+//----------------------------------------------------------------------------
+void ArrayProviderDataAdaptor::ClearArrayProviders()
+{
+  this->Internals->Providers.clear();
+}
+
+//----------------------------------------------------------------------------
+int ArrayProviderDataAdaptor::AddArray(vtkDataObject* mesh,
+  const std::string &meshName, int association, const std::string &arrayName)
+{
+  return this->AddArrays(mesh, meshName, association,
+    std::vector<std::string>(1, arrayName));
+}
+
+//----------------------------------------------------------------------------
+int ArrayProviderDataAdaptor::AddArrays(vtkDataObject* mesh,
+  const std::string &meshName, int association,
+  const std::vector<std::string> &arrayNames)
+{
+  TimeEvent<128> mark("ArrayProviderDataAdaptor::AddArrays");
+
+  if (!mesh)
+    {
+    SENSEI_ERROR("No mesh provided for mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  // find the providers once for all of the blocks
+  unsigned int nArrays = arrayNames.size();
+  std::vector<const ArrayProvider*> providers(nArrays);
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    InternalsType::KeyType key(meshName, association, arrayNames[i]);
+
+    auto it = this->Internals->Providers.find(key);
+    if (it == this->Internals->Providers.end())
+      {
+      SENSEI_ERROR("Mesh \"" << meshName << "\" has no "
+        << VTKUtils::GetAttributesName(association) << " data array \""
+        << arrayNames[i] << "\"")
+      return -1;
+      }
+
+    providers[i] = &it->second;
+    }
+
+  if (nArrays == 0)
+    return 0;
+
+  // visit each block once
+  if (vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(mesh))
+    {
+    vtkCompositeDataIterator *cdit = cd->NewIterator();
+    for (cdit->InitTraversal(); !cdit->IsDoneWithTraversal(); cdit->GoToNextItem())
+      {
+      int bid = std::max(0, VTKUtils::GetBlockId(cd, cdit));
+      if (addBlockArrays(cd->GetDataSet(cdit), bid, association,
+        arrayNames, providers))
+        {
+        SENSEI_ERROR("Failed to add arrays to mesh \"" << meshName << "\"")
+        cdit->Delete();
+        return -1;
+        }
+      }
+    cdit->Delete();
+    return 0;
+    }
+
+  if (addBlockArrays(mesh, 0, association, arrayNames, providers))
+    {
+    SENSEI_ERROR("Failed to add arrays to mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  return 0;
+}
+
+}
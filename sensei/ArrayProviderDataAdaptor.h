@@ -0,0 +1,71 @@
+#ifndef sensei_ArrayProviderDataAdaptor_h
+#define sensei_ArrayProviderDataAdaptor_h
+
+#include "senseiConfig.h"
+#include "DataAdaptor.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+class vtkDataArray;
+
+namespace sensei
+{
+
+/// @class ArrayProviderDataAdaptor
+/// @brief ArrayProviderDataAdaptor fills all requested arrays in one traversal
+///
+/// Simulations register a provider for each array they can serve, once, by
+/// mesh name, association, and array name. AddArrays then finds the
+/// providers for the requested arrays once and visits each block of the
+/// mesh once, calling the providers for that block. This amortizes the
+/// block iteration and lookups that a loop over AddArray would repeat for
+/// every array. Derived classes implement the rest of the DataAdaptor API.
+class ArrayProviderDataAdaptor : public DataAdaptor
+{
+public:
+  senseiBaseTypeMacro(ArrayProviderDataAdaptor, DataAdaptor);
+
+  /// A callable that returns the array for one block. The block is
+  /// identified by its index in the composite dataset, a mesh that is not
+  /// composite has block 0. The array is returned with a reference that is
+  /// passed to the caller, nullptr indicates an error.
+  using ArrayProvider = std::function<vtkDataArray*(int blockId)>;
+
+  /// @brief Adds the named array to each block of the mesh.
+  ///
+  /// Forwards to AddArrays.
+  int AddArray(vtkDataObject* mesh, const std::string &meshName,
+    int association, const std::string &arrayName) override;
+
+  /// @brief Adds the named arrays to each block of the mesh.
+  ///
+  /// Each block is visited once. Arrays that are already present on a block
+  /// are not added again.
+  int AddArrays(vtkDataObject* mesh, const std::string &meshName,
+    int association, const std::vector<std::string> &arrayNames) override;
+
+protected:
+  ArrayProviderDataAdaptor();
+  ~ArrayProviderDataAdaptor();
+
+  /// Register the provider for the named array. A provider registered for
+  /// the same array replaces it.
+  void SetArrayProvider(const std::string &meshName, int association,
+    const std::string &arrayName, const ArrayProvider &provider);
+
+  /// Remove all of the providers
+  void ClearArrayProviders();
+
+private:
+  ArrayProviderDataAdaptor(const ArrayProviderDataAdaptor&); // not implemented.
+  void operator=(const ArrayProviderDataAdaptor&); // not implemented.
+
+  struct InternalsType;
+  InternalsType *Internals;
+};
+
+}
+
+#endif
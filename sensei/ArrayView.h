@@ -0,0 +1,55 @@
+#ifndef sensei_ArrayView_h
+#define sensei_ArrayView_h
+
+#include <vtkObjectBase.h>
+#include <vtkSmartPointer.h>
+
+class vtkDataArray;
+
+namespace sensei
+{
+
+/// @class ArrayView
+/// @brief describes the values of an array on one block without VTK objects.
+///
+/// The values are NumTuples tuples of NumComponents components of the VTK
+/// type DataType, in host memory. Consecutive tuples are Stride values
+/// apart, so that one component of an interleaved array may be viewed in
+/// place. The ghost values are described either by a mask, or for
+/// Cartesian blocks by the extent of the tuples and the extent of those
+/// that are not ghosts. When neither is given every value is owned.
+///
+/// Views made by the simulation point into its memory, which must remain
+/// valid until the data adaptor's ReleaseData is called. Views made from
+/// VTK objects by DataAdaptor::GetArrayViews keep a reference to them in
+/// Owner, and Array is the array viewed.
+struct ArrayView
+{
+  ArrayView() : BlockId(0), Data(nullptr), DataType(0), NumTuples(0),
+    NumComponents(1), Stride(1), Extent{0,-1,0,-1,0,-1},
+    Interior{0,-1,0,-1,0,-1}, Ghosts(nullptr), Array(nullptr) {}
+
+  /// true if the values are stored contiguously, one component per tuple
+  bool Contiguous() const
+  { return this->Data && (this->NumComponents == 1) && (this->Stride == 1); }
+
+  /// true if the ghosts are given by Extent and Interior
+  bool HasInterior() const
+  { return this->Extent[0] <= this->Extent[1]; }
+
+  int BlockId;            // the block's index in the mesh
+  const void *Data;       // the first component of the first tuple, or null
+  int DataType;           // VTK type enum, VTK_FLOAT, VTK_DOUBLE, etc
+  long NumTuples;
+  int NumComponents;
+  long Stride;            // the number of values from one tuple to the next
+  int Extent[6];          // the index extent of the tuples, i fastest, or empty
+  int Interior[6];        // the part of Extent that are not ghosts
+  const unsigned char *Ghosts;  // non zero marks a ghost tuple, or null
+  vtkDataArray *Array;    // the VTK array viewed, or null
+  vtkSmartPointer<vtkObjectBase> Owner;
+};
+
+}
+
+#endif
@@ -47,6 +47,7 @@ private:
   ascent::Ascent _ascent;
   conduit::Node optionsNode;    // Ascent options from json file.
   conduit::Node actionsNode;    // Ascent actions from json file.
+  conduit::Node MeshCache;      // Coordsets and topologies of static meshes.
 
   void GetFieldsFromActions();
   std::set<std::string> Fields;
@@ -5,6 +5,9 @@
 #include "MeshMetadataMap.h"
 #include "VTKUtils.h"
 #include "Profiler.h"
+#include "TaskRuntime.h"
+#include "TemporalWindow.h"
+#include "TopK.h"
 #include "Error.h"
 
 // VTK includes
@@ -19,12 +22,11 @@
 #include <vtkStructuredData.h>
 #include <vtkUnsignedCharArray.h>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
 #include <sdiy/master.hpp>
-#include <sdiy/reduce.hpp>
-#include <sdiy/partners/merge.hpp>
 #include <sdiy/io/numpy.hpp>
 #include <sdiy/grid.hpp>
 #include <sdiy/vertices.hpp>
@@ -37,27 +39,6 @@ std::unique_ptr<T> make_unique(Args&& ...args)
   return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
 }
 
-template<class T>
-struct add_vectors
-{
-    using Vector = std::vector<T>;
-    Vector  operator()(const Vector& lhs, const Vector& rhs) const
-    {
-      Vector res(lhs.size(), 0);
-      for (size_t i = 0; i < lhs.size(); ++i)
-        res[i] = lhs[i] + rhs[i];
-      return res;
-    }
-};
-
-namespace sdiy { namespace mpi { namespace detail {
-template<class U> struct mpi_op<add_vectors<U>>
-{
-  static MPI_Op get()
-  { return MPI_SUM; }
-};
-}}}
-
 namespace sensei
 {
 
@@ -68,82 +49,235 @@ using Vertex4D = Vertex::UPoint;
 struct AutocorrelationImpl
 {
   using Grid = sdiy::Grid<float,4>;
-  AutocorrelationImpl(size_t window_, int gid_, Vertex from_, Vertex to_):
+  AutocorrelationImpl(size_t window_, size_t channels_, int gid_,
+    Vertex from_, Vertex to_):
     window(window_),
+    channels(channels_),
+    levels(numLevels(window_, channels_)),
     gid(gid_),
     from(from_), to(to_),
     shape(to - from + Vertex::one()),
-    // init grid with (to - from + 1) in 3D, and window in the 4-th dimension
-    values(shape.lift(3, window)),
-    corr(shape.lift(3, window))
-  { corr = 0; }
+    // init grid with (to - from + 1) in 3D, and window in the 4-th dimension.
+    // in the multiple tau mode each vertex keeps a history for each level
+    // and the sum of pairs being averaged for all but the first. the exact
+    // mode reads the history from the shared TemporalWindow
+    values(shape.lift(3, channels ? levels*channels + levels - 1 : 0)),
+    corr(shape.lift(3, channels ? channels + (levels - 1)*channels/2 : window)),
+    levelCount(levels, 0)
+  {
+    corr = 0;
+    values = 0;
+  }
+
+  // the lag of each shift
+  static std::vector<size_t> makeLags(size_t window, size_t channels)
+    {
+    std::vector<size_t> lags;
+    if (channels)
+      {
+      size_t nLevels = numLevels(window, channels);
+
+      for (size_t j = 1; j <= channels; ++j)
+        lags.push_back(j);
+
+      for (size_t l = 1; l < nLevels; ++l)
+        for (size_t j = channels/2 + 1; j <= channels; ++j)
+          lags.push_back(j << l);
+      }
+    else
+      {
+      for (size_t j = 1; j <= window; ++j)
+        lags.push_back(j);
+      }
+    return lags;
+    }
+
+  // the number of levels of the multiple tau correlator needed to reach
+  // lags of window steps with the given number of channels
+  static size_t numLevels(size_t window, size_t channels)
+    {
+    size_t nLevels = 1;
+    while (channels && ((channels << (nLevels - 1)) < window))
+      ++nLevels;
+    return nLevels;
+    }
 
   static void* create()            { return new AutocorrelationImpl; }
   static void destroy(void* b)    { delete static_cast<AutocorrelationImpl*>(b); }
-  void process(float* data, unsigned char *ghostArray)
+
+  // the number of shifts for which autocorrelations are computed
+  size_t shifts() const { return corr.shape()[3]; }
+
+  // the number of vertices in the block
+  size_t size() const
     {
-    GridRef g(data, shape);
+    return size_t(shape[0])*size_t(shape[1])*size_t(shape[2]);
+    }
 
-    if (ghostArray)
+  // accumulate the products of the current values with the values of the
+  // last window steps for vertices [begin, end). the history is that of
+  // the shared window, whose latest step is the current one, the values
+  // of each step back are read in place or decoded for the range. the
+  // correlations of each vertex are contiguous. ghost values, given by a
+  // mask or by the interior range of a Cartesian block, contribute
+  // nothing.
+  void process(const TemporalWindow *history, const float* data,
+    const unsigned char *ghostArray, const VTKUtils::InteriorRange *interior,
+    size_t begin, size_t end)
+    {
+    if (interior)
       {
-      sdiy::GridRef<unsigned char, 3> ghost(ghostArray, shape);
-      // record the values
-      sdiy::for_each(g.shape(), [&](const Vertex& v)
+      // the spans of ghosts are processed without data
+      interior->ForEachSpan(begin, end,
+        [&](long b, long e, bool isInterior)
         {
-        auto gv = (ghost(v) == 0) ? g(v) : 0;
+        this->process(history, isInterior ? data : nullptr, nullptr, nullptr, b, e);
+        });
+      return;
+      }
 
-        for (size_t i = 1; i <= window; ++i)
-        {
-        if (i > count) continue;    // during the initial fill, we don't get contributions to some shifts
+    if (channels)
+      {
+      processMultipleTau(data, ghostArray, begin, end);
+      return;
+      }
+
+    if (!data)
+      return;
 
-        auto uc = v.lift(3, i-1);
-        auto uv = v.lift(3, (offset + window - i) % window);
-        corr(uc) += values(uv)*gv;
+    // during the initial fill, we don't get contributions to some shifts
+    size_t nHeld = history->GetNumberOfSteps();
+    size_t n = std::min(nHeld ? nHeld - 1 : 0, window);
+
+    size_t len = end - begin;
+    std::vector<const float*> hist(n);
+    std::vector<float> decoded;
+
+    for (size_t i = 0; i < n; ++i)
+      {
+      if (const float *h = history->GetValues(gid, i + 1))
+        {
+        hist[i] = h + begin;
+        }
+      else
+        {
+        decoded.resize(n*len);
+        history->GetValues(gid, i + 1, begin, end, decoded.data() + i*len);
+        hist[i] = decoded.data() + i*len;
         }
+      }
 
-        auto u = v.lift(3, offset);
-        values(u) = gv;
-        });
+    const unsigned char *g = ghostArray;
+    for (size_t k = begin; k < end; ++k)
+      {
+      if (g && g[k])
+        continue;
+
+      float gv = data[k];
+      float * __restrict__ c = corr.data() + k*window;
+      size_t j = k - begin;
+
+      for (size_t i = 0; i < n; ++i)
+        c[i] += hist[i][j]*gv;
       }
-    else
+    }
+
+  // the multiple tau correlator. level 0 correlates the values of the last
+  // channels steps. each following level l receives the average of pairs of
+  // values from the level below, one every 2^l steps, and correlates them
+  // at lags (channels/2 + 1)*2^l through channels*2^l. the products at level
+  // l are weighted by 2^l since each stands for that many steps. memory
+  // grows with the log of the window rather than the window.
+  void processMultipleTau(const float* data, const unsigned char *ghostArray,
+    size_t begin, size_t end)
+    {
+    size_t m = channels;
+    size_t nValues = values.shape()[3];
+    size_t nShifts = corr.shape()[3];
+
+    // the levels that receive a value this step. level l does when its
+    // predecessor completes a pair
+    size_t nActive = 1;
+    while ((nActive < levels) && (levelCount[nActive - 1] % 2))
+      ++nActive;
+
+    for (size_t k = begin; k < end; ++k)
       {
-      // record the values
-      sdiy::for_each(g.shape(), [&](const Vertex& v)
-        {
-        auto gv = g(v);
+      float y = (!data || (ghostArray && ghostArray[k])) ? 0.0f : data[k];
 
-        for (size_t i = 1; i <= window; ++i)
+      float *h = values.data() + k*nValues;
+      float *c = corr.data() + k*nShifts;
+      float *acc = h + levels*m;
+
+      for (size_t l = 0; l < nActive; ++l)
         {
-        if (i > count) continue;    // during the initial fill, we don't get contributions to some shifts
+        float *ring = h + l*m;
+        size_t n = std::min(levelCount[l], m);
+        size_t pos = levelCount[l] % m;
+        size_t jmin = l ? m/2 + 1 : 1;
+        float *cl = c + (l ? m + (l - 1)*m/2 : 0) - jmin;
+        float wy = float(size_t(1) << l)*y;
+
+        for (size_t j = jmin; j <= n; ++j)
+          cl[j] += wy*ring[(pos + m - j) % m];
+
+        ring[pos] = y;
 
-        auto uc = v.lift(3, i-1);
-        auto uv = v.lift(3, (offset + window - i) % window);
-        corr(uc) += values(uv)*gv;
+        // pass the average of a pair to the next level
+        if (l + 1 < levels)
+          {
+          if (levelCount[l] % 2)
+            y = 0.5f*(acc[l] + y);
+          else
+            acc[l] = y;
+          }
         }
+      }
+    }
 
-        auto u = v.lift(3, offset);
-        values(u) = gv;
-        });
+  // move on to the next step once all vertices have been processed
+  void advance()
+    {
+    if (channels)
+      {
+      for (size_t l = 0; l < levels; ++l)
+        {
+        bool carry = levelCount[l] % 2;
+        ++levelCount[l];
+        if (!carry)
+          break;
+        }
       }
-    offset += 1;
-    offset %= window;
 
     ++count;
     }
 
   size_t          window;
+  size_t          channels;   // when non-zero the multiple tau mode is used
+  size_t          levels;
   int             gid;
   Vertex          from, to, shape;
-  Grid            values;     // circular buffer of last `window` values
+  Grid            values;     // the history of the multiple tau mode
   Grid            corr;       // autocorrelations for different time shifts
+  std::vector<size_t> levelCount; // values received by each level
 
-  size_t          offset = 0;
   size_t          count  = 0;
 
 private:
   AutocorrelationImpl() {}        // here just for create; to let Master manage the blocks (+ if we choose to add OOC later)
 };
 
+// a range of vertices of a block to process
+struct AutocorrelationTask
+{
+  AutocorrelationImpl *Block;
+  const float *Data;
+  const unsigned char *Ghosts;
+  const VTKUtils::InteriorRange *Interior;
+  size_t Begin;
+  size_t End;
+};
+
 //-----------------------------------------------------------------------------
 class Autocorrelation::AInternals
 {
@@ -154,11 +288,26 @@ public:
   int Association;
   std::string ArrayName;
   size_t Window;
+  size_t Channels;
   bool BlocksInitialized;
   size_t NumberOfBlocks;
+  int NumThreads;
+  int Storage;
+
+  // the history of the exact mode, shared with other analyses of the array
+  TemporalWindowPtr History;
+
+  // split the blocks into about NumThreads ranges of vertices of equal size
+  // and process them in parallel. blocks smaller than a range are processed
+  // whole, larger blocks are split.
+  void Process(std::vector<AutocorrelationTask> &blocks);
+
+  // fetch the array of one step and add it to the correlations
+  int ProcessStep(DataAdaptor *data, const MeshMetadataPtr &mmd);
 
   AInternals() : KMax(3), Association(vtkDataObject::POINT),
-    Window(10), BlocksInitialized(false), NumberOfBlocks(0) {}
+    Window(10), Channels(0), BlocksInitialized(false), NumberOfBlocks(0),
+    NumThreads(1), Storage(TemporalWindow::STORAGE_FLOAT) {}
 
   void InitializeBlocks(vtkDataObject* dobj)
     {
@@ -181,7 +330,7 @@ public:
       Vertex from { ext[0], ext[2], ext[4] };
       Vertex to   { ext[1], ext[3], ext[5] };
       int bid = this->Master->communicator().rank();
-      AutocorrelationImpl* b = new AutocorrelationImpl(this->Window, bid, from, to);
+      AutocorrelationImpl* b = new AutocorrelationImpl(this->Window, this->Channels, bid, from, to);
       this->Master->add(bid, b, new sdiy::Link);
       this->NumberOfBlocks = this->Master->communicator().size();
       }
@@ -210,7 +359,7 @@ public:
           Vertex from { ext[0], ext[2], ext[4] };
           Vertex to   { ext[1], ext[3], ext[5] };
 
-          AutocorrelationImpl* b = new AutocorrelationImpl(this->Window, bid, from, to);
+          AutocorrelationImpl* b = new AutocorrelationImpl(this->Window, this->Channels, bid, from, to);
           this->Master->add(bid, b, new sdiy::Link);
           }
         }
@@ -220,6 +369,45 @@ public:
     }
 };
 
+//-----------------------------------------------------------------------------
+void Autocorrelation::AInternals::Process(std::vector<AutocorrelationTask> &blocks)
+{
+  size_t nBlocks = blocks.size();
+
+  size_t nVerts = 0;
+  for (size_t i = 0; i < nBlocks; ++i)
+    nVerts += blocks[i].End;
+
+  size_t nThreads = std::max(1, this->NumThreads);
+  size_t rangeSize = std::max(size_t(4096), nVerts/nThreads + 1);
+
+  std::vector<AutocorrelationTask> tasks;
+  for (size_t i = 0; i < nBlocks; ++i)
+    {
+    AutocorrelationTask task = blocks[i];
+    size_t end = task.End;
+    for (size_t j = 0; j < end; j += rangeSize)
+      {
+      task.Begin = j;
+      task.End = std::min(end, j + rangeSize);
+      tasks.push_back(task);
+      }
+    }
+
+  // the ranges are processed on the process wide pool
+  const TemporalWindow *history = this->History.get();
+  TaskRuntime::ParallelFor(tasks.size(), nThreads,
+    [&tasks, history](int, long j) -> int
+    {
+    tasks[j].Block->process(history, tasks[j].Data, tasks[j].Ghosts,
+      tasks[j].Interior, tasks[j].Begin, tasks[j].End);
+    return 0;
+    });
+
+  for (size_t i = 0; i < nBlocks; ++i)
+    blocks[i].Block->advance();
+}
+
 //-----------------------------------------------------------------------------
 senseiNewMacro(Autocorrelation);
 
@@ -243,73 +431,91 @@ void Autocorrelation::Initialize(size_t window, const std::string &meshName,
 
   AInternals& internals = (*this->Internals);
 
+  // the blocks are processed on the TaskRuntime rather than by the
+  // master's threads
   internals.Master = make_unique<sdiy::Master>(this->GetCommunicator(),
-    numThreads, -1, &AutocorrelationImpl::create, &AutocorrelationImpl::destroy);
+    1, -1, &AutocorrelationImpl::create, &AutocorrelationImpl::destroy);
 
   internals.MeshName = meshName;
   internals.Association = association;
   internals.ArrayName = arrayname;
   internals.Window = window;
   internals.KMax = kmax;
+  internals.NumThreads = numThreads < 1 ?
+    TaskRuntime::GetNumberOfThreads() : numThreads;
 }
 
 //-----------------------------------------------------------------------------
-bool Autocorrelation::Execute(DataAdaptor* dataAdaptor)
+void Autocorrelation::SetMultipleTau(size_t channels)
 {
-  TimeEvent<128> mark("Autocorrelation::Execute");
-
-  AInternals& internals = (*this->Internals);
-
-  // see what the simulation is providing
-  MeshMetadataMap mdMap;
-  if (mdMap.Initialize(dataAdaptor))
+  if (this->Internals->BlocksInitialized)
     {
-    SENSEI_ERROR("Failed to get metadata")
-    return false;
+    SENSEI_ERROR("The mode must be set before the first Execute")
+    return;
     }
 
-  // metadata
-  MeshMetadataPtr mmd;
-  if (mdMap.GetMeshMetadata(internals.MeshName, mmd))
+  // the upper half of each level's channels is used, round up to even
+  this->Internals->Channels = channels + (channels % 2);
+}
+
+//-----------------------------------------------------------------------------
+void Autocorrelation::SetStorage(int storage)
+{
+  if (this->Internals->BlocksInitialized)
     {
-    SENSEI_ERROR("Failed to get metadata for mesh \"" << internals.MeshName << "\"")
-    return false;
+    SENSEI_ERROR("The storage must be set before the first Execute")
+    return;
     }
 
+  this->Internals->Storage = storage;
+}
+
+//-----------------------------------------------------------------------------
+int Autocorrelation::AInternals::ProcessStep(DataAdaptor *data,
+  const MeshMetadataPtr &mmd)
+{
   // mesh
   vtkDataObject* mesh = nullptr;
-  if (dataAdaptor->GetMesh(internals.MeshName, false, mesh))
+  if (data->GetMesh(this->MeshName, false, mesh))
     {
-    SENSEI_ERROR("Failed to get mesh \"" << internals.MeshName << "\"")
-    return false;
+    SENSEI_ERROR("Failed to get mesh \"" << this->MeshName << "\"")
+    return -1;
     }
 
   // array
-  if (dataAdaptor->AddArray(mesh, internals.MeshName,
-    internals.Association, internals.ArrayName))
+  if (data->AddArray(mesh, this->MeshName,
+    this->Association, this->ArrayName))
     {
-    SENSEI_ERROR("Failed to add array \"" << internals.ArrayName
-      << "\" on mesh \"" << internals.MeshName << "\"")
-    return false;
+    SENSEI_ERROR("Failed to add array \"" << this->ArrayName
+      << "\" on mesh \"" << this->MeshName << "\"")
+    return -1;
     }
 
+  // the ghost zones of Cartesian blocks are described by index ranges and
+  // the ghost arrays are not needed
+  VTKUtils::InteriorRangeMap interiors;
+  bool haveInteriors = (mmd->NumGhostCells || mmd->NumGhostNodes) &&
+    !VTKUtils::GetInteriorRanges(mmd, interiors);
+
   // ghost cells
-  if ((mmd->NumGhostCells || VTKUtils::AMR(mmd)) &&
-    dataAdaptor->AddGhostCellsArray(mesh, internals.MeshName))
+  if (!haveInteriors && (mmd->NumGhostCells || VTKUtils::AMR(mmd)) &&
+    data->AddGhostCellsArray(mesh, this->MeshName))
     {
-    SENSEI_ERROR(<< dataAdaptor->GetClassName() << " failed to add ghost cells.")
-    return false;
+    SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost cells.")
+    return -1;
     }
 
-  if ((mmd->NumGhostNodes > 0) &&
-    dataAdaptor->AddGhostNodesArray(mesh, internals.MeshName))
+  if (!haveInteriors && (mmd->NumGhostNodes > 0) &&
+    data->AddGhostNodesArray(mesh, this->MeshName))
     {
-    SENSEI_ERROR(<< dataAdaptor->GetClassName() << " failed to add ghost nodes.")
-    return false;
+    SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost nodes.")
+    return -1;
     }
 
-  const int association = internals.Association;
-  internals.InitializeBlocks(mesh);
+  const int association = this->Association;
+  this->InitializeBlocks(mesh);
+
+  std::vector<AutocorrelationTask> blocks;
 
   if (vtkCompositeDataSet* cd = vtkCompositeDataSet::SafeDownCast(mesh))
     {
@@ -322,15 +528,18 @@ bool Autocorrelation::Execute(DataAdaptor* dataAdaptor)
       {
       if (vtkDataSet* dataObj = vtkDataSet::SafeDownCast(iter->GetCurrentDataObject()))
         {
-        int lid = internals.Master->lid(static_cast<int>(bid));
-        AutocorrelationImpl* corr = internals.Master->block<AutocorrelationImpl>(lid);
+        int lid = this->Master->lid(static_cast<int>(bid));
+        AutocorrelationImpl* corr = this->Master->block<AutocorrelationImpl>(lid);
         vtkFloatArray* fa = vtkFloatArray::SafeDownCast(
-          dataObj->GetAttributesAsFieldData(association)->GetArray(internals.ArrayName.c_str()));
+          dataObj->GetAttributesAsFieldData(association)->GetArray(this->ArrayName.c_str()));
         vtkUnsignedCharArray *gc = vtkUnsignedCharArray::SafeDownCast(
           dataObj->GetCellData()->GetArray("vtkGhostType"));
         if (fa)
           {
-          corr->process(fa->GetPointer(0), gc ? gc->GetPointer(0) : nullptr);
+          blocks.push_back({corr, fa->GetPointer(0),
+            gc ? gc->GetPointer(0) : nullptr,
+            VTKUtils::FindInteriorRange(interiors, bid, association, fa),
+            0, corr->size()});
           }
         else
           {
@@ -342,16 +551,19 @@ bool Autocorrelation::Execute(DataAdaptor* dataAdaptor)
     }
   else if (vtkDataSet* ds = vtkDataSet::SafeDownCast(mesh))
     {
-    int bid = internals.Master->communicator().rank();
-    int lid = internals.Master->lid(static_cast<int>(bid));
-    AutocorrelationImpl* corr = internals.Master->block<AutocorrelationImpl>(lid);
+    int bid = this->Master->communicator().rank();
+    int lid = this->Master->lid(static_cast<int>(bid));
+    AutocorrelationImpl* corr = this->Master->block<AutocorrelationImpl>(lid);
     vtkFloatArray* fa = vtkFloatArray::SafeDownCast(
-      ds->GetAttributesAsFieldData(association)->GetArray(internals.ArrayName.c_str()));
+      ds->GetAttributesAsFieldData(association)->GetArray(this->ArrayName.c_str()));
     vtkUnsignedCharArray *gc = vtkUnsignedCharArray::SafeDownCast(
       ds->GetCellData()->GetArray("vtkGhostType"));
     if (fa)
       {
-      corr->process(fa->GetPointer(0), gc ? gc->GetPointer(0) : nullptr);
+      blocks.push_back({corr, fa->GetPointer(0),
+        gc ? gc->GetPointer(0) : nullptr,
+        VTKUtils::FindInteriorRange(interiors, bid, association, fa),
+        0, corr->size()});
       }
     else
       {
@@ -360,8 +572,111 @@ bool Autocorrelation::Execute(DataAdaptor* dataAdaptor)
       }
     }
 
+  // the history of the exact mode is the shared window, the current step
+  // is added unless another analysis of the array did so
+  if (!this->Channels)
+    {
+    if (!this->History)
+      this->History = TemporalWindow::GetWindow(this->MeshName,
+        this->Association, this->ArrayName, this->Window + 1, this->Storage);
+
+    unsigned int nBlocks = blocks.size();
+    std::vector<ArrayView> views(nBlocks);
+    for (unsigned int i = 0; i < nBlocks; ++i)
+      {
+      views[i].BlockId = blocks[i].Block->gid;
+      views[i].Data = blocks[i].Data;
+      views[i].DataType = VTK_FLOAT;
+      views[i].NumTuples = blocks[i].End;
+      }
+
+    if (this->History->Update(data->GetDataTimeStep(),
+      data->GetDataTime(), views))
+      {
+      SENSEI_ERROR("Failed to update the history of \"" << this->ArrayName << "\"")
+      mesh->Delete();
+      return -1;
+      }
+    }
+
+  this->Process(blocks);
+
   mesh->Delete();
 
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+bool Autocorrelation::Execute(DataAdaptor* dataAdaptor)
+{
+  TimeEvent<128> mark("Autocorrelation::Execute");
+
+  AInternals& internals = (*this->Internals);
+
+  // see what the simulation is providing. the block extents of Cartesian
+  // meshes describe the ghost zones without a ghost array
+  MeshMetadataFlags flags;
+  flags.SetBlockDecomp();
+  flags.SetBlockExtents();
+
+  MeshMetadataMap mdMap;
+  if (mdMap.Initialize(dataAdaptor, flags))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return false;
+    }
+
+  // metadata
+  MeshMetadataPtr mmd;
+  if (mdMap.GetMeshMetadata(internals.MeshName, mmd))
+    {
+    SENSEI_ERROR("Failed to get metadata for mesh \"" << internals.MeshName << "\"")
+    return false;
+    }
+
+  return internals.ProcessStep(dataAdaptor, mmd) ? false : true;
+}
+
+//-----------------------------------------------------------------------------
+bool Autocorrelation::ExecuteBatch(const std::vector<DataAdaptor*> &steps)
+{
+  TimeEvent<128> mark("Autocorrelation::ExecuteBatch");
+
+  AInternals& internals = (*this->Internals);
+
+  unsigned int nSteps = steps.size();
+  if (!nSteps)
+    return true;
+
+  // the blocks are fixed once initialized, so the metadata, which costs
+  // a collective, is gathered once for the whole batch
+  MeshMetadataFlags flags;
+  flags.SetBlockDecomp();
+  flags.SetBlockExtents();
+
+  MeshMetadataMap mdMap;
+  if (mdMap.Initialize(steps[0], flags))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return false;
+    }
+
+  MeshMetadataPtr mmd;
+  if (mdMap.GetMeshMetadata(internals.MeshName, mmd))
+    {
+    SENSEI_ERROR("Failed to get metadata for mesh \"" << internals.MeshName << "\"")
+    return false;
+    }
+
+  for (unsigned int i = 0; i < nSteps; ++i)
+    {
+    if (internals.ProcessStep(steps[i], mmd))
+      {
+      SENSEI_ERROR("Failed to process step " << steps[i]->GetDataTimeStep())
+      return false;
+      }
+    }
+
   return true;
 }
 
@@ -371,109 +686,73 @@ void Autocorrelation::PrintResults(size_t k_max)
   TimeEvent<128> mark("Autocorrelation::PrintResults");
 
   AInternals& internals = (*this->Internals);
-  size_t nblocks = internals.NumberOfBlocks;
-
-    // add up the autocorrellations
-  internals.Master->foreach([](AutocorrelationImpl* b, const sdiy::Master::ProxyWithLink& cp)
-                                     {
-                                        std::vector<float> sums(b->window, 0);
-                                        sdiy::for_each(b->corr.shape(), [&](const Vertex4D& v)
-                                        {
-                                            size_t w = v[3];
-                                            sums[w] += b->corr(v);
-                                        });
-
-                                        cp.all_reduce(sums, add_vectors<float>());
-                                     });
-  internals.Master->exchange();
-  if (internals.Master->communicator().rank() == 0)
+
+  MPI_Comm comm = this->GetCommunicator();
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  // ranks without blocks take part, so the shifts are not taken from a block
+  std::vector<size_t> lags =
+    AutocorrelationImpl::makeLags(internals.Window, internals.Channels);
+  size_t nShifts = lags.size();
+
+  // add up the autocorrelations and select the k strongest for each shift
+  // over the local blocks
+  using Selection = TopK<float,Vertex>;
+
+  std::vector<float> sums(nShifts, 0.0f);
+  std::vector<Selection> maxs(nShifts, Selection(k_max));
+
+  int nBlocks = internals.Master->size();
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    AutocorrelationImpl* b = internals.Master->block<AutocorrelationImpl>(i);
+    sdiy::for_each(b->corr.shape(), [&](const Vertex4D& v)
+      {
+      size_t w = v[3];
+      float val = b->corr(v);
+      sums[w] += val;
+      maxs[w].Insert(val, v.drop(3) + b->from);
+      });
+    }
+
+  MPI_Reduce(rank ? sums.data() : MPI_IN_PLACE, sums.data(), nShifts,
+    MPI_FLOAT, MPI_SUM, 0, comm);
+
+  if (rank == 0)
     {
     // print out the autocorrelations
-    auto result = internals.Master->proxy(0).get<std::vector<float>>();
+    if (internals.Channels)
+      {
+      std::cerr << "Lags:";
+      for (size_t i = 0; i < nShifts; ++i)
+        std::cerr << ' ' << lags[i];
+      std::cerr << std::endl;
+      }
     std::cerr << "Autocorrelations:";
-    for (size_t i = 0; i < result.size(); ++i)
-      std::cerr << ' ' << result[i];
+    for (size_t i = 0; i < nShifts; ++i)
+      std::cerr << ' ' << sums[i];
     std::cerr << std::endl;
     }
 
-  internals.Master->foreach(
-    [](AutocorrelationImpl*, const sdiy::Master::ProxyWithLink& cp)
-    {
-    cp.collectives()->clear();
-    });
+  if (k_max == 0)
+    return;
 
+  // only the candidates that can be in the result are gathered to rank 0
+  std::vector<std::vector<Selection::Candidate>> result;
+  GlobalTopK(comm, 0, maxs, result);
 
-  // select k strongest autocorrelations for each shift
-  sdiy::ContiguousAssigner     assigner(internals.Master->communicator().size(), nblocks);     // NB: this is coupled to main(...) in oscillator.cpp
-  sdiy::RegularDecomposer<sdiy::DiscreteBounds> decomposer(1, sdiy::interval(0, nblocks-1), nblocks);
-  sdiy::RegularMergePartners   partners(decomposer, 2);
-  //sdiy::RegularMergePartners   partners(3, nblocks, 2, true);
-  sdiy::reduce(*internals.Master, assigner, partners,
-              [k_max](void* b_, const sdiy::ReduceProxy& rp, const sdiy::RegularMergePartners&)
-              {
-                  AutocorrelationImpl* b = static_cast<AutocorrelationImpl*>(b_);
-                  //unsigned round = rp.round(); // current round number
-
-                  using MaxHeapVector = std::vector<std::vector<std::tuple<float,Vertex>>>;
-                  using Compare       = std::greater<std::tuple<float,Vertex>>;
-                  MaxHeapVector maxs(b->window);
-                  if (rp.in_link().size() == 0)
-                  {
-                      sdiy::for_each(b->corr.shape(), [&](const Vertex4D& v)
-                      {
-                          size_t offset = v[3];
-                          float val = b->corr(v);
-                          auto& max = maxs[offset];
-                          if (max.size() < k_max)
-                          {
-                              max.emplace_back(val, v.drop(3) + b->from);
-                              std::push_heap(max.begin(), max.end(), Compare());
-                          } else if (val > std::get<0>(max[0]))
-                          {
-                              std::pop_heap(max.begin(), max.end(), Compare());
-                              maxs[offset].back() = std::make_tuple(val, v.drop(3) + b->from);
-                              std::push_heap(max.begin(), max.end(), Compare());
-                          }
-                      });
-                  } else
-                  {
-                      for (long i = 0; i < rp.in_link().size(); ++i)
-                      {
-                          MaxHeapVector in_heaps;
-                          rp.dequeue(rp.in_link().target(i).gid, in_heaps);
-                          for (size_t j = 0; j < in_heaps.size(); ++j)
-                          {
-                              for (auto& x : in_heaps[j])
-                                  maxs[j].push_back(x);
-                          }
-                      }
-                      for (size_t j = 0; j < maxs.size(); ++j)
-                      {
-                          auto& max = maxs[j];
-                          std::make_heap(max.begin(), max.end(), Compare());
-                          while(max.size() > k_max)
-                          {
-                              std::pop_heap(max.begin(), max.end(), Compare());
-                              max.pop_back();
-                          }
-                      }
-                  }
-
-                  if (rp.out_link().size() > 0)
-                      rp.enqueue(rp.out_link().target(0), maxs);
-                  else
-                  {
-                      // print out the answer
-                      for (size_t i = 0; i < maxs.size(); ++i)
-                      {
-                          std::sort(maxs[i].begin(), maxs[i].end(), Compare());
-                          std::cerr << "Max autocorrelations for " << i << ":";
-                          for (auto& x : maxs[i])
-                              std::cerr << " (" << std::get<0>(x) << " at " << std::get<1>(x) << ")";
-                          std::cerr << std::endl;
-                      }
-                  }
-              });
+  if (rank == 0)
+    {
+    // print out the answer
+    for (size_t i = 0; i < nShifts; ++i)
+      {
+      std::cerr << "Max autocorrelations for " << i << ":";
+      for (auto& x : result[i])
+        std::cerr << " (" << x.Value << " at " << x.Item << ")";
+      std::cerr << std::endl;
+      }
+    }
 }
 
 //-----------------------------------------------------------------------------
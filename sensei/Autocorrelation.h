@@ -30,13 +30,43 @@ public:
   /// @param arrayname together with \c association, identifies the array to
   ///         compute autocorrelation for.
   /// @param kMax number of strongest autocorrelations to report
-  /// @param numThreads number of threads in sdiy's thread pool
+  /// @param numThreads number of threads of the TaskRuntime used to process
+  ///         the blocks, < 1 uses all of them. Blocks are split so that a
+  ///         single large block is also processed in parallel.
   void Initialize(size_t window, const std::string &meshName,
     int association, const std::string &arrayname, size_t kMax,
     int numThreads = 1);
 
+  /// @brief Use the multiple tau correlator.
+  ///
+  /// By default the autocorrelation is computed exactly for each shift up to
+  /// the window, which keeps a correlation per shift for each cell or point
+  /// and the array's values over the window. The values are held in the
+  /// TemporalWindow of the array, shared with the other analyses of its
+  /// history.
+  /// The multiple tau correlator instead correlates the last \c channels
+  /// steps exactly and longer lags at a resolution that halves with each
+  /// doubling of the lag, using averages of the values. Memory then grows with
+  /// the log of the window. Must be called before the first Execute.
+  ///
+  /// @param channels number of lags at each resolution, rounded up to even.
+  ///        0 selects the exact mode.
+  void SetMultipleTau(size_t channels);
+
+  /// @brief Set how the history of the exact mode is stored.
+  ///
+  /// One of the TemporalWindow storage modes, reduced precision trades
+  /// accuracy of the correlations for memory. The default is
+  /// TemporalWindow::STORAGE_FLOAT, which is exact for float arrays. Must be
+  /// called before the first Execute.
+  void SetStorage(int storage);
+
   bool Execute(DataAdaptor* data) override;
 
+  /// the steps of a batch are processed with a single metadata query
+  bool ExecuteBatch(const std::vector<DataAdaptor*> &steps) override;
+  bool AcceptsBatches() override { return true; }
+
   int Finalize() override;
 
 protected:
@@ -1,12 +1,15 @@
 #include "BinaryStream.h"
+#include "MPIUtils.h"
+#include "Profiler.h"
 #include <mpi.h>
+#include <algorithm>
 
 namespace sensei
 {
 
 //-----------------------------------------------------------------------------
 BinaryStream::BinaryStream()
-   : mSize(0), mData(nullptr), mReadPtr(nullptr), mWritePtr(nullptr)
+   : mOwner(true), mSize(0), mData(nullptr), mReadPtr(nullptr), mWritePtr(nullptr)
 {}
 
 //-----------------------------------------------------------------------------
@@ -17,12 +20,12 @@ BinaryStream::~BinaryStream() noexcept
 
 //-----------------------------------------------------------------------------
 BinaryStream::BinaryStream(const BinaryStream &other)
-   : mSize(0), mData(nullptr), mReadPtr(nullptr), mWritePtr(nullptr)
+   : mOwner(true), mSize(0), mData(nullptr), mReadPtr(nullptr), mWritePtr(nullptr)
 { *this = other; }
 
 //-----------------------------------------------------------------------------
 BinaryStream::BinaryStream(BinaryStream &&other) noexcept
-   : mSize(0), mData(nullptr), mReadPtr(nullptr), mWritePtr(nullptr)
+   : mOwner(true), mSize(0), mData(nullptr), mReadPtr(nullptr), mWritePtr(nullptr)
 { this->Swap(other); }
 
 //-----------------------------------------------------------------------------
@@ -32,6 +35,10 @@ const BinaryStream &BinaryStream::operator=(
   if (&other == this)
     return *this;
 
+  // the copy always owns its buffer
+  if (!mOwner)
+    this->Clear();
+
   this->Resize(other.mSize);
   unsigned long inUse = other.mWritePtr - other.mData;
   memcpy(mData, other.mData, inUse);
@@ -53,7 +60,9 @@ const BinaryStream &BinaryStream::operator=(
 //-----------------------------------------------------------------------------
 void BinaryStream::Clear() noexcept
 {
-  free(mData);
+  if (mOwner)
+    free(mData);
+  mOwner = true;
   mData = nullptr;
   mReadPtr = nullptr;
   mWritePtr = nullptr;
@@ -83,6 +92,20 @@ void BinaryStream::Resize(unsigned long nBytes)
     return;
     }
 
+  // grow an external buffer. take a private copy since we may not
+  // reallocate memory we don't own
+  if (!mOwner)
+    {
+    unsigned char *newData = (unsigned char *)malloc(nBytes);
+    memcpy(newData, mData, mWritePtr - mData);
+    mWritePtr = newData + (mWritePtr - mData);
+    mReadPtr = newData + (mReadPtr - mData);
+    mData = newData;
+    mSize = nBytes;
+    mOwner = true;
+    return;
+    }
+
   // grow
   unsigned char *origMData = mData;
   mData = (unsigned char *)realloc(mData, nBytes);
@@ -97,22 +120,43 @@ void BinaryStream::Resize(unsigned long nBytes)
   mSize = nBytes;
 }
 
+//-----------------------------------------------------------------------------
+void BinaryStream::SetExternalBuffer(unsigned char *data,
+  unsigned long nBytes) noexcept
+{
+  this->Clear();
+  mOwner = false;
+  mData = data;
+  mSize = nBytes;
+  mReadPtr = data;
+  mWritePtr = data + nBytes;
+}
+
 //-----------------------------------------------------------------------------
 void BinaryStream::Grow(unsigned long nBytes)
 {
   unsigned long nBytesNeeded = this->Size() + nBytes;
   if (nBytesNeeded > mSize)
     {
-    unsigned long newSize = mSize + this->GetBlockSize();
-    while (newSize < nBytesNeeded)
-      newSize += this->GetBlockSize();
+    // double the capacity, rounded up to a whole number of blocks
+    unsigned long newSize = std::max(2*mSize, nBytesNeeded);
+    unsigned long blockSize = this->GetBlockSize();
+    newSize = ((newSize + blockSize - 1)/blockSize)*blockSize;
     this->Resize(newSize);
     }
 }
 
+//-----------------------------------------------------------------------------
+void BinaryStream::Reserve(unsigned long nBytes)
+{
+  if (nBytes > mSize)
+    this->Resize(nBytes);
+}
+
 //-----------------------------------------------------------------------------
 void BinaryStream::Swap(BinaryStream &other) noexcept
 {
+  std::swap(mOwner, other.mOwner);
   std::swap(mData, other.mData);
   std::swap(mWritePtr, other.mWritePtr);
   std::swap(mReadPtr, other.mReadPtr);
@@ -121,28 +165,52 @@ void BinaryStream::Swap(BinaryStream &other) noexcept
 
 //-----------------------------------------------------------------------------
 int BinaryStream::Broadcast(int rootRank)
+{
+  return this->Broadcast(MPI_COMM_WORLD, rootRank);
+}
+
+//-----------------------------------------------------------------------------
+int BinaryStream::Broadcast(MPI_Comm comm, int rootRank)
 {
   int init = 0;
   int rank = 0;
   MPI_Initialized(&init);
   if (init)
     {
+    CollectiveEvent mark(comm, "BinaryStream::Broadcast");
+    MPI_Comm_rank(comm, &rank);
+
+    // the size is sent along with the head of the stream, small streams
+    // such as metadata take a single broadcast, the rest of larger ones
+    // a second
+    const unsigned long headSize = 4096;
+    const unsigned long maxInline = headSize - sizeof(unsigned long);
+    unsigned char head[headSize];
+
     unsigned long nbytes = 0;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     if (rank == rootRank)
       {
       nbytes = this->Size();
-      MPI_Bcast(&nbytes, 1, MPI_UNSIGNED_LONG, rootRank, MPI_COMM_WORLD);
-      MPI_Bcast(this->GetData(), nbytes, MPI_BYTE, rootRank, MPI_COMM_WORLD);
+      memcpy(head, &nbytes, sizeof(unsigned long));
+      memcpy(head + sizeof(unsigned long), this->GetData(),
+        std::min(nbytes, maxInline));
       }
-    else
+
+    MPI_Bcast(head, headSize, MPI_BYTE, rootRank, comm);
+
+    if (rank != rootRank)
       {
-      MPI_Bcast(&nbytes, 1, MPI_UNSIGNED_LONG, rootRank, MPI_COMM_WORLD);
+      memcpy(&nbytes, head, sizeof(unsigned long));
       this->Resize(nbytes);
-      MPI_Bcast(this->GetData(), nbytes, MPI_BYTE, rootRank, MPI_COMM_WORLD);
+      memcpy(this->GetData(), head + sizeof(unsigned long),
+        std::min(nbytes, maxInline));
       this->SetReadPos(0);
       this->SetWritePos(nbytes);
       }
+
+    if (nbytes > maxInline)
+      MPIUtils::Bcast(this->GetData() + maxInline, nbytes - maxInline,
+        MPI_BYTE, rootRank, comm);
     }
   return 0;
 }
@@ -4,6 +4,8 @@
 #include "senseiConfig.h"
 #include "Error.h"
 
+#include <mpi.h>
+
 #include <cstdlib>
 #include <cstring>
 #include <string>
@@ -42,9 +44,29 @@ public:
   // Allocate nBytes for the stream.
   void Resize(unsigned long nBytes);
 
-  // ensures space for nBytes more to the stream.
+  // Wrap a buffer of nBytes of valid data owned by the caller, for
+  // instance an MPI receive buffer or an ADIOS2 span, without copying
+  // it. The read position is set to the head of the buffer and the
+  // write position to its end. The caller must keep the buffer alive
+  // while the stream is in use, the stream will not free it. Should the
+  // stream need to grow, the data is first copied into a buffer owned
+  // by the stream.
+  void SetExternalBuffer(unsigned char *data, unsigned long nBytes) noexcept;
+
+  // evaluates to true when the stream wraps an externally owned buffer
+  bool IsExternalBuffer() const noexcept
+  { return !mOwner; }
+
+  // ensures space for nBytes more to the stream. the buffer is grown
+  // geometrically so that the cost of packing many small values is
+  // amortized.
   void Grow(unsigned long nBytes);
 
+  // ensures the internal buffer can hold at least nBytes in total
+  // without further reallocation. use with PackedSize to pre-size the
+  // stream before packing large objects.
+  void Reserve(unsigned long nBytes);
+
   // Get a pointer to the stream internal representation.
   unsigned char *GetData() noexcept
   { return mData; }
@@ -67,6 +89,11 @@ public:
   void SetReadPos(unsigned long n) noexcept
   { mReadPtr = mData + n; }
 
+  // get the number of bytes from the head of the stream to the read
+  // position
+  unsigned long GetReadPos() const noexcept
+  { return mReadPtr - mData; }
+
   void SetWritePos(unsigned long n) noexcept
   { mWritePtr = mData + n; }
 
@@ -82,6 +109,13 @@ public:
   template <typename T> void Pack(const T *val, unsigned long n);
   template <typename T> void Unpack(T *val, unsigned long n);
 
+  // Get a pointer to the next n values in the stream and advance the
+  // read position past them, without copying. The pointer is valid
+  // until the stream is modified or destroyed. Values are packed
+  // without padding, so the pointer is only suitably aligned for T if
+  // the data was packed at an aligned offset.
+  template <typename T> const T *UnpackView(unsigned long n);
+
   // specializations
   void Pack(const std::string &str);
   void Unpack(std::string &str);
@@ -106,9 +140,37 @@ public:
     typename std::enable_if<!std::is_class<T>::value>::type* = 0);
 #endif
 
+  // Get the number of bytes the corresponding Pack call would add
+  // to the stream.
+  template <typename T> static unsigned long PackedSize(const T &val,
+    typename std::enable_if<!std::is_class<T>::value>::type* = 0);
+
+  static unsigned long PackedSize(const std::string &str);
+
+  template <typename T, unsigned long N>
+  static unsigned long PackedSize(const std::array<T,N> &arr);
+
+  template <typename K, typename V>
+  static unsigned long PackedSize(const std::map<K,V> &amap);
+
+  template<typename T> static unsigned long PackedSize(const std::vector<T> &v,
+    typename std::enable_if<std::is_class<T>::value>::type* = 0);
+
+#if !defined(SWIG)
+  template<typename T> static unsigned long PackedSize(const std::vector<T> &v,
+    typename std::enable_if<!std::is_class<T>::value>::type* = 0);
+#endif
+
   // broadcast the stream from the root process to all other processes
+  // over MPI_COMM_WORLD. threaded code should pass a communicator of
+  // its own instead.
   int Broadcast(int rootRank=0);
 
+  // broadcast the stream from the root process to all other processes
+  // in the communicator. the communicator must not be used by another
+  // thread during the call
+  int Broadcast(MPI_Comm comm, int rootRank);
+
 private:
   // re-allocation size
   static
@@ -116,6 +178,7 @@ private:
   { return 512; }
 
 private:
+  bool mOwner;
   unsigned long mSize;
   unsigned char *mData;
   unsigned char *mReadPtr;
@@ -168,6 +231,15 @@ void BinaryStream::Unpack(T *val, unsigned long n)
   mReadPtr += nn;
 }
 
+//-----------------------------------------------------------------------------
+template <typename T>
+const T *BinaryStream::UnpackView(unsigned long n)
+{
+  const T *val = reinterpret_cast<const T*>(mReadPtr);
+  mReadPtr += n*sizeof(T);
+  return val;
+}
+
 //-----------------------------------------------------------------------------
 inline
 void BinaryStream::Pack(const std::string &str)
@@ -280,6 +352,61 @@ void BinaryStream::Unpack(std::vector<T> &v, typename std::enable_if<!std::is_cl
   this->Unpack(v.data(), vlen);
 }
 
+//-----------------------------------------------------------------------------
+template <typename T>
+unsigned long BinaryStream::PackedSize(const T &,
+  typename std::enable_if<!std::is_class<T>::value>::type*)
+{
+  return sizeof(T);
+}
+
+//-----------------------------------------------------------------------------
+inline
+unsigned long BinaryStream::PackedSize(const std::string &str)
+{
+  return sizeof(unsigned long) + str.size();
+}
+
+//-----------------------------------------------------------------------------
+template <typename T, unsigned long N>
+unsigned long BinaryStream::PackedSize(const std::array<T,N> &)
+{
+  return N*sizeof(T);
+}
+
+//-----------------------------------------------------------------------------
+template <typename K, typename V>
+unsigned long BinaryStream::PackedSize(const std::map<K,V> &amap)
+{
+  unsigned long nBytes = sizeof(unsigned long);
+
+  typename std::map<K,V>::const_iterator it = amap.begin();
+  typename std::map<K,V>::const_iterator end = amap.end();
+  for (; it != end; ++it)
+    nBytes += PackedSize(it->first) + PackedSize(it->second);
+
+  return nBytes;
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+unsigned long BinaryStream::PackedSize(const std::vector<T> &v,
+  typename std::enable_if<std::is_class<T>::value>::type*)
+{
+  unsigned long nBytes = sizeof(unsigned long);
+  unsigned long vlen = v.size();
+  for (unsigned long i = 0; i < vlen; ++i)
+    nBytes += PackedSize(v[i]);
+  return nBytes;
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+unsigned long BinaryStream::PackedSize(const std::vector<T> &v,
+  typename std::enable_if<!std::is_class<T>::value>::type*)
+{
+  return sizeof(unsigned long) + v.size()*sizeof(T);
+}
 
 }
 
@@ -0,0 +1,322 @@
+#include "BlockIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// the most blocks held in a leaf
+constexpr int leafSize = 8;
+
+// compute the range of the signed distance from a plane to the points
+// of a box
+void planeDistance(const std::array<double,6> &box, const double *point,
+  const double *normal, double &dmin, double &dmax)
+{
+  double c = 0.0;
+  double r = 0.0;
+  for (int j = 0; j < 3; ++j)
+    {
+    double mid = 0.5*(box[2*j] + box[2*j+1]);
+    double half = 0.5*(box[2*j+1] - box[2*j]);
+    c += normal[j]*(mid - point[j]);
+    r += std::fabs(normal[j])*half;
+    }
+  dmin = c - r;
+  dmax = c + r;
+}
+
+// true if the boxes overlap or touch
+bool overlaps(const std::array<double,6> &a, const std::array<double,6> &b)
+{
+  for (int j = 0; j < 3; ++j)
+    {
+    if ((a[2*j] > b[2*j+1]) || (b[2*j] > a[2*j+1]))
+      return false;
+    }
+  return true;
+}
+
+// true if at least one of the sorted values is in [lo, hi]
+bool containsValue(const std::vector<double> &vals, double lo, double hi)
+{
+  std::vector<double>::const_iterator it =
+    std::lower_bound(vals.begin(), vals.end(), lo);
+  return (it != vals.end()) && (*it <= hi);
+}
+}
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+void BlockIndex::Initialize(const std::vector<std::array<double,6>> &bounds)
+{
+  this->Clear();
+
+  int nBlocks = bounds.size();
+  if (nBlocks == 0)
+    return;
+
+  this->Bounds = bounds;
+
+  std::vector<Center> centers(nBlocks);
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    centers[i].Id = i;
+    for (int j = 0; j < 3; ++j)
+      centers[i].X[j] = 0.5*(bounds[i][2*j] + bounds[i][2*j+1]);
+    }
+
+  this->Ids.resize(nBlocks);
+  this->Nodes.reserve(2*(nBlocks/leafSize + 1));
+  this->Build(centers, 0, nBlocks);
+}
+
+// --------------------------------------------------------------------------
+void BlockIndex::Initialize(const std::vector<std::array<double,2>> &ranges)
+{
+  int nBlocks = ranges.size();
+  std::vector<std::array<double,6>> bounds(nBlocks);
+  for (int i = 0; i < nBlocks; ++i)
+    bounds[i] = {ranges[i][0], ranges[i][1], 0.0, 0.0, 0.0, 0.0};
+
+  this->Initialize(bounds);
+}
+
+// --------------------------------------------------------------------------
+void BlockIndex::Clear()
+{
+  this->Nodes.clear();
+  this->Ids.clear();
+  this->Bounds.clear();
+}
+
+// --------------------------------------------------------------------------
+int BlockIndex::Build(std::vector<Center> &centers, int begin, int end)
+{
+  int nodeId = this->Nodes.size();
+  this->Nodes.emplace_back();
+
+  // bound the block centers
+  std::array<double,6> cbox;
+  for (int j = 0; j < 3; ++j)
+    {
+    cbox[2*j] = std::numeric_limits<double>::max();
+    cbox[2*j+1] = std::numeric_limits<double>::lowest();
+    }
+
+  for (int i = begin; i < end; ++i)
+    {
+    const std::array<double,3> &c = centers[i].X;
+    for (int j = 0; j < 3; ++j)
+      {
+      cbox[2*j] = std::min(cbox[2*j], c[j]);
+      cbox[2*j+1] = std::max(cbox[2*j+1], c[j]);
+      }
+    }
+
+  std::array<double,6> box;
+  int left = -1;
+  int right = -1;
+
+  if ((end - begin) > leafSize)
+    {
+    // split at the median center along the longest axis
+    int axis = 0;
+    for (int j = 1; j < 3; ++j)
+      {
+      if ((cbox[2*j+1] - cbox[2*j]) > (cbox[2*axis+1] - cbox[2*axis]))
+        axis = j;
+      }
+
+    int mid = begin + (end - begin)/2;
+    std::nth_element(centers.begin() + begin, centers.begin() + mid,
+      centers.begin() + end, [axis](const Center &a, const Center &b) -> bool
+      { return a.X[axis] < b.X[axis]; });
+
+    left = this->Build(centers, begin, mid);
+    right = this->Build(centers, mid, end);
+
+    // bound the children
+    const std::array<double,6> &lbox = this->Nodes[left].Bounds;
+    const std::array<double,6> &rbox = this->Nodes[right].Bounds;
+    for (int j = 0; j < 3; ++j)
+      {
+      box[2*j] = std::min(lbox[2*j], rbox[2*j]);
+      box[2*j+1] = std::max(lbox[2*j+1], rbox[2*j+1]);
+      }
+    }
+  else
+    {
+    // bound the blocks
+    for (int j = 0; j < 3; ++j)
+      {
+      box[2*j] = std::numeric_limits<double>::max();
+      box[2*j+1] = std::numeric_limits<double>::lowest();
+      }
+
+    for (int i = begin; i < end; ++i)
+      {
+      this->Ids[i] = centers[i].Id;
+      const std::array<double,6> &bds = this->Bounds[this->Ids[i]];
+      for (int j = 0; j < 3; ++j)
+        {
+        box[2*j] = std::min(box[2*j], bds[2*j]);
+        box[2*j+1] = std::max(box[2*j+1], bds[2*j+1]);
+        }
+      }
+    }
+
+  Node &node = this->Nodes[nodeId];
+  node.Bounds = box;
+  node.Left = left;
+  node.Right = right;
+  node.Begin = begin;
+  node.End = end;
+
+  return nodeId;
+}
+
+// --------------------------------------------------------------------------
+void BlockIndex::FindValues(const std::vector<double> &vals,
+  std::vector<int> &ids) const
+{
+  ids.clear();
+
+  if (this->Nodes.empty() || vals.empty())
+    return;
+
+  std::vector<double> sorted(vals);
+  std::sort(sorted.begin(), sorted.end());
+
+  std::vector<int> stack(1, 0);
+  while (!stack.empty())
+    {
+    const Node &node = this->Nodes[stack.back()];
+    stack.pop_back();
+
+    if (!containsValue(sorted, node.Bounds[0], node.Bounds[1]))
+      continue;
+
+    if (node.Left >= 0)
+      {
+      stack.push_back(node.Right);
+      stack.push_back(node.Left);
+      continue;
+      }
+
+    for (int i = node.Begin; i < node.End; ++i)
+      {
+      int bid = this->Ids[i];
+      if (containsValue(sorted, this->Bounds[bid][0], this->Bounds[bid][1]))
+        ids.push_back(bid);
+      }
+    }
+
+  std::sort(ids.begin(), ids.end());
+}
+
+// --------------------------------------------------------------------------
+void BlockIndex::FindPlanes(const std::vector<std::array<double,3>> &points,
+  const std::vector<std::array<double,3>> &normals,
+  std::vector<int> &ids) const
+{
+  ids.clear();
+
+  int nPlanes = std::min(points.size(), normals.size());
+  if (this->Nodes.empty() || (nPlanes == 0))
+    return;
+
+  std::vector<int> stack(1, 0);
+  while (!stack.empty())
+    {
+    const Node &node = this->Nodes[stack.back()];
+    stack.pop_back();
+
+    // a node is visited when any plane passes through its box. a small
+    // tolerance keeps rounding from pruning blocks that touch a plane
+    bool hit = false;
+    for (int k = 0; !hit && (k < nPlanes); ++k)
+      {
+      double dmin = 0.0;
+      double dmax = 0.0;
+      planeDistance(node.Bounds, points[k].data(), normals[k].data(),
+        dmin, dmax);
+
+      double eps = 1.0e-12*(std::fabs(dmin) + std::fabs(dmax));
+      hit = (dmin <= eps) && (dmax > -eps);
+      }
+
+    if (!hit)
+      continue;
+
+    if (node.Left >= 0)
+      {
+      stack.push_back(node.Right);
+      stack.push_back(node.Left);
+      continue;
+      }
+
+    // a block intersects a plane when its corners are not all on the same
+    // side
+    for (int i = node.Begin; i < node.End; ++i)
+      {
+      int bid = this->Ids[i];
+      for (int k = 0; k < nPlanes; ++k)
+        {
+        double dmin = 0.0;
+        double dmax = 0.0;
+        planeDistance(this->Bounds[bid], points[k].data(), normals[k].data(),
+          dmin, dmax);
+
+        if ((dmin <= 0.0) && (dmax > 0.0))
+          {
+          ids.push_back(bid);
+          break;
+          }
+        }
+      }
+    }
+
+  std::sort(ids.begin(), ids.end());
+}
+
+// --------------------------------------------------------------------------
+void BlockIndex::FindBox(const std::array<double,6> &box,
+  std::vector<int> &ids) const
+{
+  ids.clear();
+
+  if (this->Nodes.empty())
+    return;
+
+  std::vector<int> stack(1, 0);
+  while (!stack.empty())
+    {
+    const Node &node = this->Nodes[stack.back()];
+    stack.pop_back();
+
+    if (!overlaps(node.Bounds, box))
+      continue;
+
+    if (node.Left >= 0)
+      {
+      stack.push_back(node.Right);
+      stack.push_back(node.Left);
+      continue;
+      }
+
+    for (int i = node.Begin; i < node.End; ++i)
+      {
+      int bid = this->Ids[i];
+      if (overlaps(this->Bounds[bid], box))
+        ids.push_back(bid);
+      }
+    }
+
+  std::sort(ids.begin(), ids.end());
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef sensei_BlockIndex_h
+#define sensei_BlockIndex_h
+
+#include <array>
+#include <vector>
+
+namespace sensei
+{
+
+/// @class BlockIndex
+/// @brief a bounding volume hierarchy over block bounds or array ranges.
+///
+/// The index is built once, in O(n log n), and answers queries for the
+/// blocks intersecting a set of planes or a box, or the blocks whose array
+/// range contains one of a set of values, in O(log n + k) for k matching
+/// blocks.
+/// An array range [lo, hi] is indexed as the box [lo, hi, 0, 0, 0, 0].
+/// Query results are returned in ascending order of block id.
+class BlockIndex
+{
+public:
+  BlockIndex() = default;
+
+  /// build the index over block bounds
+  void Initialize(const std::vector<std::array<double,6>> &bounds);
+
+  /// build the index over the range of one array
+  void Initialize(const std::vector<std::array<double,2>> &ranges);
+
+  /// release the index
+  void Clear();
+
+  /// the number of blocks in the index
+  int GetNumberOfBlocks() const { return this->Ids.size(); }
+
+  /// get the blocks whose range contains at least one of the values
+  void FindValues(const std::vector<double> &vals, std::vector<int> &ids) const;
+
+  /// get the blocks that intersect at least one of the planes defined by
+  /// the points and normals
+  void FindPlanes(const std::vector<std::array<double,3>> &points,
+    const std::vector<std::array<double,3>> &normals,
+    std::vector<int> &ids) const;
+
+  /// get the blocks whose bounds overlap the box. bounds that only touch
+  /// the box are included
+  void FindBox(const std::array<double,6> &box, std::vector<int> &ids) const;
+
+private:
+  struct Node
+  {
+    std::array<double,6> Bounds;
+    int Left;   // first child, or -1 for a leaf
+    int Right;  // second child
+    int Begin;  // the leaf's range in Ids
+    int End;
+  };
+
+  // a block's center, kept next to its id while building
+  struct Center
+  {
+    std::array<double,3> X;
+    int Id;
+  };
+
+  int Build(std::vector<Center> &centers, int begin, int end);
+
+  std::vector<Node> Nodes;
+  std::vector<int> Ids;
+  std::vector<std::array<double,6>> Bounds;
+};
+
+}
+
+#endif
@@ -0,0 +1,168 @@
+#include "BlockReadPlan.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+void BlockReadPlan::Clear()
+{
+  this->Requests.clear();
+  this->Reads.clear();
+  this->Order.clear();
+  this->Built = false;
+}
+
+// --------------------------------------------------------------------------
+int BlockReadPlan::Add(int var, unsigned long long start,
+  unsigned long long count, int elemSize)
+{
+  this->Requests.push_back({var, start, count, elemSize});
+  this->Built = false;
+  return this->Requests.size() - 1;
+}
+
+// --------------------------------------------------------------------------
+bool BlockReadPlan::Matches(const std::vector<int> &var,
+  const std::vector<unsigned long long> &start,
+  const std::vector<unsigned long long> &count) const
+{
+  size_t nReqs = this->Requests.size();
+
+  if ((var.size() != nReqs) || (start.size() != nReqs) ||
+    (count.size() != nReqs))
+    return false;
+
+  for (size_t i = 0; i < nReqs; ++i)
+    {
+    const Request &req = this->Requests[i];
+    if ((req.Var != var[i]) || (req.Start != start[i]) ||
+      (req.Count != count[i]))
+      return false;
+    }
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void BlockReadPlan::Build()
+{
+  this->Reads.clear();
+
+  int nReqs = this->Requests.size();
+
+  // order the requests by variable then position
+  this->Order.resize(nReqs);
+  for (int i = 0; i < nReqs; ++i)
+    this->Order[i] = i;
+
+  std::stable_sort(this->Order.begin(), this->Order.end(),
+    [&](int a, int b) -> bool
+    {
+    const Request &ra = this->Requests[a];
+    const Request &rb = this->Requests[b];
+    return (ra.Var < rb.Var) || ((ra.Var == rb.Var) && (ra.Start < rb.Start));
+    });
+
+  // merge requests that are adjacent in the same variable
+  for (int i = 0; i < nReqs; ++i)
+    {
+    const Request &req = this->Requests[this->Order[i]];
+
+    if (!this->Reads.empty())
+      {
+      Read &last = this->Reads.back();
+      if ((last.Var == req.Var) && (last.ElemSize == req.ElemSize) &&
+        (last.Start + last.Count == req.Start))
+        {
+        last.Count += req.Count;
+        last.Last = i + 1;
+        continue;
+        }
+      }
+
+    this->Reads.push_back({req.Var, req.Start, req.Count, req.ElemSize, i, i + 1});
+    }
+
+  this->Built = true;
+}
+
+// --------------------------------------------------------------------------
+int BlockReadPlan::Execute(const std::vector<void*> &dests,
+  const ReadFunction &read, const SyncFunction &sync)
+{
+  TimeEvent<128> mark("BlockReadPlan::Execute");
+
+  if (dests.size() != this->Requests.size())
+    {
+    SENSEI_ERROR("A destination is needed for each of the "
+      << this->Requests.size() << " requests. " << dests.size() << " given")
+    return -1;
+    }
+
+  if (!this->Built)
+    this->Build();
+
+  // merged reads are staged, the buffers must live until the sync
+  int nReads = this->Reads.size();
+  std::vector<std::vector<char>> staging(nReads);
+
+  for (int i = 0; i < nReads; ++i)
+    {
+    const Read &rd = this->Reads[i];
+
+    if (rd.Count == 0)
+      continue;
+
+    void *dest = nullptr;
+    if ((rd.Last - rd.First) == 1)
+      {
+      dest = dests[this->Order[rd.First]];
+      }
+    else
+      {
+      staging[i].resize(rd.Count*rd.ElemSize);
+      dest = staging[i].data();
+      }
+
+    if (read(rd.Var, rd.Start, rd.Count, dest))
+      {
+      SENSEI_ERROR("Failed to read " << rd.Count << " elements at "
+        << rd.Start << " from variable " << rd.Var)
+      return -1;
+      }
+    }
+
+  if (sync && sync())
+    {
+    SENSEI_ERROR("Failed to complete " << nReads << " reads")
+    return -1;
+    }
+
+  // copy the merged reads out
+  for (int i = 0; i < nReads; ++i)
+    {
+    if (staging[i].empty())
+      continue;
+
+    const Read &rd = this->Reads[i];
+    const char *src = staging[i].data();
+
+    for (int j = rd.First; j < rd.Last; ++j)
+      {
+      int rid = this->Order[j];
+      const Request &req = this->Requests[rid];
+      size_t nBytes = req.Count*req.ElemSize;
+
+      memcpy(dests[rid], src + (req.Start - rd.Start)*rd.ElemSize, nBytes);
+      }
+    }
+
+  return 0;
+}
+
+}
@@ -0,0 +1,96 @@
+#ifndef sensei_BlockReadPlan_h
+#define sensei_BlockReadPlan_h
+
+#include <functional>
+#include <vector>
+
+namespace sensei
+{
+
+/// @class BlockReadPlan
+/// @brief batches and coalesces the reads of a rank's blocks.
+///
+/// Transports store the blocks of a variable one after another in a 1D
+/// global array. After partitioning, a rank typically owns runs of
+/// consecutive blocks. A plan collects the rank's requests for a step, each
+/// a span of a variable, and merges spans that are adjacent in the same
+/// variable into a single read. Executing the plan issues all of the reads
+/// through a transport supplied callback followed by a single
+/// synchronization, then copies merged reads out to the destination of each
+/// request. Spans that are not merged are read directly into their
+/// destination.
+///
+/// The plan depends only on the requests, not the destinations, and may be
+/// kept and re-executed for as long as the mesh and the partitioning do not
+/// change. See Matches.
+class BlockReadPlan
+{
+public:
+  // called once per merged read. var, start, and count identify the span of
+  // elements, dest is a buffer large enough to hold them. the read may be
+  // deferred until Sync is called. returns 0 on success.
+  using ReadFunction = std::function<int(int var, unsigned long long start,
+    unsigned long long count, void *dest)>;
+
+  // called after all reads have been issued. returns 0 on success.
+  using SyncFunction = std::function<int()>;
+
+  BlockReadPlan() : Built(false) {}
+
+  /// remove all requests
+  void Clear();
+
+  /// add a request for count elements of elemSize bytes starting at start
+  /// in variable var. returns the id of the request, requests are numbered
+  /// in the order that they are added.
+  int Add(int var, unsigned long long start, unsigned long long count,
+    int elemSize);
+
+  /// the number of requests
+  int GetNumberOfRequests() const { return this->Requests.size(); }
+
+  /// the number of reads after merging
+  int GetNumberOfReads() const { return this->Reads.size(); }
+
+  /// true if the plan holds exactly the requests given. this lets callers
+  /// decide if a cached plan may be reused.
+  bool Matches(const std::vector<int> &var,
+    const std::vector<unsigned long long> &start,
+    const std::vector<unsigned long long> &count) const;
+
+  /// merge the requests. called automatically by Execute
+  void Build();
+
+  /// issue the reads. dests holds the destination of each request in
+  /// request id order.
+  int Execute(const std::vector<void*> &dests, const ReadFunction &read,
+    const SyncFunction &sync);
+
+private:
+  struct Request
+  {
+    int Var;
+    unsigned long long Start;
+    unsigned long long Count;
+    int ElemSize;
+  };
+
+  struct Read
+  {
+    int Var;
+    unsigned long long Start;
+    unsigned long long Count;
+    int ElemSize;
+    int First;  // the range of requests in Order served by this read
+    int Last;
+  };
+
+  std::vector<Request> Requests;
+  std::vector<Read> Reads;
+  std::vector<int> Order;
+  bool Built;
+};
+
+}
+
+#endif
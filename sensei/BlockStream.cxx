@@ -0,0 +1,173 @@
+#include "BlockStream.h"
+#include "DataAdaptor.h"
+#include "InTransitDataAdaptor.h"
+#include "VTKUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCompositeDataSet.h>
+
+#include <algorithm>
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+BlockStream::BlockStream() : Comm(MPI_COMM_WORLD), BatchSize(0)
+{
+}
+
+// --------------------------------------------------------------------------
+int BlockStream::GetLocalBlockIds(const MeshMetadataPtr &md,
+  std::vector<int> &ids)
+{
+  ids.clear();
+
+  if (!md->Flags.BlockDecompSet())
+    {
+    SENSEI_ERROR("The block decomposition of mesh \"" << md->MeshName
+      << "\" is required")
+    return -1;
+    }
+
+  // with the global view only the blocks owned by this rank are local
+  bool globalView = (md->BlockOwner.size() ==
+    static_cast<unsigned int>(md->NumBlocks)) && (md->NumBlocks > 0);
+
+  int rank = 0;
+  MPI_Comm_rank(this->Comm, &rank);
+
+  unsigned int nBlocks = md->BlockIds.size();
+  for (unsigned int i = 0; i < nBlocks; ++i)
+    {
+    if (!globalView || (md->BlockOwner[i] == rank))
+      ids.push_back(md->BlockIds[i]);
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int BlockStream::AddArrays(DataAdaptor *data, const MeshMetadataPtr &md,
+  vtkCompositeDataSet *batch, const ArrayMap &arrays)
+{
+  const std::string &meshName = md->MeshName;
+
+  if ((md->NumGhostCells || VTKUtils::AMR(md)) &&
+    data->AddGhostCellsArray(batch, meshName))
+    {
+    SENSEI_ERROR("Failed to get ghost cells for mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  if (md->NumGhostNodes && data->AddGhostNodesArray(batch, meshName))
+    {
+    SENSEI_ERROR("Failed to get ghost nodes for mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  ArrayMap::const_iterator it = arrays.begin();
+  ArrayMap::const_iterator end = arrays.end();
+  for (; it != end; ++it)
+    {
+    if (data->AddArrays(batch, meshName, it->first, it->second))
+      {
+      SENSEI_ERROR("Failed to add " << VTKUtils::GetAttributesName(it->first)
+        << " data arrays to mesh \"" << meshName << "\"")
+      return -1;
+      }
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int BlockStream::Visit(DataAdaptor *data, const MeshMetadataPtr &md,
+  bool structureOnly, const ArrayMap &arrays, const Visitor &visitor)
+{
+  return this->VisitBlocks(data, md, structureOnly, nullptr, arrays, visitor);
+}
+
+// --------------------------------------------------------------------------
+int BlockStream::Visit(DataAdaptor *data, const MeshMetadataPtr &md,
+  bool structureOnly, const std::vector<int> &blockIds,
+  const ArrayMap &arrays, const Visitor &visitor)
+{
+  return this->VisitBlocks(data, md, structureOnly, &blockIds, arrays, visitor);
+}
+
+// --------------------------------------------------------------------------
+int BlockStream::VisitBlocks(DataAdaptor *data, const MeshMetadataPtr &md,
+  bool structureOnly, const std::vector<int> *blockIds,
+  const ArrayMap &arrays, const Visitor &visitor)
+{
+  TimeEvent<128> mark("BlockStream::VisitBlocks");
+
+  const std::string &meshName = md->MeshName;
+
+  // in transit the blocks arrive together, and AMR blocks are not
+  // addressed by global id. these are visited in one batch
+  bool wholeMesh = VTKUtils::AMR(md) || dynamic_cast<InTransitDataAdaptor*>(data);
+
+  if (!this->Streaming() || wholeMesh)
+    {
+    vtkCompositeDataSet *mesh = nullptr;
+    if ((blockIds && !wholeMesh) ?
+      data->GetMesh(meshName, structureOnly, *blockIds, mesh) :
+      data->GetMesh(meshName, structureOnly, mesh))
+      {
+      SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    int ierr = this->AddArrays(data, md, mesh, arrays) || visitor(mesh);
+
+    mesh->Delete();
+
+    return ierr ? -1 : 0;
+    }
+
+  std::vector<int> localIds;
+  if (!blockIds)
+    {
+    if (this->GetLocalBlockIds(md, localIds))
+      return -1;
+    blockIds = &localIds;
+    }
+
+  // all ranks make the same number of passes
+  long nLocal = blockIds->size();
+  long nBatches = (nLocal + this->BatchSize - 1) / this->BatchSize;
+
+  MPI_Allreduce(MPI_IN_PLACE, &nBatches, 1, MPI_LONG, MPI_MAX, this->Comm);
+
+  // errors are reported but processing continues so that ranks make the
+  // same number of calls
+  int ierr = 0;
+  for (long i = 0; i < nBatches; ++i)
+    {
+    long first = std::min(nLocal, i*this->BatchSize);
+    long last = std::min(nLocal, first + this->BatchSize);
+
+    std::vector<int> batchIds(blockIds->begin() + first,
+      blockIds->begin() + last);
+
+    vtkCompositeDataSet *batch = nullptr;
+    if (data->GetMesh(meshName, structureOnly, batchIds, batch))
+      {
+      SENSEI_ERROR("Failed to get blocks " << first << " to " << last
+        << " of mesh \"" << meshName << "\"")
+      ierr = -1;
+      continue;
+      }
+
+    if (this->AddArrays(data, md, batch, arrays) || visitor(batch))
+      ierr = -1;
+
+    batch->Delete();
+    }
+
+  return ierr;
+}
+
+}
@@ -0,0 +1,102 @@
+#ifndef sensei_BlockStream_h
+#define sensei_BlockStream_h
+
+#include "MeshMetadata.h"
+
+#include <mpi.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+class vtkCompositeDataSet;
+
+namespace sensei
+{
+
+class DataAdaptor;
+
+/// @class BlockStream
+/// @brief fetches the local blocks of a mesh in batches.
+///
+/// An analysis that fetches the whole local mesh and all of the arrays it
+/// needs at once holds a copy of the rank's data for the duration of the
+/// analysis. On ranks with little memory to spare this leads to out of
+/// memory errors. An analysis that can process blocks independently may
+/// instead visit them in batches. Each batch is fetched with the subset
+/// GetMesh, the ghost and requested arrays are added, the visitor is
+/// called, and the batch is released before the next is fetched. The peak
+/// memory used is then that of a batch.
+///
+/// Memory is bounded only when the data adaptor constructs the requested
+/// blocks on demand, see DataAdaptor::GetMesh with block ids. In transit
+/// data adaptors and AMR meshes are visited in a single batch.
+///
+/// Visit is collective over the communicator. Every rank calls the
+/// visitor the same number of times, with an empty batch once its blocks
+/// are exhausted, so that data adaptors whose GetMesh is collective are
+/// supported.
+class BlockStream
+{
+public:
+  BlockStream();
+
+  void SetCommunicator(MPI_Comm comm) { this->Comm = comm; }
+  MPI_Comm GetCommunicator() const { return this->Comm; }
+
+  /// Set the number of blocks fetched at a time. A value less than 1,
+  /// the default, fetches all of the local blocks at once.
+  void SetBatchSize(int n) { this->BatchSize = n; }
+  int GetBatchSize() const { return this->BatchSize; }
+
+  /// returns true if blocks are fetched in batches
+  bool Streaming() const { return this->BatchSize > 0; }
+
+  /// the arrays to add to each batch, by association
+  using ArrayMap = std::map<int, std::vector<std::string>>;
+
+  /// called on each batch. The batch is released after the call returns,
+  /// the visitor must take a reference to anything it keeps. Returns zero
+  /// if successful.
+  using Visitor = std::function<int(vtkCompositeDataSet *batch)>;
+
+  /// @brief Visit the local blocks of a mesh in batches.
+  ///
+  /// @param[in] data the data adaptor providing the mesh
+  /// @param[in] md the mesh's metadata, the local or global view, with the
+  ///               block decomposition
+  /// @param[in] structureOnly passed to GetMesh
+  /// @param[in] arrays the arrays to add to each batch
+  /// @param[in] visitor called once per batch
+  /// @returns zero if successful
+  int Visit(DataAdaptor *data, const MeshMetadataPtr &md,
+    bool structureOnly, const ArrayMap &arrays, const Visitor &visitor);
+
+  /// @brief Visit a subset of the local blocks of a mesh in batches.
+  ///
+  /// As above, only the blocks with the listed global ids are visited. In
+  /// transit and for AMR meshes the whole mesh is visited.
+  int Visit(DataAdaptor *data, const MeshMetadataPtr &md,
+    bool structureOnly, const std::vector<int> &blockIds,
+    const ArrayMap &arrays, const Visitor &visitor);
+
+  /// get the global ids of the blocks of the mesh local to this rank
+  int GetLocalBlockIds(const MeshMetadataPtr &md, std::vector<int> &ids);
+
+private:
+  // visit the listed blocks, or all local blocks when blockIds is null
+  int VisitBlocks(DataAdaptor *data, const MeshMetadataPtr &md,
+    bool structureOnly, const std::vector<int> *blockIds,
+    const ArrayMap &arrays, const Visitor &visitor);
+
+  // add the ghost arrays and the requested arrays to a batch
+  int AddArrays(DataAdaptor *data, const MeshMetadataPtr &md,
+    vtkCompositeDataSet *batch, const ArrayMap &arrays);
+
+  MPI_Comm Comm;
+  int BatchSize;
+};
+
+}
+
+#endif
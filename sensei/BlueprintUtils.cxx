@@ -0,0 +1,620 @@
+#include "BlueprintUtils.h"
+#include "DataAdaptor.h"
+#include "Error.h"
+#include "VTKUtils.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataArray.h>
+#include <vtkDataSet.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkImageData.h>
+#include <vtkRectilinearGrid.h>
+#include <vtkStructuredGrid.h>
+#include <vtkUnstructuredGrid.h>
+#include <vtkCellData.h>
+#include <vtkPointData.h>
+#include <vtkAOSDataArrayTemplate.h>
+#include <vtkSOADataArrayTemplate.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkPoints.h>
+
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+// --------------------------------------------------------------------------
+template<typename n_t> struct conduit_tt {};
+
+#define declare_conduit_tt(cpp_t, conduit_t) \
+template<> struct conduit_tt<cpp_t>          \
+{                                            \
+  using conduit_type = conduit_t;            \
+};
+
+declare_conduit_tt(char, conduit::int8);
+declare_conduit_tt(signed char, conduit::int8);
+declare_conduit_tt(unsigned char, conduit::uint8);
+declare_conduit_tt(short, conduit::int16);
+declare_conduit_tt(unsigned short, conduit::uint16);
+declare_conduit_tt(int, conduit::int32);
+declare_conduit_tt(unsigned int, conduit::uint32);
+declare_conduit_tt(long long, conduit::int64);
+declare_conduit_tt(unsigned long long, conduit::uint64);
+declare_conduit_tt(float, conduit::float32);
+declare_conduit_tt(double, conduit::float64);
+declare_conduit_tt(long double, conduit::float64);
+
+// the size of long depends on the platform. these are spelled out since
+// the commas of the template arguments would split the macro's arguments
+template<> struct conduit_tt<long>
+{
+  using conduit_type = std::conditional<sizeof(long) == 8,
+    conduit::int64, conduit::int32>::type;
+};
+
+template<> struct conduit_tt<unsigned long>
+{
+  using conduit_type = std::conditional<sizeof(long) == 8,
+    conduit::uint64, conduit::uint32>::type;
+};
+
+//------------------------------------------------------------------------------
+void GetShape(std::string &shape, int type)
+{
+  if(type == 1) shape = "point";
+  else if(type == 2) shape = "line";
+  else if(type == 3) shape = "tri";
+  else if(type == 4) shape = "quad";
+  else if(type == 8) shape = "hex";
+  else SENSEI_ERROR("Error: Unsupported element shape");
+}
+
+//------------------------------------------------------------------------------
+// point the node at the array's values without copying. each component of
+// a multi-component array is a child named by compNames, components of AOS
+// arrays are described with a stride. returns -1 if the array's layout
+// can't be described.
+template<typename T>
+int PassArrayExternal(vtkDataArray *da, conduit::Node &values,
+  const char **compNames)
+{
+  using conduit_t = typename conduit_tt<T>::conduit_type;
+  static_assert(sizeof(conduit_t) == sizeof(T), "conduit type size mismatch");
+
+  long nElem = da->GetNumberOfTuples();
+  int nComps = da->GetNumberOfComponents();
+
+  if (vtkAOSDataArrayTemplate<T> *aos =
+    dynamic_cast<vtkAOSDataArrayTemplate<T>*>(da))
+  {
+    conduit_t *ptr = reinterpret_cast<conduit_t*>(aos->GetPointer(0));
+
+    if (nComps == 1)
+    {
+      values.set_external(ptr, nElem, 0, sizeof(T), sizeof(T),
+        conduit::Endianness::DEFAULT_ID);
+      return 0;
+    }
+
+    for (int j = 0; j < nComps; ++j)
+    {
+      values[compNames[j]].set_external(ptr, nElem, j*sizeof(T),
+        nComps*sizeof(T), sizeof(T), conduit::Endianness::DEFAULT_ID);
+    }
+    return 0;
+  }
+
+  if (vtkSOADataArrayTemplate<T> *soa =
+    dynamic_cast<vtkSOADataArrayTemplate<T>*>(da))
+  {
+    for (int j = 0; j < nComps; ++j)
+    {
+      conduit_t *ptr =
+        reinterpret_cast<conduit_t*>(soa->GetComponentArrayPointer(j));
+
+      conduit::Node &comp = nComps == 1 ? values : values[compNames[j]];
+      comp.set_external(ptr, nElem, 0, sizeof(T), sizeof(T),
+        conduit::Endianness::DEFAULT_ID);
+    }
+    return 0;
+  }
+
+  return -1;
+}
+
+//------------------------------------------------------------------------------
+// pass the array's values, without copying when the layout allows
+void PassArray(vtkDataArray *da, conduit::Node &values, const char **compNames)
+{
+  int ierr = -1;
+  switch (da->GetDataType())
+  {
+    vtkTemplateMacro(
+      ierr = PassArrayExternal<VTK_TT>(da, values, compNames);
+      );
+  }
+
+  if (ierr == 0)
+    return;
+
+  // fall back to a copy for other array implementations
+  long nElem = da->GetNumberOfTuples();
+  int nComps = da->GetNumberOfComponents();
+
+  for (int j = 0; j < nComps; ++j)
+  {
+    std::vector<conduit::float64> vals(nElem, 0.0);
+    for (long i = 0; i < nElem; ++i)
+      vals[i] = da->GetComponent(i, j);
+
+    conduit::Node &comp = nComps == 1 ? values : values[compNames[j]];
+    comp.set(vals);
+  }
+}
+
+}
+
+namespace sensei
+{
+
+namespace BlueprintUtils
+{
+
+//------------------------------------------------------------------------------
+int PassGhostsZones(vtkDataSet* ds, conduit::Node& node)
+{
+  // Check if the mesh has ghost zone data.
+  if( ds->HasAnyGhostCells() || ds->HasAnyGhostPoints() )
+  {
+    // If so, add the data for Acsent.
+    node["fields/ascent_ghosts/association"] = "element";
+    node["fields/ascent_ghosts/topology"] = "mesh";
+    node["fields/ascent_ghosts/type"] = "scalar";
+
+    vtkUnsignedCharArray *gc = vtkUnsignedCharArray::SafeDownCast(ds->GetCellData()->GetArray("vtkGhostType"));
+    unsigned char *gcp = (unsigned char *)gc->GetVoidPointer( 0 );
+    auto size = gc->GetSize();
+
+    // In Acsent, 0 means real data, 1 means ghost data, and 2 or greater means garbage data.
+    std::vector<conduit::int32> ghost_flags(size);
+
+    // Ascent needs int32 not unsigned char. I don't know why, that is the way.
+    for(vtkIdType i=0; i < size ;++i)
+    {
+        ghost_flags[i] = gcp[i];
+    }
+    node["fields/ascent_ghosts/values"].set(ghost_flags);
+  }
+
+  return 0;
+}
+
+/* TODO look at
+int PassFields(vtkDataSetAttributes *dsa, int centering, conduit::Node &node)
+{
+  int nArrays = dsa->GetNumberOfArrays();
+  for (int i = 0; i < nArrays; ++i)
+  {
+    vtkDataArray *da = dsa->GetArray(i);
+    const char *name = da->GetName();
+    long nElem = da->GetNumberOfTuples();
+    int nComps = da->GetNumberOfComponents();
+
+    std::string arrayName(name);
+
+    //nComp = 1 -> type = scalar; nComp > 1 -> type = vector
+    std::stringstream ss;
+    ss << "fields/" << arrayName << "/type";
+    std::string typePath = ss.str();
+    ss.str(std::string());
+
+    //nComp = 1
+    ss << "fields/" << arrayName << "/values";
+    std::string valPath = ss.str();
+    ss.str(std::string());
+
+    //nComp > 1
+    ss << "fields/" << arrayName << "/values/u";
+    std::string uValPath = ss.str();
+    ss.str(std::string());
+
+    ss << "fields/" << arrayName << "/values/v";
+    std::string vValPath = ss.str();
+    ss.str(std::string());
+
+    ss << "fields/" << arrayName << "/values/w";
+    std::string wValPath = ss.str();
+    ss.str(std::string());
+
+
+    switch (da->GetDataType())
+    {
+      vtkTemplateMacro(
+        vtkAOSDataArrayTemplate<VTK_TT> *aosda =
+          dynamic_cast<vtkAOSDataArrayTemplate<VTK_TT>*>(da);
+
+        vtkSOADataArrayTemplate<VTK_TT> *soada =
+          dynamic_cast<vtkSOADataArrayTemplate<VTK_TT>*>(da);
+
+        if (aosda)
+        {
+          // AOS
+          //VTK_TT *ptr = aosda->GetPointer(0);
+
+          // TODO -- Have to set the u v w separately -- like below
+          // Not sure how to do that with zero copy
+          // Original code copied the data into three separate vectors
+          //node[valPath].set_external(ptr, nElem);
+          //node[uValPath].set_external(ptr, nElem);
+          //node[vValPath].set_external(ptr, nElem);
+          //node[wValPath].set_external(ptr, nElem);
+        }
+        else if (soada)
+        {
+          // SOA
+          for (int j = 0; j < nComps; ++j)
+          {
+            VTK_TT *ptr = soada->GetComponentArrayPointer(j);
+            if(nComps == 1)
+            {
+              node[valPath].set_external((conduit_tt<VTK_TT>::conduit_type*)ptr, nElem, 0,
+                sizeof(VTK_TT), sizeof(VTK_TT), conduit::Endianness::DEFAULT_ID);
+              node[typePath] = "scalar";
+            }
+            else
+            {
+              switch(j)
+              {
+                 case 0: node[uValPath].set_external((conduit_tt<VTK_TT>::conduit_type*)ptr, nElem, 0,
+                           sizeof(VTK_TT), sizeof(VTK_TT), conduit::Endianness::DEFAULT_ID);
+                         node[typePath] = "vector";
+                         break;
+                 case 1: node[vValPath].set_external((conduit_tt<VTK_TT>::conduit_type*)ptr, nElem, 0,
+                           sizeof(VTK_TT), sizeof(VTK_TT), conduit::Endianness::DEFAULT_ID);
+                         break;
+                 case 2: node[wValPath].set_external((conduit_tt<VTK_TT>::conduit_type*)ptr, nElem, 0,
+                           sizeof(VTK_TT), sizeof(VTK_TT), conduit::Endianness::DEFAULT_ID);
+                         break;
+
+              }
+            }
+          }
+        }
+        else
+        {
+          // this should never happen
+          SENSEI_ERROR("Invalid array type \"" << da->GetClassName() << "\" at " << i);
+        }
+        );
+      default:
+        SENSEI_ERROR("Invalid type from " << VTKUtils::GetAttributesName(centering)
+          << " data array " << i << " named \"" << (name ? name : "") << "\"");
+    }
+  }
+
+  return( 0 );
+}
+
+int PassFields(int bid, vtkDataSet *ds, conduit::Node &node)
+{
+  // handle the arrays
+  if (PassFields(ds->GetPointData(), vtkDataObject::POINT, node))
+  {
+    SENSEI_ERROR("Failed to transfer point data from block " << bid);
+    return( -1 );
+  }
+
+  if (PassFields(ds->GetCellData(), vtkDataObject::CELL, node))
+  {
+    SENSEI_ERROR("Failed to transfer cell data from block " << bid);
+    return( -1 );
+  }
+
+  return( 0 );
+}
+*/
+
+// **************************************************************************
+int PassFields(vtkDataSet* ds, conduit::Node& node,
+  const std::string &arrayName, int arrayCen)
+{
+  std::stringstream ss;
+  ss << "fields/" << arrayName << "/association";
+  std::string assocPath = ss.str();
+  ss.str(std::string());
+
+  //ss << "fields/" << arrayName << "/volume_dependent";
+  //std::string volPath = ss.str();
+  //ss.str(std::string());
+
+  ss << "fields/" << arrayName << "/topology";
+  std::string topoPath = ss.str();
+  ss.str(std::string());
+
+  ss << "fields/" << arrayName << "/type";
+  std::string typePath = ss.str();
+  ss.str(std::string());
+
+  ss << "fields/" << arrayName << "/values";
+  std::string valPath = ss.str();
+  ss.str(std::string());
+
+  //ss << "fields/" << arrayName << "/grid_function";
+  //std::string gridPath = ss.str();
+  //ss.str(std::string());
+
+  //ss << "fields/" << arrayName << "/matset";
+  //std::string matPath = ss.str();
+  //ss.str(std::string());
+
+  //ss << "fields/" << arrayName << "/matset_values";
+  //std::string matValPath = ss.str();
+  //ss.str(std::string());
+
+
+  // tell ascent the centering
+  vtkDataSetAttributes *atts = ds->GetAttributes(arrayCen);
+  vtkDataArray *da = atts->GetArray(arrayName.c_str());
+  std::string cenType;
+  if (arrayCen == vtkDataObject::POINT)
+  {
+    cenType = "vertex";
+  }
+  else if (arrayCen == vtkDataObject::CELL)
+  {
+    cenType = "element";
+  }
+  else
+  {
+    SENSEI_ERROR("Invlaid centering " << arrayCen)
+    return -1;
+  }
+  node[assocPath] = cenType;
+
+  int components = da->GetNumberOfComponents();
+  if (components > 3)
+  {
+    SENSEI_ERROR("Too many components (" << components << ") associated with " << arrayName);
+    return -1;
+  }
+
+  node[typePath] = components == 1 ? "scalar" : "vector";
+
+  const char *compNames[] = {"u", "v", "w"};
+  PassArray(da, node[valPath], compNames);
+
+  // tell ascent which topology the array belongs to
+  node[topoPath] = "mesh";
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+int PassTopology(vtkDataSet* ds, conduit::Node& node)
+{
+  vtkImageData *uniform             = vtkImageData::SafeDownCast(ds);
+  vtkRectilinearGrid *rectilinear   = vtkRectilinearGrid::SafeDownCast(ds);
+  vtkStructuredGrid *structured     = vtkStructuredGrid::SafeDownCast(ds);
+  vtkUnstructuredGrid *unstructured = vtkUnstructuredGrid::SafeDownCast(ds);
+
+  if(uniform != nullptr)
+  {
+    node["topologies/mesh/type"]     = "uniform";
+    node["topologies/mesh/coordset"] = "coords";
+
+    int dims[3] = {0, 0, 0};
+    uniform->GetDimensions(dims);
+
+    double origin[3] = {0.0, 0.0, 0.0};
+    uniform->GetOrigin(origin);
+
+    int extents[6] = {0, 0, 0, 0, 0, 0};
+    uniform->GetExtent(extents);
+
+    double spacing[3] = {0.0, 0.0, 0.0};
+    uniform->GetSpacing(spacing);
+
+    node["topologies/mesh/elements/origin/i0"] = origin[0] + (extents[0] * spacing[0]);
+    node["topologies/mesh/elements/origin/j0"] = origin[1] + (extents[2] * spacing[1]);
+    if(dims[2] != 0 && dims[2] != 1)
+      node["topologies/mesh/elements/origin/k0"] = origin[2] + (extents[4] * spacing[2]);
+  }
+  else if(rectilinear != nullptr)
+  {
+    node["topologies/mesh/type"]     = "rectilinear";
+    node["topologies/mesh/coordset"] = "coords";
+
+  }
+  else if(structured != nullptr)
+  {
+    node["topologies/mesh/type"]     = "structured";
+    node["topologies/mesh/coordset"] = "coords";
+
+    int dims[3] = {0, 0, 0};
+    structured->GetDimensions(dims);
+
+    node["topologies/mesh/elements/dims/i"] = dims[0] - 1;
+    node["topologies/mesh/elements/dims/j"] = dims[1] - 1;
+    if(dims[2] != 0 && dims[2] != 1)
+      node["topologies/mesh/elements/dims/k"] = dims[2] - 1;
+  }
+  else if(unstructured != nullptr)
+  {
+    if(!unstructured->IsHomogeneous())
+    {
+      SENSEI_ERROR("Unstructured cells must be homogenous");
+      return( -1 );
+    }
+    node["topologies/mesh/type"]     = "unstructured";
+    node["topologies/mesh/coordset"] = "coords";
+
+    vtkCellArray* cellarray = unstructured->GetCells();
+    vtkIdType *ptr = cellarray->GetPointer();
+
+    std::string shape;
+    GetShape(shape, ptr[0]);
+    node["topologies/mesh/elements/shape"] = shape;
+
+    int ncells = unstructured->GetNumberOfCells();
+    int connections = ncells*(ptr[0] + 1);
+    std::vector<int> data(ncells*ptr[0], 0);
+
+    int count = 0;
+    for(int i = 0; i < connections; ++i)
+    {
+      int offset = ptr[0] + 1;
+      if(i%offset == 0)
+        continue;
+      else
+      {
+        data[count] = ptr[i];
+        count++;
+      }
+    }
+    node["topologies/mesh/elements/connectivity"].set(data);
+  }
+  else
+  {
+    SENSEI_ERROR("Mesh structure not supported");
+    return( -1 );
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+int PassState(vtkDataSet *, conduit::Node& node, sensei::DataAdaptor *dataAdaptor)
+{
+    node["state/time"] = dataAdaptor->GetDataTime();
+    node["state/cycle"] = (int)dataAdaptor->GetDataTimeStep();
+    return  0;
+}
+
+//------------------------------------------------------------------------------
+int PassCoordsets(vtkDataSet* ds, conduit::Node& node)
+{
+  vtkImageData *uniform             = vtkImageData::SafeDownCast(ds);
+  vtkRectilinearGrid *rectilinear   = vtkRectilinearGrid::SafeDownCast(ds);
+  vtkStructuredGrid *structured     = vtkStructuredGrid::SafeDownCast(ds);
+  vtkUnstructuredGrid *unstructured = vtkUnstructuredGrid::SafeDownCast(ds);
+
+  if(uniform != nullptr)
+  {
+    node["coordsets/coords/type"] = "uniform";
+
+    //Local Dimensions
+    int dims[3] = {0,0,0};
+    uniform->GetDimensions(dims);
+    node["coordsets/coords/dims/i"] = dims[0];
+    node["coordsets/coords/dims/j"] = dims[1];
+    node["coordsets/coords/dims/k"] = dims[2];
+
+    //Global Origin
+    double origin[3] = {0.0, 0.0, 0.0};
+    uniform->GetOrigin(origin);
+
+    int extents[6] = {0, 0, 0, 0, 0, 0};
+    uniform->GetExtent(extents);
+
+    double spacing[3] = {0.0, 0.0, 0.0};
+    uniform->GetSpacing(spacing);
+
+    node["coordsets/coords/origin/x"] = origin[0] + (extents[0] * spacing[0]);
+    node["coordsets/coords/origin/y"] = origin[1] + (extents[2] * spacing[1]);
+    node["coordsets/coords/origin/z"] = origin[2] + (extents[4] * spacing[2]);
+
+    //Global Spacing == Local Spacing
+    node["coordsets/coords/spacing/dx"] = spacing[0];
+    node["coordsets/coords/spacing/dy"] = spacing[1];
+    node["coordsets/coords/spacing/dz"] = spacing[2];
+  }
+  else if(rectilinear != nullptr)
+  {
+    node["coordsets/coords/type"] = "rectilinear";
+
+    int dims[3] = {0, 0, 0};
+    rectilinear->GetDimensions(dims);
+
+    vtkDataArray *x = rectilinear->GetXCoordinates();
+    vtkDataArray *y = rectilinear->GetYCoordinates();
+    vtkDataArray *z = rectilinear->GetZCoordinates();
+
+    if (!x || !y || !z)
+    {
+      SENSEI_ERROR("Invalid coordinate arrays in rectilinear");
+      return( -1 );
+    }
+
+    PassArray(x, node["coordsets/coords/values/x"], nullptr);
+    PassArray(y, node["coordsets/coords/values/y"], nullptr);
+    if (z->GetNumberOfTuples() > 1)
+      PassArray(z, node["coordsets/coords/values/z"], nullptr);
+  }
+  else if(structured != nullptr)
+  {
+    node["coordsets/coords/type"] = "explicit";
+
+    int dims[3] = {0, 0, 0};
+    structured->GetDimensions(dims);
+
+    const char *compNames[] = {"x", "y", "z"};
+    conduit::Node &values = node["coordsets/coords/values"];
+    PassArray(structured->GetPoints()->GetData(), values, compNames);
+    if(dims[2] == 0 || dims[2] == 1)
+      values.remove("z");
+  }
+  else if(unstructured != nullptr)
+  {
+    node["coordsets/coords/type"] = "explicit";
+
+    const char *compNames[] = {"x", "y", "z"};
+    PassArray(unstructured->GetPoints()->GetData(),
+      node["coordsets/coords/values"], compNames);
+  }
+  else
+  {
+    SENSEI_ERROR("Mesh type not supported");
+    return -1;
+  }
+
+  return 0;
+}
+
+// **************************************************************************
+// when meshCache is not null the mesh is static. the coordset and topology
+// are converted once, kept in the cache, and referenced on later steps.
+int PassData(vtkDataSet* ds, conduit::Node& node,
+  const std::string &arrayName, int arrayCen, sensei::DataAdaptor *dataAdaptor,
+  conduit::Node *meshCache)
+{
+    // FIXME -- do error checking on all these and report any errors
+    PassState(ds, node, dataAdaptor);
+    if (meshCache && meshCache->has_child("coordsets"))
+    {
+      node["coordsets"].set_external((*meshCache)["coordsets"]);
+      node["topologies"].set_external((*meshCache)["topologies"]);
+    }
+    else
+    {
+      PassCoordsets(ds, node);
+      PassTopology(ds, node);
+
+      // the cache keeps a copy since the simulation's arrays may not
+      // outlive the step
+      if (meshCache)
+      {
+        (*meshCache)["coordsets"].set(node["coordsets"]);
+        (*meshCache)["topologies"].set(node["topologies"]);
+      }
+    }
+    PassFields(ds, node, arrayName, arrayCen);
+    PassGhostsZones(ds, node);
+    return 0;
+}
+
+}
+
+}
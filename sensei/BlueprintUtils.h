@@ -0,0 +1,54 @@
+#ifndef sensei_BlueprintUtils_h
+#define sensei_BlueprintUtils_h
+
+#include <conduit.hpp>
+#include <string>
+
+class vtkDataSet;
+
+namespace sensei
+{
+
+class DataAdaptor;
+
+/// Conversion of VTK datasets to Conduit Blueprint meshes. Arrays are
+/// passed without copying when their layout can be described by Conduit,
+/// hence the tree is only valid while the dataset is. These are shared by
+/// the analysis adaptors that hand Blueprint to an in situ library.
+namespace BlueprintUtils
+{
+
+// add the dataset's ghost cells as the element field ascent_ghosts, with
+// ascent's convention that ghosts are non-zero. returns zero if successful.
+int PassGhostsZones(vtkDataSet* ds, conduit::Node& node);
+
+// add the named array to the fields of the node. arrayCen is the VTK
+// association of the array, and the field refers to the topology named
+// mesh. returns zero if successful.
+int PassFields(vtkDataSet* ds, conduit::Node& node,
+  const std::string &arrayName, int arrayCen);
+
+// add the topology of the dataset, named mesh. returns zero if successful.
+int PassTopology(vtkDataSet* ds, conduit::Node& node);
+
+// add the time and cycle of the current step. returns zero if successful.
+int PassState(vtkDataSet *ds, conduit::Node& node,
+  sensei::DataAdaptor *dataAdaptor);
+
+// add the coordinates of the dataset, named coords. returns zero if
+// successful.
+int PassCoordsets(vtkDataSet* ds, conduit::Node& node);
+
+// convert the dataset, with a single array and its ghost zones, to a
+// Blueprint domain. when meshCache is not null the mesh is static. the
+// coordset and topology are converted once, kept in the cache, and
+// referenced on later steps. returns zero if successful.
+int PassData(vtkDataSet* ds, conduit::Node& node,
+  const std::string &arrayName, int arrayCen, sensei::DataAdaptor *dataAdaptor,
+  conduit::Node *meshCache);
+
+}
+
+}
+
+#endif
@@ -0,0 +1,324 @@
+#include "senseiConfig.h"
+#include "BufferPool.h"
+#include "MemoryGovernor.h"
+#include "Error.h"
+
+#include <vtkDataArray.h>
+#include <vtkVersionMacros.h>
+#if defined(ENABLE_VTK_GENERIC_ARRAYS) && ((VTK_VERSION_MAJOR > 8) || \
+  ((VTK_VERSION_MAJOR == 8) && (VTK_VERSION_MINOR >= 1)))
+#include <vtkAOSDataArrayTemplate.h>
+#define SENSEI_POOLED_VTK_ARRAYS
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+// the smallest size class, and the number of classes per power of two
+constexpr size_t minClassBytes = 256;
+constexpr int classesPerOctave = 4;
+
+// buffers are aligned to this, the header is placed just before the buffer
+constexpr size_t alignment = 64;
+
+// get the size class of a request. above the smallest class the requests
+// are rounded up to a multiple of a quarter of the power of two below
+int sizeClass(size_t nBytes)
+{
+  if (nBytes <= minClassBytes)
+    return 0;
+
+  int e = 0;
+  for (size_t n = nBytes - 1; n > 1; n >>= 1)
+    ++e;
+
+  size_t step = size_t(1) << (e - 2);
+  size_t m = (nBytes + step - 1)/step;
+
+  return 1 + (e - 8)*classesPerOctave + int(m - 5);
+}
+
+// get the bytes in buffers of a size class
+size_t classBytes(int cls)
+{
+  if (cls == 0)
+    return minClassBytes;
+
+  int e = 8 + (cls - 1)/classesPerOctave;
+  size_t m = 5 + (cls - 1)%classesPerOctave;
+
+  return m << (e - 2);
+}
+
+// get the NUMA node the calling thread is running on
+int currentNode()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned int cpu = 0;
+  unsigned int node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+    return node;
+#endif
+  return 0;
+}
+}
+
+namespace sensei
+{
+
+// placed before each buffer, padded to keep the buffer aligned
+struct BufferPool::Header
+{
+  BufferPool *Pool;
+  int SizeClass;
+  int Node;
+  char Pad[alignment - sizeof(BufferPool*) - 2*sizeof(int)];
+};
+
+// --------------------------------------------------------------------------
+BufferPool &BufferPool::GetGlobalPool()
+{
+  // the pool is never destroyed so that arrays released during exit
+  // can still return their buffers
+  static BufferPool *pool = nullptr;
+
+  // the kept buffers are the first memory given back when the in situ
+  // memory budget runs short
+  static std::once_flag once;
+  std::call_once(once, []()
+    {
+    pool = new BufferPool;
+    MemoryGovernor::GetGlobalGovernor().Register("BufferPool",
+      MemoryGovernor::POLICY_DEGRADE, [](long long nBytes) -> long long
+      {
+      return pool->Trim(nBytes);
+      });
+    });
+
+  return *pool;
+}
+
+// --------------------------------------------------------------------------
+BufferPool::BufferPool() : MaxCachedBytes(size_t(1) << 30)
+{
+}
+
+// --------------------------------------------------------------------------
+BufferPool::~BufferPool()
+{
+  this->Clear();
+}
+
+// --------------------------------------------------------------------------
+void BufferPool::SetMaxCachedBytes(size_t nBytes)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->MaxCachedBytes = nBytes;
+}
+
+// --------------------------------------------------------------------------
+size_t BufferPool::GetMaxCachedBytes() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->MaxCachedBytes;
+}
+
+// --------------------------------------------------------------------------
+size_t BufferPool::GetCachedBytes() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  size_t nBytes = 0;
+  size_t nNodes = this->Nodes.size();
+  for (size_t i = 0; i < nNodes; ++i)
+    nBytes += this->Nodes[i].CachedBytes;
+
+  return nBytes;
+}
+
+// --------------------------------------------------------------------------
+void BufferPool::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  size_t nNodes = this->Nodes.size();
+  for (size_t i = 0; i < nNodes; ++i)
+    {
+    Node &node = this->Nodes[i];
+    size_t nClasses = node.Free.size();
+    for (size_t j = 0; j < nClasses; ++j)
+      {
+      std::vector<Header*> &bufs = node.Free[j];
+      size_t nBufs = bufs.size();
+      for (size_t k = 0; k < nBufs; ++k)
+        free(bufs[k]);
+      bufs.clear();
+      }
+    node.CachedBytes = 0;
+    }
+}
+
+// --------------------------------------------------------------------------
+size_t BufferPool::Trim(size_t nBytes)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  size_t nReleased = 0;
+  size_t nClasses = 0;
+  size_t nNodes = this->Nodes.size();
+  for (size_t i = 0; i < nNodes; ++i)
+    nClasses = std::max(nClasses, this->Nodes[i].Free.size());
+
+  for (size_t j = nClasses; (j > 0) && (nReleased < nBytes); --j)
+    {
+    size_t cls = j - 1;
+    size_t clsBytes = classBytes(cls);
+    for (size_t i = 0; (i < nNodes) && (nReleased < nBytes); ++i)
+      {
+      Node &node = this->Nodes[i];
+      if (cls >= node.Free.size())
+        continue;
+
+      std::vector<Header*> &bufs = node.Free[cls];
+      while (!bufs.empty() && (nReleased < nBytes))
+        {
+        free(bufs.back());
+        bufs.pop_back();
+        node.CachedBytes -= clsBytes;
+        nReleased += clsBytes;
+        }
+      }
+    }
+
+  return nReleased;
+}
+
+// --------------------------------------------------------------------------
+void *BufferPool::Allocate(size_t nBytes)
+{
+  static_assert(sizeof(Header) == alignment,
+    "the header must preserve the buffer alignment");
+
+  int cls = sizeClass(nBytes);
+  int nid = currentNode();
+
+  // reuse a buffer on this node
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+
+    if (size_t(nid) < this->Nodes.size())
+      {
+      Node &node = this->Nodes[nid];
+      if ((size_t(cls) < node.Free.size()) && !node.Free[cls].empty())
+        {
+        Header *header = node.Free[cls].back();
+        node.Free[cls].pop_back();
+        node.CachedBytes -= classBytes(cls);
+        return header + 1;
+        }
+      }
+    }
+
+  // make a new one. its pages are placed when first touched, usually by
+  // this thread
+  void *mem = nullptr;
+  if (posix_memalign(&mem, alignment, sizeof(Header) + classBytes(cls)))
+    {
+    SENSEI_ERROR("Failed to allocate " << classBytes(cls) << " bytes")
+    throw std::bad_alloc();
+    }
+
+  Header *header = static_cast<Header*>(mem);
+  header->Pool = this;
+  header->SizeClass = cls;
+  header->Node = nid;
+
+  return header + 1;
+}
+
+// --------------------------------------------------------------------------
+void BufferPool::Free(void *buffer)
+{
+  if (!buffer)
+    return;
+
+  Header *header = static_cast<Header*>(buffer) - 1;
+  header->Pool->Release(header);
+}
+
+// --------------------------------------------------------------------------
+void BufferPool::Release(Header *header)
+{
+  int cls = header->SizeClass;
+  size_t nBytes = classBytes(cls);
+
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+
+    if (size_t(header->Node) >= this->Nodes.size())
+      this->Nodes.resize(header->Node + 1);
+
+    Node &node = this->Nodes[header->Node];
+    if (node.CachedBytes + nBytes <= this->MaxCachedBytes)
+      {
+      if (size_t(cls) >= node.Free.size())
+        node.Free.resize(cls + 1);
+
+      node.Free[cls].push_back(header);
+      node.CachedBytes += nBytes;
+      return;
+      }
+    }
+
+  free(header);
+}
+
+// --------------------------------------------------------------------------
+vtkDataArray *BufferPool::NewDataArray(int vtkType, int nComps, long nTuples)
+{
+#if defined(SENSEI_POOLED_VTK_ARRAYS)
+  switch (vtkType)
+    {
+    vtkTemplateMacro(
+      vtkDataArray *da = vtkDataArray::CreateDataArray(vtkType);
+      vtkAOSDataArrayTemplate<VTK_TT> *aos =
+        dynamic_cast<vtkAOSDataArrayTemplate<VTK_TT>*>(da);
+      if (!aos)
+        {
+        da->SetNumberOfComponents(nComps);
+        da->SetNumberOfTuples(nTuples);
+        return da;
+        }
+
+      vtkIdType nVals = vtkIdType(nComps)*nTuples;
+      VTK_TT *vals = static_cast<VTK_TT*>(
+        BufferPool::GetGlobalPool().Allocate(nVals*sizeof(VTK_TT)));
+
+      aos->SetNumberOfComponents(nComps);
+      aos->SetArray(vals, nVals, 0,
+        vtkAbstractArray::VTK_DATA_ARRAY_USER_DEFINED);
+      aos->SetArrayFreeFunction(BufferPool::Free);
+
+      return aos;
+      );
+    }
+#endif
+
+  vtkDataArray *da = vtkDataArray::CreateDataArray(vtkType);
+  if (da)
+    {
+    da->SetNumberOfComponents(nComps);
+    da->SetNumberOfTuples(nTuples);
+    }
+  return da;
+}
+
+}
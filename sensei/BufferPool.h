@@ -0,0 +1,88 @@
+#ifndef sensei_BufferPool_h
+#define sensei_BufferPool_h
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+class vtkDataArray;
+
+namespace sensei
+{
+
+/// @class BufferPool
+/// @brief a pool of memory buffers kept for reuse across time steps.
+///
+/// Requests are rounded up to one of a set of size classes, four per power
+/// of two, and served from buffers of that class released earlier. Released
+/// buffers are kept on a list per NUMA node, the node of the thread that
+/// allocated them, and allocations are served from the list of the calling
+/// thread's node, so that reused pages stay local. At most
+/// MaxCachedBytes are kept per node, buffers released beyond that are
+/// returned to the system.
+///
+/// Arrays made by NewDataArray return their buffer to the pool when they
+/// are deleted. Readers and simulations that make arrays of the same sizes
+/// each step avoid the allocation and page faults of fresh memory.
+///
+/// All methods are thread safe.
+class BufferPool
+{
+public:
+  /// the process wide pool used by NewDataArray
+  static BufferPool &GetGlobalPool();
+
+  /// get a buffer of at least nBytes, aligned to 64 bytes
+  void *Allocate(size_t nBytes);
+
+  /// return a buffer made by Allocate to the pool it came from
+  static void Free(void *buffer);
+
+  /// set the most bytes kept per NUMA node. default 1 GiB
+  void SetMaxCachedBytes(size_t nBytes);
+  size_t GetMaxCachedBytes() const;
+
+  /// the bytes kept for reuse on all nodes
+  size_t GetCachedBytes() const;
+
+  /// return all of the kept buffers to the system
+  void Clear();
+
+  /// return kept buffers to the system, the largest first, until at
+  /// least nBytes were returned or none are left. returns the bytes
+  /// returned
+  size_t Trim(size_t nBytes);
+
+  /// make a VTK array of the given type and size with its values in a
+  /// pooled buffer. the values are not initialized. when VTK generic arrays
+  /// are not available a standard array is returned. the caller takes the
+  /// reference
+  static vtkDataArray *NewDataArray(int vtkType, int nComps, long nTuples);
+
+  BufferPool();
+  ~BufferPool();
+
+  BufferPool(const BufferPool &) = delete;
+  void operator=(const BufferPool &) = delete;
+
+private:
+  struct Header;
+
+  void Release(Header *header);
+
+  // the free buffers of one NUMA node by size class
+  struct Node
+  {
+    Node() : CachedBytes(0) {}
+    std::vector<std::vector<Header*>> Free;
+    size_t CachedBytes;
+  };
+
+  mutable std::mutex Mutex;
+  std::vector<Node> Nodes;
+  size_t MaxCachedBytes;
+};
+
+}
+
+#endif
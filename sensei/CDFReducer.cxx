@@ -1,5 +1,9 @@
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
 #include <limits>
+#include <vector>
 
 #include <vtkCommunicator.h>
 #include <vtkMultiProcessController.h>
@@ -36,6 +40,45 @@ struct Entry
 
 // ----------------------------------------------------------------------------
 
+namespace
+{
+// Map a double to an unsigned integer with the same order. -0 and +0 map to
+// the same key.
+inline uint64_t OrderedKey(double value)
+{
+  if (value == 0.0)
+  {
+    value = 0.0;
+  }
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint64_t sign = uint64_t(1) << 63;
+  return (bits & sign) ? ~bits : (bits | sign);
+}
+
+inline double OrderedValue(uint64_t key)
+{
+  const uint64_t sign = uint64_t(1) << 63;
+  uint64_t bits = (key & sign) ? (key & ~sign) : ~key;
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// the first of the sorted values whose key is not less than key
+inline const double* LowerBound(const double* first, const double* last, uint64_t key)
+{
+  return std::lower_bound(
+    first, last, key, [](double value, uint64_t k) { return OrderedKey(value) < k; });
+}
+
+// the first of the sorted values whose key is greater than key
+inline const double* UpperBound(const double* first, const double* last, uint64_t key)
+{
+  return std::upper_bound(
+    first, last, key, [](uint64_t k, double value) { return k < OrderedKey(value); });
+}
+}
 
 // ----------------------------------------------------------------------------
 
@@ -139,6 +182,102 @@ double CDFReducer::GetValueAtIndex(vtkIdType targetIdx, vtkIdType pid, vtkIdType
 
 // ----------------------------------------------------------------------------
 
+void CDFReducer::RefineValuesAtIndices(const std::vector<vtkIdType>& targetIdx, double* values)
+{
+  size_t nTargets = targetIdx.size();
+  uint64_t nBuckets = std::max<vtkIdType>(2, this->CDFSize);
+
+  const double* first = this->LocalValues;
+  const double* last = this->LocalValues + this->ArraySize;
+
+  // the interval of keys known to hold each target, and the number of
+  // values below it
+  std::vector<uint64_t> lo(nTargets, OrderedKey(this->ReducedCDF[0]));
+  std::vector<uint64_t> hi(nTargets, OrderedKey(this->ReducedCDF[this->ReducedCDFSize - 1]));
+  std::vector<vtkIdType> below(nTargets, 0);
+
+  std::vector<size_t> active;
+  std::vector<vtkIdType> localCounts;
+  std::vector<vtkIdType> globalCounts;
+
+  while (true)
+  {
+    // the decisions depend only on reduced counts, so all ranks agree on
+    // the targets that remain
+    active.clear();
+    for (size_t t = 0; t < nTargets; ++t)
+    {
+      if (lo[t] < hi[t])
+      {
+        active.push_back(t);
+      }
+    }
+
+    size_t nActive = active.size();
+    if (nActive == 0)
+    {
+      break;
+    }
+
+    this->ExecutionCount++;
+
+    // count the local values in each bucket
+    localCounts.assign(nActive * nBuckets, 0);
+    for (size_t a = 0; a < nActive; ++a)
+    {
+      size_t t = active[a];
+      uint64_t width = (hi[t] - lo[t]) / nBuckets + 1;
+      uint64_t nb = (hi[t] - lo[t]) / width + 1;
+
+      vtkIdType* counts = localCounts.data() + a * nBuckets;
+      const double* pos = LowerBound(first, last, lo[t]);
+      for (uint64_t j = 0; j < nb; ++j)
+      {
+        const double* next = (j + 1 < nb) ? LowerBound(pos, last, lo[t] + (j + 1) * width)
+                                          : UpperBound(pos, last, hi[t]);
+        counts[j] = next - pos;
+        pos = next;
+      }
+    }
+
+    globalCounts.resize(localCounts.size());
+    this->Controller->AllReduce(localCounts.data(), globalCounts.data(),
+      static_cast<vtkIdType>(localCounts.size()), vtkCommunicator::SUM_OP);
+
+    // narrow each interval to the bucket holding the target
+    for (size_t a = 0; a < nActive; ++a)
+    {
+      size_t t = active[a];
+      uint64_t width = (hi[t] - lo[t]) / nBuckets + 1;
+      uint64_t nb = (hi[t] - lo[t]) / width + 1;
+
+      const vtkIdType* counts = globalCounts.data() + a * nBuckets;
+      vtkIdType count = below[t];
+      uint64_t j = 0;
+      while ((j + 1 < nb) && (count + counts[j] <= targetIdx[t]))
+      {
+        count += counts[j];
+        ++j;
+      }
+
+      uint64_t start = lo[t] + j * width;
+      if (j + 1 < nb)
+      {
+        hi[t] = start + width - 1;
+      }
+      lo[t] = start;
+      below[t] = count;
+    }
+  }
+
+  for (size_t t = 0; t < nTargets; ++t)
+  {
+    values[t] = OrderedValue(lo[t]);
+  }
+}
+
+// ----------------------------------------------------------------------------
+
 double* CDFReducer::Compute(double* localSortedValues,
                             vtkIdType localArraySize,
                             vtkIdType outputCDFSize)
@@ -176,11 +315,13 @@ double* CDFReducer::Compute(double* localSortedValues,
   }
   this->ReducedCDFSize = outputCDFSize;
 
-  // Share basic information (min, max, counts)
+  // Share basic information (min, max, counts). ranks without values take part
+  double localMin = localArraySize ? this->LocalValues[0] : std::numeric_limits<double>::max();
+  double localMax =
+    localArraySize ? this->LocalValues[localArraySize - 1] : std::numeric_limits<double>::lowest();
   double globalMin, globalMax;
-  this->Controller->AllReduce(&this->LocalValues[0], &globalMin, 1, vtkCommunicator::MIN_OP);
-  this->Controller->AllReduce(
-    &this->LocalValues[localArraySize - 1], &globalMax, 1, vtkCommunicator::MAX_OP);
+  this->Controller->AllReduce(&localMin, &globalMin, 1, vtkCommunicator::MIN_OP);
+  this->Controller->AllReduce(&localMax, &globalMax, 1, vtkCommunicator::MAX_OP);
   this->Controller->AllReduce(&localArraySize, &this->TotalCount, 1, vtkCommunicator::SUM_OP);
 
   this->ReducedCDF[0] = globalMin;
@@ -189,6 +330,30 @@ double* CDFReducer::Compute(double* localSortedValues,
   // Look for indexes we will search value for
   vtkIdType splitSize = outputCDFSize - 1;
 
+  if (this->Method == METHOD_REFINE)
+  {
+    if (this->TotalCount == 0 || splitSize < 2)
+    {
+      return this->ReducedCDF;
+    }
+
+    // the value at position i * TotalCount / splitSize in sorted order
+    std::vector<vtkIdType> targets(splitSize - 1);
+    for (vtkIdType i = 1; i < splitSize; i++)
+    {
+      targets[i - 1] = std::min(i * this->TotalCount / splitSize, this->TotalCount - 1);
+    }
+
+    this->ExecutionCount = 0;
+    this->RefineValuesAtIndices(targets, this->ReducedCDF + 1);
+    if (this->Verbose && (MPI_ID == 0))
+    {
+      std::cout << "Refinement rounds: " << this->ExecutionCount << std::endl;
+    }
+
+    return this->ReducedCDF;
+  }
+
   // Proper init
   this->Handler.Init(this->CDFOffsets, MPI_SIZE, this->CDFSize);
 
@@ -21,6 +21,8 @@
 #ifndef CDFReducer_h
 #define CDFReducer_h
 
+#include <vector>
+
 class vtkMultiProcessController;
 
 struct StepHandler
@@ -124,8 +126,26 @@ struct StepHandler
 class CDFReducer
 {
 public:
+  // How the quantiles are located.
+  //
+  // METHOD_GATHER gathers samples of each rank's values to rank 0, once per
+  // quantile and per refinement.
+  //
+  // METHOD_REFINE locates all quantiles at once. Each round splits the
+  // interval known to hold each quantile into BufferSize buckets, counts the
+  // values in each bucket locally and sums the counts with one AllReduce.
+  // Intervals are kept in a 64 bit ordered encoding of the values, so at
+  // most ceil(64 / log2(BufferSize)) + 1 rounds are needed and the result is
+  // exact. No rank does more work than another.
+  enum
+  {
+    METHOD_GATHER = 0,
+    METHOD_REFINE = 1
+  };
+
   CDFReducer(vtkMultiProcessController* controller)
     : Controller(controller)
+    , Method(METHOD_REFINE)
     , ArraySize(0)
     , LocalValues(nullptr)
     , ReducedCDF(nullptr)
@@ -136,6 +156,7 @@ public:
     , CDFSize(512)
     , LocalCDF(nullptr)
     , RemoteCDFs(nullptr)
+    , Verbose(0)
     {};
   ~CDFReducer();
 
@@ -143,12 +164,18 @@ public:
   vtkIdType GetBufferSize() { return this->CDFSize; };
   void SetBufferSize(vtkIdType exchangeCDFSize) { this->CDFSize = exchangeCDFSize; };
   vtkIdType GetTotalCount() { return this->TotalCount; };
+  void SetMethod(int method) { this->Method = method; };
+  int GetMethod() { return this->Method; };
+  // When set rank 0 reports the number of refinement rounds.
+  void SetVerbose(int verbose) { this->Verbose = verbose; };
 
 protected:
   double GetValueAtIndex(vtkIdType targetIdx, vtkIdType pid, vtkIdType mpiSize, int depth);
+  void RefineValuesAtIndices(const std::vector<vtkIdType>& targetIdx, double* values);
 
 private:
   vtkMultiProcessController* Controller;
+  int Method;
   vtkIdType ArraySize;
   double* LocalValues;
   double* ReducedCDF;
@@ -162,6 +189,7 @@ private:
   double* RemoteCDFs;
   //
   int ExecutionCount;
+  int Verbose;
   //
   StepHandler Handler;
 };
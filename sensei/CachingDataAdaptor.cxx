@@ -0,0 +1,525 @@
+#include "CachingDataAdaptor.h"
+#include "DerivedFields.h"
+#include "VTKUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataSet.h>
+#include <vtkDataObject.h>
+#include <vtkFieldData.h>
+#include <vtkDataArray.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <string>
+#include <utility>
+
+using vtkDataObjectPtr = vtkSmartPointer<vtkDataObject>;
+
+using vtkCompositeDataIteratorPtr =
+  vtkSmartPointer<vtkCompositeDataIterator>;
+
+namespace
+{
+// create a new object that shares the cached object's structure, but
+// not its arrays. field data is passed since it carries metadata such
+// as the number of ghost layers
+vtkDataObject *newShallowStructure(vtkDataObject *dobj, bool structureOnly)
+{
+  if (vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(dobj))
+    {
+    vtkCompositeDataSet *cdo = cd->NewInstance();
+    cdo->CopyStructure(cd);
+    cdo->GetFieldData()->ShallowCopy(cd->GetFieldData());
+
+    vtkCompositeDataIteratorPtr cdit;
+    cdit.TakeReference(cd->NewIterator());
+    while (!cdit->IsDoneWithTraversal())
+      {
+      vtkDataObject *leaf = cd->GetDataSet(cdit);
+      vtkDataObject *leafo = leaf->NewInstance();
+
+      if (!structureOnly)
+        {
+        if (vtkDataSet *ds = dynamic_cast<vtkDataSet*>(leaf))
+          static_cast<vtkDataSet*>(leafo)->CopyStructure(ds);
+        }
+
+      leafo->GetFieldData()->ShallowCopy(leaf->GetFieldData());
+
+      cdo->SetDataSet(cdit, leafo);
+      leafo->Delete();
+
+      cdit->GoToNextItem();
+      }
+
+    return cdo;
+    }
+
+  if (vtkDataSet *ds = dynamic_cast<vtkDataSet*>(dobj))
+    {
+    vtkDataSet *dso = ds->NewInstance();
+
+    if (!structureOnly)
+      dso->CopyStructure(ds);
+
+    dso->GetFieldData()->ShallowCopy(ds->GetFieldData());
+
+    return dso;
+    }
+
+  SENSEI_ERROR("Unsupoorted data object type " << dobj->GetClassName())
+  return nullptr;
+}
+
+// locate the local block when a legacy dataset was converted to
+// a composite dataset, for instance by DataAdaptor::GetMesh
+vtkDataSet *getLocalBlock(vtkCompositeDataSet *cd)
+{
+  vtkCompositeDataIteratorPtr cdit;
+  cdit.TakeReference(cd->NewIterator());
+  if (cdit->IsDoneWithTraversal())
+    return nullptr;
+  return dynamic_cast<vtkDataSet*>(cd->GetDataSet(cdit));
+}
+
+// pass the named array from the cached object to the caller's object. The
+// array is passed by reference. Blocks where the array is not present are
+// skipped, the wrapped adaptor has already reported any errors.
+int passArray(vtkDataObject *cached, vtkDataObject *mesh,
+  int association, const std::string &arrayName)
+{
+  sensei::VTKUtils::BinaryDatasetFunction pass =
+    [&](vtkDataSet *ds, vtkDataSet *dsOut) -> int
+    {
+    vtkFieldData *dsa = sensei::VTKUtils::GetAttributes(ds, association);
+    vtkFieldData *dsaOut = sensei::VTKUtils::GetAttributes(dsOut, association);
+
+    if (!dsa || !dsaOut)
+      return -1;
+
+    vtkDataArray *da = dsa->GetArray(arrayName.c_str());
+    if (da)
+      dsaOut->AddArray(da);
+
+    return 0;
+    };
+
+  vtkCompositeDataSet *cdo = dynamic_cast<vtkCompositeDataSet*>(mesh);
+  if (cdo && !dynamic_cast<vtkCompositeDataSet*>(cached))
+    {
+    vtkDataSet *dso = getLocalBlock(cdo);
+    if (!dso)
+      return 0;
+    return sensei::VTKUtils::Apply(cached, dso, pass);
+    }
+
+  return sensei::VTKUtils::Apply(cached, mesh, pass);
+}
+}
+
+
+namespace sensei
+{
+
+struct CachingDataAdaptor::InternalsType
+{
+  InternalsType() : Data(nullptr), Derived(nullptr) {}
+
+  // the data produced by the wrapped adaptor for one mesh
+  struct CacheEntry
+  {
+    CacheEntry() : StructureOnly(true), GhostCells(false),
+      GhostNodes(false) {}
+
+    vtkDataObjectPtr Mesh;
+    bool StructureOnly;
+    bool GhostCells;
+    bool GhostNodes;
+    std::set<std::pair<int, std::string>> Arrays;
+  };
+
+  using CacheType = std::map<std::string, CacheEntry>;
+
+  // locate the cache entry for the named mesh, or report an error
+  CacheEntry *Find(const std::string &meshName);
+
+  // get the cache entry of the named mesh, fetching it from the wrapped
+  // adaptor if it is not cached or lacks the requested geometry. the
+  // caller must hold the mutex
+  int Fetch(const std::string &meshName, bool structureOnly,
+    CacheEntry *&entry);
+
+  // add an array to the cached mesh, computing it if it is derived. the
+  // caller must hold the mutex
+  int Add(CacheEntry *entry, const std::string &meshName,
+    int association, const std::string &arrayName);
+
+  // list the derived arrays in the metadata, and compute their ranges
+  // when these are requested
+  int AddDerivedMetadata(MeshMetadataPtr &md);
+
+  DataAdaptor *Data;
+  const DerivedFields *Derived;
+  CacheType Cache;
+  std::mutex Mutex;
+};
+
+//----------------------------------------------------------------------------
+CachingDataAdaptor::InternalsType::CacheEntry *
+CachingDataAdaptor::InternalsType::Find(const std::string &meshName)
+{
+  CacheType::iterator it = this->Cache.find(meshName);
+  if (it == this->Cache.end())
+    {
+    SENSEI_ERROR("Mesh \"" << meshName << "\" was not requested")
+    return nullptr;
+    }
+  return &it->second;
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::InternalsType::Fetch(const std::string &meshName,
+  bool structureOnly, CacheEntry *&entry)
+{
+  CacheType::iterator it = this->Cache.find(meshName);
+
+  // fetch from the simulation if not cached or if the cached mesh
+  // lacks the requested geometry
+  if ((it == this->Cache.end()) || (it->second.StructureOnly && !structureOnly))
+    {
+    TimeEvent<128> mark("CachingDataAdaptor::GetMesh");
+
+    vtkDataObject *dobj = nullptr;
+    if (this->Data->GetMesh(meshName, structureOnly, dobj))
+      {
+      SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    CacheEntry &newEntry = this->Cache[meshName];
+    newEntry = CacheEntry();
+    newEntry.Mesh.TakeReference(dobj);
+    newEntry.StructureOnly = structureOnly;
+
+    it = this->Cache.find(meshName);
+    }
+
+  entry = &it->second;
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::InternalsType::Add(CacheEntry *entry,
+  const std::string &meshName, int association, const std::string &arrayName)
+{
+  std::pair<int, std::string> key(association, arrayName);
+  if (entry->Arrays.count(key))
+    return 0;
+
+  const DerivedFields::Field *field = this->Derived ?
+    this->Derived->Find(meshName, association, arrayName) : nullptr;
+
+  if (!field)
+    {
+    TimeEvent<128> mark("CachingDataAdaptor::AddArray");
+
+    if (this->Data->AddArray(entry->Mesh, meshName, association, arrayName))
+      {
+      SENSEI_ERROR("Failed to add " << VTKUtils::GetAttributesName(association)
+        << " data array \"" << arrayName << "\" to mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    entry->Arrays.insert(key);
+    return 0;
+    }
+
+  // the operations need the geometry. a mesh cached without it is fetched
+  // again, the arrays already added will be added again when requested.
+  // callers' meshes keep the arrays passed to them
+  if (entry->StructureOnly && this->Fetch(meshName, false, entry))
+    return -1;
+
+  if (!entry->Mesh)
+    return 0;
+
+  // the input, which may itself be derived
+  if (this->Add(entry, meshName, field->InputAssociation, field->Input) ||
+    DerivedFields::Compute(*field, entry->Mesh))
+    {
+    SENSEI_ERROR("Failed to derive " << VTKUtils::GetAttributesName(association)
+      << " data array \"" << arrayName << "\" on mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  entry->Arrays.insert(key);
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::InternalsType::AddDerivedMetadata(MeshMetadataPtr &md)
+{
+  if (!this->Derived || (this->Derived->AddMetadata(md) < 1) ||
+    !md->Flags.BlockArrayRangeSet())
+    return 0;
+
+  // the local ranges are set, as the wrapped adaptor sets those of its
+  // arrays, and are made global by the caller. this means computing the
+  // derived arrays now, they are then cached for the analyses
+  if (md->GlobalView)
+    {
+    SENSEI_WARNING("The ranges of the derived arrays of mesh \""
+      << md->MeshName << "\" are not available in the global view")
+    return 0;
+    }
+
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  CacheEntry *entry = nullptr;
+  if (this->Fetch(md->MeshName, false, entry))
+    return -1;
+
+  if (!entry->Mesh)
+    return 0;
+
+  unsigned int nArrays = md->ArrayName.size();
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    if (this->Derived->Find(md->MeshName, md->ArrayCentering[i],
+      md->ArrayName[i]) && this->Add(entry, md->MeshName,
+      md->ArrayCentering[i], md->ArrayName[i]))
+      return -1;
+    }
+
+  return this->Derived->SetRanges(entry->Mesh, md);
+}
+
+//----------------------------------------------------------------------------
+senseiNewMacro(CachingDataAdaptor);
+
+//----------------------------------------------------------------------------
+CachingDataAdaptor::CachingDataAdaptor()
+{
+  this->Internals = new InternalsType;
+}
+
+//----------------------------------------------------------------------------
+CachingDataAdaptor::~CachingDataAdaptor()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+void CachingDataAdaptor::SetDataAdaptor(DataAdaptor *data)
+{
+  if (this->Internals->Data == data)
+    return;
+
+  this->Clear();
+  this->Internals->Data = data;
+
+  if (data)
+    this->SetCommunicator(data->GetCommunicator());
+}
+
+//----------------------------------------------------------------------------
+void CachingDataAdaptor::SetDerivedFields(const DerivedFields *fields)
+{
+  if (this->Internals->Derived == fields)
+    return;
+
+  this->Clear();
+  this->Internals->Derived = fields;
+}
+
+//----------------------------------------------------------------------------
+DataAdaptor *CachingDataAdaptor::GetDataAdaptor()
+{
+  return this->Internals->Data;
+}
+
+//----------------------------------------------------------------------------
+void CachingDataAdaptor::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+  this->Internals->Cache.clear();
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::GetNumberOfMeshes(unsigned int &numMeshes)
+{
+  return this->Internals->Data->GetNumberOfMeshes(numMeshes);
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::GetMeshMetadata(unsigned int id,
+  MeshMetadataPtr &metadata)
+{
+  if (this->Internals->Data->GetMeshMetadata(id, metadata) ||
+    this->Internals->AddDerivedMetadata(metadata))
+    return -1;
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::GetCachedMeshMetadata(unsigned int id,
+  const MeshMetadataFlags &flags, bool globalView, MeshMetadataPtr &metadata)
+{
+  // the wrapped adaptor persists across steps
+  if (this->Internals->Data->GetCachedMeshMetadata(id, flags,
+    globalView, metadata))
+    return -1;
+
+  // the wrapped adaptor's copy is shared and must not be modified
+  if (this->Internals->Derived && !this->Internals->Derived->Empty())
+    {
+    metadata = metadata->NewCopy();
+    if (this->Internals->AddDerivedMetadata(metadata))
+      return -1;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+double CachingDataAdaptor::GetDataTime()
+{
+  return this->Internals->Data->GetDataTime();
+}
+
+//----------------------------------------------------------------------------
+long CachingDataAdaptor::GetDataTimeStep()
+{
+  return this->Internals->Data->GetDataTimeStep();
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::GetMesh(const std::string &meshName,
+  bool structureOnly, vtkDataObject *&mesh)
+{
+  mesh = nullptr;
+
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+
+  InternalsType::CacheEntry *entry = nullptr;
+  if (this->Internals->Fetch(meshName, structureOnly, entry))
+    return -1;
+
+  // this rank has no data
+  if (!entry->Mesh)
+    return 0;
+
+  mesh = newShallowStructure(entry->Mesh, structureOnly);
+  if (!mesh)
+    {
+    SENSEI_ERROR("Failed to copy mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::AddArray(vtkDataObject* mesh,
+  const std::string &meshName, int association, const std::string &arrayName)
+{
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+
+  InternalsType::CacheEntry *entry = this->Internals->Find(meshName);
+  if (!entry)
+    return -1;
+
+  if (!entry->Mesh || !mesh)
+    return 0;
+
+  if (this->Internals->Add(entry, meshName, association, arrayName))
+    return -1;
+
+  if (passArray(entry->Mesh, mesh, association, arrayName))
+    {
+    SENSEI_ERROR("Failed to pass " << VTKUtils::GetAttributesName(association)
+      << " data array \"" << arrayName << "\" to mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::AddGhostCellsArray(vtkDataObject* mesh,
+  const std::string &meshName)
+{
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+
+  InternalsType::CacheEntry *entry = this->Internals->Find(meshName);
+  if (!entry)
+    return -1;
+
+  if (!entry->Mesh || !mesh)
+    return 0;
+
+  if (!entry->GhostCells)
+    {
+    if (this->Internals->Data->AddGhostCellsArray(entry->Mesh, meshName))
+      {
+      SENSEI_ERROR("Failed to add ghost cells to mesh \"" << meshName << "\"")
+      return -1;
+      }
+    entry->GhostCells = true;
+    }
+
+  if (passArray(entry->Mesh, mesh, vtkDataObject::CELL, "vtkGhostType"))
+    {
+    SENSEI_ERROR("Failed to pass ghost cells to mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::AddGhostNodesArray(vtkDataObject* mesh,
+  const std::string &meshName)
+{
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+
+  InternalsType::CacheEntry *entry = this->Internals->Find(meshName);
+  if (!entry)
+    return -1;
+
+  if (!entry->Mesh || !mesh)
+    return 0;
+
+  if (!entry->GhostNodes)
+    {
+    if (this->Internals->Data->AddGhostNodesArray(entry->Mesh, meshName))
+      {
+      SENSEI_ERROR("Failed to add ghost nodes to mesh \"" << meshName << "\"")
+      return -1;
+      }
+    entry->GhostNodes = true;
+    }
+
+  if (passArray(entry->Mesh, mesh, vtkDataObject::POINT, "vtkGhostType"))
+    {
+    SENSEI_ERROR("Failed to pass ghost nodes to mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int CachingDataAdaptor::ReleaseData()
+{
+  return 0;
+}
+
+}
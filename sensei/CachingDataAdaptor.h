@@ -0,0 +1,103 @@
+#ifndef sensei_CachingDataAdaptor_h
+#define sensei_CachingDataAdaptor_h
+
+#include "DataAdaptor.h"
+
+class vtkDataObject;
+
+namespace sensei
+{
+class DerivedFields;
+
+/// @brief A DataAdaptor that memoizes the data served by another adaptor.
+///
+/// sensei::CachingDataAdaptor wraps the simulation's sensei::DataAdaptor
+/// and caches the meshes, arrays, and ghost arrays it produces for the
+/// duration of a time step. When a number of analyses access the same mesh
+/// the simulation's adaptor converts it only once, later requests are
+/// served from the cache. Meshes handed out are new objects that reference
+/// the cached geometry, topology, and arrays. Hence, as with other adaptors,
+/// the caller takes ownership of the returned mesh and may modify it
+/// without affecting other callers.
+///
+/// The cache is valid until Clear is called. ReleaseData does not clear it
+/// since analyses may call ReleaseData while others still need the data.
+/// The owner of the cache is expected to call Clear after all analyses have
+/// executed and before the simulation releases its data.
+///
+/// When given DerivedFields the cache also serves the derived arrays. They
+/// are listed in the metadata of their mesh and computed, along with their
+/// inputs, on the first AddArray that requests them in a step. An analysis
+/// cannot tell them from the simulation's arrays.
+class CachingDataAdaptor : public DataAdaptor
+{
+public:
+  static CachingDataAdaptor *New();
+  senseiTypeMacro(CachingDataAdaptor, DataAdaptor);
+
+  /// @brief Set the adaptor whose data is cached.
+  ///
+  /// Setting a different adaptor clears the cache. The cache takes the
+  /// communicator of the wrapped adaptor.
+  ///
+  /// @param[in] data the adaptor to cache data from
+  void SetDataAdaptor(DataAdaptor *data);
+  DataAdaptor *GetDataAdaptor();
+
+  /// @brief Set the arrays derived from those of the wrapped adaptor.
+  ///
+  /// The fields are not owned and must outlive the cache, or be unset
+  /// with nullptr. Setting them clears the cache.
+  ///
+  /// @param[in] fields the derived arrays, or nullptr for none
+  void SetDerivedFields(const DerivedFields *fields);
+
+  /// @brief Release the cached data.
+  ///
+  /// Must be called when the wrapped adaptor's data are no longer
+  /// valid, typically before the simulation releases its data.
+  void Clear();
+
+  // forwarded to the wrapped adaptor. the metadata lists the derived
+  // arrays, their ranges are computed when requested
+  int GetNumberOfMeshes(unsigned int &numMeshes) override;
+  int GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadata) override;
+  int GetCachedMeshMetadata(unsigned int id, const MeshMetadataFlags &flags,
+    bool globalView, MeshMetadataPtr &metadata) override;
+  double GetDataTime() override;
+  long GetDataTimeStep() override;
+
+  // served from the cache. on a cache miss the wrapped adaptor is
+  // called and the result is stored for subsequent use
+  int GetMesh(const std::string &meshName, bool structureOnly,
+    vtkDataObject *&mesh) override;
+
+  using DataAdaptor::GetMesh;
+
+  int AddGhostNodesArray(vtkDataObject* mesh,
+    const std::string &meshName) override;
+
+  int AddGhostCellsArray(vtkDataObject* mesh,
+    const std::string &meshName) override;
+
+  int AddArray(vtkDataObject* mesh, const std::string &meshName,
+    int association, const std::string &arrayName) override;
+
+  /// @brief Does nothing, see Clear.
+  int ReleaseData() override;
+
+protected:
+  CachingDataAdaptor();
+  ~CachingDataAdaptor();
+
+private:
+  CachingDataAdaptor(const CachingDataAdaptor&) = delete;
+  void operator=(const CachingDataAdaptor&) = delete;
+
+  struct InternalsType;
+  InternalsType *Internals;
+};
+
+}
+
+#endif
@@ -0,0 +1,512 @@
+#include "Catalyst2AnalysisAdaptor.h"
+
+#include "BlueprintUtils.h"
+#include "ConduitDataAdaptor.h"
+#include "DataAdaptor.h"
+#include "Error.h"
+#include "MeshMetadataMap.h"
+#include "Profiler.h"
+#include "VTKUtils.h"
+
+#include <catalyst.hpp>
+#include <conduit_blueprint.hpp>
+
+#include <vtkObjectFactory.h>
+#include <vtkCellData.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataObject.h>
+#include <vtkDataSet.h>
+#include <vtkPointData.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Catalyst is initialized once per process
+int catalystInitializationCounter = 0;
+
+// --------------------------------------------------------------------------
+template <typename T>
+void SetExternal(conduit_cpp::Node dst, const conduit::Node &src)
+{
+  const conduit::DataType &dt = src.dtype();
+  dst.set_external(static_cast<T*>(const_cast<void*>(src.data_ptr())),
+    dt.number_of_elements(), dt.offset(), dt.stride(), dt.element_bytes(),
+    dt.endianness());
+}
+
+// --------------------------------------------------------------------------
+// reference a tree in a node of Catalyst's Conduit without copying the
+// values. libcatalyst is usually built with its own copy of Conduit, hence
+// the tree is walked rather than handed over by pointer. returns zero if
+// successful
+int PassExternal(const conduit::Node &src, conduit_cpp::Node dst)
+{
+  const conduit::DataType &dt = src.dtype();
+
+  if (dt.is_object() || dt.is_list())
+    {
+    conduit::NodeConstIterator it = src.children();
+    while (it.has_next())
+      {
+      const conduit::Node &child = it.next();
+      if (PassExternal(child, dt.is_list() ? dst.append() : dst[it.name()]))
+        return -1;
+      }
+    return 0;
+    }
+
+  switch (dt.id())
+    {
+    case conduit::DataType::EMPTY_ID:
+      return 0;
+    case conduit::DataType::CHAR8_STR_ID:
+      dst.set(src.as_string());
+      return 0;
+    case conduit::DataType::INT8_ID:
+      SetExternal<conduit_int8>(dst, src);
+      return 0;
+    case conduit::DataType::INT16_ID:
+      SetExternal<conduit_int16>(dst, src);
+      return 0;
+    case conduit::DataType::INT32_ID:
+      SetExternal<conduit_int32>(dst, src);
+      return 0;
+    case conduit::DataType::INT64_ID:
+      SetExternal<conduit_int64>(dst, src);
+      return 0;
+    case conduit::DataType::UINT8_ID:
+      SetExternal<conduit_uint8>(dst, src);
+      return 0;
+    case conduit::DataType::UINT16_ID:
+      SetExternal<conduit_uint16>(dst, src);
+      return 0;
+    case conduit::DataType::UINT32_ID:
+      SetExternal<conduit_uint32>(dst, src);
+      return 0;
+    case conduit::DataType::UINT64_ID:
+      SetExternal<conduit_uint64>(dst, src);
+      return 0;
+    case conduit::DataType::FLOAT32_ID:
+      SetExternal<conduit_float32>(dst, src);
+      return 0;
+    case conduit::DataType::FLOAT64_ID:
+      SetExternal<conduit_float64>(dst, src);
+      return 0;
+    }
+
+  SENSEI_ERROR("Unsupported Conduit type " << dt.name()
+    << " at \"" << src.path() << "\"")
+  return -1;
+}
+
+// --------------------------------------------------------------------------
+// reference a domain, keeping only the required fields and the ghosts
+void PassRequiredFields(const conduit::Node &src, conduit::Node &dst,
+  const std::string &meshName, const sensei::DataRequirements &reqs)
+{
+  conduit::NodeConstIterator it = src.children();
+  while (it.has_next())
+    {
+    const conduit::Node &child = it.next();
+    if (it.name() != "fields")
+      {
+      dst[it.name()].set_external(const_cast<conduit::Node&>(child));
+      continue;
+      }
+
+    conduit::NodeConstIterator fit = child.children();
+    while (fit.has_next())
+      {
+      const conduit::Node &field = fit.next();
+      std::string name = fit.name();
+
+      std::string assoc = field.has_child("association") ?
+        field["association"].as_string() : std::string();
+
+      int cen = assoc == "vertex" ? vtkDataObject::POINT :
+        assoc == "element" ? vtkDataObject::CELL : -1;
+
+      if ((name == "vtkGhostType") || (name == "ascent_ghosts") ||
+        ((cen >= 0) && reqs.HasArray(meshName, cen, name)))
+        dst["fields"][name].set_external(const_cast<conduit::Node&>(field));
+      }
+    }
+}
+}
+
+namespace sensei
+{
+
+//-----------------------------------------------------------------------------
+senseiNewMacro(Catalyst2AnalysisAdaptor);
+
+//-----------------------------------------------------------------------------
+Catalyst2AnalysisAdaptor::Catalyst2AnalysisAdaptor() :
+  Implementation("paraview"), Initialized(false)
+{
+}
+
+//-----------------------------------------------------------------------------
+Catalyst2AnalysisAdaptor::~Catalyst2AnalysisAdaptor()
+{
+  this->Finalize();
+}
+
+//-----------------------------------------------------------------------------
+void Catalyst2AnalysisAdaptor::AddPythonScript(const std::string &fileName)
+{
+  if (this->Initialized)
+    {
+    SENSEI_WARNING("Catalyst is initialized, the script \"" << fileName
+      << "\" is ignored")
+    return;
+    }
+
+  this->Scripts.push_back(fileName);
+}
+
+//-----------------------------------------------------------------------------
+void Catalyst2AnalysisAdaptor::SetImplementation(const std::string &name)
+{
+  this->Implementation = name;
+}
+
+//-----------------------------------------------------------------------------
+void Catalyst2AnalysisAdaptor::SetSearchPath(const std::string &path)
+{
+  this->SearchPath = path;
+}
+
+//-----------------------------------------------------------------------------
+int Catalyst2AnalysisAdaptor::SetDataRequirements(const DataRequirements &reqs)
+{
+  this->Requirements = reqs;
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int Catalyst2AnalysisAdaptor::AddDataRequirement(const std::string &meshName,
+  int association, const std::vector<std::string> &arrays)
+{
+  this->Requirements.AddRequirement(meshName, association, arrays);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int Catalyst2AnalysisAdaptor::Initialize()
+{
+  if (this->Initialized)
+    return 0;
+
+  TimeEvent<128> mark("Catalyst2AnalysisAdaptor::Initialize");
+
+  if (catalystInitializationCounter)
+    {
+    SENSEI_ERROR("Catalyst is already initialized. Add all of the scripts"
+      " to a single Catalyst2AnalysisAdaptor")
+    return -1;
+    }
+
+  conduit_cpp::Node node;
+
+  for (size_t i = 0; i < this->Scripts.size(); ++i)
+    {
+    char path[64];
+    snprintf(path, sizeof(path), "catalyst/scripts/script%zu", i);
+    node[path].set(this->Scripts[i]);
+    }
+
+  node["catalyst/mpi_comm"].set(
+    static_cast<conduit_int64>(MPI_Comm_c2f(this->GetCommunicator())));
+
+  node["catalyst_load/implementation"].set(this->Implementation);
+  if (!this->SearchPath.empty())
+    node["catalyst_load/search_paths/" + this->Implementation].set(this->SearchPath);
+
+  enum catalyst_status ierr = catalyst_initialize(conduit_cpp::c_node(&node));
+  if (ierr != catalyst_status_ok)
+    {
+    SENSEI_ERROR("Failed to initialize the Catalyst implementation \""
+      << this->Implementation << "\". catalyst_initialize returned " << ierr)
+    return -1;
+    }
+
+  ++catalystInitializationCounter;
+  this->Initialized = true;
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int Catalyst2AnalysisAdaptor::PassConduitNode(DataAdaptor *dataAdaptor,
+  conduit::Node &channels)
+{
+  ConduitDataAdaptor *cda = static_cast<ConduitDataAdaptor*>(dataAdaptor);
+
+  conduit::Node *node = cda->GetNode();
+  if (!node)
+    {
+    SENSEI_ERROR("The ConduitDataAdaptor has no node")
+    return -1;
+    }
+
+  MeshMetadataPtr mmd;
+  MeshMetadataFlags flags;
+  if (dataAdaptor->GetCachedMeshMetadata(0, flags, false, mmd))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return -1;
+    }
+
+  std::vector<std::string> meshes;
+  this->Requirements.GetRequiredMeshes(meshes);
+  if (!this->Requirements.Empty() &&
+    (std::find(meshes.begin(), meshes.end(), mmd->MeshName) == meshes.end()))
+    return 0;
+
+  conduit::Node &channel = channels[mmd->MeshName];
+  channel["type"] = "mesh";
+  conduit::Node &data = channel["data"];
+
+  // the simulation's tree is passed as is
+  if (this->Requirements.Empty())
+    {
+    data.set_external(*node);
+    return 0;
+    }
+
+  if (conduit::blueprint::mesh::is_multi_domain(*node))
+    {
+    conduit::NodeConstIterator it = node->children();
+    while (it.has_next())
+      {
+      const conduit::Node &domain = it.next();
+      ::PassRequiredFields(domain, data[it.name()], mmd->MeshName,
+        this->Requirements);
+      }
+    }
+  else
+    {
+    ::PassRequiredFields(*node, data, mmd->MeshName, this->Requirements);
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int Catalyst2AnalysisAdaptor::PassVTKMeshes(DataAdaptor *dataAdaptor,
+  conduit::Node &channels, std::vector<vtkCompositeDataSetPtr> &meshes)
+{
+  // pass everything when nothing in particular was asked for
+  DataRequirements reqs = this->Requirements;
+  if (reqs.Empty() && reqs.Initialize(dataAdaptor, false))
+    {
+    SENSEI_ERROR("Failed to get the meshes and arrays")
+    return -1;
+    }
+
+  MeshMetadataMap mdMap;
+  if (mdMap.Initialize(dataAdaptor))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return -1;
+    }
+
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    const std::string &meshName = mit.MeshName();
+
+    MeshMetadataPtr mmd;
+    if (mdMap.GetMeshMetadata(meshName, mmd))
+      {
+      SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    vtkDataObject *dobj = nullptr;
+    if (dataAdaptor->GetMesh(meshName, mit.StructureOnly(), dobj))
+      {
+      SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    ArrayRequirementsIterator ait = reqs.GetArrayRequirementsIterator(meshName);
+    for (; ait; ++ait)
+      {
+      if (dataAdaptor->AddArray(dobj, meshName, ait.Association(), ait.Array()))
+        {
+        SENSEI_ERROR("Failed to add " << VTKUtils::GetAttributesName(ait.Association())
+          << " data array \"" << ait.Array() << "\" to mesh \"" << meshName << "\"")
+        dobj->Delete();
+        return -1;
+        }
+      }
+
+    if ((mmd->NumGhostCells || VTKUtils::AMR(mmd)) &&
+      dataAdaptor->AddGhostCellsArray(dobj, meshName))
+      {
+      SENSEI_ERROR("Failed to get ghost cells for mesh \"" << meshName << "\"")
+      dobj->Delete();
+      return -1;
+      }
+
+    vtkCompositeDataSetPtr cd =
+      VTKUtils::AsCompositeData(this->GetCommunicator(), dobj, true);
+    meshes.push_back(cd);
+
+    // geometry cached for a static mesh is dropped if the mesh changes
+    if (!mmd->StaticMesh && this->MeshCache.has_child(meshName))
+      this->MeshCache.remove(meshName);
+
+    conduit::Node &channel = channels[meshName];
+    channel["type"] = "mesh";
+    conduit::Node &data = channel["data"];
+
+    vtkCompositeDataIterator *it = cd->NewIterator();
+    it->SetSkipEmptyNodes(1);
+    for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+      {
+      vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+      if (!ds)
+        {
+        SENSEI_ERROR("Block " << it->GetCurrentFlatIndex() << " of mesh \""
+          << meshName << "\" is not a vtkDataSet")
+        it->Delete();
+        return -1;
+        }
+
+      // the flat index is stable from step to step and names the cache entry
+      char domainName[32];
+      snprintf(domainName, sizeof(domainName), "domain_%.6u",
+        it->GetCurrentFlatIndex());
+
+      conduit::Node &domain = data[domainName];
+      BlueprintUtils::PassState(ds, domain, dataAdaptor);
+
+      conduit::Node *cache = mmd->StaticMesh ?
+        &this->MeshCache[meshName][domainName] : nullptr;
+
+      if (cache && cache->has_child("coordsets"))
+        {
+        domain["coordsets"].set_external((*cache)["coordsets"]);
+        domain["topologies"].set_external((*cache)["topologies"]);
+        }
+      else
+        {
+        if (BlueprintUtils::PassCoordsets(ds, domain) ||
+          BlueprintUtils::PassTopology(ds, domain))
+          {
+          SENSEI_ERROR("Failed to convert block " << it->GetCurrentFlatIndex()
+            << " of mesh \"" << meshName << "\"")
+          it->Delete();
+          return -1;
+          }
+
+        // the cache keeps a copy since the simulation's arrays may not
+        // outlive the step
+        if (cache)
+          {
+          (*cache)["coordsets"].set(domain["coordsets"]);
+          (*cache)["topologies"].set(domain["topologies"]);
+          }
+        }
+
+      for (ait = reqs.GetArrayRequirementsIterator(meshName); ait; ++ait)
+        {
+        if (ds->GetAttributes(ait.Association())->GetArray(ait.Array().c_str()) &&
+          BlueprintUtils::PassFields(ds, domain, ait.Array(), ait.Association()))
+          {
+          SENSEI_ERROR("Failed to pass array \"" << ait.Array()
+            << "\" of mesh \"" << meshName << "\"")
+          it->Delete();
+          return -1;
+          }
+        }
+
+      // ParaView recognizes the ghost array by its name
+      if (ds->GetCellData()->GetArray("vtkGhostType"))
+        BlueprintUtils::PassFields(ds, domain, "vtkGhostType", vtkDataObject::CELL);
+      }
+    it->Delete();
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+bool Catalyst2AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
+{
+  TimeEvent<128> mark("Catalyst2AnalysisAdaptor::Execute");
+
+  if (this->Initialize())
+    return false;
+
+  // a simulation that makes Blueprint skips making VTK objects
+  conduit::Node channels;
+  std::vector<vtkCompositeDataSetPtr> meshes;
+  if (dynamic_cast<ConduitDataAdaptor*>(dataAdaptor))
+    {
+    if (this->PassConduitNode(dataAdaptor, channels))
+      return false;
+    }
+  else if (this->PassVTKMeshes(dataAdaptor, channels, meshes))
+    {
+    return false;
+    }
+
+  conduit_cpp::Node node;
+  node["catalyst/state/timestep"].set(
+    static_cast<conduit_int64>(dataAdaptor->GetDataTimeStep()));
+  node["catalyst/state/time"].set(
+    static_cast<conduit_float64>(dataAdaptor->GetDataTime()));
+
+  if (::PassExternal(channels, node["catalyst/channels"]))
+    {
+    SENSEI_ERROR("Failed to pass the channels to Catalyst")
+    return false;
+    }
+
+  // the tree references the simulation's arrays, the meshes are released
+  // only after Catalyst is done with them
+  enum catalyst_status ierr = catalyst_execute(conduit_cpp::c_node(&node));
+  meshes.clear();
+
+  if (ierr != catalyst_status_ok)
+    {
+    SENSEI_ERROR("catalyst_execute returned " << ierr)
+    return false;
+    }
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int Catalyst2AnalysisAdaptor::Finalize()
+{
+  if (!this->Initialized)
+    return 0;
+
+  TimeEvent<128> mark("Catalyst2AnalysisAdaptor::Finalize");
+
+  this->Initialized = false;
+  this->MeshCache.reset();
+  --catalystInitializationCounter;
+
+  conduit_cpp::Node node;
+  enum catalyst_status ierr = catalyst_finalize(conduit_cpp::c_node(&node));
+  if (ierr != catalyst_status_ok)
+    {
+    SENSEI_ERROR("catalyst_finalize returned " << ierr)
+    return -1;
+    }
+
+  return 0;
+}
+
+}
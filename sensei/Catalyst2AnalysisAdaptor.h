@@ -0,0 +1,97 @@
+#ifndef sensei_Catalyst2AnalysisAdaptor_h
+#define sensei_Catalyst2AnalysisAdaptor_h
+
+#include "AnalysisAdaptor.h"
+#include "DataRequirements.h"
+
+#include <conduit.hpp>
+#include <vtkSmartPointer.h>
+
+#include <string>
+#include <vector>
+
+class vtkCompositeDataSet;
+
+namespace sensei
+{
+
+/// @brief Analysis adaptor for the Catalyst 2 API.
+///
+/// CatalystAnalysisAdaptor hands VTK objects to the legacy co-processing
+/// API. This adaptor instead passes Conduit Blueprint meshes to
+/// catalyst_execute, the Catalyst implementation, ParaView's by default,
+/// is loaded by libcatalyst at run time and SENSEI does not link to it.
+///
+/// When the data adaptor is a ConduitDataAdaptor its node is passed
+/// through without copying and no VTK objects are made. Otherwise the
+/// meshes are converted with the VTK to Blueprint mapping used by the
+/// Ascent adaptor, arrays are passed without copying where their layout
+/// allows. Each mesh is a channel of the same name, holding one domain per
+/// local block. The geometry of static meshes is converted once.
+///
+/// The node passed to catalyst_initialize holds the scripts as
+/// catalyst/scripts/scriptN, the communicator as catalyst/mpi_comm, and
+/// the implementation as catalyst_load/implementation and
+/// catalyst_load/search_paths. libcatalyst also honors the environment
+/// variables CATALYST_IMPLEMENTATION_NAME and
+/// CATALYST_IMPLEMENTATION_PATHS.
+class Catalyst2AnalysisAdaptor : public AnalysisAdaptor
+{
+public:
+  static Catalyst2AnalysisAdaptor* New();
+  senseiTypeMacro(Catalyst2AnalysisAdaptor, AnalysisAdaptor);
+
+  /// Add a Catalyst Python script. Scripts must be added before
+  /// Initialize is called.
+  void AddPythonScript(const std::string &fileName);
+
+  /// Set the name of the implementation that libcatalyst loads, paraview
+  /// by default, and the directory it is searched for in. An empty path
+  /// leaves the search to libcatalyst.
+  void SetImplementation(const std::string &name);
+  void SetSearchPath(const std::string &path);
+
+  /// Set the meshes and arrays that are passed to Catalyst. When empty,
+  /// all of the data adaptor's meshes and arrays are passed.
+  int SetDataRequirements(const DataRequirements &reqs);
+
+  int AddDataRequirement(const std::string &meshName,
+    int association, const std::vector<std::string> &arrays);
+
+  /// Initialize Catalyst. This is done at the first execution if it was
+  /// not called earlier, calling it again has no effect. returns zero if
+  /// successful.
+  int Initialize();
+
+  bool Execute(DataAdaptor* data) override;
+
+  int Finalize() override;
+
+protected:
+  Catalyst2AnalysisAdaptor();
+  ~Catalyst2AnalysisAdaptor();
+
+  Catalyst2AnalysisAdaptor(const Catalyst2AnalysisAdaptor&) = delete;
+  void operator=(const Catalyst2AnalysisAdaptor&) = delete;
+
+  // reference the Blueprint node of a ConduitDataAdaptor in the channel.
+  // when arrays are required only the required fields are passed
+  int PassConduitNode(DataAdaptor *data, conduit::Node &channels);
+
+  // convert the VTK meshes of the data adaptor to Blueprint channels. the
+  // meshes are kept until Catalyst is done with their arrays
+  int PassVTKMeshes(DataAdaptor *data, conduit::Node &channels,
+    std::vector<vtkSmartPointer<vtkCompositeDataSet>> &meshes);
+
+private:
+  std::vector<std::string> Scripts;
+  std::string Implementation;
+  std::string SearchPath;
+  DataRequirements Requirements;
+  conduit::Node MeshCache;    // Coordsets and topologies of static meshes.
+  bool Initialized;
+};
+
+}
+
+#endif
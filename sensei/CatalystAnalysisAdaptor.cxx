@@ -15,6 +15,7 @@
 #include <vtkCPInputDataDescription.h>
 #include <vtkCPProcessor.h>
 #include <vtkDataObject.h>
+#include <vtkDataSet.h>
 #include <vtkImageData.h>
 #include <vtkMultiProcessController.h>
 #include <vtkObjectFactory.h>
@@ -25,6 +26,10 @@
 #include <vtkCPPythonScriptPipeline.h>
 #endif
 
+#include <map>
+#include <string>
+#include <vector>
+
 namespace sensei
 {
 
@@ -34,9 +39,8 @@ static int vtkCPAdaptorAPIInitializationCounter = 0;
 senseiNewMacro(CatalystAnalysisAdaptor);
 
 //-----------------------------------------------------------------------------
-CatalystAnalysisAdaptor::CatalystAnalysisAdaptor()
+CatalystAnalysisAdaptor::CatalystAnalysisAdaptor() : Initialized(false)
 {
-  this->Initialize();
 }
 
 //-----------------------------------------------------------------------------
@@ -48,12 +52,16 @@ CatalystAnalysisAdaptor::~CatalystAnalysisAdaptor()
 //-----------------------------------------------------------------------------
 void CatalystAnalysisAdaptor::Initialize()
 {
+  if (this->Initialized)
+    return;
+
   TimeEvent<128> mark("CatalystAnalysisAdaptor::Initialize");
   if (vtkCPAdaptorAPIInitializationCounter == 0)
     {
     vtkCPAdaptorAPI::CoProcessorInitialize();
     }
   vtkCPAdaptorAPIInitializationCounter++;
+  this->Initialized = true;
 }
 
 //-----------------------------------------------------------------------------
@@ -61,6 +69,7 @@ void CatalystAnalysisAdaptor::AddPipeline(vtkCPPipeline* pipeline)
 {
   if (pipeline)
     {
+    this->Initialize();
     vtkCPAdaptorAPI::GetCoProcessor()->AddPipeline(pipeline);
     }
 }
@@ -70,6 +79,8 @@ void CatalystAnalysisAdaptor::AddPythonScriptPipeline(
   const std::string &fileName)
 {
 #ifdef ENABLE_CATALYST_PYTHON
+  // the Co-Processor starts the interpreter the script is loaded into
+  this->Initialize();
   vtkNew<vtkCPPythonScriptPipeline> pythonPipeline;
   pythonPipeline->Initialize(fileName.c_str());
   this->AddPipeline(pythonPipeline.GetPointer());
@@ -137,15 +148,30 @@ int CatalystAnalysisAdaptor::SelectData(DataAdaptor *dataAdaptor,
 
     if (inDesc->GetIfGridIsNecessary())
       {
-      // get the mesh
+      // the data adaptor returns the same object for as long as the mesh
+      // is static, only its arrays are new
+      bool staticMesh = metadata[i]->StaticMesh;
+
       vtkDataObject* dobj = nullptr;
-      if (dataAdaptor->GetMesh(meshName, false, dobj))
+      if (dataAdaptor->GetCachedMesh(metadata[i], false, dobj))
         {
         SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
         return -1;
         }
 
-      // add the requested arrays
+      vtkSmartPointer<vtkDataObject> mesh;
+      mesh.TakeReference(dobj);
+
+      bool cached = false;
+      if (staticMesh)
+        {
+        auto it = this->StaticMeshes.find(metadata[i]->MeshName);
+        cached = (it != this->StaticMeshes.end()) && (it->second == mesh);
+        }
+
+      // gather the requested arrays by association so that each group is
+      // added in one call
+      std::map<int, std::vector<std::string>> arrays;
       for (int j = 0; j < metadata[i]->NumArrays; ++j)
         {
         int assoc = metadata[i]->ArrayCentering[j];
@@ -157,39 +183,56 @@ int CatalystAnalysisAdaptor::SelectData(DataAdaptor *dataAdaptor,
         if (inDesc->IsFieldNeeded(arrayName))
 #endif
           {
-          if (dataAdaptor->AddArray(dobj, meshName, assoc, arrayName))
-            {
-            SENSEI_ERROR("Failed to add "
-              << VTKUtils::GetAttributesName(assoc)
-              << " data array \"" << arrayName << "\" to mesh \""
-              << meshName << "\"")
-            return -1;
-            }
+          arrays[assoc].push_back(arrayName);
+          }
+        }
+
+      // add the requested arrays
+      auto ait = arrays.begin();
+      auto aend = arrays.end();
+      for (; ait != aend; ++ait)
+        {
+        if (dataAdaptor->AddArrays(mesh, meshName, ait->first, ait->second))
+          {
+          SENSEI_ERROR("Failed to add "
+            << VTKUtils::GetAttributesName(ait->first)
+            << " data arrays to mesh \"" << meshName << "\"")
+          return -1;
           }
         }
 
       // add ghost zones
       if ((metadata[i]->NumGhostCells || VTKUtils::AMR(metadata[i])) &&
-        dataAdaptor->AddGhostNodesArray(dobj, meshName))
+        dataAdaptor->AddGhostNodesArray(mesh, meshName))
         {
         SENSEI_ERROR("Failed to get ghost nodes array for mesh \""
           << meshName << "\"")
         }
 
       if (metadata[i]->NumGhostCells &&
-        dataAdaptor->AddGhostCellsArray(dobj, meshName))
+        dataAdaptor->AddGhostCellsArray(mesh, meshName))
         {
         SENSEI_ERROR("Failed to get ghost nodes array for mesh \""
           << meshName << "\"")
         }
 
-      inDesc->SetGrid(dobj);
-      dobj->Delete();
+      if (cached)
+        {
+        // the whole extent was set on the description when the mesh was
+        // first fetched and is kept, only the arrays are new
+        mesh->Modified();
+        inDesc->SetGrid(mesh);
+        continue;
+        }
 
-      // we could get this info from metadata, however if there
-      // is not advantage to doing so we might as well get it
-      // from the data itself
-      this->SetWholeExtent(dobj, inDesc);
+      inDesc->SetGrid(mesh);
+
+      if (staticMesh)
+        this->StaticMeshes[metadata[i]->MeshName] = mesh;
+
+      // the whole extent is taken from the metadata, which the data
+      // adaptor keeps for static meshes
+      this->SetWholeExtent(metadata[i], mesh, inDesc);
       }
     }
 
@@ -197,8 +240,8 @@ int CatalystAnalysisAdaptor::SelectData(DataAdaptor *dataAdaptor,
 }
 
 //----------------------------------------------------------------------------
-int CatalystAnalysisAdaptor::SetWholeExtent(vtkDataObject *dobj,
-  vtkCPInputDataDescription *desc)
+int CatalystAnalysisAdaptor::SetWholeExtent(const MeshMetadataPtr &md,
+  vtkDataObject *dobj, vtkCPInputDataDescription *desc)
 {
   int localExtent[6] = {0};
 
@@ -211,6 +254,26 @@ int CatalystAnalysisAdaptor::SetWholeExtent(vtkDataObject *dobj,
   else
     return 0;
 
+  // the metadata holds the cell extent of the whole mesh, points have one
+  // more layer in each direction that is not flat
+  if (VTKUtils::LogicallyCartesian(md) && !VTKUtils::AMR(md) &&
+    (md->Extent[0] <= md->Extent[1]))
+    {
+    int wholeExtent[6] = {0};
+    for (int d = 0; d < 3; ++d)
+      {
+      wholeExtent[2*d] = md->Extent[2*d];
+      wholeExtent[2*d+1] = md->Extent[2*d+1] +
+        (md->Extent[2*d] != md->Extent[2*d+1] ? 1 : 0);
+      }
+
+    desc->SetWholeExtent(wholeExtent);
+
+    return 0;
+    }
+
+  // the simulation did not provide the extent, on any rank, reduce the
+  // local extents
   localExtent[0] = -localExtent[0];
   localExtent[2] = -localExtent[2];
   localExtent[4] = -localExtent[4];
@@ -231,11 +294,47 @@ int CatalystAnalysisAdaptor::SetWholeExtent(vtkDataObject *dobj,
   return 0;
 }
 
+//----------------------------------------------------------------------------
+bool CatalystAnalysisAdaptor::WillExecute(long step, double time)
+{
+  TimeEvent<128> mark("CatalystAnalysisAdaptor::WillExecute");
+
+  // the data has not been described yet
+  if (!this->DataDescription)
+    return true;
+
+  this->DataDescription->ResetAll();
+  this->DataDescription->SetTimeData(time, step);
+
+  vtkCPProcessor *proc = vtkCPAdaptorAPI::GetCoProcessor();
+
+  return proc->RequestDataDescription(this->DataDescription);
+}
+
 //----------------------------------------------------------------------------
 bool CatalystAnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
 {
   TimeEvent<128> mark("CatalystAnalysisAdaptor::Execute");
 
+  this->Initialize();
+
+  double time = dataAdaptor->GetDataTime();
+  int timeStep = dataAdaptor->GetDataTimeStep();
+
+  vtkCPProcessor *proc = vtkCPAdaptorAPI::GetCoProcessor();
+
+  // ask the pipelines if they will run using the description made in an
+  // earlier step. on most steps nothing runs and nothing is fetched from
+  // the simulation
+  if (this->DataDescription)
+    {
+    this->DataDescription->ResetAll();
+    this->DataDescription->SetTimeData(time, timeStep);
+
+    if (!proc->RequestDataDescription(this->DataDescription))
+      return true;
+    }
+
   // Get a description of the simulation metadata
   unsigned int nMeshes = 0;
   if (dataAdaptor->GetNumberOfMeshes(nMeshes))
@@ -247,58 +346,117 @@ bool CatalystAnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
   std::vector<MeshMetadataPtr> metadata(nMeshes);
   for (unsigned int i = 0; i < nMeshes; ++i)
     {
-    MeshMetadataPtr mmd = MeshMetadata::New();
-
-    // for now, rather than querry metadata for whole extent
-    // use data object itself
-    //mmd->Flags.SetBlockExtents();
+    // the extents give the whole extent of logically Cartesian meshes
+    // without a collective
+    MeshMetadataFlags flags;
+    flags.SetBlockExtents();
 
-    if (dataAdaptor->GetMeshMetadata(i, mmd))
+    if (dataAdaptor->GetCachedMeshMetadata(i, flags, false, metadata[i]))
       {
       SENSEI_ERROR("Failed to get metadata for mesh " << i << " of " << nMeshes)
       return false;
       }
-    metadata[i] = mmd;
     }
 
-  double time = dataAdaptor->GetDataTime();
-  int timeStep = dataAdaptor->GetDataTimeStep();
+  // the meshes or arrays changed, describe them and ask again
+  if (!this->DataDescription || this->MetadataChanged(metadata))
+    {
+    this->ClearCache();
 
-  vtkSmartPointer<vtkCPDataDescription> dataDesc =
-    vtkSmartPointer<vtkCPDataDescription>::New();
+    this->Metadata = metadata;
+    this->DataDescription = vtkSmartPointer<vtkCPDataDescription>::New();
+
+    if (this->DescribeData(timeStep, time, metadata, this->DataDescription))
+      {
+      SENSEI_ERROR("Failed to describe simulation data")
+      this->ClearCache();
+      return false;
+      }
+
+    if (!proc->RequestDataDescription(this->DataDescription))
+      return true;
+    }
 
-  if (this->DescribeData(timeStep, time, metadata, dataDesc.GetPointer()))
+  // Querry Catalyst for what data is required, fetch from the sim
+  if (this->SelectData(dataAdaptor, metadata, this->DataDescription))
     {
-    SENSEI_ERROR("Failed to describe simulation data")
+    SENSEI_ERROR("Failed to selct data")
+    this->ReleaseData(metadata, this->DataDescription);
     return false;
     }
 
-  vtkCPProcessor *proc = vtkCPAdaptorAPI::GetCoProcessor();
-  if (proc->RequestDataDescription(dataDesc.GetPointer()))
+  // transfer control to Catalyst
+  proc->CoProcess(this->DataDescription);
+
+  this->ReleaseData(metadata, this->DataDescription);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void CatalystAnalysisAdaptor::ReleaseData(
+  const std::vector<MeshMetadataPtr> &metadata, vtkCPDataDescription *dataDesc)
+{
+  // static meshes are kept by the data adaptor, which removes their
+  // arrays when the step changes. they are shared with the other analyses
+  // and are left as is
+  unsigned int nMeshes = metadata.size();
+  for (unsigned int i = 0; i < nMeshes; ++i)
     {
-    // Querry Catalyst for what data is required, fetch from the sim
-    if (this->SelectData(dataAdaptor, metadata, dataDesc.GetPointer()))
-      {
-      SENSEI_ERROR("Failed to selct data")
-      return false;
-      }
+    const std::string &meshName = metadata[i]->MeshName;
 
-    // transfer control to Catalyst
-    proc->CoProcess(dataDesc.GetPointer());
+    vtkCPInputDataDescription *inDesc =
+      dataDesc->GetInputDescriptionByName(meshName.c_str());
+
+    if (inDesc && (this->StaticMeshes.find(meshName) == this->StaticMeshes.end()))
+      inDesc->SetGrid(nullptr);
     }
+}
 
-  return true;
+//----------------------------------------------------------------------------
+bool CatalystAnalysisAdaptor::MetadataChanged(
+  const std::vector<MeshMetadataPtr> &metadata) const
+{
+  unsigned int nMeshes = metadata.size();
+  if (nMeshes != this->Metadata.size())
+    return true;
+
+  for (unsigned int i = 0; i < nMeshes; ++i)
+    {
+    const MeshMetadataPtr &md = metadata[i];
+    const MeshMetadataPtr &cmd = this->Metadata[i];
+
+    if ((md->MeshName != cmd->MeshName) || (md->StaticMesh != cmd->StaticMesh) ||
+      (md->ArrayName != cmd->ArrayName) || (md->ArrayCentering != cmd->ArrayCentering))
+      return true;
+    }
+
+  return false;
+}
+
+//----------------------------------------------------------------------------
+void CatalystAnalysisAdaptor::ClearCache()
+{
+  this->DataDescription = nullptr;
+  this->Metadata.clear();
+  this->StaticMeshes.clear();
 }
 
 //-----------------------------------------------------------------------------
 int CatalystAnalysisAdaptor::Finalize()
 {
   TimeEvent<128> mark("CatalystAnalysisAdaptor::Finalize");
+  this->ClearCache();
+
+  if (!this->Initialized)
+    return 0;
+
   vtkCPAdaptorAPIInitializationCounter--;
   if (vtkCPAdaptorAPIInitializationCounter == 0)
     {
     vtkCPAdaptorAPI::CoProcessorFinalize();
     }
+  this->Initialized = false;
   return 0;
 }
 
@@ -4,7 +4,11 @@
 #include "AnalysisAdaptor.h"
 #include "MeshMetadata.h"
 
+#include <vtkSmartPointer.h>
+
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 class vtkCPDataDescription;
@@ -26,6 +30,13 @@ public:
   senseiTypeMacro(CatalystAnalysisAdaptor, AnalysisAdaptor);
   void PrintSelf(ostream& os, vtkIndent indent) override;
 
+  /// @brief Initialize the global Catalyst Co-Processor.
+  ///
+  /// This is done when the first pipeline is added, or at the first
+  /// execution. It may be called earlier to choose when the cost of
+  /// starting Catalyst is paid. Calling it again has no effect.
+  void Initialize();
+
   /// @brief Add a vtkCPPipeline subclass to the global Catalyst Co-Processor.
   ///
   /// Adds a vtkCPPipeline subclass to the global Catalyst Co-Processor.
@@ -34,6 +45,11 @@ public:
   /// Adds a pipeline initialized from a Catalyst python script
   virtual void AddPythonScriptPipeline(const std::string &fileName);
 
+  /// Asks the pipelines if they will run, using the description of the
+  /// data made in an earlier step. Before the first execution this
+  /// returns true.
+  bool WillExecute(long step, double time) override;
+
   bool Execute(DataAdaptor* data) override;
 
   int Finalize() override;
@@ -42,15 +58,42 @@ protected:
   CatalystAnalysisAdaptor();
   ~CatalystAnalysisAdaptor();
 
-  void Initialize();
-
   int DescribeData(int timeStep, double time,
     const std::vector<MeshMetadataPtr> &metadata, vtkCPDataDescription *dataDesc);
 
   int SelectData(DataAdaptor *dataAdaptor,
     const std::vector<MeshMetadataPtr> &reqs, vtkCPDataDescription *dataDesc);
 
-  int SetWholeExtent(vtkDataObject *dobj, vtkCPInputDataDescription *desc);
+  // set the whole extent of a logically Cartesian mesh from the metadata.
+  // only when the simulation does not provide it is it reduced over the
+  // ranks from the local extents
+  int SetWholeExtent(const MeshMetadataPtr &md, vtkDataObject *dobj,
+    vtkCPInputDataDescription *desc);
+
+  // drop references to the simulation's data once Catalyst is done with
+  // it. the geometry of static meshes is kept for use in the next step
+  void ReleaseData(const std::vector<MeshMetadataPtr> &metadata,
+    vtkCPDataDescription *dataDesc);
+
+  // true if the meshes or arrays in the metadata differ from those that
+  // the cached description was made from
+  bool MetadataChanged(const std::vector<MeshMetadataPtr> &metadata) const;
+
+  // discard the cached description and meshes
+  void ClearCache();
+
+  // the description is made once and reused for as long as the meshes
+  // and arrays do not change. this lets Catalyst be asked if anything will
+  // run before any metadata or data is fetched from the simulation.
+  vtkSmartPointer<vtkCPDataDescription> DataDescription;
+  std::vector<MeshMetadataPtr> Metadata;
+
+  // the static meshes given to Catalyst. the data adaptor returns the
+  // same objects while they are static, arrays are swapped in at each step
+  std::map<std::string, vtkSmartPointer<vtkDataObject>> StaticMeshes;
+
+  // set once this instance holds a reference to the Co-Processor
+  bool Initialized;
 
 private:
   CatalystAnalysisAdaptor(const CatalystAnalysisAdaptor&); // Not implemented.
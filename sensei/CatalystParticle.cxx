@@ -54,11 +54,16 @@ public:
   std::string ImageFileName;
   int ImageSize[2];
 
+  double RenderThreshold;
+  bool FixedCamera;
+  bool CameraPlaced;
+
   vtkInternals() : PipelineCreated(false), ColorAssociation(0),
     ParticleStyle("Sphere"), ParticleRadius(1.0f),
     CameraPosition(1.f,1.f,1.f), CameraFocus(0.f,0.f,0.f),
     ShouldResetCamera(true),
-    UseLogScale(false), AutoColorRange(true)
+    UseLogScale(false), AutoColorRange(true), RenderThreshold(-1.0),
+    FixedCamera(false), CameraPlaced(false)
   {
     this->ColorRange[0] = 0; this->ColorRange[1] = 1.0;
     this->ImageSize[0] = this->ImageSize[1] = 800;
@@ -87,6 +92,7 @@ public:
         vtkSMPropertyHelper(this->RenderView, "ViewTime").Set(time);
         vtkSMPropertyHelper(this->RenderView, "ViewSize").Set(this->ImageSize, 2);
         this->RenderView->UpdateVTKObjects();
+        catalyst::SetRenderThreshold(this->RenderView, this->RenderThreshold);
 
         this->ParticleRepresentation = catalyst::Show(this->TrivialProducer, this->RenderView);
         vtkSMPropertyHelper(this->ParticleRepresentation, "Representation").Set("Point Gaussian"); // .Set("3D Glyphs");
@@ -102,11 +108,6 @@ public:
       vtkPVTrivialProducer *tp = vtkPVTrivialProducer::SafeDownCast(
         this->TrivialProducer->GetClientSideObject());
       tp->SetOutput(data, time);
-
-      this->Particle = catalyst::CreatePipelineProxy("filters", "Glyph", this->TrivialProducer);
-      // vtkSMPropertyHelper(this->Particle, "GlyphType").Set("Sphere");
-      this->Particle->UpdateVTKObjects();
-      this->PipelineCreated = true;
       }
 
     vtkMultiProcessController* controller = vtkMultiProcessController::GetGlobalController();
@@ -155,14 +156,20 @@ public:
           ulsHelper.Set(use_log_scale? 1 : 0);
           }
         }
-      vtkSMRenderViewProxy* renderViewProxy = vtkSMRenderViewProxy::SafeDownCast(this->RenderView);
-      vtkSMPropertyHelper(renderViewProxy, "CameraPosition").Set(this->CameraPosition.GetData(), 3);
-      vtkSMPropertyHelper(renderViewProxy, "CameraFocalPoint").Set(this->CameraFocus.GetData(), 3);
+      // resetting the camera gathers the bounds from all ranks, with a fixed
+      // camera this is done once
+      if (!this->FixedCamera || !this->CameraPlaced)
+        {
+        vtkSMRenderViewProxy* renderViewProxy = vtkSMRenderViewProxy::SafeDownCast(this->RenderView);
+        vtkSMPropertyHelper(renderViewProxy, "CameraPosition").Set(this->CameraPosition.GetData(), 3);
+        vtkSMPropertyHelper(renderViewProxy, "CameraFocalPoint").Set(this->CameraFocus.GetData(), 3);
 
-      if (this->ShouldResetCamera)
-      {
-        renderViewProxy->ResetCamera();
-      }
+        if (this->ShouldResetCamera)
+          {
+          renderViewProxy->ResetCamera();
+          }
+        this->CameraPlaced = true;
+        }
 
       std::string filename = this->ImageFileName;
 
@@ -359,4 +366,18 @@ bool CatalystParticle::GetUseLogScale() const
   return internals.UseLogScale;
 }
 
+//----------------------------------------------------------------------------
+void CatalystParticle::SetRenderThreshold(double megabytes)
+{
+  vtkInternals& internals = (*this->Internals);
+  internals.RenderThreshold = megabytes;
+}
+
+//----------------------------------------------------------------------------
+void CatalystParticle::SetFixedCamera(bool val)
+{
+  vtkInternals& internals = (*this->Internals);
+  internals.FixedCamera = val;
+}
+
 }
@@ -76,6 +76,18 @@ public:
   void SetUseLogScale(bool val);
   bool GetUseLogScale() const;
 
+  /// @brief Set the geometry size, in megabytes, below which rendering is
+  /// done on a single rank.
+  ///
+  /// Geometry smaller than the threshold is gathered to one rank and
+  /// rendered there, skipping parallel image compositing. This is usually
+  /// faster for small extracts. A negative value keeps ParaView's default.
+  void SetRenderThreshold(double megabytes);
+
+  /// @brief When set to true, the camera is placed on the first time step
+  /// only and reused after that. Default: false.
+  void SetFixedCamera(bool val);
+
   int RequestDataDescription(vtkCPDataDescription* dataDesc) override;
   int CoProcess(vtkCPDataDescription* dataDesc) override;
   int Finalize() override;
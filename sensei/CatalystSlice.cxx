@@ -50,8 +50,13 @@ public:
   std::string ImageFileName;
   int ImageSize[2];
 
+  double RenderThreshold;
+  bool FixedCamera;
+  bool CameraPlaced;
+
   vtkInternals() : PipelineCreated(false), ColorAssociation(0),
-    AutoCenter(true), UseLogScale(false), AutoColorRange(true)
+    AutoCenter(true), UseLogScale(false), AutoColorRange(true),
+    RenderThreshold(-1.0), FixedCamera(false), CameraPlaced(false)
   {
     this->Origin[0] = this->Origin[1] = this->Origin[2] = 0.0;
     this->Normal[0] = this->Normal[1] = 0.0; this->Normal[2] = 1.0;
@@ -89,6 +94,7 @@ public:
         vtkSMPropertyHelper(this->RenderView, "ViewTime").Set(time);
         vtkSMPropertyHelper(this->RenderView, "ViewSize").Set(this->ImageSize, 2);
         this->RenderView->UpdateVTKObjects();
+        catalyst::SetRenderThreshold(this->RenderView, this->RenderThreshold);
 
         this->SliceRepresentation = catalyst::Show(this->Slice, this->RenderView);
         }
@@ -172,12 +178,18 @@ public:
           ulsHelper.Set(use_log_scale? 1 : 0);
           }
         }
-      vtkSMRenderViewProxy* renderViewProxy = vtkSMRenderViewProxy::SafeDownCast(this->RenderView);
-      double position[3] = {0, 0, 0};
-      vtkSMPropertyHelper(renderViewProxy, "CameraPosition").Set(position, 3);
-      vtkSMPropertyHelper(renderViewProxy, "CameraFocalPoint").Set(this->Normal, 3);
+      // resetting the camera gathers the bounds from all ranks, with a fixed
+      // camera this is done once
+      if (!this->FixedCamera || !this->CameraPlaced)
+        {
+        vtkSMRenderViewProxy* renderViewProxy = vtkSMRenderViewProxy::SafeDownCast(this->RenderView);
+        double position[3] = {0, 0, 0};
+        vtkSMPropertyHelper(renderViewProxy, "CameraPosition").Set(position, 3);
+        vtkSMPropertyHelper(renderViewProxy, "CameraFocalPoint").Set(this->Normal, 3);
 
-      renderViewProxy->ResetCamera();
+        renderViewProxy->ResetCamera();
+        this->CameraPlaced = true;
+        }
 
       std::string filename = this->ImageFileName;
 
@@ -364,4 +376,18 @@ bool CatalystSlice::GetUseLogScale() const
   return internals.UseLogScale;
 }
 
+//----------------------------------------------------------------------------
+void CatalystSlice::SetRenderThreshold(double megabytes)
+{
+  vtkInternals& internals = (*this->Internals);
+  internals.RenderThreshold = megabytes;
+}
+
+//----------------------------------------------------------------------------
+void CatalystSlice::SetFixedCamera(bool val)
+{
+  vtkInternals& internals = (*this->Internals);
+  internals.FixedCamera = val;
+}
+
 }
@@ -7,6 +7,7 @@
 #include <vtkSMProxyManager.h>
 #include <vtkSMSessionProxyManager.h>
 #include <vtkSMSourceProxy.h>
+#include <vtkSMViewProxy.h>
 
 #include <vtkSMParaViewPipelineControllerWithRendering.h>
 #include <vtkSMRenderViewProxy.h>
@@ -69,6 +70,7 @@ vtkSMViewProxy* CreateViewProxy(const char* group, const char* name)
   return vtkSMViewProxy::SafeDownCast(proxy);
 }
 
+// --------------------------------------------------------------------------
 vtkSMRepresentationProxy* Show(vtkSMSourceProxy* producer, vtkSMViewProxy* view)
 {
   vtkNew<vtkSMParaViewPipelineControllerWithRendering> controller;
@@ -76,5 +78,16 @@ vtkSMRepresentationProxy* Show(vtkSMSourceProxy* producer, vtkSMViewProxy* view)
     controller->Show(producer, 0, view));
 }
 
+// --------------------------------------------------------------------------
+void SetRenderThreshold(vtkSMViewProxy* view, double megabytes)
+{
+  if (!view || (megabytes < 0.0))
+    {
+    return;
+    }
+  vtkSMPropertyHelper(view, "RemoteRenderThreshold").Set(megabytes);
+  view->UpdateVTKObjects();
+}
+
 }
 }
@@ -22,6 +22,11 @@ vtkSMViewProxy* CreateViewProxy(const char* group,
 vtkSMRepresentationProxy* Show(vtkSMSourceProxy* producer,
   vtkSMViewProxy* view);
 
+// Set the geometry size, in megabytes, below which a render view gathers
+// the geometry to a single rank and renders it there without parallel
+// image compositing. A negative value keeps ParaView's default.
+void SetRenderThreshold(vtkSMViewProxy* view, double megabytes);
+
 }
 }
 
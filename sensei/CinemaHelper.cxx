@@ -5,7 +5,13 @@
 #include <map>
 #include <math.h>
 #include <sstream>
+#include <fstream>
 #include <algorithm>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include <vtksys/SystemTools.hxx>
 
@@ -32,6 +38,8 @@
 #  include <vtkRenderWindow.h>
 #  include <vtkRenderer.h>
 #  include <vtkWindowToImageFilter.h>
+#  include <vtkJPEGWriter.h>
+#  include <vtkPNGWriter.h>
 #endif
 #ifdef ENABLE_CATALYST
 #  include <vtkIceTCompositePass.h>
@@ -272,9 +280,23 @@ struct CinemaHelper::Internals
   std::string JSONExtraMetadata;
   std::vector<std::string> JSONPipeline;
   std::vector<std::string> JSONCompositePipeline;
-
-
-  Internals() : NumberOfTimeSteps(0), NumberOfCameraPositions(0), CameraPositions(nullptr), NumberOfCameraArgs(0), CameraArgs(nullptr), CurrentCameraPosition(0), LAYER_CODES("ABCDEFGHIJKLMNOPQRSTUVWXYZ")
+  // Background encoding. Images are queued by the calling thread and
+  // encoded and written by the encoder threads. The queue holds at most
+  // two images per thread so that memory stays bounded.
+  int NumberOfEncoderThreads;
+  bool RawLayers;
+  std::vector<std::thread> Encoders;
+  std::deque<std::function<void()>> EncodeQueue;
+  unsigned int NumberEncoding;
+  bool StopEncoding;
+  std::mutex EncodeMutex;
+  std::condition_variable EncodeCond;
+  // serializes writes to the aggregated raw layer files
+  std::mutex RawMutex;
+
+
+  Internals() : NumberOfTimeSteps(0), NumberOfCameraPositions(0), CameraPositions(nullptr), NumberOfCameraArgs(0), CameraArgs(nullptr), CurrentCameraPosition(0), LAYER_CODES("ABCDEFGHIJKLMNOPQRSTUVWXYZ"),
+    NumberOfEncoderThreads(0), RawLayers(false), NumberEncoding(0), StopEncoding(false)
   {
     this->ImageSize[0] = this->ImageSize[1] = 512;
     this->SampleSize = 1024;
@@ -290,6 +312,7 @@ struct CinemaHelper::Internals
 
   ~Internals()
   {
+    this->StopEncoders();
     if (this->CameraPositions)
     {
       delete[] this->CameraPositions;
@@ -300,6 +323,94 @@ struct CinemaHelper::Internals
     }
   }
 
+  // queue a job for the encoder threads, starting them on first use.
+  // blocks while the queue is full.
+  void Encode(std::function<void()> job)
+  {
+    if (this->NumberOfEncoderThreads < 1)
+    {
+      job();
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(this->EncodeMutex);
+
+    if (this->Encoders.empty())
+    {
+      this->StopEncoding = false;
+      for (int i = 0; i < this->NumberOfEncoderThreads; ++i)
+      {
+        this->Encoders.emplace_back([this]()
+        {
+          std::unique_lock<std::mutex> elock(this->EncodeMutex);
+          while (true)
+          {
+            this->EncodeCond.wait(elock, [this]() -> bool
+              { return this->StopEncoding || !this->EncodeQueue.empty(); });
+
+            if (this->EncodeQueue.empty())
+              return;
+
+            std::function<void()> next = std::move(this->EncodeQueue.front());
+            this->EncodeQueue.pop_front();
+            ++this->NumberEncoding;
+            this->EncodeCond.notify_all();
+
+            elock.unlock();
+            next();
+            elock.lock();
+
+            --this->NumberEncoding;
+            this->EncodeCond.notify_all();
+          }
+        });
+      }
+    }
+
+    size_t maxQueued = 2 * this->Encoders.size();
+    this->EncodeCond.wait(lock, [this, maxQueued]() -> bool
+      { return this->EncodeQueue.size() < maxQueued; });
+
+    this->EncodeQueue.push_back(std::move(job));
+    this->EncodeCond.notify_all();
+  }
+
+  // wait for the queued jobs to complete
+  void FlushEncoders()
+  {
+    std::unique_lock<std::mutex> lock(this->EncodeMutex);
+    this->EncodeCond.wait(lock, [this]() -> bool
+      { return this->EncodeQueue.empty() && (this->NumberEncoding == 0); });
+  }
+
+  // complete the queued jobs and join the encoder threads
+  void StopEncoders()
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->EncodeMutex);
+      this->StopEncoding = true;
+    }
+    this->EncodeCond.notify_all();
+
+    for (size_t i = 0; i < this->Encoders.size(); ++i)
+    {
+      this->Encoders[i].join();
+    }
+    this->Encoders.clear();
+  }
+
+  // the directory of the current time step
+  std::string getTimeStepDirectory(bool createDirectory)
+  {
+    std::ostringstream resultPath;
+    resultPath << this->WorkingDirectory << "/" << this->NumberOfTimeSteps;
+    if (createDirectory)
+    {
+      vtksys::SystemTools::MakeDirectory(resultPath.str().c_str());
+    }
+    return resultPath.str();
+  }
+
   std::string getDataAbsoluteFilePath(const std::string &fileName, bool createDirectory)
   {
     std::ostringstream resultPath;
@@ -492,6 +603,25 @@ void CinemaHelper::SetSampleSize(int ssz)
   this->Data->SampleSize = ssz;
 }
 
+// --------------------------------------------------------------------------
+void CinemaHelper::SetNumberOfEncoderThreads(int n)
+{
+  this->Data->StopEncoders();
+  this->Data->NumberOfEncoderThreads = std::max(0, n);
+}
+
+// --------------------------------------------------------------------------
+void CinemaHelper::SetWriteRawLayers(bool enable)
+{
+  this->Data->RawLayers = enable;
+}
+
+// --------------------------------------------------------------------------
+void CinemaHelper::Flush()
+{
+  this->Data->FlushEncoders();
+}
+
 // --------------------------------------------------------------------------
 void CinemaHelper::AddTimeEntry()
 {
@@ -1178,6 +1308,114 @@ vtkImageData* CinemaHelper::CaptureWindow(vtkRenderWindow* renderWindow)
   capture->ShallowCopy(w2i->GetOutput());
   return capture;
 }
+
+// --------------------------------------------------------------------------
+static bool isSupportedImageWriter(const std::string& writerName)
+{
+  return (writerName == "vtkJPEGWriter") || (writerName == "vtkPNGWriter");
+}
+
+// --------------------------------------------------------------------------
+static void writeImageFile(vtkImageData* image, const std::string& path, const std::string& writerName)
+{
+  vtkSmartPointer<vtkImageWriter> writer;
+  if (writerName == "vtkPNGWriter")
+    {
+    writer = vtkSmartPointer<vtkPNGWriter>::New();
+    }
+  else
+    {
+    writer = vtkSmartPointer<vtkJPEGWriter>::New();
+    }
+
+  writer->SetInputData(image);
+  writer->SetFileName(path.c_str());
+  writer->Write();
+}
+
+// --------------------------------------------------------------------------
+void CinemaHelper::WriteImage(vtkImageData* image, const std::string& fileName, const std::string& writerName, bool createDirectory)
+{
+  if (!image || !this->Data->IsRoot)
+    {
+    return;
+    }
+
+  if (!isSupportedImageWriter(writerName))
+    {
+    std::cout << "Unsupported image writer: " << writerName << std::endl;
+    return;
+    }
+
+  // the path depends on the current time step and camera position and is
+  // resolved now. the caller is free to reuse the image once we return
+  std::string path = this->Data->getDataAbsoluteFilePath(fileName, createDirectory);
+
+  vtkSmartPointer<vtkImageData> copy = vtkSmartPointer<vtkImageData>::New();
+  copy->ShallowCopy(image);
+
+  this->Data->Encode([copy, path, writerName]()
+    {
+    writeImageFile(copy, path, writerName);
+    });
+}
+
+// --------------------------------------------------------------------------
+void CinemaHelper::CaptureDepth(vtkRenderWindow* renderWindow)
+{
+  if (!this->Data->IsRoot)
+    {
+    return;
+    }
+
+  int* size = renderWindow->GetSize();
+  vtkIdType nPixels = static_cast<vtkIdType>(size[0]) * size[1];
+
+  vtkSmartPointer<vtkFloatArray> depth = vtkSmartPointer<vtkFloatArray>::New();
+  renderWindow->GetZbufferData(0, 0, size[0] - 1, size[1] - 1, depth);
+
+  // camera position i occupies values [i*width*height, (i+1)*width*height)
+  // of the step's file. the layout is described next to it once per step
+  std::string dir = this->Data->getTimeStepDirectory(true);
+  std::string fileName = dir + "/depth.float32";
+  long long offset = static_cast<long long>(this->Data->CurrentCameraPosition) * nPixels * sizeof(float);
+
+  if (this->Data->CurrentCameraPosition == 0)
+    {
+    std::ofstream fp((dir + "/depth.json").c_str(), ios::out);
+    fp << "{" << endl
+      << "  \"file\": \"depth.float32\"," << endl
+      << "  \"dataType\": \"Float32Array\"," << endl
+      << "  \"encode\": \"LittleEndian\"," << endl
+      << "  \"dimensions\": [" << size[0] << ", " << size[1] << "]," << endl
+      << "  \"numberOfCameraPositions\": " << std::max(1, this->Data->NumberOfCameraPositions) << endl
+      << "}" << endl;
+    }
+
+  Internals* data = this->Data;
+  this->Data->Encode([data, depth, fileName, offset]()
+    {
+    std::lock_guard<std::mutex> lock(data->RawMutex);
+
+    // open without truncating the values of other camera positions
+    std::fstream fp(fileName.c_str(), ios::in | ios::out | ios::binary);
+    if (!fp.is_open())
+      {
+      fp.clear();
+      fp.open(fileName.c_str(), ios::out | ios::binary);
+      }
+
+    if (fp.fail())
+      {
+      std::cout << "Unable to open file: "<< fileName.c_str() << std::endl;
+      return;
+      }
+
+    fp.seekp(offset);
+    fp.write(reinterpret_cast<const char*>(depth->GetPointer(0)), depth->GetNumberOfValues() * sizeof(float));
+    fp.close();
+    });
+}
 #endif
 
 #ifdef ENABLE_CATALYST
@@ -1360,24 +1598,51 @@ void CinemaHelper::CaptureSortedCompositeData(vtkRenderWindow* renderWindow, vtk
 // --------------------------------------------------------------------------
 void CinemaHelper::CaptureImage(vtkSMViewProxy* view, const std::string fileName, const std::string writerName, double scale, bool createDirectory)
 {
-  view->WriteImage(this->Data->getDataAbsoluteFilePath(fileName, createDirectory).c_str(), writerName.c_str(), scale);
+  if ((this->Data->NumberOfEncoderThreads > 0) && isSupportedImageWriter(writerName))
+    {
+    // grab the framebuffer now, it is encoded and written in the
+    // background while the next camera position renders
+    vtkImageData* image = view->CaptureImage(std::max(1, static_cast<int>(scale)));
+    this->WriteImage(image, fileName, writerName, createDirectory);
+    if (image)
+      {
+      image->Delete();
+      }
+    }
+  else
+    {
+    view->WriteImage(this->Data->getDataAbsoluteFilePath(fileName, createDirectory).c_str(), writerName.c_str(), scale);
+    }
+
+  vtkSMRenderViewProxy* renderView = vtkSMRenderViewProxy::SafeDownCast(view);
+  if (this->Data->RawLayers && renderView)
+    {
+    this->CaptureDepth(renderView->GetRenderWindow());
+    }
 }
 #endif // ENABLE_CATALYST
 
 // --------------------------------------------------------------------------
 void CinemaHelper::WriteVolume(vtkImageData* image)
 {
-  std::string jsonName = "volume.json";
-  std::string dataName = "volume.data";
+  this->WriteVolume(image, "volume");
+}
+
+// --------------------------------------------------------------------------
+void CinemaHelper::WriteVolume(vtkImageData* image, const std::string& baseName)
+{
+  std::string jsonName = baseName + ".json";
+  std::string dataName = baseName + ".data";
+  std::string refName = dataName;
 
   if (!this->Data->IsRoot)
     {
       std::ostringstream json;
-      json << "volume_" << this->Data->PID << ".json";
+      json << baseName << "_" << this->Data->PID << ".json";
       jsonName = json.str();
 
       std::ostringstream data;
-      data << "volume_" << this->Data->PID << ".data";
+      data << baseName << "_" << this->Data->PID << ".data";
       dataName = data.str();
     }
 
@@ -1419,7 +1684,7 @@ void CinemaHelper::WriteVolume(vtkImageData* image)
     jsonFilePointer << "                    \"registration\": \"setScalars\"," << endl;
     jsonFilePointer << "                    \"encode\": \"LittleEndian\"," << endl;
     jsonFilePointer << "                    \"basepath\": \"" << this->Data->NumberOfTimeSteps << "\"," << endl;
-    jsonFilePointer << "                    \"id\": \"volume.data\"" << endl;
+    jsonFilePointer << "                    \"id\": \"" << refName << "\"" << endl;
     jsonFilePointer << "                }," << endl;
     jsonFilePointer << "                \"size\": "<< array->GetNumberOfValues() << endl;
     jsonFilePointer << "            }" << endl;
@@ -1430,22 +1695,27 @@ void CinemaHelper::WriteVolume(vtkImageData* image)
     jsonFilePointer.close();
     }
 
-  // Write volume.data
+  // Write volume.data, in the background when there are encoder threads.
+  // the array is referenced until it is written
   std::string dataFileName = this->Data->getDataAbsoluteFilePath(dataName, true);
-  // std::cout << "write volume: " << dataFileName.c_str() << std::endl;
-  std::ofstream filePointer(dataFileName.c_str(), ios::out | ios::binary);
+  vtkSmartPointer<vtkFloatArray> values = array;
 
-  if (filePointer.fail())
-    {
-    std::cout << "Unable to open file: "<< dataFileName.c_str() << std::endl;
-    }
-  else
+  this->Data->Encode([values, dataFileName]()
     {
-    int stackSize = array->GetNumberOfTuples() * 4;
-    filePointer.write((char*)array->GetVoidPointer(0), stackSize);
-    filePointer.flush();
-    filePointer.close();
-    }
+    std::ofstream filePointer(dataFileName.c_str(), ios::out | ios::binary);
+
+    if (filePointer.fail())
+      {
+      std::cout << "Unable to open file: "<< dataFileName.c_str() << std::endl;
+      }
+    else
+      {
+      int stackSize = values->GetNumberOfTuples() * 4;
+      filePointer.write((char*)values->GetVoidPointer(0), stackSize);
+      filePointer.flush();
+      filePointer.close();
+      }
+    });
 }
 
 void CinemaHelper::WriteCDF(long long totalArraySize, const double* cdfValues)
@@ -1456,39 +1726,50 @@ void CinemaHelper::WriteCDF(long long totalArraySize, const double* cdfValues)
   }
   std::string dataName = "cdf.float32";
   std::string dataFilePath = this->Data->getDataAbsoluteFilePath(dataName, true);
-  std::ofstream dataFilePathPointer(dataFilePath.c_str(), std::ios::out | std::ios::binary);
-  if (dataFilePathPointer.fail())
+
+  // the values are converted now, the caller is free to reuse them, and
+  // written in the background when there are encoder threads
+  std::vector<float> cdfFloats(cdfValues, cdfValues + this->Data->SampleSize);
+  this->Data->Encode([cdfFloats, dataFilePath]()
   {
-    std::cout << "Unable to open file: " << dataFilePath.c_str() << std::endl;
-  }
-  else
+    std::ofstream dataFilePathPointer(dataFilePath.c_str(), std::ios::out | std::ios::binary);
+    if (dataFilePathPointer.fail())
+    {
+      std::cout << "Unable to open file: " << dataFilePath.c_str() << std::endl;
+    }
+    else
+    {
+      long long stackSize = cdfFloats.size() * 4;
+      dataFilePathPointer.write((const char*)cdfFloats.data(), stackSize);
+      dataFilePathPointer.flush();
+      dataFilePathPointer.close();
+    }
+  });
+
+  this->Data->JSONData["cdf"] =
+    "{\n"
+    "    \"pattern\": \"{time}/cdf.float32\",\n"
+    "    \"name\": \"cdf\",\n"
+    "    \"type\": \"arraybuffer\"\n"
+    "}\n"
+    ;
+  std::ostringstream xmeta;
+  xmeta << "   ,\"totalCount\": " << totalArraySize;
+  this->Data->JSONExtraMetadata = xmeta.str();
+}
+
+// --------------------------------------------------------------------------
+void CinemaHelper::AddCDFErrorBound(double sampleFraction, long long sampleCount, double bound)
+{
+  if (!this->Data->IsRoot)
   {
-    long long stackSize = this->Data->SampleSize * 4;
-    std::vector<float> cdfFloats(cdfValues, cdfValues + this->Data->SampleSize);
-    /*
-    float* cdfFloats = new float[cdfSize];
-    for (int i = 0; i < cdfSize; i++)
-    {
-    cdfFloats[i] = (float)cdfValues[i];
-    }
-
-    dataFilePathPointer.write((char*)cdfFloats, stackSize);
-    */
-    dataFilePathPointer.write((char*)&cdfFloats[0], stackSize);
-    dataFilePathPointer.flush();
-    dataFilePathPointer.close();
-    this->Data->JSONData["cdf"] =
-      "{\n"
-      "    \"pattern\": \"{time}/cdf.float32\",\n"
-      "    \"name\": \"cdf\",\n"
-      "    \"type\": \"arraybuffer\"\n"
-      "}\n"
-      ;
-    std::ostringstream xmeta;
-    xmeta << "   ,\"totalCount\": " << totalArraySize;
-    this->Data->JSONExtraMetadata = xmeta.str();
-    //delete[] cdfFloats;
+    return;
   }
+  std::ostringstream xmeta;
+  xmeta << "\n   ,\"sampleFraction\": " << sampleFraction
+        << "\n   ,\"sampleCount\": " << sampleCount
+        << "\n   ,\"cdfErrorBound\": " << bound;
+  this->Data->JSONExtraMetadata += xmeta.str();
 }
 
 }
@@ -32,6 +32,18 @@ public:
     void AddTimeEntry();
     void WriteMetadata();
 
+    // Background encoding. When n > 0 captured images, volumes and CDFs
+    // are encoded and written by n threads while the caller goes on, for
+    // instance to render the next camera position. The default, 0, writes
+    // on the calling thread.
+    void SetNumberOfEncoderThreads(int n);
+    // When enabled CaptureImage also writes the depth buffer of each
+    // camera position, see CaptureDepth.
+    void SetWriteRawLayers(bool enable);
+    // Wait for the queued images to be written. Call before WriteMetadata
+    // and before releasing the data passed to WriteVolume.
+    void Flush();
+
     // Camera handling
     void SetCameraConfig(const std::string& config);
     int GetNumberOfCameraPositions();
@@ -68,6 +80,13 @@ public:
 #if defined(ENABLE_CATALYST) || defined (ENABLE_VTK_RENDERING)
     void Render(vtkRenderWindow* renderWindow);
     vtkImageData* CaptureWindow(vtkRenderWindow* renderWindow);
+    // Encode and write an image, such as one returned by CaptureWindow, for
+    // the current camera position. writerName is vtkJPEGWriter or vtkPNGWriter.
+    void WriteImage(vtkImageData* image, const std::string& fileName, const std::string& writerName, bool createDirectory = true);
+    // Write the depth buffer of the current camera position as raw float32
+    // values into the time step's depth.float32 file, camera position i
+    // starting at value i*width*height. depth.json describes the layout.
+    void CaptureDepth(vtkRenderWindow* renderWindow);
 #endif
 
 #ifdef ENABLE_CATALYST
@@ -80,10 +99,17 @@ public:
 
     // Volume handling
     void WriteVolume(vtkImageData* image);
+    // write the volume to files named after the base name, ranks other than
+    // the root append their rank
+    void WriteVolume(vtkImageData* image, const std::string& baseName);
 
     // CDF handling
     void WriteCDF(long long totalArraySize, const double* cdfValues);
 
+    // record, after WriteCDF, that the CDF was estimated from a sample and
+    // the 95% bound on the error of its probabilities
+    void AddCDFErrorBound(double sampleFraction, long long sampleCount, double bound);
+
 private:
     struct Internals;
     Internals *Data;
@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
 #include <sstream>
 
 #include <conduit_blueprint.hpp>
@@ -15,6 +18,8 @@
 #include <vtkUnsignedLongLongArray.h>
 #include <vtkFloatArray.h>
 #include <vtkDoubleArray.h>
+#include <vtkSOADataArrayTemplate.h>
+#include "StridedDataArray.h"
 
 #include <vtkDataSetAttributes.h>
 #include <vtkImageData.h>
@@ -30,6 +35,7 @@
 #include <vtkPoints.h>
 #include <vtkPointData.h>
 
+#include <vtkType.h>
 #include <vtkRectilinearGrid.h>
 #include <vtkStructuredGrid.h>
 #include <vtkUnstructuredGrid.h>
@@ -45,7 +51,9 @@ namespace sensei
 senseiNewMacro(ConduitDataAdaptor);
 
 //-----------------------------------------------------------------------------
-ConduitDataAdaptor::ConduitDataAdaptor()
+ConduitDataAdaptor::ConduitDataAdaptor() : HaveFields(false), Fingerprint(0),
+  HaveBlockLayout(false), NumLocalBlocks(0), NumGlobalBlocks(0),
+  BlockOffset(0), Node(nullptr)
 {
 }
 
@@ -123,6 +131,83 @@ template<typename T> void Blueprint_MultiCompArray_To_VTKDataArray( const condui
   }
 }
 
+//-----------------------------------------------------------------------------
+// Wrap the Conduit buffers in a VTK array without copying. A compact array,
+// or an mcarray with interleaved components, becomes an AOS array, and an
+// mcarray with a compact buffer per component becomes an SOA array. A
+// single array with a stride, such as a slice of a larger array, becomes a
+// StridedDataArray. The Conduit node keeps ownership and must outlive the
+// VTK array. Other layouts are copied.
+template<typename T, typename array_t> vtkDataArray *Blueprint_MultiCompArray_Wrap_VTKDataArray( const conduit::Node &n, int ncomps, int ntuples )
+{
+  if( n.number_of_children() == 0 )
+  {
+    if( n.dtype().is_compact() )
+    {
+      array_t *aos = array_t::New();
+      aos->SetArray( static_cast<T*>( const_cast<void*>( n.element_ptr(0) ) ), ntuples, 1 );
+      return aos;
+    }
+
+    const conduit::DataType &dt = n.dtype();
+    if( ( dt.element_bytes() == (conduit::index_t)sizeof(T) ) && dt.endianness_matches_machine() )
+    {
+      sensei::StridedDataArray<T> *sa = sensei::StridedDataArray<T>::New();
+      sa->SetArray( static_cast<T*>( const_cast<void*>( n.element_ptr(0) ) ), ntuples, 1, dt.stride() );
+      return sa;
+    }
+  }
+  else
+  {
+    bool compact = true;
+    bool interleaved = ( ncomps != 2 );
+    const char *base = static_cast<const char*>( n[0].element_ptr(0) );
+    for(int c=0; c < ncomps ;++c)
+    {
+      const conduit::DataType &dt = n[c].dtype();
+      compact = compact && dt.is_compact();
+      interleaved = interleaved &&
+        ( dt.stride() == (conduit::index_t)( ncomps*sizeof(T) ) ) &&
+        ( static_cast<const char*>( n[c].element_ptr(0) ) == base + c*sizeof(T) );
+    }
+
+    if( interleaved )
+    {
+      array_t *aos = array_t::New();
+      aos->SetNumberOfComponents( ncomps );
+      aos->SetArray( const_cast<T*>( reinterpret_cast<const T*>( base ) ), ntuples*ncomps, 1 );
+      return aos;
+    }
+
+    if( compact )
+    {
+      // we need 3 comps for vectors, VTK owns the padding
+      int vtk_ncomps = ( ncomps == 2 ) ? 3 : ncomps;
+
+      vtkSOADataArrayTemplate<T> *soa = vtkSOADataArrayTemplate<T>::New();
+      soa->SetNumberOfComponents( vtk_ncomps );
+
+      for(int c=0; c < ncomps ;++c)
+      {
+        soa->SetArray( c, static_cast<T*>( const_cast<void*>( n[c].element_ptr(0) ) ),
+          ntuples, c == vtk_ncomps - 1, true );
+      }
+
+      if( vtk_ncomps != ncomps )
+      {
+        T *zeros = static_cast<T*>( calloc( ntuples, sizeof(T) ) );
+        soa->SetArray( 2, zeros, ntuples, true, false, vtkAbstractArray::VTK_DATA_ARRAY_FREE );
+      }
+
+      return soa;
+    }
+  }
+
+  array_t *copy = array_t::New();
+  Blueprint_MultiCompArray_To_VTKDataArray<T>( n, ncomps, ntuples, copy );
+  return copy;
+}
+
 //-----------------------------------------------------------------------------
 vtkDataArray * ConduitArrayToVTKDataArray( const conduit::Node &n )
 {
@@ -158,48 +243,39 @@ vtkDataArray * ConduitArrayToVTKDataArray( const conduit::Node &n )
     
   if( vals_dtype.is_unsigned_char() )
   {
-    retval = vtkUnsignedCharArray::New();
-    Blueprint_MultiCompArray_To_VTKDataArray<CONDUIT_NATIVE_UNSIGNED_CHAR>( n, ncomps, ntuples, retval );
+    retval = Blueprint_MultiCompArray_Wrap_VTKDataArray<CONDUIT_NATIVE_UNSIGNED_CHAR, vtkUnsignedCharArray>( n, ncomps, ntuples );
   }
   else if( vals_dtype.is_unsigned_short() )
   {
-    retval = vtkUnsignedShortArray::New();
-    Blueprint_MultiCompArray_To_VTKDataArray<CONDUIT_NATIVE_UNSIGNED_SHORT>( n, ncomps, ntuples, retval );
+    retval = Blueprint_MultiCompArray_Wrap_VTKDataArray<CONDUIT_NATIVE_UNSIGNED_SHORT, vtkUnsignedShortArray>( n, ncomps, ntuples );
   }
   else if( vals_dtype.is_unsigned_int() )
   {
-    retval = vtkUnsignedIntArray::New();
-    Blueprint_MultiCompArray_To_VTKDataArray<CONDUIT_NATIVE_UNSIGNED_INT>( n, ncomps, ntuples, retval );
+    retval = Blueprint_MultiCompArray_Wrap_VTKDataArray<CONDUIT_NATIVE_UNSIGNED_INT, vtkUnsignedIntArray>( n, ncomps, ntuples );
   }
   else if( vals_dtype.is_char() )
   {
-    retval = vtkCharArray::New();
-    Blueprint_MultiCompArray_To_VTKDataArray<CONDUIT_NATIVE_CHAR>( n, ncomps, ntuples, retval );
+    retval = Blueprint_MultiCompArray_Wrap_VTKDataArray<CONDUIT_NATIVE_CHAR, vtkCharArray>( n, ncomps, ntuples );
   }
   else if( vals_dtype.is_short() )
   {
-    retval = vtkShortArray::New();
-    Blueprint_MultiCompArray_To_VTKDataArray<CONDUIT_NATIVE_SHORT>( n, ncomps, ntuples, retval );
+    retval = Blueprint_MultiCompArray_Wrap_VTKDataArray<CONDUIT_NATIVE_SHORT, vtkShortArray>( n, ncomps, ntuples );
   }
   else if( vals_dtype.is_int() )
   {
-    retval = vtkIntArray::New();
-    Blueprint_MultiCompArray_To_VTKDataArray<CONDUIT_NATIVE_INT>( n, ncomps, ntuples, retval );
+    retval = Blueprint_MultiCompArray_Wrap_VTKDataArray<CONDUIT_NATIVE_INT, vtkIntArray>( n, ncomps, ntuples );
   }
   else if( vals_dtype.is_long() )
   {
-    retval = vtkLongArray::New();
-    Blueprint_MultiCompArray_To_VTKDataArray<CONDUIT_NATIVE_LONG>( n, ncomps, ntuples, retval );
+    retval = Blueprint_MultiCompArray_Wrap_VTKDataArray<CONDUIT_NATIVE_LONG, vtkLongArray>( n, ncomps, ntuples );
   }
   else if( vals_dtype.is_float() )
   {
-    retval = vtkFloatArray::New();
-    Blueprint_MultiCompArray_To_VTKDataArray<CONDUIT_NATIVE_FLOAT>( n, ncomps, ntuples, retval );
+    retval = Blueprint_MultiCompArray_Wrap_VTKDataArray<CONDUIT_NATIVE_FLOAT, vtkFloatArray>( n, ncomps, ntuples );
   }
   else if( vals_dtype.is_double() )
   {
-    retval = vtkDoubleArray::New();
-    Blueprint_MultiCompArray_To_VTKDataArray<CONDUIT_NATIVE_DOUBLE>( n, ncomps, ntuples, retval );
+    retval = Blueprint_MultiCompArray_Wrap_VTKDataArray<CONDUIT_NATIVE_DOUBLE, vtkDoubleArray>( n, ncomps, ntuples );
   }
   else
   {
@@ -481,6 +557,97 @@ vtkDataSet* UniformMesh( const conduit::Node* node )
   return( rectgrid );
 }
 
+//-----------------------------------------------------------------------------
+// the VTK type of the block made from a Blueprint domain
+static int BlueprintBlockType( const conduit::Node &domain )
+{
+  const conduit::Node &coords = domain["coordsets"][0];
+  const conduit::Node &topo   = domain["topologies"][0];
+
+  if( (coords["type"].as_string() == "uniform") ||
+    (coords["type"].as_string() == "rectilinear") )
+    return( VTK_RECTILINEAR_GRID );
+
+  if( topo["type"].as_string() == "structured" )
+    return( VTK_STRUCTURED_GRID );
+
+  return( VTK_UNSTRUCTURED_GRID );
+}
+
+//-----------------------------------------------------------------------------
+// the number of points and cells of the block made from a Blueprint domain
+static void BlueprintBlockSize( const conduit::Node &domain, long &npts, long &ncells )
+{
+  const conduit::Node &coords = domain["coordsets"][0];
+  const conduit::Node &topo   = domain["topologies"][0];
+
+  npts = 1;
+  ncells = 1;
+
+  if( coords["type"].as_string() == "uniform" )
+  {
+    const char *axes[] = {"i", "j", "k"};
+    for(int i = 0; i < 3 ;++i)
+    {
+      long n = coords["dims"].has_child(axes[i]) ? coords["dims"][axes[i]].to_long() : 1;
+      npts *= n;
+      ncells *= std::max( n - 1, 1l );
+    }
+  }
+  else if( coords["type"].as_string() == "rectilinear" )
+  {
+    const char *axes[] = {"x", "y", "z"};
+    for(int i = 0; i < 3 ;++i)
+    {
+      long n = coords["values"].has_child(axes[i]) ?
+        coords["values"][axes[i]].dtype().number_of_elements() : 1;
+      npts *= n;
+      ncells *= std::max( n - 1, 1l );
+    }
+  }
+  else
+  {
+    npts = coords["values/x"].dtype().number_of_elements();
+    if( topo["type"].as_string() == "structured" )
+    {
+      const char *axes[] = {"elements/dims/i", "elements/dims/j", "elements/dims/k"};
+      for(int i = 0; i < 3 ;++i)
+        ncells *= topo.has_path(axes[i]) ? topo[axes[i]].to_long() : 1;
+    }
+    else
+    {
+      int csize = VTKCellTypeSize( ElementShapeNameToVTKCellType(topo["elements/shape"].as_string()) );
+      ncells = topo["elements/connectivity"].dtype().number_of_elements() / std::max( csize, 1 );
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// the VTK type enum of a Conduit array, matching ConduitArrayToVTKDataArray
+static int ConduitTypeToVTKType( const conduit::DataType &dt )
+{
+  if( dt.is_unsigned_char() )
+    return( VTK_UNSIGNED_CHAR );
+  else if( dt.is_unsigned_short() )
+    return( VTK_UNSIGNED_SHORT );
+  else if( dt.is_unsigned_int() )
+    return( VTK_UNSIGNED_INT );
+  else if( dt.is_char() )
+    return( VTK_CHAR );
+  else if( dt.is_short() )
+    return( VTK_SHORT );
+  else if( dt.is_int() )
+    return( VTK_INT );
+  else if( dt.is_long() )
+    return( VTK_LONG );
+  else if( dt.is_float() )
+    return( VTK_FLOAT );
+  else if( dt.is_double() )
+    return( VTK_DOUBLE );
+
+  return( -1 );
+}
+
 //-----------------------------------------------------------------------------
 /* ******* TODO ???
 int ConduitDataAdaptor::GetNumberOfArrays( const std::string &meshName, int association, unsigned int &numberOfArrays )
@@ -527,7 +694,143 @@ int ConduitDataAdaptor::GetArrayName( const std::string &meshName, int associati
 void ConduitDataAdaptor::SetNode( conduit::Node* node )
 {
   this->Node = node;
-  ConduitDataAdaptor::UpdateFields();
+  this->HaveBlockLayout = false;
+
+  // the field layout of most simulations is the same every step, the maps
+  // are rebuilt only when it changes
+  if( !this->HaveFields || (this->FieldFingerprint() != this->Fingerprint) )
+    ConduitDataAdaptor::UpdateFields();
+}
+
+//-----------------------------------------------------------------------------
+uint64_t ConduitDataAdaptor::FieldFingerprint() const
+{
+  // FNV-1a over the number of domains and the name, association, topology
+  // and value layout of each field of the first domain. the domains of a
+  // multi-domain node are expected to hold the same fields, call
+  // UpdateFields directly when they do not
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash]( const std::string &str )
+  {
+    for(size_t i = 0; i < str.size() ;++i)
+    {
+      hash ^= static_cast<unsigned char>( str[i] );
+      hash *= 1099511628211ull;
+    }
+    hash ^= 0xff;
+    hash *= 1099511628211ull;
+  };
+
+  if( !this->Node )
+    return( hash );
+
+  bool multi = conduit::blueprint::mesh::is_multi_domain(*this->Node);
+  int ndoms = multi ? this->Node->number_of_children() : 1;
+  mix( std::to_string(multi) + ":" + std::to_string(ndoms) );
+
+  if( ndoms < 1 )
+    return( hash );
+
+  const conduit::Node &d_node = multi ? this->Node->child(0) : *this->Node;
+  if( !d_node.has_child("fields") )
+    return( hash );
+
+  conduit::NodeConstIterator field_itr = d_node["fields"].children();
+  while( field_itr.has_next() )
+  {
+    const conduit::Node &field = field_itr.next();
+    mix( field_itr.name() );
+
+    if( field.has_child("association") )
+      mix( field["association"].as_string() );
+
+    if( field.has_child("topology") )
+      mix( field["topology"].as_string() );
+
+    if( field.has_child("values") )
+      mix( std::to_string(field["values"].number_of_children()) );
+  }
+
+  return( hash );
+}
+
+//-----------------------------------------------------------------------------
+void ConduitDataAdaptor::UpdateFields()
+{
+  this->FieldNames.clear();
+  this->FieldIndex.clear();
+
+  bool multi = conduit::blueprint::mesh::is_multi_domain(*this->Node);
+  int ndoms = multi ? this->Node->number_of_children() : 1;
+
+  for(int i = 0; i < ndoms ;++i)
+  {
+    const conduit::Node &d_node = multi ? this->Node->child(i) : *this->Node;
+    if( !d_node.has_child("fields") )
+      continue;
+
+    conduit::NodeConstIterator field_itr = d_node["fields"].children();
+    while( field_itr.has_next() )
+    {
+      const conduit::Node &field = field_itr.next();
+      std::string field_name = field_itr.name();
+
+      //TODO: There is no formal protocol for naming meshes within a multi
+      //domain node. This is a placeholder until there is a path in a node
+      //that distinguishes what mesh the data belongs to. For now, the
+      //meshName will be hardcoded as "mesh".
+      std::string meshName = multi ? "mesh" : field["topology"].as_string();
+
+      std::map<std::string, FieldInfo> &fields = this->FieldIndex[meshName];
+      if( fields.count(field_name) )
+        continue;
+
+      std::string association = field["association"].as_string();
+
+      FieldInfo &info = fields[field_name];
+      info.ValuesPath = "fields/" + field_name + "/values";
+      info.Association = association == "vertex" ? vtkDataObject::POINT :
+        association == "element" ? vtkDataObject::CELL : -1;
+
+      this->FieldNames[meshName].push_back( field_name );
+    }
+  }
+
+  this->Fingerprint = this->FieldFingerprint();
+  this->HaveFields = true;
+}
+
+//-----------------------------------------------------------------------------
+int ConduitDataAdaptor::UpdateBlockLayout()
+{
+  if( this->HaveBlockLayout )
+    return( 0 );
+
+  if( !this->Node )
+  {
+    SENSEI_ERROR( "No node was set" );
+    return( -1 );
+  }
+
+  this->NumLocalBlocks = conduit::blueprint::mesh::is_multi_domain(*this->Node) ?
+    this->Node->number_of_children() : 1;
+
+  // the blocks are numbered consecutively in rank order. two scalar
+  // collectives replace gathering the count of every rank
+  int rank = 0;
+  MPI_Comm_rank( this->GetCommunicator(), &rank );
+
+  this->BlockOffset = 0;
+  MPI_Exscan( &this->NumLocalBlocks, &this->BlockOffset, 1, MPI_INT, MPI_SUM, this->GetCommunicator() );
+
+  // the result of the scan is undefined on rank 0
+  if( rank == 0 )
+    this->BlockOffset = 0;
+
+  MPI_Allreduce( &this->NumLocalBlocks, &this->NumGlobalBlocks, 1, MPI_INT, MPI_SUM, this->GetCommunicator() );
+
+  this->HaveBlockLayout = true;
+  return( 0 );
 }
 
 //-----------------------------------------------------------------------------
@@ -626,33 +929,16 @@ int ConduitDataAdaptor::GetMesh( const std::string &meshName, bool /*structureOn
     return( -1 );
   }
 
-  vtkMultiBlockDataSet *mb_mesh = vtkMultiBlockDataSet::New();
+  if( this->UpdateBlockLayout() )
+    return( -1 );
 
-  int start = 0, total_blocks = 0;
-  int size, rank;
-  MPI_Comm_size( this->GetCommunicator(), &size );
-  MPI_Comm_rank( this->GetCommunicator(), &rank );
+  int start = this->BlockOffset;
 
-  int global_blocks[size] = {};
+  vtkMultiBlockDataSet *mb_mesh = vtkMultiBlockDataSet::New();
+  mb_mesh->SetNumberOfBlocks( this->NumGlobalBlocks );
 
   if( conduit::blueprint::mesh::is_multi_domain(*this->Node) )
   {
-    int local_blocks[size] = {};
-    local_blocks[rank] = this->Node->number_of_children();
-    MPI_Allreduce( &local_blocks, &global_blocks, size, MPI_INT, MPI_SUM, this->GetCommunicator() ); 
-
-    this->GlobalBlockDistribution = (int *)malloc( (sizeof(int) * size) );
-    memcpy( this->GlobalBlockDistribution, global_blocks, (sizeof(int) * size) );
-        
-    for(int i = 0; i < size ;++i)
-    {
-      total_blocks += global_blocks[i];
-      if( i < rank )
-        start += global_blocks[i];
-    }
-
-
-    mb_mesh->SetNumberOfBlocks( total_blocks );
     int domain = 0;
     conduit::NodeConstIterator domain_itr = this->Node->children();
        
@@ -687,22 +973,6 @@ int ConduitDataAdaptor::GetMesh( const std::string &meshName, bool /*structureOn
   }
   else
   {
-    int local_blocks[size] = {};
-    local_blocks[rank] = 1;
-    MPI_Allreduce( &local_blocks, &global_blocks, size, MPI_INT, MPI_SUM, this->GetCommunicator() );
-        
-    this->GlobalBlockDistribution = (int*)malloc( (sizeof(int) * size) );
-    memcpy( this->GlobalBlockDistribution, global_blocks, (sizeof(int) * size) );
-   
-    for(int i = 0; i < size ;++i)
-    {
-      total_blocks += global_blocks[i];
-      if( i < rank )
-        start += global_blocks[i];
-    }
-
-    mb_mesh->SetNumberOfBlocks( total_blocks );
-
     int block = start;
     const conduit::Node &coords = (*this->Node)["coordsets"][0];
     const conduit::Node &topo   = (*this->Node)["topologies"][0];
@@ -743,44 +1013,123 @@ int ConduitDataAdaptor::GetNumberOfMeshes( unsigned int &numberOfMeshes )
 
 
 //-----------------------------------------------------------------------------
-int ConduitDataAdaptor::GetMeshMetadata(unsigned int /*id*/, sensei::MeshMetadataPtr &metadata)
+int ConduitDataAdaptor::GetMeshMetadata(unsigned int id, sensei::MeshMetadataPtr &metadata)
 {
-  //this->FieldNames can be used to find the mesh name, once that becomes 
-  //supported in the conduit node. 
-  metadata->MeshName = "mesh";
+  if( id != 0 )
+  {
+    SENSEI_ERROR( "GetMeshMetadata: No mesh " << id );
+    return( -1 );
+  }
+
+  if( this->UpdateBlockLayout() )
+    return( -1 );
+
+  int rank = 0;
+  MPI_Comm_rank( this->GetCommunicator(), &rank );
+
+  //Once multiple meshes are present in the same node the mesh name will
+  //come from the node. For now there is at most one entry in FieldNames.
+  metadata->MeshName = this->FieldNames.empty() ? "mesh" : this->FieldNames.begin()->first;
+  metadata->GlobalView = false;
+  metadata->MeshType = VTK_MULTIBLOCK_DATA_SET;
+  metadata->BlockType = VTK_UNSTRUCTURED_GRID;
+  metadata->NumBlocks = this->NumGlobalBlocks;
+  metadata->NumBlocksLocal = {this->NumLocalBlocks};
+  metadata->CoordinateType = VTK_DOUBLE;
+  metadata->NumGhostCells = 0;
+  metadata->NumGhostNodes = 0;
+  metadata->StaticMesh = 0;
+  metadata->NumArrays = 0;
+
+  // a rank without domains has nothing to describe them with
+  if( this->NumLocalBlocks < 1 )
+    return( 0 );
+
+  bool multi = conduit::blueprint::mesh::is_multi_domain(*this->Node);
+  const conduit::Node &first = multi ? this->Node->child(0) : *this->Node;
+
+  metadata->BlockType = BlueprintBlockType( first );
+
+  // the arrays are described by the first domain
+  auto search = this->FieldNames.find( metadata->MeshName );
+  if( search != this->FieldNames.end() )
+  {
+    const std::vector<std::string> &names = search->second;
+    const std::map<std::string, FieldInfo> &index = this->FieldIndex[metadata->MeshName];
+    for(size_t i = 0; i < names.size() ;++i)
+    {
+      const FieldInfo &info = index.at( names[i] );
+      if( (info.Association < 0) || !first.has_path(info.ValuesPath) )
+        continue;
+
+      const conduit::Node &values = first[info.ValuesPath];
+      int nchildren = values.number_of_children();
+
+      metadata->ArrayName.push_back( names[i] );
+      metadata->ArrayCentering.push_back( info.Association );
+      metadata->ArrayComponents.push_back( nchildren > 0 ? nchildren : 1 );
+      metadata->ArrayType.push_back( ConduitTypeToVTKType(nchildren > 0 ?
+        values[0].dtype() : values.dtype()) );
+    }
+    metadata->NumArrays = metadata->ArrayName.size();
+  }
+
+  if( metadata->Flags.BlockDecompSet() )
+  {
+    for(int i = 0; i < this->NumLocalBlocks ;++i)
+    {
+      metadata->BlockOwner.push_back( rank );
+      metadata->BlockIds.push_back( this->BlockOffset + i );
+    }
+  }
+
+  if( metadata->Flags.BlockSizeSet() )
+  {
+    long npts_total = 0, ncells_total = 0;
+    for(int i = 0; i < this->NumLocalBlocks ;++i)
+    {
+      long npts = 0, ncells = 0;
+      BlueprintBlockSize( multi ? this->Node->child(i) : *this->Node, npts, ncells );
+      metadata->BlockNumPoints.push_back( npts );
+      metadata->BlockNumCells.push_back( ncells );
+      npts_total += npts;
+      ncells_total += ncells;
+    }
+    metadata->NumPoints = npts_total;
+    metadata->NumCells = ncells_total;
+  }
+
   return( 0 );
 }
 
 //-----------------------------------------------------------------------------
 int ConduitDataAdaptor::AddArray( vtkDataObject* mesh, const std::string &meshName, int /*association*/, const std::string &arrayname )
 {
-  auto search = this->FieldNames.find( meshName );
-  if( search == this->FieldNames.end() )
+  auto search = this->FieldIndex.find( meshName );
+  if( search == this->FieldIndex.end() )
   {
     SENSEI_ERROR( "AddArray: Mesh " << meshName << " Cannot Be Found" );
+    return( -1 );
   }
 
-  std::vector<std::string> vec = search->second;
-  int flag = 1;
-  for(size_t i = 0; i < vec.size() ;++i)
+  auto field = search->second.find( arrayname );
+  if( field == search->second.end() )
   {
-    if( arrayname.compare(vec.at(i)) == 0 )
-    {
-      flag = 0;
-      break;
-    }
+    SENSEI_ERROR( "ERROR: field " << arrayname << " does not reside on Mesh " << meshName );
+    return( -1 );
   }
-  if( flag )
+
+  const FieldInfo &info = field->second;
+  if( info.Association < 0 )
   {
-    SENSEI_ERROR( "ERROR: field " << arrayname << " does not reside on Mesh ");
+    SENSEI_ERROR( "ERROR: association of field " << arrayname << " incompatible" );
     return( -1 );
   }
 
-  int rank, start = 0;
-  MPI_Comm_rank( this->GetCommunicator(), &rank );
-  
-  for(int i = 0; i < rank ;++i)
-    start += this->GlobalBlockDistribution[i];
+  if( this->UpdateBlockLayout() )
+    return( -1 );
+
+  int start = this->BlockOffset;
 
   vtkMultiBlockDataSet *mb = dynamic_cast<vtkMultiBlockDataSet*>( mesh );
 
@@ -789,126 +1138,40 @@ int ConduitDataAdaptor::AddArray( vtkDataObject* mesh, const std::string &meshNa
     SENSEI_ERROR( "MultiBlockDataSet is NULL" );
     return( -1 );
   }
-  if( conduit::blueprint::mesh::is_multi_domain(*this->Node) )
-  {
-    conduit::NodeConstIterator dom_itr = this->Node->children();
-    int domain = 0;
-    while( dom_itr.has_next() )
-    {
-      const conduit::Node& d_node = dom_itr.next();
-      const conduit::Node& fields = d_node["fields"];
-      const conduit::Node& field  = fields[arrayname];
-      const conduit::Node& values = field["values"];
-            
-      vtkSmartPointer<vtkDataArray> array = ConduitArrayToVTKDataArray( values );
-      array->SetName( arrayname.c_str() );
-       
-      vtkDataObject *block = mb->GetBlock( start + domain );
 
-      std::stringstream ss;
-      ss << "fields/" << arrayname << "/association";
-      std::string association_path  = ss.str();
-      std::string field_association = d_node[association_path].as_string();
+  bool multi = conduit::blueprint::mesh::is_multi_domain(*this->Node);
+  int ndoms = multi ? this->Node->number_of_children() : 1;
 
-      std::stringstream rr;
-      rr << "fields/" << arrayname << "/values";
-      std::string values_path = rr.str();
-      int nchildren = values.number_of_children();
-      if( field_association == "vertex" )
-      {
-        if( nchildren > 0 )
-        {
-          vtkDataSetAttributes *attr = block->GetAttributes( vtkDataObject::POINT );
-          attr->AddArray( array );
-        }
-        else
-        {
-          vtkDataSetAttributes *attr = block->GetAttributes( vtkDataObject::POINT );
-          attr->AddArray( array );
-        }
-      }  
-      else if( field_association == "element" )
-      {
-        if( nchildren > 0 )
-        {
-          vtkDataSetAttributes *attr = block->GetAttributes( vtkDataObject::CELL );
-          attr->AddArray( array );
-        } 
-        else
-        {
-          vtkDataSetAttributes *attr = block->GetAttributes( vtkDataObject::CELL );
-          attr->AddArray( array );
-        }
-      }
-      else
-      {
-        SENSEI_ERROR( "ERROR: association of type " << field_association << " incompatible" );
-        return( -1 );
-      }
-      ++domain;
-    }
-  }  
-  else
+  for(int domain = 0; domain < ndoms ;++domain)
   {
-    const conduit::Node& fields  = (*this->Node)["fields"];
-    const conduit::Node& field   = fields[arrayname];
-    const conduit::Node& values  = field["values"];
-    vtkSmartPointer<vtkDataArray> array = ConduitArrayToVTKDataArray( values );
-    array->SetName( arrayname.c_str() );
+    const conduit::Node &d_node = multi ? this->Node->child(domain) : *this->Node;
 
-    vtkDataObject *block = mb->GetBlock( start );
+    // the values are found by their path rather than a search of the
+    // fields. a domain without the field is left without the array
+    if( !d_node.has_path(info.ValuesPath) )
+      continue;
 
-    std::stringstream ss;
-    ss << "fields/" << arrayname << "/association";
-    std::string association_path  = ss.str();
-    std::string field_association = (*this->Node)[association_path].as_string();
+    vtkSmartPointer<vtkDataArray> array;
+    array.TakeReference( ConduitArrayToVTKDataArray(d_node[info.ValuesPath]) );
+    if( !array )
+      return( -1 );
 
-    std::stringstream rr;
-    rr << "fields/" << arrayname << "/values";
-    std::string values_path = rr.str();
-    int nchildren = (*this->Node)[values_path].number_of_children();
+    array->SetName( arrayname.c_str() );
+
+    vtkDataObject *block = mb->GetBlock( start + domain );
+    block->GetAttributes( info.Association )->AddArray( array );
+  }
 
-    if( field_association == "vertex" )
-    {
-      if( nchildren > 0 )
-      {
-        vtkDataSetAttributes *attr = block->GetAttributes( vtkDataObject::POINT );
-        attr->AddArray( array );
-      }
-      else
-      {
-        vtkDataSetAttributes *attr = block->GetAttributes( vtkDataObject::POINT );
-        attr->AddArray( array );
-      }
-    }
-    else if( field_association == "element" )
-    {
-      if( nchildren > 0 )
-      {
-        vtkDataSetAttributes *attr = block->GetAttributes( vtkDataObject::CELL );
-        attr->AddArray( array );
-      } 
-      else
-      {
-        vtkDataSetAttributes *attr = block->GetAttributes( vtkDataObject::CELL );
-        attr->AddArray( array );
-      }
-    }
-    else
-    {
-      SENSEI_ERROR( "ERROR: association of type " << field_association << " incompatible" );
-      return( -1 );
-    }
-  } 
   return( 0 );
 }
 
 //-----------------------------------------------------------------------------
 int ConduitDataAdaptor::ReleaseData()
 {
+  // the field maps describe the layout, not the data, and are kept for
+  // the next call to SetNode
   this->Node = NULL;
-  this->FieldNames.clear();
-  free( this->GlobalBlockDistribution );
+  this->HaveBlockLayout = false;
 
   return( 0 );
 }
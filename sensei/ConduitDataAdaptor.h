@@ -1,6 +1,9 @@
 #ifndef CONDUIT_DATAADAPTOR_H
 #define CONDUIT_DATAADAPTOR_H
 
+#include <cstdint>
+#include <map>
+#include <string>
 #include <vector>
 #include <vtkDataArray.h>
 #include <conduit.hpp>
@@ -19,6 +22,10 @@ public:
   void PrintSelf(ostream &os, vtkIndent indent) override;
 
   void SetNode(conduit::Node* node);
+
+  // the node passed to SetNode, for analyses that consume Blueprint
+  // directly and need no VTK objects
+  conduit::Node* GetNode() { return this->Node; }
   void UpdateFields();
 
   // SENSEI DataAdaptor API.
@@ -41,7 +48,34 @@ protected:
 
   typedef std::map<std::string, std::vector<std::string>> Fields;
   Fields FieldNames;
-  int *GlobalBlockDistribution;
+
+  // where the values of a field are found in each domain, and the VTK
+  // association of the field. -1 for unsupported associations.
+  struct FieldInfo
+  {
+    std::string ValuesPath;
+    int Association;
+  };
+
+  // indexed by mesh name then field name
+  typedef std::map<std::string, std::map<std::string, FieldInfo>> FieldIndexType;
+  FieldIndexType FieldIndex;
+
+  // a hash of the node's field layout. SetNode rebuilds the field maps
+  // only when it differs from the one they were built from.
+  uint64_t FieldFingerprint() const;
+  bool HaveFields;
+  uint64_t Fingerprint;
+
+  // computes the global id of the first local block and the global number
+  // of blocks. this is collective and is done once per call to SetNode,
+  // later calls return the cached values.
+  int UpdateBlockLayout();
+
+  bool HaveBlockLayout;
+  int NumLocalBlocks;
+  int NumGlobalBlocks;
+  int BlockOffset;
 
 private:
   ConduitDataAdaptor(const ConduitDataAdaptor&) = delete; // not implemented.
@@ -2,24 +2,61 @@
 #include <vtkSmartPointer.h>
 #include <vtkNew.h>
 #include <vtkDataObject.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkAbstractArray.h>
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
+#include <vtkCellData.h>
 
 #include <vector>
+#include <set>
 #include <fstream>
 #include <sstream>
 #include <cstdio>
 #include <errno.h>
+#include <future>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <chrono>
+#include <sys/resource.h>
 
 #include "ConfigurableAnalysis.h"
 #include "senseiConfig.h"
 #include "Error.h"
 #include "Profiler.h"
+#include "MPIUtils.h"
+#include "TaskRuntime.h"
+#include "MemoryProfiler.h"
+#include "MemoryGovernor.h"
 #include "VTKUtils.h"
 #include "XMLUtils.h"
 #include "STLUtils.h"
 #include "DataRequirements.h"
+#include "DataAdaptor.h"
+#include "VTKDataAdaptor.h"
+#include "CachingDataAdaptor.h"
+#include "DerivedFields.h"
+#include "PartialResultsDataAdaptor.h"
+#include "SubsamplingDataAdaptor.h"
+#include "SpatialSortDataAdaptor.h"
+#include "InTransitDataAdaptor.h"
+#include "MeshMetadataMap.h"
+#include "AnalysisTrigger.h"
+#include "PlacementPolicy.h"
 
 #include "Autocorrelation.h"
 #include "Histogram.h"
+#include "Statistics.h"
+#include "TemporalStatistics.h"
+#include "TemporalWindow.h"
+#include "Extremes.h"
+#include "ConnectedComponents.h"
+#include "ParticleDeposition.h"
+#include "ParticleTracer.h"
+#include "MPIAnalysisAdaptor.h"
+#include "MPISchema.h"
 #ifdef ENABLE_VTK_IO
 #include "VTKPosthocIO.h"
 #ifdef ENABLE_VTK_MPI
@@ -32,6 +69,7 @@
 #ifdef ENABLE_VTKM
 #include "VTKmVolumeReductionAnalysis.h"
 #include "VTKmCDFAnalysis.h"
+#include "VTKmHistogramAnalysis.h"
 #endif
 #ifdef ENABLE_ADIOS1
 #include "ADIOS1AnalysisAdaptor.h"
@@ -50,6 +88,9 @@
 #ifdef ENABLE_ASCENT
 #include "AscentAnalysisAdaptor.h"
 #endif
+#ifdef ENABLE_CATALYST2
+#include "Catalyst2AnalysisAdaptor.h"
+#endif
 #ifdef ENABLE_LIBSIM
 #include "LibsimAnalysisAdaptor.h"
 #include "LibsimImageProperties.h"
@@ -61,6 +102,9 @@
 #define ENABLE_SLICE_EXTRACT
 #include "SliceExtract.h"
 #endif
+#if defined(ENABLE_SLICE_EXTRACT) || defined(ENABLE_VTK_ACCELERATORS)
+#include "PolyDataReducer.h"
+#endif
 
 using AnalysisAdaptorPtr = vtkSmartPointer<sensei::AnalysisAdaptor>;
 using AnalysisAdaptorVector = std::vector<AnalysisAdaptorPtr>;
@@ -73,7 +117,12 @@ using namespace STLUtils; // for operator<< overloads
 struct ConfigurableAnalysis::InternalsType
 {
   InternalsType()
-    : Comm(MPI_COMM_NULL)
+    : Comm(MPI_COMM_NULL), Concurrent(0), CacheData(1), GlobalViewMode(-1),
+    Budget(0.0),
+    BudgetWindow(10), Credit(0.0), HaveLastExecute(false), LastExecuteTime(0.0),
+    LazyInit(false), HaveNextRun(false), HaveTriggerMetadata(false),
+    HavePartialResults(false), EndPoint(false), HavePlacement(false),
+    PushedRequirements(false)
   {
   }
 
@@ -81,23 +130,65 @@ struct ConfigurableAnalysis::InternalsType
   // optionally timing how long initialization takes.
   // If no \a initializer is passed, then no initialization is
   // required but a timer entry will be created for consistency.
+  // When LazyInit is set the initializer is deferred until the analysis
+  // is first executed, it must then not refer to the caller's locals.
   int TimeInitialization(
     AnalysisAdaptorPtr adaptor,
     std::function<int()> initializer = []() { return 0; });
 
+  // run a step of the adaptor's configuration that relies on its
+  // initialization, now or after the deferred initialization
+  int DeferInitialization(AnalysisAdaptor *adaptor, std::function<int()> step);
+
+  // run the deferred initialization of the i'th analysis, if it has not
+  // run yet. this is collective over the analysis' communicator
+  int InitializeAnalysis(unsigned int i);
+
+  // start the deferred initialization of all analyses in the background
+  void StartPrewarm();
+
+  // wait for the deferred initialization started by StartPrewarm
+  int WaitPrewarm();
+
+  // rank 0 reports the time each analysis spent in initialization, the
+  // largest over all ranks
+  void ReportStartup(MPI_Comm comm);
+
+  // get the arrays an analysis processes, given either by mesh elements
+  // or by the mesh, array, and association attributes. arrays lists them
+  // for status messages. returns the number of arrays, or -1 on error
+  int GetArrayRequirements(pugi::xml_node node, DataRequirements &reqs,
+    std::string &arrays);
+
+  // get the phase of an analysis split between the simulation and an end
+  // point from the phase attribute, and the prefix of its partial results
+  // from the partial attribute. a local phase makes the partial results
+  // adaptor wrap the data. returns -1 on error
+  int GetPhase(pugi::xml_node node, const char *defaultPrefix, int &phase,
+    std::string &prefix);
+
   // creates, initializes from xml, and adds the analysis
   // if it has been compiled into the build and is enabled.
   // a status message indicating success/failure is printed
   // by rank 0
   int AddHistogram(pugi::xml_node node);
+  int AddStatistics(pugi::xml_node node);
+  int AddTemporalStatistics(pugi::xml_node node);
+  int AddExtremes(pugi::xml_node node);
+  int AddConnectedComponents(pugi::xml_node node);
+  int AddParticleDeposition(pugi::xml_node node);
+  int AddParticleTracer(pugi::xml_node node);
   int AddVTKmContour(pugi::xml_node node);
   int AddVTKmVolumeReduction(pugi::xml_node node);
   int AddVTKmCDF(pugi::xml_node node);
+  int AddVTKmHistogram(pugi::xml_node node);
   int AddAdios1(pugi::xml_node node);
   int AddAdios2(pugi::xml_node node);
   int AddHDF5(pugi::xml_node node);
+  int AddMPI(pugi::xml_node node);
   int AddAscent(pugi::xml_node node);
   int AddCatalyst(pugi::xml_node node);
+  int AddCatalyst2(pugi::xml_node node);
   int AddLibsim(pugi::xml_node node);
   int AddAutoCorrelation(pugi::xml_node node);
   int AddPosthocIO(pugi::xml_node node);
@@ -105,7 +196,247 @@ struct ConfigurableAnalysis::InternalsType
   int AddPythonAnalysis(pugi::xml_node node);
   int AddSliceExtract(pugi::xml_node node);
 
+  // parses the execution controls (eg. async="1") for the most recently
+  // added analysis. must be called after each successful Add* call.
+  int ConfigureExecution(pugi::xml_node node);
+
+  // find the transports that ship the data of the analyses placed in
+  // transit, once all of the analyses have been added
+  int ConfigurePlacement();
+
+  // place the analyses that run this step in situ or in transit, publish
+  // the placement, and give the transports the requirements of the
+  // analyses they ship. on an end point, find the analyses the simulation
+  // placed here. collective
+  int Place(MPI_Comm comm, DataAdaptor *data, const std::vector<bool> &run);
+
+  // get the analyses placed on the end point from the published placement
+  int GetEndPointPlacement(DataAdaptor *data);
+
+  // estimate the bytes on this rank of the data described by the
+  // requirements from the step's metadata
+  int EstimateBytes(MeshMetadataMap &mdMap, const DataRequirements &reqs,
+    double &nBytes);
+
+  // set the requirements of the i'th analysis, a transport
+  int SetTransportRequirements(unsigned int i, const DataRequirements &reqs);
+
+  // add the data the ai'th analysis accesses, given on the meshes of the
+  // simulation, to reqs. complete is set to false when the analysis
+  // declares none
+  int AddSourceRequirements(unsigned int ai, DataRequirements &reqs,
+    bool &complete);
+
+  // the union of the data the analyses access, irrespective of the
+  // schedule, see ConfigurableAnalysis::GetAllDataRequirements
+  int GetAllRequirements(DataRequirements &reqs, bool &complete);
+
+  // give an in transit adaptor the union of the analyses' requirements,
+  // unless its XML named the data to read
+  int PushRequirements(InTransitDataAdaptor *data);
+
+  // make a copy of the data described by the requirements into the passed
+  // adaptor. When deep is set the copy is independent of the simulation
+  // and can be processed after the simulation has moved on.
+  // When nBytes is passed the size of the deep copy is returned.
+  int Snapshot(DataAdaptor *data, const DataRequirements &reqs,
+    VTKDataAdaptor *snapshot, bool deep, long long *nBytes = nullptr);
+
+  // wait for the pending asynchronous execution of the i'th analysis
+  // to complete. returns non-zero if the execution failed.
+  int Wait(unsigned int i);
+
+  // execute the i'th analysis on the calling thread
+  int ExecuteSynchronous(unsigned int i, DataAdaptor *data);
+
+  // determine if this rank has blocks of the meshes the i'th analysis
+  // accesses. owner is set to 1 if it does and 0 otherwise.
+  int GetDataOwnership(unsigned int i, DataAdaptor *data, int &owner);
+
+  // give the analyses that run only where there is data, and that run
+  // this step, a communicator of the ranks that have it. a new one is
+  // made only when the ownership changed. collective.
+  int UpdateDataRanks(MPI_Comm comm, DataAdaptor *data,
+    const std::vector<bool> &run);
+
+  // execute the i'th analysis on a batch of steps on the calling thread
+  int ExecuteBatch(unsigned int i, const std::vector<DataAdaptor*> &steps);
+
+  // copy the data required by the i'th analysis and start its execution
+  // in the background
+  int ExecuteAsynchronous(unsigned int i, DataAdaptor *data);
+
+  // execute the listed analyses concurrently. An analysis is started as
+  // soon as the analyses listed before it that access the same meshes have
+  // completed.
+  int ExecuteConcurrent(DataAdaptor *data, const std::vector<unsigned int> &ids);
+
+  // get the data the i'th analysis sees, the step's data or its reduction
+  // and sort when the analysis subsamples or sorts
+  DataAdaptor *GetAnalysisData(unsigned int i, DataAdaptor *data);
+
+  // returns true if the i'th and j'th analyses can not run at the same time
+  bool Conflict(unsigned int i, unsigned int j) const;
+
+  // choose the analyses to run this step such that the time spent in situ
+  // stays within the budget. this is collective so that all ranks make the
+  // same choice.
+  int Schedule(MPI_Comm comm, std::vector<bool> &run);
+
+  // skip the analyses whose memory does not fit in the in situ memory
+  // budget. collective
+  int ScheduleMemory(MPI_Comm comm, std::vector<bool> &run);
+
+  // schedule the upcoming step into NextRun, unless it was already
+  int ScheduleNext(MPI_Comm comm);
+
+  // evaluate the trigger of the i'th analysis. fire is set when the
+  // analysis should run this step. when data is null only triggers that
+  // do not reference data are evaluated, the others fire. collective.
+  int EvaluateTrigger(MPI_Comm comm, unsigned int i, DataAdaptor *data,
+    long step, double time, bool &fire);
+
+  // get the global range of an array from the metadata
+  int GetTriggerRange(DataAdaptor *data, const std::string &meshName,
+    const std::string &arrayName, int association, double range[2]);
+
+  // get the fraction of the values at or above value in the last
+  // histogram computed by the named analysis. collective.
+  int GetTriggerTail(MPI_Comm comm, const std::string &name, double value,
+    double &fraction);
+
+  // measures the resources used by an execution. Start is called before
+  // and Stop after on the thread that executes the analysis.
+  struct CostMeter
+  {
+    void Start();
+    void Stop(ConfigurableAnalysis::AnalysisCost &cost, long long copyBytes,
+      std::mutex &mtx);
+
+    std::chrono::steady_clock::time_point WallTime;
+    double CpuTime;
+    long long Memory;
+    long long PeakMemory;
+    long long Bytes;
+  };
+
 public:
+  // controls how each analysis is executed. There is one instance
+  // for each analysis in the Analyses vector below.
+  struct ExecutionControl
+  {
+    ExecutionControl() : Async(false), SnapshotAll(false), DataRanks(false),
+      Owner(-1), Split(false), Publishes(false), Priority(0), MinCadence(0),
+      StepsSkipped(0), NumMeasured(0), CostEstimate(0.0), MemoryConsumer(-1),
+      MemoryGranted(0), Transport(-1), PlacedElsewhere(false),
+      PlacedExecutions(0), Ships(false), ShipExecutions(0),
+      ShippedBytes(0.0), Bandwidth(0.0) {}
+
+    // when set the analysis is run in a background thread on
+    // a snapshot of the data it requires
+    bool Async;
+
+    // when set all of the data the simulation provides is copied,
+    // this is used when the analysis does not specify its requirements
+    bool SnapshotAll;
+
+    // the meshes and arrays the analysis accesses. may be empty
+    DataRequirements Requirements;
+
+    // when set the analysis runs only on the ranks that have blocks of the
+    // meshes it accesses, over a communicator of those ranks. Owner is 1
+    // on those ranks, 0 on others, and -1 until it was first determined.
+    // the communicator is kept for as long as the ownership is unchanged,
+    // Split is set once the analysis was given one
+    bool DataRanks;
+    int Owner;
+    bool Split;
+
+    // when set the analysis publishes meshes for those that run after it
+    bool Publishes;
+
+    // when given the analysis is handed reduced resolution copies of the
+    // meshes, see the subsample element
+    vtkSmartPointer<SubsamplingDataAdaptor> Subsample;
+
+    // when given the analysis is handed the points of the meshes ordered
+    // along a space filling curve, see the sort element
+    vtkSmartPointer<SpatialSortDataAdaptor> Sort;
+
+    // when given the analysis runs only in the steps in which it fires
+    AnalysisTrigger Trigger;
+
+    // holds the data handed to the analysis when it is not run
+    // directly on the simulation's adaptor
+    vtkSmartPointer<VTKDataAdaptor> Data;
+
+    std::future<bool> Pending;
+
+    // the resources used by the analysis
+    ConfigurableAnalysis::AnalysisCost Cost;
+
+    // scheduling under a time budget. analyses of higher priority are
+    // chosen first, and an analysis runs at least once every MinCadence
+    // steps irrespective of the budget. 0 places no bound
+    int Priority;
+    long MinCadence;
+    long StepsSkipped;
+
+    // the number of executions seen by the scheduler, and the estimated
+    // time of the next, the largest over all ranks
+    long NumMeasured;
+    double CostEstimate;
+
+    // the analysis' id with the memory governor and the bytes it was
+    // granted for the current step
+    int MemoryConsumer;
+    long long MemoryGranted;
+
+    // where the analysis runs, see PlacementPolicy. Transport is the index
+    // of the transport that ships its data, and PlacedElsewhere is set in
+    // the steps it runs on the other side of the transport. the executions
+    // seen by the placement tell when the local cost was measured
+    PlacementPolicy Placement;
+    int Transport;
+    bool PlacedElsewhere;
+    long PlacedExecutions;
+
+    // set for a transport that ships the data of analyses placed in
+    // transit. its requirements are extended with theirs in the steps they
+    // are shipped. the estimated bytes it shipped and its bandwidth are
+    // used by the placement. ShipBase holds the transport's own
+    // requirements
+    bool Ships;
+    DataRequirements ShipBase;
+    long ShipExecutions;
+    double ShippedBytes;
+    double Bandwidth;
+  };
+
+  std::vector<ExecutionControl> Controls;
+
+  // controls the initialization of each analysis. There is one instance
+  // for each analysis in the Analyses vector below.
+  struct StartupControl
+  {
+    StartupControl() : Lazy(false), Initialized(true), Time(0.0) {}
+
+    // when set the initialization runs at the first execution
+    bool Lazy;
+    bool Initialized;
+
+    // the time spent in initialization on this rank
+    double Time;
+
+    // the deferred initialization
+    std::vector<std::function<int()>> Steps;
+  };
+
+  std::vector<StartupControl> Startup;
+
+  // serializes updates to the costs made by the threads executing analyses
+  std::mutex CostMutex;
+
   // list of all analyses. api calls are forwareded to each
   // analysis in the list
   AnalysisAdaptorVector Analyses;
@@ -119,6 +450,10 @@ public:
 #ifdef ENABLE_CATALYST
   vtkSmartPointer<CatalystAnalysisAdaptor> CatalystAdaptor;
 #endif
+#ifdef ENABLE_CATALYST2
+  vtkSmartPointer<Catalyst2AnalysisAdaptor> Catalyst2Adaptor;
+  DataRequirements Catalyst2Requirements;
+#endif
 
   // the communicator that is used to initialize new analyses.
   // When this is MPI_COMM_NULL, the default, each analysis uses
@@ -127,1191 +462,4552 @@ public:
   // and superfluous Comm_dup's are avoided.
   MPI_Comm Comm;
 
+  // when set analyses that access disjoint sets of meshes are executed
+  // concurrently
+  int Concurrent;
+
+  // when set the meshes and arrays produced by the simulation are cached
+  // during each Execute so that analyses accessing the same data share a
+  // single conversion
+  int CacheData;
+  vtkSmartPointer<CachingDataAdaptor> Cache;
+
+  // how the data adaptors make the global views of the metadata, see
+  // DataAdaptor::SetGlobalViewMode. -1 leaves the adaptor's setting
+  int GlobalViewMode;
+
+  // arrays computed from the simulation's once per step and served by the
+  // cache to the analyses that request them
+  DerivedFields Derived;
+
+  // when an analysis has a local phase the data is wrapped so that the
+  // partial results it publishes are shipped by the transports
+  bool HavePartialResults;
+  vtkSmartPointer<PartialResultsDataAdaptor> PartialResults;
+
+  // the names of the meshes analyses publish for those that run after
+  // them. these are not the simulation's
+  std::set<std::string> Published;
+
+  // when set, the fraction of the total step time that may be spent in
+  // situ. Credit accumulates the time the budget allows and is spent by
+  // the analyses that run, it is bounded by BudgetWindow steps worth of
+  // allowance so that time saved in cheap phases is not hoarded
+  double Budget;
+  int BudgetWindow;
+  double Credit;
+
+  // used to measure the time the simulation spends between steps and the
+  // time spent in situ
+  bool HaveLastExecute;
+  std::chrono::steady_clock::time_point LastExecuteEnd;
+  double LastExecuteTime;
+
   std::vector<std::string> LogEventNames;
+
+  // when set only the analyses of this group are run, see SplitGroups
+  std::string Group;
+
+  // when set the analysis being configured is initialized on first use
+  bool LazyInit;
+
+  // the deferred initialization running in the background
+  std::future<int> Prewarming;
+
+  // flags the analyses that are handed the whole batch during
+  // ExecuteBatch, these are skipped when the steps are executed one at a
+  // time. empty outside of ExecuteBatch
+  std::vector<bool> Batched;
+
+  // the analyses scheduled by GetDataRequirements for the next step
+  bool HaveNextRun;
+  std::vector<bool> NextRun;
+
+  // the metadata used by triggers during the current step, fetched on
+  // first use
+  bool HaveTriggerMetadata;
+  MeshMetadataMap TriggerMetadata;
+
+  // when set the configuration is that of an in transit end point, see
+  // SetEndPoint. HavePlacement is set when an analysis has a placement
+  bool EndPoint;
+  bool HavePlacement;
+
+  // set once the requirements were given to the in transit adaptor
+  bool PushedRequirements;
 };
 
+// --------------------------------------------------------------------------
+static double getCpuTime()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0.0;
+
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec/1.0e6 +
+    usage.ru_stime.tv_sec + usage.ru_stime.tv_usec/1.0e6;
+}
+
+// --------------------------------------------------------------------------
+void ConfigurableAnalysis::InternalsType::CostMeter::Start()
+{
+  this->WallTime = std::chrono::steady_clock::now();
+  this->CpuTime = getCpuTime();
+  this->Memory = MemoryProfiler::GetMemoryUsed();
+  this->PeakMemory = MemoryProfiler::GetPeakMemoryUsed();
+  this->Bytes = Profiler::GetThreadBytes();
+}
+
+// --------------------------------------------------------------------------
+void ConfigurableAnalysis::InternalsType::CostMeter::Stop(
+  ConfigurableAnalysis::AnalysisCost &cost, long long copyBytes,
+  std::mutex &mtx)
+{
+  double wallTime = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - this->WallTime).count();
+
+  double cpuTime = getCpuTime() - this->CpuTime;
+
+  // when the peak moved it was reached during the execution, otherwise
+  // only the growth at the end is known
+  long long memory = MemoryProfiler::GetMemoryUsed();
+  long long peakMemory = MemoryProfiler::GetPeakMemoryUsed();
+  long long memoryDelta = std::max(0ll, peakMemory > this->PeakMemory ?
+    peakMemory - this->Memory : memory - this->Memory);
+
+  long long bytes = Profiler::GetThreadBytes() - this->Bytes + copyBytes;
+
+  std::lock_guard<std::mutex> lock(mtx);
+
+  cost.NumExecutions += 1;
+  cost.LastTime = wallTime;
+  cost.TotalTime += wallTime;
+  cost.MaxTime = std::max(cost.MaxTime, wallTime);
+  cost.LastBytes = bytes;
+  cost.TotalBytes += bytes;
+  cost.LastMemoryDelta = memoryDelta;
+  cost.MaxMemoryDelta = std::max(cost.MaxMemoryDelta, memoryDelta);
+  cost.LastUtilization = wallTime > 0.0 ? cpuTime/wallTime : 0.0;
+}
+
 // --------------------------------------------------------------------------
 int ConfigurableAnalysis::InternalsType::TimeInitialization(
   AnalysisAdaptorPtr adaptor, std::function<int()> initializer)
 {
-  const char* analysisName = nullptr;
   bool logEnabled = Profiler::Enabled();
+  auto analysisNumber = this->Analyses.size();
   if (logEnabled)
     {
     std::ostringstream initName;
     std::ostringstream execName;
     std::ostringstream finiName;
-    auto analysisNumber = this->Analyses.size();
     initName << adaptor->GetClassName() << "::" << analysisNumber << "::Initialize";
     execName << adaptor->GetClassName() << "::" << analysisNumber << "::Execute";
     finiName << adaptor->GetClassName() << "::" << analysisNumber << "::Finalize";
     this->LogEventNames.push_back(initName.str());
     this->LogEventNames.push_back(execName.str());
     this->LogEventNames.push_back(finiName.str());
-    analysisName = this->LogEventNames[3 * analysisNumber].c_str();
-    Profiler::StartEvent(analysisName);
     }
 
-  int result = initializer();
+  this->Startup.resize(analysisNumber + 1);
+  StartupControl &startup = this->Startup[analysisNumber];
 
-  if (logEnabled)
-    Profiler::EndEvent(analysisName);
+  // the name is looked up when the step runs, the vector may have grown
+  std::function<int()> step = [this, logEnabled, analysisNumber, initializer]() -> int
+    {
+    const char *analysisName = logEnabled ?
+      this->LogEventNames[3 * analysisNumber].c_str() : nullptr;
+
+    if (analysisName)
+      Profiler::StartEvent(analysisName);
+
+    int result = initializer();
+
+    if (analysisName)
+      Profiler::EndEvent(analysisName);
+
+    return result;
+    };
+
+  startup.Lazy = this->LazyInit;
+  startup.Initialized = !this->LazyInit;
+
+  if (this->LazyInit)
+    {
+    startup.Steps.push_back(step);
+    return 0;
+    }
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+  int result = step();
+
+  startup.Time += std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - t0).count();
 
   return result;
 }
 
 // --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddHistogram(pugi::xml_node node)
+int ConfigurableAnalysis::InternalsType::DeferInitialization(
+  AnalysisAdaptor *adaptor, std::function<int()> step)
 {
-  if (XMLUtils::RequireAttribute(node, "mesh") || XMLUtils::RequireAttribute(node, "array"))
-    {
-    SENSEI_ERROR("Failed to initialize Histogram");
-    return -1;
-    }
+  // the adaptor is added after its initialization has been set up
+  unsigned int nAnalyses = this->Analyses.size();
+  unsigned int i = 0;
+  while ((i < nAnalyses) && (this->Analyses[i].GetPointer() != adaptor))
+    ++i;
 
-  int association = 0;
-  std::string assocStr = node.attribute("association").as_string("point");
-  if (VTKUtils::GetAssociation(assocStr, association))
+  if ((i < this->Startup.size()) && !this->Startup[i].Initialized)
     {
-    SENSEI_ERROR("Failed to initialize Histogram");
-    return -1;
+    this->Startup[i].Steps.push_back(step);
+    return 0;
     }
 
-  std::string mesh = node.attribute("mesh").value();
-  std::string array = node.attribute("array").value();
-  int bins = node.attribute("bins").as_int(10);
-  std::string fileName = node.attribute("file").value();
-
-  auto histogram = vtkSmartPointer<Histogram>::New();
-
-  if (this->Comm != MPI_COMM_NULL)
-    histogram->SetCommunicator(this->Comm);
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
 
-  this->TimeInitialization(histogram, [&]() {
-      histogram->Initialize(bins, mesh, association, array, fileName);
-      return 0;
-    });
-  this->Analyses.push_back(histogram.GetPointer());
+  int result = step();
 
-  SENSEI_STATUS("Configured histogram with " << bins
-    << " bins on " << assocStr << " data array \"" << array
-    << "\" on mesh \"" << mesh << "\" writing output to "
-    << (fileName.empty() ? "cout" : "file"))
+  if (i < this->Startup.size())
+    this->Startup[i].Time += std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - t0).count();
 
-  return 0;
+  return result;
 }
 
 // --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddVTKmContour(pugi::xml_node node)
+int ConfigurableAnalysis::InternalsType::InitializeAnalysis(unsigned int i)
 {
-#ifndef ENABLE_VTK_ACCELERATORS
-  (void)node;
-  SENSEI_ERROR("vtkAcceleratorsVtkm was requested but is disabled in this build")
-  return -1;
-#else
+  if ((i >= this->Startup.size()) || this->Startup[i].Initialized)
+    return 0;
 
-  if (XMLUtils::RequireAttribute(node, "mesh") || XMLUtils::RequireAttribute(node, "array"))
+  StartupControl &startup = this->Startup[i];
+  startup.Initialized = true;
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+  int ierr = 0;
+  unsigned int nSteps = startup.Steps.size();
+  for (unsigned int j = 0; !ierr && (j < nSteps); ++j)
+    ierr = startup.Steps[j]();
+
+  startup.Steps.clear();
+
+  startup.Time += std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - t0).count();
+
+  if (ierr)
     {
-    SENSEI_ERROR("Failed to initialize VTKmContourAnalysis");
+    SENSEI_ERROR("Failed to initialize " << this->Analyses[i]->GetClassName())
     return -1;
     }
 
-  auto mesh = node.attribute("mesh");
-  auto array = node.attribute("array");
+  return 0;
+}
 
-  double value = node.attribute("value").as_double(0.0);
-  bool writeOutput = node.attribute("write_output").as_bool(false);
+// --------------------------------------------------------------------------
+void ConfigurableAnalysis::InternalsType::StartPrewarm()
+{
+  this->Prewarming = std::async(std::launch::async, [this]() -> int
+    {
+    TaskRuntime::BindThread("ConfigurableAnalysis::Prewarm");
+    TimeEvent<128> mark("ConfigurableAnalysis::Prewarm");
 
-  auto contour = vtkSmartPointer<VTKmContourAnalysis>::New();
+    int ierr = 0;
+    unsigned int nAnalyses = this->Startup.size();
+    for (unsigned int i = 0; i < nAnalyses; ++i)
+      {
+      if (this->InitializeAnalysis(i))
+        ierr = -1;
+      }
 
-  if (this->Comm != MPI_COMM_NULL)
-    contour->SetCommunicator(this->Comm);
+    return ierr;
+    });
+}
 
-  this->TimeInitialization(contour, [&]() {
-    contour->Initialize(mesh.value(), array.value(), value, writeOutput);
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::WaitPrewarm()
+{
+  if (!this->Prewarming.valid())
     return 0;
-    });
-  this->Analyses.push_back(contour.GetPointer());
 
-  SENSEI_STATUS("Configured VTKmContourAnalysis " << array.value())
+  TimeEvent<128> mark("ConfigurableAnalysis::WaitPrewarm");
+  return this->Prewarming.get();
+}
 
-  return 0;
-#endif
+// --------------------------------------------------------------------------
+void ConfigurableAnalysis::InternalsType::ReportStartup(MPI_Comm comm)
+{
+  unsigned int nAnalyses = this->Startup.size();
+  if (nAnalyses == 0)
+    return;
+
+  std::vector<double> times(nAnalyses);
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    times[i] = this->Startup[i].Time;
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  MPI_Reduce(rank == 0 ? MPI_IN_PLACE : times.data(), times.data(),
+    nAnalyses, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    const std::string &name = i < this->Controls.size() ?
+      this->Controls[i].Cost.Name : this->Analyses[i]->GetClassName();
+
+    if (this->Startup[i].Lazy)
+      SENSEI_STATUS("Initialization of " << name << " is deferred")
+    else
+      SENSEI_STATUS("Initialized " << name << " in " << times[i] << " s")
+    }
 }
 
 // --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddVTKmVolumeReduction(pugi::xml_node node)
+int ConfigurableAnalysis::InternalsType::GetArrayRequirements(
+  pugi::xml_node node, DataRequirements &reqs, std::string &arrayList)
 {
-#ifndef ENABLE_VTKM
-  (void)node;
-  SENSEI_ERROR("VTK-m analysis was requested but is disabled in this build")
-  return -1;
-#else
-  if (XMLUtils::RequireAttribute(node, "mesh") || XMLUtils::RequireAttribute(node, "field") ||
-    XMLUtils::RequireAttribute(node, "association") || XMLUtils::RequireAttribute(node, "reduction"))
+  // the arrays are given either by mesh elements, which allows for any
+  // number of meshes and arrays, or by the mesh and array attributes
+  if (node.child("mesh"))
     {
-    SENSEI_ERROR("Failed to initialize VTKmVolumeReductionAnalysis");
-    return -1;
+    if (reqs.Initialize(node))
+      return -1;
     }
+  else
+    {
+    if (XMLUtils::RequireAttribute(node, "mesh") || XMLUtils::RequireAttribute(node, "array"))
+      return -1;
 
-  auto mesh = node.attribute("mesh").as_string();
-  auto field = node.attribute("field").as_string();
-  auto assoc = node.attribute("association").as_string();
-  auto reduction = node.attribute("reduction").as_int();
+    int association = 0;
+    std::string assocStr = node.attribute("association").as_string("point");
+    if (VTKUtils::GetAssociation(assocStr, association))
+      return -1;
 
-  std::string workDir = node.attribute("working-directory").as_string(".");
+    std::string mesh = node.attribute("mesh").value();
+    std::string array = node.attribute("array").value();
 
-  auto reducer = vtkSmartPointer<VTKmVolumeReductionAnalysis>::New();
-  this->TimeInitialization(reducer, [&]() {
-    reducer->Initialize(mesh, field, assoc, workDir, reduction, this->Comm);
-    return 0;
-  });
-  this->Analyses.push_back(reducer.GetPointer());
+    reqs.AddRequirement(mesh, true);
+    reqs.AddRequirement(mesh, association, array);
+    }
 
-  SENSEI_STATUS("Configured VTKmVolumeReductionAnalysis " << mesh << "/" << field)
+  // list the arrays for the status message
+  int nArrays = 0;
+  std::ostringstream arrays;
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    ArrayRequirementsIterator ait =
+      reqs.GetArrayRequirementsIterator(mit.MeshName());
+    for (; ait; ++ait, ++nArrays)
+      {
+      arrays << " " << VTKUtils::GetAttributesName(ait.Association())
+        << " data array \"" << ait.Array() << "\" on mesh \""
+        << mit.MeshName() << "\"";
+      }
+    }
 
-  return 0;
-#endif
+  arrayList = arrays.str();
+
+  return nArrays;
 }
 
 // --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddVTKmCDF(pugi::xml_node node)
+int ConfigurableAnalysis::InternalsType::GetPhase(pugi::xml_node node,
+  const char *defaultPrefix, int &phase, std::string &prefix)
 {
-#ifndef ENABLE_VTKM
-  (void)node;
-  SENSEI_ERROR("VTK-m analysis was requested but is disabled in this build")
-  return -1;
-#else
-  if (
-    XMLUtils::RequireAttribute(node, "mesh") ||
-    XMLUtils::RequireAttribute(node, "field") ||
-    XMLUtils::RequireAttribute(node, "association")
-    )
+  std::string phaseStr = node.attribute("phase").as_string("all");
+  if (PartialResultsDataAdaptor::GetPhase(phaseStr, phase))
     {
-    SENSEI_ERROR("Failed to initialize VTKmCDFAnalysis");
+    SENSEI_ERROR("Invalid phase \"" << phaseStr << "\". The phase is one of"
+      " all, local, or global")
     return -1;
     }
 
-  auto mesh = node.attribute("mesh").as_string();
-  auto field = node.attribute("field").as_string();
-  auto assoc = node.attribute("association").as_string();
-  auto quantiles = node.attribute("quantiles").as_int(10);
-  auto exchangeSize = node.attribute("exchange-size").as_int(quantiles);
-
-  bool haveWorkDir = !!node.attribute("working-directory");
-  std::string workDir =  haveWorkDir ? node.attribute("working-directory").as_string() : ".";
-
-  auto analysis = vtkSmartPointer<VTKmCDFAnalysis>::New();
-  this->TimeInitialization(analysis, [&]() {
-    analysis->Initialize(mesh, field, assoc, workDir, quantiles, exchangeSize, this->Comm);
-    return 0;
-  });
-  this->Analyses.push_back(analysis.GetPointer());
+  prefix = node.attribute("partial").as_string(defaultPrefix);
 
-  SENSEI_STATUS("Configured VTKmCDFAnalysis " << mesh << "/" << field)
+  if (phase == PartialResultsDataAdaptor::PHASE_LOCAL)
+    this->HavePartialResults = true;
 
   return 0;
-#endif
 }
 
 // --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddAscent(pugi::xml_node node)
+int ConfigurableAnalysis::InternalsType::AddHistogram(pugi::xml_node node)
 {
-#ifndef ENABLE_ASCENT
-  (void)node;
-  SENSEI_ERROR("Ascent was requested but is disabled in this build")
-  return( -1 );
-#else
-  vtkNew<AscentAnalysisAdaptor> ascent;
+  DataRequirements reqs;
+  std::string arrays;
 
-  if (this->Comm != MPI_COMM_NULL)
-    ascent->SetCommunicator(this->Comm);
+  int nArrays = this->GetArrayRequirements(node, reqs, arrays);
+  if (nArrays < 0)
+    {
+    SENSEI_ERROR("Failed to initialize Histogram");
+    return -1;
+    }
 
-  // get the data requirements for this run
-  DataRequirements req;
-  if (req.Initialize(node) || req.Empty())
+  if (nArrays < 1)
     {
-    SENSEI_ERROR("Failed to initialize the AscentAnalysisAdaptor."
-      << " Missing data requirements.")
+    SENSEI_ERROR("Failed to initialize Histogram. No arrays were specified");
     return -1;
     }
-  ascent->SetDataRequirements(req);
 
-  // get the json files used to configure ascent
-  std::string options_file;
-  std::string actions_file;
+  int bins = node.attribute("bins").as_int(10);
+  std::string fileName = node.attribute("file").value();
+  int threads = node.attribute("threads").as_int(1);
+  int batchSize = node.attribute("batch_size").as_int(0);
+  double sampleFraction = node.attribute("sample_fraction").as_double(1.0);
+  double errorBound = node.attribute("error_bound").as_double(0.0);
+  int accumulateSteps = node.attribute("accumulate_steps").as_int(1);
+  bool async = node.attribute("asynchronous").as_bool(false);
+
+  int phase = PartialResultsDataAdaptor::PHASE_ALL;
+  std::string prefix;
+  if (this->GetPhase(node, "histogram", phase, prefix))
+    {
+    SENSEI_ERROR("Failed to initialize Histogram");
+    return -1;
+    }
 
-  // Check if the xml file has the ascent options filename.
-  if(node.attribute("options"))
-    options_file = node.attribute("options").value();
+  // the partial results are exact counts
+  if ((phase != PartialResultsDataAdaptor::PHASE_ALL) &&
+    ((sampleFraction < 1.0) || (errorBound > 0.0)))
+    {
+    SENSEI_ERROR("Failed to initialize Histogram. A histogram split in"
+      " phases is not sampled");
+    return -1;
+    }
 
-  // Check if the xml file has the ascent actions filename.
-  if (XMLUtils::RequireAttribute(node, "actions"))
+  if (!(sampleFraction > 0.0) || (sampleFraction > 1.0) || (errorBound < 0.0))
     {
-    SENSEI_ERROR("Failed to initialize the AscentAnalysisAdaptor");
+    SENSEI_ERROR("Failed to initialize Histogram. Invalid sample_fraction "
+      << sampleFraction << " or error_bound " << errorBound);
     return -1;
     }
 
-  actions_file = node.attribute("actions").value();
+  if (accumulateSteps < 0)
+    {
+    SENSEI_ERROR("Failed to initialize Histogram. Invalid accumulate_steps "
+      << accumulateSteps);
+    return -1;
+    }
 
-  if (ascent->Initialize(actions_file, options_file))
+  // a fixed range is given by both range_min and range_max
+  pugi::xml_attribute rangeMin = node.attribute("range_min");
+  pugi::xml_attribute rangeMax = node.attribute("range_max");
+  if ((bool(rangeMin) != bool(rangeMax)) ||
+    (rangeMin && !(rangeMin.as_double() < rangeMax.as_double())))
     {
-    SENSEI_ERROR("Failed to initialize ascent using the actions \""
-      << actions_file << "\" and options \"" << options_file << "\"")
+    SENSEI_ERROR("Failed to initialize Histogram. range_min and range_max "
+      "must both be given with range_min less than range_max");
     return -1;
     }
 
-  this->Analyses.push_back(ascent.GetPointer());
+  auto histogram = vtkSmartPointer<Histogram>::New();
 
-  SENSEI_STATUS("Configured the AscentAnalysisAdaptor with actions \""
-    << actions_file << "\" and options \"" << options_file << "\"")
+  if (this->Comm != MPI_COMM_NULL)
+    histogram->SetCommunicator(this->Comm);
 
-  return 0;
-#endif
-}
+  histogram->SetNumberOfThreads(threads);
+  histogram->SetBatchSize(batchSize);
+  histogram->SetSampleFraction(sampleFraction);
+  histogram->SetErrorBound(errorBound);
+  histogram->SetAccumulationSteps(accumulateSteps);
+  histogram->SetAsynchronous(async);
+  histogram->SetPhase(phase);
+  histogram->SetPartialPrefix(prefix);
 
+  if (rangeMin)
+    histogram->SetRange(rangeMin.as_double(), rangeMax.as_double());
 
-// --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddAdios1(pugi::xml_node node)
-{
-#ifndef ENABLE_ADIOS1
-  (void)node;
-  SENSEI_ERROR("ADIOS 1 was requested but is disabled in this build")
-  return -1;
-#else
-  auto adios = vtkSmartPointer<ADIOS1AnalysisAdaptor>::New();
+  this->TimeInitialization(histogram, [&]() {
+      histogram->Initialize(bins, reqs, fileName);
+      return 0;
+    });
+  this->Analyses.push_back(histogram.GetPointer());
 
-  if (this->Comm != MPI_COMM_NULL)
-    adios->SetCommunicator(this->Comm);
+  SENSEI_STATUS("Configured histogram with " << bins << " bins on"
+    << arrays << " writing output to "
+    << (fileName.empty() ? "cout" : "file"))
 
-  pugi::xml_attribute filename = node.attribute("filename");
-  if (filename)
-    adios->SetFileName(filename.value());
+  return 0;
+}
 
-  pugi::xml_attribute method = node.attribute("method");
-  if (method)
-    adios->SetMethod(method.value());
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddStatistics(pugi::xml_node node)
+{
+  DataRequirements reqs;
+  std::string arrays;
 
-  unsigned long maxBufSize =
-    node.attribute("max_buffer_size").as_ullong(0);
-  adios->SetMaxBufferSize(maxBufSize);
+  int nArrays = this->GetArrayRequirements(node, reqs, arrays);
+  if (nArrays < 0)
+    {
+    SENSEI_ERROR("Failed to initialize Statistics");
+    return -1;
+    }
 
-  DataRequirements req;
-  if (req.Initialize(node))
+  if (nArrays < 1)
     {
-    SENSEI_ERROR("Failed to initialize ADIOS 1.")
+    SENSEI_ERROR("Failed to initialize Statistics. No arrays were specified");
     return -1;
     }
-  adios->SetDataRequirements(req);
 
-  this->TimeInitialization(adios);
-  this->Analyses.push_back(adios.GetPointer());
+  std::string fileName = node.attribute("file").value();
+  int threads = node.attribute("threads").as_int(1);
 
-  SENSEI_STATUS("Configured ADIOSAnalysisAdaptor filename=\""
-    << filename.value() << "\" method " << method.value()
-    << " max_buffer_size=" << maxBufSize)
+  int phase = PartialResultsDataAdaptor::PHASE_ALL;
+  std::string prefix;
+  if (this->GetPhase(node, "statistics", phase, prefix))
+    {
+    SENSEI_ERROR("Failed to initialize Statistics");
+    return -1;
+    }
+
+  auto statistics = vtkSmartPointer<Statistics>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    statistics->SetCommunicator(this->Comm);
+
+  statistics->SetNumberOfThreads(threads);
+  statistics->SetAsynchronous(node.attribute("asynchronous").as_bool(false));
+  statistics->SetPhase(phase);
+  statistics->SetPartialPrefix(prefix);
+
+  this->TimeInitialization(statistics, [&]() {
+      statistics->Initialize(reqs, fileName);
+      return 0;
+    });
+  this->Analyses.push_back(statistics.GetPointer());
+
+  SENSEI_STATUS("Configured statistics on" << arrays << " writing output to "
+    << (fileName.empty() ? "cout" : "file"))
 
   return 0;
-#endif
 }
 
 // --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddAdios2(pugi::xml_node node)
+int ConfigurableAnalysis::InternalsType::AddTemporalStatistics(pugi::xml_node node)
 {
-#ifndef ENABLE_ADIOS2
-  (void)node;
-  SENSEI_ERROR("ADIOS 2 was requested but is disabled in this build")
-  return -1;
-#else
-  auto adiosAdaptor = vtkSmartPointer<ADIOS2AnalysisAdaptor>::New();
+  DataRequirements reqs;
+  std::string arrays;
 
-  if (this->Comm != MPI_COMM_NULL)
-    adiosAdaptor->SetCommunicator(this->Comm);
+  int nArrays = this->GetArrayRequirements(node, reqs, arrays);
+  if (nArrays < 0)
+    {
+    SENSEI_ERROR("Failed to initialize TemporalStatistics");
+    return -1;
+    }
 
-  if (XMLUtils::RequireAttribute(node, "engine") ||
-    XMLUtils::RequireAttribute(node, "filename"))
+  if (nArrays < 1)
     {
-    SENSEI_ERROR("Failed to initialize ADIOS2AnalysisAdaptor");
+    SENSEI_ERROR("Failed to initialize TemporalStatistics. No arrays were specified");
     return -1;
     }
 
-  std::string filename = node.attribute("filename").value();
-  adiosAdaptor->SetFileName(filename);
+  int window = node.attribute("window").as_int(10);
+  if (window < 1)
+    {
+    SENSEI_ERROR("Failed to initialize TemporalStatistics. The window must"
+      " be positive, not " << window);
+    return -1;
+    }
 
-  std::string engine = node.attribute("engine").value();
-  adiosAdaptor->SetEngineName(engine);
+  std::string statsStr = node.attribute("stats").as_string("all");
+  int stats = 0;
+  if (TemporalStatistics::GetStatistics(statsStr, stats))
+    {
+    SENSEI_ERROR("Failed to initialize TemporalStatistics");
+    return -1;
+    }
 
-  // buffer size is given in the units of number of time steps,
-  // 0 means buffer all steps
-  std::string bufferSize = node.attribute("buffer_size").as_string("");
-  if (!bufferSize.empty())
-    adiosAdaptor->AddParameter("QueueLimit", bufferSize);
+  // the history may be stored at reduced precision
+  std::string storageStr = node.attribute("storage").as_string("float");
+  int storage = 0;
+  if (TemporalWindow::GetStorage(storageStr, storage))
+    {
+    SENSEI_ERROR("Failed to initialize TemporalStatistics");
+    return -1;
+    }
 
-  // valid modes are Block or Discard
-  std::string bufferMode = node.attribute("buffer_mode").as_string("");
-  if (!bufferMode.empty())
-    adiosAdaptor->AddParameter("QueueFullPolicy", bufferMode);
+  std::string fileName = node.attribute("file").value();
+  int threads = node.attribute("threads").as_int(1);
+  int publish = node.attribute("publish").as_int(0);
 
-  // turn on/off debug output
-  adiosAdaptor->SetDebugMode(node.attribute("debug_mode").as_int(0));
+  auto temporal = vtkSmartPointer<TemporalStatistics>::New();
 
-  DataRequirements req;
-  if (req.Initialize(node))
+  if (this->Comm != MPI_COMM_NULL)
+    temporal->SetCommunicator(this->Comm);
+
+  temporal->SetNumberOfThreads(threads);
+  temporal->SetStorage(storage);
+  temporal->SetPublish(publish);
+
+  this->TimeInitialization(temporal, [&]() {
+      temporal->Initialize(reqs, window, stats, fileName);
+      return 0;
+    });
+
+  // the fields are served to the analyses that run after
+  if (publish)
     {
-    SENSEI_ERROR("Failed to initialize ADIOS 2.")
-    return -1;
+    std::vector<std::string> names;
+    temporal->GetPublishedMeshNames(names);
+    this->Published.insert(names.begin(), names.end());
+    this->HavePartialResults = true;
     }
-  adiosAdaptor->SetDataRequirements(req);
 
-  this->TimeInitialization(adiosAdaptor);
-  this->Analyses.push_back(adiosAdaptor.GetPointer());
+  this->Analyses.push_back(temporal.GetPointer());
 
-  SENSEI_STATUS("Configured ADIOSAnalysisAdaptor filename=\""
-    << filename << "\" engine=" << engine
-    << (!bufferMode.empty() ? "buffer_mode=" : "")
-    << (!bufferMode.empty() ? bufferMode.c_str() : "")
-    << (!bufferSize.empty() ? "buffer_size=" : "")
-    << (!bufferSize.empty() ? bufferSize.c_str() : ""))
+  SENSEI_STATUS("Configured temporal statistics " << statsStr << " over "
+    << window << " steps on" << arrays << " storage " << storageStr
+    << " publish " << publish << " writing output to "
+    << (fileName.empty() ? "cout" : "file"))
 
   return 0;
-#endif
 }
 
 // --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddHDF5(pugi::xml_node node)
+int ConfigurableAnalysis::InternalsType::AddExtremes(pugi::xml_node node)
 {
-#ifndef ENABLE_HDF5
-  (void)node;
-  SENSEI_ERROR("HDF5 was requested but is disabled in this build");
-  return -1;
-#else
-  auto dataE = vtkSmartPointer<HDF5AnalysisAdaptor>::New();
-
-  if(this->Comm != MPI_COMM_NULL)
-    dataE->SetCommunicator(this->Comm);
+  DataRequirements reqs;
+  std::string arrays;
 
-  pugi::xml_attribute filename = node.attribute("filename");
-  pugi::xml_attribute methodAttr = node.attribute("method");
+  int nArrays = this->GetArrayRequirements(node, reqs, arrays);
+  if (nArrays < 0)
+    {
+    SENSEI_ERROR("Failed to initialize Extremes");
+    return -1;
+    }
 
-  if(filename)
-    dataE->SetStreamName(filename.value());
+  if (nArrays < 1)
+    {
+    SENSEI_ERROR("Failed to initialize Extremes. No arrays were specified");
+    return -1;
+    }
 
-  if(methodAttr)
+  int k = node.attribute("k").as_int(100);
+  if (k < 1)
     {
-      std::string method = methodAttr.value();
+    SENSEI_ERROR("Failed to initialize Extremes. k must be positive, not " << k);
+    return -1;
+    }
 
-      if(method.size() > 0)
-        {
-          bool doStreaming = ('s' == method[0]);
-          bool doCollectiveTxf = ((method.size() > 1) && ('c' == method[1]));
+  bool smallest = node.attribute("smallest").as_bool(false);
+  std::string fileName = node.attribute("file").value();
+  int threads = node.attribute("threads").as_int(1);
 
-          dataE->SetStreaming(doStreaming);
-          dataE->SetCollective(doCollectiveTxf);
-        }
-    }
+  auto extremes = vtkSmartPointer<Extremes>::New();
 
-  DataRequirements req;
-  if (req.Initialize(node))
+  if (this->Comm != MPI_COMM_NULL)
+    extremes->SetCommunicator(this->Comm);
+
+  extremes->SetNumberOfThreads(threads);
+
+  this->TimeInitialization(extremes, [&]() {
+      extremes->Initialize(reqs, k, smallest, fileName);
+      return 0;
+    });
+  this->Analyses.push_back(extremes.GetPointer());
+
+  SENSEI_STATUS("Configured the " << k << (smallest ? " smallest" : " largest")
+    << " values of" << arrays << " writing output to "
+    << (fileName.empty() ? "cout" : "file"))
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddConnectedComponents(pugi::xml_node node)
+{
+  if (XMLUtils::RequireAttribute(node, "mesh") ||
+    XMLUtils::RequireAttribute(node, "array") ||
+    XMLUtils::RequireAttribute(node, "threshold"))
     {
-    SENSEI_ERROR("Failed to initialize HDF5 Transport.")
+    SENSEI_ERROR("Failed to initialize ConnectedComponents");
     return -1;
     }
-  dataE->SetDataRequirements(req);
 
+  std::string meshName = node.attribute("mesh").value();
+  std::string arrayName = node.attribute("array").value();
+  double threshold = node.attribute("threshold").as_double();
+  bool below = node.attribute("below").as_bool(false);
+  long long minCells = node.attribute("min_cells").as_llong(1);
+  std::string fileName = node.attribute("file").value();
+  int threads = node.attribute("threads").as_int(1);
+
+  auto components = vtkSmartPointer<ConnectedComponents>::New();
 
-  this->TimeInitialization(dataE);
-  this->Analyses.push_back(dataE.GetPointer());
+  if (this->Comm != MPI_COMM_NULL)
+    components->SetCommunicator(this->Comm);
 
-  SENSEI_STATUS("Configured HDF5 AnalysisAdaptor \"" << filename.value())
+  components->SetNumberOfThreads(threads);
+
+  this->TimeInitialization(components, [&]() {
+      components->Initialize(meshName, arrayName, threshold, below, minCells,
+        fileName);
+      return 0;
+    });
+  this->Analyses.push_back(components.GetPointer());
+
+  SENSEI_STATUS("Configured connected components of " << meshName << " "
+    << arrayName << (below ? " < " : " > ") << threshold << " writing output to "
+    << (fileName.empty() ? "cout" : "file"))
 
   return 0;
-#endif
 }
 
-
 // --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddCatalyst(pugi::xml_node node)
+int ConfigurableAnalysis::InternalsType::AddParticleDeposition(pugi::xml_node node)
 {
-#ifndef ENABLE_CATALYST
-  (void)node;
-  SENSEI_ERROR("Catalyst was requested but is disabled in this build")
-  return -1;
-#else
-  // a single adaptor used with multiple pipelines
-  if (!this->CatalystAdaptor)
+  int dims[3] = {0, 0, 0};
+  double bounds[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+  if (XMLUtils::RequireAttribute(node, "dims") ||
+    XMLUtils::RequireAttribute(node, "bounds") ||
+    (std::sscanf(node.attribute("dims").value(), "%d,%d,%d",
+    &dims[0], &dims[1], &dims[2]) != 3) ||
+    (std::sscanf(node.attribute("bounds").value(), "%lg,%lg,%lg,%lg,%lg,%lg",
+    &bounds[0], &bounds[1], &bounds[2], &bounds[3], &bounds[4], &bounds[5]) != 6))
     {
-    this->CatalystAdaptor = vtkSmartPointer<CatalystAnalysisAdaptor>::New();
-
-    if (this->Comm != MPI_COMM_NULL)
-      this->CatalystAdaptor->SetCommunicator(this->Comm);
+    SENSEI_ERROR("Failed to initialize ParticleDeposition. The dims and"
+      " bounds attributes must give 3 and 6 comma separated values")
+    return -1;
+    }
 
-    this->TimeInitialization(this->CatalystAdaptor);
-    this->Analyses.push_back(this->CatalystAdaptor);
+  int scheme = ParticleDeposition::SCHEME_CIC;
+  if (node.attribute("scheme") &&
+    ParticleDeposition::GetScheme(node.attribute("scheme").value(), scheme))
+    {
+    SENSEI_ERROR("Failed to initialize ParticleDeposition");
+    return -1;
     }
 
-  // Add the pipelines
-  if (strcmp(node.attribute("pipeline").value(), "slice") == 0)
+  std::string meshName = node.attribute("mesh").as_string("particles");
+  std::string velocity = node.attribute("velocity").value();
+  std::string fileName = node.attribute("file").value();
+  int threads = node.attribute("threads").as_int(1);
+
+  auto deposition = vtkSmartPointer<ParticleDeposition>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    deposition->SetCommunicator(this->Comm);
+
+  deposition->SetNumberOfThreads(threads);
+
+  if (this->TimeInitialization(deposition,
+    [deposition, meshName, velocity, dims, bounds, scheme, fileName]() {
+      return deposition->Initialize(meshName, velocity, dims, bounds,
+        scheme, fileName);
+    }))
     {
-    vtkNew<CatalystSlice> slice;
+    SENSEI_ERROR("Failed to initialize ParticleDeposition");
+    return -1;
+    }
 
-    double tmp[3];
-    if (node.attribute("mesh"))
-      {
-      slice->SetInputMesh(node.attribute("mesh").value());
-      }
-    if (node.attribute("slice-normal") &&
-      (std::sscanf(node.attribute("slice-normal").value(),
-      "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3))
-      {
-      slice->SetSliceNormal(tmp[0], tmp[1], tmp[2]);
-      }
+  this->Analyses.push_back(deposition.GetPointer());
 
-    if (node.attribute("slice-origin") &&
-      (std::sscanf(node.attribute("slice-origin").value(),
-      "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3))
-      {
-      slice->SetSliceOrigin(tmp[0], tmp[1], tmp[2]);
-      slice->SetAutoCenter(false);
-      }
-    else
-      {
-      slice->SetAutoCenter(true);
-      }
+  SENSEI_STATUS("Configured deposition of mesh \"" << meshName << "\" onto "
+    << dims[0] << "x" << dims[1] << "x" << dims[2] << " cells writing output to "
+    << (fileName.empty() ? "memory" : "file"))
 
-    int association = 0;
-    std::string assocStr = node.attribute("association").as_string("point");
-    if (VTKUtils::GetAssociation(assocStr, association))
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddParticleTracer(pugi::xml_node node)
+{
+  if (XMLUtils::RequireAttribute(node, "mesh") ||
+    XMLUtils::RequireAttribute(node, "velocity"))
+    {
+    SENSEI_ERROR("Failed to initialize ParticleTracer");
+    return -1;
+    }
+
+  // the seeds are listed, or placed at random in a box
+  std::vector<double> seeds;
+  if (node.attribute("seeds"))
+    {
+    std::string list = node.attribute("seeds").value();
+    std::replace(list.begin(), list.end(), ',', ' ');
+
+    std::istringstream iss(list);
+    double x = 0.0;
+    while (iss >> x)
+      seeds.push_back(x);
+    }
+  else
+    {
+    double bounds[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (XMLUtils::RequireAttribute(node, "seed_bounds") ||
+      (std::sscanf(node.attribute("seed_bounds").value(), "%lg,%lg,%lg,%lg,%lg,%lg",
+      &bounds[0], &bounds[1], &bounds[2], &bounds[3], &bounds[4], &bounds[5]) != 6))
       {
-      SENSEI_ERROR("Failed to initialize Catalyst")
+      SENSEI_ERROR("Failed to initialize ParticleTracer. The seeds must be"
+        " listed or seed_bounds must give 6 comma separated values")
       return -1;
       }
 
-    slice->ColorBy(association, node.attribute("array").value());
-    if (node.attribute("color-range") &&
-      (std::sscanf(node.attribute("color-range").value(), "%lg,%lg", &tmp[0], &tmp[1]) == 2))
-      {
-      slice->SetAutoColorRange(false);
-      slice->SetColorRange(tmp[0], tmp[1]);
-      }
+    long long nSeeds = node.attribute("num_seeds").as_llong(100);
+    unsigned int seed = node.attribute("random_seed").as_uint(0);
+
+    ParticleTracer::GetRandomSeeds(bounds, nSeeds, seed, seeds);
+    }
+
+  int association = 0;
+  std::string assocStr = node.attribute("association").as_string("point");
+  if (VTKUtils::GetAssociation(assocStr, association))
+    {
+    SENSEI_ERROR("Failed to initialize ParticleTracer. Invalid association \""
+      << assocStr << "\"");
+    return -1;
+    }
+
+  std::string meshName = node.attribute("mesh").value();
+  std::string velocity = node.attribute("velocity").value();
+  double dt = node.attribute("dt").as_double(0.0);
+  int substeps = node.attribute("substeps").as_int(1);
+  bool periodic = node.attribute("periodic").as_bool(false);
+  int writeInterval = node.attribute("write_interval").as_int(10);
+  std::string fileName = node.attribute("file").value();
+  int threads = node.attribute("threads").as_int(1);
+
+  auto tracer = vtkSmartPointer<ParticleTracer>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    tracer->SetCommunicator(this->Comm);
+
+  tracer->SetNumberOfThreads(threads);
+
+  if (this->TimeInitialization(tracer, [&]() {
+      return tracer->Initialize(meshName, velocity, association, seeds, dt,
+        substeps, periodic, writeInterval, fileName);
+    }))
+    {
+    SENSEI_ERROR("Failed to initialize ParticleTracer");
+    return -1;
+    }
+
+  this->Analyses.push_back(tracer.GetPointer());
+
+  SENSEI_STATUS("Configured tracing of " << seeds.size()/3 << " particles"
+    " through " << meshName << " " << velocity << " writing output to "
+    << (fileName.empty() ? "memory" : "file"))
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddVTKmContour(pugi::xml_node node)
+{
+#ifndef ENABLE_VTK_ACCELERATORS
+  (void)node;
+  SENSEI_ERROR("vtkAcceleratorsVtkm was requested but is disabled in this build")
+  return -1;
+#else
+
+  if (XMLUtils::RequireAttribute(node, "mesh") || XMLUtils::RequireAttribute(node, "array"))
+    {
+    SENSEI_ERROR("Failed to initialize VTKmContourAnalysis");
+    return -1;
+    }
+
+  auto mesh = node.attribute("mesh");
+  auto array = node.attribute("array");
+
+  double value = node.attribute("value").as_double(0.0);
+  bool writeOutput = node.attribute("write_output").as_bool(false);
+
+  auto contour = vtkSmartPointer<VTKmContourAnalysis>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    contour->SetCommunicator(this->Comm);
+
+  // merge points, decimate and quantize the contours before they are
+  // written
+  if (pugi::xml_node reduceNode = node.child("reduce"))
+    {
+    PolyDataReducer reducer;
+    if (reducer.Initialize(reduceNode))
+      return -1;
+
+    contour->SetReducer(reducer);
+    }
+
+  this->TimeInitialization(contour, [&]() {
+    contour->Initialize(mesh.value(), array.value(), value, writeOutput);
+    return 0;
+    });
+  this->Analyses.push_back(contour.GetPointer());
+
+  SENSEI_STATUS("Configured VTKmContourAnalysis " << array.value())
+
+  return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddVTKmVolumeReduction(pugi::xml_node node)
+{
+#ifndef ENABLE_VTKM
+  (void)node;
+  SENSEI_ERROR("VTK-m analysis was requested but is disabled in this build")
+  return -1;
+#else
+  if (XMLUtils::RequireAttribute(node, "mesh") || XMLUtils::RequireAttribute(node, "field") ||
+    XMLUtils::RequireAttribute(node, "association") || XMLUtils::RequireAttribute(node, "reduction"))
+    {
+    SENSEI_ERROR("Failed to initialize VTKmVolumeReductionAnalysis");
+    return -1;
+    }
+
+  auto mesh = node.attribute("mesh").as_string();
+  auto field = node.attribute("field").as_string();
+  auto assoc = node.attribute("association").as_string();
+  auto reduction = node.attribute("reduction").as_int();
+
+  std::string workDir = node.attribute("working-directory").as_string(".");
+
+  auto reducer = vtkSmartPointer<VTKmVolumeReductionAnalysis>::New();
+  this->TimeInitialization(reducer, [&]() {
+    reducer->Initialize(mesh, field, assoc, workDir, reduction, this->Comm);
+    reducer->SetPyramid(node.attribute("pyramid").as_int(0));
+    reducer->SetNumberOfEncoderThreads(node.attribute("encoder-threads").as_int(0));
+    return 0;
+  });
+  this->Analyses.push_back(reducer.GetPointer());
+
+  SENSEI_STATUS("Configured VTKmVolumeReductionAnalysis " << mesh << "/" << field)
+
+  return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddVTKmCDF(pugi::xml_node node)
+{
+#ifndef ENABLE_VTKM
+  (void)node;
+  SENSEI_ERROR("VTK-m analysis was requested but is disabled in this build")
+  return -1;
+#else
+  if (
+    XMLUtils::RequireAttribute(node, "mesh") ||
+    XMLUtils::RequireAttribute(node, "field") ||
+    XMLUtils::RequireAttribute(node, "association")
+    )
+    {
+    SENSEI_ERROR("Failed to initialize VTKmCDFAnalysis");
+    return -1;
+    }
+
+  auto mesh = node.attribute("mesh").as_string();
+  auto field = node.attribute("field").as_string();
+  auto assoc = node.attribute("association").as_string();
+  auto quantiles = node.attribute("quantiles").as_int(10);
+  auto exchangeSize = node.attribute("exchange-size").as_int(quantiles);
+
+  // the sketch trades accuracy for constant memory and no sorting
+  std::string method = node.attribute("method").as_string("exact");
+  if ((method != "exact") && (method != "sketch"))
+    {
+    SENSEI_ERROR("Invalid method \"" << method << "\". Use exact or sketch")
+    return -1;
+    }
+  int sketchSize = node.attribute("sketch-size").as_int(256);
+
+  // a sample of the values makes the cost independent of the data size
+  double sampleFraction = node.attribute("sample-fraction").as_double(1.0);
+  double errorBound = node.attribute("error-bound").as_double(0.0);
+  if (!(sampleFraction > 0.0) || (sampleFraction > 1.0) || (errorBound < 0.0))
+    {
+    SENSEI_ERROR("Invalid sample-fraction " << sampleFraction
+      << " or error-bound " << errorBound)
+    return -1;
+    }
+
+  bool haveWorkDir = !!node.attribute("working-directory");
+  std::string workDir =  haveWorkDir ? node.attribute("working-directory").as_string() : ".";
+
+  auto analysis = vtkSmartPointer<VTKmCDFAnalysis>::New();
+  this->TimeInitialization(analysis, [&]() {
+    analysis->Initialize(mesh, field, assoc, workDir, quantiles, exchangeSize, this->Comm);
+    analysis->SetMethod(method == "sketch" ?
+      VTKmCDFAnalysis::METHOD_SKETCH : VTKmCDFAnalysis::METHOD_EXACT);
+    analysis->SetSketchSize(sketchSize);
+    analysis->SetSampleFraction(sampleFraction);
+    analysis->SetErrorBound(errorBound);
+    analysis->SetNumberOfEncoderThreads(node.attribute("encoder-threads").as_int(0));
+    analysis->SetVerbose(node.attribute("verbose").as_int(0));
+    return 0;
+  });
+  this->Analyses.push_back(analysis.GetPointer());
+
+  SENSEI_STATUS("Configured VTKmCDFAnalysis " << mesh << "/" << field
+    << " method " << method)
+
+  return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddVTKmHistogram(pugi::xml_node node)
+{
+#ifndef ENABLE_VTKM
+  (void)node;
+  SENSEI_ERROR("VTK-m analysis was requested but is disabled in this build")
+  return -1;
+#else
+  if (XMLUtils::RequireAttribute(node, "mesh") || XMLUtils::RequireAttribute(node, "field") ||
+    XMLUtils::RequireAttribute(node, "association"))
+    {
+    SENSEI_ERROR("Failed to initialize VTKmHistogramAnalysis");
+    return -1;
+    }
+
+  auto mesh = node.attribute("mesh").as_string();
+  auto field = node.attribute("field").as_string();
+  auto assoc = node.attribute("association").as_string();
+  int bins = node.attribute("bins").as_int(10);
+  std::string fileName = node.attribute("file").value();
+
+  auto histogram = vtkSmartPointer<VTKmHistogramAnalysis>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    histogram->SetCommunicator(this->Comm);
+
+  this->TimeInitialization(histogram, [&]() {
+    histogram->Initialize(mesh, field, assoc, bins, fileName);
+    return 0;
+  });
+  this->Analyses.push_back(histogram.GetPointer());
+
+  SENSEI_STATUS("Configured VTKmHistogramAnalysis " << mesh << "/" << field
+    << " with " << bins << " bins writing output to "
+    << (fileName.empty() ? "cout" : "file"))
+
+  return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddAscent(pugi::xml_node node)
+{
+#ifndef ENABLE_ASCENT
+  (void)node;
+  SENSEI_ERROR("Ascent was requested but is disabled in this build")
+  return( -1 );
+#else
+  auto ascent = vtkSmartPointer<AscentAnalysisAdaptor>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    ascent->SetCommunicator(this->Comm);
+
+  // get the data requirements for this run
+  DataRequirements req;
+  if (req.Initialize(node) || req.Empty())
+    {
+    SENSEI_ERROR("Failed to initialize the AscentAnalysisAdaptor."
+      << " Missing data requirements.")
+    return -1;
+    }
+  ascent->SetDataRequirements(req);
+
+  // get the json files used to configure ascent
+  std::string options_file;
+  std::string actions_file;
+
+  // Check if the xml file has the ascent options filename.
+  if(node.attribute("options"))
+    options_file = node.attribute("options").value();
+
+  // Check if the xml file has the ascent actions filename.
+  if (XMLUtils::RequireAttribute(node, "actions"))
+    {
+    SENSEI_ERROR("Failed to initialize the AscentAnalysisAdaptor");
+    return -1;
+    }
+
+  actions_file = node.attribute("actions").value();
+
+  if (this->TimeInitialization(ascent, [ascent, actions_file, options_file]() {
+      return ascent->Initialize(actions_file, options_file); }))
+    {
+    SENSEI_ERROR("Failed to initialize ascent using the actions \""
+      << actions_file << "\" and options \"" << options_file << "\"")
+    return -1;
+    }
+
+  this->Analyses.push_back(ascent);
+
+  SENSEI_STATUS("Configured the AscentAnalysisAdaptor with actions \""
+    << actions_file << "\" and options \"" << options_file << "\"")
+
+  return 0;
+#endif
+}
+
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddAdios1(pugi::xml_node node)
+{
+#ifndef ENABLE_ADIOS1
+  (void)node;
+  SENSEI_ERROR("ADIOS 1 was requested but is disabled in this build")
+  return -1;
+#else
+  auto adios = vtkSmartPointer<ADIOS1AnalysisAdaptor>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    adios->SetCommunicator(this->Comm);
+
+  pugi::xml_attribute filename = node.attribute("filename");
+  if (filename)
+    adios->SetFileName(filename.value());
+
+  pugi::xml_attribute method = node.attribute("method");
+  if (method)
+    adios->SetMethod(method.value());
+
+  unsigned long maxBufSize =
+    node.attribute("max_buffer_size").as_ullong(0);
+  adios->SetMaxBufferSize(maxBufSize);
+
+  DataRequirements req;
+  if (req.Initialize(node))
+    {
+    SENSEI_ERROR("Failed to initialize ADIOS 1.")
+    return -1;
+    }
+  adios->SetDataRequirements(req);
+
+  this->TimeInitialization(adios);
+  this->Analyses.push_back(adios.GetPointer());
+
+  SENSEI_STATUS("Configured ADIOSAnalysisAdaptor filename=\""
+    << filename.value() << "\" method " << method.value()
+    << " max_buffer_size=" << maxBufSize)
+
+  return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddAdios2(pugi::xml_node node)
+{
+#ifndef ENABLE_ADIOS2
+  (void)node;
+  SENSEI_ERROR("ADIOS 2 was requested but is disabled in this build")
+  return -1;
+#else
+  auto adiosAdaptor = vtkSmartPointer<ADIOS2AnalysisAdaptor>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    adiosAdaptor->SetCommunicator(this->Comm);
+
+  if (XMLUtils::RequireAttribute(node, "engine") ||
+    XMLUtils::RequireAttribute(node, "filename"))
+    {
+    SENSEI_ERROR("Failed to initialize ADIOS2AnalysisAdaptor");
+    return -1;
+    }
+
+  std::string filename = node.attribute("filename").value();
+  adiosAdaptor->SetFileName(filename);
+
+  std::string engine = node.attribute("engine").value();
+  adiosAdaptor->SetEngineName(engine);
+
+  // buffer size is given in the units of number of time steps,
+  // 0 means buffer all steps
+  std::string bufferSize = node.attribute("buffer_size").as_string("");
+  if (!bufferSize.empty())
+    adiosAdaptor->AddParameter("QueueLimit", bufferSize);
+
+  // valid modes are Block or Discard
+  std::string bufferMode = node.attribute("buffer_mode").as_string("");
+  if (!bufferMode.empty())
+    adiosAdaptor->AddParameter("QueueFullPolicy", bufferMode);
+
+  // turn on/off debug output
+  adiosAdaptor->SetDebugMode(node.attribute("debug_mode").as_int(0));
+
+  // coalesce the blocks of at most this many tuples into one put per array.
+  // worthwhile below about 32^3 cells per block
+  adiosAdaptor->SetAggregateBlocks(
+    node.attribute("aggregate_blocks").as_ullong(0));
+
+  // write subsampled copies of the arrays of uniform meshes for readers
+  // that refine progressively
+  adiosAdaptor->SetProgressiveLevels(
+    node.attribute("progressive_levels").as_uint(0));
+
+  // write the metadata as the difference to the last step's, in full
+  // every this many steps
+  adiosAdaptor->SetMetadataKeyFrames(
+    node.attribute("metadata_key_frames").as_uint(0));
+
+  // send only the data arrays that changed since the last step
+  adiosAdaptor->SetTrackChanges(node.attribute("track_changes").as_int(0));
+
+  // gather the blocks to a leader per node, only the leaders write
+  adiosAdaptor->SetNodeAggregation(
+    node.attribute("node_aggregation").as_int(0));
+
+  // write in a background thread. the value is the number of steps that
+  // may be queued, the policy, block or discard, applies when it is full
+  unsigned int writerQueue = node.attribute("writer_queue").as_uint(0);
+  if (writerQueue)
+    {
+    std::string policy = node.attribute("writer_policy").as_string("block");
+    if ((policy != "block") && (policy != "discard"))
+      {
+      SENSEI_ERROR("Invalid writer_policy \"" << policy
+        << "\". Valid values are block and discard")
+      return -1;
+      }
+    adiosAdaptor->SetAsynchronous(writerQueue, policy == "block" ?
+      ADIOS2AnalysisAdaptor::QUEUE_BLOCK : ADIOS2AnalysisAdaptor::QUEUE_DISCARD);
+    }
+
+  // what to do when the readers fall behind, the count is the queue
+  // depth for latest and block, and k for every_kth
+  std::string stepPolicy = node.attribute("step_policy").as_string("all");
+  unsigned int stepCount = node.attribute("step_count").as_uint(1);
+  if (stepPolicy == "all")
+    adiosAdaptor->SetStepPolicy(ADIOS2AnalysisAdaptor::STEP_POLICY_ALL, stepCount);
+  else if (stepPolicy == "latest")
+    adiosAdaptor->SetStepPolicy(ADIOS2AnalysisAdaptor::STEP_POLICY_LATEST, stepCount);
+  else if (stepPolicy == "every_kth")
+    adiosAdaptor->SetStepPolicy(ADIOS2AnalysisAdaptor::STEP_POLICY_EVERY_KTH, stepCount);
+  else if (stepPolicy == "block")
+    adiosAdaptor->SetStepPolicy(ADIOS2AnalysisAdaptor::STEP_POLICY_BLOCK, stepCount);
+  else
+    {
+    SENSEI_ERROR("Invalid step_policy \"" << stepPolicy << "\". Valid values"
+      " are all, latest, every_kth, and block")
+    return -1;
+    }
+
+  DataRequirements req;
+  if (req.Initialize(node))
+    {
+    SENSEI_ERROR("Failed to initialize ADIOS 2.")
+    return -1;
+    }
+  adiosAdaptor->SetDataRequirements(req);
+
+  // reduce the arrays before they are sent. each compression element
+  // names the arrays, the operator, and passes its other attributes to
+  // the operator as parameters
+  for (pugi::xml_node opNode = node.child("compression"); opNode;
+    opNode = opNode.next_sibling("compression"))
+    {
+    if (XMLUtils::RequireAttribute(opNode, "operator"))
+      {
+      SENSEI_ERROR("Failed to initialize ADIOS 2.")
+      return -1;
+      }
+
+    std::vector<std::pair<std::string,std::string>> params;
+    for (pugi::xml_attribute att = opNode.first_attribute(); att;
+      att = att.next_attribute())
+      {
+      std::string key = att.name();
+      if ((key != "array") && (key != "operator"))
+        params.emplace_back(key, att.value());
+      }
+
+    adiosAdaptor->AddArrayOperation(opNode.attribute("array").as_string("*"),
+      opNode.attribute("operator").value(), params);
+    }
+
+  this->TimeInitialization(adiosAdaptor);
+  this->Analyses.push_back(adiosAdaptor.GetPointer());
+
+  SENSEI_STATUS("Configured ADIOSAnalysisAdaptor filename=\""
+    << filename << "\" engine=" << engine
+    << (!bufferMode.empty() ? "buffer_mode=" : "")
+    << (!bufferMode.empty() ? bufferMode.c_str() : "")
+    << (!bufferSize.empty() ? "buffer_size=" : "")
+    << (!bufferSize.empty() ? bufferSize.c_str() : ""))
+
+  return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddHDF5(pugi::xml_node node)
+{
+#ifndef ENABLE_HDF5
+  (void)node;
+  SENSEI_ERROR("HDF5 was requested but is disabled in this build");
+  return -1;
+#else
+  auto dataE = vtkSmartPointer<HDF5AnalysisAdaptor>::New();
+
+  if(this->Comm != MPI_COMM_NULL)
+    dataE->SetCommunicator(this->Comm);
+
+  pugi::xml_attribute filename = node.attribute("filename");
+  pugi::xml_attribute methodAttr = node.attribute("method");
+
+  if(filename)
+    dataE->SetStreamName(filename.value());
+
+  if(methodAttr)
+    {
+      std::string method = methodAttr.value();
+
+      if(method.size() > 0)
+        {
+          bool doStreaming = ('s' == method[0]);
+          bool doCollectiveTxf = ((method.size() > 1) && ('c' == method[1]));
+
+          dataE->SetStreaming(doStreaming);
+          dataE->SetCollective(doCollectiveTxf);
+        }
+    }
+
+  // dataset layout. chunk_size is a number of elements or "block"
+  pugi::xml_attribute chunkSize = node.attribute("chunk_size");
+  std::string filter = node.attribute("compression").as_string("none");
+  int filterLevel = node.attribute("compression_level").as_int(1);
+
+  if ((filter != "none") && (filter != "deflate") && (filter != "zstd")
+    && (filter != "blosc") && (filter != "scaleoffset"))
+    {
+    SENSEI_ERROR("Invalid compression \"" << filter << "\". Valid values"
+      " are none, deflate, zstd, blosc, and scaleoffset")
+    return -1;
+    }
+
+  if (std::string(chunkSize.as_string()) == "block")
+    dataE->SetChunkSize(-1);
+  else if (chunkSize.as_llong(0) > 0)
+    dataE->SetChunkSize(chunkSize.as_llong(0));
+
+  dataE->SetFilter(filter, filterLevel);
+  dataE->SetShuffle(node.attribute("shuffle").as_int(0));
+
+  // link the data arrays that did not change to their last copy
+  dataE->SetTrackChanges(node.attribute("track_changes").as_int(0));
+
+  // write the metadata as the difference to the last step's, in full
+  // every this many steps
+  dataE->SetMetadataKeyFrames(
+    node.attribute("metadata_key_frames").as_uint(0));
+
+  // gather the blocks to a leader per node, only the leaders write
+  dataE->SetNodeAggregation(node.attribute("node_aggregation").as_int(0));
+
+  // MPI-IO hints
+  dataE->SetMPIHints(node.attribute("cb_nodes").as_int(0),
+    node.attribute("cb_buffer_size").as_llong(0),
+    node.attribute("alignment").as_llong(0));
+
+  // N:M output through the subfiling VFD
+  dataE->SetSubfiling(node.attribute("subfiling").as_int(0),
+    node.attribute("stripe_size").as_llong(0),
+    node.attribute("stripe_count").as_int(0));
+
+  // write from a background thread
+  unsigned int writerQueue = node.attribute("writer_queue").as_uint(0);
+  if (writerQueue)
+    {
+    std::string policy = node.attribute("writer_policy").as_string("block");
+    if ((policy != "block") && (policy != "discard"))
+      {
+      SENSEI_ERROR("Invalid writer_policy \"" << policy
+        << "\". Valid values are block and discard")
+      return -1;
+      }
+    dataE->SetAsynchronous(writerQueue, policy == "block" ?
+      HDF5AnalysisAdaptor::QUEUE_BLOCK : HDF5AnalysisAdaptor::QUEUE_DISCARD);
+    }
+
+  DataRequirements req;
+  if (req.Initialize(node))
+    {
+    SENSEI_ERROR("Failed to initialize HDF5 Transport.")
+    return -1;
+    }
+  dataE->SetDataRequirements(req);
+
+
+  this->TimeInitialization(dataE);
+  this->Analyses.push_back(dataE.GetPointer());
+
+  SENSEI_STATUS("Configured HDF5 AnalysisAdaptor \"" << filename.value())
+
+  return 0;
+#endif
+}
+
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddMPI(pugi::xml_node node)
+{
+  auto adaptor = vtkSmartPointer<MPIAnalysisAdaptor>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    adaptor->SetCommunicator(this->Comm);
+
+  std::string mode = node.attribute("connect").as_string("port");
+  if (mode == "port")
+    {
+    adaptor->SetConnectMode(senseiMPI::CONNECT_PORT);
+    }
+  else if (mode == "mpmd")
+    {
+    adaptor->SetConnectMode(senseiMPI::CONNECT_MPMD);
+    }
+  else
+    {
+    SENSEI_ERROR("Invalid connect mode \"" << mode
+      << "\". Valid values are port and mpmd")
+    return -1;
+    }
+
+  if (node.attribute("filename"))
+    adaptor->SetFileName(node.attribute("filename").value());
+
+  adaptor->SetTimeout(node.attribute("timeout").as_double(60.0));
+  adaptor->SetPeerApplication(node.attribute("peer_application").as_int(-1));
+  adaptor->SetSharedMemory(node.attribute("shared_memory").as_int(0));
+
+  this->TimeInitialization(adaptor);
+  this->Analyses.push_back(adaptor.GetPointer());
+
+  SENSEI_STATUS("Configured MPIAnalysisAdaptor connect=" << mode
+    << (mode == "port" ? " filename=" : "")
+    << (mode == "port" ? adaptor->GetFileName() : std::string()))
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddCatalyst(pugi::xml_node node)
+{
+#ifndef ENABLE_CATALYST
+  (void)node;
+  SENSEI_ERROR("Catalyst was requested but is disabled in this build")
+  return -1;
+#else
+  // a single adaptor used with multiple pipelines
+  if (!this->CatalystAdaptor)
+    {
+    this->CatalystAdaptor = vtkSmartPointer<CatalystAnalysisAdaptor>::New();
+
+    if (this->Comm != MPI_COMM_NULL)
+      this->CatalystAdaptor->SetCommunicator(this->Comm);
+
+    vtkSmartPointer<CatalystAnalysisAdaptor> catalyst = this->CatalystAdaptor;
+    this->TimeInitialization(catalyst, [catalyst]() {
+      catalyst->Initialize();
+      return 0; });
+
+    this->Analyses.push_back(this->CatalystAdaptor);
+    }
+
+  // Add the pipelines
+  if (strcmp(node.attribute("pipeline").value(), "slice") == 0)
+    {
+    vtkNew<CatalystSlice> slice;
+
+    double tmp[3];
+    if (node.attribute("mesh"))
+      {
+      slice->SetInputMesh(node.attribute("mesh").value());
+      }
+    if (node.attribute("slice-normal") &&
+      (std::sscanf(node.attribute("slice-normal").value(),
+      "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3))
+      {
+      slice->SetSliceNormal(tmp[0], tmp[1], tmp[2]);
+      }
+
+    if (node.attribute("slice-origin") &&
+      (std::sscanf(node.attribute("slice-origin").value(),
+      "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3))
+      {
+      slice->SetSliceOrigin(tmp[0], tmp[1], tmp[2]);
+      slice->SetAutoCenter(false);
+      }
+    else
+      {
+      slice->SetAutoCenter(true);
+      }
+
+    int association = 0;
+    std::string assocStr = node.attribute("association").as_string("point");
+    if (VTKUtils::GetAssociation(assocStr, association))
+      {
+      SENSEI_ERROR("Failed to initialize Catalyst")
+      return -1;
+      }
+
+    slice->ColorBy(association, node.attribute("array").value());
+    if (node.attribute("color-range") &&
+      (std::sscanf(node.attribute("color-range").value(), "%lg,%lg", &tmp[0], &tmp[1]) == 2))
+      {
+      slice->SetAutoColorRange(false);
+      slice->SetColorRange(tmp[0], tmp[1]);
+      }
+    else
+      {
+      slice->SetAutoColorRange(true);
+      }
+
+    slice->SetUseLogScale(node.attribute("color-log").as_int(0) == 1);
+    if (node.attribute("image-filename"))
+      {
+      slice->SetImageParameters(
+        node.attribute("image-filename").value(),
+        node.attribute("image-width").as_int(800),
+        node.attribute("image-height").as_int(800));
+      }
+
+    slice->SetRenderThreshold(node.attribute("render-threshold").as_double(-1.0));
+    slice->SetFixedCamera(node.attribute("fixed-camera").as_int(0) == 1);
+
+    vtkSmartPointer<vtkCPPipeline> pipeline = slice.GetPointer();
+    vtkSmartPointer<CatalystAnalysisAdaptor> catalyst = this->CatalystAdaptor;
+    this->DeferInitialization(catalyst, [catalyst, pipeline]() {
+      catalyst->AddPipeline(pipeline);
+      return 0; });
+    }
+  else if (strcmp(node.attribute("pipeline").value(), "particle") == 0)
+    {
+    vtkNew<CatalystParticle> particle;
+
+    double tmp[3];
+    if (node.attribute("mesh"))
+      {
+      particle->SetInputMesh(node.attribute("mesh").value());
+      }
+    if (node.attribute("particle-style"))
+      {
+      particle->SetParticleStyle(node.attribute("particle-style").value());
+      }
+    if (node.attribute("particle-radius") &&
+      (std::sscanf(node.attribute("particle-radius").value(),
+      "%lg", &tmp[0]) == 1))
+      {
+      particle->SetParticleRadius(tmp[0]);
+      }
+    if (node.attribute("camera-position") &&
+      (std::sscanf(node.attribute("camera-position").value(),
+      "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3))
+      {
+      particle->SetCameraPosition(tmp);
+      }
+
+    if (node.attribute("camera-focus") &&
+      (std::sscanf(node.attribute("camera-focus").value(),
+      "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3))
+      {
+      particle->SetCameraFocus(tmp);
+      }
+
+    int association = 0;
+    std::string assocStr = node.attribute("association").as_string("point");
+    if (VTKUtils::GetAssociation(assocStr, association))
+      {
+      SENSEI_ERROR("Failed to initialize Catalyst")
+      return -1;
+      }
+
+    particle->ColorBy(association, node.attribute("array").value());
+    if (node.attribute("color-range") &&
+      (std::sscanf(node.attribute("color-range").value(), "%lg,%lg", &tmp[0], &tmp[1]) == 2))
+      {
+      particle->SetAutoColorRange(false);
+      particle->SetColorRange(tmp[0], tmp[1]);
+      }
+    else
+      {
+      particle->SetAutoColorRange(true);
+      }
+
+    particle->SetUseLogScale(node.attribute("color-log").as_int(0) == 1);
+    if (node.attribute("image-filename"))
+      {
+      particle->SetImageParameters(
+        node.attribute("image-filename").value(),
+        node.attribute("image-width").as_int(800),
+        node.attribute("image-height").as_int(800));
+      }
+
+    particle->SetRenderThreshold(node.attribute("render-threshold").as_double(-1.0));
+    particle->SetFixedCamera(node.attribute("fixed-camera").as_int(0) == 1);
+
+    vtkSmartPointer<vtkCPPipeline> pipeline = particle.GetPointer();
+    vtkSmartPointer<CatalystAnalysisAdaptor> catalyst = this->CatalystAdaptor;
+    this->DeferInitialization(catalyst, [catalyst, pipeline]() {
+      catalyst->AddPipeline(pipeline);
+      return 0; });
+    }
+  else if (strcmp(node.attribute("pipeline").value(), "pythonscript") == 0)
+    {
+#ifndef ENABLE_CATALYST_PYTHON
+    SENSEI_ERROR("Catalyst Python was requested but is disabled in this build")
+#else
+    if (node.attribute("filename"))
+      {
+      std::string fileName = node.attribute("filename").value();
+      vtkSmartPointer<CatalystAnalysisAdaptor> catalyst = this->CatalystAdaptor;
+      this->DeferInitialization(catalyst, [catalyst, fileName]() {
+        catalyst->AddPythonScriptPipeline(fileName);
+        return 0; });
+      }
+#endif
+    }
+  SENSEI_STATUS("Configured CatalystAnalysisAdaptor "
+    << node.attribute("pipeline").value() << " "
+    << (node.attribute("filename") ? node.attribute("filename").value() : ""))
+#endif
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddCatalyst2(pugi::xml_node node)
+{
+#ifndef ENABLE_CATALYST2
+  (void)node;
+  SENSEI_ERROR("Catalyst 2 was requested but is disabled in this build")
+  return -1;
+#else
+  // Catalyst is initialized once per process with all of the scripts, a
+  // single adaptor is used. it initializes Catalyst when first executed
+  if (!this->Catalyst2Adaptor)
+    {
+    this->Catalyst2Adaptor = vtkSmartPointer<Catalyst2AnalysisAdaptor>::New();
+
+    if (this->Comm != MPI_COMM_NULL)
+      this->Catalyst2Adaptor->SetCommunicator(this->Comm);
+
+    this->TimeInitialization(this->Catalyst2Adaptor);
+    this->Analyses.push_back(this->Catalyst2Adaptor);
+    }
+
+  if (node.attribute("implementation"))
+    this->Catalyst2Adaptor->SetImplementation(
+      node.attribute("implementation").value());
+
+  if (node.attribute("search_path"))
+    this->Catalyst2Adaptor->SetSearchPath(node.attribute("search_path").value());
+
+  // the meshes and arrays needed by any of the scripts are passed, when
+  // none are given everything is
+  DataRequirements req;
+  if (req.Initialize(node))
+    {
+    SENSEI_ERROR("Failed to initialize the Catalyst2AnalysisAdaptor")
+    return -1;
+    }
+
+  if (!req.Empty())
+    {
+    this->Catalyst2Requirements.AddRequirements(req);
+    this->Catalyst2Adaptor->SetDataRequirements(this->Catalyst2Requirements);
+    }
+
+  if (XMLUtils::RequireAttribute(node, "filename"))
+    {
+    SENSEI_ERROR("Failed to initialize the Catalyst2AnalysisAdaptor")
+    return -1;
+    }
+
+  std::string fileName = node.attribute("filename").value();
+  this->Catalyst2Adaptor->AddPythonScript(fileName);
+
+  SENSEI_STATUS("Configured Catalyst2AnalysisAdaptor " << fileName
+    << " implementation " << node.attribute("implementation").as_string("paraview"))
+
+  return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddLibsim(pugi::xml_node node)
+{
+#ifndef ENABLE_LIBSIM
+  (void)node;
+  SENSEI_ERROR("Libsim was requested but is disabled in this build")
+  return -1;
+#else
+
+  // We keep around a single instance of the libsim adaptor and then tell it to
+  // do different things.
+  if (!this->LibsimAdaptor)
+    {
+    this->LibsimAdaptor = vtkSmartPointer<LibsimAnalysisAdaptor>::New();
+
+    if (this->Comm != MPI_COMM_NULL)
+      this->LibsimAdaptor->SetCommunicator(this->Comm);
+
+    if(node.attribute("trace"))
+      this->LibsimAdaptor->SetTraceFile(node.attribute("trace").value());
+
+    if(node.attribute("options"))
+      this->LibsimAdaptor->SetOptions(node.attribute("options").value());
+
+    if(node.attribute("visitdir"))
+      this->LibsimAdaptor->SetVisItDirectory(node.attribute("visitdir").value());
+
+    if(node.attribute("mode"))
+      this->LibsimAdaptor->SetMode(node.attribute("mode").value());
+
+    this->LibsimAdaptor->SetComputeNesting(
+      node.attribute("compute_nesting").as_int(0));
+
+    vtkSmartPointer<LibsimAnalysisAdaptor> libsim = this->LibsimAdaptor;
+    this->TimeInitialization(libsim, [libsim]()
+      {
+      libsim->Initialize();
+      return 0;
+      });
+
+    this->Analyses.push_back(this->LibsimAdaptor);
+    }
+
+  bool doExport = false;
+  if(node.attribute("operation") != NULL)
+    doExport = (node.attribute("operation").value() == std::string("export"));
+
+  int frequency = 5;
+  if(node.attribute("frequency") != NULL)
+    frequency = node.attribute("frequency").as_int();
+
+  if(frequency < 1)
+    frequency = 1;
+
+  std::string filename;
+  LibsimImageProperties imageProps;
+  if(node.attribute("filename") != NULL)
+    {
+    imageProps.SetFilename(node.attribute("filename").value());
+    filename = node.attribute("filename").value();
+    }
+  if(node.attribute("image-filename") != NULL)
+    {
+    imageProps.SetFilename(node.attribute("image-filename").value());
+    filename = node.attribute("image-filename").value();
+    }
+
+  if(node.attribute("image-width") != NULL)
+    imageProps.SetWidth(node.attribute("image-width").as_int());
+
+  if(node.attribute("image-height") != NULL)
+    imageProps.SetHeight(node.attribute("image-height").as_int());
+
+  std::string plots, plotVars;
+  double origin[3] = {0.,0.,0.};
+  double normal[3] = {1.,0.,0.};
+  bool slice = false, project = false;
+
+  std::string session;
+  if(node.attribute("session") != NULL)
+    session = node.attribute("session").value();
+
+  if(node.attribute("plots") != NULL)
+    plots = node.attribute("plots").value();
+
+  if(node.attribute("plotvars") != NULL)
+    plotVars = node.attribute("plotvars").value();
+
+  if(node.attribute("slice-origin") != NULL)
+    {
+    double tmp[3];
+    if(sscanf(node.attribute("slice-origin").value(),
+       "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3)
+      {
+      slice = true;
+      origin[0] = tmp[0];
+      origin[1] = tmp[1];
+      origin[2] = tmp[2];
+      }
+    }
+  if(node.attribute("slice-normal") != NULL)
+    {
+    double tmp[3];
+    if(sscanf(node.attribute("slice-normal").value(),
+      "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3)
+    {
+      slice = true;
+      normal[0] = tmp[0];
+      normal[1] = tmp[1];
+      normal[2] = tmp[2];
+      }
+    }
+
+  if(node.attribute("slice-project") != NULL)
+    project = node.attribute("slice-project").as_int() != 0;
+
+  if(doExport)
+  {
+    // Add the export that we want to make.
+    if(!this->LibsimAdaptor->AddExport(frequency, session, plots, plotVars,
+      slice, project, origin, normal, filename))
+      return -2;
+
+    SENSEI_STATUS("configured LibsimAnalysisAdaptor export")
+  }
+  else
+  {
+    // Add the image that we want to make.
+    if(!this->LibsimAdaptor->AddRender(frequency, session, plots, plotVars,
+      slice, project, origin, normal, imageProps))
+      return -2;
+
+    SENSEI_STATUS("configured LibsimAnalysisAdaptor render")
+  }
+
+#endif
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddAutoCorrelation(pugi::xml_node node)
+{
+  if (XMLUtils::RequireAttribute(node, "mesh") || XMLUtils::RequireAttribute(node, "array"))
+    {
+    SENSEI_ERROR("Failed to initialize Autocorrelation");
+    return -1;
+    }
+
+  std::string meshName = node.attribute("mesh").value();
+  std::string arrayName = node.attribute("array").value();
+
+  std::string assocStr = node.attribute("association").as_string("point");
+  int assoc = 0;
+  if (VTKUtils::GetAssociation(assocStr, assoc))
+    {
+    SENSEI_ERROR("Failed to initialize Autocorrelation");
+    return -1;
+    }
+
+  int window = node.attribute("window").as_int(10);
+  int kMax = node.attribute("k-max").as_int(3);
+  int numThreads = node.attribute("n-threads").as_int(1);
+
+  // the multiple tau mode bounds memory use for large windows
+  std::string mode = node.attribute("mode").as_string("exact");
+  int channels = 0;
+  if (mode == "multiple-tau")
+    {
+    channels = node.attribute("channels").as_int(8);
+    }
+  else if (mode != "exact")
+    {
+    SENSEI_ERROR("Invalid mode \"" << mode << "\". Use exact or multiple-tau")
+    return -1;
+    }
+
+  // the history of the exact mode may be stored at reduced precision
+  std::string storageStr = node.attribute("storage").as_string("float");
+  int storage = 0;
+  if (TemporalWindow::GetStorage(storageStr, storage))
+    {
+    SENSEI_ERROR("Failed to initialize Autocorrelation");
+    return -1;
+    }
+
+  auto adaptor = vtkSmartPointer<Autocorrelation>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    adaptor->SetCommunicator(this->Comm);
+
+  this->TimeInitialization(adaptor, [&]() {
+    adaptor->Initialize(window, meshName, assoc, arrayName, kMax, numThreads);
+    adaptor->SetMultipleTau(channels);
+    adaptor->SetStorage(storage);
+    return 0;
+  });
+
+  this->Analyses.push_back(adaptor.GetPointer());
+
+  SENSEI_STATUS("Configured Autocorrelation " << assocStr
+    << " data array \"" << arrayName << "\" on mesh \"" << meshName
+    << "\" window " << window << " k-max " << kMax
+    << " n-threads " << numThreads << " mode " << mode << " storage " << storageStr
+    << (channels ? " channels " : "") << (channels ? std::to_string(channels) : ""))
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddPosthocIO(pugi::xml_node node)
+{
+#ifndef ENABLE_VTK_IO
+  (void)node;
+  SENSEI_ERROR("VTK I/O was requested but is disabled in this build")
+  return -1;
+#else
+  DataRequirements req;
+  if (req.Initialize(node))
+    {
+    SENSEI_ERROR("Failed to initialize VTKPosthocIO.")
+    return -1;
+    }
+
+  std::string outputDir = node.attribute("output_dir").as_string("./");
+  std::string fileName = node.attribute("file_name").as_string("data");
+  std::string mode = node.attribute("mode").as_string("visit");
+  std::string writer = node.attribute("writer").as_string("xml");
+  std::string ghostArrayName = node.attribute("ghost_array_name").as_string("");
+  std::string compressor = node.attribute("compressor").as_string("none");
+  int aggregation = node.attribute("ranks_per_file").as_int(0);
+  int batchSize = node.attribute("batch_size").as_int(0);
+  int verbose = node.attribute("verbose").as_int(0);
+  std::string stagingDir = node.attribute("staging_dir").as_string("");
+  double stagingBandwidth = node.attribute("staging_bandwidth").as_double(0.0);
+  double stagingCapacity = node.attribute("staging_capacity").as_double(0.0);
+  bool stagingHandOff = node.attribute("staging_hand_off").as_int(0);
+
+  auto adaptor = vtkSmartPointer<VTKPosthocIO>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    adaptor->SetCommunicator(this->Comm);
+
+  adaptor->SetGhostArrayName(ghostArrayName);
+  adaptor->SetBatchSize(batchSize);
+  adaptor->SetVerbose(verbose);
+
+  if (adaptor->SetOutputDir(outputDir) || adaptor->SetMode(mode) ||
+    adaptor->SetWriter(writer) || adaptor->SetCompressor(compressor) ||
+    adaptor->SetAggregation(aggregation) || adaptor->SetDataRequirements(req) ||
+    (!stagingDir.empty() && adaptor->SetStaging(stagingDir, stagingBandwidth,
+      stagingCapacity, stagingHandOff)))
+    {
+    SENSEI_ERROR("Failed to initialize the VTKPosthocIO analysis")
+    return -1;
+    }
+
+  this->TimeInitialization(adaptor);
+  this->Analyses.push_back(adaptor.GetPointer());
+
+  SENSEI_STATUS("Configured VTKPosthocIO")
+
+  return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddVTKAmrWriter(pugi::xml_node node)
+{
+#if !defined(ENABLE_VTK_IO) || !defined(ENABLE_VTK_MPI)
+  (void)node;
+  SENSEI_ERROR("VTK AMR Writer was requested but is disabled in this build")
+  return -1;
+#else
+  DataRequirements req;
+
+  if (req.Initialize(node))
+    {
+    SENSEI_ERROR("Failed to initialize VTKAmrWriter.")
+    return -1;
+    }
+
+  std::string outputDir = node.attribute("output_dir").as_string("./");
+  std::string fileName = node.attribute("file_name").as_string("data");
+  std::string mode = node.attribute("mode").as_string("visit");
+  int threads = node.attribute("threads").as_int(1);
+  std::string stagingDir = node.attribute("staging_dir").as_string("");
+  double stagingBandwidth = node.attribute("staging_bandwidth").as_double(0.0);
+  double stagingCapacity = node.attribute("staging_capacity").as_double(0.0);
+  bool stagingHandOff = node.attribute("staging_hand_off").as_int(0);
+
+  auto adapter = vtkSmartPointer<VTKAmrWriter>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    adapter->SetCommunicator(this->Comm);
+
+  adapter->SetNumberOfThreads(threads);
+
+  if (adapter->SetOutputDir(outputDir) || adapter->SetMode(mode) ||
+    adapter->SetDataRequirements(req) ||
+    (!stagingDir.empty() && adapter->SetStaging(stagingDir, stagingBandwidth,
+      stagingCapacity, stagingHandOff)) ||
+    this->TimeInitialization(adapter, [&]() { return adapter->Initialize(); }))
+    {
+    SENSEI_ERROR("Failed to initialize the VTKAmrWriter analysis")
+    return -1;
+    }
+
+  this->TimeInitialization(adapter);
+  this->Analyses.push_back(adapter.GetPointer());
+
+  SENSEI_STATUS("Configured VTKAmrWriter")
+
+  return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddPythonAnalysis(pugi::xml_node node)
+{
+#if !defined(ENABLE_PYTHON)
+  (void)node;
+  SENSEI_ERROR("The PythonAnalysis was requested but is disabled in this build")
+  return -1;
+#else
+  if (!node.attribute("script_file") && !node.attribute("script_module"))
+    {
+    SENSEI_ERROR("Failed to initialize PythonAnalysis. Missing "
+      "a required attribute: script_file or script_module");
+    return -1;
+    }
+
+  std::string scriptFile = node.attribute("script_file").value();
+  std::string scriptModule = node.attribute("script_module").value();
+
+  std::string initSource;
+  pugi::xml_node inode = node.child("initialize_source");
+  if (inode)
+    initSource = inode.text().as_string();
+
+  auto pyAnalysis = vtkSmartPointer<PythonAnalysis>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    pyAnalysis->SetCommunicator(this->Comm);
+
+  pyAnalysis->SetScriptFile(scriptFile);
+  pyAnalysis->SetScriptModule(scriptModule);
+  pyAnalysis->SetInitializeSource(initSource);
+
+  if (node.attribute("import_cache"))
+    pyAnalysis->SetImportCache(node.attribute("import_cache").value());
+
+  if (this->TimeInitialization(pyAnalysis, [pyAnalysis]() {
+      return pyAnalysis->Initialize(); }))
+    {
+    SENSEI_ERROR("Failed to initialize PythonAnalysis")
+    return -1;
+    }
+  this->Analyses.push_back(pyAnalysis);
+
+  const char *scriptType = scriptFile.empty() ? "module" : "file";
+
+  const char *scriptName =
+    scriptFile.empty() ?  scriptModule.c_str() : scriptFile.c_str();
+
+  SENSEI_STATUS("Configured python with " << scriptType
+    << " \"" << scriptName << "\"")
+
+  return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddSliceExtract(pugi::xml_node node)
+{
+#ifndef ENABLE_SLICE_EXTRACT
+  (void)node;
+  SENSEI_ERROR("SliceExtract requested but is disabled in this build")
+  return -1;
+#else
+
+  std::ostringstream oss;
+  oss << "Configured SliceExtract ";
+
+  // initialize the slice extract
+  auto adaptor = vtkSmartPointer<SliceExtract>::New();
+
+  if (this->Comm != MPI_COMM_NULL)
+    adaptor->SetCommunicator(this->Comm);
+
+  // parse data requirements
+  DataRequirements req;
+  if (req.Initialize(node) || adaptor->SetDataRequirements(req))
+    return -1;
+
+  // parse writer parameters
+  pugi::xml_node writerNode = node.child("writer");
+  if (writerNode)
+    {
+    std::string outputDir = writerNode.attribute("output_dir").as_string("./");
+    std::string mode = writerNode.attribute("mode").as_string("visit");
+    std::string writer = writerNode.attribute("writer").as_string("xml");
+    std::string raster = writerNode.attribute("raster").as_string("");
+
+    if (adaptor->SetWriterOutputDir(outputDir) || adaptor->SetWriterMode(mode) ||
+      adaptor->SetWriterWriter(writer) || adaptor->SetRasterFormat(raster))
+      return -1;
+
+    oss << " writer.mode=" << mode << " writer.outputDir=" << outputDir
+      << " writer.writer=" << writer;
+
+    if (!raster.empty())
+      oss << " writer.raster=" << raster;
+    }
+
+  // operation specific parsing
+  if (XMLUtils::RequireAttribute(node, "operation"))
+    return -1;
+
+  std::string operation = node.attribute("operation").as_string();
+
+  if (adaptor->SetOperation(operation))
+    return -1;
+
+  oss << " operation=" << operation;
+
+  bool slice = (operation == "planar_slice") ||
+    (operation == "slice_and_iso_surface");
+
+  bool iso = (operation == "iso_surface") ||
+    (operation == "slice_and_iso_surface");
+
+  if (!slice && !iso)
+    {
+    SENSEI_ERROR("Invalid operation \"" << operation << "\"")
+    return -1;
+    }
+
+  if (slice)
+    {
+    // parse points and normals. each point pairs with the normal in the
+    // same position
+    std::vector<std::array<double,3>> points;
+    for (pugi::xml_node pointNode = node.child("point"); pointNode;
+      pointNode = pointNode.next_sibling("point"))
+      {
+      std::array<double,3> point{0.0,0.0,0.0};
+      if (XMLUtils::ParseNumeric(pointNode, point))
+        return -1;
+
+      points.push_back(point);
+      oss << " point=" << point;
+      }
+
+    std::vector<std::array<double,3>> normals;
+    for (pugi::xml_node normalNode = node.child("normal"); normalNode;
+      normalNode = normalNode.next_sibling("normal"))
+      {
+      std::array<double,3> normal{0.0,0.0,0.0};
+      if (XMLUtils::ParseNumeric(normalNode, normal))
+        return -1;
+
+      normals.push_back(normal);
+      oss << " normal=" << normal;
+      }
+
+    if ((points.size() > 1) || (normals.size() > 1))
+      {
+      if (adaptor->SetPlanes(points, normals))
+        return -1;
+      }
+    else
+      {
+      if ((points.size() && adaptor->SetPoint(points[0])) ||
+        (normals.size() && adaptor->SetNormal(normals[0])))
+        return -1;
+      }
+    }
+
+  if (iso)
+    {
+    // parse iso values parameters
+    if (XMLUtils::RequireChild(node, "iso_values"))
+      return -1;
+
+    pugi::xml_node valsNode = node.child("iso_values");
+
+    std::vector<double> isoVals;
+    if (XMLUtils::ParseNumeric(valsNode, isoVals))
+      return -1;
+
+    if (XMLUtils::RequireAttribute(valsNode, "mesh_name") ||
+      XMLUtils::RequireAttribute(valsNode, "array_name") ||
+      XMLUtils::RequireAttribute(valsNode, "array_centering"))
+      return -1;
+
+    std::string meshName = valsNode.attribute("mesh_name").as_string();
+    std::string arrayName = valsNode.attribute("array_name").as_string();
+    std::string arrayCenStr = valsNode.attribute("array_centering").as_string();
+
+    int arrayCen = 0;
+    if (VTKUtils::GetAssociation(arrayCenStr.c_str(), arrayCen))
+      return -1;
+
+    adaptor->SetIsoValues(meshName, arrayName, arrayCen, isoVals);
+
+    oss << " mesh_name=" << meshName << " array_name=" << arrayName
+      << " array_centering=" << arrayCenStr << " iso_values=" << isoVals;
+    }
+
+  // get other settings
+  int enablePart = node.attribute("enable_partitioner").as_int(1);
+  adaptor->EnablePartitioner(enablePart);
+  oss << " enable_partitioner=" <<  enablePart;
+
+  int nThreads = node.attribute("n_threads").as_int(1);
+  adaptor->SetNumberOfThreads(nThreads);
+  oss << " n_threads=" << nThreads;
+
+  int batchSize = node.attribute("batch_size").as_int(0);
+  adaptor->SetBatchSize(batchSize);
+  oss << " batch_size=" << batchSize;
+
+  int verbose = node.attribute("verbose").as_int(0);
+  adaptor->SetVerbose(verbose);
+  oss << " verbose=" << verbose;
+
+  // the extracts may be published for the analyses that follow, in which
+  // case they are written only when a writer is configured
+  int publish = node.attribute("publish").as_int(0);
+  int write = node.attribute("write").as_int(!publish || writerNode);
+  adaptor->SetPublish(publish);
+  adaptor->SetWrite(write);
+  oss << " publish=" << publish << " write=" << write;
+
+  // merge points, decimate and quantize the extracts before they are
+  // written or published
+  if (pugi::xml_node reduceNode = node.child("reduce"))
+    {
+    PolyDataReducer reducer;
+    if (reducer.Initialize(reduceNode))
+      return -1;
+
+    adaptor->SetReducer(reducer);
+    oss << " reduce=(" << reducer.GetDescription() << ")";
+    }
+
+  if (publish)
+    {
+    std::vector<std::string> names;
+    adaptor->GetExtractMeshNames(names);
+    this->Published.insert(names.begin(), names.end());
+    this->HavePartialResults = true;
+    oss << " published=" << names;
+    }
+
+  // call intialize and add to the pipeline
+  this->TimeInitialization(adaptor);
+  this->Analyses.push_back(adaptor.GetPointer());
+
+  SENSEI_STATUS(<< oss.str())
+
+  return 0;
+#endif
+}
+
+
+
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::ConfigureExecution(pugi::xml_node node)
+{
+  bool async = node.attribute("async").as_int(0);
+
+  // some adaptors, Catalyst and Libsim, are shared by a number of XML
+  // elements. in that case no new analysis was added.
+  unsigned int nAnalyses = this->Analyses.size();
+  if (this->Controls.size() == nAnalyses)
+    {
+    if (async)
+      SENSEI_WARNING("Asynchronous execution is not supported for \""
+        << node.attribute("type").value() << "\" analyses")
+    if (node.attribute("trigger"))
+      SENSEI_WARNING("Triggers are not supported for \""
+        << node.attribute("type").value() << "\" analyses")
+    if (node.attribute("placement"))
+      SENSEI_WARNING("Placement is not supported for \""
+        << node.attribute("type").value() << "\" analyses")
+    return 0;
+    }
+
+  this->Controls.resize(nAnalyses);
+
+  AnalysisAdaptorPtr &analysis = this->Analyses.back();
+  ExecutionControl &control = this->Controls.back();
+
+  std::ostringstream name;
+  name << node.attribute("type").value() << "::" << nAnalyses - 1;
+  control.Cost.Name = node.attribute("name").as_string(name.str().c_str());
+
+  control.Priority = node.attribute("priority").as_int(0);
+  control.MinCadence = node.attribute("min_cadence").as_int(0);
+  control.DataRanks = node.attribute("data_ranks").as_int(0);
+  control.Publishes = node.attribute("publish").as_int(0);
+
+  // the published meshes are served by the adaptor of the step, to the
+  // analyses that run after
+  if (control.Publishes && (async || control.DataRanks))
+    {
+    SENSEI_WARNING("The published results of " << analysis->GetClassName()
+      << " require it to run synchronously on all ranks")
+    async = false;
+    control.DataRanks = false;
+    }
+
+  if (control.Trigger.Initialize(node.attribute("trigger").as_string("")))
+    {
+    SENSEI_ERROR("Failed to parse the trigger of " << analysis->GetClassName())
+    return -1;
+    }
+
+  if (control.Placement.Initialize(node))
+    {
+    SENSEI_ERROR("Failed to parse the placement of " << analysis->GetClassName())
+    return -1;
+    }
+
+  if (control.Placement.Enabled())
+    SENSEI_STATUS("Configured " << control.Cost.Name << " placement="
+      << control.Placement.GetDescription())
+
+  // reduce the resolution of the data written
+  if (pugi::xml_node subNode = node.child("subsample"))
+    {
+    control.Subsample = vtkSmartPointer<SubsamplingDataAdaptor>::New();
+    if (control.Subsample->Initialize(subNode))
+      {
+      SENSEI_ERROR("Failed to parse the subsampling of "
+        << analysis->GetClassName())
+      return -1;
+      }
+    }
+
+  // order the points written for locality
+  if (pugi::xml_node sortNode = node.child("sort"))
+    {
+    control.Sort = vtkSmartPointer<SpatialSortDataAdaptor>::New();
+    if (control.Sort->Initialize(sortNode))
+      {
+      SENSEI_ERROR("Failed to parse the sort of " << analysis->GetClassName())
+      return -1;
+      }
+    }
+
+  // determine the data the analysis accesses. prefer explicit requirements,
+  // many analyses use the mesh, array and association attributes instead.
+  if (node.child("mesh"))
+    {
+    if (control.Requirements.Initialize(node))
+      {
+      SENSEI_ERROR("Failed to parse the data requirements for "
+        << analysis->GetClassName())
+      return -1;
+      }
+    }
+  else if (node.attribute("mesh"))
+    {
+    std::string meshName = node.attribute("mesh").value();
+    std::string arrayName = node.attribute("array").as_string(
+      node.attribute("field").as_string(""));
+
+    if (arrayName.empty())
+      {
+      control.Requirements.AddRequirement(meshName, false);
+      }
     else
       {
-      slice->SetAutoColorRange(true);
+      int association = 0;
+      std::string assocStr = node.attribute("association").as_string("point");
+      if (VTKUtils::GetAssociation(assocStr, association))
+        {
+        SENSEI_ERROR("Failed to determine the data requirements for "
+          << analysis->GetClassName())
+        return -1;
+        }
+      control.Requirements.AddRequirement(meshName, association, arrayName);
+      }
+    }
+
+  // the analysis will issue MPI calls from the background thread
+  // while the simulation continues to do the same from the main thread
+  if (async && !MPIUtils::HaveThreadLevel(MPI_THREAD_MULTIPLE))
+    {
+    SENSEI_WARNING("Asynchronous execution of " << analysis->GetClassName()
+      << " requires MPI_THREAD_MULTIPLE. The analysis will run synchronously")
+    async = false;
+    }
+
+  // analyses that run where there is data access it through their own
+  // adaptor, since a collective on the simulation's would involve all ranks
+  if (!async && !control.DataRanks &&
+    !(this->Concurrent && !control.Requirements.Empty()))
+    return 0;
+
+  control.Async = async;
+
+  control.SnapshotAll = (async || control.DataRanks) &&
+    control.Requirements.Empty();
+  if (control.SnapshotAll && async)
+    SENSEI_WARNING("No data requirements were given for the asynchronous "
+      << analysis->GetClassName() << ". All available data will be copied")
+
+  // the analysis accesses the data through its own adaptor, hence
+  // any collectives it makes involve only the analysis' communicator
+  control.Data = vtkSmartPointer<VTKDataAdaptor>::New();
+  control.Data->SetCommunicator(analysis->GetCommunicator());
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::Snapshot(DataAdaptor *data,
+  const DataRequirements &reqs, VTKDataAdaptor *snapshot, bool deep,
+  long long *nBytes)
+{
+  TimeEvent<128> mark("ConfigurableAnalysis::Snapshot");
+
+  if (nBytes)
+    *nBytes = 0;
+
+  snapshot->ReleaseData();
+  snapshot->ClearTransientMeshMetadata();
+  snapshot->SetDataTime(data->GetDataTime());
+  snapshot->SetDataTimeStep(data->GetDataTimeStep());
+
+  // get the ghost layer metadata
+  MeshMetadataMap mdMap;
+  if (mdMap.Initialize(data))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return -1;
+    }
+
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    const std::string &meshName = mit.MeshName();
+
+    MeshMetadataPtr mmd;
+    if (mdMap.GetMeshMetadata(meshName, mmd))
+      {
+      SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    vtkDataObject *mesh = nullptr;
+    if (data->GetMesh(meshName, mit.StructureOnly(), mesh))
+      {
+      SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    // it is not an error for a rank to have no data, substitute an
+    // empty dataset so that the copy can be queried uniformly
+    if (!mesh)
+      {
+      int nRanks = 1;
+      MPI_Comm_size(snapshot->GetCommunicator(), &nRanks);
+
+      vtkMultiBlockDataSet *mb = vtkMultiBlockDataSet::New();
+      mb->SetNumberOfBlocks(nRanks);
+
+      snapshot->SetDataObject(meshName, mb);
+      mb->Delete();
+
+      continue;
+      }
+
+    if ((mmd->NumGhostCells || VTKUtils::AMR(mmd)) &&
+      data->AddGhostCellsArray(mesh, meshName))
+      {
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost cells.")
+      mesh->Delete();
+      return -1;
+      }
+
+    if (mmd->NumGhostNodes && data->AddGhostNodesArray(mesh, meshName))
+      {
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost nodes.")
+      mesh->Delete();
+      return -1;
+      }
+
+    ArrayRequirementsIterator ait = reqs.GetArrayRequirementsIterator(meshName);
+    ait.SetMode(ArrayRequirementsIterator::MODE_ASSOCIATION);
+    for (; ait; ++ait)
+      {
+      if (data->AddArrays(mesh, meshName, ait.Association(), ait.Arrays()))
+        {
+        SENSEI_ERROR(<< data->GetClassName() << " failed to add "
+          << VTKUtils::GetAttributesName(ait.Association())
+          << " data arrays to mesh \"" << meshName << "\"")
+        mesh->Delete();
+        return -1;
+        }
+      }
+
+    // the simulation is free to modify or release its data as soon as
+    // we return, in that case a deep copy is needed
+    if (deep)
+      {
+      vtkDataObject *meshCopy = mesh->NewInstance();
+      meshCopy->DeepCopy(mesh);
+      mesh->Delete();
+      mesh = meshCopy;
+
+      if (nBytes)
+        *nBytes += 1024ll*mesh->GetActualMemorySize();
+      }
+
+    snapshot->SetDataObject(meshName, mesh);
+    mesh->Delete();
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::Wait(unsigned int i)
+{
+  ExecutionControl &control = this->Controls[i];
+
+  if (!control.Pending.valid())
+    return 0;
+
+  TimeEvent<128> mark("ConfigurableAnalysis::Wait");
+
+  if (!control.Pending.get())
+    {
+    SENSEI_ERROR("Failed to execute " << this->Analyses[i]->GetClassName())
+    return -1;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::ExecuteSynchronous(unsigned int i,
+  DataAdaptor *data)
+{
+  const char* analysisName = nullptr;
+  bool logEnabled = Profiler::Enabled();
+  if (logEnabled)
+    {
+    analysisName = this->LogEventNames[3 * i + 1].c_str();
+    Profiler::StartEvent(analysisName);
+    }
+
+  CostMeter meter;
+  meter.Start();
+
+  int ierr = 0;
+  if (!this->Analyses[i]->Execute(data))
+    {
+    SENSEI_ERROR("Failed to execute " << this->Analyses[i]->GetClassName())
+    ierr = -1;
+    }
+
+  if (logEnabled)
+    Profiler::EndEvent(analysisName);
+
+  meter.Stop(this->Controls[i].Cost, 0, this->CostMutex);
+
+  return ierr;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::GetDataOwnership(unsigned int i,
+  DataAdaptor *data, int &owner)
+{
+  owner = 0;
+
+  std::vector<std::string> meshNames;
+  this->Controls[i].Requirements.GetRequiredMeshes(meshNames);
+
+  unsigned int nMeshes = 0;
+  if (data->GetNumberOfMeshes(nMeshes))
+    {
+    SENSEI_ERROR("Failed to get the number of meshes")
+    return -1;
+    }
+
+  // with no requirements the analysis may access any of the meshes
+  for (unsigned int j = 0; (j < nMeshes) && !owner; ++j)
+    {
+    MeshMetadataPtr md;
+    if (data->GetCachedMeshMetadata(j, MeshMetadataFlags(), false, md))
+      {
+      SENSEI_ERROR("Failed to get metadata for mesh " << j)
+      return -1;
+      }
+
+    if (!meshNames.empty() && (std::find(meshNames.begin(),
+      meshNames.end(), md->MeshName) == meshNames.end()))
+      continue;
+
+    if (md->NumBlocksLocal.size() > 0)
+      {
+      int rank = 0;
+      MPI_Comm_rank(data->GetCommunicator(), &rank);
+
+      owner = (md->GlobalView ? md->NumBlocksLocal[rank] :
+        md->NumBlocksLocal[0]) > 0;
+      }
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::UpdateDataRanks(MPI_Comm comm,
+  DataAdaptor *data, const std::vector<bool> &run)
+{
+  // the decision to run is the same on all ranks, and so is this list
+  std::vector<unsigned int> ids;
+  unsigned int nAnalyses = this->Controls.size();
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    if (this->Controls[i].DataRanks && run[i])
+      ids.push_back(i);
+    }
+
+  unsigned int nIds = ids.size();
+  if (nIds == 0)
+    return 0;
+
+  TimeEvent<128> mark("ConfigurableAnalysis::UpdateDataRanks");
+
+  // a single reduction finds the analyses for which any rank's
+  // ownership changed
+  std::vector<int> owner(nIds, 0);
+  std::vector<int> changed(nIds, 0);
+  for (unsigned int j = 0; j < nIds; ++j)
+    {
+    if (this->GetDataOwnership(ids[j], data, owner[j]))
+      {
+      SENSEI_ERROR("Failed to determine the data owned by "
+        << this->Analyses[ids[j]]->GetClassName())
+      return -1;
+      }
+    changed[j] = owner[j] != this->Controls[ids[j]].Owner;
+    }
+
+  MPI_Allreduce(MPI_IN_PLACE, changed.data(), nIds, MPI_INT, MPI_MAX, comm);
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  for (unsigned int j = 0; j < nIds; ++j)
+    {
+    if (!changed[j])
+      continue;
+
+    unsigned int i = ids[j];
+    ExecutionControl &control = this->Controls[i];
+
+    // the communicator of a running analysis can not be replaced
+    if (this->Wait(i))
+      return -1;
+
+    // the ranks without data form a communicator of their own, which is
+    // only used when the data moves to them
+    MPI_Comm subComm = MPI_COMM_NULL;
+    MPI_Comm_split(comm, owner[j], rank, &subComm);
+
+    this->Analyses[i]->SetCommunicator(subComm);
+    if (control.Data)
+      control.Data->SetCommunicator(subComm);
+
+    MPI_Comm_free(&subComm);
+
+    control.Owner = owner[j];
+    control.Split = true;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::ConfigurePlacement()
+{
+  unsigned int nAnalyses = this->Controls.size();
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    ExecutionControl &control = this->Controls[i];
+    if (!control.Placement.Enabled())
+      continue;
+
+    this->HavePlacement = true;
+
+    // the end point learns the placement from the simulation
+    if (this->EndPoint ||
+      (control.Placement.GetPlacement() == PlacementPolicy::PLACE_IN_SITU))
+      continue;
+
+    // the transport ships only the data of the analyses placed in transit
+    if (control.Requirements.Empty())
+      {
+      SENSEI_ERROR("The meshes and arrays of " << control.Cost.Name
+        << " must be given for it to be placed in transit")
+      return -1;
+      }
+
+    const std::string &transportName = control.Placement.GetTransport();
+
+    unsigned int t = 0;
+    while ((t < nAnalyses) && ((t == i) ||
+      (this->Controls[t].Cost.Name != transportName)))
+      ++t;
+
+    if (t == nAnalyses)
+      {
+      SENSEI_ERROR("The transport \"" << transportName << "\" of "
+        << control.Cost.Name << " was not found")
+      return -1;
+      }
+
+    ExecutionControl &transport = this->Controls[t];
+    if (transport.Placement.Enabled())
+      {
+      SENSEI_ERROR("The transport \"" << transportName << "\" of "
+        << control.Cost.Name << " can not itself be placed")
+      return -1;
+      }
+
+    control.Transport = t;
+
+    if (!transport.Ships)
+      {
+      transport.Ships = true;
+      transport.ShipBase = transport.Requirements;
+      }
+    }
+
+  // the placement is published for the transports to ship
+  if (this->HavePlacement && !this->EndPoint)
+    {
+    this->HavePartialResults = true;
+    this->Published.insert(PlacementPolicy::GetMeshName());
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::EstimateBytes(MeshMetadataMap &mdMap,
+  const DataRequirements &reqs, double &nBytes)
+{
+  nBytes = 0.0;
+
+  // empty requirements are those of a transport that ships everything
+  bool all = reqs.Empty();
+
+  unsigned int nMeshes = mdMap.Size();
+  for (unsigned int j = 0; j < nMeshes; ++j)
+    {
+    MeshMetadataPtr md;
+    if (mdMap.GetMeshMetadata(j, md))
+      {
+      SENSEI_ERROR("Failed to get metadata for mesh " << j)
+      return -1;
+      }
+
+    bool required = all;
+    bool structureOnly = false;
+    MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+    for (; mit && !required; ++mit)
+      {
+      if (mit.MeshName() == md->MeshName)
+        {
+        required = true;
+        structureOnly = mit.StructureOnly();
+        }
+      }
+
+    if (!required)
+      continue;
+
+    double nPoints = 0.0;
+    for (size_t k = 0; k < md->BlockNumPoints.size(); ++k)
+      nPoints += md->BlockNumPoints[k];
+
+    double nCells = 0.0;
+    for (size_t k = 0; k < md->BlockNumCells.size(); ++k)
+      nCells += md->BlockNumCells[k];
+
+    double nCellArray = 0.0;
+    for (size_t k = 0; k < md->BlockCellArraySize.size(); ++k)
+      nCellArray += md->BlockCellArraySize[k];
+
+    // the geometry of image data is described by its extent
+    if (!structureOnly && (md->BlockType != VTK_IMAGE_DATA) &&
+      (md->BlockType != VTK_UNIFORM_GRID) &&
+      (md->BlockType != VTK_RECTILINEAR_GRID))
+      nBytes += 3.0*nPoints*vtkAbstractArray::GetDataTypeSize(md->CoordinateType)
+        + nCellArray*sizeof(vtkIdType);
+
+    unsigned int nArrays = md->ArrayName.size();
+    for (unsigned int k = 0; k < nArrays; ++k)
+      {
+      int centering = md->ArrayCentering[k];
+      if (all || reqs.HasArray(md->MeshName, centering, md->ArrayName[k]))
+        nBytes += (centering == vtkDataObject::POINT ? nPoints : nCells)*
+          md->ArrayComponents[k]*vtkAbstractArray::GetDataTypeSize(md->ArrayType[k]);
+      }
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::SetTransportRequirements(
+  unsigned int i, const DataRequirements &reqs)
+{
+  AnalysisAdaptor *transport = this->Analyses[i].Get();
+
+  int ierr = -1;
+#ifdef ENABLE_ADIOS2
+  if (ADIOS2AnalysisAdaptor *adios =
+    dynamic_cast<ADIOS2AnalysisAdaptor*>(transport))
+    ierr = adios->SetDataRequirements(reqs);
+#endif
+#ifdef ENABLE_HDF5
+  if (HDF5AnalysisAdaptor *hdf5 = dynamic_cast<HDF5AnalysisAdaptor*>(transport))
+    ierr = hdf5->SetDataRequirements(reqs);
+#endif
+
+  if (ierr)
+    {
+    SENSEI_ERROR("Failed to set the data requirements of "
+      << transport->GetClassName() << ". Analyses may be placed in transit"
+      " by the adios2 and hdf5 transports")
+    return -1;
+    }
+
+  this->Controls[i].Requirements = reqs;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::AddSourceRequirements(unsigned int ai,
+  DataRequirements &reqs, bool &complete)
+{
+  // an analysis that did not declare its requirements may access
+  // anything the simulation provides. the requirements of an analysis
+  // that subsamples or sorts are on the meshes it is served
+  ExecutionControl &control = this->Controls[ai];
+  DataRequirements sourceReqs = control.Requirements;
+  if (control.Sort)
+    {
+    DataRequirements sortReqs;
+    control.Sort->GetSourceRequirements(sourceReqs, sortReqs);
+    sourceReqs = sortReqs;
+    }
+
+  if (control.Subsample)
+    {
+    DataRequirements subReqs;
+    control.Subsample->GetSourceRequirements(sourceReqs, subReqs);
+    sourceReqs = subReqs;
+    }
+
+  const DataRequirements &ri = sourceReqs;
+  if (ri.GetNumberOfRequiredMeshes() == 0)
+    {
+    complete = false;
+    return 0;
+    }
+
+  // the meshes published by the analyses are not asked of the simulation
+  std::set<std::string> &published = this->Published;
+  bool consumes = false;
+  MeshRequirementsIterator mit = ri.GetMeshRequirementsIterator();
+  for (; mit && !consumes; ++mit)
+    consumes = published.count(mit.MeshName());
+
+  if (!consumes)
+    {
+    reqs.AddRequirements(ri);
+    return 0;
+    }
+
+  for (mit = ri.GetMeshRequirementsIterator(); mit; ++mit)
+    {
+    if (published.count(mit.MeshName()))
+      continue;
+
+    reqs.AddRequirement(mit.MeshName(), mit.StructureOnly());
+
+    ArrayRequirementsIterator ait =
+      ri.GetArrayRequirementsIterator(mit.MeshName());
+    for (; ait; ++ait)
+      reqs.AddRequirement(mit.MeshName(), ait.Association(), ait.Array());
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::GetAllRequirements(
+  DataRequirements &reqs, bool &complete)
+{
+  reqs.Clear();
+  complete = true;
+
+  unsigned int nAnalyses = this->Controls.size();
+  for (unsigned int ai = 0; ai < nAnalyses; ++ai)
+    {
+    if (this->AddSourceRequirements(ai, reqs, complete))
+      return -1;
+    }
+
+  // the placement is read by the end point, its arrays name the analyses
+  // placed in transit
+  if (this->EndPoint && this->HavePlacement)
+    {
+    reqs.AddRequirement(PlacementPolicy::GetMeshName(), true);
+    for (unsigned int ai = 0; ai < nAnalyses; ++ai)
+      {
+      const ExecutionControl &control =
+        this->Controls[ai];
+
+      if (control.Placement.Enabled())
+        reqs.AddRequirement(PlacementPolicy::GetMeshName(),
+          vtkDataObject::CELL, control.Cost.Name);
       }
+    }
 
-    slice->SetUseLogScale(node.attribute("color-log").as_int(0) == 1);
-    if (node.attribute("image-filename"))
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::PushRequirements(
+  InTransitDataAdaptor *data)
+{
+  if (this->PushedRequirements)
+    return 0;
+
+  this->PushedRequirements = true;
+
+  if (!data->GetDataRequirements().Empty())
+    return 0;
+
+  DataRequirements reqs;
+  bool complete = true;
+  if (this->GetAllRequirements(reqs, complete))
+    return -1;
+
+  // an analysis that declares no requirements may access any of the data
+  if (complete)
+    data->SetDataRequirements(reqs);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::GetEndPointPlacement(DataAdaptor *data)
+{
+  unsigned int nMeshes = 0;
+  if (data->GetNumberOfMeshes(nMeshes))
+    {
+    SENSEI_ERROR("Failed to get the number of meshes")
+    return -1;
+    }
+
+  MeshMetadataPtr marker;
+  for (unsigned int j = 0; (j < nMeshes) && !marker; ++j)
+    {
+    MeshMetadataPtr md;
+    if (data->GetCachedMeshMetadata(j, MeshMetadataFlags(), false, md))
       {
-      slice->SetImageParameters(
-        node.attribute("image-filename").value(),
-        node.attribute("image-width").as_int(800),
-        node.attribute("image-height").as_int(800));
+      SENSEI_ERROR("Failed to get metadata for mesh " << j)
+      return -1;
       }
 
-    this->CatalystAdaptor->AddPipeline(slice.GetPointer());
+    if (md->MeshName == PlacementPolicy::GetMeshName())
+      marker = md;
     }
-  else if (strcmp(node.attribute("pipeline").value(), "particle") == 0)
+
+  // the marker names the analyses placed in transit. without it the
+  // stream was written by a simulation that does not place the analyses
+  // and all of them run
+  unsigned int nAnalyses = this->Controls.size();
+  for (unsigned int i = 0; i < nAnalyses; ++i)
     {
-    vtkNew<CatalystParticle> particle;
+    ExecutionControl &control = this->Controls[i];
+    if (!control.Placement.Enabled())
+      continue;
 
-    double tmp[3];
-    if (node.attribute("mesh"))
+    control.PlacedElsewhere = marker && (std::find(marker->ArrayName.begin(),
+      marker->ArrayName.end(), control.Cost.Name) == marker->ArrayName.end());
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::Place(MPI_Comm comm,
+  DataAdaptor *data, const std::vector<bool> &run)
+{
+  if (!this->HavePlacement)
+    return 0;
+
+  if (this->EndPoint)
+    return this->GetEndPointPlacement(data);
+
+  TimeEvent<128> mark("ConfigurableAnalysis::Place");
+
+  unsigned int nAnalyses = this->Controls.size();
+
+  // the sizes of the data are estimated from the metadata
+  MeshMetadataFlags flags;
+  flags.SetBlockSize();
+
+  MeshMetadataMap mdMap;
+  if (mdMap.Initialize(data, flags))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return -1;
+    }
+
+  // the measurements of the last step. the time of the analyses that
+  // executed in situ and of the transports, and the bytes the transports
+  // shipped, as counted by the Profiler or else as estimated. the bytes
+  // the analyses read are estimated from this step's metadata
+  std::vector<double> times(nAnalyses, -1.0);
+  std::vector<double> bytes(2*nAnalyses, 0.0);
+  std::vector<double> backlog(nAnalyses, 0.0);
+  {
+  std::lock_guard<std::mutex> lock(this->CostMutex);
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    ExecutionControl &control = this->Controls[i];
+    long &seen = control.Ships ? control.ShipExecutions :
+      control.PlacedExecutions;
+
+    if ((control.Ships || control.Placement.Enabled()) &&
+      (control.Cost.NumExecutions > seen))
       {
-      particle->SetInputMesh(node.attribute("mesh").value());
+      times[i] = control.Cost.LastTime;
+      if (control.Ships)
+        bytes[i] = control.Cost.LastBytes > 0 ?
+          control.Cost.LastBytes : control.ShippedBytes;
+      seen = control.Cost.NumExecutions;
       }
-    if (node.attribute("particle-style"))
+    }
+  }
+
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    ExecutionControl &control = this->Controls[i];
+
+    if (control.Placement.Enabled() &&
+      this->EstimateBytes(mdMap, control.Requirements, bytes[nAnalyses + i]))
+      return -1;
+
+    long long depth = 0;
+    if (control.Ships && !Profiler::GetCounter((std::string(
+      this->Analyses[i]->GetClassName()) + "::QueueDepth").c_str(), depth))
+      backlog[i] = depth;
+    }
+
+  MPI_Allreduce(MPI_IN_PLACE, times.data(), nAnalyses, MPI_DOUBLE, MPI_MAX, comm);
+  MPI_Allreduce(MPI_IN_PLACE, bytes.data(), 2*nAnalyses, MPI_DOUBLE, MPI_SUM, comm);
+  MPI_Allreduce(MPI_IN_PLACE, backlog.data(), nAnalyses, MPI_DOUBLE, MPI_MAX, comm);
+
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    ExecutionControl &control = this->Controls[i];
+    if (control.Ships && (times[i] > 0.0) && (bytes[i] > 0.0))
+      control.Bandwidth = bytes[i]/times[i];
+    }
+
+  // place the analyses that run this step. those placed in transit are
+  // named by the marker
+  std::vector<std::vector<unsigned int>> shipped(nAnalyses);
+  std::vector<std::string> names;
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    ExecutionControl &control = this->Controls[i];
+    if (!control.Placement.Enabled())
+      continue;
+
+    bool wasElsewhere = control.PlacedElsewhere;
+    control.PlacedElsewhere = false;
+
+    if (!run[i])
+      continue;
+
+    PlacementPolicy::Measures measures;
+    measures.LocalTime = times[i];
+    measures.Bytes = bytes[nAnalyses + i];
+    measures.Bandwidth = 0.0;
+    measures.Backlog = 0.0;
+
+    // the data can only be shipped when the transport runs
+    int t = control.Transport;
+    if ((t >= 0) && run[t])
       {
-      particle->SetParticleStyle(node.attribute("particle-style").value());
+      measures.Bandwidth = this->Controls[t].Bandwidth;
+      measures.Backlog = backlog[t];
       }
-    if (node.attribute("particle-radius") &&
-      (std::sscanf(node.attribute("particle-radius").value(),
-      "%lg", &tmp[0]) == 1))
+
+    control.PlacedElsewhere = (t >= 0) &&
+      (control.Placement.Place(measures) == PlacementPolicy::PLACE_IN_TRANSIT);
+
+    if (control.PlacedElsewhere)
       {
-      particle->SetParticleRadius(tmp[0]);
+      shipped[t].push_back(i);
+      names.push_back(control.Cost.Name);
       }
-    if (node.attribute("camera-position") &&
-      (std::sscanf(node.attribute("camera-position").value(),
-      "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3))
+
+    if (control.PlacedElsewhere != wasElsewhere)
+      SENSEI_STATUS("Placed " << control.Cost.Name << " "
+        << (control.PlacedElsewhere ? "in transit" : "in situ")
+        << " step=" << data->GetDataTimeStep() << " local cost="
+        << times[i] << " bytes=" << measures.Bytes << " bandwidth="
+        << measures.Bandwidth << " backlog=" << measures.Backlog)
+
+    Profiler::LogCounter((control.Cost.Name + "::InTransit").c_str(),
+      control.PlacedElsewhere);
+    }
+
+  // publish the marker, a cell on each rank with an array named for each
+  // analysis placed in transit
+  vtkImageData *block = vtkImageData::New();
+  block->SetDimensions(2, 1, 1);
+
+  unsigned int nNames = names.size();
+  for (unsigned int j = 0; j < nNames; ++j)
+    {
+    vtkIntArray *placed = vtkIntArray::New();
+    placed->SetName(names[j].c_str());
+    placed->SetNumberOfTuples(1);
+    placed->SetValue(0, 1);
+    block->GetCellData()->AddArray(placed);
+    placed->Delete();
+    }
+
+  vtkCompositeDataSetPtr marker = VTKUtils::AsCompositeData(comm, block, true);
+
+  this->PartialResults->SetPartialResult(PlacementPolicy::GetMeshName(), marker);
+
+  // the transports ship the marker and the data of the analyses placed in
+  // transit along with their own. those without requirements ship all of
+  // the meshes, the marker included
+  for (unsigned int t = 0; t < nAnalyses; ++t)
+    {
+    ExecutionControl &transport = this->Controls[t];
+    if (!transport.Ships)
+      continue;
+
+    if (!transport.ShipBase.Empty())
       {
-      particle->SetCameraPosition(tmp);
+      DataRequirements reqs = transport.ShipBase;
+
+      unsigned int nShipped = shipped[t].size();
+      for (unsigned int j = 0; j < nShipped; ++j)
+        reqs.AddRequirements(this->Controls[shipped[t][j]].Requirements);
+
+      if (nNames)
+        reqs.AddRequirement(PlacementPolicy::GetMeshName(),
+          vtkDataObject::CELL, names);
+      else
+        reqs.AddRequirement(PlacementPolicy::GetMeshName(), false);
+
+      if (this->SetTransportRequirements(t, reqs))
+        return -1;
       }
 
-    if (node.attribute("camera-focus") &&
-      (std::sscanf(node.attribute("camera-focus").value(),
-      "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3))
+    if (this->EstimateBytes(mdMap, transport.Requirements,
+      transport.ShippedBytes))
+      return -1;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::ExecuteBatch(unsigned int i,
+  const std::vector<DataAdaptor*> &steps)
+{
+  const char* analysisName = nullptr;
+  bool logEnabled = Profiler::Enabled();
+  if (logEnabled)
+    {
+    analysisName = this->LogEventNames[3 * i + 1].c_str();
+    Profiler::StartEvent(analysisName);
+    }
+
+  CostMeter meter;
+  meter.Start();
+
+  int ierr = 0;
+  if (!this->Analyses[i]->ExecuteBatch(steps))
+    {
+    SENSEI_ERROR("Failed to execute " << this->Analyses[i]->GetClassName()
+      << " on a batch of " << steps.size() << " steps")
+    ierr = -1;
+    }
+
+  if (logEnabled)
+    Profiler::EndEvent(analysisName);
+
+  meter.Stop(this->Controls[i].Cost, 0, this->CostMutex);
+
+  return ierr;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::ExecuteAsynchronous(unsigned int i,
+  DataAdaptor *data)
+{
+  ExecutionControl &control = this->Controls[i];
+
+  // the previous step must be complete before the copy used by
+  // the analysis can be updated
+  if (this->Wait(i))
+    return -1;
+
+  if (control.SnapshotAll && control.Requirements.Initialize(data, false))
+    {
+    SENSEI_ERROR("Failed to determine the data available for "
+      << this->Analyses[i]->GetClassName())
+    return -1;
+    }
+
+  long long copyBytes = 0;
+  if (this->Snapshot(data, control.Requirements, control.Data, true, &copyBytes))
+    {
+    SENSEI_ERROR("Failed to copy the data required by "
+      << this->Analyses[i]->GetClassName())
+    return -1;
+    }
+
+  const char* analysisName = nullptr;
+  if (Profiler::Enabled())
+    analysisName = this->LogEventNames[3 * i + 1].c_str();
+
+  AnalysisAdaptorPtr analysis = this->Analyses[i];
+  vtkSmartPointer<VTKDataAdaptor> snapshot = control.Data;
+
+  ConfigurableAnalysis::AnalysisCost &cost = control.Cost;
+  std::mutex &costMutex = this->CostMutex;
+
+  control.Pending = std::async(std::launch::async,
+    [analysis, snapshot, analysisName, copyBytes, &cost, &costMutex]() -> bool
+    {
+    TaskRuntime::BindThread("ConfigurableAnalysis::Asynchronous");
+
+    if (analysisName)
+      Profiler::StartEvent(analysisName);
+
+    CostMeter meter;
+    meter.Start();
+
+    bool ok = analysis->Execute(snapshot.GetPointer());
+
+    if (analysisName)
+      Profiler::EndEvent(analysisName);
+
+    meter.Stop(cost, copyBytes, costMutex);
+
+    return ok;
+    });
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+DataAdaptor *ConfigurableAnalysis::InternalsType::GetAnalysisData(
+  unsigned int i, DataAdaptor *data)
+{
+  ExecutionControl &control = this->Controls[i];
+
+  if (control.Subsample)
+    {
+    control.Subsample->SetDataAdaptor(data);
+    data = control.Subsample;
+    }
+
+  if (control.Sort)
+    {
+    control.Sort->SetDataAdaptor(data);
+    data = control.Sort;
+    }
+
+  return data;
+}
+
+// --------------------------------------------------------------------------
+bool ConfigurableAnalysis::InternalsType::Conflict(unsigned int i,
+  unsigned int j) const
+{
+  const DataRequirements &ri = this->Controls[i].Requirements;
+  const DataRequirements &rj = this->Controls[j].Requirements;
+
+  // nothing is known about what one of these accesses, or the later may
+  // consume what the earlier publishes
+  if (ri.Empty() || rj.Empty() || this->Controls[i].Publishes)
+    return true;
+
+  MeshRequirementsIterator mit = ri.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    MeshRequirementsIterator mjt = rj.GetMeshRequirementsIterator();
+    for (; mjt; ++mjt)
       {
-      particle->SetCameraFocus(tmp);
+      if (mit.MeshName() == mjt.MeshName())
+        return true;
       }
+    }
 
-    int association = 0;
-    std::string assocStr = node.attribute("association").as_string("point");
-    if (VTKUtils::GetAssociation(assocStr, association))
+  return false;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::ExecuteConcurrent(DataAdaptor *data,
+  const std::vector<unsigned int> &ids)
+{
+  TimeEvent<128> mark("ConfigurableAnalysis::ExecuteConcurrent");
+
+  unsigned int nIds = ids.size();
+
+  // gather the data for the analyses that run on their own adaptor.
+  // this is done up front on the calling thread since the simulation's
+  // adaptor is not expected to be thread safe, and it may make collective
+  // calls on the simulation's communicator.
+  for (unsigned int j = 0; j < nIds; ++j)
+    {
+    ExecutionControl &control = this->Controls[ids[j]];
+    DataAdaptor *adata = this->GetAnalysisData(ids[j], data);
+
+    if (control.SnapshotAll && control.Requirements.Initialize(adata, false))
+      {
+      SENSEI_ERROR("Failed to determine the data available for "
+        << this->Analyses[ids[j]]->GetClassName())
+      return -1;
+      }
+
+    if (control.Data && this->Snapshot(adata, control.Requirements,
+      control.Data, false))
+      {
+      SENSEI_ERROR("Failed to get the data required by "
+        << this->Analyses[ids[j]]->GetClassName())
+      return -1;
+      }
+    }
+
+  // build the dependency graph and start execution. each task first
+  // waits for the earlier analyses that it conflicts with.
+  std::vector<std::shared_future<int>> tasks(nIds);
+  for (unsigned int j = 0; j < nIds; ++j)
+    {
+    std::vector<std::shared_future<int>> deps;
+    for (unsigned int i = 0; i < j; ++i)
+      {
+      if (this->Conflict(ids[i], ids[j]))
+        deps.push_back(tasks[i]);
+      }
+
+    unsigned int aid = ids[j];
+
+    ExecutionControl &control = this->Controls[aid];
+    DataAdaptor *da = control.Data ? control.Data.GetPointer() :
+      this->GetAnalysisData(aid, data);
+
+    tasks[j] = std::async(std::launch::async,
+      [this, aid, da, deps]() -> int
+      {
+      TaskRuntime::BindThread("ConfigurableAnalysis::Concurrent");
+
+      unsigned int nDeps = deps.size();
+      for (unsigned int q = 0; q < nDeps; ++q)
+        deps[q].wait();
+
+      return this->ExecuteSynchronous(aid, da);
+      }).share();
+    }
+
+  int ierr = 0;
+  for (unsigned int j = 0; j < nIds; ++j)
+    {
+    if (tasks[j].get())
+      ierr = -1;
+
+    ExecutionControl &control = this->Controls[ids[j]];
+    if (control.Data)
+      control.Data->ReleaseData();
+    }
+
+  return ierr;
+}
+
+// --------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::Schedule(MPI_Comm comm,
+  std::vector<bool> &run)
+{
+  unsigned int nAnalyses = this->Controls.size();
+
+  run.assign(nAnalyses, true);
+
+  if (this->Budget <= 0.0)
+    return this->ScheduleMemory(comm, run);
+
+  TimeEvent<128> mark("ConfigurableAnalysis::Schedule");
+
+  // gather the time the simulation spent since the last step, the time
+  // spent in situ during the last step, and the time of each analysis'
+  // last execution. the slowest rank determines the cost
+  std::vector<double> times(nAnalyses + 2, 0.0);
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (this->HaveLastExecute)
+    {
+    times[0] = std::chrono::duration<double>(now - this->LastExecuteEnd).count();
+    times[1] = this->LastExecuteTime;
+    }
+
+  std::vector<long> nExecuted(nAnalyses);
+    {
+    std::lock_guard<std::mutex> lock(this->CostMutex);
+    for (unsigned int i = 0; i < nAnalyses; ++i)
+      {
+      times[i + 2] = this->Controls[i].Cost.LastTime;
+      nExecuted[i] = this->Controls[i].Cost.NumExecutions;
+      }
+    }
+
+  MPI_Allreduce(MPI_IN_PLACE, times.data(), times.size(), MPI_DOUBLE,
+    MPI_MAX, comm);
+
+  // asynchronous executions complete at different times on different
+  // ranks, agree on the number completed so that estimates match
+  MPI_Allreduce(MPI_IN_PLACE, nExecuted.data(), nAnalyses, MPI_LONG,
+    MPI_MIN, comm);
+
+  // update the estimates with the executions completed since the last
+  // step. the average is weighted toward recent executions so that
+  // changes in the cost of a phase are followed quickly
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    ExecutionControl &control = this->Controls[i];
+    if (nExecuted[i] > control.NumMeasured)
       {
-      SENSEI_ERROR("Failed to initialize Catalyst")
-      return -1;
+      control.CostEstimate = control.NumMeasured ?
+        0.5*(control.CostEstimate + times[i + 2]) : times[i + 2];
+
+      control.NumMeasured = nExecuted[i];
       }
+    }
 
-    particle->ColorBy(association, node.attribute("array").value());
-    if (node.attribute("color-range") &&
-      (std::sscanf(node.attribute("color-range").value(), "%lg,%lg", &tmp[0], &tmp[1]) == 2))
+  // earn the allowance for the time the simulation ran and pay for the
+  // time spent in situ. a fraction b of the total step time is allowed when
+  // the in situ time is at most b/(1 - b) of the simulation's time
+  double ratio = this->Budget < 1.0 ? this->Budget/(1.0 - this->Budget) :
+    std::numeric_limits<double>::max();
+
+  double allowance = ratio*times[0];
+
+  this->Credit = std::min(this->Credit + allowance - times[1],
+    this->BudgetWindow*allowance);
+
+  // the analyses that are due run regardless of the budget. those never
+  // measured are run so that their cost is known
+  double credit = this->Credit;
+  std::vector<unsigned int> order;
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    ExecutionControl &control = this->Controls[i];
+    if ((control.NumMeasured == 0) || ((control.MinCadence > 0) &&
+      (control.StepsSkipped + 1 >= control.MinCadence)))
       {
-      particle->SetAutoColorRange(false);
-      particle->SetColorRange(tmp[0], tmp[1]);
+      credit -= control.CostEstimate;
       }
     else
       {
-      particle->SetAutoColorRange(true);
+      run[i] = false;
+      order.push_back(i);
       }
+    }
 
-    particle->SetUseLogScale(node.attribute("color-log").as_int(0) == 1);
-    if (node.attribute("image-filename"))
+  // the remaining analyses are chosen in order of priority, and among
+  // those of the same priority the one that has waited longest goes first
+  std::stable_sort(order.begin(), order.end(),
+    [this](unsigned int a, unsigned int b) -> bool
+    {
+    const ExecutionControl &ca = this->Controls[a];
+    const ExecutionControl &cb = this->Controls[b];
+    return (ca.Priority > cb.Priority) || ((ca.Priority == cb.Priority) &&
+      (ca.StepsSkipped > cb.StepsSkipped));
+    });
+
+  unsigned int nOrdered = order.size();
+  for (unsigned int j = 0; j < nOrdered; ++j)
+    {
+    ExecutionControl &control = this->Controls[order[j]];
+    if (control.CostEstimate <= credit)
       {
-      particle->SetImageParameters(
-        node.attribute("image-filename").value(),
-        node.attribute("image-width").as_int(800),
-        node.attribute("image-height").as_int(800));
+      run[order[j]] = true;
+      credit -= control.CostEstimate;
       }
+    }
 
-    this->CatalystAdaptor->AddPipeline(particle.GetPointer());
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    ExecutionControl &control = this->Controls[i];
+    control.StepsSkipped = run[i] ? 0 : control.StepsSkipped + 1;
     }
-  else if (strcmp(node.attribute("pipeline").value(), "pythonscript") == 0)
+
+  return this->ScheduleMemory(comm, run);
+}
+
+//----------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::ScheduleMemory(MPI_Comm comm,
+  std::vector<bool> &run)
+{
+  MemoryGovernor &governor = MemoryGovernor::GetGlobalGovernor();
+
+  unsigned int nAnalyses = this->Controls.size();
+
+  // the memory granted for the last step is returned, its use is now
+  // part of the process' resident set
+  for (unsigned int i = 0; i < nAnalyses; ++i)
     {
-#ifndef ENABLE_CATALYST_PYTHON
-    SENSEI_ERROR("Catalyst Python was requested but is disabled in this build")
-#else
-    if (node.attribute("filename"))
+    ExecutionControl &control = this->Controls[i];
+    governor.Release(control.MemoryConsumer, control.MemoryGranted);
+    control.MemoryGranted = 0;
+    }
+
+  if (!governor.Enabled())
+    return 0;
+
+  TimeEvent<128> mark("ConfigurableAnalysis::ScheduleMemory");
+
+  // an analysis is expected to need the most memory it added in any of
+  // its executions so far. those never measured are run
+  std::vector<int> denied(nAnalyses, 0);
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    ExecutionControl &control = this->Controls[i];
+    if (!run[i])
+      continue;
+
+    long long nBytes = 0;
+    std::string name;
       {
-      std::string fileName = node.attribute("filename").value();
-      this->CatalystAdaptor->AddPythonScriptPipeline(fileName);
+      std::lock_guard<std::mutex> lock(this->CostMutex);
+      nBytes = 1024ll*control.Cost.MaxMemoryDelta;
+      name = control.Cost.Name;
       }
-#endif
+
+    if (control.MemoryConsumer < 0)
+      control.MemoryConsumer = governor.Register(name,
+        MemoryGovernor::POLICY_SKIP);
+
+    if (nBytes <= 0)
+      continue;
+
+    if (governor.Request(control.MemoryConsumer, nBytes))
+      control.MemoryGranted = nBytes;
+    else
+      denied[i] = 1;
     }
-  SENSEI_STATUS("Configured CatalystAnalysisAdaptor "
-    << node.attribute("pipeline").value() << " "
-    << (node.attribute("filename") ? node.attribute("filename").value() : ""))
-#endif
+
+  // an analysis that does not fit on one rank is skipped on all of them
+  if (nAnalyses)
+    MPI_Allreduce(MPI_IN_PLACE, denied.data(), nAnalyses, MPI_INT,
+      MPI_MAX, comm);
+
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    ExecutionControl &control = this->Controls[i];
+    if (denied[i])
+      {
+      SENSEI_STATUS("Skipping " << this->Analyses[i]->GetClassName()
+        << " " << i << ", its memory does not fit in the budget")
+
+      governor.Release(control.MemoryConsumer, control.MemoryGranted);
+      control.MemoryGranted = 0;
+      run[i] = false;
+      }
+    }
+
   return 0;
 }
 
-// --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddLibsim(pugi::xml_node node)
+//----------------------------------------------------------------------------
+senseiNewMacro(ConfigurableAnalysis);
+
+//----------------------------------------------------------------------------
+ConfigurableAnalysis::ConfigurableAnalysis()
+  : Internals(new ConfigurableAnalysis::InternalsType())
 {
-#ifndef ENABLE_LIBSIM
-  (void)node;
-  SENSEI_ERROR("Libsim was requested but is disabled in this build")
-  return -1;
-#else
+}
 
-  // We keep around a single instance of the libsim adaptor and then tell it to
-  // do different things.
-  if (!this->LibsimAdaptor)
-    {
-    this->LibsimAdaptor = vtkSmartPointer<LibsimAnalysisAdaptor>::New();
+//----------------------------------------------------------------------------
+ConfigurableAnalysis::~ConfigurableAnalysis()
+{
+  delete this->Internals;
+}
 
-    if (this->Comm != MPI_COMM_NULL)
-      this->LibsimAdaptor->SetCommunicator(this->Comm);
+//----------------------------------------------------------------------------
+int ConfigurableAnalysis::SetCommunicator(MPI_Comm comm)
+{
+  this->AnalysisAdaptor::SetCommunicator(comm);
 
-    if(node.attribute("trace"))
-      this->LibsimAdaptor->SetTraceFile(node.attribute("trace").value());
+  // save the communicator for use with adaptors created
+  // during XML parsing
+  this->Internals->Comm = comm;
 
-    if(node.attribute("options"))
-      this->LibsimAdaptor->SetOptions(node.attribute("options").value());
+  // set the communicator on existing adaptors, if there are any
+  AnalysisAdaptorVector::iterator iter = this->Internals->Analyses.begin();
+  AnalysisAdaptorVector::iterator end = this->Internals->Analyses.end();
 
-    if(node.attribute("visitdir"))
-      this->LibsimAdaptor->SetVisItDirectory(node.attribute("visitdir").value());
+  for (; iter != end; ++iter)
+    (*iter)->SetCommunicator(comm);
 
-    if(node.attribute("mode"))
-      this->LibsimAdaptor->SetMode(node.attribute("mode").value());
+  return 0;
+}
 
-    this->LibsimAdaptor->SetComputeNesting(
-      node.attribute("compute_nesting").as_int(0));
 
-    this->TimeInitialization(this->LibsimAdaptor, [&]()
-      {
-      this->LibsimAdaptor->Initialize();
-      return 0;
-      });
+//----------------------------------------------------------------------------
+int ConfigurableAnalysis::Initialize(const std::string& filename)
+{
+  TimeEvent<128> event("ConfigurableAnalysis::Initialize");
 
-    this->Analyses.push_back(this->LibsimAdaptor);
+  pugi::xml_document doc;
+  if (XMLUtils::Parse(this->GetCommunicator(), filename, doc))
+    {
+    SENSEI_ERROR("Failed to load, parse, and share XML configuration")
+    MPI_Abort(this->GetCommunicator(), -1);
+    return -1;
     }
 
-  bool doExport = false;
-  if(node.attribute("operation") != NULL)
-    doExport = (node.attribute("operation").value() == std::string("export"));
+  pugi::xml_node root = doc.child("sensei");
 
-  int frequency = 5;
-  if(node.attribute("frequency") != NULL)
-    frequency = node.attribute("frequency").as_int();
+  return Initialize(root);
+}
 
-  if(frequency < 1)
-    frequency = 1;
+//----------------------------------------------------------------------------
+int ConfigurableAnalysis::Initialize(const pugi::xml_node &root)
+{
+  TimeEvent<128> event("ConfigurableAnalysis::Initialize");
 
-  std::string filename;
-  LibsimImageProperties imageProps;
-  if(node.attribute("filename") != NULL)
+  // size the threads shared by the analyses before any of them is created
+  // and place them, and the threads of the asynchronous stages, on cores
+  if (root.attribute("threads") || root.attribute("thread_affinity") ||
+    root.attribute("reserved_cores"))
     {
-    imageProps.SetFilename(node.attribute("filename").value());
-    filename = node.attribute("filename").value();
+    int affinity = TaskRuntime::AFFINITY_NONE;
+    const char *affinityName =
+      root.attribute("thread_affinity").as_string("inherit");
+    if (TaskRuntime::GetAffinity(affinityName, affinity) ||
+      TaskRuntime::Initialize(root.attribute("threads").as_int(0), affinity,
+        root.attribute("reserved_cores").as_string("")))
+      {
+      SENSEI_ERROR("Failed to configure the threads. thread_affinity \""
+        << affinityName << "\" should be one of inherit, compact, scatter,"
+        " reserved, or smt")
+      return -1;
+      }
     }
-  if(node.attribute("image-filename") != NULL)
+
+  // run independent analyses at the same time. this requires
+  // MPI_THREAD_MULTIPLE since each analysis makes MPI calls
+  this->Internals->Concurrent = root.attribute("concurrent").as_int(0);
+  if (this->Internals->Concurrent &&
+    !MPIUtils::HaveThreadLevel(MPI_THREAD_MULTIPLE))
     {
-    imageProps.SetFilename(node.attribute("image-filename").value());
-    filename = node.attribute("image-filename").value();
+    SENSEI_WARNING("Concurrent execution requires MPI_THREAD_MULTIPLE."
+      " Analyses will run one after the other")
+    this->Internals->Concurrent = 0;
     }
 
-  if(node.attribute("image-width") != NULL)
-    imageProps.SetWidth(node.attribute("image-width").as_int());
+  // share the data produced by the simulation among the analyses
+  this->Internals->CacheData = root.attribute("cache").as_int(1);
 
-  if(node.attribute("image-height") != NULL)
-    imageProps.SetHeight(node.attribute("image-height").as_int());
+  // exchange the metadata in two stages, within and then across nodes
+  if (root.attribute("global_view"))
+    {
+    std::string globalView = root.attribute("global_view").as_string();
+    if (globalView == "flat")
+      this->Internals->GlobalViewMode = DataAdaptor::GLOBAL_VIEW_FLAT;
+    else if (globalView == "hierarchical")
+      this->Internals->GlobalViewMode = DataAdaptor::GLOBAL_VIEW_HIERARCHICAL;
+    else
+      {
+      SENSEI_ERROR("Invalid global_view \"" << globalView
+        << "\". Use flat or hierarchical")
+      MPI_Abort(this->GetCommunicator(), -1);
+      }
+    }
 
-  std::string plots, plotVars;
-  double origin[3] = {0.,0.,0.};
-  double normal[3] = {1.,0.,0.};
-  bool slice = false, project = false;
+  // arrays derived from the simulation's, served through the cache
+  for (pugi::xml_node node = root.child("derived");
+    node; node = node.next_sibling("derived"))
+    {
+    if (this->Internals->Derived.Initialize(node))
+      {
+      SENSEI_ERROR("Failed to initialize the derived arrays")
+      return -1;
+      }
+    }
 
-  std::string session;
-  if(node.attribute("session") != NULL)
-    session = node.attribute("session").value();
+  // choose the analyses to run each step to keep the time spent in situ
+  // within the given fraction of the step time
+  this->Internals->Budget = root.attribute("budget").as_double(0.0);
+  this->Internals->BudgetWindow = root.attribute("budget_window").as_int(10);
+
+  // bound the memory used in situ by the analyses, writers and
+  // prefetchers of this process. the reserve is kept for the simulation
+  MemoryGovernor &governor = MemoryGovernor::GetGlobalGovernor();
+  if (root.attribute("memory_budget"))
+    governor.SetLimit(1024ll*1024ll*root.attribute("memory_budget").as_llong(0));
+
+  if (root.attribute("memory_reserve"))
+    governor.SetReserve(1024ll*1024ll*root.attribute("memory_reserve").as_llong(0));
+
+  if (root.attribute("spill_dir"))
+    governor.SetSpillDirectory(root.attribute("spill_dir").as_string());
+
+  // back-ends that are expensive to start may be initialized on first use,
+  // optionally in the background while the simulation starts
+  int lazyInit = root.attribute("lazy_init").as_int(0);
+  int prewarm = root.attribute("prewarm").as_int(0);
+
+  // when split into groups the analyses of the other groups run on other
+  // ranks. those that name no group belong to the first
+  std::string defaultGroup = root.child("group").attribute("name").as_string("");
+  const std::string &group = this->Internals->Group;
+
+  // the configuration of analyses that are placed may be shared by the
+  // simulation and the end point. the end point runs those that may be
+  // placed in transit, but not those placed in situ nor the transports
+  // that ship it the data
+  std::set<std::string> transports;
+  if (this->Internals->EndPoint)
+    {
+    for (pugi::xml_node node = root.child("analysis");
+      node; node = node.next_sibling("analysis"))
+      {
+      if (node.attribute("enabled").as_int(0) && node.attribute("placement") &&
+        (std::string(node.attribute("placement").value()) != "in_situ"))
+        transports.insert(node.attribute("transport").as_string(""));
+      }
+    }
 
-  if(node.attribute("plots") != NULL)
-    plots = node.attribute("plots").value();
+  // create and configure analysis adaptors
+  for (pugi::xml_node node = root.child("analysis");
+    node; node = node.next_sibling("analysis"))
+    {
+    if (!node.attribute("enabled").as_int(0) || (!group.empty() &&
+      (group != node.attribute("group").as_string(defaultGroup.c_str()))))
+      continue;
 
-  if(node.attribute("plotvars") != NULL)
-    plotVars = node.attribute("plotvars").value();
+    if (this->Internals->EndPoint &&
+      (std::string(node.attribute("placement").as_string("")) == "in_situ"))
+      continue;
 
-  if(node.attribute("slice-origin") != NULL)
-    {
-    double tmp[3];
-    if(sscanf(node.attribute("slice-origin").value(),
-       "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3)
+    std::string type = node.attribute("type").value();
+
+    // the initialization of these back-ends does not depend on the XML
+    this->Internals->LazyInit = node.attribute("lazy_init").as_int(lazyInit) &&
+      ((type == "ascent") || (type == "catalyst") || (type == "libsim") ||
+      (type == "python"));
+
+    if (!(((type == "histogram") && !this->Internals->AddHistogram(node))
+      || ((type == "statistics") && !this->Internals->AddStatistics(node))
+      || ((type == "temporal_statistics") && !this->Internals->AddTemporalStatistics(node))
+      || ((type == "extremes") && !this->Internals->AddExtremes(node))
+      || ((type == "connected_components") && !this->Internals->AddConnectedComponents(node))
+      || ((type == "deposition") && !this->Internals->AddParticleDeposition(node))
+      || ((type == "particle_tracer") && !this->Internals->AddParticleTracer(node))
+      || ((type == "autocorrelation") && !this->Internals->AddAutoCorrelation(node))
+      || ((type == "adios1") && !this->Internals->AddAdios1(node))
+      || ((type == "adios2") && !this->Internals->AddAdios2(node))
+      || ((type == "ascent") && !this->Internals->AddAscent(node))
+      || ((type == "catalyst") && !this->Internals->AddCatalyst(node))
+      || ((type == "catalyst2") && !this->Internals->AddCatalyst2(node))
+      || ((type == "hdf5") && !this->Internals->AddHDF5(node))
+      || ((type == "mpi") && !this->Internals->AddMPI(node))
+      || ((type == "libsim") && !this->Internals->AddLibsim(node))
+      || ((type == "PosthocIO") && !this->Internals->AddPosthocIO(node))
+      || ((type == "VTKAmrWriter") && !this->Internals->AddVTKAmrWriter(node))
+      || ((type == "vtkmcontour") && !this->Internals->AddVTKmContour(node))
+      || ((type == "vtkmhaar") && !this->Internals->AddVTKmVolumeReduction(node))
+      || ((type == "cdf") && !this->Internals->AddVTKmCDF(node))
+      || ((type == "vtkmhistogram") && !this->Internals->AddVTKmHistogram(node))
+      || ((type == "python") && !this->Internals->AddPythonAnalysis(node))
+      || ((type == "SliceExtract") && !this->Internals->AddSliceExtract(node))))
       {
-      slice = true;
-      origin[0] = tmp[0];
-      origin[1] = tmp[1];
-      origin[2] = tmp[2];
+      SENSEI_ERROR("Failed to add \"" << type << "\" analysis")
+      MPI_Abort(this->GetCommunicator(), -1);
+      }
+
+    if (this->Internals->ConfigureExecution(node))
+      {
+      SENSEI_ERROR("Failed to configure execution of \"" << type << "\" analysis")
+      MPI_Abort(this->GetCommunicator(), -1);
       }
     }
-  if(node.attribute("slice-normal") != NULL)
-    {
-    double tmp[3];
-    if(sscanf(node.attribute("slice-normal").value(),
-      "%lg,%lg,%lg", &tmp[0], &tmp[1], &tmp[2]) == 3)
+
+  this->Internals->LazyInit = false;
+
+  // create and configure transport analysis adaptors
+  for (pugi::xml_node node = root.child("transport");
+    node; node = node.next_sibling("transport"))
     {
-      slice = true;
-      normal[0] = tmp[0];
-      normal[1] = tmp[1];
-      normal[2] = tmp[2];
+    if (!node.attribute("enabled").as_int(0) || (!group.empty() &&
+      (group != node.attribute("group").as_string(defaultGroup.c_str()))))
+      continue;
+
+    if (this->Internals->EndPoint &&
+      transports.count(node.attribute("name").as_string("")))
+      continue;
+
+    std::string type = node.attribute("type").value();
+    if (!(((type == "adios1") && !this->Internals->AddAdios1(node))
+      || ((type == "adios2") && !this->Internals->AddAdios2(node))
+      || ((type == "hdf5") && !this->Internals->AddHDF5(node))
+      || ((type == "mpi") && !this->Internals->AddMPI(node))))
+      {
+      SENSEI_ERROR("Failed to add \"" << type << "\" transport")
+      MPI_Abort(this->GetCommunicator(), -1);
+      }
+
+    if (this->Internals->ConfigureExecution(node))
+      {
+      SENSEI_ERROR("Failed to configure execution of \"" << type << "\" transport")
+      MPI_Abort(this->GetCommunicator(), -1);
       }
     }
 
-  if(node.attribute("slice-project") != NULL)
-    project = node.attribute("slice-project").as_int() != 0;
-
-  if(doExport)
-  {
-    // Add the export that we want to make.
-    if(!this->LibsimAdaptor->AddExport(frequency, session, plots, plotVars,
-      slice, project, origin, normal, filename))
-      return -2;
+  if (this->Internals->ConfigurePlacement())
+    {
+    SENSEI_ERROR("Failed to configure the placement of the analyses")
+    MPI_Abort(this->GetCommunicator(), -1);
+    }
 
-    SENSEI_STATUS("configured LibsimAnalysisAdaptor export")
-  }
-  else
-  {
-    // Add the image that we want to make.
-    if(!this->LibsimAdaptor->AddRender(frequency, session, plots, plotVars,
-      slice, project, origin, normal, imageProps))
-      return -2;
+  this->Internals->ReportStartup(this->GetCommunicator());
 
-    SENSEI_STATUS("configured LibsimAnalysisAdaptor render")
-  }
+  // the deferred initialization makes MPI calls from the background thread
+  if (prewarm)
+    {
+    if (MPIUtils::HaveThreadLevel(MPI_THREAD_MULTIPLE))
+      this->Internals->StartPrewarm();
+    else
+      SENSEI_WARNING("Prewarming requires MPI_THREAD_MULTIPLE. Analyses"
+        " will be initialized at their first execution")
+    }
 
-#endif
   return 0;
 }
 
-// --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddAutoCorrelation(pugi::xml_node node)
+//----------------------------------------------------------------------------
+int ConfigurableAnalysis::SplitGroups(MPI_Comm comm,
+  const pugi::xml_node &root, MPI_Comm &groupComm, std::string &groupName)
 {
-  if (XMLUtils::RequireAttribute(node, "mesh") || XMLUtils::RequireAttribute(node, "array"))
+  groupComm = MPI_COMM_NULL;
+  groupName.clear();
+
+  std::vector<std::string> names;
+  std::vector<int> counts;
+  std::vector<double> weights;
+  for (pugi::xml_node node = root.child("group");
+    node; node = node.next_sibling("group"))
     {
-    SENSEI_ERROR("Failed to initialize Autocorrelation");
-    return -1;
+    std::string name = node.attribute("name").as_string("");
+    if (name.empty() ||
+      (std::find(names.begin(), names.end(), name) != names.end()))
+      {
+      SENSEI_ERROR("Each group must have a unique name")
+      return -1;
+      }
+
+    names.push_back(name);
+    counts.push_back(node.attribute("ranks").as_int(0));
+    weights.push_back(node.attribute("ranks") ? 0.0 :
+      node.attribute("fraction").as_double(1.0));
+
+    if ((node.attribute("ranks") && (counts.back() < 1)) ||
+      (!node.attribute("ranks") && (weights.back() <= 0.0)))
+      {
+      SENSEI_ERROR("Group \"" << name << "\" must have a positive number"
+        " of ranks or fraction")
+      return -1;
+      }
     }
 
-  std::string meshName = node.attribute("mesh").value();
-  std::string arrayName = node.attribute("array").value();
+  int nGroups = names.size();
+  if (nGroups == 0)
+    return 0;
 
-  std::string assocStr = node.attribute("association").as_string("point");
-  int assoc = 0;
-  if (VTKUtils::GetAssociation(assocStr, assoc))
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  // the groups given a number of ranks are served first, the others share
+  // the rest
+  int nShared = nRanks;
+  int nWeighted = 0;
+  double totalWeight = 0.0;
+  for (int i = 0; i < nGroups; ++i)
     {
-    SENSEI_ERROR("Failed to initialize Autocorrelation");
+    if (weights[i] > 0.0)
+      {
+      totalWeight += weights[i];
+      nWeighted += 1;
+      }
+    else
+      {
+      nShared -= counts[i];
+      }
+    }
+
+  if ((nShared < nWeighted) || ((nWeighted == 0) && (nShared != 0)))
+    {
+    SENSEI_ERROR("The " << nRanks << " ranks can not be split between the "
+      << nGroups << " groups as configured")
     return -1;
     }
 
-  int window = node.attribute("window").as_int(10);
-  int kMax = node.attribute("k-max").as_int(3);
-  int numThreads = node.attribute("n-threads").as_int(1);
+  // the shared ranks are divided in proportion by rounding the cumulative
+  // share, so that they add up, leaving at least one for each group
+  double share = 0.0;
+  int assigned = 0;
+  int left = nWeighted;
+  for (int i = 0; i < nGroups; ++i)
+    {
+    if (weights[i] <= 0.0)
+      continue;
 
-  auto adaptor = vtkSmartPointer<Autocorrelation>::New();
+    share += weights[i];
+    left -= 1;
 
-  if (this->Comm != MPI_COMM_NULL)
-    adaptor->SetCommunicator(this->Comm);
+    int end = std::min(int(std::round(nShared*share/totalWeight)),
+      nShared - left);
 
-  this->TimeInitialization(adaptor, [&]() {
-    adaptor->Initialize(window, meshName, assoc, arrayName, kMax);
-    return 0;
-  });
+    counts[i] = std::max(1, end - assigned);
+    assigned += counts[i];
+    }
 
-  this->Analyses.push_back(adaptor.GetPointer());
+  // the ranks of a group are contiguous
+  int color = 0;
+  int first = 0;
+  for (int i = 0; i < nGroups; first += counts[i], ++i)
+    {
+    if ((rank >= first) && (rank < first + counts[i]))
+      color = i;
 
-  SENSEI_STATUS("Configured Autocorrelation " << assocStr
-    << " data array \"" << arrayName << "\" on mesh \"" << meshName
-    << "\" window " << window << " k-max " << kMax
-    << " n-threads " << numThreads)
+    SENSEI_STATUS("Group \"" << names[i] << "\" runs on ranks " << first
+      << " to " << first + counts[i] - 1)
+    }
+
+  MPI_Comm_split(comm, color, rank, &groupComm);
+  groupName = names[color];
 
   return 0;
 }
 
-// --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddPosthocIO(pugi::xml_node node)
+//----------------------------------------------------------------------------
+void ConfigurableAnalysis::SetGroup(const std::string &name)
 {
-#ifndef ENABLE_VTK_IO
-  (void)node;
-  SENSEI_ERROR("VTK I/O was requested but is disabled in this build")
-  return -1;
-#else
-  DataRequirements req;
-  if (req.Initialize(node))
-    {
-    SENSEI_ERROR("Failed to initialize VTKPosthocIO.")
+  this->Internals->Group = name;
+}
+
+//----------------------------------------------------------------------------
+void ConfigurableAnalysis::SetEndPoint(int val)
+{
+  this->Internals->EndPoint = val;
+}
+
+//----------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::ScheduleNext(MPI_Comm comm)
+{
+  if (this->HaveNextRun)
+    return 0;
+
+  if (this->Schedule(comm, this->NextRun))
     return -1;
-    }
 
-  std::string outputDir = node.attribute("output_dir").as_string("./");
-  std::string fileName = node.attribute("file_name").as_string("data");
-  std::string mode = node.attribute("mode").as_string("visit");
-  std::string writer = node.attribute("writer").as_string("xml");
-  std::string ghostArrayName = node.attribute("ghost_array_name").as_string("");
-  int verbose = node.attribute("verbose").as_int(0);
+  this->HaveNextRun = true;
+  return 0;
+}
 
-  auto adaptor = vtkSmartPointer<VTKPosthocIO>::New();
+//----------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::GetTriggerRange(DataAdaptor *data,
+  const std::string &meshName, const std::string &arrayName, int association,
+  double range[2])
+{
+  // the metadata is fetched once per step and shared by the triggers
+  if (!this->HaveTriggerMetadata)
+    {
+    MeshMetadataFlags flags;
+    flags.SetBlockArrayRange();
 
-  if (this->Comm != MPI_COMM_NULL)
-    adaptor->SetCommunicator(this->Comm);
+    if (this->TriggerMetadata.Initialize(data, flags))
+      {
+      SENSEI_ERROR("Failed to get metadata")
+      return -1;
+      }
 
-  adaptor->SetGhostArrayName(ghostArrayName);
-  adaptor->SetVerbose(verbose);
+    this->HaveTriggerMetadata = true;
+    }
 
-  if (adaptor->SetOutputDir(outputDir) || adaptor->SetMode(mode) ||
-    adaptor->SetWriter(writer) || adaptor->SetDataRequirements(req))
+  MeshMetadataPtr md;
+  if (this->TriggerMetadata.GetGlobalMeshMetadata(meshName, md))
     {
-    SENSEI_ERROR("Failed to initialize the VTKPosthocIO analysis")
+    SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
     return -1;
     }
 
-  this->TimeInitialization(adaptor);
-  this->Analyses.push_back(adaptor.GetPointer());
+  unsigned int nArrays = md->ArrayName.size();
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    if ((md->ArrayName[i] != arrayName) ||
+      ((association >= 0) && (md->ArrayCentering[i] != association)))
+      continue;
 
-  SENSEI_STATUS("Configured VTKPosthocIO")
+    if (i >= md->ArrayRange.size())
+      {
+      SENSEI_ERROR("No range was provided for array \"" << arrayName
+        << "\" on mesh \"" << meshName << "\"")
+      return -1;
+      }
 
-  return 0;
-#endif
+    range[0] = md->ArrayRange[i][0];
+    range[1] = md->ArrayRange[i][1];
+    return 0;
+    }
+
+  SENSEI_ERROR("No array \"" << arrayName << "\" on mesh \"" << meshName << "\"")
+  return -1;
 }
 
-// --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddVTKAmrWriter(pugi::xml_node node)
+//----------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::GetTriggerTail(MPI_Comm comm,
+  const std::string &name, double value, double &fraction)
 {
-#if !defined(ENABLE_VTK_IO) || !defined(ENABLE_VTK_MPI)
-  (void)node;
-  SENSEI_ERROR("VTK AMR Writer was requested but is disabled in this build")
-  return -1;
-#else
-  DataRequirements req;
+  fraction = 0.0;
 
-  if (req.Initialize(node))
+  unsigned int nAnalyses = this->Analyses.size();
+  unsigned int ai = 0;
+  while ((ai < nAnalyses) && (this->Controls[ai].Cost.Name != name))
+    ++ai;
+
+  Histogram *hist = ai < nAnalyses ?
+    dynamic_cast<Histogram*>(this->Analyses[ai].GetPointer()) : nullptr;
+
+  if (!hist)
     {
-    SENSEI_ERROR("Failed to initialize VTKAmrWriter.")
+    SENSEI_ERROR("No histogram analysis named \"" << name << "\"")
     return -1;
     }
 
-  std::string outputDir = node.attribute("output_dir").as_string("./");
-  std::string fileName = node.attribute("file_name").as_string("data");
-  std::string mode = node.attribute("mode").as_string("visit");
-
-  auto adapter = vtkSmartPointer<VTKAmrWriter>::New();
+  // the result of a background execution is used once it completes
+  if (this->Wait(ai))
+    return -1;
 
-  if (this->Comm != MPI_COMM_NULL)
-    adapter->SetCommunicator(this->Comm);
+  // the histogram is held by rank 0. before the first execution there
+  // is none and the tail is empty
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
 
-  if (adapter->SetOutputDir(outputDir) || adapter->SetMode(mode) ||
-    adapter->SetDataRequirements(req) ||
-    this->TimeInitialization(adapter, [&]() { return adapter->Initialize(); }))
+  double min = 0.0;
+  double max = 0.0;
+  std::vector<unsigned int> bins;
+  if ((rank == 0) && !hist->GetHistogram(min, max, bins) && !bins.empty())
     {
-    SENSEI_ERROR("Failed to initialize the VTKAmrWriter analysis")
-    return -1;
-    }
+    double width = (max - min)/bins.size();
+    double total = 0.0;
+    double tail = 0.0;
 
-  this->TimeInitialization(adapter);
-  this->Analyses.push_back(adapter.GetPointer());
+    unsigned int nBins = bins.size();
+    for (unsigned int i = 0; i < nBins; ++i)
+      {
+      double lo = min + i*width;
+      double hi = lo + width;
 
-  SENSEI_STATUS("Configured VTKAmrWriter")
+      total += bins[i];
+
+      // the part of a bin above the value is counted in proportion
+      if (lo >= value)
+        tail += bins[i];
+      else if (hi > value)
+        tail += bins[i]*(hi - value)/width;
+      }
+
+    fraction = total > 0.0 ? tail/total : 0.0;
+    }
+
+  MPI_Bcast(&fraction, 1, MPI_DOUBLE, 0, comm);
 
   return 0;
-#endif
 }
 
-// --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddPythonAnalysis(pugi::xml_node node)
+//----------------------------------------------------------------------------
+int ConfigurableAnalysis::InternalsType::EvaluateTrigger(MPI_Comm comm,
+  unsigned int i, DataAdaptor *data, long step, double time, bool &fire)
 {
-#if !defined(ENABLE_PYTHON)
-  (void)node;
-  SENSEI_ERROR("The PythonAnalysis was requested but is disabled in this build")
-  return -1;
-#else
-  if (!node.attribute("script_file") && !node.attribute("script_module"))
-    {
-    SENSEI_ERROR("Failed to initialize PythonAnalysis. Missing "
-      "a required attribute: script_file or script_module");
-    return -1;
-    }
+  fire = true;
 
-  std::string scriptFile = node.attribute("script_file").value();
-  std::string scriptModule = node.attribute("script_module").value();
+  const AnalysisTrigger &trigger = this->Controls[i].Trigger;
+  if (trigger.Empty() || (!data && trigger.UsesData()))
+    return 0;
 
-  std::string initSource;
-  pugi::xml_node inode = node.child("initialize_source");
-  if (inode)
-    initSource = inode.text().as_string();
+  TimeEvent<128> mark("ConfigurableAnalysis::EvaluateTrigger");
 
-  auto pyAnalysis = vtkSmartPointer<PythonAnalysis>::New();
+  AnalysisTrigger::Context ctx;
+  ctx.Step = step;
+  ctx.Time = time;
 
-  if (this->Comm != MPI_COMM_NULL)
-    pyAnalysis->SetCommunicator(this->Comm);
+  ctx.Range = [this, data](const std::string &meshName,
+    const std::string &arrayName, int association, double range[2]) -> int
+    {
+    return this->GetTriggerRange(data, meshName, arrayName,
+      association, range);
+    };
 
-  pyAnalysis->SetScriptFile(scriptFile);
-  pyAnalysis->SetScriptModule(scriptModule);
-  pyAnalysis->SetInitializeSource(initSource);
+  ctx.Tail = [this, comm](const std::string &name, double value,
+    double &fraction) -> int
+    {
+    return this->GetTriggerTail(comm, name, value, fraction);
+    };
 
-  if (this->TimeInitialization(pyAnalysis, [&]() {
-      return pyAnalysis->Initialize(); }))
+  if (trigger.Evaluate(ctx, fire))
     {
-    SENSEI_ERROR("Failed to initialize PythonAnalysis")
+    SENSEI_ERROR("Failed to evaluate the trigger of \""
+      << this->Controls[i].Cost.Name << "\"")
     return -1;
     }
-  this->Analyses.push_back(pyAnalysis);
-
-  const char *scriptType = scriptFile.empty() ? "module" : "file";
-
-  const char *scriptName =
-    scriptFile.empty() ?  scriptModule.c_str() : scriptFile.c_str();
-
-  SENSEI_STATUS("Configured python with " << scriptType
-    << " \"" << scriptName << "\"")
 
   return 0;
-#endif
 }
 
-// --------------------------------------------------------------------------
-int ConfigurableAnalysis::InternalsType::AddSliceExtract(pugi::xml_node node)
+//----------------------------------------------------------------------------
+bool ConfigurableAnalysis::Execute(DataAdaptor* data)
 {
-#ifndef ENABLE_SLICE_EXTRACT
-  (void)node;
-  SENSEI_ERROR("SliceExtract requested but is disabled in this build")
-  return -1;
-#else
+  TimeEvent<128> event("ConfigurableAnalysis::Execute");
 
-  std::ostringstream oss;
-  oss << "Configured SliceExtract ";
+  std::chrono::steady_clock::time_point startTime =
+    std::chrono::steady_clock::now();
 
-  // initialize the slice extract
-  auto adaptor = vtkSmartPointer<SliceExtract>::New();
+  std::vector<unsigned int> ids;
 
-  if (this->Comm != MPI_COMM_NULL)
-    adaptor->SetCommunicator(this->Comm);
+  unsigned int nAnalyses = this->Internals->Analyses.size();
 
-  // parse data requirements
-  DataRequirements req;
-  if (req.Initialize(node) || adaptor->SetDataRequirements(req))
-    return -1;
+  // initialization started in the background must complete first
+  if (this->Internals->WaitPrewarm())
+    MPI_Abort(this->GetCommunicator(), -1);
+
+  // the step may have been scheduled when the requirements were queried
+  std::vector<bool> run;
+  if (this->Internals->HaveNextRun)
+    {
+    run.swap(this->Internals->NextRun);
+    this->Internals->HaveNextRun = false;
+    }
+  else if (this->Internals->Schedule(this->GetCommunicator(), run))
+    {
+    SENSEI_ERROR("Failed to schedule the analyses")
+    MPI_Abort(this->GetCommunicator(), -1);
+    }
+
+  if (this->Internals->GlobalViewMode >= 0)
+    data->SetGlobalViewMode(this->Internals->GlobalViewMode);
+
+  // an in transit adaptor reads only the data the analyses access
+  if (InTransitDataAdaptor *inTransit = dynamic_cast<InTransitDataAdaptor*>(data))
+    {
+    if (this->Internals->PushRequirements(inTransit))
+      {
+      SENSEI_ERROR("Failed to set the data requirements of the transport")
+      MPI_Abort(this->GetCommunicator(), -1);
+      }
+    }
+
+  // serve the data from the cache when more than one analysis will access
+  // it, or when there are derived arrays, which the cache computes. in
+  // transit adaptors are not wrapped since analyses make use of their
+  // control API
+  CachingDataAdaptor *cache = nullptr;
+  bool derived = !this->Internals->Derived.Empty();
+  if (((this->Internals->CacheData && (nAnalyses > 1)) || derived) &&
+    !dynamic_cast<InTransitDataAdaptor*>(data))
+    {
+    if (!this->Internals->Cache)
+      this->Internals->Cache = vtkSmartPointer<CachingDataAdaptor>::New();
+
+    cache = this->Internals->Cache;
+    cache->SetDerivedFields(derived ? &this->Internals->Derived : nullptr);
+    cache->SetDataAdaptor(data);
+    data = cache;
+    }
+
+  // serve the partial results of the analyses with a local phase to the
+  // transports that run after them
+  PartialResultsDataAdaptor *partials = nullptr;
+  if (this->Internals->HavePartialResults)
+    {
+    if (!this->Internals->PartialResults)
+      this->Internals->PartialResults =
+        vtkSmartPointer<PartialResultsDataAdaptor>::New();
+
+    partials = this->Internals->PartialResults;
+    partials->SetDataAdaptor(data);
+    partials->SetGlobalViewMode(data->GetGlobalViewMode());
+    data = partials;
+    }
+
+  // analyses that run only where there is data
+  if (this->Internals->UpdateDataRanks(this->GetCommunicator(), data, run))
+    MPI_Abort(this->GetCommunicator(), -1);
+
+  // analyses run in situ or in transit
+  if (this->Internals->Place(this->GetCommunicator(), data, run))
+    {
+    SENSEI_ERROR("Failed to place the analyses")
+    MPI_Abort(this->GetCommunicator(), -1);
+    }
 
-  // parse writer parameters
-  pugi::xml_node writerNode = node.child("writer");
-  if (writerNode)
+  for (unsigned int ai = 0; ai < nAnalyses; ++ai)
     {
-    std::string outputDir = writerNode.attribute("output_dir").as_string("./");
-    std::string mode = writerNode.attribute("mode").as_string("visit");
-    std::string writer = writerNode.attribute("writer").as_string("xml");
+    InternalsType::ExecutionControl &control = this->Internals->Controls[ai];
 
-    if (adaptor->SetWriterOutputDir(outputDir) || adaptor->SetWriterMode(mode) ||
-      adaptor->SetWriterWriter(writer))
-      return -1;
+    // the analysis does not fit in this step's budget, or it is run
+    // once on the whole batch
+    if (!run[ai] || (!this->Internals->Batched.empty() &&
+      this->Internals->Batched[ai]))
+      continue;
 
-    oss << " writer.mode=" << mode << " writer.outputDir=" << outputDir
-      << " writer.writer=" << writer;
-    }
+    // the analysis runs on the other side of the transport this step
+    if (control.PlacedElsewhere)
+      continue;
 
-  // operation specific parsing
-  if (XMLUtils::RequireAttribute(node, "operation"))
-    return -1;
+    // an analysis with a trigger runs only in the steps in which it fires
+    bool fire = true;
+    if (this->Internals->EvaluateTrigger(this->GetCommunicator(), ai, data,
+      data->GetDataTimeStep(), data->GetDataTime(), fire))
+      MPI_Abort(this->GetCommunicator(), -1);
 
-  std::string operation = node.attribute("operation").as_string();
+    if (!fire)
+      continue;
 
-  if (adaptor->SetOperation(operation))
-    return -1;
+    // an analysis configured for lazy initialization is initialized
+    // before its first execution
+    if (this->Internals->InitializeAnalysis(ai))
+      MPI_Abort(this->GetCommunicator(), -1);
 
-  oss << " operation=" << operation;
+    // the ranks without data are done with the analysis
+    if (control.DataRanks && !control.Owner)
+      continue;
 
-  if (operation == "planar_slice")
-    {
-    // parse point and normal
-    pugi::xml_node pointNode = node.child("point");
-    if (pointNode)
+    // launch the asynchronous analysis, it runs in the background
+    if (control.Async)
       {
-      std::array<double,3> point{0.0,0.0,0.0};
-      if (XMLUtils::ParseNumeric(node.child("point"), point) ||
-        adaptor->SetPoint(point))
-        return -1;
-
-      oss << " point=" << point;
+      if (this->Internals->ExecuteAsynchronous(ai,
+        this->Internals->GetAnalysisData(ai, data)))
+        MPI_Abort(this->GetCommunicator(), -1);
+      continue;
       }
 
-    pugi::xml_node normalNode = node.child("normal");
-    if (normalNode)
+    // collect the analyses to run concurrently
+    if (this->Internals->Concurrent)
       {
-      std::array<double,3> normal{0.0,0.0,0.0};
-      if (XMLUtils::ParseNumeric(node.child("normal"), normal) ||
-        adaptor->SetNormal(normal))
-        return -1;
+      ids.push_back(ai);
+      continue;
+      }
 
-      oss << " normal=" << normal;
+    // an analysis that has a communicator of its own makes collective
+    // calls through its own adaptor
+    DataAdaptor *da = this->Internals->GetAnalysisData(ai, data);
+    if (control.Data)
+      {
+      if ((control.SnapshotAll && control.Requirements.Initialize(da, false)) ||
+        this->Internals->Snapshot(da, control.Requirements, control.Data, false))
+        {
+        SENSEI_ERROR("Failed to get the data required by "
+          << this->Internals->Analyses[ai]->GetClassName())
+        MPI_Abort(this->GetCommunicator(), -1);
+        }
+      da = control.Data;
       }
+
+    if (this->Internals->ExecuteSynchronous(ai, da))
+      MPI_Abort(this->GetCommunicator(), -1);
+
+    if (control.Data)
+      control.Data->ReleaseData();
     }
-  else if (operation == "iso_surface")
-    {
-    // parse iso values parameters
-    if (XMLUtils::RequireChild(node, "iso_values"))
-      return -1;
 
-    pugi::xml_node valsNode = node.child("iso_values");
+  if (!ids.empty() && this->Internals->ExecuteConcurrent(data, ids))
+    MPI_Abort(this->GetCommunicator(), -1);
 
-    std::vector<double> isoVals;
-    if (XMLUtils::ParseNumeric(valsNode, isoVals))
-      return -1;
+  // the simulation is free to release its data once we return
+  for (unsigned int ai = 0; ai < nAnalyses; ++ai)
+    {
+    InternalsType::ExecutionControl &control = this->Internals->Controls[ai];
 
-    if (XMLUtils::RequireAttribute(valsNode, "mesh_name") ||
-      XMLUtils::RequireAttribute(valsNode, "array_name") ||
-      XMLUtils::RequireAttribute(valsNode, "array_centering"))
-      return -1;
+    if (control.Sort)
+      control.Sort->Clear();
 
-    std::string meshName = valsNode.attribute("mesh_name").as_string();
-    std::string arrayName = valsNode.attribute("array_name").as_string();
-    std::string arrayCenStr = valsNode.attribute("array_centering").as_string();
+    if (control.Subsample)
+      control.Subsample->Clear();
+    }
 
-    int arrayCen = 0;
-    if (VTKUtils::GetAssociation(arrayCenStr.c_str(), arrayCen))
-      return -1;
+  if (partials)
+    partials->Clear();
 
-    adaptor->SetIsoValues(meshName, arrayName, arrayCen, isoVals);
+  if (cache)
+    cache->Clear();
 
-    oss << " mesh_name=" << meshName << " array_name=" << arrayName
-      << " array_centering=" << arrayCenStr << " iso_values=" << isoVals;
+  // the metadata of meshes that change is fetched anew next step
+  data->ClearTransientMeshMetadata();
+
+  if (this->Internals->HaveTriggerMetadata)
+    {
+    this->Internals->TriggerMetadata.Clear();
+    this->Internals->HaveTriggerMetadata = false;
     }
-  else
+
+  // write the profile collected so far
+  Profiler::Checkpoint();
+
+  if (this->Internals->Budget > 0.0)
     {
-    SENSEI_ERROR("Invalid operation \"" << operation << "\"")
-    return -1;
+    this->Internals->LastExecuteEnd = std::chrono::steady_clock::now();
+    this->Internals->LastExecuteTime = std::chrono::duration<double>(
+      this->Internals->LastExecuteEnd - startTime).count();
+    this->Internals->HaveLastExecute = true;
     }
 
-  // get other settings
-  int enablePart = node.attribute("enable_partitioner").as_int(1);
-  adaptor->EnablePartitioner(enablePart);
-  oss << " enable_partitioner=" <<  enablePart;
+  return true;
+}
 
-  int verbose = node.attribute("verbose").as_int(0);
-  adaptor->SetVerbose(verbose);
-  oss << " verbose=" << verbose;
+//----------------------------------------------------------------------------
+bool ConfigurableAnalysis::ExecuteBatch(const std::vector<DataAdaptor*> &steps)
+{
+  TimeEvent<128> event("ConfigurableAnalysis::ExecuteBatch");
 
-  // call intialize and add to the pipeline
-  this->TimeInitialization(adaptor);
-  this->Analyses.push_back(adaptor.GetPointer());
+  unsigned int nSteps = steps.size();
+  unsigned int nAnalyses = this->Internals->Analyses.size();
 
-  SENSEI_STATUS(<< oss.str())
+  if (!nSteps)
+    return true;
 
-  return 0;
-#endif
-}
+  // asynchronous analyses work on their own copy of each step and are
+  // left to the per-step execution, as are those that are placed, since
+  // the placement may differ from step to step
+  std::vector<bool> batched(nAnalyses, false);
+  bool anyBatched = false;
+  for (unsigned int ai = 0; ai < nAnalyses; ++ai)
+    {
+    batched[ai] = !this->Internals->Controls[ai].Async &&
+      !this->Internals->Controls[ai].DataRanks &&
+      !this->Internals->Controls[ai].Placement.Enabled() &&
+      this->Internals->Analyses[ai]->AcceptsBatches();
+    anyBatched |= batched[ai];
+    }
 
+  if (!anyBatched)
+    return this->Superclass::ExecuteBatch(steps);
 
+  // the others see the steps one at a time, as they would in situ
+  this->Internals->Batched = batched;
+  for (unsigned int i = 0; i < nSteps; ++i)
+    this->Execute(steps[i]);
+  this->Internals->Batched.clear();
+
+  // the time budget is applied per step and so is not used here
+  for (unsigned int ai = 0; ai < nAnalyses; ++ai)
+    {
+    if (!batched[ai])
+      continue;
 
+    if (this->Internals->InitializeAnalysis(ai) ||
+      this->Internals->ExecuteBatch(ai, steps))
+      MPI_Abort(this->GetCommunicator(), -1);
+    }
 
-//----------------------------------------------------------------------------
-senseiNewMacro(ConfigurableAnalysis);
+  Profiler::Checkpoint();
 
-//----------------------------------------------------------------------------
-ConfigurableAnalysis::ConfigurableAnalysis()
-  : Internals(new ConfigurableAnalysis::InternalsType())
-{
+  return true;
 }
 
 //----------------------------------------------------------------------------
-ConfigurableAnalysis::~ConfigurableAnalysis()
+int ConfigurableAnalysis::ReceiveResult(std::string &tag, std::string &result)
 {
-  delete this->Internals;
+  unsigned int nAnalyses = this->Internals->Analyses.size();
+  for (unsigned int i = 0; i < nAnalyses; ++i)
+    {
+    int ierr = this->Internals->Analyses[i]->ReceiveResult(tag, result);
+    if (ierr != 1)
+      return ierr;
+    }
+
+  return 1;
 }
 
 //----------------------------------------------------------------------------
-int ConfigurableAnalysis::SetCommunicator(MPI_Comm comm)
+int ConfigurableAnalysis::Finalize()
 {
-  this->AnalysisAdaptor::SetCommunicator(comm);
+  TimeEvent<128> event("ConfigurableAnalysis::Finalize");
 
-  // save the communicator for use with adaptors created
-  // during XML parsing
-  this->Internals->Comm = comm;
+  if (this->Internals->WaitPrewarm())
+    MPI_Abort(this->GetCommunicator(), -1);
 
-  // set the communicator on existing adaptors, if there are any
+  int ai = 0;
   AnalysisAdaptorVector::iterator iter = this->Internals->Analyses.begin();
   AnalysisAdaptorVector::iterator end = this->Internals->Analyses.end();
+  for (; iter != end; ++iter, ++ai)
+    {
+    // let asynchronous analyses complete the last step
+    if (this->Internals->Wait(ai))
+      MPI_Abort(this->GetCommunicator(), -1);
 
-  for (; iter != end; ++iter)
-    (*iter)->SetCommunicator(comm);
+    InternalsType::ExecutionControl &control = this->Internals->Controls[ai];
+    if (control.Data)
+      control.Data->ReleaseData();
 
-  return 0;
-}
+    MemoryGovernor::GetGlobalGovernor().Unregister(control.MemoryConsumer);
+    control.MemoryConsumer = -1;
+    control.MemoryGranted = 0;
 
+    // all ranks take part in finalization
+    if (control.Split)
+      {
+      (*iter)->SetCommunicator(this->GetCommunicator());
+      if (control.Data)
+        control.Data->SetCommunicator(this->GetCommunicator());
+      control.Split = false;
+      control.Owner = -1;
+      }
 
-//----------------------------------------------------------------------------
-int ConfigurableAnalysis::Initialize(const std::string& filename)
-{
-  TimeEvent<128> event("ConfigurableAnalysis::Initialize");
+    // an analysis that was never initialized has nothing to finalize
+    if ((ai < int(this->Internals->Startup.size())) &&
+      !this->Internals->Startup[ai].Initialized)
+      continue;
 
-  pugi::xml_document doc;
-  if (XMLUtils::Parse(this->GetCommunicator(), filename, doc))
-    {
-    SENSEI_ERROR("Failed to load, parse, and share XML configuration")
-    MPI_Abort(this->GetCommunicator(), -1);
-    return -1;
-    }
+    bool logEnabled = Profiler::Enabled();
+    const char* analysisName = nullptr;
+    if (logEnabled)
+      {
+      analysisName = this->Internals->LogEventNames[3 * ai + 2].c_str();
+      Profiler::StartEvent(analysisName);
+      }
 
-  pugi::xml_node root = doc.child("sensei");
+    if ((*iter)->Finalize())
+      {
+      SENSEI_ERROR("Failed to finalize " << (*iter)->GetClassName())
+      MPI_Abort(this->GetCommunicator(), -1);
+      }
 
-  return Initialize(root);
+    if (logEnabled)
+      Profiler::EndEvent(analysisName);
+    }
+
+  return 0;
 }
 
 //----------------------------------------------------------------------------
-int ConfigurableAnalysis::Initialize(const pugi::xml_node &root)
+bool ConfigurableAnalysis::WillExecute(long step, double time)
 {
-  TimeEvent<128> event("ConfigurableAnalysis::Initialize");
+  TimeEvent<128> event("ConfigurableAnalysis::WillExecute");
 
-  // create and configure analysis adaptors
-  for (pugi::xml_node node = root.child("analysis");
-    node; node = node.next_sibling("analysis"))
+  // schedule the upcoming step, the next call to Execute uses the result
+  if (this->Internals->ScheduleNext(this->GetCommunicator()))
+    {
+    SENSEI_ERROR("Failed to schedule the analyses")
+    MPI_Abort(this->GetCommunicator(), -1);
+    }
+
+  bool willExecute = false;
+  unsigned int nAnalyses = this->Internals->Controls.size();
+  for (unsigned int ai = 0; !willExecute && (ai < nAnalyses); ++ai)
     {
-    if (!node.attribute("enabled").as_int(0))
+    if (!this->Internals->NextRun[ai])
       continue;
 
-    std::string type = node.attribute("type").value();
-    if (!(((type == "histogram") && !this->Internals->AddHistogram(node))
-      || ((type == "autocorrelation") && !this->Internals->AddAutoCorrelation(node))
-      || ((type == "adios1") && !this->Internals->AddAdios1(node))
-      || ((type == "adios2") && !this->Internals->AddAdios2(node))
-      || ((type == "ascent") && !this->Internals->AddAscent(node))
-      || ((type == "catalyst") && !this->Internals->AddCatalyst(node))
-      || ((type == "hdf5") && !this->Internals->AddHDF5(node))
-      || ((type == "libsim") && !this->Internals->AddLibsim(node))
-      || ((type == "PosthocIO") && !this->Internals->AddPosthocIO(node))
-      || ((type == "VTKAmrWriter") && !this->Internals->AddVTKAmrWriter(node))
-      || ((type == "vtkmcontour") && !this->Internals->AddVTKmContour(node))
-      || ((type == "vtkmhaar") && !this->Internals->AddVTKmVolumeReduction(node))
-      || ((type == "cdf") && !this->Internals->AddVTKmCDF(node))
-      || ((type == "python") && !this->Internals->AddPythonAnalysis(node))
-      || ((type == "SliceExtract") && !this->Internals->AddSliceExtract(node))))
-      {
-      SENSEI_ERROR("Failed to add \"" << type << "\" analysis")
+    // a trigger that depends on the data is evaluated during Execute,
+    // the others are known now
+    bool fire = true;
+    if (this->Internals->EvaluateTrigger(this->GetCommunicator(), ai,
+      nullptr, step, time, fire))
       MPI_Abort(this->GetCommunicator(), -1);
-      }
+
+    // an asynchronous analysis may be running in the background and is
+    // not asked
+    willExecute = fire && (this->Internals->Controls[ai].Async ||
+      this->Internals->Analyses[ai]->WillExecute(step, time));
     }
 
-  // create and configure transport analysis adaptors
-  for (pugi::xml_node node = root.child("transport");
-    node; node = node.next_sibling("transport"))
+  // the bridge skips the step, the next one is scheduled anew. the
+  // schedule has already earned the time up to now and paid for the last
+  // execution, the next one starts from here so that neither is counted
+  // twice
+  if (!willExecute)
     {
-    if (!node.attribute("enabled").as_int(0))
-      continue;
-
-    std::string type = node.attribute("type").value();
-    if (!(((type == "adios1") && !this->Internals->AddAdios1(node))
-      || ((type == "adios2") && !this->Internals->AddAdios2(node))
-      || ((type == "hdf5") && !this->Internals->AddHDF5(node))))
+    this->Internals->HaveNextRun = false;
+    if (this->Internals->Budget > 0.0)
       {
-      SENSEI_ERROR("Failed to add \"" << type << "\" transport")
-      MPI_Abort(this->GetCommunicator(), -1);
+      this->Internals->LastExecuteEnd = std::chrono::steady_clock::now();
+      this->Internals->LastExecuteTime = 0.0;
+      this->Internals->HaveLastExecute = true;
       }
     }
 
-  return 0;
+  return willExecute;
 }
 
 //----------------------------------------------------------------------------
-bool ConfigurableAnalysis::Execute(DataAdaptor* data)
+int ConfigurableAnalysis::GetDataRequirements(DataRequirements &reqs,
+  bool &complete)
 {
-  TimeEvent<128> event("ConfigurableAnalysis::Execute");
+  TimeEvent<128> event("ConfigurableAnalysis::GetDataRequirements");
 
-  int ai = 0;
-  AnalysisAdaptorVector::iterator iter = this->Internals->Analyses.begin();
-  AnalysisAdaptorVector::iterator end = this->Internals->Analyses.end();
-  for (; iter != end; ++iter, ++ai)
-    {
-    const char* analysisName = nullptr;
-    bool logEnabled = Profiler::Enabled();
-    if (logEnabled)
-      {
-      analysisName = this->Internals->LogEventNames[3 * ai + 1].c_str();
-      Profiler::StartEvent(analysisName);
-      }
+  reqs.Clear();
+  complete = true;
 
-    if (!(*iter)->Execute(data))
-      {
-      SENSEI_ERROR("Failed to execute " << (*iter)->GetClassName())
-      MPI_Abort(this->GetCommunicator(), -1);
-      }
+  // schedule the upcoming step, the next call to Execute uses the result
+  if (this->Internals->ScheduleNext(this->GetCommunicator()))
+    {
+    SENSEI_ERROR("Failed to schedule the analyses")
+    return -1;
+    }
 
-    if (logEnabled)
-      Profiler::EndEvent(analysisName);
+  unsigned int nAnalyses = this->Internals->Controls.size();
+  for (unsigned int ai = 0; ai < nAnalyses; ++ai)
+    {
+    if (this->Internals->NextRun[ai] &&
+      this->Internals->AddSourceRequirements(ai, reqs, complete))
+      return -1;
     }
 
-  return true;
+  return 0;
 }
 
 //----------------------------------------------------------------------------
-int ConfigurableAnalysis::Finalize()
+int ConfigurableAnalysis::GetAllDataRequirements(DataRequirements &reqs,
+  bool &complete)
 {
-  TimeEvent<128> event("ConfigurableAnalysis::Finalize");
+  return this->Internals->GetAllRequirements(reqs, complete);
+}
 
-  int ai = 0;
-  AnalysisAdaptorVector::iterator iter = this->Internals->Analyses.begin();
-  AnalysisAdaptorVector::iterator end = this->Internals->Analyses.end();
-  for (; iter != end; ++iter, ++ai)
+//----------------------------------------------------------------------------
+unsigned int ConfigurableAnalysis::GetNumberOfAnalyses()
+{
+  return this->Internals->Analyses.size();
+}
+
+//----------------------------------------------------------------------------
+int ConfigurableAnalysis::GetAnalysisCost(unsigned int i, AnalysisCost &cost)
+{
+  if (i >= this->Internals->Controls.size())
     {
-    bool logEnabled = Profiler::Enabled();
-    const char* analysisName = nullptr;
-    if (logEnabled)
-      {
-      analysisName = this->Internals->LogEventNames[3 * ai + 2].c_str();
-      Profiler::StartEvent(analysisName);
-      }
+    SENSEI_ERROR("No analysis " << i << ". There are "
+      << this->Internals->Controls.size() << " analyses")
+    return -1;
+    }
 
-    if ((*iter)->Finalize())
-      {
-      SENSEI_ERROR("Failed to finalize " << (*iter)->GetClassName())
-      MPI_Abort(this->GetCommunicator(), -1);
-      }
+  std::lock_guard<std::mutex> lock(this->Internals->CostMutex);
+  cost = this->Internals->Controls[i].Cost;
 
-    if (logEnabled)
-      Profiler::EndEvent(analysisName);
-    }
+  // the times are updated by the background initialization until the
+  // first execution
+  if (!this->Internals->Prewarming.valid() &&
+    (i < this->Internals->Startup.size()))
+    cost.InitializeTime = this->Internals->Startup[i].Time;
 
   return 0;
 }
@@ -2,6 +2,7 @@
 #define sensei_ConfigurableAnalysis_h
 
 #include "AnalysisAdaptor.h"
+#include "DataRequirements.h"
 
 #include <string>
 #include <mpi.h>
@@ -28,13 +29,208 @@ public:
   int SetCommunicator(MPI_Comm comm) override;
 
   /// @brief Initialize the adaptor using the configuration specified.
+  ///
+  /// When the root element sets lazy_init="1" or an analysis element sets
+  /// lazy_init="1", the Catalyst, Libsim, Ascent and Python back-ends are
+  /// initialized on their first execution instead of here. With
+  /// prewarm="1" on the root element the deferred initialization runs in a
+  /// background thread that overlaps the simulation's own startup, this
+  /// requires MPI_THREAD_MULTIPLE. The time each analysis spends in
+  /// initialization is reported by rank 0 and by GetAnalysisCost.
+  ///
+  /// An analysis element that sets data_ranks="1" is executed only on the
+  /// ranks that have blocks of the meshes it accesses, over a communicator
+  /// of those ranks, and the others return to the simulation immediately.
+  /// Ownership is taken from MeshMetadata::NumBlocksLocal each step and the
+  /// communicator is made anew only when it changes. The analysis accesses
+  /// the data through an adaptor of its own on that communicator.
+  ///
+  /// The root element's memory_budget and memory_reserve, in MiB, set the
+  /// limit and reserve of the process' MemoryGovernor, and spill_dir the
+  /// directory for data spilled from memory. Under a limit an analysis is
+  /// skipped in the steps in which the most memory it added in an earlier
+  /// execution does not fit, on all ranks when it does not fit on one.
+  ///
+  /// The root element's global_view, flat or hierarchical, sets how the
+  /// data adaptor gathers the metadata of all ranks, see
+  /// DataAdaptor::SetGlobalViewMode. When it is not given the adaptor's
+  /// setting, flat by default, is kept.
+  ///
+  /// A derived element on the root declares arrays computed from the
+  /// simulation's, see DerivedFields. They are computed once per step, on
+  /// first request, and served to the analyses by the data cache, which is
+  /// then used even when one analysis runs or cache="0". They are not
+  /// available when the data is served by an in transit adaptor.
+  ///
+  /// An analysis element that sets publish="1", SliceExtract's for now,
+  /// serves its output meshes to the analyses and transports listed after
+  /// it, which name them in their mesh requirements. For instance a slice
+  /// of "mesh" published as "mesh_slice" and an adios2 transport with
+  /// <mesh name="mesh_slice"> ships only the slice. A publishing analysis
+  /// runs synchronously on all ranks and before any that may consume its
+  /// output, the published meshes are not asked of the simulation by
+  /// GetDataRequirements.
+  ///
+  /// An analysis element, typically a writer or transport, may hold a
+  /// subsample element. The analysis is then handed reduced resolution
+  /// copies of the meshes, see SubsamplingDataAdaptor, and its mesh
+  /// requirements name the meshes it is served. A sort element orders the
+  /// points of particle and unstructured meshes along a space filling
+  /// curve, after any subsampling, see SpatialSortDataAdaptor.
+  ///
+  /// An analysis element may set placement to in_situ, in_transit, or
+  /// adaptive, and name by transport the transport element that ships its
+  /// data, see PlacementPolicy. The same configuration is then given to
+  /// the simulation and the end point. Each step the simulation places
+  /// the analyses that run, adding the requirements of those placed in
+  /// transit to the transport's, and publishes the placement as a mesh the
+  /// transport ships. The end point, see SetEndPoint, runs the analyses the
+  /// mesh names. An analysis placed in transit is instantiated in the
+  /// simulation but not executed there. The analyses placed in situ, and
+  /// the transports that ship the others, are not run on the end point.
   int Initialize(const std::string &filename);
   int Initialize(const pugi::xml_node &root);
 
+  /// @brief Split the ranks between the analysis groups of a configuration.
+  ///
+  /// The root element may hold group elements that divide the ranks, an
+  /// in transit end point's, into disjoint groups that each run their own
+  /// analyses on the same steps at the same time, so that a small
+  /// analysis does not run at the full width of the end point. For
+  /// instance
+  ///
+  ///   <group name="render" fraction="0.75"/>
+  ///   <group name="stats" fraction="0.25"/>
+  ///
+  /// A group is given a number of ranks by its ranks attribute, the others
+  /// share the remaining ranks in proportion to their fraction attribute,
+  /// by default 1. Every group gets at least one rank and the ranks of a
+  /// group are contiguous. An analysis or transport element names its
+  /// group with the group attribute, and by default belongs to the first.
+  ///
+  /// groupComm is set to a new communicator of the ranks of this rank's
+  /// group, which the caller frees, and groupName to its name. Each group
+  /// should then read the stream with a transport data adaptor of its own
+  /// on groupComm, which partitions the blocks over the group's ranks, and
+  /// run a ConfigurableAnalysis on groupComm given the group's name with
+  /// SetGroup. When there are no groups groupComm is MPI_COMM_NULL and
+  /// groupName empty. Collective.
+  ///
+  /// @returns zero if successful
+  static int SplitGroups(MPI_Comm comm, const pugi::xml_node &root,
+    MPI_Comm &groupComm, std::string &groupName);
+
+  /// @brief Run only the analyses and transports of the named group.
+  ///
+  /// See SplitGroups. Must be called before Initialize. The default, an
+  /// empty name, runs all of them.
+  void SetGroup(const std::string &name);
+
+  /// @brief Configure the analyses for an in transit end point.
+  ///
+  /// Analyses with a placement then run in the steps the simulation
+  /// placed them in transit. Must be called before Initialize. The
+  /// default, 0, configures them for the simulation.
+  void SetEndPoint(int val);
+
+  /// @brief Returns true if any analysis will run on the upcoming step.
+  ///
+  /// The analyses chosen by the time budget are asked in turn, see
+  /// AnalysisAdaptor::WillExecute. A bridge that gets false may skip
+  /// setting up the data adaptor and calling Execute for the step. This is
+  /// collective when a time budget is set, the next call to Execute runs
+  /// the analyses chosen here.
+  bool WillExecute(long step, double time) override;
+
   bool Execute(DataAdaptor *data) override;
 
+  /// @brief Execute the analyses on a batch of steps.
+  ///
+  /// Analyses that accept batches are handed all of the steps at once,
+  /// after the others have executed on each step in turn. Asynchronous
+  /// analyses always see one step at a time. The time budget does not
+  /// apply to the analyses run on the batch.
+  bool ExecuteBatch(const std::vector<DataAdaptor*> &steps) override;
+
+  /// @brief Get a result sent back by an in transit end point.
+  ///
+  /// Takes the next result from the first of the configured transports
+  /// that has one, see AnalysisAdaptor::ReceiveResult.
+  int ReceiveResult(std::string &tag, std::string &result) override;
+
   int Finalize() override;
 
+  /// @brief Get the data the analyses will access on the upcoming step.
+  ///
+  /// The union of the data requirements of the analyses that will run on
+  /// the next call to Execute. A bridge calls this before computing the
+  /// step's derived fields and passes the result to
+  /// DataAdaptor::SetAnalysisRequirements. The requirements of an analysis
+  /// are those given by its XML, either mesh elements or the mesh, array
+  /// and association attributes. complete is set to false when an analysis
+  /// that will run declares none, it may access any of the data. When a
+  /// time budget is set this schedules the step and is collective, the
+  /// next call to Execute runs the analyses chosen here.
+  ///
+  /// @param[out] reqs the union of the requirements
+  /// @param[out] complete false if an analysis may access other data
+  /// @returns zero if successful
+  int GetDataRequirements(DataRequirements &reqs, bool &complete);
+
+  /// @brief Get the data accessed by all of the analyses.
+  ///
+  /// The union of the data requirements of every analysis, irrespective of
+  /// the schedule. An in transit end point passes it to its transport's
+  /// InTransitDataAdaptor::SetDataRequirements so that only that data is
+  /// read, Execute does so at the first step when the adaptor was given
+  /// no requirements of its own. complete is set to false when an analysis
+  /// declares none, the transport must then read all of the data.
+  ///
+  /// @param[out] reqs the union of the requirements
+  /// @param[out] complete false if an analysis may access other data
+  /// @returns zero if successful
+  int GetAllDataRequirements(DataRequirements &reqs, bool &complete);
+
+  /// @brief The resources used by an analysis on this rank.
+  ///
+  /// Values are accumulated over the executions since the analysis was
+  /// added. Times are in seconds. Bytes are those reported to the profiler
+  /// by the analysis' events plus the copies made for asynchronous
+  /// execution, and are only counted while event profiling is enabled.
+  /// Memory deltas are in KiB and give the growth of the resident set over
+  /// an execution beyond its size at the start; this is a lower bound when
+  /// the process reached a higher peak earlier. Utilization is the
+  /// process' CPU time over the wall time of the last execution, values
+  /// above 1 indicate the use of threads. When analyses run concurrently
+  /// the CPU time of the others is included. The initialization time is
+  /// the time spent starting the analysis, including deferred
+  /// initialization once it has run.
+  struct AnalysisCost
+  {
+    AnalysisCost() : NumExecutions(0), LastTime(0.0), TotalTime(0.0),
+      MaxTime(0.0), LastBytes(0), TotalBytes(0), LastMemoryDelta(0),
+      MaxMemoryDelta(0), LastUtilization(0.0), InitializeTime(0.0) {}
+
+    std::string Name;  // the name attribute, or the type and position
+    long NumExecutions;
+    double LastTime;
+    double TotalTime;
+    double MaxTime;
+    long long LastBytes;
+    long long TotalBytes;
+    long long LastMemoryDelta;
+    long long MaxMemoryDelta;
+    double LastUtilization;
+    double InitializeTime;
+  };
+
+  /// @brief Get the number of analyses that are executed.
+  unsigned int GetNumberOfAnalyses();
+
+  /// @brief Get the resources used by the i'th analysis on this rank.
+  /// Analyses running asynchronously are accounted for when they complete.
+  int GetAnalysisCost(unsigned int i, AnalysisCost &cost);
+
 protected:
   ConfigurableAnalysis();
   ~ConfigurableAnalysis();
@@ -1,6 +1,12 @@
 #include "ConfigurableInTransitDataAdaptor.h"
 #include "InTransitDataAdaptor.h"
+#include "DataRequirements.h"
+#include "VTKDataAdaptor.h"
+#include "VTKUtils.h"
 #include "XMLUtils.h"
+#include "Profiler.h"
+#include "MemoryGovernor.h"
+#include "TaskRuntime.h"
 #include "Error.h"
 #ifdef ENABLE_ADIOS1
 #include "ADIOS1DataAdaptor.h"
@@ -11,28 +17,406 @@
 #ifdef ENABLE_HDF5
 #include "HDF5DataAdaptor.h"
 #endif
+#include "MPIDataAdaptor.h"
+#include "MultiStreamDataAdaptor.h"
 
 #include <pugixml.hpp>
 #include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 #include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkDataObject.h>
 
 namespace sensei
 {
 
 struct ConfigurableInTransitDataAdaptor::InternalsType
 {
-  InternalsType() : Adaptor(nullptr) {}
+  InternalsType() : Adaptor(nullptr), PrefetchDepth(0),
+    PrefetchMemory(0), BytesInUse(0), Stop(false), Running(false),
+    MemoryConsumer(-1) {}
 
   ~InternalsType()
   {
+    this->StopPrefetch();
+
     if (this->Adaptor)
       Adaptor->Delete();
   }
 
+  // the data and metadata of one time step read ahead of the analyses
+  struct PrefetchStep
+  {
+    PrefetchStep() : Status(0), Time(0.0), TimeStep(0), Bytes(0) {}
+
+    // 0 when the step holds data, 1 at the end of the stream, and
+    // -1 if reading the step failed
+    int Status;
+    double Time;
+    long TimeStep;
+    unsigned long Bytes;
+    std::vector<MeshMetadataPtr> Metadata;
+    vtkSmartPointer<VTKDataAdaptor> Data;
+  };
+
+  // returns true when data is served from prefetched steps
+  bool Prefetching() const { return this->Running; }
+
+  // start/stop the background thread that reads ahead
+  void StartPrefetch();
+  void StopPrefetch();
+
+  // the body of the background thread
+  void Prefetch();
+
+  // read the wrapped adaptor's current step into the passed object
+  int ReadStep(PrefetchStep &step);
+
+  // wait for the next prefetched step and make it current. returns
+  // 0 if a step is available, 1 at the end of the stream, and -1
+  // on error
+  int NextStep();
+
+  // drop the current step's data and return its memory to the budget
+  void ReleaseStep();
+
+  // wait until the in situ memory budget grants nBytes, or until no steps
+  // are held. returns 1 when the prefetch is stopped while waiting
+  int WaitForMemory(unsigned long nBytes);
+
   InTransitDataAdaptor *Adaptor;
+
+  // number of steps to read ahead of the analyses and the memory,
+  // in bytes, the queued steps may use. 0 disables the budget
+  unsigned int PrefetchDepth;
+  unsigned long PrefetchMemory;
+
+  PrefetchStep Current;
+  std::deque<PrefetchStep> Queue;
+  unsigned long BytesInUse;
+  bool Stop;
+  bool Running;
+  std::mutex Mutex;
+  std::condition_variable Cond;
+  std::thread Thread;
+  int MemoryConsumer;
 };
 
+//----------------------------------------------------------------------------
+void ConfigurableInTransitDataAdaptor::InternalsType::StartPrefetch()
+{
+  this->Stop = false;
+  this->BytesInUse = 0;
+  this->Queue.clear();
+  this->Current = PrefetchStep();
+  this->Running = true;
+  this->MemoryConsumer = MemoryGovernor::GetGlobalGovernor().Register(
+    "ConfigurableInTransitDataAdaptor::Prefetch", MemoryGovernor::POLICY_STREAM);
+  this->Thread = std::thread(&InternalsType::Prefetch, this);
+}
+
+//----------------------------------------------------------------------------
+void ConfigurableInTransitDataAdaptor::InternalsType::StopPrefetch()
+{
+  if (!this->Running)
+    return;
+
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Stop = true;
+  }
+  this->Cond.notify_all();
+
+  // if the thread is blocked in the transport waiting for the next step
+  // this returns once the step arrives or the writer closes the stream
+  if (this->Thread.joinable())
+    this->Thread.join();
+
+  this->Queue.clear();
+  this->Current = PrefetchStep();
+  this->BytesInUse = 0;
+  this->Running = false;
+
+  MemoryGovernor::GetGlobalGovernor().Unregister(this->MemoryConsumer);
+  this->MemoryConsumer = -1;
+}
+
+//----------------------------------------------------------------------------
+int ConfigurableInTransitDataAdaptor::InternalsType::ReadStep(
+  PrefetchStep &step)
+{
+  TimeEvent<128> mark("ConfigurableInTransitDataAdaptor::ReadStep");
+
+  InTransitDataAdaptor *adaptor = this->Adaptor;
+
+  step.Time = adaptor->GetDataTime();
+  step.TimeStep = adaptor->GetDataTimeStep();
+
+  // the metadata is captured with all fields since the flags the analyses
+  // will ask for are not known ahead of time
+  unsigned int nMeshes = 0;
+  if (adaptor->GetNumberOfMeshes(nMeshes))
+    {
+    SENSEI_ERROR("Failed to get the number of meshes")
+    return -1;
+    }
+
+  step.Metadata.resize(nMeshes);
+  for (unsigned int i = 0; i < nMeshes; ++i)
+    {
+    MeshMetadataPtr md = MeshMetadata::New();
+    md->Flags.SetAll();
+    if (adaptor->GetMeshMetadata(i, md))
+      {
+      SENSEI_ERROR("Failed to get metadata for mesh " << i)
+      return -1;
+      }
+    step.Metadata[i] = md;
+    }
+
+  // read what the analyses will use, or everything if that is not known.
+  // the requirements may be set by the analysis thread while prefetching
+  DataRequirements reqs;
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  reqs = adaptor->GetDataRequirements();
+  }
+  if (reqs.Empty() && reqs.Initialize(adaptor, false))
+    {
+    SENSEI_ERROR("Failed to initialize data requirements")
+    return -1;
+    }
+
+  step.Data = vtkSmartPointer<VTKDataAdaptor>::New();
+  step.Data->SetDataTime(step.Time);
+  step.Data->SetDataTimeStep(step.TimeStep);
+
+  step.Bytes = 0;
+
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    const std::string &meshName = mit.MeshName();
+
+    MeshMetadataPtr mmd;
+    for (unsigned int i = 0; !mmd && (i < nMeshes); ++i)
+      {
+      if (step.Metadata[i]->MeshName == meshName)
+        mmd = step.Metadata[i];
+      }
+
+    if (!mmd)
+      {
+      SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    vtkDataObject *mesh = nullptr;
+    if (adaptor->GetMesh(meshName, mit.StructureOnly(), mesh))
+      {
+      SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    // this rank has no data
+    if (!mesh)
+      {
+      step.Data->SetDataObject(meshName, nullptr);
+      continue;
+      }
+
+    if ((mmd->NumGhostCells || VTKUtils::AMR(mmd)) &&
+      adaptor->AddGhostCellsArray(mesh, meshName))
+      {
+      SENSEI_ERROR(<< adaptor->GetClassName() << " failed to add ghost cells.")
+      mesh->Delete();
+      return -1;
+      }
+
+    if (mmd->NumGhostNodes && adaptor->AddGhostNodesArray(mesh, meshName))
+      {
+      SENSEI_ERROR(<< adaptor->GetClassName() << " failed to add ghost nodes.")
+      mesh->Delete();
+      return -1;
+      }
+
+    ArrayRequirementsIterator ait =
+      reqs.GetArrayRequirementsIterator(meshName);
+
+    ait.SetMode(ArrayRequirementsIterator::MODE_ASSOCIATION);
+
+    for (; ait; ++ait)
+      {
+      if (adaptor->AddArrays(mesh, meshName, ait.Association(), ait.Arrays()))
+        {
+        SENSEI_ERROR(<< adaptor->GetClassName() << " failed to add "
+          << VTKUtils::GetAttributesName(ait.Association())
+          << " data arrays to mesh \"" << meshName << "\"")
+        mesh->Delete();
+        return -1;
+        }
+      }
+
+    // the meshes produced by the transport own their memory so no copy
+    // is needed for the data to outlive the step
+    step.Bytes += 1024ul*mesh->GetActualMemorySize();
+
+    step.Data->SetDataObject(meshName, mesh);
+    mesh->Delete();
+    }
+
+  adaptor->ReleaseData();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void ConfigurableInTransitDataAdaptor::InternalsType::Prefetch()
+{
+  TaskRuntime::BindThread("ConfigurableInTransitDataAdaptor::Prefetch");
+
+  MemoryGovernor &governor = MemoryGovernor::GetGlobalGovernor();
+
+  // the wrapped adaptor's current step was made available by OpenStream
+  unsigned long lastBytes = 0;
+  while (true)
+    {
+    // the memory of the next step, taken to be that of the last, is
+    // requested before it is read. when the in situ budget is short the
+    // steps are streamed, each is read once the analyses are done with
+    // those held
+    if (lastBytes && this->WaitForMemory(lastBytes))
+      return;
+
+    PrefetchStep step;
+    if (this->ReadStep(step))
+      step.Status = -1;
+
+    governor.Release(this->MemoryConsumer, lastBytes);
+    governor.Request(this->MemoryConsumer, step.Bytes, true);
+    lastBytes = step.Bytes;
+
+    // wait for room in the queue. a step is always admitted when nothing
+    // else is held, so that a step larger than the budget can not stall
+    // the stream
+    {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    this->Cond.wait(lock, [&]() -> bool
+      {
+      return this->Stop || ((this->Queue.size() < this->PrefetchDepth) &&
+        (!this->PrefetchMemory || !this->BytesInUse ||
+        (this->BytesInUse + step.Bytes <= this->PrefetchMemory)));
+      });
+
+    if (this->Stop)
+      return;
+
+    this->BytesInUse += step.Bytes;
+    bool failed = step.Status;
+    this->Queue.push_back(std::move(step));
+    this->Cond.notify_all();
+
+    if (failed)
+      return;
+    }
+
+    // move the transport on while the analyses process earlier steps
+    if (this->Adaptor->AdvanceStream())
+      {
+      PrefetchStep end;
+      end.Status = 1;
+
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      this->Queue.push_back(std::move(end));
+      this->Cond.notify_all();
+      return;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+int ConfigurableInTransitDataAdaptor::InternalsType::NextStep()
+{
+  TimeEvent<128> mark("ConfigurableInTransitDataAdaptor::NextStep");
+
+  std::unique_lock<std::mutex> lock(this->Mutex);
+
+  this->BytesInUse -= this->Current.Bytes;
+  MemoryGovernor::GetGlobalGovernor().Release(this->MemoryConsumer,
+    this->Current.Bytes);
+  this->Current = PrefetchStep();
+  this->Cond.notify_all();
+
+  this->Cond.wait(lock, [&]() -> bool { return !this->Queue.empty(); });
+
+  // the end of stream and error markers are left in place so that
+  // subsequent calls report the same
+  if (this->Queue.front().Status)
+    {
+    this->Current.Status = this->Queue.front().Status;
+    return this->Current.Status;
+    }
+
+  this->Current = std::move(this->Queue.front());
+  this->Queue.pop_front();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void ConfigurableInTransitDataAdaptor::InternalsType::ReleaseStep()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  this->BytesInUse -= this->Current.Bytes;
+  MemoryGovernor::GetGlobalGovernor().Release(this->MemoryConsumer,
+    this->Current.Bytes);
+  this->Current.Bytes = 0;
+  this->Current.Data = nullptr;
+  this->Cond.notify_all();
+}
+
+//----------------------------------------------------------------------------
+int ConfigurableInTransitDataAdaptor::InternalsType::WaitForMemory(
+  unsigned long nBytes)
+{
+  MemoryGovernor &governor = MemoryGovernor::GetGlobalGovernor();
+  if (!governor.Enabled())
+    {
+    governor.Request(this->MemoryConsumer, nBytes);
+    return 0;
+    }
+
+  TimeEvent<128> mark("ConfigurableInTransitDataAdaptor::WaitForMemory");
+
+  // memory given back by others is not signaled, the budget is polled
+  std::unique_lock<std::mutex> lock(this->Mutex);
+
+  bool granted = false;
+  while (!this->Stop && this->BytesInUse &&
+    !(granted = governor.Request(this->MemoryConsumer, nBytes)))
+    this->Cond.wait_for(lock, std::chrono::milliseconds(10));
+
+  if (this->Stop)
+    {
+    if (granted)
+      governor.Release(this->MemoryConsumer, nBytes);
+    return 1;
+    }
+
+  // nothing is held, the step is read irrespective of the budget
+  if (!granted)
+    governor.Request(this->MemoryConsumer, nBytes, true);
+
+  return 0;
+}
+
 //----------------------------------------------------------------------------
 senseiNewMacro(ConfigurableInTransitDataAdaptor);
 
@@ -79,6 +463,35 @@ int ConfigurableInTransitDataAdaptor::Initialize(pugi::xml_node &root)
 
   pugi::xml_node node = root.child("transport");
 
+  // several transport elements configure one stream each
+  if (node.next_sibling("transport"))
+    {
+    MultiStreamDataAdaptor *adaptor = MultiStreamDataAdaptor::New();
+    adaptor->SetCommunicator(this->GetCommunicator());
+
+    if (adaptor->Initialize(root))
+      {
+      SENSEI_ERROR("Failed to initialize the streams")
+      adaptor->Delete();
+      return -1;
+      }
+
+    if (this->Internals->Adaptor)
+      this->Internals->Adaptor->Delete();
+
+    // each stream prefetches on its own
+    this->Internals->Adaptor = adaptor;
+    this->Internals->PrefetchDepth = 0;
+
+    return 0;
+    }
+
+  return this->InitializeTransport(node);
+}
+
+// -------------------------------------------------------------------------------
+int ConfigurableInTransitDataAdaptor::InitializeTransport(pugi::xml_node &node)
+{
   if (XMLUtils::RequireAttribute(node, "type"))
     return -1;
 
@@ -113,6 +526,10 @@ int ConfigurableInTransitDataAdaptor::Initialize(pugi::xml_node &root)
     adaptor = HDF5DataAdaptor::New();
 #endif
     }
+  else if (type == "mpi")
+    {
+    adaptor = MPIDataAdaptor::New();
+    }
   else if (type == "libis")
     {
 #ifndef ENABLE_LIBIS
@@ -138,6 +555,8 @@ int ConfigurableInTransitDataAdaptor::Initialize(pugi::xml_node &root)
 
   // intialize the adaptor. the partitioner is typically iniitialized
   // by the default initialize in the InTransitDataAdaptor
+  adaptor->SetCommunicator(this->GetCommunicator());
+
   if (adaptor->SetConnectionInfo(this->GetConnectionInfo()) ||
     adaptor->Initialize(node))
     {
@@ -148,6 +567,21 @@ int ConfigurableInTransitDataAdaptor::Initialize(pugi::xml_node &root)
   // everything is good, take ownership of the concrete instance
   this->Internals->Adaptor = adaptor;
 
+  // read ahead of the analyses. the transport is driven by a background
+  // thread which makes MPI calls while the analyses are running
+  this->Internals->PrefetchDepth = node.attribute("prefetch").as_uint(0);
+  this->Internals->PrefetchMemory = 1024ul*1024ul*
+    node.attribute("prefetch_memory").as_uint(0);
+
+  int threadLevel = MPI_THREAD_SINGLE;
+  MPI_Query_thread(&threadLevel);
+  if (this->Internals->PrefetchDepth && (threadLevel < MPI_THREAD_MULTIPLE))
+    {
+    SENSEI_WARNING("Prefetch requires MPI_THREAD_MULTIPLE."
+      " Time steps will be read on demand")
+    this->Internals->PrefetchDepth = 0;
+    }
+
   SENSEI_STATUS("Configured \"" << adaptor->GetClassName())
 
   return 0;
@@ -232,6 +666,47 @@ sensei::PartitionerPtr ConfigurableInTransitDataAdaptor::GetPartitioner()
   return this->Internals->Adaptor->GetPartitioner();
 }
 
+// -------------------------------------------------------------------------------
+int ConfigurableInTransitDataAdaptor::NewStepSnapshot(DataAdaptor *&snapshot,
+  unsigned long &bytes)
+{
+  snapshot = nullptr;
+  bytes = 0;
+
+  if (!this->Internals->Adaptor)
+    {
+    SENSEI_ERROR("No InTransitDataAdaptor instance")
+    return -1;
+    }
+
+  // the prefetched step already is a copy
+  if (this->Internals->Prefetching())
+    {
+    if (!this->Internals->Current.Data)
+      {
+      SENSEI_ERROR("No prefetched data for the current time step")
+      return -1;
+      }
+    snapshot = this->Internals->Current.Data.GetPointer();
+    snapshot->Register(nullptr);
+    bytes = this->Internals->Current.Bytes;
+    return 0;
+    }
+
+  InternalsType::PrefetchStep step;
+  if (this->Internals->ReadStep(step))
+    {
+    SENSEI_ERROR("Failed to copy time step " << step.TimeStep)
+    return -1;
+    }
+
+  snapshot = step.Data.GetPointer();
+  snapshot->Register(nullptr);
+  bytes = step.Bytes;
+
+  return 0;
+}
+
 // -------------------------------------------------------------------------------
 int ConfigurableInTransitDataAdaptor::OpenStream()
 {
@@ -241,7 +716,21 @@ int ConfigurableInTransitDataAdaptor::OpenStream()
     return -1;
     }
 
-  return this->Internals->Adaptor->OpenStream();
+  if (this->Internals->Adaptor->OpenStream())
+    return -1;
+
+  if (!this->Internals->PrefetchDepth)
+    return 0;
+
+  this->Internals->StartPrefetch();
+
+  if (this->Internals->NextStep())
+    {
+    SENSEI_ERROR("Failed to prefetch the first time step")
+    return -1;
+    }
+
+  return 0;
 }
 
 // -------------------------------------------------------------------------------
@@ -253,6 +742,8 @@ int ConfigurableInTransitDataAdaptor::CloseStream()
     return -1;
     }
 
+  this->Internals->StopPrefetch();
+
   return this->Internals->Adaptor->CloseStream();
 }
 
@@ -265,6 +756,14 @@ int ConfigurableInTransitDataAdaptor::AdvanceStream()
     return -1;
     }
 
+  if (this->Internals->Prefetching())
+    {
+    int ierr = this->Internals->NextStep();
+    if (ierr < 0)
+      SENSEI_ERROR("Failed to prefetch the next time step")
+    return ierr ? -1 : 0;
+    }
+
   return this->Internals->Adaptor->AdvanceStream();
 }
 
@@ -277,6 +776,9 @@ int ConfigurableInTransitDataAdaptor::StreamGood()
     return -1;
     }
 
+  if (this->Internals->Prefetching())
+    return this->Internals->Current.Status == 0;
+
   return this->Internals->Adaptor->StreamGood();
 }
 
@@ -289,6 +791,8 @@ int ConfigurableInTransitDataAdaptor::Finalize()
     return -1;
     }
 
+  this->Internals->StopPrefetch();
+
   return this->Internals->Adaptor->Finalize();
 }
 
@@ -301,6 +805,12 @@ int ConfigurableInTransitDataAdaptor::GetNumberOfMeshes(unsigned int &numMeshes)
     return -1;
     }
 
+  if (this->Internals->Prefetching())
+    {
+    numMeshes = this->Internals->Current.Metadata.size();
+    return 0;
+    }
+
   return this->Internals->Adaptor->GetNumberOfMeshes(numMeshes);
 }
 
@@ -314,6 +824,18 @@ int ConfigurableInTransitDataAdaptor::GetMeshMetadata(unsigned int id,
     return -1;
     }
 
+  if (this->Internals->Prefetching())
+    {
+    std::vector<MeshMetadataPtr> &md = this->Internals->Current.Metadata;
+    if (id >= md.size())
+      {
+      SENSEI_ERROR("Mesh id " << id << " is out of bounds")
+      return -1;
+      }
+    metadata = md[id]->NewCopy();
+    return 0;
+    }
+
   return this->Internals->Adaptor->GetMeshMetadata(id, metadata);
 }
 
@@ -327,6 +849,17 @@ int ConfigurableInTransitDataAdaptor::GetMesh(const std::string &meshName,
     return -1;
     }
 
+  if (this->Internals->Prefetching())
+    {
+    if (!this->Internals->Current.Data)
+      {
+      SENSEI_ERROR("No prefetched data for the current time step")
+      return -1;
+      }
+    return this->Internals->Current.Data->GetMesh(meshName,
+      structureOnly, mesh);
+    }
+
   return this->Internals->Adaptor->GetMesh(meshName, structureOnly, mesh);
 }
 
@@ -340,6 +873,18 @@ int ConfigurableInTransitDataAdaptor::GetMesh(const std::string &meshName,
     return -1;
     }
 
+  if (this->Internals->Prefetching())
+    {
+    if (!this->Internals->Current.Data)
+      {
+      SENSEI_ERROR("No prefetched data for the current time step")
+      return -1;
+      }
+    // the composite overload is provided by the base class
+    DataAdaptor *data = this->Internals->Current.Data;
+    return data->GetMesh(meshName, structureOnly, mesh);
+    }
+
   return this->Internals->Adaptor->GetMesh(meshName, structureOnly, mesh);
 }
 
@@ -353,6 +898,10 @@ int ConfigurableInTransitDataAdaptor::AddGhostNodesArray(vtkDataObject* mesh,
     return -1;
     }
 
+  // prefetched meshes already carry their ghost arrays
+  if (this->Internals->Prefetching())
+    return 0;
+
   return this->Internals->Adaptor->AddGhostNodesArray(mesh, meshName);
 }
 
@@ -366,6 +915,10 @@ int ConfigurableInTransitDataAdaptor::AddGhostCellsArray(vtkDataObject* mesh,
     return -1;
     }
 
+  // prefetched meshes already carry their ghost arrays
+  if (this->Internals->Prefetching())
+    return 0;
+
   return this->Internals->Adaptor->AddGhostCellsArray(mesh, meshName);
 }
 
@@ -379,6 +932,17 @@ int ConfigurableInTransitDataAdaptor::AddArray(vtkDataObject* mesh,
     return -1;
     }
 
+  if (this->Internals->Prefetching())
+    {
+    if (!this->Internals->Current.Data)
+      {
+      SENSEI_ERROR("No prefetched data for the current time step")
+      return -1;
+      }
+    return this->Internals->Current.Data->AddArray(mesh, meshName,
+      association, arrayName);
+    }
+
   return this->Internals->Adaptor->AddArray(mesh, meshName, association, arrayName);
 }
 
@@ -392,6 +956,17 @@ int ConfigurableInTransitDataAdaptor::AddArrays(vtkDataObject* mesh,
     return -1;
     }
 
+  if (this->Internals->Prefetching())
+    {
+    if (!this->Internals->Current.Data)
+      {
+      SENSEI_ERROR("No prefetched data for the current time step")
+      return -1;
+      }
+    return this->Internals->Current.Data->AddArrays(mesh, meshName,
+      association, arrayName);
+    }
+
   return this->Internals->Adaptor->AddArrays(mesh, meshName, association, arrayName);
 }
 
@@ -404,31 +979,126 @@ int ConfigurableInTransitDataAdaptor::ReleaseData()
     return -1;
     }
 
+  if (this->Internals->Prefetching())
+    {
+    this->Internals->ReleaseStep();
+    return 0;
+    }
+
   return this->Internals->Adaptor->ReleaseData();
 }
 
 // -------------------------------------------------------------------------------
 double ConfigurableInTransitDataAdaptor::GetDataTime()
 {
+  if (this->Internals->Prefetching())
+    return this->Internals->Current.Time;
+
   return this->Internals->Adaptor->GetDataTime();
 }
 
 // -------------------------------------------------------------------------------
 void ConfigurableInTransitDataAdaptor::SetDataTime(double time)
 {
+  if (this->Internals->Prefetching())
+    {
+    this->Internals->Current.Time = time;
+    return;
+    }
+
   this->Internals->Adaptor->SetDataTime(time);
 }
 
 // -------------------------------------------------------------------------------
 long ConfigurableInTransitDataAdaptor::GetDataTimeStep()
 {
+  if (this->Internals->Prefetching())
+    return this->Internals->Current.TimeStep;
+
   return this->Internals->Adaptor->GetDataTimeStep();
 }
 
 // -------------------------------------------------------------------------------
 void ConfigurableInTransitDataAdaptor::SetDataTimeStep(long index)
 {
+  if (this->Internals->Prefetching())
+    {
+    this->Internals->Current.TimeStep = index;
+    return;
+    }
+
   this->Internals->Adaptor->SetDataTimeStep(index);
 }
 
+// -------------------------------------------------------------------------------
+void ConfigurableInTransitDataAdaptor::SetDataRequirements(
+  const DataRequirements &reqs)
+{
+  // the prefetch thread copies the wrapped adaptor's requirements as it
+  // reads each step
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+  this->InTransitDataAdaptor::SetDataRequirements(reqs);
+  if (this->Internals->Adaptor)
+    this->Internals->Adaptor->SetDataRequirements(reqs);
+}
+
+// -------------------------------------------------------------------------------
+const DataRequirements &
+ConfigurableInTransitDataAdaptor::GetDataRequirements() const
+{
+  if (this->Internals->Adaptor)
+    return this->Internals->Adaptor->GetDataRequirements();
+  return this->InTransitDataAdaptor::GetDataRequirements();
+}
+
+// -------------------------------------------------------------------------------
+void ConfigurableInTransitDataAdaptor::SetStepPolicy(int policy,
+  unsigned int count)
+{
+  this->InTransitDataAdaptor::SetStepPolicy(policy, count);
+  if (this->Internals->Adaptor)
+    this->Internals->Adaptor->SetStepPolicy(policy, count);
+}
+
+// -------------------------------------------------------------------------------
+int ConfigurableInTransitDataAdaptor::GetStepPolicy() const
+{
+  if (this->Internals->Adaptor)
+    return this->Internals->Adaptor->GetStepPolicy();
+  return this->InTransitDataAdaptor::GetStepPolicy();
+}
+
+// -------------------------------------------------------------------------------
+unsigned int ConfigurableInTransitDataAdaptor::GetStepPolicyCount() const
+{
+  if (this->Internals->Adaptor)
+    return this->Internals->Adaptor->GetStepPolicyCount();
+  return this->InTransitDataAdaptor::GetStepPolicyCount();
+}
+
+// -------------------------------------------------------------------------------
+void ConfigurableInTransitDataAdaptor::GetStepCounters(
+  unsigned long &numProcessed, unsigned long &numSkipped) const
+{
+  if (this->Internals->Adaptor)
+    {
+    this->Internals->Adaptor->GetStepCounters(numProcessed, numSkipped);
+    return;
+    }
+  this->InTransitDataAdaptor::GetStepCounters(numProcessed, numSkipped);
+}
+
+// -------------------------------------------------------------------------------
+int ConfigurableInTransitDataAdaptor::PostResult(const std::string &tag,
+  const std::string &result)
+{
+  if (!this->Internals->Adaptor)
+    {
+    SENSEI_ERROR("No InTransitDataAdaptor instance")
+    return -1;
+    }
+
+  return this->Internals->Adaptor->PostResult(tag, result);
+}
+
 }
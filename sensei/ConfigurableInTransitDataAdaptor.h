@@ -40,6 +40,32 @@ namespace sensei
 //   </transport>
 // <sensei>
 //
+// The following attributes of the `transport` element are handled here
+// and apply to all transport types:
+//
+//   prefetch        -- the number of time steps to read ahead of the
+//                      analyses (default 0, read on demand). When set, a
+//                      background thread reads the data of the next steps
+//                      while the analyses process the current one.
+//                      Requires MPI_THREAD_MULTIPLE.
+//   prefetch_memory -- bound, in MiB, on the memory held by prefetched
+//                      steps including the current one (default 0, no
+//                      bound). A step is always read when no other step
+//                      is held.
+//
+// Prefetched steps are also charged to the process' MemoryGovernor. When
+// the in situ memory budget is short the next step is read only once the
+// analyses release the steps held, that is steps are streamed one at a
+// time.
+//
+// When prefetching only the meshes and arrays named in the data
+// requirements are read, or if there are no requirements everything the
+// sender provides.
+//
+// When there is more than one `transport` element each configures a
+// stream, and the streams are served together by a MultiStreamDataAdaptor.
+// Meshes are then named "<stream>:<mesh>", see MultiStreamDataAdaptor.
+//
 class ConfigurableInTransitDataAdaptor : public sensei::InTransitDataAdaptor
 {
 public:
@@ -54,6 +80,9 @@ public:
 
   int Initialize(pugi::xml_node &node) override;
 
+  // Initialize from a single transport element
+  int InitializeTransport(pugi::xml_node &node);
+
   int GetSenderMeshMetadata(unsigned int id,
     MeshMetadataPtr &metadata) override;
 
@@ -66,6 +95,25 @@ public:
   void SetPartitioner(const sensei::PartitionerPtr &partitioner) override;
   sensei::PartitionerPtr GetPartitioner() override;
 
+  void SetDataRequirements(const sensei::DataRequirements &reqs) override;
+  const sensei::DataRequirements &GetDataRequirements() const override;
+
+  void SetStepPolicy(int policy, unsigned int count = 1) override;
+  int GetStepPolicy() const override;
+  unsigned int GetStepPolicyCount() const override;
+
+  void GetStepCounters(unsigned long &numProcessed,
+    unsigned long &numSkipped) const override;
+
+  int PostResult(const std::string &tag, const std::string &result) override;
+
+  // Copy the data of the current step, so that it remains available after
+  // the stream is advanced. The data the analyses require is copied, or
+  // all of it if they did not say. When steps are prefetched the prefetched
+  // copy is returned. bytes is set to the memory used by the copy. The
+  // caller takes the reference.
+  int NewStepSnapshot(DataAdaptor *&snapshot, unsigned long &bytes);
+
   int OpenStream() override;
   int CloseStream() override;
   int AdvanceStream() override;
@@ -4,6 +4,10 @@
 #include "MappedPartitioner.h"
 #include "PlanarPartitioner.h"
 #include "PlanarSlicePartitioner.h"
+#include "LocalityPartitioner.h"
+#include "HilbertPartitioner.h"
+#include "AdaptivePartitioner.h"
+#include "ElasticPartitioner.h"
 #include "XMLUtils.h"
 #include "Profiler.h"
 
@@ -80,6 +84,22 @@ int ConfigurablePartitioner::Initialize(pugi::xml_node &partNode)
     {
     tmp = PlanarSlicePartitioner::New();
     }
+  else if (partType == "locality")
+    {
+    tmp = LocalityPartitioner::New();
+    }
+  else if (partType == "hilbert")
+    {
+    tmp = HilbertPartitioner::New();
+    }
+  else if (partType == "adaptive")
+    {
+    tmp = AdaptivePartitioner::New();
+    }
+  else if (partType == "elastic")
+    {
+    tmp = ElasticPartitioner::New();
+    }
   else
     {
     SENSEI_ERROR("Failed to construct a partitioner. \""
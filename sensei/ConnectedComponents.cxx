@@ -0,0 +1,987 @@
+#include "ConnectedComponents.h"
+#include "ArrayDispatch.h"
+#include "DataAdaptor.h"
+#include "MeshMetadata.h"
+#include "MeshMetadataMap.h"
+#include "Profiler.h"
+#include "TaskRuntime.h"
+#include "VTKUtils.h"
+#include "Error.h"
+
+#include <vtkCellData.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSet.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkRectilinearGrid.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using Feature = sensei::ConnectedComponents::Feature;
+
+namespace
+{
+// makes the i,j,k index of cells positive when they are packed into a key
+const long long indexOffset = 1ll << 20;
+
+// the sums of the cells of a label, or of a feature
+struct Sums
+{
+  double Cells;
+  double Volume;
+  double X[3];      // center times volume
+  double Extreme;
+  double Integral;
+};
+
+// a cell on the boundary of a block, Owner is set, or a cell next to such
+// a cell that the block does not have, Owner is not. Label is that of the
+// block's cell
+struct Link
+{
+  long long Key;
+  long long Label;
+  long long Owner;
+};
+
+// two labels of the same feature
+struct Edge
+{
+  long long A;
+  long long B;
+};
+
+// the number of cells of a label in a feature of the previous step
+struct Overlap
+{
+  long long Id;
+  long long Label;
+  long long Count;
+};
+
+// a local block, its geometry and labels
+struct BlockLabels
+{
+  vtkDataSet *Data;
+  int Id;
+  vtkDataArray *Array;
+  const unsigned char *Ghosts;
+  int Ext[6];                   // the cell extent
+  std::vector<double> Edges[3]; // the point coordinates along each axis
+  std::vector<int> Labels;      // the label of each cell, -1 outside
+  std::vector<Sums> LabelSums;
+  std::vector<Link> Links;
+  long long Offset;             // the rank local id of the first label
+};
+
+// --------------------------------------------------------------------------
+Sums emptySums(bool below)
+{
+  Sums s = {0.0, 0.0, {0.0, 0.0, 0.0}, below ?
+    std::numeric_limits<double>::max() : std::numeric_limits<double>::lowest(),
+    0.0};
+  return s;
+}
+
+// --------------------------------------------------------------------------
+void merge(Sums &a, const Sums &b, bool below)
+{
+  a.Cells += b.Cells;
+  a.Volume += b.Volume;
+  a.X[0] += b.X[0];
+  a.X[1] += b.X[1];
+  a.X[2] += b.X[2];
+  a.Extreme = below ? std::min(a.Extreme, b.Extreme) :
+    std::max(a.Extreme, b.Extreme);
+  a.Integral += b.Integral;
+}
+
+// --------------------------------------------------------------------------
+long long packIndex(long long i, long long j, long long k)
+{
+  return ((i + indexOffset) << 42) | ((j + indexOffset) << 21) |
+    (k + indexOffset);
+}
+
+// --------------------------------------------------------------------------
+int hashRank(long long key, int nRanks)
+{
+  unsigned long long h = static_cast<unsigned long long>(key) *
+    0x9E3779B97F4A7C15ull;
+  return (h >> 33) % nRanks;
+}
+
+// --------------------------------------------------------------------------
+// the root of i's set, halving the path. the root of a set is its
+// smallest member
+template <typename T>
+T findRoot(std::vector<T> &parent, T i)
+{
+  while (parent[i] != i)
+    {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+    }
+  return i;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+void unite(std::vector<T> &parent, T a, T b)
+{
+  a = findRoot(parent, a);
+  b = findRoot(parent, b);
+  if (a < b)
+    parent[b] = a;
+  else if (b < a)
+    parent[a] = b;
+}
+
+// --------------------------------------------------------------------------
+// get the cell extent and the point coordinates along the axes
+int getGeometry(BlockLabels &b)
+{
+  int ext[6];
+  if (vtkImageData *im = dynamic_cast<vtkImageData*>(b.Data))
+    {
+    im->GetExtent(ext);
+    double *origin = im->GetOrigin();
+    double *spacing = im->GetSpacing();
+    for (int q = 0; q < 3; ++q)
+      {
+      int n = ext[2*q+1] - ext[2*q] + 1;
+      b.Edges[q].resize(n);
+      for (int l = 0; l < n; ++l)
+        b.Edges[q][l] = origin[q] + spacing[q]*(ext[2*q] + l);
+      }
+    }
+  else if (vtkRectilinearGrid *rg = dynamic_cast<vtkRectilinearGrid*>(b.Data))
+    {
+    rg->GetExtent(ext);
+    vtkDataArray *coords[3] = {rg->GetXCoordinates(),
+      rg->GetYCoordinates(), rg->GetZCoordinates()};
+    for (int q = 0; q < 3; ++q)
+      {
+      int n = ext[2*q+1] - ext[2*q] + 1;
+      b.Edges[q].resize(n);
+      for (int l = 0; l < n; ++l)
+        b.Edges[q][l] = coords[q]->GetTuple1(l);
+      }
+    }
+  else
+    {
+    return -1;
+    }
+
+  // an axis of a single point, as in 2D, has one layer of cells
+  for (int q = 0; q < 3; ++q)
+    {
+    b.Ext[2*q] = ext[2*q];
+    b.Ext[2*q+1] = std::max(ext[2*q], ext[2*q+1] - 1);
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+// the center and length of the l'th cell along an axis
+void cellSpan(const std::vector<double> &edges, int l, double &center,
+  double &length)
+{
+  if (edges.size() < 2)
+    {
+    center = edges[0];
+    length = 1.0;
+    return;
+    }
+
+  center = 0.5*(edges[l] + edges[l+1]);
+  length = edges[l+1] - edges[l];
+}
+
+// --------------------------------------------------------------------------
+// label the cells that pass the threshold. the cells are joined to their
+// -x, -y and -z neighbors in one pass, and the sets numbered and summed
+// in a second
+template <typename T>
+void labelCells(BlockLabels &b, const T *vals, double threshold, bool below)
+{
+  long nx = b.Ext[1] - b.Ext[0] + 1;
+  long ny = b.Ext[3] - b.Ext[2] + 1;
+  long nz = b.Ext[5] - b.Ext[4] + 1;
+  long nxy = nx*ny;
+  long n = nxy*nz;
+
+  std::vector<int> parent(n, -1);
+
+  for (long k = 0; k < nz; ++k)
+    {
+    for (long j = 0; j < ny; ++j)
+      {
+      for (long i = 0; i < nx; ++i)
+        {
+        int id = i + nx*j + nxy*k;
+
+        if (b.Ghosts && b.Ghosts[id])
+          continue;
+
+        double v = vals ? static_cast<double>(vals[id]) :
+          b.Array->GetComponent(id, 0);
+
+        if (!(below ? v < threshold : v > threshold))
+          continue;
+
+        parent[id] = id;
+
+        if (i && (parent[id-1] >= 0))
+          unite(parent, id - 1, id);
+
+        if (j && (parent[id-nx] >= 0))
+          unite(parent, static_cast<int>(id - nx), id);
+
+        if (k && (parent[id-nxy] >= 0))
+          unite(parent, static_cast<int>(id - nxy), id);
+        }
+      }
+    }
+
+  // the root is the first cell of its set, and is labeled before the rest
+  b.Labels.assign(n, -1);
+  b.LabelSums.clear();
+
+  for (long k = 0; k < nz; ++k)
+    {
+    double zc, dz;
+    cellSpan(b.Edges[2], k, zc, dz);
+
+    for (long j = 0; j < ny; ++j)
+      {
+      double yc, dy;
+      cellSpan(b.Edges[1], j, yc, dy);
+
+      for (long i = 0; i < nx; ++i)
+        {
+        int id = i + nx*j + nxy*k;
+        if (parent[id] < 0)
+          continue;
+
+        int root = findRoot(parent, id);
+
+        int label = b.Labels[root];
+        if (root == id)
+          {
+          label = b.LabelSums.size();
+          b.LabelSums.push_back(emptySums(below));
+          }
+        b.Labels[id] = label;
+
+        double xc, dx;
+        cellSpan(b.Edges[0], i, xc, dx);
+
+        double v = vals ? static_cast<double>(vals[id]) :
+          b.Array->GetComponent(id, 0);
+
+        double vol = dx*dy*dz;
+
+        Sums &s = b.LabelSums[label];
+        s.Cells += 1.0;
+        s.Volume += vol;
+        s.X[0] += xc*vol;
+        s.X[1] += yc*vol;
+        s.X[2] += zc*vol;
+        s.Extreme = below ? std::min(s.Extreme, v) : std::max(s.Extreme, v);
+        s.Integral += v*vol;
+        }
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+// find the labeled cells next to cells the block does not have, ghosts or
+// those outside of its extent. these are where labels of other blocks may
+// touch them. axes of a single point have no neighbors
+void findLinks(BlockLabels &b)
+{
+  long nx = b.Ext[1] - b.Ext[0] + 1;
+  long ny = b.Ext[3] - b.Ext[2] + 1;
+  long nz = b.Ext[5] - b.Ext[4] + 1;
+  long nxy = nx*ny;
+  long dims[3] = {nx, ny, nz};
+  long stride[3] = {1, nx, nxy};
+
+  bool active[3];
+  for (int q = 0; q < 3; ++q)
+    active[q] = b.Edges[q].size() > 1;
+
+  b.Links.clear();
+
+  for (long k = 0; k < nz; ++k)
+    {
+    for (long j = 0; j < ny; ++j)
+      {
+      for (long i = 0; i < nx; ++i)
+        {
+        long id = i + nx*j + nxy*k;
+        int label = b.Labels[id];
+        if (label < 0)
+          continue;
+
+        long ijk[3] = {i, j, k};
+        bool owner = false;
+
+        for (int q = 0; q < 3; ++q)
+          {
+          if (!active[q])
+            continue;
+
+          for (int s = -1; s < 2; s += 2)
+            {
+            long l = ijk[q] + s;
+            bool outside = (l < 0) || (l >= dims[q]) ||
+              (b.Ghosts && b.Ghosts[id + s*stride[q]]);
+
+            if (!outside)
+              continue;
+
+            long long nijk[3] = {b.Ext[0] + i, b.Ext[2] + j, b.Ext[4] + k};
+            nijk[q] += s;
+
+            b.Links.push_back(Link{packIndex(nijk[0], nijk[1], nijk[2]),
+              label, 0});
+
+            owner = true;
+            }
+          }
+
+        if (owner)
+          b.Links.push_back(Link{packIndex(b.Ext[0] + i, b.Ext[2] + j,
+            b.Ext[4] + k), label, 1});
+        }
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+// label the cells of a block, see ArrayDispatch
+struct LabelKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    labelCells(*this->Block, vals, this->Threshold, this->Below);
+  }
+
+  BlockLabels *Block;
+  double Threshold;
+  bool Below;
+};
+
+// --------------------------------------------------------------------------
+int labelBlock(BlockLabels &b, double threshold, bool below)
+{
+  LabelKernel kernel{&b, threshold, below};
+  sensei::ArrayDispatch::Execute(b.Array, kernel);
+
+  findLinks(b);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+// send the values in out[i] to rank i and receive those sent to this rank
+template <typename T>
+void exchange(MPI_Comm comm, const std::vector<std::vector<T>> &out,
+  std::vector<T> &in)
+{
+  int nRanks = out.size();
+
+  MPI_Datatype type;
+  MPI_Type_contiguous(sizeof(T), MPI_BYTE, &type);
+  MPI_Type_commit(&type);
+
+  std::vector<int> sendCounts(nRanks);
+  std::vector<int> sendDispls(nRanks);
+  std::vector<int> recvCounts(nRanks);
+  std::vector<int> recvDispls(nRanks);
+
+  std::vector<T> sendBuf;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    sendCounts[i] = out[i].size();
+    sendDispls[i] = sendBuf.size();
+    sendBuf.insert(sendBuf.end(), out[i].begin(), out[i].end());
+    }
+
+  MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT,
+    comm);
+
+  int nRecv = 0;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    recvDispls[i] = nRecv;
+    nRecv += recvCounts[i];
+    }
+
+  in.resize(nRecv);
+
+  MPI_Alltoallv(sendBuf.data(), sendCounts.data(), sendDispls.data(), type,
+    in.data(), recvCounts.data(), recvDispls.data(), type, comm);
+
+  MPI_Type_free(&type);
+}
+
+// --------------------------------------------------------------------------
+// gather the values of all ranks on rank 0, in rank order, and the number
+// from each
+template <typename T>
+void gather(MPI_Comm comm, const std::vector<T> &local, std::vector<T> &all,
+  std::vector<int> &counts)
+{
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  MPI_Datatype type;
+  MPI_Type_contiguous(sizeof(T), MPI_BYTE, &type);
+  MPI_Type_commit(&type);
+
+  int nLocal = local.size();
+  counts.assign(nRanks, 0);
+  MPI_Gather(&nLocal, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+
+  std::vector<int> displ(nRanks, 0);
+  int nTotal = 0;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    displ[i] = nTotal;
+    nTotal += counts[i];
+    }
+
+  all.resize(rank ? 0 : nTotal);
+
+  MPI_Gatherv(local.data(), nLocal, type, all.data(), counts.data(),
+    displ.data(), type, 0, comm);
+
+  MPI_Type_free(&type);
+}
+}
+
+namespace sensei
+{
+
+//-----------------------------------------------------------------------------
+senseiNewMacro(ConnectedComponents);
+
+//-----------------------------------------------------------------------------
+ConnectedComponents::ConnectedComponents() : Threshold(0.0), Below(false),
+  MinCells(1), Threads(1), NextId(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+ConnectedComponents::~ConnectedComponents()
+{
+}
+
+//-----------------------------------------------------------------------------
+void ConnectedComponents::Initialize(const std::string &meshName,
+  const std::string &arrayName, double threshold, bool below,
+  long long minCells, const std::string &fileName)
+{
+  this->MeshName = meshName;
+  this->ArrayName = arrayName;
+  this->Threshold = threshold;
+  this->Below = below;
+  this->MinCells = minCells;
+  this->FileName = fileName;
+
+  this->Features.clear();
+  this->CellIds.clear();
+  this->NextId = 0;
+}
+
+//-----------------------------------------------------------------------------
+void ConnectedComponents::SetNumberOfThreads(int nThreads)
+{
+  this->Threads = nThreads < 1 ? TaskRuntime::GetNumberOfThreads() : nThreads;
+}
+
+//-----------------------------------------------------------------------------
+const char *ConnectedComponents::GetGhostArrayName()
+{
+#if VTK_MAJOR_VERSION == 6 && VTK_MINOR_VERSION == 1
+    return "vtkGhostType";
+#else
+    return vtkDataSetAttributes::GhostArrayName();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+bool ConnectedComponents::Execute(DataAdaptor* data)
+{
+  TimeEvent<128> mark("ConnectedComponents::Execute");
+
+  MPI_Comm comm = this->GetCommunicator();
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  int step = data->GetDataTimeStep();
+  double time = data->GetDataTime();
+
+  // fetch the mesh and the array. errors are reported but processing
+  // continues so that all ranks take part in the communication below
+  bool status = true;
+  vtkCompositeDataSetPtr mesh;
+
+  MeshMetadataFlags flags;
+  flags.SetBlockDecomp();
+
+  MeshMetadataMap mdMap;
+  MeshMetadataPtr mmd;
+  vtkDataObject* dobj = nullptr;
+
+  if (mdMap.Initialize(data, flags) ||
+    mdMap.GetMeshMetadata(this->MeshName, mmd))
+    {
+    SENSEI_ERROR("Failed to get metadata for mesh \"" << this->MeshName << "\"")
+    status = false;
+    }
+  else if (data->GetMesh(this->MeshName, false, dobj))
+    {
+    SENSEI_ERROR("Failed to get mesh \"" << this->MeshName << "\"")
+    status = false;
+    }
+  else if (dobj)
+    {
+    mesh = VTKUtils::AsCompositeData(comm, dobj, true);
+
+    if (mmd->NumGhostCells && data->AddGhostCellsArray(mesh, this->MeshName))
+      {
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost cells.")
+      status = false;
+      mesh = nullptr;
+      }
+    else if (data->AddArray(mesh, this->MeshName, vtkDataObject::CELL,
+      this->ArrayName))
+      {
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add cell data"
+        " array \""  << this->ArrayName << "\"")
+      status = false;
+      mesh = nullptr;
+      }
+    }
+
+  // find the blocks to label
+  std::vector<BlockLabels> blocks;
+  if (mesh)
+    {
+    vtkSmartPointer<vtkCompositeDataIterator> iter;
+    iter.TakeReference(mesh->NewIterator());
+
+    for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
+      {
+      BlockLabels b;
+      b.Data = dynamic_cast<vtkDataSet*>(iter->GetCurrentDataObject());
+      b.Id = VTKUtils::GetBlockId(mesh, iter);
+      b.Offset = 0;
+
+      if (!b.Data || getGeometry(b))
+        {
+        SENSEI_ERROR("Block " << b.Id << " is a "
+          << iter->GetCurrentDataObject()->GetClassName() << " but"
+          " vtkImageData or vtkRectilinearGrid is required")
+        status = false;
+        continue;
+        }
+
+      b.Array = b.Data->GetCellData()->GetArray(this->ArrayName.c_str());
+      if (!b.Array)
+        {
+        SENSEI_WARNING("Dataset " << iter->GetCurrentFlatIndex()
+          << " has no array named \"" << this->ArrayName << "\"")
+        continue;
+        }
+
+      if ((b.Array->GetNumberOfComponents() != 1) ||
+        (b.Array->GetNumberOfTuples() != b.Data->GetNumberOfCells()))
+        {
+        SENSEI_ERROR("Array \"" << this->ArrayName << "\" must have one"
+          " component and a value per cell")
+        status = false;
+        continue;
+        }
+
+      vtkUnsignedCharArray *ghostArray = dynamic_cast<vtkUnsignedCharArray*>(
+        b.Data->GetCellData()->GetArray(this->GetGhostArrayName()));
+
+      b.Ghosts = ghostArray ? ghostArray->GetPointer(0) : nullptr;
+
+      blocks.push_back(std::move(b));
+      }
+    }
+
+  // label the blocks
+  int nBlocks = blocks.size();
+  {
+  TimeEvent<128> mark("ConnectedComponents::Label");
+  if (TaskRuntime::ParallelFor(nBlocks, this->Threads,
+    [&](int, long i) -> int
+    {
+    return labelBlock(blocks[i], this->Threshold, this->Below);
+    }))
+    {
+    SENSEI_ERROR("Unsupported type of array \"" << this->ArrayName << "\"")
+    status = false;
+    for (int i = 0; i < nBlocks; ++i)
+      {
+      blocks[i].Labels.assign(blocks[i].Labels.size(), -1);
+      blocks[i].LabelSums.clear();
+      blocks[i].Links.clear();
+      }
+    }
+  }
+
+  // number the labels over the rank and then over all ranks
+  long long nLocal = 0;
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    blocks[i].Offset = nLocal;
+    nLocal += blocks[i].LabelSums.size();
+    }
+
+  long long rankOffset = 0;
+  MPI_Exscan(&nLocal, &rankOffset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+  if (rank == 0)
+    rankOffset = 0;
+
+  // send the boundary cells to the ranks where those of the neighboring
+  // blocks meet, and join the labels of the cells that touch
+  std::vector<Edge> edges;
+  {
+  TimeEvent<128> mark("ConnectedComponents::Join");
+
+  std::vector<std::vector<Link>> out(nRanks);
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    for (Link l : blocks[i].Links)
+      {
+      l.Label += rankOffset + blocks[i].Offset;
+      out[hashRank(l.Key, nRanks)].push_back(l);
+      }
+    std::vector<Link>().swap(blocks[i].Links);
+    }
+
+  std::vector<Link> in;
+  exchange(comm, out, in);
+
+  std::sort(in.begin(), in.end(), [](const Link &a, const Link &b)
+    { return std::tie(a.Key, a.Owner) > std::tie(b.Key, b.Owner); });
+
+  // the owners of a cell come first, the cells of other blocks next to it
+  // are joined to it
+  size_t nIn = in.size();
+  for (size_t i = 0; i < nIn;)
+    {
+    size_t j = i;
+    while ((j < nIn) && (in[j].Key == in[i].Key))
+      ++j;
+
+    if (in[i].Owner)
+      {
+      for (size_t q = i + 1; q < j; ++q)
+        {
+        if (in[q].Label != in[i].Label)
+          edges.push_back(Edge{in[i].Label, in[q].Label});
+        }
+      }
+
+    i = j;
+    }
+
+  std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b)
+    { return std::tie(a.A, a.B) < std::tie(b.A, b.B); });
+
+  edges.erase(std::unique(edges.begin(), edges.end(),
+    [](const Edge &a, const Edge &b) { return (a.A == b.A) && (a.B == b.B); }),
+    edges.end());
+  }
+
+  // the overlaps of the labels with the features of the last step
+  std::vector<Overlap> overlaps;
+  {
+  std::map<std::pair<int,long long>, long long> counts;
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    const BlockLabels &b = blocks[i];
+
+    std::map<int, std::vector<int>>::iterator it = this->CellIds.find(b.Id);
+    if ((it == this->CellIds.end()) || (it->second.size() != b.Labels.size()))
+      continue;
+
+    const std::vector<int> &ids = it->second;
+    size_t n = ids.size();
+    for (size_t j = 0; j < n; ++j)
+      {
+      if ((ids[j] >= 0) && (b.Labels[j] >= 0))
+        ++counts[std::make_pair(ids[j], rankOffset + b.Offset + b.Labels[j])];
+      }
+    }
+
+  for (auto &c : counts)
+    overlaps.push_back(Overlap{c.first.first, c.first.second, c.second});
+  }
+
+  // gather the sums, the edges and the overlaps on rank 0
+  std::vector<Sums> localSums;
+  for (int i = 0; i < nBlocks; ++i)
+    localSums.insert(localSums.end(), blocks[i].LabelSums.begin(),
+      blocks[i].LabelSums.end());
+
+  std::vector<Sums> allSums;
+  std::vector<int> labelCounts;
+  gather(comm, localSums, allSums, labelCounts);
+
+  std::vector<Edge> allEdges;
+  std::vector<int> unused;
+  gather(comm, edges, allEdges, unused);
+
+  std::vector<Overlap> allOverlaps;
+  gather(comm, overlaps, allOverlaps, unused);
+
+  // join the labels into features and track them
+  std::vector<int> labelIds;
+  if (rank == 0)
+    {
+    TimeEvent<128> mark("ConnectedComponents::Track");
+
+    long long nLabels = allSums.size();
+
+    std::vector<long long> parent(nLabels);
+    std::iota(parent.begin(), parent.end(), 0ll);
+
+    for (const Edge &e : allEdges)
+      unite(parent, e.A, e.B);
+
+    // the root of a set is its smallest label, and is met first
+    std::vector<long long> featureOf(nLabels, -1);
+    std::vector<Sums> sums;
+    for (long long l = 0; l < nLabels; ++l)
+      {
+      long long r = findRoot(parent, l);
+      if (featureOf[r] < 0)
+        {
+        featureOf[r] = sums.size();
+        sums.push_back(emptySums(this->Below));
+        }
+      featureOf[l] = featureOf[r];
+      merge(sums[featureOf[l]], allSums[l], this->Below);
+      }
+
+    long long nFeatures = sums.size();
+
+    std::vector<bool> keep(nFeatures);
+    for (long long f = 0; f < nFeatures; ++f)
+      keep[f] = sums[f].Cells >= this->MinCells;
+
+    // the overlaps of the features with those of the last step, largest
+    // first. a feature continues the largest overlapped feature that does
+    // not continue in a larger overlap
+    std::map<std::pair<long long,long long>, long long> overlapCounts;
+    for (const Overlap &o : allOverlaps)
+      {
+      long long f = featureOf[o.Label];
+      if (keep[f])
+        overlapCounts[std::make_pair(o.Id, f)] += o.Count;
+      }
+
+    std::vector<std::tuple<long long,long long,long long>> ranked;
+    for (auto &o : overlapCounts)
+      ranked.emplace_back(o.second, o.first.first, o.first.second);
+
+    std::sort(ranked.begin(), ranked.end(),
+      [](const std::tuple<long long,long long,long long> &a,
+        const std::tuple<long long,long long,long long> &b)
+      {
+      return (std::get<0>(a) > std::get<0>(b)) ||
+        ((std::get<0>(a) == std::get<0>(b)) &&
+        (std::tie(std::get<1>(a), std::get<2>(a)) <
+        std::tie(std::get<1>(b), std::get<2>(b))));
+      });
+
+    std::vector<int> ids(nFeatures, -1);
+    std::vector<std::vector<int>> parents(nFeatures);
+    std::set<long long> continued;
+    for (auto &o : ranked)
+      {
+      long long id = std::get<1>(o);
+      long long f = std::get<2>(o);
+
+      parents[f].push_back(id);
+
+      if ((ids[f] < 0) && !continued.count(id))
+        {
+        ids[f] = id;
+        continued.insert(id);
+        }
+      }
+
+    this->Features.clear();
+    for (long long f = 0; f < nFeatures; ++f)
+      {
+      if (!keep[f])
+        continue;
+
+      if (ids[f] < 0)
+        ids[f] = this->NextId++;
+
+      const Sums &s = sums[f];
+      double vol = s.Volume > 0.0 ? s.Volume : 1.0;
+
+      Feature feature;
+      feature.Id = ids[f];
+      feature.Cells = static_cast<long long>(s.Cells);
+      feature.Volume = s.Volume;
+      feature.Centroid[0] = s.X[0]/vol;
+      feature.Centroid[1] = s.X[1]/vol;
+      feature.Centroid[2] = s.X[2]/vol;
+      feature.Extreme = s.Extreme;
+      feature.Integral = s.Integral;
+      feature.Parents.swap(parents[f]);
+
+      this->Features.push_back(feature);
+      }
+
+    std::sort(this->Features.begin(), this->Features.end(),
+      [](const Feature &a, const Feature &b) { return a.Id < b.Id; });
+
+    labelIds.resize(nLabels);
+    for (long long l = 0; l < nLabels; ++l)
+      labelIds[l] = keep[featureOf[l]] ? ids[featureOf[l]] : -1;
+    }
+
+  // send the ids of the features back to the ranks, and keep those of the
+  // cells for the next step
+  std::vector<int> displ(nRanks, 0);
+  for (int i = 1; rank == 0 && i < nRanks; ++i)
+    displ[i] = displ[i-1] + labelCounts[i-1];
+
+  std::vector<int> localIds(nLocal);
+  MPI_Scatterv(labelIds.data(), labelCounts.data(), displ.data(), MPI_INT,
+    localIds.data(), nLocal, MPI_INT, 0, comm);
+
+  this->CellIds.clear();
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    const BlockLabels &b = blocks[i];
+
+    size_t n = b.Labels.size();
+    std::vector<int> &ids = this->CellIds[b.Id];
+    ids.resize(n);
+
+    for (size_t j = 0; j < n; ++j)
+      ids[j] = b.Labels[j] < 0 ? -1 : localIds[b.Offset + b.Labels[j]];
+    }
+
+  if (this->WriteResults(step, time))
+    status = false;
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+int ConnectedComponents::WriteResults(int step, double time)
+{
+  int rank = 0;
+  MPI_Comm_rank(this->GetCommunicator(), &rank);
+
+  if (rank != 0)
+    return 0;
+
+  FILE *file = stdout;
+  if (this->FileName.empty())
+    {
+    std::cout << "ConnectedComponents mesh \"" << this->MeshName
+      << "\" data array \"" << this->ArrayName << "\" step " << step
+      << " time " << time << " features " << this->Features.size()
+      << std::endl;
+    }
+  else
+    {
+    char fname[1024] = {'\0'};
+    snprintf(fname, 1024, "%s_%s_%s_%d_features.txt", this->FileName.c_str(),
+      this->MeshName.c_str(), this->ArrayName.c_str(), step);
+
+    file = fopen(fname, "w");
+    if (!file)
+      {
+      char *estr = strerror(errno);
+      SENSEI_ERROR("Failed to open \"" << fname << "\""
+        << std::endl << estr)
+      return -1;
+      }
+
+    fprintf(file, "step : %d\n", step);
+    fprintf(file, "time : %0.6g\n", time);
+    }
+
+  fprintf(file, "id cells volume cx cy cz extreme integral parents\n");
+  for (const Feature &f : this->Features)
+    {
+    fprintf(file, "%d %lld %0.9g %0.9g %0.9g %0.9g %0.9g %0.9g ", f.Id,
+      f.Cells, f.Volume, f.Centroid[0], f.Centroid[1], f.Centroid[2],
+      f.Extreme, f.Integral);
+
+    size_t nParents = f.Parents.size();
+    if (!nParents)
+      fprintf(file, "-");
+
+    for (size_t i = 0; i < nParents; ++i)
+      fprintf(file, i ? ",%d" : "%d", f.Parents[i]);
+
+    fprintf(file, "\n");
+    }
+
+  if (file == stdout)
+    fflush(file);
+  else
+    fclose(file);
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int ConnectedComponents::GetFeatures(std::vector<Feature> &features)
+{
+  features = this->Features;
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int ConnectedComponents::Finalize()
+{
+  this->Features.clear();
+  this->CellIds.clear();
+  return 0;
+}
+
+}
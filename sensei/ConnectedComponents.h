@@ -0,0 +1,115 @@
+#ifndef sensei_ConnectedComponents_h
+#define sensei_ConnectedComponents_h
+
+#include "AnalysisAdaptor.h"
+#include <mpi.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class vtkDataArray;
+class vtkDataObject;
+
+namespace sensei
+{
+
+/// @class ConnectedComponents
+/// @brief Extracts and tracks the connected regions where a cell array is
+/// above, or below, a threshold.
+///
+/// The cells of each block that pass the threshold are labeled by a union
+/// find over their face neighbors, the blocks on the TaskRuntime's
+/// threads. The labels are joined across blocks and ranks by exchanging
+/// the cells on the boundaries of the blocks, each sent to a rank chosen
+/// by hashing its global i,j,k index, where those of neighboring blocks
+/// meet. The links between labels, and each label's cell count, volume,
+/// volume weighted centroid, extreme value and integral, are gathered to
+/// rank 0, which joins them into features. Only the features and the
+/// links, not the cells, are communicated.
+///
+/// Features are tracked by their overlap with those of the previous step.
+/// Each rank keeps the feature id of its cells, a feature keeps the id of
+/// the previous feature it overlaps most, that no other overlaps more,
+/// and the ids of all of the previous features it overlaps are listed as
+/// its parents, from which merges and splits can be read. Other features
+/// get new ids. Tracking assumes that the blocks stay on the same ranks.
+///
+/// The mesh must be made of vtkImageData or vtkRectilinearGrid blocks,
+/// whose extents give the global i,j,k index of the cells. Ghost cells,
+/// marked by the vtkGhostType cell array, are skipped. The feature table
+/// is written by rank 0 to <file>_<mesh>_<array>_<step>_features.txt, or
+/// to cout when no file is given.
+class ConnectedComponents : public AnalysisAdaptor
+{
+public:
+  static ConnectedComponents* New();
+  senseiTypeMacro(ConnectedComponents, AnalysisAdaptor);
+
+  /// a feature found in a step
+  struct Feature
+  {
+    int Id;                     // the same in the steps it is tracked over
+    long long Cells;            // the number of cells
+    double Volume;              // the volume, or the area in 2D
+    double Centroid[3];         // the volume weighted center
+    double Extreme;             // the largest value, the smallest if below
+    double Integral;            // the sum of value times volume
+    std::vector<int> Parents;   // the overlapped features of the last step
+  };
+
+  /// @brief Set up the analysis.
+  ///
+  /// @param meshName the mesh
+  /// @param arrayName the cell array thresholded
+  /// @param threshold cells with values above it are in features
+  /// @param below when set the cells below the threshold are instead
+  /// @param minCells features of fewer cells are dropped
+  /// @param fileName the prefix of the output files, or empty
+  void Initialize(const std::string &meshName, const std::string &arrayName,
+    double threshold, bool below, long long minCells,
+    const std::string &fileName);
+
+  /// set the number of threads used to label the blocks. the threads are
+  /// those of the TaskRuntime, a value less than 1 uses all of them. the
+  /// default is 1.
+  void SetNumberOfThreads(int nThreads);
+
+  bool Execute(DataAdaptor* data) override;
+
+  int Finalize() override;
+
+  /// get the features of the last step on rank 0, ordered by id
+  int GetFeatures(std::vector<Feature> &features);
+
+protected:
+  ConnectedComponents();
+  ~ConnectedComponents();
+
+  ConnectedComponents(const ConnectedComponents&) = delete;
+  void operator=(const ConnectedComponents&) = delete;
+
+  // write the features of the last step
+  int WriteResults(int step, double time);
+
+  static const char *GetGhostArrayName();
+
+  std::string MeshName;
+  std::string ArrayName;
+  double Threshold;
+  bool Below;
+  long long MinCells;
+  std::string FileName;
+  int Threads;
+
+  // the features of the last step on rank 0, and the next new id
+  std::vector<Feature> Features;
+  int NextId;
+
+  // the feature id of the cells of the last step, -1 outside of
+  // features, by block id
+  std::map<int, std::vector<int>> CellIds;
+};
+
+}
+
+#endif
@@ -1,15 +1,32 @@
 #include "DataAdaptor.h"
+#include "DataRequirements.h"
 #include "MeshMetadata.h"
 #include "VTKUtils.h"
+#include "STLUtils.h"
+#include "MPIUtils.h"
+#include "Profiler.h"
 #include "Error.h"
 
 #include <vtkDataObject.h>
+#include <vtkDataArray.h>
+#include <vtkDataSet.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkFieldData.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkPointData.h>
+#include <vtkCellData.h>
 #include <vtkCompositeDataSet.h>
+#include <vtkCompositeDataIterator.h>
 #include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
 
+#include <algorithm>
+#include <cstring>
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
+#include <tuple>
 #include <utility>
 
 namespace sensei
@@ -17,15 +34,81 @@ namespace sensei
 
 struct DataAdaptor::InternalsType
 {
-  InternalsType() : Time(0.0), TimeStep(0) {}
+  InternalsType() : Time(0.0), TimeStep(0), HostArrayStep(0),
+    HaveAnalysisRequirements(false),
+    GlobalViewMode(DataAdaptor::GLOBAL_VIEW_FLAT) {}
   ~InternalsType() {}
 
-  MeshMetadataFlags Flags;
-  std::vector<MeshMetadataPtr> Metadata;
+  // metadata of static meshes, and of the others until the end of the
+  // step, see GetCachedMeshMetadata and ClearTransientMeshMetadata
+  struct MetadataCacheEntry
+  {
+    MeshMetadataFlags Flags;
+    MeshMetadataPtr Local;
+    MeshMetadataPtr Global;
+
+    // the exchange of the block array ranges, repeated every step
+    std::shared_ptr<MPIUtils::GlobalViewPlan<double>> RangePlan;
+  };
+
+  std::vector<MetadataCacheEntry> Metadata;
   double Time;
   long TimeStep;
+
+  // host copies of device arrays, see GetHostArray. indexed by mesh name,
+  // association, array name, and block
+  using HostArrayKey = std::tuple<std::string, int, std::string, int>;
+  std::map<HostArrayKey, vtkSmartPointer<vtkDataArray>> HostArrays;
+  long HostArrayStep;
+
+  // static meshes, see GetCachedMesh. indexed by mesh name and structure
+  // only flag
+  struct MeshCacheEntry
+  {
+    vtkSmartPointer<vtkDataObject> Mesh;
+    long TimeStep;
+  };
+
+  using MeshCacheKey = std::pair<std::string, bool>;
+  std::map<MeshCacheKey, MeshCacheEntry> Meshes;
+
+  // the data the analyses will access, see SetAnalysisRequirements
+  DataRequirements AnalysisRequirements;
+  bool HaveAnalysisRequirements;
+
+  // how global views are made, see SetGlobalViewMode. the node and leader
+  // communicators are made on first use
+  int GlobalViewMode;
+  std::shared_ptr<MPIUtils::HierarchicalComm> NodeComm;
 };
 
+namespace
+{
+// remove all but the ghost arrays
+void removeArrays(vtkDataSetAttributes *fd)
+{
+  for (int i = fd->GetNumberOfArrays() - 1; i >= 0; --i)
+    {
+    const char *name = fd->GetAbstractArray(i)->GetName();
+    if (!name || strcmp(name, "vtkGhostType"))
+      fd->RemoveArray(i);
+    }
+}
+
+// remove the point and cell data arrays of a mesh
+void removeMeshArrays(vtkDataObject *dobj)
+{
+  VTKUtils::DatasetFunction func = [](vtkDataSet *ds) -> int
+    {
+    removeArrays(ds->GetPointData());
+    removeArrays(ds->GetCellData());
+    return 0;
+    };
+
+  VTKUtils::Apply(dobj, func);
+}
+}
+
 //----------------------------------------------------------------------------
 DataAdaptor::DataAdaptor()
 {
@@ -43,11 +126,26 @@ DataAdaptor::~DataAdaptor()
 //----------------------------------------------------------------------------
 int DataAdaptor::SetCommunicator(MPI_Comm comm)
 {
+  // the node communicators are split from the old communicator
+  this->Internals->NodeComm = nullptr;
+
   MPI_Comm_free(&this->Comm);
   MPI_Comm_dup(comm, &this->Comm);
   return 0;
 }
 
+//----------------------------------------------------------------------------
+void DataAdaptor::SetGlobalViewMode(int mode)
+{
+  this->Internals->GlobalViewMode = mode;
+}
+
+//----------------------------------------------------------------------------
+int DataAdaptor::GetGlobalViewMode() const
+{
+  return this->Internals->GlobalViewMode;
+}
+
 //----------------------------------------------------------------------------
 double DataAdaptor::GetDataTime()
 {
@@ -72,6 +170,242 @@ void DataAdaptor::SetDataTimeStep(long index)
   this->Internals->TimeStep = index;
 }
 
+//----------------------------------------------------------------------------
+int DataAdaptor::GetCachedMeshMetadata(unsigned int id,
+  const MeshMetadataFlags &flags, bool globalView, MeshMetadataPtr &metadata)
+{
+  unsigned int nMeshes = 0;
+  if (this->GetNumberOfMeshes(nMeshes))
+    {
+    SENSEI_ERROR("Failed to get the number of meshes")
+    return -1;
+    }
+
+  if (id >= nMeshes)
+    {
+    SENSEI_ERROR("Index " << id << " out of bounds")
+    return -1;
+    }
+
+  // the set of meshes changed, start over
+  if (this->Internals->Metadata.size() != nMeshes)
+    {
+    this->Internals->Metadata.clear();
+    this->Internals->Metadata.resize(nMeshes);
+    }
+
+  InternalsType::MetadataCacheEntry &entry = this->Internals->Metadata[id];
+
+  // array ranges are expected to change even when the mesh does not
+  MeshMetadataFlags meshFlags = flags;
+  meshFlags.ClearBlockArrayRange();
+
+  // the metadata of a mesh that changes is reused until the end of the
+  // step, such as for a global view requested after the local one
+  bool current = entry.Local && !entry.Local->StaticMesh &&
+    entry.Flags.Contains(flags);
+
+  bool cached = entry.Local && entry.Local->StaticMesh &&
+    entry.Flags.Contains(meshFlags);
+
+  if (!current && (!cached || flags.BlockArrayRangeSet()))
+    {
+    // keep the fields that are cached for later use
+    MeshMetadataFlags reqFlags = flags;
+    if (cached)
+      reqFlags.Merge(entry.Flags);
+
+    MeshMetadataPtr md = MeshMetadata::New(reqFlags);
+    if (this->GetMeshMetadata(id, md))
+      {
+      SENSEI_ERROR("Failed to get metadata for mesh " << id)
+      return -1;
+      }
+
+    if (!md->StaticMesh)
+      {
+      // nothing to reuse in later steps
+      entry = InternalsType::MetadataCacheEntry();
+      }
+    else if (cached && entry.Global)
+      {
+      // only the array ranges need a global view
+      TimeEvent<128> mark("DataAdaptor::GetCachedMeshMetadata");
+
+      entry.Global->BlockArrayRange = md->BlockArrayRange;
+      entry.Global->ArrayRange = md->ArrayRange;
+
+      // the blocks are the same every step and so is the exchange
+      if (!md->GlobalView)
+        {
+        int nArrays = md->NumArrays;
+        unsigned long nLocal = md->BlockArrayRange.size();
+
+        std::vector<double> lranges;
+        lranges.reserve(2*nArrays*nLocal);
+        for (unsigned long i = 0; i < nLocal; ++i)
+          {
+          for (int j = 0; j < nArrays; ++j)
+            {
+            lranges.push_back(md->BlockArrayRange[i][j][0]);
+            lranges.push_back(md->BlockArrayRange[i][j][1]);
+            }
+          }
+
+        if (!entry.RangePlan)
+          {
+          entry.RangePlan = std::make_shared<MPIUtils::GlobalViewPlan<double>>();
+          entry.RangePlan->Initialize(this->GetCommunicator(), lranges.size());
+          }
+
+        std::vector<double> granges;
+        if (entry.RangePlan->Execute(lranges, granges))
+          {
+          SENSEI_ERROR("The block array ranges of static mesh " << id
+            << " changed size")
+          return -1;
+          }
+
+        unsigned long nBlocks = nArrays ? granges.size()/(2*nArrays) :
+          entry.Global->BlockArrayRange.size();
+
+        std::vector<std::vector<std::array<double,2>>> &range =
+          entry.Global->BlockArrayRange;
+
+        range.resize(nBlocks);
+        for (unsigned long i = 0, q = 0; i < nBlocks; ++i)
+          {
+          range[i].resize(nArrays);
+          for (int j = 0; j < nArrays; ++j, q += 2)
+            range[i][j] = {granges[q], granges[q + 1]};
+          }
+        }
+
+      STLUtils::ReduceRange(entry.Global->BlockArrayRange,
+        entry.Global->ArrayRange);
+      }
+    else
+      {
+      entry.Global = nullptr;
+      entry.RangePlan = nullptr;
+      }
+
+    entry.Local = md;
+    entry.Flags = reqFlags;
+    }
+
+  if (globalView)
+    {
+    if (!entry.Global)
+      {
+      entry.Global = entry.Local->NewCopy();
+
+      if (this->Internals->GlobalViewMode == GLOBAL_VIEW_HIERARCHICAL)
+        {
+        if (!this->Internals->NodeComm)
+          {
+          this->Internals->NodeComm =
+            std::make_shared<MPIUtils::HierarchicalComm>();
+          this->Internals->NodeComm->Initialize(this->GetCommunicator());
+          }
+
+        entry.Global->GlobalizeView(*this->Internals->NodeComm);
+        }
+      else
+        {
+        entry.Global->GlobalizeView(this->GetCommunicator());
+        }
+      }
+
+    metadata = entry.Global->NewCopy();
+    return 0;
+    }
+
+  metadata = entry.Local->NewCopy();
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void DataAdaptor::ClearMeshMetadataCache()
+{
+  this->Internals->Metadata.clear();
+  this->Internals->Meshes.clear();
+}
+
+//----------------------------------------------------------------------------
+void DataAdaptor::ClearTransientMeshMetadata()
+{
+  unsigned int nEntries = this->Internals->Metadata.size();
+  for (unsigned int i = 0; i < nEntries; ++i)
+    {
+    InternalsType::MetadataCacheEntry &entry = this->Internals->Metadata[i];
+    if (entry.Local && !entry.Local->StaticMesh)
+      entry = InternalsType::MetadataCacheEntry();
+    }
+}
+
+//----------------------------------------------------------------------------
+int DataAdaptor::GetCachedMesh(const MeshMetadataPtr &metadata,
+  bool structureOnly, vtkDataObject *&mesh)
+{
+  mesh = nullptr;
+
+  const std::string &meshName = metadata->MeshName;
+  InternalsType::MeshCacheKey key(meshName, structureOnly);
+
+  // nothing to reuse in later steps
+  if (!metadata->StaticMesh)
+    {
+    this->Internals->Meshes.erase(key);
+    return this->GetMesh(meshName, structureOnly, mesh);
+    }
+
+  long step = this->GetDataTimeStep();
+
+  auto it = this->Internals->Meshes.find(key);
+  if (it == this->Internals->Meshes.end())
+    {
+    vtkDataObject *dobj = nullptr;
+    if (this->GetMesh(meshName, structureOnly, dobj))
+      {
+      SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    InternalsType::MeshCacheEntry &entry = this->Internals->Meshes[key];
+    entry.Mesh.TakeReference(dobj);
+    entry.TimeStep = step;
+    }
+  else if (it->second.TimeStep != step)
+    {
+    // the arrays are from an earlier step
+    TimeEvent<128> mark("DataAdaptor::GetCachedMesh");
+    removeMeshArrays(it->second.Mesh);
+    it->second.Mesh->Modified();
+    it->second.TimeStep = step;
+    }
+
+  mesh = this->Internals->Meshes[key].Mesh.GetPointer();
+  mesh->Register(nullptr);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void DataAdaptor::ReleaseCachedMeshArrays()
+{
+  auto it = this->Internals->Meshes.begin();
+  auto end = this->Internals->Meshes.end();
+  for (; it != end; ++it)
+    removeMeshArrays(it->second.Mesh);
+}
+
+//----------------------------------------------------------------------------
+void DataAdaptor::ClearMeshCache()
+{
+  this->Internals->Meshes.clear();
+}
+
 //----------------------------------------------------------------------------
 int DataAdaptor::GetMesh(const std::string &meshName, bool structureOnly,
     vtkCompositeDataSet *&mesh)
@@ -95,6 +429,65 @@ int DataAdaptor::GetMesh(const std::string &meshName, bool structureOnly,
   return 0;
 }
 
+//----------------------------------------------------------------------------
+int DataAdaptor::GetMesh(const std::string &meshName, bool structureOnly,
+    const std::vector<int> &blockIds, vtkDataObject *&mesh)
+{
+  TimeEvent<128> mark("DataAdaptor::GetMeshBlocks");
+
+  mesh = nullptr;
+
+  // get the object from the simulation
+  if (this->GetMesh(meshName, structureOnly, mesh))
+    {
+    SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  // remove the blocks that were not requested. a legacy object is the
+  // rank's only block and is kept
+  vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(mesh);
+  if (!cd)
+    return 0;
+
+  std::vector<int> ids(blockIds);
+  std::sort(ids.begin(), ids.end());
+
+  vtkCompositeDataIterator *cdit = cd->NewIterator();
+  for (cdit->InitTraversal(); !cdit->IsDoneWithTraversal(); cdit->GoToNextItem())
+    {
+    int bid = std::max(0, VTKUtils::GetBlockId(cd, cdit));
+    if (!std::binary_search(ids.begin(), ids.end(), bid))
+      cd->SetDataSet(cdit, nullptr);
+    }
+  cdit->Delete();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int DataAdaptor::GetMesh(const std::string &meshName, bool structureOnly,
+    const std::vector<int> &blockIds, vtkCompositeDataSet *&mesh)
+{
+  mesh = nullptr;
+
+  // get the object from the simulation
+  vtkDataObject *dobj = nullptr;
+  if (this->GetMesh(meshName, structureOnly, blockIds, dobj))
+    {
+    SENSEI_ERROR("Failed to get blocks of mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  vtkCompositeDataSetPtr meshptr = VTKUtils::AsCompositeData(
+    this->GetCommunicator(), dobj, true);
+
+  mesh = meshptr.GetPointer();
+  mesh->Register(nullptr);
+
+  return 0;
+}
+
 //----------------------------------------------------------------------------
 int DataAdaptor::AddArrays(vtkDataObject* mesh, const std::string &meshName,
     int association, const std::vector<std::string> &arrayNames)
@@ -113,6 +506,253 @@ int DataAdaptor::AddArrays(vtkDataObject* mesh, const std::string &meshName,
   return 0;
 }
 
+//----------------------------------------------------------------------------
+int DataAdaptor::GetDeviceArray(const std::string &, int,
+  const std::string &, int, DeviceArray &)
+{
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int DataAdaptor::GetArrayViews(const std::string &meshName, int association,
+  const std::string &arrayName, std::vector<ArrayView> &views)
+{
+  views.clear();
+
+  // the block extents of Cartesian meshes describe the ghost zones
+  // without a ghost array
+  MeshMetadataFlags flags;
+  flags.SetBlockDecomp();
+  flags.SetBlockExtents();
+
+  unsigned int nMeshes = 0;
+  if (this->GetNumberOfMeshes(nMeshes))
+    {
+    SENSEI_ERROR("Failed to get the number of meshes")
+    return -1;
+    }
+
+  MeshMetadataPtr md;
+  for (unsigned int i = 0; i < nMeshes; ++i)
+    {
+    MeshMetadataPtr mdi;
+    if (this->GetCachedMeshMetadata(i, flags, false, mdi))
+      {
+      SENSEI_ERROR("Failed to get metadata for data object " << i)
+      return -1;
+      }
+
+    if (mdi->MeshName == meshName)
+      {
+      md = mdi;
+      break;
+      }
+    }
+
+  if (!md)
+    {
+    SENSEI_ERROR("No mesh named \"" << meshName << "\"")
+    return -1;
+    }
+
+  vtkDataObject *dobj = nullptr;
+  if (this->GetMesh(meshName, true, dobj))
+    {
+    SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  // not all ranks need have blocks
+  if (!dobj)
+    return 0;
+
+  vtkCompositeDataSetPtr mesh =
+    VTKUtils::AsCompositeData(this->GetCommunicator(), dobj, true);
+
+  VTKUtils::InteriorRangeMap interiors;
+  bool haveInteriors = (md->NumGhostCells || md->NumGhostNodes) &&
+    !VTKUtils::GetInteriorRanges(md, interiors);
+
+  if (!haveInteriors)
+    {
+    if ((association == vtkDataObject::CELL) &&
+      (md->NumGhostCells || VTKUtils::AMR(md)) &&
+      this->AddGhostCellsArray(mesh, meshName))
+      {
+      SENSEI_ERROR(<< this->GetClassName() << " failed to add ghost cells.")
+      return -1;
+      }
+
+    if ((association == vtkDataObject::POINT) && md->NumGhostNodes &&
+      this->AddGhostNodesArray(mesh, meshName))
+      {
+      SENSEI_ERROR(<< this->GetClassName() << " failed to add ghost nodes.")
+      return -1;
+      }
+    }
+
+  if (this->AddArray(mesh, meshName, association, arrayName))
+    {
+    SENSEI_ERROR(<< this->GetClassName() << " failed to add "
+      << VTKUtils::GetAttributesName(association) << " data array \""
+      << arrayName << "\" to mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  vtkSmartPointer<vtkCompositeDataIterator> it;
+  it.TakeReference(mesh->NewIterator());
+
+  for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+    {
+    vtkFieldData *fd =
+      it->GetCurrentDataObject()->GetAttributesAsFieldData(association);
+
+    vtkDataArray *da = fd ? fd->GetArray(arrayName.c_str()) : nullptr;
+    if (!da)
+      continue;
+
+    ArrayView view;
+    view.BlockId = VTKUtils::GetBlockId(mesh, it);
+    view.Data = da->HasStandardMemoryLayout() ? da->GetVoidPointer(0) : nullptr;
+    view.DataType = da->GetDataType();
+    view.NumTuples = da->GetNumberOfTuples();
+    view.NumComponents = da->GetNumberOfComponents();
+    view.Stride = view.NumComponents;
+    view.Array = da;
+    view.Owner = mesh.GetPointer();
+
+    const VTKUtils::InteriorRange *interior = haveInteriors ?
+      VTKUtils::FindInteriorRange(interiors, view.BlockId, association, da) :
+      nullptr;
+
+    if (interior)
+      {
+      for (int d = 0; d < 3; ++d)
+        {
+        view.Extent[2*d] = 0;
+        view.Extent[2*d+1] = interior->Dims[d] - 1;
+        view.Interior[2*d] = interior->Begin[d];
+        view.Interior[2*d+1] = interior->End[d] - 1;
+        }
+      }
+    else if (vtkUnsignedCharArray *ghosts = dynamic_cast<vtkUnsignedCharArray*>(
+      fd->GetArray(vtkDataSetAttributes::GhostArrayName())))
+      {
+      view.Ghosts = ghosts->GetPointer(0);
+      }
+
+    views.push_back(view);
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int DataAdaptor::GetHostArray(const std::string &meshName, int association,
+  const std::string &arrayName, int blockId, vtkDataArray *&array)
+{
+  array = nullptr;
+
+  // copies are only shared within a step
+  long step = this->GetDataTimeStep();
+  if (step != this->Internals->HostArrayStep)
+    {
+    this->Internals->HostArrays.clear();
+    this->Internals->HostArrayStep = step;
+    }
+
+  InternalsType::HostArrayKey key(meshName, association, arrayName, blockId);
+
+  auto it = this->Internals->HostArrays.find(key);
+  if (it != this->Internals->HostArrays.end())
+    {
+    array = it->second.GetPointer();
+    return 0;
+    }
+
+  DeviceArray dev;
+  if (this->GetDeviceArray(meshName, association, arrayName, blockId, dev))
+    {
+    SENSEI_ERROR("No device array for " << VTKUtils::GetAttributesName(association)
+      << " data array \"" << arrayName << "\" block " << blockId
+      << " of mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  TimeEvent<128> mark("DataAdaptor::GetHostArray");
+
+  vtkSmartPointer<vtkDataArray> da;
+  da.TakeReference(vtkDataArray::CreateDataArray(dev.DataType));
+  if (!da)
+    {
+    SENSEI_ERROR("Failed to create an array of type " << dev.DataType)
+    return -1;
+    }
+
+  da->SetName(arrayName.c_str());
+  da->SetNumberOfComponents(dev.NumComponents);
+  da->SetNumberOfTuples(dev.NumTuples);
+
+  if (dev.NumTuples && dev.NumComponents)
+    {
+    int ierr = -1;
+    if (dev.MemorySpace == MEMORY_SPACE_HOST)
+      {
+      memcpy(da->GetVoidPointer(0), dev.Data, dev.NumTuples*
+        dev.NumComponents*da->GetDataTypeSize());
+      ierr = 0;
+      }
+    else if (dev.CopyToHost)
+      {
+      ierr = dev.CopyToHost(da->GetVoidPointer(0));
+      }
+
+    if (ierr)
+      {
+      SENSEI_ERROR("Failed to copy " << VTKUtils::GetAttributesName(association)
+        << " data array \"" << arrayName << "\" block " << blockId
+        << " from " << GetMemorySpaceName(dev.MemorySpace) << " memory")
+      return -1;
+      }
+    }
+
+  this->Internals->HostArrays[key] = da;
+  array = da.GetPointer();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void DataAdaptor::ReleaseHostArrays()
+{
+  this->Internals->HostArrays.clear();
+}
+
+//----------------------------------------------------------------------------
+int DataAdaptor::SetAnalysisRequirements(const DataRequirements &reqs,
+  bool complete)
+{
+  this->Internals->AnalysisRequirements = reqs;
+  this->Internals->HaveAnalysisRequirements = complete;
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void DataAdaptor::ClearAnalysisRequirements()
+{
+  this->Internals->AnalysisRequirements.Clear();
+  this->Internals->HaveAnalysisRequirements = false;
+}
+
+//----------------------------------------------------------------------------
+bool DataAdaptor::IsArrayRequired(const std::string &meshName,
+  int association, const std::string &arrayName) const
+{
+  return !this->Internals->HaveAnalysisRequirements ||
+    this->Internals->AnalysisRequirements.HasArray(meshName,
+      association, arrayName);
+}
+
 //----------------------------------------------------------------------------
 int DataAdaptor::AddGhostNodesArray(vtkDataObject*, const std::string &)
 {
@@ -3,6 +3,8 @@
 
 #include "senseiConfig.h"
 #include "MeshMetadata.h"
+#include "DeviceArray.h"
+#include "ArrayView.h"
 
 #include <vtkObjectBase.h>
 
@@ -12,12 +14,14 @@
 #include <memory>
 
 class vtkAbstractArray;
+class vtkDataArray;
 class vtkDataObject;
 class vtkCompositeDataSet;
 
 namespace sensei
 {
 
+class DataRequirements;
 
 /// @class DataAdaptor
 /// @brief DataAdaptor is an abstract base class that defines the data interface.
@@ -25,6 +29,15 @@ namespace sensei
 /// DataAdaptor defines the data interface. Any simulation code that interfaces with
 /// Sensei needs to provide an implementation for this interface. Analysis routines
 /// (via AnalysisAdator) use the DataAdaptor implementation to access simulation data.
+///
+/// Thread safety. A data adaptor is used by one thread at a time. Analyses
+/// that run asynchronously or concurrently do not share the simulation's
+/// adaptor, ConfigurableAnalysis gives each a snapshot of the data with its
+/// own communicator. The methods that make collective calls, such as
+/// GetMeshMetadata when a global view is requested, do so over the
+/// communicator returned by GetCommunicator, and must be called in the
+/// same order on every rank. Implementations that use threads internally
+/// should give each thread a communicator, see MPIUtils::ThreadComms.
 class DataAdaptor : public vtkObjectBase
 {
 public:
@@ -61,6 +74,86 @@ public:
   /// @returns zero if successful, non zero if an error occurred
   virtual int GetMeshMetadata(unsigned int id, sensei::MeshMetadataPtr &metadata) = 0;
 
+  /// @brief Get metadata of the i'th mesh, reusing that of static meshes
+  ///
+  /// When the simulation reports the mesh as static (see
+  /// MeshMetadata::StaticMesh) the metadata is kept and reused in later
+  /// steps, as is its global view. Only block array ranges, which change in
+  /// time, are regenerated and only when requested by the flags. The
+  /// metadata of meshes that are not static is kept until
+  /// ClearTransientMeshMetadata is called, so that a global view requested
+  /// after the local one, as by MeshMetadataMap, calls GetMeshMetadata
+  /// once. The returned metadata may be modified by the caller.
+  ///
+  /// @param[in] id index of the mesh to access
+  /// @param[in] flags describe the optional metadata that is needed
+  /// @param[in] globalView if set the global view is returned
+  /// @param[out] metadata a pointer where the metadata is stored
+  /// @returns zero if successful, non zero if an error occurred
+  virtual int GetCachedMeshMetadata(unsigned int id,
+    const sensei::MeshMetadataFlags &flags, bool globalView,
+    sensei::MeshMetadataPtr &metadata);
+
+  /// @brief Discard the metadata kept by GetCachedMeshMetadata.
+  ///
+  /// This should be called if a mesh reported as static is modified. The
+  /// meshes kept by GetCachedMesh are discarded as well.
+  void ClearMeshMetadataCache();
+
+  /// @brief Discard the metadata GetCachedMeshMetadata keeps for meshes
+  /// that are not static.
+  ///
+  /// This should be called once the step's analyses are done, as
+  /// ConfigurableAnalysis::Execute does. The metadata of static meshes is
+  /// kept.
+  void ClearTransientMeshMetadata();
+
+  /// ways GetCachedMeshMetadata makes global views, see SetGlobalViewMode
+  enum {GLOBAL_VIEW_FLAT = 0, GLOBAL_VIEW_HIERARCHICAL = 1};
+
+  /// @brief Set how GetCachedMeshMetadata makes global views.
+  ///
+  /// GLOBAL_VIEW_FLAT, the default, exchanges the metadata among all ranks
+  /// at once. GLOBAL_VIEW_HIERARCHICAL gathers it to the lowest rank of
+  /// each node first, so that only those ranks exchange it across the
+  /// network, see MPIUtils::HierarchicalComm. The views are the same. The
+  /// node communicators are made, collectively, the first time a global
+  /// view is made.
+  void SetGlobalViewMode(int mode);
+  int GetGlobalViewMode() const;
+
+  /// @brief Return a mesh that is reused for as long as it is static.
+  ///
+  /// When the simulation reports the mesh as static (see
+  /// MeshMetadata::StaticMesh) the mesh is fetched with GetMesh once and
+  /// the same object is returned in later steps. When the time step changes
+  /// the point and cell data arrays, other than ghost arrays, are removed so
+  /// that the current values are added by AddArray. The mesh is shared by
+  /// all of the analyses, they may add arrays but must not change the
+  /// geometry or topology. An analysis may keep structures derived from
+  /// the mesh, such as cell locators, by holding a reference to it; they
+  /// remain valid while the same object is returned. For meshes that are
+  /// not static this is the same as GetMesh. In both cases the caller takes
+  /// a reference and calls Delete when it is no longer needed.
+  ///
+  /// @param[in] metadata the metadata of the mesh to access
+  /// @param[in] structureOnly When set to true the returned mesh may not have
+  ///            any geometry or topology information.
+  /// @param[out] mesh a reference to a pointer where the VTK object is stored
+  /// @returns zero if successful, non zero if an error occurred
+  int GetCachedMesh(const sensei::MeshMetadataPtr &metadata,
+    bool structureOnly, vtkDataObject *&mesh);
+
+  /// @brief Remove the arrays of the meshes kept by GetCachedMesh.
+  ///
+  /// Ghost arrays are kept. Simulations that pass their memory to VTK
+  /// without a copy may call this from ReleaseData so that the meshes do not
+  /// reference the memory after it is released.
+  void ReleaseCachedMeshArrays();
+
+  /// @brief Discard the meshes kept by GetCachedMesh.
+  void ClearMeshCache();
+
   /// @brief Return the data object with appropriate structure.
   ///
   /// This method will return a data object of the appropriate type. The data
@@ -88,6 +181,36 @@ public:
   virtual int GetMesh(const std::string &meshName, bool structureOnly,
     vtkCompositeDataSet *&mesh);
 
+  /// @brief Return a subset of the local blocks of a mesh.
+  ///
+  /// Analyses that need only some of the blocks, for instance those
+  /// intersecting a slice plane or region of interest found from
+  /// MeshMetadata::BlockBounds or MeshMetadata::BlockArrayRange, use this
+  /// to spare the simulation the construction of the others. The blocks
+  /// are identified by their global ids (see MeshMetadata::BlockIds).
+  /// Ids of blocks that are not local are ignored. The composite structure
+  /// is the same as that returned by GetMesh, the blocks that were not
+  /// requested are empty. Simulations that construct blocks on demand
+  /// should override this. The default implementation calls GetMesh and
+  /// removes the blocks that were not requested. The caller takes
+  /// ownership of the returned mesh object.
+  ///
+  /// @param[in] meshName the name of the mesh to access (see GetMeshMetadata)
+  /// @param[in] structureOnly When set to true the returned mesh may not have
+  ///            any geometry or topology information.
+  /// @param[in] blockIds the global ids of the blocks needed
+  /// @param[out] mesh a reference to a pointer where a new VTK object is stored
+  /// @returns zero if successful, non zero if an error occurred
+  virtual int GetMesh(const std::string &meshName, bool structureOnly,
+    const std::vector<int> &blockIds, vtkDataObject *&mesh);
+
+  /// @brief Return a subset of the blocks as a composite (multi-block) object
+  ///
+  /// See GetMesh with block ids above. Legacy VTK objects are converted
+  /// to a multi-block as by the corresponding GetMesh.
+  virtual int GetMesh(const std::string &meshName, bool structureOnly,
+    const std::vector<int> &blockIds, vtkCompositeDataSet *&mesh);
+
   /// @brief Adds ghost nodes on the specified mesh. The array name must be set
   ///        to "vtkGhostType".
   ///
@@ -134,6 +257,89 @@ public:
   virtual int AddArrays(vtkDataObject* mesh, const std::string &meshName,
     int association, const std::vector<std::string> &arrayName);
 
+  /// @brief Get an array that resides in device memory.
+  ///
+  /// Simulations that keep their data on an accelerator may override this
+  /// to expose a block's array where it lives, with its memory space.
+  /// Analyses that can consume device memory call this before AddArray and
+  /// use the device buffer directly when it is provided. The default
+  /// provides no device arrays.
+  ///
+  /// @param[in] meshName the name of the mesh on which the array is stored
+  /// @param[in] association field association; one of
+  ///            vtkDataObject::FieldAssociations or vtkDataObject::AttributeTypes.
+  /// @param[in] arrayName name of the array
+  /// @param[in] blockId the block's index in the mesh
+  /// @param[out] array describes the device buffer
+  /// @returns zero if the array is provided in device memory, non zero if
+  ///          it is not. a non zero return is not an error
+  virtual int GetDeviceArray(const std::string &meshName, int association,
+    const std::string &arrayName, int blockId, DeviceArray &array);
+
+  /// @brief Get views of the values of an array on each local block.
+  ///
+  /// Analyses that only need the values of arrays, such as statistics,
+  /// may use this in place of GetMesh and AddArray. Simulations may
+  /// override this to describe their memory directly, so that no VTK
+  /// objects are made. The default implementation gets the mesh, adds the
+  /// array and the ghost array or the interior extents given by the
+  /// metadata, and views the VTK arrays.
+  ///
+  /// @param[in] meshName the name of the mesh on which the array is stored
+  /// @param[in] association field association; one of
+  ///            vtkDataObject::FieldAssociations or vtkDataObject::AttributeTypes.
+  /// @param[in] arrayName name of the array
+  /// @param[out] views a view of the array on each block of this rank
+  /// @returns zero if successful, non zero if an error occurred
+  virtual int GetArrayViews(const std::string &meshName, int association,
+    const std::string &arrayName, std::vector<ArrayView> &views);
+
+  /// @brief Get a host copy of an array provided by GetDeviceArray.
+  ///
+  /// The copy is made once per time step and shared by every caller in the
+  /// step. Simulations implementing GetDeviceArray may use this from
+  /// AddArray so that the analyses that need host memory share a single
+  /// device to host transfer. The array is owned by the data adaptor, the
+  /// caller should add a reference to keep it. Host arrays are released
+  /// when the time step changes or ReleaseHostArrays is called.
+  ///
+  /// @returns zero if successful, non zero if an error occurred
+  int GetHostArray(const std::string &meshName, int association,
+    const std::string &arrayName, int blockId, vtkDataArray *&array);
+
+  /// @brief Release the host copies made by GetHostArray.
+  ///
+  /// Simulations may call this from ReleaseData.
+  void ReleaseHostArrays();
+
+  /// @brief Tell the simulation which data the analyses will access.
+  ///
+  /// Derived fields are often the largest cost of a bridge, and a bridge
+  /// can not know which arrays will be requested until AddArray is called.
+  /// A bridge may get the requirements of the analyses that will run on
+  /// the upcoming step from ConfigurableAnalysis::GetDataRequirements,
+  /// pass them here, and compute only the fields for which
+  /// IsArrayRequired returns true. When complete is false one of the
+  /// analyses did not declare what it accesses, and every array is
+  /// required. Simulations may override this to act on the requirements,
+  /// overrides should call this implementation. The requirements are kept
+  /// until they are set again or cleared.
+  ///
+  /// @param[in] reqs the union of the analyses' requirements
+  /// @param[in] complete false if an analysis may access other data
+  /// @returns zero if successful, non zero if an error occurred
+  virtual int SetAnalysisRequirements(const DataRequirements &reqs,
+    bool complete);
+
+  /// @brief Forget the requirements, every array is required.
+  void ClearAnalysisRequirements();
+
+  /// @brief Returns true if an analysis may access the named array.
+  ///
+  /// This is true for every array when no complete requirements were set.
+  bool IsArrayRequired(const std::string &meshName, int association,
+    const std::string &arrayName) const;
+
   /// @brief Release data allocated for the current timestep.
   ///
   /// Releases the data allocated for the current timestep. This is expected to
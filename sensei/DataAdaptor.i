@@ -8,12 +8,19 @@
 #include "BlockPartitioner.h"
 #include "PlanarPartitioner.h"
 #include "MappedPartitioner.h"
+#include "LocalityPartitioner.h"
+#include "HilbertPartitioner.h"
+#include "AdaptivePartitioner.h"
 #include "PlanarSlicePartitioner.h"
 #include "IsoSurfacePartitioner.h"
 #include "ConfigurablePartitioner.h"
 #include "VTKUtils.h"
 #include "Error.h"
 #include "senseiPyString.h"
+#include "senseiPyGILState.h"
+#include "senseiPyArrayView.h"
+#include "senseiPyDeviceArray.h"
+#include <vtkPythonUtil.h>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -33,7 +40,9 @@ using namespace std;
 %ignore sensei::DA::GetNumberOfMeshes;
 %ignore sensei::DA::GetMeshMetadata;
 %ignore sensei::DA::GetMesh;
+%ignore sensei::DA::GetCachedMesh;
 %ignore sensei::DA::AddArray;
+%ignore sensei::DA::GetDeviceArray;
 %ignore sensei::DA::ReleaseData;
 /* memory management */
 VTK_DERIVED(DA)
@@ -50,7 +59,9 @@ VTK_DERIVED(DA)
 %ignore sensei::DA::GetNumberOfMeshes;
 %ignore sensei::DA::GetMeshMetadata;
 %ignore sensei::DA::GetMesh;
+%ignore sensei::DA::GetCachedMesh;
 %ignore sensei::DA::AddArray;
+%ignore sensei::DA::GetDeviceArray;
 %ignore sensei::DA::ReleaseData;
 %ignore sensei::DA::GetSenderMeshMetadata;
 %ignore sensei::DA::GetReceiverMeshMetadata;
@@ -66,10 +77,67 @@ VTK_DERIVED(DA)
 %ignore sensei::BinaryStream::BinaryStream(BinaryStream &&);
 %include "BinaryStream.h"
 
+%inline
+%{
+// ------------------------------------------------------------------------
+// return a NumPy view of the bytes in a BinaryStream, no copy is made.
+// see senseiPyArray::NewView. the view keeps the stream alive and is
+// valid until the stream is resized, grown, or cleared.
+PyObject *StreamView(PyObject *obj)
+{
+  void *vp = nullptr;
+  if (!SWIG_IsOK(SWIG_ConvertPtr(obj, &vp, SWIGTYPE_p_sensei__BinaryStream, 0)))
+    {
+    PyErr_Format(PyExc_TypeError, "A BinaryStream is required");
+    return nullptr;
+    }
+
+  return senseiPyArray::NewView(obj, static_cast<sensei::BinaryStream*>(vp));
+}
+%}
+
+/****************************************************************************
+ * DeviceArray
+ ***************************************************************************/
+%ignore sensei::DeviceArray::CopyToHost;
+%ignore sensei::DeviceArray::CopyFunction;
+%extend sensei::DeviceArray
+{
+  /* the DLPack protocol. see senseiPyDeviceArray::NewDLPackCapsule.
+     the stream argument is accepted for compatibility, the simulation is
+     responsible for the values being ready when the data is provided */
+  PyObject *__dlpack__(PyObject *stream = nullptr)
+  {
+    (void)stream;
+    return senseiPyDeviceArray::NewDLPackCapsule(*self);
+  }
+
+  // ------------------------------------------------------------------------
+  PyObject *__dlpack_device__()
+  {
+    return senseiPyDeviceArray::NewDLPackDevice(*self);
+  }
+
+  // ------------------------------------------------------------------------
+  PyObject *GetCudaArrayInterface()
+  {
+    return senseiPyDeviceArray::NewCudaArrayInterface(*self);
+  }
+
+  %pythoncode
+  {
+  @property
+  def __cuda_array_interface__(self):
+      return self.GetCudaArrayInterface()
+  }
+}
+%include "DeviceArray.h"
+
 /****************************************************************************
  * MeshMetadata
  ***************************************************************************/
 %shared_ptr(sensei::MeshMetadata)
+%ignore sensei::MeshMetadata::GlobalizeView(const MPIUtils::HierarchicalComm &);
 
 // this lets you assign directly to the member variable
 %naturalvar sensei::MeshMetadata::GlobalView;
@@ -132,6 +200,20 @@ VTK_DERIVED(DA)
 }
 %include "MeshMetadata.h"
 
+%inline
+%{
+// ------------------------------------------------------------------------
+// return a NumPy view of an array member of MeshMetadata, such as
+// BlockBounds or BlockNumCells, no copy is made. see
+// senseiPyArray::NewView. the view keeps the metadata alive and is
+// valid until the member is resized or assigned to.
+PyObject *MetadataView(const sensei::MeshMetadataPtr &md,
+  const std::string &member)
+{
+  return senseiPyArray::NewView(md, member);
+}
+%}
+
 /****************************************************************************
  * DataAdaptor
  ***************************************************************************/
@@ -148,7 +230,12 @@ VTK_DERIVED(DA)
   unsigned int GetNumberOfMeshes()
   {
     unsigned int nMeshes = 0;
-    if (self->GetNumberOfMeshes(nMeshes))
+    int ierr = 0;
+    {
+    senseiPyThreadState nogil;
+    ierr = self->GetNumberOfMeshes(nMeshes);
+    }
+    if (ierr)
       {
       PyErr_Format(PyExc_RuntimeError,
         "Failed to get the number of meshes");
@@ -163,7 +250,13 @@ VTK_DERIVED(DA)
   {
     sensei::MeshMetadataPtr pmd = sensei::MeshMetadata::New(flags);
 
-    if (self->GetMeshMetadata(id, pmd) || !pmd)
+    int ierr = 0;
+    {
+    senseiPyThreadState nogil;
+    ierr = self->GetMeshMetadata(id, pmd);
+    }
+
+    if (ierr || !pmd)
       {
       PyErr_Format(PyExc_RuntimeError,
         "Failed to get metadata for mesh %d", id);
@@ -177,7 +270,12 @@ VTK_DERIVED(DA)
   vtkDataObject *GetMesh(const std::string &meshName, bool structureOnly)
   {
     vtkDataObject *mesh = nullptr;
-    if (self->GetMesh(meshName, structureOnly, mesh))
+    int ierr = 0;
+    {
+    senseiPyThreadState nogil;
+    ierr = self->GetMesh(meshName, structureOnly, mesh);
+    }
+    if (ierr)
       {
       PyErr_Format(PyExc_RuntimeError,
         "Failed to get mesh \"%s\"", meshName.c_str());
@@ -186,11 +284,35 @@ VTK_DERIVED(DA)
     return mesh;
   }
 
+  // ------------------------------------------------------------------------
+  vtkDataObject *GetCachedMesh(const sensei::MeshMetadataPtr &md,
+    bool structureOnly)
+  {
+    vtkDataObject *mesh = nullptr;
+    int ierr = 0;
+    {
+    senseiPyThreadState nogil;
+    ierr = self->GetCachedMesh(md, structureOnly, mesh);
+    }
+    if (ierr)
+      {
+      PyErr_Format(PyExc_RuntimeError,
+        "Failed to get mesh \"%s\"", md->MeshName.c_str());
+      PyErr_Print();
+      }
+    return mesh;
+  }
+
   // ------------------------------------------------------------------------
   void AddArray(vtkDataObject* mesh, const std::string &meshName,
     int association, const std::string &arrayName)
   {
-     if (self->AddArray(mesh, meshName, association, arrayName))
+     int ierr = 0;
+     {
+     senseiPyThreadState nogil;
+     ierr = self->AddArray(mesh, meshName, association, arrayName);
+     }
+     if (ierr)
        {
        PyErr_Format(PyExc_RuntimeError,
          "Failed to add %s data array \"%s\" to mesh \"%s\"",
@@ -199,10 +321,39 @@ VTK_DERIVED(DA)
        PyErr_Print();
        }
   }
+  // ------------------------------------------------------------------------
+  // returns a DeviceArray, which CuPy, Numba, and other DLPack or CUDA
+  // array interface consumers can use without a host copy, or None when
+  // the simulation does not provide the array in device memory. the
+  // array is only valid until ReleaseData is called.
+  PyObject *GetDeviceArray(const std::string &meshName, int association,
+    const std::string &arrayName, int blockId)
+  {
+    sensei::DeviceArray *dev = new sensei::DeviceArray;
+    int ierr = 0;
+    {
+    senseiPyThreadState nogil;
+    ierr = self->GetDeviceArray(meshName, association, arrayName,
+      blockId, *dev);
+    }
+    if (ierr)
+      {
+      delete dev;
+      Py_RETURN_NONE;
+      }
+    return SWIG_NewPointerObj(SWIG_as_voidptr(dev),
+      SWIGTYPE_p_sensei__DeviceArray, SWIG_POINTER_OWN);
+  }
+
   // ------------------------------------------------------------------------
   void ReleaseData()
   {
-    if (self->ReleaseData())
+    int ierr = 0;
+    {
+    senseiPyThreadState nogil;
+    ierr = self->ReleaseData();
+    }
+    if (ierr)
       {
       SENSEI_ERROR("Failed to release data")
       }
@@ -211,6 +362,31 @@ VTK_DERIVED(DA)
 SENSEI_DATA_ADAPTOR(DataAdaptor)
 %include "DataAdaptor.h"
 
+/* The DataAdaptor wrappers above release the GIL while the C++ call runs.
+   Data adaptors implemented in Python re-aquire it in their callbacks. */
+
+%inline
+%{
+// ------------------------------------------------------------------------
+// return a NumPy view of a vtkDataArray's memory, no copy is made. see
+// senseiPyArray::NewView. the view is valid until the data adaptor's
+// ReleaseData is called.
+PyObject *ArrayView(PyObject *obj)
+{
+  vtkDataArray *arr = static_cast<vtkDataArray*>(
+    vtkPythonUtil::GetPointerFromObject(obj, "vtkDataArray"));
+
+  if (!arr)
+    {
+    if (!PyErr_Occurred())
+      PyErr_Format(PyExc_TypeError, "A vtkDataArray is required");
+    return nullptr;
+    }
+
+  return senseiPyArray::NewView(arr);
+}
+%}
+
 /****************************************************************************
  * Partitioners
  ***************************************************************************/
@@ -218,6 +394,9 @@ SENSEI_DATA_ADAPTOR(DataAdaptor)
 %shared_ptr(sensei::BlockPartitioner)
 %shared_ptr(sensei::PlanarPartitioner)
 %shared_ptr(sensei::MappedPartitioner)
+%shared_ptr(sensei::LocalityPartitioner)
+%shared_ptr(sensei::HilbertPartitioner)
+%shared_ptr(sensei::AdaptivePartitioner)
 %shared_ptr(sensei::PlanarSlicePartitioner)
 %shared_ptr(sensei::IsoSurfacePartitioner)
 %shared_ptr(sensei::ConfigurablePartitioner)
@@ -243,6 +422,9 @@ PARTITIONER_API(Partitioner)
 PARTITIONER_API(BlockPartitioner)
 PARTITIONER_API(PlanarPartitioner)
 PARTITIONER_API(MappedPartitioner)
+PARTITIONER_API(LocalityPartitioner)
+PARTITIONER_API(HilbertPartitioner)
+PARTITIONER_API(AdaptivePartitioner)
 PARTITIONER_API(PlanarSlicePartitioner)
 PARTITIONER_API(IsoSurfacePartitioner)
 PARTITIONER_API(ConfigurablePartitioner)
@@ -251,6 +433,9 @@ PARTITIONER_API(ConfigurablePartitioner)
 %include "BlockPartitioner.h"
 %include "PlanarPartitioner.h"
 %include "MappedPartitioner.h"
+%include "LocalityPartitioner.h"
+%include "HilbertPartitioner.h"
+%include "AdaptivePartitioner.h"
 %include "PlanarSlicePartitioner.h"
 %include "IsoSurfacePartitioner.h"
 %include "ConfigurablePartitioner.h"
@@ -5,6 +5,7 @@
 #include "Error.h"
 
 #include <vtkDataObject.h>
+#include <algorithm>
 #include <sstream>
 
 namespace sensei
@@ -53,6 +54,9 @@ void DataRequirements::Clear()
 {
   this->MeshNames.clear();
   this->MeshArrayMap.clear();
+  this->MaxLevels.clear();
+  this->ArrayPrecision.clear();
+  this->ArrayCadence.clear();
 }
 
 // --------------------------------------------------------------------------
@@ -81,15 +85,54 @@ int DataRequirements::Initialize(pugi::xml_node parent)
 
     this->MeshNames.insert(std::make_pair(meshName, structureOnly));
 
-    // get cell data arrays, optional
-    std::vector<std::string> arrays;
-    if (getArrayNames(node.child("cell_arrays"), arrays))
-      this->MeshArrayMap[meshName][vtkDataObject::CELL] = arrays;
+    // get the finest AMR level, optional
+    if (node.attribute("max_level"))
+      this->SetMaxLevel(meshName, node.attribute("max_level").as_int(-1));
 
-    // get point data arrays, optional
-    arrays.clear();
-    if (getArrayNames(node.child("point_arrays"), arrays))
-      this->MeshArrayMap[meshName][vtkDataObject::POINT] = arrays;
+    // get cell and point data arrays, optional. a group may be repeated
+    // to give its arrays a different precision or cadence
+    const char *groups[] = {"cell_arrays", "point_arrays"};
+    int assocs[] = {vtkDataObject::CELL, vtkDataObject::POINT};
+    for (int i = 0; i < 2; ++i)
+      {
+      for (pugi::xml_node group = node.child(groups[i]);
+        group; group = group.next_sibling(groups[i]))
+        {
+        std::vector<std::string> arrays;
+        if (!getArrayNames(group, arrays))
+          continue;
+
+        int precision = PRECISION_NATIVE;
+        if (group.attribute("precision") && ((precision =
+          DataRequirements::GetPrecision(group.attribute("precision").value())) < 0))
+          {
+          SENSEI_ERROR("Invalid precision \"" << group.attribute("precision").value()
+            << "\" on mesh \"" << meshName << "\". Valid values are native,"
+            " float64, float32, and float16")
+          retVal = -1;
+          continue;
+          }
+
+        int cadence = group.attribute("cadence").as_int(1);
+        if (cadence < 1)
+          {
+          SENSEI_ERROR("Invalid cadence " << cadence << " on mesh \""
+            << meshName << "\". The cadence must be at least 1")
+          retVal = -1;
+          continue;
+          }
+
+        std::vector<std::string> &groupArrays = this->MeshArrayMap[meshName][assocs[i]];
+        for (const std::string &arrayName : arrays)
+          {
+          if (std::find(groupArrays.begin(), groupArrays.end(), arrayName) == groupArrays.end())
+            groupArrays.push_back(arrayName);
+
+          this->SetArrayPrecision(meshName, assocs[i], arrayName, precision);
+          this->SetArrayCadence(meshName, assocs[i], arrayName, cadence);
+          }
+        }
+      }
 
     meshId += 1;
     }
@@ -178,6 +221,295 @@ int DataRequirements::AddRequirement(const std::string &meshName,
   return 0;
 }
 
+// --------------------------------------------------------------------------
+int DataRequirements::AddRequirements(const DataRequirements &other)
+{
+  MeshNamesType::const_iterator mit = other.MeshNames.begin();
+  MeshNamesType::const_iterator mend = other.MeshNames.end();
+  for (; mit != mend; ++mit)
+    {
+    const std::string &meshName = mit->first;
+
+    // the geometry is needed if either needs it
+    std::pair<MeshNamesType::iterator, bool> ins =
+      this->MeshNames.insert(*mit);
+
+    if (!ins.second)
+      ins.first->second = ins.first->second && mit->second;
+
+    // a mesh without a level limit uses all levels
+    int maxLevel = other.GetMaxLevel(meshName);
+    if (ins.second)
+      this->SetMaxLevel(meshName, maxLevel);
+    else if ((maxLevel < 0) || (this->GetMaxLevel(meshName) < 0))
+      this->SetMaxLevel(meshName, -1);
+    else
+      this->SetMaxLevel(meshName, std::max(maxLevel, this->GetMaxLevel(meshName)));
+    }
+
+  MeshArrayMapType::const_iterator ait = other.MeshArrayMap.begin();
+  MeshArrayMapType::const_iterator aend = other.MeshArrayMap.end();
+  for (; ait != aend; ++ait)
+    {
+    AssocArrayMapType::const_iterator it = ait->second.begin();
+    AssocArrayMapType::const_iterator end = ait->second.end();
+    for (; it != end; ++it)
+      {
+      std::vector<std::string> &arrays = this->MeshArrayMap[ait->first][it->first];
+      for (const std::string &arrayName : it->second)
+        {
+        // an array required by both is stored at the higher precision, and
+        // at each step either needs it
+        int precision = other.GetArrayPrecision(ait->first, it->first, arrayName);
+        int cadence = other.GetArrayCadence(ait->first, it->first, arrayName);
+        if (std::find(arrays.begin(), arrays.end(), arrayName) == arrays.end())
+          {
+          arrays.push_back(arrayName);
+          }
+        else
+          {
+          precision = std::min(precision,
+            this->GetArrayPrecision(ait->first, it->first, arrayName));
+
+          int a = this->GetArrayCadence(ait->first, it->first, arrayName);
+          while (a)
+            {
+            int r = cadence % a;
+            cadence = a;
+            a = r;
+            }
+          }
+
+        this->SetArrayPrecision(ait->first, it->first, arrayName, precision);
+        this->SetArrayCadence(ait->first, it->first, arrayName, cadence);
+        }
+      }
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+bool DataRequirements::HasArray(const std::string &meshName, int association,
+  const std::string &arrayName) const
+{
+  MeshArrayMapType::const_iterator mit = this->MeshArrayMap.find(meshName);
+  if (mit == this->MeshArrayMap.end())
+    return false;
+
+  AssocArrayMapType::const_iterator ait = mit->second.find(association);
+  if (ait == mit->second.end())
+    return false;
+
+  return std::find(ait->second.begin(), ait->second.end(), arrayName) !=
+    ait->second.end();
+}
+
+// --------------------------------------------------------------------------
+int DataRequirements::SetMaxLevel(const std::string &meshName, int maxLevel)
+{
+  if (meshName.empty())
+    {
+    SENSEI_ERROR("A mesh name is required")
+    return -1;
+    }
+
+  if (maxLevel < 0)
+    this->MaxLevels.erase(meshName);
+  else
+    this->MaxLevels[meshName] = maxLevel;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int DataRequirements::GetMaxLevel(const std::string &meshName) const
+{
+  std::map<std::string, int>::const_iterator it = this->MaxLevels.find(meshName);
+  return it == this->MaxLevels.end() ? -1 : it->second;
+}
+
+// --------------------------------------------------------------------------
+int DataRequirements::SetArrayPrecision(const std::string &meshName,
+  int association, const std::string &arrayName, int precision)
+{
+  if (meshName.empty())
+    {
+    SENSEI_ERROR("A mesh name is required")
+    return -1;
+    }
+
+  if ((precision < PRECISION_NATIVE) || (precision > PRECISION_FLOAT16))
+    {
+    SENSEI_ERROR("Invalid precision " << precision << " for array \""
+      << arrayName << "\"")
+    return -1;
+    }
+
+  if (precision == PRECISION_NATIVE)
+    {
+    ArrayPrecisionMapType::iterator it = this->ArrayPrecision.find(meshName);
+    if (it != this->ArrayPrecision.end())
+      it->second[association].erase(arrayName);
+    }
+  else
+    {
+    this->ArrayPrecision[meshName][association][arrayName] = precision;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int DataRequirements::GetArrayPrecision(const std::string &meshName,
+  int association, const std::string &arrayName) const
+{
+  ArrayPrecisionMapType::const_iterator mit = this->ArrayPrecision.find(meshName);
+  if (mit == this->ArrayPrecision.end())
+    return PRECISION_NATIVE;
+
+  std::map<int, std::map<std::string, int>>::const_iterator ait =
+    mit->second.find(association);
+  if (ait == mit->second.end())
+    return PRECISION_NATIVE;
+
+  std::map<std::string, int>::const_iterator it = ait->second.find(arrayName);
+  return it == ait->second.end() ? PRECISION_NATIVE : it->second;
+}
+
+// --------------------------------------------------------------------------
+int DataRequirements::SetArrayCadence(const std::string &meshName,
+  int association, const std::string &arrayName, int cadence)
+{
+  if (meshName.empty())
+    {
+    SENSEI_ERROR("A mesh name is required")
+    return -1;
+    }
+
+  if (cadence < 1)
+    {
+    SENSEI_ERROR("Invalid cadence " << cadence << " for array \""
+      << arrayName << "\"")
+    return -1;
+    }
+
+  if (cadence == 1)
+    {
+    ArrayPrecisionMapType::iterator it = this->ArrayCadence.find(meshName);
+    if (it != this->ArrayCadence.end())
+      it->second[association].erase(arrayName);
+    }
+  else
+    {
+    this->ArrayCadence[meshName][association][arrayName] = cadence;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int DataRequirements::GetArrayCadence(const std::string &meshName,
+  int association, const std::string &arrayName) const
+{
+  ArrayPrecisionMapType::const_iterator mit = this->ArrayCadence.find(meshName);
+  if (mit == this->ArrayCadence.end())
+    return 1;
+
+  std::map<int, std::map<std::string, int>>::const_iterator ait =
+    mit->second.find(association);
+  if (ait == mit->second.end())
+    return 1;
+
+  std::map<std::string, int>::const_iterator it = ait->second.find(arrayName);
+  return it == ait->second.end() ? 1 : it->second;
+}
+
+// --------------------------------------------------------------------------
+int DataRequirements::GetRequiredArrays(const std::string &meshName,
+  int association, long timeStep, std::vector<std::string> &arrays) const
+{
+  arrays.clear();
+
+  std::vector<std::string> required;
+  if (this->GetRequiredArrays(meshName, association, required))
+    return -1;
+
+  for (const std::string &arrayName : required)
+    {
+    if ((timeStep % this->GetArrayCadence(meshName, association, arrayName)) == 0)
+      arrays.push_back(arrayName);
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int DataRequirements::SelectArrays(long timeStep, MeshMetadataPtr &md) const
+{
+  std::vector<int> keep;
+  for (int i = 0; i < md->NumArrays; ++i)
+    {
+    const std::string &arrayName = md->ArrayName[i];
+    int cen = md->ArrayCentering[i];
+    if (this->HasArray(md->MeshName, cen, arrayName) &&
+      ((timeStep % this->GetArrayCadence(md->MeshName, cen, arrayName)) == 0))
+      keep.push_back(i);
+    }
+
+  if (keep.size() == static_cast<size_t>(md->NumArrays))
+    return 0;
+
+  MeshMetadataPtr sub = md->NewCopy();
+
+  sub->NumArrays = keep.size();
+  sub->ArrayName.clear();
+  sub->ArrayCentering.clear();
+  sub->ArrayComponents.clear();
+  sub->ArrayType.clear();
+  sub->ArrayRange.clear();
+
+  for (int i : keep)
+    {
+    sub->ArrayName.push_back(md->ArrayName[i]);
+    sub->ArrayCentering.push_back(md->ArrayCentering[i]);
+    sub->ArrayComponents.push_back(md->ArrayComponents[i]);
+    sub->ArrayType.push_back(md->ArrayType[i]);
+    if (static_cast<size_t>(i) < md->ArrayRange.size())
+      sub->ArrayRange.push_back(md->ArrayRange[i]);
+    }
+
+  // indexed by block then array
+  size_t nBlocks = md->BlockArrayRange.size();
+  for (size_t j = 0; j < nBlocks; ++j)
+    {
+    const std::vector<std::array<double,2>> &ranges = md->BlockArrayRange[j];
+    std::vector<std::array<double,2>> &subRanges = sub->BlockArrayRange[j];
+    subRanges.clear();
+    for (int i : keep)
+      {
+      if (static_cast<size_t>(i) < ranges.size())
+        subRanges.push_back(ranges[i]);
+      }
+    }
+
+  md = sub;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int DataRequirements::GetPrecision(const std::string &precision)
+{
+  if ((precision == "native") || (precision == "float64"))
+    return PRECISION_NATIVE;
+  else if (precision == "float32")
+    return PRECISION_FLOAT32;
+  else if (precision == "float16")
+    return PRECISION_FLOAT16;
+  return -1;
+}
+
 // --------------------------------------------------------------------------
 int DataRequirements::GetRequiredMesh(unsigned int id, std::string &mesh) const
 {
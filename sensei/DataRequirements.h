@@ -1,6 +1,8 @@
 #ifndef DataRequirements_h
 #define DataRequirements_h
 
+#include "MeshMetadata.h"
+
 #include <string>
 #include <vector>
 #include <map>
@@ -34,7 +36,7 @@ public:
   /// mesh elements each with zero or more array groups
   ///
   /// <parent>
-  ///   <mesh name="mesh_1" structure_only="1">
+  ///   <mesh name="mesh_1" structure_only="1" max_level="2">
   ///     <cell_arrays>  array_1, ... array_n </cell_arrays>
   ///     <point_arrays>  array_1, ... array_n </point_arrays>
   ///   </mesh>
@@ -47,8 +49,24 @@ public:
   ///   </mesh>
   /// </parent>
   ///
+  /// an array group may be repeated and may carry a precision attribute,
+  /// one of native, float32, or float16, that writers use to store the
+  /// group's floating point arrays at reduced precision, see
+  /// SetArrayPrecision.
+  ///
+  ///     <point_arrays precision="float32"> array_1, ... </point_arrays>
+  ///
+  /// a group may also carry a cadence attribute, the writers store the
+  /// group's arrays at the steps that are a multiple of it, see
+  /// SetArrayCadence.
+  ///
+  ///     <cell_arrays cadence="10"> diagnostic_1, ... </cell_arrays>
+  ///
+  /// the optional max_level attribute limits an AMR mesh to its coarsest
+  /// levels, in transit the blocks of the finer levels are not moved.
+  ///
   /// @param[in] parent  XML node which contains mesh elements
-  /// @returns the number of mesh elements processed.
+  /// @returns zero if successful, non zero if an error occurred
   int Initialize(pugi::xml_node parent);
 
   /// @breif Get a description of what data is available
@@ -81,6 +99,17 @@ public:
   int AddRequirement(const std::string &meshName, int association,
     const std::string &array);
 
+  /// Adds all of the requirements of another instance, forming the union.
+  /// A mesh is structure only if it is in both. An AMR mesh is limited to
+  /// the finer of the two levels, and not at all if either is unlimited.
+  /// @param[in] other the requirements to add
+  /// @returns zero if successful
+  int AddRequirements(const DataRequirements &other);
+
+  /// Returns true if the named array is required
+  bool HasArray(const std::string &meshName, int association,
+    const std::string &arrayName) const;
+
   /// Get the list of meshes
   /// @param[out] meshes a vector where mesh names will be stored
   /// @returns zero if successful
@@ -105,6 +134,66 @@ public:
   int GetNumberOfRequiredArrays(const std::string &meshName,
     int association, unsigned int &nArrays) const;
 
+  /// Set/get the finest AMR level of the named mesh that is used, -1
+  /// when all levels are used. this is the default
+  /// @param[in] meshName the name of the mesh
+  /// @param[in] maxLevel the finest level used
+  /// @returns zero if successful
+  int SetMaxLevel(const std::string &meshName, int maxLevel);
+  int GetMaxLevel(const std::string &meshName) const;
+
+  /// precisions at which a writer may store an array
+  enum {PRECISION_NATIVE=0, PRECISION_FLOAT32=1, PRECISION_FLOAT16=2};
+
+  /// Set/get the precision at which writers store the named floating point
+  /// array, PRECISION_NATIVE by default. Values are converted as they are
+  /// written, the mesh metadata keeps the array's type and readers convert
+  /// back to it. Where a format has no 16 bit type float16 is stored as
+  /// float32. Integer arrays are always stored at their native precision.
+  /// @param[in] meshName the name of the mesh
+  /// @param[in] association vtkDataObject::POINT, vtkDataObject::CELL, etc
+  /// @param[in] arrayName the name of the array
+  /// @param[in] precision one of the PRECISION_ values
+  /// @returns zero if successful
+  int SetArrayPrecision(const std::string &meshName, int association,
+    const std::string &arrayName, int precision);
+
+  int GetArrayPrecision(const std::string &meshName, int association,
+    const std::string &arrayName) const;
+
+  /// Parse a precision given as native, float64, float32, or float16.
+  /// @returns the PRECISION_ value, or -1 if the string is not valid
+  static int GetPrecision(const std::string &precision);
+
+  /// Set/get the cadence at which writers store the named array, 1, every
+  /// step, by default. The array is written at the simulation time steps
+  /// that are a multiple of the cadence and is left out of the mesh
+  /// metadata written with the other steps, so that readers see which
+  /// arrays are available at each step.
+  /// @param[in] meshName the name of the mesh
+  /// @param[in] association vtkDataObject::POINT, vtkDataObject::CELL, etc
+  /// @param[in] arrayName the name of the array
+  /// @param[in] cadence the number of steps between writes, at least 1
+  /// @returns zero if successful
+  int SetArrayCadence(const std::string &meshName, int association,
+    const std::string &arrayName, int cadence);
+
+  int GetArrayCadence(const std::string &meshName, int association,
+    const std::string &arrayName) const;
+
+  /// For the named mesh, gets the list of required arrays that are due at
+  /// the time step according to their cadence
+  int GetRequiredArrays(const std::string &meshName, int association,
+    long timeStep, std::vector<std::string> &arrays) const;
+
+  /// Make a copy of the metadata that lists only the arrays that are
+  /// required and due at the time step. The metadata is not copied when
+  /// every array it lists is.
+  /// @param[in] timeStep the simulation time step
+  /// @param[inout] md the metadata, replaced by the copy
+  /// @returns zero if successful
+  int SelectArrays(long timeStep, MeshMetadataPtr &md) const;
+
   /// Clear the contents of the container
   void Clear();
 
@@ -119,6 +208,8 @@ public:
   using AssocArrayMapType = std::map<int, std::vector<std::string>>;
   using MeshArrayMapType = std::map<std::string, AssocArrayMapType>;
   using MeshNamesType = std::map<std::string, bool>;
+  using ArrayPrecisionMapType = std::map<std::string,
+    std::map<int, std::map<std::string, int>>>;
 
 private:
   friend class ArrayRequirementsIterator;
@@ -126,6 +217,9 @@ private:
 
   MeshNamesType MeshNames;
   MeshArrayMapType MeshArrayMap;
+  std::map<std::string, int> MaxLevels;
+  ArrayPrecisionMapType ArrayPrecision;
+  ArrayPrecisionMapType ArrayCadence;
 };
 
 // iterate over the meshes
@@ -0,0 +1,526 @@
+#include "DerivedFields.h"
+#include "ArrayDispatch.h"
+#include "TaskRuntime.h"
+#include "VTKUtils.h"
+#include "STLUtils.h"
+#include "XMLUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataSet.h>
+#include <vtkDataObject.h>
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdList.h>
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace sensei
+{
+
+namespace
+{
+// the values of a component, from the contiguous values when available
+template <typename T>
+double getValue(vtkDataArray *da, const T *vals, vtkIdType i, int c, int nc)
+{
+  return vals ? static_cast<double>(vals[i*nc + c]) : da->GetComponent(i, c);
+}
+
+// --------------------------------------------------------------------------
+void getLeaves(vtkDataObject *mesh, std::vector<vtkDataSet*> &blocks)
+{
+  if (vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(mesh))
+    {
+    vtkSmartPointer<vtkCompositeDataIterator> cdit;
+    cdit.TakeReference(cd->NewIterator());
+    cdit->SetSkipEmptyNodes(0);
+
+    for (cdit->InitTraversal(); !cdit->IsDoneWithTraversal(); cdit->GoToNextItem())
+      {
+      if (vtkDataSet *ds = dynamic_cast<vtkDataSet*>(cd->GetDataSet(cdit)))
+        blocks.push_back(ds);
+      }
+    }
+  else if (vtkDataSet *ds = dynamic_cast<vtkDataSet*>(mesh))
+    {
+    blocks.push_back(ds);
+    }
+}
+
+// the magnitude of each tuple, in chunks of tuples on the threads
+struct MagnitudeKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    const long chunk = 65536;
+    long nChunks = (this->NumTuples + chunk - 1) / chunk;
+
+    TaskRuntime::ParallelFor(nChunks, -1, [&](int, long q) -> int
+      {
+      long i0 = q*chunk;
+      long i1 = std::min(this->NumTuples, i0 + chunk);
+      for (long i = i0; i < i1; ++i)
+        {
+        double m = 0.0;
+        for (int c = 0; c < this->NumComponents; ++c)
+          {
+          double v = getValue(this->In, vals, i, c, this->NumComponents);
+          m += v*v;
+          }
+        this->Out[i] = std::sqrt(m);
+        }
+      return 0;
+      });
+  }
+
+  vtkDataArray *In;
+  long NumTuples;
+  int NumComponents;
+  double *Out;
+};
+
+// the average of the cell values around each point. the cells scatter to
+// their points so it is computed by one thread
+struct AverageToPointsKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    int nc = this->NumComponents;
+    long nPoints = this->Block->GetNumberOfPoints();
+    long nCells = this->Block->GetNumberOfCells();
+
+    std::vector<int> count(nPoints, 0);
+    std::fill(this->Out, this->Out + nPoints*nc, 0.0);
+
+    vtkIdList *ids = vtkIdList::New();
+    for (long i = 0; i < nCells; ++i)
+      {
+      this->Block->GetCellPoints(i, ids);
+      vtkIdType nIds = ids->GetNumberOfIds();
+      for (vtkIdType j = 0; j < nIds; ++j)
+        {
+        vtkIdType pt = ids->GetId(j);
+        for (int c = 0; c < nc; ++c)
+          this->Out[pt*nc + c] += getValue(this->In, vals, i, c, nc);
+        count[pt] += 1;
+        }
+      }
+    ids->Delete();
+
+    for (long i = 0; i < nPoints; ++i)
+      {
+      if (count[i] > 1)
+        {
+        for (int c = 0; c < nc; ++c)
+          this->Out[i*nc + c] /= count[i];
+        }
+      }
+  }
+
+  vtkDataSet *Block;
+  vtkDataArray *In;
+  int NumComponents;
+  double *Out;
+};
+
+// the partial derivatives of each component on a uniform grid, or when
+// Curl is set the curl of the 3 components. rows of the grid are spread
+// over the threads
+struct GradientKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    int nc = this->NumComponents;
+    long nx = this->Dims[0];
+    long ny = this->Dims[1];
+    long nz = this->Dims[2];
+    long stride[3] = {1, nx, nx*ny};
+
+    TaskRuntime::ParallelFor(ny*nz, -1, [&](int, long row) -> int
+      {
+      long idx[3] = {0, row % ny, row / ny};
+      std::vector<double> grad(3*nc);
+
+      for (idx[0] = 0; idx[0] < nx; ++idx[0])
+        {
+        long i = idx[0] + nx*(idx[1] + ny*idx[2]);
+
+        for (int d = 0; d < 3; ++d)
+          {
+          long n = this->Dims[d];
+          long lo = idx[d] > 0 ? -1 : 0;
+          long hi = idx[d] < n - 1 ? 1 : 0;
+
+          // a flat direction has no derivative
+          double dx = (hi - lo)*this->Spacing[d];
+          for (int c = 0; c < nc; ++c)
+            {
+            grad[c*3 + d] = (hi == lo) ? 0.0 :
+              (getValue(this->In, vals, i + hi*stride[d], c, nc) -
+              getValue(this->In, vals, i + lo*stride[d], c, nc)) / dx;
+            }
+          }
+
+        if (this->Curl)
+          {
+          double *w = this->Out + 3*i;
+          w[0] = grad[7] - grad[5];
+          w[1] = grad[2] - grad[6];
+          w[2] = grad[3] - grad[1];
+          }
+        else
+          {
+          std::copy(grad.begin(), grad.end(), this->Out + 3*nc*i);
+          }
+        }
+      return 0;
+      });
+  }
+
+  vtkDataArray *In;
+  int NumComponents;
+  long Dims[3];
+  double Spacing[3];
+  bool Curl;
+  double *Out;
+};
+
+// --------------------------------------------------------------------------
+int computeBlock(const DerivedFields::Field &field, vtkDataSet *ds)
+{
+  vtkFieldData *dsa = VTKUtils::GetAttributes(ds, field.InputAssociation);
+  vtkDataArray *in = dsa ? dsa->GetArray(field.Input.c_str()) : nullptr;
+  if (!in)
+    {
+    SENSEI_ERROR("The " << VTKUtils::GetAttributesName(field.InputAssociation)
+      << " data array \"" << field.Input << "\" needed by the derived array \""
+      << field.Name << "\" is missing")
+    return -1;
+    }
+
+  int nc = in->GetNumberOfComponents();
+  long nTuples = in->GetNumberOfTuples();
+
+  if ((field.Operation == DerivedFields::VORTICITY) && (nc != 3))
+    {
+    SENSEI_ERROR("The vorticity \"" << field.Name << "\" needs an input with"
+      " 3 components, \"" << field.Input << "\" has " << nc)
+    return -1;
+    }
+
+  vtkDoubleArray *out = vtkDoubleArray::New();
+  out->SetName(field.Name.c_str());
+  out->SetNumberOfComponents(DerivedFields::GetNumberOfComponents(field.Operation, nc));
+
+  switch (field.Operation)
+    {
+    case DerivedFields::MAGNITUDE:
+      {
+      out->SetNumberOfTuples(nTuples);
+      MagnitudeKernel kernel{in, nTuples, nc, out->GetPointer(0)};
+      ArrayDispatch::Execute(in, kernel);
+      }
+      break;
+
+    case DerivedFields::AVERAGE_TO_POINTS:
+      {
+      out->SetNumberOfTuples(ds->GetNumberOfPoints());
+      AverageToPointsKernel kernel{ds, in, nc, out->GetPointer(0)};
+      ArrayDispatch::Execute(in, kernel);
+      }
+      break;
+
+    case DerivedFields::GRADIENT:
+    case DerivedFields::VORTICITY:
+      {
+      vtkImageData *im = dynamic_cast<vtkImageData*>(ds);
+      if (!im)
+        {
+        SENSEI_ERROR("The " << DerivedFields::GetOperationName(field.Operation)
+          << " \"" << field.Name << "\" requires vtkImageData blocks, not "
+          << ds->GetClassName())
+        out->Delete();
+        return -1;
+        }
+
+      GradientKernel kernel;
+      kernel.In = in;
+      kernel.NumComponents = nc;
+      kernel.Curl = field.Operation == DerivedFields::VORTICITY;
+      im->GetSpacing(kernel.Spacing);
+
+      // cell values sit at the cell centers, one fewer in each direction
+      int *dims = im->GetDimensions();
+      int cells = field.InputAssociation == vtkDataObject::CELL ? 1 : 0;
+      for (int d = 0; d < 3; ++d)
+        kernel.Dims[d] = std::max(1, dims[d] - cells);
+
+      if (kernel.Dims[0]*kernel.Dims[1]*kernel.Dims[2] != nTuples)
+        {
+        SENSEI_ERROR("The size of \"" << field.Input << "\", " << nTuples
+          << ", does not match the block's dimensions")
+        out->Delete();
+        return -1;
+        }
+
+      out->SetNumberOfTuples(nTuples);
+      kernel.Out = out->GetPointer(0);
+      ArrayDispatch::Execute(in, kernel);
+      }
+      break;
+    }
+
+  VTKUtils::GetAttributes(ds, field.Association)->AddArray(out);
+  out->Delete();
+
+  return 0;
+}
+}
+
+// --------------------------------------------------------------------------
+int DerivedFields::GetOperation(const std::string &name, int &operation)
+{
+  const char *names[] = {"magnitude", "average_to_points", "gradient", "vorticity"};
+  for (int i = 0; i < 4; ++i)
+    {
+    if (name == names[i])
+      {
+      operation = i;
+      return 0;
+      }
+    }
+
+  SENSEI_ERROR("Invalid operation \"" << name << "\". The operations are"
+    " magnitude, average_to_points, gradient, and vorticity")
+  return -1;
+}
+
+// --------------------------------------------------------------------------
+const char *DerivedFields::GetOperationName(int operation)
+{
+  const char *names[] = {"magnitude", "average_to_points", "gradient", "vorticity"};
+  return ((operation >= 0) && (operation < 4)) ? names[operation] : "unknown";
+}
+
+// --------------------------------------------------------------------------
+int DerivedFields::GetNumberOfComponents(int operation, int inputComponents)
+{
+  switch (operation)
+    {
+    case MAGNITUDE:
+      return 1;
+    case GRADIENT:
+      return 3*inputComponents;
+    case VORTICITY:
+      return 3;
+    }
+  return inputComponents;
+}
+
+// --------------------------------------------------------------------------
+int DerivedFields::AddField(const std::string &meshName,
+  const std::string &name, int operation, const std::string &input,
+  int inputAssociation)
+{
+  if ((operation < MAGNITUDE) || (operation > VORTICITY))
+    {
+    SENSEI_ERROR("Invalid operation " << operation)
+    return -1;
+    }
+
+  Field field{meshName, name, operation, input, inputAssociation,
+    inputAssociation};
+
+  if (operation == AVERAGE_TO_POINTS)
+    {
+    field.InputAssociation = vtkDataObject::CELL;
+    field.Association = vtkDataObject::POINT;
+    }
+
+  if (this->Find(meshName, field.Association, name))
+    {
+    SENSEI_ERROR("The derived array \"" << name << "\" of mesh \""
+      << meshName << "\" was already declared")
+    return -1;
+    }
+
+  this->Fields.push_back(field);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int DerivedFields::Initialize(const pugi::xml_node &node)
+{
+  for (pugi::xml_node array = node.child("array"); array;
+    array = array.next_sibling("array"))
+    {
+    if (XMLUtils::RequireAttribute(array, "mesh") ||
+      XMLUtils::RequireAttribute(array, "name") ||
+      XMLUtils::RequireAttribute(array, "operation") ||
+      XMLUtils::RequireAttribute(array, "input"))
+      {
+      SENSEI_ERROR("Failed to parse a derived array")
+      return -1;
+      }
+
+    int operation = 0;
+    if (GetOperation(array.attribute("operation").as_string(), operation))
+      return -1;
+
+    int association = vtkDataObject::POINT;
+    if (array.attribute("association") && VTKUtils::GetAssociation(
+      array.attribute("association").as_string(), association))
+      return -1;
+
+    if (this->AddField(array.attribute("mesh").as_string(),
+      array.attribute("name").as_string(), operation,
+      array.attribute("input").as_string(), association))
+      return -1;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+const DerivedFields::Field *DerivedFields::Find(const std::string &meshName,
+  int association, const std::string &name) const
+{
+  for (const Field &field : this->Fields)
+    {
+    if ((field.MeshName == meshName) && (field.Association == association) &&
+      (field.Name == name))
+      return &field;
+    }
+  return nullptr;
+}
+
+// --------------------------------------------------------------------------
+int DerivedFields::AddMetadata(MeshMetadataPtr &md) const
+{
+  int nArrays = md->ArrayName.size();
+  int nAdded = 0;
+
+  for (const Field &field : this->Fields)
+    {
+    if (field.MeshName != md->MeshName)
+      continue;
+
+    // the input, which may be a derived array listed before. a mesh
+    // without it does not get the array
+    int nIn = md->ArrayName.size();
+    int in = 0;
+    while ((in < nIn) && ((md->ArrayName[in] != field.Input) ||
+      (md->ArrayCentering[in] != field.InputAssociation)))
+      ++in;
+
+    if (in == nIn)
+      continue;
+
+    md->ArrayName.push_back(field.Name);
+    md->ArrayCentering.push_back(field.Association);
+    md->ArrayType.push_back(VTK_DOUBLE);
+    md->ArrayComponents.push_back(
+      GetNumberOfComponents(field.Operation, md->ArrayComponents[in]));
+
+    ++nAdded;
+    }
+
+  if (nAdded == 0)
+    return 0;
+
+  md->NumArrays = md->ArrayName.size();
+
+  // the ranges are empty until set
+  std::array<double,2> empty;
+  STLUtils::InitializeRange(empty);
+
+  if (md->ArrayRange.size() == static_cast<size_t>(nArrays))
+    md->ArrayRange.resize(nArrays + nAdded, empty);
+
+  for (std::vector<std::array<double,2>> &rng : md->BlockArrayRange)
+    {
+    if (rng.size() == static_cast<size_t>(nArrays))
+      rng.resize(nArrays + nAdded, empty);
+    }
+
+  return nAdded;
+}
+
+// --------------------------------------------------------------------------
+int DerivedFields::SetRanges(vtkDataObject *mesh, MeshMetadataPtr &md) const
+{
+  std::vector<vtkDataSet*> blocks;
+  getLeaves(mesh, blocks);
+
+  // the block ranges are indexed by the local blocks in order
+  long nBlocks = blocks.size();
+  if (md->GlobalView || (md->BlockArrayRange.size() != static_cast<size_t>(nBlocks)))
+    {
+    SENSEI_ERROR("Ranges can be set in the local view of the mesh's blocks only")
+    return -1;
+    }
+
+  int nArrays = md->ArrayName.size();
+  for (int j = 0; j < nArrays; ++j)
+    {
+    if (!this->Find(md->MeshName, md->ArrayCentering[j], md->ArrayName[j]))
+      continue;
+
+    std::array<double,2> range;
+    STLUtils::InitializeRange(range);
+
+    for (long q = 0; q < nBlocks; ++q)
+      {
+      vtkFieldData *dsa = VTKUtils::GetAttributes(blocks[q], md->ArrayCentering[j]);
+      vtkDataArray *da = dsa ? dsa->GetArray(md->ArrayName[j].c_str()) : nullptr;
+
+      if (!da || (md->BlockArrayRange[q].size() != static_cast<size_t>(nArrays)))
+        continue;
+
+      da->GetRange(md->BlockArrayRange[q][j].data());
+      STLUtils::ReduceRange(md->BlockArrayRange[q][j], range);
+      }
+
+    if (md->ArrayRange.size() == static_cast<size_t>(nArrays))
+      md->ArrayRange[j] = range;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int DerivedFields::Compute(const Field &field, vtkDataObject *mesh)
+{
+  TimeEvent<128> mark("DerivedFields::Compute");
+
+  std::vector<vtkDataSet*> blocks;
+  getLeaves(mesh, blocks);
+
+  // blocks are spread over the threads, the kernels spread the work of a
+  // block over them too so that a rank with one block is threaded
+  if (TaskRuntime::ParallelFor(blocks.size(), -1,
+    [&](int, long q) -> int { return computeBlock(field, blocks[q]); }))
+    {
+    SENSEI_ERROR("Failed to compute the " << GetOperationName(field.Operation)
+      << " \"" << field.Name << "\" of mesh \"" << field.MeshName << "\"")
+    return -1;
+    }
+
+  return 0;
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef sensei_DerivedFields_h
+#define sensei_DerivedFields_h
+
+#include "MeshMetadata.h"
+
+#include <string>
+#include <vector>
+
+class vtkDataObject;
+namespace pugi { class xml_node; }
+
+namespace sensei
+{
+
+/// @class DerivedFields
+/// @brief arrays computed in situ from those of the simulation.
+///
+/// Several analyses often need the same quantity derived from the
+/// simulation's arrays, for instance a writer and a histogram both wanting
+/// the speed. Rather than each computing it, the derived arrays are
+/// declared once and computed once per step by the CachingDataAdaptor,
+/// which serves them to the analyses as if the simulation had provided
+/// them. They are listed in the mesh metadata, requested with AddArray,
+/// and computed on the first request, so a step in which no analysis asks
+/// for one costs nothing. The XML is
+///
+///   <derived>
+///     <array mesh="mesh" name="speed" operation="magnitude"
+///       input="velocity" association="point"/>
+///     <array mesh="mesh" name="p_avg" operation="average_to_points"
+///       input="pressure"/>
+///     <array mesh="mesh" name="vort" operation="vorticity"
+///       input="velocity" association="point"/>
+///   </derived>
+///
+/// The operations are
+///
+///   magnitude          the magnitude of each tuple, on any dataset
+///   average_to_points  the average of the cells using each point, from a
+///                      cell array to a point array, on any dataset
+///   gradient           the partial derivatives of each component, ordered
+///                      du/dx du/dy du/dz dv/dx ..., on vtkImageData
+///   vorticity          the curl of a 3 component array, on vtkImageData
+///
+/// association is that of the input, point or cell, and is point by
+/// default. The output has the input's association except for
+/// average_to_points, whose input is a cell array. A derived array may be
+/// the input of another, "vort" may be the input of a magnitude. Gradients
+/// use central differences in the interior and one sided differences on
+/// the boundary of each block, blocks with ghost layers thus have accurate
+/// values on their owned points. The values are double precision. The
+/// blocks of a mesh are computed in parallel on the TaskRuntime's threads.
+class DerivedFields
+{
+public:
+  enum {MAGNITUDE=0, AVERAGE_TO_POINTS=1, GRADIENT=2, VORTICITY=3};
+
+  /// the description of a derived array
+  struct Field
+  {
+    std::string MeshName;
+    std::string Name;
+    int Operation;
+    std::string Input;
+    int InputAssociation;
+    int Association;
+  };
+
+  /// parse the <derived> element. returns zero if successful
+  int Initialize(const pugi::xml_node &node);
+
+  /// add a derived array. returns zero if successful
+  int AddField(const std::string &meshName, const std::string &name,
+    int operation, const std::string &input, int inputAssociation);
+
+  /// true if no derived arrays were declared
+  bool Empty() const { return this->Fields.empty(); }
+
+  /// get the derived array with the name and association on the mesh, or
+  /// null if there is none
+  const Field *Find(const std::string &meshName, int association,
+    const std::string &name) const;
+
+  /// list the derived arrays of a mesh in the metadata. the array names,
+  /// centering, types and components are appended, ranges requested by the
+  /// metadata's flags are left empty for the caller to fill with
+  /// SetRanges. returns the number of arrays added
+  int AddMetadata(MeshMetadataPtr &md) const;
+
+  /// set the local ranges of the derived arrays added by AddMetadata from
+  /// the computed arrays of a mesh in the local view. returns zero if
+  /// successful
+  int SetRanges(vtkDataObject *mesh, MeshMetadataPtr &md) const;
+
+  /// compute the array on each block of the mesh and add it to the block.
+  /// the input must be present. returns zero if successful
+  static int Compute(const Field &field, vtkDataObject *mesh);
+
+  /// get an operation from its name. returns zero if successful
+  static int GetOperation(const std::string &name, int &operation);
+
+  /// the name of an operation
+  static const char *GetOperationName(int operation);
+
+  /// the number of components of the output of an operation
+  static int GetNumberOfComponents(int operation, int inputComponents);
+
+private:
+  std::vector<Field> Fields;
+};
+
+}
+
+#endif
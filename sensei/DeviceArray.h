@@ -0,0 +1,57 @@
+#ifndef sensei_DeviceArray_h
+#define sensei_DeviceArray_h
+
+#include <functional>
+
+namespace sensei
+{
+
+/// the memory spaces that an array may reside in
+enum MemorySpace
+{
+  MEMORY_SPACE_HOST = 0,
+  MEMORY_SPACE_CUDA = 1,
+  MEMORY_SPACE_HIP = 2
+};
+
+/// returns the name of the memory space, host, cuda, or hip
+inline const char *GetMemorySpaceName(int space)
+{
+  switch (space)
+    {
+    case MEMORY_SPACE_HOST: return "host";
+    case MEMORY_SPACE_CUDA: return "cuda";
+    case MEMORY_SPACE_HIP: return "hip";
+    }
+  return "unknown";
+}
+
+/// @class DeviceArray
+/// @brief describes a simulation owned array in device memory.
+///
+/// The values are NumTuples tuples of NumComponents interleaved components
+/// of the VTK type DataType. The memory is owned by the simulation and must
+/// remain valid until the data adaptor's ReleaseData is called. The copy to
+/// host memory is done by a callback provided by the simulation, so that
+/// SENSEI does not depend on a particular device runtime.
+struct DeviceArray
+{
+  DeviceArray() : Data(nullptr), MemorySpace(MEMORY_SPACE_HOST),
+    DeviceId(0), DataType(0), NumTuples(0), NumComponents(1) {}
+
+  // copies all of the values to the host buffer dest, which is large
+  // enough to hold them. returns 0 if successful.
+  using CopyFunction = std::function<int(void *dest)>;
+
+  void *Data;             // the values
+  int MemorySpace;        // one of MemorySpace
+  int DeviceId;           // the device the values reside on
+  int DataType;           // VTK type enum, VTK_FLOAT, VTK_DOUBLE, etc
+  long NumTuples;
+  int NumComponents;
+  CopyFunction CopyToHost;
+};
+
+}
+
+#endif
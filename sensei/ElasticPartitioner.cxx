@@ -0,0 +1,226 @@
+#include "ElasticPartitioner.h"
+#include "BlockPartitioner.h"
+#include "ConfigurablePartitioner.h"
+#include "BinaryStream.h"
+#include "Profiler.h"
+
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+ElasticPartitioner::ElasticPartitioner() : Part(BlockPartitioner::New()),
+  MinRanks(1), InitialRanks(0), LowMark(0.5), HighMark(0.9),
+  EventName("ConfigurableAnalysis::Execute"), NumActive(0),
+  ActiveCommSize(0), ActiveComm(MPI_COMM_NULL), ParentComm(MPI_COMM_NULL),
+  Measured(false), SkipNext(false), LastBusy(0.0)
+{
+  Profiler::TrackEvent(this->EventName.c_str());
+}
+
+// --------------------------------------------------------------------------
+ElasticPartitioner::~ElasticPartitioner()
+{
+  int fin = 0;
+  MPI_Finalized(&fin);
+  if (!fin && (this->ActiveComm != MPI_COMM_NULL))
+    MPI_Comm_free(&this->ActiveComm);
+}
+
+// --------------------------------------------------------------------------
+void ElasticPartitioner::SetEventName(const std::string &name)
+{
+  this->EventName = name;
+  Profiler::TrackEvent(name.c_str());
+}
+
+// --------------------------------------------------------------------------
+int ElasticPartitioner::Resize(MPI_Comm comm, int nRanks)
+{
+  int minRanks = std::max(1, std::min(this->MinRanks, nRanks));
+
+  // the first step, or the receiver's communicator changed
+  if ((this->NumActive < 1) || (this->NumActive > nRanks))
+    {
+    this->NumActive = this->InitialRanks > 0 ?
+      std::max(minRanks, std::min(this->InitialRanks, nRanks)) : nRanks;
+
+    this->Measured = false;
+    }
+
+  double busy = Profiler::GetTrackedTime(this->EventName.c_str());
+  std::chrono::steady_clock::time_point wall = std::chrono::steady_clock::now();
+
+  if (this->Measured && !this->SkipNext && Profiler::Enabled())
+    {
+    // the slowest rank sets the pace, all ranks agree on the result
+    double times[2] = {std::max(busy - this->LastBusy, 0.0),
+      std::chrono::duration<double>(wall - this->LastWall).count()};
+
+    MPI_Allreduce(MPI_IN_PLACE, times, 2, MPI_DOUBLE, MPI_MAX, comm);
+
+    double util = times[1] > 0.0 ? times[0]/times[1] : 0.0;
+
+    if ((util > this->HighMark) || (util < this->LowMark))
+      {
+      // assume the work spreads evenly over the active ranks
+      double target = 0.5*(this->LowMark + this->HighMark);
+      int nActive = int(std::ceil(this->NumActive*util/target));
+
+      // always move when outside the marks
+      if (util > this->HighMark)
+        nActive = std::max(nActive, this->NumActive + 1);
+      else
+        nActive = std::min(nActive, this->NumActive - 1);
+
+      nActive = std::max(minRanks, std::min(nActive, nRanks));
+
+      if (nActive != this->NumActive)
+        {
+        int rank = 0;
+        MPI_Comm_rank(comm, &rank);
+        if (this->Verbose && (rank == 0))
+          SENSEI_STATUS("ElasticPartitioner utilization " << util
+            << " resizing the active set from " << this->NumActive
+            << " to " << nActive << " ranks")
+
+        this->NumActive = nActive;
+        this->SkipNext = true;
+        }
+      }
+    }
+  else
+    {
+    this->SkipNext = false;
+    }
+
+  this->Measured = true;
+  this->LastBusy = busy;
+  this->LastWall = wall;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+MPI_Comm ElasticPartitioner::GetActiveCommunicator(MPI_Comm comm)
+{
+  if ((comm == this->ParentComm) && (this->NumActive == this->ActiveCommSize))
+    return this->ActiveComm;
+
+  if (this->ActiveComm != MPI_COMM_NULL)
+    MPI_Comm_free(&this->ActiveComm);
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  // the active ranks keep their order, so that rank i of the active
+  // communicator is rank i of the receiver's
+  MPI_Comm_split(comm, rank < this->NumActive ? 0 : MPI_UNDEFINED,
+    rank, &this->ActiveComm);
+
+  this->ParentComm = comm;
+  this->ActiveCommSize = this->NumActive;
+
+  return this->ActiveComm;
+}
+
+// --------------------------------------------------------------------------
+int ElasticPartitioner::GetPartition(MPI_Comm comm, const MeshMetadataPtr &mdIn,
+  MeshMetadataPtr &mdOut)
+{
+  TimeEvent<128> mark("ElasticPartitioner::GetPartition");
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  // a new step starts when the first mesh is partitioned again
+  if (this->LeadMesh.empty())
+    this->LeadMesh = mdIn->MeshName;
+
+  if ((mdIn->MeshName == this->LeadMesh) && this->Resize(comm, nRanks))
+    return -1;
+
+  MPI_Comm active = this->GetActiveCommunicator(comm);
+
+  // the nested partitioner runs on the active ranks, rank 0 of comm is
+  // always one of them and shares the result with the idle ranks
+  int ierr = 0;
+  BinaryStream bs;
+  if (active != MPI_COMM_NULL)
+    {
+    if (this->Part->GetPartition(active, mdIn, mdOut))
+      {
+      SENSEI_ERROR("Failed to partition mesh \"" << mdIn->MeshName
+        << "\" over " << this->NumActive << " ranks")
+      ierr = -1;
+      }
+    else if (rank == 0)
+      {
+      mdOut->ToStream(bs);
+      }
+    }
+
+  MPI_Allreduce(MPI_IN_PLACE, &ierr, 1, MPI_INT, MPI_MIN, comm);
+  if (ierr)
+    return -1;
+
+  bs.Broadcast(comm, 0);
+
+  if (rank)
+    {
+    mdOut = MeshMetadata::New();
+    mdOut->FromStream(bs);
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ElasticPartitioner::Initialize(pugi::xml_node &node)
+{
+  TimeEvent<128> mark("ElasticPartitioner::Initialize");
+
+  this->MinRanks = node.attribute("min_ranks").as_int(1);
+  this->InitialRanks = node.attribute("initial_ranks").as_int(0);
+  this->LowMark = node.attribute("low").as_double(0.5);
+  this->HighMark = node.attribute("high").as_double(0.9);
+
+  if (node.attribute("event"))
+    this->SetEventName(node.attribute("event").value());
+
+  if ((this->LowMark < 0.0) || (this->HighMark <= this->LowMark))
+    {
+    SENSEI_ERROR("The low mark must be non-negative and less than the high mark")
+    return -1;
+    }
+
+  pugi::xml_node partNode = node.child("partitioner");
+  if (partNode)
+    {
+    ConfigurablePartitionerPtr part = ConfigurablePartitioner::New();
+    if (part->Initialize(partNode))
+      {
+      SENSEI_ERROR("Failed to initialize the nested partitioner")
+      return -1;
+      }
+    this->Part = part;
+    }
+
+  if (!Profiler::Enabled())
+    SENSEI_WARNING("Event profiling is disabled. ElasticPartitioner will not"
+      " resize the active set. Set PROFILER_ENABLE=1 to enable it.")
+
+  SENSEI_STATUS("Configured ElasticPartitioner min_ranks=" << this->MinRanks
+    << " initial_ranks=" << this->InitialRanks << " low=" << this->LowMark
+    << " high=" << this->HighMark << " event=\"" << this->EventName << "\"")
+
+  return 0;
+}
+
+}
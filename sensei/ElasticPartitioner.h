@@ -0,0 +1,129 @@
+#ifndef sensei_ElasticPartitioner_h
+#define sensei_ElasticPartitioner_h
+
+#include "Partitioner.h"
+
+#include <chrono>
+#include <string>
+
+namespace sensei
+{
+
+class ElasticPartitioner;
+using ElasticPartitionerPtr = std::shared_ptr<sensei::ElasticPartitioner>;
+
+/// @class ElasticPartitioner
+/// @brief places blocks on an active subset of the receiver ranks whose
+/// size follows the measured load.
+///
+/// The blocks are partitioned by a nested partitioner over the first N
+/// ranks of the receiver's communicator, the remaining ranks receive no
+/// data and stay idle. Between steps N is grown or shrunk from the
+/// utilization of the active ranks, the largest time spent in the
+/// Profiler's named event, by default ConfigurableAnalysis::Execute, over
+/// the wall time since the previous step. When the utilization exceeds
+/// the high mark the receivers are falling behind and N grows, when it
+/// drops below the low mark N shrinks. In both cases N is chosen so that
+/// the projected utilization is midway between the marks. The step after
+/// a change is not measured, since it includes the cost of moving the
+/// blocks. When event profiling is disabled N stays at its initial value.
+///
+/// The measurement is made when the first mesh seen is partitioned, the
+/// other meshes of the step are placed on the same ranks.
+///
+/// XML attributes:
+///
+///   min_ranks     -- the smallest active set. default 1
+///   initial_ranks -- the active set on the first step. default all ranks
+///   low           -- utilization below which ranks are released. default 0.5
+///   high          -- utilization above which ranks are added. default 0.9
+///   event         -- the Profiler event whose duration is the busy time
+///
+/// A nested partitioner element selects the partitioner used over the
+/// active ranks, the block partitioner is used when there is none.
+///
+/// <partitioner type="elastic" min_ranks="2" low="0.4" high="0.85">
+///   <partitioner type="block"/>
+/// </partitioner>
+class ElasticPartitioner : public sensei::Partitioner
+{
+public:
+  static sensei::ElasticPartitionerPtr New()
+  { return ElasticPartitionerPtr(new ElasticPartitioner); }
+
+  ~ElasticPartitioner();
+
+  const char *GetClassName() override { return "ElasticPartitioner"; }
+
+  // given an existing partitioning of data passed in the first MeshMetadata
+  // argument,return a new partittioning in the second MeshMetadata argument.
+  // this must be called once per step for each mesh.
+  int GetPartition(MPI_Comm comm, const sensei::MeshMetadataPtr &in,
+     sensei::MeshMetadataPtr &out) override;
+
+  // Set/get the partitioner used over the active ranks
+  void SetPartitioner(const PartitionerPtr &part) { this->Part = part; }
+  PartitionerPtr GetPartitioner() { return this->Part; }
+
+  // Set/get the bounds of the active set. 0 for the initial size selects
+  // all ranks
+  void SetMinRanks(int val) { this->MinRanks = val; }
+  int GetMinRanks() { return this->MinRanks; }
+
+  void SetInitialRanks(int val) { this->InitialRanks = val; }
+  int GetInitialRanks() { return this->InitialRanks; }
+
+  // Set/get the utilization marks
+  void SetLowMark(double val) { this->LowMark = val; }
+  double GetLowMark() { return this->LowMark; }
+
+  void SetHighMark(double val) { this->HighMark = val; }
+  double GetHighMark() { return this->HighMark; }
+
+  // Set/get the name of the Profiler event that measures busy time
+  void SetEventName(const std::string &name);
+  const std::string &GetEventName() { return this->EventName; }
+
+  // get the number of ranks currently receiving data
+  int GetNumberOfActiveRanks() { return this->NumActive; }
+
+  // Initialize from XML
+  int Initialize(pugi::xml_node &node) override;
+
+protected:
+  ElasticPartitioner();
+  ElasticPartitioner(const ElasticPartitioner &) = delete;
+
+  // measure the utilization and update the size of the active set
+  int Resize(MPI_Comm comm, int nRanks);
+
+  // get a communicator made of the active ranks, MPI_COMM_NULL on the
+  // others. collective over comm when the active set has changed
+  MPI_Comm GetActiveCommunicator(MPI_Comm comm);
+
+  PartitionerPtr Part;
+  int MinRanks;
+  int InitialRanks;
+  double LowMark;
+  double HighMark;
+  std::string EventName;
+
+  // the size of the active set, and the communicator over it split from
+  // ParentComm
+  int NumActive;
+  int ActiveCommSize;
+  MPI_Comm ActiveComm;
+  MPI_Comm ParentComm;
+
+  // the mesh whose partitioning starts a step, and the measurements
+  // taken then
+  std::string LeadMesh;
+  bool Measured;
+  bool SkipNext;
+  double LastBusy;
+  std::chrono::steady_clock::time_point LastWall;
+};
+
+}
+
+#endif
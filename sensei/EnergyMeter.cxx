@@ -0,0 +1,434 @@
+#include "EnergyMeter.h"
+#include "Error.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace sensei
+{
+
+namespace
+{
+// a sensor read from a sysfs file, either an energy counter in micro
+// joules or an average power in micro watts
+struct Sensor
+{
+  int Domain;
+  int Fd;
+  bool Power;
+  long long Range;    // the value an energy counter wraps at, or 0
+  long long Last;     // the counter at the last read
+};
+
+// the NVML functions used, resolved at run time. the return is
+// NVML_SUCCESS, 0, when successful
+typedef int (*nvmlInit_t)();
+typedef int (*nvmlShutdown_t)();
+typedef int (*nvmlDeviceGetCount_t)(unsigned int*);
+typedef int (*nvmlDeviceGetHandleByIndex_t)(unsigned int, void**);
+typedef int (*nvmlDeviceGetTotalEnergyConsumption_t)(void*, unsigned long long*);
+
+// the sensors, opened at the first read
+struct Meter
+{
+  Meter() : Opened(false), Nvml(nullptr), NvmlShutdown(nullptr),
+    NvmlEnergy(nullptr), LastTime(0.0), Has{false,false,false},
+    Total{0ll,0ll,0ll} {}
+
+  ~Meter();
+
+  // find and open the sensors, the caller must hold the mutex
+  void Open();
+  void OpenRapl();
+  void OpenHwmon();
+  void OpenNvml();
+
+  // accumulate the energy since the last update, the caller must hold the
+  // mutex
+  void Update(double now);
+
+  std::mutex Mutex;
+  bool Opened;
+  std::vector<Sensor> Sensors;
+
+  void *Nvml;
+  nvmlShutdown_t NvmlShutdown;
+  nvmlDeviceGetTotalEnergyConsumption_t NvmlEnergy;
+  std::vector<void*> Gpus;
+  std::vector<unsigned long long> GpuLast;  // milli joules
+
+  double LastTime;
+  bool Has[EnergyMeter::NUM_DOMAINS];
+  long long Total[EnergyMeter::NUM_DOMAINS];
+};
+
+Meter meter;
+
+// --------------------------------------------------------------------------
+double getTime()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#if defined(__linux__)
+// --------------------------------------------------------------------------
+bool readValue(int fd, long long &val)
+{
+  char buf[64];
+  ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+  if (n <= 0)
+    return false;
+
+  buf[n] = '\0';
+  val = strtoll(buf, nullptr, 10);
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool readFile(const std::string &fileName, std::string &str)
+{
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  char buf[256];
+  ssize_t n = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+
+  if (n <= 0)
+    return false;
+
+  // strip the newline
+  while ((n > 0) && ((buf[n-1] == '\n') || (buf[n-1] == ' ')))
+    --n;
+
+  str.assign(buf, n);
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void listDirectory(const std::string &dirName, std::vector<std::string> &entries)
+{
+  entries.clear();
+
+  DIR *dir = opendir(dirName.c_str());
+  if (!dir)
+    return;
+
+  while (struct dirent *ent = readdir(dir))
+    {
+    if (ent->d_name[0] != '.')
+      entries.push_back(ent->d_name);
+    }
+
+  closedir(dir);
+}
+#endif
+}
+
+// --------------------------------------------------------------------------
+Meter::~Meter()
+{
+#if defined(__linux__)
+  for (const Sensor &s : this->Sensors)
+    close(s.Fd);
+
+  if (this->NvmlShutdown)
+    this->NvmlShutdown();
+#endif
+}
+
+// --------------------------------------------------------------------------
+void Meter::OpenRapl()
+{
+#if defined(__linux__)
+  // the package zones are intel-rapl:<n>, their sub zones intel-rapl:<n>:<m>
+  // the core and uncore sub zones are part of the package and are left out
+  std::string base = "/sys/class/powercap/";
+  std::vector<std::string> zones;
+  listDirectory(base, zones);
+
+  bool warned = false;
+  for (const std::string &zone : zones)
+    {
+    if (zone.compare(0, 11, "intel-rapl:"))
+      continue;
+
+    std::string path = base + zone + "/";
+
+    std::string name;
+    if (!readFile(path + "name", name))
+      continue;
+
+    int domain = -1;
+    if (name.compare(0, 8, "package-") == 0)
+      domain = EnergyMeter::DOMAIN_CPU;
+    else if (name == "dram")
+      domain = EnergyMeter::DOMAIN_DRAM;
+    else
+      continue;
+
+    Sensor s{domain, -1, false, 0ll, 0ll};
+    if ((s.Fd = open((path + "energy_uj").c_str(), O_RDONLY)) < 0)
+      {
+      if (!warned)
+        {
+        const char *estr = strerror(errno);
+        SENSEI_WARNING("Failed to open the RAPL energy counters. " << estr
+          << ". Check the permissions of " << path << "energy_uj")
+        warned = true;
+        }
+      continue;
+      }
+
+    std::string range;
+    if (readFile(path + "max_energy_range_uj", range))
+      s.Range = strtoll(range.c_str(), nullptr, 10);
+
+    if (!readValue(s.Fd, s.Last))
+      {
+      close(s.Fd);
+      continue;
+      }
+
+    this->Has[domain] = true;
+    this->Sensors.push_back(s);
+    }
+#endif
+}
+
+// --------------------------------------------------------------------------
+void Meter::OpenHwmon()
+{
+#if defined(__linux__)
+  std::string base = "/sys/class/hwmon/";
+  std::vector<std::string> hwmons;
+  listDirectory(base, hwmons);
+
+  for (const std::string &hwmon : hwmons)
+    {
+    std::string path = base + hwmon + "/";
+
+    std::string name;
+    if (!readFile(path + "name", name))
+      continue;
+
+    // GPUs are always read. the CPU drivers report the energy RAPL does,
+    // they are used when it is not available. of those that report both
+    // per core and per socket only the sockets are read
+    bool gpu = name == "amdgpu";
+    if (!gpu && this->Has[EnergyMeter::DOMAIN_CPU])
+      continue;
+
+    int domain = gpu ? EnergyMeter::DOMAIN_GPU : EnergyMeter::DOMAIN_CPU;
+
+    std::vector<std::string> files;
+    listDirectory(path, files);
+
+    bool haveEnergy = false;
+    for (const std::string &file : files)
+      {
+      size_t n = file.size();
+      if (file.compare(0, 6, "energy") || (n < 12) ||
+        file.compare(n - 6, 6, "_input"))
+        continue;
+
+      std::string label;
+      if (!gpu && readFile(path + file.substr(0, n - 6) + "_label", label) &&
+        (label.compare(0, 7, "Esocket")))
+        continue;
+
+      Sensor s{domain, -1, false, 0ll, 0ll};
+      if ((s.Fd = open((path + file).c_str(), O_RDONLY)) < 0)
+        continue;
+
+      if (!readValue(s.Fd, s.Last))
+        {
+        close(s.Fd);
+        continue;
+        }
+
+      haveEnergy = true;
+      this->Has[domain] = true;
+      this->Sensors.push_back(s);
+      }
+
+    // most amdgpus report power only. it is integrated over the time
+    // between updates
+    if (gpu && !haveEnergy)
+      {
+      Sensor s{domain, -1, true, 0ll, 0ll};
+      if ((s.Fd = open((path + "power1_average").c_str(), O_RDONLY)) < 0)
+        continue;
+
+      if (!readValue(s.Fd, s.Last))
+        {
+        close(s.Fd);
+        continue;
+        }
+
+      this->Has[domain] = true;
+      this->Sensors.push_back(s);
+      }
+    }
+#endif
+}
+
+// --------------------------------------------------------------------------
+void Meter::OpenNvml()
+{
+#if defined(__linux__)
+  // the library is optional, it is present where the driver is
+  this->Nvml = dlopen("libnvidia-ml.so.1", RTLD_NOW|RTLD_LOCAL);
+  if (!this->Nvml)
+    return;
+
+  nvmlInit_t init = reinterpret_cast<nvmlInit_t>(
+    dlsym(this->Nvml, "nvmlInit_v2"));
+
+  nvmlDeviceGetCount_t getCount = reinterpret_cast<nvmlDeviceGetCount_t>(
+    dlsym(this->Nvml, "nvmlDeviceGetCount_v2"));
+
+  nvmlDeviceGetHandleByIndex_t getHandle =
+    reinterpret_cast<nvmlDeviceGetHandleByIndex_t>(
+      dlsym(this->Nvml, "nvmlDeviceGetHandleByIndex_v2"));
+
+  nvmlShutdown_t shutdown = reinterpret_cast<nvmlShutdown_t>(
+    dlsym(this->Nvml, "nvmlShutdown"));
+
+  this->NvmlEnergy = reinterpret_cast<nvmlDeviceGetTotalEnergyConsumption_t>(
+    dlsym(this->Nvml, "nvmlDeviceGetTotalEnergyConsumption"));
+
+  unsigned int nDevices = 0;
+  if (!init || !getCount || !getHandle || !shutdown || !this->NvmlEnergy ||
+    init())
+    {
+    this->NvmlEnergy = nullptr;
+    return;
+    }
+
+  this->NvmlShutdown = shutdown;
+
+  if (getCount(&nDevices))
+    return;
+
+  // the energy counter is available from Volta on
+  for (unsigned int i = 0; i < nDevices; ++i)
+    {
+    void *dev = nullptr;
+    unsigned long long mj = 0;
+    if (getHandle(i, &dev) || this->NvmlEnergy(dev, &mj))
+      continue;
+
+    this->Gpus.push_back(dev);
+    this->GpuLast.push_back(mj);
+    this->Has[EnergyMeter::DOMAIN_GPU] = true;
+    }
+#endif
+}
+
+// --------------------------------------------------------------------------
+void Meter::Open()
+{
+  this->Opened = true;
+  this->OpenRapl();
+  this->OpenHwmon();
+  this->OpenNvml();
+  this->LastTime = getTime();
+}
+
+// --------------------------------------------------------------------------
+void Meter::Update(double now)
+{
+#if defined(__linux__)
+  double dt = now - this->LastTime;
+
+  for (Sensor &s : this->Sensors)
+    {
+    long long val = 0;
+    if (!readValue(s.Fd, val))
+      continue;
+
+    if (s.Power)
+      {
+      this->Total[s.Domain] += static_cast<long long>(val*dt);
+      continue;
+      }
+
+    // the RAPL counters wrap around
+    long long delta = val - s.Last;
+    if ((delta < 0) && (s.Range > 0))
+      delta += s.Range;
+
+    if (delta > 0)
+      this->Total[s.Domain] += delta;
+
+    s.Last = val;
+    }
+
+  size_t nGpus = this->Gpus.size();
+  for (size_t i = 0; i < nGpus; ++i)
+    {
+    unsigned long long mj = 0;
+    if (this->NvmlEnergy(this->Gpus[i], &mj))
+      continue;
+
+    if (mj > this->GpuLast[i])
+      this->Total[EnergyMeter::DOMAIN_GPU] += 1000ll*(mj - this->GpuLast[i]);
+
+    this->GpuLast[i] = mj;
+    }
+#else
+  (void)now;
+#endif
+
+  this->LastTime = now;
+}
+
+// --------------------------------------------------------------------------
+void EnergyMeter::Read(long long energy[NUM_DOMAINS])
+{
+  std::lock_guard<std::mutex> lock(meter.Mutex);
+
+  if (!meter.Opened)
+    meter.Open();
+
+  double now = getTime();
+  if (now - meter.LastTime >= 1.0e-3)
+    meter.Update(now);
+
+  for (int i = 0; i < NUM_DOMAINS; ++i)
+    energy[i] = meter.Has[i] ? meter.Total[i] : -1ll;
+}
+
+// --------------------------------------------------------------------------
+bool EnergyMeter::Available()
+{
+  long long energy[NUM_DOMAINS];
+  EnergyMeter::Read(energy);
+
+  return (energy[DOMAIN_CPU] >= 0) || (energy[DOMAIN_DRAM] >= 0) ||
+    (energy[DOMAIN_GPU] >= 0);
+}
+
+// --------------------------------------------------------------------------
+const char *EnergyMeter::GetDomainName(int domain)
+{
+  const char *names[] = {"cpu", "dram", "gpu"};
+  return ((domain >= 0) && (domain < NUM_DOMAINS)) ? names[domain] : "unknown";
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef sensei_EnergyMeter_h
+#define sensei_EnergyMeter_h
+
+namespace sensei
+{
+
+/// @class EnergyMeter
+/// @brief reads the energy used by the node from its power sensors.
+///
+/// The energy is accumulated from the sensors the node exposes, and is
+/// reported in micro joules, per domain, since the meter was first read.
+///
+///   DOMAIN_CPU  : the RAPL package zones of /sys/class/powercap, or when
+///                 there are none the energy inputs of the CPU hwmon
+///                 drivers, amd_energy and the like
+///   DOMAIN_DRAM : the RAPL dram zones
+///   DOMAIN_GPU  : NVIDIA GPUs through NVML, loaded at run time so that
+///                 there is no build dependency, and the energy, or the
+///                 average power integrated over time, of amdgpu hwmons
+///
+/// A domain without any sensor reads -1. The sensors measure the whole
+/// node, the energy of a rank's work includes that of the other ranks and
+/// threads running on the node at the same time.
+///
+/// Reads may be made from any thread. The sensors are refreshed at most
+/// once per millisecond, about the rate RAPL updates at, reads in between
+/// return the last values, so that reading at the boundaries of short
+/// events costs a lock. Access to RAPL is often restricted to root, see
+/// the permissions of /sys/class/powercap/intel-rapl:0/energy_uj, in that
+/// case a warning is issued and the domain reads -1.
+class EnergyMeter
+{
+public:
+  enum {DOMAIN_CPU=0, DOMAIN_DRAM=1, DOMAIN_GPU=2, NUM_DOMAINS=3};
+
+  /// get the energy used by the node since the first read, in micro
+  /// joules, or -1 for the domains without sensors
+  static void Read(long long energy[NUM_DOMAINS]);
+
+  /// returns true if any domain has a sensor
+  static bool Available();
+
+  /// the name of a domain, cpu, dram, or gpu
+  static const char *GetDomainName(int domain);
+};
+
+}
+
+#endif
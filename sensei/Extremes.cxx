@@ -0,0 +1,599 @@
+#include "Extremes.h"
+#include "ArrayDispatch.h"
+#include "DataAdaptor.h"
+#include "MeshMetadata.h"
+#include "MeshMetadataMap.h"
+#include "Profiler.h"
+#include "TaskRuntime.h"
+#include "TopK.h"
+#include "VTKUtils.h"
+#include "Error.h"
+
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSet.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkFieldData.h>
+#include <vtkIdList.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkRectilinearGrid.h>
+#include <vtkSmartPointer.h>
+#include <vtkStructuredGrid.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+using Location = sensei::Extremes::Location;
+
+namespace
+{
+// the values are scanned by the threads in spans of this size
+const long spanSize = 65536;
+
+// a candidate while scanning, the local block and the value's index in it
+struct Item
+{
+  int Block;
+  long long Index;
+};
+
+// a local block and what is needed to scan its values
+struct BlockInfo
+{
+  vtkDataSet *Block;
+  int Id;
+  vtkDataArray *Array;
+  const unsigned char *Ghosts;
+  const sensei::VTKUtils::InteriorRange *Interior;
+};
+
+// a span of the values of a local block
+struct Span
+{
+  int Block;
+  long Begin;
+  long End;
+};
+
+// keep the largest of the values [begin, end) that are not ghosts or NaN.
+// the values are multiplied by sign so that the smallest may be kept.
+// values of arrays that are not stored contiguously are read one at a time
+template <typename T>
+void scanValues(vtkDataArray *da, const T *vals, const unsigned char *ghosts,
+  long begin, long end, double sign, int block,
+  sensei::TopK<double,Item> &top)
+{
+  for (long i = begin; i < end; ++i)
+    {
+    if (ghosts && ghosts[i])
+      continue;
+
+    double x = sign * (vals ? static_cast<double>(vals[i]) :
+      da->GetComponent(i, 0));
+
+    if (x != x)
+      continue;
+
+    top.Insert(x, Item{block, i});
+    }
+}
+
+// scan a span of a block, when the ghosts are given by an index range only
+// the spans of interior values are visited
+template <typename T>
+void scanSpan(const BlockInfo &bi, const T *vals, long begin, long end,
+  double sign, int block, sensei::TopK<double,Item> &top)
+{
+  if (!bi.Interior)
+    {
+    scanValues(bi.Array, vals, bi.Ghosts, begin, end, sign, block, top);
+    return;
+    }
+
+  bi.Interior->ForEachSpan(begin, end,
+    [&](long spanBegin, long spanEnd, bool isInterior)
+    {
+    if (isInterior)
+      scanValues(bi.Array, vals, static_cast<const unsigned char*>(nullptr),
+        spanBegin, spanEnd, sign, block, top);
+    });
+}
+
+// scan a span of a block, see ArrayDispatch
+struct ScanKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    scanSpan(*this->Info, vals, this->Begin, this->End, this->Sign,
+      this->Block, *this->Top);
+  }
+
+  const BlockInfo *Info;
+  long Begin;
+  long End;
+  double Sign;
+  int Block;
+  sensei::TopK<double,Item> *Top;
+};
+
+// find where the index'th value of a block is
+void locate(const BlockInfo &bi, int association, long long index,
+  int rank, Location &loc)
+{
+  loc.Rank = rank;
+  loc.Block = bi.Id;
+  loc.Index = index;
+
+  // the i,j,k index of Cartesian blocks is found from their extent
+  int ext[6] = {0, -1, 0, -1, 0, -1};
+  bool cartesian = true;
+  if (vtkImageData *im = dynamic_cast<vtkImageData*>(bi.Block))
+    im->GetExtent(ext);
+  else if (vtkRectilinearGrid *rg = dynamic_cast<vtkRectilinearGrid*>(bi.Block))
+    rg->GetExtent(ext);
+  else if (vtkStructuredGrid *sg = dynamic_cast<vtkStructuredGrid*>(bi.Block))
+    sg->GetExtent(ext);
+  else
+    cartesian = false;
+
+  bool points = association == vtkDataObject::POINT;
+
+  if (cartesian)
+    {
+    long long dims[3];
+    for (int q = 0; q < 3; ++q)
+      {
+      long long n = ext[2*q+1] - ext[2*q];
+      dims[q] = points ? n + 1 : std::max(1ll, n);
+      }
+
+    loc.IJK[0] = ext[0] + index % dims[0];
+    loc.IJK[1] = ext[2] + (index / dims[0]) % dims[1];
+    loc.IJK[2] = ext[4] + index / (dims[0]*dims[1]);
+    }
+  else
+    {
+    loc.IJK[0] = loc.IJK[1] = loc.IJK[2] = -1;
+    }
+
+  // the world coordinates of the point, or of the center of the cell
+  if (points)
+    {
+    bi.Block->GetPoint(index, loc.X);
+    return;
+    }
+
+  loc.X[0] = loc.X[1] = loc.X[2] = 0.0;
+
+  vtkSmartPointer<vtkIdList> ids = vtkSmartPointer<vtkIdList>::New();
+  bi.Block->GetCellPoints(index, ids);
+
+  vtkIdType nIds = ids->GetNumberOfIds();
+  for (vtkIdType j = 0; j < nIds; ++j)
+    {
+    double x[3];
+    bi.Block->GetPoint(ids->GetId(j), x);
+    loc.X[0] += x[0];
+    loc.X[1] += x[1];
+    loc.X[2] += x[2];
+    }
+
+  if (nIds)
+    {
+    loc.X[0] /= nIds;
+    loc.X[1] /= nIds;
+    loc.X[2] /= nIds;
+    }
+}
+}
+
+namespace sensei
+{
+
+//-----------------------------------------------------------------------------
+senseiNewMacro(Extremes);
+
+//-----------------------------------------------------------------------------
+Extremes::Extremes() : K(100), Smallest(false), Threads(1)
+{
+}
+
+//-----------------------------------------------------------------------------
+Extremes::~Extremes()
+{
+}
+
+//-----------------------------------------------------------------------------
+void Extremes::Initialize(const DataRequirements &reqs, unsigned int k,
+  bool smallest, const std::string &fileName)
+{
+  this->K = k;
+  this->Smallest = smallest;
+  this->FileName = fileName;
+
+  this->MeshNames.clear();
+  this->ArrayNames.clear();
+  this->Associations.clear();
+  this->Values.clear();
+  this->Locations.clear();
+
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    ArrayRequirementsIterator ait =
+      reqs.GetArrayRequirementsIterator(mit.MeshName());
+
+    for (; ait; ++ait)
+      {
+      this->MeshNames.push_back(mit.MeshName());
+      this->Associations.push_back(ait.Association());
+      this->ArrayNames.push_back(ait.Array());
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Extremes::SetNumberOfThreads(int nThreads)
+{
+  this->Threads = nThreads < 1 ? TaskRuntime::GetNumberOfThreads() : nThreads;
+}
+
+//-----------------------------------------------------------------------------
+const char *Extremes::GetGhostArrayName()
+{
+#if VTK_MAJOR_VERSION == 6 && VTK_MINOR_VERSION == 1
+    return "vtkGhostType";
+#else
+    return vtkDataSetAttributes::GhostArrayName();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+vtkDataArray* Extremes::GetArray(vtkDataObject* dobj, int association,
+  const std::string& arrayname)
+{
+  if (vtkFieldData* fd = dobj->GetAttributesAsFieldData(association))
+    {
+    return fd->GetArray(arrayname.c_str());
+    }
+  return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+bool Extremes::Execute(DataAdaptor* data)
+{
+  TimeEvent<128> mark("Extremes::Execute");
+
+  bool status = true;
+
+  // see what the simulation is providing. the block extents of Cartesian
+  // meshes describe the ghost zones without a ghost array
+  MeshMetadataFlags flags;
+  flags.SetBlockDecomp();
+  flags.SetBlockExtents();
+
+  MeshMetadataMap mdMap;
+  if (mdMap.Initialize(data, flags))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return false;
+    }
+
+  int rank = 0;
+  MPI_Comm_rank(this->GetCommunicator(), &rank);
+
+  int step = data->GetDataTimeStep();
+  double time = data->GetDataTime();
+
+  // the smallest values are the largest of the negated values
+  double sign = this->Smallest ? -1.0 : 1.0;
+
+  unsigned int nArrays = this->ArrayNames.size();
+  std::vector<TopK<double,Location>> local(nArrays,
+    TopK<double,Location>(this->K));
+
+  // fetch each mesh once and add the arrays to it. errors are reported
+  // but processing continues so that all ranks take part in the
+  // selection below
+  std::map<std::string, vtkCompositeDataSetPtr> meshes;
+  std::map<std::string, VTKUtils::InteriorRangeMap> interiors;
+
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    const std::string &meshName = this->MeshNames[i];
+
+    std::map<std::string, vtkCompositeDataSetPtr>::iterator it =
+      meshes.find(meshName);
+
+    if (it == meshes.end())
+      {
+      it = meshes.insert(std::make_pair(meshName,
+        vtkCompositeDataSetPtr())).first;
+
+      MeshMetadataPtr mmd;
+      if (mdMap.GetMeshMetadata(meshName, mmd))
+        {
+        SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
+        status = false;
+        continue;
+        }
+
+      vtkDataObject* dobj = nullptr;
+      if (data->GetMesh(meshName, false, dobj))
+        {
+        SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+        status = false;
+        continue;
+        }
+
+      // it is not an necessarilly an error if all ranks do not have
+      // a dataset to process
+      if (!dobj)
+        continue;
+
+      vtkCompositeDataSetPtr mesh =
+        VTKUtils::AsCompositeData(this->GetCommunicator(), dobj, true);
+
+      // the ghost zones of Cartesian blocks are described by index ranges
+      // and the ghost arrays are not needed
+      bool haveInteriors = (mmd->NumGhostCells || mmd->NumGhostNodes) &&
+        !VTKUtils::GetInteriorRanges(mmd, interiors[meshName]);
+
+      if (!haveInteriors)
+        {
+        interiors.erase(meshName);
+
+        if ((mmd->NumGhostCells || VTKUtils::AMR(mmd)) &&
+          data->AddGhostCellsArray(mesh, meshName))
+          {
+          SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost cells.")
+          status = false;
+          continue;
+          }
+
+        if (mmd->NumGhostNodes && data->AddGhostNodesArray(mesh, meshName))
+          {
+          SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost nodes.")
+          status = false;
+          continue;
+          }
+        }
+
+      it->second = mesh;
+      }
+
+    vtkCompositeDataSet *mesh = it->second;
+    if (!mesh)
+      continue;
+
+    if (data->AddArray(mesh, meshName, this->Associations[i],
+      this->ArrayNames[i]))
+      {
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add "
+        << VTKUtils::GetAttributesName(this->Associations[i])
+        << " data array \""  << this->ArrayNames[i] << "\"")
+      status = false;
+      continue;
+      }
+
+    std::map<std::string, VTKUtils::InteriorRangeMap>::iterator iit =
+      interiors.find(meshName);
+
+    const VTKUtils::InteriorRangeMap *interiorMap =
+      iit == interiors.end() ? nullptr : &iit->second;
+
+    // find the blocks to scan and split them into spans
+    std::vector<BlockInfo> blocks;
+    std::vector<Span> spans;
+
+    vtkSmartPointer<vtkCompositeDataIterator> iter;
+    iter.TakeReference(mesh->NewIterator());
+
+    for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
+      {
+      vtkDataSet *ds = dynamic_cast<vtkDataSet*>(iter->GetCurrentDataObject());
+      if (!ds)
+        continue;
+
+      vtkDataArray* array = this->GetArray(ds,
+        this->Associations[i], this->ArrayNames[i]);
+      if (!array)
+        {
+        SENSEI_WARNING("Dataset " << iter->GetCurrentFlatIndex()
+          << " has no array named \"" << this->ArrayNames[i] << "\"")
+        continue;
+        }
+
+      if (array->GetNumberOfComponents() != 1)
+        {
+        SENSEI_ERROR("Array \"" << this->ArrayNames[i] << "\" has "
+          << array->GetNumberOfComponents() << " components. Extremes"
+          " of multi-component arrays are not supported")
+        status = false;
+        continue;
+        }
+
+      int blockId = VTKUtils::GetBlockId(mesh, iter);
+
+      const VTKUtils::InteriorRange *interior = interiorMap ?
+        VTKUtils::FindInteriorRange(*interiorMap, blockId,
+          this->Associations[i], array) : nullptr;
+
+      vtkUnsignedCharArray *ghostArray = interior ? nullptr :
+        dynamic_cast<vtkUnsignedCharArray*>(this->GetArray(ds,
+          this->Associations[i], this->GetGhostArrayName()));
+
+      const unsigned char *ghosts =
+        ghostArray ? ghostArray->GetPointer(0) : nullptr;
+
+      int b = blocks.size();
+      blocks.push_back(BlockInfo{ds, blockId, array, ghosts, interior});
+
+      long n = array->GetNumberOfTuples();
+      for (long j = 0; j < n; j += spanSize)
+        spans.push_back(Span{b, j, std::min(n, j + spanSize)});
+      }
+
+    // each thread keeps the extremes of the spans it scans
+    long nSpans = spans.size();
+    int nThreads = std::max(1l, std::min(static_cast<long>(this->Threads), nSpans));
+
+    std::vector<TopK<double,Item>> threadTop(nThreads,
+      TopK<double,Item>(this->K));
+
+    TaskRuntime::ParallelFor(nSpans, nThreads,
+      [&](int thread, long s) -> int
+      {
+      const Span &span = spans[s];
+      const BlockInfo &bi = blocks[span.Block];
+
+      ScanKernel kernel{&bi, span.Begin, span.End, sign, span.Block,
+        &threadTop[thread]};
+      ArrayDispatch::Execute(bi.Array, kernel);
+
+      return 0;
+      });
+
+    TopK<double,Item> top(this->K);
+    for (int j = 0; j < nThreads; ++j)
+      top.Merge(threadTop[j]);
+
+    // locate the rank's candidates
+    for (const TopK<double,Item>::Candidate &c : top.GetCandidates())
+      {
+      Location loc;
+      locate(blocks[c.Item.Block], this->Associations[i], c.Item.Index,
+        rank, loc);
+
+      local[i].Insert(c.Value, loc);
+      }
+    }
+
+  // select the extremes of all of the arrays at once
+  std::vector<std::vector<TopK<double,Location>::Candidate>> result;
+  GlobalTopK(this->GetCommunicator(), 0, local, result);
+
+  this->Values.clear();
+  this->Locations.clear();
+
+  if (rank == 0)
+    {
+    this->Values.resize(nArrays);
+    this->Locations.resize(nArrays);
+
+    for (unsigned int i = 0; i < nArrays; ++i)
+      {
+      for (const TopK<double,Location>::Candidate &c : result[i])
+        {
+        this->Values[i].push_back(sign * c.Value);
+        this->Locations[i].push_back(c.Item);
+        }
+      }
+    }
+
+  if (this->WriteResults(step, time))
+    status = false;
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+int Extremes::WriteResults(int step, double time)
+{
+  int rank = 0;
+  MPI_Comm_rank(this->GetCommunicator(), &rank);
+
+  if (rank != 0)
+    return 0;
+
+  unsigned int nArrays = this->Values.size();
+  for (unsigned int j = 0; j < nArrays; ++j)
+    {
+    const std::vector<double> &vals = this->Values[j];
+    const std::vector<Location> &locs = this->Locations[j];
+    const std::string &meshName = this->MeshNames[j];
+    const std::string &arrayName = this->ArrayNames[j];
+
+    size_t n = vals.size();
+
+    if (this->FileName.empty())
+      {
+      std::cout << "Extremes mesh \"" << meshName << "\" data array \""
+        << arrayName << "\" step " << step << " time " << time << std::endl
+        << "value rank block index i j k x y z" << std::endl;
+
+      for (size_t i = 0; i < n; ++i)
+        {
+        const Location &l = locs[i];
+        std::cout << vals[i] << " " << l.Rank << " " << l.Block << " "
+          << l.Index << " " << l.IJK[0] << " " << l.IJK[1] << " "
+          << l.IJK[2] << " " << l.X[0] << " " << l.X[1] << " " << l.X[2]
+          << std::endl;
+        }
+      }
+    else
+      {
+      char fname[1024] = {'\0'};
+      snprintf(fname, 1024, "%s_%s_%s_%d_extremes.txt", this->FileName.c_str(),
+        meshName.c_str(), arrayName.c_str(), step);
+
+      FILE *file = fopen(fname, "w");
+      if (!file)
+        {
+        char *estr = strerror(errno);
+        SENSEI_ERROR("Failed to open \"" << fname << "\""
+          << std::endl << estr)
+        return -1;
+        }
+
+      fprintf(file, "step : %d\n", step);
+      fprintf(file, "time : %0.6g\n", time);
+      fprintf(file, "value rank block index i j k x y z\n");
+
+      for (size_t i = 0; i < n; ++i)
+        {
+        const Location &l = locs[i];
+        fprintf(file, "%0.9g %d %d %lld %d %d %d %0.9g %0.9g %0.9g\n",
+          vals[i], l.Rank, l.Block, l.Index, l.IJK[0], l.IJK[1], l.IJK[2],
+          l.X[0], l.X[1], l.X[2]);
+        }
+
+      fclose(file);
+      }
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int Extremes::GetExtremes(unsigned int id, std::vector<double> &values,
+  std::vector<Location> &locations)
+{
+  if (id >= this->Values.size())
+    return -1;
+
+  values = this->Values[id];
+  locations = this->Locations[id];
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int Extremes::Finalize()
+{
+  this->Values.clear();
+  this->Locations.clear();
+  return 0;
+}
+
+}
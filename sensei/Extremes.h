@@ -0,0 +1,102 @@
+#ifndef sensei_Extremes_h
+#define sensei_Extremes_h
+
+#include "AnalysisAdaptor.h"
+#include "DataRequirements.h"
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+class vtkDataArray;
+class vtkDataObject;
+
+namespace sensei
+{
+
+/// @class Extremes
+/// @brief Finds the k largest, or smallest, values of any number of arrays
+/// and where they are.
+///
+/// Each thread keeps a bounded heap of the k most extreme values it has
+/// seen while scanning spans of the blocks' values, and the heaps of the
+/// threads are merged. The locations of the rank's k candidates, the
+/// block, the cell or point index, the i,j,k index of Cartesian blocks
+/// and the world coordinates of the point or cell center, are found once
+/// the scan is complete. The global selection of all of the arrays is
+/// made with one MPI_Allreduce of the ranks' k'th values, which prunes the
+/// candidates, and one gather of the survivors to rank 0. Ghost values and
+/// NaNs are skipped, using the interior range of Cartesian blocks where
+/// the metadata describes it.
+///
+/// The results are written by rank 0 to a file per array and step named
+/// <file>_<mesh>_<array>_<step>_extremes.txt, or to cout when no file is
+/// given, one line per value, most extreme first.
+class Extremes : public AnalysisAdaptor
+{
+public:
+  static Extremes* New();
+  senseiTypeMacro(Extremes, AnalysisAdaptor);
+
+  /// where a value is. Block is the index of the block in the mesh, Index
+  /// that of the cell or point in the block, and IJK its global i,j,k
+  /// index on Cartesian blocks and -1 elsewhere. X is the point or the
+  /// center of the cell
+  struct Location
+  {
+    int Rank;
+    int Block;
+    long long Index;
+    int IJK[3];
+    double X[3];
+  };
+
+  /// find the k most extreme values of each of the arrays named in the
+  /// requirements, the smallest when smallest is set, else the largest
+  void Initialize(const DataRequirements &reqs, unsigned int k,
+    bool smallest, const std::string &fileName);
+
+  /// set the number of threads used to scan the values. the threads are
+  /// those of the TaskRuntime, a value less than 1 uses all of them. the
+  /// default is 1.
+  void SetNumberOfThreads(int nThreads);
+
+  bool Execute(DataAdaptor* data) override;
+
+  int Finalize() override;
+
+  /// get the extremes of the id'th array found by the last step on rank 0,
+  /// most extreme first. arrays are ordered by mesh name and association,
+  /// then in the order given
+  int GetExtremes(unsigned int id, std::vector<double> &values,
+    std::vector<Location> &locations);
+
+protected:
+  Extremes();
+  ~Extremes();
+
+  Extremes(const Extremes&) = delete;
+  void operator=(const Extremes&) = delete;
+
+  // write the results of the last step
+  int WriteResults(int step, double time);
+
+  static const char *GetGhostArrayName();
+  vtkDataArray* GetArray(vtkDataObject* dobj, int association,
+    const std::string& arrayname);
+
+  std::vector<std::string> MeshNames;  // mesh of each array
+  std::vector<std::string> ArrayNames;
+  std::vector<int> Associations;
+  unsigned int K;
+  bool Smallest;
+  std::string FileName;
+  int Threads;
+
+  // the extremes of each array on rank 0
+  std::vector<std::vector<double>> Values;
+  std::vector<std::vector<Location>> Locations;
+};
+
+}
+
+#endif
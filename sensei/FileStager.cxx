@@ -0,0 +1,419 @@
+#include "FileStager.h"
+#include "Profiler.h"
+#include "TaskRuntime.h"
+#include "Error.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace sensei
+{
+
+struct FileStager::InternalsType
+{
+  InternalsType() : Comm(MPI_COMM_NULL), Bandwidth(0.0), Capacity(0.0),
+    StagedBytes(0), Running(false), Stop(false) {}
+
+  struct File
+  {
+    std::string Source;
+    std::string Dest;
+    long Bytes;
+  };
+
+  // copy a staged file to its destination and remove it
+  int Drain(const File &file);
+
+  // the body of the drain thread
+  void Run(bool &handOff);
+
+  MPI_Comm Comm;
+  std::string Name;
+  double Bandwidth;   // bytes per second, 0 is unlimited
+  double Capacity;    // bytes, 0 is unlimited
+
+  // the files to drain, the bytes queued or being drained, and the
+  // outcome of those that were attempted
+  std::deque<File> Queue;
+  long StagedBytes;
+  std::vector<File> Drained;
+  std::vector<File> Failed;
+
+  bool Running;
+  bool Stop;
+  std::mutex Mutex;
+  std::condition_variable Cond;
+  std::thread Thread;
+};
+
+// --------------------------------------------------------------------------
+int FileStager::InternalsType::Drain(const File &file)
+{
+  TimeEvent<128> mark("FileStager::Drain");
+
+  size_t slash = file.Dest.find_last_of('/');
+  if ((slash != std::string::npos) &&
+    FileStager::MakeDirectories(file.Dest.substr(0, slash)))
+    return -1;
+
+  FILE *src = fopen(file.Source.c_str(), "rb");
+  if (!src)
+    {
+    SENSEI_ERROR("Failed to open \"" << file.Source << "\". " << strerror(errno))
+    return -1;
+    }
+
+  // the copy is renamed when complete, so that a partial file is never
+  // seen at the destination
+  std::string part = file.Dest + ".part";
+  FILE *dest = fopen(part.c_str(), "wb");
+  if (!dest)
+    {
+    SENSEI_ERROR("Failed to open \"" << part << "\". " << strerror(errno))
+    fclose(src);
+    return -1;
+    }
+
+  const size_t chunkSize = 4*1024*1024;
+  std::vector<char> buffer(chunkSize);
+
+  using clock = std::chrono::steady_clock;
+  clock::time_point start = clock::now();
+  double copied = 0.0;
+
+  int ierr = 0;
+  size_t n = 0;
+  while ((n = fread(buffer.data(), 1, chunkSize, src)) > 0)
+    {
+    if (fwrite(buffer.data(), 1, n, dest) != n)
+      {
+      SENSEI_ERROR("Failed to write \"" << part << "\". " << strerror(errno))
+      ierr = -1;
+      break;
+      }
+
+    // hold the rate at the bandwidth by sleeping off any lead
+    copied += n;
+    if (this->Bandwidth > 0.0)
+      {
+      std::chrono::duration<double> due(copied / this->Bandwidth);
+      std::chrono::duration<double> spent = clock::now() - start;
+      if (due > spent)
+        std::this_thread::sleep_for(due - spent);
+      }
+    }
+
+  if (ferror(src))
+    {
+    SENSEI_ERROR("Failed to read \"" << file.Source << "\". " << strerror(errno))
+    ierr = -1;
+    }
+
+  fclose(src);
+
+  if (fclose(dest) && !ierr)
+    {
+    SENSEI_ERROR("Failed to close \"" << part << "\". " << strerror(errno))
+    ierr = -1;
+    }
+
+  if (ierr)
+    {
+    unlink(part.c_str());
+    return -1;
+    }
+
+  if (rename(part.c_str(), file.Dest.c_str()))
+    {
+    SENSEI_ERROR("Failed to rename \"" << part << "\" to \""
+      << file.Dest << "\". " << strerror(errno))
+    unlink(part.c_str());
+    return -1;
+    }
+
+  unlink(file.Source.c_str());
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+void FileStager::InternalsType::Run(bool &handOff)
+{
+  TaskRuntime::BindThread("FileStager::Drain");
+
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  while (true)
+    {
+    this->Cond.wait(lock, [this]() -> bool
+      { return this->Stop || !this->Queue.empty(); });
+
+    // when handing off the files still queued are left in place
+    if (this->Queue.empty() || (this->Stop && handOff))
+      return;
+
+    File file = this->Queue.front();
+    this->Queue.pop_front();
+
+    lock.unlock();
+    int ierr = this->Drain(file);
+    lock.lock();
+
+    this->StagedBytes -= file.Bytes;
+    (ierr ? this->Failed : this->Drained).push_back(file);
+    this->Cond.notify_all();
+    }
+}
+
+// --------------------------------------------------------------------------
+FileStager::FileStager() : Internals(new InternalsType), HandOff(false)
+{
+}
+
+// --------------------------------------------------------------------------
+FileStager::~FileStager()
+{
+  // the drain completes or is handed off as configured
+  {
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+  this->Internals->Stop = true;
+  this->Internals->Cond.notify_all();
+  }
+
+  if (this->Internals->Thread.joinable())
+    this->Internals->Thread.join();
+
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+  if (!finalized && (this->Internals->Comm != MPI_COMM_NULL))
+    MPI_Comm_free(&this->Internals->Comm);
+
+  delete this->Internals;
+}
+
+// --------------------------------------------------------------------------
+int FileStager::MakeDirectories(const std::string &dir)
+{
+  size_t pos = 0;
+  while (pos != std::string::npos)
+    {
+    pos = dir.find('/', pos + 1);
+    std::string path = dir.substr(0, pos);
+
+    if (path.empty() || (path == "."))
+      continue;
+
+    if (mkdir(path.c_str(), S_IRWXU|S_IRWXG|S_IROTH|S_IXOTH) && (errno != EEXIST))
+      {
+      SENSEI_ERROR("Failed to make directory \"" << path << "\". "
+        << strerror(errno))
+      return -1;
+      }
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int FileStager::Initialize(MPI_Comm comm, const std::string &stagingDir,
+  const std::string &outputDir, const std::string &name)
+{
+  if (stagingDir.empty() || (stagingDir == outputDir))
+    {
+    SENSEI_ERROR("The staging directory must differ from the output directory")
+    return -1;
+    }
+
+  if (MakeDirectories(stagingDir))
+    return -1;
+
+  if ((this->Internals->Comm != MPI_COMM_NULL) || this->Internals->Stop)
+    {
+    SENSEI_ERROR("Staging may be initialized once")
+    return -1;
+    }
+
+  MPI_Comm_dup(comm, &this->Internals->Comm);
+
+  this->StagingDir = stagingDir;
+  this->OutputDir = outputDir;
+  this->Internals->Name = name;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+void FileStager::SetBandwidth(double mbPerSecond)
+{
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+  this->Internals->Bandwidth = std::max(0.0, mbPerSecond)*1024.0*1024.0;
+}
+
+// --------------------------------------------------------------------------
+void FileStager::SetCapacity(double mb)
+{
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+  this->Internals->Capacity = std::max(0.0, mb)*1024.0*1024.0;
+}
+
+// --------------------------------------------------------------------------
+int FileStager::Stage(const std::string &fileName)
+{
+  TimeEvent<128> mark("FileStager::Stage");
+
+  if (fileName.compare(0, this->StagingDir.size(), this->StagingDir))
+    {
+    SENSEI_ERROR("\"" << fileName << "\" is not in the staging directory \""
+      << this->StagingDir << "\"")
+    return -1;
+    }
+
+  struct stat info;
+  if (stat(fileName.c_str(), &info))
+    {
+    SENSEI_ERROR("Failed to stat \"" << fileName << "\". " << strerror(errno))
+    return -1;
+    }
+
+  InternalsType::File file{fileName,
+    this->OutputDir + fileName.substr(this->StagingDir.size()),
+    static_cast<long>(info.st_size)};
+
+  InternalsType *internals = this->Internals;
+  std::unique_lock<std::mutex> lock(internals->Mutex);
+
+  if (internals->Stop || (internals->Comm == MPI_COMM_NULL))
+    {
+    SENSEI_ERROR("Files may only be staged between Initialize and Finalize")
+    return -1;
+    }
+
+  if (!internals->Running)
+    {
+    internals->Running = true;
+    internals->Thread = std::thread([this, internals]()
+      { internals->Run(this->HandOff); });
+    }
+
+  // wait for the drain to make room. a file larger than the capacity is
+  // staged when no others are
+  if (internals->Capacity > 0.0)
+    {
+    internals->Cond.wait(lock, [internals, &file]() -> bool
+      { return (internals->StagedBytes == 0) ||
+        (internals->StagedBytes + file.Bytes <= internals->Capacity); });
+    }
+
+  internals->StagedBytes += file.Bytes;
+  internals->Queue.push_back(file);
+  internals->Cond.notify_all();
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int FileStager::Finalize()
+{
+  TimeEvent<128> mark("FileStager::Finalize");
+
+  InternalsType *internals = this->Internals;
+  if (internals->Comm == MPI_COMM_NULL)
+    return 0;
+
+  {
+  std::lock_guard<std::mutex> lock(internals->Mutex);
+  internals->Stop = true;
+  internals->Cond.notify_all();
+  }
+
+  if (internals->Thread.joinable())
+    internals->Thread.join();
+
+  // list this rank's files, those left in the queue are pending
+  char host[MPI_MAX_PROCESSOR_NAME] = {'\0'};
+  int hostLen = 0;
+  MPI_Get_processor_name(host, &hostLen);
+
+  std::ostringstream oss;
+  for (const InternalsType::File &f : internals->Drained)
+    oss << "drained " << host << " " << f.Source << " " << f.Dest
+      << " " << f.Bytes << std::endl;
+
+  for (const InternalsType::File &f : internals->Failed)
+    oss << "failed " << host << " " << f.Source << " " << f.Dest
+      << " " << f.Bytes << std::endl;
+
+  for (const InternalsType::File &f : internals->Queue)
+    oss << "pending " << host << " " << f.Source << " " << f.Dest
+      << " " << f.Bytes << std::endl;
+
+  std::string lines = oss.str();
+  int localFailed = internals->Failed.size();
+
+  // rank 0 gathers the lists and writes the manifest
+  MPI_Comm comm = internals->Comm;
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  int len = lines.size();
+  std::vector<int> lens(rank == 0 ? nRanks : 0);
+  MPI_Gather(&len, 1, MPI_INT, lens.data(), 1, MPI_INT, 0, comm);
+
+  std::vector<int> offs(rank == 0 ? nRanks : 0);
+  std::vector<char> all;
+  if (rank == 0)
+    {
+    int total = 0;
+    for (int i = 0; i < nRanks; ++i)
+      {
+      offs[i] = total;
+      total += lens[i];
+      }
+    all.resize(total);
+    }
+
+  MPI_Gatherv(lines.data(), len, MPI_CHAR, all.data(), lens.data(),
+    offs.data(), MPI_CHAR, 0, comm);
+
+  int ierr = 0;
+  if (rank == 0)
+    {
+    std::string manifest = this->OutputDir + "/" + internals->Name + ".manifest";
+    std::ofstream ofs(manifest);
+    ofs << "# state host source destination bytes" << std::endl;
+    ofs.write(all.data(), all.size());
+    if (!ofs)
+      {
+      SENSEI_ERROR("Failed to write the manifest \"" << manifest << "\"")
+      ierr = -1;
+      }
+    }
+
+  int anyFailed = 0;
+  MPI_Allreduce(&localFailed, &anyFailed, 1, MPI_INT, MPI_MAX, comm);
+
+  if (anyFailed && (rank == 0))
+    SENSEI_ERROR("Some staged files failed to drain, see the manifest")
+
+  MPI_Comm_free(&internals->Comm);
+
+  return (ierr || anyFailed) ? -1 : 0;
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef sensei_FileStager_h
+#define sensei_FileStager_h
+
+#include <mpi.h>
+
+#include <string>
+
+namespace sensei
+{
+
+/// @class FileStager
+/// @brief stages the files of a writer on node local storage and drains
+/// them to their final location in the background.
+///
+/// Writers that produce a file per rank or per block write them to the
+/// staging directory, a node local NVMe, DataWarp or tmpfs mount, and call
+/// Stage when each is complete. A thread per rank copies the staged files
+/// to the output directory, keeping their path relative to the staging
+/// directory, and removes them. The simulation waits for local storage
+/// only, the parallel file system is written while it computes.
+///
+/// The drain may be throttled to a bandwidth, to leave the network and
+/// file system to the simulation, and the staged bytes may be bounded, in
+/// which case Stage blocks until the drain makes room. Finalize waits for
+/// the drain to complete or, with hand off enabled, stops it and leaves
+/// the remaining files for a stage out step of the batch system. Either
+/// way Finalize writes a manifest, <output dir>/<name>.manifest, listing
+/// each file as drained or pending, so that the completeness of the
+/// output may be checked after the run.
+///
+/// Stage may be called from several threads.
+class FileStager
+{
+public:
+  FileStager();
+  ~FileStager();
+
+  FileStager(const FileStager&) = delete;
+  void operator=(const FileStager&) = delete;
+
+  /// Set up staging. The staging directory is made if needed, on each
+  /// rank as it is node local. The output directory must exist. name
+  /// names the manifest. returns zero if successful.
+  int Initialize(MPI_Comm comm, const std::string &stagingDir,
+    const std::string &outputDir, const std::string &name);
+
+  /// the directory in which to write the staged files
+  const std::string &GetStagingDir() const { return this->StagingDir; }
+
+  /// the directory the drained files are copied to
+  const std::string &GetOutputDir() const { return this->OutputDir; }
+
+  /// limit the rate at which this rank drains to this many MB per
+  /// second. 0, the default, does not limit the rate
+  void SetBandwidth(double mbPerSecond);
+
+  /// limit the bytes staged but not yet drained by this rank to this many
+  /// MB. Stage blocks while the limit is exceeded. 0, the default, does
+  /// not limit the staged bytes
+  void SetCapacity(double mb);
+
+  /// when set Finalize does not wait for the drain. the files not yet
+  /// drained are left in the staging directory and listed in the manifest
+  void SetHandOff(bool handOff) { this->HandOff = handOff; }
+
+  /// Queue a complete file for draining. fileName is the path of the file
+  /// in the staging directory, as written, and must start with it. The
+  /// file must not be modified after. returns zero if successful.
+  int Stage(const std::string &fileName);
+
+  /// Wait for, or hand off, the drain and write the manifest. This is
+  /// collective over the communicator given to Initialize. returns zero
+  /// if all of the files staged by every rank were drained, or handed
+  /// off, without error.
+  int Finalize();
+
+  /// make a directory and its parents. returns zero if successful
+  static int MakeDirectories(const std::string &dir);
+
+private:
+  struct InternalsType;
+  InternalsType *Internals;
+
+  std::string StagingDir;
+  std::string OutputDir;
+  bool HandOff;
+};
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+#include "GhostArrayCache.h"
+#include "Profiler.h"
+#include "VTKUtils.h"
+
+#include <vtkDataObject.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+GhostArrayCache &GhostArrayCache::GetGlobalCache()
+{
+  static GhostArrayCache cache;
+  return cache;
+}
+
+// --------------------------------------------------------------------------
+int GhostArrayCache::GetSharedFaces(const int extent[6], const int domain[6])
+{
+  int faces = 0;
+  for (int d = 0; d < 3; ++d)
+    {
+    if (extent[2*d] > domain[2*d])
+      faces |= 1 << (2*d);
+
+    if (extent[2*d+1] < domain[2*d+1])
+      faces |= 1 << (2*d+1);
+    }
+  return faces;
+}
+
+// --------------------------------------------------------------------------
+vtkUnsignedCharArray *GhostArrayCache::GetGhostCells(const int cellExtent[6],
+  const int domainExtent[6], int numGhosts)
+{
+  return this->GetGhostArray(vtkDataObject::CELL, cellExtent,
+    domainExtent, numGhosts);
+}
+
+// --------------------------------------------------------------------------
+vtkUnsignedCharArray *GhostArrayCache::GetGhostNodes(const int pointExtent[6],
+  const int domainExtent[6], int numGhosts)
+{
+  return this->GetGhostArray(vtkDataObject::POINT, pointExtent,
+    domainExtent, numGhosts);
+}
+
+// --------------------------------------------------------------------------
+vtkUnsignedCharArray *GhostArrayCache::GetGhostArray(int centering,
+  const int extent[6], const int domainExtent[6], int numGhosts)
+{
+  int nx = extent[1] - extent[0] + 1;
+  int ny = extent[3] - extent[2] + 1;
+  int nz = extent[5] - extent[4] + 1;
+  int faces = GetSharedFaces(extent, domainExtent);
+
+  Key key = {{centering, nx, ny, nz, faces, numGhosts}};
+
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  auto it = this->Arrays.find(key);
+  if (it != this->Arrays.end())
+    return it->second.GetPointer();
+
+  TimeEvent<128> mark("GhostArrayCache::GetGhostArray");
+
+  unsigned char ghost = centering == vtkDataObject::CELL ?
+    vtkDataSetAttributes::DUPLICATECELL : vtkDataSetAttributes::DUPLICATEPOINT;
+
+  long nxny = long(nx)*ny;
+  long n = nxny*nz;
+
+  vtkUnsignedCharArray *g = vtkUnsignedCharArray::New();
+  g->SetName("vtkGhostType");
+  g->SetNumberOfTuples(n);
+
+  unsigned char *gptr = g->GetPointer(0);
+  memset(gptr, 0, n);
+
+  // the mask is the interior range made explicit, for consumers that
+  // test a mask per value
+  VTKUtils::InteriorRange interior;
+  VTKUtils::GetInteriorRange(extent, domainExtent, numGhosts, interior);
+
+  interior.ForEachSpan(0, n, [&](long begin, long end, bool isInterior)
+    {
+    if (!isInterior)
+      memset(gptr + begin, ghost, end - begin);
+    });
+
+  this->Arrays[key].TakeReference(g);
+
+  return g;
+}
+
+// --------------------------------------------------------------------------
+void GhostArrayCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Arrays.clear();
+}
+
+// --------------------------------------------------------------------------
+size_t GhostArrayCache::GetNumberOfArrays() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Arrays.size();
+}
+
+}
@@ -0,0 +1,72 @@
+#ifndef sensei_GhostArrayCache_h
+#define sensei_GhostArrayCache_h
+
+#include <vtkSmartPointer.h>
+
+#include <array>
+#include <map>
+#include <mutex>
+
+class vtkUnsignedCharArray;
+
+namespace sensei
+{
+
+/// @class GhostArrayCache
+/// @brief shares vtkGhostType arrays between the blocks of Cartesian meshes.
+///
+/// The ghost array of a block of a Cartesian mesh depends only on the
+/// block's dimensions, the faces that are shared with a neighbor and the
+/// number of ghost layers. Blocks with the same layout, such as the interior
+/// blocks of a regular decomposition, get the same array, and it is made
+/// once and reused in later steps. The arrays are shared and must be treated
+/// as read only. Data adaptors may add them to any number of blocks, each
+/// block holds a reference.
+///
+/// All methods are thread safe.
+class GhostArrayCache
+{
+public:
+  /// the process wide cache
+  static GhostArrayCache &GetGlobalCache();
+
+  /// get a bit mask of the faces of a block that are shared with a
+  /// neighbor, those not on the domain boundary. the extents are in the
+  /// same index space, [i0, i1, j0, j1, k0, k1]. bit 2*d is the low face
+  /// and 2*d+1 the high face in direction d
+  static int GetSharedFaces(const int extent[6], const int domain[6]);
+
+  /// get the ghost cell array of a block given its cell extent and the cell
+  /// extent of the domain. cells within numGhosts layers of a shared face
+  /// are marked vtkDataSetAttributes::DUPLICATECELL. the caller does not
+  /// take a reference
+  vtkUnsignedCharArray *GetGhostCells(const int cellExtent[6],
+    const int domainExtent[6], int numGhosts);
+
+  /// get the ghost node array of a block given its point extent and the
+  /// point extent of the domain. points within numGhosts layers of a shared
+  /// face are marked vtkDataSetAttributes::DUPLICATEPOINT. the caller does
+  /// not take a reference
+  vtkUnsignedCharArray *GetGhostNodes(const int pointExtent[6],
+    const int domainExtent[6], int numGhosts);
+
+  /// release the arrays. blocks holding them are not affected
+  void Clear();
+
+  /// the number of distinct arrays held
+  size_t GetNumberOfArrays() const;
+
+private:
+  vtkUnsignedCharArray *GetGhostArray(int centering, const int extent[6],
+    const int domainExtent[6], int numGhosts);
+
+  // centering, dimensions, shared faces, and number of ghost layers
+  using Key = std::array<int,6>;
+
+  mutable std::mutex Mutex;
+  std::map<Key, vtkSmartPointer<vtkUnsignedCharArray>> Arrays;
+};
+
+}
+
+#endif
@@ -0,0 +1,772 @@
+#include "GhostExchange.h"
+#include "GhostArrayCache.h"
+#include "VTKUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkImageData.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <sdiy/master.hpp>
+#include <sdiy/mpi.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <vector>
+
+namespace
+{
+using Extent = std::array<int,6>;
+
+// --------------------------------------------------------------------------
+bool empty(const Extent &ext)
+{
+  return (ext[0] > ext[1]) || (ext[2] > ext[3]) || (ext[4] > ext[5]);
+}
+
+// --------------------------------------------------------------------------
+Extent intersect(const Extent &a, const Extent &b)
+{
+  Extent ext;
+  for (int i = 0; i < 3; ++i)
+    {
+    ext[2*i] = std::max(a[2*i], b[2*i]);
+    ext[2*i+1] = std::min(a[2*i+1], b[2*i+1]);
+    }
+  return ext;
+}
+
+// --------------------------------------------------------------------------
+Extent shift(const Extent &ext, const std::array<int,3> &s)
+{
+  Extent sext;
+  for (int i = 0; i < 3; ++i)
+    {
+    sext[2*i] = ext[2*i] + s[i];
+    sext[2*i+1] = ext[2*i+1] + s[i];
+    }
+  return sext;
+}
+
+// --------------------------------------------------------------------------
+// the extent of the cells of a point extent. a flat dimension has one
+// layer of cells, as in VTK
+Extent cellExtent(const Extent &pext)
+{
+  Extent cext;
+  for (int i = 0; i < 3; ++i)
+    {
+    cext[2*i] = pext[2*i];
+    cext[2*i+1] = std::max(pext[2*i], pext[2*i+1] - 1);
+    }
+  return cext;
+}
+
+// --------------------------------------------------------------------------
+size_t size(const Extent &ext)
+{
+  return size_t(ext[1] - ext[0] + 1)*size_t(ext[3] - ext[2] + 1)*
+    size_t(ext[5] - ext[4] + 1);
+}
+
+// --------------------------------------------------------------------------
+// copies the tuples of the region ext between an array laid out over the
+// extent aext and a packed buffer. returns the end of the packed data
+unsigned char *copyRegion(unsigned char *array, const Extent &aext,
+  const Extent &ext, size_t tupleBytes, unsigned char *buffer, bool pack)
+{
+  if (empty(ext))
+    return buffer;
+
+  size_t nx = aext[1] - aext[0] + 1;
+  size_t ny = aext[3] - aext[2] + 1;
+  size_t rowBytes = (ext[1] - ext[0] + 1)*tupleBytes;
+
+  for (int k = ext[4]; k <= ext[5]; ++k)
+    {
+    for (int j = ext[2]; j <= ext[3]; ++j)
+      {
+      size_t id = (size_t(k - aext[4])*ny + size_t(j - aext[2]))*nx +
+        size_t(ext[0] - aext[0]);
+
+      unsigned char *row = array + id*tupleBytes;
+
+      if (pack)
+        memcpy(buffer, row, rowBytes);
+      else
+        memcpy(row, buffer, rowBytes);
+
+      buffer += rowBytes;
+      }
+    }
+
+  return buffer;
+}
+
+// --------------------------------------------------------------------------
+size_t tupleBytes(vtkDataArray *da)
+{
+  return size_t(da->GetNumberOfComponents())*da->GetDataTypeSize();
+}
+
+// a region exchanged with a neighbor, its cells and points. a region
+// received is in the receiver's index space, a region sent is in the
+// sender's
+struct Region
+{
+  Extent Cells;
+  Extent Points;
+};
+
+// the regions exchanged with a neighbor, in the same order on both sides
+struct Neighbor
+{
+  sdiy::BlockID Id;
+  std::vector<Region> Send;
+  std::vector<Region> Recv;
+  size_t SendCells;
+  size_t SendPoints;
+  size_t RecvCells;
+  size_t RecvPoints;
+};
+
+// a local block and its ghosted copy. index 0 of the array lists holds
+// the cell data, index 1 the point data
+struct Block
+{
+  Block() : Id(-1), Input(nullptr) {}
+
+  int Id;
+  Extent Points;
+  Extent GhostedPoints;
+  std::vector<Neighbor> Neighbors;
+
+  vtkImageData *Input; // set during an exchange
+  vtkSmartPointer<vtkImageData> Output;
+  std::vector<vtkDataArray*> InputArrays[2];
+  std::vector<vtkDataArray*> OutputArrays[2];
+
+  std::vector<unsigned char> Buffer; // reused between steps
+};
+
+// --------------------------------------------------------------------------
+// the arrays of a block that are exchanged, ordered by name so that all
+// ranks pack them in the same order
+void getArrays(vtkDataSetAttributes *dsa, std::vector<vtkDataArray*> &arrays)
+{
+  arrays.clear();
+
+  int nArrays = dsa->GetNumberOfArrays();
+  for (int i = 0; i < nArrays; ++i)
+    {
+    vtkDataArray *da = dsa->GetArray(i);
+    if (da && da->GetName() && strcmp(da->GetName(), "vtkGhostType"))
+      arrays.push_back(da);
+    }
+
+  std::sort(arrays.begin(), arrays.end(),
+    [](vtkDataArray *a, vtkDataArray *b)
+    { return strcmp(a->GetName(), b->GetName()) < 0; });
+}
+
+// --------------------------------------------------------------------------
+// true if two lists of arrays have the same names, types and components
+bool sameArrays(const std::vector<vtkDataArray*> &a,
+  const std::vector<vtkDataArray*> &b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  size_t n = a.size();
+  for (size_t i = 0; i < n; ++i)
+    {
+    if ((a[i]->GetDataType() != b[i]->GetDataType()) ||
+      (a[i]->GetNumberOfComponents() != b[i]->GetNumberOfComponents()) ||
+      strcmp(a[i]->GetName(), b[i]->GetName()))
+      return false;
+    }
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+size_t tupleBytes(const std::vector<vtkDataArray*> &arrays)
+{
+  size_t n = 0;
+  for (size_t i = 0; i < arrays.size(); ++i)
+    n += tupleBytes(arrays[i]);
+  return n;
+}
+
+// --------------------------------------------------------------------------
+// pack the regions the neighbors need and enqueue them
+void sendGhosts(Block *b, const sdiy::Master::ProxyWithLink &cp)
+{
+  Extent cells = cellExtent(b->Points);
+
+  size_t cellBytes = tupleBytes(b->InputArrays[0]);
+  size_t pointBytes = tupleBytes(b->InputArrays[1]);
+
+  size_t nNeighbors = b->Neighbors.size();
+  for (size_t i = 0; i < nNeighbors; ++i)
+    {
+    Neighbor &n = b->Neighbors[i];
+
+    b->Buffer.resize(n.SendCells*cellBytes + n.SendPoints*pointBytes);
+    unsigned char *buf = b->Buffer.data();
+
+    size_t nRegions = n.Send.size();
+    for (size_t j = 0; j < nRegions; ++j)
+      {
+      const Region &r = n.Send[j];
+
+      for (vtkDataArray *da : b->InputArrays[0])
+        buf = copyRegion(static_cast<unsigned char*>(da->GetVoidPointer(0)),
+          cells, r.Cells, tupleBytes(da), buf, true);
+
+      for (vtkDataArray *da : b->InputArrays[1])
+        buf = copyRegion(static_cast<unsigned char*>(da->GetVoidPointer(0)),
+          b->Points, r.Points, tupleBytes(da), buf, true);
+      }
+
+    cp.enqueue(n.Id, b->Buffer.data(), b->Buffer.size());
+    }
+}
+
+// --------------------------------------------------------------------------
+// dequeue the regions sent by the neighbors into the ghosted arrays
+void receiveGhosts(Block *b, const sdiy::Master::ProxyWithLink &cp)
+{
+  Extent cells = cellExtent(b->GhostedPoints);
+
+  size_t cellBytes = tupleBytes(b->OutputArrays[0]);
+  size_t pointBytes = tupleBytes(b->OutputArrays[1]);
+
+  size_t nNeighbors = b->Neighbors.size();
+  for (size_t i = 0; i < nNeighbors; ++i)
+    {
+    Neighbor &n = b->Neighbors[i];
+
+    b->Buffer.resize(n.RecvCells*cellBytes + n.RecvPoints*pointBytes);
+    cp.dequeue(n.Id.gid, b->Buffer.data(), b->Buffer.size());
+
+    unsigned char *buf = b->Buffer.data();
+
+    size_t nRegions = n.Recv.size();
+    for (size_t j = 0; j < nRegions; ++j)
+      {
+      const Region &r = n.Recv[j];
+
+      for (vtkDataArray *da : b->OutputArrays[0])
+        buf = copyRegion(static_cast<unsigned char*>(da->GetVoidPointer(0)),
+          cells, r.Cells, tupleBytes(da), buf, false);
+
+      for (vtkDataArray *da : b->OutputArrays[1])
+        buf = copyRegion(static_cast<unsigned char*>(da->GetVoidPointer(0)),
+          b->GhostedPoints, r.Points, tupleBytes(da), buf, false);
+      }
+    }
+}
+}
+
+namespace sensei
+{
+
+// the plan and ghosted blocks of a mesh
+struct MeshGhosts
+{
+  MeshGhosts() : NumGhostLayers(0), Step(-1), Master(nullptr) {}
+  ~MeshGhosts() { delete this->Master; }
+
+  MeshGhosts(const MeshGhosts&) = delete;
+  void operator=(const MeshGhosts&) = delete;
+
+  int Initialize(MPI_Comm comm, const MeshMetadataPtr &md, int numGhosts);
+  int UpdateBlocks(vtkDataObject *mesh, bool &changed);
+
+  // what the plan was made for
+  int NumGhostLayers;
+  std::vector<Extent> BlockExtents;
+  std::vector<int> BlockOwner;
+  std::vector<int> BlockIds;
+  std::array<int,3> PeriodicBoundary;
+
+  Extent Domain;
+  Extent GhostDomain; // used to mark the ghost cells
+  long Step;
+  std::vector<Block> Blocks;
+  sdiy::Master *Master;
+};
+
+// --------------------------------------------------------------------------
+int MeshGhosts::Initialize(MPI_Comm comm, const MeshMetadataPtr &md,
+  int numGhosts)
+{
+  TimeEvent<128> mark("GhostExchange::Initialize");
+
+  delete this->Master;
+  this->Master = nullptr;
+  this->Blocks.clear();
+  this->Step = -1;
+
+  this->NumGhostLayers = numGhosts;
+  this->BlockIds = md->BlockIds;
+  this->BlockOwner = md->BlockOwner;
+  this->PeriodicBoundary = md->PeriodicBoundary;
+
+  int nBlocks = md->NumBlocks;
+  this->BlockExtents.resize(nBlocks);
+  for (int i = 0; i < nBlocks; ++i)
+    std::copy(md->BlockExtents[i].begin(), md->BlockExtents[i].end(),
+      this->BlockExtents[i].begin());
+
+  // the domain spans all of the blocks
+  Extent &dom = this->Domain;
+  int imax = std::numeric_limits<int>::max();
+  int imin = std::numeric_limits<int>::lowest();
+  dom = {{imax, imin, imax, imin, imax, imin}};
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    const Extent &ext = this->BlockExtents[i];
+    for (int j = 0; j < 3; ++j)
+      {
+      dom[2*j] = std::min(dom[2*j], ext[2*j]);
+      dom[2*j+1] = std::max(dom[2*j+1], ext[2*j+1]);
+      }
+    }
+
+  // the shifts that map the periodic images of the blocks onto the ghost
+  // layers. the unshifted blocks come first
+  std::array<int,3> period;
+  std::vector<int> shifts[3];
+  for (int j = 0; j < 3; ++j)
+    {
+    period[j] = dom[2*j+1] - dom[2*j];
+    shifts[j].push_back(0);
+    if (this->PeriodicBoundary[j] && period[j])
+      {
+      shifts[j].push_back(-period[j]);
+      shifts[j].push_back(period[j]);
+      }
+    }
+
+  std::vector<std::array<int,3>> images;
+  for (int k : shifts[2])
+    for (int jj : shifts[1])
+      for (int i : shifts[0])
+        images.push_back({{i, jj, k}});
+
+  // the ghosted extents. ghosts are not added past the domain on sides
+  // that are not periodic. the ghost array treats the sides on the
+  // domain boundary as not shared, so in the periodic directions it is
+  // given a domain larger than the ghosted blocks
+  this->GhostDomain = cellExtent(dom);
+
+  std::vector<Extent> ghosted(nBlocks);
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    const Extent &ext = this->BlockExtents[i];
+    for (int j = 0; j < 3; ++j)
+      {
+      int ng = period[j] ? numGhosts : 0;
+      int lo = ext[2*j] - ng;
+      int hi = ext[2*j+1] + ng;
+
+      if (!this->PeriodicBoundary[j])
+        {
+        lo = std::max(lo, dom[2*j]);
+        hi = std::min(hi, dom[2*j+1]);
+        }
+
+      ghosted[i][2*j] = lo;
+      ghosted[i][2*j+1] = hi;
+      }
+    }
+
+  for (int j = 0; j < 3; ++j)
+    {
+    if (this->PeriodicBoundary[j] && period[j])
+      {
+      this->GhostDomain[2*j] -= numGhosts + 1;
+      this->GhostDomain[2*j+1] += numGhosts + 1;
+      }
+    }
+
+  // the local blocks. the addresses of the blocks must not change once
+  // they are added to the master
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  std::vector<int> local;
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    if (this->BlockOwner[i] == rank)
+      local.push_back(i);
+    }
+
+  this->Blocks.resize(local.size());
+
+  // the region of block m that lands in the ghost layer of block b,
+  // for the periodic image s of m. the region is in b's index space
+  auto overlap = [&](int b, int m, const std::array<int,3> &s,
+    Region &r) -> bool
+    {
+    if ((b == m) && !s[0] && !s[1] && !s[2])
+      return false;
+
+    Extent img = shift(this->BlockExtents[m], s);
+
+    r.Cells = intersect(cellExtent(ghosted[b]), cellExtent(img));
+    r.Points = intersect(ghosted[b], img);
+
+    return !empty(r.Cells) || !empty(r.Points);
+    };
+
+  // empty regions are still listed so that both sides agree on the
+  // order. their sizes are zero
+  auto regionSize = [](const Extent &ext) -> size_t
+    { return empty(ext) ? 0 : size(ext); };
+
+  this->Master = new sdiy::Master(sdiy::mpi::communicator(comm));
+
+  size_t nLocal = local.size();
+  for (size_t q = 0; q < nLocal; ++q)
+    {
+    int b = local[q];
+    Block &blk = this->Blocks[q];
+
+    blk.Id = this->BlockIds[b];
+    blk.Points = this->BlockExtents[b];
+    blk.GhostedPoints = ghosted[b];
+
+    for (int m = 0; m < nBlocks; ++m)
+      {
+      Neighbor n;
+      n.Id.gid = this->BlockIds[m];
+      n.Id.proc = this->BlockOwner[m];
+      n.SendCells = n.SendPoints = n.RecvCells = n.RecvPoints = 0;
+
+      for (const std::array<int,3> &s : images)
+        {
+        Region r;
+
+        // m's image s in b's ghost layers
+        if (overlap(b, m, s, r))
+          {
+          n.RecvCells += regionSize(r.Cells);
+          n.RecvPoints += regionSize(r.Points);
+          n.Recv.push_back(r);
+          }
+
+        // b's image s in m's ghost layers, in b's index space
+        if (overlap(m, b, s, r))
+          {
+          std::array<int,3> back = {{-s[0], -s[1], -s[2]}};
+          r.Cells = shift(r.Cells, back);
+          r.Points = shift(r.Points, back);
+
+          n.SendCells += regionSize(r.Cells);
+          n.SendPoints += regionSize(r.Points);
+          n.Send.push_back(r);
+          }
+        }
+
+      if (!n.Send.empty() || !n.Recv.empty())
+        blk.Neighbors.push_back(n);
+      }
+
+    sdiy::Link *link = new sdiy::Link;
+    for (const Neighbor &n : blk.Neighbors)
+      link->add_neighbor(n.Id);
+
+    this->Master->add(blk.Id, &blk, link);
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int MeshGhosts::UpdateBlocks(vtkDataObject *mesh, bool &changed)
+{
+  vtkMultiBlockDataSet *mb = dynamic_cast<vtkMultiBlockDataSet*>(mesh);
+  if (!mb)
+    {
+    SENSEI_ERROR("Ghost exchange requires a vtkMultiBlockDataSet not a "
+      << (mesh ? mesh->GetClassName() : "nullptr"))
+    return -1;
+    }
+
+  changed = false;
+
+  size_t nBlocks = this->Blocks.size();
+  for (size_t q = 0; q < nBlocks; ++q)
+    {
+    Block &b = this->Blocks[q];
+
+    b.Input = dynamic_cast<vtkImageData*>(
+      (unsigned(b.Id) < mb->GetNumberOfBlocks()) ? mb->GetBlock(b.Id) : nullptr);
+
+    if (!b.Input)
+      {
+      SENSEI_ERROR("Block " << b.Id << " is not a local vtkImageData")
+      return -1;
+      }
+
+    int inExt[6];
+    b.Input->GetExtent(inExt);
+    if (!std::equal(inExt, inExt + 6, b.Points.begin()))
+      {
+      SENSEI_ERROR("The extent of block " << b.Id
+        << " does not match the metadata")
+      return -1;
+      }
+
+    std::vector<vtkDataArray*> cellArrays;
+    std::vector<vtkDataArray*> pointArrays;
+    getArrays(b.Input->GetCellData(), cellArrays);
+    getArrays(b.Input->GetPointData(), pointArrays);
+
+    // the ghosted block is reused while the arrays are the same
+    if (!b.Output || !sameArrays(cellArrays, b.OutputArrays[0]) ||
+      !sameArrays(pointArrays, b.OutputArrays[1]))
+      {
+      b.Output = vtkSmartPointer<vtkImageData>::New();
+      b.Output->SetExtent(b.GhostedPoints.data());
+
+      vtkDataSetAttributes *dsa[2] =
+        {b.Output->GetCellData(), b.Output->GetPointData()};
+
+      vtkIdType nTuples[2] =
+        {b.Output->GetNumberOfCells(), b.Output->GetNumberOfPoints()};
+
+      std::vector<vtkDataArray*> *in[2] = {&cellArrays, &pointArrays};
+
+      for (int c = 0; c < 2; ++c)
+        {
+        b.OutputArrays[c].clear();
+        for (vtkDataArray *da : *in[c])
+          {
+          vtkDataArray *ga = vtkDataArray::CreateDataArray(da->GetDataType());
+          ga->SetName(da->GetName());
+          ga->SetNumberOfComponents(da->GetNumberOfComponents());
+          ga->SetNumberOfTuples(nTuples[c]);
+          dsa[c]->AddArray(ga);
+          b.OutputArrays[c].push_back(ga);
+          ga->Delete();
+          }
+        }
+
+      GhostArrayCache &gac = GhostArrayCache::GetGlobalCache();
+
+      Extent cells = cellExtent(b.GhostedPoints);
+      b.Output->GetCellData()->AddArray(gac.GetGhostCells(cells.data(),
+        this->GhostDomain.data(), this->NumGhostLayers));
+
+      Extent ghostPoints = this->GhostDomain;
+      for (int j = 0; j < 3; ++j)
+        {
+        if (this->Domain[2*j] != this->Domain[2*j+1])
+          ghostPoints[2*j+1] += 1;
+        }
+
+      b.Output->GetPointData()->AddArray(gac.GetGhostNodes(
+        b.GhostedPoints.data(), ghostPoints.data(), this->NumGhostLayers));
+
+      changed = true;
+      }
+
+    b.InputArrays[0] = cellArrays;
+    b.InputArrays[1] = pointArrays;
+
+    b.Output->SetOrigin(b.Input->GetOrigin());
+    b.Output->SetSpacing(b.Input->GetSpacing());
+
+    // copy the block's own values
+    Extent cells = cellExtent(b.Points);
+    Extent ghostedCells = cellExtent(b.GhostedPoints);
+
+    const Extent *ext[2] = {&cells, &b.Points};
+    const Extent *gext[2] = {&ghostedCells, &b.GhostedPoints};
+
+    for (int c = 0; c < 2; ++c)
+      {
+      size_t nArrays = b.InputArrays[c].size();
+      for (size_t j = 0; j < nArrays; ++j)
+        {
+        vtkDataArray *da = b.InputArrays[c][j];
+        vtkDataArray *ga = b.OutputArrays[c][j];
+        size_t tb = tupleBytes(da);
+
+        b.Buffer.resize(size(*ext[c])*tb);
+
+        copyRegion(static_cast<unsigned char*>(da->GetVoidPointer(0)),
+          *ext[c], *ext[c], tb, b.Buffer.data(), true);
+
+        copyRegion(static_cast<unsigned char*>(ga->GetVoidPointer(0)),
+          *gext[c], *ext[c], tb, b.Buffer.data(), false);
+        }
+      }
+    }
+
+  return 0;
+}
+
+struct GhostExchange::InternalsType
+{
+  std::map<std::string, MeshGhosts> Meshes;
+};
+
+// --------------------------------------------------------------------------
+GhostExchange::GhostExchange() : Comm(MPI_COMM_WORLD), NumGhostLayers(1),
+  Internals(new InternalsType)
+{
+}
+
+// --------------------------------------------------------------------------
+GhostExchange::~GhostExchange()
+{
+  delete this->Internals;
+}
+
+// --------------------------------------------------------------------------
+void GhostExchange::SetCommunicator(MPI_Comm comm)
+{
+  this->Comm = comm;
+  this->Clear();
+}
+
+// --------------------------------------------------------------------------
+void GhostExchange::SetNumberOfGhostLayers(int n)
+{
+  this->NumGhostLayers = std::max(0, n);
+}
+
+// --------------------------------------------------------------------------
+void GhostExchange::Clear()
+{
+  this->Internals->Meshes.clear();
+}
+
+// --------------------------------------------------------------------------
+int GhostExchange::Exchange(const MeshMetadataPtr &md, long step,
+  vtkDataObject *mesh, vtkDataObject *&ghosted)
+{
+  TimeEvent<128> mark("GhostExchange::Exchange");
+
+  ghosted = nullptr;
+
+  if (!mesh)
+    {
+    SENSEI_ERROR("No mesh was provided")
+    return -1;
+    }
+
+  // nothing to do
+  if (md->NumGhostCells >= this->NumGhostLayers)
+    {
+    mesh->Register(nullptr);
+    ghosted = mesh;
+    return 0;
+    }
+
+  if (md->NumGhostCells > 0)
+    {
+    SENSEI_ERROR("Mesh \"" << md->MeshName << "\" has " << md->NumGhostCells
+      << " ghost layers, extending existing ghost layers is not supported")
+    return -1;
+    }
+
+  size_t nBlocks = md->NumBlocks;
+  if ((md->BlockOwner.size() != nBlocks) || (md->BlockIds.size() != nBlocks) ||
+    (md->BlockExtents.size() != nBlocks))
+    {
+    SENSEI_ERROR("Ghost exchange for mesh \"" << md->MeshName << "\" requires "
+      "the global view of the block decomposition and extents")
+    return -1;
+    }
+
+  MeshGhosts &mg = this->Internals->Meshes[md->MeshName];
+
+  // the plan is made again when the decomposition changes. the metadata
+  // is the same on all ranks, so they agree without communicating
+  bool newPlan = !mg.Master || (mg.NumGhostLayers != this->NumGhostLayers) ||
+    (mg.BlockOwner != md->BlockOwner) || (mg.BlockIds != md->BlockIds) ||
+    (mg.PeriodicBoundary != md->PeriodicBoundary);
+
+  for (size_t i = 0; !newPlan && (i < nBlocks); ++i)
+    newPlan = !std::equal(mg.BlockExtents[i].begin(), mg.BlockExtents[i].end(),
+      md->BlockExtents[i].begin());
+
+  if (newPlan && mg.Initialize(this->Comm, md, this->NumGhostLayers))
+    {
+    SENSEI_ERROR("Failed to make the ghost exchange plan for mesh \""
+      << md->MeshName << "\"")
+    return -1;
+    }
+
+  bool changed = false;
+  if (mg.UpdateBlocks(mesh, changed))
+    {
+    SENSEI_ERROR("Failed to update the ghosted blocks of mesh \""
+      << md->MeshName << "\"")
+    return -1;
+    }
+
+  // the ghosted blocks of this step are reused if the arrays are the same
+  // on all ranks
+  int exchange = changed || (mg.Step != step) ? 1 : 0;
+
+  MPI_Allreduce(MPI_IN_PLACE, &exchange, 1, MPI_INT, MPI_MAX, this->Comm);
+
+  if (exchange)
+    {
+    TimeEvent<128> mark2("GhostExchange::Move");
+
+    mg.Master->foreach(&sendGhosts);
+    mg.Master->exchange();
+    mg.Master->foreach(&receiveGhosts);
+
+    for (Block &b : mg.Blocks)
+      {
+      for (int c = 0; c < 2; ++c)
+        {
+        for (vtkDataArray *ga : b.OutputArrays[c])
+          ga->Modified();
+        }
+      b.Output->Modified();
+      }
+
+    mg.Step = step;
+    }
+
+  vtkMultiBlockDataSet *mbo = vtkMultiBlockDataSet::New();
+  mbo->SetNumberOfBlocks(nBlocks);
+
+  for (Block &b : mg.Blocks)
+    {
+    mbo->SetBlock(b.Id, b.Output);
+
+    // the simulation's data is only valid during the call
+    b.Input = nullptr;
+    b.InputArrays[0].clear();
+    b.InputArrays[1].clear();
+    }
+
+  VTKUtils::SetGhostLayerMetadata(mbo, this->NumGhostLayers,
+    this->NumGhostLayers);
+
+  ghosted = mbo;
+
+  return 0;
+}
+
+}
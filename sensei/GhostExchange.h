@@ -0,0 +1,82 @@
+#ifndef sensei_GhostExchange_h
+#define sensei_GhostExchange_h
+
+#include "MeshMetadata.h"
+
+#include <mpi.h>
+#include <string>
+
+class vtkDataObject;
+
+namespace sensei
+{
+
+/// @class GhostExchange
+/// @brief builds ghost layers for the blocks of a Cartesian mesh.
+///
+/// Blocks that arrive on a receiver after in transit repartitioning, or
+/// that a simulation passes without ghost layers, can not be processed by
+/// analyses that need the values of neighboring cells, such as contouring,
+/// gradients or cell to point interpolation. GhostExchange makes ghosted
+/// copies of the local blocks of a multiblock of vtkImageData. The
+/// neighbors and the regions exchanged with them are found from the global
+/// view of the mesh's metadata, MeshMetadata::BlockExtents, BlockOwner,
+/// BlockIds and PeriodicBoundary, and the values are moved with sdiy.
+///
+/// The exchange plan depends only on the decomposition. It is made on the
+/// first call and kept until the block extents, owners or the number of
+/// ghost layers change. The ghosted blocks are kept for the duration of a
+/// step, later calls in the same step with the same arrays return them
+/// without communicating. Each call is collective over the communicator,
+/// and every rank's blocks must hold the same arrays.
+class GhostExchange
+{
+public:
+  GhostExchange();
+  ~GhostExchange();
+
+  /// Set the communicator. Block owners in the metadata are ranks of this
+  /// communicator. Clears the plans.
+  void SetCommunicator(MPI_Comm comm);
+  MPI_Comm GetCommunicator() const { return this->Comm; }
+
+  /// Set the number of ghost cell layers to build. The default is 1.
+  void SetNumberOfGhostLayers(int n);
+  int GetNumberOfGhostLayers() const { return this->NumGhostLayers; }
+
+  /// @brief Make ghosted copies of the local blocks of a mesh.
+  ///
+  /// The blocks of mesh are located by their global id, the block index
+  /// in the multiblock. The metadata must have the global view and the
+  /// block decomposition and extents. Point and cell data arrays are
+  /// exchanged and vtkGhostType arrays are added. If the blocks already
+  /// have enough ghost layers the mesh is returned as it is.
+  ///
+  /// The caller takes a reference to ghosted. Its blocks are shared with
+  /// later calls made in the same step and must be treated as read only.
+  ///
+  /// @param[in] md the metadata describing mesh
+  /// @param[in] step the time step, used to identify the step's blocks
+  /// @param[in] mesh a vtkMultiBlockDataSet of vtkImageData
+  /// @param[out] ghosted the mesh with ghost layers
+  /// @returns zero if successful
+  int Exchange(const MeshMetadataPtr &md, long step, vtkDataObject *mesh,
+    vtkDataObject *&ghosted);
+
+  /// release the plans and the ghosted blocks
+  void Clear();
+
+private:
+  GhostExchange(const GhostExchange&) = delete;
+  void operator=(const GhostExchange&) = delete;
+
+  MPI_Comm Comm;
+  int NumGhostLayers;
+
+  struct InternalsType;
+  InternalsType *Internals;
+};
+
+}
+
+#endif
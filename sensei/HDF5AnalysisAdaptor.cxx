@@ -6,6 +6,7 @@
 #include "MPIUtils.h"
 #include "MeshMetadataMap.h"
 #include "Profiler.h"
+#include "TaskRuntime.h"
 #include "VTKUtils.h"
 
 #include <vtkCellArray.h>
@@ -33,10 +34,52 @@
 
 #include <mpi.h>
 #include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using vtkCompositeDataSetPtr = vtkSmartPointer<vtkCompositeDataSet>;
 
 namespace sensei
 {
 
+// state of the background writer used when writing asynchronously
+struct HDF5AnalysisAdaptor::WriterType
+{
+  WriterType() : QueueDepth(0), Policy(QUEUE_BLOCK), Comm(MPI_COMM_NULL),
+    Running(false), Stop(false), Error(false), NumWritten(0),
+    NumDiscarded(0) {}
+
+  // a copy of one step's data waiting to be written
+  struct Step
+  {
+    unsigned long TimeStep;
+    double Time;
+    std::vector<MeshMetadataPtr> Metadata;
+    std::vector<vtkCompositeDataSetPtr> Objects;
+    std::vector<std::vector<int>> Changed;
+  };
+
+  unsigned int QueueDepth;
+  int Policy;
+
+  // the writer thread's HDF5 file is opened on this communicator so that
+  // its collective I/O never overlaps the calling thread's collectives
+  MPI_Comm Comm;
+
+  bool Running;
+  bool Stop;
+  bool Error;
+  unsigned long NumWritten;
+  unsigned long NumDiscarded;
+
+  std::deque<Step> Queue;
+  std::mutex Mutex;
+  std::condition_variable Cond;
+  std::thread Thread;
+};
+
 //----------------------------------------------------------------------------
 senseiNewMacro(HDF5AnalysisAdaptor);
 
@@ -44,15 +87,25 @@ senseiNewMacro(HDF5AnalysisAdaptor);
 HDF5AnalysisAdaptor::HDF5AnalysisAdaptor()
   : m_FileName("no.file")
   , m_HDF5Writer(nullptr)
+  , m_Writer(new WriterType)
 {
 }
 
 //----------------------------------------------------------------------------
 HDF5AnalysisAdaptor::~HDF5AnalysisAdaptor()
 {
+  this->StopWriter();
+  delete m_Writer;
   delete m_HDF5Writer;
 }
 
+//----------------------------------------------------------------------------
+void HDF5AnalysisAdaptor::SetAsynchronous(unsigned int queueDepth, int policy)
+{
+  this->m_Writer->QueueDepth = queueDepth;
+  this->m_Writer->Policy = policy;
+}
+
 //-----------------------------------------------------------------------------
 int HDF5AnalysisAdaptor::SetDataRequirements(const DataRequirements& reqs)
 {
@@ -132,19 +185,14 @@ bool HDF5AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
       SENSEI_WARNING("No subset specified. Writing all available data");
     }
 
-  if (!this->InitializeHDF5())
-    return false;
-
   unsigned long timeStep = dataAdaptor->GetDataTimeStep();
   double time = dataAdaptor->GetDataTime();
 
-  if (!this->m_HDF5Writer->AdvanceTimeStep(timeStep, time))
-    return false;
-
   // senseiHDF5::HDF5GroupGuard g(this->m_HDF5Writer->m_TimeStepGroupId);
 
   // collect the specified data objects and metadata
-  // std::vector<vtkCompositeDataSet*> objects;
+  std::vector<MeshMetadataPtr> metadata;
+  std::vector<vtkCompositeDataSet*> objects;
 
   MeshRequirementsIterator mit =
     this->Requirements.GetMeshRequirementsIterator();
@@ -188,25 +236,40 @@ bool HDF5AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
           return false;
         }
 
-      // add the required arrays
+      // add the required arrays that are due at this step
       ArrayRequirementsIterator ait =
         this->Requirements.GetArrayRequirementsIterator(mit.MeshName());
 
+      ait.SetMode(ArrayRequirementsIterator::MODE_ASSOCIATION);
+
       while (ait)
         {
-          if (dataAdaptor->AddArray(
-                dobj, mit.MeshName(), ait.Association(), ait.Array()))
+          std::vector<std::string> arrays;
+          this->Requirements.GetRequiredArrays(
+            mit.MeshName(), ait.Association(), timeStep, arrays);
+
+          if (dataAdaptor->AddArrays(
+                dobj, mit.MeshName(), ait.Association(), arrays))
             {
               SENSEI_ERROR("Failed to add "
                            << VTKUtils::GetAttributesName(ait.Association())
-                           << " data array \"" << ait.Array() << "\" to mesh \""
-                           << mit.MeshName() << "\"");
+                           << " data arrays to mesh \"" << mit.MeshName()
+                           << "\"");
               return false;
             }
 
           ++ait;
         }
 
+      // the metadata written lists the arrays written, readers find the
+      // arrays available at each step there
+      if (this->Requirements.SelectArrays(timeStep, md))
+        {
+          SENSEI_ERROR("Failed to select the arrays of mesh \""
+                       << mit.MeshName() << "\"");
+          return false;
+        }
+
       // generate a global view of the metadata. everything we do from here
       // on out depends on having the global view.
       if (!md->GlobalView)
@@ -221,70 +284,419 @@ bool HDF5AnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
           md->GlobalView = true;
         }
 
-      this->m_HDF5Writer->WriteMesh(md, dobj);
-
-      dobj->Delete();
+      metadata.push_back(md);
+      objects.push_back(dobj);
 
       ++mit;
     }
 
-  return true;
+  // separate step files are removed by their readers, there is nothing
+  // to link to
+  if (m_TrackChanges && m_DoStreaming)
+    {
+      SENSEI_WARNING("Tracking changed arrays requires a single file."
+        " All arrays will be written")
+      m_TrackChanges = false;
+    }
+
+  // when aggregating the changes are found before the discard decision,
+  // which is made by the leaders
+  if (m_TrackChanges && m_NodeAggregation && this->m_Writer->QueueDepth &&
+    (this->m_Writer->Policy == QUEUE_DISCARD))
+    {
+      SENSEI_WARNING("Tracking changed arrays is not supported with node"
+        " aggregation and a discarding writer queue. All arrays will be written")
+      m_TrackChanges = false;
+    }
+
+  // the changes are found on the simulation's blocks, those gathered to
+  // the leaders are new each step. only the leaders go on to write
+  std::vector<std::vector<int>> changed;
+  if (m_NodeAggregation)
+    {
+      if (!this->GetChangedArrays(metadata, objects, changed) ||
+        !this->GatherToLeaders(metadata, objects))
+        return false;
+
+      if (!m_Aggregator.IsLeader())
+        return true;
+    }
+
+  // the changes of a step written asynchronously are found once it is
+  // known not to be discarded
+  bool ok = this->m_Writer->QueueDepth ?
+    this->WriteTimestepAsynchronous(timeStep, time, metadata, objects,
+      changed) :
+    ((m_NodeAggregation || this->GetChangedArrays(metadata, objects, changed)) &&
+     this->InitializeHDF5(this->GetWriterCommunicator()) &&
+     this->WriteTimestep(timeStep, time, metadata, objects, changed));
+
+  unsigned int nObjects = objects.size();
+  for (unsigned int i = 0; i < nObjects; ++i)
+    objects[i]->Delete();
+
+  return ok;
 }
 
 //----------------------------------------------------------------------------
-bool HDF5AnalysisAdaptor::InitializeHDF5()
+MPI_Comm HDF5AnalysisAdaptor::GetWriterCommunicator()
 {
-  TimeEvent<128> mark("HDF5AnalysisAdaptor::IntializeHDF5");
+  return m_NodeAggregation ? m_Aggregator.GetLeaderCommunicator() :
+    this->GetCommunicator();
+}
 
-  if (!this->m_HDF5Writer)
+//----------------------------------------------------------------------------
+bool HDF5AnalysisAdaptor::GatherToLeaders(
+  std::vector<MeshMetadataPtr> &metadata,
+  std::vector<vtkCompositeDataSet*> &objects)
+{
+  TimeEvent<128> mark("HDF5AnalysisAdaptor::GatherToLeaders");
+
+  if (!m_Aggregator.Initialized() &&
+    m_Aggregator.Initialize(this->GetCommunicator()))
     {
-      this->m_HDF5Writer =
-        new senseiHDF5::WriteStream(this->GetCommunicator(), m_DoStreaming);
-      if (!this->m_HDF5Writer->Init(this->m_FileName))
+      SENSEI_ERROR("Failed to initialize node aggregation")
+      return false;
+    }
+
+  bool ok = true;
+  unsigned int nObjects = objects.size();
+  for (unsigned int i = 0; i < nObjects; ++i)
+    {
+      MeshMetadataPtr leaderMd;
+      vtkCompositeDataSet *leaderMesh = nullptr;
+
+      if (ok && m_Aggregator.Gather(metadata[i], objects[i], leaderMd,
+                                    leaderMesh))
         {
-          return -1;
+          SENSEI_ERROR("Failed to gather mesh \"" << metadata[i]->MeshName
+            << "\" to the node leaders")
+          ok = false;
         }
+
+      if (objects[i])
+        objects[i]->Delete();
+      objects[i] = leaderMesh;
+      metadata[i] = leaderMd;
     }
-  return true;
+
+  if (!ok || !m_Aggregator.IsLeader())
+    {
+      for (unsigned int i = 0; i < nObjects; ++i)
+        {
+          if (objects[i])
+            objects[i]->Delete();
+        }
+      objects.clear();
+      metadata.clear();
+    }
+
+  return ok;
 }
 
 //----------------------------------------------------------------------------
-int HDF5AnalysisAdaptor::Finalize()
+bool HDF5AnalysisAdaptor::GetChangedArrays(
+  const std::vector<MeshMetadataPtr> &metadata,
+  const std::vector<vtkCompositeDataSet*> &objects,
+  std::vector<std::vector<int>> &changed)
 {
-  TimeEvent<128> mark("HDF5AnalysisAdaptor::Finalize");
+  changed.clear();
 
-  if (this->m_HDF5Writer)
-    delete this->m_HDF5Writer;
+  if (!m_TrackChanges)
+    return true;
 
-  this->m_HDF5Writer = nullptr;
+  TimeEvent<128> mark("HDF5AnalysisAdaptor::GetChangedArrays");
 
-  return 0;
+  unsigned int nObjects = objects.size();
+  changed.resize(nObjects);
+
+  for (unsigned int i = 0; i < nObjects; ++i)
+    {
+      if (m_ChangeTracker.Update(this->GetCommunicator(), metadata[i],
+                                 objects[i], changed[i]))
+        {
+          SENSEI_ERROR("Failed to find the changed arrays of mesh \""
+            << metadata[i]->MeshName << "\"")
+          return false;
+        }
+    }
+
+  return true;
 }
 
-/*
 //----------------------------------------------------------------------------
 bool HDF5AnalysisAdaptor::WriteTimestep(unsigned long timeStep, double time,
-                                      const std::vector<vtkCompositeDataSet*>
-&objects)
+  std::vector<MeshMetadataPtr> &metadata,
+  const std::vector<vtkCompositeDataSet*> &objects,
+  const std::vector<std::vector<int>> &changed)
+{
+  TimeEvent<128> mark("HDF5AnalysisAdaptor::WriteTimestep");
+
+  if (!this->m_HDF5Writer->AdvanceTimeStep(timeStep, time))
+    return false;
+
+  // an empty list of flags writes all of the arrays
+  static const std::vector<int> allChanged;
+
+  unsigned int nObjects = objects.size();
+  for (unsigned int i = 0; i < nObjects; ++i)
+    {
+      if (!this->m_HDF5Writer->WriteMesh(metadata[i], objects[i],
+            i < changed.size() ? changed[i] : allChanged))
+        {
+          SENSEI_ERROR("Failed to write mesh \"" << metadata[i]->MeshName
+            << "\" at step " << timeStep << " to \"" << this->m_FileName << "\"")
+          return false;
+        }
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool HDF5AnalysisAdaptor::WriteTimestepAsynchronous(unsigned long timeStep,
+  double time, const std::vector<MeshMetadataPtr> &metadata,
+  const std::vector<vtkCompositeDataSet*> &objects,
+  const std::vector<std::vector<int>> &changed)
 {
-TimeEvent<128> mark("HDF5AnalysisAdaptor::WriteTimestep");
+  TimeEvent<128> mark("HDF5AnalysisAdaptor::WriteTimestepAsynchronous");
+
+  WriterType *writer = this->m_Writer;
+
+  if (!writer->Running)
+    {
+      // the writer thread makes MPI calls while the simulation does
+      int threadLevel = MPI_THREAD_SINGLE;
+      MPI_Query_thread(&threadLevel);
+      if (threadLevel < MPI_THREAD_MULTIPLE)
+        {
+          SENSEI_WARNING("Asynchronous writes require MPI_THREAD_MULTIPLE."
+            " Steps will be written synchronously")
+          writer->QueueDepth = 0;
+          std::vector<MeshMetadataPtr> md(metadata);
+          std::vector<std::vector<int>> stepChanged(changed);
+          return (m_NodeAggregation ||
+            this->GetChangedArrays(metadata, objects, stepChanged)) &&
+            this->InitializeHDF5(this->GetWriterCommunicator()) &&
+            this->WriteTimestep(timeStep, time, md, objects, stepChanged);
+        }
 
-int ierr = 0;
+      MPI_Comm_dup(this->GetWriterCommunicator(), &writer->Comm);
 
-TimeEvent<128> mark("HDF5AnalysisAdaptor::WriteTimestep");
+      writer->Stop = false;
+      writer->Error = false;
+      writer->Running = true;
 
-this->m_HDF5Writer->AdvanceTimeStep(timestep, time);
+      // HDF5 is not necessarily thread safe. from here on every HDF5 call,
+      // including opening the file, is made by the writer thread
+      writer->Thread = std::thread([this, writer]()
+        {
+          TaskRuntime::BindThread("HDF5AnalysisAdaptor::Writer");
+
+          std::unique_lock<std::mutex> lock(writer->Mutex);
+          while (true)
+            {
+              writer->Cond.wait(lock, [writer]() -> bool
+                { return writer->Stop || !writer->Queue.empty(); });
+
+              if (writer->Queue.empty())
+                return;
+
+              WriterType::Step step = std::move(writer->Queue.front());
+              writer->Queue.pop_front();
+              writer->Cond.notify_all();
+
+              lock.unlock();
+
+              std::vector<vtkCompositeDataSet*> objs(step.Objects.begin(),
+                step.Objects.end());
+
+              bool ok = this->InitializeHDF5(writer->Comm) &&
+                this->WriteTimestep(step.TimeStep, step.Time, step.Metadata,
+                  objs, step.Changed);
+
+              // release the copy before taking the lock
+              objs.clear();
+              step.Objects.clear();
+
+              lock.lock();
+              ++writer->NumWritten;
+              if (!ok)
+                {
+                  writer->Error = true;
+                  writer->Cond.notify_all();
+                }
+            }
+        });
+    }
+
+  // discard the step everywhere if any rank's writer has fallen behind
+  if (writer->Policy == QUEUE_DISCARD)
+    {
+      int full = 0;
+      {
+        std::lock_guard<std::mutex> lock(writer->Mutex);
+        full = writer->Queue.size() >= writer->QueueDepth;
+      }
+
+      int anyFull = 0;
+      MPI_Allreduce(&full, &anyFull, 1, MPI_INT, MPI_MAX,
+        this->GetWriterCommunicator());
+
+      if (anyFull)
+        {
+          ++writer->NumDiscarded;
+          return true;
+        }
+    }
+
+  // copy the data, the simulation may modify it as soon as we return.
+  // changes are found on the simulation's arrays, the copies are new
+  WriterType::Step step;
+  step.TimeStep = timeStep;
+  step.Time = time;
+  step.Metadata = metadata;
+
+  if (m_NodeAggregation)
+    step.Changed = changed;
+  else if (!this->GetChangedArrays(metadata, objects, step.Changed))
+    return false;
+
+  unsigned int nObjects = objects.size();
+  for (unsigned int i = 0; i < nObjects; ++i)
+    {
+      vtkCompositeDataSetPtr copy;
+      copy.TakeReference(objects[i]->NewInstance());
+      copy->DeepCopy(objects[i]);
+      step.Objects.push_back(copy);
+    }
+
+  // wait for room in the queue
+  std::unique_lock<std::mutex> lock(writer->Mutex);
+  writer->Cond.wait(lock, [writer]() -> bool
+    { return writer->Error || (writer->Queue.size() < writer->QueueDepth); });
+
+  if (writer->Error)
+    {
+      SENSEI_ERROR("The asynchronous writer failed")
+      return false;
+    }
+
+  writer->Queue.push_back(std::move(step));
+  writer->Cond.notify_all();
+
+  Profiler::LogCounter("HDF5AnalysisAdaptor::QueueDepth",
+    writer->Queue.size());
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool HDF5AnalysisAdaptor::StopWriter()
+{
+  WriterType *writer = this->m_Writer;
+
+  if (!writer->Running)
+    return true;
 
-if (this->m_HDF5Writer->Write(objects))
   {
-    SENSEI_ERROR("Failed to write step " << timeStep
-                 << " to \"" << this->FileName << "\"");
-    return -1;
+    std::lock_guard<std::mutex> lock(writer->Mutex);
+    writer->Stop = true;
   }
+  writer->Cond.notify_all();
+
+  writer->Thread.join();
+  writer->Running = false;
+
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+  if (finalized)
+    return !writer->Error;
+
+  int rank = 0;
+  MPI_Comm_rank(writer->Comm, &rank);
+  if (rank == 0)
+    {
+      SENSEI_STATUS("HDF5AnalysisAdaptor wrote " << writer->NumWritten
+        << " steps asynchronously and discarded " << writer->NumDiscarded)
+    }
 
-return ierr;
+  // the file is closed before the communicator it was opened on is freed
+  delete this->m_HDF5Writer;
+  this->m_HDF5Writer = nullptr;
+
+  MPI_Comm_free(&writer->Comm);
+
+  return !writer->Error;
 }
-*/
+
+//----------------------------------------------------------------------------
+bool HDF5AnalysisAdaptor::InitializeHDF5(MPI_Comm comm)
+{
+  TimeEvent<128> mark("HDF5AnalysisAdaptor::IntializeHDF5");
+
+  if (!this->m_HDF5Writer)
+    {
+      this->m_HDF5Writer =
+        new senseiHDF5::WriteStream(comm, m_DoStreaming);
+
+      // hints apply to the file access and must be set before opening
+      this->m_HDF5Writer->SetMPIHints(m_CbNodes, m_CbBufferSize, m_Alignment);
+
+      if (m_Subfiling &&
+        !this->m_HDF5Writer->SetSubfiling(m_StripeSize, m_StripeCount))
+        {
+          delete this->m_HDF5Writer;
+          this->m_HDF5Writer = nullptr;
+          return false;
+        }
+
+      if (!this->m_HDF5Writer->Init(this->m_FileName))
+        {
+          delete this->m_HDF5Writer;
+          this->m_HDF5Writer = nullptr;
+          return false;
+        }
+
+      if (m_Collective)
+        this->m_HDF5Writer->SetCollectiveTxf();
+
+      this->m_HDF5Writer->SetChunkSize(m_ChunkSize);
+      this->m_HDF5Writer->SetShuffle(m_Shuffle);
+      this->m_HDF5Writer->SetMetadataKeyFrames(m_MetadataKeyFrames);
+      this->m_HDF5Writer->SetArrayPrecision(this->Requirements);
+
+      if (!this->m_HDF5Writer->SetFilter(m_Filter, m_FilterLevel))
+        {
+          delete this->m_HDF5Writer;
+          this->m_HDF5Writer = nullptr;
+          return false;
+        }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int HDF5AnalysisAdaptor::Finalize()
+{
+  TimeEvent<128> mark("HDF5AnalysisAdaptor::Finalize");
+
+  // write the steps that are still queued
+  int ierr = this->StopWriter() ? 0 : -1;
+
+  Profiler::LogCounter("HDF5AnalysisAdaptor::StepsSkipped",
+    this->m_Writer->NumDiscarded);
+
+  if (this->m_HDF5Writer)
+    delete this->m_HDF5Writer;
+
+  this->m_HDF5Writer = nullptr;
+  m_ChangeTracker.Clear();
+  m_Aggregator.Free();
+
+  return ierr;
+}
+
 //----------------------------------------------------------------------------
 void HDF5AnalysisAdaptor::PrintSelf(ostream& os, vtkIndent indent)
 {
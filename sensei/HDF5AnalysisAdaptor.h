@@ -2,8 +2,10 @@
 #define HDF5AnalysisAdaptor_h
 
 #include "AnalysisAdaptor.h"
+#include "ArrayChangeTracker.h"
 #include "DataRequirements.h"
 #include "MeshMetadata.h"
+#include "NodeAggregator.h"
 
 #include "hdf5.h"
 #include <mpi.h>
@@ -40,10 +42,106 @@ public:
 
   void SetCollective(bool s) { m_Collective = s; }
 
+  /// @brief Set the dataset chunk size in elements.
+  ///
+  /// 0 writes contiguous datasets, -1 aligns chunks with the blocks.
+  /// Default 0, or -1 when a filter is set.
+  void SetChunkSize(long long n) { m_ChunkSize = n; }
+
+  /// @brief Set the compression filter applied to data arrays.
+  ///
+  /// One of none, deflate, zstd, blosc, or scaleoffset, with zstd and
+  /// blosc provided by HDF5 filter plugins. scaleoffset quantizes floating
+  /// point values to level decimal digits. Readers decompress
+  /// transparently. Parallel compression forces collective writes.
+  void SetFilter(const std::string &name, int level)
+  { m_Filter = name; m_FilterLevel = level; }
+
+  /// @brief Shuffle the bytes of the array elements before compression.
+  /// Default off.
+  void SetShuffle(bool val)
+  { m_Shuffle = val; }
+
+  /// @brief Write each file as a set of subfiles.
+  ///
+  /// Subfiles are written by I/O concentrators, by default one per node,
+  /// and are read back as one file. See senseiHDF5::BasicStream::SetSubfiling.
+  /// A stripe size or count of 0 uses the HDF5 default.
+  void SetSubfiling(bool s, long long stripeSize, int stripeCount)
+  {
+    m_Subfiling = s;
+    m_StripeSize = stripeSize;
+    m_StripeCount = stripeCount;
+  }
+
+  /// @brief Set MPI-IO collective buffering hints and the file alignment.
+  ///
+  /// Values of 0 leave the MPI-IO and HDF5 defaults.
+  void SetMPIHints(int cbNodes, long long cbBufferSize, long long alignment)
+  {
+    m_CbNodes = cbNodes;
+    m_CbBufferSize = cbBufferSize;
+    m_Alignment = alignment;
+  }
+
+  /// queue policies, see SetAsynchronous
+  enum {QUEUE_BLOCK=0, QUEUE_DISCARD=1};
+
+  /// @brief Write in a background thread.
+  ///
+  /// When the queue depth is non-zero Execute copies the data to be
+  /// written and hands it to a background thread which makes all of the
+  /// HDF5 calls while the simulation continues. At most queueDepth steps
+  /// wait to be written. When the queue is full QUEUE_BLOCK makes Execute
+  /// wait for the writer, QUEUE_DISCARD skips the step on all ranks.
+  /// Requires MPI_THREAD_MULTIPLE, otherwise steps are written
+  /// synchronously. The default, 0, writes synchronously.
+  void SetAsynchronous(unsigned int queueDepth, int policy = QUEUE_BLOCK);
+
+  /// @brief Store the data arrays that did not change only once.
+  ///
+  /// When enabled a data array that did not change since the last step,
+  /// see ArrayChangeTracker, is made a hard link to the dataset it was last
+  /// written to, readers see it in every step. The same is done for the
+  /// geometry of meshes flagged StaticMesh and for unchanged metadata, and
+  /// readers reuse the geometry they read then. Only in a single file, steps
+  /// written to separate files are removed by their readers. The default
+  /// is disabled.
+  void SetTrackChanges(bool val) { m_TrackChanges = val; }
+
+  /// @brief Write the metadata as the difference to the last step's.
+  ///
+  /// The metadata of a mesh that changed is written as the fields and
+  /// blocks that differ from that of the last step, with all of it written
+  /// every interval steps. Readers follow the deltas back to the last key
+  /// frame when steps are read out of order. Only in a single file. The
+  /// default, 0, writes all of it every step.
+  void SetMetadataKeyFrames(unsigned int interval)
+  { m_MetadataKeyFrames = interval; }
+
+  /// flag an array as unchanged at the next step, for data adaptors that
+  /// make their VTK arrays anew each step. see ArrayChangeTracker
+  void SetArrayUnchanged(const std::string &meshName, int association,
+                         const std::string &arrayName)
+  { m_ChangeTracker.SetArrayUnchanged(meshName, association, arrayName); }
+
+  /// @brief Write from one rank per node.
+  ///
+  /// When enabled the ranks of each shared memory node gather their blocks
+  /// to the lowest rank of the node and only these leaders open the file,
+  /// see NodeAggregator. The blocks' metadata is kept with their owners set
+  /// to the leaders. Changed arrays are found on all ranks before the
+  /// gather. AMR meshes are not supported. The default is disabled.
+  void SetNodeAggregation(bool val) { m_NodeAggregation = val; }
+
   std::string GetFileName() const { return this->m_FileName; }
 
   /// data requirements tell the adaptor what to push
-  /// if none are given then all data is pushed.
+  /// if none are given then all data is pushed. floating point arrays are
+  /// stored at the precision the requirements give them, see
+  /// DataRequirements::SetArrayPrecision. arrays are written at the steps
+  /// their cadence gives, see DataRequirements::SetArrayCadence, and the
+  /// metadata of each step lists those written.
   int SetDataRequirements(const DataRequirements &reqs);
 
   int AddDataRequirement(const std::string &meshName, int association,
@@ -59,23 +157,66 @@ protected:
 
   // intializes HDF5 in no-xml mode, allocate buffers, and declares a group
   // bool InitializeHDF5(const std::vector<MeshMetadataPtr> &metadata);
-  bool InitializeHDF5();
+  bool InitializeHDF5(MPI_Comm comm);
 
-  // writes the data collection
-  /*
+  // writes one step of the data collection. changed flags the data arrays
+  // of each object that changed, when empty all are written
   bool WriteTimestep(unsigned long timeStep, double time,
-                     const std::vector<MeshMetadataPtr> &metadata,
-                     const std::vector<vtkCompositeDataSet*> &dobjects);
-  */
+                     std::vector<MeshMetadataPtr> &metadata,
+                     const std::vector<vtkCompositeDataSet*> &objects,
+                     const std::vector<std::vector<int>> &changed);
+
+  // finds the data arrays of each object that changed since the last step
+  // written. changed is left empty when changes are not tracked
+  bool GetChangedArrays(const std::vector<MeshMetadataPtr> &metadata,
+                        const std::vector<vtkCompositeDataSet*> &objects,
+                        std::vector<std::vector<int>> &changed);
+
+  // the ranks that write, the node leaders when aggregating
+  MPI_Comm GetWriterCommunicator();
+
+  // replaces the objects and their metadata by those gathered to the node
+  // leaders, on the other ranks they are released and cleared
+  bool GatherToLeaders(std::vector<MeshMetadataPtr> &metadata,
+                       std::vector<vtkCompositeDataSet*> &objects);
+
+  // queues a copy of the step for the background writer. changed holds
+  // the changes found before the gather when aggregating
+  bool WriteTimestepAsynchronous(unsigned long timeStep, double time,
+                                 const std::vector<MeshMetadataPtr> &metadata,
+                                 const std::vector<vtkCompositeDataSet*> &objects,
+                                 const std::vector<std::vector<int>> &changed);
+
+  // writes the queued steps and stops the background writer
+  bool StopWriter();
+
   unsigned int MaxBufferSize;
   sensei::DataRequirements Requirements;
   std::string m_FileName;
   bool m_DoStreaming = false;
   bool m_Collective = false;
+  long long m_ChunkSize = 0;
+  std::string m_Filter = "none";
+  int m_FilterLevel = 0;
+  bool m_Shuffle = false;
+  int m_CbNodes = 0;
+  long long m_CbBufferSize = 0;
+  long long m_Alignment = 0;
+  bool m_Subfiling = false;
+  long long m_StripeSize = 0;
+  int m_StripeCount = 0;
+  bool m_TrackChanges = false;
+  unsigned int m_MetadataKeyFrames = 0;
+  ArrayChangeTracker m_ChangeTracker;
+  bool m_NodeAggregation = false;
+  NodeAggregator m_Aggregator;
 
 private:
   senseiHDF5::WriteStream *m_HDF5Writer;
 
+  struct WriterType;
+  WriterType *m_Writer;
+
   HDF5AnalysisAdaptor(const HDF5AnalysisAdaptor &) = delete;
   void operator=(const HDF5AnalysisAdaptor &) = delete;
 };
@@ -73,6 +73,10 @@ int HDF5DataAdaptor::Initialize(pugi::xml_node& node)
         }
     }
 
+  SetSubfiling(node.attribute("subfiling").as_int(0));
+  SetStructureOfArrays(node.attribute("structure_of_arrays").as_int(0));
+  SetNumberOfThreads(node.attribute("threads").as_int(1));
+
   return 0;
 }
 
@@ -81,6 +85,10 @@ int HDF5DataAdaptor::OpenStream()
 {
   TimeEvent<128> mark("HDF5DataAdaptor::OpenStream");
 
+  if (this->GetStepPolicy() == STEP_POLICY_LATEST)
+    SENSEI_WARNING("The latest step policy is not supported by HDF5."
+      " Every step will be processed")
+
   if (m_StreamName.size() == 0)
     {
       SENSEI_ERROR("Failed to specify stream name:");
@@ -91,6 +99,12 @@ int HDF5DataAdaptor::OpenStream()
     {
       this->m_HDF5Reader =
         new senseiHDF5::ReadStream(this->GetCommunicator(), m_Streaming);
+
+      if (m_Subfiling && !this->m_HDF5Reader->SetSubfiling(0, 0))
+        return -1;
+
+      this->m_HDF5Reader->m_StructureOfArrays = m_StructureOfArrays;
+      this->m_HDF5Reader->m_NumberOfThreads = m_NumberOfThreads;
     }
 
   if (!this->m_HDF5Reader->Init(m_StreamName))
@@ -103,6 +117,8 @@ int HDF5DataAdaptor::OpenStream()
   if (this->UpdateTimeStep())
     return -1;
 
+  this->CountSteps(1, 0);
+
   return 0;
 }
 
@@ -150,7 +166,22 @@ int HDF5DataAdaptor::AdvanceStream()
 {
   TimeEvent<128> mark("HDF5DataAdaptor::Advance");
 
-  return this->UpdateTimeStep();
+  // move past the steps skipped by the step policy
+  unsigned int stride = this->GetStepStride();
+  for (unsigned int i = 1; i < stride; ++i)
+    {
+      unsigned long timeStep = 0;
+      double time = 0.0;
+      if (!this->m_HDF5Reader->AdvanceTimeStep(timeStep, time))
+        return -1;
+    }
+
+  if (this->UpdateTimeStep())
+    return -1;
+
+  this->CountSteps(1, stride - 1);
+
+  return 0;
 }
 
 //----------------------------------------------------------------------------
@@ -168,6 +199,35 @@ int HDF5DataAdaptor::UpdateTimeStep()
       return -1;
     }
 
+  return this->UpdateMetadata(timeStep, time);
+}
+
+//----------------------------------------------------------------------------
+int HDF5DataAdaptor::SeekStream(unsigned int step)
+{
+  TimeEvent<128> mark("HDF5DataAdaptor::SeekStream");
+
+  if (this->m_HDF5Reader == nullptr)
+    {
+      SENSEI_ERROR("The stream is not open");
+      return -1;
+    }
+
+  unsigned long timeStep = 0;
+  double time = 0.0;
+
+  if (!this->m_HDF5Reader->SeekTimeStep(step, timeStep, time) ||
+    this->UpdateMetadata(timeStep, time))
+    return -1;
+
+  this->CountSteps(1, 0);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int HDF5DataAdaptor::UpdateMetadata(unsigned long timeStep, double time)
+{
   this->SetDataTimeStep(timeStep);
   this->SetDataTime(time);
 
@@ -247,6 +307,14 @@ int HDF5DataAdaptor::GetMeshMetadata(unsigned int id, MeshMetadataPtr& metadata)
           this->CloseStream();
         }
 
+      // leave the AMR levels the analyses do not need on the sender
+      if (this->ApplyLevelRequirements(recverMd))
+        {
+          SENSEI_ERROR("Failed to select the required levels");
+          this->CloseStream();
+          return -1;
+        }
+
       metadata = recverMd;
       //
       // use this meshmetadata to read objects
@@ -254,7 +322,8 @@ int HDF5DataAdaptor::GetMeshMetadata(unsigned int id, MeshMetadataPtr& metadata)
       this->m_HDF5Reader->m_AllMeshInfoReceiver.SetMeshMetadata(id, recverMd);
     }
 
-  return 0;
+  // pass only the arrays the analyses require
+  return this->ApplyDataRequirements(metadata);
 }
 
 //----------------------------------------------------------------------------
@@ -27,6 +27,18 @@ public:
   void SetStreaming(bool s) { m_Streaming = s; }
   void SetCollective(bool s) { m_Collective = s; }
 
+  // read files written as a set of subfiles
+  void SetSubfiling(bool s) { m_Subfiling = s; }
+
+  // read multi-component arrays into vtkSOADataArrayTemplate, one buffer
+  // per component. requires VTK generic arrays
+  void SetStructureOfArrays(bool s) { m_StructureOfArrays = s; }
+
+  // the number of threads of the TaskRuntime the received blocks' cells
+  // are assembled on, once the reads of all of the local blocks complete.
+  // a value less than 1 uses all of them. the default is 1
+  void SetNumberOfThreads(int n) { m_NumberOfThreads = n; }
+
   // int Advance(); now is AdvanceStream()
 
   // int Close(); now is CloseStream()
@@ -54,6 +66,12 @@ public:
   int CloseStream() override;
   int AdvanceStream() override;
   int StreamGood() override;
+
+  // move to the step'th step of the stream without reading the steps
+  // before it. the steps are indexed when the stream is opened. only for
+  // streams written to a single file
+  int SeekStream(unsigned int step);
+
   int Initialize(pugi::xml_node &parent) override;
   int Finalize() override;
   int GetSenderMeshMetadata(unsigned int id,
@@ -67,6 +85,9 @@ protected:
   // stores them in the base class information object
   int UpdateTimeStep();
 
+  // reads the metadata of the step just opened
+  int UpdateMetadata(unsigned long timeStep, double time);
+
 private:
   // struct InternalsType;
   // InternalsType *Internals;
@@ -74,6 +95,9 @@ private:
 
   bool m_Streaming = false;
   bool m_Collective = false;
+  bool m_Subfiling = false;
+  bool m_StructureOfArrays = false;
+  int m_NumberOfThreads = 1;
 
   std::string m_StreamName;
 
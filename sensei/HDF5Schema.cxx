@@ -1,5 +1,7 @@
 #include "HDF5Schema.h"
+#include "BufferPool.h"
 #include "Profiler.h"
+#include "TaskRuntime.h"
 #include "VTKUtils.h"
 
 #include <vtkCellArray.h>
@@ -40,6 +42,9 @@
 #include <vtkUnsignedLongLongArray.h>
 #include <vtkUnstructuredGrid.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <map>
 #include <set>
 #include <sstream>
@@ -47,6 +52,10 @@
 #include <vector>
 
 #include <unistd.h>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
 
 #include "BlockPartitioner.h"
 
@@ -56,6 +65,7 @@ static const std::string ATTRNAME_TIMESTEP = "timestep";
 static const std::string ATTRNAME_TIME = "time";
 static const std::string ATTRNAME_NUM_TIMESTEP = "num_timestep";
 static const std::string ATTRNAME_NUM_MESH = "num_meshs";
+static const std::string ATTRNAME_GEOMETRY_STEP = "geometry_step";
 static const std::string TAG_MESH = "mesh_";
 static const std::string TAG_ARRAY = "array_";
 static const std::string TAG_VTK_GHOST =
@@ -85,6 +95,11 @@ static void gGetNameStr(std::string &out,
   out = ons.str();
 }
 
+// the datasets holding the geometry of a mesh, see the VTKObjectFlow's
+static const char *GEOMETRY_NAMES[] = {"points", "cell_types", "cell_array",
+  "cell_offsets", "cell_connectivity", "x_coords", "y_coords", "z_coords",
+  "origin", "spacing", "extent", nullptr};
+
 static void gGetArrayNameStr(std::string &out,
                              unsigned int meshID,
                              unsigned int array_id)
@@ -230,22 +245,25 @@ hid_t gVTKToH5Type(int vtkt)
 //
 //
 //
-HDF5VarGuard::HDF5VarGuard(hid_t varID)
+HDF5VarGuard::HDF5VarGuard(hid_t varID, bool owner)
   : m_VarID(varID)
+  , m_Owner(owner)
 {
   m_VarType = H5Dget_type(varID);
+  m_MemType = m_VarType;
   m_VarSpace = H5Dget_space(varID);
 }
 
 HDF5VarGuard::~HDF5VarGuard()
 {
-  H5Dclose(m_VarID);
+  if(m_Owner)
+    H5Dclose(m_VarID);
   H5Sclose(m_VarSpace);
 }
 
 void HDF5VarGuard::ReadAll(void *buf)
 {
-  H5Dread(m_VarID, m_VarType, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf);
+  H5Dread(m_VarID, m_MemType, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf);
 }
 
 void HDF5VarGuard::ReadSlice(void *buf,
@@ -263,9 +281,79 @@ void HDF5VarGuard::ReadSlice(void *buf,
   sensei::TimeEvent<128> mark(evtName.c_str());
   H5Sselect_hyperslab(m_VarSpace, H5S_SELECT_SET, start, stride, count, block);
 
-  H5Dread(m_VarID, m_VarType, memDataSpace, m_VarSpace, H5P_DEFAULT, buf);
+  H5Dread(m_VarID, m_MemType, memDataSpace, m_VarSpace, H5P_DEFAULT, buf);
+
+  H5Sclose(memDataSpace);
+}
+
+bool HDF5VarGuard::ReadSpans(const std::vector<hsize_t> &starts,
+                             const std::vector<hsize_t> &counts,
+                             const std::vector<hsize_t> &strides,
+                             const std::vector<void *> &bufs)
+{
+  size_t nSpans = counts.size();
+  size_t elemSize = H5Tget_size(m_MemType);
+
+  // select the union of the spans, merging adjacent contiguous spans
+  H5Sselect_none(m_VarSpace);
+
+  hsize_t total = 0;
+  for(size_t i = 0; i < nSpans;)
+    {
+      hsize_t start = starts[i];
+      hsize_t count = counts[i];
+      hsize_t stride = strides.empty() ? 1 : strides[i];
+
+      for(++i; (stride == 1) && (i < nSpans) &&
+            (strides.empty() || (strides[i] == 1)) &&
+            (starts[i] == start + count); ++i)
+        count += counts[i];
+
+      if(count)
+        H5Sselect_hyperslab(
+          m_VarSpace, H5S_SELECT_OR, &start, &stride, &count, NULL);
+
+      total += count;
+    }
+
+  if(total == 0)
+    return true;
+
+  std::ostringstream  oss;   oss<<"H5BytesRead="<<total*elemSize;
+  std::string evtName = oss.str();
+  sensei::TimeEvent<128> mark(evtName.c_str());
+
+  // a single span is read in place, otherwise stage and scatter
+  std::vector<char> buffer;
+  void *memData = bufs[0];
+  if(nSpans > 1)
+    {
+      buffer.resize(total * elemSize);
+      memData = buffer.data();
+    }
+
+  hid_t memDataSpace = H5Screate_simple(1, &total, NULL);
+
+  herr_t ierr =
+    H5Dread(m_VarID, m_MemType, memDataSpace, m_VarSpace, H5P_DEFAULT, memData);
 
   H5Sclose(memDataSpace);
+
+  if(ierr < 0)
+    return false;
+
+  if(nSpans > 1)
+    {
+      const char *src = buffer.data();
+      for(size_t i = 0; i < nSpans; ++i)
+        {
+          size_t nBytes = counts[i] * elemSize;
+          memcpy(bufs[i], src, nBytes);
+          src += nBytes;
+        }
+    }
+
+  return true;
 }
 
 //
@@ -292,10 +380,13 @@ DefaultStreamHandler::DefaultStreamHandler(const std::string &hostFile,
     H5Fopen(hostFile.c_str(), H5F_ACC_RDONLY, client->m_PropertyListId);
 
   if(m_HostFileId >= 0)
-    client->ReadNativeAttr(senseiHDF5::ATTRNAME_NUM_TIMESTEP,
-                           &(m_TimeStepTotal),
-                           H5T_NATIVE_UINT,
-                           m_HostFileId);
+    {
+      client->ReadNativeAttr(senseiHDF5::ATTRNAME_NUM_TIMESTEP,
+                             &(m_TimeStepTotal),
+                             H5T_NATIVE_UINT,
+                             m_HostFileId);
+      BuildIndex(client);
+    }
 }
 
 DefaultStreamHandler::DefaultStreamHandler(const std::string &hostFile,
@@ -323,6 +414,75 @@ bool DefaultStreamHandler::IsValid()
   return true;
 }
 
+void DefaultStreamHandler::BuildIndex(ReadStream *client)
+{
+  sensei::TimeEvent<128> mark("DefaultStreamHandler::BuildIndex");
+
+  // a single rank visits the steps, rather than every rank reading the
+  // attributes of every step it opens
+  m_Index.resize(m_TimeStepTotal);
+
+  int ok = 1;
+  if(client->m_Rank == 0)
+    {
+      for(unsigned int i = 0; ok && (i < m_TimeStepTotal); ++i)
+        {
+          std::string stepName;
+          gGetTimeStepString(stepName, i);
+
+          hid_t gid = H5Gopen(m_HostFileId, stepName.c_str(), H5P_DEFAULT);
+          if(gid < 0)
+            {
+              ok = 0;
+              break;
+            }
+
+          HDF5GroupGuard g(gid);
+
+          StepRecord &rec = m_Index[i];
+          ok = client->ReadNativeAttr(ATTRNAME_TIMESTEP, &rec.TimeStep,
+                                      H5T_NATIVE_ULONG, gid) &&
+            client->ReadNativeAttr(ATTRNAME_TIME, &rec.Time,
+                                   H5T_NATIVE_DOUBLE, gid) &&
+            client->ReadNativeAttr(ATTRNAME_NUM_MESH, &rec.NumMeshes,
+                                   H5T_NATIVE_UINT, gid);
+        }
+    }
+
+  MPI_Bcast(&ok, 1, MPI_INT, 0, client->m_Comm);
+
+  // without the index the attributes are read as each step is opened
+  if(!ok)
+    {
+      SENSEI_WARNING("Failed to index the steps of " << m_FileName);
+      m_Index.clear();
+      return;
+    }
+
+  MPI_Bcast(m_Index.data(), m_TimeStepTotal * sizeof(StepRecord), MPI_BYTE,
+            0, client->m_Comm);
+}
+
+bool DefaultStreamHandler::SeekStream(unsigned int step)
+{
+  if(!m_InReadMode || (step >= m_TimeStepTotal))
+    return false;
+
+  m_TimeStepCounter = step;
+
+  return AdvanceStream();
+}
+
+bool DefaultStreamHandler::GetStepRecord(unsigned int step, StepRecord &rec)
+{
+  if(step >= m_Index.size())
+    return false;
+
+  rec = m_Index[step];
+
+  return true;
+}
+
 bool DefaultStreamHandler::CloseStream()
 {
   if(this->m_TimeStepId > -1)
@@ -405,17 +565,26 @@ PerStepStreamHandler::PerStepStreamHandler(const std::string &hostFile,
     ReadStream *client)
   : StreamHandler(true, hostFile, client)
 {
-  unsigned int AllowedTimeOutSec = 300;
+  // the watch is in place before the signal file is first read so that
+  // no update is missed
+  WatchSignalFile();
+
+  // wait until the first step is written
+  std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() + std::chrono::seconds(300);
 
-  // loop until timestep showed
-  unsigned int counter = 0;
-  while(counter < AllowedTimeOutSec)
+  while(true)
     {
       GetCurrAvailStep();
       if(m_NumStepsWritten > 0)
         break;
-      sleep(2);
-      counter += 5;
+
+      int timedOut = (std::chrono::steady_clock::now() > deadline);
+      MPI_Bcast(&timedOut, 1, MPI_INT, 0, m_Client->m_Comm);
+      if(timedOut)
+        break;
+
+      WaitForUpdate();
     }
 }
 
@@ -428,7 +597,91 @@ PerStepStreamHandler::PerStepStreamHandler(const std::string &hostFile,
   MPI_Barrier(m_Client->m_Comm);
 }
 
-PerStepStreamHandler::~PerStepStreamHandler() {}
+PerStepStreamHandler::~PerStepStreamHandler()
+{
+  if(m_WatchFd >= 0)
+    close(m_WatchFd);
+}
+
+void PerStepStreamHandler::WatchSignalFile()
+{
+#if defined(__linux__)
+  if(m_Client->m_Rank > 0)
+    return;
+
+  // the signal file is removed and recreated by the writer, the
+  // directory is watched
+  std::string dir = ".";
+  size_t slash = m_FileName.find_last_of('/');
+  if(slash != std::string::npos)
+    dir = (slash == 0) ? "/" : m_FileName.substr(0, slash);
+
+  m_WatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if((m_WatchFd >= 0) &&
+     (inotify_add_watch(m_WatchFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0))
+    {
+      close(m_WatchFd);
+      m_WatchFd = -1;
+    }
+
+  if(m_WatchFd < 0)
+    SENSEI_WARNING("Failed to watch \"" << dir << "\". " << strerror(errno)
+                   << ". Polling for new steps")
+#endif
+}
+
+void PerStepStreamHandler::WaitForUpdate()
+{
+  // the other ranks wait in the broadcast that follows
+  if(m_Client->m_Rank > 0)
+    return;
+
+  // the signal file is read again at least this often. inotify sees the
+  // writes made on this node, on a parallel file system the writer is
+  // often on another node and only the recheck finds its steps
+  const int recheckMs = 1000;
+
+#if defined(__linux__)
+  if(m_WatchFd >= 0)
+    {
+      std::string baseName = m_FileName.substr(m_FileName.find_last_of('/') + 1);
+
+      std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(recheckMs);
+
+      while(true)
+        {
+          int ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+
+          pollfd pfd = { m_WatchFd, POLLIN, 0 };
+          if((ms <= 0) || (poll(&pfd, 1, ms) <= 0))
+            return;
+
+          // the step files are written alongside, only a change to the
+          // signal file ends the wait
+          alignas(inotify_event) char buf[4096];
+          bool updated = false;
+          ssize_t len = 0;
+          while((len = read(m_WatchFd, buf, sizeof(buf))) > 0)
+            {
+              for(char *p = buf; p < buf + len;)
+                {
+                  inotify_event *evt = reinterpret_cast<inotify_event *>(p);
+                  if(evt->len && (baseName == evt->name))
+                    updated = true;
+                  p += sizeof(inotify_event) + evt->len;
+                }
+            }
+
+          if(updated)
+            return;
+        }
+    }
+#endif
+
+  usleep(recheckMs * 1000);
+}
 
 bool PerStepStreamHandler::IsValid()
 {
@@ -561,8 +814,10 @@ bool PerStepStreamHandler::NoMoreStep()
   if(m_AllStepsWritten && (0 == (m_NumStepsWritten - m_TimeStepCounter)))
     return true;
 
-  unsigned int counter = 0;
-  unsigned int MAXWAIT = 900;
+  sensei::TimeEvent<128> mark("PerStepStreamHandler::WaitForStep");
+
+  std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() + std::chrono::seconds(900);
 
   while (true)
   {
@@ -576,11 +831,13 @@ bool PerStepStreamHandler::NoMoreStep()
     if (m_AllStepsWritten && (0 == (m_NumStepsWritten - m_TimeStepCounter)))
       return true;
 
-    sleep(1);
-
-    counter++;
-    if(counter > MAXWAIT)
+    // rank 0 decides so that every rank leaves together
+    int timedOut = (std::chrono::steady_clock::now() > deadline);
+    MPI_Bcast(&timedOut, 1, MPI_INT, 0, m_Client->m_Comm);
+    if (timedOut)
       return true;
+
+    WaitForUpdate();
   }
   return true;
 }
@@ -666,6 +923,53 @@ void BasicStream::SetCollectiveTxf()
     }
 }
 
+bool BasicStream::SetSubfiling(long long stripeSize, int stripeCount)
+{
+#if defined(H5_HAVE_SUBFILING_VFD)
+  // the I/O concentrators are threads that make MPI calls
+  int threadLevel = MPI_THREAD_SINGLE;
+  MPI_Query_thread(&threadLevel);
+  if(threadLevel < MPI_THREAD_MULTIPLE)
+    {
+      SENSEI_ERROR("Subfiling requires MPI_THREAD_MULTIPLE");
+      return false;
+    }
+
+  H5Pset_mpi_params(m_PropertyListId, m_Comm, MPI_INFO_NULL);
+
+  // start from the default configuration, which may be adjusted with the
+  // H5FD_SUBFILING_* environment variables
+  H5FD_subfiling_config_t config;
+  if(H5Pget_fapl_subfiling(m_PropertyListId, &config) < 0)
+    {
+      SENSEI_ERROR("Failed to get the subfiling configuration");
+      return false;
+    }
+
+  if(stripeSize > 0)
+    config.shared_cfg.stripe_size = stripeSize;
+
+  if(stripeCount > 0)
+    config.shared_cfg.stripe_count = stripeCount;
+
+  herr_t ierr = H5Pset_fapl_subfiling(m_PropertyListId, &config);
+  H5Pclose(config.ioc_fapl_id);
+
+  if(ierr < 0)
+    {
+      SENSEI_ERROR("Failed to enable subfiling");
+      return false;
+    }
+
+  return true;
+#else
+  (void)stripeSize;
+  (void)stripeCount;
+  SENSEI_ERROR("Subfiling requires HDF5 built with the subfiling VFD");
+  return false;
+#endif
+}
+
 BasicStream::~BasicStream()
 {
   H5Pclose(m_PropertyListId);
@@ -694,17 +998,53 @@ ReadStream::ReadStream(MPI_Comm comm, bool streaming)
 
 ReadStream::~ReadStream()
 {
+  // the datasets are closed before their file
+  CloseDatasets();
   m_Streamer->Summary();
 }
 
 bool ReadStream::AdvanceTimeStep(unsigned long &time_step, double &time)
 {
+  CloseDatasets();
   m_AllMeshInfo.Clear();
   m_AllMeshInfoReceiver.Clear();
 
   if(!m_Streamer->AdvanceStream())
     return false;
 
+  return ReadTimeStep(time_step, time);
+}
+
+bool ReadStream::SeekTimeStep(unsigned int step,
+                              unsigned long &time_step,
+                              double &time)
+{
+  CloseDatasets();
+  m_AllMeshInfo.Clear();
+  m_AllMeshInfoReceiver.Clear();
+
+  if(!m_Streamer->SeekStream(step))
+    {
+      SENSEI_ERROR("Failed to open step " << step);
+      return false;
+    }
+
+  return ReadTimeStep(time_step, time);
+}
+
+bool ReadStream::ReadTimeStep(unsigned long &time_step, double &time)
+{
+  StreamHandler::StepRecord rec;
+  if(m_Streamer->GetStepRecord(m_Streamer->m_TimeStepCounter - 1, rec))
+    {
+      time_step = rec.TimeStep;
+      time = rec.Time;
+      m_NumMeshes = rec.NumMeshes;
+      return true;
+    }
+
+  m_NumMeshes = 0;
+
   if(!ReadNativeAttr(
         senseiHDF5::ATTRNAME_TIMESTEP, &time_step, H5T_NATIVE_ULONG, -1))
     return false;
@@ -714,6 +1054,28 @@ bool ReadStream::AdvanceTimeStep(unsigned long &time_step, double &time)
   return true;
 }
 
+hid_t ReadStream::OpenDataset(const std::string &name)
+{
+  std::map<std::string, hid_t>::iterator it = m_Datasets.find(name);
+  if(it != m_Datasets.end())
+    return it->second;
+
+  hid_t varId = H5Dopen(m_Streamer->m_TimeStepId, name.c_str(), H5P_DEFAULT);
+  if(varId >= 0)
+    m_Datasets[name] = varId;
+
+  return varId;
+}
+
+void ReadStream::CloseDatasets()
+{
+  std::map<std::string, hid_t>::iterator it = m_Datasets.begin();
+  for(; it != m_Datasets.end(); ++it)
+    H5Dclose(it->second);
+
+  m_Datasets.clear();
+}
+
 bool ReadStream::ReadNativeAttr(const std::string &name,
                                 void *val,
                                 hid_t h5Type,
@@ -739,9 +1101,10 @@ bool ReadStream::ReadNativeAttr(const std::string &name,
 bool ReadStream::ReadVar1D(const std::string &name,
                            hsize_t s,
                            hsize_t c,
-                           void *data)
+                           void *data,
+                           hid_t memType)
 {
-  hid_t varId = H5Dopen(m_Streamer->m_TimeStepId, name.c_str(), H5P_DEFAULT);
+  hid_t varId = OpenDataset(name);
 
   if(varId < 0)
     {
@@ -749,7 +1112,9 @@ bool ReadStream::ReadVar1D(const std::string &name,
       return false;
     }
 
-  HDF5VarGuard g(varId);
+  HDF5VarGuard g(varId, false);
+  if(memType >= 0)
+    g.SetMemType(memType);
 
   hsize_t start[1] = { s };
   hsize_t count[1] = { c };
@@ -760,9 +1125,41 @@ bool ReadStream::ReadVar1D(const std::string &name,
   return true;
 }
 
+bool ReadStream::ReadVar1D(const std::string &name,
+                           const std::vector<hsize_t> &starts,
+                           const std::vector<hsize_t> &counts,
+                           const std::vector<hsize_t> &strides,
+                           const std::vector<void *> &data,
+                           hid_t memType)
+{
+  if(counts.empty())
+    return true;
+
+  hid_t varId = OpenDataset(name);
+
+  if(varId < 0)
+    {
+      SENSEI_ERROR("Failed to open H5 dataset: " << name);
+      return false;
+    }
+
+  HDF5VarGuard g(varId, false);
+  if(memType >= 0)
+    g.SetMemType(memType);
+
+  if(!g.ReadSpans(starts, counts, strides, data))
+    {
+      SENSEI_ERROR("Failed to read " << counts.size()
+                   << " blocks from H5 dataset: " << name);
+      return false;
+    }
+
+  return true;
+}
+
 bool ReadStream::ReadBinary(const std::string &name, sensei::BinaryStream &str)
 {
-  hid_t varID = H5Dopen(m_Streamer->m_TimeStepId, name.c_str(), H5P_DEFAULT);
+  hid_t varID = OpenDataset(name);
 
   if(varID < 0)
     {
@@ -770,7 +1167,7 @@ bool ReadStream::ReadBinary(const std::string &name, sensei::BinaryStream &str)
       return false;
     }
 
-  HDF5VarGuard g(varID);
+  HDF5VarGuard g(varID, false);
 
   hsize_t nbytes = H5Sget_simple_extent_npoints(g.m_VarSpace);
   str.Resize(nbytes);
@@ -798,7 +1195,8 @@ void ReadStream::Close() {}
 
 bool ReadStream::ReadMetadata(unsigned int &nMesh)
 {
-  if(!ReadNativeAttr(
+  nMesh = m_NumMeshes;
+  if(!nMesh && !ReadNativeAttr(
         senseiHDF5::ATTRNAME_NUM_MESH, &(nMesh), H5T_NATIVE_UINT, -1))
     return false;
 
@@ -810,12 +1208,14 @@ bool ReadStream::ReadMetadata(unsigned int &nMesh)
       std::string path;
       gGetNameStr(path, i, "meshdata");
 
-      sensei::BinaryStream bs;
-      if(!ReadBinary(path, bs))
-        return false;
+      // the step's group name is absolute, deltas refer to the dataset
+      // they were made from by its absolute path
+      char stepName[256] = {'\0'};
+      H5Iget_name(m_Streamer->m_TimeStepId, stepName, sizeof(stepName));
 
-      sensei::MeshMetadataPtr md = sensei::MeshMetadata::New();
-      md->FromStream(bs);
+      sensei::MeshMetadataPtr md;
+      if(!ReadMetadata(i, std::string(stepName) + "/" + path, md))
+        return false;
 
       // add internally generated arrays
       md->ArrayName.push_back("SenderBlockOwner");
@@ -837,6 +1237,47 @@ bool ReadStream::ReadMetadata(unsigned int &nMesh)
   return true;
 }
 
+bool ReadStream::ReadMetadata(unsigned int meshID, const std::string &path,
+                              sensei::MeshMetadataPtr &md)
+{
+  sensei::BinaryStream bs;
+  if(!ReadBinary(path, bs))
+    return false;
+
+  // a delta is decoded against the metadata it was made from, which is
+  // the last decoded when the steps are read in order. otherwise the
+  // chain is followed back to the last key frame
+  sensei::MeshMetadataPtr base;
+  if(sensei::MeshMetadata::IsDeltaStream(bs))
+    {
+      sensei::BinaryStream bps;
+      if(!ReadBinary(path + "_base", bps))
+        return false;
+
+      std::string basePath;
+      bps.Unpack(basePath);
+
+      CachedMetadata &cache = m_MetadataCache[meshID];
+      if(cache.Metadata && (cache.Path == basePath))
+        base = cache.Metadata;
+      else if(!ReadMetadata(meshID, basePath, base))
+        return false;
+    }
+
+  md = sensei::MeshMetadata::New();
+  if(md->FromStream(bs, base.get()))
+    {
+      SENSEI_ERROR("Failed to deserialize the metadata in " << path);
+      return false;
+    }
+
+  CachedMetadata &cache = m_MetadataCache[meshID];
+  cache.Path = path;
+  cache.Metadata = md->NewCopy();
+
+  return true;
+}
+
 bool ReadStream::ReadSenderMeshMetaData(unsigned int i, sensei::MeshMetadataPtr &ptr)
 {
   if(i >= m_AllMeshInfo.Size())
@@ -880,6 +1321,101 @@ bool ReadStream::ReadMesh(std::string name,
   return true;
 }
 
+bool ReadStream::ReadGeometryStep(unsigned int meshID, unsigned int &step)
+{
+  std::string meshName;
+  gGetNameStr(meshName, meshID, "");
+
+  hid_t gid = H5Gopen(m_Streamer->m_TimeStepId, meshName.c_str(), H5P_DEFAULT);
+  if(gid < 0)
+    return false;
+
+  HDF5GroupGuard g(gid);
+
+  if(H5Aexists(gid, ATTRNAME_GEOMETRY_STEP.c_str()) <= 0)
+    return false;
+
+  return ReadNativeAttr(ATTRNAME_GEOMETRY_STEP, &step, H5T_NATIVE_UINT, gid);
+}
+
+bool ReadStream::ReuseGeometry(const sensei::MeshMetadataPtr &md,
+                               unsigned int step,
+                               vtkCompositeDataSet *dobj)
+{
+  std::map<std::string, CachedGeometry>::iterator cit =
+    m_GeometryCache.find(md->MeshName);
+
+  if(cit == m_GeometryCache.end())
+    return false;
+
+  CachedGeometry &cache = cit->second;
+
+  std::vector<unsigned int> blocks;
+  for(unsigned int j = 0; j < static_cast<unsigned int>(md->NumBlocks); ++j)
+    {
+      if(md->BlockOwner[j] == m_Rank)
+        blocks.push_back(j);
+    }
+
+  if((cache.Step != step) || (cache.Blocks != blocks))
+    return false;
+
+  vtkCompositeDataIterator *it = dobj->NewIterator();
+  it->SetSkipEmptyNodes(0);
+  it->InitTraversal();
+
+  for(unsigned int j = 0, k = 0; j < static_cast<unsigned int>(md->NumBlocks); ++j)
+    {
+      if(md->BlockOwner[j] == m_Rank)
+        {
+          vtkDataSet *ds = dynamic_cast<vtkDataSet *>(it->GetCurrentDataObject());
+          if(ds)
+            ds->CopyStructure(cache.Structure[k]);
+          ++k;
+        }
+      it->GoToNextItem();
+    }
+
+  it->Delete();
+
+  return true;
+}
+
+void ReadStream::CacheGeometry(const sensei::MeshMetadataPtr &md,
+                               unsigned int step,
+                               vtkCompositeDataSet *dobj)
+{
+  CachedGeometry &cache = m_GeometryCache[md->MeshName];
+  cache.Step = step;
+  cache.Blocks.clear();
+  cache.Structure.clear();
+
+  vtkCompositeDataIterator *it = dobj->NewIterator();
+  it->SetSkipEmptyNodes(0);
+  it->InitTraversal();
+
+  for(unsigned int j = 0; j < static_cast<unsigned int>(md->NumBlocks); ++j)
+    {
+      if(md->BlockOwner[j] == m_Rank)
+        {
+          vtkSmartPointer<vtkDataSet> structure;
+
+          vtkDataSet *ds = dynamic_cast<vtkDataSet *>(it->GetCurrentDataObject());
+          if(ds)
+            {
+              structure.TakeReference(ds->NewInstance());
+              structure->CopyStructure(ds);
+            }
+
+          cache.Blocks.push_back(j);
+          cache.Structure.push_back(structure);
+        }
+      it->GoToNextItem();
+    }
+
+  it->Delete();
+}
+
 bool ReadStream::ReadInArray(const std::string &meshName,
                              int association,
                              const std::string &array_name,
@@ -1029,15 +1565,10 @@ void MeshFlow::Load(ArrayFlow *arrayFlowPtr, const sensei::MeshMetadataPtr &md,
   it->SetSkipEmptyNodes(0);
   it->InitTraversal();
 
-  for (unsigned int j = 0; j < num_blocks; ++j) {
-    if (md->BlockOwner[j] == reader->m_Rank) {
-      arrayFlowPtr->load(j, it, reader);
-    }
-    arrayFlowPtr->update(j);
-    it->GoToNextItem();
-  }
+  (void)md;
 
-  it->Delete();
+  // all of the local blocks are read together
+  arrayFlowPtr->loadAll(m_VtkPtr, reader);
 }
 
 
@@ -1085,11 +1616,22 @@ bool MeshFlow::ReadFrom(ReadStream *input, bool structure_only)
   if(structure_only)
     return true;
 
+  // the geometry of a static mesh written once is linked by later steps,
+  // the copy read then is reused
+  unsigned int geometryStep = 0;
+  bool tracked = md->StaticMesh &&
+    input->ReadGeometryStep(m_MeshID, geometryStep);
+
+  if (tracked && input->ReuseGeometry(md, geometryStep, m_VtkPtr))
+    return true;
+
   {
     vtkCompositeDataIterator *it = m_VtkPtr->NewIterator();
     it->SetSkipEmptyNodes(0);
     it->InitTraversal();
 
+    // the blocks are allocated and their reads collected, then the reads
+    // are issued together and the blocks finished
     WorkerCollection workerPool(md, m_MeshID);
     for(unsigned int j = 0; j < num_blocks; ++j)
       {
@@ -1102,14 +1644,26 @@ bool MeshFlow::ReadFrom(ReadStream *input, bool structure_only)
       }
 
     it->Delete();
+
+    if(!workerPool.build(input))
+      {
+        SENSEI_ERROR("Failed to build the blocks of mesh \""
+                     << md->MeshName << "\"");
+        return false;
+      }
   }
 
+  if (tracked)
+    input->CacheGeometry(md, geometryStep, m_VtkPtr);
+
   return true;
 }
 
-bool MeshFlow::WriteTo(WriteStream *output, const sensei::MeshMetadataPtr &md)
+bool MeshFlow::WriteTo(WriteStream *output, const sensei::MeshMetadataPtr &md,
+                       const std::vector<int> &changed, bool geometry)
 {
   unsigned int num_blocks = md->NumBlocks;
+  if (geometry)
   {
     vtkCompositeDataIterator *it = m_VtkPtr->NewIterator();
     it->SetSkipEmptyNodes(0);
@@ -1132,7 +1686,20 @@ bool MeshFlow::WriteTo(WriteStream *output, const sensei::MeshMetadataPtr &md)
     unsigned int num_arrays = md->NumArrays;
     for (unsigned int i = 0; i < num_arrays; ++i) {
       ArrayFlow arrayFlow(md, m_MeshID, i);
+
+      // an array that did not change refers to its last copy. the flags
+      // are the same on all ranks
+      std::ostringstream key;
+      key << md->MeshName << "/" << md->ArrayCentering[i] << "/"
+          << md->ArrayName[i];
+
+      bool unchanged = (i < changed.size()) && !changed[i];
+      if (unchanged &&
+          output->LinkLastWritten(key.str(), arrayFlow.GetArrayPath()))
+        continue;
+
       Unload(&arrayFlow, md, output);
+      output->SetLastWritten(key.str(), arrayFlow.GetArrayPath());
     }
   }
 
@@ -1155,22 +1722,11 @@ void MeshFlow::Unload(ArrayFlow *arrayFlowPtr,
                       const sensei::MeshMetadataPtr &md, 
 		      WriteStream *output) 
 {
-  unsigned int num_blocks = md->NumBlocks;
-
-  vtkCompositeDataIterator *it = m_VtkPtr->NewIterator();
-  it->SetSkipEmptyNodes(0);
-  it->InitTraversal();
-
-  // ArrayFlow arrayFlow(md, m_MeshID, i);
-  for (unsigned int j = 0; j < num_blocks; ++j) {
-    if (output->m_Rank == md->BlockOwner[j]) {
-      arrayFlowPtr->unload(j, it, output);
-    }
-    arrayFlowPtr->update(j);
-    it->GoToNextItem();
-  }
+  (void)md;
 
-  it->Delete();
+  // all of the local blocks are written together, in one collective call
+  // when collective transfers are enabled
+  arrayFlowPtr->unloadAll(m_VtkPtr, output);
 }
 
 //
@@ -1254,6 +1810,16 @@ bool WorkerCollection::update(unsigned int block_id)
     }
   return true;
 }
+
+bool WorkerCollection::build(ReadStream *input)
+{
+  for(size_t i = 0; i < m_Workers.size(); i++)
+    {
+      if(!m_Workers[i]->build(input))
+        return false;
+    }
+  return true;
+}
 //
 //
 //
@@ -1334,12 +1900,14 @@ bool ArrayFlow::load(unsigned int block_id,
   uint64_t count = num_elem_local;
   ;
 
-  vtkDataArray *array = vtkDataArray::CreateDataArray(GetArrayType());
-  array->SetNumberOfComponents(m_NumArrayComponent);
+  // the buffer is reused in later steps
+  vtkDataArray *array = sensei::BufferPool::NewDataArray(GetArrayType(),
+    m_NumArrayComponent, num_elem_local / m_NumArrayComponent);
   array->SetName(GetArrayName().c_str());
-  array->SetNumberOfTuples(num_elem_local);
 
-  if(!reader->ReadVar1D(m_ArrayPath, start, count, array->GetVoidPointer(0)))
+  // arrays stored at reduced precision are converted back by HDF5
+  if(!reader->ReadVar1D(m_ArrayPath, start, count, array->GetVoidPointer(0),
+                        gVTKToH5Type(GetArrayType())))
     return false;
 
   // pass to vtk
@@ -1362,6 +1930,111 @@ bool ArrayFlow::load(unsigned int block_id,
   return true;
 }
 
+bool ArrayFlow::loadAll(vtkCompositeDataSet *dobj, ReadStream *reader)
+{
+  unsigned int num_blocks = m_Metadata->NumBlocks;
+
+  // a structure of arrays is read one component at a time, selecting the
+  // component's interleaved positions with a stride
+  bool soa = reader->m_StructureOfArrays && (m_NumArrayComponent > 1);
+  std::vector<std::vector<void *>> comps;
+
+  std::vector<hsize_t> starts;
+  std::vector<hsize_t> counts;
+  std::vector<void *> data;
+
+  vtkCompositeDataIterator *it = dobj->NewIterator();
+  it->SetSkipEmptyNodes(0);
+  it->InitTraversal();
+
+  // allocate the blocks assigned to this rank by the partitioner and
+  // collect their position in the dataset
+  for(unsigned int j = 0; j < num_blocks; ++j)
+    {
+      if(m_Metadata->BlockOwner[j] == reader->m_Rank)
+        {
+          vtkDataSet *ds = dynamic_cast<vtkDataSet *>(it->GetCurrentDataObject());
+          if(!ds)
+            {
+              SENSEI_ERROR("Failed to get block " << j << " rank"
+                           << reader->m_Rank);
+              it->Delete();
+              return false;
+            }
+
+          unsigned long long num_tuples_local = getLocalElement(j);
+
+          std::vector<void *> blockComps;
+          vtkDataArray *array = nullptr;
+          if(soa)
+            array = sensei::VTKUtils::NewSOAArray(GetArrayType(),
+              m_NumArrayComponent, num_tuples_local, blockComps);
+
+          if(array)
+            {
+              comps.push_back(blockComps);
+              starts.push_back(m_BlockOffset);
+              counts.push_back(num_tuples_local);
+            }
+          else
+            {
+              // generic arrays are not available, fall back to interleaved
+              soa = false;
+
+              // the buffer is reused in later steps
+              array = sensei::BufferPool::NewDataArray(GetArrayType(),
+                m_NumArrayComponent, num_tuples_local);
+
+              starts.push_back(m_BlockOffset);
+              counts.push_back(m_NumArrayComponent * num_tuples_local);
+              data.push_back(array->GetVoidPointer(0));
+            }
+
+          array->SetName(GetArrayName().c_str());
+
+          vtkDataSetAttributes *dsa =
+            (m_ArrayCenter == vtkDataObject::POINT)
+            ? dynamic_cast<vtkDataSetAttributes *>(ds->GetPointData())
+            : dynamic_cast<vtkDataSetAttributes *>(ds->GetCellData());
+
+          dsa->AddArray(array);
+          array->Delete();
+        }
+
+      update(j);
+      it->GoToNextItem();
+    }
+
+  it->Delete();
+
+  // arrays stored at reduced precision are converted back by HDF5
+  hid_t memType = gVTKToH5Type(GetArrayType());
+
+  if(!soa)
+    return reader->ReadVar1D(m_ArrayPath, starts, counts,
+                             std::vector<hsize_t>(), data, memType);
+
+  size_t nLocal = comps.size();
+  std::vector<hsize_t> strides(nLocal, m_NumArrayComponent);
+  std::vector<hsize_t> compStarts(nLocal);
+  data.resize(nLocal);
+
+  for(unsigned long long c = 0; c < m_NumArrayComponent; ++c)
+    {
+      for(size_t j = 0; j < nLocal; ++j)
+        {
+          compStarts[j] = starts[j] + c;
+          data[j] = comps[j][c];
+        }
+
+      if(!reader->ReadVar1D(m_ArrayPath, compStarts, counts, strides, data,
+                            memType))
+        return false;
+    }
+
+  return true;
+}
+
 bool ArrayFlow::unload(unsigned int block_id,
                        vtkCompositeDataIterator *it,
                        WriteStream *output)
@@ -1404,7 +2077,130 @@ bool ArrayFlow::unload(unsigned int block_id,
                    m_ArrayPath,
                    arraySpace,
                    h5TypeCurrArray,
-                   da->GetVoidPointer(0));
+                   da->GetVoidPointer(0),
+                   output->GetFileType(m_Metadata->MeshName, m_ArrayCenter,
+                                       GetArrayName(), h5TypeCurrArray));
+
+  return true;
+}
+
+bool ArrayFlow::unloadAll(vtkCompositeDataSet *dobj, WriteStream *output)
+{
+  unsigned int num_blocks = m_Metadata->NumBlocks;
+
+  // the position, size, and the array of each local block
+  std::vector<hsize_t> offsets;
+  std::vector<hsize_t> tuples;
+  std::vector<vtkDataArray *> arrays;
+
+  hsize_t maxBlock = 0;
+
+  vtkCompositeDataIterator *it = dobj->NewIterator();
+  it->SetSkipEmptyNodes(0);
+  it->InitTraversal();
+
+  for(unsigned int j = 0; j < num_blocks; ++j)
+    {
+      unsigned long long num_elem_local =
+        m_NumArrayComponent * getLocalElement(j);
+
+      maxBlock = std::max(maxBlock, hsize_t(num_elem_local));
+
+      if(output->m_Rank == m_Metadata->BlockOwner[j])
+        {
+          vtkDataSet *ds = dynamic_cast<vtkDataSet *>(it->GetCurrentDataObject());
+          if(!ds)
+            {
+              SENSEI_ERROR("Failed to get block " << j);
+              it->Delete();
+              return false;
+            }
+
+          vtkDataSetAttributes *dsa =
+            m_ArrayCenter == vtkDataObject::POINT
+            ? dynamic_cast<vtkDataSetAttributes *>(ds->GetPointData())
+            : dynamic_cast<vtkDataSetAttributes *>(ds->GetCellData());
+
+          vtkDataArray *da = dsa->GetArray(GetArrayName().c_str());
+          if(!da)
+            {
+              SENSEI_ERROR("Failed to get array \"" << GetArrayName()
+                           << "\"");
+              it->Delete();
+              return false;
+            }
+
+          offsets.push_back(m_BlockOffset);
+          tuples.push_back(getLocalElement(j));
+          arrays.push_back(da);
+        }
+
+      update(j);
+      it->GoToNextItem();
+    }
+
+  it->Delete();
+
+  // a structure of arrays is written one component at a time directly from
+  // its component buffers, each into its interleaved positions selected
+  // with a stride. the calls are collective, so every rank makes one per
+  // component even when its blocks are interleaved, those are written
+  // entirely by the first call.
+  unsigned long long nPasses = 1;
+  if(m_NumArrayComponent > 1)
+    nPasses = m_NumArrayComponent;
+
+  size_t nLocal = arrays.size();
+  std::vector<std::vector<void *>> comps(nLocal);
+  std::vector<bool> soa(nLocal);
+  for(size_t j = 0; j < nLocal; ++j)
+    soa[j] = (nPasses > 1) &&
+      !sensei::VTKUtils::GetComponentPointers(arrays[j], comps[j]);
+
+  // the values are converted by HDF5 when the array is stored at reduced
+  // precision
+  hid_t memType = gVTKToH5Type(GetArrayType());
+  hid_t fileType = output->GetFileType(m_Metadata->MeshName, m_ArrayCenter,
+                                       GetArrayName(), memType);
+
+  for(unsigned long long c = 0; c < nPasses; ++c)
+    {
+      std::vector<hsize_t> starts;
+      std::vector<hsize_t> counts;
+      std::vector<hsize_t> strides;
+      std::vector<void *> data;
+
+      for(size_t j = 0; j < nLocal; ++j)
+        {
+          if(soa[j])
+            {
+              starts.push_back(offsets[j] + c);
+              counts.push_back(tuples[j]);
+              strides.push_back(m_NumArrayComponent);
+              data.push_back(comps[j][c]);
+            }
+          else if(c == 0)
+            {
+              starts.push_back(offsets[j]);
+              counts.push_back(m_NumArrayComponent * tuples[j]);
+              strides.push_back(1);
+              data.push_back(arrays[j]->GetVoidPointer(0));
+            }
+        }
+
+      // chunks are aligned to the blocks
+      if(!output->WriteBlocks(m_ArrayVarID,
+                              m_ArrayPath,
+                              m_ElementTotal,
+                              starts,
+                              counts,
+                              strides,
+                              data,
+                              memType,
+                              maxBlock,
+                              fileType))
+        return false;
+    }
 
   return true;
 }
@@ -1443,148 +2239,63 @@ bool PolydataCellFlow::load(unsigned int block_id,
                             vtkCompositeDataIterator *it,
                             ReadStream *reader)
 {
-  // /data_object_<id>/cell_types
-  unsigned long long cell_array_size_local =
-    m_Metadata->BlockCellArraySize[block_id];
-  unsigned long long num_cells_local = m_Metadata->BlockNumCells[block_id];
-
-  std::vector<vtkIdType> cell_array(cell_array_size_local);
-  std::vector<unsigned char> cell_types(num_cells_local);
-
-  uint64_t ct_start = m_CellTypesBlockOffset;
-  uint64_t ct_count = num_cells_local;
-  if(!reader->ReadVar1D(
-        m_CellTypeVarName, ct_start, ct_count, cell_types.data()))
-    return false;
-
-  uint64_t ca_start = m_CellArrayBlockOffset;
-  uint64_t ca_count = cell_array_size_local;
-  ;
-  if(!reader->ReadVar1D(
-        m_CellArrayVarName, ca_start, ca_count, cell_array.data()))
-    return false;
-
-  unsigned char *p_types = cell_types.data();
-  vtkIdType *p_cells = cell_array.data();
-
-  // find first and last vert and number of verts
-  unsigned long i = 0;
-  unsigned long n_verts = 0;
-  vtkIdType *vert_begin = p_cells;
-  while((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
-    {
-      p_cells += p_cells[0] + 1;
-      ++n_verts;
-      ++i;
-    }
-  vtkIdType *vert_end = p_cells;
-
-  // find first and last line and number of lines
-  unsigned long n_lines = 0;
-  vtkIdType *line_begin = p_cells;
-  while((i < num_cells_local) && (p_types[i] == VTK_LINE))
-    {
-      p_cells += p_cells[0] + 1;
-      ++n_lines;
-      ++i;
-    }
-  vtkIdType *line_end = p_cells;
-
-  // find first and last poly and number of polys
-  unsigned long n_polys = 0;
-  vtkIdType *poly_begin = p_cells;
-  while((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
-    {
-      p_cells += p_cells[0] + 1;
-      ++n_polys;
-      ++i;
-    }
-  vtkIdType *poly_end = p_cells;
-
-  // find first and last strip and number of strips
-  unsigned long n_strips = 0;
-  vtkIdType *strip_begin = p_cells;
-  while((i < num_cells_local) && (p_types[i] == VTK_VERTEX))
-    {
-      p_cells += p_cells[0] + 1;
-      ++n_strips;
-      ++i;
-    }
-  vtkIdType *strip_end = p_cells;
-
-  // pass into vtk
   vtkPolyData *pd = dynamic_cast<vtkPolyData *>(it->GetCurrentDataObject());
   if(!pd)
     {
-      SENSEI_ERROR("Failed to get block " << block_id);
-      return -1;
+      SENSEI_ERROR("Failed to get block " << block_id << " rank"
+                   << reader->m_Rank);
+      return false;
     }
 
-  // pass verts
-  unsigned long n_tups = vert_end - vert_begin;
-  vtkIdTypeArray *verts = vtkIdTypeArray::New();
-  verts->SetNumberOfTuples(n_tups);
-  vtkIdType *p_verts = verts->GetPointer(0);
-
-  for(unsigned long j = 0; j < n_tups; ++j)
-    p_verts[j] = vert_begin[j];
-
-  vtkCellArray *ca = vtkCellArray::New();
-  ca->SetCells(n_verts, verts);
-  verts->Delete();
-
-  pd->SetVerts(ca);
-  ca->Delete();
-
-  // pass lines
-  n_tups = line_end - line_begin;
-  vtkIdTypeArray *lines = vtkIdTypeArray::New();
-  lines->SetNumberOfTuples(n_tups);
-  vtkIdType *p_lines = lines->GetPointer(0);
-
-  for(unsigned long j = 0; j < n_tups; ++j)
-    p_lines[j] = line_begin[j];
-
-  ca = vtkCellArray::New();
-  ca->SetCells(n_lines, lines);
-  lines->Delete();
-
-  pd->SetLines(ca);
-  ca->Delete();
-
-  // pass polys
-  n_tups = poly_end - poly_begin;
-  vtkIdTypeArray *polys = vtkIdTypeArray::New();
-  polys->SetNumberOfTuples(n_tups);
-  vtkIdType *p_polys = polys->GetPointer(0);
-
-  for(unsigned long j = 0; j < n_tups; ++j)
-    p_polys[j] = poly_begin[j];
+  // the cells are read by build
+  m_Blocks.push_back(pd);
+  m_Types.emplace_back(m_Metadata->BlockNumCells[block_id]);
+  m_Cells.emplace_back(m_Metadata->BlockCellArraySize[block_id]);
+  m_TypeStarts.push_back(m_CellTypesBlockOffset);
+  m_CellStarts.push_back(m_CellArrayBlockOffset);
 
-  ca = vtkCellArray::New();
-  ca->SetCells(n_polys, polys);
-  polys->Delete();
-
-  pd->SetPolys(ca);
-  ca->Delete();
-
-  // pass strips
-  n_tups = strip_end - strip_begin;
-  vtkIdTypeArray *strips = vtkIdTypeArray::New();
-  strips->SetNumberOfTuples(n_tups);
-  vtkIdType *p_strips = strips->GetPointer(0);
+  return true;
+}
 
-  for(unsigned long j = 0; j < n_tups; ++j)
-    p_strips[j] = strip_begin[j];
+bool PolydataCellFlow::build(ReadStream *reader)
+{
+  size_t nLocal = m_Blocks.size();
+  if(nLocal == 0)
+    return true;
 
-  ca = vtkCellArray::New();
-  ca->SetCells(n_strips, strips);
-  strips->Delete();
+  std::vector<hsize_t> typeCounts(nLocal);
+  std::vector<hsize_t> cellCounts(nLocal);
+  std::vector<void *> types(nLocal);
+  std::vector<void *> cells(nLocal);
+  for(size_t j = 0; j < nLocal; ++j)
+    {
+      typeCounts[j] = m_Types[j].size();
+      cellCounts[j] = m_Cells[j].size();
+      types[j] = m_Types[j].data();
+      cells[j] = m_Cells[j].data();
+    }
 
-  pd->SetStrips(ca);
-  ca->Delete();
+  // /data_object_<id>/cell_types
+  // /data_object_<id>/cell_array
+  if(!reader->ReadVar1D(m_CellTypeVarName, m_TypeStarts, typeCounts,
+                        std::vector<hsize_t>(), types) ||
+      !reader->ReadVar1D(m_CellArrayVarName, m_CellStarts, cellCounts,
+                         std::vector<hsize_t>(), cells))
+    return false;
 
-  pd->BuildCells();
+  // pass into vtk, each block's cell arrays are assembled on its own
+  // thread
+  if(sensei::TaskRuntime::ParallelFor(nLocal, reader->m_NumberOfThreads,
+      [&](int, long j) -> int
+      {
+        return sensei::VTKUtils::SetPolydataCells(m_Blocks[j],
+          m_Types[j].data(), m_Cells[j].data(), m_Types[j].size()) ? -1 : 0;
+      }))
+    {
+      SENSEI_ERROR("Failed to set the cells of mesh \""
+                   << m_Metadata->MeshName << "\"");
+      return false;
+    }
 
   return true;
 }
@@ -1691,79 +2402,133 @@ UnstructuredCellFlow::UnstructuredCellFlow(const sensei::MeshMetadataPtr &md,
   : VTKObjectFlow(md, meshID)
 {
   m_CellTypesBlockOffset = 0;
-  m_CellArrayBlockOffset = 0;
+  m_CellOffsetBlockOffset = 0;
+  m_CellConnBlockOffset = 0;
+
+  gGetNameStr(m_CellOffsetVarName, m_MeshID, "cell_offsets");
+  gGetNameStr(m_CellConnVarName, m_MeshID, "cell_connectivity");
+
+  if (md->NumBlocks != static_cast<long>(md->BlockCellArraySize.size()))
+    {
+      return;
+    }
+
+  m_Use32 = sensei::VTKUtils::CellIndices32(md);
+  m_IndexType = m_Use32 ? H5T_NATIVE_INT32 : H5T_NATIVE_INT64;
+
+  // the cell array size is that of the legacy layout, which has a count
+  // per cell
+  m_TotalOffsets = m_TotalCell + md->NumBlocks;
+  m_TotalConn = m_TotalArraySize - m_TotalCell;
+}
+
+UnstructuredCellFlow::~UnstructuredCellFlow()
+{
+  if(-1 != m_CellOffsetVarID)
+    H5Dclose(m_CellOffsetVarID);
+
+  if(-1 != m_CellConnVarID)
+    H5Dclose(m_CellConnVarID);
 }
 
 bool UnstructuredCellFlow::load(unsigned int block_id,
                                 vtkCompositeDataIterator *it,
                                 ReadStream *reader)
 {
-  // /data_object_<id>/cell_types
-  unsigned long long cell_array_size_local =
-    m_Metadata->BlockCellArraySize[block_id];
   unsigned long long num_cells_local = m_Metadata->BlockNumCells[block_id];
-  uint64_t ct_start = m_CellTypesBlockOffset;
-  uint64_t ct_count = num_cells_local;
+  unsigned long long conn_size_local =
+    m_Metadata->BlockCellArraySize[block_id] - num_cells_local;
+
+  vtkUnstructuredGrid *ds =
+    dynamic_cast<vtkUnstructuredGrid *>(it->GetCurrentDataObject());
+
+  if(!ds)
+    {
+      SENSEI_ERROR("Failed to get block " << block_id << " rank"
+                   << reader->m_Rank);
+      return false;
+    }
 
+  // /data_object_<id>/cell_types
   vtkUnsignedCharArray *cell_types = vtkUnsignedCharArray::New();
   cell_types->SetNumberOfComponents(1);
-  cell_types->SetNumberOfTuples(ct_count);
+  cell_types->SetNumberOfTuples(num_cells_local);
   cell_types->SetName("cell_types");
 
-  if(!reader->ReadVar1D(
-        m_CellTypeVarName, ct_start, ct_count, cell_types->GetVoidPointer(0)))
-    return false;
+  // the offsets and connectivity are read directly into the cell array's
+  // storage
+  vtkDataArray *cell_offsets = nullptr;
+  vtkDataArray *cell_conn = nullptr;
+  sensei::VTKUtils::NewCellArrays(
+    m_Use32, num_cells_local, conn_size_local, cell_offsets, cell_conn);
+
+  // the cells are read by build
+  m_Blocks.push_back(ds);
+  m_Types.push_back(vtkSmartPointer<vtkUnsignedCharArray>::Take(cell_types));
+  m_Offsets.push_back(vtkSmartPointer<vtkDataArray>::Take(cell_offsets));
+  m_Conns.push_back(vtkSmartPointer<vtkDataArray>::Take(cell_conn));
+  m_TypeStarts.push_back(m_CellTypesBlockOffset);
+  m_OffsetStarts.push_back(m_CellOffsetBlockOffset);
+  m_ConnStarts.push_back(m_CellConnBlockOffset);
 
-  // /data_object_<id>/cell_array
-  uint64_t ca_start = m_CellArrayBlockOffset;
-  uint64_t ca_count = cell_array_size_local;
-  ;
+  return true;
+}
 
-  vtkIdTypeArray *cell_array = vtkIdTypeArray::New();
-  cell_array->SetNumberOfComponents(1);
-  cell_array->SetNumberOfTuples(cell_array_size_local);
-  cell_array->SetName("cell_array");
+bool UnstructuredCellFlow::build(ReadStream *reader)
+{
+  size_t nLocal = m_Blocks.size();
+  if(nLocal == 0)
+    return true;
 
-  if(!reader->ReadVar1D(
-        m_CellArrayVarName, ca_start, ca_count, cell_array->GetVoidPointer(0)))
+  std::vector<hsize_t> typeCounts(nLocal);
+  std::vector<hsize_t> offsetCounts(nLocal);
+  std::vector<hsize_t> connCounts(nLocal);
+  std::vector<void *> types(nLocal);
+  std::vector<void *> offsets(nLocal);
+  std::vector<void *> conns(nLocal);
+  for(size_t j = 0; j < nLocal; ++j)
+    {
+      typeCounts[j] = m_Types[j]->GetNumberOfTuples();
+      offsetCounts[j] = m_Offsets[j]->GetNumberOfTuples();
+      connCounts[j] = m_Conns[j]->GetNumberOfTuples();
+      types[j] = m_Types[j]->GetVoidPointer(0);
+      offsets[j] = m_Offsets[j]->GetVoidPointer(0);
+      conns[j] = m_Conns[j]->GetVoidPointer(0);
+    }
+
+  if(!reader->ReadVar1D(m_CellTypeVarName, m_TypeStarts, typeCounts,
+                        std::vector<hsize_t>(), types) ||
+      !reader->ReadVar1D(m_CellOffsetVarName, m_OffsetStarts, offsetCounts,
+                         std::vector<hsize_t>(), offsets) ||
+      !reader->ReadVar1D(m_CellConnVarName, m_ConnStarts, connCounts,
+                         std::vector<hsize_t>(), conns))
     return false;
 
-  vtkUnstructuredGrid *ds =
-    dynamic_cast<vtkUnstructuredGrid *>(it->GetCurrentDataObject());
-
-  if(!ds)
+  // pass types, offsets, and connectivity. each block's cell array is
+  // assembled on its own thread
+  if(sensei::TaskRuntime::ParallelFor(nLocal, reader->m_NumberOfThreads,
+      [&](int, long j) -> int
+      {
+        return sensei::VTKUtils::SetCells(m_Blocks[j], m_Types[j],
+          m_Offsets[j], m_Conns[j]) ? -1 : 0;
+      }))
     {
-      SENSEI_ERROR("Failed to get block " << block_id);
-      return -1;
+      SENSEI_ERROR("Failed to set the cells of mesh \""
+                   << m_Metadata->MeshName << "\"");
+      return false;
     }
-  // build locations
-  vtkIdTypeArray *cell_locs = vtkIdTypeArray::New();
-  cell_locs->SetNumberOfTuples(m_Metadata->BlockNumCells[block_id]);
-  vtkIdType *p_locs = cell_locs->GetPointer(0);
-  vtkIdType *p_cells = cell_array->GetPointer(0);
-  p_locs[0] = 0;
-  for(unsigned long i = 1; i < num_cells_local; ++i)
-    p_locs[i] = p_locs[i - 1] + p_cells[p_locs[i - 1]] + 1;
-
-  // pass types, cell_locs, and cells
-  vtkCellArray *ca = vtkCellArray::New();
-  ca->SetCells(num_cells_local, cell_array);
-  cell_array->Delete();
-
-  ds->SetCells(cell_types, cell_locs, ca);
-
-  cell_locs->Delete();
-  cell_array->Delete();
-  cell_types->Delete();
 
   return true;
 }
 
 bool UnstructuredCellFlow::update(unsigned int block_id)
 {
-  m_CellTypesBlockOffset += m_Metadata->BlockNumCells[block_id];
-  ;
-  m_CellArrayBlockOffset += m_Metadata->BlockCellArraySize[block_id];
+  unsigned long long num_cells_local = m_Metadata->BlockNumCells[block_id];
+
+  m_CellTypesBlockOffset += num_cells_local;
+  m_CellOffsetBlockOffset += num_cells_local + 1;
+  m_CellConnBlockOffset +=
+    m_Metadata->BlockCellArraySize[block_id] - num_cells_local;
 
   return true;
 }
@@ -1772,12 +2537,11 @@ bool UnstructuredCellFlow::unload(unsigned int block_id,
                                   vtkCompositeDataIterator *it,
                                   WriteStream *output)
 {
-  hid_t h5TypeCellArray = senseiHDF5::gHDF5_IDType();
   hid_t h5TypeCellType = H5T_NATIVE_CHAR;
 
   unsigned long long num_cells_local = m_Metadata->BlockNumCells[block_id];
-  unsigned long long cell_array_size_local =
-    m_Metadata->BlockCellArraySize[block_id];
+  unsigned long long conn_size_local =
+    m_Metadata->BlockCellArraySize[block_id] - num_cells_local;
 
   vtkUnstructuredGrid *ds =
     dynamic_cast<vtkUnstructuredGrid *>(it->GetCurrentDataObject());
@@ -1788,13 +2552,32 @@ bool UnstructuredCellFlow::unload(unsigned int block_id,
       return false;
     }
 
-  HDF5SpaceGuard cellArraySpace(
-    m_TotalArraySize, m_CellArrayBlockOffset, cell_array_size_local);
-  output->WriteVar(m_CellArrayVarID,
-                   m_CellArrayVarName,
-                   cellArraySpace,
-                   h5TypeCellArray,
-                   ds->GetCells()->GetData()->GetVoidPointer(0));
+  // the offsets and connectivity, without a copy when the cell array's
+  // storage has the stream's index type
+  vtkDataArray *cell_offsets = nullptr;
+  vtkDataArray *cell_conn = nullptr;
+  if(sensei::VTKUtils::GetCellArrays(
+       ds->GetCells(), m_Use32, cell_offsets, cell_conn))
+    {
+      SENSEI_ERROR("Failed to get the cells of block " << block_id);
+      return false;
+    }
+
+  HDF5SpaceGuard cellOffsetSpace(
+    m_TotalOffsets, m_CellOffsetBlockOffset, num_cells_local + 1);
+  output->WriteVar(m_CellOffsetVarID,
+                   m_CellOffsetVarName,
+                   cellOffsetSpace,
+                   m_IndexType,
+                   cell_offsets->GetVoidPointer(0));
+
+  HDF5SpaceGuard cellConnSpace(
+    m_TotalConn, m_CellConnBlockOffset, conn_size_local);
+  output->WriteVar(m_CellConnVarID,
+                   m_CellConnVarName,
+                   cellConnSpace,
+                   m_IndexType,
+                   cell_conn->GetVoidPointer(0));
 
   HDF5SpaceGuard cellTypeSpace(
     m_TotalCell, m_CellTypesBlockOffset, num_cells_local);
@@ -1804,6 +2587,9 @@ bool UnstructuredCellFlow::unload(unsigned int block_id,
                    h5TypeCellType,
                    ds->GetCellTypesArray()->GetVoidPointer(0));
 
+  cell_offsets->Delete();
+  cell_conn->Delete();
+
   return true;
 }
 
@@ -1879,12 +2665,10 @@ bool PointFlow::load(unsigned int block_id,
   points->SetNumberOfTuples(m_Metadata->BlockNumPoints[block_id]);
   points->SetName("points");
 
-  // std::string path = ons + "points";
-  // std::string path;
-
-  if(!reader->ReadVar1D(
-        m_PointVarName, start, count, points->GetVoidPointer(0)))
-    return false;
+  // the points are read by build
+  m_Starts.push_back(start);
+  m_Counts.push_back(count);
+  m_Data.push_back(points->GetVoidPointer(0));
 
   // pass into vtk
   vtkPoints *pts = vtkPoints::New();
@@ -1894,8 +2678,10 @@ bool PointFlow::load(unsigned int block_id,
   vtkPointSet *ds = dynamic_cast<vtkPointSet *>(it->GetCurrentDataObject());
   if(!ds)
     {
-      SENSEI_ERROR("Failed to get block " << block_id);
-      return -1;
+      SENSEI_ERROR("Failed to get block " << block_id << " rank"
+                   << reader->m_Rank);
+      pts->Delete();
+      return false;
     }
 
   ds->SetPoints(pts);
@@ -1904,6 +2690,12 @@ bool PointFlow::load(unsigned int block_id,
   return true;
 }
 
+bool PointFlow::build(ReadStream *reader)
+{
+  return reader->ReadVar1D(m_PointVarName, m_Starts, m_Counts,
+                           std::vector<hsize_t>(), m_Data);
+}
+
 bool PointFlow::unload(unsigned int block_id,
                        vtkCompositeDataIterator *it,
                        WriteStream *output)
@@ -2336,22 +3128,214 @@ hid_t WriteStream::CreateVar(const std::string &name,
                              const HDF5SpaceGuard &space,
                              hid_t h5Type)
 {
+  hsize_t global = H5Sget_simple_extent_npoints(space.m_FileSpaceID);
+  hsize_t chunk = H5Sget_simple_extent_npoints(space.m_MemSpaceID);
+
+  return CreateVar(name, global, h5Type, chunk, false);
+}
+
+hid_t WriteStream::CreateVar(const std::string &name,
+                             hsize_t global,
+                             hid_t h5Type,
+                             hsize_t chunk,
+                             bool filtered)
+{
+  hid_t fileSpace = H5Screate_simple(1, &global, NULL);
+
+  // chunked layout, filters require it
+  hid_t dcpl = H5P_DEFAULT;
+  bool useFilter = filtered && (m_Filter != H5Z_FILTER_NONE);
+  if(((m_ChunkSize != 0) || useFilter) && (global > 0))
+    {
+      if(m_ChunkSize > 0)
+        chunk = m_ChunkSize;
+
+      chunk = std::max(std::min(chunk, global), hsize_t(1));
+
+      dcpl = H5Pcreate(H5P_DATASET_CREATE);
+      H5Pset_chunk(dcpl, 1, &chunk);
+
+      if(useFilter)
+        {
+          // parallel writes of filtered datasets require space to be
+          // allocated up front
+          if(m_Size > 1)
+            H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_EARLY);
+
+          if(m_Filter == H5Z_FILTER_SCALEOFFSET)
+            {
+              // floating point values are quantized to the given number of
+              // decimal digits, integers are packed without loss
+              if(H5Tget_class(h5Type) == H5T_FLOAT)
+                H5Pset_scaleoffset(dcpl, H5Z_SO_FLOAT_DSCALE, m_FilterLevel);
+              else
+                H5Pset_scaleoffset(dcpl, H5Z_SO_INT, H5Z_SO_INT_MINBITS_DEFAULT);
+            }
+          else if(m_Filter == SENSEI_H5Z_FILTER_BLOSC)
+            {
+              // the first four values are filled in by the plugin. the
+              // compressor is lz4, blosc shuffles bytes itself
+              unsigned int cdValues[7] = {0, 0, 0, 0, m_FilterLevel,
+                m_Shuffle ? 1u : 0u, 1};
+
+              H5Pset_filter(dcpl, m_Filter, H5Z_FLAG_OPTIONAL, 7, cdValues);
+            }
+          else
+            {
+              // byte shuffling groups the bytes of like significance,
+              // which compress better
+              if(m_Shuffle)
+                H5Pset_shuffle(dcpl);
+
+              if(m_Filter == H5Z_FILTER_DEFLATE)
+                H5Pset_deflate(dcpl, m_FilterLevel);
+              else
+                H5Pset_filter(dcpl, m_Filter, H5Z_FLAG_OPTIONAL, 1, &m_FilterLevel);
+            }
+        }
+    }
+
   hid_t varID = H5Dcreate(m_Streamer->m_TimeStepId,
                           name.c_str(),
                           h5Type,
-                          space.m_FileSpaceID,
-                          H5P_DEFAULT,
+                          fileSpace,
                           H5P_DEFAULT,
+                          dcpl,
                           H5P_DEFAULT);
 
+  if(dcpl != H5P_DEFAULT)
+    H5Pclose(dcpl);
+
+  H5Sclose(fileSpace);
+
   return varID;
 }
 
+bool WriteStream::SetFilter(const std::string &name, int level)
+{
+  H5Z_filter_t filter = H5Z_FILTER_NONE;
+
+  if(name == "none")
+    {
+      filter = H5Z_FILTER_NONE;
+    }
+  else if(name == "deflate")
+    {
+      filter = H5Z_FILTER_DEFLATE;
+    }
+  else if(name == "zstd")
+    {
+      // registered id of the zstd filter plugin
+      filter = 32015;
+    }
+  else if(name == "blosc")
+    {
+      filter = SENSEI_H5Z_FILTER_BLOSC;
+    }
+  else if(name == "scaleoffset")
+    {
+      filter = H5Z_FILTER_SCALEOFFSET;
+    }
+  else
+    {
+      SENSEI_ERROR("Invalid filter \"" << name << "\". Valid values are"
+                   " none, deflate, zstd, blosc, and scaleoffset");
+      return false;
+    }
+
+  if((filter != H5Z_FILTER_NONE) && (H5Zfilter_avail(filter) <= 0))
+    {
+      SENSEI_ERROR("The HDF5 " << name << " filter is not available. Check"
+                   " that HDF5_PLUGIN_PATH points to the filter plugin");
+      return false;
+    }
+
+  if((filter != H5Z_FILTER_NONE) && (m_Size > 1))
+    {
+#if H5_VERSION_GE(1, 10, 2)
+      // parallel compression requires collective transfers
+      if(H5P_DEFAULT == m_CollectiveTxf)
+        SetCollectiveTxf();
+#else
+      SENSEI_ERROR("Parallel compression requires HDF5 1.10.2 or later");
+      return false;
+#endif
+    }
+
+  m_Filter = filter;
+  m_FilterLevel = level;
+
+  return true;
+}
+
+void WriteStream::SetMPIHints(int cbNodes,
+                              long long cbBufferSize,
+                              long long alignment)
+{
+  if((cbNodes <= 0) && (cbBufferSize <= 0) && (alignment <= 0))
+    return;
+
+  MPI_Info info = MPI_INFO_NULL;
+
+  if((cbNodes > 0) || (cbBufferSize > 0))
+    {
+      MPI_Info_create(&info);
+      MPI_Info_set(info, "romio_cb_write", "enable");
+
+      if(cbNodes > 0)
+        MPI_Info_set(info, "cb_nodes", std::to_string(cbNodes).c_str());
+
+      if(cbBufferSize > 0)
+        MPI_Info_set(info,
+                     "cb_buffer_size",
+                     std::to_string(cbBufferSize).c_str());
+    }
+
+  H5Pset_fapl_mpio(m_PropertyListId, m_Comm, info);
+
+  if(info != MPI_INFO_NULL)
+    MPI_Info_free(&info);
+
+  // align objects larger than the alignment, typically the file system
+  // stripe size, on multiples of it
+  if(alignment > 0)
+    H5Pset_alignment(m_PropertyListId, alignment, alignment);
+}
+
+hid_t WriteStream::GetFileType(const std::string &meshName,
+                               int association,
+                               const std::string &arrayName,
+                               hid_t memType)
+{
+  int precision = m_Precision.GetArrayPrecision(meshName, association, arrayName);
+
+  if((precision == sensei::DataRequirements::PRECISION_NATIVE) ||
+     (H5Tget_class(memType) != H5T_FLOAT))
+    return memType;
+
+  if(precision == sensei::DataRequirements::PRECISION_FLOAT32)
+    return H5Tget_size(memType) > 4 ? H5T_IEEE_F32LE : memType;
+
+  // IEEE 754 binary16, 1 sign, 5 exponent, and 10 mantissa bits. HDF5 has
+  // no predefined half type, it is derived from float32
+  if(m_HalfType < 0)
+    {
+      m_HalfType = H5Tcopy(H5T_IEEE_F32LE);
+      H5Tset_fields(m_HalfType, 15, 10, 5, 0, 10);
+      H5Tset_precision(m_HalfType, 16);
+      H5Tset_size(m_HalfType, 2);
+      H5Tset_ebias(m_HalfType, 15);
+    }
+
+  return m_HalfType;
+}
+
 bool WriteStream::WriteVar(hid_t &varID,
                            const std::string &name,
                            const HDF5SpaceGuard &space,
                            hid_t h5Type,
-                           void *data)
+                           void *data,
+                           hid_t fileType)
 {
   hsize_t bytes= H5Sget_simple_extent_npoints(space.m_MemSpaceID);
   std::ostringstream  oss;   oss<<"H5BytesWrote="<<bytes;
@@ -2361,18 +3345,119 @@ bool WriteStream::WriteVar(hid_t &varID,
   sensei::TimeEvent<128> mark(evtName.c_str());
 
   if(-1 == varID)
-    varID = CreateVar(name, space, h5Type);
+    varID = CreateVar(name, space, fileType < 0 ? h5Type : fileType);
 
+  // blocks are written one at a time by their owner, the number of calls
+  // differs between ranks, so the transfer is independent
   H5Dwrite(varID,
            h5Type,
            space.m_MemSpaceID,
            space.m_FileSpaceID,
-           m_CollectiveTxf,
+           H5P_DEFAULT,
            data);
 
   return true;
 }
 
+bool WriteStream::WriteBlocks(hid_t &varID,
+                              const std::string &name,
+                              hsize_t global,
+                              const std::vector<hsize_t> &starts,
+                              const std::vector<hsize_t> &counts,
+                              const std::vector<hsize_t> &strides,
+                              const std::vector<void *> &data,
+                              hid_t h5Type,
+                              hsize_t chunk,
+                              hid_t fileType)
+{
+  size_t elemSize = H5Tget_size(h5Type);
+
+  hsize_t total = 0;
+  size_t nBlocks = counts.size();
+  for(size_t i = 0; i < nBlocks; ++i)
+    total += counts[i];
+
+  std::ostringstream  oss;   oss<<"H5BytesWrote="<<total*elemSize;
+  std::string evtName = oss.str();
+  sensei::TimeEvent<128> mark(evtName.c_str());
+
+  // dataset creation is collective
+  if(-1 == varID)
+    varID = CreateVar(name, global, fileType < 0 ? h5Type : fileType,
+                      chunk, true);
+
+  if(varID < 0)
+    {
+      SENSEI_ERROR("Failed to create \"" << name << "\"");
+      return false;
+    }
+
+  // select the union of the local blocks, merging adjacent contiguous
+  // blocks
+  hid_t fileSpace = H5Dget_space(varID);
+  H5Sselect_none(fileSpace);
+
+  for(size_t i = 0; i < nBlocks;)
+    {
+      hsize_t start = starts[i];
+      hsize_t count = counts[i];
+      hsize_t stride = strides.empty() ? 1 : strides[i];
+
+      for(++i; (stride == 1) && (i < nBlocks) &&
+            (strides.empty() || (strides[i] == 1)) &&
+            (starts[i] == start + count); ++i)
+        count += counts[i];
+
+      if(count)
+        H5Sselect_hyperslab(
+          fileSpace, H5S_SELECT_OR, &start, &stride, &count, NULL);
+    }
+
+  // pack the blocks, the selection is in increasing order of position
+  // and the blocks are visited in that order
+  std::vector<char> buffer;
+  void *memData = nullptr;
+  if(nBlocks == 1)
+    {
+      memData = data[0];
+    }
+  else if(nBlocks > 1)
+    {
+      buffer.resize(total * elemSize);
+      char *dest = buffer.data();
+      for(size_t i = 0; i < nBlocks; ++i)
+        {
+          size_t nBytes = counts[i] * elemSize;
+          memcpy(dest, data[i], nBytes);
+          dest += nBytes;
+        }
+      memData = buffer.data();
+    }
+
+  hsize_t memCount = std::max(total, hsize_t(1));
+  hid_t memSpace = H5Screate_simple(1, &memCount, NULL);
+  if(total == 0)
+    H5Sselect_none(memSpace);
+
+  herr_t ierr = H5Dwrite(varID,
+                         h5Type,
+                         memSpace,
+                         fileSpace,
+                         m_CollectiveTxf,
+                         memData);
+
+  H5Sclose(memSpace);
+  H5Sclose(fileSpace);
+
+  if(ierr < 0)
+    {
+      SENSEI_ERROR("Failed to write \"" << name << "\"");
+      return false;
+    }
+
+  return true;
+}
+
 /*
 bool WriteStream::WriteVar(const std::string& name,
                              const HDF5SpaceGuard& space,
@@ -2395,15 +3480,72 @@ bool WriteStream::WriteVar(const std::string& name,
 }
 */
 
-bool WriteStream::WriteMetadata(sensei::MeshMetadataPtr &md)
+bool WriteStream::WriteMetadata(sensei::MeshMetadataPtr &md, bool track)
 {
   std::string path;
   gGetNameStr(path, m_MeshCounter, "meshdata");
 
   sensei::BinaryStream bs;
-  md->ToStream(bs);
+  md->ToStream(bs, sensei::MeshMetadata::ENCODING_COMPACT);
+
+  // metadata that did not change refers to its last copy. the metadata is
+  // a global view, the same on all ranks
+  std::string key = md->MeshName + "/meshdata";
+  if (track)
+    {
+      sensei::BinaryStream &last = m_LastMetadata[key];
+      if ((last.Size() == bs.Size()) &&
+          !memcmp(last.GetData(), bs.GetData(), bs.Size()) &&
+          LinkLastWritten(key, path))
+        {
+          // a delta's base is linked with it. the next delta is made from
+          // the link, which a reader reading in order has just decoded
+          if (m_LastWritten.count(key + "_base"))
+            {
+              LinkLastWritten(key + "_base", path + "_base");
+              SetLastWritten(key + "_base", path + "_base");
+            }
+          SetLastWritten(key, path);
+          return true;
+        }
+
+      last = bs;
+    }
+
+  // metadata that changed is written as the difference to that last
+  // written, a key frame holding all of it every m_MetadataKeyFrames
+  // steps. the name of the dataset it was made from is written beside it
+  if (m_MetadataKeyFrames && !m_StreamingOn)
+    {
+      DeltaBase &base = m_MetadataBase[key];
+      std::map<std::string, std::string>::iterator it = m_LastWritten.find(key);
+
+      if (base.Metadata && (it != m_LastWritten.end()) &&
+          (base.NumDeltas + 1 < m_MetadataKeyFrames))
+        {
+          sensei::BinaryStream delta;
+          md->ToDeltaStream(delta, *base.Metadata);
+
+          sensei::BinaryStream basePath;
+          basePath.Pack(it->second);
+
+          WriteBinary(path + "_base", basePath);
+          SetLastWritten(key + "_base", path + "_base");
+
+          bs.Swap(delta);
+          base.NumDeltas += 1;
+        }
+      else
+        {
+          m_LastWritten.erase(key + "_base");
+          base.NumDeltas = 0;
+        }
+
+      base.Metadata = md->NewCopy();
+    }
 
   WriteBinary(path, bs);
+  SetLastWritten(key, path);
   return true;
 }
 
@@ -2417,6 +3559,9 @@ WriteStream::~WriteStream()
       CloseTimeStep();
     }
   m_Streamer->Summary();
+
+  if(m_HalfType >= 0)
+    H5Tclose(m_HalfType);
 }
 
 // --------------------------------------------------------------------------
@@ -2446,8 +3591,87 @@ bool WriteStream::WriteBinary(const std::string &name,
   return true;
 }
 
+bool WriteStream::LinkLastWritten(const std::string &key,
+                                  const std::string &name)
+{
+  // the readers of separate step files remove them as they go
+  if(m_StreamingOn)
+    return false;
+
+  std::map<std::string, std::string>::iterator it = m_LastWritten.find(key);
+  if(it == m_LastWritten.end())
+    return false;
+
+  if(H5Lcreate_hard(m_Streamer->m_TimeStepId, it->second.c_str(),
+                    m_Streamer->m_TimeStepId, name.c_str(),
+                    H5P_DEFAULT, H5P_DEFAULT) < 0)
+    {
+      SENSEI_WARNING("Failed to link \"" << name << "\" to \""
+                     << it->second << "\". The array is written")
+      return false;
+    }
+
+  return true;
+}
+
+void WriteStream::SetLastWritten(const std::string &key,
+                                 const std::string &name)
+{
+  if(m_StreamingOn)
+    return;
+
+  // the step's group name is absolute, links to it remain valid while
+  // later steps are written
+  char stepName[256] = {'\0'};
+  H5Iget_name(m_Streamer->m_TimeStepId, stepName, sizeof(stepName));
+
+  m_LastWritten[key] = std::string(stepName) + "/" + name;
+}
+
+bool WriteStream::LinkGeometry(const std::string &key, unsigned int meshID)
+{
+  if(m_StreamingOn || (m_GeometryStep.find(key) == m_GeometryStep.end()))
+    return false;
+
+  // the same datasets were recorded on all ranks
+  bool linked = false;
+  for(const char **name = GEOMETRY_NAMES; *name; ++name)
+    {
+      std::string path;
+      gGetNameStr(path, meshID, *name);
+
+      if(m_LastWritten.count(key + "/" + *name))
+        {
+          if(!LinkLastWritten(key + "/" + *name, path))
+            return false;
+
+          linked = true;
+        }
+    }
+
+  return linked;
+}
+
+void WriteStream::SetGeometryWritten(const std::string &key,
+                                     unsigned int meshID)
+{
+  m_GeometryStep[key] = m_Streamer->m_TimeStepCounter;
+
+  for(const char **name = GEOMETRY_NAMES; *name; ++name)
+    {
+      std::string path;
+      gGetNameStr(path, meshID, *name);
+
+      if(H5Lexists(m_Streamer->m_TimeStepId, path.c_str(), H5P_DEFAULT) > 0)
+        SetLastWritten(key + "/" + *name, path);
+      else
+        m_LastWritten.erase(key + "/" + *name);
+    }
+}
+
 bool WriteStream::WriteMesh(sensei::MeshMetadataPtr &md,
-                            vtkCompositeDataSet *vtkPtr)
+                            vtkCompositeDataSet *vtkPtr,
+                            const std::vector<int> &changed)
 {
   std::string meshName;
   gGetNameStr(meshName, m_MeshCounter, "");
@@ -2463,10 +3687,24 @@ bool WriteStream::WriteMesh(sensei::MeshMetadataPtr &md,
 
   HDF5GroupGuard g(meshID);
 
-  WriteMetadata(md);
+  // when changes are tracked the metadata and the geometry of a static
+  // mesh are written once, or when they change, later steps link to them
+  bool track = !changed.empty();
+  WriteMetadata(md, track);
+
+  std::string key = md->MeshName + "/geometry";
+  bool linked = track && md->StaticMesh && LinkGeometry(key, m_MeshCounter);
 
   MeshFlow m(vtkPtr, m_MeshCounter);
-  m.WriteTo(this, md);
+  m.WriteTo(this, md, changed, !linked);
+
+  if(!linked)
+    SetGeometryWritten(key, m_MeshCounter);
+
+  // readers reuse the geometry they read at this step
+  unsigned int geometryStep = m_GeometryStep[key];
+  WriteNativeAttr(ATTRNAME_GEOMETRY_STEP, &geometryStep, H5T_NATIVE_UINT,
+                  meshID);
 
   m_MeshCounter++;
   return true;
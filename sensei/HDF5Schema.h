@@ -3,18 +3,29 @@
 
 class vtkDataSet;
 class vtkDataObject;
+class vtkDataArray;
+class vtkPolyData;
+class vtkUnstructuredGrid;
+class vtkUnsignedCharArray;
 typedef struct _ADIOS_FILE ADIOS_FILE;
 
 #include "MeshMetadata.h"
 #include "MeshMetadataMap.h"
+#include "DataRequirements.h"
 #include "hdf5.h"
 //#include <adios_read.h>
 #include <cstdint>
 #include <mpi.h>
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
 #include <vtkCompositeDataSet.h>
+#include <vtkDataSet.h>
+#include <vtkSmartPointer.h>
+
+// registered id of the blosc filter plugin
+#define SENSEI_H5Z_FILTER_BLOSC 32001
 #include <vtkDataObject.h>
 
 namespace senseiHDF5
@@ -41,7 +52,8 @@ private:
 class HDF5VarGuard
 {
 public:
-  HDF5VarGuard(hid_t varID);
+  // the dataset is closed with the guard unless it is owned elsewhere
+  HDF5VarGuard(hid_t varID, bool owner = true);
 
   ~HDF5VarGuard();
 
@@ -54,9 +66,25 @@ public:
                  const hsize_t *count,
                  const hsize_t *block);
 
+  // read the spans of a 1D dataset given in increasing order of start,
+  // each into its own buffer. adjacent spans are coalesced and the whole
+  // read is a single hyperslab selection. a span of count elements spaced
+  // stride apart is read when strides are given, otherwise the spans are
+  // contiguous.
+  bool ReadSpans(const std::vector<hsize_t> &starts,
+                 const std::vector<hsize_t> &counts,
+                 const std::vector<hsize_t> &strides,
+                 const std::vector<void *> &bufs);
+
+  // set the type the values are read as, by default the dataset's type.
+  // HDF5 converts when they differ
+  void SetMemType(hid_t memType) { m_MemType = memType; }
+
   hid_t m_VarID;
   hid_t m_VarType;
+  hid_t m_MemType;
   hid_t m_VarSpace;
+  bool m_Owner;
 };
 
 class HDF5SpaceGuard
@@ -112,6 +140,31 @@ public:
   virtual bool IsValid() = 0;
   virtual bool Summary() = 0;
 
+  // the attributes of a step, recorded when the stream is opened
+  struct StepRecord
+  {
+    unsigned long TimeStep;
+    double Time;
+    unsigned int NumMeshes;
+  };
+
+  // open the step'th step directly. false when the handler can only
+  // advance
+  virtual bool SeekStream(unsigned int step)
+  {
+    (void)step;
+    return false;
+  }
+
+  // get the recorded attributes of the step'th step. false when they
+  // were not recorded and are read from the step
+  virtual bool GetStepRecord(unsigned int step, StepRecord &rec)
+  {
+    (void)step;
+    (void)rec;
+    return false;
+  }
+
   hid_t m_TimeStepId;
   unsigned int m_TimeStepCounter = 0;
 
@@ -135,9 +188,17 @@ public:
   bool IsValid();
   bool Summary();
 
+  bool SeekStream(unsigned int step) override;
+  bool GetStepRecord(unsigned int step, StepRecord &rec) override;
+
 private:
+  // record the attributes of every step. they are read by rank 0 and
+  // broadcast
+  void BuildIndex(ReadStream *client);
+
   hid_t m_HostFileId;
   unsigned int m_TimeStepTotal = 0;
+  std::vector<StepRecord> m_Index;
 };
 
 class PerStepStreamHandler : public StreamHandler
@@ -162,6 +223,15 @@ private:
   void GetCurrAvailStep();
   void UpdateAvailStep();
 
+  // rank 0 watches the directory of the signal file for updates, where
+  // inotify is available
+  void WatchSignalFile();
+
+  // rank 0 waits until the signal file is updated, or at most a second,
+  // rather than polling it
+  void WaitForUpdate();
+  int m_WatchFd = -1;
+
   int m_NumStepsWritten = -1; // -1 if not able to detect. otherwise >=1
 
   bool m_AllStepsWritten = false;
@@ -183,12 +253,29 @@ public:
 
   void CloseTimeStep();
   void SetCollectiveTxf();
+
+  // store files as a set of subfiles, each written by an I/O concentrator,
+  // by default one per node. stripeSize is the number of bytes written to
+  // a subfile before moving to the next, stripeCount the number of
+  // subfiles, 0 for the HDF5 defaults. a small configuration file records
+  // the layout and readers open the set as a single file. must be called
+  // before Init by both writers and readers. requires HDF5 built with the
+  // subfiling VFD and MPI_THREAD_MULTIPLE.
+  bool SetSubfiling(long long stripeSize, int stripeCount);
+
   MPI_Comm m_Comm;
   int m_Rank;
   int m_Size;
 
   bool m_StreamingOn = false;
 
+  // read multi-component arrays into vtkSOADataArrayTemplate
+  bool m_StructureOfArrays = false;
+
+  // the threads of the TaskRuntime the cells of the local blocks are
+  // assembled on, less than 1 for all of them
+  int m_NumberOfThreads = 1;
+
   sensei::MeshMetadataMap m_AllMeshInfo; // sender
   sensei::MeshMetadataMap m_AllMeshInfoReceiver;
 
@@ -215,10 +302,45 @@ public:
   bool AdvanceTimeStep(unsigned long &time_step, double &time);
 
   void Close() {}
-  bool WriteMesh(sensei::MeshMetadataPtr &md, vtkCompositeDataSet *vtkPtr);
+
+  // when given, changed holds a flag per data array, see
+  // sensei::ArrayChangeTracker. in a single file an array flagged 0 is
+  // made a hard link to the dataset it was last written to
+  bool WriteMesh(sensei::MeshMetadataPtr &md, vtkCompositeDataSet *vtkPtr,
+                 const std::vector<int> &changed = {});
+
+  // make name, in the current step, a hard link to the dataset last
+  // written for key. returns false when there is none or the steps are
+  // written to separate files. collective
+  bool LinkLastWritten(const std::string &key, const std::string &name);
+
+  // record the dataset name of the current step as the last written for key
+  void SetLastWritten(const std::string &key, const std::string &name);
+
+  // make the geometry datasets of mesh meshID, in the current step, hard
+  // links to those last recorded for key by SetGeometryWritten. returns
+  // false when there are none or the steps are written to separate files.
+  // collective
+  bool LinkGeometry(const std::string &key, unsigned int meshID);
+
+  // record the geometry datasets of mesh meshID written in the current
+  // step as the last written for key
+  void SetGeometryWritten(const std::string &key, unsigned int meshID);
 
   bool WriteBinary(const std::string &name, sensei::BinaryStream &str);
-  bool WriteMetadata(sensei::MeshMetadataPtr &md);
+
+  // when track is set metadata that is the same as that last written for
+  // the mesh is made a hard link to it
+  bool WriteMetadata(sensei::MeshMetadataPtr &md, bool track = false);
+
+  // write the metadata as the difference to that last written for the
+  // mesh, see sensei::MeshMetadata::ToDeltaStream, with all of it written
+  // every interval steps. the absolute path of the dataset a delta was
+  // made from is stored beside it in meshdata_base. only in a single file,
+  // steps written to separate files are removed by their readers. 0, the
+  // default, and 1 write all of it every step
+  void SetMetadataKeyFrames(unsigned int interval)
+  { m_MetadataKeyFrames = interval; }
   bool WriteNativeAttr(const std::string &name,
                        void *val,
                        hid_t h5Type,
@@ -228,17 +350,103 @@ public:
                   const HDF5SpaceGuard &space,
                   hid_t h5Type);
 
+  // create a dataset of global elements. chunk is the chunk size used when
+  // chunking follows the block size, it is ignored otherwise. the filter
+  // pipeline is applied when filtered is set.
+  hid_t CreateVar(const std::string &name,
+                  hsize_t global,
+                  hid_t h5Type,
+                  hsize_t chunk,
+                  bool filtered);
+
+  // set the chunk size in elements. 0 writes contiguous datasets, -1
+  // chunks datasets by block. chunking is enabled by filters.
+  void SetChunkSize(long long n) { m_ChunkSize = n; }
+
+  // set the compression filter, one of none, deflate, zstd, blosc, or
+  // scaleoffset. zstd and blosc are provided by the HDF5 filter plugins
+  // 32015 and 32001. scaleoffset is lossy for floating point data, level
+  // is the number of decimal digits kept. returns false if the filter is
+  // not available.
+  bool SetFilter(const std::string &name, int level);
+
+  // shuffle the bytes of the elements ahead of the compression filter.
+  // not used with scaleoffset
+  void SetShuffle(bool val) { m_Shuffle = val; }
+
+  // set MPI-IO collective buffering hints and the file alignment. values
+  // of 0 leave the default. must be called before Init.
+  void SetMPIHints(int cbNodes, long long cbBufferSize, long long alignment);
+
+  // store the data arrays at the precision given for each in reqs, see
+  // sensei::DataRequirements::SetArrayPrecision. the metadata keeps the
+  // arrays' types, HDF5 converts the values as they are written and read
+  void SetArrayPrecision(const sensei::DataRequirements &reqs)
+  { m_Precision = reqs; }
+
+  // get the dataset type of the named array given its memory type. float32
+  // or IEEE half precision for floating point arrays stored at reduced
+  // precision, otherwise the memory type
+  hid_t GetFileType(const std::string &meshName, int association,
+                    const std::string &arrayName, hid_t memType);
+
   // bool WriteVar(const std::string& name, const HDF5SpaceGuard &space,
   // hid_t h5Type, void *data);
 
+  // when given the dataset is created with fileType, HDF5 converts the
+  // values from h5Type.
   bool WriteVar(hid_t &vid,
                 const std::string &name,
                 const HDF5SpaceGuard &space,
                 hid_t h5Type,
-                void *data);
+                void *data,
+                hid_t fileType = -1);
+
+  // write all of this rank's blocks of a dataset in a single call. every
+  // rank must call this, including those that have no blocks. when strides
+  // are given a block's elements are spaced stride apart in the dataset,
+  // which lets the components of a structure of arrays be written into
+  // their interleaved positions one at a time.
+  bool WriteBlocks(hid_t &vid,
+                   const std::string &name,
+                   hsize_t global,
+                   const std::vector<hsize_t> &starts,
+                   const std::vector<hsize_t> &counts,
+                   const std::vector<hsize_t> &strides,
+                   const std::vector<void *> &data,
+                   hid_t h5Type,
+                   hsize_t chunk,
+                   hid_t fileType = -1);
 
 private:
   unsigned int m_MeshCounter;
+
+  sensei::DataRequirements m_Precision;
+  hid_t m_HalfType = -1;
+
+  // the absolute path of the dataset each array was last written to
+  std::map<std::string, std::string> m_LastWritten;
+
+  // the step the geometry of each static mesh was last written at, and
+  // the metadata of each mesh last written
+  std::map<std::string, unsigned int> m_GeometryStep;
+  std::map<std::string, sensei::BinaryStream> m_LastMetadata;
+
+  // the metadata of each mesh the next delta is made from, and the number
+  // of deltas written since the last key frame
+  struct DeltaBase
+  {
+    unsigned int NumDeltas = 0;
+    sensei::MeshMetadataPtr Metadata;
+  };
+
+  unsigned int m_MetadataKeyFrames = 0;
+  std::map<std::string, DeltaBase> m_MetadataBase;
+
+  long long m_ChunkSize = 0;
+  H5Z_filter_t m_Filter = H5Z_FILTER_NONE;
+  unsigned int m_FilterLevel = 0;
+  bool m_Shuffle = false;
 };
 
 class ReadStream : public BasicStream
@@ -249,6 +457,10 @@ public:
 
   bool AdvanceTimeStep(unsigned long &time_step, double &time);
 
+  // move to the step'th step without opening those before it. only for
+  // steps written to a single file
+  bool SeekTimeStep(unsigned int step, unsigned long &time_step, double &time);
+
   bool Init(const std::string &name);
   void Close();
 
@@ -271,10 +483,73 @@ public:
                       hid_t h5Type,
                       hid_t hid);
   bool ReadBinary(const std::string &name, sensei::BinaryStream &str);
-  bool ReadVar1D(const std::string &name, hsize_t s, hsize_t c, void *data);
+
+  // get the step at which the geometry of mesh meshID was written. returns
+  // false when the file does not record it
+  bool ReadGeometryStep(unsigned int meshID, unsigned int &step);
+
+  // give the local blocks of dobj the geometry cached when it was read
+  // at step. returns false when it was not, or was for other blocks
+  bool ReuseGeometry(const sensei::MeshMetadataPtr &md, unsigned int step,
+                     vtkCompositeDataSet *dobj);
+
+  // keep the geometry of the local blocks, read at step, for the steps
+  // that link to it
+  void CacheGeometry(const sensei::MeshMetadataPtr &md, unsigned int step,
+                     vtkCompositeDataSet *dobj);
+
+  // when given the values are read as memType, otherwise as the type of
+  // the dataset
+  bool ReadVar1D(const std::string &name, hsize_t s, hsize_t c, void *data,
+                 hid_t memType = -1);
+
+  // read a number of spans of a 1D dataset in a single call. strides may
+  // be empty for contiguous spans
+  bool ReadVar1D(const std::string &name,
+                 const std::vector<hsize_t> &starts,
+                 const std::vector<hsize_t> &counts,
+                 const std::vector<hsize_t> &strides,
+                 const std::vector<void *> &data,
+                 hid_t memType = -1);
 
 private:
+  // get the time and number of meshes of the step just opened
+  bool ReadTimeStep(unsigned long &time_step, double &time);
+
+  // read the metadata of mesh meshID from the dataset at path, decoding a
+  // delta against the metadata it was made from
+  bool ReadMetadata(unsigned int meshID, const std::string &path,
+                    sensei::MeshMetadataPtr &md);
+
+  // get the dataset of the current step, opened on first use and kept
+  // open until the step is closed
+  hid_t OpenDataset(const std::string &name);
+  void CloseDatasets();
+
   unsigned int m_TimeStepTotal;
+  unsigned int m_NumMeshes = 0;
+  std::map<std::string, hid_t> m_Datasets;
+
+  // the geometry of the local blocks of each static mesh, shallow copies
+  // of the points and cells read at Step
+  struct CachedGeometry
+  {
+    unsigned int Step = 0;
+    std::vector<unsigned int> Blocks;
+    std::vector<vtkSmartPointer<vtkDataSet>> Structure;
+  };
+
+  std::map<std::string, CachedGeometry> m_GeometryCache;
+
+  // the metadata of each mesh last decoded and the absolute path of its
+  // dataset. read in order each step's delta is made from it
+  struct CachedMetadata
+  {
+    std::string Path;
+    sensei::MeshMetadataPtr Metadata;
+  };
+
+  std::map<unsigned int, CachedMetadata> m_MetadataCache;
 };
 
 class ArrayFlow;
@@ -298,7 +573,11 @@ public:
   bool ReadFrom(ReadStream *StreamPtr, bool structureOnly);
   bool Initialize(const sensei::MeshMetadataPtr &md, ReadStream *input);
 
-  bool WriteTo(WriteStream *StreamPtr, const sensei::MeshMetadataPtr &md);
+  // data arrays flagged 0 in changed are linked to their last copy. the
+  // points and cells are not written when geometry is false
+  bool WriteTo(WriteStream *StreamPtr, const sensei::MeshMetadataPtr &md,
+               const std::vector<int> &changed = {},
+               bool geometry = true);
 
   vtkCompositeDataSet *m_VtkPtr;
 
@@ -328,6 +607,10 @@ public:
   virtual bool unload(unsigned int block_id,
                       vtkCompositeDataIterator *it,
                       WriteStream *output) = 0;
+  // called once load has been called for all of the local blocks. flows
+  // that collect the reads of the blocks in load issue them here and
+  // finish the blocks
+  virtual bool build(ReadStream *) { return true; }
 
 protected:
   const sensei::MeshMetadataPtr &m_Metadata;
@@ -360,6 +643,7 @@ public:
               vtkCompositeDataIterator *it,
               WriteStream *input);
   bool update(unsigned int block_id);
+  bool build(ReadStream *input);
 
 protected:
   std::vector<VTKObjectFlow *> m_Workers;
@@ -380,13 +664,18 @@ public:
   bool load(unsigned int block_id, 
 	    vtkCompositeDataIterator *it, 
 	    ReadStream *);
+  // read the local blocks in one call
+  bool loadAll(vtkCompositeDataSet *dobj, ReadStream *reader);
   bool unload(unsigned int block_id, 
 	      vtkCompositeDataIterator *it,
               WriteStream *output);
+  // write the local blocks in one call, must be called on all ranks
+  bool unloadAll(vtkCompositeDataSet *dobj, WriteStream *output);
   bool update(unsigned int block_id);
 
   int GetArrayType();
   const std::string &GetArrayName();
+  const std::string &GetArrayPath() { return m_ArrayPath; }
 
 protected:
   unsigned long long getLocalElement(unsigned int block_id);
@@ -415,10 +704,17 @@ public:
               vtkCompositeDataIterator *it,
               WriteStream *output);
   bool update(unsigned int block_id);
+  // read the points of the local blocks in one call
+  bool build(ReadStream *input);
 
 private:
   unsigned long long m_BlockOffset;
   unsigned long long m_GlobalTotal;
+
+  // the points of the local blocks read by build
+  std::vector<hsize_t> m_Starts;
+  std::vector<hsize_t> m_Counts;
+  std::vector<void *> m_Data;
 };
 
 class PolydataCellFlow : public VTKObjectFlow
@@ -432,10 +728,20 @@ public:
               vtkCompositeDataIterator *it,
               WriteStream *output);
   bool update(unsigned int block_id);
+  // read the cells of the local blocks in one call per dataset and
+  // assemble the blocks' cell arrays in parallel
+  bool build(ReadStream *input);
 
 private:
   unsigned long long m_CellTypesBlockOffset = 0;
   unsigned long long m_CellArrayBlockOffset = 0;
+
+  // the local blocks and their types and cells, read by build
+  std::vector<vtkPolyData *> m_Blocks;
+  std::vector<std::vector<unsigned char>> m_Types;
+  std::vector<std::vector<vtkIdType>> m_Cells;
+  std::vector<hsize_t> m_TypeStarts;
+  std::vector<hsize_t> m_CellStarts;
 };
 
 class UniformCartesianFlow : public VTKObjectFlow
@@ -503,17 +809,44 @@ class UnstructuredCellFlow : public VTKObjectFlow
 {
 public:
   UnstructuredCellFlow(const sensei::MeshMetadataPtr &md, unsigned int meshID);
-  ~UnstructuredCellFlow() {}
+  ~UnstructuredCellFlow();
 
   bool load(unsigned int block_id, vtkCompositeDataIterator *it, ReadStream *);
   bool unload(unsigned int block_id,
               vtkCompositeDataIterator *it,
               WriteStream *output);
   bool update(unsigned int block_id);
+  // read the cells of the local blocks in one call per dataset and
+  // assemble the blocks' cell arrays in parallel
+  bool build(ReadStream *input);
 
 private:
+  // the cells are stored as types, offsets, one per cell plus one, and
+  // connectivity. the indices are 32 bit when every block fits
+  bool m_Use32 = false;
+  hid_t m_IndexType = -1;
+
+  std::string m_CellOffsetVarName;
+  std::string m_CellConnVarName;
+
+  hid_t m_CellOffsetVarID = -1;
+  hid_t m_CellConnVarID = -1;
+
+  unsigned long long m_TotalOffsets = 0;
+  unsigned long long m_TotalConn = 0;
+
   unsigned long long m_CellTypesBlockOffset = 0;
-  unsigned long long m_CellArrayBlockOffset = 0;
+  unsigned long long m_CellOffsetBlockOffset = 0;
+  unsigned long long m_CellConnBlockOffset = 0;
+
+  // the local blocks and their cells, read by build
+  std::vector<vtkUnstructuredGrid *> m_Blocks;
+  std::vector<vtkSmartPointer<vtkUnsignedCharArray>> m_Types;
+  std::vector<vtkSmartPointer<vtkDataArray>> m_Offsets;
+  std::vector<vtkSmartPointer<vtkDataArray>> m_Conns;
+  std::vector<hsize_t> m_TypeStarts;
+  std::vector<hsize_t> m_OffsetStarts;
+  std::vector<hsize_t> m_ConnStarts;
 };
 
 //
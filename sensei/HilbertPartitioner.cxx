@@ -0,0 +1,146 @@
+#include "HilbertPartitioner.h"
+#include "SpaceFillingCurve.h"
+#include "Profiler.h"
+
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+// number of bits per axis in the Hilbert index
+constexpr int hilbertBits = sensei::SpaceFillingCurve::MaxBits;
+}
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+int HilbertPartitioner::GetPartition(MPI_Comm comm, const MeshMetadataPtr &mdIn,
+  MeshMetadataPtr &mdOut)
+{
+  TimeEvent<128> mark("HilbertPartitioner::GetPartition");
+
+  int nBlocks = mdIn->NumBlocks;
+
+  // require block bounds
+  if (int(mdIn->BlockBounds.size()) != nBlocks)
+    {
+    SENSEI_ERROR("Block bounds are required")
+    return -1;
+    }
+
+  const std::vector<long> *blockSize = nullptr;
+  if (this->Weight == WEIGHT_CELLS)
+    blockSize = &mdIn->BlockNumCells;
+  else if (this->Weight == WEIGHT_POINTS)
+    blockSize = &mdIn->BlockNumPoints;
+
+  if (blockSize && (int(blockSize->size()) != nBlocks))
+    {
+    SENSEI_ERROR("Block " << (this->Weight == WEIGHT_CELLS ? "cell" : "point")
+      << " counts are required")
+    return -1;
+    }
+
+  mdOut = mdIn->NewCopy();
+  mdOut->BlockOwner.resize(nBlocks);
+
+  int nRanks = 1;
+  MPI_Comm_size(comm, &nRanks);
+
+  // compute the block centers and the box enclosing them
+  std::vector<double> center(3*nBlocks);
+  double lo[3] = {std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+  double hi[3] = {std::numeric_limits<double>::lowest(),
+    std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    const std::array<double,6> &bounds = mdIn->BlockBounds[i];
+    for (int j = 0; j < 3; ++j)
+      {
+      double c = 0.5*(bounds[2*j] + bounds[2*j+1]);
+      center[3*i+j] = c;
+      lo[j] = std::min(lo[j], c);
+      hi[j] = std::max(hi[j], c);
+      }
+    }
+
+  // order the blocks along the curve. axes with no extent, for instance
+  // in 2D data, map to 0
+  double maxCoord = double((1u << hilbertBits) - 1);
+  std::vector<uint64_t> key(nBlocks);
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    uint32_t x[3] = {0u, 0u, 0u};
+    for (int j = 0; j < 3; ++j)
+      {
+      double dx = hi[j] - lo[j];
+      if (dx > 0.0)
+        x[j] = uint32_t((center[3*i+j] - lo[j])/dx*maxCoord);
+      }
+    key[i] = SpaceFillingCurve::HilbertIndex(x, hilbertBits);
+    }
+
+  std::vector<int> order(nBlocks);
+  for (int i = 0; i < nBlocks; ++i)
+    order[i] = i;
+
+  std::stable_sort(order.begin(), order.end(),
+    [&](int a, int b) -> bool { return key[a] < key[b]; });
+
+  // cut the curve into pieces of equal weight. a block goes to the rank
+  // whose piece holds the middle of the block's weight
+  std::vector<double> weight(nBlocks, 1.0);
+  double total = 0.0;
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    if (blockSize)
+      weight[i] = std::max(double((*blockSize)[i]), 1.0);
+    total += weight[i];
+    }
+
+  double prefix = 0.0;
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    int bid = order[i];
+    int owner = int((prefix + 0.5*weight[bid])/total*nRanks);
+    mdOut->BlockOwner[bid] = std::min(owner, nRanks - 1);
+    prefix += weight[bid];
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int HilbertPartitioner::Initialize(pugi::xml_node &node)
+{
+  TimeEvent<128> mark("HilbertPartitioner::Initialize");
+
+  std::string weight = node.attribute("weight").as_string("cells");
+  if (weight == "cells")
+    this->Weight = WEIGHT_CELLS;
+  else if (weight == "points")
+    this->Weight = WEIGHT_POINTS;
+  else if (weight == "none")
+    this->Weight = WEIGHT_NONE;
+  else
+    {
+    SENSEI_ERROR("Invalid weight \"" << weight << "\". Valid values are"
+      " cells, points, and none")
+    return -1;
+    }
+
+  SENSEI_STATUS("Configured HilbertPartitioner weight=" << weight)
+
+  return 0;
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef sensei_HilbertPartitioner_h
+#define sensei_HilbertPartitioner_h
+
+#include "Partitioner.h"
+
+namespace sensei
+{
+
+class HilbertPartitioner;
+using HilbertPartitionerPtr = std::shared_ptr<sensei::HilbertPartitioner>;
+
+/// @class HilbertPartitioner
+/// @brief partitions blocks along a space filling curve.
+///
+/// Blocks are ordered by the Hilbert index of the center of their
+/// MeshMetadata::BlockBounds and the curve is cut into pieces of equal
+/// weight, one per rank. Because the curve preserves locality each rank
+/// receives a spatially coherent set of blocks, which keeps ghost exchange
+/// and the set of ranks touched by slices and iso-surfaces small. The weight
+/// of a block is taken from BlockNumCells, BlockNumPoints, or is uniform.
+/// The class looks for the weighting in the XML attribute `weight`, one of
+/// `cells` (the default), `points`, or `none`.
+class HilbertPartitioner : public sensei::Partitioner
+{
+public:
+  static sensei::HilbertPartitionerPtr New()
+  { return HilbertPartitionerPtr(new HilbertPartitioner); }
+
+  const char *GetClassName() override { return "HilbertPartitioner"; }
+
+  // given an existing partitioning of data passed in the first MeshMetadata
+  // argument,return a new partittioning in the second MeshMetadata argument.
+  // requires BlockBounds.
+  int GetPartition(MPI_Comm comm, const sensei::MeshMetadataPtr &in,
+     sensei::MeshMetadataPtr &out) override;
+
+  // Set/get the block weighting
+  enum {WEIGHT_NONE=0, WEIGHT_CELLS=1, WEIGHT_POINTS=2};
+  void SetWeight(int weight) { this->Weight = weight; }
+  int GetWeight() { return this->Weight; }
+
+  // Initialize from XML
+  int Initialize(pugi::xml_node &node) override;
+
+protected:
+  HilbertPartitioner() : Weight(WEIGHT_CELLS) {}
+  HilbertPartitioner(const HilbertPartitioner &) = default;
+
+  int Weight;
+};
+
+}
+
+#endif
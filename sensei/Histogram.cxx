@@ -1,22 +1,105 @@
 #include "Histogram.h"
+#include "BlockStream.h"
 #include "DataAdaptor.h"
 #include "MeshMetadata.h"
 #include "MeshMetadataMap.h"
+#include "PartialResultsDataAdaptor.h"
 #include "Profiler.h"
+#include "Sampling.h"
 #include "VTKHistogram.h"
 #include "VTKUtils.h"
 #include "Error.h"
 
+#include <vtkCellData.h>
 #include <vtkCompositeDataIterator.h>
 #include <vtkCompositeDataSet.h>
 #include <vtkDataObject.h>
 #include <vtkDataSetAttributes.h>
+#include <vtkImageData.h>
 #include <vtkObjectFactory.h>
 #include <vtkSmartPointer.h>
 #include <vtkUnsignedCharArray.h>
+#include <vtkUnsignedIntArray.h>
 
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 #include <vector>
+#include <map>
+#include <utility>
+
+namespace
+{
+// get the global ids of the non-empty blocks of a composite dataset
+void GetBlockIds(vtkCompositeDataSet *mesh, std::vector<int> &ids)
+{
+  ids.clear();
+
+  vtkSmartPointer<vtkCompositeDataIterator> iter;
+  iter.TakeReference(mesh->NewIterator());
+
+  for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
+    ids.push_back(sensei::VTKUtils::GetBlockId(mesh, iter));
+}
+
+// get the range of the named array over the listed blocks from the block
+// array ranges in the metadata. returns false if the metadata does not
+// hold a valid range for each of the blocks
+bool GetMetadataRange(const sensei::MeshMetadataPtr &md,
+  const std::string &arrayName, int association,
+  const std::vector<int> &blockIds, double range[2])
+{
+  if (!md || !md->Flags.BlockArrayRangeSet() || sensei::VTKUtils::AMR(md) ||
+    (md->BlockArrayRange.size() != md->BlockIds.size()))
+    return false;
+
+  std::vector<std::string>::const_iterator ait =
+    std::find(md->ArrayName.begin(), md->ArrayName.end(), arrayName);
+
+  if (ait == md->ArrayName.end())
+    return false;
+
+  // the histogram is of the first component, the range of a multi-component
+  // array may not be
+  unsigned int ai = ait - md->ArrayName.begin();
+  if ((ai >= md->ArrayCentering.size()) || (md->ArrayCentering[ai] != association) ||
+    (ai >= md->ArrayComponents.size()) || (md->ArrayComponents[ai] != 1))
+    return false;
+
+  // the metadata may hold the local or the global view, locate the local
+  // blocks by their id
+  std::map<int, unsigned int> blockIndex;
+  unsigned int nBlocks = md->BlockIds.size();
+  for (unsigned int i = 0; i < nBlocks; ++i)
+    blockIndex[md->BlockIds[i]] = i;
+
+  double lrange[2] = {std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::lowest()};
+
+  for (int bid : blockIds)
+    {
+    std::map<int, unsigned int>::iterator bit = blockIndex.find(bid);
+
+    if (bit == blockIndex.end())
+      return false;
+
+    const std::vector<std::array<double,2>> &blockRange =
+      md->BlockArrayRange[bit->second];
+
+    if ((ai >= blockRange.size()) || (blockRange[ai][0] > blockRange[ai][1]))
+      return false;
+
+    lrange[0] = std::min(lrange[0], blockRange[ai][0]);
+    lrange[1] = std::max(lrange[1], blockRange[ai][1]);
+    }
+
+  range[0] = lrange[0];
+  range[1] = lrange[1];
+
+  return true;
+}
+}
 
 namespace sensei
 {
@@ -25,8 +108,11 @@ namespace sensei
 senseiNewMacro(Histogram);
 
 //-----------------------------------------------------------------------------
-Histogram::Histogram() : Bins(0),
-  Association(vtkDataObject::FIELD_ASSOCIATION_POINTS), Internals(nullptr)
+Histogram::Histogram() : Bins(0), Threads(1), BatchSize(0),
+  SampleFraction(1.0), ErrorBound(0.0), Range{1.0, 0.0},
+  AccumulationSteps(1), Asynchronous(false),
+  Phase(PartialResultsDataAdaptor::PHASE_ALL), PartialPrefix("histogram"),
+  StepsAccumulated(0), LastStep(0), LastTime(0.0), Internals(nullptr)
 {
 }
 
@@ -39,12 +125,183 @@ Histogram::~Histogram()
 //-----------------------------------------------------------------------------
 void Histogram::Initialize(int bins, const std::string &meshName,
   int association, const std::string& arrayName, const std::string &fileName)
+{
+  DataRequirements reqs;
+  reqs.AddRequirement(meshName, association, arrayName);
+
+  this->Initialize(bins, reqs, fileName);
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::Initialize(int bins, const DataRequirements &reqs,
+  const std::string &fileName)
 {
   this->Bins = bins;
-  this->MeshName = meshName;
-  this->ArrayName = arrayName;
-  this->Association = association;
   this->FileName = fileName;
+
+  this->MeshNames.clear();
+  this->ArrayNames.clear();
+  this->Associations.clear();
+
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    ArrayRequirementsIterator ait =
+      reqs.GetArrayRequirementsIterator(mit.MeshName());
+
+    for (; ait; ++ait)
+      {
+      this->MeshNames.push_back(mit.MeshName());
+      this->Associations.push_back(ait.Association());
+      this->ArrayNames.push_back(ait.Array());
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::SetNumberOfThreads(int nThreads)
+{
+  this->Threads = nThreads;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::SetBatchSize(int batchSize)
+{
+  this->BatchSize = batchSize;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::SetSampleFraction(double fraction)
+{
+  this->SampleFraction = fraction;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::SetErrorBound(double bound)
+{
+  this->ErrorBound = bound;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::SetRange(double min, double max)
+{
+  this->Range[0] = min;
+  this->Range[1] = max;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::SetAccumulationSteps(int nSteps)
+{
+  this->AccumulationSteps = std::max(0, nSteps);
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::SetAsynchronous(bool async)
+{
+  this->Asynchronous = async;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::SetPhase(int phase)
+{
+  this->Phase = phase;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::SetPartialPrefix(const std::string &prefix)
+{
+  this->PartialPrefix = prefix;
+}
+
+//-----------------------------------------------------------------------------
+bool Histogram::InitializeBins()
+{
+  bool fixedRange = this->Range[0] <= this->Range[1];
+
+  if (this->Internals && (fixedRange || (this->AccumulationSteps != 1)))
+    return true;
+
+  unsigned int nArrays = this->ArrayNames.size();
+
+  delete this->Internals;
+  this->Internals = new VTKHistogram;
+  this->Internals->SetNumberOfThreads(this->Threads);
+  this->Internals->SetNumberOfArrays(nArrays);
+
+  if (!fixedRange)
+    return false;
+
+  for (unsigned int i = 0; i < nArrays; ++i)
+    this->Internals->SetRange(i, this->Range);
+
+  this->Internals->PreCompute(this->Bins);
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::EndStep(int step, double time)
+{
+  this->StepsAccumulated += 1;
+  this->LastStep = step;
+  this->LastTime = time;
+
+  if ((this->AccumulationSteps > 0) &&
+    (this->StepsAccumulated >= this->AccumulationSteps))
+    this->ReduceBins();
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::ReduceBins()
+{
+  TimeEvent<128> mark("Histogram::ReduceBins");
+
+  this->Internals->SetNumberOfSteps(this->StepsAccumulated);
+
+  if (this->Asynchronous)
+    this->Internals->StartPostCompute(this->GetCommunicator(), this->Bins,
+      this->LastStep, this->LastTime, this->MeshNames, this->ArrayNames,
+      this->FileName);
+  else
+    this->Internals->PostCompute(this->GetCommunicator(), this->Bins,
+      this->LastStep, this->LastTime, this->MeshNames, this->ArrayNames,
+      this->FileName);
+
+  this->Internals->ClearBins();
+  this->StepsAccumulated = 0;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::InitializeSampling(MeshMetadataMap &mdMap, int step)
+{
+  this->Internals->SetSampleSeed(step);
+
+  long nSamples = this->ErrorBound > 0.0 ?
+    Sampling::GetProportionSampleSize(this->ErrorBound) : 0;
+
+  unsigned int nArrays = this->ArrayNames.size();
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    double fraction = this->SampleFraction;
+
+    // the metadata holds the same global counts on all ranks, so each
+    // rank samples the same fraction of its blocks
+    MeshMetadataPtr mmd;
+    if ((nSamples > 0) && !mdMap.GetMeshMetadata(this->MeshNames[i], mmd))
+      {
+      long nValues = this->Associations[i] == vtkDataObject::POINT ?
+        mmd->NumPoints : mmd->NumCells;
+
+      if (nValues > 0)
+        fraction = Sampling::GetFraction(nSamples, nValues);
+      else
+        SENSEI_WARNING("Mesh \"" << this->MeshNames[i] << "\" metadata has no "
+          << VTKUtils::GetAttributesName(this->Associations[i]) << " count,"
+          " the error bound is not applied")
+      }
+
+    this->Internals->SetSampleFraction(i, fraction);
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -62,84 +319,168 @@ bool Histogram::Execute(DataAdaptor* data)
 {
   TimeEvent<128> mark("Histogram::Execute");
 
-  // see what the simulation is providing
+  // complete the reduction of the last step, it was overlapped with the
+  // simulation
+  if (this->Internals)
+    this->Internals->FinishPostCompute();
+
+  if (this->Phase == PartialResultsDataAdaptor::PHASE_GLOBAL)
+    return this->ExecuteGlobal(data);
+
+  if (this->BatchSize > 0)
+    return this->ExecuteBatches(data);
+
+  // see what the simulation is providing. the block extents of Cartesian
+  // meshes describe the ghost zones without a ghost array
+  MeshMetadataFlags flags;
+  flags.SetBlockArrayRange();
+  flags.SetBlockDecomp();
+  flags.SetBlockExtents();
+
   MeshMetadataMap mdMap;
-  if (mdMap.Initialize(data))
+  if (mdMap.Initialize(data, flags))
     {
     SENSEI_ERROR("Failed to get metadata")
     return false;
     }
 
-  delete this->Internals;
-  this->Internals = new VTKHistogram;
+  unsigned int nArrays = this->ArrayNames.size();
+
+  // the bins are kept across the steps of a window, and with a fixed range
+  // they are ready before the data is seen
+  bool haveBins = this->InitializeBins();
 
   // get the current time and step
   int step = data->GetDataTimeStep();
   double time = data->GetDataTime();
 
-  // get the mesh metadata object
-  MeshMetadataPtr mmd;
-  if (mdMap.GetMeshMetadata(this->MeshName, mmd))
-    {
-    SENSEI_ERROR("Failed to get metadata for mesh \"" << this->MeshName << "\"")
-    return false;
-    }
+  this->InitializeSampling(mdMap, step);
 
-  // get the mesh object
-  vtkDataObject* mesh = nullptr;
-  if (data->GetMesh(this->MeshName, true, mesh))
-    {
-    SENSEI_ERROR("Failed to get mesh \"" << this->MeshName << "\"")
-    return false;
-    }
+  // fetch each mesh once and add the arrays to it. errors are reported
+  // but processing continues so that all ranks take part in the
+  // reductions below
+  bool status = true;
+  std::map<std::string, vtkCompositeDataSetPtr> meshes;
+  std::vector<vtkCompositeDataSet*> arrayMesh(nArrays, nullptr);
+  std::map<std::string, VTKUtils::InteriorRangeMap> interiors;
 
-  if (!mesh)
+  for (unsigned int i = 0; i < nArrays; ++i)
     {
-    // it is not an necessarilly an error if all ranks do not have
-    // a dataset to process
-    this->Internals->PreCompute(this->GetCommunicator(), this->Bins);
+    const std::string &meshName = this->MeshNames[i];
 
-    this->Internals->PostCompute(this->GetCommunicator(), this->Bins,
-      step, time, this->MeshName, this->ArrayName, this->FileName);
+    std::map<std::string, vtkCompositeDataSetPtr>::iterator it =
+      meshes.find(meshName);
 
-    return true;
-    }
+    if (it == meshes.end())
+      {
+      it = meshes.insert(std::make_pair(meshName,
+        vtkCompositeDataSetPtr())).first;
 
-  // add the array
-  if (data->AddArray(mesh, this->MeshName, this->Association, this->ArrayName))
-    {
-    // it is an error if we try to compute a histogram over a non
-    // existant array
-    SENSEI_ERROR(<< data->GetClassName() << " failed to add "
-      << (this->Association == vtkDataObject::POINT ? "point" : "cell")
-      << " data array \""  << this->ArrayName << "\"")
+      // get the mesh metadata object
+      MeshMetadataPtr mmd;
+      if (mdMap.GetMeshMetadata(meshName, mmd))
+        {
+        SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
+        status = false;
+        continue;
+        }
 
-    this->Internals->PreCompute(this->GetCommunicator(), this->Bins);
+      // get the mesh object
+      vtkDataObject* dobj = nullptr;
+      if (data->GetMesh(meshName, true, dobj))
+        {
+        SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+        status = false;
+        continue;
+        }
 
-    this->Internals->PostCompute(this->GetCommunicator(), this->Bins,
-      step, time, this->MeshName, this->ArrayName, this->FileName);
+      // it is not an necessarilly an error if all ranks do not have
+      // a dataset to process
+      if (!dobj)
+        continue;
 
-    return false;
-    }
+      vtkCompositeDataSetPtr mesh =
+        VTKUtils::AsCompositeData(this->GetCommunicator(), dobj, true);
 
-  // add the ghost zones
-  if ((mmd->NumGhostCells || VTKUtils::AMR(mmd)) &&
-    data->AddGhostCellsArray(mesh, this->MeshName))
-    {
-    SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost cells.")
-    return false;
-    }
+      // the ghost zones of Cartesian blocks are described by index ranges
+      // and the ghost arrays are not needed
+      bool haveInteriors = (mmd->NumGhostCells || mmd->NumGhostNodes) &&
+        !VTKUtils::GetInteriorRanges(mmd, interiors[meshName]);
 
-  if (mmd->NumGhostNodes && data->AddGhostNodesArray(mesh, this->MeshName))
-    {
-    SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost nodes.")
-    return false;
+      if (!haveInteriors)
+        {
+        interiors.erase(meshName);
+
+        // add the ghost zones
+        if ((mmd->NumGhostCells || VTKUtils::AMR(mmd)) &&
+          data->AddGhostCellsArray(mesh, meshName))
+          {
+          SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost cells.")
+          status = false;
+          continue;
+          }
+
+        if (mmd->NumGhostNodes && data->AddGhostNodesArray(mesh, meshName))
+          {
+          SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost nodes.")
+          status = false;
+          continue;
+          }
+        }
+
+      it->second = mesh;
+      }
+
+    vtkCompositeDataSet *mesh = it->second;
+    if (!mesh)
+      continue;
+
+    // add the array
+    if (data->AddArray(mesh, meshName, this->Associations[i],
+      this->ArrayNames[i]))
+      {
+      // it is an error if we try to compute a histogram over a non
+      // existant array
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add "
+        << VTKUtils::GetAttributesName(this->Associations[i])
+        << " data array \""  << this->ArrayNames[i] << "\"")
+      status = false;
+      continue;
+      }
+
+    arrayMesh[i] = mesh;
     }
 
-  if (vtkCompositeDataSet* cd = dynamic_cast<vtkCompositeDataSet*>(mesh))
+  // compute local histogram ranges. when the simulation provided the
+  // block ranges in the metadata the pass over the data is skipped
+  for (unsigned int i = 0; i < nArrays; ++i)
     {
+    if (haveBins || !arrayMesh[i])
+      continue;
+
+    std::map<std::string, VTKUtils::InteriorRangeMap>::iterator iit =
+      interiors.find(this->MeshNames[i]);
+
+    const VTKUtils::InteriorRangeMap *interiorMap =
+      iit == interiors.end() ? nullptr : &iit->second;
+
+    MeshMetadataPtr mmd;
+    if (!mdMap.GetMeshMetadata(this->MeshNames[i], mmd))
+      {
+      std::vector<int> blockIds;
+      GetBlockIds(arrayMesh[i], blockIds);
+
+      double mdRange[2];
+      if (GetMetadataRange(mmd, this->ArrayNames[i], this->Associations[i],
+        blockIds, mdRange))
+        {
+        this->Internals->AddRange(i, mdRange);
+        continue;
+        }
+      }
+
     vtkSmartPointer<vtkCompositeDataIterator> iter;
-    iter.TakeReference(cd->NewIterator());
+    iter.TakeReference(arrayMesh[i]->NewIterator());
 
     for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
       {
@@ -147,88 +488,477 @@ bool Histogram::Execute(DataAdaptor* data)
       vtkDataObject *curObj = iter->GetCurrentDataObject();
 
       // get the array to compute histogram for
-      vtkDataArray* array = this->GetArray(curObj, this->ArrayName);
+      vtkDataArray* array = this->GetArray(curObj,
+        this->Associations[i], this->ArrayNames[i]);
       if (!array)
         {
         SENSEI_WARNING("Dataset " << iter->GetCurrentFlatIndex()
-          << " has no array named \"" << this->ArrayName << "\"")
+          << " has no array named \"" << this->ArrayNames[i] << "\"")
+        continue;
+        }
+
+      // visit the interior of Cartesian blocks
+      const VTKUtils::InteriorRange *interior = interiorMap ?
+        VTKUtils::FindInteriorRange(*interiorMap,
+          VTKUtils::GetBlockId(arrayMesh[i], iter),
+          this->Associations[i], array) : nullptr;
+
+      if (interior)
+        {
+        this->Internals->AddRange(i, array, *interior);
         continue;
         }
 
       // and get the ghost cell array
       vtkUnsignedCharArray *ghostArray = dynamic_cast<vtkUnsignedCharArray*>(
-        this->GetArray(curObj, this->GetGhostArrayName()));
+        this->GetArray(curObj, this->Associations[i], this->GetGhostArrayName()));
 
-      // compute local histogram range
-      this->Internals->AddRange(array, ghostArray);
+      this->Internals->AddRange(i, array, ghostArray);
       }
+    }
 
-    // compute global histogram range
+  // compute global histogram ranges
+  if (!haveBins)
     this->Internals->PreCompute(this->GetCommunicator(), this->Bins);
 
+  // compute local histograms
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    if (!arrayMesh[i])
+      continue;
+
+    std::map<std::string, VTKUtils::InteriorRangeMap>::iterator iit =
+      interiors.find(this->MeshNames[i]);
+
+    const VTKUtils::InteriorRangeMap *interiorMap =
+      iit == interiors.end() ? nullptr : &iit->second;
+
+    vtkSmartPointer<vtkCompositeDataIterator> iter;
+    iter.TakeReference(arrayMesh[i]->NewIterator());
+
     for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
       {
-      // get the local mesh
       vtkDataObject *curObj = iter->GetCurrentDataObject();
-      // get the array to compute histogram for
-      vtkDataArray* array = this->GetArray(curObj, this->ArrayName);
+
+      vtkDataArray* array = this->GetArray(curObj,
+        this->Associations[i], this->ArrayNames[i]);
       if (!array)
-        {
-        SENSEI_WARNING("Dataset " << iter->GetCurrentFlatIndex()
-          << " has no array named \"" << this->ArrayName << "\"")
         continue;
+
+      if (interiorMap)
+        {
+        const VTKUtils::InteriorRange *interior =
+          VTKUtils::FindInteriorRange(*interiorMap,
+            VTKUtils::GetBlockId(arrayMesh[i], iter), this->Associations[i],
+            array);
+
+        if (interior)
+          {
+          this->Internals->Compute(i, array, *interior);
+          continue;
+          }
+
+        SENSEI_WARNING("The extent of dataset " << iter->GetCurrentFlatIndex()
+          << " does not match the size of array \"" << this->ArrayNames[i]
+          << "\", its ghost values are included")
         }
 
-      // and get the ghost cell array
       vtkUnsignedCharArray *ghostArray = dynamic_cast<vtkUnsignedCharArray*>(
-        this->GetArray(curObj, this->GetGhostArrayName()));
+        this->GetArray(curObj, this->Associations[i], this->GetGhostArrayName()));
 
-      // compute local histogram
-      this->Internals->Compute(array, ghostArray);
+      this->Internals->Compute(i, array, ghostArray);
       }
+    }
 
-    // compute the global histogram
-    this->Internals->PostCompute(this->GetCommunicator(), this->Bins,
-      step, time, this->MeshName, this->ArrayName, this->FileName);
+  // publish the bins for the global phase
+  if (this->Phase == PartialResultsDataAdaptor::PHASE_LOCAL)
+    return !this->PublishBins(data) && status;
+
+  // compute the global histograms, or add the step to the window
+  this->EndStep(step, time);
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+bool Histogram::ExecuteBatches(DataAdaptor* data)
+{
+  TimeEvent<128> mark("Histogram::ExecuteBatches");
+
+  // see what the simulation is providing
+  MeshMetadataFlags flags;
+  flags.SetBlockDecomp();
+  flags.SetBlockArrayRange();
+
+  MeshMetadataMap mdMap;
+  if (mdMap.Initialize(data, flags))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return false;
     }
-  else
+
+  unsigned int nArrays = this->ArrayNames.size();
+
+  // the bins are kept across the steps of a window, and with a fixed range
+  // they are ready before the data is seen
+  bool haveBins = this->InitializeBins();
+
+  int step = data->GetDataTimeStep();
+  double time = data->GetDataTime();
+
+  this->InitializeSampling(mdMap, step);
+
+  BlockStream stream;
+  stream.SetCommunicator(this->GetCommunicator());
+  stream.SetBatchSize(this->BatchSize);
+
+  // the arrays of each mesh, and the arrays whose range is not in the
+  // metadata
+  struct MeshArrays
+  {
+    MeshMetadataPtr Metadata;
+    std::vector<unsigned int> Ids;
+    std::vector<unsigned int> RangeIds;
+  };
+
+  std::map<std::string, MeshArrays> meshes;
+  for (unsigned int i = 0; i < nArrays; ++i)
+    meshes[this->MeshNames[i]].Ids.push_back(i);
+
+  // the blocks are visited once to compute the range of the arrays that
+  // need it and once more to compute the bins. visits are collective, a
+  // rank that fails keeps visiting and the status is reduced before each
+  // collective phase so that all ranks end the execution together
+  int ierr = 0;
+  std::map<std::string, MeshArrays>::iterator mit = meshes.begin();
+  std::map<std::string, MeshArrays>::iterator mend = meshes.end();
+  for (; mit != mend; ++mit)
     {
-    vtkDataArray* array = this->GetArray(mesh, this->ArrayName);
-    if (!array)
+    const std::string &meshName = mit->first;
+    MeshArrays &mesh = mit->second;
+
+    std::vector<int> blockIds;
+    int mdErr = 0;
+    if (mdMap.GetMeshMetadata(meshName, mesh.Metadata) ||
+      stream.GetLocalBlockIds(mesh.Metadata, blockIds))
       {
-      int rank = 0;
-      MPI_Comm_rank(this->GetCommunicator(), &rank);
+      SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
+      mdErr = -1;
+      }
 
-      SENSEI_WARNING("Dataset " << rank << " has no array named \""
-        << this->ArrayName << "\"")
+    // the mesh can't be visited without its metadata
+    MPI_Allreduce(MPI_IN_PLACE, &mdErr, 1, MPI_INT, MPI_MIN,
+      this->GetCommunicator());
+    if (mdErr)
+      return false;
 
-      this->Internals->PreCompute(this->GetCommunicator(), this->Bins);
+    if (haveBins)
+      continue;
 
-      this->Internals->PostCompute(this->GetCommunicator(), this->Bins,
-        step, time, this->MeshName, this->ArrayName, this->FileName);
+    BlockStream::ArrayMap rangeArrays;
+    for (unsigned int i : mesh.Ids)
+      {
+      double mdRange[2];
+      if (GetMetadataRange(mesh.Metadata, this->ArrayNames[i],
+        this->Associations[i], blockIds, mdRange))
+        {
+        this->Internals->AddRange(i, mdRange);
+        continue;
+        }
+
+      mesh.RangeIds.push_back(i);
+      rangeArrays[this->Associations[i]].push_back(this->ArrayNames[i]);
       }
-    else
+
+    // all ranks take part in the visit if any rank needs it
+    int needRange = !mesh.RangeIds.empty();
+    MPI_Allreduce(MPI_IN_PLACE, &needRange, 1, MPI_INT, MPI_MAX,
+      this->GetCommunicator());
+
+    if (needRange && stream.Visit(data, mesh.Metadata, true, rangeArrays,
+      [&](vtkCompositeDataSet *batch) -> int
       {
-      vtkUnsignedCharArray *ghostArray = dynamic_cast<vtkUnsignedCharArray*>(
-        this->GetArray(mesh, this->GetGhostArrayName()));
+      this->VisitArrays(batch, mesh.RangeIds,
+        [&](unsigned int i, vtkDataArray *array, vtkUnsignedCharArray *ghostArray)
+        { this->Internals->AddRange(i, array, ghostArray); });
+      return 0;
+      }))
+      {
+      SENSEI_ERROR("Failed to compute the range of arrays on mesh \""
+        << meshName << "\"")
+      ierr = -1;
+      }
+    }
+
+  MPI_Allreduce(MPI_IN_PLACE, &ierr, 1, MPI_INT, MPI_MIN,
+    this->GetCommunicator());
+  if (ierr)
+    return false;
+
+  // compute global histogram ranges
+  if (!haveBins)
+    this->Internals->PreCompute(this->GetCommunicator(), this->Bins);
+
+  // compute local histograms
+  for (mit = meshes.begin(); mit != mend; ++mit)
+    {
+    const std::string &meshName = mit->first;
+    MeshArrays &mesh = mit->second;
 
-      this->Internals->AddRange(array, ghostArray);
-      this->Internals->PreCompute(this->GetCommunicator(), this->Bins);
-      this->Internals->Compute(array, ghostArray);
+    BlockStream::ArrayMap arrays;
+    for (unsigned int i : mesh.Ids)
+      arrays[this->Associations[i]].push_back(this->ArrayNames[i]);
 
-      this->Internals->PostCompute(this->GetCommunicator(), this->Bins,
-        step, time, this->MeshName, this->ArrayName, this->FileName);
+    if (stream.Visit(data, mesh.Metadata, true, arrays,
+      [&](vtkCompositeDataSet *batch) -> int
+      {
+      this->VisitArrays(batch, mesh.Ids,
+        [&](unsigned int i, vtkDataArray *array, vtkUnsignedCharArray *ghostArray)
+        { this->Internals->Compute(i, array, ghostArray); });
+      return 0;
+      }))
+      {
+      SENSEI_ERROR("Failed to compute the histograms of arrays on mesh \""
+        << meshName << "\"")
+      ierr = -1;
       }
     }
 
-  mesh->Delete();
+  MPI_Allreduce(MPI_IN_PLACE, &ierr, 1, MPI_INT, MPI_MIN,
+    this->GetCommunicator());
+  if (ierr)
+    return false;
+
+  if (this->Phase == PartialResultsDataAdaptor::PHASE_LOCAL)
+    return !this->PublishBins(data);
+
+  // compute the global histograms, or add the step to the window
+  this->EndStep(step, time);
+
   return true;
 }
 
 //-----------------------------------------------------------------------------
-vtkDataArray* Histogram::GetArray(vtkDataObject* dobj, const std::string& arrayname)
+int Histogram::PublishBins(DataAdaptor* data)
 {
-  if (vtkFieldData* fd = dobj->GetAttributesAsFieldData(this->Association))
+  TimeEvent<128> mark("Histogram::PublishBins");
+
+  PartialResultsDataAdaptor *partials =
+    dynamic_cast<PartialResultsDataAdaptor*>(data);
+
+  unsigned int nArrays = this->ArrayNames.size();
+  int status = 0;
+
+  if (!partials)
+    {
+    SENSEI_ERROR("The local phase of the histogram publishes its bins on a"
+      " PartialResultsDataAdaptor, but was given a " << data->GetClassName())
+    status = -1;
+    nArrays = 0;
+    }
+
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    double range[2];
+    this->Internals->GetRange(i, range);
+
+    std::vector<unsigned int> hist;
+    this->Internals->GetLocalHistogram(i, hist);
+
+    // the cells of the block are the bins
+    vtkUnsignedIntArray *counts = vtkUnsignedIntArray::New();
+    counts->SetName("count");
+    counts->SetNumberOfTuples(this->Bins);
+    std::copy(hist.begin(), hist.end(), counts->GetPointer(0));
+
+    vtkImageData *block = vtkImageData::New();
+    block->SetDimensions(this->Bins + 1, 1, 1);
+    block->SetOrigin(range[0], 0.0, 0.0);
+    block->SetSpacing((range[1] - range[0]) / this->Bins, 1.0, 1.0);
+    block->GetCellData()->AddArray(counts);
+    counts->Delete();
+
+    vtkCompositeDataSetPtr mesh =
+      VTKUtils::AsCompositeData(this->GetCommunicator(), block, true);
+
+    partials->SetPartialResult(PartialResultsDataAdaptor::GetMeshName(
+      this->PartialPrefix, this->MeshNames[i], this->ArrayNames[i]), mesh);
+    }
+
+  // the global phase accumulates the steps
+  this->Internals->ClearBins();
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+bool Histogram::ExecuteGlobal(DataAdaptor* data)
+{
+  TimeEvent<128> mark("Histogram::ExecuteGlobal");
+
+  unsigned int nArrays = this->ArrayNames.size();
+
+  bool haveBins = this->InitializeBins();
+
+  int step = data->GetDataTimeStep();
+  double time = data->GetDataTime();
+
+  // fetch the partial results of each array. errors are reported but
+  // processing continues so that all ranks take part in the reductions
+  bool status = true;
+  std::vector<vtkCompositeDataSetPtr> partials(nArrays);
+
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    std::string meshName = PartialResultsDataAdaptor::GetMeshName(
+      this->PartialPrefix, this->MeshNames[i], this->ArrayNames[i]);
+
+    vtkDataObject* dobj = nullptr;
+    if (data->GetMesh(meshName, false, dobj))
+      {
+      SENSEI_ERROR("Failed to get the partial result \"" << meshName << "\"")
+      status = false;
+      continue;
+      }
+
+    // this rank was not sent any of the blocks
+    if (!dobj)
+      continue;
+
+    vtkCompositeDataSetPtr mesh =
+      VTKUtils::AsCompositeData(this->GetCommunicator(), dobj, true);
+
+    if (data->AddArray(mesh, meshName, vtkDataObject::CELL, "count"))
+      {
+      SENSEI_ERROR("Failed to add the bins of the partial result \""
+        << meshName << "\"")
+      status = false;
+      continue;
+      }
+
+    partials[i] = mesh;
+    }
+
+  // visit the bins of each block, with the range they were binned over
+  using BinVisitor = std::function<void(unsigned int, const double*,
+    vtkDataArray*)>;
+
+  auto visitBins = [&](const BinVisitor &visitor)
+    {
+    for (unsigned int i = 0; i < nArrays; ++i)
+      {
+      if (!partials[i])
+        continue;
+
+      vtkSmartPointer<vtkCompositeDataIterator> iter;
+      iter.TakeReference(partials[i]->NewIterator());
+
+      for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
+        {
+        vtkImageData *block =
+          dynamic_cast<vtkImageData*>(iter->GetCurrentDataObject());
+
+        vtkDataArray *counts = block ?
+          this->GetArray(block, vtkDataObject::CELL, "count") : nullptr;
+
+        if (!counts)
+          {
+          SENSEI_ERROR("Block " << iter->GetCurrentFlatIndex() - 1
+            << " of the partial result of \"" << this->ArrayNames[i]
+            << "\" has no bins")
+          status = false;
+          continue;
+          }
+
+        int dims[3];
+        block->GetDimensions(dims);
+
+        double range[2];
+        range[0] = block->GetOrigin()[0];
+        range[1] = range[0] + block->GetSpacing()[0] * (dims[0] - 1);
+
+        visitor(i, range, counts);
+        }
+      }
+    };
+
+  // the range of the bins is that of the partial results
+  if (!haveBins)
+    {
+    visitBins([&](unsigned int i, const double *range, vtkDataArray *)
+      { this->Internals->AddRange(i, range); });
+
+    this->Internals->PreCompute(this->GetCommunicator(), this->Bins);
+    }
+
+  visitBins([&](unsigned int i, const double *range, vtkDataArray *counts)
+    {
+    double grange[2];
+    this->Internals->GetRange(i, grange);
+
+    double tol = 1.0e-6 * std::max(std::abs(grange[1] - grange[0]),
+      std::numeric_limits<double>::min());
+
+    if ((counts->GetNumberOfTuples() != this->Bins) ||
+      (std::abs(range[0] - grange[0]) > tol) ||
+      (std::abs(range[1] - grange[1]) > tol))
+      {
+      SENSEI_ERROR("The partial result of \"" << this->ArrayNames[i]
+        << "\" has " << counts->GetNumberOfTuples() << " bins over ["
+        << range[0] << ", " << range[1] << "] rather than " << this->Bins
+        << " over [" << grange[0] << ", " << grange[1] << "]")
+      status = false;
+      return;
+      }
+
+    std::vector<unsigned int> hist(this->Bins);
+    for (int j = 0; j < this->Bins; ++j)
+      hist[j] = static_cast<unsigned int>(counts->GetComponent(j, 0));
+
+    this->Internals->AddHistogram(i, hist);
+    });
+
+  // compute the global histograms, or add the step to the window
+  this->EndStep(step, time);
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+void Histogram::VisitArrays(vtkCompositeDataSet *mesh,
+  const std::vector<unsigned int> &ids, const ArrayVisitor &visitor)
+{
+  vtkSmartPointer<vtkCompositeDataIterator> iter;
+  iter.TakeReference(mesh->NewIterator());
+
+  for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
+    {
+    vtkDataObject *curObj = iter->GetCurrentDataObject();
+
+    for (unsigned int i : ids)
+      {
+      vtkDataArray* array = this->GetArray(curObj,
+        this->Associations[i], this->ArrayNames[i]);
+      if (!array)
+        {
+        SENSEI_WARNING("Dataset " << iter->GetCurrentFlatIndex()
+          << " has no array named \"" << this->ArrayNames[i] << "\"")
+        continue;
+        }
+
+      vtkUnsignedCharArray *ghostArray = dynamic_cast<vtkUnsignedCharArray*>(
+        this->GetArray(curObj, this->Associations[i], this->GetGhostArrayName()));
+
+      visitor(i, array, ghostArray);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkDataArray* Histogram::GetArray(vtkDataObject* dobj, int association,
+  const std::string& arrayname)
+{
+  if (vtkFieldData* fd = dobj->GetAttributesAsFieldData(association))
     {
     return fd->GetArray(arrayname.c_str());
     }
@@ -238,16 +968,42 @@ vtkDataArray* Histogram::GetArray(vtkDataObject* dobj, const std::string& arrayn
 //-----------------------------------------------------------------------------
 int Histogram::GetHistogram(double &min, double &max,
   std::vector<unsigned int> &bins)
+{
+  return this->GetHistogram(0, min, max, bins);
+}
+
+//-----------------------------------------------------------------------------
+int Histogram::GetHistogram(unsigned int id, double &min, double &max,
+  std::vector<unsigned int> &bins)
+{
+  if (!this->Internals)
+    return -1;
+
+  return this->Internals->GetHistogram(this->GetCommunicator(),
+    id, min, max, bins);
+}
+
+//-----------------------------------------------------------------------------
+int Histogram::GetConfidenceBounds(unsigned int id,
+  std::vector<double> &lower, std::vector<double> &upper)
 {
   if (!this->Internals)
     return -1;
 
-  return this->Internals->GetHistogram(this->GetCommunicator(), min, max, bins);
+  return this->Internals->GetConfidenceBounds(this->GetCommunicator(),
+    id, lower, upper);
 }
 
 //-----------------------------------------------------------------------------
 int Histogram::Finalize()
 {
+  // reduce the steps of the last, incomplete, window
+  if (this->Internals && (this->StepsAccumulated > 0))
+    this->ReduceBins();
+
+  if (this->Internals)
+    this->Internals->FinishPostCompute();
+
   delete this->Internals;
   this->Internals = nullptr;
   return 0;
@@ -2,19 +2,41 @@
 #define sensei_Histogram_h
 
 #include "AnalysisAdaptor.h"
+#include "DataRequirements.h"
 #include <mpi.h>
+#include <functional>
 #include <vector>
+#include <string>
 
 class vtkDataObject;
 class vtkDataArray;
+class vtkCompositeDataSet;
+class vtkUnsignedCharArray;
 
 namespace sensei
 {
 
 class VTKHistogram;
+class MeshMetadataMap;
 
 /// @class Histogram
 /// @brief Computes a parallel histogram
+///
+/// Histograms of any number of arrays on any number of meshes may be
+/// computed by a single instance. Each mesh is fetched once, and the ranges
+/// and bins of all of the arrays are each computed in a single reduction.
+///
+/// The bins may be accumulated over a window of steps and reduced once per
+/// window, or once at Finalize. Accumulated bins have a range fixed for the
+/// run, given by SetRange or else found on the first step, and values
+/// outside of it are counted in the first and last bins.
+///
+/// The reduction may be left in flight when Execute returns, overlapping
+/// it with the simulation. It is completed, and the result written, at the
+/// next Execute, at Finalize, or when the result is requested.
+///
+/// The histogram may be split between the simulation and an in transit
+/// end point, see SetPhase, so that bins rather than fields are shipped.
 class Histogram : public AnalysisAdaptor
 {
 public:
@@ -25,14 +47,86 @@ public:
     int association, const std::string& arrayName,
     const std::string &fileName);
 
+  // compute histograms of each of the arrays named in the requirements
+  void Initialize(int bins, const DataRequirements &reqs,
+    const std::string &fileName);
+
+  // set the number of threads used to compute the local histogram.
+  // the threads are those of the TaskRuntime, a value less than 1 uses
+  // all of them. the default is 1.
+  void SetNumberOfThreads(int nThreads);
+
+  // set the number of blocks fetched from the simulation at a time. a
+  // value less than 1, the default, fetches the whole mesh. when blocks
+  // are fetched in batches each batch is visited twice, once for the range
+  // and once for the bins, unless the simulation provides the block array
+  // ranges in the metadata. see BlockStream.
+  void SetBatchSize(int batchSize);
+
+  // set the fraction, in (0, 1], of the values sampled. the range and bins
+  // are computed from a stratified sample of each block, with a sample
+  // size in proportion to the block's size, and the counts are estimates
+  // reported with their 95% confidence bounds. the default, 1, computes
+  // the exact histogram.
+  void SetSampleFraction(double fraction);
+
+  // set the sample size from the largest error, as a fraction of the
+  // values, of the 95% bounds on the fraction of values in any bin. the
+  // sample size is independent of the size of the data, the fraction
+  // follows from the number of cells or points in the mesh metadata. a
+  // value of 0, the default, uses the sample fraction.
+  void SetErrorBound(double bound);
+
+  // set a range of the bins, used by all of the arrays for the whole run.
+  // the range is not computed and its reduction is skipped. values outside
+  // of it are counted in the first and last bins. by default the range is
+  // that of the data.
+  void SetRange(double min, double max);
+
+  // set the number of steps whose bins are accumulated before they are
+  // reduced and written. the result is written with the last step of the
+  // window. a value of 0 accumulates all steps and reduces them once in
+  // Finalize. the default, 1, reduces each step.
+  void SetAccumulationSteps(int nSteps);
+
+  // when set the reduction of the bins is posted and Execute returns
+  // without waiting for it. the default is off.
+  void SetAsynchronous(bool async);
+
+  // split the histogram between the simulation and an end point. in the
+  // local phase, run by the simulation, the global range is found and the
+  // local bins are published each step on the PartialResultsDataAdaptor
+  // passed to Execute, as a mesh per array with a vtkImageData block per
+  // rank whose cells are the bins, holding a "count" array. in the global
+  // phase, run on the end point, the blocks are merged and the result is
+  // reduced and written as usual. the bins must be the same in both
+  // phases and the local bins are not sampled. the global phase may
+  // accumulate steps when the range is fixed in both phases. the
+  // default, PartialResultsDataAdaptor::PHASE_ALL, does both in place.
+  void SetPhase(int phase);
+
+  // set the prefix of the names of the partial result meshes, see
+  // PartialResultsDataAdaptor::GetMeshName. the default is "histogram".
+  void SetPartialPrefix(const std::string &prefix);
+
   bool Execute(DataAdaptor* data) override;
 
   int Finalize() override;
 
-  // return the last computed histogram
+  // return the last computed histogram of the first array
   int GetHistogram(double &min, double &max,
     std::vector<unsigned int> &bins);
 
+  // return the last computed histogram of the id'th array. arrays are
+  // ordered by mesh name and association, then in the order given
+  int GetHistogram(unsigned int id, double &min, double &max,
+    std::vector<unsigned int> &bins);
+
+  // return the 95% confidence bounds of the last computed counts of the
+  // id'th array. when the array is not sampled the bounds are the counts
+  int GetConfidenceBounds(unsigned int id, std::vector<double> &lower,
+    std::vector<double> &upper);
+
 protected:
   Histogram();
   ~Histogram();
@@ -40,14 +134,60 @@ protected:
   Histogram(const Histogram&) = delete;
   void operator=(const Histogram&) = delete;
 
+  // compute the histograms visiting the blocks in batches
+  bool ExecuteBatches(DataAdaptor* data);
+
+  // merge the bins published by the local phase
+  bool ExecuteGlobal(DataAdaptor* data);
+
+  // publish the local bins of each array for the global phase, then
+  // clear them
+  int PublishBins(DataAdaptor* data);
+
+  // pass the sample fraction of each array and the sample seed to the
+  // internals
+  void InitializeSampling(MeshMetadataMap &mdMap, int step);
+
+  // prepare the internals for a step. returns true when the bins exist,
+  // kept from an earlier step or over the fixed range, and the range need
+  // not be computed
+  bool InitializeBins();
+
+  // count the step in the window, reducing the bins when it is complete
+  void EndStep(int step, double time);
+
+  // reduce and write the bins accumulated so far, then clear them
+  void ReduceBins();
+
+  // call the visitor with each of the listed arrays, and the ghost array,
+  // on each of the blocks of mesh
+  using ArrayVisitor = std::function<void(unsigned int,
+    vtkDataArray*, vtkUnsignedCharArray*)>;
+
+  void VisitArrays(vtkCompositeDataSet *mesh,
+    const std::vector<unsigned int> &ids, const ArrayVisitor &visitor);
+
   static const char *GetGhostArrayName();
-  vtkDataArray* GetArray(vtkDataObject* dobj, const std::string& arrayname);
+  vtkDataArray* GetArray(vtkDataObject* dobj, int association,
+    const std::string& arrayname);
 
   int Bins;
-  std::string MeshName;
-  std::string ArrayName;
-  int Association;
+  std::vector<std::string> MeshNames;  // mesh of each array
+  std::vector<std::string> ArrayNames;
+  std::vector<int> Associations;
   std::string FileName;
+  int Threads;
+  int BatchSize;
+  double SampleFraction;
+  double ErrorBound;
+  double Range[2];
+  int AccumulationSteps;
+  bool Asynchronous;
+  int Phase;
+  std::string PartialPrefix;
+  int StepsAccumulated;
+  int LastStep;
+  double LastTime;
 
   VTKHistogram *Internals;
 
@@ -3,6 +3,8 @@
 #include "Partitioner.h"
 #include "ConfigurablePartitioner.h"
 #include "BlockPartitioner.h"
+#include "DataRequirements.h"
+#include "VTKUtils.h"
 #include "Error.h"
 #include "Profiler.h"
 
@@ -12,6 +14,7 @@
 #include <vtkObjectFactory.h>
 
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 #include <utility>
@@ -21,10 +24,19 @@ namespace sensei
 
 struct InTransitDataAdaptor::InternalsType
 {
-  InternalsType() : Part(BlockPartitioner::New()) {}
+  InternalsType() : Part(BlockPartitioner::New()),
+    StepPolicy(STEP_POLICY_ALL), StepPolicyCount(1), NumProcessed(0),
+    NumSkipped(0), PartitionedBlocks(false) {}
+
   ~InternalsType() {}
 
   PartitionerPtr Part;
+  int StepPolicy;
+  unsigned int StepPolicyCount;
+  unsigned long NumProcessed;
+  unsigned long NumSkipped;
+  bool PartitionedBlocks;
+  DataRequirements Requirements;
   std::map<unsigned int, MeshMetadataPtr> ReceiverMetadata;
   std::string ConnectionInfo;
 };
@@ -67,6 +79,41 @@ int InTransitDataAdaptor::Initialize(pugi::xml_node &node)
     this->Internals->Part = tmp;
     }
 
+  // look for the presense of optional data requirements
+  pugi::xml_node reqNode = node.child("data_requirements");
+  if (reqNode)
+    {
+    DataRequirements reqs;
+    if (reqs.Initialize(reqNode))
+      {
+      SENSEI_ERROR("Failed to initialize data requirements from XML")
+      return -1;
+      }
+    this->Internals->Requirements = reqs;
+    }
+
+  // look for an optional step policy
+  std::string policy = node.attribute("step_policy").as_string("all");
+  unsigned int count = node.attribute("step_count").as_uint(1);
+
+  if (policy == "all")
+    this->SetStepPolicy(STEP_POLICY_ALL, count);
+  else if (policy == "latest")
+    this->SetStepPolicy(STEP_POLICY_LATEST, count);
+  else if (policy == "every_kth")
+    this->SetStepPolicy(STEP_POLICY_EVERY_KTH, count);
+  else if (policy == "block")
+    this->SetStepPolicy(STEP_POLICY_BLOCK, count);
+  else
+    {
+    SENSEI_ERROR("Invalid step_policy \"" << policy << "\". Valid values"
+      " are all, latest, every_kth, and block")
+    return -1;
+    }
+
+  // hold only the local blocks
+  this->SetPartitionedBlocks(node.attribute("partitioned_blocks").as_int(0));
+
   return 0;
 }
 
@@ -111,4 +158,188 @@ int InTransitDataAdaptor::SetReceiverMeshMetadata(unsigned int id,
   this->Internals->ReceiverMetadata[id] = metadata;
   return 0;
 }
+
+//----------------------------------------------------------------------------
+void InTransitDataAdaptor::SetDataRequirements(const DataRequirements &reqs)
+{
+  this->Internals->Requirements = reqs;
+}
+
+//----------------------------------------------------------------------------
+const DataRequirements &InTransitDataAdaptor::GetDataRequirements() const
+{
+  return this->Internals->Requirements;
+}
+
+//----------------------------------------------------------------------------
+void InTransitDataAdaptor::SetStepPolicy(int policy, unsigned int count)
+{
+  this->Internals->StepPolicy = policy;
+  this->Internals->StepPolicyCount = count ? count : 1;
+}
+
+//----------------------------------------------------------------------------
+int InTransitDataAdaptor::GetStepPolicy() const
+{
+  return this->Internals->StepPolicy;
+}
+
+//----------------------------------------------------------------------------
+unsigned int InTransitDataAdaptor::GetStepPolicyCount() const
+{
+  return this->Internals->StepPolicyCount;
+}
+
+//----------------------------------------------------------------------------
+void InTransitDataAdaptor::SetPartitionedBlocks(bool val)
+{
+  this->Internals->PartitionedBlocks = val;
+}
+
+//----------------------------------------------------------------------------
+bool InTransitDataAdaptor::GetPartitionedBlocks() const
+{
+  return this->Internals->PartitionedBlocks;
+}
+
+//----------------------------------------------------------------------------
+void InTransitDataAdaptor::GetStepCounters(unsigned long &numProcessed,
+  unsigned long &numSkipped) const
+{
+  numProcessed = this->Internals->NumProcessed;
+  numSkipped = this->Internals->NumSkipped;
+}
+
+//----------------------------------------------------------------------------
+int InTransitDataAdaptor::PostResult(const std::string &tag,
+  const std::string &)
+{
+  SENSEI_ERROR(<< this->GetClassName() << " has no return channel to the"
+    " simulation. The result \"" << tag << "\" was not sent")
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+unsigned int InTransitDataAdaptor::GetStepStride() const
+{
+  if (this->Internals->StepPolicy == STEP_POLICY_EVERY_KTH)
+    return this->Internals->StepPolicyCount;
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void InTransitDataAdaptor::CountSteps(unsigned long numProcessed,
+  unsigned long numSkipped)
+{
+  this->Internals->NumProcessed += numProcessed;
+  this->Internals->NumSkipped += numSkipped;
+}
+
+//----------------------------------------------------------------------------
+int InTransitDataAdaptor::ApplyDataRequirements(MeshMetadataPtr &metadata)
+{
+  const DataRequirements &reqs = this->Internals->Requirements;
+  if (reqs.Empty() || !metadata)
+    return 0;
+
+  TimeEvent<128> mark("InTransitDataAdaptor::ApplyDataRequirements");
+
+  // gather the required arrays
+  std::set<std::pair<int, std::string>> required;
+  ArrayRequirementsIterator ait =
+    reqs.GetArrayRequirementsIterator(metadata->MeshName);
+  for (; ait; ++ait)
+    required.insert(std::make_pair(ait.Association(), ait.Array()));
+
+  // select the arrays to keep
+  std::vector<int> keep;
+  for (int i = 0; i < metadata->NumArrays; ++i)
+    {
+    if (required.count(std::make_pair(metadata->ArrayCentering[i],
+      metadata->ArrayName[i])))
+      keep.push_back(i);
+    }
+
+  if (int(keep.size()) == metadata->NumArrays)
+    return 0;
+
+  // copy the metadata and remove the others
+  MeshMetadataPtr md = metadata->NewCopy();
+
+  int nKeep = keep.size();
+  bool haveRange = int(md->ArrayRange.size()) == md->NumArrays;
+
+  for (int i = 0; i < nKeep; ++i)
+    {
+    int j = keep[i];
+    md->ArrayName[i] = md->ArrayName[j];
+    md->ArrayCentering[i] = md->ArrayCentering[j];
+    md->ArrayComponents[i] = md->ArrayComponents[j];
+    md->ArrayType[i] = md->ArrayType[j];
+    if (haveRange)
+      md->ArrayRange[i] = md->ArrayRange[j];
+    }
+
+  md->ArrayName.resize(nKeep);
+  md->ArrayCentering.resize(nKeep);
+  md->ArrayComponents.resize(nKeep);
+  md->ArrayType.resize(nKeep);
+  if (haveRange)
+    md->ArrayRange.resize(nKeep);
+
+  unsigned long nBlocks = md->BlockArrayRange.size();
+  for (unsigned long q = 0; q < nBlocks; ++q)
+    {
+    std::vector<std::array<double,2>> &bar = md->BlockArrayRange[q];
+    if (int(bar.size()) != md->NumArrays)
+      continue;
+
+    for (int i = 0; i < nKeep; ++i)
+      bar[i] = bar[keep[i]];
+
+    bar.resize(nKeep);
+    }
+
+  md->NumArrays = nKeep;
+
+  metadata = md;
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int InTransitDataAdaptor::ApplyLevelRequirements(MeshMetadataPtr &metadata)
+{
+  const DataRequirements &reqs = this->Internals->Requirements;
+  if (reqs.Empty() || !metadata || !VTKUtils::AMR(metadata))
+    return 0;
+
+  int maxLevel = reqs.GetMaxLevel(metadata->MeshName);
+  if ((maxLevel < 0) || (maxLevel >= metadata->NumLevels - 1))
+    return 0;
+
+  TimeEvent<128> mark("InTransitDataAdaptor::ApplyLevelRequirements");
+
+  if ((metadata->BlockLevel.size() != size_t(metadata->NumBlocks)) ||
+    (metadata->BlockOwner.size() != size_t(metadata->NumBlocks)))
+    {
+    SENSEI_ERROR("Block levels and owners are required to select the levels"
+      " of mesh \"" << metadata->MeshName << "\"")
+    return -1;
+    }
+
+  // copy the metadata and release the blocks of the finer levels
+  MeshMetadataPtr md = metadata->NewCopy();
+
+  for (int j = 0; j < md->NumBlocks; ++j)
+    {
+    if (md->BlockLevel[j] > maxLevel)
+      md->BlockOwner[j] = -1;
+    }
+
+  metadata = md;
+
+  return 0;
+}
+
 }
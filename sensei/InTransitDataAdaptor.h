@@ -8,6 +8,7 @@ namespace pugi { class xml_node; }
 
 namespace sensei
 {
+class DataRequirements;
 
 /// @class InTransitDataAdaptor
 /// @brief InTransitDataAdaptor defines control API for in transit data movement
@@ -73,6 +74,69 @@ public:
   virtual void SetPartitioner(const sensei::PartitionerPtr &partitioner);
   virtual sensei::PartitionerPtr GetPartitioner();
 
+  // Set/get the data required by the analyses on the receiver side,
+  // typically the union of the requirements of all of the analyses that
+  // will run. When set, the metadata returned by GetMeshMetadata lists
+  // only the required arrays, so analyses that fetch every available
+  // array move only what is needed. Meshes that are not required are
+  // reported without arrays. Requirements may be given in XML by a
+  // data_requirements element holding mesh elements, see
+  // sensei::DataRequirements::Initialize
+  virtual void SetDataRequirements(const sensei::DataRequirements &reqs);
+  virtual const sensei::DataRequirements &GetDataRequirements() const;
+
+  // Step policies. These control which of the steps produced by the sender
+  // are processed when the receiver can not keep up.
+  //
+  //   STEP_POLICY_ALL       -- every step is processed (default)
+  //   STEP_POLICY_LATEST    -- AdvanceStream moves to the most recent step
+  //                            the sender has made available. Steps
+  //                            produced in the meantime are not seen.
+  //                            Requires transport support, see ADIOS2 SST.
+  //   STEP_POLICY_EVERY_KTH -- AdvanceStream moves k steps forward, only
+  //                            every k'th step is processed. The steps
+  //                            are those in the stream, when the sender
+  //                            writes every j'th step too only every
+  //                            j*k'th simulation step is processed. Set
+  //                            it on one side only.
+  //   STEP_POLICY_BLOCK     -- every step is processed, the sender blocks
+  //                            when n steps are waiting. The depth applies
+  //                            to the sender, see ADIOS2AnalysisAdaptor.
+  //
+  // In XML the policy is given by the step_policy attribute, one of all,
+  // latest, every_kth or block, and the value of k or n by step_count.
+  enum {STEP_POLICY_ALL=0, STEP_POLICY_LATEST=1,
+    STEP_POLICY_EVERY_KTH=2, STEP_POLICY_BLOCK=3};
+
+  virtual void SetStepPolicy(int policy, unsigned int count = 1);
+  virtual int GetStepPolicy() const;
+  virtual unsigned int GetStepPolicyCount() const;
+
+  // Get the number of steps made available to the analyses and the number
+  // of steps that were moved past without being processed.
+  virtual void GetStepCounters(unsigned long &numProcessed,
+    unsigned long &numSkipped) const;
+
+  // When set the meshes are made as vtkPartitionedDataSet holding only the
+  // local blocks, rather than as vtkMultiBlockDataSet with a slot for
+  // every block, see VTKUtils::NewLocalBlocks. Iterating over the blocks
+  // is then O(local blocks), which matters when there are very many.
+  // Analyses find the global id of a block with VTKUtils::GetBlockId. In
+  // XML the partitioned_blocks attribute. Transports that do not support
+  // it make multiblocks. The default is off.
+  virtual void SetPartitionedBlocks(bool val);
+  virtual bool GetPartitionedBlocks() const;
+
+  // Send a small result back to the simulation, for instance an adaptive
+  // threshold, a refinement hint or a steering flag computed by an
+  // analysis. The results posted by any rank of the end point during a
+  // step are delivered to every rank of the simulation when the stream is
+  // advanced past the step, or closed, where they are received with
+  // AnalysisAdaptor::ReceiveResult. The tag identifies the result to the
+  // simulation, the result may hold binary data. The default reports an
+  // error, for transports that have no return channel.
+  virtual int PostResult(const std::string &tag, const std::string &result);
+
   // Control API
   virtual int OpenStream() = 0;
   virtual int CloseStream() = 0;
@@ -86,6 +150,23 @@ protected:
   InTransitDataAdaptor();
   ~InTransitDataAdaptor();
 
+  // Replace metadata with a copy listing only the arrays named in the
+  // data requirements. Does nothing if there are no requirements.
+  // Derived classes call this on metadata before handing it out.
+  int ApplyDataRequirements(MeshMetadataPtr &metadata);
+
+  // Replace the receiver's metadata of an AMR mesh with a copy in which the
+  // blocks of levels finer than the data requirements' max level are
+  // not assigned to any rank, and so are not moved. Derived classes call
+  // this on the partitioner's output before it is cached.
+  int ApplyLevelRequirements(MeshMetadataPtr &metadata);
+
+  // Returns the number of steps AdvanceStream should move the transport
+  // forward according to the step policy. Derived classes report the
+  // steps they move through with CountSteps.
+  unsigned int GetStepStride() const;
+  void CountSteps(unsigned long numProcessed, unsigned long numSkipped);
+
   InTransitDataAdaptor(const InTransitDataAdaptor&) = delete;
   void operator=(const InTransitDataAdaptor&) = delete;
 
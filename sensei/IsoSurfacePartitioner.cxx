@@ -4,6 +4,7 @@
 #include "VTKUtils.h"
 #include "Profiler.h"
 
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <sstream>
@@ -52,43 +53,84 @@ int IsoSurfacePartitioner::GetIsoValues(std::string &meshName,
 }
 
 // --------------------------------------------------------------------------
-int IsoSurfacePartitioner::GetPartition(MPI_Comm comm,
-  const MeshMetadataPtr &mdIn, MeshMetadataPtr &mdOut)
+int IsoSurfacePartitioner::GetActiveBlocks(const MeshMetadataPtr &md,
+  std::vector<int> &activeBlocks)
 {
-  TimeEvent<128> mark("IsoSurfacePartitioner::GetPartition");
+  activeBlocks.clear();
 
   // find the set of arrays and values for this mesh
-  if (this->MeshName != mdIn->MeshName)
+  if (this->MeshName != md->MeshName)
     {
-    SENSEI_ERROR("No iso values set for mesh \"" << mdIn->MeshName << "\"")
+    SENSEI_ERROR("No iso values set for mesh \"" << md->MeshName << "\"")
     return -1;
     }
 
+  int nBlocks = md->BlockArrayRange.size();
+
   // locate the active blocks
-  std::set<int> activeBlocks;
-  for (int i = 0; i < mdIn->NumArrays; ++i)
+  for (int i = 0; i < md->NumArrays; ++i)
     {
     // see if this array is being used, if not skip it
-    const std::string &array = mdIn->ArrayName[i];
+    const std::string &array = md->ArrayName[i];
     if (this->ArrayName != array)
       continue;
 
-    // walk blocks and see if any of them are needed
-    const std::vector<double> &vals = this->IsoValues;
-    int nvals = vals.size();
-    for (int j = 0; j < mdIn->NumBlocks; ++j)
+    std::vector<std::array<double,2>> ranges(nBlocks);
+    for (int j = 0; j < nBlocks; ++j)
+      ranges[j] = md->BlockArrayRange[j][i];
+
+    if (ranges == this->Ranges)
       {
-      std::array<double,2> &rng = mdIn->BlockArrayRange[j][i];
-      for (int k = 0; k < nvals; ++k)
+      // the ranges are unchanged, search the index
+      if (this->Index.GetNumberOfBlocks() != nBlocks)
+        this->Index.Initialize(this->Ranges);
+
+      this->Index.FindValues(this->IsoValues, activeBlocks);
+      }
+    else
+      {
+      // the ranges changed, building an index will not pay off. walk
+      // blocks and see if any of them are needed
+      this->Ranges.swap(ranges);
+      this->Index.Clear();
+
+      std::vector<double> vals(this->IsoValues);
+      std::sort(vals.begin(), vals.end());
+
+      for (int j = 0; j < nBlocks; ++j)
         {
-        // if the value is in the range then this block is needed
-        double val = vals[k];
-        if ((val >= rng[0]) && (val <= rng[1]))
-          activeBlocks.insert(j);
+        // if a value is in the range then this block is needed
+        const std::array<double,2> &rng = this->Ranges[j];
+        std::vector<double>::iterator it =
+          std::lower_bound(vals.begin(), vals.end(), rng[0]);
+        if ((it != vals.end()) && (*it <= rng[1]))
+          activeBlocks.push_back(j);
         }
       }
+
+    break;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int IsoSurfacePartitioner::GetPartition(MPI_Comm comm,
+  const MeshMetadataPtr &mdIn, MeshMetadataPtr &mdOut)
+{
+  TimeEvent<128> mark("IsoSurfacePartitioner::GetPartition");
+
+  // require the global view of the block array ranges
+  if (mdIn->BlockArrayRange.size() != static_cast<unsigned int>(mdIn->NumBlocks))
+    {
+    SENSEI_ERROR("Block array ranges are required")
+    return -1;
     }
 
+  std::vector<int> activeBlocks;
+  if (this->GetActiveBlocks(mdIn, activeBlocks))
+    return -1;
+
   // partition the needed blocks to ranks equally
   int nRanks = 1;
   MPI_Comm_size(comm, &nRanks);
@@ -122,9 +164,8 @@ int IsoSurfacePartitioner::GetPartition(MPI_Comm comm,
     mdOut->BlockOwner[i] = -1;
 
   // assign the active blocks to the correct rank
-  std::set<int>::iterator bit = activeBlocks.begin();
-  for (int i = 0; i < numActiveBlocks; ++i, ++bit)
-    mdOut->BlockOwner[*bit] = activeBlockOwner[i];
+  for (int i = 0; i < numActiveBlocks; ++i)
+    mdOut->BlockOwner[activeBlocks[i]] = activeBlockOwner[i];
 
   // report the decomp
   int rank = 0;
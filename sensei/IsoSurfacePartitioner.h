@@ -2,8 +2,9 @@
 #define sensei_IsoSurfacePartitioner_h
 
 #include "Partitioner.h"
+#include "BlockIndex.h"
 
-#include <set>
+#include <array>
 #include <vector>
 #include <string>
 
@@ -18,6 +19,10 @@ using IsoSurfacePartitionerPtr = std::shared_ptr<sensei::IsoSurfacePartitioner>;
 /// compute the desired set of iso surfaces. These blocks are partitioned
 /// in consecutive spans to ranks such that each rank gets approximately
 /// the same number. The number of blocks per rank will differ by at most 1.
+///
+/// When the block array ranges are the same as on the previous step, the
+/// blocks are located with a BlockIndex built on the first repeat, making
+/// the search O(log n) per iso value rather than O(n).
 class IsoSurfacePartitioner : public sensei::Partitioner
 {
 public:
@@ -37,6 +42,13 @@ public:
   // Initialize from XML
   int Initialize(pugi::xml_node &node) override;
 
+  // find the blocks whose range includes an iso value. the indices of the
+  // blocks in the metadata's block arrays are returned. block array
+  // ranges are required, either the local or the global view may be
+  // passed
+  int GetActiveBlocks(const sensei::MeshMetadataPtr &md,
+    std::vector<int> &activeBlocks);
+
   // given an existing partitioning of data passed in the first MeshMetadata
   // argument,return a new partittioning in the second MeshMetadata argument.
   int GetPartition(MPI_Comm comm, const sensei::MeshMetadataPtr &in,
@@ -50,6 +62,9 @@ protected:
   std::string ArrayName;
   int ArrayCentering;
   std::vector<double> IsoValues;
+
+  std::vector<std::array<double,2>> Ranges;
+  sensei::BlockIndex Index;
 };
 
 }
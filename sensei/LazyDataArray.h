@@ -0,0 +1,285 @@
+#ifndef sensei_LazyDataArray_h
+#define sensei_LazyDataArray_h
+
+#include <vtkGenericDataArray.h>
+#include <vtkAOSDataArrayTemplate.h>
+#include <vtkObjectFactory.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace sensei
+{
+
+/// @class LazyDataArray
+/// @brief a vtkGenericDataArray whose values are computed on first access.
+///
+/// A data adaptor that can compute an array, for instance a derived field,
+/// may return a LazyDataArray from AddArray instead of computing every value
+/// up front. The array holds a callback that fills the values of a range of
+/// tuples. Tuples are organized in pages of PageSize tuples, the first
+/// access to a tuple fills its page. An analysis that samples a small part of
+/// the mesh, such as a slice, only pays for the pages it touches.
+///
+/// The values are stored in one contiguous buffer that is not initialized
+/// until a page is filled. Materialize fills the pages that have not been
+/// accessed. GetVoidPointer materializes the array and returns the buffer
+/// directly, without the copy vtkGenericDataArray would make. NewAOSArray
+/// returns a copy in the standard layout.
+///
+/// Concurrent reads from several threads are safe. The callback is called
+/// at most once per page, and may run on any thread that reads the array.
+template <typename ValueTypeT>
+class LazyDataArray :
+  public vtkGenericDataArray<LazyDataArray<ValueTypeT>, ValueTypeT>
+{
+  using GenericDataArrayType =
+    vtkGenericDataArray<LazyDataArray<ValueTypeT>, ValueTypeT>;
+
+public:
+  using SelfType = LazyDataArray<ValueTypeT>;
+  vtkTemplateTypeMacro(SelfType, GenericDataArrayType);
+  using ValueType = typename Superclass::ValueType;
+
+  static LazyDataArray *New()
+  { VTK_STANDARD_NEW_BODY(LazyDataArray<ValueTypeT>); }
+
+  /// fills the interleaved values of nTuples tuples starting at firstTuple.
+  /// returns 0 if successful.
+  using FillFunction = std::function<int(vtkIdType firstTuple,
+    vtkIdType nTuples, ValueType *values)>;
+
+  /// Set the callback that computes the values and the size of the array.
+  /// The number of components must be set before this call. Any values
+  /// computed earlier are discarded.
+  void SetFillFunction(vtkIdType nTuples, const FillFunction &fill)
+  {
+    this->Fill = fill;
+    this->AllocateTuples(nTuples);
+    this->Size = nTuples*this->NumberOfComponents;
+    this->MaxId = this->Size - 1;
+    this->FillTuples = nTuples;
+    this->Modified();
+  }
+
+  /// Set the number of tuples in a page. This must be set before the fill
+  /// function. Default 4096.
+  void SetPageSize(vtkIdType pageSize)
+  { this->PageSize = std::max(vtkIdType(1), pageSize); }
+
+  vtkIdType GetPageSize() const { return this->PageSize; }
+
+  /// fill all of the pages that have not been computed yet
+  /// returns 0 if successful.
+  int Materialize() const
+  {
+    int ierr = 0;
+    for (vtkIdType i = 0; i < this->NumPages; ++i)
+      ierr |= this->FillPage(i);
+    return ierr ? -1 : 0;
+  }
+
+  /// the number of pages that have been filled
+  vtkIdType GetNumberOfFilledPages() const
+  {
+    vtkIdType n = 0;
+    for (vtkIdType i = 0; i < this->NumPages; ++i)
+      n += this->Filled[i].load(std::memory_order_acquire) ? 1 : 0;
+    return n;
+  }
+
+  /// returns a new standard layout array holding a copy of the values.
+  /// the caller takes the reference.
+  vtkAOSDataArrayTemplate<ValueType> *NewAOSArray() const
+  {
+    this->Materialize();
+
+    vtkAOSDataArrayTemplate<ValueType> *aos =
+      vtkAOSDataArrayTemplate<ValueType>::New();
+
+    aos->SetName(this->GetName());
+    aos->SetNumberOfComponents(this->NumberOfComponents);
+    aos->SetNumberOfTuples(this->GetNumberOfTuples());
+
+    if (this->Data)
+      memcpy(aos->GetPointer(0), this->Data.get(),
+        this->GetNumberOfValues()*sizeof(ValueType));
+
+    return aos;
+  }
+
+  /// materializes the array and returns the buffer directly
+  void *GetVoidPointer(vtkIdType valueIdx) override
+  {
+    this->Materialize();
+    return this->Data.get() + valueIdx;
+  }
+
+  ValueType GetValue(vtkIdType valueIdx) const
+  {
+    this->FillPage(valueIdx/this->NumberOfComponents/this->PageSize);
+    return this->Data[valueIdx];
+  }
+
+  void SetValue(vtkIdType valueIdx, ValueType value)
+  {
+    this->FillPage(valueIdx/this->NumberOfComponents/this->PageSize);
+    this->Data[valueIdx] = value;
+  }
+
+  void GetTypedTuple(vtkIdType tupleIdx, ValueType *tuple) const
+  {
+    this->FillPage(tupleIdx/this->PageSize);
+    const ValueType *src = this->Data.get() + tupleIdx*this->NumberOfComponents;
+    std::copy(src, src + this->NumberOfComponents, tuple);
+  }
+
+  void SetTypedTuple(vtkIdType tupleIdx, const ValueType *tuple)
+  {
+    this->FillPage(tupleIdx/this->PageSize);
+    std::copy(tuple, tuple + this->NumberOfComponents,
+      this->Data.get() + tupleIdx*this->NumberOfComponents);
+  }
+
+  ValueType GetTypedComponent(vtkIdType tupleIdx, int comp) const
+  {
+    this->FillPage(tupleIdx/this->PageSize);
+    return this->Data[tupleIdx*this->NumberOfComponents + comp];
+  }
+
+  void SetTypedComponent(vtkIdType tupleIdx, int comp, ValueType value)
+  {
+    this->FillPage(tupleIdx/this->PageSize);
+    this->Data[tupleIdx*this->NumberOfComponents + comp] = value;
+  }
+
+protected:
+  LazyDataArray() : PageSize(4096), NumPages(0), FillTuples(0) {}
+  ~LazyDataArray() {}
+
+  bool AllocateTuples(vtkIdType numTuples)
+  {
+    // the buffer is left uninitialized so that the memory of pages that
+    // are never accessed is not touched
+    vtkIdType nValues = numTuples*this->NumberOfComponents;
+    this->Data.reset(nValues ? new ValueType[nValues] : nullptr);
+
+    this->NumPages = (numTuples + this->PageSize - 1)/this->PageSize;
+    this->Filled.reset(this->NumPages ?
+      new std::atomic<char>[this->NumPages] : nullptr);
+
+    for (vtkIdType i = 0; i < this->NumPages; ++i)
+      this->Filled[i].store(0);
+
+    this->FillTuples = 0;
+    return true;
+  }
+
+  bool ReallocateTuples(vtkIdType numTuples)
+  {
+    if (numTuples == 0)
+      return this->AllocateTuples(0);
+
+    // keep the computed values and the callback for the tuples it covers,
+    // tuples past that are zero initialized on first access
+    if (this->Materialize())
+      return false;
+
+    vtkIdType nOld = this->GetNumberOfTuples();
+    vtkIdType nCopy = std::min(nOld, numTuples)*this->NumberOfComponents;
+
+    std::unique_ptr<ValueType[]> data(std::move(this->Data));
+    vtkIdType fillTuples = std::min(this->FillTuples, numTuples);
+
+    this->AllocateTuples(numTuples);
+
+    if (nCopy)
+      memcpy(this->Data.get(), data.get(), nCopy*sizeof(ValueType));
+
+    // the pages holding the copied values are complete except the last
+    // partial one, which is completed with zeros
+    vtkIdType nCopyTuples = nCopy/std::max(1, this->NumberOfComponents);
+    for (vtkIdType i = 0; i < this->NumPages; ++i)
+      {
+      vtkIdType first = i*this->PageSize;
+      vtkIdType last = std::min(first + this->PageSize, numTuples);
+      if (last <= nCopyTuples)
+        {
+        this->Filled[i].store(1);
+        }
+      else if (first < nCopyTuples)
+        {
+        std::fill(this->Data.get() + nCopyTuples*this->NumberOfComponents,
+          this->Data.get() + last*this->NumberOfComponents, ValueType());
+        this->Filled[i].store(1);
+        }
+      }
+
+    this->FillTuples = fillTuples;
+    return true;
+  }
+
+  // compute the values in a page, once
+  int FillPage(vtkIdType page) const
+  {
+    if ((page < 0) || (page >= this->NumPages))
+      return 0;
+
+    if (this->Filled[page].load(std::memory_order_acquire))
+      return 0;
+
+    std::lock_guard<std::mutex> lock(this->FillMutex);
+
+    if (this->Filled[page].load(std::memory_order_relaxed))
+      return 0;
+
+    int nComps = this->NumberOfComponents;
+    vtkIdType first = page*this->PageSize;
+    vtkIdType last = std::min(first + this->PageSize, this->GetNumberOfTuples());
+    vtkIdType fillLast = std::min(last, this->FillTuples);
+
+    ValueType *values = this->Data.get() + first*nComps;
+
+    int ierr = 0;
+    if (fillLast > first)
+      {
+      if (!this->Fill || this->Fill(first, fillLast - first, values))
+        {
+        vtkErrorMacro("Failed to compute tuples " << first
+          << " to " << fillLast)
+        ierr = -1;
+        }
+      }
+
+    // tuples the callback does not cover, or the callback failed to compute
+    vtkIdType zeroFirst = ierr ? first : std::max(first, fillLast);
+    if (last > zeroFirst)
+      std::fill(this->Data.get() + zeroFirst*nComps,
+        this->Data.get() + last*nComps, ValueType());
+
+    this->Filled[page].store(1, std::memory_order_release);
+    return ierr;
+  }
+
+  FillFunction Fill;
+  vtkIdType PageSize;
+  vtkIdType NumPages;
+  vtkIdType FillTuples;
+  std::unique_ptr<ValueType[]> Data;
+  std::unique_ptr<std::atomic<char>[]> Filled;
+  mutable std::mutex FillMutex;
+
+private:
+  LazyDataArray(const LazyDataArray&) = delete;
+  void operator=(const LazyDataArray&) = delete;
+
+  friend class vtkGenericDataArray<LazyDataArray<ValueTypeT>, ValueTypeT>;
+};
+
+}
+
+#endif
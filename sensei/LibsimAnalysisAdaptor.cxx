@@ -8,6 +8,7 @@
 #include "Profiler.h"
 #include "Error.h"
 #include "BinaryStream.h"
+#include "BlockIndex.h"
 
 #include <vtkCellArray.h>
 #include <vtkCellData.h>
@@ -58,6 +59,31 @@ namespace sensei
 {
 using namespace sensei::STLUtils;
 
+///////////////////////////////////////////////////////////////////////////////
+// A block of a mesh and the products of its conversion to libsim's
+// representation. These are kept for the duration of a step so that plots,
+// exports and variables on the same mesh share them. The handles given to
+// libsim are owned and freed by VisIt, only the memory that they wrap is
+// kept here.
+struct LibsimBlockCache
+{
+    LibsimBlockCache() : Block(nullptr) {}
+
+    vtkDataObject *Block;
+    std::vector<int> Connectivity;   // unstructured cells in libsim's layout
+    std::vector<float> Coords[3];    // uniform grids exposed as rectilinear
+};
+
+using LibsimBlockCacheMap = std::map<int, LibsimBlockCache>;
+
+// The children of each block of an AMR mesh in compressed row form. The
+// children of block i are Children[Offsets[i]] up to Children[Offsets[i+1]].
+struct LibsimNesting
+{
+    std::vector<int> Offsets;
+    std::vector<int> Children;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 class PlotRecord
 {
@@ -151,6 +177,7 @@ public:
 
     bool Initialize();
 
+    bool WillExecute(long step) const;
     bool Execute(sensei::DataAdaptor *DataAdaptor);
 
     bool AddRender(int freq, const std::string &session,
@@ -181,11 +208,13 @@ private:
 
     // helpers
     int ProcessVisItCommand(int rank);
+    void ProcessVisItInput(int rank, int visitstate);
     bool Execute_Batch(int rank);
     bool Execute_Interactive(int rank);
 
     int GetMesh(const std::string &meshName, vtkDataObjectPtr &cdp);
-    int GetMesh(int dom, const std::string &meshName, vtkDataObject *&mesh);
+    int GetMesh(int dom, const std::string &meshName, LibsimBlockCache *&block);
+    int GetBlocks(const std::string &meshName, LibsimBlockCacheMap *&blocks);
     int GetVariable(int dom, const std::string &varName, vtkDataArray *&array);
 
     int DecodeVarName(const std::string &varName, std::string &meshName,
@@ -206,14 +235,25 @@ private:
     sensei::DataAdaptor *Adaptor;
 
     std::map<std::string, vtkDataObjectPtr> Meshes;
+    std::map<std::string, LibsimBlockCacheMap> Blocks;
     std::map<std::string, sensei::MeshMetadataPtr> Metadata;
 
+    // domain nesting is kept across steps for static meshes
+    std::map<std::string, LibsimNesting> Nesting;
+
     int ComputeNesting;
 
     std::string               traceFile, options, visitdir;
     std::vector<PlotRecord>   plots;
     std::string               mode;
     bool                      paused;
+
+    // the poll of VisIt made by rank 0 while running, distributed by a
+    // non-blocking broadcast that is completed on the next step
+    int                       pollState;
+    MPI_Request               pollRequest;
+    bool                      pollPending;
+
     static bool               initialized;
     static int                instances;
 };
@@ -224,7 +264,8 @@ int  LibsimAnalysisAdaptor::PrivateData::instances = 0;
 // --------------------------------------------------------------------------
 LibsimAnalysisAdaptor::PrivateData::PrivateData() : Comm(MPI_COMM_WORLD),
   Adaptor(nullptr), traceFile(), options(), visitdir(),
-  mode("batch"), paused(false)
+  mode("batch"), paused(false), pollState(0), pollRequest(MPI_REQUEST_NULL),
+  pollPending(false)
 {
     ++instances;
 }
@@ -234,6 +275,13 @@ LibsimAnalysisAdaptor::PrivateData::~PrivateData()
 {
     --instances;
 
+    // the outstanding poll must complete before the communicator is used
+    // for anything else
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if(pollPending && !finalized)
+        MPI_Wait(&pollRequest, MPI_STATUS_IGNORE);
+
     if(instances == 0 && initialized)
     {
         TimeEvent<128> mark("libsim::finalize");
@@ -597,6 +645,23 @@ LibsimAnalysisAdaptor::PrivateData::Execute(sensei::DataAdaptor *DataAdaptor)
     return retval;
 }
 
+// --------------------------------------------------------------------------
+bool
+LibsimAnalysisAdaptor::PrivateData::WillExecute(long step) const
+{
+    // interactive sessions are serviced every step
+    if (!initialized || (mode.substr(0, 11) == "interactive"))
+        return true;
+
+    for(size_t i = 0; i < plots.size(); ++i)
+    {
+        if(step % plots[i].frequency == 0)
+            return true;
+    }
+
+    return false;
+}
+
 // --------------------------------------------------------------------------
 bool
 LibsimAnalysisAdaptor::PrivateData::Execute_Batch(int rank)
@@ -783,11 +848,68 @@ LibsimAnalysisAdaptor::PrivateData::ProcessVisItCommand(int rank)
     }
 }
 
+// --------------------------------------------------------------------------
+void
+LibsimAnalysisAdaptor::PrivateData::ProcessVisItInput(int rank, int visitstate)
+{
+    // Do different things depending on the output from VisItDetectInput.
+    switch(visitstate)
+    {
+    case 0:
+        // There was no input from VisIt, try again.
+        break;
+    case 1:
+        // VisIt is trying to connect to sim.
+        if(VisItAttemptToCompleteConnection() == VISIT_OKAY)
+        {
+            // Register Libsim callbacks.
+            VisItSetCommandCallback(ControlCommandCallback, (void*)this);
+            VisItSetSlaveProcessCallback2(SlaveProcessCallback, (void*)this);
+            VisItSetGetMetaData(GetMetaData, (void*)this);
+            VisItSetGetMesh(GetMesh, (void*)this);
+            VisItSetGetVariable(GetVariable, (void*)this);
+            VisItSetGetDomainList(GetDomainList, (void*)this);
+            if (this->ComputeNesting)
+                VisItSetGetDomainNesting(GetDomainNesting, (void*)this);
+
+            // Pause when we connect.
+            this->paused = true;
+        }
+        else
+        {
+            // Print the error message
+            if(rank == 0)
+            {
+                char *err = VisItGetLastError();
+                fprintf(stderr, "VisIt did not connect: %s\n", err);
+                free(err);
+            }
+        }
+        break;
+    case 2:
+        // VisIt wants to tell the engine something.
+        if(!ProcessVisItCommand(rank))
+        {
+            // Disconnect on an error or closed connection.
+            VisItDisconnect();
+            // Start running again if VisIt closes.
+            this->paused = false;
+        }
+        break;
+    case 3:
+        // No console input.
+        break;
+    default:
+        //fprintf(stderr, "Can't recover from error %d!\n", visitstate);
+        break;
+    }
+}
+
 // --------------------------------------------------------------------------
 bool
 LibsimAnalysisAdaptor::PrivateData::Execute_Interactive(int rank)
 {
-    int visitstate = 0, blocking = 0, err = 0;
+    int visitstate = 0, blocking = 0;
 
     // If we are paused, block. We can do this even if we're not connected
     // if we gave "interactive,paused" as the mode. This means that we want
@@ -801,6 +923,35 @@ LibsimAnalysisAdaptor::PrivateData::Execute_Interactive(int rank)
         VisItUpdatePlots();
     }
 
+    // While running, rank 0 polls VisIt without waiting and the result is
+    // sent with a non-blocking broadcast that is completed on the next
+    // step, by which time it has long arrived. The ranks act on the input
+    // a step after it was detected, the connection or command waits in its
+    // socket meanwhile, and only synchronize when VisIt has work for them.
+    if(!this->paused)
+    {
+        if(this->pollPending)
+        {
+            MPI_Wait(&this->pollRequest, MPI_STATUS_IGNORE);
+            this->pollPending = false;
+            ProcessVisItInput(rank, this->pollState);
+        }
+
+        if(!this->paused)
+        {
+            this->pollState = 0;
+            if(rank == 0)
+                this->pollState = VisItDetectInputWithTimeout(0, 0, -1);
+
+            MPI_Ibcast(&this->pollState, 1, MPI_INT, 0, this->Comm,
+                &this->pollRequest);
+            this->pollPending = true;
+
+            return true;
+        }
+    }
+
+    // Paused, VisIt is driving. Service it until it lets the sim run.
     do
     {
         // Get input from VisIt
@@ -811,59 +962,8 @@ LibsimAnalysisAdaptor::PrivateData::Execute_Interactive(int rank)
         // Broadcast the return value of VisItDetectInput to all procs.
         MPI_Bcast(&visitstate, 1, MPI_INT, 0, this->Comm);
 
-        // Do different things depending on the output from VisItDetectInput.
-        switch(visitstate)
-        {
-        case 0:
-            // There was no input from VisIt, try again.
-            break;
-        case 1:
-            // VisIt is trying to connect to sim.
-            if(VisItAttemptToCompleteConnection() == VISIT_OKAY)
-            {
-                // Register Libsim callbacks.
-                VisItSetCommandCallback(ControlCommandCallback, (void*)this);
-                VisItSetSlaveProcessCallback2(SlaveProcessCallback, (void*)this);
-                VisItSetGetMetaData(GetMetaData, (void*)this);
-                VisItSetGetMesh(GetMesh, (void*)this);
-                VisItSetGetVariable(GetVariable, (void*)this);
-                VisItSetGetDomainList(GetDomainList, (void*)this);
-                if (this->ComputeNesting)
-                    VisItSetGetDomainNesting(GetDomainNesting, (void*)this);
-
-                // Pause when we connect.
-                this->paused = true;
-            }
-            else
-            {
-                // Print the error message
-                if(rank == 0)
-                {
-                    char *err = VisItGetLastError();
-                    fprintf(stderr, "VisIt did not connect: %s\n", err);
-                    free(err);
-                }
-            }
-            break;
-        case 2:
-            // VisIt wants to tell the engine something.
-            if(!ProcessVisItCommand(rank))
-            {
-                // Disconnect on an error or closed connection.
-                VisItDisconnect();
-                // Start running again if VisIt closes.
-                this->paused = false;
-            }
-            break;
-        case 3:
-            // No console input.
-            break;
-        default:
-            //fprintf(stderr, "Can't recover from error %d!\n", visitstate);
-            //err = 1;
-            break;
-        }
-    } while(this->paused && err == 0);
+        ProcessVisItInput(rank, visitstate);
+    } while(this->paused);
 
     return true;
 }
@@ -1058,7 +1158,7 @@ vtkDataSet_GhostData(vtkDataSetAttributes *dsa, const std::string &name)
 
 // -----------------------------------------------------------------------------
 static visit_handle
-vtkDataSet_to_VisIt_Mesh(vtkDataObject *dobj)
+vtkDataSet_to_VisIt_Mesh(vtkDataObject *dobj, LibsimBlockCache &cache)
 {
     vtkDataSet *ds = dynamic_cast<vtkDataSet*>(dobj);
     if (dobj && !ds)
@@ -1099,70 +1199,66 @@ vtkDataSet_to_VisIt_Mesh(vtkDataObject *dobj)
             int nx = std::max(dims[0], 1);
             int ny = std::max(dims[1], 1);
             int nz = std::max(dims[2], 1);
-            float *x = (float *)malloc(sizeof(float) * nx);
-            float *y = (float *)malloc(sizeof(float) * ny);
-            float *z = (float *)malloc(sizeof(float) * nz);
-            if(x != nullptr && y != nullptr && z != nullptr)
+
+            // the coordinates are generated once and shared by all of the
+            // plots of this block
+            std::vector<float> *xyz = cache.Coords;
+            if(xyz[0].empty())
             {
-                visit_handle xc = VISIT_INVALID_HANDLE,
-                             yc = VISIT_INVALID_HANDLE,
-                             zc = VISIT_INVALID_HANDLE;
-                if(VisIt_VariableData_alloc(&xc) == VISIT_OKAY &&
-                   VisIt_VariableData_alloc(&yc) == VISIT_OKAY &&
-                   VisIt_VariableData_alloc(&zc) == VISIT_OKAY)
+                xyz[0].resize(nx);
+                xyz[1].resize(ny);
+                for(int i = 0; i < nx; ++i)
+                    xyz[0][i] = x0[0] + (ext[0] + i)*dx[0];
+                for(int i = 0; i < ny; ++i)
+                    xyz[1][i] = x0[1] + (ext[2] + i)*dx[1];
+                if(nz > 1)
                 {
-                    for(int i = 0; i < nx; ++i)
-                        x[i] = x0[0] + (ext[0] + i)*dx[0];
-                    for(int i = 0; i < ny; ++i)
-                        y[i] = x0[1] + (ext[2] + i)*dx[1];
-                    VisIt_VariableData_setDataF(xc, VISIT_OWNER_VISIT, 1, nx, x);
-                    VisIt_VariableData_setDataF(yc, VISIT_OWNER_VISIT, 1, ny, y);
-                    if(nz > 1)
-                    {
-                        for(int i = 0; i < nz; ++i)
-                            z[i] = x0[2] + (ext[4] + i)*dx[2];
-                        VisIt_VariableData_setDataF(zc, VISIT_OWNER_VISIT, 1, nz, z);
-                        VisIt_RectilinearMesh_setCoordsXYZ(mesh, xc, yc, zc);
-                    }
-                    else
-                    {
-                        VisIt_VariableData_free(zc); // didn't use it.
-                        VisIt_RectilinearMesh_setCoordsXY(mesh, xc, yc);
-                    }
+                    xyz[2].resize(nz);
+                    for(int i = 0; i < nz; ++i)
+                        xyz[2][i] = x0[2] + (ext[4] + i)*dx[2];
+                }
+            }
 
-                    // Try and make some ghost nodes.
-                    visit_handle gn = vtkDataSet_GhostData(ds->GetPointData(),
-                                          "vtkGhostType");
-                    if(gn != VISIT_INVALID_HANDLE)
-                        VisIt_RectilinearMesh_setGhostNodes(mesh, gn);
-                    // Try and make some ghost cells.
-                    visit_handle gz = vtkDataSet_GhostData(ds->GetCellData(),
-                                          "vtkGhostType");
-                    if(gz != VISIT_INVALID_HANDLE)
-                        VisIt_RectilinearMesh_setGhostCells(mesh, gz);
+            visit_handle xc = VISIT_INVALID_HANDLE,
+                         yc = VISIT_INVALID_HANDLE,
+                         zc = VISIT_INVALID_HANDLE;
+            if(VisIt_VariableData_alloc(&xc) == VISIT_OKAY &&
+               VisIt_VariableData_alloc(&yc) == VISIT_OKAY &&
+               ((nz < 2) || (VisIt_VariableData_alloc(&zc) == VISIT_OKAY)))
+            {
+                VisIt_VariableData_setDataF(xc, VISIT_OWNER_SIM, 1, nx, xyz[0].data());
+                VisIt_VariableData_setDataF(yc, VISIT_OWNER_SIM, 1, ny, xyz[1].data());
+                if(nz > 1)
+                {
+                    VisIt_VariableData_setDataF(zc, VISIT_OWNER_SIM, 1, nz, xyz[2].data());
+                    VisIt_RectilinearMesh_setCoordsXYZ(mesh, xc, yc, zc);
                 }
                 else
                 {
-                    VisIt_RectilinearMesh_free(mesh);
-                    mesh = VISIT_INVALID_HANDLE;
-                    if(xc != VISIT_INVALID_HANDLE)
-                        VisIt_VariableData_free(xc);
-                    if(yc != VISIT_INVALID_HANDLE)
-                        VisIt_VariableData_free(yc);
-                    if(zc != VISIT_INVALID_HANDLE)
-                        VisIt_VariableData_free(zc);
-                    if(x != nullptr) free(x);
-                    if(y != nullptr) free(y);
-                    if(z != nullptr) free(z);
+                    VisIt_RectilinearMesh_setCoordsXY(mesh, xc, yc);
                 }
+
+                // Try and make some ghost nodes.
+                visit_handle gn = vtkDataSet_GhostData(ds->GetPointData(),
+                                      "vtkGhostType");
+                if(gn != VISIT_INVALID_HANDLE)
+                    VisIt_RectilinearMesh_setGhostNodes(mesh, gn);
+                // Try and make some ghost cells.
+                visit_handle gz = vtkDataSet_GhostData(ds->GetCellData(),
+                                      "vtkGhostType");
+                if(gz != VISIT_INVALID_HANDLE)
+                    VisIt_RectilinearMesh_setGhostCells(mesh, gz);
             }
             else
             {
                 VisIt_RectilinearMesh_free(mesh);
                 mesh = VISIT_INVALID_HANDLE;
-                if(x != nullptr) free(x);
-                if(y != nullptr) free(y);
-                if(z != nullptr) free(z);
+                if(xc != VISIT_INVALID_HANDLE)
+                    VisIt_VariableData_free(xc);
+                if(yc != VISIT_INVALID_HANDLE)
+                    VisIt_VariableData_free(yc);
+                if(zc != VISIT_INVALID_HANDLE)
+                    VisIt_VariableData_free(zc);
             }
         }
     }
@@ -1275,42 +1371,50 @@ vtkDataSet_to_VisIt_Mesh(vtkDataObject *dobj)
             vtkIdType ncells = ugrid->GetNumberOfCells();
             if(ncells > 0 && !err)
             {
-                const unsigned char *cellTypes = (const unsigned char *)ugrid->GetCellTypesArray()->GetVoidPointer(0);
-                const vtkIdType *vtkconn = (const vtkIdType *)ugrid->GetCells()->GetData()->GetVoidPointer(0);
-                const vtkIdType *offsets = (const vtkIdType *)ugrid->GetCellLocationsArray()->GetVoidPointer(0);
-                int connlen = ugrid->GetCells()->GetNumberOfConnectivityEntries();
-                int *newconn = new int[connlen];
-                int *lsconn = newconn;
-                for(int cellid = 0; cellid < ncells; ++cellid)
+                // the translation is made once and shared by all of the
+                // plots of this block
+                std::vector<int> &conn = cache.Connectivity;
+                if(conn.empty())
                 {
-                    // Map VTK cell type to Libsim cell type.
-                    int lsct = celltype_vtk_to_libsim(cellTypes[cellid]);
-                    if(lsct != -1)
+                    const unsigned char *cellTypes = (const unsigned char *)ugrid->GetCellTypesArray()->GetVoidPointer(0);
+                    const vtkIdType *vtkconn = (const vtkIdType *)ugrid->GetCells()->GetData()->GetVoidPointer(0);
+                    const vtkIdType *offsets = (const vtkIdType *)ugrid->GetCellLocationsArray()->GetVoidPointer(0);
+                    int connlen = ugrid->GetCells()->GetNumberOfConnectivityEntries();
+                    conn.resize(connlen);
+                    int *lsconn = conn.data();
+                    for(int cellid = 0; cellid < ncells; ++cellid)
                     {
-                        *lsconn++ = lsct;
-
-                        // The number of points is the first number for the cell.
-                        const vtkIdType *cellConn = vtkconn + offsets[cellid];
-                        vtkIdType npts = cellConn[0];
-                        cellConn++;
-                        for(vtkIdType idx = 0; idx < npts; ++idx)
-                            *lsconn++ = static_cast<int>(cellConn[idx]);
-                    }
-                    else
-                    {
-                        // We got a cell type we don't support. Make a vertex cell
-                        // so we at least don't mess up the cell data later.
-                        *lsconn++ = VISIT_CELL_POINT;
-                        const vtkIdType *cellConn = vtkconn + offsets[cellid];
-                        *lsconn++ = cellConn[1];
+                        // Map VTK cell type to Libsim cell type.
+                        int lsct = celltype_vtk_to_libsim(cellTypes[cellid]);
+                        if(lsct != -1)
+                        {
+                            *lsconn++ = lsct;
+
+                            // The number of points is the first number for the cell.
+                            const vtkIdType *cellConn = vtkconn + offsets[cellid];
+                            vtkIdType npts = cellConn[0];
+                            cellConn++;
+                            for(vtkIdType idx = 0; idx < npts; ++idx)
+                                *lsconn++ = static_cast<int>(cellConn[idx]);
+                        }
+                        else
+                        {
+                            // We got a cell type we don't support. Make a vertex cell
+                            // so we at least don't mess up the cell data later.
+                            *lsconn++ = VISIT_CELL_POINT;
+                            const vtkIdType *cellConn = vtkconn + offsets[cellid];
+                            *lsconn++ = cellConn[1];
+                        }
                     }
+                    // vertex cells replacing unsupported cells are shorter
+                    conn.resize(lsconn - conn.data());
                 }
 
                 visit_handle hc = VISIT_INVALID_HANDLE;
                 if(VisIt_VariableData_alloc(&hc) != VISIT_ERROR)
                 {
-                    // Wrap newconn, let VisIt own it.
-                    VisIt_VariableData_setDataI(hc, VISIT_OWNER_VISIT, 1, connlen, newconn);
+                    // Wrap the cached connectivity, it outlives the handle.
+                    VisIt_VariableData_setDataI(hc, VISIT_OWNER_SIM, 1, conn.size(), conn.data());
                     VisIt_UnstructuredMesh_setConnectivity(mesh, ncells, hc);
 
                     // Try and make some ghost nodes.
@@ -1326,7 +1430,6 @@ vtkDataSet_to_VisIt_Mesh(vtkDataObject *dobj)
                 }
                 else
                 {
-                    delete [] newconn;
                     err = true;
                 }
             }
@@ -1620,6 +1723,7 @@ void LibsimAnalysisAdaptor::PrivateData::ClearCache()
 #ifdef VISIT_DEBUG_LOG
     VisItDebug5("SENSEI: LibsimAnalysisAdaptor::PrivateData::ClearCache\n");
 #endif
+    this->Blocks.clear();
     this->Meshes.clear();
     this->Metadata.clear();
 }
@@ -1729,40 +1833,17 @@ int LibsimAnalysisAdaptor::PrivateData::GetVariable(int dom,
         }
     }
 
-    // extract array from the requested block
-
-    // VTK's iterators for AMR datasets behave differently than for multiblock
-    // datasets.  we are going to have to handle AMR data as a special case for
-    // now.
-
-    vtkUniformGridAMRDataIterator *amrIt = dynamic_cast<vtkUniformGridAMRDataIterator*>(cdit);
-    vtkOverlappingAMR *amrMesh = dynamic_cast<vtkOverlappingAMR*>(cd.Get());
-
-    for (cdit->InitTraversal(); !cdit->IsDoneWithTraversal(); cdit->GoToNextItem())
-    {
-        long blockId = 0;
-        if (amrIt)
-        {
-            // special case for AMR
-            int level = amrIt->GetCurrentLevel();
-            int index = amrIt->GetCurrentIndex();
-            blockId = amrMesh->GetAMRBlockSourceIndex(level, index);
-        }
-        else
-        {
-            // other composite data
-            blockId = cdit->GetCurrentFlatIndex() - 1;
-        }
+    cdit->Delete();
 
-        if (blockId == dom)
-        {
-            array = cdit->GetCurrentDataObject()->GetAttributes(
-                association)->GetArray(arrayName.c_str());
-            break;
-        }
-    }
+    // extract array from the requested block
+    LibsimBlockCacheMap *blocks = nullptr;
+    if (this->GetBlocks(meshName, blocks))
+        return -1;
 
-    cdit->Delete();
+    auto bit = blocks->find(dom);
+    if (bit != blocks->end())
+        array = bit->second.Block->GetAttributes(
+            association)->GetArray(arrayName.c_str());
 
     if (!array)
     {
@@ -1775,19 +1856,19 @@ int LibsimAnalysisAdaptor::PrivateData::GetVariable(int dom,
 }
 
 // --------------------------------------------------------------------------
-int LibsimAnalysisAdaptor::PrivateData::GetMesh(int dom,
-    const std::string &meshName, vtkDataObject *&mesh)
+int LibsimAnalysisAdaptor::PrivateData::GetBlocks(const std::string &meshName,
+    LibsimBlockCacheMap *&blocks)
 {
-    mesh = nullptr;
+    blocks = nullptr;
 
-    // get the metadata, it should already be available
-    auto mdit = this->Metadata.find(meshName);
-    if (mdit == this->Metadata.end())
+    // the blocks are indexed by domain once per step. visit asks for them
+    // one at a time, for each plot, and for each variable.
+    auto it = this->Blocks.find(meshName);
+    if (it != this->Blocks.end())
     {
-        SENSEI_ERROR("No metadata for mesh \"" << meshName << "\"")
-        return -1;
+        blocks = &it->second;
+        return 0;
     }
-    MeshMetadataPtr mmd = mdit->second;
 
     // get the mesh
     vtkDataObjectPtr dobj;
@@ -1797,10 +1878,9 @@ int LibsimAnalysisAdaptor::PrivateData::GetMesh(int dom,
     vtkCompositeDataSetPtr cd =
       VTKUtils::AsCompositeData(this->Comm, dobj.GetPointer(), false);
 
-    // get the block that visit is after
-    vtkCompositeDataIterator *cdit = cd->NewIterator();
+    LibsimBlockCacheMap &blks = this->Blocks[meshName];
 
-    // extract array from the requested block
+    vtkCompositeDataIterator *cdit = cd->NewIterator();
 
     // VTK's iterators for AMR datasets behave differently than for multiblock
     // datasets.  we are going to have to handle AMR data as a special case for
@@ -1825,22 +1905,45 @@ int LibsimAnalysisAdaptor::PrivateData::GetMesh(int dom,
             blockId = cdit->GetCurrentFlatIndex() - 1;
         }
 
-        if (blockId == dom)
-        {
-            mesh = cdit->GetCurrentDataObject();
-            break;
-        }
+        blks[blockId].Block = cdit->GetCurrentDataObject();
     }
 
     cdit->Delete();
 
-    if (!mesh)
+    blocks = &blks;
+
+    return 0;
+}
+
+// --------------------------------------------------------------------------
+int LibsimAnalysisAdaptor::PrivateData::GetMesh(int dom,
+    const std::string &meshName, LibsimBlockCache *&block)
+{
+    block = nullptr;
+
+    // get the metadata, it should already be available
+    auto mdit = this->Metadata.find(meshName);
+    if (mdit == this->Metadata.end())
+    {
+        SENSEI_ERROR("No metadata for mesh \"" << meshName << "\"")
+        return -1;
+    }
+
+    // get the block that visit is after
+    LibsimBlockCacheMap *blocks = nullptr;
+    if (this->GetBlocks(meshName, blocks))
+        return -1;
+
+    auto it = blocks->find(dom);
+    if (it == blocks->end())
     {
         SENSEI_ERROR("Failed to get domain " << dom << " from mesh \""
             << meshName << "\"")
         return -1;
     }
 
+    block = &it->second;
+
     return 0;
 }
 
@@ -1853,12 +1956,12 @@ LibsimAnalysisAdaptor::PrivateData::GetMesh(int dom, const char *meshName,
 
     PrivateData *This = (PrivateData *)cbdata;
 
-    vtkDataObject *block = nullptr;
+    LibsimBlockCache *block = nullptr;
 
     if (This->GetMesh(dom, std::string(meshName), block))
         return VISIT_INVALID_HANDLE;
 
-    return vtkDataSet_to_VisIt_Mesh(block);
+    return vtkDataSet_to_VisIt_Mesh(block->Block, *block);
 }
 
 // --------------------------------------------------------------------------
@@ -1951,6 +2054,121 @@ intersects(const std::array<int,6> &rcext, const std::array<int,6> &fext)
     return false;
 }
 
+// find the children of each block of an AMR mesh. the blocks of each level
+// are placed in a BlockIndex so that the candidate children of a block are
+// found without visiting every block of the next level. the blocks are
+// divided evenly among the ranks and the results are gathered so that all
+// ranks hold the nesting of all blocks.
+static
+int computeNesting(MPI_Comm comm, const MeshMetadataPtr &mmd, LibsimNesting &nest)
+{
+    TimeEvent<128> mark("LibsimAnalysisAdaptor::ComputeNesting");
+
+    int rank = 0, size = 1;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    int nBlocks = mmd->NumBlocks;
+    int nLevels = mmd->NumLevels;
+
+    // the blocks of each level, in block order, and their extents
+    std::vector<std::vector<int>> levelIds(nLevels);
+    std::vector<std::vector<std::array<double,6>>> levelExts(nLevels);
+    for (int i = 0; i < nBlocks; ++i)
+    {
+        int level = mmd->BlockLevel[i];
+        const std::array<int,6> &ext = mmd->BlockExtents[i];
+
+        levelIds[level].push_back(i);
+        levelExts[level].push_back({{double(ext[0]), double(ext[1]),
+            double(ext[2]), double(ext[3]), double(ext[4]), double(ext[5])}});
+    }
+
+    std::vector<BlockIndex> index(nLevels);
+    for (int l = 1; l < nLevels; ++l)
+        index[l].Initialize(levelExts[l]);
+
+    // this rank's share of the blocks
+    int nLocal = nBlocks / size;
+    int nLarge = nBlocks % size;
+    int first = rank*nLocal + std::min(rank, nLarge);
+    if (rank < nLarge)
+        ++nLocal;
+
+    std::vector<int> counts(nLocal, 0);
+    std::vector<int> children;
+    std::vector<int> cands;
+    for (int i = 0; i < nLocal; ++i)
+    {
+        int bid = first + i;
+        int nextLevel = mmd->BlockLevel[bid] + 1;
+
+        // blocks on the finest level have no children
+        if (nextLevel >= nLevels)
+            continue;
+
+        // refine the active extent, calculations are made in
+        // the finer level index space
+        std::array<int,6> rActiveExt = refine(mmd->BlockExtents[bid],
+            mmd->RefRatio[nextLevel - 1]);
+
+        std::array<double,6> box = {{double(rActiveExt[0]), double(rActiveExt[1]),
+            double(rActiveExt[2]), double(rActiveExt[3]), double(rActiveExt[4]),
+            double(rActiveExt[5])}};
+
+        // the index finds the blocks whose extents overlap, keep those
+        // that satisfy the nesting test
+        index[nextLevel].FindBox(box, cands);
+
+        size_t nCands = cands.size();
+        for (size_t j = 0; j < nCands; ++j)
+        {
+            int cid = levelIds[nextLevel][cands[j]];
+            if (intersects(rActiveExt, mmd->BlockExtents[cid]))
+            {
+                children.push_back(cid);
+                ++counts[i];
+            }
+        }
+    }
+
+    // gather the number of children of every block
+    std::vector<int> blockCounts(size);
+    std::vector<int> blockDispls(size);
+    for (int r = 0; r < size; ++r)
+    {
+        blockCounts[r] = nBlocks / size + (r < nLarge ? 1 : 0);
+        blockDispls[r] = r*(nBlocks / size) + std::min(r, nLarge);
+    }
+
+    std::vector<int> allCounts(nBlocks);
+    MPI_Allgatherv(counts.data(), nLocal, MPI_INT, allCounts.data(),
+        blockCounts.data(), blockDispls.data(), MPI_INT, comm);
+
+    nest.Offsets.resize(nBlocks + 1);
+    nest.Offsets[0] = 0;
+    for (int i = 0; i < nBlocks; ++i)
+        nest.Offsets[i+1] = nest.Offsets[i] + allCounts[i];
+
+    // gather the children. each rank's blocks are contiguous so the
+    // children land in block order
+    std::vector<int> childCounts(size);
+    std::vector<int> childDispls(size);
+    for (int r = 0; r < size; ++r)
+    {
+        childDispls[r] = nest.Offsets[blockDispls[r]];
+        childCounts[r] = nest.Offsets[blockDispls[r] + blockCounts[r]] -
+            childDispls[r];
+    }
+
+    nest.Children.resize(nest.Offsets[nBlocks]);
+    MPI_Allgatherv(children.data(), children.size(), MPI_INT,
+        nest.Children.data(), childCounts.data(), childDispls.data(),
+        MPI_INT, comm);
+
+    return 0;
+}
+
 // TODO -- this isn't working
 // --------------------------------------------------------------------------
 visit_handle
@@ -1998,40 +2216,26 @@ LibsimAnalysisAdaptor::PrivateData::GetDomainNesting(const char *name,
         VisIt_DomainNesting_set_levelRefinement(h, i, rr.data());
     }
 
-    // for each block figure out the list of children
-    std::vector<int> nesting;
-    nesting.reserve(mmd->NumBlocks);
+    // for each block figure out the list of children. this is only done
+    // again if the mesh changes
+    LibsimNesting &nest = This->Nesting[meshName];
+    if (!mmd->StaticMesh || (int(nest.Offsets.size()) != (mmd->NumBlocks + 1)))
+        computeNesting(This->Comm, mmd, nest);
+
     for (int i = 0; i < mmd->NumBlocks; ++i)
     {
         int activeLevel = mmd->BlockLevel[i];
-        int nextLevel = activeLevel + 1;
         std::array<int,6> &activeExt = mmd->BlockExtents[i];
-        std::array<int,3> &rr = mmd->RefRatio[activeLevel];
 
-        // for blocks not on the finest level, find children
-        if (nextLevel < mmd->NumLevels)
-        {
-            // refine the active extent, calculations are made in
-            // the finer level index space
-            std::array<int,6> rActiveExt = refine(activeExt, rr);
+        int *children = nest.Children.data() + nest.Offsets[i];
+        int nChildren = nest.Offsets[i+1] - nest.Offsets[i];
 
-            for (int j = 0; j < mmd->NumBlocks; ++j)
-            {
-                if (mmd->BlockLevel[j] != nextLevel)
-                    continue;
-
-                const std::array<int,6> &otherExt = mmd->BlockExtents[j];
-
-                if (intersects(rActiveExt, otherExt))
-                {
 #ifdef USE_REAL_DOMAIN
-                    nesting.push_back(mmd->BlockIds[j]);
-#else
-                    nesting.push_back(j);
+        std::vector<int> nesting(nChildren);
+        for (int j = 0; j < nChildren; ++j)
+            nesting[j] = mmd->BlockIds[children[j]];
+        children = nesting.data();
 #endif
-                }
-            }
-        }
 
         // re-roder the block extent to be compatible w/ VisIt
         int vExt[6] = {activeExt[0], activeExt[2], activeExt[4],
@@ -2039,13 +2243,11 @@ LibsimAnalysisAdaptor::PrivateData::GetDomainNesting(const char *name,
 
 #ifdef USE_REAL_DOMAIN
         VisIt_DomainNesting_set_nestingForPatch(h, mmd->BlockIds[i],
-            activeLevel, nesting.data(), nesting.size(), vExt);
+            activeLevel, children, nChildren, vExt);
 #else
         VisIt_DomainNesting_set_nestingForPatch(h, i,
-            activeLevel, nesting.data(), nesting.size(), vExt);
+            activeLevel, children, nChildren, vExt);
 #endif
-
-        nesting.clear();
     }
 
     return h;
@@ -2134,6 +2336,12 @@ void LibsimAnalysisAdaptor::Initialize()
     internals->Initialize();
 }
 
+//-----------------------------------------------------------------------------
+bool LibsimAnalysisAdaptor::WillExecute(long step, double)
+{
+    return !internals || internals->WillExecute(step);
+}
+
 //-----------------------------------------------------------------------------
 bool LibsimAnalysisAdaptor::Execute(DataAdaptor* DataAdaptor)
 {
@@ -38,6 +38,9 @@ public:
   // Let the caller explicitly initialize.
   void Initialize();
 
+  // in batch mode, true when one of the plots is due on the step
+  bool WillExecute(long step, double time) override;
+
   bool Execute(DataAdaptor* data) override;
 
   int Finalize() override;
@@ -0,0 +1,213 @@
+#include "LocalityPartitioner.h"
+#include "Profiler.h"
+
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+namespace
+{
+// split the ordered blocks [i0, i1) into pieces whose weights are in
+// proportion to share. sum holds the running sum of the ordered weights and
+// group the sender node of each ordered block. on return bounds[j] is the
+// first block of the j'th piece and bounds[nParts] is i1. cuts are moved to a
+// sender node boundary when the weight changes by no more than tol times the
+// average piece.
+void cut(const std::vector<double> &sum, const std::vector<int> &group,
+  int i0, int i1, const std::vector<double> &share, double tol,
+  std::vector<int> &bounds)
+{
+  int nParts = share.size();
+
+  bounds.resize(nParts + 1);
+  bounds[0] = i0;
+  bounds[nParts] = i1;
+
+  double total = sum[i1] - sum[i0];
+  double window = nParts ? tol*total/nParts : 0.0;
+
+  double frac = 0.0;
+  for (int j = 1; j < nParts; ++j)
+    {
+    frac += share[j-1];
+    double target = sum[i0] + frac*total;
+
+    // the boundary closest to the target
+    int k = std::lower_bound(sum.begin() + bounds[j-1],
+      sum.begin() + i1 + 1, target) - sum.begin();
+
+    if ((k > bounds[j-1]) && ((target - sum[k-1]) < (sum[k] - target)))
+      --k;
+
+    // the closest sender node boundary within the window
+    int best = k;
+    double bestDist = -1.0;
+
+    int m = std::lower_bound(sum.begin() + bounds[j-1],
+      sum.begin() + i1 + 1, target - window) - sum.begin();
+
+    for (; (m <= i1) && (sum[m] <= target + window); ++m)
+      {
+      if ((m == i0) || (m == i1) || (group[m-1] != group[m]))
+        {
+        double dist = std::fabs(sum[m] - target);
+        if ((bestDist < 0.0) || (dist < bestDist))
+          {
+          best = m;
+          bestDist = dist;
+          }
+        }
+      }
+
+    bounds[j] = std::max(best, bounds[j-1]);
+    }
+}
+}
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+int LocalityPartitioner::GetPartition(MPI_Comm comm, const MeshMetadataPtr &mdIn,
+  MeshMetadataPtr &mdOut)
+{
+  TimeEvent<128> mark("LocalityPartitioner::GetPartition");
+
+  mdOut = mdIn->NewCopy();
+
+  int nBlocks = mdOut->NumBlocks;
+
+  if ((nBlocks > 0) && (int(mdIn->BlockOwner.size()) != nBlocks))
+    {
+    SENSEI_ERROR("LocalityPartitioner requires BlockOwner")
+    return -1;
+    }
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  // locate the receiver nodes. each node is identified by its lowest rank
+  MPI_Comm nodeComm = MPI_COMM_NULL;
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank,
+    MPI_INFO_NULL, &nodeComm);
+
+  int leader = rank;
+  MPI_Bcast(&leader, 1, MPI_INT, 0, nodeComm);
+  MPI_Comm_free(&nodeComm);
+
+  std::vector<int> nodeOf(nRanks);
+  MPI_Allgather(&leader, 1, MPI_INT, nodeOf.data(), 1, MPI_INT, comm);
+
+  std::map<int, std::vector<int>> nodes;
+  for (int i = 0; i < nRanks; ++i)
+    nodes[nodeOf[i]].push_back(i);
+
+  unsigned int ranksPerNode = this->SenderRanksPerNode;
+  if (!ranksPerNode)
+    {
+    std::map<int, std::vector<int>>::iterator it = nodes.begin();
+    for (; it != nodes.end(); ++it)
+      ranksPerNode = std::max(ranksPerNode, (unsigned int)it->second.size());
+    }
+
+  // weigh the blocks by their size, fall back to a uniform weight when
+  // sizes are not available
+  bool haveCells = int(mdIn->BlockNumCells.size()) == nBlocks;
+  bool havePoints = int(mdIn->BlockNumPoints.size()) == nBlocks;
+
+  std::vector<double> weight(nBlocks, 1.0);
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    double w = (haveCells ? mdIn->BlockNumCells[i] : 0) +
+      (havePoints ? mdIn->BlockNumPoints[i] : 0);
+    weight[i] = std::max(w, 1.0);
+    }
+
+  // order the blocks by sender node, then sender rank
+  std::vector<int> order(nBlocks);
+  for (int i = 0; i < nBlocks; ++i)
+    order[i] = i;
+
+  std::stable_sort(order.begin(), order.end(),
+    [&](int a, int b) -> bool
+    { return mdIn->BlockOwner[a] < mdIn->BlockOwner[b]; });
+
+  std::vector<int> group(nBlocks);
+  std::vector<double> sum(nBlocks + 1, 0.0);
+  for (int i = 0; i < nBlocks; ++i)
+    {
+    group[i] = mdIn->BlockOwner[order[i]] / ranksPerNode;
+    sum[i+1] = sum[i] + weight[order[i]];
+    }
+
+  // split across receiver nodes in proportion to their size
+  int nNodes = nodes.size();
+  std::vector<double> share(nNodes);
+  std::vector<const std::vector<int>*> nodeRanks(nNodes);
+
+  std::map<int, std::vector<int>>::iterator it = nodes.begin();
+  for (int i = 0; it != nodes.end(); ++it, ++i)
+    {
+    share[i] = double(it->second.size())/nRanks;
+    nodeRanks[i] = &it->second;
+    }
+
+  std::vector<int> nodeBounds;
+  cut(sum, group, 0, nBlocks, share, this->Tolerance, nodeBounds);
+
+  // then across the ranks of each node
+  for (int i = 0; i < nNodes; ++i)
+    {
+    const std::vector<int> &ranks = *nodeRanks[i];
+    int nNodeRanks = ranks.size();
+
+    std::vector<double> rankShare(nNodeRanks, 1.0/nNodeRanks);
+
+    std::vector<int> rankBounds;
+    cut(sum, group, nodeBounds[i], nodeBounds[i+1], rankShare,
+      this->Tolerance, rankBounds);
+
+    for (int j = 0; j < nNodeRanks; ++j)
+      {
+      for (int k = rankBounds[j]; k < rankBounds[j+1]; ++k)
+        mdOut->BlockOwner[order[k]] = ranks[j];
+      }
+    }
+
+  if (this->Verbose && (rank == 0))
+    {
+    std::vector<double> load(nRanks, 0.0);
+    for (int i = 0; i < nBlocks; ++i)
+      load[mdOut->BlockOwner[i]] += weight[i];
+
+    double maxLoad = *std::max_element(load.begin(), load.end());
+    double avgLoad = sum[nBlocks]/nRanks;
+
+    SENSEI_STATUS("LocalityPartitioner assigned " << nBlocks << " blocks to "
+      << nRanks << " ranks on " << nNodes << " nodes, imbalance "
+      << (avgLoad > 0.0 ? maxLoad/avgLoad : 1.0))
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int LocalityPartitioner::Initialize(pugi::xml_node &node)
+{
+  TimeEvent<128> mark("LocalityPartitioner::Initialize");
+
+  this->SenderRanksPerNode = node.attribute("sender_ranks_per_node").as_uint(0);
+  this->Tolerance = node.attribute("tolerance").as_double(0.05);
+
+  SENSEI_STATUS("Configured LocalityPartitioner sender_ranks_per_node="
+    << this->SenderRanksPerNode << " tolerance=" << this->Tolerance)
+
+  return 0;
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef sensei_LocalityPartitioner_h
+#define sensei_LocalityPartitioner_h
+
+#include "Partitioner.h"
+
+namespace sensei
+{
+
+class LocalityPartitioner;
+using LocalityPartitionerPtr = std::shared_ptr<sensei::LocalityPartitioner>;
+
+/// @class LocalityPartitioner
+/// @brief balances the data per receiver while keeping node traffic local.
+///
+/// Blocks are weighted by their size, the sum of BlockNumCells and
+/// BlockNumPoints, and ordered by the sender node they come from. The sender
+/// node of a block is derived from its BlockOwner and the number of sender
+/// ranks per node. The ordered blocks are cut into pieces of equal weight,
+/// first one per receiver node, sized by the number of receiver ranks on the
+/// node as reported by MPI_Comm_split_type, then one per rank on each node.
+/// As a result the blocks of a sender node land on one or two receiver nodes
+/// and, within that, on as few ranks as the balance permits. A cut is moved to
+/// the nearest sender node boundary when that changes the weight of the piece
+/// by no more than the tolerance.
+///
+/// XML attributes:
+///
+///   sender_ranks_per_node -- the number of sender ranks on each sender node.
+///                            Default 0, use the number of ranks on the
+///                            largest receiver node.
+///   tolerance             -- allowed imbalance, as a fraction of the
+///                            average piece, when aligning cuts with sender
+///                            nodes. Default 0.05
+class LocalityPartitioner : public sensei::Partitioner
+{
+public:
+  static sensei::LocalityPartitionerPtr New()
+  { return LocalityPartitionerPtr(new LocalityPartitioner); }
+
+  const char *GetClassName() override { return "LocalityPartitioner"; }
+
+  // given an existing partitioning of data passed in the first MeshMetadata
+  // argument,return a new partittioning in the second MeshMetadata argument.
+  int GetPartition(MPI_Comm comm, const sensei::MeshMetadataPtr &in,
+     sensei::MeshMetadataPtr &out) override;
+
+  // Set/get the number of sender ranks per sender node. 0 uses the size of
+  // the largest receiver node.
+  void SetSenderRanksPerNode(unsigned int n) { this->SenderRanksPerNode = n; }
+  unsigned int GetSenderRanksPerNode() { return this->SenderRanksPerNode; }
+
+  // Set/get the tolerance used when aligning cuts with sender nodes
+  void SetTolerance(double tol) { this->Tolerance = tol; }
+  double GetTolerance() { return this->Tolerance; }
+
+  // Initialize from XML
+  int Initialize(pugi::xml_node &node) override;
+
+protected:
+  LocalityPartitioner() : SenderRanksPerNode(0), Tolerance(0.05) {}
+  LocalityPartitioner(const LocalityPartitioner &) = default;
+
+  unsigned int SenderRanksPerNode;
+  double Tolerance;
+};
+
+}
+
+#endif
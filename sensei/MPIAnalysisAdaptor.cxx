@@ -0,0 +1,396 @@
+#include "MPIAnalysisAdaptor.h"
+
+#include "MPISchema.h"
+#include "BinaryStream.h"
+#include "DataAdaptor.h"
+#include "MeshMetadata.h"
+#include "MeshMetadataMap.h"
+#include "VTKUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSet.h>
+#include <vtkFieldData.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using vtkCompositeDataSetPtr = vtkSmartPointer<vtkCompositeDataSet>;
+
+namespace sensei
+{
+
+struct MPIAnalysisAdaptor::InternalsType
+{
+  // the current step's metadata
+  std::vector<MeshMetadataPtr> Metadata;
+
+  // the meshes requested during the current step, arrays are added to them
+  std::map<std::string, vtkCompositeDataSetPtr> Meshes;
+
+  // flags the end point ranks reached through shared memory
+  std::vector<int> LocalPeers;
+
+  // the results sent by the end point that have not been taken, tag and
+  // result. the simulation may poll while Execute runs in the background
+  std::deque<std::pair<std::string, std::string>> Results;
+  std::mutex ResultMutex;
+
+  // get the named mesh's metadata
+  MeshMetadataPtr GetMetadata(const std::string &meshName)
+  {
+    std::vector<MeshMetadataPtr>::iterator it =
+      std::find_if(this->Metadata.begin(), this->Metadata.end(),
+        [&meshName](const MeshMetadataPtr &md) -> bool
+        { return md->MeshName == meshName; });
+
+    return it == this->Metadata.end() ? MeshMetadataPtr() : *it;
+  }
+
+  void Clear()
+  {
+    this->Metadata.clear();
+    this->Meshes.clear();
+  }
+};
+
+//----------------------------------------------------------------------------
+senseiNewMacro(MPIAnalysisAdaptor);
+
+//----------------------------------------------------------------------------
+MPIAnalysisAdaptor::MPIAnalysisAdaptor() :
+    ConnectMode(senseiMPI::CONNECT_PORT), FileName("sensei_mpi_port"),
+    Timeout(60.0), PeerApplication(-1), SharedMemory(0),
+    InterComm(MPI_COMM_NULL),
+    Closed(false), Internals(new InternalsType)
+{
+}
+
+//----------------------------------------------------------------------------
+MPIAnalysisAdaptor::~MPIAnalysisAdaptor()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+int MPIAnalysisAdaptor::Connect()
+{
+  TimeEvent<128> mark("MPIAnalysisAdaptor::Connect");
+
+  int ierr = 0;
+  if (this->ConnectMode == senseiMPI::CONNECT_MPMD)
+    ierr = senseiMPI::ConnectMPMD(this->GetCommunicator(),
+      this->PeerApplication, this->InterComm);
+  else
+    ierr = senseiMPI::Connect(this->GetCommunicator(), this->FileName,
+      this->Timeout, this->InterComm);
+
+  if (ierr)
+    {
+    SENSEI_ERROR("Failed to connect to the end point")
+    return -1;
+    }
+
+  senseiMPI::GetLocalPeers(this->InterComm, this->SharedMemory,
+    this->Internals->LocalPeers);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+bool MPIAnalysisAdaptor::Execute(DataAdaptor* dataAdaptor)
+{
+  TimeEvent<128> mark("MPIAnalysisAdaptor::Execute");
+
+  // the end point has gone away
+  if (this->Closed)
+    return true;
+
+  if ((this->InterComm == MPI_COMM_NULL) && this->Connect())
+    return false;
+
+  // figure out what the simulation can provide. include the full
+  // suite of metadata for the end-point partitioners
+  MeshMetadataFlags flags;
+  flags.SetBlockDecomp();
+  flags.SetBlockSize();
+  flags.SetBlockBounds();
+  flags.SetBlockExtents();
+  flags.SetBlockArrayRange();
+
+  MeshMetadataMap mdm;
+  if (mdm.Initialize(dataAdaptor, flags))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return false;
+    }
+
+  this->Internals->Clear();
+
+  unsigned int nMeshes = mdm.Size();
+  for (unsigned int i = 0; i < nMeshes; ++i)
+    {
+    MeshMetadataPtr lmd;
+    MeshMetadataPtr md;
+    if (mdm.GetMeshMetadata(i, lmd) ||
+      mdm.GetGlobalMeshMetadata(lmd->MeshName, md))
+      {
+      SENSEI_ERROR("Failed to get metadata for mesh " << i)
+      return false;
+      }
+    this->Internals->Metadata.push_back(md);
+    }
+
+  // send the step header
+  BinaryStream bs;
+  bs.Pack(int(1));
+  bs.Pack(dataAdaptor->GetDataTimeStep());
+  bs.Pack(dataAdaptor->GetDataTime());
+  bs.Pack(nMeshes);
+  for (unsigned int i = 0; i < nMeshes; ++i)
+    this->Internals->Metadata[i]->ToStream(bs);
+
+  if (senseiMPI::Broadcast(this->InterComm, true, bs))
+    {
+    SENSEI_ERROR("Failed to send the header of step "
+      << dataAdaptor->GetDataTimeStep())
+    return false;
+    }
+
+  // move the data the end point asks for
+  int ierr = this->Serve(dataAdaptor);
+
+  this->Internals->Clear();
+
+  return ierr ? false : true;
+}
+
+//----------------------------------------------------------------------------
+int MPIAnalysisAdaptor::Serve(DataAdaptor *dataAdaptor)
+{
+  TimeEvent<128> mark("MPIAnalysisAdaptor::Serve");
+
+  int nRemote = 0;
+  MPI_Comm_remote_size(this->InterComm, &nRemote);
+
+  while (true)
+    {
+    BinaryStream req;
+    if (senseiMPI::Broadcast(this->InterComm, false, req))
+      {
+      SENSEI_ERROR("Failed to receive a request")
+      return -1;
+      }
+
+    int code = senseiMPI::REQUEST_END_STEP;
+    req.Unpack(code);
+
+    if (code == senseiMPI::REQUEST_END_STEP)
+      {
+      this->UnpackResults(req);
+      return 0;
+      }
+    else if (code == senseiMPI::REQUEST_CLOSE)
+      {
+      this->UnpackResults(req);
+      this->Closed = true;
+      senseiMPI::Disconnect(this->InterComm, this->ConnectMode);
+      return 0;
+      }
+    else if ((code != senseiMPI::REQUEST_GET_MESH) &&
+      (code != senseiMPI::REQUEST_ADD_ARRAY))
+      {
+      SENSEI_ERROR("Invalid request " << code)
+      return -1;
+      }
+
+    std::string meshName;
+    int structureOnly = 0;
+    int association = vtkDataObject::POINT;
+    std::string arrayName;
+    std::vector<int> owners;
+
+    req.Unpack(meshName);
+    if (code == senseiMPI::REQUEST_GET_MESH)
+      {
+      req.Unpack(structureOnly);
+      }
+    else
+      {
+      req.Unpack(association);
+      req.Unpack(arrayName);
+      }
+    req.Unpack(owners);
+
+    // serialize the local blocks for the ranks that receive them. on error
+    // the exchange still takes place, so that the end point does not hang
+    int ierr = 0;
+    std::vector<BinaryStream> streams(nRemote);
+
+    MeshMetadataPtr md = this->Internals->GetMetadata(meshName);
+    if (!md || (owners.size() != size_t(md->NumBlocks)))
+      {
+      SENSEI_ERROR("Invalid request for mesh \"" << meshName << "\"")
+      ierr = -1;
+      }
+
+    // get the mesh. arrays are added to the mesh fetched earlier in the step
+    vtkCompositeDataSetPtr &mesh = this->Internals->Meshes[meshName];
+    if (!ierr && (!mesh || (code == senseiMPI::REQUEST_GET_MESH)))
+      {
+      vtkCompositeDataSet *dobj = nullptr;
+      if (dataAdaptor->GetMesh(meshName,
+        (code == senseiMPI::REQUEST_GET_MESH) ? structureOnly : true, dobj))
+        {
+        SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+        ierr = -1;
+        }
+      mesh.TakeReference(dobj);
+      }
+
+    if (!ierr && (code == senseiMPI::REQUEST_ADD_ARRAY))
+      {
+      if (arrayName == "vtkGhostType")
+        ierr = association == vtkDataObject::CELL ?
+          dataAdaptor->AddGhostCellsArray(mesh, meshName) :
+          dataAdaptor->AddGhostNodesArray(mesh, meshName);
+      else
+        ierr = dataAdaptor->AddArray(mesh, meshName, association, arrayName);
+
+      if (ierr)
+        SENSEI_ERROR("Failed to add " << VTKUtils::GetAttributesName(association)
+          << " data array \"" << arrayName << "\" to mesh \"" << meshName << "\"")
+      }
+
+    if (!ierr)
+      {
+      vtkCompositeDataIterator *it = mesh->NewIterator();
+      for (it->InitTraversal(); !ierr && !it->IsDoneWithTraversal();
+        it->GoToNextItem())
+        {
+        int bid = std::max(0, VTKUtils::GetBlockId(mesh, it));
+        int dest = bid < md->NumBlocks ? owners[bid] : -1;
+
+        // blocks the end point does not need stay here
+        if (dest < 0)
+          continue;
+
+        if (dest >= nRemote)
+          {
+          SENSEI_ERROR("Block " << bid << " of mesh \"" << meshName
+            << "\" has no owner on the end point")
+          ierr = -1;
+          break;
+          }
+
+        BinaryStream &bs = streams[dest];
+        bs.Pack(bid);
+
+        if (code == senseiMPI::REQUEST_GET_MESH)
+          {
+          ierr = senseiMPI::PackBlock(it->GetCurrentDataObject(),
+            structureOnly, bs);
+          }
+        else
+          {
+          vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+          vtkFieldData *atts = ds ? VTKUtils::GetAttributes(ds, association) : nullptr;
+          vtkDataArray *da = atts ? atts->GetArray(arrayName.c_str()) : nullptr;
+
+          if (!da)
+            {
+            SENSEI_ERROR("Block " << bid << " of mesh \"" << meshName
+              << "\" has no " << VTKUtils::GetAttributesName(association)
+              << " data array \"" << arrayName << "\"")
+            ierr = -1;
+            break;
+            }
+
+          ierr = senseiMPI::PackArray(da, bs);
+          }
+        }
+      it->Delete();
+      }
+
+    if (ierr)
+      {
+      for (int i = 0; i < nRemote; ++i)
+        streams[i].Clear();
+      }
+
+    if (senseiMPI::Exchange(this->InterComm, true,
+      this->Internals->LocalPeers, streams,
+      senseiMPI::ReceiveFunction()) || ierr)
+      {
+      SENSEI_ERROR("Failed to send mesh \"" << meshName << "\"")
+      return -1;
+      }
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void MPIAnalysisAdaptor::UnpackResults(BinaryStream &req)
+{
+  std::vector<std::string> tags;
+  std::vector<std::string> results;
+  req.Unpack(tags);
+  req.Unpack(results);
+
+  std::lock_guard<std::mutex> lock(this->Internals->ResultMutex);
+
+  unsigned int nResults = std::min(tags.size(), results.size());
+  for (unsigned int i = 0; i < nResults; ++i)
+    this->Internals->Results.emplace_back(tags[i], results[i]);
+}
+
+//----------------------------------------------------------------------------
+int MPIAnalysisAdaptor::ReceiveResult(std::string &tag, std::string &result)
+{
+  std::lock_guard<std::mutex> lock(this->Internals->ResultMutex);
+
+  if (this->Internals->Results.empty())
+    return 1;
+
+  tag.swap(this->Internals->Results.front().first);
+  result.swap(this->Internals->Results.front().second);
+  this->Internals->Results.pop_front();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIAnalysisAdaptor::Finalize()
+{
+  TimeEvent<128> mark("MPIAnalysisAdaptor::Finalize");
+
+  if (this->InterComm == MPI_COMM_NULL)
+    return 0;
+
+  // tell the end point there are no more steps
+  if (!this->Closed)
+    {
+    BinaryStream bs;
+    bs.Pack(int(0));
+    senseiMPI::Broadcast(this->InterComm, true, bs);
+    this->Closed = true;
+    }
+
+  senseiMPI::Disconnect(this->InterComm, this->ConnectMode);
+
+  return 0;
+}
+
+}
@@ -0,0 +1,116 @@
+#ifndef MPIAnalysisAdaptor_h
+#define MPIAnalysisAdaptor_h
+
+#include "AnalysisAdaptor.h"
+
+#include <mpi.h>
+#include <string>
+
+namespace sensei
+{
+class BinaryStream;
+
+/// @class MPIAnalysisAdaptor
+/// @brief The write side of the MPI transport.
+///
+/// Blocks move directly from the simulation's ranks to the end point's
+/// ranks over an intercommunicator, without going through files or a
+/// staging library. The end point runs either as a separate job that
+/// publishes an MPI port in a file, or as the other application of an
+/// MPMD launch sharing MPI_COMM_WORLD. See MPIDataAdaptor for the read
+/// side.
+///
+/// Each step the global metadata of every mesh is sent to the end point,
+/// which partitions it and pulls the meshes and arrays its analyses
+/// need. Execute returns once the end point has finished with the step.
+/// Only the requested data is read from the simulation and moved.
+///
+/// The results the end point's analyses post with
+/// InTransitDataAdaptor::PostResult arrive with the end of the step, and
+/// are queued on every rank until they are taken with ReceiveResult.
+class MPIAnalysisAdaptor : public AnalysisAdaptor
+{
+public:
+  static MPIAnalysisAdaptor* New();
+  senseiTypeMacro(MPIAnalysisAdaptor, AnalysisAdaptor);
+
+  /// @brief Set how to connect to the end point.
+  ///
+  /// CONNECT_PORT (0), the default, reads the name of an MPI port from
+  /// the file set by SetFileName. CONNECT_MPMD (1) connects to the other
+  /// application of an MPMD job, the adaptor's communicator is then the
+  /// simulation's part of MPI_COMM_WORLD.
+  void SetConnectMode(int mode)
+  { this->ConnectMode = mode; }
+
+  int GetConnectMode() const
+  { return this->ConnectMode; }
+
+  /// @brief Set the file the end point publishes its port in.
+  /// Default value is "sensei_mpi_port".
+  void SetFileName(const std::string &fileName)
+  { this->FileName = fileName; }
+
+  std::string GetFileName() const
+  { return this->FileName; }
+
+  /// @brief Set the time in seconds to wait for the port to be published.
+  /// Default value is 60.
+  void SetTimeout(double timeout)
+  { this->Timeout = timeout; }
+
+  /// @brief Set the MPI_APPNUM of the end point in an MPMD job.
+  /// Default value is -1, meaning the other application.
+  void SetPeerApplication(int appNum)
+  { this->PeerApplication = appNum; }
+
+  /// @brief Pass data through shared memory to end point ranks on the
+  /// same node.
+  ///
+  /// Only names of shared memory segments cross processes, the end point
+  /// uses the values in place. The end point must enable it too.
+  /// Default value is 0.
+  void SetSharedMemory(int val)
+  { this->SharedMemory = val; }
+
+  // SENSEI AnalysisAdaptor API
+  bool Execute(DataAdaptor* data) override;
+  int Finalize() override;
+
+  /// take the next result sent by the end point, see
+  /// AnalysisAdaptor::ReceiveResult
+  int ReceiveResult(std::string &tag, std::string &result) override;
+
+protected:
+  MPIAnalysisAdaptor();
+  ~MPIAnalysisAdaptor();
+
+  // establish the intercommunicator
+  int Connect();
+
+  // answer the end point's requests until it is done with the step
+  int Serve(DataAdaptor *dataAdaptor);
+
+  // queue the results that come with the request ending the step
+  void UnpackResults(BinaryStream &req);
+
+  int ConnectMode;
+  std::string FileName;
+  double Timeout;
+  int PeerApplication;
+  int SharedMemory;
+
+  MPI_Comm InterComm;
+  bool Closed;
+
+  struct InternalsType;
+  InternalsType *Internals;
+
+private:
+  MPIAnalysisAdaptor(const MPIAnalysisAdaptor&) = delete;
+  void operator=(const MPIAnalysisAdaptor&) = delete;
+};
+
+}
+
+#endif
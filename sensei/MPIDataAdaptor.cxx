@@ -0,0 +1,665 @@
+#include "MPIDataAdaptor.h"
+#include "MPISchema.h"
+#include "BinaryStream.h"
+#include "MeshMetadata.h"
+#include "Partitioner.h"
+#include "BlockPartitioner.h"
+#include "Error.h"
+#include "Profiler.h"
+#include "VTKUtils.h"
+#include "XMLUtils.h"
+
+#include <vtkDataArray.h>
+#include <vtkDataSet.h>
+#include <vtkFieldData.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkObjectFactory.h>
+
+#include <pugixml.hpp>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sensei
+{
+struct MPIDataAdaptor::InternalsType
+{
+  InternalsType() : ConnectMode(senseiMPI::CONNECT_PORT),
+    FileName("sensei_mpi_port"), PeerApplication(-1), SharedMemory(0),
+    InterComm(MPI_COMM_NULL), Good(false) {}
+
+  int ConnectMode;
+  std::string FileName;
+  int PeerApplication;
+  int SharedMemory;
+  MPI_Comm InterComm;
+  bool Good;
+
+  // flags the simulation ranks reached through shared memory
+  std::vector<int> LocalPeers;
+
+  // the current step's metadata, as sent and as partitioned
+  std::vector<MeshMetadataPtr> SenderMetadata;
+  std::vector<MeshMetadataPtr> ReceiverMetadata;
+
+  // the results posted for the simulation during the current step
+  std::vector<std::string> ResultTags;
+  std::vector<std::string> Results;
+  std::mutex ResultMutex;
+};
+
+//----------------------------------------------------------------------------
+senseiNewMacro(MPIDataAdaptor);
+
+//----------------------------------------------------------------------------
+MPIDataAdaptor::MPIDataAdaptor() : Internals(nullptr)
+{
+  this->Internals = new InternalsType;
+}
+
+//----------------------------------------------------------------------------
+MPIDataAdaptor::~MPIDataAdaptor()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+void MPIDataAdaptor::SetConnectMode(int mode)
+{
+  this->Internals->ConnectMode = mode;
+}
+
+//----------------------------------------------------------------------------
+void MPIDataAdaptor::SetFileName(const std::string &fileName)
+{
+  this->Internals->FileName = fileName;
+}
+
+//----------------------------------------------------------------------------
+void MPIDataAdaptor::SetPeerApplication(int appNum)
+{
+  this->Internals->PeerApplication = appNum;
+}
+
+//----------------------------------------------------------------------------
+void MPIDataAdaptor::SetSharedMemory(int val)
+{
+  this->Internals->SharedMemory = val;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::Initialize(pugi::xml_node &node)
+{
+  TimeEvent<128> mark("MPIDataAdaptor::Initialize");
+
+  // let the base class handle initialization of the partitioner etc
+  if (this->InTransitDataAdaptor::Initialize(node))
+    {
+    SENSEI_ERROR("Failed to intialize the MPIDataAdaptor")
+    return -1;
+    }
+
+  std::string mode = node.attribute("connect").as_string("port");
+  if (mode == "port")
+    {
+    this->SetConnectMode(senseiMPI::CONNECT_PORT);
+    }
+  else if (mode == "mpmd")
+    {
+    this->SetConnectMode(senseiMPI::CONNECT_MPMD);
+    }
+  else
+    {
+    SENSEI_ERROR("Invalid connect mode \"" << mode
+      << "\". Valid values are port and mpmd")
+    return -1;
+    }
+
+  // connection info given on the command line takes precedence
+  if (!this->GetConnectionInfo().empty())
+    this->SetFileName(this->GetConnectionInfo());
+  else if (node.attribute("filename"))
+    this->SetFileName(node.attribute("filename").value());
+
+  this->SetPeerApplication(node.attribute("peer_application").as_int(-1));
+
+  this->SetSharedMemory(node.attribute("shared_memory").as_int(0));
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::Finalize()
+{
+  TimeEvent<128> mark("MPIDataAdaptor::Finalize");
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::OpenStream()
+{
+  TimeEvent<128> mark("MPIDataAdaptor::OpenStream");
+
+  // the simulation waits for the end point in each step, it never has
+  // more than the current step to offer
+  if (this->GetStepPolicy() == STEP_POLICY_LATEST)
+    SENSEI_WARNING("The MPI transport does not support the latest step"
+      " policy. Every step will be processed")
+
+  int ierr = 0;
+  if (this->Internals->ConnectMode == senseiMPI::CONNECT_MPMD)
+    ierr = senseiMPI::ConnectMPMD(this->GetCommunicator(),
+      this->Internals->PeerApplication, this->Internals->InterComm);
+  else
+    ierr = senseiMPI::Accept(this->GetCommunicator(),
+      this->Internals->FileName, this->Internals->InterComm);
+
+  if (ierr)
+    {
+    SENSEI_ERROR("Failed to open stream")
+    return -1;
+    }
+
+  senseiMPI::GetLocalPeers(this->Internals->InterComm,
+    this->Internals->SharedMemory, this->Internals->LocalPeers);
+
+  this->Internals->Good = true;
+
+  // initialize the time step
+  if (this->ReceiveHeader())
+    return -1;
+
+  this->CountSteps(1, 0);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::StreamGood()
+{
+  return this->Internals->Good;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::CloseStream()
+{
+  TimeEvent<128> mark("MPIDataAdaptor::CloseStream");
+
+  // release the simulation, unless it ended the stream
+  if (this->Internals->Good)
+    {
+    this->SendRequest(senseiMPI::REQUEST_CLOSE);
+    this->Internals->Good = false;
+    }
+
+  senseiMPI::Disconnect(this->Internals->InterComm,
+    this->Internals->ConnectMode);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::AdvanceStream()
+{
+  TimeEvent<128> mark("MPIDataAdaptor::AdvanceStream");
+
+  if (!this->Internals->Good)
+    return -1;
+
+  // steps skipped by the step policy are released without moving
+  // anything
+  unsigned int stride = this->GetStepStride();
+  for (unsigned int i = 0; i < stride; ++i)
+    {
+    if (this->SendRequest(senseiMPI::REQUEST_END_STEP) ||
+      this->ReceiveHeader())
+      return -1;
+    }
+
+  this->CountSteps(1, stride - 1);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::PostResult(const std::string &tag,
+  const std::string &result)
+{
+  std::lock_guard<std::mutex> lock(this->Internals->ResultMutex);
+  this->Internals->ResultTags.push_back(tag);
+  this->Internals->Results.push_back(result);
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::PackResults(BinaryStream &bs)
+{
+  MPI_Comm comm = this->GetCommunicator();
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  std::vector<std::string> tags;
+  std::vector<std::string> results;
+  {
+  std::lock_guard<std::mutex> lock(this->Internals->ResultMutex);
+  tags.swap(this->Internals->ResultTags);
+  results.swap(this->Internals->Results);
+  }
+
+  BinaryStream local;
+  local.Pack(tags);
+  local.Pack(results);
+
+  int nLocal = local.Size();
+  std::vector<int> counts(rank == 0 ? nRanks : 0);
+  MPI_Gather(&nLocal, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+
+  std::vector<int> offsets(counts.size());
+  int nTotal = 0;
+  for (int i = 0; i < int(counts.size()); ++i)
+    {
+    offsets[i] = nTotal;
+    nTotal += counts[i];
+    }
+
+  BinaryStream all;
+  if (rank == 0)
+    {
+    all.Resize(nTotal);
+    all.SetWritePos(nTotal);
+    }
+
+  MPI_Gatherv(local.GetData(), nLocal, MPI_BYTE, all.GetData(),
+    counts.data(), offsets.data(), MPI_BYTE, 0, comm);
+
+  // only rank 0's stream is sent
+  if (rank != 0)
+    return 0;
+
+  std::vector<std::string> allTags;
+  std::vector<std::string> allResults;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    all.SetReadPos(offsets[i]);
+    all.Unpack(tags);
+    all.Unpack(results);
+    allTags.insert(allTags.end(), tags.begin(), tags.end());
+    allResults.insert(allResults.end(), results.begin(), results.end());
+    }
+
+  bs.Pack(allTags);
+  bs.Pack(allResults);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::SendRequest(int code)
+{
+  TimeEvent<128> mark("MPIDataAdaptor::SendRequest");
+
+  BinaryStream req;
+  req.Pack(code);
+
+  // the results posted during the step go with the request that ends it
+  if (((code == senseiMPI::REQUEST_END_STEP) ||
+    (code == senseiMPI::REQUEST_CLOSE)) && this->PackResults(req))
+    {
+    SENSEI_ERROR("Failed to gather the results for the simulation")
+    return -1;
+    }
+
+  if (senseiMPI::Broadcast(this->Internals->InterComm, true, req))
+    {
+    SENSEI_ERROR("Failed to send request " << code)
+    return -1;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::ReceiveHeader()
+{
+  TimeEvent<128> mark("MPIDataAdaptor::ReceiveHeader");
+
+  this->Internals->SenderMetadata.clear();
+  this->Internals->ReceiverMetadata.clear();
+
+  BinaryStream bs;
+  if (senseiMPI::Broadcast(this->Internals->InterComm, false, bs))
+    {
+    SENSEI_ERROR("Failed to receive the step header")
+    this->Internals->Good = false;
+    return -1;
+    }
+
+  // the simulation has no more steps
+  int more = 0;
+  bs.Unpack(more);
+  if (!more)
+    {
+    this->Internals->Good = false;
+    senseiMPI::Disconnect(this->Internals->InterComm,
+      this->Internals->ConnectMode);
+    return -1;
+    }
+
+  long timeStep = 0;
+  double time = 0.0;
+  unsigned int nMeshes = 0;
+
+  bs.Unpack(timeStep);
+  bs.Unpack(time);
+  bs.Unpack(nMeshes);
+
+  for (unsigned int i = 0; i < nMeshes; ++i)
+    {
+    MeshMetadataPtr md = MeshMetadata::New();
+    if (md->FromStream(bs))
+      {
+      SENSEI_ERROR("Failed to deserialize metadata for mesh " << i)
+      return -1;
+      }
+    this->Internals->SenderMetadata.push_back(md);
+    }
+
+  this->Internals->ReceiverMetadata.resize(nMeshes);
+
+  this->SetDataTimeStep(timeStep);
+  this->SetDataTime(time);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::GetSenderMeshMetadata(unsigned int id,
+  MeshMetadataPtr &metadata)
+{
+  if (id >= this->Internals->SenderMetadata.size())
+    {
+    SENSEI_ERROR("Mesh id " << id << " is out of bounds. "
+      << this->Internals->SenderMetadata.size() << " meshes available")
+    return -1;
+    }
+
+  metadata = this->Internals->SenderMetadata[id];
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::GetNumberOfMeshes(unsigned int &numMeshes)
+{
+  numMeshes = this->Internals->SenderMetadata.size();
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadata)
+{
+  TimeEvent<128> mark("MPIDataAdaptor::GetMeshMetadata");
+
+  // check if an analysis told us how the data should land by
+  // passing in reciever metadata
+  if (this->GetReceiverMeshMetadata(id, metadata))
+    {
+    // layout was set by an analysis. did we do this already?
+    if (id >= this->Internals->ReceiverMetadata.size())
+      {
+      SENSEI_ERROR("Mesh id " << id << " is out of bounds")
+      return -1;
+      }
+
+    // we did this already, return cached layout
+    metadata = this->Internals->ReceiverMetadata[id];
+    if (metadata)
+      return this->ApplyDataRequirements(metadata);
+
+    // first time through. use the partitioner to figure it out.
+    // get the sender layout.
+    MeshMetadataPtr senderMd;
+    if (this->GetSenderMeshMetadata(id, senderMd))
+      {
+      SENSEI_ERROR("Failed to get sender metadata")
+      return -1;
+      }
+
+    // get the partitioner, default to the block partitioner
+    PartitionerPtr part = this->GetPartitioner();
+    if (!part)
+      {
+      SENSEI_WARNING("No partitoner specified, using BlockParititoner")
+      part = BlockPartitioner::New();
+      }
+
+    MeshMetadataPtr receiverMd;
+    if (part->GetPartition(this->GetCommunicator(), senderMd, receiverMd))
+      {
+      SENSEI_ERROR("Failed to determine a suitable layout to receive the data")
+      return -1;
+      }
+
+    // leave the AMR levels the analyses do not need on the sender
+    if (this->ApplyLevelRequirements(receiverMd))
+      {
+      SENSEI_ERROR("Failed to select the required levels")
+      return -1;
+      }
+
+    // cache and return the new layout
+    this->Internals->ReceiverMetadata[id] = receiverMd;
+    metadata = receiverMd;
+    }
+
+  // pass only the arrays the analyses require
+  return this->ApplyDataRequirements(metadata);
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::GetReceiverLayout(const std::string &meshName,
+  MeshMetadataPtr &md)
+{
+  unsigned int nMeshes = this->Internals->SenderMetadata.size();
+  for (unsigned int i = 0; i < nMeshes; ++i)
+    {
+    if (this->Internals->SenderMetadata[i]->MeshName == meshName)
+      return this->GetMeshMetadata(i, md);
+    }
+
+  SENSEI_ERROR("No mesh named \"" << meshName << "\"")
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::GetMesh(const std::string &meshName,
+   bool structureOnly, vtkDataObject *&mesh)
+{
+  TimeEvent<128> mark("MPIDataAdaptor::GetMesh");
+
+  mesh = nullptr;
+
+  MeshMetadataPtr md;
+  std::vector<int> owners;
+  if (this->GetReceiverLayout(meshName, md) ||
+    senseiMPI::GetBlockOwners(md, owners))
+    {
+    SENSEI_ERROR("Failed to get the layout of mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  // ask for the blocks
+  BinaryStream req;
+  req.Pack(int(senseiMPI::REQUEST_GET_MESH));
+  req.Pack(meshName);
+  req.Pack(int(structureOnly));
+  req.Pack(owners);
+
+  if (senseiMPI::Broadcast(this->Internals->InterComm, true, req))
+    {
+    SENSEI_ERROR("Failed to request mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  // put the blocks in place as they arrive
+  int rank = 0;
+  MPI_Comm_rank(this->GetCommunicator(), &rank);
+
+  std::vector<int> localIds;
+  for (int i = 0; i < md->NumBlocks; ++i)
+    {
+    if (owners[i] == rank)
+      localIds.push_back(i);
+    }
+
+  vtkCompositeDataSet *mbds = VTKUtils::NewLocalBlocks(md->NumBlocks,
+    localIds, this->GetPartitionedBlocks());
+
+  senseiMPI::ReceiveFunction recv = [&](int, BinaryStream &bs) -> int
+    {
+    while (bs.GetReadPos() < bs.Size())
+      {
+      int bid = 0;
+      bs.Unpack(bid);
+
+      vtkDataObject *dobj = nullptr;
+      if (senseiMPI::UnpackBlock(bs, dobj))
+        {
+        SENSEI_ERROR("Failed to deserialize block " << bid)
+        return -1;
+        }
+
+      int ierr = VTKUtils::SetLocalBlock(mbds, bid, dobj);
+      dobj->Delete();
+
+      if (ierr)
+        {
+        SENSEI_ERROR("Received block " << bid << " which is not on this rank")
+        return -1;
+        }
+      }
+    return 0;
+    };
+
+  if (senseiMPI::Exchange(this->Internals->InterComm, false,
+    this->Internals->LocalPeers, std::vector<BinaryStream>(), recv))
+    {
+    SENSEI_ERROR("Failed to receive mesh \"" << meshName << "\"")
+    mbds->Delete();
+    return -1;
+    }
+
+  mesh = mbds;
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::AddGhostNodesArray(vtkDataObject *mesh,
+  const std::string &meshName)
+{
+  TimeEvent<128> mark("MPIDataAdaptor::AddGhostNodesArray");
+  return AddArray(mesh, meshName, vtkDataObject::POINT, "vtkGhostType");
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::AddGhostCellsArray(vtkDataObject *mesh,
+  const std::string &meshName)
+{
+  TimeEvent<128> mark("MPIDataAdaptor::AddGhostCellsArray");
+  return AddArray(mesh, meshName, vtkDataObject::CELL, "vtkGhostType");
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::AddArray(vtkDataObject* mesh,
+  const std::string &meshName, int association, const std::string& arrayName)
+{
+  TimeEvent<128> mark("MPIDataAdaptor::AddArray");
+
+  // the mesh should never be null. there must have been an error
+  // upstream.
+  vtkCompositeDataSet *mbds = dynamic_cast<vtkCompositeDataSet*>(mesh);
+  if (!mbds)
+    {
+    SENSEI_ERROR("Invalid mesh object")
+    return -1;
+    }
+
+  MeshMetadataPtr md;
+  std::vector<int> owners;
+  if (this->GetReceiverLayout(meshName, md) ||
+    senseiMPI::GetBlockOwners(md, owners))
+    {
+    SENSEI_ERROR("Failed to get the layout of mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  // ask for the array
+  BinaryStream req;
+  req.Pack(int(senseiMPI::REQUEST_ADD_ARRAY));
+  req.Pack(meshName);
+  req.Pack(association);
+  req.Pack(arrayName);
+  req.Pack(owners);
+
+  if (senseiMPI::Broadcast(this->Internals->InterComm, true, req))
+    {
+    SENSEI_ERROR("Failed to request array \"" << arrayName << "\"")
+    return -1;
+    }
+
+  // attach the arrays to the blocks as they arrive
+  senseiMPI::ReceiveFunction recv = [&](int, BinaryStream &bs) -> int
+    {
+    while (bs.GetReadPos() < bs.Size())
+      {
+      int bid = 0;
+      bs.Unpack(bid);
+
+      vtkDataArray *da = nullptr;
+      if (senseiMPI::UnpackArray(bs, da))
+        {
+        SENSEI_ERROR("Failed to deserialize the array of block " << bid)
+        return -1;
+        }
+
+      vtkDataSet *ds = dynamic_cast<vtkDataSet*>(
+        VTKUtils::GetLocalBlock(mbds, bid));
+
+      if (!ds)
+        {
+        SENSEI_ERROR("Received an array for block " << bid
+          << " which is not on this rank")
+        da->Delete();
+        return -1;
+        }
+
+      VTKUtils::GetAttributes(ds, association)->AddArray(da);
+      da->Delete();
+      }
+    return 0;
+    };
+
+  if (senseiMPI::Exchange(this->Internals->InterComm, false,
+    this->Internals->LocalPeers, std::vector<BinaryStream>(), recv))
+    {
+    SENSEI_ERROR("Failed to receive " << VTKUtils::GetAttributesName(association)
+      << " data array \"" << arrayName << "\" of mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MPIDataAdaptor::ReleaseData()
+{
+  TimeEvent<128> mark("MPIDataAdaptor::ReleaseData");
+  return 0;
+}
+
+}
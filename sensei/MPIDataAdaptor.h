@@ -0,0 +1,119 @@
+#ifndef MPIDataAdaptor_h
+#define MPIDataAdaptor_h
+
+#include "InTransitDataAdaptor.h"
+
+#include <mpi.h>
+#include <string>
+
+namespace pugi { class xml_node; }
+namespace sensei { class BinaryStream; }
+
+namespace sensei
+{
+
+/// @class MPIDataAdaptor
+/// @brief The read side of the MPI transport.
+///
+/// Blocks are received directly from the simulation's ranks over an
+/// intercommunicator, see MPIAnalysisAdaptor for the write side. The
+/// metadata of each step is received when the stream is advanced, meshes
+/// and arrays are moved when GetMesh and AddArray are called. Blocks land
+/// on the ranks given by the receiver metadata, which the partitioner
+/// computes unless an analysis sets it. The simulation waits in its
+/// Execute until the step is advanced past or the stream is closed.
+///
+/// In XML the connection is given by the connect attribute, port (the
+/// default) or mpmd. In port mode the end point is started first, and
+/// publishes its port in the file given by the filename attribute or the
+/// connection info. In mpmd mode the peer_application attribute may give
+/// the MPI_APPNUM of the simulation. The shared_memory attribute enables
+/// moving data through shared memory on the same node.
+///
+/// Results posted by the end point's analyses with PostResult are sent
+/// with the request that ends the step, see
+/// MPIAnalysisAdaptor::ReceiveResult.
+class MPIDataAdaptor : public sensei::InTransitDataAdaptor
+{
+public:
+  static MPIDataAdaptor* New();
+  senseiTypeMacro(MPIDataAdaptor, sensei::InTransitDataAdaptor);
+
+  /// set how to connect, one of senseiMPI::CONNECT_PORT or CONNECT_MPMD
+  void SetConnectMode(int mode);
+
+  /// set the file the port name is published in. this will be the same
+  /// name given to the write side analysis adaptor
+  void SetFileName(const std::string &fileName);
+
+  /// set the MPI_APPNUM of the simulation in an MPMD job. the default,
+  /// -1, connects to the other application
+  void SetPeerApplication(int appNum);
+
+  /// receive data from simulation ranks on the same node through shared
+  /// memory. the arrays point into the shared memory. the simulation must
+  /// enable it too. default off
+  void SetSharedMemory(int val);
+
+  /// post a result for the simulation. results are gathered to rank 0
+  /// and travel with the request that ends the step, the simulation
+  /// receives them before its Execute returns
+  int PostResult(const std::string &tag, const std::string &result) override;
+
+  /// SENSEI InTransitDataAdaptor control API
+  int Initialize(pugi::xml_node &parent) override;
+  int Finalize() override;
+
+  int OpenStream() override;
+  int CloseStream() override;
+  int AdvanceStream() override;
+  int StreamGood() override;
+
+  /// SENSEI InTransitDataAdaptor explicit paritioning API
+  int GetSenderMeshMetadata(unsigned int id, MeshMetadataPtr &metadata) override;
+
+  /// SENSEI DataAdaptor API
+  int GetNumberOfMeshes(unsigned int &numMeshes) override;
+
+  int GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadata) override;
+
+  int GetMesh(const std::string &meshName, bool structure_only,
+    vtkDataObject *&mesh) override;
+
+  int AddGhostNodesArray(vtkDataObject* mesh, const std::string &meshName) override;
+  int AddGhostCellsArray(vtkDataObject* mesh, const std::string &meshName) override;
+
+  int AddArray(vtkDataObject* mesh, const std::string &meshName,
+    int association, const std::string &arrayName) override;
+
+  int ReleaseData() override;
+
+protected:
+  MPIDataAdaptor();
+  ~MPIDataAdaptor();
+
+  // receives the header of the next step, the time, time step and
+  // metadata
+  int ReceiveHeader();
+
+  // sends a request to the simulation
+  int SendRequest(int code);
+
+  // gathers the results posted on all ranks and packs them on rank 0.
+  // the posted results are cleared
+  int PackResults(BinaryStream &bs);
+
+  // gets the receiver layout of the named mesh
+  int GetReceiverLayout(const std::string &meshName, MeshMetadataPtr &md);
+
+private:
+  struct InternalsType;
+  InternalsType *Internals;
+
+  MPIDataAdaptor(const MPIDataAdaptor&) = delete;
+  void operator=(const MPIDataAdaptor&) = delete;
+};
+
+}
+
+#endif
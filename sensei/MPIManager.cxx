@@ -1,4 +1,5 @@
 #include "MPIManager.h"
+#include "MPIUtils.h"
 #include "Profiler.h"
 #include "Error.h"
 
@@ -11,25 +12,49 @@ namespace sensei
 {
 
 // --------------------------------------------------------------------------
-MPIManager::MPIManager(int &argc, char **&argv)
-  : mRank(0),  mSize(1)
+MPIManager::MPIManager(int &argc, char **&argv, int requiredThreadLevel,
+  int requestedThreadLevel) : mRank(0),  mSize(1),
+  mThreadLevel(MPI_THREAD_SINGLE), mOwnMPI(false)
 {
   Profiler::Enable(0x01);
   Profiler::StartEvent("TotalRunTime");
   Profiler::StartEvent("AppInitialize");
 
 #if defined(SENSEI_HAS_MPI)
-  int required = MPI_THREAD_SERIALIZED;
-  int provided = 0;
-  MPI_Init_thread(&argc, &argv, required, &provided);
-  if (provided < required)
+  const char *envLevel = getenv("SENSEI_MPI_THREAD_LEVEL");
+  if (envLevel && MPIUtils::GetThreadLevel(envLevel, requestedThreadLevel))
     {
-    SENSEI_ERROR("This MPI does not support thread serialized");
+    SENSEI_ERROR("Invalid SENSEI_MPI_THREAD_LEVEL \"" << envLevel
+      << "\". Use one of single, funneled, serialized, or multiple")
+    abort();
+    }
+
+  int requested = std::max(requestedThreadLevel, requiredThreadLevel);
+
+  int init = 0;
+  MPI_Initialized(&init);
+  if (init)
+    {
+    MPI_Query_thread(&mThreadLevel);
+    }
+  else
+    {
+    MPI_Init_thread(&argc, &argv, requested, &mThreadLevel);
+    mOwnMPI = true;
+    }
+
+  if (mThreadLevel < requiredThreadLevel)
+    {
+    SENSEI_ERROR("This MPI does not support "
+      << MPIUtils::GetThreadLevelName(requiredThreadLevel)
+      << ", it provides " << MPIUtils::GetThreadLevelName(mThreadLevel))
     abort();
     }
 #else
   (void)argc;
   (void)argv;
+  (void)requiredThreadLevel;
+  (void)requestedThreadLevel;
 #endif
 
   Profiler::Disable();
@@ -39,6 +64,13 @@ MPIManager::MPIManager(int &argc, char **&argv)
 #if defined(SENSEI_HAS_MPI)
   MPI_Comm_rank(MPI_COMM_WORLD, &mRank);
   MPI_Comm_size(MPI_COMM_WORLD, &mSize);
+
+  if ((mRank == 0) && (mThreadLevel < requested))
+    {
+    SENSEI_STATUS("Requested " << MPIUtils::GetThreadLevelName(requested)
+      << " but MPI provides " << MPIUtils::GetThreadLevelName(mThreadLevel)
+      << ". Asynchronous analyses will run synchronously")
+    }
 #endif
 
   Profiler::EndEvent("AppInitialize");
@@ -51,9 +83,10 @@ MPIManager::~MPIManager()
   Profiler::Finalize();
 
 #if defined(SENSEI_HAS_MPI)
+  // MPI is left for the code that initialized it to finalize
   int ok = 0;
   MPI_Initialized(&ok);
-  if (ok)
+  if (ok && mOwnMPI)
     MPI_Finalize();
 #endif
 
@@ -4,6 +4,8 @@
 #include "senseiConfig.h"
 #define SENSEI_HAS_MPI
 
+#include <mpi.h>
+
 namespace sensei
 {
 
@@ -11,6 +13,16 @@ namespace sensei
 // MPI_Init is handled in the constructor, MPI_Finalize is handled in the
 // destructor. Given that this is an application level helper rank and size
 // are reported relatoive to MPI_COMM_WORLD.
+//
+// MPI is initialized with MPI_Init_thread. The requested thread level is
+// asked for and the required level is verified, the application aborts
+// when the MPI library provides less than the required level. By default
+// MPI_THREAD_MULTIPLE is requested, which is needed by analyses that run
+// asynchronously or concurrently (see ConfigurableAnalysis), and
+// MPI_THREAD_SERIALIZED is required. The SENSEI_MPI_THREAD_LEVEL
+// environment variable overrides the requested level with one of single,
+// funneled, serialized, or multiple. If MPI was already initialized the
+// level it provides is verified.
 class MPIManager
 {
 public:
@@ -18,15 +30,23 @@ public:
   MPIManager(const MPIManager &) = delete;
   void operator=(const MPIManager &) = delete;
 
-  MPIManager(int &argc, char **&argv);
+  MPIManager(int &argc, char **&argv,
+    int requiredThreadLevel = MPI_THREAD_SERIALIZED,
+    int requestedThreadLevel = MPI_THREAD_MULTIPLE);
+
   ~MPIManager();
 
   int GetCommRank(){ return mRank; }
   int GetCommSize(){ return mSize; }
 
+  // the thread level provided by the MPI library
+  int GetThreadLevel(){ return mThreadLevel; }
+
 private:
   int mRank;
   int mSize;
+  int mThreadLevel;
+  bool mOwnMPI;
 };
 
 }
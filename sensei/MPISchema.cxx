@@ -0,0 +1,1054 @@
+#include "senseiConfig.h"
+#include "MPISchema.h"
+#include "BinaryStream.h"
+#include "BufferPool.h"
+#include "VTKUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkPoints.h>
+#include <vtkPointSet.h>
+#include <vtkPolyData.h>
+#include <vtkRectilinearGrid.h>
+#include <vtkSmartPointer.h>
+#include <vtkStructuredGrid.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnstructuredGrid.h>
+#include <vtkVersionMacros.h>
+#if defined(ENABLE_VTK_GENERIC_ARRAYS) && ((VTK_VERSION_MAJOR > 8) || \
+  ((VTK_VERSION_MAJOR == 8) && (VTK_VERSION_MINOR >= 1)))
+#include <vtkAOSDataArrayTemplate.h>
+#define SENSEI_MPI_SHARED_VIEWS
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace senseiMPI
+{
+
+// the tag used to create the MPMD intercommunicator
+constexpr int mpmdTag = 6296;
+
+// the tag of the data messages
+constexpr int dataTag = 6297;
+
+// the largest message sent in one call, larger messages are split
+constexpr unsigned long maxMessage = 1ul << 30;
+
+// array values are aligned to this in the streams
+constexpr unsigned int valueAlignment = 64;
+
+// the name of a shared memory segment
+using SegmentName = std::array<char,64>;
+
+// the segments mapped by the receiver. a segment is unmapped when the
+// last reference to it is released
+struct Segment
+{
+  unsigned long Size;
+  int References;
+};
+
+static std::mutex segmentMutex;
+static std::map<const unsigned char*, Segment> segments;
+
+// --------------------------------------------------------------------------
+static int CreateSegment(const sensei::BinaryStream &bs, SegmentName &name)
+{
+  sensei::TimeEvent<128> mark("senseiMPI::CreateSegment");
+
+  static unsigned long counter = 0;
+
+  name.fill('\0');
+
+  std::string segName = "/sensei-" + std::to_string(getpid()) + "-" +
+    std::to_string(counter++);
+
+  int fd = shm_open(segName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0)
+    {
+    SENSEI_ERROR("Failed to create shared memory segment " << segName
+      << ". " << strerror(errno))
+    return -1;
+    }
+
+  unsigned long nBytes = bs.Size();
+  void *data = MAP_FAILED;
+
+  if (ftruncate(fd, nBytes) ||
+    ((data = mmap(nullptr, nBytes, PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED))
+    {
+    SENSEI_ERROR("Failed to map shared memory segment " << segName
+      << ". " << strerror(errno))
+    close(fd);
+    shm_unlink(segName.c_str());
+    return -1;
+    }
+
+  close(fd);
+
+  memcpy(data, bs.GetData(), nBytes);
+  munmap(data, nBytes);
+
+  // the receiver removes the name once it has mapped the segment
+  strncpy(name.data(), segName.c_str(), name.size() - 1);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+static int OpenSegment(const SegmentName &name, unsigned long nBytes,
+  unsigned char *&data)
+{
+  sensei::TimeEvent<128> mark("senseiMPI::OpenSegment");
+
+  data = nullptr;
+
+  if (name[0] == '\0')
+    {
+    SENSEI_ERROR("The sender failed to create a shared memory segment")
+    return -1;
+    }
+
+  int fd = shm_open(name.data(), O_RDONLY, 0);
+  if (fd < 0)
+    {
+    SENSEI_ERROR("Failed to open shared memory segment " << name.data()
+      << ". " << strerror(errno))
+    shm_unlink(name.data());
+    return -1;
+    }
+
+  // a private mapping lets the analyses modify arrays in place
+  void *mem = mmap(nullptr, nBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+  shm_unlink(name.data());
+
+  if (mem == MAP_FAILED)
+    {
+    SENSEI_ERROR("Failed to map shared memory segment " << name.data()
+      << ". " << strerror(errno))
+    return -1;
+    }
+
+  data = static_cast<unsigned char*>(mem);
+
+  std::lock_guard<std::mutex> lock(segmentMutex);
+  segments[data] = Segment{nBytes, 1};
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+static std::map<const unsigned char*, Segment>::iterator FindSegment(
+  const void *ptr)
+{
+  const unsigned char *p = static_cast<const unsigned char*>(ptr);
+
+  std::map<const unsigned char*, Segment>::iterator it =
+    segments.upper_bound(p);
+
+  if (it == segments.begin())
+    return segments.end();
+
+  --it;
+
+  return (p < it->first + it->second.Size) ? it : segments.end();
+}
+
+#if defined(SENSEI_MPI_SHARED_VIEWS)
+// --------------------------------------------------------------------------
+static bool RetainSegment(const void *ptr)
+{
+  std::lock_guard<std::mutex> lock(segmentMutex);
+
+  std::map<const unsigned char*, Segment>::iterator it = FindSegment(ptr);
+  if (it == segments.end())
+    return false;
+
+  it->second.References += 1;
+
+  return true;
+}
+#endif
+
+// --------------------------------------------------------------------------
+static void ReleaseSegment(void *ptr)
+{
+  std::lock_guard<std::mutex> lock(segmentMutex);
+
+  std::map<const unsigned char*, Segment>::iterator it = FindSegment(ptr);
+  if (it == segments.end())
+    return;
+
+  if (--it->second.References == 0)
+    {
+    munmap(const_cast<unsigned char*>(it->first), it->second.Size);
+    segments.erase(it);
+    }
+}
+
+// --------------------------------------------------------------------------
+int Accept(MPI_Comm comm, const std::string &portFile, MPI_Comm &inter)
+{
+  sensei::TimeEvent<128> mark("senseiMPI::Accept");
+
+  inter = MPI_COMM_NULL;
+
+  if (portFile.empty())
+    {
+    SENSEI_ERROR("A file name is needed to publish the port")
+    return -1;
+    }
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  char port[MPI_MAX_PORT_NAME] = {'\0'};
+
+  // publish the port. the file is renamed into place so that the sender
+  // never reads a partial port name
+  int ok = 1;
+  if (rank == 0)
+    {
+    MPI_Open_port(MPI_INFO_NULL, port);
+
+    std::string tmpFile = portFile + ".tmp";
+    std::ofstream ofs(tmpFile);
+    ofs << port << std::endl;
+    ofs.close();
+
+    if (!ofs.good() || std::rename(tmpFile.c_str(), portFile.c_str()))
+      {
+      SENSEI_ERROR("Failed to write the port name to \"" << portFile << "\"")
+      MPI_Close_port(port);
+      ok = 0;
+      }
+    }
+
+  MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+  if (!ok)
+    return -1;
+
+  MPI_Comm_accept(port, MPI_INFO_NULL, 0, comm, &inter);
+
+  if (rank == 0)
+    {
+    MPI_Close_port(port);
+    std::remove(portFile.c_str());
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int Connect(MPI_Comm comm, const std::string &portFile, double timeout,
+  MPI_Comm &inter)
+{
+  sensei::TimeEvent<128> mark("senseiMPI::Connect");
+
+  inter = MPI_COMM_NULL;
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  char port[MPI_MAX_PORT_NAME] = {'\0'};
+
+  // wait for the receiver to publish its port
+  int ok = 0;
+  if (rank == 0)
+    {
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+    while (!ok)
+      {
+      std::ifstream ifs(portFile);
+      std::string portName;
+      if (ifs && std::getline(ifs, portName) && !portName.empty() &&
+        (portName.size() < MPI_MAX_PORT_NAME))
+        {
+        strncpy(port, portName.c_str(), MPI_MAX_PORT_NAME - 1);
+        ok = 1;
+        break;
+        }
+
+      std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+      if (elapsed.count() > timeout)
+        {
+        SENSEI_ERROR("No port was published in \"" << portFile
+          << "\" after " << timeout << " seconds")
+        break;
+        }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+    }
+
+  MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+  if (!ok)
+    return -1;
+
+  MPI_Comm_connect(port, MPI_INFO_NULL, 0, comm, &inter);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+static int GetAppNumber()
+{
+  int *appNum = nullptr;
+  int flag = 0;
+  MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_APPNUM, &appNum, &flag);
+  return (flag && appNum) ? *appNum : 0;
+}
+
+// --------------------------------------------------------------------------
+int GetAppCommunicator(MPI_Comm &appComm)
+{
+  int worldRank = 0;
+  MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+
+  MPI_Comm_split(MPI_COMM_WORLD, GetAppNumber(), worldRank, &appComm);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ConnectMPMD(MPI_Comm comm, int peerApp, MPI_Comm &inter)
+{
+  sensei::TimeEvent<128> mark("senseiMPI::ConnectMPMD");
+
+  inter = MPI_COMM_NULL;
+
+  int app = GetAppNumber();
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  int worldSize = 1;
+  MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+  // find the world rank of the peer application's leader
+  int leader = rank == 0 ? app : -1;
+  std::vector<int> leaders(worldSize);
+  MPI_Allgather(&leader, 1, MPI_INT, leaders.data(), 1, MPI_INT,
+    MPI_COMM_WORLD);
+
+  int remoteLeader = -1;
+  for (int i = 0; i < worldSize; ++i)
+    {
+    if ((leaders[i] >= 0) && (leaders[i] != app) &&
+      ((peerApp < 0) || (leaders[i] == peerApp)))
+      {
+      remoteLeader = i;
+      break;
+      }
+    }
+
+  if (remoteLeader < 0)
+    {
+    SENSEI_ERROR("Application " << app << " found no peer application "
+      << (peerApp < 0 ? std::string("") : std::to_string(peerApp))
+      << " in MPI_COMM_WORLD")
+    return -1;
+    }
+
+  MPI_Intercomm_create(comm, 0, MPI_COMM_WORLD, remoteLeader, mpmdTag, &inter);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int Disconnect(MPI_Comm &inter, int mode)
+{
+  sensei::TimeEvent<128> mark("senseiMPI::Disconnect");
+
+  if (inter == MPI_COMM_NULL)
+    return 0;
+
+  if (mode == CONNECT_PORT)
+    MPI_Comm_disconnect(&inter);
+  else
+    MPI_Comm_free(&inter);
+
+  inter = MPI_COMM_NULL;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int Broadcast(MPI_Comm inter, bool source, sensei::BinaryStream &bs)
+{
+  sensei::TimeEvent<128> mark("senseiMPI::Broadcast");
+
+  unsigned long nBytes = 0;
+
+  if (source)
+    {
+    int rank = 0;
+    MPI_Comm_rank(inter, &rank);
+
+    int root = rank == 0 ? MPI_ROOT : MPI_PROC_NULL;
+
+    nBytes = bs.Size();
+    if (nBytes > maxMessage)
+      {
+      SENSEI_ERROR("Control message of " << nBytes << " bytes exceeds the "
+        << maxMessage << " byte limit")
+      nBytes = 0;
+      }
+
+    MPI_Bcast(&nBytes, 1, MPI_UNSIGNED_LONG, root, inter);
+
+    if (nBytes)
+      MPI_Bcast(bs.GetData(), nBytes, MPI_BYTE, root, inter);
+    }
+  else
+    {
+    MPI_Bcast(&nBytes, 1, MPI_UNSIGNED_LONG, 0, inter);
+
+    bs.Resize(nBytes);
+
+    if (nBytes)
+      MPI_Bcast(bs.GetData(), nBytes, MPI_BYTE, 0, inter);
+
+    bs.SetReadPos(0);
+    bs.SetWritePos(nBytes);
+    }
+
+  return nBytes ? 0 : -1;
+}
+
+// --------------------------------------------------------------------------
+int GetLocalPeers(MPI_Comm inter, int enable, std::vector<int> &local)
+{
+  sensei::TimeEvent<128> mark("senseiMPI::GetLocalPeers");
+
+  int nRemote = 0;
+  MPI_Comm_remote_size(inter, &nRemote);
+
+  // each rank sends its flag followed by its node's name
+  constexpr int len = MPI_MAX_PROCESSOR_NAME + 1;
+
+  std::vector<char> mine(len, '\0');
+  int nameLen = 0;
+  MPI_Get_processor_name(mine.data() + 1, &nameLen);
+  mine[0] = enable ? 1 : 0;
+
+  std::vector<char> remote(nRemote*len, '\0');
+  MPI_Allgather(mine.data(), len, MPI_CHAR, remote.data(), len, MPI_CHAR,
+    inter);
+
+  local.assign(nRemote, 0);
+  for (int i = 0; i < nRemote; ++i)
+    {
+    const char *peer = remote.data() + i*len;
+    local[i] = mine[0] && peer[0] &&
+      (strncmp(mine.data() + 1, peer + 1, MPI_MAX_PROCESSOR_NAME) == 0);
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int Exchange(MPI_Comm inter, bool source, const std::vector<int> &local,
+  const std::vector<sensei::BinaryStream> &send, const ReceiveFunction &recv)
+{
+  sensei::TimeEvent<128> mark("senseiMPI::Exchange");
+
+  int nRemote = 0;
+  MPI_Comm_remote_size(inter, &nRemote);
+
+  std::vector<int> shared(local);
+  shared.resize(nRemote, 0);
+
+  // let the receivers know how much is coming from where
+  std::vector<unsigned long> sendCounts(nRemote, 0);
+  std::vector<unsigned long> recvCounts(nRemote, 0);
+
+  if (source)
+    {
+    int nSend = std::min(int(send.size()), nRemote);
+    for (int i = 0; i < nSend; ++i)
+      sendCounts[i] = send[i].Size();
+    }
+
+  MPI_Alltoall(sendCounts.data(), 1, MPI_UNSIGNED_LONG,
+    recvCounts.data(), 1, MPI_UNSIGNED_LONG, inter);
+
+  std::vector<MPI_Request> reqs;
+
+  // the names of the shared memory segments
+  std::vector<SegmentName> names(nRemote);
+
+  if (source)
+    {
+    for (int i = 0; i < nRemote; ++i)
+      {
+      if (!sendCounts[i])
+        continue;
+
+      // on the same node the data is placed in a segment and only the
+      // segment's name is sent. an empty name tells the receiver that
+      // the segment could not be created
+      if (shared[i])
+        {
+        CreateSegment(send[i], names[i]);
+        reqs.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(names[i].data(), names[i].size(), MPI_CHAR, i, dataTag,
+          inter, &reqs.back());
+        continue;
+        }
+
+      // messages are split in pieces below the int count limit, pieces
+      // between a pair of ranks arrive in order
+      const unsigned char *data = send[i].GetData();
+      for (unsigned long off = 0; off < sendCounts[i]; off += maxMessage)
+        {
+        int n = std::min(maxMessage, sendCounts[i] - off);
+        reqs.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(const_cast<unsigned char*>(data + off), n, MPI_BYTE, i,
+          dataTag, inter, &reqs.back());
+        }
+      }
+
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+
+    return 0;
+    }
+
+  // post the receives
+  std::vector<sensei::BinaryStream> bufs(nRemote);
+  std::vector<int> pending(nRemote, 0);
+  std::vector<int> reqRank;
+
+  for (int i = 0; i < nRemote; ++i)
+    {
+    if (!recvCounts[i])
+      continue;
+
+    if (shared[i])
+      {
+      reqs.push_back(MPI_REQUEST_NULL);
+      reqRank.push_back(i);
+      MPI_Irecv(names[i].data(), names[i].size(), MPI_CHAR, i, dataTag,
+        inter, &reqs.back());
+      pending[i] = 1;
+      continue;
+      }
+
+    bufs[i].Resize(recvCounts[i]);
+    unsigned char *data = bufs[i].GetData();
+
+    for (unsigned long off = 0; off < recvCounts[i]; off += maxMessage)
+      {
+      int n = std::min(maxMessage, recvCounts[i] - off);
+      reqs.push_back(MPI_REQUEST_NULL);
+      reqRank.push_back(i);
+      MPI_Irecv(data + off, n, MPI_BYTE, i, dataTag, inter, &reqs.back());
+      pending[i] += 1;
+      }
+    }
+
+  // deserialize each message as soon as it is complete, while the others
+  // are still in flight
+  int ierr = 0;
+  int nReqs = reqs.size();
+  for (int i = 0; i < nReqs; ++i)
+    {
+    int idx = MPI_UNDEFINED;
+    MPI_Waitany(nReqs, reqs.data(), &idx, MPI_STATUS_IGNORE);
+
+    if (idx == MPI_UNDEFINED)
+      break;
+
+    int r = reqRank[idx];
+    if (--pending[r])
+      continue;
+
+    sensei::BinaryStream &bs = bufs[r];
+
+    unsigned char *segment = nullptr;
+    if (shared[r])
+      {
+      if (OpenSegment(names[r], recvCounts[r], segment))
+        {
+        SENSEI_ERROR("Failed to map the data from rank " << r)
+        ierr = -1;
+        continue;
+        }
+      bs.SetExternalBuffer(segment, recvCounts[r]);
+      }
+    else
+      {
+      bs.SetReadPos(0);
+      bs.SetWritePos(recvCounts[r]);
+      }
+
+    if (recv(r, bs))
+      {
+      SENSEI_ERROR("Failed to process the data from rank " << r)
+      ierr = -1;
+      }
+
+    bs.Clear();
+
+    // the arrays that point into the segment keep it mapped
+    if (segment)
+      ReleaseSegment(segment);
+    }
+
+  return ierr;
+}
+
+// --------------------------------------------------------------------------
+int PackArray(vtkDataArray *da, sensei::BinaryStream &bs)
+{
+  if (!da)
+    {
+    SENSEI_ERROR("Can't pack a null array")
+    return -1;
+    }
+
+  // copy arrays in other layouts into the standard one
+  vtkSmartPointer<vtkDataArray> aos = da;
+  if (!da->HasStandardMemoryLayout())
+    {
+    aos.TakeReference(vtkDataArray::CreateDataArray(da->GetDataType()));
+    aos->DeepCopy(da);
+    }
+
+  int type = aos->GetDataType();
+  int nComps = aos->GetNumberOfComponents();
+  long nTuples = aos->GetNumberOfTuples();
+  unsigned long nBytes = nTuples*nComps*aos->GetDataTypeSize();
+
+  bs.Pack(std::string(da->GetName() ? da->GetName() : ""));
+  bs.Pack(type);
+  bs.Pack(nComps);
+  bs.Pack(nTuples);
+
+  // pad so that the values are aligned relative to the head of the
+  // stream. a receiver that maps the stream uses the values in place
+  static const unsigned char zeros[valueAlignment] = {0};
+  unsigned char pad = (valueAlignment - (bs.Size() + 1) % valueAlignment) %
+    valueAlignment;
+  bs.Pack(pad);
+  bs.Pack(zeros, pad);
+
+  if (nBytes)
+    bs.Pack(static_cast<const unsigned char*>(aos->GetVoidPointer(0)), nBytes);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int UnpackArray(sensei::BinaryStream &bs, vtkDataArray *&da)
+{
+  std::string name;
+  int type = 0;
+  int nComps = 0;
+  long nTuples = 0;
+  unsigned char pad = 0;
+
+  bs.Unpack(name);
+  bs.Unpack(type);
+  bs.Unpack(nComps);
+  bs.Unpack(nTuples);
+  bs.Unpack(pad);
+  bs.UnpackView<unsigned char>(pad);
+
+  da = nullptr;
+
+#if defined(SENSEI_MPI_SHARED_VIEWS)
+  // when the stream is in a shared memory segment point to the values
+  // in place. the array holds a reference to the segment
+  vtkIdType nVals = vtkIdType(nTuples)*nComps;
+  if (nVals && RetainSegment(bs.GetData() + bs.GetReadPos()))
+    {
+    switch (type)
+      {
+      vtkTemplateMacro(
+        vtkDataArray *tmp = vtkDataArray::CreateDataArray(type);
+        vtkAOSDataArrayTemplate<VTK_TT> *aos =
+          dynamic_cast<vtkAOSDataArrayTemplate<VTK_TT>*>(tmp);
+        if (aos)
+          {
+          const VTK_TT *vals = bs.UnpackView<VTK_TT>(nVals);
+          aos->SetNumberOfComponents(nComps);
+          aos->SetArray(const_cast<VTK_TT*>(vals), nVals, 0,
+            vtkAbstractArray::VTK_DATA_ARRAY_USER_DEFINED);
+          aos->SetArrayFreeFunction(ReleaseSegment);
+          da = aos;
+          }
+        else
+          {
+          if (tmp)
+            tmp->Delete();
+          ReleaseSegment(bs.GetData() + bs.GetReadPos());
+          }
+        );
+      }
+
+    if (da)
+      {
+      da->SetName(name.c_str());
+      return 0;
+      }
+    }
+#endif
+
+  da = sensei::BufferPool::NewDataArray(type, nComps, nTuples);
+  if (!da)
+    {
+    SENSEI_ERROR("Failed to create array \"" << name << "\" of type " << type)
+    return -1;
+    }
+
+  da->SetName(name.c_str());
+
+  unsigned long nBytes = nTuples*nComps*da->GetDataTypeSize();
+  if (nBytes)
+    bs.Unpack(static_cast<unsigned char*>(da->GetVoidPointer(0)), nBytes);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+static int PackPoints(vtkPointSet *ps, sensei::BinaryStream &bs)
+{
+  vtkPoints *pts = ps->GetPoints();
+  int havePts = pts ? 1 : 0;
+  bs.Pack(havePts);
+  return havePts ? PackArray(pts->GetData(), bs) : 0;
+}
+
+// --------------------------------------------------------------------------
+static int UnpackPoints(sensei::BinaryStream &bs, vtkPointSet *ps)
+{
+  int havePts = 0;
+  bs.Unpack(havePts);
+
+  if (!havePts)
+    return 0;
+
+  vtkDataArray *da = nullptr;
+  if (UnpackArray(bs, da))
+    return -1;
+
+  vtkPoints *pts = vtkPoints::New();
+  pts->SetData(da);
+  da->Delete();
+
+  ps->SetPoints(pts);
+  pts->Delete();
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+static int PackCells(vtkCellArray *ca, sensei::BinaryStream &bs)
+{
+  long nCells = ca ? ca->GetNumberOfCells() : 0;
+  bs.Pack(nCells);
+  return nCells ? PackArray(ca->GetData(), bs) : 0;
+}
+
+// --------------------------------------------------------------------------
+static int UnpackCells(sensei::BinaryStream &bs, vtkCellArray *&ca)
+{
+  ca = nullptr;
+
+  long nCells = 0;
+  bs.Unpack(nCells);
+
+  if (!nCells)
+    return 0;
+
+  vtkDataArray *da = nullptr;
+  if (UnpackArray(bs, da))
+    return -1;
+
+  vtkIdTypeArray *ids = dynamic_cast<vtkIdTypeArray*>(da);
+  if (!ids)
+    {
+    SENSEI_ERROR("The cells are not stored in a vtkIdTypeArray")
+    da->Delete();
+    return -1;
+    }
+
+  ca = vtkCellArray::New();
+  ca->SetCells(nCells, ids);
+  ids->Delete();
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int PackBlock(vtkDataObject *dobj, bool structureOnly, sensei::BinaryStream &bs)
+{
+  if (!dobj)
+    {
+    SENSEI_ERROR("Can't pack a null block")
+    return -1;
+    }
+
+  int type = dobj->GetDataObjectType();
+  int geometry = structureOnly ? 0 : 1;
+
+  bs.Pack(type);
+  bs.Pack(geometry);
+
+  if (vtkImageData *im = dynamic_cast<vtkImageData*>(dobj))
+    {
+    bs.Pack(im->GetExtent(), 6);
+    bs.Pack(im->GetOrigin(), 3);
+    bs.Pack(im->GetSpacing(), 3);
+    }
+  else if (vtkRectilinearGrid *rg = dynamic_cast<vtkRectilinearGrid*>(dobj))
+    {
+    bs.Pack(rg->GetExtent(), 6);
+    if (geometry && (PackArray(rg->GetXCoordinates(), bs) ||
+      PackArray(rg->GetYCoordinates(), bs) || PackArray(rg->GetZCoordinates(), bs)))
+      return -1;
+    }
+  else if (vtkStructuredGrid *sg = dynamic_cast<vtkStructuredGrid*>(dobj))
+    {
+    bs.Pack(sg->GetExtent(), 6);
+    if (geometry && PackPoints(sg, bs))
+      return -1;
+    }
+  else if (vtkPolyData *pd = dynamic_cast<vtkPolyData*>(dobj))
+    {
+    if (geometry && (PackPoints(pd, bs) || PackCells(pd->GetVerts(), bs) ||
+      PackCells(pd->GetLines(), bs) || PackCells(pd->GetPolys(), bs) ||
+      PackCells(pd->GetStrips(), bs)))
+      return -1;
+    }
+  else if (vtkUnstructuredGrid *ug = dynamic_cast<vtkUnstructuredGrid*>(dobj))
+    {
+    if (geometry)
+      {
+      vtkUnsignedCharArray *types = ug->GetCellTypesArray();
+      int haveTypes = types ? 1 : 0;
+
+      if (PackPoints(ug, bs))
+        return -1;
+
+      bs.Pack(haveTypes);
+
+      if (haveTypes && (PackArray(types, bs) || PackCells(ug->GetCells(), bs)))
+        return -1;
+      }
+    }
+  else
+    {
+    SENSEI_ERROR("Blocks of type " << dobj->GetClassName()
+      << " are not supported by the MPI transport")
+    return -1;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int UnpackBlock(sensei::BinaryStream &bs, vtkDataObject *&dobj)
+{
+  dobj = nullptr;
+
+  int type = 0;
+  int geometry = 0;
+
+  bs.Unpack(type);
+  bs.Unpack(geometry);
+
+  dobj = sensei::VTKUtils::NewDataObject(type);
+  if (!dobj)
+    {
+    SENSEI_ERROR("Failed to create a block of type " << type)
+    return -1;
+    }
+
+  int ierr = 0;
+  if (vtkImageData *im = dynamic_cast<vtkImageData*>(dobj))
+    {
+    int ext[6] = {0};
+    double x0[3] = {0.0};
+    double dx[3] = {0.0};
+
+    bs.Unpack(ext, 6);
+    bs.Unpack(x0, 3);
+    bs.Unpack(dx, 3);
+
+    im->SetExtent(ext);
+    im->SetOrigin(x0);
+    im->SetSpacing(dx);
+    }
+  else if (vtkRectilinearGrid *rg = dynamic_cast<vtkRectilinearGrid*>(dobj))
+    {
+    int ext[6] = {0};
+    bs.Unpack(ext, 6);
+    rg->SetExtent(ext);
+
+    if (geometry)
+      {
+      vtkDataArray *coords[3] = {nullptr};
+      for (int i = 0; (i < 3) && !ierr; ++i)
+        ierr = UnpackArray(bs, coords[i]);
+
+      if (!ierr)
+        {
+        rg->SetXCoordinates(coords[0]);
+        rg->SetYCoordinates(coords[1]);
+        rg->SetZCoordinates(coords[2]);
+        }
+
+      for (int i = 0; i < 3; ++i)
+        if (coords[i])
+          coords[i]->Delete();
+      }
+    }
+  else if (vtkStructuredGrid *sg = dynamic_cast<vtkStructuredGrid*>(dobj))
+    {
+    int ext[6] = {0};
+    bs.Unpack(ext, 6);
+    sg->SetExtent(ext);
+
+    if (geometry)
+      ierr = UnpackPoints(bs, sg);
+    }
+  else if (vtkPolyData *pd = dynamic_cast<vtkPolyData*>(dobj))
+    {
+    if (geometry && !(ierr = UnpackPoints(bs, pd)))
+      {
+      vtkCellArray *cells[4] = {nullptr};
+      for (int i = 0; (i < 4) && !ierr; ++i)
+        ierr = UnpackCells(bs, cells[i]);
+
+      if (!ierr)
+        {
+        pd->SetVerts(cells[0]);
+        pd->SetLines(cells[1]);
+        pd->SetPolys(cells[2]);
+        pd->SetStrips(cells[3]);
+        }
+
+      for (int i = 0; i < 4; ++i)
+        if (cells[i])
+          cells[i]->Delete();
+      }
+    }
+  else if (vtkUnstructuredGrid *ug = dynamic_cast<vtkUnstructuredGrid*>(dobj))
+    {
+    int haveTypes = 0;
+    if (geometry && !(ierr = UnpackPoints(bs, ug)))
+      bs.Unpack(haveTypes);
+
+    if (haveTypes)
+      {
+      vtkDataArray *da = nullptr;
+      vtkCellArray *ca = nullptr;
+
+      if (!(ierr = UnpackArray(bs, da)) && !(ierr = UnpackCells(bs, ca)) && ca)
+        {
+        vtkUnsignedCharArray *types = dynamic_cast<vtkUnsignedCharArray*>(da);
+        vtkIdTypeArray *cells = ca->GetData();
+
+        long nCells = ca->GetNumberOfCells();
+        if (!types || (types->GetNumberOfTuples() != nCells))
+          {
+          SENSEI_ERROR("Invalid cell types array")
+          ierr = -1;
+          }
+        else
+          {
+          // build locations
+          vtkIdTypeArray *locs = vtkIdTypeArray::New();
+          locs->SetNumberOfTuples(nCells);
+          vtkIdType *pLocs = locs->GetPointer(0);
+          vtkIdType *pCells = cells->GetPointer(0);
+          pLocs[0] = 0;
+          for (long i = 1; i < nCells; ++i)
+            pLocs[i] = pLocs[i-1] + pCells[pLocs[i-1]] + 1;
+
+          ug->SetCells(types, locs, ca);
+          locs->Delete();
+          }
+        }
+
+      if (da)
+        da->Delete();
+
+      if (ca)
+        ca->Delete();
+      }
+    }
+  else
+    {
+    SENSEI_ERROR("Blocks of type " << dobj->GetClassName()
+      << " are not supported by the MPI transport")
+    ierr = -1;
+    }
+
+  if (ierr)
+    {
+    dobj->Delete();
+    dobj = nullptr;
+    return -1;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int GetBlockOwners(const sensei::MeshMetadataPtr &md, std::vector<int> &owners)
+{
+  owners.assign(md->NumBlocks, -1);
+
+  if ((md->BlockIds.size() != size_t(md->NumBlocks)) ||
+    (md->BlockOwner.size() != size_t(md->NumBlocks)))
+    {
+    SENSEI_ERROR("Metadata for mesh \"" << md->MeshName
+      << "\" is missing the block decomposition")
+    return -1;
+    }
+
+  for (int i = 0; i < md->NumBlocks; ++i)
+    {
+    int bid = md->BlockIds[i];
+    if ((bid < 0) || (bid >= md->NumBlocks))
+      {
+      SENSEI_ERROR("Invalid block id " << bid << " in mesh \""
+        << md->MeshName << "\"")
+      return -1;
+      }
+    owners[bid] = md->BlockOwner[i];
+    }
+
+  return 0;
+}
+
+}
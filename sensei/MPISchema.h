@@ -0,0 +1,108 @@
+#ifndef senseiMPISchema_h
+#define senseiMPISchema_h
+
+#include "MeshMetadata.h"
+
+#include <mpi.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sensei { class BinaryStream; }
+class vtkDataArray;
+class vtkDataObject;
+
+/// Helpers shared by the write and read sides of the MPI transport.
+///
+/// The two sides run as separate MPI applications joined by an
+/// intercommunicator. Control messages (step headers and the receiver's
+/// requests for data) are broadcast across the intercommunicator. Mesh
+/// blocks and arrays are serialized into a BinaryStream per destination
+/// rank and sent point to point, the receiver deserializes each message
+/// as soon as it arrives.
+///
+/// Ranks of the two sides that run on the same node may exchange the
+/// streams through POSIX shared memory instead. The sender copies its
+/// stream into a new segment and sends only the segment's name. The
+/// receiver maps the segment and the arrays it unpacks point into it,
+/// without a copy. The segment stays mapped until the last of these
+/// arrays is deleted.
+namespace senseiMPI
+{
+
+/// how the two sides are connected
+enum {CONNECT_PORT=0, CONNECT_MPMD=1};
+
+/// the requests the receiver sends to the sender during a step
+enum {REQUEST_END_STEP=0, REQUEST_GET_MESH=1, REQUEST_ADD_ARRAY=2,
+  REQUEST_CLOSE=3};
+
+/// Open an MPI port and wait for the sender to connect. The port name is
+/// written to portFile by rank 0 of comm, the sender reads it from there.
+/// Collective over comm.
+int Accept(MPI_Comm comm, const std::string &portFile, MPI_Comm &inter);
+
+/// Connect to a receiver that called Accept. Rank 0 of comm waits up to
+/// timeout seconds for portFile to appear. Collective over comm.
+int Connect(MPI_Comm comm, const std::string &portFile, double timeout,
+  MPI_Comm &inter);
+
+/// Split MPI_COMM_WORLD of an MPMD job (mpiexec -n N sim : -n M endpoint)
+/// into a communicator per application using MPI_APPNUM.
+/// Collective over MPI_COMM_WORLD.
+int GetAppCommunicator(MPI_Comm &appComm);
+
+/// Join the applications of an MPMD job. comm is this application's
+/// communicator. peerApp is the MPI_APPNUM of the other side, when
+/// negative the first other application found is used.
+/// Collective over MPI_COMM_WORLD.
+int ConnectMPMD(MPI_Comm comm, int peerApp, MPI_Comm &inter);
+
+/// Close the connection. Collective over both sides.
+int Disconnect(MPI_Comm &inter, int mode);
+
+/// Find the ranks of the other side that run on the same node. local
+/// gets a flag for each remote rank, set when both ranks enabled shared
+/// memory and run on the same node. Collective over both sides.
+int GetLocalPeers(MPI_Comm inter, int enable, std::vector<int> &local);
+
+/// Broadcast a stream from rank 0 of the source side to all ranks of
+/// the other side. source is true on the sending side.
+int Broadcast(MPI_Comm inter, bool source, sensei::BinaryStream &bs);
+
+/// Called for each message received by Exchange, with the remote rank
+using ReceiveFunction = std::function<int(int, sensei::BinaryStream &)>;
+
+/// Move data from the sender side to the receiver side. On the sender
+/// side send holds a stream for each rank of the receiver side, empty
+/// streams are not sent. On the receiver side send is ignored and recv
+/// is called with each message as it arrives. Messages between ranks
+/// flagged in local, see GetLocalPeers, go through shared memory.
+/// Collective over both sides.
+int Exchange(MPI_Comm inter, bool source, const std::vector<int> &local,
+  const std::vector<sensei::BinaryStream> &send, const ReceiveFunction &recv);
+
+/// Serialize the structure of a block, its geometry and topology. When
+/// structureOnly is set only the block type and extent are sent.
+int PackBlock(vtkDataObject *dobj, bool structureOnly, sensei::BinaryStream &bs);
+
+/// Construct a block from the stream. The caller takes the reference.
+int UnpackBlock(sensei::BinaryStream &bs, vtkDataObject *&dobj);
+
+/// Serialize an array. Arrays in non-standard layouts are copied into
+/// the standard layout.
+int PackArray(vtkDataArray *da, sensei::BinaryStream &bs);
+
+/// Construct an array from the stream. When the stream is in a shared
+/// memory segment the array points into the segment. The caller takes
+/// the reference.
+int UnpackArray(sensei::BinaryStream &bs, vtkDataArray *&da);
+
+/// Get the rank of the receiver side each block is sent to, indexed by
+/// block id.
+int GetBlockOwners(const sensei::MeshMetadataPtr &md,
+  std::vector<int> &owners);
+
+}
+
+#endif
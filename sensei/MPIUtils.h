@@ -1,7 +1,13 @@
 #ifndef MPIUtils_h
 #define MPIUtils_h
 
+#include "Profiler.h"
+
 #include <algorithm>
+#include <array>
+#include <limits>
+#include <string>
+#include <vector>
 
 namespace sensei
 {
@@ -24,6 +30,174 @@ define_mpi_tt(unsigned long, MPI_UNSIGNED_LONG)
 define_mpi_tt(float, MPI_FLOAT)
 define_mpi_tt(double, MPI_DOUBLE)
 
+// Large counts. The counts and displacements of MPI calls are int, which
+// global metadata and per rank buffers exceed on large runs. MPI 4 adds
+// variants of the calls taking MPI_Count, the helpers below use them when
+// available. With older MPI calls whose counts fit in an int are made as
+// they are, others are split into pieces of LargeCountChunk elements or
+// use a derived type whose count fits. The helpers return an MPI error
+// code.
+
+// the number of elements passed in one call when a call is split
+constexpr long LargeCountChunk = 1l << 30;
+
+// returns true if n fits in the count of an MPI call
+inline bool FitsInt(long n)
+{
+  return n <= long(std::numeric_limits<int>::max());
+}
+
+// make a type describing n contiguous elements of type, used with a count
+// of 1. the caller frees it with MPI_Type_free
+inline int NewLargeType(long n, MPI_Datatype type, MPI_Datatype &large)
+{
+  MPI_Aint lb = 0;
+  MPI_Aint extent = 0;
+  MPI_Type_get_extent(type, &lb, &extent);
+
+  long nChunks = n / LargeCountChunk;
+  long nTail = n % LargeCountChunk;
+
+  MPI_Datatype chunk = MPI_DATATYPE_NULL;
+  MPI_Datatype body = MPI_DATATYPE_NULL;
+  MPI_Datatype tail = MPI_DATATYPE_NULL;
+
+  MPI_Type_contiguous(LargeCountChunk, type, &chunk);
+  MPI_Type_contiguous(nChunks, chunk, &body);
+  MPI_Type_contiguous(nTail, type, &tail);
+
+  int lengths[2] = {1, 1};
+  MPI_Aint displs[2] = {0, MPI_Aint(nChunks*LargeCountChunk*extent)};
+  MPI_Datatype types[2] = {body, tail};
+
+  int ierr = MPI_Type_create_struct(2, lengths, displs, types, &large);
+  if (ierr == MPI_SUCCESS)
+    ierr = MPI_Type_commit(&large);
+
+  MPI_Type_free(&chunk);
+  MPI_Type_free(&body);
+  MPI_Type_free(&tail);
+
+  return ierr;
+}
+
+// broadcast n elements
+inline int Bcast(void *buf, long n, MPI_Datatype type, int root, MPI_Comm comm)
+{
+#if MPI_VERSION >= 4
+  return MPI_Bcast_c(buf, n, type, root, comm);
+#else
+  if (FitsInt(n))
+    return MPI_Bcast(buf, n, type, root, comm);
+
+  MPI_Aint lb = 0;
+  MPI_Aint extent = 0;
+  MPI_Type_get_extent(type, &lb, &extent);
+
+  // every rank knows n hence makes the same calls
+  char *pbuf = static_cast<char*>(buf);
+  for (long i = 0; i < n; i += LargeCountChunk)
+    {
+    int nc = std::min(n - i, LargeCountChunk);
+    int ierr = MPI_Bcast(pbuf + i*extent, nc, type, root, comm);
+    if (ierr != MPI_SUCCESS)
+      return ierr;
+    }
+
+  return MPI_SUCCESS;
+#endif
+}
+
+// write n elements at the individual file pointer
+inline int FileWrite(MPI_File fh, const void *buf, long n, MPI_Datatype type)
+{
+#if MPI_VERSION >= 4
+  return MPI_File_write_c(fh, buf, n, type, MPI_STATUS_IGNORE);
+#else
+  if (FitsInt(n))
+    return MPI_File_write(fh, buf, n, type, MPI_STATUS_IGNORE);
+
+  MPI_Aint lb = 0;
+  MPI_Aint extent = 0;
+  MPI_Type_get_extent(type, &lb, &extent);
+
+  // the file pointer advances with each piece
+  const char *pbuf = static_cast<const char*>(buf);
+  for (long i = 0; i < n; i += LargeCountChunk)
+    {
+    int nc = std::min(n - i, LargeCountChunk);
+    int ierr = MPI_File_write(fh, pbuf + i*extent, nc, type, MPI_STATUS_IGNORE);
+    if (ierr != MPI_SUCCESS)
+      return ierr;
+    }
+
+  return MPI_SUCCESS;
+#endif
+}
+
+// collectively write n elements at the individual file pointer
+inline int FileWriteAll(MPI_File fh, const void *buf, long n, MPI_Datatype type)
+{
+#if MPI_VERSION >= 4
+  return MPI_File_write_all_c(fh, buf, n, type, MPI_STATUS_IGNORE);
+#else
+  if (FitsInt(n))
+    return MPI_File_write_all(fh, buf, n, type, MPI_STATUS_IGNORE);
+
+  // a collective can not be split since the ranks would make different
+  // numbers of calls
+  MPI_Datatype large = MPI_DATATYPE_NULL;
+  int ierr = NewLargeType(n, type, large);
+  if (ierr != MPI_SUCCESS)
+    return ierr;
+
+  ierr = MPI_File_write_all(fh, buf, 1, large, MPI_STATUS_IGNORE);
+
+  MPI_Type_free(&large);
+
+  return ierr;
+#endif
+}
+
+// gather counts[i] elements from each rank i at offsets[i] of buf, in
+// place. the counts and offsets are in elements
+inline int AllgathervInPlace(void *buf, const std::vector<long> &counts,
+  const std::vector<long> &offsets, MPI_Datatype type, MPI_Comm comm)
+{
+  int nRanks = counts.size();
+
+#if MPI_VERSION >= 4
+  std::vector<MPI_Count> ccounts(counts.begin(), counts.end());
+  std::vector<MPI_Aint> coffsets(offsets.begin(), offsets.end());
+  return MPI_Allgatherv_c(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, buf,
+    ccounts.data(), coffsets.data(), type, comm);
+#else
+  long nTotal = nRanks ? offsets[nRanks - 1] + counts[nRanks - 1] : 0;
+  if (FitsInt(nTotal))
+    {
+    std::vector<int> icounts(counts.begin(), counts.end());
+    std::vector<int> ioffsets(offsets.begin(), offsets.end());
+    return MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, buf,
+      icounts.data(), ioffsets.data(), type, comm);
+    }
+
+  // each rank broadcasts its part
+  MPI_Aint lb = 0;
+  MPI_Aint extent = 0;
+  MPI_Type_get_extent(type, &lb, &extent);
+
+  char *pbuf = static_cast<char*>(buf);
+  for (int i = 0; i < nRanks; ++i)
+    {
+    int ierr = Bcast(pbuf + offsets[i]*extent, counts[i], type, i, comm);
+    if (ierr != MPI_SUCCESS)
+      return ierr;
+    }
+
+  return MPI_SUCCESS;
+#endif
+}
+
 
 // helper to recuce by summation elements in a vector
 // it's assumed that the vector is the same size on all
@@ -31,6 +205,7 @@ define_mpi_tt(double, MPI_DOUBLE)
 template<typename cpp_t>
 void GlobalCounts(MPI_Comm comm, std::vector<cpp_t> &vec)
 {
+  CollectiveEvent mark(comm, "MPIUtils::GlobalCounts");
   MPI_Allreduce(MPI_IN_PLACE, vec.data(), vec.size(),
       mpi_tt<cpp_t>::datatype(), MPI_SUM, comm);
 }
@@ -83,8 +258,11 @@ void GlobalBounds(MPI_Comm comm, const std::vector<std::array<cpp_t,6>> &lbounds
     gbounds[i] = -gbounds[i];
 
   // find the smallest bounding covering all distributed
+  {
+  CollectiveEvent mark(comm, "MPIUtils::GlobalBounds");
   MPI_Allreduce(MPI_IN_PLACE, gbounds.data(), 6,
     mpi_tt<cpp_t>::datatype(), MPI_MAX, comm);
+  }
 
   // because we used MPI_MAX
   for (size_t i = 0; i < 6; i += 2)
@@ -113,8 +291,11 @@ void GlobalRange(MPI_Comm comm, const std::vector<std::array<cpp_t,2>> &lrange,
   grange[0] = -grange[0];
 
   // find the smallest bounding covering all distributed
+  {
+  CollectiveEvent mark(comm, "MPIUtils::GlobalRange");
   MPI_Allreduce(MPI_IN_PLACE, grange.data(), 2,
     mpi_tt<cpp_t>::datatype(), MPI_MAX, comm);
+  }
 
   // because we used MPI_MAX
   grange[0] = -grange[0];
@@ -139,6 +320,7 @@ void GlobalView(MPI_Comm comm, const std::vector<cpp_t> &ldata,
   for (int i = 0; i < nLocal; ++i)
       gdata[nLocal*rank+i] = ldata[i];
 
+  CollectiveEvent mark(comm, "MPIUtils::GlobalView");
   MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
     gdata.data(), nLocal, mpi_tt<cpp_t>::datatype(), comm);
 }
@@ -151,7 +333,7 @@ void GlobalView(MPI_Comm comm, const std::vector<cpp_t> &ldata,
 // rank. offsets contains an offset of each ranks data.
 template <typename cpp_t>
 void GlobalViewV(MPI_Comm comm, const std::vector<cpp_t> &ldata,
-  std::vector<int> &gcounts, std::vector<int> &goffset,
+  std::vector<long> &gcounts, std::vector<long> &goffset,
   std::vector<cpp_t> &gdata)
 {
   int rank = 0;
@@ -163,19 +345,20 @@ void GlobalViewV(MPI_Comm comm, const std::vector<cpp_t> &ldata,
   gcounts.clear();
   gcounts.resize(nRanks);
 
-  int nLocal = ldata.size();
+  long nLocal = ldata.size();
   gcounts[rank] = nLocal;
 
+  CollectiveEvent mark(comm, "MPIUtils::GlobalViewV");
   MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
-    gcounts.data(), 1, MPI_INT, comm);
+    gcounts.data(), 1, MPI_LONG, comm);
 
   goffset.clear();
   goffset.resize(nRanks);
 
   int q = 0;
-  int nTotal = 0;
+  long nTotal = 0;
   std::for_each(gcounts.begin(), gcounts.end(),
-    [&nTotal,&goffset,&q](const int &n)
+    [&nTotal,&goffset,&q](const long &n)
       {
       goffset[q] = nTotal;
       nTotal += n;
@@ -186,28 +369,248 @@ void GlobalViewV(MPI_Comm comm, const std::vector<cpp_t> &ldata,
 
   const cpp_t *ld = ldata.data();
   cpp_t *gd = gdata.data() + goffset[rank];
-  for (int i = 0; i < nLocal; ++i)
+  for (long i = 0; i < nLocal; ++i)
     gd[i] = ld[i];
 
-  MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, gdata.data(),
-    gcounts.data(), goffset.data(), mpi_tt<cpp_t>::datatype(), comm);
+  AllgathervInPlace(gdata.data(), gcounts, goffset,
+    mpi_tt<cpp_t>::datatype(), comm);
 }
 
-// use this if you don't need counts & offsets
+// A communicator split into one communicator per shared memory node and a
+// communicator of the node leaders (the lowest rank on each node). This is
+// used to generate global views in two stages. First data is gathered to
+// the node leaders, then only the leaders exchange data across the network,
+// finally the leaders broadcast the result within their node. This replaces
+// the all to all exchange over comm, whose cost grows with the number of
+// ranks, by one exchange per node.
+struct HierarchicalComm
+{
+  HierarchicalComm() : Comm(MPI_COMM_NULL), Node(MPI_COMM_NULL),
+    Leaders(MPI_COMM_NULL), NodeId(0) {}
+
+  ~HierarchicalComm() { this->Free(); }
+
+  HierarchicalComm(const HierarchicalComm &) = delete;
+  void operator=(const HierarchicalComm &) = delete;
+
+  // split comm into node and leader communicators. this is collective
+  // over comm.
+  void Initialize(MPI_Comm comm)
+  {
+    this->Free();
+
+    this->Comm = comm;
+
+    int rank = 0;
+    MPI_Comm_rank(comm, &rank);
+
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank,
+      MPI_INFO_NULL, &this->Node);
+
+    int nodeRank = 0;
+    int nodeSize = 1;
+    MPI_Comm_rank(this->Node, &nodeRank);
+    MPI_Comm_size(this->Node, &nodeSize);
+
+    MPI_Comm_split(comm, nodeRank == 0 ? 0 : MPI_UNDEFINED,
+      rank, &this->Leaders);
+
+    // ranks in comm of the processes on this node
+    std::vector<int> nodeRanks(nodeSize);
+    MPI_Gather(&rank, 1, MPI_INT, nodeRanks.data(), 1, MPI_INT, 0, this->Node);
+
+    // the leaders share the layout of all nodes
+    if (nodeRank == 0)
+      {
+      int nNodes = 1;
+      MPI_Comm_rank(this->Leaders, &this->NodeId);
+      MPI_Comm_size(this->Leaders, &nNodes);
+
+      this->NodeSize.resize(nNodes);
+      MPI_Allgather(&nodeSize, 1, MPI_INT, this->NodeSize.data(),
+        1, MPI_INT, this->Leaders);
+
+      this->NodeOffset.resize(nNodes);
+      int nRanks = 0;
+      for (int i = 0; i < nNodes; ++i)
+        {
+        this->NodeOffset[i] = nRanks;
+        nRanks += this->NodeSize[i];
+        }
+
+      this->NodeRanks.resize(nRanks);
+      MPI_Allgatherv(nodeRanks.data(), nodeSize, MPI_INT,
+        this->NodeRanks.data(), this->NodeSize.data(),
+        this->NodeOffset.data(), MPI_INT, this->Leaders);
+      }
+  }
+
+  // release the node and leader communicators
+  void Free()
+  {
+    // communicators may not be freed after MPI_Finalize
+    int fin = 0;
+    MPI_Finalized(&fin);
+
+    if (!fin && (this->Node != MPI_COMM_NULL))
+      MPI_Comm_free(&this->Node);
+
+    if (!fin && (this->Leaders != MPI_COMM_NULL))
+      MPI_Comm_free(&this->Leaders);
+
+    this->Node = MPI_COMM_NULL;
+    this->Leaders = MPI_COMM_NULL;
+
+    this->Comm = MPI_COMM_NULL;
+    this->NodeId = 0;
+    this->NodeSize.clear();
+    this->NodeOffset.clear();
+    this->NodeRanks.clear();
+  }
+
+  MPI_Comm Comm;     // the communicator that was split
+  MPI_Comm Node;     // the processes on this node
+  MPI_Comm Leaders;  // the lowest rank on each node, null elsewhere
+
+  // the following are only valid on the node leaders
+  int NodeId;                  // rank of this node in Leaders
+  std::vector<int> NodeSize;   // number of ranks on each node
+  std::vector<int> NodeOffset; // offset of each node into NodeRanks
+  std::vector<int> NodeRanks;  // rank in Comm of each process, by node
+};
+
+// helper function to generate a global view from a local view using a
+// hierarchical communicator. the result is identical to that of the
+// GlobalViewV taking MPI_Comm, see above, however only the node leaders
+// communicate across nodes.
 template <typename cpp_t>
-void GlobalViewV(MPI_Comm comm, const std::vector<cpp_t> &ldata,
+void GlobalViewV(const HierarchicalComm &comm, const std::vector<cpp_t> &ldata,
+  std::vector<long> &gcounts, std::vector<long> &goffset,
+  std::vector<cpp_t> &gdata)
+{
+  int rank = 0;
+  int nRanks = 1;
+
+  MPI_Comm_rank(comm.Comm, &rank);
+  MPI_Comm_size(comm.Comm, &nRanks);
+
+  CollectiveEvent mark(comm.Comm, "MPIUtils::GlobalViewV hierarchical");
+
+  // the counts are small, share them with everyone
+  gcounts.clear();
+  gcounts.resize(nRanks);
+
+  long nLocal = ldata.size();
+  gcounts[rank] = nLocal;
+
+  MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+    gcounts.data(), 1, MPI_LONG, comm.Comm);
+
+  goffset.clear();
+  goffset.resize(nRanks);
+
+  long nTotal = 0;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    goffset[i] = nTotal;
+    nTotal += gcounts[i];
+    }
+
+  gdata.resize(nTotal);
+
+  MPI_Datatype type = mpi_tt<cpp_t>::datatype();
+
+  // the node gathers take int counts. views that do not fit are exchanged
+  // over the flat communicator, which handles large counts
+  if (!FitsInt(nTotal))
+    {
+    std::copy(ldata.begin(), ldata.end(), gdata.begin() + goffset[rank]);
+    AllgathervInPlace(gdata.data(), gcounts, goffset, type, comm.Comm);
+    return;
+    }
+
+  int nodeRank = 0;
+  MPI_Comm_rank(comm.Node, &nodeRank);
+
+  if (nodeRank == 0)
+    {
+    // gather the data from the processes on this node
+    int nNodes = comm.NodeSize.size();
+
+    std::vector<int> nodeCounts(nNodes);
+    std::vector<int> nodeOffset(nNodes);
+
+    int nNodeTotal = 0;
+    for (int i = 0; i < nNodes; ++i)
+      {
+      nodeOffset[i] = nNodeTotal;
+      int nc = 0;
+      const int *nr = comm.NodeRanks.data() + comm.NodeOffset[i];
+      for (int j = 0; j < comm.NodeSize[i]; ++j)
+        nc += gcounts[nr[j]];
+      nodeCounts[i] = nc;
+      nNodeTotal += nc;
+      }
+
+    int nodeSize = comm.NodeSize[comm.NodeId];
+    const int *nr = comm.NodeRanks.data() + comm.NodeOffset[comm.NodeId];
+
+    std::vector<int> counts(nodeSize);
+    std::vector<int> offset(nodeSize);
+    for (int j = 0, q = 0; j < nodeSize; ++j)
+      {
+      offset[j] = q;
+      counts[j] = gcounts[nr[j]];
+      q += counts[j];
+      }
+
+    // data ordered by node
+    std::vector<cpp_t> ndata(nNodeTotal);
+
+    MPI_Gatherv(ldata.data(), nLocal, type,
+      ndata.data() + nodeOffset[comm.NodeId], counts.data(),
+      offset.data(), type, 0, comm.Node);
+
+    // exchange between nodes
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, ndata.data(),
+      nodeCounts.data(), nodeOffset.data(), type, comm.Leaders);
+
+    // put in rank order
+    const cpp_t *nd = ndata.data();
+    int nProcs = comm.NodeRanks.size();
+    for (int i = 0; i < nProcs; ++i)
+      {
+      int r = comm.NodeRanks[i];
+      std::copy(nd, nd + gcounts[r], gdata.data() + goffset[r]);
+      nd += gcounts[r];
+      }
+    }
+  else
+    {
+    MPI_Gatherv(ldata.data(), nLocal, type, nullptr, nullptr,
+      nullptr, type, 0, comm.Node);
+    }
+
+  // share with the processes on this node
+  MPI_Bcast(gdata.data(), nTotal, type, 0, comm.Node);
+}
+
+// use this if you don't need counts & offsets. comm_t is either MPI_Comm
+// or HierarchicalComm
+template <typename comm_t, typename cpp_t>
+void GlobalViewV(const comm_t &comm, const std::vector<cpp_t> &ldata,
   std::vector<cpp_t> &gdata)
 {
-  std::vector<int> counts, offsets;
+  std::vector<long> counts, offsets;
   GlobalViewV(comm, ldata, counts, offsets, gdata);
 }
 
 // use this if you don't need counts & offsets and want the result
 // to replace the input.
-template <typename cpp_t>
-void GlobalViewV(MPI_Comm comm, std::vector<cpp_t> &ldata)
+template <typename comm_t, typename cpp_t>
+void GlobalViewV(const comm_t &comm, std::vector<cpp_t> &ldata)
 {
-  std::vector<int> counts, offsets;
+  std::vector<long> counts, offsets;
   std::vector<cpp_t> gdata;
   GlobalViewV(comm, ldata, counts, offsets, gdata);
   ldata = std::move(gdata);
@@ -219,8 +622,8 @@ void GlobalViewV(MPI_Comm comm, std::vector<cpp_t> &ldata)
 // of counts, and offsets that are used to index into the global data. counts
 // is indexed by rank and contains the number of items contributed by each
 // rank. offsets contains an offset of each ranks data.
-template <typename cpp_t, std::size_t N>
-void GlobalViewV(MPI_Comm comm, const std::vector<std::array<cpp_t,N>> &ldata,
+template <typename comm_t, typename cpp_t, std::size_t N>
+void GlobalViewV(const comm_t &comm, const std::vector<std::array<cpp_t,N>> &ldata,
   std::vector<std::array<cpp_t,N>> &gdata)
 {
   // serialize the data
@@ -237,7 +640,7 @@ void GlobalViewV(MPI_Comm comm, const std::vector<std::array<cpp_t,N>> &ldata,
 
   // send it
   std::vector<cpp_t> gd;
-  std::vector<int> counts, offsets;
+  std::vector<long> counts, offsets;
   GlobalViewV(comm, ld, counts, offsets, gd);
 
   // deserialize
@@ -255,8 +658,8 @@ void GlobalViewV(MPI_Comm comm, const std::vector<std::array<cpp_t,N>> &ldata,
 
 // use this if you don't need counts & offsets and want the result
 // to replace the input.
-template <typename cpp_t, std::size_t N>
-void GlobalViewV(MPI_Comm comm, std::vector<std::array<cpp_t,N>> &ldata)
+template <typename comm_t, typename cpp_t, std::size_t N>
+void GlobalViewV(const comm_t &comm, std::vector<std::array<cpp_t,N>> &ldata)
 {
   std::vector<std::array<cpp_t,N>> gdata;
   GlobalViewV(comm, ldata, gdata);
@@ -265,8 +668,8 @@ void GlobalViewV(MPI_Comm comm, std::vector<std::array<cpp_t,N>> &ldata)
 
 // use this if you don't need counts & offsets and want the result
 // to replace the input.
-template <typename cpp_t>
-void GlobalViewV(MPI_Comm comm, std::vector<std::vector<cpp_t>> &ldata)
+template <typename comm_t, typename cpp_t>
+void GlobalViewV(const comm_t &comm, std::vector<std::vector<cpp_t>> &ldata)
 {
   // gather local sizes
   std::vector<long> lsizes;
@@ -274,7 +677,7 @@ void GlobalViewV(MPI_Comm comm, std::vector<std::vector<cpp_t>> &ldata)
   for (int i = 0; i < nLocal; ++i)
     lsizes.push_back(ldata[i].size());
 
-  std::vector<int> scounts, soffsets;
+  std::vector<long> scounts, soffsets;
   std::vector<long> gsizes;
 
   GlobalViewV(comm, lsizes, scounts, soffsets, gsizes);
@@ -298,9 +701,9 @@ void GlobalViewV(MPI_Comm comm, std::vector<std::vector<cpp_t>> &ldata)
   unsigned int nranks = scounts.size();
   for (unsigned int i = 0, q  = 0; i < nranks; ++i)
     {
-    int nVec = scounts[i];
-    int vecOffs = soffsets[i];
-    for (int j = 0; j < nVec; ++j)
+    long nVec = scounts[i];
+    long vecOffs = soffsets[i];
+    for (long j = 0; j < nVec; ++j)
       {
       long nElem = gsizes[vecOffs + j];
       std::vector<cpp_t> vec;
@@ -316,6 +719,374 @@ void GlobalViewV(MPI_Comm comm, std::vector<std::vector<cpp_t>> &ldata)
   ldata.swap(gdata);
 }
 
+// The counts and offsets of a global view, see GlobalViewV. When several
+// views are made of data with the same number of items on each rank, for
+// instance the fields of the local blocks, the counts are exchanged once
+// and each view is then a single MPI_Allgatherv.
+struct ViewLayout
+{
+  ViewLayout() : Total(0) {}
+
+  // exchange the number of local items. this is collective over comm.
+  void Initialize(MPI_Comm comm, long nLocal)
+  {
+    int nRanks = 1;
+    MPI_Comm_size(comm, &nRanks);
+
+    this->Counts.resize(nRanks);
+
+    CollectiveEvent mark(comm, "MPIUtils::ViewLayout");
+    MPI_Allgather(&nLocal, 1, MPI_LONG, this->Counts.data(), 1, MPI_LONG, comm);
+
+    this->Update();
+  }
+
+  // compute the offsets and total from the counts
+  void Update()
+  {
+    int nRanks = this->Counts.size();
+    this->Offsets.resize(nRanks);
+
+    this->Total = 0;
+    for (int i = 0; i < nRanks; ++i)
+      {
+      this->Offsets[i] = this->Total;
+      this->Total += this->Counts[i];
+      }
+  }
+
+  // the layout of n values per item
+  ViewLayout Scale(int n) const
+  {
+    ViewLayout layout;
+    layout.Counts = this->Counts;
+    for (long &c : layout.Counts)
+      c *= n;
+    layout.Update();
+    return layout;
+  }
+
+  std::vector<long> Counts;  // number of items on each rank
+  std::vector<long> Offsets; // offset of each rank's items into the view
+  long Total;                // number of items in the view
+};
+
+// helper function to generate a global view from a local view whose
+// layout is known. ldata must hold the number of items the layout gives
+// this rank.
+template <typename cpp_t>
+void GlobalViewV(MPI_Comm comm, const ViewLayout &layout,
+  const std::vector<cpp_t> &ldata, std::vector<cpp_t> &gdata)
+{
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  gdata.resize(layout.Total);
+  std::copy(ldata.begin(), ldata.begin() + layout.Counts[rank],
+    gdata.begin() + layout.Offsets[rank]);
+
+  CollectiveEvent mark(comm, "MPIUtils::GlobalViewV layout");
+  AllgathervInPlace(gdata.data(), layout.Counts, layout.Offsets,
+    mpi_tt<cpp_t>::datatype(), comm);
+}
+
+// as above for fixed size arrays, the layout counts arrays
+template <typename cpp_t, std::size_t N>
+void GlobalViewV(MPI_Comm comm, const ViewLayout &layout,
+  std::vector<std::array<cpp_t,N>> &ldata)
+{
+  size_t n = ldata.size();
+  std::vector<cpp_t> ld(n*N);
+  for (size_t i = 0; i < n; ++i)
+    std::copy(ldata[i].begin(), ldata[i].end(), ld.begin() + i*N);
+
+  std::vector<cpp_t> gd;
+  GlobalViewV(comm, layout.Scale(N), ld, gd);
+
+  n = gd.size()/N;
+  ldata.resize(n);
+  for (size_t i = 0; i < n; ++i)
+    std::copy(gd.begin() + i*N, gd.begin() + (i + 1)*N, ldata[i].begin());
+}
+
+// as above replacing the input
+template <typename cpp_t>
+void GlobalViewV(MPI_Comm comm, const ViewLayout &layout,
+  std::vector<cpp_t> &ldata)
+{
+  std::vector<cpp_t> gdata;
+  GlobalViewV(comm, layout, ldata, gdata);
+  ldata.swap(gdata);
+}
+
+// Collectives repeated with the same shape, for instance every step. The
+// buffers are allocated once and, with MPI 4, the exchange is a persistent
+// collective that is set up once and only started afterward, saving the
+// setup of each call. With older MPI the plain collective is called with
+// the cached layout. A plan holds on to the communicator it was made for,
+// which must outlive it.
+class PersistentPlan
+{
+public:
+  PersistentPlan() : Comm(MPI_COMM_NULL), Request(MPI_REQUEST_NULL) {}
+  ~PersistentPlan() { this->Free(); }
+
+  PersistentPlan(const PersistentPlan &) = delete;
+  void operator=(const PersistentPlan &) = delete;
+
+  // the communicator the plan was made for
+  MPI_Comm GetCommunicator() const { return this->Comm; }
+
+  // release the persistent request
+  void Free()
+  {
+    int fin = 0;
+    MPI_Finalized(&fin);
+
+    if (!fin && (this->Request != MPI_REQUEST_NULL))
+      MPI_Request_free(&this->Request);
+
+    this->Request = MPI_REQUEST_NULL;
+    this->Comm = MPI_COMM_NULL;
+  }
+
+protected:
+  // start the persistent collective and wait for it
+  void StartAndWait()
+  {
+    MPI_Start(&this->Request);
+    MPI_Wait(&this->Request, MPI_STATUS_IGNORE);
+  }
+
+  MPI_Comm Comm;
+  MPI_Request Request;
+};
+
+// A global view of the same layout repeated, see PersistentPlan.
+template <typename cpp_t>
+class GlobalViewPlan : public PersistentPlan
+{
+public:
+  // set up for nLocal items on this rank. this is collective over comm.
+  void Initialize(MPI_Comm comm, long nLocal)
+  {
+    this->Free();
+
+    this->Comm = comm;
+    this->Layout.Initialize(comm, nLocal);
+    this->Send.resize(nLocal);
+    this->Recv.resize(this->Layout.Total);
+
+#if MPI_VERSION >= 4
+    // the request refers to the counts for as long as it lives
+    this->Counts.assign(this->Layout.Counts.begin(), this->Layout.Counts.end());
+    this->Offsets.assign(this->Layout.Offsets.begin(), this->Layout.Offsets.end());
+
+    MPI_Datatype type = mpi_tt<cpp_t>::datatype();
+    MPI_Allgatherv_init_c(this->Send.data(), nLocal, type, this->Recv.data(),
+      this->Counts.data(), this->Offsets.data(), type, comm,
+      MPI_INFO_NULL, &this->Request);
+#endif
+  }
+
+  // the number of local items the plan was made for
+  long GetLocalSize() const { return this->Send.size(); }
+
+  // make the global view. ldata must hold GetLocalSize items. this is
+  // collective over the plan's communicator. returns zero if successful.
+  int Execute(const std::vector<cpp_t> &ldata, std::vector<cpp_t> &gdata)
+  {
+    if ((this->Comm == MPI_COMM_NULL) || (ldata.size() != this->Send.size()))
+      return -1;
+
+    CollectiveEvent mark(this->Comm, "MPIUtils::GlobalViewPlan");
+
+    std::copy(ldata.begin(), ldata.end(), this->Send.begin());
+
+#if MPI_VERSION >= 4
+    this->StartAndWait();
+#else
+    int rank = 0;
+    MPI_Comm_rank(this->Comm, &rank);
+
+    std::copy(this->Send.begin(), this->Send.end(),
+      this->Recv.begin() + this->Layout.Offsets[rank]);
+
+    AllgathervInPlace(this->Recv.data(), this->Layout.Counts,
+      this->Layout.Offsets, mpi_tt<cpp_t>::datatype(), this->Comm);
+#endif
+
+    gdata.assign(this->Recv.begin(), this->Recv.end());
+    return 0;
+  }
+
+private:
+  ViewLayout Layout;
+  std::vector<cpp_t> Send;
+  std::vector<cpp_t> Recv;
+#if MPI_VERSION >= 4
+  std::vector<MPI_Count> Counts;
+  std::vector<MPI_Aint> Offsets;
+#endif
+};
+
+// An in place reduction of the same size repeated, see PersistentPlan.
+template <typename cpp_t>
+class AllreducePlan : public PersistentPlan
+{
+public:
+  AllreducePlan() : Op(MPI_SUM) {}
+
+  // set up for n values reduced with op. this is collective over comm.
+  void Initialize(MPI_Comm comm, int n, MPI_Op op)
+  {
+    this->Free();
+
+    this->Comm = comm;
+    this->Op = op;
+    this->Buffer.resize(n);
+
+#if MPI_VERSION >= 4
+    MPI_Allreduce_init(MPI_IN_PLACE, this->Buffer.data(), n,
+      mpi_tt<cpp_t>::datatype(), op, comm, MPI_INFO_NULL, &this->Request);
+#endif
+  }
+
+  // the number of values the plan was made for
+  int GetSize() const { return this->Buffer.size(); }
+
+  // reduce data in place. data must hold GetSize values. this is
+  // collective over the plan's communicator. returns zero if successful.
+  int Execute(std::vector<cpp_t> &data)
+  {
+    if ((this->Comm == MPI_COMM_NULL) || (data.size() != this->Buffer.size()))
+      return -1;
+
+    CollectiveEvent mark(this->Comm, "MPIUtils::AllreducePlan");
+
+    std::copy(data.begin(), data.end(), this->Buffer.begin());
+
+#if MPI_VERSION >= 4
+    this->StartAndWait();
+#else
+    MPI_Allreduce(MPI_IN_PLACE, this->Buffer.data(), this->Buffer.size(),
+      mpi_tt<cpp_t>::datatype(), this->Op, this->Comm);
+#endif
+
+    std::copy(this->Buffer.begin(), this->Buffer.end(), data.begin());
+    return 0;
+  }
+
+private:
+  MPI_Op Op;
+  std::vector<cpp_t> Buffer;
+};
+
+
+// Thread safety. MPI_THREAD_MULTIPLE lets any thread make MPI calls, however
+// collectives over a communicator must still be issued in the same order
+// on every rank. Two threads issuing collectives over the same communicator
+// at the same time can not guarantee that, hence each thread that makes
+// collective calls needs a communicator of its own. SENSEI's adaptors each
+// duplicate the communicator they are given (see
+// AnalysisAdaptor::SetCommunicator), so an adaptor may be used from a
+// thread other than the one that created it as long as it is used by one
+// thread at a time. The helpers below query the thread level and
+// duplicate communicators for the threads of a pool.
+
+// get the MPI thread level from its name, one of single, funneled,
+// serialized, or multiple. returns zero if successful
+inline int GetThreadLevel(const std::string &name, int &level)
+{
+  if (name == "single")
+    level = MPI_THREAD_SINGLE;
+  else if (name == "funneled")
+    level = MPI_THREAD_FUNNELED;
+  else if (name == "serialized")
+    level = MPI_THREAD_SERIALIZED;
+  else if (name == "multiple")
+    level = MPI_THREAD_MULTIPLE;
+  else
+    return -1;
+  return 0;
+}
+
+// get the name of an MPI thread level
+inline const char *GetThreadLevelName(int level)
+{
+  if (level == MPI_THREAD_SINGLE)
+    return "MPI_THREAD_SINGLE";
+  else if (level == MPI_THREAD_FUNNELED)
+    return "MPI_THREAD_FUNNELED";
+  else if (level == MPI_THREAD_SERIALIZED)
+    return "MPI_THREAD_SERIALIZED";
+  else if (level == MPI_THREAD_MULTIPLE)
+    return "MPI_THREAD_MULTIPLE";
+  return "unknown";
+}
+
+// returns true if MPI is initialized with at least the given thread level
+inline bool HaveThreadLevel(int level)
+{
+  int init = 0;
+  MPI_Initialized(&init);
+  if (!init)
+    return false;
+
+  int provided = MPI_THREAD_SINGLE;
+  MPI_Query_thread(&provided);
+  return provided >= level;
+}
+
+// A communicator for each thread of a pool. The duplicates are made up
+// front, since MPI_Comm_dup is collective and the threads of different
+// ranks would not duplicate in the same order if it were done lazily.
+// Thread i uses Get(i) for its collectives.
+struct ThreadComms
+{
+  ThreadComms() {}
+  ~ThreadComms() { this->Free(); }
+
+  ThreadComms(const ThreadComms &) = delete;
+  void operator=(const ThreadComms &) = delete;
+
+  // duplicate comm once for each of nThreads threads. this is collective
+  // over comm and should be called from a single thread.
+  void Initialize(MPI_Comm comm, int nThreads)
+  {
+    this->Free();
+
+    this->Comms.resize(nThreads, MPI_COMM_NULL);
+    for (int i = 0; i < nThreads; ++i)
+      MPI_Comm_dup(comm, &this->Comms[i]);
+  }
+
+  // release the communicators
+  void Free()
+  {
+    // communicators may not be freed after MPI_Finalize
+    int fin = 0;
+    MPI_Finalized(&fin);
+
+    unsigned int n = this->Comms.size();
+    for (unsigned int i = 0; !fin && (i < n); ++i)
+      {
+      if (this->Comms[i] != MPI_COMM_NULL)
+        MPI_Comm_free(&this->Comms[i]);
+      }
+
+    this->Comms.clear();
+  }
+
+  // the number of communicators
+  int Size() const { return this->Comms.size(); }
+
+  // get the communicator of the i'th thread
+  MPI_Comm Get(int i) const { return this->Comms[i]; }
+
+  std::vector<MPI_Comm> Comms;
+};
+
 }
 }
 
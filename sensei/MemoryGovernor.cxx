@@ -0,0 +1,291 @@
+#include "MemoryGovernor.h"
+#include "MemoryProfiler.h"
+#include "Error.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+// samples of the resident set size older than this are refreshed on request
+constexpr double maxSampleAge = 0.1;
+}
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+MemoryGovernor &MemoryGovernor::GetGlobalGovernor()
+{
+  // the governor is never destroyed so that consumers released during
+  // exit can still return their memory
+  static MemoryGovernor *governor = new MemoryGovernor;
+  return *governor;
+}
+
+// --------------------------------------------------------------------------
+MemoryGovernor::MemoryGovernor() : Limit(0), Reserve(0), Granted(0),
+  Used(0), HaveSample(false)
+{
+}
+
+// --------------------------------------------------------------------------
+int MemoryGovernor::GetPolicy(const std::string &name, int &policy)
+{
+  if (name == "degrade")
+    policy = POLICY_DEGRADE;
+  else if (name == "skip")
+    policy = POLICY_SKIP;
+  else if (name == "stream")
+    policy = POLICY_STREAM;
+  else if (name == "spill")
+    policy = POLICY_SPILL;
+  else
+    {
+    SENSEI_ERROR("Invalid memory policy \"" << name
+      << "\". Use one of degrade, skip, stream, or spill")
+    return -1;
+    }
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int MemoryGovernor::Register(const std::string &name, int policy,
+  const ReleaseFunction &release)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  Consumer consumer;
+  consumer.Name = name;
+  consumer.Policy = policy;
+  consumer.Release = release;
+  consumer.Active = true;
+
+  // reuse the slot of a consumer that is gone
+  int nConsumers = this->Consumers.size();
+  for (int i = 0; i < nConsumers; ++i)
+    {
+    if (!this->Consumers[i].Active)
+      {
+      this->Consumers[i] = std::move(consumer);
+      return i;
+      }
+    }
+
+  this->Consumers.push_back(std::move(consumer));
+  return nConsumers;
+}
+
+// --------------------------------------------------------------------------
+void MemoryGovernor::Unregister(int id)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  if ((id < 0) || (id >= int(this->Consumers.size())))
+    return;
+
+  this->Granted -= this->Consumers[id].Granted;
+  this->Consumers[id] = Consumer();
+}
+
+// --------------------------------------------------------------------------
+void MemoryGovernor::SetLimit(long long nBytes)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Limit = std::max(0ll, nBytes);
+}
+
+// --------------------------------------------------------------------------
+long long MemoryGovernor::GetLimit() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Limit;
+}
+
+// --------------------------------------------------------------------------
+void MemoryGovernor::SetReserve(long long nBytes)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Reserve = std::max(0ll, nBytes);
+}
+
+// --------------------------------------------------------------------------
+long long MemoryGovernor::GetReserve() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Reserve;
+}
+
+// --------------------------------------------------------------------------
+void MemoryGovernor::SetSpillDirectory(const std::string &dir)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->SpillDirectory = dir;
+}
+
+// --------------------------------------------------------------------------
+std::string MemoryGovernor::GetSpillDirectory() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->SpillDirectory.empty() ? std::string(".") : this->SpillDirectory;
+}
+
+// --------------------------------------------------------------------------
+bool MemoryGovernor::Enabled() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Limit > 0;
+}
+
+// --------------------------------------------------------------------------
+void MemoryGovernor::UpdateUsage(long long nBytes)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Used = nBytes;
+  this->SampleTime = std::chrono::steady_clock::now();
+  this->HaveSample = true;
+}
+
+// --------------------------------------------------------------------------
+void MemoryGovernor::Sample()
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  if (this->HaveSample &&
+    (std::chrono::duration<double>(now - this->SampleTime).count() < maxSampleAge))
+    return;
+
+  long long used = MemoryProfiler::GetMemoryUsed();
+  if (used >= 0)
+    this->Used = 1024ll*used;
+
+  this->SampleTime = now;
+  this->HaveSample = true;
+}
+
+// --------------------------------------------------------------------------
+long long MemoryGovernor::Available() const
+{
+  // granted memory not yet touched is not part of the resident set, and
+  // memory in use by the simulation is not granted
+  return this->Limit - this->Reserve - std::max(this->Used, this->Granted);
+}
+
+// --------------------------------------------------------------------------
+long long MemoryGovernor::GetAvailable()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  if (this->Limit <= 0)
+    return -1;
+
+  this->Sample();
+
+  return std::max(0ll, this->Available());
+}
+
+// --------------------------------------------------------------------------
+bool MemoryGovernor::Request(int id, long long nBytes, bool force)
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+
+  if ((id < 0) || (id >= int(this->Consumers.size())) ||
+    !this->Consumers[id].Active)
+    {
+    SENSEI_ERROR("No memory consumer " << id)
+    return false;
+    }
+
+  bool granted = true;
+  if (this->Limit > 0)
+    {
+    this->Sample();
+
+    long long wanted = nBytes - this->Available();
+    if (wanted > 0)
+      {
+      // ask the consumers that can give memory back. they are called
+      // without the lock since they release what they held
+      std::vector<ReleaseFunction> releases;
+      int nConsumers = this->Consumers.size();
+      for (int i = 0; i < nConsumers; ++i)
+        {
+        const Consumer &consumer = this->Consumers[i];
+        if ((i != id) && consumer.Active && consumer.Release &&
+          (consumer.Policy == POLICY_DEGRADE))
+          releases.push_back(consumer.Release);
+        }
+
+      if (!releases.empty())
+        {
+        lock.unlock();
+
+        long long released = 0;
+        size_t nReleases = releases.size();
+        for (size_t i = 0; (i < nReleases) && (released < wanted); ++i)
+          released += releases[i](wanted - released);
+
+        lock.lock();
+
+        if (released > 0)
+          {
+          this->HaveSample = false;
+          this->Sample();
+          }
+        }
+
+      granted = nBytes <= this->Available();
+      }
+    }
+
+  Consumer &consumer = this->Consumers[id];
+  if (granted || force)
+    {
+    consumer.Granted += nBytes;
+    this->Granted += nBytes;
+    }
+
+  if (!granted)
+    consumer.Denied += 1;
+
+  return granted;
+}
+
+// --------------------------------------------------------------------------
+void MemoryGovernor::Release(int id, long long nBytes)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  if ((id < 0) || (id >= int(this->Consumers.size())))
+    return;
+
+  Consumer &consumer = this->Consumers[id];
+
+  nBytes = std::min(nBytes, consumer.Granted);
+  consumer.Granted -= nBytes;
+  this->Granted -= nBytes;
+}
+
+// --------------------------------------------------------------------------
+long long MemoryGovernor::GetGranted(int id) const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  if ((id < 0) || (id >= int(this->Consumers.size())))
+    return 0;
+
+  return this->Consumers[id].Granted;
+}
+
+// --------------------------------------------------------------------------
+long long MemoryGovernor::GetNumberOfDenials(int id) const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  if ((id < 0) || (id >= int(this->Consumers.size())))
+    return 0;
+
+  return this->Consumers[id].Denied;
+}
+
+}
@@ -0,0 +1,130 @@
+#ifndef sensei_MemoryGovernor_h
+#define sensei_MemoryGovernor_h
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sensei
+{
+
+/// @class MemoryGovernor
+/// @brief a process wide budget for the memory used in situ.
+///
+/// Analyses, writers, caches and prefetchers register with the governor
+/// and request the memory they are about to use. The memory available is
+/// the limit, less a reserve kept for the simulation's growth, less the
+/// larger of the resident set size and the memory granted. The resident
+/// set size is fed by the MemoryProfiler's samples when it runs, and is
+/// otherwise read on request, so that the budget follows the simulation's
+/// use.
+///
+/// When a request does not fit, the consumers that can give memory back,
+/// those registered with POLICY_DEGRADE and a release function, are asked
+/// to do so. If the request still does not fit it is denied and the
+/// requester applies its policy: skip the step, stream the data in smaller
+/// pieces, or spill it to the directory given by GetSpillDirectory.
+///
+/// No limit is set by default in which case every request is granted. The
+/// governor makes no MPI calls, when requests are denied on some ranks
+/// the consumer is responsible for a consistent decision. All methods are
+/// thread safe.
+class MemoryGovernor
+{
+public:
+  /// the process wide governor
+  static MemoryGovernor &GetGlobalGovernor();
+
+  /// what a consumer does when its request is denied
+  enum {POLICY_DEGRADE=0, POLICY_SKIP=1, POLICY_STREAM=2, POLICY_SPILL=3};
+
+  /// convert a policy name, degrade, skip, stream or spill, to its value.
+  /// returns zero if successful.
+  static int GetPolicy(const std::string &name, int &policy);
+
+  /// called with the number of bytes wanted, returns the bytes released
+  using ReleaseFunction = std::function<long long(long long)>;
+
+  /// register a consumer, returns its id
+  int Register(const std::string &name, int policy,
+    const ReleaseFunction &release = ReleaseFunction());
+
+  /// release the consumer's memory and forget it
+  void Unregister(int id);
+
+  /// set the bytes the process may use. 0, the default, sets no limit
+  void SetLimit(long long nBytes);
+  long long GetLimit() const;
+
+  /// set the bytes kept in reserve for the simulation's growth
+  void SetReserve(long long nBytes);
+  long long GetReserve() const;
+
+  /// set the directory, typically on node local storage, where consumers
+  /// with POLICY_SPILL write what does not fit
+  void SetSpillDirectory(const std::string &dir);
+  std::string GetSpillDirectory() const;
+
+  /// true when a limit is set
+  bool Enabled() const;
+
+  /// request nBytes for the consumer. returns true when they are granted.
+  /// when force is set the bytes are accounted even when they do not fit,
+  /// for memory already in use
+  bool Request(int id, long long nBytes, bool force = false);
+
+  /// return bytes granted earlier
+  void Release(int id, long long nBytes);
+
+  /// the bytes the consumer holds and the number of its requests denied
+  long long GetGranted(int id) const;
+  long long GetNumberOfDenials(int id) const;
+
+  /// the bytes that may be granted now
+  long long GetAvailable();
+
+  /// set the resident set size in bytes. called by the MemoryProfiler
+  void UpdateUsage(long long nBytes);
+
+private:
+  MemoryGovernor();
+  ~MemoryGovernor() = delete;
+
+  MemoryGovernor(const MemoryGovernor &) = delete;
+  void operator=(const MemoryGovernor &) = delete;
+
+  struct Consumer
+  {
+    Consumer() : Policy(POLICY_SKIP), Granted(0), Denied(0), Active(false) {}
+
+    std::string Name;
+    int Policy;
+    ReleaseFunction Release;
+    long long Granted;
+    long long Denied;
+    bool Active;
+  };
+
+  // read the resident set size when no recent sample was fed. the caller
+  // must hold the mutex
+  void Sample();
+
+  // the bytes available. the caller must hold the mutex
+  long long Available() const;
+
+  mutable std::mutex Mutex;
+  std::vector<Consumer> Consumers;
+  long long Limit;
+  long long Reserve;
+  long long Granted;
+  long long Used;
+  std::chrono::steady_clock::time_point SampleTime;
+  bool HaveSample;
+  std::string SpillDirectory;
+};
+
+}
+
+#endif
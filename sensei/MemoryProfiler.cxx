@@ -1,4 +1,7 @@
 #include "MemoryProfiler.h"
+#include "MemoryGovernor.h"
+#include "EnergyMeter.h"
+#include "MPIUtils.h"
 #include "Error.h"
 
 #if defined(_WIN32)
@@ -33,6 +36,7 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #endif
 
 #include <ctype.h>
@@ -41,8 +45,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
 #include <vector>
 #include <deque>
+#include <chrono>
 #include <sstream>
 #include <sys/time.h>
 #include <cstring>
@@ -195,11 +201,33 @@ namespace sensei
 struct MemoryProfiler::InternalsType
 {
   InternalsType() : Comm(MPI_COMM_WORLD), Filename("mem_prof.csv"),
-    Interval(60.0), DataMutex(PTHREAD_MUTEX_INITIALIZER),
-    TotalVirtualMemory(0), AvailableVirtualMemory(0),
+    Interval(60.0), Format(MemoryProfiler::FORMAT_CSV), TrackPeak(false),
+    TrackEnergy(false), DataMutex(PTHREAD_MUTEX_INITIALIZER), StatusFd(-1), ClearRefsFd(-1),
+    CgroupFd(-1), TimerFd(-1), TotalVirtualMemory(0), AvailableVirtualMemory(0),
     TotalPhysicalMemory(0), AvailablePhysicalMemory(0)
       {}
 
+  // a memory use sample. sizes are in KiB, or -1 when not available
+  struct Sample
+  {
+    double Time;
+    long long Used;   // the resident set size
+    long long Peak;   // the largest resident set size since the last sample
+    long long Cgroup; // the memory charged to the process' cgroup
+    long long Energy[EnergyMeter::NUM_DOMAINS]; // micro joules, when tracked
+  };
+
+  // open the files read by each sample, they are kept open so that
+  // sampling costs a few reads
+  void OpenSampleFiles();
+  void CloseSampleFiles();
+
+  // capture the current memory use
+  void GetSample(Sample &smp);
+
+  // serialize the samples in the configured format
+  void Serialize(int rank, std::string &buf);
+
   // initialize member vars with data about ram available on this system
   int InitializeMemory();
   int InitializeAppleMemory();
@@ -244,10 +272,16 @@ struct MemoryProfiler::InternalsType
   MPI_Comm Comm;
   std::string Filename;
   double Interval;
-  std::deque<long long> MemUse;
-  std::deque<double> TimePt;
+  int Format;
+  bool TrackPeak;
+  bool TrackEnergy;
+  std::deque<Sample> Samples;
   pthread_t Thread;
   pthread_mutex_t DataMutex;
+  int StatusFd;
+  int ClearRefsFd;
+  int CgroupFd;
+  int TimerFd;
   long long TotalVirtualMemory;
   long long AvailableVirtualMemory;
   long long TotalPhysicalMemory;
@@ -269,6 +303,8 @@ MemoryProfiler::~MemoryProfiler()
 // --------------------------------------------------------------------------
 int MemoryProfiler::Initialize()
 {
+  this->Internals->OpenSampleFiles();
+
   if (pthread_create(&this->Internals->Thread,
     nullptr, profile, this->Internals))
     {
@@ -301,25 +337,11 @@ int MemoryProfiler::Finalize()
   // tell the thread to quit
   this->Internals->Interval = -1;
 
-  // create the ascii buffer
-  // use ascii in the file as a convenince
-  std::ostringstream oss;
-  oss.precision(std::numeric_limits<double>::digits10 + 2);
-  oss.setf(std::ios::scientific, std::ios::floatfield);
-
-  if (rank == 0)
-    oss << "# rank, time, memory kiB" << std::endl;
-
-  long n_elem = this->Internals->MemUse.size();
-  for (long i = 0; i < n_elem; ++i)
-    {
-    oss << rank << ", " << this->Internals->TimePt[i]
-      << ", " << this->Internals->MemUse[i] << std::endl;
-    }
+  std::string buf;
+  this->Internals->Serialize(rank, buf);
 
   // free resources
-  this->Internals->TimePt.clear();
-  this->Internals->MemUse.clear();
+  this->Internals->Samples.clear();
 
   pthread_mutex_unlock(&this->Internals->DataMutex);
 
@@ -327,7 +349,7 @@ int MemoryProfiler::Finalize()
   pthread_cancel(this->Internals->Thread);
 
   // compute the file offset
-  long n_bytes = oss.str().size();
+  long n_bytes = buf.size();
 
   if (ok)
     {
@@ -353,8 +375,7 @@ int MemoryProfiler::Finalize()
     MPI_File_set_view(fh, offset, MPI_BYTE, MPI_BYTE,
       "native", MPI_INFO_NULL);
 
-    MPI_File_write(fh, oss.str().c_str(), n_bytes,
-      MPI_BYTE, MPI_STATUS_IGNORE);
+    MPIUtils::FileWrite(fh, buf.c_str(), n_bytes, MPI_BYTE);
 
     MPI_File_set_size(fh, file_size);
 
@@ -371,7 +392,7 @@ int MemoryProfiler::Finalize()
       return -1;
       }
 
-    long nwritten = fwrite(oss.str().c_str(), 1, n_bytes, fh);
+    long nwritten = fwrite(buf.c_str(), 1, n_bytes, fh);
     if (nwritten != n_bytes)
       {
       const char *estr = strerror(errno);
@@ -385,6 +406,8 @@ int MemoryProfiler::Finalize()
   // wait for the proiler thread to finish
   pthread_join(this->Internals->Thread, nullptr);
 
+  this->Internals->CloseSampleFiles();
+
   return 0;
 }
 
@@ -402,6 +425,66 @@ void MemoryProfiler::SetInterval(double interval)
   pthread_mutex_unlock(&this->Internals->DataMutex);
 }
 
+// --------------------------------------------------------------------------
+long long MemoryProfiler::GetMemoryUsed()
+{
+#if defined(__linux)
+  // the second field is the number of resident pages
+  FILE *fh = fopen("/proc/self/statm", "r");
+  if (!fh)
+    return -1;
+
+  long long nPages = 0;
+  long long nResident = -1;
+  int nRead = fscanf(fh, "%lld %lld", &nPages, &nResident);
+  fclose(fh);
+
+  if (nRead != 2)
+    return -1;
+
+  return nResident*(sysconf(_SC_PAGESIZE)/1024);
+#else
+  InternalsType internals;
+  return internals.GetProcMemoryUsed();
+#endif
+}
+
+// --------------------------------------------------------------------------
+long long MemoryProfiler::GetPeakMemoryUsed()
+{
+#if defined(_WIN32)
+  return -1;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+    return -1;
+#if defined(__APPLE__)
+  // reported in bytes
+  return usage.ru_maxrss/1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// --------------------------------------------------------------------------
+void MemoryProfiler::SetFormat(int format)
+{
+  this->Internals->Format = format;
+}
+
+// --------------------------------------------------------------------------
+void MemoryProfiler::SetTrackPeak(bool val)
+{
+  this->Internals->TrackPeak = val;
+}
+
+// --------------------------------------------------------------------------
+void MemoryProfiler::SetTrackEnergy(bool val)
+{
+  this->Internals->TrackEnergy = val;
+}
+
 // --------------------------------------------------------------------------
 void MemoryProfiler::SetCommunicator(MPI_Comm comm)
 {
@@ -437,6 +520,191 @@ std::string system_information::get_memory_description(
 }
 */
 
+// --------------------------------------------------------------------------
+void MemoryProfiler::InternalsType::OpenSampleFiles()
+{
+#if defined(__linux)
+  // a periodic timer keeps the sampling rate steady regardless of the time
+  // taken to sample
+  this->TimerFd = timerfd_create(CLOCK_MONOTONIC, 0);
+
+  this->StatusFd = open("/proc/self/status", O_RDONLY);
+
+  // the kernel's high water mark is reset after each sample so that short
+  // lived peaks between samples are seen. this also resets the value
+  // reported by getrusage
+  if (this->TrackPeak)
+    this->ClearRefsFd = open("/proc/self/clear_refs", O_WRONLY);
+
+  // locate the process' cgroup. v2 lists it as 0::<path>, v1 lists the
+  // memory controller as <n>:memory:<path>
+  std::vector<std::string> lines;
+  loadLines("/proc/self/cgroup", lines);
+
+  size_t nLines = lines.size();
+  for (size_t i = 0; (this->CgroupFd < 0) && (i < nLines); ++i)
+    {
+    std::string file;
+    if (lines[i].compare(0, 3, "0::") == 0)
+      {
+      file = "/sys/fs/cgroup" + lines[i].substr(3) + "/memory.current";
+      }
+    else
+      {
+      size_t at = lines[i].find(":memory:");
+      if (at != std::string::npos)
+        file = "/sys/fs/cgroup/memory" + lines[i].substr(at + 8)
+          + "/memory.usage_in_bytes";
+      }
+
+    if (!file.empty())
+      this->CgroupFd = open(file.c_str(), O_RDONLY);
+    }
+#endif
+}
+
+// --------------------------------------------------------------------------
+void MemoryProfiler::InternalsType::CloseSampleFiles()
+{
+#if defined(__linux)
+  if (this->StatusFd >= 0)
+    close(this->StatusFd);
+
+  if (this->ClearRefsFd >= 0)
+    close(this->ClearRefsFd);
+
+  if (this->CgroupFd >= 0)
+    close(this->CgroupFd);
+
+  if (this->TimerFd >= 0)
+    close(this->TimerFd);
+#endif
+  this->TimerFd = -1;
+  this->StatusFd = -1;
+  this->ClearRefsFd = -1;
+  this->CgroupFd = -1;
+}
+
+#if defined(__linux)
+// --------------------------------------------------------------------------
+static long long readField(const char *buf, const char *name)
+{
+  const char *at = strstr(buf, name);
+  if (!at)
+    return -1;
+
+  return strtoll(at + strlen(name), nullptr, 10);
+}
+#endif
+
+// --------------------------------------------------------------------------
+void MemoryProfiler::InternalsType::GetSample(Sample &smp)
+{
+  // times are seconds since the epoch, as in the timer log, so that samples
+  // can be matched to the events that were active when they were taken
+  smp.Time = std::chrono::duration<double>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+
+  smp.Used = -1;
+  smp.Peak = -1;
+  smp.Cgroup = -1;
+
+  if (this->TrackEnergy)
+    EnergyMeter::Read(smp.Energy);
+  else
+    std::fill(smp.Energy, smp.Energy + EnergyMeter::NUM_DOMAINS, -1ll);
+
+#if defined(__linux)
+  char buf[8192];
+
+  ssize_t n = 0;
+  if ((this->StatusFd >= 0) &&
+    ((n = pread(this->StatusFd, buf, sizeof(buf) - 1, 0)) > 0))
+    {
+    buf[n] = '\0';
+    smp.Used = readField(buf, "VmRSS:");
+    smp.Peak = readField(buf, "VmHWM:");
+
+    if ((this->ClearRefsFd >= 0) && (pwrite(this->ClearRefsFd, "5", 1, 0) != 1))
+      {
+      close(this->ClearRefsFd);
+      this->ClearRefsFd = -1;
+      }
+    }
+  else
+    {
+    smp.Used = this->GetProcMemoryUsed();
+    }
+
+  // without tracking the high water mark is that of the whole run
+  if (this->ClearRefsFd < 0)
+    smp.Peak = smp.Used;
+
+  if ((this->CgroupFd >= 0) &&
+    ((n = pread(this->CgroupFd, buf, sizeof(buf) - 1, 0)) > 0))
+    {
+    buf[n] = '\0';
+    smp.Cgroup = strtoll(buf, nullptr, 10)/1024;
+    }
+#else
+  smp.Used = this->GetProcMemoryUsed();
+  smp.Peak = smp.Used;
+#endif
+}
+
+// --------------------------------------------------------------------------
+void MemoryProfiler::InternalsType::Serialize(int rank, std::string &buf)
+{
+  long long nSamples = this->Samples.size();
+
+  if (this->Format == MemoryProfiler::FORMAT_BINARY)
+    {
+    if (rank == 0)
+      buf.append(this->TrackEnergy ? "SENSEIMEM2\n" : "SENSEIMEM1\n");
+
+    buf.append(reinterpret_cast<const char*>(&rank), sizeof(int));
+    buf.append(reinterpret_cast<const char*>(&nSamples), sizeof(long long));
+
+    for (long long i = 0; i < nSamples; ++i)
+      {
+      const Sample &smp = this->Samples[i];
+      buf.append(reinterpret_cast<const char*>(&smp.Time), sizeof(double));
+      buf.append(reinterpret_cast<const char*>(&smp.Used), sizeof(long long));
+      buf.append(reinterpret_cast<const char*>(&smp.Peak), sizeof(long long));
+      buf.append(reinterpret_cast<const char*>(&smp.Cgroup), sizeof(long long));
+
+      if (this->TrackEnergy)
+        buf.append(reinterpret_cast<const char*>(smp.Energy),
+          EnergyMeter::NUM_DOMAINS*sizeof(long long));
+      }
+
+    return;
+    }
+
+  // use ascii in the file as a convenince
+  std::ostringstream oss;
+  oss.precision(std::numeric_limits<double>::digits10 + 2);
+  oss.setf(std::ios::scientific, std::ios::floatfield);
+
+  if (rank == 0)
+    oss << "# rank, time, memory kiB, peak kiB, cgroup kiB"
+      << (this->TrackEnergy ? ", cpu uJ, dram uJ, gpu uJ" : "") << std::endl;
+
+  for (long long i = 0; i < nSamples; ++i)
+    {
+    const Sample &smp = this->Samples[i];
+    oss << rank << ", " << smp.Time << ", " << smp.Used << ", "
+      << smp.Peak << ", " << smp.Cgroup;
+
+    for (int j = 0; this->TrackEnergy && (j < EnergyMeter::NUM_DOMAINS); ++j)
+      oss << ", " << smp.Energy[j];
+
+    oss << std::endl;
+    }
+
+  buf = oss.str();
+}
+
 // --------------------------------------------------------------------------
 int MemoryProfiler::InternalsType::InitializeMemory()
 {
@@ -927,20 +1195,25 @@ extern "C" void *profile(void *argp)
   sensei::MemoryProfiler::InternalsType *internals =
     reinterpret_cast<sensei::MemoryProfiler::InternalsType*>(argp);
 
+#if defined(__linux)
+  int timerFd = internals->TimerFd;
+  double armedInterval = 0.0;
+#endif
+
   while (1)
     {
     // capture the current time and memory usage.
-    struct timeval tv;
-    gettimeofday(&tv, nullptr);
+    sensei::MemoryProfiler::InternalsType::Sample smp;
+    internals->GetSample(smp);
 
-    double cur_time = tv.tv_sec + tv.tv_usec/1.0e6;
-    long long cur_mem = internals->GetProcMemoryUsed();
+    // the in situ memory budget follows the process' use
+    if (smp.Used >= 0)
+      sensei::MemoryGovernor::GetGlobalGovernor().UpdateUsage(1024ll*smp.Used);
 
     pthread_mutex_lock(&internals->DataMutex);
 
     // log time and mem use
-    internals->TimePt.push_back(cur_time);
-    internals->MemUse.push_back(cur_mem);
+    internals->Samples.push_back(smp);
 
     // get next interval
     double interval = internals->Interval;
@@ -951,9 +1224,43 @@ extern "C" void *profile(void *argp)
     if (interval < 0)
       pthread_exit(nullptr);
 
-    // suspend the thread for the requested interval
     long long secs = floor(interval);
     long nsecs = (interval - secs)*1e9;
+
+#if defined(__linux)
+    if (timerFd >= 0)
+      {
+      // (re)arm the timer when the interval changes
+      if (interval != armedInterval)
+        {
+        struct itimerspec spec;
+        spec.it_interval.tv_sec = secs;
+        spec.it_interval.tv_nsec = nsecs;
+        spec.it_value = spec.it_interval;
+        if ((secs == 0) && (nsecs == 0))
+          spec.it_value.tv_nsec = spec.it_interval.tv_nsec = 1;
+
+        timerfd_settime(timerFd, 0, &spec, nullptr);
+        armedInterval = interval;
+        }
+
+      // wait for the next expiry. expiries missed while sampling are
+      // dropped rather than sampled back to back
+      uint64_t nExpired = 0;
+      ssize_t ierr = 0;
+      while (((ierr = read(timerFd, &nExpired, sizeof(nExpired))) < 0) && (errno == EINTR));
+      if (ierr < 0)
+        {
+        const char *estr = strerror(errno);
+        SENSEI_ERROR("Error: timer had an error \"" << estr << "\"")
+        abort();
+        }
+
+      continue;
+      }
+#endif
+
+    // suspend the thread for the requested interval
     struct timespec sleep_time = {secs, nsecs};
 
     int ierr = 0;
@@ -13,9 +13,13 @@ namespace sensei
 // MemoryProfiler - A sampling memory use profiler
 /**
 The class samples process memory usage at the specified interval
-given in seconds. For each sample the time is aquired. Calling
-Initialize starts profiling, and Finalize ends it. During
-Finaliziation the buffers are written using MPI-I/O to the
+given in seconds, which may be a fraction of a second. For each sample the
+time is aquired, in seconds since the epoch as in the timer log, so that
+samples can be matched to profiler events. Each sample records the resident set size,
+the largest resident set size since the previous sample, and the memory
+charged to the process' cgroup, and when enabled the energy used by the
+node. Sizes are in KiB, or -1 when not available. Calling Initialize starts profiling, and Finalize ends it.
+During Finaliziation the buffers are written using MPI-I/O to the
 file name provided
 */
 class MemoryProfiler
@@ -36,6 +40,29 @@ public:
   void SetInterval(double interval);
   double GetInterval() const;
 
+  // Set the format of the file written. In the CSV format, the default, a
+  // line of text is written for each sample. The binary format starts with
+  // the line "SENSEIMEM1\n" followed by a record for each rank in rank
+  // order. A record is the rank (int), the number of samples (long long),
+  // and for each sample the time (double), and the memory used, peak, and
+  // cgroup sizes (long long). When energy is tracked the line is
+  // "SENSEIMEM2\n" and each sample ends with the CPU, DRAM, and GPU
+  // energy (long long). Values are in the native byte order.
+  enum {FORMAT_CSV=0, FORMAT_BINARY=1};
+  void SetFormat(int format);
+
+  // When set, the high water mark kept by the kernel is reset after each
+  // sample so that the peak between samples is recorded. Doing so alters
+  // the peak reported by getrusage. Only available on Linux. Otherwise the
+  // peak is the memory used when the sample was taken.
+  void SetTrackPeak(bool val);
+
+  // When set, each sample records the energy used by the node since the
+  // first sample, in micro joules, for the CPU, DRAM, and GPU domains, or
+  // -1 for those without sensors, see EnergyMeter. Set by the Profiler
+  // when energy measurement is enabled.
+  void SetTrackEnergy(bool val);
+
   // Set the comunicator for parallel I/O
   void SetCommunicator(MPI_Comm comm);
 
@@ -43,6 +70,11 @@ public:
   void SetFilename(const std::string &filename);
   const char *GetFilename() const;
 
+  // Get the resident set size and its peak over the life of the process,
+  // in KiB. These are cheap enough to call around each unit of work.
+  static long long GetMemoryUsed();
+  static long long GetPeakMemoryUsed();
+
   friend void *::profile(void *argp);
 
 private:
@@ -6,6 +6,371 @@
 
 #include <utility>
 #include <algorithm>
+#include <array>
+#include <map>
+
+namespace
+{
+// marks a compact stream. a verbatim stream begins with the GlobalView
+// flag which is 0 or 1
+const unsigned char CompactMagic = 0xfe;
+const unsigned char CompactVersion = 1;
+
+// marks a delta stream, see MeshMetadata::ToDeltaStream
+const unsigned char DeltaMagic = 0xfd;
+const unsigned char DeltaVersion = 1;
+
+// pack an unsigned value 7 bits at a time, the high bit flags that
+// more bytes follow
+void packVarint(sensei::BinaryStream &str, unsigned long long val)
+{
+  unsigned char buf[10];
+  int n = 0;
+  while (val >= 0x80)
+    {
+    buf[n++] = (val & 0x7f) | 0x80;
+    val >>= 7;
+    }
+  buf[n++] = val;
+  str.Pack(buf, n);
+}
+
+unsigned long long unpackVarint(sensei::BinaryStream &str)
+{
+  unsigned long long val = 0;
+  for (int shift = 0; shift < 64; shift += 7)
+    {
+    unsigned char byte = 0;
+    str.Unpack(byte);
+    val |= (unsigned long long)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      break;
+    }
+  return val;
+}
+
+// map signed differences onto unsigned values such that small
+// magnitudes have short encodings
+unsigned long long zigZag(long long val)
+{
+  return ((unsigned long long)val << 1) ^ (val >> 63);
+}
+
+long long unZigZag(unsigned long long val)
+{
+  return (long long)(val >> 1) ^ -(long long)(val & 1);
+}
+
+// differences are computed in unsigned arithmetic, which wraps, so that
+// any pair of values round trips
+long long delta(long long cur, long long prev)
+{
+  return (long long)((unsigned long long)cur - (unsigned long long)prev);
+}
+
+long long undelta(long long prev, long long d)
+{
+  return (long long)((unsigned long long)prev + (unsigned long long)d);
+}
+
+// pack the differences between consecutive values
+template <typename T>
+void packDeltas(sensei::BinaryStream &str, const std::vector<T> &vec)
+{
+  unsigned long n = vec.size();
+  packVarint(str, n);
+
+  long long prev = 0;
+  for (unsigned long i = 0; i < n; ++i)
+    {
+    long long cur = vec[i];
+    packVarint(str, zigZag(delta(cur, prev)));
+    prev = cur;
+    }
+}
+
+template <typename T>
+void unpackDeltas(sensei::BinaryStream &str, std::vector<T> &vec)
+{
+  unsigned long n = unpackVarint(str);
+  vec.resize(n);
+
+  long long prev = 0;
+  for (unsigned long i = 0; i < n; ++i)
+    {
+    prev = undelta(prev, unZigZag(unpackVarint(str)));
+    vec[i] = prev;
+    }
+}
+
+// pack the differences between the same component of consecutive tuples
+template <typename T, std::size_t N>
+void packDeltas(sensei::BinaryStream &str, const std::vector<std::array<T,N>> &vec)
+{
+  unsigned long n = vec.size();
+  packVarint(str, n);
+
+  std::array<long long,N> prev;
+  prev.fill(0);
+
+  for (unsigned long i = 0; i < n; ++i)
+    {
+    for (std::size_t j = 0; j < N; ++j)
+      {
+      long long cur = vec[i][j];
+      packVarint(str, zigZag(delta(cur, prev[j])));
+      prev[j] = cur;
+      }
+    }
+}
+
+template <typename T, std::size_t N>
+void unpackDeltas(sensei::BinaryStream &str, std::vector<std::array<T,N>> &vec)
+{
+  unsigned long n = unpackVarint(str);
+  vec.resize(n);
+
+  std::array<long long,N> prev;
+  prev.fill(0);
+
+  for (unsigned long i = 0; i < n; ++i)
+    {
+    for (std::size_t j = 0; j < N; ++j)
+      {
+      prev[j] = undelta(prev[j], unZigZag(unpackVarint(str)));
+      vec[i][j] = prev[j];
+      }
+    }
+}
+
+// the delta of a field is its value, packed only when it differs from the
+// base. the field's bit in the mask records that it was
+template <typename T>
+void packFieldDelta(sensei::BinaryStream &str, unsigned long long &mask,
+  int field, const T &cur, const T &base)
+{
+  if (cur == base)
+    return;
+
+  mask |= 1ull << field;
+  str.Pack(cur);
+}
+
+template <typename T>
+int unpackFieldDelta(sensei::BinaryStream &str, unsigned long long mask,
+  int field, T &cur)
+{
+  if (mask & (1ull << field))
+    str.Unpack(cur);
+  return 0;
+}
+
+// the delta of a vector is either the whole vector or, when fewer than
+// half of the elements differ, the new size followed by the elements that
+// differ, each preceded by its distance from the previous one
+enum { VECTOR_FULL = 0, VECTOR_SPARSE = 1 };
+
+template <typename T>
+void packFieldDelta(sensei::BinaryStream &str, unsigned long long &mask,
+  int field, const std::vector<T> &cur, const std::vector<T> &base)
+{
+  if (cur == base)
+    return;
+
+  mask |= 1ull << field;
+
+  unsigned long n = cur.size();
+  unsigned long nBase = std::min(n, (unsigned long)base.size());
+
+  std::vector<unsigned long> changed;
+  for (unsigned long i = 0; i < n; ++i)
+    {
+    if ((i >= nBase) || !(cur[i] == base[i]))
+      changed.push_back(i);
+    }
+
+  unsigned long nChanged = changed.size();
+  if (2*nChanged >= n)
+    {
+    str.Pack((unsigned char)VECTOR_FULL);
+    str.Pack(cur);
+    return;
+    }
+
+  str.Pack((unsigned char)VECTOR_SPARSE);
+  packVarint(str, n);
+  packVarint(str, nChanged);
+
+  unsigned long prev = 0;
+  for (unsigned long i = 0; i < nChanged; ++i)
+    {
+    packVarint(str, changed[i] - prev);
+    prev = changed[i];
+    str.Pack(cur[changed[i]]);
+    }
+}
+
+template <typename T>
+int unpackFieldDelta(sensei::BinaryStream &str, unsigned long long mask,
+  int field, std::vector<T> &cur)
+{
+  if (!(mask & (1ull << field)))
+    return 0;
+
+  unsigned char mode = 0;
+  str.Unpack(mode);
+
+  if (mode == VECTOR_FULL)
+    {
+    str.Unpack(cur);
+    return 0;
+    }
+
+  if (mode != VECTOR_SPARSE)
+    {
+    SENSEI_ERROR("Invalid delta mode " << int(mode) << " of field " << field)
+    return -1;
+    }
+
+  unsigned long n = unpackVarint(str);
+  unsigned long nChanged = unpackVarint(str);
+
+  cur.resize(n);
+
+  unsigned long idx = 0;
+  for (unsigned long i = 0; i < nChanged; ++i)
+    {
+    idx += unpackVarint(str);
+    if (idx >= n)
+      {
+      SENSEI_ERROR("Invalid delta of field " << field << ", element "
+        << idx << " of " << n)
+      return -1;
+      }
+    str.Unpack(cur[idx]);
+    }
+
+  return 0;
+}
+
+// gather the per block fields over a hierarchical communicator
+void globalizeBlockFields(const sensei::MPIUtils::HierarchicalComm &comm,
+  sensei::MeshMetadata *md)
+{
+  sensei::MPIUtils::GlobalViewV(comm, md->BlockOwner);
+  sensei::MPIUtils::GlobalViewV(comm, md->BlockIds);
+  sensei::MPIUtils::GlobalViewV(comm, md->NumBlocksLocal);
+  sensei::MPIUtils::GlobalViewV(comm, md->BlockNumPoints);
+  sensei::MPIUtils::GlobalViewV(comm, md->BlockNumCells);
+  sensei::MPIUtils::GlobalViewV(comm, md->BlockCellArraySize);
+  sensei::MPIUtils::GlobalViewV(comm, md->BlockExtents);
+  sensei::MPIUtils::GlobalViewV(comm, md->BlockBounds);
+  sensei::MPIUtils::GlobalViewV(comm, md->BlockArrayRange);
+  sensei::MPIUtils::GlobalViewV(comm, md->BlockLevel);
+}
+
+// gather a field with the shared layout when it has an entry per local
+// block on every rank, otherwise with its own counts
+template <typename vec_t>
+void globalizeField(MPI_Comm comm, const sensei::MPIUtils::ViewLayout &layout,
+  bool perBlock, vec_t &field)
+{
+  if (perBlock)
+    sensei::MPIUtils::GlobalViewV(comm, layout, field);
+  else
+    sensei::MPIUtils::GlobalViewV(comm, field);
+}
+
+// gather the per block fields over comm. GlobalViewV would exchange the
+// counts of each field, however the fields that are present have an entry
+// per local block. the block counts are exchanged once for all of them,
+// along with flags telling which fields have the expected size on every
+// rank. the others, and NumBlocksLocal, are gathered as before.
+void globalizeBlockFields(MPI_Comm comm, sensei::MeshMetadata *md)
+{
+  const int nFields = 9;
+  size_t sizes[nFields] = {md->BlockOwner.size(), md->BlockIds.size(),
+    md->BlockNumPoints.size(), md->BlockNumCells.size(),
+    md->BlockCellArraySize.size(), md->BlockExtents.size(),
+    md->BlockBounds.size(), md->BlockArrayRange.size(),
+    md->BlockLevel.size()};
+
+  size_t nLocal = *std::max_element(sizes, sizes + nFields);
+
+  int flags = 0;
+  for (int i = 0; i < nFields; ++i)
+    {
+    if (sizes[i] == nLocal)
+      flags |= 1 << i;
+    }
+
+  // the ranges also need an entry per array
+  for (size_t i = 0; i < md->BlockArrayRange.size(); ++i)
+    {
+    if (md->BlockArrayRange[i].size() != unsigned(md->NumArrays))
+      flags &= ~(1 << 7);
+    }
+
+  int nRanks = 1;
+  MPI_Comm_size(comm, &nRanks);
+
+  int local[2] = {int(nLocal), flags};
+  std::vector<int> global(2*nRanks);
+
+  MPI_Allgather(local, 2, MPI_INT, global.data(), 2, MPI_INT, comm);
+
+  sensei::MPIUtils::ViewLayout layout;
+  layout.Counts.resize(nRanks);
+  for (int i = 0; i < nRanks; ++i)
+    {
+    layout.Counts[i] = global[2*i];
+    flags &= global[2*i + 1];
+    }
+  layout.Update();
+
+  sensei::MPIUtils::GlobalViewV(comm, md->NumBlocksLocal);
+
+  globalizeField(comm, layout, flags & (1 << 0), md->BlockOwner);
+  globalizeField(comm, layout, flags & (1 << 1), md->BlockIds);
+  globalizeField(comm, layout, flags & (1 << 2), md->BlockNumPoints);
+  globalizeField(comm, layout, flags & (1 << 3), md->BlockNumCells);
+  globalizeField(comm, layout, flags & (1 << 4), md->BlockCellArraySize);
+  globalizeField(comm, layout, flags & (1 << 5), md->BlockExtents);
+  globalizeField(comm, layout, flags & (1 << 6), md->BlockBounds);
+  globalizeField(comm, layout, flags & (1 << 8), md->BlockLevel);
+
+  if (!(flags & (1 << 7)))
+    {
+    sensei::MPIUtils::GlobalViewV(comm, md->BlockArrayRange);
+    return;
+    }
+
+  // the ranges of each block are flattened, 2 values per array
+  int nArrays = md->NumArrays;
+
+  std::vector<double> lranges;
+  lranges.reserve(2*nArrays*nLocal);
+  for (size_t i = 0; i < nLocal; ++i)
+    {
+    for (int j = 0; j < nArrays; ++j)
+      {
+      lranges.push_back(md->BlockArrayRange[i][j][0]);
+      lranges.push_back(md->BlockArrayRange[i][j][1]);
+      }
+    }
+
+  std::vector<double> granges;
+  sensei::MPIUtils::GlobalViewV(comm, layout.Scale(2*nArrays), lranges, granges);
+
+  md->BlockArrayRange.resize(layout.Total);
+  for (long i = 0, q = 0; i < layout.Total; ++i)
+    {
+    md->BlockArrayRange[i].resize(nArrays);
+    for (int j = 0; j < nArrays; ++j, q += 2)
+      md->BlockArrayRange[i][j] = {granges[q], granges[q + 1]};
+    }
+}
+}
 
 namespace sensei
 {
@@ -20,6 +385,12 @@ int MeshMetadataFlags::ToStream(sensei::BinaryStream &str) const
   return 0;
 }
 
+// --------------------------------------------------------------------------
+unsigned long MeshMetadataFlags::GetSerializedSize() const
+{
+  return BinaryStream::PackedSize(this->Flags);
+}
+
 // --------------------------------------------------------------------------
 int MeshMetadataFlags::FromStream(sensei::BinaryStream &str)
 {
@@ -68,8 +439,63 @@ int MeshMetadataFlags::ToStream(ostream &str) const
 }
 
 // --------------------------------------------------------------------------
-int MeshMetadata::ToStream(sensei::BinaryStream &str) const
+unsigned long MeshMetadata::GetSerializedSize() const
 {
+  unsigned long nBytes = 0;
+  nBytes += BinaryStream::PackedSize(this->GlobalView);
+  nBytes += BinaryStream::PackedSize(this->MeshName);
+  nBytes += BinaryStream::PackedSize(this->MeshType);
+  nBytes += BinaryStream::PackedSize(this->BlockType);
+  nBytes += BinaryStream::PackedSize(this->NumBlocks);
+  nBytes += BinaryStream::PackedSize(this->NumBlocksLocal);
+  nBytes += BinaryStream::PackedSize(this->Extent);
+  nBytes += BinaryStream::PackedSize(this->Bounds);
+  nBytes += BinaryStream::PackedSize(this->CoordinateType);
+  nBytes += BinaryStream::PackedSize(this->NumPoints);
+  nBytes += BinaryStream::PackedSize(this->NumCells);
+  nBytes += BinaryStream::PackedSize(this->CellArraySize);
+  nBytes += BinaryStream::PackedSize(this->NumArrays);
+  nBytes += BinaryStream::PackedSize(this->NumGhostCells);
+  nBytes += BinaryStream::PackedSize(this->NumGhostNodes);
+  nBytes += BinaryStream::PackedSize(this->NumLevels);
+  nBytes += BinaryStream::PackedSize(this->StaticMesh);
+  nBytes += BinaryStream::PackedSize(this->ArrayName);
+  nBytes += BinaryStream::PackedSize(this->ArrayCentering);
+  nBytes += BinaryStream::PackedSize(this->ArrayComponents);
+  nBytes += BinaryStream::PackedSize(this->ArrayType);
+  nBytes += BinaryStream::PackedSize(this->ArrayRange);
+  nBytes += BinaryStream::PackedSize(this->BlockOwner);
+  nBytes += BinaryStream::PackedSize(this->BlockIds);
+  nBytes += BinaryStream::PackedSize(this->BlockNumPoints);
+  nBytes += BinaryStream::PackedSize(this->BlockNumCells);
+  nBytes += BinaryStream::PackedSize(this->BlockCellArraySize);
+  nBytes += BinaryStream::PackedSize(this->BlockExtents);
+  nBytes += BinaryStream::PackedSize(this->BlockBounds);
+  nBytes += BinaryStream::PackedSize(this->BlockArrayRange);
+  nBytes += BinaryStream::PackedSize(this->RefRatio);
+  nBytes += BinaryStream::PackedSize(this->BlocksPerLevel);
+  nBytes += BinaryStream::PackedSize(this->BlockLevel);
+  nBytes += BinaryStream::PackedSize(this->PeriodicBoundary);
+  nBytes += this->Flags.GetSerializedSize();
+  return nBytes;
+}
+
+// --------------------------------------------------------------------------
+int MeshMetadata::ToStream(sensei::BinaryStream &str, int encoding) const
+{
+  if (encoding == ENCODING_COMPACT)
+    return this->ToCompactStream(str);
+
+  if (encoding != ENCODING_VERBATIM)
+    {
+    SENSEI_ERROR("Invalid encoding " << encoding)
+    return -1;
+    }
+
+  // size the stream up front, for large block counts packing element
+  // by element would otherwise reallocate many times
+  str.Reserve(str.Size() + this->GetSerializedSize());
+
   str.Pack(this->GlobalView);
   str.Pack(this->MeshName);
   str.Pack(this->MeshType);
@@ -112,7 +538,62 @@ int MeshMetadata::ToStream(sensei::BinaryStream &str) const
 // --------------------------------------------------------------------------
 int MeshMetadata::FromStream(sensei::BinaryStream &str)
 {
-  str.Unpack(this->GlobalView);
+  return this->FromStream(str, nullptr);
+}
+
+// --------------------------------------------------------------------------
+int MeshMetadata::FromStream(sensei::BinaryStream &str,
+  const sensei::MeshMetadata *base)
+{
+  // the first byte is either the compact or delta header or the GlobalView
+  // flag
+  unsigned char head = 0;
+  str.Unpack(head);
+
+  if (head == DeltaMagic)
+    {
+    unsigned char version = 0;
+    str.Unpack(version);
+
+    if (version != DeltaVersion)
+      {
+      SENSEI_ERROR("Unsupported delta encoding version "
+        << int(version) << ". Expected " << int(DeltaVersion))
+      return -1;
+      }
+
+    if (!base)
+      {
+      SENSEI_ERROR("The stream holds the difference to an earlier"
+        " MeshMetadata which was not provided")
+      return -1;
+      }
+
+    return this->FromDeltaStream(str, *base);
+    }
+
+  if (head == CompactMagic)
+    {
+    unsigned char version = 0;
+    str.Unpack(version);
+
+    if (version != CompactVersion)
+      {
+      SENSEI_ERROR("Unsupported compact encoding version "
+        << int(version) << ". Expected " << int(CompactVersion))
+      return -1;
+      }
+
+    return this->FromCompactStream(str);
+    }
+
+  if (head > 1)
+    {
+    SENSEI_ERROR("Invalid MeshMetadata stream")
+    return -1;
+    }
+
+  this->GlobalView = head;
   str.Unpack(this->MeshName);
   str.Unpack(this->MeshType);
   str.Unpack(this->BlockType);
@@ -151,6 +632,214 @@ int MeshMetadata::FromStream(sensei::BinaryStream &str)
   return 0;
 }
 
+// --------------------------------------------------------------------------
+int MeshMetadata::ToCompactStream(sensei::BinaryStream &str) const
+{
+  str.Pack(CompactMagic);
+  str.Pack(CompactVersion);
+
+  str.Pack(this->GlobalView);
+  str.Pack(this->MeshName);
+  str.Pack(this->MeshType);
+  str.Pack(this->BlockType);
+  str.Pack(this->NumBlocks);
+  packDeltas(str, this->NumBlocksLocal);
+  str.Pack(this->Extent);
+  str.Pack(this->Bounds);
+  str.Pack(this->CoordinateType);
+  str.Pack(this->NumPoints);
+  str.Pack(this->NumCells);
+  str.Pack(this->CellArraySize);
+  str.Pack(this->NumArrays);
+  str.Pack(this->NumGhostCells);
+  str.Pack(this->NumGhostNodes);
+  str.Pack(this->NumLevels);
+  str.Pack(this->StaticMesh);
+  str.Pack(this->ArrayName);
+  packDeltas(str, this->ArrayCentering);
+  packDeltas(str, this->ArrayComponents);
+  packDeltas(str, this->ArrayType);
+  str.Pack(this->ArrayRange);
+  packDeltas(str, this->BlockOwner);
+  packDeltas(str, this->BlockIds);
+  packDeltas(str, this->BlockNumPoints);
+  packDeltas(str, this->BlockNumCells);
+  packDeltas(str, this->BlockCellArraySize);
+  packDeltas(str, this->BlockExtents);
+  str.Pack(this->BlockBounds);
+  str.Pack(this->BlockArrayRange);
+  packDeltas(str, this->RefRatio);
+  packDeltas(str, this->BlocksPerLevel);
+  packDeltas(str, this->BlockLevel);
+  str.Pack(this->PeriodicBoundary);
+  this->Flags.ToStream(str);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int MeshMetadata::FromCompactStream(sensei::BinaryStream &str)
+{
+  str.Unpack(this->GlobalView);
+  str.Unpack(this->MeshName);
+  str.Unpack(this->MeshType);
+  str.Unpack(this->BlockType);
+  str.Unpack(this->NumBlocks);
+  unpackDeltas(str, this->NumBlocksLocal);
+  str.Unpack(this->Extent);
+  str.Unpack(this->Bounds);
+  str.Unpack(this->CoordinateType);
+  str.Unpack(this->NumPoints);
+  str.Unpack(this->NumCells);
+  str.Unpack(this->CellArraySize);
+  str.Unpack(this->NumArrays);
+  str.Unpack(this->NumGhostCells);
+  str.Unpack(this->NumGhostNodes);
+  str.Unpack(this->NumLevels);
+  str.Unpack(this->StaticMesh);
+  str.Unpack(this->ArrayName);
+  unpackDeltas(str, this->ArrayCentering);
+  unpackDeltas(str, this->ArrayComponents);
+  unpackDeltas(str, this->ArrayType);
+  str.Unpack(this->ArrayRange);
+  unpackDeltas(str, this->BlockOwner);
+  unpackDeltas(str, this->BlockIds);
+  unpackDeltas(str, this->BlockNumPoints);
+  unpackDeltas(str, this->BlockNumCells);
+  unpackDeltas(str, this->BlockCellArraySize);
+  unpackDeltas(str, this->BlockExtents);
+  str.Unpack(this->BlockBounds);
+  str.Unpack(this->BlockArrayRange);
+  unpackDeltas(str, this->RefRatio);
+  unpackDeltas(str, this->BlocksPerLevel);
+  unpackDeltas(str, this->BlockLevel);
+  str.Unpack(this->PeriodicBoundary);
+  this->Flags.FromStream(str);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+bool MeshMetadata::IsDeltaStream(const sensei::BinaryStream &str)
+{
+  unsigned long pos = str.GetReadPos();
+  return (pos < str.Size()) && (str.GetData()[pos] == DeltaMagic);
+}
+
+// --------------------------------------------------------------------------
+int MeshMetadata::ToDeltaStream(sensei::BinaryStream &str,
+  const sensei::MeshMetadata &base) const
+{
+  // the fields are packed to a separate stream, since the mask of those
+  // that changed precedes them
+  sensei::BinaryStream fields;
+  unsigned long long mask = 0;
+  int field = 0;
+
+  packFieldDelta(fields, mask, field++, this->GlobalView, base.GlobalView);
+  packFieldDelta(fields, mask, field++, this->MeshName, base.MeshName);
+  packFieldDelta(fields, mask, field++, this->MeshType, base.MeshType);
+  packFieldDelta(fields, mask, field++, this->BlockType, base.BlockType);
+  packFieldDelta(fields, mask, field++, this->NumBlocks, base.NumBlocks);
+  packFieldDelta(fields, mask, field++, this->NumBlocksLocal, base.NumBlocksLocal);
+  packFieldDelta(fields, mask, field++, this->Extent, base.Extent);
+  packFieldDelta(fields, mask, field++, this->Bounds, base.Bounds);
+  packFieldDelta(fields, mask, field++, this->CoordinateType, base.CoordinateType);
+  packFieldDelta(fields, mask, field++, this->NumPoints, base.NumPoints);
+  packFieldDelta(fields, mask, field++, this->NumCells, base.NumCells);
+  packFieldDelta(fields, mask, field++, this->CellArraySize, base.CellArraySize);
+  packFieldDelta(fields, mask, field++, this->NumArrays, base.NumArrays);
+  packFieldDelta(fields, mask, field++, this->NumGhostCells, base.NumGhostCells);
+  packFieldDelta(fields, mask, field++, this->NumGhostNodes, base.NumGhostNodes);
+  packFieldDelta(fields, mask, field++, this->NumLevels, base.NumLevels);
+  packFieldDelta(fields, mask, field++, this->StaticMesh, base.StaticMesh);
+  packFieldDelta(fields, mask, field++, this->ArrayName, base.ArrayName);
+  packFieldDelta(fields, mask, field++, this->ArrayCentering, base.ArrayCentering);
+  packFieldDelta(fields, mask, field++, this->ArrayComponents, base.ArrayComponents);
+  packFieldDelta(fields, mask, field++, this->ArrayType, base.ArrayType);
+  packFieldDelta(fields, mask, field++, this->ArrayRange, base.ArrayRange);
+  packFieldDelta(fields, mask, field++, this->BlockOwner, base.BlockOwner);
+  packFieldDelta(fields, mask, field++, this->BlockIds, base.BlockIds);
+  packFieldDelta(fields, mask, field++, this->BlockNumPoints, base.BlockNumPoints);
+  packFieldDelta(fields, mask, field++, this->BlockNumCells, base.BlockNumCells);
+  packFieldDelta(fields, mask, field++, this->BlockCellArraySize, base.BlockCellArraySize);
+  packFieldDelta(fields, mask, field++, this->BlockExtents, base.BlockExtents);
+  packFieldDelta(fields, mask, field++, this->BlockBounds, base.BlockBounds);
+  packFieldDelta(fields, mask, field++, this->BlockArrayRange, base.BlockArrayRange);
+  packFieldDelta(fields, mask, field++, this->RefRatio, base.RefRatio);
+  packFieldDelta(fields, mask, field++, this->BlocksPerLevel, base.BlocksPerLevel);
+  packFieldDelta(fields, mask, field++, this->BlockLevel, base.BlockLevel);
+  packFieldDelta(fields, mask, field++, this->PeriodicBoundary, base.PeriodicBoundary);
+
+  if (!this->Flags.Contains(base.Flags) || !base.Flags.Contains(this->Flags))
+    {
+    mask |= 1ull << field;
+    this->Flags.ToStream(fields);
+    }
+
+  str.Pack(DeltaMagic);
+  str.Pack(DeltaVersion);
+  packVarint(str, mask);
+  str.Pack(fields.GetData(), fields.Size());
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int MeshMetadata::FromDeltaStream(sensei::BinaryStream &str,
+  const sensei::MeshMetadata &base)
+{
+  if (this != &base)
+    *this = base;
+
+  unsigned long long mask = unpackVarint(str);
+  int field = 0;
+
+  if (unpackFieldDelta(str, mask, field++, this->GlobalView) ||
+    unpackFieldDelta(str, mask, field++, this->MeshName) ||
+    unpackFieldDelta(str, mask, field++, this->MeshType) ||
+    unpackFieldDelta(str, mask, field++, this->BlockType) ||
+    unpackFieldDelta(str, mask, field++, this->NumBlocks) ||
+    unpackFieldDelta(str, mask, field++, this->NumBlocksLocal) ||
+    unpackFieldDelta(str, mask, field++, this->Extent) ||
+    unpackFieldDelta(str, mask, field++, this->Bounds) ||
+    unpackFieldDelta(str, mask, field++, this->CoordinateType) ||
+    unpackFieldDelta(str, mask, field++, this->NumPoints) ||
+    unpackFieldDelta(str, mask, field++, this->NumCells) ||
+    unpackFieldDelta(str, mask, field++, this->CellArraySize) ||
+    unpackFieldDelta(str, mask, field++, this->NumArrays) ||
+    unpackFieldDelta(str, mask, field++, this->NumGhostCells) ||
+    unpackFieldDelta(str, mask, field++, this->NumGhostNodes) ||
+    unpackFieldDelta(str, mask, field++, this->NumLevels) ||
+    unpackFieldDelta(str, mask, field++, this->StaticMesh) ||
+    unpackFieldDelta(str, mask, field++, this->ArrayName) ||
+    unpackFieldDelta(str, mask, field++, this->ArrayCentering) ||
+    unpackFieldDelta(str, mask, field++, this->ArrayComponents) ||
+    unpackFieldDelta(str, mask, field++, this->ArrayType) ||
+    unpackFieldDelta(str, mask, field++, this->ArrayRange) ||
+    unpackFieldDelta(str, mask, field++, this->BlockOwner) ||
+    unpackFieldDelta(str, mask, field++, this->BlockIds) ||
+    unpackFieldDelta(str, mask, field++, this->BlockNumPoints) ||
+    unpackFieldDelta(str, mask, field++, this->BlockNumCells) ||
+    unpackFieldDelta(str, mask, field++, this->BlockCellArraySize) ||
+    unpackFieldDelta(str, mask, field++, this->BlockExtents) ||
+    unpackFieldDelta(str, mask, field++, this->BlockBounds) ||
+    unpackFieldDelta(str, mask, field++, this->BlockArrayRange) ||
+    unpackFieldDelta(str, mask, field++, this->RefRatio) ||
+    unpackFieldDelta(str, mask, field++, this->BlocksPerLevel) ||
+    unpackFieldDelta(str, mask, field++, this->BlockLevel) ||
+    unpackFieldDelta(str, mask, field++, this->PeriodicBoundary))
+    {
+    SENSEI_ERROR("Failed to decode the MeshMetadata delta")
+    return -1;
+    }
+
+  if (mask & (1ull << field))
+    this->Flags.FromStream(str);
+
+  return 0;
+}
+
 // --------------------------------------------------------------------------
 int MeshMetadata::ToStream(ostream &str) const
 {
@@ -382,23 +1071,14 @@ int MeshMetadata::Validate(MPI_Comm comm, const MeshMetadataFlags &requiredFlags
 }
 
 // --------------------------------------------------------------------------
-int MeshMetadata::GlobalizeView(MPI_Comm comm)
+template <typename comm_t>
+int MeshMetadata::GlobalizeView(const comm_t &comm, MPI_Comm flatComm)
 {
-  TimeEvent<128> mark("MeshMetadata::GlobalizeView");
   if (!this->GlobalView)
     {
-    MPIUtils::GlobalViewV(comm, this->BlockOwner);
-    MPIUtils::GlobalViewV(comm, this->BlockIds);
-    MPIUtils::GlobalViewV(comm, this->NumBlocksLocal);
-    MPIUtils::GlobalViewV(comm, this->BlockNumPoints);
-    MPIUtils::GlobalViewV(comm, this->BlockNumCells);
-    MPIUtils::GlobalViewV(comm, this->BlockCellArraySize);
-    MPIUtils::GlobalViewV(comm, this->BlockExtents);
-    MPIUtils::GlobalViewV(comm, this->BlockBounds);
-    MPIUtils::GlobalViewV(comm, this->BlockArrayRange);
-    MPIUtils::GlobalViewV(comm, this->BlockLevel);
+    globalizeBlockFields(comm, this);
 
-    MPIUtils::GlobalCounts(comm, this->BlocksPerLevel);
+    MPIUtils::GlobalCounts(flatComm, this->BlocksPerLevel);
 
     STLUtils::ReduceRange(this->BlockBounds, this->Bounds);
     STLUtils::ReduceRange(this->BlockExtents, this->Extent);
@@ -415,6 +1095,191 @@ int MeshMetadata::GlobalizeView(MPI_Comm comm)
   return 0;
 }
 
+// --------------------------------------------------------------------------
+int MeshMetadata::GlobalizeView(MPI_Comm comm)
+{
+  CollectiveEvent mark(comm, "MeshMetadata::GlobalizeView");
+  return this->GlobalizeView(comm, comm);
+}
+
+// --------------------------------------------------------------------------
+int MeshMetadata::GlobalizeView(const MPIUtils::HierarchicalComm &comm)
+{
+  CollectiveEvent mark(comm.Comm, "MeshMetadata::GlobalizeView");
+  return this->GlobalizeView(comm, comm.Comm);
+}
+
+// --------------------------------------------------------------------------
+int MeshMetadata::GlobalizeDatasetView(MPI_Comm comm)
+{
+  CollectiveEvent mark(comm, "MeshMetadata::GlobalizeDatasetView");
+
+  if (this->GlobalView)
+    return 0;
+
+  // the number of blocks on each rank is small, and used to locate blocks
+  std::vector<int> numBlocksLocal;
+  MPIUtils::GlobalViewV(comm, this->NumBlocksLocal, numBlocksLocal);
+  this->NumBlocksLocal.swap(numBlocksLocal);
+
+  MPIUtils::GlobalCounts(comm, this->BlocksPerLevel);
+
+  this->NumBlocks = STLUtils::Sum(this->NumBlocksLocal);
+
+  // totals
+  std::array<long,3> sizes = {STLUtils::Sum(this->BlockNumPoints),
+    STLUtils::Sum(this->BlockNumCells), STLUtils::Sum(this->BlockCellArraySize)};
+
+  MPI_Allreduce(MPI_IN_PLACE, sizes.data(), 3, MPI_LONG, MPI_SUM, comm);
+
+  this->NumPoints = sizes[0];
+  this->NumCells = sizes[1];
+  this->CellArraySize = sizes[2];
+
+  // bounds and extents. the flags are used to decide what is reduced
+  // since they are the same on all ranks.
+  if (this->Flags.BlockBoundsSet())
+    MPIUtils::GlobalBounds(comm, this->BlockBounds, this->Bounds);
+
+  if (this->Flags.BlockExtentsSet())
+    MPIUtils::GlobalBounds(comm, this->BlockExtents, this->Extent);
+
+  // array ranges
+  if (this->Flags.BlockArrayRangeSet())
+    {
+    std::vector<std::array<double,2>> range(this->NumArrays);
+    STLUtils::InitializeRange(range);
+
+    unsigned long nBlocks = this->BlockArrayRange.size();
+    for (unsigned long i = 0; i < nBlocks; ++i)
+      STLUtils::ReduceRange(this->BlockArrayRange[i], range);
+
+    // so we can use MPI_MAX
+    for (int i = 0; i < this->NumArrays; ++i)
+      range[i][0] = -range[i][0];
+
+    MPI_Allreduce(MPI_IN_PLACE, range.data(), 2*this->NumArrays,
+      MPI_DOUBLE, MPI_MAX, comm);
+
+    for (int i = 0; i < this->NumArrays; ++i)
+      range[i][0] = -range[i][0];
+
+    this->ArrayRange.swap(range);
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int MeshMetadata::GetBlockMetadata(MPI_Comm comm,
+  const std::vector<int> &blockIds, MeshMetadataPtr &blocks)
+{
+  TimeEvent<128> mark("MeshMetadata::GetBlockMetadata");
+
+  // a copy of the dataset level information
+  MeshMetadataPtr base = MeshMetadata::New();
+  *base = *this;
+  base->ClearBlockInfo();
+
+  blocks = base->NewCopy();
+
+  // the local block index of each block id
+  std::map<int, int> localIds;
+  unsigned long nLocal = this->BlockIds.size();
+  for (unsigned long i = 0; i < nLocal; ++i)
+    localIds[this->BlockIds[i]] = i;
+
+  // everything is available
+  if (this->GlobalView)
+    {
+    unsigned long nIds = blockIds.size();
+    for (unsigned long i = 0; i < nIds; ++i)
+      {
+      std::map<int, int>::iterator it = localIds.find(blockIds[i]);
+      if (it != localIds.end())
+        blocks->CopyBlockInfo(*this, it->second);
+      }
+    return 0;
+    }
+
+  int nRanks = 1;
+  MPI_Comm_size(comm, &nRanks);
+
+  // share the requests
+  std::vector<long> reqCounts;
+  std::vector<long> reqOffset;
+  std::vector<int> reqIds;
+  MPIUtils::GlobalViewV(comm, blockIds, reqCounts, reqOffset, reqIds);
+
+  // package the requested blocks that are owned by this rank
+  std::vector<int> sendCounts(nRanks, 0);
+  std::vector<int> sendOffset(nRanks, 0);
+  BinaryStream sendBuf;
+
+  for (int r = 0; r < nRanks; ++r)
+    {
+    MeshMetadataPtr md;
+
+    const int *ids = reqIds.data() + reqOffset[r];
+    for (int i = 0; i < reqCounts[r]; ++i)
+      {
+      std::map<int, int>::iterator it = localIds.find(ids[i]);
+      if (it != localIds.end())
+        {
+        if (!md)
+          md = base->NewCopy();
+
+        md->CopyBlockInfo(*this, it->second);
+        }
+      }
+
+    sendOffset[r] = sendBuf.Size();
+
+    if (md)
+      md->ToStream(sendBuf, ENCODING_COMPACT);
+
+    sendCounts[r] = sendBuf.Size() - sendOffset[r];
+    }
+
+  // exchange
+  std::vector<int> recvCounts(nRanks, 0);
+  MPI_Alltoall(sendCounts.data(), 1, MPI_INT,
+    recvCounts.data(), 1, MPI_INT, comm);
+
+  std::vector<int> recvOffset(nRanks, 0);
+  int nBytes = 0;
+  for (int r = 0; r < nRanks; ++r)
+    {
+    recvOffset[r] = nBytes;
+    nBytes += recvCounts[r];
+    }
+
+  std::vector<unsigned char> recvBuf(nBytes);
+
+  MPI_Alltoallv(sendBuf.GetData(), sendCounts.data(), sendOffset.data(),
+    MPI_BYTE, recvBuf.data(), recvCounts.data(), recvOffset.data(),
+    MPI_BYTE, comm);
+
+  // unpack the blocks in place
+  for (int r = 0; r < nRanks; ++r)
+    {
+    if (recvCounts[r] == 0)
+      continue;
+
+    BinaryStream str;
+    str.SetExternalBuffer(recvBuf.data() + recvOffset[r], recvCounts[r]);
+
+    MeshMetadataPtr md = MeshMetadata::New();
+    md->FromStream(str);
+
+    int nBlocks = md->NumBlocks;
+    for (int i = 0; i < nBlocks; ++i)
+      blocks->CopyBlockInfo(*md, i);
+    }
+
+  return 0;
+}
+
 // --------------------------------------------------------------------------
 int MeshMetadata::ClearBlockInfo()
 {
@@ -449,50 +1314,56 @@ int MeshMetadata::ClearBlockInfo()
 
 // --------------------------------------------------------------------------
 int MeshMetadata::CopyBlockInfo(const MeshMetadataPtr &other, int i)
+{
+  return this->CopyBlockInfo(*other, i);
+}
+
+// --------------------------------------------------------------------------
+int MeshMetadata::CopyBlockInfo(const MeshMetadata &other, int i)
 {
   this->NumBlocks += 1;
 
-  if (other->BlockNumPoints.size())
+  if (other.BlockNumPoints.size())
     {
-    this->NumPoints += other->BlockNumPoints[i];
-    this->BlockNumPoints.push_back(other->BlockNumPoints[i]);
+    this->NumPoints += other.BlockNumPoints[i];
+    this->BlockNumPoints.push_back(other.BlockNumPoints[i]);
     }
 
-  if (other->BlockNumCells.size())
+  if (other.BlockNumCells.size())
     {
-    this->NumCells += other->BlockNumCells[i];
-    this->BlockNumCells.push_back(other->BlockNumCells[i]);
+    this->NumCells += other.BlockNumCells[i];
+    this->BlockNumCells.push_back(other.BlockNumCells[i]);
     }
 
-  if (other->BlockCellArraySize.size())
+  if (other.BlockCellArraySize.size())
     {
-    this->CellArraySize += other->BlockCellArraySize[i];
-    this->BlockCellArraySize.push_back(other->BlockCellArraySize[i]);
+    this->CellArraySize += other.BlockCellArraySize[i];
+    this->BlockCellArraySize.push_back(other.BlockCellArraySize[i]);
     }
 
-  if (other->BlockOwner.size())
-    this->BlockOwner.push_back(other->BlockOwner[i]);
+  if (other.BlockOwner.size())
+    this->BlockOwner.push_back(other.BlockOwner[i]);
 
-  if (other->BlockIds.size())
-    this->BlockIds.push_back(other->BlockIds[i]);
+  if (other.BlockIds.size())
+    this->BlockIds.push_back(other.BlockIds[i]);
 
-  if (other->BlockBounds.size())
+  if (other.BlockBounds.size())
     {
-    const std::array<double,6> &obi = other->BlockBounds[i];
+    const std::array<double,6> &obi = other.BlockBounds[i];
     this->BlockBounds.push_back(obi);
     STLUtils::ReduceRange(obi, this->Bounds);
     }
 
-  if (other->BlockExtents.size())
+  if (other.BlockExtents.size())
     {
-    const std::array<int,6> &obi = other->BlockExtents[i];
+    const std::array<int,6> &obi = other.BlockExtents[i];
     this->BlockExtents.push_back(obi);
     STLUtils::ReduceRange(obi, this->Extent);
     }
 
-  if (other->BlockArrayRange.size())
+  if (other.BlockArrayRange.size())
     {
-    const std::vector<std::array<double,2>> &obari = other->BlockArrayRange[i];
+    const std::vector<std::array<double,2>> &obari = other.BlockArrayRange[i];
     this->BlockArrayRange.push_back(obari);
     STLUtils::ReduceRange(obari, this->ArrayRange);
     }
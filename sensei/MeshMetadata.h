@@ -12,6 +12,8 @@
 
 namespace sensei
 {
+namespace MPIUtils { struct HierarchicalComm; }
+
 /// a set of flags describing which optional fields in the MeshMetadata structure
 /// should be generated.
 class MeshMetadataFlags
@@ -59,6 +61,12 @@ public:
   void ClearBlockArrayRange(){ Flags &= ~RANGE; }
   bool BlockArrayRangeSet() const { return Flags & RANGE; }
 
+  // check if all of the flags set in other are also set here, or
+  // set all of the flags that are set in other
+  bool Contains(const MeshMetadataFlags &other) const
+  { return (Flags & other.Flags) == other.Flags; }
+
+  void Merge(const MeshMetadataFlags &other){ Flags |= other.Flags; }
 
   /// serialize/deserialize for communication and/or I/O
   int ToStream(sensei::BinaryStream &str) const;
@@ -66,6 +74,9 @@ public:
 
   int ToStream(ostream &str) const;
 
+  // get the number of bytes ToStream adds to a sensei::BinaryStream
+  unsigned long GetSerializedSize() const;
+
 private:
   long long Flags;  // flags indicate which optional fields are needed
                     // some feilds are optional because they are costly
@@ -103,12 +114,43 @@ struct MeshMetadata
       return md;
   }
 
-  /// serialize/deserialize for communication and/or I/O
-  int ToStream(sensei::BinaryStream &str) const;
+  // encodings for serialization. ENCODING_VERBATIM packs each field as
+  // is. ENCODING_COMPACT packs integer block level fields as variable
+  // length, zig-zag encoded, differences between consecutive blocks. For
+  // regular decompositions, where ids, counts, and extents vary
+  // regularly from block to block, this shrinks them to about a byte per
+  // value. Compact streams begin with a versioned header.
+  enum { ENCODING_VERBATIM = 0, ENCODING_COMPACT = 1 };
+
+  /// serialize/deserialize for communication and/or I/O. FromStream
+  /// detects the encoding. a delta stream, see ToDeltaStream, is decoded
+  /// against base, which must be the metadata it was made from. it is an
+  /// error to decode one without.
+  int ToStream(sensei::BinaryStream &str,
+    int encoding = ENCODING_VERBATIM) const;
+
   int FromStream(sensei::BinaryStream &str);
+  int FromStream(sensei::BinaryStream &str, const sensei::MeshMetadata *base);
+
+  // serialize the difference to base, typically the metadata of the
+  // previous step. only the fields that differ are packed, vector fields
+  // as the elements that differ when fewer than half do. when the two are
+  // the same a few bytes are written. the stream begins with a versioned
+  // header, it can only be decoded with a copy of base
+  int ToDeltaStream(sensei::BinaryStream &str,
+    const sensei::MeshMetadata &base) const;
+
+  // return true if the stream, from its read position, was written by
+  // ToDeltaStream. the read position is left unchanged
+  static bool IsDeltaStream(const sensei::BinaryStream &str);
 
   int ToStream(ostream &str) const;
 
+  // get the number of bytes ToStream adds to a sensei::BinaryStream using
+  // the verbatim encoding. this is used to size the stream once rather
+  // than growing it while packing
+  unsigned long GetSerializedSize() const;
+
   // return true if the Flags match the arrays. will return false
   // if the a flag is set and a coresponding array is empty. an
   // error message will be printed naming the missing the array
@@ -124,15 +166,41 @@ struct MeshMetadata
     const sensei::MeshMetadataFlags &requiredFlags = 0xffffffffffffffff);
 
   // construct a global view of the metadata. return 0 if successful.
-  // this call uses MPI collectives
+  // this call uses MPI collectives over the communicator, which must not
+  // be used by another thread during the call
   int GlobalizeView(MPI_Comm);
 
+  // construct a global view of the metadata, gathering block level
+  // information to the node leaders first such that only the leaders
+  // communicate across nodes. see MPIUtils::HierarchicalComm. the result
+  // is identical to that of GlobalizeView(MPI_Comm).
+  int GlobalizeView(const MPIUtils::HierarchicalComm &comm);
+
+  // compute the global dataset level information, such as the number of
+  // blocks, points, and cells, the bounds, extent, and array ranges, while
+  // leaving the block level information distributed. The GlobalView flag
+  // is not set, since the block level arrays describe only the local
+  // blocks. Use GetBlockMetadata to fetch information about remote blocks
+  // on demand. this call uses MPI collectives
+  int GlobalizeDatasetView(MPI_Comm comm);
+
+  // collect the block level information of the blocks listed in blockIds
+  // from the ranks that own them. blocks is a copy of this instance
+  // holding only the requested blocks, ordered by the owning rank.
+  // dataset level totals in blocks describe the returned blocks. ids that
+  // are not found on any rank are ignored. this call uses MPI collectives
+  // and should be called with the local view. When the global view is
+  // already available no communication takes place.
+  int GetBlockMetadata(MPI_Comm comm, const std::vector<int> &blockIds,
+    sensei::MeshMetadataPtr &blocks);
+
   // removes all block level information from the instance. initialize
   // the related dataset level information.
   int ClearBlockInfo();
 
   // appends block level information of block bid from other.
   int CopyBlockInfo(const sensei::MeshMetadataPtr &other, int bid);
+  int CopyBlockInfo(const sensei::MeshMetadata &other, int bid);
 
   // metadata: the following metadata fields are available.  fields marked
   // "all" are required for all mesh types.  other fields may be required for
@@ -179,6 +247,8 @@ struct MeshMetadata
   std::vector<long> BlockCellArraySize;    // cell array size for each block (unstructured, optional)
 
                                                  // note: for AMR BlockExtents and BlockBounds are always global
+                                                 // note: for Cartesian meshes BlockExtents, Extent and the number of ghost
+                                                 // layers describe the ghost zones, see VTKUtils::GetInteriorRange
   std::vector<std::array<int,6>> BlockExtents;   // index space extent of each block [i0,i1, j0,j1, k0,k1] (Cartesian, AMR, optional)
   std::vector<std::array<double,6>> BlockBounds; // bounds of each block [x0,x1, y0,y1, z0,z1] (all, optional)
 
@@ -197,6 +267,21 @@ struct MeshMetadata
                                     // side.
 
 protected:
+  // implement the compact encoding. FromCompactStream is called after
+  // the header has been read
+  int ToCompactStream(sensei::BinaryStream &str) const;
+  int FromCompactStream(sensei::BinaryStream &str);
+
+  // apply a delta stream to base. FromDeltaStream is called after the
+  // header has been read
+  int FromDeltaStream(sensei::BinaryStream &str,
+    const sensei::MeshMetadata &base);
+
+  // implements GlobalizeView for either type of communicator. flatComm is
+  // used for reductions
+  template <typename comm_t>
+  int GlobalizeView(const comm_t &comm, MPI_Comm flatComm);
+
   MeshMetadata() : GlobalView(false), MeshName(),
     MeshType(VTK_MULTIBLOCK_DATA_SET), BlockType(VTK_DATA_SET), NumBlocks(0),
     NumBlocksLocal(), Extent(), Bounds(), CoordinateType(VTK_DOUBLE),
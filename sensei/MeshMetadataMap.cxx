@@ -16,14 +16,15 @@ int MeshMetadataMap::Initialize(DataAdaptor *da, MeshMetadataFlags flags)
     return -1;
     }
 
+  this->Adaptor = da;
+  this->Flags = flags;
+
   this->Metadata.resize(nMeshes);
 
   for (unsigned int i = 0; i < nMeshes; ++i)
     {
-    MeshMetadataPtr md = MeshMetadata::New();
-    md->Flags = flags;
-
-    if (da->GetMeshMetadata(i, md))
+    MeshMetadataPtr md;
+    if (da->GetCachedMeshMetadata(i, flags, false, md))
       {
       SENSEI_ERROR("Failed to get metadata for data object " << i)
       return -1;
@@ -69,6 +70,8 @@ void MeshMetadataMap::PushBack(MeshMetadataPtr &md)
 // --------------------------------------------------------------------------
 void MeshMetadataMap::Clear()
 {
+  this->Adaptor = nullptr;
+  this->Flags = MeshMetadataFlags();
   this->Metadata.clear();
   this->IdMap.clear();
 }
@@ -112,4 +115,27 @@ int MeshMetadataMap::GetMeshMetadata(unsigned int id, MeshMetadataPtr &md)
   return 0;
 }
 
+// --------------------------------------------------------------------------
+int MeshMetadataMap::GetGlobalMeshMetadata(const std::string &name,
+  MeshMetadataPtr &md)
+{
+  unsigned int id = 0;
+  if (this->GetMeshId(name, id))
+    return -1;
+
+  if (!this->Adaptor)
+    {
+    SENSEI_ERROR("The map was not initialized from a data adaptor")
+    return -1;
+    }
+
+  if (this->Adaptor->GetCachedMeshMetadata(id, this->Flags, true, md))
+    {
+    SENSEI_ERROR("Failed to get the global view of mesh \"" << name << "\"")
+    return -1;
+    }
+
+  return 0;
+}
+
 }
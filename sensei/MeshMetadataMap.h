@@ -16,8 +16,11 @@ class DataAdaptor;
 class MeshMetadataMap
 {
 public:
+  MeshMetadataMap() : Adaptor(nullptr) {}
+
   // initialize the map by getting metadata for all of the
-  // meshes provided by the simulation.
+  // meshes provided by the simulation. metadata of static meshes
+  // is reused from earlier steps, see DataAdaptor::GetCachedMeshMetadata
   int Initialize(DataAdaptor *da, MeshMetadataFlags flags = MeshMetadataFlags());
 
   void PushBack(MeshMetadataPtr &md);
@@ -38,7 +41,16 @@ public:
   int GetMeshMetadata(unsigned int i, MeshMetadataPtr &md);
   int SetMeshMetadata(unsigned int i, MeshMetadataPtr &md);
 
+  // get a global view of the named object's metadata. this uses MPI
+  // collectives unless the mesh is static and the global view was already
+  // generated. only available after Initialize.
+  int GetGlobalMeshMetadata(const std::string &name, MeshMetadataPtr &md);
+
 private:
+  // the adaptor and flags passed to Initialize
+  DataAdaptor *Adaptor;
+  MeshMetadataFlags Flags;
+
   // a vector of metadata for each data object provided by
   // the simulation
   std::vector<MeshMetadataPtr> Metadata;
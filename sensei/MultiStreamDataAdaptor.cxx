@@ -0,0 +1,649 @@
+#include "MultiStreamDataAdaptor.h"
+#include "ConfigurableInTransitDataAdaptor.h"
+#include "DataRequirements.h"
+#include "MeshMetadata.h"
+#include "XMLUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <pugixml.hpp>
+
+#include <vtkDataObject.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sensei
+{
+
+using StreamAdaptorPtr = vtkSmartPointer<ConfigurableInTransitDataAdaptor>;
+
+struct MultiStreamDataAdaptor::InternalsType
+{
+  InternalsType() : Threaded(false), StepCount(0) {}
+
+  struct Stream
+  {
+    Stream() : Every(1), Open(false) {}
+
+    std::string Name;
+    StreamAdaptorPtr Adaptor;
+    unsigned int Every;
+    bool Open;
+  };
+
+  // apply the function to the selected streams, concurrently when
+  // permitted. returns non-zero if any call failed
+  int ForEach(const std::vector<bool> &selected,
+    const std::function<int(Stream&)> &func);
+
+  // the qualified name of a stream's mesh
+  static std::string QualifiedName(const std::string &stream,
+    const std::string &meshName)
+  { return stream + ":" + meshName; }
+
+  std::vector<Stream> Streams;
+
+  // the stream and the stream's id of each of the listed meshes
+  std::vector<std::pair<unsigned int, unsigned int>> MeshIds;
+
+  bool Threaded;
+  unsigned long StepCount;
+};
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::InternalsType::ForEach(
+  const std::vector<bool> &selected, const std::function<int(Stream&)> &func)
+{
+  unsigned int nStreams = this->Streams.size();
+  std::vector<int> ierr(nStreams, 0);
+
+  if (this->Threaded)
+    {
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < nStreams; ++i)
+      {
+      if (!selected[i])
+        continue;
+
+      threads.emplace_back([this, &func, &ierr, i]()
+        { ierr[i] = func(this->Streams[i]); });
+      }
+
+    unsigned int nThreads = threads.size();
+    for (unsigned int i = 0; i < nThreads; ++i)
+      threads[i].join();
+    }
+  else
+    {
+    for (unsigned int i = 0; i < nStreams; ++i)
+      {
+      if (selected[i])
+        ierr[i] = func(this->Streams[i]);
+      }
+    }
+
+  int status = 0;
+  for (unsigned int i = 0; i < nStreams; ++i)
+    {
+    if (ierr[i] < 0)
+      status = -1;
+    else if (ierr[i] && !status)
+      status = ierr[i];
+    }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+senseiNewMacro(MultiStreamDataAdaptor);
+
+//----------------------------------------------------------------------------
+MultiStreamDataAdaptor::MultiStreamDataAdaptor() :
+  Internals(new InternalsType)
+{
+}
+
+//----------------------------------------------------------------------------
+MultiStreamDataAdaptor::~MultiStreamDataAdaptor()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::Initialize(pugi::xml_node &parent)
+{
+  TimeEvent<128> mark("MultiStreamDataAdaptor::Initialize");
+
+  this->Internals->Streams.clear();
+  this->Internals->MeshIds.clear();
+
+  std::set<std::string> names;
+  for (pugi::xml_node node = parent.child("transport"); node;
+    node = node.next_sibling("transport"))
+    {
+    if (XMLUtils::RequireAttribute(node, "name"))
+      {
+      SENSEI_ERROR("Each of several transport elements must be named")
+      return -1;
+      }
+
+    InternalsType::Stream stream;
+    stream.Name = node.attribute("name").value();
+    stream.Every = std::max(1u, node.attribute("every").as_uint(1));
+
+    if (stream.Name.find(':') != std::string::npos)
+      {
+      SENSEI_ERROR("The stream name \"" << stream.Name
+        << "\" may not contain a ':'")
+      return -1;
+      }
+
+    if (!names.insert(stream.Name).second)
+      {
+      SENSEI_ERROR("The stream name \"" << stream.Name << "\" is not unique")
+      return -1;
+      }
+
+    // each stream communicates over its own duplicate of the communicator
+    stream.Adaptor = StreamAdaptorPtr::New();
+    stream.Adaptor->SetCommunicator(this->GetCommunicator());
+    if (stream.Adaptor->InitializeTransport(node))
+      {
+      SENSEI_ERROR("Failed to initialize stream \"" << stream.Name << "\"")
+      return -1;
+      }
+
+    this->Internals->Streams.push_back(stream);
+    }
+
+  if (this->Internals->Streams.empty())
+    {
+    SENSEI_ERROR("No transport elements found")
+    return -1;
+    }
+
+  // concurrent collectives on distinct communicators from several threads
+  int threadLevel = MPI_THREAD_SINGLE;
+  MPI_Query_thread(&threadLevel);
+  this->Internals->Threaded = threadLevel >= MPI_THREAD_MULTIPLE;
+
+  if (!this->Internals->Threaded)
+    SENSEI_WARNING("Multiplexing streams on threads requires"
+      " MPI_THREAD_MULTIPLE. The streams will be advanced in turn")
+
+  SENSEI_STATUS("Configured MultiStreamDataAdaptor with "
+    << this->Internals->Streams.size() << " streams")
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+unsigned int MultiStreamDataAdaptor::GetNumberOfStreams()
+{
+  return this->Internals->Streams.size();
+}
+
+//----------------------------------------------------------------------------
+std::string MultiStreamDataAdaptor::GetStreamName(unsigned int id)
+{
+  if (id >= this->Internals->Streams.size())
+    {
+    SENSEI_ERROR("Stream id " << id << " is out of bounds")
+    return std::string();
+    }
+
+  return this->Internals->Streams[id].Name;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::SplitMeshName(const std::string &qualifiedName,
+  unsigned int &stream, std::string &meshName)
+{
+  size_t pos = qualifiedName.find(':');
+  if (pos != std::string::npos)
+    {
+    std::string streamName = qualifiedName.substr(0, pos);
+
+    unsigned int nStreams = this->Internals->Streams.size();
+    for (unsigned int i = 0; i < nStreams; ++i)
+      {
+      if (this->Internals->Streams[i].Name == streamName)
+        {
+        stream = i;
+        meshName = qualifiedName.substr(pos + 1);
+        return 0;
+        }
+      }
+    }
+
+  SENSEI_ERROR("\"" << qualifiedName << "\" does not name a mesh of a stream."
+    " Mesh names take the form \"<stream>:<mesh>\"")
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::UpdateMeshes()
+{
+  this->Internals->MeshIds.clear();
+
+  bool haveTime = false;
+  unsigned int nStreams = this->Internals->Streams.size();
+  for (unsigned int i = 0; i < nStreams; ++i)
+    {
+    InternalsType::Stream &stream = this->Internals->Streams[i];
+    if (!stream.Open)
+      continue;
+
+    unsigned int nMeshes = 0;
+    if (stream.Adaptor->GetNumberOfMeshes(nMeshes))
+      {
+      SENSEI_ERROR("Failed to get the number of meshes of stream \""
+        << stream.Name << "\"")
+      return -1;
+      }
+
+    for (unsigned int j = 0; j < nMeshes; ++j)
+      this->Internals->MeshIds.push_back(std::make_pair(i, j));
+
+    if (!haveTime)
+      {
+      this->SetDataTime(stream.Adaptor->GetDataTime());
+      this->SetDataTimeStep(stream.Adaptor->GetDataTimeStep());
+      haveTime = true;
+      }
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::GetLocalMeshId(unsigned int id,
+  unsigned int &stream, unsigned int &localId)
+{
+  if (id >= this->Internals->MeshIds.size())
+    {
+    SENSEI_ERROR("Mesh id " << id << " is out of bounds")
+    return -1;
+    }
+
+  stream = this->Internals->MeshIds[id].first;
+  localId = this->Internals->MeshIds[id].second;
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::GetSenderMeshMetadata(unsigned int id,
+  MeshMetadataPtr &metadata)
+{
+  unsigned int stream = 0;
+  unsigned int localId = 0;
+  if (this->GetLocalMeshId(id, stream, localId))
+    return -1;
+
+  InternalsType::Stream &s = this->Internals->Streams[stream];
+  if (s.Adaptor->GetSenderMeshMetadata(localId, metadata))
+    return -1;
+
+  // the stream may hand out metadata it owns, qualify a copy
+  metadata = metadata->NewCopy();
+  metadata->MeshName = InternalsType::QualifiedName(s.Name, metadata->MeshName);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::GetReceiverMeshMetadata(unsigned int id,
+  MeshMetadataPtr &metadata)
+{
+  unsigned int stream = 0;
+  unsigned int localId = 0;
+  if (this->GetLocalMeshId(id, stream, localId))
+    return -1;
+
+  InternalsType::Stream &s = this->Internals->Streams[stream];
+  if (s.Adaptor->GetReceiverMeshMetadata(localId, metadata))
+    return -1;
+
+  // the stream may hand out metadata it owns, qualify a copy
+  metadata = metadata->NewCopy();
+  metadata->MeshName = InternalsType::QualifiedName(s.Name, metadata->MeshName);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::SetReceiverMeshMetadata(unsigned int id,
+  MeshMetadataPtr &metadata)
+{
+  unsigned int stream = 0;
+  unsigned int localId = 0;
+  if (this->GetLocalMeshId(id, stream, localId))
+    return -1;
+
+  InternalsType::Stream &s = this->Internals->Streams[stream];
+
+  // the stream knows the mesh by its own name
+  MeshMetadataPtr md = metadata->NewCopy();
+
+  std::string prefix = InternalsType::QualifiedName(s.Name, "");
+  if (md->MeshName.compare(0, prefix.size(), prefix) == 0)
+    md->MeshName = md->MeshName.substr(prefix.size());
+
+  return s.Adaptor->SetReceiverMeshMetadata(localId, md);
+}
+
+//----------------------------------------------------------------------------
+void MultiStreamDataAdaptor::SetPartitioner(const sensei::PartitionerPtr &partitioner)
+{
+  unsigned int nStreams = this->Internals->Streams.size();
+  for (unsigned int i = 0; i < nStreams; ++i)
+    this->Internals->Streams[i].Adaptor->SetPartitioner(partitioner);
+}
+
+//----------------------------------------------------------------------------
+sensei::PartitionerPtr MultiStreamDataAdaptor::GetPartitioner()
+{
+  if (this->Internals->Streams.empty())
+    return this->InTransitDataAdaptor::GetPartitioner();
+
+  return this->Internals->Streams[0].Adaptor->GetPartitioner();
+}
+
+//----------------------------------------------------------------------------
+void MultiStreamDataAdaptor::SetDataRequirements(const DataRequirements &reqs)
+{
+  this->InTransitDataAdaptor::SetDataRequirements(reqs);
+
+  unsigned int nStreams = this->Internals->Streams.size();
+  std::vector<DataRequirements> streamReqs(nStreams);
+
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+
+  for (; mit; ++mit)
+    {
+    unsigned int stream = 0;
+    std::string meshName;
+    if (this->SplitMeshName(mit.MeshName(), stream, meshName))
+      continue;
+
+    streamReqs[stream].AddRequirement(meshName, mit.StructureOnly());
+    streamReqs[stream].SetMaxLevel(meshName, reqs.GetMaxLevel(mit.MeshName()));
+
+    ArrayRequirementsIterator ait =
+      reqs.GetArrayRequirementsIterator(mit.MeshName());
+
+    ait.SetMode(ArrayRequirementsIterator::MODE_ASSOCIATION);
+
+    for (; ait; ++ait)
+      streamReqs[stream].AddRequirement(meshName, ait.Association(), ait.Arrays());
+    }
+
+  for (unsigned int i = 0; i < nStreams; ++i)
+    this->Internals->Streams[i].Adaptor->SetDataRequirements(streamReqs[i]);
+}
+
+//----------------------------------------------------------------------------
+void MultiStreamDataAdaptor::SetStepPolicy(int policy, unsigned int count)
+{
+  this->InTransitDataAdaptor::SetStepPolicy(policy, count);
+
+  unsigned int nStreams = this->Internals->Streams.size();
+  for (unsigned int i = 0; i < nStreams; ++i)
+    this->Internals->Streams[i].Adaptor->SetStepPolicy(policy, count);
+}
+
+//----------------------------------------------------------------------------
+void MultiStreamDataAdaptor::GetStepCounters(unsigned long &numProcessed,
+  unsigned long &numSkipped) const
+{
+  numProcessed = 0;
+  numSkipped = 0;
+
+  unsigned int nStreams = this->Internals->Streams.size();
+  for (unsigned int i = 0; i < nStreams; ++i)
+    {
+    unsigned long nProcessed = 0;
+    unsigned long nSkipped = 0;
+    this->Internals->Streams[i].Adaptor->GetStepCounters(nProcessed, nSkipped);
+    numProcessed += nProcessed;
+    numSkipped += nSkipped;
+    }
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::PostResult(const std::string &tag,
+  const std::string &result)
+{
+  int ierr = 0;
+
+  unsigned int nStreams = this->Internals->Streams.size();
+  for (unsigned int i = 0; i < nStreams; ++i)
+    {
+    if (this->Internals->Streams[i].Adaptor->PostResult(tag, result))
+      {
+      SENSEI_ERROR("Failed to post result \"" << tag << "\" to stream \""
+        << this->Internals->Streams[i].Name << "\"")
+      ierr = -1;
+      }
+    }
+
+  return ierr;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::OpenStream()
+{
+  TimeEvent<128> mark("MultiStreamDataAdaptor::OpenStream");
+
+  // the streams are opened concurrently since each may wait on its sender
+  std::vector<bool> all(this->Internals->Streams.size(), true);
+  if (this->Internals->ForEach(all, [](InternalsType::Stream &stream) -> int
+    {
+    if (stream.Adaptor->OpenStream())
+      {
+      SENSEI_ERROR("Failed to open stream \"" << stream.Name << "\"")
+      return -1;
+      }
+    stream.Open = true;
+    return 0;
+    }))
+    return -1;
+
+  this->Internals->StepCount = 0;
+
+  return this->UpdateMeshes();
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::AdvanceStream()
+{
+  TimeEvent<128> mark("MultiStreamDataAdaptor::AdvanceStream");
+
+  this->Internals->StepCount += 1;
+
+  unsigned int nStreams = this->Internals->Streams.size();
+  std::vector<bool> due(nStreams, false);
+  for (unsigned int i = 0; i < nStreams; ++i)
+    {
+    InternalsType::Stream &stream = this->Internals->Streams[i];
+    due[i] = stream.Open && ((this->Internals->StepCount % stream.Every) == 0);
+    }
+
+  // a stream that reaches its end is closed and its meshes are dropped
+  this->Internals->ForEach(due, [](InternalsType::Stream &stream) -> int
+    {
+    if (stream.Adaptor->AdvanceStream())
+      {
+      stream.Adaptor->CloseStream();
+      stream.Open = false;
+      }
+    return 0;
+    });
+
+  bool anyOpen = false;
+  for (unsigned int i = 0; i < nStreams; ++i)
+    anyOpen |= this->Internals->Streams[i].Open;
+
+  if (!anyOpen)
+    return 1;
+
+  return this->UpdateMeshes();
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::StreamGood()
+{
+  unsigned int nStreams = this->Internals->Streams.size();
+  for (unsigned int i = 0; i < nStreams; ++i)
+    {
+    if (this->Internals->Streams[i].Open)
+      return 1;
+    }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::CloseStream()
+{
+  TimeEvent<128> mark("MultiStreamDataAdaptor::CloseStream");
+
+  unsigned int nStreams = this->Internals->Streams.size();
+  std::vector<bool> open(nStreams, false);
+  for (unsigned int i = 0; i < nStreams; ++i)
+    open[i] = this->Internals->Streams[i].Open;
+
+  int ierr = this->Internals->ForEach(open,
+    [](InternalsType::Stream &stream) -> int
+    {
+    stream.Open = false;
+    return stream.Adaptor->CloseStream();
+    });
+
+  this->Internals->MeshIds.clear();
+
+  return ierr ? -1 : 0;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::Finalize()
+{
+  TimeEvent<128> mark("MultiStreamDataAdaptor::Finalize");
+
+  int ierr = 0;
+  unsigned int nStreams = this->Internals->Streams.size();
+  for (unsigned int i = 0; i < nStreams; ++i)
+    {
+    if (this->Internals->Streams[i].Adaptor->Finalize())
+      ierr = -1;
+    }
+
+  return ierr;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::GetNumberOfMeshes(unsigned int &numMeshes)
+{
+  numMeshes = this->Internals->MeshIds.size();
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::GetMeshMetadata(unsigned int id,
+  MeshMetadataPtr &metadata)
+{
+  unsigned int stream = 0;
+  unsigned int localId = 0;
+  if (this->GetLocalMeshId(id, stream, localId))
+    return -1;
+
+  InternalsType::Stream &s = this->Internals->Streams[stream];
+  if (s.Adaptor->GetMeshMetadata(localId, metadata))
+    {
+    SENSEI_ERROR("Failed to get metadata for mesh " << localId
+      << " of stream \"" << s.Name << "\"")
+    return -1;
+    }
+
+  // the stream may hand out metadata it owns, qualify a copy
+  metadata = metadata->NewCopy();
+  metadata->MeshName = InternalsType::QualifiedName(s.Name, metadata->MeshName);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::GetMesh(const std::string &meshName,
+  bool structureOnly, vtkDataObject *&mesh)
+{
+  unsigned int stream = 0;
+  std::string streamMeshName;
+  if (this->SplitMeshName(meshName, stream, streamMeshName))
+    return -1;
+
+  return this->Internals->Streams[stream].Adaptor->GetMesh(streamMeshName,
+    structureOnly, mesh);
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::AddGhostNodesArray(vtkDataObject *mesh,
+  const std::string &meshName)
+{
+  unsigned int stream = 0;
+  std::string streamMeshName;
+  if (this->SplitMeshName(meshName, stream, streamMeshName))
+    return -1;
+
+  return this->Internals->Streams[stream].Adaptor->AddGhostNodesArray(mesh,
+    streamMeshName);
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::AddGhostCellsArray(vtkDataObject *mesh,
+  const std::string &meshName)
+{
+  unsigned int stream = 0;
+  std::string streamMeshName;
+  if (this->SplitMeshName(meshName, stream, streamMeshName))
+    return -1;
+
+  return this->Internals->Streams[stream].Adaptor->AddGhostCellsArray(mesh,
+    streamMeshName);
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::AddArray(vtkDataObject* mesh,
+  const std::string &meshName, int association, const std::string &arrayName)
+{
+  unsigned int stream = 0;
+  std::string streamMeshName;
+  if (this->SplitMeshName(meshName, stream, streamMeshName))
+    return -1;
+
+  return this->Internals->Streams[stream].Adaptor->AddArray(mesh,
+    streamMeshName, association, arrayName);
+}
+
+//----------------------------------------------------------------------------
+int MultiStreamDataAdaptor::ReleaseData()
+{
+  int ierr = 0;
+  unsigned int nStreams = this->Internals->Streams.size();
+  for (unsigned int i = 0; i < nStreams; ++i)
+    {
+    InternalsType::Stream &stream = this->Internals->Streams[i];
+    if (stream.Open && stream.Adaptor->ReleaseData())
+      ierr = -1;
+    }
+  return ierr;
+}
+
+}
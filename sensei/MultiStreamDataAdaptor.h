@@ -0,0 +1,124 @@
+#ifndef sensei_MultiStreamDataAdaptor_h
+#define sensei_MultiStreamDataAdaptor_h
+
+#include "InTransitDataAdaptor.h"
+
+#include <string>
+
+namespace pugi { class xml_node; }
+
+namespace sensei
+{
+
+/// @class MultiStreamDataAdaptor
+/// @brief Presents several in transit streams to the analyses as one.
+///
+/// Each stream is read by its own ConfigurableInTransitDataAdaptor, with
+/// its own transport, partitioner, step policy and prefetch settings. The
+/// meshes of all streams are served together. Their names are qualified
+/// by the stream's name, "<stream>:<mesh>", and analyses reference them
+/// this way. The data requirements are split among the streams by the
+/// same names.
+///
+/// Each call to AdvanceStream moves the streams that are due forward.
+/// When MPI_THREAD_MULTIPLE is available each stream is moved on its own
+/// thread, over its own communicator, so that a stream waiting on its
+/// sender does not hold up the others. A stream whose every attribute is
+/// n is advanced on every n'th step only, for senders that provide data
+/// at a lower cadence. Until then its last step remains visible. Once a
+/// stream ends its meshes are no longer listed, the adaptor reaches the
+/// end when all streams have ended. The time and time step are those of
+/// the first stream that has not ended.
+///
+/// ConfigurableInTransitDataAdaptor makes use of this class when the
+/// configuration holds more than one transport element, each then needs
+/// a unique name attribute:
+///
+/// <sensei>
+///   <transport name="fluid" type="adios2" filename="fluid.bp">
+///     <partitioner type="block"/>
+///   </transport>
+///   <transport name="particles" type="mpi" filename="particles_port" every="10"/>
+/// </sensei>
+///
+/// The streams are configured by XML only, the connection info is not
+/// forwarded to them.
+class MultiStreamDataAdaptor : public sensei::InTransitDataAdaptor
+{
+public:
+  static MultiStreamDataAdaptor* New();
+  senseiTypeMacro(MultiStreamDataAdaptor, sensei::InTransitDataAdaptor);
+
+  /// Initialize from the parent of the transport elements
+  int Initialize(pugi::xml_node &parent) override;
+
+  /// get the number of streams and their names
+  unsigned int GetNumberOfStreams();
+  std::string GetStreamName(unsigned int id);
+
+  /// split a qualified mesh name into the stream's and the mesh's. returns
+  /// non-zero if there is no such stream
+  int SplitMeshName(const std::string &qualifiedName, unsigned int &stream,
+    std::string &meshName);
+
+  /// SENSEI InTransitDataAdaptor control API
+  int GetSenderMeshMetadata(unsigned int id, MeshMetadataPtr &metadata) override;
+  int GetReceiverMeshMetadata(unsigned int id, MeshMetadataPtr &metadata) override;
+  int SetReceiverMeshMetadata(unsigned int id, MeshMetadataPtr &metadata) override;
+
+  void SetPartitioner(const sensei::PartitionerPtr &partitioner) override;
+  sensei::PartitionerPtr GetPartitioner() override;
+
+  void SetDataRequirements(const sensei::DataRequirements &reqs) override;
+
+  void SetStepPolicy(int policy, unsigned int count = 1) override;
+
+  void GetStepCounters(unsigned long &numProcessed,
+    unsigned long &numSkipped) const override;
+
+  /// the result is posted to each of the streams
+  int PostResult(const std::string &tag, const std::string &result) override;
+
+  int OpenStream() override;
+  int CloseStream() override;
+  int AdvanceStream() override;
+  int StreamGood() override;
+  int Finalize() override;
+
+  /// SENSEI DataAdaptor API
+  int GetNumberOfMeshes(unsigned int &numMeshes) override;
+  int GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadata) override;
+
+  int GetMesh(const std::string &meshName, bool structureOnly,
+    vtkDataObject *&mesh) override;
+
+  int AddGhostNodesArray(vtkDataObject* mesh, const std::string &meshName) override;
+  int AddGhostCellsArray(vtkDataObject* mesh, const std::string &meshName) override;
+
+  int AddArray(vtkDataObject* mesh, const std::string &meshName,
+    int association, const std::string &arrayName) override;
+
+  int ReleaseData() override;
+
+protected:
+  MultiStreamDataAdaptor();
+  ~MultiStreamDataAdaptor();
+
+  // list the meshes of the open streams and update the time
+  int UpdateMeshes();
+
+  // map a mesh id onto a stream and the stream's mesh id
+  int GetLocalMeshId(unsigned int id, unsigned int &stream,
+    unsigned int &localId);
+
+private:
+  struct InternalsType;
+  InternalsType *Internals;
+
+  MultiStreamDataAdaptor(const MultiStreamDataAdaptor&) = delete;
+  void operator=(const MultiStreamDataAdaptor&) = delete;
+};
+
+}
+
+#endif
@@ -0,0 +1,303 @@
+#include "NodeAggregator.h"
+#include "MPISchema.h"
+#include "BinaryStream.h"
+#include "VTKUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCompositeDataSet.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkDataSet.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkPointData.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+
+#include <cstring>
+
+namespace
+{
+// serialize the arrays of a block's point or cell attributes
+int packArrays(vtkDataSetAttributes *dsa, sensei::BinaryStream &bs)
+{
+  int nArrays = 0;
+  int nIn = dsa ? dsa->GetNumberOfArrays() : 0;
+  for (int i = 0; i < nIn; ++i)
+    {
+    if (dsa->GetArray(i))
+      ++nArrays;
+    }
+
+  bs.Pack(nArrays);
+
+  for (int i = 0; i < nIn; ++i)
+    {
+    vtkDataArray *da = dsa->GetArray(i);
+    if (da && senseiMPI::PackArray(da, bs))
+      return -1;
+    }
+
+  return 0;
+}
+
+// construct the arrays serialized by packArrays
+int unpackArrays(sensei::BinaryStream &bs, vtkDataSetAttributes *dsa)
+{
+  int nArrays = 0;
+  bs.Unpack(nArrays);
+
+  for (int i = 0; i < nArrays; ++i)
+    {
+    vtkDataArray *da = nullptr;
+    if (senseiMPI::UnpackArray(bs, da))
+      return -1;
+
+    dsa->AddArray(da);
+    da->Delete();
+    }
+
+  return 0;
+}
+}
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+int NodeAggregator::Initialize(MPI_Comm comm)
+{
+  TimeEvent<128> mark("NodeAggregator::Initialize");
+
+  this->Comm.Initialize(comm);
+
+  // find the node of each rank
+  int nodeId = this->Comm.NodeId;
+  int numNodes = this->Comm.NodeSize.size();
+
+  MPI_Bcast(&nodeId, 1, MPI_INT, 0, this->Comm.Node);
+  MPI_Bcast(&numNodes, 1, MPI_INT, 0, this->Comm.Node);
+
+  int nRanks = 1;
+  MPI_Comm_size(comm, &nRanks);
+
+  this->NumNodes = numNodes;
+  this->RankNode.resize(nRanks);
+
+  MPI_Allgather(&nodeId, 1, MPI_INT, this->RankNode.data(), 1, MPI_INT, comm);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int NodeAggregator::Gather(const MeshMetadataPtr &md,
+  vtkCompositeDataSet *mesh, MeshMetadataPtr &leaderMd,
+  vtkCompositeDataSet *&leaderMesh)
+{
+  TimeEvent<128> mark("NodeAggregator::Gather");
+
+  leaderMd = nullptr;
+  leaderMesh = nullptr;
+
+  if (!this->Initialized())
+    {
+    SENSEI_ERROR("The aggregator was not initialized")
+    return -1;
+    }
+
+  if (VTKUtils::AMR(md))
+    {
+    SENSEI_ERROR("Node aggregation of AMR mesh \"" << md->MeshName
+      << "\" is not supported")
+    return -1;
+    }
+
+  if (md->BlockOwner.size() != static_cast<unsigned int>(md->NumBlocks))
+    {
+    SENSEI_ERROR("A global view of mesh \"" << md->MeshName
+      << "\" block decomposition is required")
+    return -1;
+    }
+
+  int rank = 0;
+  MPI_Comm_rank(this->Comm.Comm, &rank);
+
+  // serialize the local blocks, each with its position in the mesh
+  BinaryStream bs;
+  if (mesh)
+    {
+    int nLocal = 0;
+    for (int j = 0; j < md->NumBlocks; ++j)
+      {
+      if (md->BlockOwner[j] == rank)
+        ++nLocal;
+      }
+
+    bs.Pack(nLocal);
+
+    vtkCompositeDataIterator *it = mesh->NewIterator();
+    it->SetSkipEmptyNodes(0);
+    it->InitTraversal();
+
+    for (int j = 0; j < md->NumBlocks; ++j)
+      {
+      if (md->BlockOwner[j] == rank)
+        {
+        vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+        if (!ds)
+          {
+          SENSEI_ERROR("Failed to get block " << j << " of mesh \""
+            << md->MeshName << "\"")
+          it->Delete();
+          return -1;
+          }
+
+        bs.Pack(j);
+
+        if (senseiMPI::PackBlock(ds, false, bs) ||
+          packArrays(ds->GetPointData(), bs) || packArrays(ds->GetCellData(), bs))
+          {
+          SENSEI_ERROR("Failed to serialize block " << j << " of mesh \""
+            << md->MeshName << "\"")
+          it->Delete();
+          return -1;
+          }
+        }
+
+      it->GoToNextItem();
+      }
+
+    it->Delete();
+    }
+
+  // each rank's stream is placed in the node's shared memory, the leader
+  // reads them in place
+  unsigned char *base = nullptr;
+  MPI_Win win = MPI_WIN_NULL;
+  if (MPI_Win_allocate_shared(bs.Size(), 1, MPI_INFO_NULL, this->Comm.Node,
+    &base, &win) != MPI_SUCCESS)
+    {
+    SENSEI_ERROR("Failed to allocate the node's shared memory")
+    return -1;
+    }
+
+  MPI_Win_fence(0, win);
+
+  if (bs.Size())
+    memcpy(base, bs.GetData(), bs.Size());
+  bs.Clear();
+
+  MPI_Win_fence(0, win);
+
+  int ierr = 0;
+  if (this->IsLeader() && !mesh)
+    {
+    SENSEI_ERROR("The node leader has no mesh \"" << md->MeshName << "\"")
+    ierr = -1;
+    }
+  else if (this->IsLeader())
+    {
+    // the metadata of the blocks is kept, their owners are now the leaders
+    leaderMd = md->NewCopy();
+    leaderMd->NumBlocksLocal.assign(this->NumNodes, 0);
+    for (int j = 0; j < md->NumBlocks; ++j)
+      {
+      int owner = this->RankNode[md->BlockOwner[j]];
+      leaderMd->BlockOwner[j] = owner;
+      ++leaderMd->NumBlocksLocal[owner];
+      }
+
+    leaderMesh = mesh->NewInstance();
+    leaderMesh->CopyStructure(mesh);
+
+    // the blocks are unpacked in order, an iterator reaches each position
+    std::vector<vtkDataSet*> blocks(md->NumBlocks, nullptr);
+
+    int nodeSize = 1;
+    MPI_Comm_size(this->Comm.Node, &nodeSize);
+
+    for (int r = 0; !ierr && (r < nodeSize); ++r)
+      {
+      MPI_Aint size = 0;
+      int dispUnit = 1;
+      unsigned char *ptr = nullptr;
+      MPI_Win_shared_query(win, r, &size, &dispUnit, &ptr);
+
+      if (!size)
+        continue;
+
+      BinaryStream rbs;
+      rbs.SetExternalBuffer(ptr, size);
+
+      int nBlocks = 0;
+      rbs.Unpack(nBlocks);
+
+      for (int k = 0; k < nBlocks; ++k)
+        {
+        int j = 0;
+        rbs.Unpack(j);
+
+        vtkDataObject *dobj = nullptr;
+        if (senseiMPI::UnpackBlock(rbs, dobj))
+          {
+          ierr = -1;
+          break;
+          }
+
+        vtkDataSet *ds = dynamic_cast<vtkDataSet*>(dobj);
+        if (!ds || (j < 0) || (j >= md->NumBlocks) || blocks[j] ||
+          unpackArrays(rbs, ds->GetPointData()) ||
+          unpackArrays(rbs, ds->GetCellData()))
+          {
+          if (dobj)
+            dobj->Delete();
+          ierr = -1;
+          break;
+          }
+
+        blocks[j] = ds;
+        }
+      }
+
+    vtkCompositeDataIterator *it = leaderMesh->NewIterator();
+    it->SetSkipEmptyNodes(0);
+    it->InitTraversal();
+
+    for (int j = 0; j < md->NumBlocks; ++j)
+      {
+      if (blocks[j])
+        {
+        if (!ierr)
+          leaderMesh->SetDataSet(it, blocks[j]);
+        blocks[j]->Delete();
+        }
+
+      it->GoToNextItem();
+      }
+
+    it->Delete();
+
+    if (ierr)
+      {
+      SENSEI_ERROR("Failed to gather the blocks of mesh \""
+        << md->MeshName << "\"")
+      leaderMesh->Delete();
+      leaderMesh = nullptr;
+      leaderMd = nullptr;
+      }
+    }
+
+  // the window is freed once the leader is done with it
+  MPI_Win_free(&win);
+
+  return ierr;
+}
+
+// --------------------------------------------------------------------------
+void NodeAggregator::Free()
+{
+  this->Comm.Free();
+  this->RankNode.clear();
+  this->NumNodes = 0;
+}
+
+}
@@ -0,0 +1,63 @@
+#ifndef sensei_NodeAggregator_h
+#define sensei_NodeAggregator_h
+
+#include "MeshMetadata.h"
+#include "MPIUtils.h"
+
+#include <mpi.h>
+#include <vector>
+
+class vtkCompositeDataSet;
+
+namespace sensei
+{
+
+/// @class NodeAggregator
+/// @brief gathers the blocks of the ranks of a node to a node leader.
+///
+/// When every rank of a simulation takes part in the transport the writer
+/// sees one small participant per rank, 64 or more per node and NIC. The
+/// aggregator splits the communicator by shared memory node and moves the
+/// blocks of each node to its lowest rank, the leader, so that only the
+/// leaders write. The blocks are serialized into an MPI shared memory
+/// window and unpacked by the leader directly from its peers' segments.
+///
+/// The leader's mesh has the structure of the simulation's mesh, with the
+/// node's blocks in place. Its metadata is that of the global view with
+/// the owner of each block set to the leader's rank in the leader
+/// communicator, the block ids, sizes, extents, bounds and array ranges
+/// are kept for the receiver's partitioners. AMR meshes are not supported.
+class NodeAggregator
+{
+public:
+  /// split comm into nodes. collective. returns zero if successful.
+  int Initialize(MPI_Comm comm);
+
+  /// true once Initialize was called
+  bool Initialized() const { return this->Comm.Comm != MPI_COMM_NULL; }
+
+  /// true on the ranks that write
+  bool IsLeader() const { return this->Comm.Leaders != MPI_COMM_NULL; }
+
+  /// the leaders, MPI_COMM_NULL on the other ranks
+  MPI_Comm GetLeaderCommunicator() const { return this->Comm.Leaders; }
+
+  /// gather the local blocks of a mesh to the node leader. md must be a
+  /// global view. on the leader leaderMd and leaderMesh are set and the
+  /// caller takes the reference to the mesh, elsewhere they are null.
+  /// collective. returns zero if successful.
+  int Gather(const MeshMetadataPtr &md, vtkCompositeDataSet *mesh,
+    MeshMetadataPtr &leaderMd, vtkCompositeDataSet *&leaderMesh);
+
+  /// release the communicators
+  void Free();
+
+private:
+  MPIUtils::HierarchicalComm Comm;
+  std::vector<int> RankNode; // the node of each rank of comm
+  int NumNodes = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,249 @@
+#include "PartialResultsDataAdaptor.h"
+#include "VTKDataAdaptor.h"
+#include "Error.h"
+
+#include <vtkDataObject.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace sensei
+{
+
+struct PartialResultsDataAdaptor::InternalsType
+{
+  InternalsType() : Data(nullptr) {}
+
+  // returns true if the named mesh is a partial result
+  bool IsPartial(const std::string &meshName);
+
+  DataAdaptor *Data;
+
+  // the partial results are served by a VTKDataAdaptor, its meshes are
+  // ordered by name as are the names here
+  vtkSmartPointer<VTKDataAdaptor> Partials;
+  std::set<std::string> Names;
+  std::mutex Mutex;
+};
+
+//----------------------------------------------------------------------------
+bool PartialResultsDataAdaptor::InternalsType::IsPartial(
+  const std::string &meshName)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Names.count(meshName);
+}
+
+//----------------------------------------------------------------------------
+senseiNewMacro(PartialResultsDataAdaptor);
+
+//----------------------------------------------------------------------------
+PartialResultsDataAdaptor::PartialResultsDataAdaptor()
+{
+  this->Internals = new InternalsType;
+  this->Internals->Partials = vtkSmartPointer<VTKDataAdaptor>::New();
+}
+
+//----------------------------------------------------------------------------
+PartialResultsDataAdaptor::~PartialResultsDataAdaptor()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::GetPhase(const std::string &name, int &phase)
+{
+  if (name.empty() || (name == "all"))
+    phase = PHASE_ALL;
+  else if (name == "local")
+    phase = PHASE_LOCAL;
+  else if (name == "global")
+    phase = PHASE_GLOBAL;
+  else
+    return -1;
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+std::string PartialResultsDataAdaptor::GetMeshName(const std::string &prefix,
+  const std::string &meshName, const std::string &arrayName)
+{
+  return prefix + "_" + meshName + "_" + arrayName;
+}
+
+//----------------------------------------------------------------------------
+void PartialResultsDataAdaptor::SetDataAdaptor(DataAdaptor *data)
+{
+  if (this->Internals->Data == data)
+    return;
+
+  this->Clear();
+  this->Internals->Data = data;
+
+  if (data)
+    {
+    this->SetCommunicator(data->GetCommunicator());
+    this->Internals->Partials->SetCommunicator(data->GetCommunicator());
+    }
+}
+
+//----------------------------------------------------------------------------
+DataAdaptor *PartialResultsDataAdaptor::GetDataAdaptor()
+{
+  return this->Internals->Data;
+}
+
+//----------------------------------------------------------------------------
+void PartialResultsDataAdaptor::SetPartialResult(const std::string &meshName,
+  vtkDataObject *mesh)
+{
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+  this->Internals->Partials->SetDataObject(meshName, mesh);
+  this->Internals->Names.insert(meshName);
+}
+
+//----------------------------------------------------------------------------
+void PartialResultsDataAdaptor::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+  this->Internals->Partials->ReleaseData();
+  this->Internals->Names.clear();
+  this->ClearMeshMetadataCache();
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::GetNumberOfMeshes(unsigned int &numMeshes)
+{
+  if (this->Internals->Data->GetNumberOfMeshes(numMeshes))
+    return -1;
+
+  std::lock_guard<std::mutex> lock(this->Internals->Mutex);
+  numMeshes += this->Internals->Names.size();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::GetMeshMetadata(unsigned int id,
+  MeshMetadataPtr &metadata)
+{
+  unsigned int nMeshes = 0;
+  if (this->Internals->Data->GetNumberOfMeshes(nMeshes))
+    return -1;
+
+  if (id < nMeshes)
+    return this->Internals->Data->GetMeshMetadata(id, metadata);
+
+  return this->Internals->Partials->GetMeshMetadata(id - nMeshes, metadata);
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::GetCachedMeshMetadata(unsigned int id,
+  const MeshMetadataFlags &flags, bool globalView, MeshMetadataPtr &metadata)
+{
+  unsigned int nMeshes = 0;
+  if (this->Internals->Data->GetNumberOfMeshes(nMeshes))
+    return -1;
+
+  // the wrapped adaptor persists across steps while the partial results
+  // are new every step
+  if (id < nMeshes)
+    return this->Internals->Data->GetCachedMeshMetadata(id, flags,
+      globalView, metadata);
+
+  return this->DataAdaptor::GetCachedMeshMetadata(id, flags,
+    globalView, metadata);
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::GetMesh(const std::string &meshName,
+  bool structureOnly, vtkDataObject *&mesh)
+{
+  if (this->Internals->IsPartial(meshName))
+    return this->Internals->Partials->GetMesh(meshName, structureOnly, mesh);
+
+  return this->Internals->Data->GetMesh(meshName, structureOnly, mesh);
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::AddArray(vtkDataObject* mesh,
+  const std::string &meshName, int association, const std::string &arrayName)
+{
+  if (this->Internals->IsPartial(meshName))
+    return this->Internals->Partials->AddArray(mesh, meshName,
+      association, arrayName);
+
+  return this->Internals->Data->AddArray(mesh, meshName,
+    association, arrayName);
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::AddGhostCellsArray(vtkDataObject* mesh,
+  const std::string &meshName)
+{
+  // the partial results have no ghost zones
+  if (this->Internals->IsPartial(meshName))
+    return 0;
+
+  return this->Internals->Data->AddGhostCellsArray(mesh, meshName);
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::AddGhostNodesArray(vtkDataObject* mesh,
+  const std::string &meshName)
+{
+  if (this->Internals->IsPartial(meshName))
+    return 0;
+
+  return this->Internals->Data->AddGhostNodesArray(mesh, meshName);
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::GetDeviceArray(const std::string &meshName,
+  int association, const std::string &arrayName, int blockId,
+  DeviceArray &array)
+{
+  if (this->Internals->IsPartial(meshName))
+    return 1;
+
+  return this->Internals->Data->GetDeviceArray(meshName, association,
+    arrayName, blockId, array);
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::GetArrayViews(const std::string &meshName,
+  int association, const std::string &arrayName,
+  std::vector<ArrayView> &views)
+{
+  // the views of partial results are made from their VTK objects
+  if (this->Internals->IsPartial(meshName))
+    return this->DataAdaptor::GetArrayViews(meshName, association,
+      arrayName, views);
+
+  return this->Internals->Data->GetArrayViews(meshName, association,
+    arrayName, views);
+}
+
+//----------------------------------------------------------------------------
+double PartialResultsDataAdaptor::GetDataTime()
+{
+  return this->Internals->Data->GetDataTime();
+}
+
+//----------------------------------------------------------------------------
+long PartialResultsDataAdaptor::GetDataTimeStep()
+{
+  return this->Internals->Data->GetDataTimeStep();
+}
+
+//----------------------------------------------------------------------------
+int PartialResultsDataAdaptor::ReleaseData()
+{
+  return this->Internals->Data->ReleaseData();
+}
+
+}
@@ -0,0 +1,128 @@
+#ifndef sensei_PartialResultsDataAdaptor_h
+#define sensei_PartialResultsDataAdaptor_h
+
+#include "DataAdaptor.h"
+
+#include <string>
+
+class vtkDataObject;
+
+namespace sensei
+{
+/// @brief A DataAdaptor that serves the partial results of analyses along
+/// with the simulation's meshes.
+///
+/// Analyses that reduce their input, such as histograms and statistics,
+/// may be split in two phases. The local phase runs in the simulation and
+/// publishes its per rank result, bins or moments, as a small mesh with a
+/// block per rank. The mesh is served by this adaptor after those of the
+/// wrapped adaptor, so that a transport that runs later in the same step
+/// ships it to an in transit end point like any other mesh, in place of
+/// the full fields. The global phase runs on the end point and merges the
+/// blocks of the partial result.
+///
+/// Analyses that produce meshes, such as the slices and iso-surfaces of
+/// SliceExtract, publish them here in the same way, so that the analyses
+/// and transports that run after them in the same step consume them in
+/// memory, without copies or a round trip through the file system.
+///
+/// ConfigurableAnalysis wraps the simulation's adaptor in one of these
+/// when an analysis is configured with a local phase or publishes. The analyses with a
+/// local phase must be listed before the transport and run in order, they
+/// may not be asynchronous or concurrent. The partial results are valid
+/// until Clear is called.
+class PartialResultsDataAdaptor : public DataAdaptor
+{
+public:
+  static PartialResultsDataAdaptor *New();
+  senseiTypeMacro(PartialResultsDataAdaptor, DataAdaptor);
+
+  /// The phases of an analysis split between the simulation and an end
+  /// point. PHASE_ALL computes and reduces the result in place.
+  enum {PHASE_ALL = 0, PHASE_LOCAL = 1, PHASE_GLOBAL = 2};
+
+  /// @brief Convert "all", "local" or "global" to a phase.
+  ///
+  /// @returns zero if successful, non zero if the name is not a phase
+  static int GetPhase(const std::string &name, int &phase);
+
+  /// @brief Get the name of the mesh holding a partial result.
+  ///
+  /// The partial result of an array is published as
+  /// <prefix>_<mesh>_<array>, where prefix is chosen by the analysis.
+  static std::string GetMeshName(const std::string &prefix,
+    const std::string &meshName, const std::string &arrayName);
+
+  /// @brief Set the adaptor whose meshes are served.
+  ///
+  /// Setting a different adaptor clears the partial results. This takes
+  /// the communicator of the wrapped adaptor.
+  ///
+  /// @param[in] data the adaptor to forward to
+  void SetDataAdaptor(DataAdaptor *data);
+  DataAdaptor *GetDataAdaptor();
+
+  /// @brief Publish a partial result.
+  ///
+  /// The mesh holds the blocks of this rank. Every rank must publish the
+  /// same set of partial results, since the transports gather the
+  /// metadata of each mesh collectively. A result published with the same
+  /// name replaces the last one.
+  ///
+  /// @param[in] meshName the name the result is served as
+  /// @param[in] mesh the result, a reference is taken
+  void SetPartialResult(const std::string &meshName, vtkDataObject *mesh);
+
+  /// @brief Release the partial results.
+  ///
+  /// Called after all of the analyses of a step have executed.
+  void Clear();
+
+  // the meshes of the wrapped adaptor, followed by the partial results
+  int GetNumberOfMeshes(unsigned int &numMeshes) override;
+  int GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadata) override;
+  int GetCachedMeshMetadata(unsigned int id, const MeshMetadataFlags &flags,
+    bool globalView, MeshMetadataPtr &metadata) override;
+
+  int GetMesh(const std::string &meshName, bool structureOnly,
+    vtkDataObject *&mesh) override;
+
+  using DataAdaptor::GetMesh;
+
+  int AddGhostNodesArray(vtkDataObject* mesh,
+    const std::string &meshName) override;
+
+  int AddGhostCellsArray(vtkDataObject* mesh,
+    const std::string &meshName) override;
+
+  int AddArray(vtkDataObject* mesh, const std::string &meshName,
+    int association, const std::string &arrayName) override;
+
+  int GetDeviceArray(const std::string &meshName, int association,
+    const std::string &arrayName, int blockId, DeviceArray &array) override;
+
+  int GetArrayViews(const std::string &meshName, int association,
+    const std::string &arrayName, std::vector<ArrayView> &views) override;
+
+  // forwarded to the wrapped adaptor
+  double GetDataTime() override;
+  long GetDataTimeStep() override;
+
+  /// @brief Forwarded to the wrapped adaptor, see Clear.
+  int ReleaseData() override;
+
+protected:
+  PartialResultsDataAdaptor();
+  ~PartialResultsDataAdaptor();
+
+private:
+  PartialResultsDataAdaptor(const PartialResultsDataAdaptor&) = delete;
+  void operator=(const PartialResultsDataAdaptor&) = delete;
+
+  struct InternalsType;
+  InternalsType *Internals;
+};
+
+}
+
+#endif
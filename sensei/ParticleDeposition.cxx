@@ -0,0 +1,723 @@
+#include "ParticleDeposition.h"
+#include "ArrayDispatch.h"
+#include "DataAdaptor.h"
+#include "MeshMetadata.h"
+#include "MeshMetadataMap.h"
+#include "Profiler.h"
+#include "TaskRuntime.h"
+#include "VTKUtils.h"
+#include "Error.h"
+
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPointSet.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#if defined(ENABLE_VTK_IO)
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkXMLImageDataWriter.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+// the particles are deposited by the threads in chunks of this size
+const long chunkSize = 65536;
+
+// and converted to double in runs of this size
+const long runSize = 512;
+
+// the moments summed in each cell, the weight, the weighted velocity and
+// the weighted square of its magnitude
+const int maxMoments = 5;
+
+// the cells of the grid held by a rank or thread
+struct GridBox
+{
+  double X0[3];     // the lower bounds of the grid
+  double InvDx[3];  // the inverse of the cell size
+  int Box[6];       // the cells covered, first and last in each direction
+  long Nx;          // the strides of the cells covered
+  long Nxy;
+  int NMoments;
+};
+
+// copy the tuples [i0, i0 + n) of a 3 component array. arrays that are not
+// stored contiguously are copied a tuple at a time
+template <typename T>
+void copyTuples(vtkDataArray *da, const T *vals, long i0, long n, double *out)
+{
+  if (vals)
+    {
+    const T *pv = vals + 3*i0;
+    for (long i = 0; i < 3*n; ++i)
+      out[i] = static_cast<double>(pv[i]);
+    }
+  else
+    {
+    for (long i = 0; i < n; ++i)
+      da->GetTuple(i0 + i, out + 3*i);
+    }
+}
+
+// copy tuples, see ArrayDispatch
+struct CopyKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    copyTuples(this->Array, vals, this->Begin, this->Count, this->Out);
+  }
+
+  vtkDataArray *Array;
+  long Begin;
+  long Count;
+  double *Out;
+};
+
+int getTuples(vtkDataArray *da, long i0, long n, double *out)
+{
+  CopyKernel kernel{da, i0, n, out};
+  sensei::ArrayDispatch::Execute(da, kernel);
+  return 0;
+}
+
+// add the moments m, weighted by w, to cell i, j, k of the box
+inline
+void addMoments(const GridBox &g, int i, int j, int k, double w,
+  const double *m, double *grid)
+{
+  double *cell = grid + g.NMoments*((i - g.Box[0]) +
+    g.Nx*(j - g.Box[2]) + g.Nxy*(k - g.Box[4]));
+
+  for (int q = 0; q < g.NMoments; ++q)
+    cell[q] += w*m[q];
+}
+
+// deposit n particles at x, with velocities v when given, into the grid of
+// the box. the contributions to cells outside the box are dropped
+void deposit(const GridBox &g, int scheme, const double *x, const double *v,
+  const unsigned char *ghosts, long n, double *grid)
+{
+  for (long p = 0; p < n; ++p)
+    {
+    if (ghosts && ghosts[p])
+      continue;
+
+    double m[maxMoments] = {1.0, 0.0, 0.0, 0.0, 0.0};
+    if (v)
+      {
+      const double *vp = v + 3*p;
+      m[1] = vp[0];
+      m[2] = vp[1];
+      m[3] = vp[2];
+      m[4] = vp[0]*vp[0] + vp[1]*vp[1] + vp[2]*vp[2];
+      }
+
+    const double *xp = x + 3*p;
+
+    if (scheme == sensei::ParticleDeposition::SCHEME_NGP)
+      {
+      int c[3];
+      bool inside = true;
+      for (int q = 0; q < 3; ++q)
+        {
+        c[q] = static_cast<int>(std::floor((xp[q] - g.X0[q])*g.InvDx[q]));
+        inside &= (c[q] >= g.Box[2*q]) && (c[q] <= g.Box[2*q+1]);
+        }
+
+      if (inside)
+        addMoments(g, c[0], c[1], c[2], 1.0, m, grid);
+      }
+    else
+      {
+      // the cloud is a cell wide and centered on the particle, it overlaps
+      // the cells whose centers are less than a cell away
+      int c[3];
+      double w[3][2];
+      for (int q = 0; q < 3; ++q)
+        {
+        double s = (xp[q] - g.X0[q])*g.InvDx[q] - 0.5;
+        double cs = std::floor(s);
+        double f = s - cs;
+        c[q] = static_cast<int>(cs);
+        w[q][0] = 1.0 - f;
+        w[q][1] = f;
+        }
+
+      for (int dk = 0; dk < 2; ++dk)
+        {
+        int k = c[2] + dk;
+        if ((k < g.Box[4]) || (k > g.Box[5]))
+          continue;
+
+        for (int dj = 0; dj < 2; ++dj)
+          {
+          int j = c[1] + dj;
+          if ((j < g.Box[2]) || (j > g.Box[3]))
+            continue;
+
+          double wjk = w[1][dj]*w[2][dk];
+
+          for (int di = 0; di < 2; ++di)
+            {
+            int i = c[0] + di;
+            if ((i < g.Box[0]) || (i > g.Box[1]))
+              continue;
+
+            addMoments(g, i, j, k, w[0][di]*wjk, m, grid);
+            }
+          }
+        }
+      }
+    }
+}
+
+// the number of cells in a box, 0 when it is empty
+long boxCells(const int *box)
+{
+  long n = 1;
+  for (int q = 0; q < 3; ++q)
+    n *= std::max(0, box[2*q+1] - box[2*q] + 1);
+  return n;
+}
+}
+
+namespace sensei
+{
+
+//-----------------------------------------------------------------------------
+senseiNewMacro(ParticleDeposition);
+
+//-----------------------------------------------------------------------------
+ParticleDeposition::ParticleDeposition() : Dims{0, 0, 0},
+  Bounds{0.0, 0.0, 0.0, 0.0, 0.0, 0.0}, Scheme(SCHEME_CIC), Threads(1)
+{
+}
+
+//-----------------------------------------------------------------------------
+ParticleDeposition::~ParticleDeposition()
+{
+}
+
+//-----------------------------------------------------------------------------
+int ParticleDeposition::GetScheme(const std::string &name, int &scheme)
+{
+  if (name == "ngp")
+    scheme = SCHEME_NGP;
+  else if (name == "cic")
+    scheme = SCHEME_CIC;
+  else
+    {
+    SENSEI_ERROR("Invalid deposition scheme \"" << name
+      << "\". Use one of ngp or cic")
+    return -1;
+    }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int ParticleDeposition::Initialize(const std::string &meshName,
+  const std::string &velocityName, const int dims[3], const double bounds[6],
+  int scheme, const std::string &fileName)
+{
+  for (int q = 0; q < 3; ++q)
+    {
+    if ((dims[q] < 1) || !(bounds[2*q+1] > bounds[2*q]))
+      {
+      SENSEI_ERROR("Invalid grid, " << dims[q] << " cells over ["
+        << bounds[2*q] << ", " << bounds[2*q+1] << "] in direction " << q)
+      return -1;
+      }
+
+    this->Dims[q] = dims[q];
+    this->Bounds[2*q] = bounds[2*q];
+    this->Bounds[2*q+1] = bounds[2*q+1];
+    }
+
+  if ((scheme != SCHEME_NGP) && (scheme != SCHEME_CIC))
+    {
+    SENSEI_ERROR("Invalid deposition scheme " << scheme)
+    return -1;
+    }
+
+  this->MeshName = meshName;
+  this->VelocityName = velocityName;
+  this->Scheme = scheme;
+  this->FileName = fileName;
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void ParticleDeposition::SetNumberOfThreads(int nThreads)
+{
+  this->Threads = nThreads < 1 ? TaskRuntime::GetNumberOfThreads() : nThreads;
+}
+
+//-----------------------------------------------------------------------------
+const char *ParticleDeposition::GetGhostArrayName()
+{
+#if VTK_MAJOR_VERSION == 6 && VTK_MINOR_VERSION == 1
+    return "vtkGhostType";
+#else
+    return vtkDataSetAttributes::GhostArrayName();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+bool ParticleDeposition::Execute(DataAdaptor* data)
+{
+  TimeEvent<128> mark("ParticleDeposition::Execute");
+
+  int step = data->GetDataTimeStep();
+  double time = data->GetDataTime();
+
+  int nMoments = this->VelocityName.empty() ? 1 : maxMoments;
+
+  // errors are reported but processing continues so that all ranks take
+  // part in the reduction below
+  bool status = true;
+  int box[6] = {0, -1, 0, -1, 0, -1};
+  std::vector<double> grid;
+
+  MeshMetadataMap mdMap;
+  MeshMetadataPtr mmd;
+  vtkDataObject *dobj = nullptr;
+
+  if (mdMap.Initialize(data, MeshMetadataFlags()) ||
+    mdMap.GetMeshMetadata(this->MeshName, mmd))
+    {
+    SENSEI_ERROR("Failed to get metadata for mesh \"" << this->MeshName << "\"")
+    status = false;
+    }
+  else if (data->GetMesh(this->MeshName, false, dobj))
+    {
+    SENSEI_ERROR("Failed to get mesh \"" << this->MeshName << "\"")
+    status = false;
+    }
+
+  // it is not necessarily an error if all ranks do not have particles
+  if (status && dobj)
+    {
+    vtkCompositeDataSetPtr mesh =
+      VTKUtils::AsCompositeData(this->GetCommunicator(), dobj, true);
+
+    if (mmd->NumGhostNodes && data->AddGhostNodesArray(mesh, this->MeshName))
+      {
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add ghost nodes.")
+      status = false;
+      }
+    else if (!this->VelocityName.empty() && data->AddArray(mesh,
+      this->MeshName, vtkDataObject::POINT, this->VelocityName))
+      {
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add point data"
+        " array \""  << this->VelocityName << "\"")
+      status = false;
+      }
+    else if (this->DepositLocal(mesh, box, nMoments, grid))
+      {
+      box[1] = box[3] = box[5] = -1;
+      grid.clear();
+      status = false;
+      }
+    }
+
+  if (this->Reduce(box, nMoments, grid) || this->WriteResults(step, time))
+    status = false;
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+int ParticleDeposition::DepositLocal(vtkCompositeDataSet *mesh, int box[6],
+  int nMoments, std::vector<double> &grid)
+{
+  TimeEvent<128> mark("ParticleDeposition::DepositLocal");
+
+  // the particles of the local blocks and the bounds of all of them
+  struct Block
+  {
+    vtkDataArray *X;
+    vtkDataArray *V;
+    const unsigned char *Ghosts;
+    long N;
+  };
+
+  std::vector<Block> blocks;
+
+  double bounds[6] = {std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::lowest()};
+
+  vtkSmartPointer<vtkCompositeDataIterator> iter;
+  iter.TakeReference(mesh->NewIterator());
+
+  for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
+    {
+    vtkPointSet *ps = dynamic_cast<vtkPointSet*>(iter->GetCurrentDataObject());
+    if (!ps || !ps->GetPoints() || !ps->GetNumberOfPoints())
+      continue;
+
+    Block b = {ps->GetPoints()->GetData(), nullptr, nullptr,
+      static_cast<long>(ps->GetNumberOfPoints())};
+
+    if (!this->VelocityName.empty())
+      {
+      b.V = ps->GetPointData()->GetArray(this->VelocityName.c_str());
+      if (!b.V || (b.V->GetNumberOfComponents() != 3))
+        {
+        SENSEI_ERROR("Dataset " << iter->GetCurrentFlatIndex() << " has no 3"
+          " component point data array named \"" << this->VelocityName << "\"")
+        return -1;
+        }
+      }
+
+    vtkUnsignedCharArray *ghosts = dynamic_cast<vtkUnsignedCharArray*>(
+      ps->GetPointData()->GetArray(this->GetGhostArrayName()));
+
+    b.Ghosts = ghosts ? ghosts->GetPointer(0) : nullptr;
+
+    double bds[6];
+    ps->GetBounds(bds);
+    for (int q = 0; q < 3; ++q)
+      {
+      bounds[2*q] = std::min(bounds[2*q], bds[2*q]);
+      bounds[2*q+1] = std::max(bounds[2*q+1], bds[2*q+1]);
+      }
+
+    blocks.push_back(b);
+    }
+
+  if (blocks.empty())
+    return 0;
+
+  // the cells the particles reach, those under their clouds for CIC
+  GridBox g;
+  double shift = this->Scheme == SCHEME_CIC ? 0.5 : 0.0;
+  for (int q = 0; q < 3; ++q)
+    {
+    g.X0[q] = this->Bounds[2*q];
+    g.InvDx[q] = this->Dims[q] / (this->Bounds[2*q+1] - this->Bounds[2*q]);
+
+    double lo = std::floor((bounds[2*q] - g.X0[q])*g.InvDx[q] - shift);
+    double hi = std::floor((bounds[2*q+1] - g.X0[q])*g.InvDx[q] - shift) +
+      (this->Scheme == SCHEME_CIC ? 1.0 : 0.0);
+
+    box[2*q] = static_cast<int>(std::max(lo, 0.0));
+    box[2*q+1] = static_cast<int>(std::min(hi, this->Dims[q] - 1.0));
+    g.Box[2*q] = box[2*q];
+    g.Box[2*q+1] = box[2*q+1];
+    }
+
+  g.Nx = box[1] - box[0] + 1;
+  g.Nxy = g.Nx*(box[3] - box[2] + 1);
+  g.NMoments = nMoments;
+
+  long nValues = nMoments*boxCells(box);
+  if (nValues == 0)
+    return 0;
+
+  // split the particles into chunks, each thread deposits the chunks it
+  // takes into a grid of its own
+  std::vector<std::pair<size_t, long>> chunks;
+  for (size_t i = 0; i < blocks.size(); ++i)
+    {
+    for (long i0 = 0; i0 < blocks[i].N; i0 += chunkSize)
+      chunks.push_back(std::make_pair(i, i0));
+    }
+
+  long nChunks = chunks.size();
+  int nThreads = std::max(1l, std::min(static_cast<long>(this->Threads), nChunks));
+
+  std::vector<std::vector<double>> threadGrids(nThreads);
+
+  int ierr = TaskRuntime::ParallelFor(nChunks, nThreads,
+    [&](int thread, long i) -> int
+    {
+    std::vector<double> &tg = threadGrids[thread];
+    if (tg.empty())
+      tg.resize(nValues, 0.0);
+
+    const Block &b = blocks[chunks[i].first];
+    long i0 = chunks[i].second;
+    long i1 = std::min(i0 + chunkSize, b.N);
+
+    double x[3*runSize];
+    double v[3*runSize];
+
+    for (long j0 = i0; j0 < i1; j0 += runSize)
+      {
+      long n = std::min(runSize, i1 - j0);
+
+      if (getTuples(b.X, j0, n, x) || (b.V && getTuples(b.V, j0, n, v)))
+        return -1;
+
+      deposit(g, this->Scheme, x, b.V ? v : nullptr,
+        b.Ghosts ? b.Ghosts + j0 : nullptr, n, tg.data());
+      }
+
+    return 0;
+    });
+
+  if (ierr < 0)
+    {
+    SENSEI_ERROR("Unsupported type of the point or velocity arrays")
+    return -1;
+    }
+
+  // sum the thread grids once, splitting the cells over the threads
+  std::vector<const double*> others;
+  for (int i = 0; i < nThreads; ++i)
+    {
+    if (threadGrids[i].empty())
+      continue;
+
+    if (grid.empty())
+      grid.swap(threadGrids[i]);
+    else
+      others.push_back(threadGrids[i].data());
+    }
+
+  if (others.empty())
+    return 0;
+
+  long spanSize = nValues / nThreads + 1;
+  TaskRuntime::ParallelFor(nThreads, nThreads,
+    [&](int, long i) -> int
+    {
+    long k0 = i*spanSize;
+    long k1 = std::min(k0 + spanSize, nValues);
+
+    double *pg = grid.data();
+    for (size_t j = 0; j < others.size(); ++j)
+      {
+      const double *po = others[j];
+      for (long k = k0; k < k1; ++k)
+        pg[k] += po[k];
+      }
+
+    return 0;
+    });
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int ParticleDeposition::Reduce(const int box[6], int nMoments,
+  const std::vector<double> &grid)
+{
+  TimeEvent<128> mark("ParticleDeposition::Reduce");
+
+  MPI_Comm comm = this->GetCommunicator();
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  // rank 0 receives the box of each rank and the sums over it, which
+  // for particles that are spatially decomposed are a small part of the
+  // grid
+  std::vector<int> boxes(rank == 0 ? 6*nRanks : 0);
+  MPI_Gather(const_cast<int*>(box), 6, MPI_INT, boxes.data(), 6, MPI_INT,
+    0, comm);
+
+  std::vector<int> counts;
+  std::vector<int> displs;
+  std::vector<double> sums;
+
+  if (rank == 0)
+    {
+    counts.resize(nRanks);
+    displs.resize(nRanks);
+
+    long total = 0;
+    for (int i = 0; i < nRanks; ++i)
+      {
+      counts[i] = nMoments*boxCells(&boxes[6*i]);
+      displs[i] = total;
+      total += counts[i];
+      }
+
+    sums.resize(total);
+    }
+
+  MPI_Gatherv(const_cast<double*>(grid.data()), grid.size(), MPI_DOUBLE,
+    sums.data(), counts.data(), displs.data(), MPI_DOUBLE, 0, comm);
+
+  this->Density.clear();
+  this->Velocity.clear();
+  this->Dispersion.clear();
+
+  if (rank != 0)
+    return 0;
+
+  // sum the boxes into the grid
+  long nx = this->Dims[0];
+  long ny = this->Dims[1];
+  long nCells = nx*ny*this->Dims[2];
+
+  std::vector<double> moments(nMoments*nCells, 0.0);
+
+  for (int i = 0; i < nRanks; ++i)
+    {
+    const int *b = &boxes[6*i];
+    if (!counts[i])
+      continue;
+
+    const double *src = sums.data() + displs[i];
+    long nRow = nMoments*(b[1] - b[0] + 1);
+
+    for (long k = b[4]; k <= b[5]; ++k)
+      {
+      for (long j = b[2]; j <= b[3]; ++j)
+        {
+        double *dest = moments.data() + nMoments*(b[0] + nx*(j + ny*k));
+        for (long q = 0; q < nRow; ++q)
+          dest[q] += src[q];
+        src += nRow;
+        }
+      }
+    }
+
+  // the density, and the mean and dispersion of the velocity
+  double cellVolume = 1.0;
+  for (int q = 0; q < 3; ++q)
+    cellVolume *= (this->Bounds[2*q+1] - this->Bounds[2*q]) / this->Dims[q];
+
+  this->Density.resize(nCells);
+  if (nMoments > 1)
+    {
+    this->Velocity.resize(3*nCells, 0.0);
+    this->Dispersion.resize(nCells, 0.0);
+    }
+
+  for (long c = 0; c < nCells; ++c)
+    {
+    const double *m = moments.data() + nMoments*c;
+
+    this->Density[c] = m[0] / cellVolume;
+
+    if ((nMoments > 1) && (m[0] > 0.0))
+      {
+      double *u = this->Velocity.data() + 3*c;
+      u[0] = m[1] / m[0];
+      u[1] = m[2] / m[0];
+      u[2] = m[3] / m[0];
+
+      this->Dispersion[c] = std::max(0.0,
+        m[4] / m[0] - (u[0]*u[0] + u[1]*u[1] + u[2]*u[2]));
+      }
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int ParticleDeposition::WriteResults(int step, double time)
+{
+  int rank = 0;
+  MPI_Comm_rank(this->GetCommunicator(), &rank);
+
+  if ((rank != 0) || this->FileName.empty())
+    return 0;
+
+#if !defined(ENABLE_VTK_IO)
+  (void)step;
+  (void)time;
+  SENSEI_ERROR("VTK XML I/O capabilites are required to write the deposited"
+    " fields but are not present in this build")
+  return -1;
+#else
+  TimeEvent<128> mark("ParticleDeposition::WriteResults");
+
+  vtkImageData *im = vtkImageData::New();
+  im->SetOrigin(this->Bounds[0], this->Bounds[2], this->Bounds[4]);
+  im->SetSpacing((this->Bounds[1] - this->Bounds[0]) / this->Dims[0],
+    (this->Bounds[3] - this->Bounds[2]) / this->Dims[1],
+    (this->Bounds[5] - this->Bounds[4]) / this->Dims[2]);
+  im->SetDimensions(this->Dims[0] + 1, this->Dims[1] + 1, this->Dims[2] + 1);
+
+  const char *names[] = {"density", "velocity", "velocity_dispersion"};
+  const std::vector<double> *fields[] = {&this->Density, &this->Velocity,
+    &this->Dispersion};
+  int nComps[] = {1, 3, 1};
+
+  for (int i = 0; i < 3; ++i)
+    {
+    if (fields[i]->empty())
+      continue;
+
+    vtkDoubleArray *da = vtkDoubleArray::New();
+    da->SetName(names[i]);
+    da->SetNumberOfComponents(nComps[i]);
+    da->SetNumberOfTuples(fields[i]->size() / nComps[i]);
+    std::copy(fields[i]->begin(), fields[i]->end(), da->GetPointer(0));
+    im->GetCellData()->AddArray(da);
+    da->Delete();
+    }
+
+  vtkDoubleArray *ta = vtkDoubleArray::New();
+  ta->SetName("TimeValue");
+  ta->SetNumberOfTuples(1);
+  ta->SetValue(0, time);
+  im->GetFieldData()->AddArray(ta);
+  ta->Delete();
+
+  char fname[1024] = {'\0'};
+  snprintf(fname, 1024, "%s_%s_%d.vti", this->FileName.c_str(),
+    this->MeshName.c_str(), step);
+
+  vtkXMLImageDataWriter *w = vtkXMLImageDataWriter::New();
+  w->SetInputData(im);
+  w->SetFileName(fname);
+  int ok = w->Write();
+  w->Delete();
+  im->Delete();
+
+  if (!ok)
+    {
+    SENSEI_ERROR("Failed to write \"" << fname << "\"")
+    return -1;
+    }
+
+  return 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+int ParticleDeposition::GetGrid(std::vector<double> &density,
+  std::vector<double> &velocity, std::vector<double> &dispersion)
+{
+  density = this->Density;
+  velocity = this->Velocity;
+  dispersion = this->Dispersion;
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int ParticleDeposition::Finalize()
+{
+  this->Density.clear();
+  this->Velocity.clear();
+  this->Dispersion.clear();
+  return 0;
+}
+
+}
@@ -0,0 +1,115 @@
+#ifndef sensei_ParticleDeposition_h
+#define sensei_ParticleDeposition_h
+
+#include "AnalysisAdaptor.h"
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+class vtkCompositeDataSet;
+
+namespace sensei
+{
+
+/// @class ParticleDeposition
+/// @brief Deposits particles onto a uniform grid.
+///
+/// The number density of the particles of a mesh, and optionally the mean
+/// and dispersion of their velocity, are computed on a uniform grid of
+/// cells covering user given bounds. Each particle is assigned to the cell
+/// containing it (NGP, nearest grid point) or shared with the 8 cells
+/// around it by linear weights (CIC, cloud in cell). Particles outside of
+/// the bounds, and the parts of their clouds that are, are dropped.
+///
+/// Each thread deposits into a private grid covering only the cells the
+/// rank's particles can reach, the thread grids are summed once, and the
+/// ranks' grids are summed into the global grid on rank 0. Ghost
+/// particles, marked by the vtkGhostType point array, are skipped.
+///
+/// The results are written by rank 0 to <file>_<mesh>_<step>.vti, a
+/// vtkImageData whose cell data holds the arrays "density", and, when a
+/// velocity array is given, "velocity" and "velocity_dispersion". Writing
+/// requires VTK's XML I/O, without a file name the results are only kept
+/// for GetGrid.
+class ParticleDeposition : public AnalysisAdaptor
+{
+public:
+  static ParticleDeposition* New();
+  senseiTypeMacro(ParticleDeposition, AnalysisAdaptor);
+
+  /// the deposition schemes
+  enum {SCHEME_NGP=0, SCHEME_CIC=1};
+
+  /// get the scheme from its name, ngp or cic. returns zero if successful
+  static int GetScheme(const std::string &name, int &scheme);
+
+  /// @brief Set up the deposition.
+  ///
+  /// @param meshName the mesh of the particles, its points are their
+  ///        positions
+  /// @param velocityName a 3 component point array of the particle
+  ///        velocities, or empty to compute the density only
+  /// @param dims the number of cells of the grid in each direction
+  /// @param bounds the extent of the grid, x0, x1, y0, y1, z0, z1
+  /// @param scheme SCHEME_NGP or SCHEME_CIC
+  /// @param fileName the prefix of the output files, or empty
+  /// @returns zero if successful
+  int Initialize(const std::string &meshName, const std::string &velocityName,
+    const int dims[3], const double bounds[6], int scheme,
+    const std::string &fileName);
+
+  /// set the number of threads used to deposit the particles. the threads
+  /// are those of the TaskRuntime, a value less than 1 uses all of them.
+  /// the default is 1.
+  void SetNumberOfThreads(int nThreads);
+
+  bool Execute(DataAdaptor* data) override;
+
+  int Finalize() override;
+
+  /// @brief Get the results of the last step on rank 0.
+  ///
+  /// The values are those of the cells, x varying fastest. density is the
+  /// number of particles per unit volume. velocity, the mean velocity, has
+  /// 3 components per cell, and dispersion is the variance of the
+  /// velocities about it summed over the components. Both are empty
+  /// without a velocity array and zero in cells without particles.
+  int GetGrid(std::vector<double> &density, std::vector<double> &velocity,
+    std::vector<double> &dispersion);
+
+protected:
+  ParticleDeposition();
+  ~ParticleDeposition();
+
+  ParticleDeposition(const ParticleDeposition&) = delete;
+  void operator=(const ParticleDeposition&) = delete;
+
+  // find box, the cells the local particles reach, and deposit them into
+  // grid, nMoments sums per cell of box. returns zero if successful
+  int DepositLocal(vtkCompositeDataSet *mesh, int box[6], int nMoments,
+    std::vector<double> &grid);
+
+  // sum the grids of the ranks on rank 0 and find the fields
+  int Reduce(const int box[6], int nMoments, const std::vector<double> &grid);
+
+  // write the fields of the last step
+  int WriteResults(int step, double time);
+
+  static const char *GetGhostArrayName();
+
+  std::string MeshName;
+  std::string VelocityName;
+  int Dims[3];
+  double Bounds[6];
+  int Scheme;
+  std::string FileName;
+  int Threads;
+
+  std::vector<double> Density;
+  std::vector<double> Velocity;
+  std::vector<double> Dispersion;
+};
+
+}
+
+#endif
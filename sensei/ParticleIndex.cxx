@@ -0,0 +1,831 @@
+#include "ParticleIndex.h"
+#include "TaskRuntime.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkPointData.h>
+#include <vtkPointSet.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+// the number of histogram bins used to place a split
+const int numBins = 512;
+
+// the most particles in a leaf of the local tree
+const long leafSize = 16;
+
+// the particles counted by a thread at a time
+const long countChunkSize = 1024;
+
+// a particle as it is moved between ranks
+struct Record
+{
+  double X[3];
+  long long Id;
+  long long Rank;
+};
+
+// a node of the tree of regions, known to all ranks. the ranks in
+// [Rank0, Rank1) share the node's region, a leaf has one rank
+struct RegionNode
+{
+  std::array<double,6> Bounds;
+  int Rank0;
+  int Rank1;
+  int Dim;
+  double Split;
+  int Left;   // -1 for leaves
+  int Right;
+};
+
+// a node of the local tree, the particles [Begin, End) of the order
+struct LocalNode
+{
+  long Begin;
+  long End;
+  int Dim;
+  double Split;
+  int Left;   // -1 for leaves
+  int Right;
+};
+
+// --------------------------------------------------------------------------
+const char *ghostArrayName()
+{
+#if VTK_MAJOR_VERSION == 6 && VTK_MINOR_VERSION == 1
+    return "vtkGhostType";
+#else
+    return vtkDataSetAttributes::GhostArrayName();
+#endif
+}
+
+// --------------------------------------------------------------------------
+// append the points of a block that are not ghosts, and their index
+// among the points of the rank's blocks
+template <typename T>
+void appendPoints(vtkDataArray *da, const T *vals, const unsigned char *ghosts,
+  long long offset, std::vector<double> &x, std::vector<long long> &ids)
+{
+  long n = da->GetNumberOfTuples();
+  for (long i = 0; i < n; ++i)
+    {
+    if (ghosts && ghosts[i])
+      continue;
+
+    double p[3];
+    if (vals)
+      {
+      p[0] = static_cast<double>(vals[3*i]);
+      p[1] = static_cast<double>(vals[3*i+1]);
+      p[2] = static_cast<double>(vals[3*i+2]);
+      }
+    else
+      {
+      da->GetTuple(i, p);
+      }
+
+    x.insert(x.end(), p, p + 3);
+    ids.push_back(offset + i);
+    }
+}
+
+// --------------------------------------------------------------------------
+int appendPoints(vtkPointSet *ps, long long &offset, std::vector<double> &x,
+  std::vector<long long> &ids)
+{
+  if (!ps->GetPoints() || !ps->GetNumberOfPoints())
+    return 0;
+
+  vtkDataArray *da = ps->GetPoints()->GetData();
+
+  vtkUnsignedCharArray *ghostArray = dynamic_cast<vtkUnsignedCharArray*>(
+    ps->GetPointData()->GetArray(ghostArrayName()));
+
+  const unsigned char *ghosts =
+    ghostArray ? ghostArray->GetPointer(0) : nullptr;
+
+  // arrays with the standard layout are read in place
+  bool inPlace = da->HasStandardMemoryLayout();
+
+  switch (da->GetDataType())
+    {
+    vtkTemplateMacro(
+      appendPoints(da, inPlace ?
+        static_cast<VTK_TT*>(da->GetVoidPointer(0)) : nullptr,
+        ghosts, offset, x, ids);
+      );
+    default:
+      SENSEI_ERROR("Unsupported point type " << da->GetDataTypeAsString())
+      return -1;
+    }
+
+  offset += da->GetNumberOfTuples();
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+// send the records in out[i] to rank i and receive those sent to this rank
+void exchange(MPI_Comm comm, MPI_Datatype type,
+  const std::vector<std::vector<Record>> &out, std::vector<Record> &in)
+{
+  int nRanks = out.size();
+
+  std::vector<int> sendCounts(nRanks);
+  std::vector<int> sendDispls(nRanks);
+  std::vector<int> recvCounts(nRanks);
+  std::vector<int> recvDispls(nRanks);
+
+  int nSend = 0;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    sendCounts[i] = out[i].size();
+    sendDispls[i] = nSend;
+    nSend += sendCounts[i];
+    }
+
+  std::vector<Record> sendBuf;
+  sendBuf.reserve(nSend);
+  for (int i = 0; i < nRanks; ++i)
+    sendBuf.insert(sendBuf.end(), out[i].begin(), out[i].end());
+
+  MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT,
+    comm);
+
+  int nRecv = 0;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    recvDispls[i] = nRecv;
+    nRecv += recvCounts[i];
+    }
+
+  in.resize(nRecv);
+
+  MPI_Alltoallv(sendBuf.data(), sendCounts.data(), sendDispls.data(), type,
+    in.data(), recvCounts.data(), recvDispls.data(), type, comm);
+}
+}
+
+namespace sensei
+{
+
+struct ParticleIndex::InternalsType
+{
+  // the rank whose region holds x
+  int Route(const double *x) const;
+
+  // the ranks whose regions are within r of x
+  void Overlapping(const double *x, double r, std::vector<int> &ranks) const;
+
+  // split the space spanned by the particles into a region per rank
+  void BuildRegions(MPI_Comm comm, const std::vector<double> &x);
+
+  // build the tree over the local particles
+  void BuildLocalTree();
+
+  // call f with the index of each local particle within r of x
+  template <typename func_t>
+  void Visit(const double *x, double r, func_t &f) const;
+
+  std::vector<RegionNode> Regions;
+  std::vector<int> Leaves;   // the region of each rank
+
+  long NumOwned = 0;
+  std::vector<double> Points;
+  std::vector<int> SourceRanks;
+  std::vector<long long> SourceIds;
+
+  std::vector<long> Order;
+  std::vector<LocalNode> Nodes;
+};
+
+// --------------------------------------------------------------------------
+int ParticleIndex::InternalsType::Route(const double *x) const
+{
+  int n = 0;
+  while (this->Regions[n].Left >= 0)
+    {
+    const RegionNode &r = this->Regions[n];
+    n = x[r.Dim] < r.Split ? r.Left : r.Right;
+    }
+  return this->Regions[n].Rank0;
+}
+
+// --------------------------------------------------------------------------
+void ParticleIndex::InternalsType::Overlapping(const double *x, double r,
+  std::vector<int> &ranks) const
+{
+  ranks.clear();
+
+  std::vector<int> stack(1, 0);
+  while (!stack.empty())
+    {
+    const RegionNode &n = this->Regions[stack.back()];
+    stack.pop_back();
+
+    if (n.Left < 0)
+      {
+      ranks.push_back(n.Rank0);
+      continue;
+      }
+
+    if (x[n.Dim] - r < n.Split)
+      stack.push_back(n.Left);
+
+    if (x[n.Dim] + r >= n.Split)
+      stack.push_back(n.Right);
+    }
+}
+
+// --------------------------------------------------------------------------
+void ParticleIndex::InternalsType::BuildRegions(MPI_Comm comm,
+  const std::vector<double> &x)
+{
+  TimeEvent<128> mark("ParticleIndex::BuildRegions");
+
+  int nRanks = 1;
+  MPI_Comm_size(comm, &nRanks);
+
+  long n = x.size() / 3;
+
+  // the bounds of all of the particles, the upper bounds are negated so
+  // that a single reduction finds both
+  double ext[6] = {std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::max()};
+
+  for (long i = 0; i < n; ++i)
+    {
+    for (int q = 0; q < 3; ++q)
+      {
+      ext[q] = std::min(ext[q], x[3*i+q]);
+      ext[q+3] = std::min(ext[q+3], -x[3*i+q]);
+      }
+    }
+
+  MPI_Allreduce(MPI_IN_PLACE, ext, 6, MPI_DOUBLE, MPI_MIN, comm);
+
+  RegionNode root;
+  for (int q = 0; q < 3; ++q)
+    {
+    bool empty = ext[q] > -ext[q+3];
+    root.Bounds[2*q] = empty ? 0.0 : ext[q];
+    root.Bounds[2*q+1] = empty ? 0.0 : -ext[q+3];
+    }
+  root.Rank0 = 0;
+  root.Rank1 = nRanks;
+  root.Dim = 0;
+  root.Split = 0.0;
+  root.Left = -1;
+  root.Right = -1;
+
+  this->Regions.assign(1, root);
+
+  // the regions are split a level at a time, the histograms of all of the
+  // regions of a level are reduced together. node holds the region each
+  // particle is in at the current level
+  std::vector<int> node(n, 0);
+  std::vector<int> active;
+  if (nRanks > 1)
+    active.push_back(0);
+
+  while (!active.empty())
+    {
+    size_t nActive = active.size();
+
+    std::vector<int> slot(this->Regions.size(), -1);
+    for (size_t a = 0; a < nActive; ++a)
+      {
+      RegionNode &r = this->Regions[active[a]];
+      slot[active[a]] = a;
+
+      // split the longest side
+      double len = -1.0;
+      for (int q = 0; q < 3; ++q)
+        {
+        double lq = r.Bounds[2*q+1] - r.Bounds[2*q];
+        if (lq > len)
+          {
+          len = lq;
+          r.Dim = q;
+          }
+        }
+      }
+
+    std::vector<long> hist(nActive*numBins, 0);
+    for (long i = 0; i < n; ++i)
+      {
+      int s = slot[node[i]];
+      if (s < 0)
+        continue;
+
+      const RegionNode &r = this->Regions[node[i]];
+      double lo = r.Bounds[2*r.Dim];
+      double w = (r.Bounds[2*r.Dim+1] - lo) / numBins;
+
+      int b = w > 0.0 ? static_cast<int>((x[3*i+r.Dim] - lo) / w) : 0;
+      b = std::max(0, std::min(numBins - 1, b));
+
+      ++hist[s*numBins + b];
+      }
+
+    MPI_Allreduce(MPI_IN_PLACE, hist.data(), hist.size(), MPI_LONG, MPI_SUM,
+      comm);
+
+    std::vector<int> next;
+    for (size_t a = 0; a < nActive; ++a)
+      {
+      int id = active[a];
+      RegionNode r = this->Regions[id];
+
+      int nLeft = (r.Rank1 - r.Rank0) / 2;
+      double frac = double(nLeft) / (r.Rank1 - r.Rank0);
+
+      double lo = r.Bounds[2*r.Dim];
+      double w = (r.Bounds[2*r.Dim+1] - lo) / numBins;
+
+      // split at the bin edge that comes closest to giving the left ranks
+      // their share of the particles, or in proportion to the number of
+      // ranks when there are none
+      const long *h = hist.data() + a*numBins;
+      long total = std::accumulate(h, h + numBins, 0l);
+
+      double split = lo + frac*numBins*w;
+      if (total > 0)
+        {
+        double target = frac*total;
+        double best = target;
+        long sum = 0;
+        for (int e = 1; e <= numBins; ++e)
+          {
+          sum += h[e-1];
+          if (std::fabs(sum - target) < best)
+            {
+            best = std::fabs(sum - target);
+            split = lo + e*w;
+            }
+          }
+        }
+
+      RegionNode left = r;
+      left.Bounds[2*r.Dim+1] = split;
+      left.Rank1 = r.Rank0 + nLeft;
+
+      RegionNode right = r;
+      right.Bounds[2*r.Dim] = split;
+      right.Rank0 = r.Rank0 + nLeft;
+
+      int il = this->Regions.size();
+      this->Regions[id].Split = split;
+      this->Regions[id].Left = il;
+      this->Regions[id].Right = il + 1;
+
+      this->Regions.push_back(left);
+      this->Regions.push_back(right);
+
+      if (left.Rank1 - left.Rank0 > 1)
+        next.push_back(il);
+
+      if (right.Rank1 - right.Rank0 > 1)
+        next.push_back(il + 1);
+      }
+
+    // move the particles into the regions of the next level
+    for (long i = 0; i < n; ++i)
+      {
+      const RegionNode &r = this->Regions[node[i]];
+      if (r.Left >= 0)
+        node[i] = x[3*i+r.Dim] < r.Split ? r.Left : r.Right;
+      }
+
+    active.swap(next);
+    }
+
+  this->Leaves.resize(nRanks);
+  for (size_t i = 0; i < this->Regions.size(); ++i)
+    {
+    if (this->Regions[i].Left < 0)
+      this->Leaves[this->Regions[i].Rank0] = i;
+    }
+}
+
+// --------------------------------------------------------------------------
+void ParticleIndex::InternalsType::BuildLocalTree()
+{
+  TimeEvent<128> mark("ParticleIndex::BuildLocalTree");
+
+  long n = this->SourceIds.size();
+
+  this->Order.resize(n);
+  std::iota(this->Order.begin(), this->Order.end(), 0l);
+
+  this->Nodes.clear();
+  if (!n)
+    return;
+
+  LocalNode root = {0, n, 0, 0.0, -1, -1};
+  this->Nodes.push_back(root);
+
+  const double *px = this->Points.data();
+
+  std::vector<int> stack(1, 0);
+  while (!stack.empty())
+    {
+    int id = stack.back();
+    stack.pop_back();
+
+    LocalNode nd = this->Nodes[id];
+    if (nd.End - nd.Begin <= leafSize)
+      continue;
+
+    // split the longest side of the particles' bounds at the median
+    double lo[3] = {std::numeric_limits<double>::max(),
+      std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+    double hi[3] = {std::numeric_limits<double>::lowest(),
+      std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+
+    for (long i = nd.Begin; i < nd.End; ++i)
+      {
+      const double *p = px + 3*this->Order[i];
+      for (int q = 0; q < 3; ++q)
+        {
+        lo[q] = std::min(lo[q], p[q]);
+        hi[q] = std::max(hi[q], p[q]);
+        }
+      }
+
+    int d = 0;
+    for (int q = 1; q < 3; ++q)
+      {
+      if (hi[q] - lo[q] > hi[d] - lo[d])
+        d = q;
+      }
+
+    // the particles coincide
+    if (!(hi[d] > lo[d]))
+      continue;
+
+    long mid = (nd.Begin + nd.End) / 2;
+    std::nth_element(this->Order.begin() + nd.Begin,
+      this->Order.begin() + mid, this->Order.begin() + nd.End,
+      [px, d](long a, long b) { return px[3*a+d] < px[3*b+d]; });
+
+    int il = this->Nodes.size();
+
+    LocalNode &split = this->Nodes[id];
+    split.Dim = d;
+    split.Split = px[3*this->Order[mid]+d];
+    split.Left = il;
+    split.Right = il + 1;
+
+    LocalNode left = {nd.Begin, mid, 0, 0.0, -1, -1};
+    LocalNode right = {mid, nd.End, 0, 0.0, -1, -1};
+    this->Nodes.push_back(left);
+    this->Nodes.push_back(right);
+
+    stack.push_back(il);
+    stack.push_back(il + 1);
+    }
+}
+
+// --------------------------------------------------------------------------
+template <typename func_t>
+void ParticleIndex::InternalsType::Visit(const double *x, double r,
+  func_t &f) const
+{
+  if (this->Nodes.empty())
+    return;
+
+  const double *px = this->Points.data();
+  double r2 = r*r;
+
+  // the particles left of a split are not above it, those right of it
+  // are not below it
+  std::vector<int> stack(1, 0);
+  while (!stack.empty())
+    {
+    const LocalNode &nd = this->Nodes[stack.back()];
+    stack.pop_back();
+
+    if (nd.Left < 0)
+      {
+      for (long i = nd.Begin; i < nd.End; ++i)
+        {
+        long j = this->Order[i];
+        const double *p = px + 3*j;
+        double dx = p[0] - x[0];
+        double dy = p[1] - x[1];
+        double dz = p[2] - x[2];
+        if (dx*dx + dy*dy + dz*dz <= r2)
+          f(j);
+        }
+      continue;
+      }
+
+    if (x[nd.Dim] - r <= nd.Split)
+      stack.push_back(nd.Left);
+
+    if (x[nd.Dim] + r >= nd.Split)
+      stack.push_back(nd.Right);
+    }
+}
+
+// --------------------------------------------------------------------------
+ParticleIndex::ParticleIndex() : Comm(MPI_COMM_WORLD), GhostRadius(0.0),
+  ImbalanceTolerance(0.1), RegionsReused(false), Internals(new InternalsType)
+{
+}
+
+// --------------------------------------------------------------------------
+ParticleIndex::~ParticleIndex()
+{
+  delete this->Internals;
+}
+
+// --------------------------------------------------------------------------
+void ParticleIndex::SetCommunicator(MPI_Comm comm)
+{
+  this->Comm = comm;
+  this->Clear();
+}
+
+// --------------------------------------------------------------------------
+void ParticleIndex::SetGhostRadius(double r)
+{
+  this->GhostRadius = std::max(0.0, r);
+}
+
+// --------------------------------------------------------------------------
+void ParticleIndex::SetImbalanceTolerance(double tol)
+{
+  this->ImbalanceTolerance = std::max(0.0, tol);
+}
+
+// --------------------------------------------------------------------------
+void ParticleIndex::Clear()
+{
+  delete this->Internals;
+  this->Internals = new InternalsType;
+  this->RegionsReused = false;
+}
+
+// --------------------------------------------------------------------------
+int ParticleIndex::Build(vtkDataObject *particles)
+{
+  TimeEvent<128> mark("ParticleIndex::Build");
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(this->Comm, &rank);
+  MPI_Comm_size(this->Comm, &nRanks);
+
+  InternalsType *internals = this->Internals;
+
+  // the local particles. errors are agreed on before communicating
+  std::vector<double> x;
+  std::vector<long long> ids;
+  long long offset = 0;
+
+  int ierr = 0;
+  if (vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(particles))
+    {
+    vtkSmartPointer<vtkCompositeDataIterator> iter;
+    iter.TakeReference(cd->NewIterator());
+
+    for (iter->InitTraversal(); !ierr && !iter->IsDoneWithTraversal();
+      iter->GoToNextItem())
+      {
+      if (vtkPointSet *ps = dynamic_cast<vtkPointSet*>(iter->GetCurrentDataObject()))
+        ierr = appendPoints(ps, offset, x, ids);
+      }
+    }
+  else if (vtkPointSet *ps = dynamic_cast<vtkPointSet*>(particles))
+    {
+    ierr = appendPoints(ps, offset, x, ids);
+    }
+  else if (particles)
+    {
+    SENSEI_ERROR("Particles must be a vtkPointSet or a composite of them, not "
+      << particles->GetClassName())
+    ierr = -1;
+    }
+
+  MPI_Allreduce(MPI_IN_PLACE, &ierr, 1, MPI_INT, MPI_MIN, this->Comm);
+  if (ierr)
+    {
+    SENSEI_ERROR("Failed to get the particles")
+    return -1;
+    }
+
+  // the regions are kept while the load they give stays balanced
+  long n = ids.size();
+  std::vector<int> dest(n);
+
+  bool reuse = false;
+  if (!internals->Regions.empty() && (this->ImbalanceTolerance > 0.0))
+    {
+    std::vector<long> load(nRanks, 0);
+    for (long i = 0; i < n; ++i)
+      {
+      dest[i] = internals->Route(&x[3*i]);
+      ++load[dest[i]];
+      }
+
+    MPI_Allreduce(MPI_IN_PLACE, load.data(), nRanks, MPI_LONG, MPI_SUM,
+      this->Comm);
+
+    long total = std::accumulate(load.begin(), load.end(), 0l);
+    long maxLoad = *std::max_element(load.begin(), load.end());
+
+    reuse = maxLoad <= (1.0 + this->ImbalanceTolerance)*total/nRanks;
+    }
+
+  if (!reuse)
+    {
+    internals->BuildRegions(this->Comm, x);
+
+    for (long i = 0; i < n; ++i)
+      dest[i] = internals->Route(&x[3*i]);
+    }
+
+  this->RegionsReused = reuse;
+
+  MPI_Datatype recordType;
+  MPI_Type_contiguous(sizeof(Record), MPI_BYTE, &recordType);
+  MPI_Type_commit(&recordType);
+
+  // move the particles to the ranks of their regions
+  std::vector<Record> owned;
+  {
+  TimeEvent<128> mark("ParticleIndex::MoveParticles");
+
+  std::vector<std::vector<Record>> out(nRanks);
+  for (long i = 0; i < n; ++i)
+    {
+    Record rec = {{x[3*i], x[3*i+1], x[3*i+2]}, ids[i], rank};
+    out[dest[i]].push_back(rec);
+    }
+
+  std::vector<double>().swap(x);
+  std::vector<long long>().swap(ids);
+
+  exchange(this->Comm, recordType, out, owned);
+  }
+
+  // copy the particles near the boundaries to the regions next to them
+  std::vector<Record> ghosts;
+  if (this->GhostRadius > 0.0)
+    {
+    TimeEvent<128> mark("ParticleIndex::MoveGhosts");
+
+    std::vector<std::vector<Record>> out(nRanks);
+    std::vector<int> ranks;
+
+    size_t nOwned = owned.size();
+    for (size_t i = 0; i < nOwned; ++i)
+      {
+      internals->Overlapping(owned[i].X, this->GhostRadius, ranks);
+      for (int r : ranks)
+        {
+        if (r != rank)
+          out[r].push_back(owned[i]);
+        }
+      }
+
+    exchange(this->Comm, recordType, out, ghosts);
+    }
+
+  MPI_Type_free(&recordType);
+
+  // keep the local particles, those of the region first
+  size_t nOwned = owned.size();
+  size_t nLocal = nOwned + ghosts.size();
+
+  internals->NumOwned = nOwned;
+  internals->Points.resize(3*nLocal);
+  internals->SourceRanks.resize(nLocal);
+  internals->SourceIds.resize(nLocal);
+
+  for (size_t i = 0; i < nLocal; ++i)
+    {
+    const Record &rec = i < nOwned ? owned[i] : ghosts[i - nOwned];
+    std::copy(rec.X, rec.X + 3, &internals->Points[3*i]);
+    internals->SourceRanks[i] = rec.Rank;
+    internals->SourceIds[i] = rec.Id;
+    }
+
+  internals->BuildLocalTree();
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+void ParticleIndex::GetBounds(double bounds[6]) const
+{
+  int rank = 0;
+  MPI_Comm_rank(this->Comm, &rank);
+
+  const InternalsType *internals = this->Internals;
+  if (internals->Leaves.empty())
+    {
+    std::fill(bounds, bounds + 6, 0.0);
+    return;
+    }
+
+  const RegionNode &r = internals->Regions[internals->Leaves[rank]];
+  std::copy(r.Bounds.begin(), r.Bounds.end(), bounds);
+}
+
+// --------------------------------------------------------------------------
+long ParticleIndex::GetNumberOfPoints() const
+{
+  return this->Internals->NumOwned;
+}
+
+// --------------------------------------------------------------------------
+long ParticleIndex::GetNumberOfGhosts() const
+{
+  return this->Internals->SourceIds.size() - this->Internals->NumOwned;
+}
+
+// --------------------------------------------------------------------------
+const std::vector<double> &ParticleIndex::GetPoints() const
+{
+  return this->Internals->Points;
+}
+
+// --------------------------------------------------------------------------
+const std::vector<int> &ParticleIndex::GetSourceRanks() const
+{
+  return this->Internals->SourceRanks;
+}
+
+// --------------------------------------------------------------------------
+const std::vector<long long> &ParticleIndex::GetSourceIds() const
+{
+  return this->Internals->SourceIds;
+}
+
+// --------------------------------------------------------------------------
+int ParticleIndex::RadiusQuery(const double x[3], double r,
+  std::vector<long> &ids) const
+{
+  ids.clear();
+
+  auto found = [&ids](long j) { ids.push_back(j); };
+  this->Internals->Visit(x, r, found);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ParticleIndex::CountNeighbors(double r, std::vector<long> &counts,
+  int nThreads) const
+{
+  TimeEvent<128> mark("ParticleIndex::CountNeighbors");
+
+  const InternalsType *internals = this->Internals;
+
+  long nOwned = internals->NumOwned;
+  counts.assign(nOwned, 0);
+
+  if (nThreads < 1)
+    nThreads = TaskRuntime::GetNumberOfThreads();
+
+  long nChunks = (nOwned + countChunkSize - 1) / countChunkSize;
+
+  return TaskRuntime::ParallelFor(nChunks, nThreads,
+    [&](int, long c) -> int
+    {
+    long i0 = c*countChunkSize;
+    long i1 = std::min(i0 + countChunkSize, nOwned);
+
+    for (long i = i0; i < i1; ++i)
+      {
+      long count = 0;
+      auto found = [&count, i](long j) { count += j != i; };
+      internals->Visit(&internals->Points[3*i], r, found);
+      counts[i] = count;
+      }
+
+    return 0;
+    });
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef sensei_ParticleIndex_h
+#define sensei_ParticleIndex_h
+
+#include <mpi.h>
+#include <vector>
+
+class vtkDataObject;
+
+namespace sensei
+{
+
+/// @class ParticleIndex
+/// @brief a distributed k-d tree over the particles of a mesh.
+///
+/// Analyses of particles, such as neighbor counts, clustering or halo
+/// finding, query the particles near a point, which may be held by other
+/// ranks, most of all after in transit repartitioning where the blocks a
+/// rank receives need not be near each other. ParticleIndex splits the
+/// space spanned by the particles into one region per rank by recursive
+/// bisection, each split balancing the number of particles on either side,
+/// moves each particle to the rank of its region, and copies the
+/// particles within the ghost radius of a region's boundary to it. A local
+/// k-d tree over each rank's particles and ghosts then answers queries of
+/// up to the ghost radius without communicating.
+///
+/// The splits are found from histograms reduced over all ranks, one
+/// MPI_Allreduce per level of the tree, and the particles are moved with
+/// one exchange. When the particles move little between steps the regions
+/// are kept for as long as the load stays within the imbalance tolerance,
+/// skipping the reductions, and only the particles are moved. Ghost
+/// particles of the input, marked by the vtkGhostType point array, are
+/// skipped. Boundaries are not periodic. Build is collective over the
+/// communicator, the queries are local.
+class ParticleIndex
+{
+public:
+  ParticleIndex();
+  ~ParticleIndex();
+
+  /// Set the communicator. Clears the index.
+  void SetCommunicator(MPI_Comm comm);
+  MPI_Comm GetCommunicator() const { return this->Comm; }
+
+  /// Set the distance from a region within which the particles of
+  /// neighboring regions are copied in as ghosts. Queries of a larger
+  /// radius may miss particles held by other ranks. The default is 0.
+  void SetGhostRadius(double r);
+  double GetGhostRadius() const { return this->GhostRadius; }
+
+  /// Set how far the load may grow past the mean before the regions are
+  /// found again, as a fraction of the mean. 0 finds them in every Build.
+  /// The default is 0.1.
+  void SetImbalanceTolerance(double tol);
+  double GetImbalanceTolerance() const { return this->ImbalanceTolerance; }
+
+  /// @brief Build the index from the local particles.
+  ///
+  /// The particles are the points of the vtkPointSet blocks of particles,
+  /// which may be a single dataset or a composite dataset, and may be
+  /// empty on some ranks.
+  ///
+  /// @param[in] particles the local particles
+  /// @returns zero if successful
+  int Build(vtkDataObject *particles);
+
+  /// true when the last Build kept the regions of the one before it
+  bool GetRegionsReused() const { return this->RegionsReused; }
+
+  /// get the bounds of this rank's region, x0, x1, y0, y1, z0, z1
+  void GetBounds(double bounds[6]) const;
+
+  /// get the number of particles of this rank's region, and of the ghost
+  /// particles copied in from the regions next to it
+  long GetNumberOfPoints() const;
+  long GetNumberOfGhosts() const;
+
+  /// get the positions of the local particles, 3 per particle. the
+  /// particles of the region come first followed by the ghosts
+  const std::vector<double> &GetPoints() const;
+
+  /// get where each local particle came from, the rank that passed it to
+  /// Build and its index among the points of that rank's blocks taken in
+  /// order
+  const std::vector<int> &GetSourceRanks() const;
+  const std::vector<long long> &GetSourceIds() const;
+
+  /// find the local particles, those of the region and the ghosts, within
+  /// r of x. the indices of the local particles are returned in ids
+  int RadiusQuery(const double x[3], double r, std::vector<long> &ids) const;
+
+  /// count, for each particle of the region, the other particles within r
+  /// of it. the particles are split over nThreads threads of the
+  /// TaskRuntime, < 1 uses all of them
+  int CountNeighbors(double r, std::vector<long> &counts, int nThreads = 1) const;
+
+  /// release the regions and the particles
+  void Clear();
+
+private:
+  ParticleIndex(const ParticleIndex&) = delete;
+  void operator=(const ParticleIndex&) = delete;
+
+  MPI_Comm Comm;
+  double GhostRadius;
+  double ImbalanceTolerance;
+  bool RegionsReused;
+
+  struct InternalsType;
+  InternalsType *Internals;
+};
+
+}
+
+#endif
@@ -0,0 +1,791 @@
+#include "ParticleTracer.h"
+#include "BlockIndex.h"
+#include "DataAdaptor.h"
+#include "MeshMetadata.h"
+#include "MeshMetadataMap.h"
+#include "Profiler.h"
+#include "TaskRuntime.h"
+#include "VTKUtils.h"
+#include "Error.h"
+
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <limits>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using Particle = sensei::ParticleTracer::Particle;
+using Sample = sensei::ParticleTracer::Sample;
+
+namespace
+{
+// the particles of a block advected by a thread at a time
+const long chunkSize = 512;
+
+// a local block and the lattice its velocity is given on
+struct LocalBlock
+{
+  vtkDataArray *Velocity;
+  double Lo[3];       // the first point of the lattice
+  double Spacing[3];
+  long Dims[3];       // the points of the lattice along each axis
+  double Bounds[6];   // particles inside are advected on this block
+};
+
+// a range of the particles of a block
+struct Chunk
+{
+  int Block;
+  long Begin;
+  long End;
+};
+
+// --------------------------------------------------------------------------
+// get the lattice of the points, or of the cell centers
+int getBlock(vtkImageData *im, vtkDataArray *vel, int association,
+  LocalBlock &b)
+{
+  int ext[6];
+  im->GetExtent(ext);
+  double *origin = im->GetOrigin();
+  double *spacing = im->GetSpacing();
+
+  bool cells = association == vtkDataObject::CELL;
+
+  long nVals = 1;
+  for (int q = 0; q < 3; ++q)
+    {
+    b.Spacing[q] = spacing[q];
+    b.Bounds[2*q] = origin[q] + spacing[q]*ext[2*q];
+    b.Bounds[2*q+1] = origin[q] + spacing[q]*ext[2*q+1];
+
+    long n = ext[2*q+1] - ext[2*q];
+    if (cells && (n > 0))
+      {
+      b.Dims[q] = n;
+      b.Lo[q] = b.Bounds[2*q] + 0.5*spacing[q];
+      }
+    else
+      {
+      b.Dims[q] = n + 1;
+      b.Lo[q] = b.Bounds[2*q];
+      }
+
+    nVals *= b.Dims[q];
+    }
+
+  b.Velocity = vel;
+
+  if ((vel->GetNumberOfComponents() != 3) || (vel->GetNumberOfTuples() != nVals))
+    return -1;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+bool inside(const double *bounds, const double *x)
+{
+  return (x[0] >= bounds[0]) && (x[0] <= bounds[1]) &&
+    (x[1] >= bounds[2]) && (x[1] <= bounds[3]) &&
+    (x[2] >= bounds[4]) && (x[2] <= bounds[5]);
+}
+
+// --------------------------------------------------------------------------
+// interpolate the velocity at n positions, given by their coordinates.
+// the lattice index and weights of all of the positions are found first,
+// in loops without branches that the compiler vectorizes, and the values
+// of the corners are gathered after. positions outside of the lattice
+// take the value at its boundary
+template <typename T>
+void interpolate(const LocalBlock &b, const T *vel, long n,
+  const double * const p[3], double * const u[3], std::vector<long> &index,
+  std::vector<double> &frac)
+{
+  index.resize(3*n);
+  frac.resize(3*n);
+
+  for (int q = 0; q < 3; ++q)
+    {
+    long nq = b.Dims[q];
+    long iMax = std::max(0l, nq - 2);
+    double tMax = nq - 1;
+    double lo = b.Lo[q];
+    double inv = b.Spacing[q] > 0.0 ? 1.0/b.Spacing[q] : 0.0;
+
+    const double *pq = p[q];
+    long *iq = index.data() + q*n;
+    double *fq = frac.data() + q*n;
+
+    for (long i = 0; i < n; ++i)
+      {
+      double t = std::max(0.0, std::min((pq[i] - lo)*inv, tMax));
+      long i0 = std::min(static_cast<long>(t), iMax);
+      iq[i] = i0;
+      fq[i] = t - i0;
+      }
+    }
+
+  long nx = b.Dims[0];
+  long nxy = b.Dims[0]*b.Dims[1];
+  long stride[3] = {b.Dims[0] > 1 ? 1 : 0, b.Dims[1] > 1 ? nx : 0,
+    b.Dims[2] > 1 ? nxy : 0};
+
+  for (long i = 0; i < n; ++i)
+    {
+    long base = index[i] + nx*index[n+i] + nxy*index[2*n+i];
+    double f[3] = {frac[i], frac[n+i], frac[2*n+i]};
+
+    double acc[3] = {0.0, 0.0, 0.0};
+    for (int c = 0; c < 8; ++c)
+      {
+      int d[3] = {c & 1, (c >> 1) & 1, c >> 2};
+
+      double wt = (d[0] ? f[0] : 1.0 - f[0]) * (d[1] ? f[1] : 1.0 - f[1]) *
+        (d[2] ? f[2] : 1.0 - f[2]);
+
+      long id = base + d[0]*stride[0] + d[1]*stride[1] + d[2]*stride[2];
+
+      for (int q = 0; q < 3; ++q)
+        acc[q] += wt * (vel ? static_cast<double>(vel[3*id+q]) :
+          b.Velocity->GetComponent(id, q));
+      }
+
+    u[0][i] = acc[0];
+    u[1][i] = acc[1];
+    u[2][i] = acc[2];
+    }
+}
+
+// --------------------------------------------------------------------------
+// advance the particles with midpoint substeps of length h while they
+// stay in the block, all of the active particles a substep at a time.
+// those that leave are copied to leaving and their block set to -1
+template <typename T>
+void advect(const LocalBlock &b, const T *vel, Particle *ps, long n,
+  double h, std::vector<Particle> &leaving)
+{
+  std::vector<long> active;
+  for (long i = 0; i < n; ++i)
+    {
+    if (ps[i].Substeps > 0)
+      active.push_back(i);
+    }
+
+  std::vector<double> buf(12*n);
+  double *x[3] = {buf.data(), buf.data() + n, buf.data() + 2*n};
+  double *xm[3] = {buf.data() + 3*n, buf.data() + 4*n, buf.data() + 5*n};
+  double *u1[3] = {buf.data() + 6*n, buf.data() + 7*n, buf.data() + 8*n};
+  double *u2[3] = {buf.data() + 9*n, buf.data() + 10*n, buf.data() + 11*n};
+
+  std::vector<long> index;
+  std::vector<double> frac;
+  std::vector<long> next;
+
+  while (!active.empty())
+    {
+    long m = active.size();
+
+    for (long j = 0; j < m; ++j)
+      {
+      const double *pj = ps[active[j]].X;
+      x[0][j] = pj[0];
+      x[1][j] = pj[1];
+      x[2][j] = pj[2];
+      }
+
+    interpolate(b, vel, m, x, u1, index, frac);
+
+    for (int q = 0; q < 3; ++q)
+      {
+      for (long j = 0; j < m; ++j)
+        xm[q][j] = x[q][j] + 0.5*h*u1[q][j];
+      }
+
+    interpolate(b, vel, m, xm, u2, index, frac);
+
+    // take the step, with the velocity at the start when the midpoint is
+    // outside of the block
+    next.clear();
+    for (long j = 0; j < m; ++j)
+      {
+      Particle &p = ps[active[j]];
+
+      double mid[3] = {xm[0][j], xm[1][j], xm[2][j]};
+      double * const *u = inside(b.Bounds, mid) ? u2 : u1;
+
+      p.X[0] += h*u[0][j];
+      p.X[1] += h*u[1][j];
+      p.X[2] += h*u[2][j];
+      --p.Substeps;
+
+      if (!inside(b.Bounds, p.X))
+        {
+        leaving.push_back(p);
+        p.Block = -1;
+        }
+      else if (p.Substeps > 0)
+        {
+        next.push_back(active[j]);
+        }
+      }
+
+    active.swap(next);
+    }
+}
+
+// --------------------------------------------------------------------------
+int advectChunk(const LocalBlock &b, Particle *ps, long n, double h,
+  std::vector<Particle> &leaving)
+{
+  vtkDataArray *vel = b.Velocity;
+
+  // arrays with the standard layout are read in place
+  bool inPlace = vel->HasStandardMemoryLayout();
+
+  switch (vel->GetDataType())
+    {
+    vtkTemplateMacro(
+      advect(b, inPlace ? static_cast<VTK_TT*>(vel->GetVoidPointer(0)) :
+        nullptr, ps, n, h, leaving);
+      );
+    default:
+      return -1;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+// send the values in out[i] to rank i and receive those sent to this rank
+template <typename T>
+void exchange(MPI_Comm comm, const std::vector<std::vector<T>> &out,
+  std::vector<T> &in)
+{
+  int nRanks = out.size();
+
+  MPI_Datatype type;
+  MPI_Type_contiguous(sizeof(T), MPI_BYTE, &type);
+  MPI_Type_commit(&type);
+
+  std::vector<int> sendCounts(nRanks);
+  std::vector<int> sendDispls(nRanks);
+  std::vector<int> recvCounts(nRanks);
+  std::vector<int> recvDispls(nRanks);
+
+  std::vector<T> sendBuf;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    sendCounts[i] = out[i].size();
+    sendDispls[i] = sendBuf.size();
+    sendBuf.insert(sendBuf.end(), out[i].begin(), out[i].end());
+    }
+
+  MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT,
+    comm);
+
+  int nRecv = 0;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    recvDispls[i] = nRecv;
+    nRecv += recvCounts[i];
+    }
+
+  in.resize(nRecv);
+
+  MPI_Alltoallv(sendBuf.data(), sendCounts.data(), sendDispls.data(), type,
+    in.data(), recvCounts.data(), recvDispls.data(), type, comm);
+
+  MPI_Type_free(&type);
+}
+}
+
+namespace sensei
+{
+
+//-----------------------------------------------------------------------------
+senseiNewMacro(ParticleTracer);
+
+//-----------------------------------------------------------------------------
+ParticleTracer::ParticleTracer() : Association(vtkDataObject::POINT),
+  Dt(0.0), Substeps(1), Periodic(false), WriteInterval(1), Threads(1),
+  Seeded(false), LastStep(0), LastTime(0.0), StepsSinceWrite(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+ParticleTracer::~ParticleTracer()
+{
+}
+
+//-----------------------------------------------------------------------------
+int ParticleTracer::Initialize(const std::string &meshName,
+  const std::string &velocityName, int association,
+  const std::vector<double> &seeds, double dt, int substeps, bool periodic,
+  int writeInterval, const std::string &fileName)
+{
+  if ((association != vtkDataObject::POINT) &&
+    (association != vtkDataObject::CELL))
+    {
+    SENSEI_ERROR("The velocity must be point or cell data")
+    return -1;
+    }
+
+  if (seeds.size() % 3)
+    {
+    SENSEI_ERROR("The seeds must have 3 coordinates each")
+    return -1;
+    }
+
+  this->MeshName = meshName;
+  this->VelocityName = velocityName;
+  this->Association = association;
+  this->Seeds = seeds;
+  this->Dt = dt;
+  this->Substeps = std::max(1, substeps);
+  this->Periodic = periodic;
+  this->WriteInterval = std::max(1, writeInterval);
+  this->FileName = fileName;
+
+  this->Seeded = false;
+  this->StepsSinceWrite = 0;
+  this->Particles.clear();
+  this->Samples.clear();
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void ParticleTracer::GetRandomSeeds(const double bounds[6], long long n,
+  unsigned int seed, std::vector<double> &seeds)
+{
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+  seeds.resize(3*n);
+  for (long long i = 0; i < n; ++i)
+    {
+    for (int q = 0; q < 3; ++q)
+      seeds[3*i+q] = bounds[2*q] + dist(gen)*(bounds[2*q+1] - bounds[2*q]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void ParticleTracer::SetNumberOfThreads(int nThreads)
+{
+  this->Threads = nThreads < 1 ? TaskRuntime::GetNumberOfThreads() : nThreads;
+}
+
+//-----------------------------------------------------------------------------
+bool ParticleTracer::Execute(DataAdaptor* data)
+{
+  TimeEvent<128> mark("ParticleTracer::Execute");
+
+  MPI_Comm comm = this->GetCommunicator();
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  int step = data->GetDataTimeStep();
+  double time = data->GetDataTime();
+
+  // the bounds and owners of all of the blocks
+  MeshMetadataFlags flags;
+  flags.SetBlockDecomp();
+  flags.SetBlockBounds();
+
+  MeshMetadataMap mdMap;
+  MeshMetadataPtr mmd;
+  if (mdMap.Initialize(data, flags) ||
+    mdMap.GetMeshMetadata(this->MeshName, mmd))
+    {
+    SENSEI_ERROR("Failed to get metadata for mesh \"" << this->MeshName << "\"")
+    return false;
+    }
+
+  BlockIndex index;
+  index.Initialize(mmd->BlockBounds);
+
+  double bounds[6] = {std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::lowest()};
+
+  for (const std::array<double,6> &bb : mmd->BlockBounds)
+    {
+    for (int q = 0; q < 3; ++q)
+      {
+      bounds[2*q] = std::min(bounds[2*q], bb[2*q]);
+      bounds[2*q+1] = std::max(bounds[2*q+1], bb[2*q+1]);
+      }
+    }
+
+  // fetch the local blocks. errors are reported but processing continues
+  // so that all ranks take part in the exchanges below
+  bool status = true;
+  std::map<int, LocalBlock> blocks;
+
+  vtkDataObject *dobj = nullptr;
+  if (data->GetMesh(this->MeshName, false, dobj))
+    {
+    SENSEI_ERROR("Failed to get mesh \"" << this->MeshName << "\"")
+    status = false;
+    }
+  else if (dobj)
+    {
+    vtkCompositeDataSetPtr mesh = VTKUtils::AsCompositeData(comm, dobj, true);
+
+    if (data->AddArray(mesh, this->MeshName, this->Association,
+      this->VelocityName))
+      {
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add "
+        << VTKUtils::GetAttributesName(this->Association)
+        << " data array \""  << this->VelocityName << "\"")
+      status = false;
+      }
+    else
+      {
+      vtkSmartPointer<vtkCompositeDataIterator> iter;
+      iter.TakeReference(mesh->NewIterator());
+
+      for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
+        {
+        vtkImageData *im = dynamic_cast<vtkImageData*>(iter->GetCurrentDataObject());
+        if (!im)
+          {
+          SENSEI_ERROR("Block " << iter->GetCurrentFlatIndex() - 1 << " is a "
+            << iter->GetCurrentDataObject()->GetClassName() << " but the"
+            " tracer requires vtkImageData")
+          status = false;
+          continue;
+          }
+
+        vtkFieldData *fd = im->GetAttributesAsFieldData(this->Association);
+        vtkDataArray *vel = fd ? fd->GetArray(this->VelocityName.c_str()) : nullptr;
+
+        LocalBlock b;
+        if (!vel || getBlock(im, vel, this->Association, b))
+          {
+          SENSEI_ERROR("Block " << iter->GetCurrentFlatIndex() - 1 << " has no"
+            " 3 component array \"" << this->VelocityName << "\"")
+          status = false;
+          continue;
+          }
+
+        blocks[iter->GetCurrentFlatIndex() - 1] = b;
+        }
+      }
+    }
+
+  // find the block holding a position, wrapping it into the bounds of the
+  // mesh when periodic. returns the index of the block in the metadata or
+  // -1 if none holds it
+  std::vector<int> found;
+  auto locate = [&](double *x) -> int
+    {
+    for (int pass = 0; pass < 2; ++pass)
+      {
+      std::array<double,6> box = {{x[0], x[0], x[1], x[1], x[2], x[2]}};
+      index.FindBox(box, found);
+
+      if (!found.empty())
+        return *std::min_element(found.begin(), found.end());
+
+      if (!this->Periodic || pass)
+        break;
+
+      for (int q = 0; q < 3; ++q)
+        {
+        double lo = bounds[2*q];
+        double dx = bounds[2*q+1] - lo;
+        if ((x[q] < lo) || (x[q] > lo + dx))
+          {
+          double t = dx > 0.0 ? (x[q] - lo)/dx : 0.0;
+          x[q] = lo + (t - std::floor(t))*dx;
+          }
+        }
+      }
+    return -1;
+    };
+
+  // particles are placed in a block of this rank, or sent to the rank of
+  // their block, or dropped when they leave the mesh. returns true when
+  // the particle stays
+  std::vector<std::vector<Particle>> out(nRanks);
+  auto place = [&](Particle &p) -> bool
+    {
+    int i = locate(p.X);
+    if (i < 0)
+      return false;
+
+    p.Block = mmd->BlockIds[i];
+
+    int owner = mmd->BlockOwner[i];
+    if (owner != rank)
+      {
+      out[owner].push_back(p);
+      return false;
+      }
+
+    return blocks.count(p.Block);
+    };
+
+  if (!this->Seeded)
+    {
+    // each rank keeps the seeds inside of its blocks
+    long long nSeeds = this->Seeds.size() / 3;
+    for (long long i = 0; i < nSeeds; ++i)
+      {
+      Particle p;
+      p.Id = i;
+      p.X[0] = this->Seeds[3*i];
+      p.X[1] = this->Seeds[3*i+1];
+      p.X[2] = this->Seeds[3*i+2];
+      p.Block = -1;
+      p.Substeps = 0;
+
+      int b = locate(p.X);
+      if ((b >= 0) && (mmd->BlockOwner[b] == rank) &&
+        blocks.count(mmd->BlockIds[b]))
+        {
+        p.Block = mmd->BlockIds[b];
+        this->Particles.push_back(p);
+        }
+      }
+
+    this->Seeded = true;
+    }
+  else
+    {
+    TimeEvent<128> mark("ParticleTracer::Advect");
+
+    double dt = this->Dt > 0.0 ? this->Dt : time - this->LastTime;
+    double h = dt / this->Substeps;
+
+    // particles whose blocks moved to other ranks are sent on first
+    std::vector<Particle> particles;
+    particles.reserve(this->Particles.size());
+    for (Particle p : this->Particles)
+      {
+      p.Substeps = this->Substeps;
+      if (blocks.count(p.Block) || place(p))
+        particles.push_back(p);
+      }
+
+    // particles move while they stay on the rank, and the ones leaving it
+    // are sent together once all of the rank's particles have stopped
+    while (true)
+      {
+      std::vector<Particle> in;
+      exchange(comm, out, in);
+
+      for (std::vector<Particle> &o : out)
+        o.clear();
+
+      for (const Particle &p : in)
+        {
+        if (blocks.count(p.Block))
+          particles.push_back(p);
+        }
+
+      long long nActive = 0;
+      for (const Particle &p : particles)
+        nActive += p.Substeps > 0;
+
+      MPI_Allreduce(MPI_IN_PLACE, &nActive, 1, MPI_LONG_LONG, MPI_SUM, comm);
+      if (!nActive)
+        break;
+
+      // advect the particles of each block, in chunks over the threads
+      std::sort(particles.begin(), particles.end(),
+        [](const Particle &a, const Particle &b)
+        { return std::tie(a.Block, a.Id) < std::tie(b.Block, b.Id); });
+
+      std::vector<Chunk> chunks;
+      long nParticles = particles.size();
+      for (long i = 0; i < nParticles;)
+        {
+        long j = i;
+        while ((j < nParticles) && (particles[j].Block == particles[i].Block) &&
+          (j - i < chunkSize))
+          ++j;
+
+        chunks.push_back(Chunk{particles[i].Block, i, j});
+        i = j;
+        }
+
+      long nChunks = chunks.size();
+      std::vector<std::vector<Particle>> leaving(nChunks);
+
+      if (TaskRuntime::ParallelFor(nChunks, this->Threads,
+        [&](int, long c) -> int
+        {
+        const Chunk &chunk = chunks[c];
+        return advectChunk(blocks.find(chunk.Block)->second,
+          particles.data() + chunk.Begin,
+          chunk.End - chunk.Begin, h, leaving[c]);
+        }))
+        {
+        SENSEI_ERROR("Unsupported type of array \"" << this->VelocityName << "\"")
+        status = false;
+        for (Particle &p : particles)
+          p.Substeps = 0;
+        }
+
+      // place the particles that left their blocks
+      std::vector<Particle> staying;
+      staying.reserve(nParticles);
+      for (const Particle &p : particles)
+        {
+        if (p.Block >= 0)
+          staying.push_back(p);
+        }
+
+      for (std::vector<Particle> &l : leaving)
+        {
+        for (Particle &p : l)
+          {
+          if (place(p))
+            staying.push_back(p);
+          }
+        }
+
+      particles.swap(staying);
+      }
+
+    this->Particles.swap(particles);
+    }
+
+  this->LastStep = step;
+  this->LastTime = time;
+
+  // keep the positions, and write them every interval
+  for (const Particle &p : this->Particles)
+    this->Samples.push_back(Sample{p.Id, step, time, {p.X[0], p.X[1], p.X[2]}});
+
+  if ((++this->StepsSinceWrite >= this->WriteInterval) &&
+    this->WriteResults(step))
+    status = false;
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+int ParticleTracer::WriteResults(int step)
+{
+  TimeEvent<128> mark("ParticleTracer::WriteResults");
+
+  MPI_Comm comm = this->GetCommunicator();
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  this->StepsSinceWrite = 0;
+
+  if (this->FileName.empty())
+    {
+    this->Samples.clear();
+    return 0;
+    }
+
+  // gather the samples on rank 0
+  MPI_Datatype sampleType;
+  MPI_Type_contiguous(sizeof(Sample), MPI_BYTE, &sampleType);
+  MPI_Type_commit(&sampleType);
+
+  int nLocal = this->Samples.size();
+  std::vector<int> counts(nRanks, 0);
+  MPI_Gather(&nLocal, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+
+  std::vector<int> displ(nRanks, 0);
+  int nTotal = 0;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    displ[i] = nTotal;
+    nTotal += counts[i];
+    }
+
+  std::vector<Sample> samples(rank ? 0 : nTotal);
+
+  MPI_Gatherv(this->Samples.data(), nLocal, sampleType, samples.data(),
+    counts.data(), displ.data(), sampleType, 0, comm);
+
+  MPI_Type_free(&sampleType);
+
+  this->Samples.clear();
+
+  if (rank != 0)
+    return 0;
+
+  std::sort(samples.begin(), samples.end(),
+    [](const Sample &a, const Sample &b)
+    { return std::tie(a.Id, a.Step) < std::tie(b.Id, b.Step); });
+
+  char fname[1024] = {'\0'};
+  snprintf(fname, 1024, "%s_%s_%d_pathlines.txt", this->FileName.c_str(),
+    this->MeshName.c_str(), step);
+
+  FILE *file = fopen(fname, "w");
+  if (!file)
+    {
+    char *estr = strerror(errno);
+    SENSEI_ERROR("Failed to open \"" << fname << "\""
+      << std::endl << estr)
+    return -1;
+    }
+
+  fprintf(file, "id step time x y z\n");
+  for (const Sample &s : samples)
+    {
+    fprintf(file, "%lld %d %0.9g %0.9g %0.9g %0.9g\n", s.Id, s.Step, s.Time,
+      s.X[0], s.X[1], s.X[2]);
+    }
+
+  fclose(file);
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void ParticleTracer::GetParticles(std::vector<long long> &ids,
+  std::vector<double> &x) const
+{
+  ids.clear();
+  x.clear();
+
+  for (const Particle &p : this->Particles)
+    {
+    ids.push_back(p.Id);
+    x.insert(x.end(), p.X, p.X + 3);
+    }
+}
+
+//-----------------------------------------------------------------------------
+int ParticleTracer::Finalize()
+{
+  // write what was kept since the last interval
+  int ierr = this->StepsSinceWrite ? this->WriteResults(this->LastStep) : 0;
+
+  this->Particles.clear();
+  this->Samples.clear();
+
+  return ierr;
+}
+
+}
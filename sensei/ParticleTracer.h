@@ -0,0 +1,124 @@
+#ifndef sensei_ParticleTracer_h
+#define sensei_ParticleTracer_h
+
+#include "AnalysisAdaptor.h"
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+namespace sensei
+{
+
+/// @class ParticleTracer
+/// @brief Advects seed particles through the simulation's velocity field
+/// and writes their pathlines.
+///
+/// Between two steps each particle is moved by the velocity of the later
+/// step with a number of second order (midpoint) substeps. The velocity
+/// is interpolated trilinearly from the points, or the cell centers, of
+/// vtkImageData blocks, the particles of a block being interpolated
+/// together a substep at a time. A particle that leaves its block is
+/// placed in the block that holds it, found from the block bounds of the
+/// metadata, and is sent to the block's rank. A particle keeps moving
+/// while it stays on a rank, and those leaving are sent in one exchange
+/// per round, the rounds ending when every particle has finished the
+/// step. Particles leaving the mesh are wrapped into the global bounds
+/// when periodic is set and are dropped otherwise.
+///
+/// The position of each particle after each step is kept, and every
+/// write interval steps the positions are gathered to rank 0 and written
+/// to <file>_<mesh>_<step>_pathlines.txt, a line of id, step, time and
+/// position each, ordered by particle and step.
+class ParticleTracer : public AnalysisAdaptor
+{
+public:
+  static ParticleTracer* New();
+  senseiTypeMacro(ParticleTracer, AnalysisAdaptor);
+
+  /// @brief Set up the tracer.
+  ///
+  /// @param meshName the mesh of vtkImageData blocks
+  /// @param velocityName a 3 component array of the velocity
+  /// @param association vtkDataObject::POINT or CELL
+  /// @param seeds the starting positions, 3 per particle, the same on all
+  ///        ranks. the particle id is the index of its seed
+  /// @param dt the time between steps, or <= 0 for the difference of the
+  ///        simulation's times
+  /// @param substeps the number of substeps per step
+  /// @param periodic wrap the particles leaving the mesh into its bounds
+  /// @param writeInterval write the pathlines every this many steps
+  /// @param fileName the prefix of the output files, or empty
+  /// @returns zero if successful
+  int Initialize(const std::string &meshName, const std::string &velocityName,
+    int association, const std::vector<double> &seeds, double dt,
+    int substeps, bool periodic, int writeInterval,
+    const std::string &fileName);
+
+  /// get n seeds placed uniformly at random in the bounds, x0, x1, y0, y1,
+  /// z0, z1. the same seed gives the same positions on all ranks
+  static void GetRandomSeeds(const double bounds[6], long long n,
+    unsigned int seed, std::vector<double> &seeds);
+
+  /// set the number of threads used to advect the particles. the threads
+  /// are those of the TaskRuntime, a value less than 1 uses all of them.
+  /// the default is 1.
+  void SetNumberOfThreads(int nThreads);
+
+  bool Execute(DataAdaptor* data) override;
+
+  int Finalize() override;
+
+  /// get the ids and positions, 3 per particle, of the particles on this
+  /// rank
+  void GetParticles(std::vector<long long> &ids, std::vector<double> &x) const;
+
+  /// a particle's position after a step
+  struct Sample
+  {
+    long long Id;
+    int Step;
+    double Time;
+    double X[3];
+  };
+
+  /// a particle in flight, Block is the id of the block it is in
+  struct Particle
+  {
+    long long Id;
+    double X[3];
+    int Block;
+    int Substeps;  // the substeps left in this step
+  };
+
+protected:
+  ParticleTracer();
+  ~ParticleTracer();
+
+  ParticleTracer(const ParticleTracer&) = delete;
+  void operator=(const ParticleTracer&) = delete;
+
+  // gather the samples kept since the last write to rank 0 and write them
+  int WriteResults(int step);
+
+  std::string MeshName;
+  std::string VelocityName;
+  int Association;
+  std::vector<double> Seeds;
+  double Dt;
+  int Substeps;
+  bool Periodic;
+  int WriteInterval;
+  std::string FileName;
+  int Threads;
+
+  bool Seeded;
+  int LastStep;
+  double LastTime;
+  int StepsSinceWrite;
+  std::vector<Particle> Particles;
+  std::vector<Sample> Samples;
+};
+
+}
+
+#endif
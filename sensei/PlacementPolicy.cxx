@@ -0,0 +1,139 @@
+#include "PlacementPolicy.h"
+#include "Error.h"
+
+#include <pugixml.hpp>
+
+#include <sstream>
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+PlacementPolicy::PlacementPolicy() : Placement(PLACE_NONE), MaxBacklog(1.0),
+  Hysteresis(0.2), ProbeInterval(20), HaveLocalCost(false), LocalCost(0.0),
+  LastPlacement(PLACE_IN_SITU), StepsInTransit(0)
+{
+}
+
+// --------------------------------------------------------------------------
+int PlacementPolicy::GetPlacement(const std::string &name, int &placement)
+{
+  if (name == "in_situ")
+    placement = PLACE_IN_SITU;
+  else if (name == "in_transit")
+    placement = PLACE_IN_TRANSIT;
+  else if (name == "adaptive")
+    placement = PLACE_ADAPTIVE;
+  else
+    return -1;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int PlacementPolicy::Initialize(const pugi::xml_node &node)
+{
+  if (!node.attribute("placement"))
+    {
+    this->Placement = PLACE_NONE;
+    return 0;
+    }
+
+  std::string name = node.attribute("placement").value();
+  if (GetPlacement(name, this->Placement))
+    {
+    SENSEI_ERROR("Invalid placement \"" << name << "\". The placement is"
+      " one of in_situ, in_transit, or adaptive")
+    return -1;
+    }
+
+  this->Transport = node.attribute("transport").as_string("");
+  if ((this->Placement != PLACE_IN_SITU) &&
+    (this->Transport.empty() || !node.attribute("name")))
+    {
+    SENSEI_ERROR("An analysis placed " << name << " must be named by the"
+      " name attribute, and the transport that ships its data by the"
+      " transport attribute")
+    return -1;
+    }
+
+  this->MaxBacklog = node.attribute("max_backlog").as_double(1.0);
+  this->Hysteresis = node.attribute("hysteresis").as_double(0.2);
+  this->ProbeInterval = node.attribute("probe_interval").as_int(20);
+
+  if ((this->Hysteresis < 0.0) || (this->Hysteresis >= 1.0))
+    {
+    SENSEI_ERROR("Invalid hysteresis " << this->Hysteresis
+      << ". The fraction must be in [0, 1)")
+    return -1;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int PlacementPolicy::Place(const Measures &measures)
+{
+  if (this->Placement == PLACE_IN_TRANSIT)
+    return PLACE_IN_TRANSIT;
+
+  if (this->Placement != PLACE_ADAPTIVE)
+    return PLACE_IN_SITU;
+
+  // the average is weighted toward recent executions so that changes in
+  // the cost of a phase are followed quickly
+  if (measures.LocalTime >= 0.0)
+    {
+    this->LocalCost = this->HaveLocalCost ?
+      0.5*(this->LocalCost + measures.LocalTime) : measures.LocalTime;
+    this->HaveLocalCost = true;
+    }
+
+  int placement = PLACE_IN_SITU;
+
+  if (this->HaveLocalCost && (measures.Bandwidth > 0.0) &&
+    (measures.Backlog <= this->MaxBacklog))
+    {
+    // the cost of shipping is the time the simulation spends sending the
+    // analysis' data. moving requires the other side to win by the margin
+    double shipCost = measures.Bytes/measures.Bandwidth;
+
+    if (this->LastPlacement == PLACE_IN_SITU)
+      placement = shipCost < (1.0 - this->Hysteresis)*this->LocalCost ?
+        PLACE_IN_TRANSIT : PLACE_IN_SITU;
+    else
+      placement = shipCost > (1.0 + this->Hysteresis)*this->LocalCost ?
+        PLACE_IN_SITU : PLACE_IN_TRANSIT;
+
+    // refresh the local cost once in a while
+    if ((placement == PLACE_IN_TRANSIT) && (this->ProbeInterval > 0) &&
+      (this->StepsInTransit >= this->ProbeInterval))
+      placement = PLACE_IN_SITU;
+    }
+
+  this->StepsInTransit = placement == PLACE_IN_TRANSIT ?
+    this->StepsInTransit + 1 : 0;
+
+  this->LastPlacement = placement;
+
+  return placement;
+}
+
+// --------------------------------------------------------------------------
+std::string PlacementPolicy::GetDescription() const
+{
+  std::ostringstream oss;
+
+  if (this->Placement == PLACE_IN_SITU)
+    oss << "in_situ";
+  else if (this->Placement == PLACE_IN_TRANSIT)
+    oss << "in_transit transport=" << this->Transport;
+  else if (this->Placement == PLACE_ADAPTIVE)
+    oss << "adaptive transport=" << this->Transport << " max_backlog="
+      << this->MaxBacklog << " hysteresis=" << this->Hysteresis
+      << " probe_interval=" << this->ProbeInterval;
+
+  return oss.str();
+}
+
+}
@@ -0,0 +1,123 @@
+#ifndef sensei_PlacementPolicy_h
+#define sensei_PlacementPolicy_h
+
+#include <string>
+
+namespace pugi { class xml_node; }
+
+namespace sensei
+{
+
+/// @class PlacementPolicy
+/// @brief Decides, step by step, if an analysis runs in situ or in transit.
+///
+/// An analysis may run in the simulation, in situ, or on an end point
+/// reading a transport's stream, in transit. Which is cheaper changes with
+/// the workload: in situ the simulation waits for the analysis, in transit
+/// it waits for the analysis' data to be sent, and the end point must keep
+/// up. An analysis placed adaptively is declared once, in a configuration
+/// used by both the simulation and the end point, and the policy chooses
+/// each step from measurements made by the simulation
+///
+///   local cost  the time of the analysis' executions in situ, a moving
+///               average weighted toward recent executions
+///   bytes       the size of the data the analysis reads, over all ranks
+///   bandwidth   the bytes per second sent by the transport in its last
+///               execution, over all ranks
+///   backlog     the steps waiting in the transport's queue, the largest
+///               over the ranks, which grows when the end point falls behind
+///
+/// The analysis is shipped when sending its data, bytes over bandwidth,
+/// costs less than running it, and stays in situ while the backlog is
+/// above max_backlog. The hysteresis, a fraction of the local cost, keeps
+/// the analysis from moving back and forth when the two are close. Until
+/// the local cost is known the analysis runs in situ. While it is shipped
+/// the local cost is not measured, every probe_interval steps it is run in
+/// situ again so that the estimate follows the workload. An analysis may
+/// also be placed in situ or in transit at every step. The XML attributes
+/// of the analysis element are
+///
+///   placement="adaptive" transport="stream" max_backlog="1"
+///   hysteresis="0.2" probe_interval="20"
+///
+/// where transport names the transport that ships the data. The name
+/// attribute of an analysis placed in transit or adaptively must be set,
+/// the end point finds the analyses to run by their names.
+class PlacementPolicy
+{
+public:
+  PlacementPolicy();
+
+  /// the placements. PLACE_NONE, the default, runs the analysis wherever
+  /// it is configured, as though it had no placement
+  enum {PLACE_NONE = -1, PLACE_IN_SITU = 0, PLACE_IN_TRANSIT = 1,
+    PLACE_ADAPTIVE = 2};
+
+  /// @brief Get the name of the mesh the placement is published as.
+  ///
+  /// Each step the simulation publishes a small mesh, a block of one cell
+  /// per rank, with an array named for each analysis placed in transit,
+  /// see PartialResultsDataAdaptor. The transports ship it with the data,
+  /// and the end point runs the analyses it names.
+  static const char *GetMeshName() { return "sensei_placement"; }
+
+  /// @brief Convert "in_situ", "in_transit" or "adaptive" to a placement.
+  ///
+  /// @returns zero if successful, non zero if the name is not a placement
+  static int GetPlacement(const std::string &name, int &placement);
+
+  /// parse the attributes of the analysis element. returns zero if
+  /// successful
+  int Initialize(const pugi::xml_node &node);
+
+  /// true if the analysis has a placement
+  bool Enabled() const { return this->Placement != PLACE_NONE; }
+
+  /// the placement given by the XML
+  int GetPlacement() const { return this->Placement; }
+
+  /// the name of the transport that ships the data
+  const std::string &GetTransport() const { return this->Transport; }
+
+  /// the measurements of a step, these must be the same on all ranks
+  struct Measures
+  {
+    // the time of the analysis' last execution in situ, or -1 if it did
+    // not execute in situ since the last step
+    double LocalTime;
+
+    // the bytes of the data the analysis reads
+    double Bytes;
+
+    // the transport's bytes per second, or 0 when not known
+    double Bandwidth;
+
+    // the steps waiting in the transport's queue
+    double Backlog;
+  };
+
+  /// @brief Place the analysis for this step.
+  ///
+  /// @returns PLACE_IN_SITU or PLACE_IN_TRANSIT
+  int Place(const Measures &measures);
+
+  /// a description of the policy, for status messages
+  std::string GetDescription() const;
+
+private:
+  int Placement;
+  std::string Transport;
+  double MaxBacklog;
+  double Hysteresis;
+  long ProbeInterval;
+
+  // the estimated local cost, and where the analysis ran in the last step
+  bool HaveLocalCost;
+  double LocalCost;
+  int LastPlacement;
+  long StepsInTransit;
+};
+
+}
+
+#endif
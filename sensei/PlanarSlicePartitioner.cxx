@@ -23,64 +23,96 @@ int PlanarSlicePartitioner::Initialize(pugi::xml_node &node)
     XMLUtils::RequireChild(node, "normal"))
     return -1;
 
-  if (XMLUtils::ParseNumeric(node.child("point"), this->Point) ||
-    XMLUtils::ParseNumeric(node.child("normal"), this->Normal))
+  // each point element pairs with the normal element in the same position
+  std::vector<std::array<double,3>> points;
+  std::vector<std::array<double,3>> normals;
+
+  for (pugi::xml_node pt = node.child("point"); pt; pt = pt.next_sibling("point"))
+    {
+    std::array<double,3> p;
+    if (XMLUtils::ParseNumeric(pt, p))
+      return -1;
+    points.push_back(p);
+    }
+
+  for (pugi::xml_node nm = node.child("normal"); nm; nm = nm.next_sibling("normal"))
+    {
+    std::array<double,3> n;
+    if (XMLUtils::ParseNumeric(nm, n))
+      return -1;
+    normals.push_back(n);
+    }
+
+  if (this->SetPlanes(points, normals))
     return -1;
 
   // report configuration
   std::ostringstream oss;
-  oss << "point=" << this->Point << " normal=" << this->Normal;
+  oss << "points=" << this->Points << " normals=" << this->Normals;
   SENSEI_STATUS("Configured PlanareSlicePartitioner " << oss.str())
 
   return 0;
 }
 
 // --------------------------------------------------------------------------
-int PlanarSlicePartitioner::GetPartition(MPI_Comm comm,
-  const MeshMetadataPtr &mdIn, MeshMetadataPtr &mdOut)
+int PlanarSlicePartitioner::SetPlanes(const std::vector<std::array<double,3>> &points,
+  const std::vector<std::array<double,3>> &normals)
 {
-  TimeEvent<128>("PlanarSlicePartitioner::GetPartition");
+  if (points.empty() || (points.size() != normals.size()))
+    {
+    SENSEI_ERROR("Each slice plane requires one point and one normal. "
+      << points.size() << " points and " << normals.size() << " normals given")
+    return -1;
+    }
+
+  this->Points = points;
+  this->Normals = normals;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int PlanarSlicePartitioner::GetActiveBlocks(const MeshMetadataPtr &md,
+  std::vector<int> &activeBlocks)
+{
+  activeBlocks.clear();
 
   // require block bounds
-  if (mdIn->BlockBounds.size() != static_cast<unsigned int>(mdIn->NumBlocks))
+  int nBlocks = md->BlockBounds.size();
+  if (md->NumBlocks && !nBlocks)
     {
     SENSEI_ERROR("Block bounds are required")
     return -1;
     }
 
-  // build the list of active blocks
-  std::vector<int> activeBlocks;
-  for (int i = 0; i < mdIn->NumBlocks; ++i)
-    {
-    // compute the distance from  each corner of the block bounding box
-    // to the plane. if the block intersects the plane, at least one
-    // corner will have a different sign.
-    const std::array<double,6> &bounds = mdIn->BlockBounds[i];
+  // the block bounds of a static mesh do not change, index them once
+  if (!md->StaticMesh || (this->Index.GetNumberOfBlocks() != nBlocks))
+    this->Index.Initialize(md->BlockBounds);
 
-    // triplets defining corner points
-    int pt_ids[] = {0,2,4, 0,3,4, 1,3,4, 1,2,4,
-      0,2,5, 0,3,5, 1,3,5, 1,2,5};
+  // build the list of active blocks. if the block intersects a plane, at
+  // least one corner of its bounding box will have a different sign.
+  this->Index.FindPlanes(this->Points, this->Normals, activeBlocks);
 
-    double min_d = std::numeric_limits<double>::max();
-    double max_d = std::numeric_limits<double>::lowest();
+  return 0;
+}
 
-    for (int q = 0; q < 8; ++q)
-      {
-      double d = 0.0;
-      for (int j = 0; j < 3; ++j)
-        d += this->Normal[j] * (bounds[pt_ids[q*3 + j]] - this->Point[j]);
-
-      min_d = std::min(min_d, d);
-      max_d = std::max(max_d, d);
-
-      if ((min_d <= 0.0) && (max_d > 0.0))
-        {
-        activeBlocks.push_back(i);
-        break;
-        }
-      }
+// --------------------------------------------------------------------------
+int PlanarSlicePartitioner::GetPartition(MPI_Comm comm,
+  const MeshMetadataPtr &mdIn, MeshMetadataPtr &mdOut)
+{
+  TimeEvent<128>("PlanarSlicePartitioner::GetPartition");
+
+  // require the global view of the block bounds
+  if (mdIn->BlockBounds.size() != static_cast<unsigned int>(mdIn->NumBlocks))
+    {
+    SENSEI_ERROR("Block bounds are required")
+    return -1;
     }
 
+  std::vector<int> activeBlocks;
+  if (this->GetActiveBlocks(mdIn, activeBlocks))
+    return -1;
+
   // partition the remaining blocks to ranks equally
   int nRanks = 1;
   MPI_Comm_size(comm, &nRanks);
@@ -2,7 +2,10 @@
 #define sensei_PlanarSlicePartitioner_h
 
 #include "Partitioner.h"
+#include "BlockIndex.h"
+
 #include <array>
+#include <vector>
 
 namespace sensei
 {
@@ -15,6 +18,10 @@ using PlanarSlicePartitionerPtr = std::shared_ptr<sensei::PlanarSlicePartitioner
 /// defined by a given point and normal. This blocks are partitioned
 /// in consecutive blocks to ranks such that each rank gets approximately
 /// the same number. Ranks will differ by at most 1 block.
+///
+/// More than one plane may be given, in which case the blocks intersecting
+/// any of the planes are selected. Blocks are located with a BlockIndex
+/// that is built once for static meshes.
 class PlanarSlicePartitioner : public sensei::Partitioner
 {
 public:
@@ -23,28 +30,44 @@ public:
 
   const char *GetClassName() override { return "PlanarSlicePartitioner"; }
 
-  // set the point defining the slice plane
-  void SetPoint(const std::array<double,3> &p) { this->Point = p; }
-  void GetPoint(std::array<double,3> &p) { p = this->Point; }
+  // set the point defining the first slice plane
+  void SetPoint(const std::array<double,3> &p) { this->Points[0] = p; }
+  void GetPoint(std::array<double,3> &p) { p = this->Points[0]; }
+
+  // set the normal defining the first slice plane
+  void SetNormal(const std::array<double,3> &n) { this->Normals[0] = n; }
+  void GetNormal(std::array<double,3> &n) { n = this->Normals[0]; }
 
-  // set the normal defining the slice plane
-  void SetNormal(const std::array<double,3> &n) { this->Normal = n; }
-  void GetNormal(std::array<double,3> &n) { n = this->Normal; }
+  // set the points and normals of all slice planes. returns -1 if the
+  // number of points and normals differ or no plane is given
+  int SetPlanes(const std::vector<std::array<double,3>> &points,
+    const std::vector<std::array<double,3>> &normals);
+
+  void GetPlanes(std::vector<std::array<double,3>> &points,
+    std::vector<std::array<double,3>> &normals)
+  { points = this->Points; normals = this->Normals; }
 
   // Initialize from XML
   int Initialize(pugi::xml_node &node) override;
 
+  // find the blocks intersecting any of the planes. the indices of the
+  // blocks in the metadata's block arrays are returned. block bounds are
+  // required, either the local or the global view may be passed
+  int GetActiveBlocks(const sensei::MeshMetadataPtr &md,
+    std::vector<int> &activeBlocks);
+
   // given an existing partitioning of data passed in the first MeshMetadata
   // argument,return a new partittioning in the second MeshMetadata argument.
   int GetPartition(MPI_Comm comm, const sensei::MeshMetadataPtr &in,
     sensei::MeshMetadataPtr &out) override;
 
 protected:
-  PlanarSlicePartitioner() : Point{0.,0.,0.}, Normal{1.,0.,0.} {}
+  PlanarSlicePartitioner() : Points(1, {0.,0.,0.}), Normals(1, {1.,0.,0.}) {}
   PlanarSlicePartitioner(const PlanarSlicePartitioner &) = default;
 
-  std::array<double,3> Point;
-  std::array<double,3> Normal;
+  std::vector<std::array<double,3>> Points;
+  std::vector<std::array<double,3>> Normals;
+  sensei::BlockIndex Index;
 };
 
 }
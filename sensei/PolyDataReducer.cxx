@@ -0,0 +1,388 @@
+#include "PolyDataReducer.h"
+#include "Profiler.h"
+#include "TaskRuntime.h"
+#include "VTKUtils.h"
+#include "Error.h"
+
+#include <vtkAppendPolyData.h>
+#include <vtkCellData.h>
+#include <vtkCellDataToPointData.h>
+#include <vtkCleanPolyData.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkFloatArray.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkQuadricDecimation.h>
+#include <vtkSmartPointer.h>
+#include <vtkTriangleFilter.h>
+
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+using vtkPolyDataPtr = vtkSmartPointer<vtkPolyData>;
+
+namespace
+{
+// merge the points within tol of each other, relative to the diagonal of
+// the bounds. the cells that collapse are converted or removed
+vtkPolyDataPtr mergePoints(vtkPolyData *input, double tol)
+{
+  vtkSmartPointer<vtkCleanPolyData> clean =
+    vtkSmartPointer<vtkCleanPolyData>::New();
+  clean->SetInputData(input);
+  clean->PointMergingOn();
+  clean->SetToleranceIsAbsolute(0);
+  clean->SetTolerance(tol);
+  clean->Update();
+
+  return clean->GetOutput();
+}
+
+// triangulate and decimate the polygons, keeping the point arrays
+vtkPolyDataPtr decimate(vtkPolyData *input, double reduction)
+{
+  vtkPolyDataPtr pd = vtkPolyDataPtr::New();
+  pd->ShallowCopy(input);
+
+  // the ghost cells of the blocks the extract was made from do not
+  // average to the points
+  pd->GetCellData()->RemoveArray(vtkDataSetAttributes::GhostArrayName());
+
+  vtkSmartPointer<vtkTriangleFilter> tris =
+    vtkSmartPointer<vtkTriangleFilter>::New();
+  tris->PassVertsOff();
+  tris->PassLinesOff();
+
+  // decimation keeps the point arrays only
+  vtkSmartPointer<vtkCellDataToPointData> cdpd;
+  if (pd->GetCellData()->GetNumberOfArrays())
+    {
+    cdpd = vtkSmartPointer<vtkCellDataToPointData>::New();
+    cdpd->SetInputData(pd);
+    cdpd->SetPassCellData(0);
+    tris->SetInputConnection(cdpd->GetOutputPort());
+    }
+  else
+    {
+    tris->SetInputData(pd);
+    }
+
+  vtkSmartPointer<vtkQuadricDecimation> deci =
+    vtkSmartPointer<vtkQuadricDecimation>::New();
+  deci->SetInputConnection(tris->GetOutputPort());
+  deci->SetTargetReduction(reduction);
+  deci->VolumePreservationOn();
+  deci->Update();
+
+  return deci->GetOutput();
+}
+
+// snap the points to the lattice of nSteps steps over the bounds. the
+// points are stored as floats
+vtkPolyDataPtr quantize(vtkPolyData *input, const double *bounds,
+  double nSteps)
+{
+  vtkPolyDataPtr pd = vtkPolyDataPtr::New();
+  pd->ShallowCopy(input);
+
+  vtkPoints *pts = input->GetPoints();
+  if (!pts)
+    return pd;
+
+  double lo[3] = {bounds[0], bounds[2], bounds[4]};
+  double step[3] = {0.0};
+  for (int d = 0; d < 3; ++d)
+    step[d] = (bounds[2*d+1] - bounds[2*d]) / nSteps;
+
+  vtkIdType nPts = pts->GetNumberOfPoints();
+
+  vtkSmartPointer<vtkFloatArray> coords = vtkSmartPointer<vtkFloatArray>::New();
+  coords->SetNumberOfComponents(3);
+  coords->SetNumberOfTuples(nPts);
+  float *pCoords = coords->GetPointer(0);
+
+  for (vtkIdType i = 0; i < nPts; ++i)
+    {
+    double x[3];
+    pts->GetPoint(i, x);
+
+    for (int d = 0; d < 3; ++d)
+      {
+      double q = x[d];
+      if (step[d] > 0.0)
+        {
+        q = std::max(0.0, std::min(nSteps, std::round((x[d] - lo[d]) / step[d])));
+        q = lo[d] + q * step[d];
+        }
+      pCoords[3*i + d] = q;
+      }
+    }
+
+  vtkSmartPointer<vtkPoints> qpts = vtkSmartPointer<vtkPoints>::New();
+  qpts->SetData(coords);
+  pd->SetPoints(qpts);
+
+  return pd;
+}
+}
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+PolyDataReducer::PolyDataReducer() : MergeBlocks(0), MergePoints(0),
+  Tolerance(0.0), TargetReduction(0.0), QuantizeBits(0), NumThreads(1)
+{
+}
+
+// --------------------------------------------------------------------------
+int PolyDataReducer::Initialize(const pugi::xml_node &node)
+{
+  this->SetMergeBlocks(node.attribute("merge_blocks").as_int(0));
+
+  this->SetMergePoints(node.attribute("merge_points").as_int(0),
+    node.attribute("tolerance").as_double(0.0));
+
+  this->SetNumberOfThreads(node.attribute("threads").as_int(1));
+
+  if (this->SetTargetReduction(node.attribute("target_reduction").as_double(0.0)) ||
+    this->SetQuantizeBits(node.attribute("quantize_bits").as_int(0)))
+    {
+    SENSEI_ERROR("Failed to parse the reduce element")
+    return -1;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+void PolyDataReducer::SetMergePoints(int val, double tol)
+{
+  this->MergePoints = val;
+  this->Tolerance = std::max(0.0, tol);
+}
+
+// --------------------------------------------------------------------------
+int PolyDataReducer::SetTargetReduction(double fraction)
+{
+  if ((fraction < 0.0) || (fraction >= 1.0))
+    {
+    SENSEI_ERROR("Invalid target reduction " << fraction
+      << ". The fraction must be in [0, 1)")
+    return -1;
+    }
+
+  this->TargetReduction = fraction;
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int PolyDataReducer::SetQuantizeBits(int bits)
+{
+  if ((bits < 0) || (bits > 24))
+    {
+    SENSEI_ERROR("Invalid number of quantization bits " << bits
+      << ". The number must be in [1, 24], or 0 to not quantize")
+    return -1;
+    }
+
+  this->QuantizeBits = bits;
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+bool PolyDataReducer::Enabled() const
+{
+  return this->MergeBlocks || this->MergePoints ||
+    (this->TargetReduction > 0.0) || this->QuantizeBits;
+}
+
+// --------------------------------------------------------------------------
+std::string PolyDataReducer::GetDescription() const
+{
+  std::ostringstream oss;
+  oss << "merge_blocks=" << this->MergeBlocks
+    << " merge_points=" << this->MergePoints
+    << " tolerance=" << this->Tolerance
+    << " target_reduction=" << this->TargetReduction
+    << " quantize_bits=" << this->QuantizeBits
+    << " threads=" << this->NumThreads;
+  return oss.str();
+}
+
+// --------------------------------------------------------------------------
+int PolyDataReducer::Execute(MPI_Comm comm, vtkCompositeDataSet *input,
+  vtkCompositeDataSet *&output)
+{
+  TimeEvent<128> mark("PolyDataReducer::Execute");
+
+  output = nullptr;
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  // collect the blocks
+  vtkCompositeDataIterator *it = input->NewIterator();
+  it->SetSkipEmptyNodes(0);
+
+  unsigned int nBlocks = 0;
+  for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+    ++nBlocks;
+
+  std::vector<int> bids;
+  std::vector<vtkSmartPointer<vtkDataObject>> blocks;
+  it->SetSkipEmptyNodes(1);
+  for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+    {
+    bids.push_back(VTKUtils::GetBlockId(input, it));
+    blocks.push_back(it->GetCurrentDataObject());
+    }
+
+  it->Delete();
+
+  // append the rank's blocks into one, placed at the rank's index
+  if (this->MergeBlocks)
+    {
+    TimeEvent<128> markAppend("PolyDataReducer::MergeBlocks");
+
+    vtkSmartPointer<vtkAppendPolyData> append =
+      vtkSmartPointer<vtkAppendPolyData>::New();
+
+    unsigned int nLocal = blocks.size();
+    for (unsigned int i = 0; i < nLocal; ++i)
+      {
+      vtkPolyData *pd = dynamic_cast<vtkPolyData*>(blocks[i].GetPointer());
+      if (!pd)
+        {
+        SENSEI_ERROR("Block " << bids[i] << " is a "
+          << blocks[i]->GetClassName() << ", only vtkPolyData blocks"
+          " can be merged")
+        return -1;
+        }
+
+      if (pd->GetNumberOfPoints())
+        append->AddInputData(pd);
+      }
+
+    vtkPolyDataPtr merged;
+    if (append->GetNumberOfInputConnections(0))
+      {
+      append->Update();
+      merged = append->GetOutput();
+      }
+    else
+      {
+      merged = vtkPolyDataPtr::New();
+      }
+
+    nBlocks = nRanks;
+    bids.assign(1, rank);
+    blocks.assign(1, merged);
+    }
+
+  int nThreads = this->NumThreads < 1 ?
+    TaskRuntime::GetNumberOfThreads() : this->NumThreads;
+
+  // merge the points and decimate each block
+  long nLocal = blocks.size();
+
+  VTKUtils::ParallelFunction reduce = [&](int, long i) -> int
+    {
+    vtkPolyData *pd = dynamic_cast<vtkPolyData*>(blocks[i].GetPointer());
+    if (!pd || !pd->GetNumberOfPoints())
+      return 0;
+
+    vtkPolyDataPtr out = pd;
+
+    if (this->MergePoints)
+      out = mergePoints(out, this->Tolerance);
+
+    if ((this->TargetReduction > 0.0) &&
+      (out->GetNumberOfPolys() || out->GetNumberOfStrips()))
+      out = decimate(out, this->TargetReduction);
+
+    blocks[i] = out;
+    return 0;
+    };
+
+  if ((this->MergePoints || (this->TargetReduction > 0.0)) &&
+    (VTKUtils::ParallelFor(nLocal, nThreads, reduce) < 0))
+    {
+    SENSEI_ERROR("Failed to reduce the blocks")
+    return -1;
+    }
+
+  // quantize over the bounds of the extract on all ranks. the lower
+  // bounds are negated so that one reduction finds both
+  if (this->QuantizeBits)
+    {
+    TimeEvent<128> markQuant("PolyDataReducer::Quantize");
+
+    double ext[6];
+    for (int d = 0; d < 6; ++d)
+      ext[d] = std::numeric_limits<double>::lowest();
+
+    for (long i = 0; i < nLocal; ++i)
+      {
+      vtkPolyData *pd = dynamic_cast<vtkPolyData*>(blocks[i].GetPointer());
+      if (!pd || !pd->GetNumberOfPoints())
+        continue;
+
+      double bds[6];
+      pd->GetBounds(bds);
+      for (int d = 0; d < 3; ++d)
+        {
+        ext[d] = std::max(ext[d], -bds[2*d]);
+        ext[3 + d] = std::max(ext[3 + d], bds[2*d + 1]);
+        }
+      }
+
+    MPI_Allreduce(MPI_IN_PLACE, ext, 6, MPI_DOUBLE, MPI_MAX, comm);
+
+    double bounds[6];
+    for (int d = 0; d < 3; ++d)
+      {
+      bounds[2*d] = -ext[d];
+      bounds[2*d + 1] = ext[3 + d];
+      }
+
+    double nSteps = double((1 << this->QuantizeBits) - 1);
+
+    VTKUtils::ParallelFunction snap = [&](int, long i) -> int
+      {
+      vtkPolyData *pd = dynamic_cast<vtkPolyData*>(blocks[i].GetPointer());
+      if (pd && pd->GetNumberOfPoints())
+        blocks[i] = quantize(pd, bounds, nSteps);
+      return 0;
+      };
+
+    if (VTKUtils::ParallelFor(nLocal, nThreads, snap) < 0)
+      {
+      SENSEI_ERROR("Failed to quantize the blocks")
+      return -1;
+      }
+    }
+
+  // assemble the output
+  vtkMultiBlockDataSet *mbds = vtkMultiBlockDataSet::New();
+  mbds->SetNumberOfBlocks(nBlocks);
+  for (long i = 0; i < nLocal; ++i)
+    mbds->SetBlock(bids[i], blocks[i]);
+
+  output = mbds;
+
+  return 0;
+}
+
+}
@@ -0,0 +1,104 @@
+#ifndef sensei_PolyDataReducer_h
+#define sensei_PolyDataReducer_h
+
+#include <mpi.h>
+#include <string>
+
+class vtkCompositeDataSet;
+namespace pugi { class xml_node; }
+
+namespace sensei
+{
+
+/// @class PolyDataReducer
+/// @brief Reduces the size of extracted surfaces before they are written.
+///
+/// Slices and iso-surfaces are extracted block by block, they carry the
+/// duplicated points of the pipelines that made them and far more
+/// triangles than are needed to visualize them. The extracts of analyses
+/// such as SliceExtract and VTKmContourAnalysis are passed through the
+/// reducer before they are written or published. The vtkPolyData blocks
+/// are processed in parallel on the TaskRuntime's threads, each through
+/// a VTK pipeline of its own. The stages, each optional, are
+///
+///   merge blocks  the rank's blocks are appended into one, placed at the
+///                 rank's index of the output, which writes one file per
+///                 rank in place of one per block and lets the points
+///                 shared by neighboring blocks be merged
+///   merge points  points within the tolerance, relative to the diagonal
+///                 of the block's bounds, are merged, 0 merges coincident
+///                 points only, and the cells that collapse are removed
+///   decimate      the polygons are triangulated and decimated by quadric
+///                 error to the target reduction, the fraction of the
+///                 triangles removed, preserving the volume. Decimation
+///                 keeps point arrays only, cell arrays are averaged to the
+///                 points first. The boundaries of the blocks are not
+///                 constrained and may move slightly apart, merging the
+///                 blocks avoids the seams. Blocks without polygons are not
+///                 decimated
+///   quantize      the points are snapped to a lattice of 2^bits - 1 steps
+///                 in each direction over the bounds of the extract on all
+///                 ranks, so that the points of neighboring blocks stay
+///                 together, and stored as floats. The error is at most
+///                 half a step. The quantized coordinates compress well
+///
+/// The XML is
+///
+///   <reduce merge_blocks="1" merge_points="1" tolerance="0"
+///     target_reduction="0.75" quantize_bits="16" threads="4"/>
+class PolyDataReducer
+{
+public:
+  PolyDataReducer();
+
+  /// parse the <reduce> element. returns zero if successful
+  int Initialize(const pugi::xml_node &node);
+
+  /// append the rank's blocks into one. the default is off
+  void SetMergeBlocks(int val) { this->MergeBlocks = val; }
+
+  /// merge the points within tol, relative to the diagonal of each
+  /// block's bounds. the default is off, with a tolerance of 0
+  void SetMergePoints(int val, double tol = 0.0);
+
+  /// decimate to remove the fraction of triangles, in [0, 1). the
+  /// default, 0, does not decimate
+  int SetTargetReduction(double fraction);
+
+  /// quantize the coordinates to bits, in [1, 24]. the default, 0, does
+  /// not quantize
+  int SetQuantizeBits(int bits);
+
+  /// process the blocks on this many threads of the TaskRuntime. a value
+  /// less than 1 uses all of them. the default is 1
+  void SetNumberOfThreads(int nThreads) { this->NumThreads = nThreads; }
+
+  /// true if any of the stages is on
+  bool Enabled() const;
+
+  /// @brief Reduce the blocks of an extract.
+  ///
+  /// The output is a vtkMultiBlockDataSet with the structure of the input,
+  /// or with a block per rank when the blocks are merged. Blocks that are
+  /// not vtkPolyData are passed through. The caller takes a reference to
+  /// the output. When quantizing this call uses MPI collectives over comm.
+  ///
+  /// @returns zero if successful
+  int Execute(MPI_Comm comm, vtkCompositeDataSet *input,
+    vtkCompositeDataSet *&output);
+
+  /// a description of the stages that are on, for status messages
+  std::string GetDescription() const;
+
+private:
+  int MergeBlocks;
+  int MergePoints;
+  double Tolerance;
+  double TargetReduction;
+  int QuantizeBits;
+  int NumThreads;
+};
+
+}
+
+#endif
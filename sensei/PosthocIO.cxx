@@ -1,5 +1,6 @@
 #include "PosthocIO.h"
 #include "DataAdaptor.h"
+#include "MPIUtils.h"
 #include "senseiConfig.h"
 #include "Error.h"
 
@@ -19,6 +20,8 @@
 
 
 #include <algorithm>
+#include <cstring>
+#include <limits>
 #include <sstream>
 #include <fstream>
 #include <cassert>
@@ -87,28 +90,115 @@ void getValidPointExtents(vtkImageData *id,
 }
 
 // ****************************************************************************
-int write(MPI_File file, MPI_Info hints,
-      int domain[6], int decomp[6], int valid[6], vtkDataArray *da,
-      bool useCollectives)
+// a contiguous run of one row of a block in the file
+struct Run
 {
-  switch (da->GetDataType())
+  MPI_Offset Offset;  // in elements from the start of the file
+  const char *Src;
+  int Count;          // in elements
+};
+
+// ****************************************************************************
+// append a run for each row of the valid extent of a block
+void appendRuns(const int *domain, const int *decomp, const int *valid,
+  const char *data, int elemSize, std::vector<Run> &runs)
+{
+  MPI_Offset nx = domain[1] - domain[0] + 1;
+  MPI_Offset ny = domain[3] - domain[2] + 1;
+
+  long lnx = decomp[1] - decomp[0] + 1;
+  long lny = decomp[3] - decomp[2] + 1;
+
+  int count = valid[1] - valid[0] + 1;
+
+  for (int k = valid[4]; k <= valid[5]; ++k)
     {
-    vtkTemplateMacro(
-      vtkDataArrayTemplate<VTK_TT> *ta =
-        static_cast<vtkDataArrayTemplate<VTK_TT>*>(da);
-      if ((useCollectives && arrayIO::write_all(file, hints,
-            domain, decomp, valid, ta->GetPointer(0))) ||
-            arrayIO::write(file, hints, domain, decomp,
-            valid, ta->GetPointer(0)))
-        {
-        SENSEI_ERROR("write failed");
-        return -1;
-        }
-        );
-    default:
-      SENSEI_ERROR("Unhandled data type");
-      return -1;
+    for (int j = valid[2]; j <= valid[3]; ++j)
+      {
+      MPI_Offset offset = ((k - domain[4])*ny + (j - domain[2]))*nx +
+        (valid[0] - domain[0]);
+
+      long src = ((k - decomp[4])*lny + (j - decomp[2]))*lnx +
+        (valid[0] - decomp[0]);
+
+      runs.push_back({offset, data + src*elemSize, count});
+      }
+    }
+}
+
+// ****************************************************************************
+// write all of a rank's runs in one collective call. the runs are sorted
+// by file offset, packed, and described by a single file view. ranks
+// without data participate with an empty view. the view is in bytes since
+// its etype must have the same extent on every rank.
+int writeRuns(MPI_File fh, MPI_Info hints, std::vector<Run> &runs,
+  int elemSize)
+{
+  std::sort(runs.begin(), runs.end(),
+    [](const Run &a, const Run &b) -> bool { return a.Offset < b.Offset; });
+
+  size_t nElem = 0;
+  size_t nRuns = runs.size();
+  for (size_t i = 0; i < nRuns; ++i)
+    nElem += runs[i].Count;
+
+  // pack the rows and merge the ones that are adjacent in the file
+  std::vector<int> lengths;
+  std::vector<MPI_Aint> displs;
+  std::vector<char> buffer(nElem*elemSize);
+  char *dest = buffer.data();
+
+  int maxLength = std::numeric_limits<int>::max();
+  for (size_t i = 0; i < nRuns; ++i)
+    {
+    const Run &run = runs[i];
+    int nBytes = run.Count*elemSize;
+
+    memcpy(dest, run.Src, nBytes);
+    dest += nBytes;
+
+    MPI_Aint displ = run.Offset*elemSize;
+
+    if (!lengths.empty() && (displs.back() + lengths.back() == displ) &&
+      (lengths.back() <= maxLength - nBytes))
+      {
+      lengths.back() += nBytes;
+      continue;
+      }
+
+    lengths.push_back(nBytes);
+    displs.push_back(displ);
+    }
+
+  MPI_Datatype ftype;
+  MPI_Type_create_hindexed(lengths.size(), lengths.data(), displs.data(),
+    MPI_BYTE, &ftype);
+  MPI_Type_commit(&ftype);
+
+  MPI_Datatype mtype = MPI_BYTE;
+  if (elemSize > 1)
+    {
+    MPI_Type_contiguous(elemSize, MPI_BYTE, &mtype);
+    MPI_Type_commit(&mtype);
+    }
+
+  int ierr = MPI_File_set_view(fh, 0, MPI_BYTE, ftype, "native", hints);
+  if (ierr == MPI_SUCCESS)
+    ierr = MPIUtils::FileWriteAll(fh, buffer.data(), nElem, mtype);
+
+  if (mtype != MPI_BYTE)
+    MPI_Type_free(&mtype);
+  MPI_Type_free(&ftype);
+
+  if (ierr != MPI_SUCCESS)
+    {
+    char msg[MPI_MAX_ERROR_STRING];
+    int len = 0;
+    MPI_Error_string(ierr, msg, &len);
+    SENSEI_ERROR("Collective write failed. " << msg)
+    return -1;
     }
+
   return 0;
 }
 } // namespace impl
@@ -119,11 +209,22 @@ senseiNewMacro(PosthocIO);
 //-----------------------------------------------------------------------------
 PosthocIO::PosthocIO() : Comm(MPI_COMM_WORLD), CommRank(0), CommSize(1),
    OutputDir("./"), HeaderFile("ImageHeader"), BlockExt(".sensei"),
-   HaveHeader(true), Mode(mpiIO), Period(1) {}
+   HaveHeader(true), Mode(mpiIO), Period(1), Hints(MPI_INFO_NULL) {}
 
 //-----------------------------------------------------------------------------
 PosthocIO::~PosthocIO()
 {
+  if (this->Hints != MPI_INFO_NULL)
+    MPI_Info_free(&this->Hints);
+}
+
+//-----------------------------------------------------------------------------
+void PosthocIO::SetHint(const std::string &key, const std::string &value)
+{
+  if (this->Hints == MPI_INFO_NULL)
+    MPI_Info_create(&this->Hints);
+
+  MPI_Info_set(this->Hints, key.c_str(), value.c_str());
 }
 
 //-----------------------------------------------------------------------------
@@ -163,7 +264,7 @@ bool PosthocIO::Execute(DataAdaptor* data)
   // data we will wrap it in a composite dataset.
   vtkCompositeDataSet* cd = nullptr;
 
-  if (data->GetMesh(this->MeshName, false, mesh))
+  if (data->GetMesh(this->MeshName, false, cd))
     {
     SENSEI_ERROR("failed to get mesh \"" << this->MeshName << "\"")
     return false;
@@ -366,14 +467,6 @@ int PosthocIO::WriteBOV(vtkCompositeDataSet *cd,
         << "_" << timeStep << "." << this->BlockExt;
       std::string fileName = oss.str();
 
-      // open the file
-      MPI_File fh;
-      if (arrayIO::open(this->Comm, fileName.c_str(), MPI_INFO_NULL, fh))
-        {
-        SENSEI_ERROR("Open failed \"" << fileName);
-        return -1;
-        }
-
       // get the extents
       int wholeExt[6];
       if (dType)
@@ -381,47 +474,15 @@ int PosthocIO::WriteBOV(vtkCompositeDataSet *cd,
       else
         impl::getWholePointExtents(info, wholeExt);
 
-      // count the number of local blocks. if there are more than 1
-      // block on any process then collective buffering is problematic.
-      // there are a couple of ways to work around.
-      //
-      // 1) make the write in a number of rounds.
-      //    a) if all of the processes have the same number of blocks
-      //       there is no problem. If there are varying numbers of blocks
-      //       per process each process participates in each round passing
-      //       empty arrays.
-      //    b) disable collective buffering
-      //
-      // 2) copy local blocks into an array with a regular rectangular
-      //    shape (ie describable by mpi subarray).
-      //
-      // 3) modify the io code to use an aggregate data type describing the
-      //    irregular shaped region (this could be very slow though!)
-      //
-      // the approach below disables collective buffering when there is
-      // more than 1 block per process on any process (1b above). 2 is
-      // an more attractive scenario but I'm not sure diy decomposes this
-      // way.
+      // gather the rows of all of the local blocks. they are written
+      // together so that every rank makes exactly one collective call per
+      // array regardless of how many blocks it has.
+      std::vector<impl::Run> runs;
+      int elemSize = 0;
+
       vtkSmartPointer<vtkCompositeDataIterator> iter;
       iter.TakeReference(cd->NewIterator());
 
-      int nLocalBlocks = 0;
-      for (iter->InitTraversal(); !iter->IsDoneWithTraversal();
-          iter->GoToNextItem()) ++nLocalBlocks;
-
-      MPI_Allreduce(MPI_IN_PLACE, &nLocalBlocks,
-          1, MPI_INT, MPI_MAX, this->Comm);
-
-      bool useCollectives = (nLocalBlocks==1);
-
-      if (!useCollectives)
-        {
-        if (!this->CommRank)
-          SENSEI_WARNING("COLLECTIVE BUFFERING IS DISABLED BECAUSE THERE "
-            "IS AT LEAST ONE PROCESS WITH MORE THAN ONE BLOCK")
-        }
-
-      // write the array
       for (iter->InitTraversal(); !iter->IsDoneWithTraversal();
           iter->GoToNextItem())
         {
@@ -462,16 +523,38 @@ int PosthocIO::WriteBOV(vtkCompositeDataSet *cd,
           continue;
           }
 
-        // dispatch the write
-        if (impl::write(fh, MPI_INFO_NULL, wholeExt, localExt,
-              validExt, da, useCollectives))
+        int daSize = da->GetDataTypeSize()*da->GetNumberOfComponents();
+        if (elemSize && (daSize != elemSize))
           {
-          SENSEI_ERROR("write failed \"" << fileName)
+          SENSEI_ERROR("Blocks of array \"" << arrayName
+            << "\" have different types")
           return -1;
           }
+        elemSize = daSize;
+
+        impl::appendRuns(wholeExt, localExt, validExt,
+          static_cast<const char*>(da->GetVoidPointer(0)), elemSize, runs);
+        }
+
+      // open the file
+      MPI_File fh;
+      if (MPI_File_open(this->Comm, fileName.c_str(),
+        MPI_MODE_WRONLY|MPI_MODE_CREATE, this->Hints, &fh) != MPI_SUCCESS)
+        {
+        SENSEI_ERROR("Open failed \"" << fileName);
+        return -1;
         }
+
+      // write the array
+      if (impl::writeRuns(fh, this->Hints, runs, elemSize))
+        {
+        SENSEI_ERROR("write failed \"" << fileName)
+        MPI_File_close(&fh);
+        return -1;
+        }
+
       // close file
-      arrayIO::close(fh);
+      MPI_File_close(&fh);
       }
     }
   return 0;
@@ -30,6 +30,11 @@ public:
     const std::string &meshName, const std::vector<std::string> &cellArrays,
     const std::vector<std::string> &pointArrays, int mode, int period);
 
+  /// set an MPI-IO hint, such as cb_nodes, cb_buffer_size,
+  /// striping_factor, or striping_unit, used when opening and
+  /// writing the BOV files
+  void SetHint(const std::string &key, const std::string &value);
+
   bool Execute(DataAdaptor* data) override;
 
   int WriteBOVHeader(vtkInformation *info);
@@ -61,6 +66,7 @@ private:
   bool HaveHeader;
   int Mode;
   int Period;
+  MPI_Info Hints;
 
 private:
   PosthocIO(const PosthocIO&);
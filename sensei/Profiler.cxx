@@ -1,8 +1,9 @@
 #include "Profiler.h"
 #include "MemoryProfiler.h"
+#include "EnergyMeter.h"
+#include "MPIUtils.h"
 #include "Error.h"
 
-#include <sys/time.h>
 #include <fstream>
 #include <cstdlib>
 #include <cstring>
@@ -12,136 +13,1699 @@
 #include <cstdlib>
 #include <cstdlib>
 #include <cstdio>
+#include <cmath>
+#include <cctype>
 
 #include <map>
-#include <list>
+#include <deque>
+#include <algorithm>
 #include <vector>
 #include <iomanip>
 #include <limits>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if !defined(_WIN32)
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
 
 namespace impl
 {
 #if defined(ENABLE_PROFILER)
 
+// the hardware counters read at the boundaries of events, see
+// Profiler::Initialize
+enum { CYCLES=0, INSTRUCTIONS=1, CACHE_MISSES=2, NUM_COUNTERS=3 };
+
+// the energy domains read at the boundaries of events
+enum { NUM_ENERGY=sensei::EnergyMeter::NUM_DOMAINS };
+
+// Event names are interned. Each distinct name is stored once and events
+// refer to it by id. Entries are never removed and their addresses are
+// stable so that threads may hold on to them without locking.
+struct Name
+{
+  Name(const char *name, unsigned int id) : Str(name), Id(id),
+    Tracked(false), Total(0.0), HasValue(false), Value(0) {}
+
+  std::string Str;
+  unsigned int Id;
+
+  // set when the accumulated duration is tracked, see TrackEvent
+  std::atomic<bool> Tracked;
+  double Total;
+
+  // the last value of a counter, see GetCounter
+  std::atomic<bool> HasValue;
+  std::atomic<long long> Value;
+};
+
 // container for data captured in a timing Event
 struct Event
 {
-  Event();
-
-  // serializes the Event in CSV format into the stream.
-  void ToStream(std::ostream &str) const;
+  Event() : NameId(0), Depth(0), NumBytes(-1ll), Time{0,0},
+    Counters{-1ll,-1ll,-1ll}, Energy{-1ll,-1ll,-1ll}, Weight(1) {}
 
-  enum { START=0, END=1, DELTA=2 }; // record fields
+  enum { START=0, END=1 }; // record fields
 
-  // user provided identifier for the record
-  std::string Name;
+  // the interned name of the event
+  unsigned int NameId;
 
-  // Event duration, initially start Time, end Time and duration
-  // are recorded. when summarizing this contains min,max and sum
-  // of the summariezed set of events
-  double Time[3];
+  // how deep is the Event stack
+  int Depth;
 
   // the number of bytes, if this is an I/O or datamovement operation
   // else -1
   long long NumBytes;
 
-  // how deep is the Event stack
-  int Depth;
+  // start and end times in seconds
+  double Time[2];
+
+  // the change in the hardware counters over the event, or -1 when the
+  // counters are not in use
+  long long Counters[NUM_COUNTERS];
+
+  // the energy used by the node over the event in micro joules, per
+  // domain, or -1 when energy is not measured
+  long long Energy[NUM_ENERGY];
+
+  // the number of events of the name this one stands for, itself and those
+  // skipped by sampling, see Profiler::SetSamplingThreshold
+  long long Weight;
 
   // the thread id that generated the Event
   std::thread::id Tid;
 };
 
+// an event that has started and not yet ended
+struct ActiveEvent
+{
+  const Name *EventName;
+  double StartTime;
+
+  // the bytes reported by the events nested in this one
+  long long ChildBytes;
+
+  // the hardware counters when the event started
+  long long Counters[NUM_COUNTERS];
+
+  // the energy meter when the event started
+  long long Energy[NUM_ENERGY];
+
+  // false when the event is skipped by sampling. a skipped event only
+  // keeps its place on the stack
+  bool Sampled;
+};
+
+// The sampling of the events of a name on a thread, see
+// Profiler::SetSamplingThreshold. The events are counted in each step by
+// the thread that owns the log, without locking. Those that are skipped
+// are added to the weight of the next event of the name that is recorded,
+// or of the last one when the events are taken, so that the counts are
+// kept.
+struct SampleState
+{
+  SampleState() : Step(-1), Count(0), Skipped(0), Last(-1) {}
+
+  // the step the events were counted in, and their number
+  long long Step;
+  long long Count;
+
+  // the events skipped since the last that was recorded
+  std::atomic<long long> Skipped;
+
+  // the position in the log of the last event that was recorded, or -1.
+  // guarded by the EventsMutex
+  long long Last;
+};
+
+// A group of hardware counters counting the user space work of the thread
+// that opened it. The counters are read together in one system call. A
+// group can not follow a thread's log to another thread, it is closed when
+// the thread exits and opened again by the next thread to record.
+struct CounterGroup
+{
+  CounterGroup() : Fd{-1,-1,-1}, Failed(false) {}
+  ~CounterGroup() { this->Close(); }
+
+  // open the counters for the calling thread. returns zero if successful
+  int Open();
+  void Close();
+
+  // read the counters, scaled for the time they were not scheduled when
+  // the kernel multiplexes them. -1 when they could not be opened
+  void Read(long long vals[NUM_COUNTERS]);
+
+  int Fd[NUM_COUNTERS];
+
+  // set after a failed open so that it is not tried at every event
+  bool Failed;
+};
+
+// the time, bytes, and number of the events of a name, or the last value
+// of a counter, accumulated between telemetry updates
+struct Metric
+{
+  Metric() : Time(0.0), Bytes(0), Count(0), Value(0), IsCounter(false) {}
+
+  double Time;
+  long long Bytes;
+  long long Count;
+  long long Value;
+  bool IsCounter;
+};
+
+// Each thread records into a log of its own so that recording takes no
+// shared locks. The log's mutex is only contended while the completed
+// events are taken by a flush. Logs are owned by the profiler and outlive
+// the threads. When a thread exits its log is handed to the next thread that
+// starts recording, so the number of logs is bounded by the number of
+// threads that are alive at once.
+struct ThreadLog
+{
+  ThreadLog() : Bytes(0), InUse(true) {}
+
+  // look up the interned name. a small cache keyed by the address of the
+  // name is checked first. names are often formatted into reused buffers,
+  // see TimeEvent, so a hit is confirmed by comparing the strings
+  const Name *GetName(const char *name);
+
+  // events that have completed
+  std::deque<Event> Events;
+  std::mutex EventsMutex;
+
+  // the stack of events that have started
+  std::vector<ActiveEvent> Active;
+
+  std::unordered_map<const char*, const Name*> NameCache;
+
+  // the calling thread's hardware counters
+  CounterGroup Counters;
+
+  // add the event to the metrics of its name. the caller must hold the
+  // EventsMutex
+  void AddMetric(const Event &evt, bool counter);
+
+  // the metrics of each name, by name id, guarded by the EventsMutex
+  std::vector<Metric> Metrics;
+
+  // decide if the next event of the name is recorded
+  bool Sample(const Name *name);
+
+  // get the sampling state of the name
+  SampleState &GetSampleState(unsigned int id);
+
+  // the sampling state of each name, by name id. entries are only added by
+  // the thread that owns the log, holding the EventsMutex, and their
+  // addresses are stable
+  std::deque<SampleState> Sampling;
+
+  // the bytes reported by the outermost events that report bytes, see
+  // Profiler::GetThreadBytes
+  long long Bytes;
+
+  bool InUse;
+};
+
+// releases the calling thread's log when the thread exits
+struct ThreadLogHolder
+{
+  ThreadLogHolder() : Log(nullptr) {}
+  ~ThreadLogHolder();
+
+  ThreadLog *Log;
+};
+
 #if !defined(SENSEI_HAS_MPI)
 using MPI_Comm = void*;
 #define MPI_COMM_NULL nullptr
 #endif
 static MPI_Comm comm = MPI_COMM_NULL;
 
-static int loggingEnabled = 0x00;
+static std::atomic<int> loggingEnabled(0x00);
+
+// true when the log files carry the hardware counters. this is fixed when
+// the first events are written, so that a file's records share a layout
+static int logCounters = -1;
+
+// true when the log files and summaries carry the energy, likewise fixed
+static int logEnergy = -1;
+
+// true when the log files carry the weights of sampled events, likewise
+// fixed
+static int logSampling = -1;
+
+// set once a failure to open the counters has been reported
+static std::atomic<bool> counterWarning(false);
 
 static std::string timerLogFile = "timer.csv";
 
-using eventLogType = std::list<impl::Event>;
-using threadMapType = std::unordered_map<std::thread::id, eventLogType>;
+// adaptive sampling. once a thread has recorded threshold events of a name
+// in a step, one in ratio of those that follow is recorded. the step is
+// that counted by Checkpoint. zero threshold disables sampling
+static long long samplingThreshold = 0;
+static int samplingRatio = 10;
+static std::atomic<long long> samplingStep(0);
+
+static int timerLogFormat = sensei::Profiler::FORMAT_CSV;
+
+// periodic flushes. events are written once the memory they use on any rank
+// reaches the threshold. a new log file is started once the current one
+// reaches the maximum size. zero disables either
+static long long flushThreshold = 0;
+static long long maxLogSize = 0;
+
+// the current log file, and the size written to it so far
+static int logSegment = 0;
+static long long logOffset = 0;
+
+// summary mode. every interval steps the events are reduced over the ranks
+// to a summary of each name, and only the ranks that are sampled, those
+// whose rank is a multiple of the stride, keep their events. zero interval
+// disables the summaries, zero stride keeps no events
+static int summaryInterval = 0;
+static int sampleStride = 0;
+static std::string summaryFile = "timer_summary.csv";
+
+// the steps, counted by Checkpoint, and the first not yet summarized
+static long long stepCount = 0;
+static long long summaryStart = 0;
+static bool summaryWritten = false;
+
+// the names known to all ranks, in the order of their summary ids
+static std::vector<std::string> summaryNames;
+static std::unordered_map<std::string, int> summaryIds;
+
+// the events of a sampled rank that have been summarized and wait to be
+// written. guarded by the eventLogMutex
+static std::vector<Event> keptEvents;
+
+// telemetry. every interval steps the metrics are reduced over the ranks
+// and rank 0 sends them to a statsd server at the sink, host:port, while
+// the run goes on. an empty sink disables it
+static std::string telemetrySink;
+static std::atomic<bool> telemetryEnabled(false);
+static int telemetryInterval = 1;
+static long long telemetryStart = 0;
+
+// the socket and address of the statsd server on rank 0, and a flag set
+// when it could not be opened
+static int telemetrySocket = -1;
+static bool telemetryFailed = false;
+#if !defined(_WIN32)
+static struct sockaddr_storage telemetryAddr;
+static socklen_t telemetryAddrLen = 0;
+#endif
 
-static eventLogType eventLog;
-static threadMapType activeEvents;
+// the interned names, and the logs of all threads. the mutex is only taken
+// when a name is seen for the first time, when a thread records its first
+// event, and when the logs are written
+static std::deque<Name> names;
+static std::unordered_map<std::string, Name*> nameIndex;
+static std::vector<std::unique_ptr<ThreadLog>> threadLogs;
 static std::mutex eventLogMutex;
 
+// accumulated duration of tracked events
+static std::mutex trackedMutex;
+
+static thread_local ThreadLogHolder threadLog;
+
 // memory profiler
 static sensei::MemoryProfiler memProf;
 
+// times are taken from the monotonic clock and reported relative to the
+// system epoch
+static const double clockOffset =
+  std::chrono::duration<double>(
+    std::chrono::system_clock::now().time_since_epoch()).count() -
+  std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+
 // return high res system Time relative to system epoch
 static double getSystemTime()
 {
-  struct timeval tv;
-  gettimeofday(&tv, nullptr);
-  return tv.tv_sec + tv.tv_usec/1.0e6;
+  return clockOffset + std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// get the interned name, adding it if it has not been seen. the
+// caller must hold the eventLogMutex
+static Name *internName(const char *name)
+{
+  std::unordered_map<std::string, Name*>::iterator it = nameIndex.find(name);
+  if (it != nameIndex.end())
+    return it->second;
+
+  names.emplace_back(name, names.size());
+  Name *entry = &names.back();
+  nameIndex[entry->Str] = entry;
+
+  return entry;
+}
+
+// get the calling thread's log
+static ThreadLog *getThreadLog()
+{
+  ThreadLog *log = threadLog.Log;
+  if (log)
+    return log;
+
+  std::lock_guard<std::mutex> lock(eventLogMutex);
+
+  // reuse the log of a thread that has exited
+  size_t nLogs = threadLogs.size();
+  for (size_t i = 0; i < nLogs; ++i)
+    {
+    if (!threadLogs[i]->InUse)
+      {
+      log = threadLogs[i].get();
+      log->InUse = true;
+      break;
+      }
+    }
+
+  if (!log)
+    {
+    threadLogs.emplace_back(new ThreadLog);
+    log = threadLogs.back().get();
+    }
+
+  threadLog.Log = log;
+
+  return log;
+}
+
+// --------------------------------------------------------------------------
+ThreadLogHolder::~ThreadLogHolder()
+{
+  if (this->Log)
+    {
+    // the counters count this thread only
+    this->Log->Counters.Close();
+    this->Log->Counters.Failed = false;
+
+    std::lock_guard<std::mutex> lock(eventLogMutex);
+    this->Log->InUse = false;
+    }
+}
+
+// --------------------------------------------------------------------------
+void ThreadLog::AddMetric(const Event &evt, bool counter)
+{
+  if (evt.NameId >= this->Metrics.size())
+    this->Metrics.resize(evt.NameId + 1);
+
+  Metric &m = this->Metrics[evt.NameId];
+  if (counter)
+    {
+    m.Value = evt.NumBytes;
+    m.IsCounter = true;
+    }
+  else
+    {
+    m.Time += evt.Weight*(evt.Time[Event::END] - evt.Time[Event::START]);
+    if (evt.NumBytes > 0)
+      m.Bytes += evt.Weight*evt.NumBytes;
+    }
+  m.Count += evt.Weight;
+}
+
+// --------------------------------------------------------------------------
+bool ThreadLog::Sample(const Name *name)
+{
+  // tracked events are always recorded, their totals are used at run time
+  long long threshold = samplingThreshold;
+  if ((threshold <= 0) || (samplingRatio <= 1) || name->Tracked)
+    return true;
+
+  SampleState &state = this->GetSampleState(name->Id);
+
+  long long step = samplingStep.load(std::memory_order_relaxed);
+  if (state.Step != step)
+    {
+    state.Step = step;
+    state.Count = 0;
+    }
+
+  state.Count += 1;
+
+  return (state.Count <= threshold) ||
+    (((state.Count - threshold) % samplingRatio) == 0);
+}
+
+// --------------------------------------------------------------------------
+SampleState &ThreadLog::GetSampleState(unsigned int id)
+{
+  if (id >= this->Sampling.size())
+    {
+    std::lock_guard<std::mutex> elock(this->EventsMutex);
+    while (this->Sampling.size() <= id)
+      this->Sampling.emplace_back();
+    }
+
+  return this->Sampling[id];
+}
+
+// --------------------------------------------------------------------------
+int CounterGroup::Open()
+{
+#if defined(__linux__)
+  // cycles leads the group, all of the counters are scheduled together
+  unsigned long long config[NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+
+  for (int i = 0; i < NUM_COUNTERS; ++i)
+    {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config[i];
+    attr.read_format = PERF_FORMAT_GROUP |
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    this->Fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1,
+      i ? this->Fd[0] : -1, 0);
+
+    if (this->Fd[i] < 0)
+      {
+      if (!counterWarning.exchange(true))
+        {
+        const char *estr = strerror(errno);
+        SENSEI_WARNING("Failed to open the hardware counters. " << estr
+          << ". Check /proc/sys/kernel/perf_event_paranoid")
+        }
+      this->Close();
+      this->Failed = true;
+      return -1;
+      }
+    }
+
+  return 0;
+#else
+  if (!counterWarning.exchange(true))
+    SENSEI_WARNING("Hardware counters require perf_event on Linux")
+  this->Failed = true;
+  return -1;
+#endif
+}
+
+// --------------------------------------------------------------------------
+void CounterGroup::Close()
+{
+  for (int i = 0; i < NUM_COUNTERS; ++i)
+    {
+#if defined(__linux__)
+    if (this->Fd[i] >= 0)
+      close(this->Fd[i]);
+#endif
+    this->Fd[i] = -1;
+    }
+}
+
+// --------------------------------------------------------------------------
+void CounterGroup::Read(long long vals[NUM_COUNTERS])
+{
+  for (int i = 0; i < NUM_COUNTERS; ++i)
+    vals[i] = -1ll;
+
+  if ((this->Fd[0] < 0) && (this->Failed || this->Open()))
+    return;
+
+#if defined(__linux__)
+  // the number of counters, the times enabled and running, the values
+  unsigned long long buf[3 + NUM_COUNTERS];
+  if ((read(this->Fd[0], buf, sizeof(buf)) != sizeof(buf)) ||
+    (buf[0] != NUM_COUNTERS))
+    return;
+
+  double scale = (buf[2] > 0) && (buf[2] < buf[1]) ?
+    double(buf[1])/double(buf[2]) : 1.0;
+
+  for (int i = 0; i < NUM_COUNTERS; ++i)
+    vals[i] = scale*buf[3 + i];
+#endif
+}
+
+// --------------------------------------------------------------------------
+const Name *ThreadLog::GetName(const char *name)
+{
+  std::unordered_map<const char*, const Name*>::iterator it =
+    this->NameCache.find(name);
+
+  if ((it != this->NameCache.end()) && (strcmp(it->second->Str.c_str(), name) == 0))
+    return it->second;
+
+  const Name *entry = nullptr;
+  {
+  std::lock_guard<std::mutex> lock(eventLogMutex);
+  entry = internName(name);
+  }
+
+  this->NameCache[name] = entry;
+
+  return entry;
+}
+
+//-----------------------------------------------------------------------------
+static void toStream(std::ostream &str, int rank, bool counters,
+  bool energy, bool sampling, const Event &evt)
+{
+  str << rank << ", " << evt.Tid << ", \"" << names[evt.NameId].Str << "\", "
+    << evt.Time[Event::START] << ", " << evt.Time[Event::END] << ", "
+    << evt.Time[Event::END] - evt.Time[Event::START] << ", " << evt.NumBytes
+    << ", " << evt.Depth;
+
+  if (counters)
+    str << ", " << evt.Counters[CYCLES] << ", " << evt.Counters[INSTRUCTIONS]
+      << ", " << evt.Counters[CACHE_MISSES];
+
+  if (energy)
+    {
+    for (int i = 0; i < NUM_ENERGY; ++i)
+      str << ", " << evt.Energy[i];
+    }
+
+  if (sampling)
+    str << ", " << evt.Weight;
+
+  str << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+static int getRank()
+{
+  int rank = 0;
+#if defined(SENSEI_HAS_MPI)
+  int ini = 0, fin = 0;
+  MPI_Initialized(&ini);
+  MPI_Finalized(&fin);
+  if (ini && !fin)
+    MPI_Comm_rank(impl::comm, &rank);
+#endif
+  return rank;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void append(std::string &buf, const T &val)
+{
+  buf.append(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+// the name of the current log file. the first is the configured name,
+// those that follow have the segment number appended
+static std::string getLogFileName()
+{
+  if (logSegment == 0)
+    return timerLogFile;
+
+  std::ostringstream oss;
+  oss << timerLogFile << "." << logSegment;
+  return oss.str();
+}
+
+// the memory used by the completed events on this rank. in summary mode
+// only the events that are kept can be written
+static long long getBufferedBytes()
+{
+  std::lock_guard<std::mutex> lock(eventLogMutex);
+
+  long long nEvents = keptEvents.size();
+  if (summaryInterval > 0)
+    return nEvents*sizeof(Event);
+
+  size_t nLogs = threadLogs.size();
+  for (size_t i = 0; i < nLogs; ++i)
+    {
+    std::lock_guard<std::mutex> elock(threadLogs[i]->EventsMutex);
+    nEvents += threadLogs[i]->Events.size();
+    }
+
+  return nEvents*sizeof(Event);
+}
+
+// move the completed events out of the thread logs. the events skipped by
+// sampling since the last event of their name that was recorded are added
+// to its weight. the caller must hold the eventLogMutex
+static void takeEvents(std::vector<Event> &evts)
+{
+  size_t nLogs = threadLogs.size();
+  for (size_t i = 0; i < nLogs; ++i)
+    {
+    std::lock_guard<std::mutex> elock(threadLogs[i]->EventsMutex);
+    std::deque<Event> &log = threadLogs[i]->Events;
+
+    std::deque<SampleState> &sampling = threadLogs[i]->Sampling;
+    size_t nNames = sampling.size();
+    for (size_t j = 0; j < nNames; ++j)
+      {
+      SampleState &state = sampling[j];
+      if (state.Last < 0)
+        continue;
+
+      Event &last = log[state.Last];
+      long long nSkipped = state.Skipped.exchange(0);
+      if (nSkipped && telemetryEnabled)
+        {
+        Event skipped = last;
+        skipped.Weight = nSkipped;
+        threadLogs[i]->AddMetric(skipped, false);
+        }
+
+      last.Weight += nSkipped;
+      state.Last = -1;
+      }
+
+    evts.insert(evts.end(), log.begin(), log.end());
+    log.clear();
+    }
+}
+
+// serialize the events in CSV format. the caller must hold the
+// eventLogMutex
+static void toCSV(std::string &buf, int rank, bool header,
+  const std::vector<Event> &evts)
+{
+  std::ostringstream oss;
+  oss.precision(std::numeric_limits<double>::digits10 + 2);
+  oss.setf(std::ios::scientific, std::ios::floatfield);
+
+  if (header)
+    oss << "# rank, thread, Name, start Time, end Time, delta, Depth"
+      << (logCounters ? ", cycles, instructions, cache misses" : "")
+      << (logEnergy ? ", cpu uJ, dram uJ, gpu uJ" : "")
+      << (logSampling ? ", weight" : "")
+      << std::endl;
+
+  size_t nEvents = evts.size();
+  for (size_t i = 0; i < nEvents; ++i)
+    toStream(oss, rank, logCounters, logEnergy, logSampling, evts[i]);
+
+  buf.append(oss.str());
+}
+
+// serialize the events in the binary format, see
+// Profiler::SetTimerLogFormat. the caller must hold the eventLogMutex
+static void toBinary(std::string &buf, int rank, bool header,
+  const std::vector<Event> &evts)
+{
+  if (header)
+    {
+    // the version gives the optional fields
+    const char *version[] = {"SENSEIPROF1\n", "SENSEIPROF2\n",
+      "SENSEIPROF3\n", "SENSEIPROF4\n", "SENSEIPROF5\n", "SENSEIPROF6\n",
+      "SENSEIPROF7\n", "SENSEIPROF8\n"};
+    buf.append(version[(logCounters ? 1 : 0) + (logEnergy ? 2 : 0) +
+      (logSampling ? 4 : 0)]);
+    }
+
+  // the names
+  append(buf, int(rank));
+  append(buf, int(names.size()));
+
+  std::deque<Name>::iterator nit = names.begin();
+  std::deque<Name>::iterator nend = names.end();
+  for (; nit != nend; ++nit)
+    {
+    append(buf, int(nit->Str.size()));
+    buf.append(nit->Str);
+    }
+
+  // the events
+  long long nEvents = evts.size();
+  append(buf, nEvents);
+
+  std::hash<std::thread::id> tidHash;
+  for (long long i = 0; i < nEvents; ++i)
+    {
+    const Event &evt = evts[i];
+    append(buf, (unsigned long long)tidHash(evt.Tid));
+    append(buf, evt.NameId);
+    append(buf, evt.Depth);
+    append(buf, evt.NumBytes);
+    append(buf, evt.Time[Event::START]);
+    append(buf, evt.Time[Event::END]);
+
+    if (logCounters)
+      {
+      for (int j = 0; j < NUM_COUNTERS; ++j)
+        append(buf, evt.Counters[j]);
+      }
+
+    if (logEnergy)
+      {
+      for (int j = 0; j < NUM_ENERGY; ++j)
+        append(buf, evt.Energy[j]);
+      }
+
+    if (logSampling)
+      append(buf, evt.Weight);
+    }
+}
+
+// write the string as a JSON string literal
+static void toJSONString(std::ostream &os, const std::string &str)
+{
+  os << '"';
+  size_t n = str.size();
+  for (size_t i = 0; i < n; ++i)
+    {
+    char c = str[i];
+    if ((c == '"') || (c == '\\'))
+      os << '\\' << c;
+    else if ((unsigned char)c < 0x20)
+      os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+        << int(c) << std::dec << std::setfill(' ');
+    else
+      os << c;
+    }
+  os << '"';
+}
+
+// threads are numbered in the order they are seen so that the lanes of a
+// rank keep their order from one write to the next
+static std::unordered_map<std::thread::id, int> threadNumbers;
+
+// the threads that have been named in the current log file
+static std::vector<bool> threadNamed;
+
+// serialize the events in the Chrome trace event format, see
+// Profiler::SetTimerLogFormat. the caller must hold the eventLogMutex
+static void toChrome(std::string &buf, int rank, bool header,
+  const std::vector<Event> &evts)
+{
+  std::ostringstream oss;
+  oss.precision(3);
+  oss.setf(std::ios::fixed, std::ios::floatfield);
+
+  // a new file starts the array and names the rank's lane
+  if (header)
+    oss << "[" << std::endl;
+
+  if (logOffset == 0)
+    {
+    oss << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank
+      << ",\"args\":{\"name\":\"rank " << rank << "\"}}," << std::endl
+      << "{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":" << rank
+      << ",\"args\":{\"sort_index\":" << rank << "}}," << std::endl;
+
+    threadNamed.assign(threadNamed.size(), false);
+    }
+
+  size_t nEvents = evts.size();
+  for (size_t i = 0; i < nEvents; ++i)
+    {
+    const Event &evt = evts[i];
+
+    std::unordered_map<std::thread::id, int>::iterator it =
+      threadNumbers.find(evt.Tid);
+    if (it == threadNumbers.end())
+      {
+      it = threadNumbers.insert(std::make_pair(evt.Tid,
+        int(threadNumbers.size()))).first;
+      threadNamed.push_back(false);
+      }
+
+    int tid = it->second;
+    if (!threadNamed[tid])
+      {
+      oss << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << rank
+        << ",\"tid\":" << tid << ",\"args\":{\"name\":\"thread " << tid
+        << "\"}}," << std::endl;
+      threadNamed[tid] = true;
+      }
+
+    // times are in micro seconds
+    double ts = 1.0e6*evt.Time[Event::START];
+    double dur = 1.0e6*(evt.Time[Event::END] - evt.Time[Event::START]);
+
+    oss << "{\"name\":";
+    toJSONString(oss, names[evt.NameId].Str);
+    oss << ",\"ph\":\"X\",\"ts\":" << ts << ",\"dur\":" << dur
+      << ",\"pid\":" << rank << ",\"tid\":" << tid
+      << ",\"args\":{\"bytes\":" << evt.NumBytes << ",\"depth\":"
+      << evt.Depth;
+
+    if (evt.Counters[CYCLES] >= 0)
+      oss << ",\"cycles\":" << evt.Counters[CYCLES] << ",\"instructions\":"
+        << evt.Counters[INSTRUCTIONS] << ",\"cache_misses\":"
+        << evt.Counters[CACHE_MISSES];
+
+    for (int j = 0; j < NUM_ENERGY; ++j)
+      {
+      if (evt.Energy[j] >= 0)
+        oss << ",\"" << sensei::EnergyMeter::GetDomainName(j) << "_uj\":"
+          << evt.Energy[j];
+      }
+
+    if (logSampling)
+      oss << ",\"weight\":" << evt.Weight;
+
+    oss << "}}," << std::endl;
+
+    // byte counts are shown as a counter track
+    if (evt.NumBytes >= 0)
+      {
+      oss << "{\"name\":";
+      toJSONString(oss, names[evt.NameId].Str);
+      oss << ",\"ph\":\"C\",\"ts\":" << ts << ",\"pid\":" << rank
+        << ",\"args\":{\"bytes\":" << evt.NumBytes << "}}," << std::endl;
+      }
+    }
+
+  buf.append(oss.str());
+}
+
+// take the completed events and serialize them. the header is written by
+// rank 0 at the start of each log file
+static void serializeEvents(std::string &buf, int rank)
+{
+  bool header = (rank == 0) && (logOffset == 0);
+
+  std::lock_guard<std::mutex> lock(eventLogMutex);
+
+  if (logCounters < 0)
+    logCounters = (loggingEnabled & 0x08) ? 1 : 0;
+
+  if (logEnergy < 0)
+    logEnergy = (loggingEnabled & 0x10) ? 1 : 0;
+
+  if (logSampling < 0)
+    logSampling = samplingThreshold > 0 ? 1 : 0;
+
+  // in summary mode the events are taken by the summaries
+  std::vector<Event> evts;
+  evts.swap(keptEvents);
+
+  if (summaryInterval <= 0)
+    takeEvents(evts);
+
+  if (timerLogFormat == sensei::Profiler::FORMAT_BINARY)
+    toBinary(buf, rank, header, evts);
+  else if (timerLogFormat == sensei::Profiler::FORMAT_CHROME)
+    toChrome(buf, rank, header, evts);
+  else
+    toCSV(buf, rank, header, evts);
+}
+
+#if defined(SENSEI_HAS_MPI)
+// collectively write the contents of the string to the file in rank order
+// starting at offset. the file is truncated to the end of the data written.
+// returns the number of bytes written by all ranks
+static long writeMpiIo(MPI_Comm comm, const char *fileName,
+  const std::string &str, long offset)
+{
+  long nBytes = str.size();
+
+  int rank = 0;
+  int nRanks = 1;
+
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  std::vector<long> gsizes(nRanks);
+  gsizes[rank] = nBytes;
+
+  MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+    gsizes.data(), 1, MPI_LONG, comm);
+
+  for (int i = 0; i < rank; ++i)
+    offset += gsizes[i];
+
+  long totalSize = 0;
+  for (int i = 0; i < nRanks; ++i)
+    totalSize += gsizes[i];
+
+  long fileSize = offset;
+  for (int i = rank; i < nRanks; ++i)
+    fileSize += gsizes[i];
+
+  // write the buffer
+  MPI_File fh;
+  MPI_File_open(comm, fileName,
+    MPI_MODE_CREATE|MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+
+  MPI_File_set_view(fh, offset, MPI_BYTE, MPI_BYTE,
+    "native", MPI_INFO_NULL);
+
+  sensei::MPIUtils::FileWrite(fh, str.c_str(), nBytes, MPI_BYTE);
+
+  MPI_File_set_size(fh, fileSize);
+
+  MPI_File_close(&fh);
+
+  return totalSize;
+}
+#endif
+
+// write the completed events to the end of the current log file, and move
+// on to the next file when the current one is full. when MPI is in use this
+// is collective. returns the number of bytes written by this rank
+static long long writeEvents()
+{
+  int ok = 0;
+#if defined(SENSEI_HAS_MPI)
+  int fin = 0;
+  MPI_Initialized(&ok);
+  MPI_Finalized(&fin);
+  ok = ok && !fin && (comm != MPI_COMM_NULL);
+#endif
+
+  int rank = getRank();
+
+  std::string buf;
+  serializeEvents(buf, rank);
+
+  std::string fileName = getLogFileName();
+
+#if defined(SENSEI_HAS_MPI)
+  if (ok)
+    {
+    logOffset += writeMpiIo(comm, fileName.c_str(), buf, logOffset);
+    }
+  else
+#endif
+    {
+    sensei::Profiler::WriteCStdio(fileName.c_str(),
+      logOffset ? "a" : "w", buf);
+    logOffset += buf.size();
+    }
+
+  if ((maxLogSize > 0) && (logOffset >= maxLogSize))
+    {
+    logSegment += 1;
+    logOffset = 0;
+    }
+
+  return buf.size();
+}
+
+// true when the full event log is written, in summary mode this is only so
+// when ranks are sampled
+static bool writesEventLog()
+{
+  return (summaryInterval <= 0) || (sampleStride > 0);
+}
+
+// agree on the names. those already known keep their ids, the new ones,
+// given as null terminated strings, are gathered to rank 0 and numbered
+// there. names rarely change from one call to the next so that usually only
+// the count is reduced. when MPI is in use this is collective
+static void shareNames(int ok, int rank, std::string &newNames, int nNew)
+{
+  std::string addedNames;
+#if defined(SENSEI_HAS_MPI)
+  if (ok)
+    {
+    int nRanks = 1;
+    MPI_Comm_size(comm, &nRanks);
+
+    int anyNew = nNew;
+    MPI_Allreduce(MPI_IN_PLACE, &anyNew, 1, MPI_INT, MPI_MAX, comm);
+
+    if (anyNew)
+      {
+      int nBytes = newNames.size();
+      std::vector<int> counts(rank == 0 ? nRanks : 0);
+      MPI_Gather(&nBytes, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+
+      std::vector<int> displs;
+      std::vector<char> gathered;
+      if (rank == 0)
+        {
+        displs.resize(nRanks, 0);
+        for (int i = 1; i < nRanks; ++i)
+          displs[i] = displs[i-1] + counts[i-1];
+        gathered.resize(displs[nRanks-1] + counts[nRanks-1] + 1);
+        }
+
+      MPI_Gatherv(newNames.data(), nBytes, MPI_CHAR, gathered.data(),
+        counts.data(), displs.data(), MPI_CHAR, 0, comm);
+
+      if (rank == 0)
+        {
+        std::unordered_map<std::string, int> seen;
+        size_t n = gathered.size() - 1;
+        for (size_t i = 0; i < n; )
+          {
+          std::string name(gathered.data() + i);
+          i += name.size() + 1;
+          if (seen.insert(std::make_pair(name, 0)).second)
+            {
+            addedNames.append(name);
+            addedNames.push_back('\0');
+            }
+          }
+        }
+
+      nBytes = addedNames.size();
+      MPI_Bcast(&nBytes, 1, MPI_INT, 0, comm);
+
+      addedNames.resize(nBytes);
+      MPI_Bcast(&addedNames[0], nBytes, MPI_CHAR, 0, comm);
+      }
+    }
+  else
+#endif
+    {
+    addedNames.swap(newNames);
+    }
+
+  size_t nAdded = addedNames.size();
+  for (size_t i = 0; i < nAdded; )
+    {
+    std::string name(addedNames.data() + i);
+    i += name.size() + 1;
+    summaryIds[name] = summaryNames.size();
+    summaryNames.push_back(name);
+    }
+}
+
+// the time each rank spent in events of a name, and the rank that spent
+// the least and the most, as used by MPI_MINLOC and MPI_MAXLOC
+struct RankTime
+{
+  double Time;
+  int Rank;
+};
+
+// reduce the events recorded since the last summary over the ranks and
+// append a line per name to the summary file. the events are released
+// unless the rank is sampled. when MPI is in use this is collective
+static int summarizeEvents()
+{
+  int ok = 0;
+#if defined(SENSEI_HAS_MPI)
+  int fin = 0;
+  MPI_Initialized(&ok);
+  MPI_Finalized(&fin);
+  ok = ok && !fin && (comm != MPI_COMM_NULL);
+#endif
+
+  int rank = getRank();
+
+  // take the events, and the names this rank has not yet shared
+  std::vector<Event> evts;
+  std::vector<int> localIds;
+  std::string newNames;
+  int nNew = 0;
+  {
+  std::lock_guard<std::mutex> lock(eventLogMutex);
+
+  takeEvents(evts);
+
+  localIds.resize(names.size(), -1);
+
+  size_t nEvents = evts.size();
+  for (size_t i = 0; i < nEvents; ++i)
+    {
+    unsigned int nid = evts[i].NameId;
+    if (localIds[nid] != -1)
+      continue;
+
+    const std::string &name = names[nid].Str;
+    std::unordered_map<std::string, int>::iterator it = summaryIds.find(name);
+    if (it == summaryIds.end())
+      {
+      localIds[nid] = -2;
+      newNames.append(name);
+      newNames.push_back('\0');
+      nNew += 1;
+      }
+    else
+      {
+      localIds[nid] = it->second;
+      }
+    }
+
+  if ((sampleStride > 0) && ((rank % sampleStride) == 0))
+    keptEvents.insert(keptEvents.end(), evts.begin(), evts.end());
+  }
+
+  shareNames(ok, rank, newNames, nNew);
+
+  if (logEnergy < 0)
+    logEnergy = (loggingEnabled & 0x10) ? 1 : 0;
+
+  // the time and count of each name on this rank, and the energy in
+  // joules summed over the domains
+  int nNames = summaryNames.size();
+  std::vector<double> sums(4*nNames, 0.0);
+  std::vector<double> energy(logEnergy ? nNames : 0, 0.0);
+
+  {
+  std::lock_guard<std::mutex> lock(eventLogMutex);
+  size_t nEvents = evts.size();
+  for (size_t i = 0; i < nEvents; ++i)
+    {
+    const Event &evt = evts[i];
+    int &id = localIds[evt.NameId];
+    if (id < 0)
+      id = summaryIds[names[evt.NameId].Str];
+
+    // sampled events stand for those that were skipped
+    sums[4*id] += evt.Weight*(evt.Time[Event::END] - evt.Time[Event::START]);
+    sums[4*id + 3] += evt.Weight;
+
+    for (int j = 0; logEnergy && (j < NUM_ENERGY); ++j)
+      {
+      if (evt.Energy[j] > 0)
+        energy[id] += 1.0e-6*evt.Weight*evt.Energy[j];
+      }
+    }
+  }
+
+  // the sum of the time and its square over the ranks, the number of
+  // ranks, and the number of events, and the extremes and their ranks.
+  // ranks without events of a name are left out
+  std::vector<RankTime> minTime(nNames);
+  std::vector<RankTime> maxTime(nNames);
+  for (int i = 0; i < nNames; ++i)
+    {
+    double t = sums[4*i];
+    bool present = sums[4*i + 3] > 0.0;
+
+    sums[4*i + 1] = t*t;
+    sums[4*i + 2] = present ? 1.0 : 0.0;
+
+    minTime[i].Time = present ? t : std::numeric_limits<double>::max();
+    minTime[i].Rank = rank;
+
+    maxTime[i].Time = present ? t : -std::numeric_limits<double>::max();
+    maxTime[i].Rank = rank;
+    }
+
+#if defined(SENSEI_HAS_MPI)
+  if (ok)
+    {
+    void *sendBuf = rank == 0 ? MPI_IN_PLACE : sums.data();
+    MPI_Reduce(sendBuf, sums.data(), 4*nNames, MPI_DOUBLE, MPI_SUM,
+      0, comm);
+
+    if (logEnergy)
+      {
+      sendBuf = rank == 0 ? MPI_IN_PLACE : energy.data();
+      MPI_Reduce(sendBuf, energy.data(), nNames, MPI_DOUBLE, MPI_SUM,
+        0, comm);
+      }
+
+    sendBuf = rank == 0 ? MPI_IN_PLACE : minTime.data();
+    MPI_Reduce(sendBuf, minTime.data(), nNames, MPI_DOUBLE_INT, MPI_MINLOC,
+      0, comm);
+
+    sendBuf = rank == 0 ? MPI_IN_PLACE : maxTime.data();
+    MPI_Reduce(sendBuf, maxTime.data(), nNames, MPI_DOUBLE_INT, MPI_MAXLOC,
+      0, comm);
+    }
+#endif
+
+  long long nSteps = stepCount - summaryStart;
+  long long firstStep = summaryStart;
+  summaryStart = stepCount;
+
+  if (rank != 0)
+    return 0;
+
+  std::ostringstream oss;
+  oss.precision(std::numeric_limits<double>::digits10 + 2);
+  oss.setf(std::ios::scientific, std::ios::floatfield);
+
+  if (!summaryWritten)
+    oss << "# first step, steps, Name, ranks, count, min Time, min rank, "
+      "max Time, max rank, mean Time, stddev"
+      << (logEnergy ? ", mean energy J" : "") << std::endl;
+
+  for (int i = 0; i < nNames; ++i)
+    {
+    double nRanks = sums[4*i + 2];
+    if (nRanks <= 0.0)
+      continue;
+
+    double mean = sums[4*i]/nRanks;
+    double var = sums[4*i + 1]/nRanks - mean*mean;
+
+    oss << firstStep << ", " << nSteps << ", \"" << summaryNames[i] << "\", "
+      << (long long)nRanks << ", " << (long long)sums[4*i + 3] << ", "
+      << minTime[i].Time << ", " << minTime[i].Rank << ", "
+      << maxTime[i].Time << ", " << maxTime[i].Rank << ", "
+      << mean << ", " << sqrt(var > 0.0 ? var : 0.0);
+
+    if (logEnergy)
+      oss << ", " << energy[i]/nRanks;
+
+    oss << std::endl;
+    }
+
+  int ierr = sensei::Profiler::WriteCStdio(summaryFile.c_str(),
+    summaryWritten ? "a" : "w", oss.str());
+
+  summaryWritten = true;
+
+  return ierr;
+}
+
+// look up the statsd server and open a socket to send to it
+static int openTelemetry()
+{
+#if !defined(_WIN32)
+  size_t sep = telemetrySink.rfind(':');
+  if ((sep == std::string::npos) || (sep == 0))
+    {
+    SENSEI_ERROR("Invalid telemetry sink \"" << telemetrySink
+      << "\", expected host:port")
+    return -1;
+    }
+
+  std::string host = telemetrySink.substr(0, sep);
+  std::string port = telemetrySink.substr(sep + 1);
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  struct addrinfo *addrs = nullptr;
+  int ierr = getaddrinfo(host.c_str(), port.c_str(), &hints, &addrs);
+  if (ierr || !addrs)
+    {
+    SENSEI_ERROR("Failed to look up the telemetry sink \"" << telemetrySink
+      << "\". " << gai_strerror(ierr))
+    return -1;
+    }
+
+  telemetrySocket = socket(addrs->ai_family, addrs->ai_socktype,
+    addrs->ai_protocol);
+
+  if (telemetrySocket < 0)
+    {
+    const char *estr = strerror(errno);
+    SENSEI_ERROR("Failed to open a socket for the telemetry sink. " << estr)
+    freeaddrinfo(addrs);
+    return -1;
+    }
+
+  memcpy(&telemetryAddr, addrs->ai_addr, addrs->ai_addrlen);
+  telemetryAddrLen = addrs->ai_addrlen;
+
+  freeaddrinfo(addrs);
+
+  return 0;
+#else
+  SENSEI_ERROR("Telemetry requires POSIX sockets")
+  return -1;
+#endif
+}
+
+// send the lines to the statsd server, packed into datagrams small enough
+// to not be fragmented
+static void sendTelemetry(const std::vector<std::string> &lines)
+{
+#if !defined(_WIN32)
+  std::string buf;
+  size_t nLines = lines.size();
+  for (size_t i = 0; i <= nLines; ++i)
+    {
+    if (buf.size() && ((i == nLines) || (buf.size() + lines[i].size() > 1400)))
+      {
+      sendto(telemetrySocket, buf.data(), buf.size(), 0,
+        (struct sockaddr*)&telemetryAddr, telemetryAddrLen);
+      buf.clear();
+      }
+
+    if (i < nLines)
+      {
+      if (buf.size())
+        buf.push_back('\n');
+      buf.append(lines[i]);
+      }
+    }
+#else
+  (void)lines;
+#endif
+}
+
+// the statsd name of an event, sensei.<name> with the characters statsd
+// does not allow replaced
+static std::string telemetryName(const std::string &name)
+{
+  std::string tname("sensei.");
+  size_t n = name.size();
+  for (size_t i = 0; i < n; ++i)
+    {
+    char c = name[i];
+    if ((c == ':') && (i + 1 < n) && (name[i+1] == ':'))
+      {
+      tname.push_back('.');
+      ++i;
+      }
+    else if (isalnum(c) || (c == '_') || (c == '-') || (c == '.'))
+      tname.push_back(c);
+    else
+      tname.push_back('_');
+    }
+  return tname;
+}
+
+// reduce the metrics accumulated since the last update over the ranks and
+// send them from rank 0. when MPI is in use this is collective
+static int publishTelemetry()
+{
+  int ok = 0;
+#if defined(SENSEI_HAS_MPI)
+  int fin = 0;
+  MPI_Initialized(&ok);
+  MPI_Finalized(&fin);
+  ok = ok && !fin && (comm != MPI_COMM_NULL);
+#endif
+
+  int rank = getRank();
+
+  // take the metrics of all threads, and the names this rank has not yet
+  // shared
+  std::vector<Metric> metrics;
+  std::vector<int> localIds;
+  std::string newNames;
+  int nNew = 0;
+  {
+  std::lock_guard<std::mutex> lock(eventLogMutex);
+
+  size_t nLocal = names.size();
+  metrics.resize(nLocal);
+  localIds.resize(nLocal, -1);
+
+  size_t nLogs = threadLogs.size();
+  for (size_t i = 0; i < nLogs; ++i)
+    {
+    std::lock_guard<std::mutex> elock(threadLogs[i]->EventsMutex);
+    std::vector<Metric> &tm = threadLogs[i]->Metrics;
+    size_t nm = tm.size();
+    for (size_t j = 0; j < nm; ++j)
+      {
+      if (tm[j].Count == 0)
+        continue;
+
+      Metric &m = metrics[j];
+      m.Time += tm[j].Time;
+      m.Bytes += tm[j].Bytes;
+      if (tm[j].IsCounter)
+        m.Value = m.Count ? std::max(m.Value, tm[j].Value) : tm[j].Value;
+      m.IsCounter = m.IsCounter || tm[j].IsCounter;
+      m.Count += tm[j].Count;
+
+      tm[j] = Metric();
+      }
+    }
+
+  for (size_t j = 0; j < nLocal; ++j)
+    {
+    if (metrics[j].Count == 0)
+      continue;
+
+    std::unordered_map<std::string, int>::iterator it =
+      summaryIds.find(names[j].Str);
+
+    if (it == summaryIds.end())
+      {
+      localIds[j] = -2;
+      newNames.append(names[j].Str);
+      newNames.push_back('\0');
+      nNew += 1;
+      }
+    else
+      {
+      localIds[j] = it->second;
+      }
+    }
+  }
+
+  shareNames(ok, rank, newNames, nNew);
+
+  // the sums of the time, bytes, number of events, and ranks, and the
+  // largest time, counter value, and counter flag of each name. the
+  // resident set size is last
+  int nNames = summaryNames.size();
+  std::vector<double> sums(4*nNames + 1, 0.0);
+  std::vector<double> maxs(3*nNames + 1, -std::numeric_limits<double>::max());
+
+  {
+  std::lock_guard<std::mutex> lock(eventLogMutex);
+  size_t nLocal = localIds.size();
+  for (size_t j = 0; j < nLocal; ++j)
+    {
+    if (localIds[j] == -1)
+      continue;
+
+    int id = localIds[j] >= 0 ? localIds[j] : summaryIds[names[j].Str];
+    const Metric &m = metrics[j];
+
+    sums[4*id] = m.Time;
+    sums[4*id + 1] = m.Bytes;
+    sums[4*id + 2] = m.Count;
+    sums[4*id + 3] = 1.0;
+
+    maxs[3*id] = m.Time;
+    maxs[3*id + 1] = m.Value;
+    maxs[3*id + 2] = m.IsCounter ? 1.0 : 0.0;
+    }
+  }
+
+  double rss = sensei::MemoryProfiler::GetMemoryUsed();
+  sums[4*nNames] = rss;
+  maxs[3*nNames] = rss;
+
+#if defined(SENSEI_HAS_MPI)
+  if (ok)
+    {
+    void *sendBuf = rank == 0 ? MPI_IN_PLACE : sums.data();
+    MPI_Reduce(sendBuf, sums.data(), sums.size(), MPI_DOUBLE, MPI_SUM,
+      0, comm);
+
+    sendBuf = rank == 0 ? MPI_IN_PLACE : maxs.data();
+    MPI_Reduce(sendBuf, maxs.data(), maxs.size(), MPI_DOUBLE, MPI_MAX,
+      0, comm);
+    }
+#endif
+
+  telemetryStart = stepCount;
+
+  if (rank != 0)
+    return 0;
+
+  // the other ranks keep reducing, only rank 0 knows of the failure
+  if (telemetryFailed)
+    return -1;
+
+  if ((telemetrySocket < 0) && openTelemetry())
+    {
+    telemetryFailed = true;
+    return -1;
+    }
+
+  // counters are sent as their largest value over the ranks, events as
+  // the largest and the mean time, over the ranks that recorded them, the
+  // number of events and the bytes, all summed over the interval
+  std::vector<std::string> lines;
+  std::ostringstream oss;
+  for (int i = 0; i < nNames; ++i)
+    {
+    double nRanks = sums[4*i + 3];
+    if (nRanks <= 0.0)
+      continue;
+
+    std::string name = telemetryName(summaryNames[i]);
+
+    oss.str("");
+    if (maxs[3*i + 2] > 0.0)
+      {
+      oss << name << ":" << (long long)maxs[3*i + 1] << "|g";
+      lines.push_back(oss.str());
+      continue;
+      }
+
+    oss << name << ".time_max:" << maxs[3*i] << "|g";
+    lines.push_back(oss.str());
+
+    oss.str("");
+    oss << name << ".time_mean:" << sums[4*i]/nRanks << "|g";
+    lines.push_back(oss.str());
+
+    oss.str("");
+    oss << name << ".count:" << (long long)sums[4*i + 2] << "|g";
+    lines.push_back(oss.str());
+
+    if (sums[4*i + 1] > 0.0)
+      {
+      oss.str("");
+      oss << name << ".bytes:" << (long long)sums[4*i + 1] << "|g";
+      lines.push_back(oss.str());
+      }
+    }
+
+  oss.str("");
+  oss << "sensei.memory.rss_max:" << (long long)maxs[3*nNames] << "|g";
+  lines.push_back(oss.str());
+
+  oss.str("");
+  oss << "sensei.memory.rss_total:" << (long long)sums[4*nNames] << "|g";
+  lines.push_back(oss.str());
+
+  oss.str("");
+  oss << "sensei.step:" << stepCount << "|g";
+  lines.push_back(oss.str());
+
+  sendTelemetry(lines);
+
+  return 0;
+}
+#endif
+}
+
+
+
+namespace sensei
+{
+
+// ----------------------------------------------------------------------------
+void Profiler::SetCommunicator(MPI_Comm comm)
+{
+#if defined(ENABLE_PROFILER) && defined(SENSEI_HAS_MPI)
+  int ok = 0;
+  MPI_Initialized(&ok);
+  if (ok)
+    {
+    if (impl::comm != MPI_COMM_NULL)
+      MPI_Comm_free(&impl::comm);
+
+    MPI_Comm_dup(comm, &impl::comm);
+    }
+#else
+  (void)comm;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+void Profiler::SetTimerLogFile(const std::string &file)
+{
+#if defined(ENABLE_PROFILER)
+  impl::timerLogFile = file;
+#else
+  (void)file;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+void Profiler::SetTimerLogFormat(int format)
+{
+#if defined(ENABLE_PROFILER)
+  impl::timerLogFormat = format;
+#else
+  (void)format;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+void Profiler::SetFlushThreshold(long long nBytes)
+{
+#if defined(ENABLE_PROFILER)
+  impl::flushThreshold = nBytes;
+#else
+  (void)nBytes;
+#endif
 }
 
-
-// --------------------------------------------------------------------------
-Event::Event() : Time{0,0,0}, NumBytes(-1ll), Depth(0),
-  Tid(std::this_thread::get_id())
+// ----------------------------------------------------------------------------
+void Profiler::SetMaxLogSize(long long nBytes)
 {
+#if defined(ENABLE_PROFILER)
+  impl::maxLogSize = nBytes;
+#else
+  (void)nBytes;
+#endif
 }
 
-//-----------------------------------------------------------------------------
-void Event::ToStream(std::ostream &str) const
+// ----------------------------------------------------------------------------
+void Profiler::SetSummaryInterval(int nSteps)
 {
 #if defined(ENABLE_PROFILER)
-  int rank = 0;
-#if defined(SENSEI_HAS_MPI)
-  int ini = 0, fin = 0;
-  MPI_Initialized(&ini);
-  MPI_Finalized(&fin);
-  if (ini && !fin)
-    MPI_Comm_rank(impl::comm, &rank);
-#endif
-  str << rank << ", " << this->Tid << ", \"" << this->Name << "\", "
-    << this->Time[START] << ", " << this->Time[END] << ", "
-    << this->Time[DELTA] << ", " << this->NumBytes  << ", "
-    << this->Depth << std::endl;
+  impl::summaryInterval = nSteps;
 #else
-  (void)str;
+  (void)nSteps;
 #endif
 }
+
+// ----------------------------------------------------------------------------
+void Profiler::SetSummaryFile(const std::string &file)
+{
+#if defined(ENABLE_PROFILER)
+  impl::summaryFile = file;
+#else
+  (void)file;
 #endif
 }
 
+// ----------------------------------------------------------------------------
+void Profiler::SetSampleStride(int stride)
+{
+#if defined(ENABLE_PROFILER)
+  impl::sampleStride = stride;
+#else
+  (void)stride;
+#endif
+}
 
-
-namespace sensei
+// ----------------------------------------------------------------------------
+void Profiler::SetTelemetrySink(const std::string &sink)
 {
+#if defined(ENABLE_PROFILER)
+  impl::telemetrySink = sink;
+  impl::telemetryEnabled = !sink.empty();
+#else
+  (void)sink;
+#endif
+}
 
 // ----------------------------------------------------------------------------
-void Profiler::SetCommunicator(MPI_Comm comm)
+void Profiler::SetTelemetryInterval(int nSteps)
 {
-#if defined(ENABLE_PROFILER) && defined(SENSEI_HAS_MPI)
-  int ok = 0;
-  MPI_Initialized(&ok);
-  if (ok)
-    {
-    if (impl::comm != MPI_COMM_NULL)
-      MPI_Comm_free(&impl::comm);
+#if defined(ENABLE_PROFILER)
+  impl::telemetryInterval = nSteps > 0 ? nSteps : 1;
+#else
+  (void)nSteps;
+#endif
+}
 
-    MPI_Comm_dup(comm, &impl::comm);
-    }
+// ----------------------------------------------------------------------------
+void Profiler::SetSamplingThreshold(long long nEvents)
+{
+#if defined(ENABLE_PROFILER)
+  impl::samplingThreshold = nEvents;
 #else
-  (void)comm;
+  (void)nEvents;
 #endif
 }
 
 // ----------------------------------------------------------------------------
-void Profiler::SetTimerLogFile(const std::string &file)
+void Profiler::SetSamplingRatio(int ratio)
 {
 #if defined(ENABLE_PROFILER)
-  impl::timerLogFile = file;
+  impl::samplingRatio = ratio > 0 ? ratio : 1;
 #else
-  (void)file;
+  (void)ratio;
 #endif
 }
 
@@ -156,7 +1720,7 @@ void Profiler::SetMemProfLogFile(const std::string &file)
 }
 
 // ----------------------------------------------------------------------------
-void Profiler::SetMemProfInterval(int interval)
+void Profiler::SetMemProfInterval(double interval)
 {
 #if defined(ENABLE_PROFILER)
   impl::memProf.SetInterval(interval);
@@ -173,19 +1737,19 @@ int Profiler::Validate()
   if (impl::loggingEnabled & 0x01)
     {
 #if !defined(NDEBUG)
-    impl::threadMapType::iterator tmit = impl::activeEvents.begin();
-    impl::threadMapType::iterator tmend = impl::activeEvents.end();
-    for (; tmit != tmend; ++tmit)
+    std::lock_guard<std::mutex> lock(impl::eventLogMutex);
+    size_t nLogs = impl::threadLogs.size();
+    for (size_t i = 0; i < nLogs; ++i)
       {
-      unsigned int nLeft = tmit->second.size();
+      const std::vector<impl::ActiveEvent> &active = impl::threadLogs[i]->Active;
+      unsigned int nLeft = active.size();
       if (nLeft > 0)
         {
         std::ostringstream oss;
-        impl::eventLogType::iterator it = tmit->second.begin();
-        impl::eventLogType::iterator end = tmit->second.end();
-        for (; it != end; ++it)
-          it->ToStream(oss);
-        SENSEI_ERROR("Thread " << tmit->first << " has " << nLeft
+        for (unsigned int j = 0; j < nLeft; ++j)
+          oss << "\"" << active[j].EventName->Str << "\" started at "
+            << active[j].StartTime << std::endl;
+        SENSEI_ERROR("Thread log " << i << " has " << nLeft
           << " unmatched active events. " << std::endl
           << oss.str())
         ierr += 1;
@@ -207,13 +1771,20 @@ int Profiler::ToStream(std::ostream &os)
     os.precision(std::numeric_limits<double>::digits10 + 2);
     os.setf(std::ios::scientific, std::ios::floatfield);
 
-    // not locking this as it's intended to be accessed only from the main
-    // thread, and all other threads are required to be finished by now
-    impl::eventLogType::iterator iter = impl::eventLog.begin();
-    impl::eventLogType::iterator end = impl::eventLog.end();
+    int rank = impl::getRank();
+
+    std::lock_guard<std::mutex> lock(impl::eventLogMutex);
+    size_t nLogs = impl::threadLogs.size();
+    for (size_t i = 0; i < nLogs; ++i)
+      {
+      std::lock_guard<std::mutex> elock(impl::threadLogs[i]->EventsMutex);
+      std::deque<impl::Event>::iterator iter = impl::threadLogs[i]->Events.begin();
+      std::deque<impl::Event>::iterator end = impl::threadLogs[i]->Events.end();
 
-    for (; iter != end; ++iter)
-      iter->ToStream(os);
+      for (; iter != end; ++iter)
+        impl::toStream(os, rank, impl::loggingEnabled & 0x08,
+          impl::loggingEnabled & 0x10, impl::samplingThreshold > 0, *iter);
+      }
     }
 #else
   (void)os;
@@ -250,12 +1821,58 @@ int Profiler::Initialize()
   if ((tmp = getenv("PROFILER_LOG_FILE")))
     impl::timerLogFile = tmp;
 
+  if ((tmp = getenv("PROFILER_LOG_FORMAT")))
+    impl::timerLogFormat = strcmp(tmp, "binary") == 0 ?
+      Profiler::FORMAT_BINARY : (strcmp(tmp, "chrome") == 0 ?
+      Profiler::FORMAT_CHROME : Profiler::FORMAT_CSV);
+
+  if ((tmp = getenv("PROFILER_FLUSH_THRESHOLD")))
+    impl::flushThreshold = atoll(tmp);
+
+  if ((tmp = getenv("PROFILER_LOG_MAX_SIZE")))
+    impl::maxLogSize = atoll(tmp);
+
+  if ((tmp = getenv("PROFILER_SUMMARY_INTERVAL")))
+    impl::summaryInterval = atoi(tmp);
+
+  if ((tmp = getenv("PROFILER_SUMMARY_FILE")))
+    impl::summaryFile = tmp;
+
+  if ((tmp = getenv("PROFILER_SAMPLE_STRIDE")))
+    impl::sampleStride = atoi(tmp);
+
+  if ((tmp = getenv("PROFILER_TELEMETRY")))
+    Profiler::SetTelemetrySink(tmp);
+
+  if ((tmp = getenv("PROFILER_TELEMETRY_INTERVAL")))
+    Profiler::SetTelemetryInterval(atoi(tmp));
+
+  if ((tmp = getenv("PROFILER_SAMPLING_THRESHOLD")))
+    Profiler::SetSamplingThreshold(atoll(tmp));
+
+  if ((tmp = getenv("PROFILER_SAMPLING_RATIO")))
+    Profiler::SetSamplingRatio(atoi(tmp));
+
   if ((tmp = getenv("MEMPROF_LOG_FILE")))
     impl::memProf.SetFilename(tmp);
 
   if ((tmp = getenv("MEMPROF_INTERVAL")))
     impl::memProf.SetInterval(atof(tmp));
 
+  if ((tmp = getenv("MEMPROF_LOG_FORMAT")))
+    impl::memProf.SetFormat(strcmp(tmp, "binary") == 0 ?
+      MemoryProfiler::FORMAT_BINARY : MemoryProfiler::FORMAT_CSV);
+
+  if ((tmp = getenv("MEMPROF_TRACK_PEAK")))
+    impl::memProf.SetTrackPeak(atoi(tmp));
+
+  // energy is logged with the events and the memory samples
+  if ((impl::loggingEnabled & 0x10) && !EnergyMeter::Available() && (rank == 0))
+    SENSEI_WARNING("Energy measurement was enabled but no sensors were found."
+      " The energy will be logged as -1")
+
+  impl::memProf.SetTrackEnergy(impl::loggingEnabled & 0x10);
+
   if (impl::loggingEnabled & 0x02)
     impl::memProf.Initialize();
 
@@ -264,8 +1881,19 @@ int Profiler::Initialize()
     std::cerr << "Profiler configured with Event logging "
       << (impl::loggingEnabled & 0x01 ? "enabled" : "disabled")
       << " and memory logging " << (impl::loggingEnabled & 0x02 ? "enabled" : "disabled")
-      << ", timer log file \"" << impl::timerLogFile
-      << "\", memory profiler log file \"" << impl::memProf.GetFilename()
+      << ", hardware counters " << (impl::loggingEnabled & 0x08 ? "enabled" : "disabled")
+      << ", energy " << (impl::loggingEnabled & 0x10 ? "enabled" : "disabled")
+      << ", timer log file \"" << impl::timerLogFile << "\" ("
+      << (impl::timerLogFormat == Profiler::FORMAT_BINARY ? "binary" :
+        (impl::timerLogFormat == Profiler::FORMAT_CHROME ? "chrome" : "csv"))
+      << "), flush threshold " << impl::flushThreshold
+      << " bytes, maximum log size " << impl::maxLogSize
+      << " bytes, summary interval " << impl::summaryInterval
+      << " steps to \"" << impl::summaryFile << "\", sample stride "
+      << impl::sampleStride << ", telemetry sink \"" << impl::telemetrySink
+      << "\" every " << impl::telemetryInterval << " steps, sampling threshold "
+      << impl::samplingThreshold << " events then 1 in " << impl::samplingRatio
+      << ", memory profiler log file \"" << impl::memProf.GetFilename()
       << "\", sampling interval " << impl::memProf.GetInterval()
       << " seconds" << std::endl;
 #endif
@@ -278,63 +1906,80 @@ int Profiler::WriteMpiIo(MPI_Comm comm, const char *fileName,
 {
 #if defined(ENABLE_PROFILER) && defined(SENSEI_HAS_MPI)
   if (impl::loggingEnabled & 0x01)
-    {
-    // compute the file offset
-    long nBytes = str.size();
-
-    int rank = 0;
-    int nRanks = 1;
-
-    MPI_Comm_rank(comm, &rank);
-    MPI_Comm_size(comm, &nRanks);
+    impl::writeMpiIo(comm, fileName, str, 0);
+  return 0;
+#else
+  (void)comm;
+  (void)fileName;
+  (void)str;
+#endif
+  return -1;
+}
 
-    std::vector<long> gsizes(nRanks);
-    gsizes[rank] = nBytes;
+// ----------------------------------------------------------------------------
+int Profiler::Checkpoint()
+{
+#if defined(ENABLE_PROFILER)
+  if (!(impl::loggingEnabled & 0x01))
+    return 0;
 
-    MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
-      gsizes.data(), 1, MPI_LONG, impl::comm);
+  impl::stepCount += 1;
 
-    long offset = 0;
-    for (int i = 0; i < rank; ++i)
-      offset += gsizes[i];
+  // the events sampled are counted per step
+  impl::samplingStep = impl::stepCount;
 
-    long fileSize = 0;
-    for (int i = 0; i < nRanks; ++i)
-      fileSize += gsizes[i];
+  // reduce the events of the last interval steps to their summary
+  if ((impl::summaryInterval > 0) &&
+    ((impl::stepCount - impl::summaryStart) >= impl::summaryInterval))
+    {
+    Profiler::StartEvent("Profiler::Summarize");
+    impl::summarizeEvents();
+    Profiler::EndEvent("Profiler::Summarize");
+    }
 
-    // write the buffer
-    MPI_File fh;
-    MPI_File_open(comm, fileName,
-      MPI_MODE_CREATE|MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+  // send the metrics of the last interval steps
+  if (impl::telemetryEnabled &&
+    ((impl::stepCount - impl::telemetryStart) >= impl::telemetryInterval))
+    {
+    Profiler::StartEvent("Profiler::Telemetry");
+    impl::publishTelemetry();
+    Profiler::EndEvent("Profiler::Telemetry");
+    }
 
-    MPI_File_set_view(fh, offset, MPI_BYTE, MPI_BYTE,
-      "native", MPI_INFO_NULL);
+  if ((impl::flushThreshold <= 0) || !impl::writesEventLog())
+    return 0;
 
-    MPI_File_write(fh, str.c_str(), nBytes,
-      MPI_BYTE, MPI_STATUS_IGNORE);
+  // all ranks must agree to write
+  long long nBytes = impl::getBufferedBytes();
+#if defined(SENSEI_HAS_MPI)
+  int ok = 0;
+  MPI_Initialized(&ok);
+  if (ok && (impl::comm != MPI_COMM_NULL))
+    MPI_Allreduce(MPI_IN_PLACE, &nBytes, 1, MPI_LONG_LONG,
+      MPI_MAX, impl::comm);
+#endif
 
-    MPI_File_set_size(fh, fileSize);
+  if (nBytes < impl::flushThreshold)
+    return 0;
 
-    MPI_File_close(&fh);
-    }
-  return 0;
-#else
-  (void)comm;
-  (void)fileName;
-  (void)str;
+  // the cost of the write is recorded, and written with the next flush
+  Profiler::StartEvent("Profiler::Checkpoint");
+  long long nWritten = impl::writeEvents();
+  Profiler::EndEvent("Profiler::Checkpoint", nWritten);
 #endif
-  return -1;
+  return 0;
 }
 
 // ----------------------------------------------------------------------------
 int Profiler::Flush()
 {
 #if defined(ENABLE_PROFILER)
-  std::ostringstream oss;
-  Profiler::ToStream(oss);
-  Profiler::WriteCStdio(impl::timerLogFile.c_str(), "a", oss.str());
-  Profiler::Validate();
-  impl::eventLog.clear();
+  if (impl::loggingEnabled & 0x01)
+    {
+    if (impl::writesEventLog())
+      impl::writeEvents();
+    Profiler::Validate();
+    }
 #endif
   return 0;
 }
@@ -383,30 +2028,23 @@ int Profiler::Finalize()
   MPI_Initialized(&ok);
 #endif
 
+  // summarize and write the remaining events
   if (impl::loggingEnabled & 0x01)
     {
-    int rank = 0;
-#if defined(SENSEI_HAS_MPI)
-    if (ok)
-      MPI_Comm_rank(impl::comm, &rank);
-#endif
-
-    // serialize the logged events in CSV format
-    std::ostringstream oss;
-
-    if (rank == 0)
-      oss << "# rank, thread, Name, start Time, end Time, delta, Depth" << std::endl;
+    if (impl::summaryInterval > 0)
+      impl::summarizeEvents();
 
-    Profiler::ToStream(oss);
-
-    // free up resources
-    impl::eventLog.clear();
+    if (impl::writesEventLog())
+      impl::writeEvents();
+    }
 
-    if (ok)
-      Profiler::WriteMpiIo(impl::comm, impl::timerLogFile.c_str(), oss.str());
-    else
-      Profiler::WriteCStdio(impl::timerLogFile.c_str(), "w", oss.str());
+#if !defined(_WIN32)
+  if (impl::telemetrySocket >= 0)
+    {
+    close(impl::telemetrySocket);
+    impl::telemetrySocket = -1;
     }
+#endif
 
   // output the memory use profile and clean up resources
   if (impl::loggingEnabled & 0x02)
@@ -425,18 +2063,62 @@ int Profiler::Finalize()
 bool Profiler::Enabled()
 {
 #if defined(ENABLE_PROFILER)
-  std::lock_guard<std::mutex> lock(impl::eventLogMutex);
   return impl::loggingEnabled & 0x01;
 #else
   return false;
 #endif
 }
 
+//-----------------------------------------------------------------------------
+bool Profiler::CollectiveProbeEnabled()
+{
+#if defined(ENABLE_PROFILER)
+  return (impl::loggingEnabled & 0x05) == 0x05;
+#else
+  return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+int Profiler::ProbeCollective(MPI_Comm comm, const char *eventname)
+{
+#if defined(ENABLE_PROFILER) && defined(SENSEI_HAS_MPI)
+  if ((impl::loggingEnabled & 0x05) == 0x05)
+    {
+    int ok = 0;
+    MPI_Initialized(&ok);
+    if (!ok || (comm == MPI_COMM_NULL))
+      return 0;
+
+    // the name is interned on first use, the buffer may be reused
+    char waitName[256];
+    snprintf(waitName, sizeof(waitName), "%s::wait", eventname);
+
+    Profiler::StartEvent(waitName);
+
+    // a non-blocking barrier completes once every rank has arrived. it is
+    // tested rather than waited on so that the rank keeps making progress
+    // on other communication while it waits
+    MPI_Request req = MPI_REQUEST_NULL;
+    MPI_Ibarrier(comm, &req);
+
+    int done = 0;
+    while (!done)
+      MPI_Test(&req, &done, MPI_STATUS_IGNORE);
+
+    Profiler::EndEvent(waitName);
+    }
+#else
+  (void)comm;
+  (void)eventname;
+#endif
+  return 0;
+}
+
 //-----------------------------------------------------------------------------
 void Profiler::Enable(int arg)
 {
 #if defined(ENABLE_PROFILER)
-  std::lock_guard<std::mutex> lock(impl::eventLogMutex);
   impl::loggingEnabled = arg;
 #else
   (void)arg;
@@ -447,7 +2129,6 @@ void Profiler::Enable(int arg)
 void Profiler::Disable()
 {
 #if defined(ENABLE_PROFILER)
-  std::lock_guard<std::mutex> lock(impl::eventLogMutex);
   impl::loggingEnabled = 0x00;
 #endif
 }
@@ -458,13 +2139,38 @@ int Profiler::StartEvent(const char* eventname, long long nbytes)
 #if defined(ENABLE_PROFILER)
   if (impl::loggingEnabled & 0x01)
     {
-    impl::Event evt;
-    evt.Name = eventname;
-    evt.Time[impl::Event::START] = impl::getSystemTime();
-    evt.NumBytes = nbytes;
+    // the byte count is recorded when the event ends
+    (void)nbytes;
 
-    std::lock_guard<std::mutex> lock(impl::eventLogMutex);
-    impl::activeEvents[evt.Tid].push_back(evt);
+    impl::ThreadLog *log = impl::getThreadLog();
+
+    impl::ActiveEvent evt;
+    evt.EventName = log->GetName(eventname);
+    evt.ChildBytes = 0;
+    evt.Sampled = log->Sample(evt.EventName);
+
+    // a skipped event is not timed
+    if (!evt.Sampled)
+      {
+      evt.StartTime = -1.0;
+      log->Active.push_back(evt);
+      return 0;
+      }
+
+    evt.StartTime = impl::getSystemTime();
+
+    if (impl::loggingEnabled & 0x10)
+      sensei::EnergyMeter::Read(evt.Energy);
+    else
+      std::fill(evt.Energy, evt.Energy + impl::NUM_ENERGY, -1ll);
+
+    // the counters are read last so that the cost of recording is left out
+    if (impl::loggingEnabled & 0x08)
+      log->Counters.Read(evt.Counters);
+    else
+      evt.Counters[0] = -1ll;
+
+    log->Active.push_back(evt);
     }
 #else
   (void)eventname;
@@ -483,36 +2189,98 @@ int Profiler::EndEvent(const char* eventname, long long nbytes)
     double endTime = impl::getSystemTime();
 
     // get this thread's Event log
-    std::thread::id tid = std::this_thread::get_id();
+    impl::ThreadLog *log = impl::getThreadLog();
 
-    std::lock_guard<std::mutex> lock(impl::eventLogMutex);
-    impl::threadMapType::iterator iter = impl::activeEvents.find(tid);
-    if (iter == impl::activeEvents.end())
+    if (log->Active.empty())
       {
       SENSEI_ERROR("failed to end Event \"" << eventname
-        << "\" thread  " << tid << " has no events")
+        << "\" thread  " << std::this_thread::get_id() << " has no events")
       return -1;
       }
 
-    impl::Event evt(std::move(iter->second.back()));
-    iter->second.pop_back();
+    bool sampled = log->Active.back().Sampled;
+
+    long long counters[impl::NUM_COUNTERS] = {-1ll, -1ll, -1ll};
+    if (sampled && (impl::loggingEnabled & 0x08))
+      log->Counters.Read(counters);
+
+    long long energy[impl::NUM_ENERGY] = {-1ll, -1ll, -1ll};
+    if (sampled && (impl::loggingEnabled & 0x10))
+      sensei::EnergyMeter::Read(energy);
+
+    impl::ActiveEvent active = log->Active.back();
+    log->Active.pop_back();
 
 #ifdef NDEBUG
     (void)eventname;
 #else
-    if (strcmp(eventname, evt.Name.c_str()) != 0)
+    if (strcmp(eventname, active.EventName->Str.c_str()) != 0)
       {
       SENSEI_ERROR("Mismatched startEvent/endEvent. Expecting: '"
-        << evt.Name << "' Got: '" << eventname << "'")
+        << active.EventName->Str << "' Got: '" << eventname << "'")
       abort();
       }
 #endif
+
+    // count the bytes of the outermost events only, nested events that
+    // report bytes account for part of the enclosing event's bytes
+    long long bytes = nbytes >= 0 ? nbytes : active.ChildBytes;
+    if (log->Active.empty())
+      log->Bytes += bytes;
+    else
+      log->Active.back().ChildBytes += bytes;
+
+    // a skipped event is counted in the weight of a recorded one
+    if (!sampled)
+      {
+      log->GetSampleState(active.EventName->Id).Skipped.fetch_add(1,
+        std::memory_order_relaxed);
+      return 0;
+      }
+
+    impl::Event evt;
+    evt.NameId = active.EventName->Id;
+    evt.Time[impl::Event::START] = active.StartTime;
     evt.Time[impl::Event::END] = endTime;
-    evt.Time[impl::Event::DELTA] = endTime - evt.Time[impl::Event::START];
     evt.NumBytes = nbytes;
-    evt.Depth = iter->second.size();
+    evt.Depth = log->Active.size();
+    evt.Tid = std::this_thread::get_id();
+
+    if ((active.Counters[0] >= 0) && (counters[0] >= 0))
+      {
+      for (int i = 0; i < impl::NUM_COUNTERS; ++i)
+        evt.Counters[i] = counters[i] - active.Counters[i];
+      }
+
+    // domains without a sensor read -1
+    for (int i = 0; i < impl::NUM_ENERGY; ++i)
+      {
+      if ((active.Energy[i] >= 0) && (energy[i] >= 0))
+        evt.Energy[i] = energy[i] - active.Energy[i];
+      }
+
+    {
+    std::lock_guard<std::mutex> elock(log->EventsMutex);
+
+    // the event stands for those of its name skipped since the last one
+    if (evt.NameId < log->Sampling.size())
+      {
+      impl::SampleState &state = log->Sampling[evt.NameId];
+      evt.Weight += state.Skipped.exchange(0);
+      state.Last = log->Events.size();
+      }
+
+    log->Events.push_back(evt);
 
-    impl::eventLog.emplace_back(std::move(evt));
+    if (impl::telemetryEnabled)
+      log->AddMetric(evt, false);
+    }
+
+    if (active.EventName->Tracked)
+      {
+      std::lock_guard<std::mutex> lock(impl::trackedMutex);
+      const_cast<impl::Name*>(active.EventName)->Total += endTime - active.StartTime;
+      }
     }
 #else
   (void)eventname;
@@ -521,4 +2289,114 @@ int Profiler::EndEvent(const char* eventname, long long nbytes)
   return 0;
 }
 
+//-----------------------------------------------------------------------------
+void Profiler::TrackEvent(const char *eventname)
+{
+#if defined(ENABLE_PROFILER)
+  std::lock_guard<std::mutex> lock(impl::eventLogMutex);
+  impl::internName(eventname)->Tracked = true;
+#else
+  (void)eventname;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+double Profiler::GetTrackedTime(const char *eventname)
+{
+#if defined(ENABLE_PROFILER)
+  impl::Name *entry = nullptr;
+  {
+  std::lock_guard<std::mutex> lock(impl::eventLogMutex);
+  std::unordered_map<std::string, impl::Name*>::iterator it =
+    impl::nameIndex.find(eventname);
+
+  if ((it == impl::nameIndex.end()) || !it->second->Tracked)
+    return 0.0;
+
+  entry = it->second;
+  }
+
+  std::lock_guard<std::mutex> lock(impl::trackedMutex);
+  return entry->Total;
+#else
+  (void)eventname;
+  return 0.0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+int Profiler::GetCounter(const char *name, long long &value)
+{
+#if defined(ENABLE_PROFILER)
+  impl::Name *entry = nullptr;
+  {
+  std::lock_guard<std::mutex> lock(impl::eventLogMutex);
+  std::unordered_map<std::string, impl::Name*>::iterator it =
+    impl::nameIndex.find(name);
+
+  if (it == impl::nameIndex.end())
+    return -1;
+
+  entry = it->second;
+  }
+
+  if (!entry->HasValue.load(std::memory_order_acquire))
+    return -1;
+
+  value = entry->Value.load(std::memory_order_relaxed);
+  return 0;
+#else
+  (void)name;
+  (void)value;
+  return -1;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+long long Profiler::GetThreadBytes()
+{
+#if defined(ENABLE_PROFILER)
+  impl::ThreadLog *log = impl::threadLog.Log;
+  if (log)
+    return log->Bytes;
+#endif
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int Profiler::LogCounter(const char* name, long long value)
+{
+#if defined(ENABLE_PROFILER)
+  if (impl::loggingEnabled & 0x01)
+    {
+    impl::ThreadLog *log = impl::getThreadLog();
+
+    const impl::Name *entry = log->GetName(name);
+
+    // the latest value is kept for GetCounter
+    impl::Name *counter = const_cast<impl::Name*>(entry);
+    counter->Value.store(value, std::memory_order_relaxed);
+    counter->HasValue.store(true, std::memory_order_release);
+
+    impl::Event evt;
+    evt.NameId = entry->Id;
+    evt.Time[impl::Event::START] = impl::getSystemTime();
+    evt.Time[impl::Event::END] = evt.Time[impl::Event::START];
+    evt.NumBytes = value;
+    evt.Depth = log->Active.size();
+    evt.Tid = std::this_thread::get_id();
+
+    std::lock_guard<std::mutex> elock(log->EventsMutex);
+    log->Events.push_back(evt);
+
+    if (impl::telemetryEnabled)
+      log->AddMetric(evt, true);
+    }
+#else
+  (void)name;
+  (void)value;
+#endif
+  return 0;
+}
+
 }
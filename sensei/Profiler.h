@@ -14,7 +14,9 @@ namespace sensei
 
 // A class containing methods managing memory and time profiling
 // Each timed event logs rank, event name, start and end time, and
-// duration.
+// duration. Events are recorded to a log kept by each thread, and their
+// names are interned, so that recording takes no locks and makes no
+// copies of the name.
 class Profiler
 {
 public:
@@ -28,24 +30,89 @@ public:
   //   PROFILER_ENABLE     : bit mask turns on or off logging,
   //               0x01 -- event profiling enabled
   //               0x02 -- memory profiling enabled
+  //               0x04 -- collective wait probe enabled, see
+  //                       CollectiveEvent
+  //               0x08 -- hardware counters enabled, see below
+  //               0x10 -- energy measurement enabled, see below
   //   PROFILER_LOG_FILE   : path to write timer log to
+  //   PROFILER_LOG_FORMAT : "csv", "binary", or "chrome", see
+  //               SetTimerLogFormat
+  //   PROFILER_FLUSH_THRESHOLD : bytes of events held before a
+  //               Checkpoint writes them, see SetFlushThreshold
+  //   PROFILER_LOG_MAX_SIZE : bytes written to a log file before the
+  //               next is started, see SetMaxLogSize
+  //   PROFILER_SUMMARY_INTERVAL : steps between summaries of the events
+  //               over the ranks, see SetSummaryInterval
+  //   PROFILER_SUMMARY_FILE : path to write the summaries to
+  //   PROFILER_SAMPLE_STRIDE : ranks that keep their events in summary
+  //               mode, see SetSampleStride
+  //   PROFILER_TELEMETRY : host:port of a statsd server to send metrics
+  //               to while the run goes on, see SetTelemetrySink
+  //   PROFILER_TELEMETRY_INTERVAL : steps between updates of the metrics
+  //   PROFILER_SAMPLING_THRESHOLD : events of a name a thread records in a
+  //               step before they are sampled, see SetSamplingThreshold
+  //   PROFILER_SAMPLING_RATIO : one in this many events is recorded once
+  //               the threshold is reached, see SetSamplingRatio
   //   MEMPROF_LOG_FILE    : path to write memory profiler log to
   //   MEMPROF_INTERVAL    : number of seconds between memory recordings
+  //   MEMPROF_LOG_FORMAT  : "csv" or "binary", see MemoryProfiler::SetFormat
+  //   MEMPROF_TRACK_PEAK  : 1 to record the peak memory use between
+  //               recordings, see MemoryProfiler::SetTrackPeak
+  //
+  //
+  // When hardware counters are enabled each thread opens a group of Linux
+  // perf_event counters counting the cycles, instructions, and last level
+  // cache misses of its user space work. The group is read when an event
+  // starts and when it ends and the differences are logged with the event,
+  // so that an event's instructions per cycle and memory traffic, the cache
+  // misses times the cache line size over the duration, show whether it is
+  // compute or bandwidth bound. The counters include the work of nested
+  // events. When the kernel does not allow the counters, see
+  // /proc/sys/kernel/perf_event_paranoid, a warning is issued and they are
+  // logged as -1. The bit must be set before the first events are written.
+  //
+  // When energy measurement is enabled the node's energy meter, see
+  // EnergyMeter, is read when an event starts and when it ends and the
+  // energy used over the event, in micro joules, is logged per domain, CPU
+  // package, DRAM, and GPU, -1 for those without sensors. The summaries
+  // gain the mean over the ranks of the energy in joules, and the memory
+  // profiler's samples the node's energy since the start of the run, from
+  // which the power over time follows. The meter measures the node, so an
+  // event's energy includes that of the other ranks and threads on the
+  // node. Comparing the events of an analysis with those of the writers
+  // gives the energy cost of analyzing in situ against writing the data
+  // for post hoc analysis. Like the counters, the bit must be set before
+  // the first events are written.
   //
   static int Initialize();
 
-  // Finalize the log. this is where logs are written and cleanup occurs.
-  // All processes in the communicator must call, and it must be called
-  // prior to MPI_Finalize.
+  // Finalize the log. this is where the remaining events are written and
+  // cleanup occurs. All processes in the communicator must call, and it
+  // must be called prior to MPI_Finalize.
   static int Finalize();
 
+  // Write the events recorded so far when the memory they use on any rank
+  // has reached the flush threshold. The events are appended to the log
+  // file and released, so that long runs neither accumulate events nor
+  // lose them when the job is killed. The cost of each write is recorded
+  // in an event named Profiler::Checkpoint with the number of bytes the
+  // rank wrote. This is a collective call with respect to the timer's
+  // communicator and does nothing when the threshold is 0. It is called
+  // at the end of each ConfigurableAnalysis::Execute, and so each call
+  // is counted as a step by the summaries and the telemetry, see
+  // SetSummaryInterval and SetTelemetrySink.
+  static int Checkpoint();
+
   // this can occur after MPI_Finalize. It should only be called by rank 0.
   // Any remaining events will be appeneded to the log file. This is necessary
   // to time MPI_Initialize/Finalize and log associated I/O.
   static int Flush();
 
   // Sets the communicator for MPI calls. This must be called prior to
-  // initialization.
+  // initialization. The communicator is duplicated so that the profiler's
+  // collectives do not interfere with those of the caller. Events may be
+  // recorded from any thread, however Initialize, Checkpoint, and Finalize
+  // make collective calls and must be called from one thread at a time.
   // default value: MPI_COMM_NULL
   static void SetCommunicator(MPI_Comm comm);
 
@@ -54,14 +121,134 @@ public:
   // default value; Timer.csv
   static void SetTimerLogFile(const std::string &fileName);
 
+  // Sets the format of the timer log. In the CSV format, the default, a
+  // line of text is written for each event, with the cycles, instructions,
+  // and cache misses appended when hardware counters are enabled, and the
+  // CPU, DRAM, and GPU energy after them when energy is measured. The
+  // binary format is smaller and faster to write. It starts with the line "SENSEIPROF1\n"
+  // and is followed, for each write, by a record for each rank in rank
+  // order. A record is
+  // the rank (int), the number of names (int), each name as its length
+  // (int) followed by its characters, the number of events (long long),
+  // and the events. Each event is a hash of the thread id (unsigned long
+  // long), the name id (unsigned int), the depth (int), the number of bytes
+  // (long long), and the start and end times in seconds (double). When
+  // hardware counters are enabled the line is "SENSEIPROF2\n" and each
+  // event ends with the cycles, instructions, and cache misses (long long).
+  // When energy is measured the line is "SENSEIPROF3\n", or "SENSEIPROF4\n"
+  // with the hardware counters, and each event ends, after the counters,
+  // with the CPU, DRAM, and GPU energy in micro joules (long long).
+  // When events are sampled, see SetSamplingThreshold, the versions are
+  // "SENSEIPROF5\n" to "SENSEIPROF8\n", in the same order, and each event
+  // ends with its weight (long long), as does each line of the CSV format.
+  // Values are in the native byte order. The Chrome format is the JSON array
+  // form of the Chrome trace event format, which loads in Perfetto and
+  // chrome://tracing. Each rank is a process and each thread a lane within
+  // it. Events carry their byte count, depth, and hardware counters as
+  // arguments, and byte counts are also shown as counter tracks. The closing bracket is left
+  // off, as the format allows, so that events may be appended.
+  // overriden by PROFILER_LOG_FORMAT environment variable
+  enum {FORMAT_CSV=0, FORMAT_BINARY=1, FORMAT_CHROME=2};
+  static void SetTimerLogFormat(int format);
+
+  // Sets the number of bytes of events that may be held by a rank before
+  // Checkpoint writes them.
+  // overriden by PROFILER_FLUSH_THRESHOLD environment variable
+  // default value: 0, events are written by Finalize
+  static void SetFlushThreshold(long long nBytes);
+
+  // Sets the number of bytes written to a timer log file before the next
+  // file is started. The files that follow the first have a sequence
+  // number appended to the name, timer.csv.1, timer.csv.2, and so on, and
+  // each starts with a header.
+  // overriden by PROFILER_LOG_MAX_SIZE environment variable
+  // default value: 0, a single file is written
+  static void SetMaxLogSize(long long nBytes);
+
+  // Sets the number of steps between summaries. In summary mode the events
+  // are not written, instead every interval steps, counted by Checkpoint,
+  // the time each rank spent in events of each name is reduced over the
+  // ranks and rank 0 appends a line per name to the summary file. A line
+  // holds the first step and the number of steps summarized, the name,
+  // the number of ranks that recorded the name and of their events, the
+  // least and the most time spent by a rank with the ranks that spent
+  // them, and the mean and standard deviation over the ranks. Only the
+  // names not seen in earlier summaries are gathered, and the rest is
+  // reduced, so that a summary costs a few small collectives at any scale.
+  // The events that remain at Finalize form a last summary.
+  // overriden by PROFILER_SUMMARY_INTERVAL environment variable
+  // default value: 0, summaries are not made
+  static void SetSummaryInterval(int nSteps);
+
+  // Sets the path to write the summaries to
+  // overriden by PROFILER_SUMMARY_FILE environment variable
+  // default value: timer_summary.csv
+  static void SetSummaryFile(const std::string &fileName);
+
+  // Sets the ranks that keep their events in summary mode, every stride'th
+  // rank starting from 0. Their events are written to the timer log as
+  // they would be without the summaries, the other ranks write none.
+  // overriden by PROFILER_SAMPLE_STRIDE environment variable
+  // default value: 0, no timer log is written in summary mode
+  static void SetSampleStride(int stride);
+
+  // Sets the statsd server, as host:port, that the metrics are sent to while
+  // the run goes on. Every interval steps, counted by Checkpoint, the
+  // events of each name since the last update are reduced over the ranks,
+  // and rank 0 sends in UDP datagrams the gauges
+  //
+  //   sensei.<name>.time_max, .time_mean : the largest and the mean time
+  //               over the ranks that recorded the name
+  //   sensei.<name>.count, .bytes : the number of events and their bytes
+  //   sensei.<name> : the largest value of a counter, see LogCounter
+  //   sensei.memory.rss_max, .rss_total : resident set size in KiB
+  //   sensei.step : the number of steps
+  //
+  // where :: in a name becomes a dot. Counters include the queue depths of
+  // the asynchronous writers. Only event profiling need be enabled, and
+  // the events are logged as they would be otherwise. Datagrams are not
+  // acknowledged, so a missing server costs the run nothing.
+  // overriden by PROFILER_TELEMETRY environment variable
+  // default value: empty, no metrics are sent
+  static void SetTelemetrySink(const std::string &sink);
+
+  // Sets the number of steps between updates of the metrics.
+  // overriden by PROFILER_TELEMETRY_INTERVAL environment variable
+  // default value: 1
+  static void SetTelemetryInterval(int nSteps);
+
+  // Sets the number of events of each name that a thread records in each
+  // step, counted by Checkpoint, before the events of the name are
+  // sampled. Past the threshold one in ratio events is recorded, see
+  // SetSamplingRatio, and the others are skipped, neither timed nor held.
+  // A recorded event carries a weight, the number of events it stands for,
+  // itself and those of its name skipped since the last one recorded, so
+  // that the counts in the logs, the summaries, and the telemetry stay
+  // exact while the times, bytes, and energy of the skipped events are
+  // estimated by those of the event recorded. The bytes returned by
+  // GetThreadBytes are exact. Tracked events, see TrackEvent, and
+  // counters are not sampled. This bounds the cost of instrumenting fine
+  // grained work, such as the processing of each block or array. The
+  // weight is logged when this is set before the first events are written.
+  // overriden by PROFILER_SAMPLING_THRESHOLD environment variable
+  // default value: 0, events are not sampled
+  static void SetSamplingThreshold(long long nEvents);
+
+  // Sets the ratio of the events recorded once the sampling threshold is
+  // reached, one in ratio.
+  // overriden by PROFILER_SAMPLING_RATIO environment variable
+  // default value: 10
+  static void SetSamplingRatio(int ratio);
+
   // Sets the path to write the timer log to
   // overriden by MEMPROF_LOG_FILE environment variable
   // default value: MemProfLog.csv
   static void SetMemProfLogFile(const std::string &fileName);
 
-  // Sets the number of seconds in between memory use recordings
+  // Sets the number of seconds in between memory use recordings, this may
+  // be a fraction of a second.
   // overriden by MEMPROF_INTERVAL environment variable.
-  static void SetMemProfInterval(int interval);
+  static void SetMemProfInterval(double interval);
 
   // Enable/Disable logging. Overriden by PROFILER_ENABLE environment
   // variable. In the default format a CSV file is generated capturing each
@@ -72,6 +259,18 @@ public:
   // return true if loggin is enabled.
   static bool Enabled();
 
+  // return true if event logging and the collective wait probe are both
+  // enabled, see CollectiveEvent.
+  static bool CollectiveProbeEnabled();
+
+  // @brief Log the time a rank waits for the others to reach a collective.
+  //
+  // A non-blocking barrier is posted on comm and tested until all ranks
+  // have arrived. The time spent is logged in an event named
+  // <eventname>::wait. This does nothing unless the collective wait probe
+  // is enabled and must then be called by all ranks in comm.
+  static int ProbeCollective(MPI_Comm comm, const char *eventname);
+
   // @brief Log start of an event.
   //
   // This marks the beginning of a event that must be logged.  The @arg
@@ -85,6 +284,42 @@ public:
   // must match when calling endEvent() to mark the end of the event.
   static int EndEvent(const char *eventname, long long nbytes=-1ll);
 
+  // @brief Log the value of a counter.
+  //
+  // The value is recorded as a zero duration event with the value in the
+  // bytes field, so that counters, for instance the number of steps
+  // skipped by a transport, land in the log next to the timings.
+  static int LogCounter(const char *name, long long value);
+
+  // @brief Get the last value of a counter.
+  //
+  // The value most recently passed to LogCounter with the name, on any
+  // thread, so that run time components may act on the counters of
+  // others, for instance the queue depth of an asynchronous writer.
+  // Counters are only recorded while event profiling is enabled.
+  //
+  // @returns zero if the counter was logged, non zero otherwise
+  static int GetCounter(const char *name, long long &value);
+
+  // @brief Accumulate the duration of the named event.
+  //
+  // Once an event is tracked GetTrackedTime returns the total time spent in
+  // events of that name, on all threads, since tracking began. This lets
+  // run time components, such as partitioners, act on measured costs.
+  // Durations are only recorded while event profiling is enabled.
+  static void TrackEvent(const char *eventname);
+  static double GetTrackedTime(const char *eventname);
+
+  // @brief Get the bytes reported by the calling thread's events.
+  //
+  // The nbytes passed to EndEvent are summed over the outermost events
+  // that report them, bytes of nested events are taken to be included in
+  // the enclosing event's. The total is kept since the thread first
+  // recorded an event and only while event profiling is enabled. Callers
+  // take the difference of two calls to attribute the bytes moved by the
+  // work done in between.
+  static long long GetThreadBytes();
+
   // write contents of the string to the file.
   static int WriteCStdio(const char *fileName, const char *mode,
      const std::string &str);
@@ -156,6 +391,29 @@ private:
   const char *Eventname;
 };
 
+// CollectiveEvent -- A helper class that times a collective for its life.
+// When the collective wait probe is enabled the ranks first synchronize
+// in ProbeCollective, so that the <name>::wait event holds the time a rank
+// waited for the slowest to arrive and the <name> event holds the time
+// spent transferring data. Without the probe only <name> is logged and it
+// includes both. The pointer to the event name must be valid throughout
+// the object's life.
+class CollectiveEvent
+{
+public:
+  CollectiveEvent(MPI_Comm comm, const char *name) : Eventname(name)
+  {
+    Profiler::ProbeCollective(comm, name);
+    Profiler::StartEvent(name);
+  }
+
+  ~CollectiveEvent()
+  { Profiler::EndEvent(this->Eventname); }
+
+private:
+  const char *Eventname;
+};
+
 }
 
 #endif
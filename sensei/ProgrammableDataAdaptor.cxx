@@ -15,7 +15,7 @@ senseiNewMacro(ProgrammableDataAdaptor);
 ProgrammableDataAdaptor::ProgrammableDataAdaptor() :
  GetNumberOfMeshesCallback(nullptr), GetMeshMetadataCallback(nullptr),
  GetMeshCallback(nullptr), AddArrayCallback(nullptr),
- ReleaseDataCallback(nullptr)
+ AddArraysCallback(nullptr), ReleaseDataCallback(nullptr)
 {
 }
 
@@ -51,6 +51,13 @@ void ProgrammableDataAdaptor::SetAddArrayCallback(
   this->AddArrayCallback = callback;
 }
 
+//----------------------------------------------------------------------------
+void ProgrammableDataAdaptor::SetAddArraysCallback(
+ const AddArraysFunction &callback)
+{
+  this->AddArraysCallback = callback;
+}
+
 //----------------------------------------------------------------------------
 void ProgrammableDataAdaptor::SetReleaseDataCallback(
   const ReleaseDataFunction &callback)
@@ -105,13 +112,30 @@ int ProgrammableDataAdaptor::GetMesh(const std::string &meshName,
 int ProgrammableDataAdaptor::AddArray(vtkDataObject* mesh,
   const std::string &meshName, int association, const std::string &arrayName)
 {
-  if (!this->AddArrayCallback)
-    {
-    SENSEI_ERROR("No AddArrayCallback has been provided")
-    return -1;
-    }
+  if (this->AddArrayCallback)
+    return this->AddArrayCallback(mesh, meshName, association, arrayName);
+
+  if (this->AddArraysCallback)
+    return this->AddArraysCallback(mesh, meshName, association,
+      std::vector<std::string>(1, arrayName));
+
+  SENSEI_ERROR("No AddArrayCallback has been provided")
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+int ProgrammableDataAdaptor::AddArrays(vtkDataObject* mesh,
+  const std::string &meshName, int association,
+  const std::vector<std::string> &arrayNames)
+{
+  if (arrayNames.empty())
+    return 0;
+
+  // one call for all of the arrays
+  if (this->AddArraysCallback)
+    return this->AddArraysCallback(mesh, meshName, association, arrayNames);
 
-  return this->AddArrayCallback(mesh, meshName, association, arrayName);
+  return this->DataAdaptor::AddArrays(mesh, meshName, association, arrayNames);
 }
 
 //----------------------------------------------------------------------------
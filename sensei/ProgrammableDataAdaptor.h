@@ -5,6 +5,7 @@
 #include "DataAdaptor.h"
 
 #include <string>
+#include <vector>
 #include <functional>
 
 namespace sensei
@@ -26,6 +27,9 @@ namespace sensei
 ///     bool AddArray(vtkDataObject* mesh, int association,
 ///       const std::string& arrayname);
 ///
+///     bool AddArrays(vtkDataObject* mesh, int association,
+///       const std::vector<std::string>& arraynames);
+///
 ///     unsigned int GetNumberOfArrays(int association);
 ///
 ///     std::string GetArrayName(int association, unsigned int index);
@@ -119,6 +123,30 @@ public:
   int AddArray(vtkDataObject* mesh, const std::string &meshName,
     int association, const std::string &arrayName) override;
 
+  /// Set the callable that will be invoked when AddArrays is called
+  /// See AddArrays for details of what the callback must do.
+  using AddArraysFunction = std::function<int(vtkDataObject*,
+    const std::string &, int, const std::vector<std::string> &)>;
+
+  void SetAddArraysCallback(const AddArraysFunction &callback);
+
+  /// @brief Adds the specified field arrays to the mesh.
+  ///
+  /// When an AddArrays callback is provided it is invoked once with all of
+  /// the names. This saves the per call overhead of callbacks that cross
+  /// a language boundary, such as those written in Python. Otherwise the
+  /// AddArray callback is invoked once per array. When only an AddArrays
+  /// callback is provided AddArray invokes it with a single name.
+  ///
+  /// @param[in] mesh the VTK object returned from GetMesh
+  /// @param[in] meshName the name of the mesh on which the arrays are stored
+  /// @param[in] association field association; one of
+  ///            vtkDataObject::FieldAssociations or vtkDataObject::AttributeTypes.
+  /// @param[in] arrayNames the names of the arrays
+  /// @returns zero if successful, non zero if an error occurred
+  int AddArrays(vtkDataObject* mesh, const std::string &meshName,
+    int association, const std::vector<std::string> &arrayNames) override;
+
   ///Set the callable that will be invoked when ReleaseData is called.
   /// See ReleaseData for details about wwhat the callback should do.
   using ReleaseDataFunction = std::function<int()>;
@@ -142,6 +170,7 @@ protected:
   GetMeshMetadataFunction GetMeshMetadataCallback;
   GetMeshFunction GetMeshCallback;
   AddArrayFunction AddArrayCallback;
+  AddArraysFunction AddArraysCallback;
   ReleaseDataFunction ReleaseDataCallback;
 
 private:
@@ -1,15 +1,23 @@
 #include "PythonAnalysis.h"
 #include "Error.h"
+#include "XMLUtils.h"
 
 #include <vtkObjectFactory.h>
 #include <mpi4py/mpi4py.MPI_api.h>
 #include <string>
+#include <vector>
+#include <map>
+#include <limits>
+#include <sstream>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <errno.h>
+#include <unistd.h>
 #include <Python.h>
 
 #include "senseiPyString.h"
+#include "senseiPyGILState.h"
 
 // Macro to report error through sensei's normal mechanism
 // and include Python exception info and stack
@@ -94,82 +102,310 @@ int runString(PyObject *module, const std::string &code)
   return 0;
 }
 
-static
-int loadScript(MPI_Comm comm, const std::string &scriptFile, PyObject *&module)
+// The interpreter is shared by all PythonAnalysis instances. It is started
+// by the first instance to initialize and shut down when the last one
+// finalizes. Between calls into Python the GIL is released. Scripts are
+// compiled once, when they are first loaded, and the code is shared by the
+// instances that run the same file. Each instance runs its script in a
+// module of its own.
+struct InterpreterType
+{
+  InterpreterType() : RefCount(0), ModuleCount(0), ThreadState(nullptr) {}
+
+  // start the interpreter if needed. must be called without the GIL
+  int Initialize();
+
+  // shut the interpreter down when no instance is using it
+  int Finalize();
+
+  // get the code compiled from the script file. the file is read on rank
+  // 0 and broadcast when the script is first loaded. must be called with
+  // the GIL
+  int GetCode(MPI_Comm comm, const std::string &fileName, PyObject *&code);
+
+  // broadcast a zip file of Python modules and add it to sys.path. rank 0
+  // reads the file, one rank per node writes it to node local storage,
+  // and Python's zipimport serves imports from there. this replaces the
+  // file system traffic of every rank importing packages with a single
+  // broadcast. must be called with the GIL
+  int AddImportCache(MPI_Comm comm, const std::string &zipFile);
+
+  // generate a unique module name for an instance's script
+  std::string NewModuleName();
+
+  int RefCount;
+  int ModuleCount;
+  PyThreadState *ThreadState;
+  std::map<std::string, PyObject*> Code;
+  std::map<std::string, std::string> ImportCaches;
+  std::vector<std::string> ImportCacheFiles;
+};
+
+static InterpreterType Interpreter;
+
+// --------------------------------------------------------------------------
+int InterpreterType::Initialize()
+{
+  if (this->RefCount++)
+    return 0;
+
+  Py_SetProgramName(C_STRING_LITERAL("PythonAnalysis"));
+  Py_Initialize();
+  PyEval_InitThreads();
+
+  // release the GIL, it is re-aquired as needed
+  this->ThreadState = PyEval_SaveThread();
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int InterpreterType::Finalize()
+{
+  if ((this->RefCount < 1) || --this->RefCount)
+    return 0;
+
+  PyEval_RestoreThread(this->ThreadState);
+  this->ThreadState = nullptr;
+
+  std::map<std::string, PyObject*>::iterator it = this->Code.begin();
+  for (; it != this->Code.end(); ++it)
+    Py_DECREF(it->second);
+  this->Code.clear();
+
+  Py_Finalize();
+
+  size_t nFiles = this->ImportCacheFiles.size();
+  for (size_t i = 0; i < nFiles; ++i)
+    remove(this->ImportCacheFiles[i].c_str());
+
+  this->ImportCacheFiles.clear();
+  this->ImportCaches.clear();
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int InterpreterType::GetCode(MPI_Comm comm, const std::string &fileName,
+  PyObject *&code)
+{
+  code = nullptr;
+
+  std::map<std::string, PyObject*>::iterator it = this->Code.find(fileName);
+  if (it != this->Code.end())
+    {
+    code = it->second;
+    return 0;
+    }
+
+  std::vector<char> script;
+  if (XMLUtils::ReadFile(comm, fileName, script))
+    return -1;
+
+  code = Py_CompileString(script.data(), fileName.c_str(), Py_file_input);
+  if (!code || PyErr_Occurred())
+    {
+    SENSEI_PYTHON_ERROR("Failed to compile the script \"" << fileName << "\"")
+    return -1;
+    }
+
+  this->Code[fileName] = code;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int InterpreterType::AddImportCache(MPI_Comm comm, const std::string &zipFile)
 {
-  // read and broadcast the script
+  if (this->ImportCaches.count(zipFile))
+    return 0;
+
   int rank = 0;
   MPI_Comm_rank(comm, &rank);
 
-  char *script = nullptr;
-  long scriptLen = 0;
+  std::vector<char> buf;
+  if (XMLUtils::ReadFile(comm, zipFile, buf))
+    return -1;
 
-  if (rank == 0)
+  // name the local copy uniquely for this run
+  long id = getpid();
+  MPI_Bcast(&id, 1, MPI_LONG, 0, comm);
+
+  const char *tmp = getenv("TMPDIR");
+  std::string base = zipFile.substr(zipFile.find_last_of('/') + 1);
+
+  std::ostringstream oss;
+  oss << (tmp ? tmp : "/tmp") << "/sensei_" << id << "_"
+    << this->ImportCaches.size() << "_" << base;
+  std::string localFile = oss.str();
+
+  // one rank per node writes the local copy
+  MPI_Comm nodeComm = MPI_COMM_NULL;
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+
+  int nodeRank = 0;
+  MPI_Comm_rank(nodeComm, &nodeRank);
+
+  int ierr = 0;
+  if (nodeRank == 0)
     {
-    FILE *f = fopen(scriptFile.c_str(), "r");
-    if (!f)
+    FILE *f = fopen(localFile.c_str(), "wb");
+    size_t len = buf.size() - 1;
+    if (!f || (fwrite(buf.data(), 1, len, f) != len))
       {
       const char *estr = strerror(errno);
-      SENSEI_ERROR("Failed to open \"" << scriptFile << "\""
+      SENSEI_ERROR("Failed to write \"" << localFile << "\""
         << std::endl << estr)
-      scriptLen = -1;
-      MPI_Bcast(&scriptLen, 1, MPI_LONG, 0, comm);
-      return -1;
+      ierr = -1;
       }
 
-    fseek(f, 0, SEEK_END);
-    scriptLen = ftell(f);
-    fseek(f, 0, SEEK_SET);
+    if (f)
+      fclose(f);
 
-    script = static_cast<char*>(malloc(scriptLen+1));
-    script[scriptLen] = '\0';
+    this->ImportCacheFiles.push_back(localFile);
+    }
 
-    long nrd = fread(script, 1, scriptLen, f);
+  MPI_Allreduce(MPI_IN_PLACE, &ierr, 1, MPI_INT, MPI_MIN, comm);
+  MPI_Comm_free(&nodeComm);
 
-    fclose(f);
+  if (ierr)
+    return -1;
 
-    if (nrd != scriptLen)
-      {
-      const char *estr = strerror(errno);
-      SENSEI_ERROR("Failed to read \"" << scriptFile << "\""
-        << std::endl << estr)
-      scriptLen = -1;
-      MPI_Bcast(&scriptLen, 1, MPI_LONG, 0, comm);
-      free(script);
-      return -1;
-      }
+  // search the local copy before the file system
+  PyObject *path = PySys_GetObject(const_cast<char*>("path"));
+  PyObject *entry = C_STRING_TO_PY_STRING(localFile.c_str());
+  if (!path || !entry || PyList_Insert(path, 0, entry))
+    {
+    SENSEI_PYTHON_ERROR("Failed to add \"" << localFile << "\" to sys.path")
+    Py_XDECREF(entry);
+    return -1;
+    }
+  Py_DECREF(entry);
+
+  this->ImportCaches[zipFile] = localFile;
+
+  if (rank == 0)
+    SENSEI_STATUS("Python imports from \"" << zipFile
+      << "\" are served from node local copies")
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+std::string InterpreterType::NewModuleName()
+{
+  std::ostringstream oss;
+  oss << "sensei_python_analysis_" << this->ModuleCount++;
+  return oss.str();
+}
 
-    MPI_Bcast(&scriptLen, 1, MPI_LONG, 0, comm);
-    MPI_Bcast(script, scriptLen, MPI_CHAR, 0, comm);
+// run the script in a new module of its own
+static
+int loadScript(MPI_Comm comm, const std::string &scriptFile, PyObject *&module)
+{
+  module = nullptr;
+
+  PyObject *code = nullptr;
+  if (Interpreter.GetCode(comm, scriptFile, code))
+    return -1;
+
+  std::string moduleName = Interpreter.NewModuleName();
+
+  module = PyImport_AddModule(moduleName.c_str());
+  if (!module)
+    {
+    SENSEI_PYTHON_ERROR("Failed to create module \"" << moduleName << "\"")
+    return -1;
     }
-  else
+  Py_INCREF(module);
+
+  PyModule_AddStringConstant(module, "__file__", scriptFile.c_str());
+
+  PyObject *globals = PyModule_GetDict(module);
+  PyDict_SetItemString(globals, "__builtins__", PyEval_GetBuiltins());
+
+#if SENSEI_PYTHON_VERSION == 2
+  PyObject *pyRet = PyEval_EvalCode(reinterpret_cast<PyCodeObject*>(code),
+    globals, globals);
+#else
+  PyObject *pyRet = PyEval_EvalCode(code, globals, globals);
+#endif
+
+  if (!pyRet || PyErr_Occurred())
     {
-    MPI_Bcast(&scriptLen, 1, MPI_LONG, 0, comm);
+    SENSEI_PYTHON_ERROR("Failed to import the script \"" << scriptFile << "\"")
+    return -1;
+    }
 
-    if (scriptLen < 1)
-      return -1;
+  Py_DECREF(pyRet);
+
+  return 0;
+}
 
-    script = static_cast<char*>(malloc(scriptLen+1));
-    script[scriptLen] = '\0';
+// import the module. when the module has already been imported, by another
+// instance, a private copy is loaded so that the instances do not share
+// state
+static
+int importScript(const std::string &moduleName, PyObject *&module)
+{
+  module = nullptr;
+
+  PyObject *modules = PyImport_GetModuleDict();
+  if (!PyDict_GetItemString(modules, moduleName.c_str()))
+    {
+    module = PyImport_ImportModule(moduleName.c_str());
+    if (!module || PyErr_Occurred())
+      {
+      SENSEI_PYTHON_ERROR("Failed to import module \"" << moduleName  << "\"")
+      return -1;
+      }
+    return 0;
+    }
 
-    MPI_Bcast(script, scriptLen, MPI_CHAR, 0, comm);
+#if SENSEI_PYTHON_VERSION == 2
+  SENSEI_WARNING("Module \"" << moduleName << "\" is shared with another"
+    " PythonAnalysis instance")
+  module = PyImport_ImportModule(moduleName.c_str());
+  if (!module || PyErr_Occurred())
+    {
+    SENSEI_PYTHON_ERROR("Failed to import module \"" << moduleName  << "\"")
+    return -1;
     }
+  return 0;
+#else
+  std::string privName = Interpreter.NewModuleName();
 
-  // this does some internal initialization
-  module = PyImport_AddModule("__main__");
+  module = PyImport_AddModule(privName.c_str());
+  if (!module)
+    {
+    SENSEI_PYTHON_ERROR("Failed to create module \"" << privName << "\"")
+    return -1;
+    }
   Py_INCREF(module);
 
-  PyModule_AddStringConstant(module, "__file__", scriptFile.c_str());
+  std::ostringstream oss;
+  oss << "import importlib.util, sys" << std::endl
+    << "_spec = importlib.util.find_spec('" << moduleName << "')" << std::endl
+    << "_spec.loader.exec_module(sys.modules['" << privName << "'])" << std::endl;
+
+  PyObject *globals = PyDict_New();
+  PyDict_SetItemString(globals, "__builtins__", PyEval_GetBuiltins());
 
-  if (runString(module, script))
+  PyObject *pyRet = PyRun_String(oss.str().c_str(), Py_file_input,
+    globals, globals);
+
+  Py_DECREF(globals);
+
+  if (!pyRet || PyErr_Occurred())
     {
-    SENSEI_ERROR("Failed to import the script \"" << scriptFile << "\"")
-    free(script);
+    SENSEI_PYTHON_ERROR("Failed to import module \"" << moduleName  << "\"")
     return -1;
     }
 
-  free(script);
+  Py_DECREF(pyRet);
+
   return 0;
+#endif
 }
 
 namespace sensei
@@ -178,18 +414,25 @@ namespace sensei
 struct PythonAnalysis::InternalsType
 {
   InternalsType() : Module(nullptr), Initialize(nullptr),
-    Execute(nullptr), Finalize(nullptr) {}
+    Execute(nullptr), Finalize(nullptr), Initialized(false) {}
 
   ~InternalsType();
 
+  // load the script, locate its API and call its Initialize
+  int InitializeScript(MPI_Comm comm);
+
   std::string ScriptModule;
   std::string ScriptFile;
   std::string InitializeSource;
+  std::string ImportCache;
 
   PyObject *Module;
   PyObject *Initialize;
   PyObject *Execute;
   PyObject *Finalize;
+
+  // set when this instance holds a reference to the shared interpreter
+  bool Initialized;
 };
 
 //-----------------------------------------------------------------------------
@@ -233,9 +476,21 @@ void PythonAnalysis::SetScriptFile(const std::string &scriptName)
   this->Internals->ScriptFile = scriptName;
 }
 
+//-----------------------------------------------------------------------------
+void PythonAnalysis::SetImportCache(const std::string &zipFile)
+{
+  this->Internals->ImportCache = zipFile;
+}
+
 //-----------------------------------------------------------------------------
 int PythonAnalysis::Finalize()
 {
+  if (!this->Internals->Initialized)
+    return 0;
+
+  {
+  senseiPyGILState gil;
+
   if (this->Internals->Finalize)
     callFunction("Finalize", this->Internals->Finalize, nullptr);
 
@@ -248,8 +503,11 @@ int PythonAnalysis::Finalize()
   this->Internals->Execute = nullptr;
   this->Internals->Finalize = nullptr;
   this->Internals->Module = nullptr;
+  }
 
-  Py_Finalize();
+  // the interpreter is shut down by the last instance
+  this->Internals->Initialized = false;
+  Interpreter.Finalize();
 
   return 0;
 }
@@ -257,62 +515,66 @@ int PythonAnalysis::Finalize()
 //-----------------------------------------------------------------------------
 int PythonAnalysis::Initialize()
 {
-  // initialize the interpreter
-  Py_SetProgramName(C_STRING_LITERAL("PythonAnalysis"));
-  Py_Initialize();
+  // initialize the interpreter, it is shared by all instances
+  if (!this->Internals->Initialized)
+    {
+    Interpreter.Initialize();
+    this->Internals->Initialized = true;
+    }
 
-  if (!this->Internals->ScriptFile.empty() && !this->Internals->ScriptModule.empty())
+  senseiPyGILState gil;
+
+  return this->Internals->InitializeScript(this->GetCommunicator());
+}
+
+//-----------------------------------------------------------------------------
+int PythonAnalysis::InternalsType::InitializeScript(MPI_Comm comm)
+{
+  if (!this->ScriptFile.empty() && !this->ScriptModule.empty())
     {
     SENSEI_ERROR("Both a script file and script module were provided. "
       "You must provide either a script module or a script file not both")
     return -1;
     }
 
-  if (this->Internals->ScriptFile.empty() && this->Internals->ScriptModule.empty())
+  if (this->ScriptFile.empty() && this->ScriptModule.empty())
     {
     SENSEI_ERROR("Neither a script file nor script module were provided. "
       "You must provide either a script file or script module")
     return -1;
     }
 
-  if (!this->Internals->ScriptFile.empty())
+  // serve imports from a node local copy of the zip file
+  if (!this->ImportCache.empty() &&
+    Interpreter.AddImportCache(comm, this->ImportCache))
+    return -1;
+
+  if (!this->ScriptFile.empty())
     {
-    // read, boradcast, and run the script
-    if (loadScript(this->GetCommunicator(), this->Internals->ScriptFile,
-      this->Internals->Module))
+    // read, boradcast, compile, and run the script
+    if (loadScript(comm, this->ScriptFile, this->Module))
       return -1;
     }
   else
     {
     // import the script
-    PyObject *module = PyImport_ImportModule(this->Internals->ScriptModule.c_str());
-
-    if (!module || PyErr_Occurred())
-      {
-      SENSEI_PYTHON_ERROR("Failed to import module \""
-        << this->Internals->ScriptModule  << "\"")
+    if (importScript(this->ScriptModule, this->Module))
       return -1;
-      }
-
-    this->Internals->Module = module;
     }
 
   // look for AnalysisAdaptor API
-  int ierr = getFunction(this->Internals->Module,
-    this->Internals->ScriptModule, "Initialize", false,
-    this->Internals->Initialize);
+  int ierr = getFunction(this->Module, this->ScriptModule,
+    "Initialize", false, this->Initialize);
 
-  ierr += getFunction(this->Internals->Module,
-    this->Internals->ScriptModule, "Execute", true,
-    this->Internals->Execute);
+  ierr += getFunction(this->Module, this->ScriptModule,
+    "Execute", true, this->Execute);
 
-  ierr += getFunction(this->Internals->Module,
-    this->Internals->ScriptModule, "Finalize", false,
-    this->Internals->Finalize);
+  ierr += getFunction(this->Module, this->ScriptModule,
+    "Finalize", false, this->Finalize);
 
   if (ierr)
     {
-    SENSEI_ERROR("Module \"" << this->Internals->ScriptModule <<
+    SENSEI_ERROR("Module \"" << this->ScriptModule <<
       "\" does not provide the required API. The API consists of the "
       "following functions defined at global scope:\n\n    Initialize() -> int\n"
       "    Execute(dataAdaptor) -> int\n    Finalize() -> int\n\nOnly Execute is "
@@ -321,7 +583,7 @@ int PythonAnalysis::Initialize()
     }
 
   // import the sensei wrapper and mpi4py
-  if (runString(this->Internals->Module,
+  if (runString(this->Module,
     "from mpi4py import *\n"
     "from PythonAnalysis import *\n"))
     {
@@ -330,13 +592,13 @@ int PythonAnalysis::Initialize()
     }
 
   // set the communicator
-  PyModule_AddObject(this->Internals->Module,
-    "comm", PyMPIComm_New(this->GetCommunicator()));
+  PyModule_AddObject(this->Module,
+    "comm", PyMPIComm_New(comm));
 
   // set provided globals
-  if (!this->Internals->InitializeSource.empty())
+  if (!this->InitializeSource.empty())
     {
-    if (runString(this->Internals->Module, this->Internals->InitializeSource))
+    if (runString(this->Module, this->InitializeSource))
       {
       SENSEI_ERROR("Failed to run initialize source")
       return -1;
@@ -344,8 +606,8 @@ int PythonAnalysis::Initialize()
     }
 
   // call the provided initialize function
-  if (this->Internals->Initialize)
-    return callFunction("Initialize", this->Internals->Initialize, nullptr);
+  if (this->Initialize)
+    return callFunction("Initialize", this->Initialize, nullptr);
 
   return 0;
 }
@@ -359,6 +621,9 @@ bool PythonAnalysis::Execute(DataAdaptor *dataAdaptor)
     return false;
     }
 
+  // the wrapped DataAdaptor API releases the GIL during calls into C++
+  senseiPyGILState gil;
+
   // wrap the data adaptor instance
   PyObject *pyDataAdaptor = SWIG_NewPointerObj(
     SWIG_as_voidptr(dataAdaptor), SWIGTYPE_p_sensei__DataAdaptor, 0);
@@ -43,6 +43,22 @@ class DataAdaptor;
 // initalization source (see SetInitializeSource) is provided in a string and
 // will be executed prior to your script functions. This lets you set global
 // variables that can modify the screipts run time behavior.
+//
+// The interpreter is shared by all instances. It is started by the first
+// instance to initialize and shut down when the last one finalizes. Each
+// instance runs its script in a module of its own, so more than one script
+// may be used at once. Script files are compiled once and the code is
+// shared by instances running the same file.
+//
+// The GIL is held only while the script's functions run. The wrapped
+// DataAdaptor API (GetMesh, AddArray, ReleaseData, etc) releases it during
+// the call into C++ so that threads started by the script, and analyses
+// running concurrently in other threads, are not serialized behind the
+// interpreter. ArrayView(array) returns NumPy views of a vtkDataArray's
+// memory without copying. Arrays with the standard (AOS) layout are
+// returned as a single 2D array, vtkSOADataArrayTemplate as a tuple with
+// one array per component. Views are valid until the data adaptor's
+// ReleaseData is called.
 class PythonAnalysis : public AnalysisAdaptor
 {
 public:
@@ -66,6 +82,14 @@ public:
   /// before the script's functions.
   void SetInitializeSource(const std::string &source);
 
+  /// Set a zip file of Python modules to import from. Rank 0 reads the
+  /// file and broadcasts it, one rank per node writes it to node local
+  /// storage ($TMPDIR or /tmp), and it is placed at the front of sys.path.
+  /// This avoids every rank searching the parallel file system when
+  /// packages are imported. The copies are removed when the interpreter
+  /// is shut down.
+  void SetImportCache(const std::string &zipFile);
+
   /// Initlize the interpreter, set file name or module name
   /// before initialization
   int Initialize();
@@ -0,0 +1,146 @@
+#include "QuantileSketch.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+QuantileSketch::QuantileSketch(int capacity) :
+  Capacity(std::max(2, capacity + (capacity % 2))), Count(0.0),
+  Min(std::numeric_limits<double>::max()),
+  Max(std::numeric_limits<double>::lowest())
+{
+}
+
+// --------------------------------------------------------------------------
+void QuantileSketch::Clear()
+{
+  this->Levels.clear();
+  this->Offsets.clear();
+  this->Count = 0.0;
+  this->Min = std::numeric_limits<double>::max();
+  this->Max = std::numeric_limits<double>::lowest();
+}
+
+// --------------------------------------------------------------------------
+void QuantileSketch::Insert(double value, int level)
+{
+  if (level >= int(this->Levels.size()))
+    {
+    this->Levels.resize(level + 1);
+    this->Offsets.resize(level + 1, 0);
+    }
+
+  std::vector<double> &comp = this->Levels[level];
+  if (comp.empty())
+    comp.reserve(this->Capacity);
+
+  comp.push_back(value);
+
+  this->Count += double(1ull << level);
+  this->Min = std::min(this->Min, value);
+  this->Max = std::max(this->Max, value);
+
+  if (int(comp.size()) >= this->Capacity)
+    this->Compact(level);
+}
+
+// --------------------------------------------------------------------------
+void QuantileSketch::Compact(int level)
+{
+  // the values promoted stand for those not, the count is unchanged
+  std::vector<double> comp;
+  comp.swap(this->Levels[level]);
+  std::sort(comp.begin(), comp.end());
+
+  // alternating the offset keeps the rank error from accumulating in one
+  // direction
+  int offset = this->Offsets[level];
+  this->Offsets[level] = 1 - offset;
+
+  size_t n = comp.size();
+  double count = this->Count;
+  for (size_t i = offset; i < n; i += 2)
+    this->Insert(comp[i], level + 1);
+
+  // odd sizes leave a value behind
+  if (n % 2)
+    this->Levels[level].push_back(comp[offset ? 0 : n - 1]);
+
+  this->Count = count;
+}
+
+// --------------------------------------------------------------------------
+void QuantileSketch::Merge(const std::vector<double> &values,
+  const std::vector<int> &levels, double minValue, double maxValue)
+{
+  size_t n = std::min(values.size(), levels.size());
+  for (size_t i = 0; i < n; ++i)
+    this->Insert(values[i], levels[i]);
+
+  this->Min = std::min(this->Min, minValue);
+  this->Max = std::max(this->Max, maxValue);
+}
+
+// --------------------------------------------------------------------------
+void QuantileSketch::GetValues(std::vector<double> &values,
+  std::vector<int> &levels) const
+{
+  values.clear();
+  levels.clear();
+
+  int nLevels = this->Levels.size();
+  for (int i = 0; i < nLevels; ++i)
+    {
+    values.insert(values.end(), this->Levels[i].begin(), this->Levels[i].end());
+    levels.insert(levels.end(), this->Levels[i].size(), i);
+    }
+}
+
+// --------------------------------------------------------------------------
+void QuantileSketch::GetQuantiles(int n, double *quantiles) const
+{
+  if (n < 1)
+    return;
+
+  quantiles[0] = this->Min;
+  quantiles[n - 1] = this->Max;
+
+  // sort the values by value with their weights
+  std::vector<std::pair<double,double>> vals;
+  int nLevels = this->Levels.size();
+  for (int i = 0; i < nLevels; ++i)
+    {
+    double weight = double(1ull << i);
+    for (double v : this->Levels[i])
+      vals.emplace_back(v, weight);
+    }
+
+  if (vals.empty())
+    return;
+
+  std::sort(vals.begin(), vals.end());
+
+  double total = 0.0;
+  for (const auto &v : vals)
+    total += v.second;
+
+  // the value whose cumulative weight first exceeds each target
+  size_t j = 0;
+  double cum = vals[0].second;
+  for (int i = 1; i < n - 1; ++i)
+    {
+    double target = total*double(i)/double(n - 1);
+    while ((cum <= target) && (j + 1 < vals.size()))
+      {
+      ++j;
+      cum += vals[j].second;
+      }
+    quantiles[i] = vals[j].first;
+    }
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef sensei_QuantileSketch_h
+#define sensei_QuantileSketch_h
+
+#include <vector>
+
+namespace sensei
+{
+
+/// @class QuantileSketch
+/// @brief a mergeable, constant memory summary of a distribution.
+///
+/// The sketch is a stack of compactors. Values are inserted in the first.
+/// When a compactor holds Capacity values it is sorted and every other value,
+/// starting from an alternating offset, is promoted to the next compactor
+/// where it stands for twice as many values. A sketch of n values holds at
+/// most Capacity*log2(n/Capacity) values and the rank of a quantile is off by
+/// O(n log2(n/Capacity)/Capacity) in the worst case, much less in practice.
+/// Sketches built independently, on different ranks for instance, are merged
+/// by inserting the values of each compactor at the same level. The exact
+/// minimum and maximum are kept.
+class QuantileSketch
+{
+public:
+  QuantileSketch() : QuantileSketch(256) {}
+  explicit QuantileSketch(int capacity);
+
+  /// remove all values
+  void Clear();
+
+  /// add a value
+  void Insert(double value) { this->Insert(value, 0); }
+
+  /// add a value that stands for 2^level values
+  void Insert(double value, int level);
+
+  /// add n values
+  template <typename T>
+  void Insert(const T *values, long n)
+  {
+    for (long i = 0; i < n; ++i)
+      this->Insert(double(values[i]), 0);
+  }
+
+  /// add the values of another sketch, in the form produced by GetValues
+  void Merge(const std::vector<double> &values, const std::vector<int> &levels,
+    double minValue, double maxValue);
+
+  /// get the values held and the level of each
+  void GetValues(std::vector<double> &values, std::vector<int> &levels) const;
+
+  /// the number of values inserted, counting merged sketches
+  double GetCount() const { return this->Count; }
+
+  double GetMin() const { return this->Min; }
+  double GetMax() const { return this->Max; }
+
+  /// estimate n quantiles spaced evenly from the minimum to the maximum. the
+  /// first and last are exact.
+  void GetQuantiles(int n, double *quantiles) const;
+
+private:
+  void Compact(int level);
+
+  int Capacity;
+  std::vector<std::vector<double>> Levels;
+  std::vector<int> Offsets;
+  double Count;
+  double Min;
+  double Max;
+};
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include "Sampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+// z and the DKW constant of the 95% two sided interval
+constexpr double z95 = 1.959964;
+const double dkw95 = std::log(2.0/0.05)/2.0;
+
+// the splitmix64 finalizer, a cheap well mixed hash
+uint64_t mix(uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+}
+
+namespace sensei
+{
+namespace Sampling
+{
+
+// --------------------------------------------------------------------------
+void GetSampleIds(long n, double fraction, unsigned long seed,
+  std::vector<long> &ids)
+{
+  ids.clear();
+
+  if (n < 1)
+    return;
+
+  long m = std::min(n, std::max(1l,
+    static_cast<long>(std::ceil(fraction*n))));
+
+  ids.resize(m);
+
+  uint64_t s = mix(seed ^ mix(n));
+  for (long k = 0; k < m; ++k)
+    {
+    long start = static_cast<long>((static_cast<uint64_t>(k)*n)/m);
+    long end = static_cast<long>((static_cast<uint64_t>(k + 1)*n)/m);
+    ids[k] = start + static_cast<long>(mix(s + k) % (end - start));
+    }
+}
+
+// --------------------------------------------------------------------------
+double GetFraction(long nSamples, long nValues)
+{
+  if ((nValues < 1) || (nSamples >= nValues))
+    return 1.0;
+
+  return std::max(1.0/nValues, static_cast<double>(nSamples)/nValues);
+}
+
+// --------------------------------------------------------------------------
+long GetProportionSampleSize(double bound)
+{
+  // the variance of a proportion is largest, 1/4, at p = 1/2
+  double z = z95/(2.0*bound);
+  return static_cast<long>(std::ceil(z*z));
+}
+
+// --------------------------------------------------------------------------
+long GetCDFSampleSize(double bound)
+{
+  return static_cast<long>(std::ceil(dkw95/(bound*bound)));
+}
+
+// --------------------------------------------------------------------------
+double GetCountBound(double p, double nSamples, double nValues)
+{
+  if ((nSamples <= 0.0) || (nSamples >= nValues))
+    return 0.0;
+
+  // the strata make the variance no larger than that of a simple random
+  // sample, which is used here with the finite population correction
+  double fpc = 1.0 - nSamples/nValues;
+  return z95*nValues*std::sqrt(p*(1.0 - p)*fpc/nSamples);
+}
+
+// --------------------------------------------------------------------------
+double GetCDFBound(double nSamples)
+{
+  if (nSamples <= 0.0)
+    return 1.0;
+
+  return std::min(1.0, std::sqrt(dkw95/nSamples));
+}
+
+}
+}
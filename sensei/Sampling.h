@@ -0,0 +1,44 @@
+#ifndef sensei_Sampling_h
+#define sensei_Sampling_h
+
+#include <vector>
+
+namespace sensei
+{
+
+/// uniform stratified sampling of the values of a block, and the 95%
+/// confidence bounds of the estimates made from the sample. used by the
+/// approximate modes of the histogram and CDF analyses so that their cost
+/// follows the sample size rather than the data size.
+namespace Sampling
+{
+/// get the ids of a stratified sample of n values. the values are split
+/// into ceil(fraction n) strata of equal size and one value at a random
+/// position is taken from each. the positions depend only on n and the
+/// seed, passes over the same block with the same seed see the same
+/// sample. each sampled value stands for n/ids.size() values.
+void GetSampleIds(long n, double fraction, unsigned long seed,
+  std::vector<long> &ids);
+
+/// the fraction in (0, 1] of nValues that makes nSamples
+double GetFraction(long nSamples, long nValues);
+
+/// the number of samples for which the 95% interval of any estimated
+/// proportion, such as the fraction of values in a bin, is within +/- bound
+long GetProportionSampleSize(double bound);
+
+/// the number of samples for which the 95% band of the estimated CDF is
+/// within +/- bound (Dvoretzky-Kiefer-Wolfowitz)
+long GetCDFSampleSize(double bound);
+
+/// the half width of the 95% interval of the count of values where the
+/// proportion p of nSamples drawn from nValues fall
+double GetCountBound(double p, double nSamples, double nValues);
+
+/// the half width of the 95% band of a CDF estimated from nSamples
+double GetCDFBound(double nSamples);
+}
+
+}
+
+#endif
@@ -3,14 +3,22 @@
 #include "PlanarSlicePartitioner.h"
 #include "IsoSurfacePartitioner.h"
 #include "InTransitDataAdaptor.h"
+#include "PartialResultsDataAdaptor.h"
+#include "PolyDataReducer.h"
 #include "VTKPosthocIO.h"
+#include "BlockStream.h"
 #include "VTKDataAdaptor.h"
 #include "VTKUtils.h"
 #include "Profiler.h"
 #include "Error.h"
 
 #include <vtkObjectFactory.h>
+#include <vtkAppendPolyData.h>
 #include <vtkCellData.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkDataArray.h>
+#include <vtkDataSet.h>
 #include <vtkDataObjectAlgorithm.h>
 #include <vtkCellDataToPointData.h>
 #include <vtkContourFilter.h>
@@ -22,6 +30,26 @@
 #include <vtkMultiBlockDataSet.h>
 #include <vtkOverlappingAMR.h>
 #include <vtkUniformGridAMRDataIterator.h>
+#include <vtkImageData.h>
+#include <vtkRectilinearGrid.h>
+#include <vtkUnsignedShortArray.h>
+#if defined(ENABLE_VTK_RENDERING)
+#include <vtkPNGWriter.h>
+#endif
+
+#if defined(ENABLE_HDF5)
+#include <hdf5.h>
+#endif
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
 
 
 using vtkDataObjectAlgorithmPtr = vtkSmartPointer<vtkDataObjectAlgorithm>;
@@ -29,6 +57,600 @@ using vtkCellDataToPointDataPtr = vtkSmartPointer<vtkCellDataToPointData>;
 using vtkContourFilterPtr = vtkSmartPointer<vtkContourFilter>;
 using vtkCutterPtr = vtkSmartPointer<vtkCutter>;
 using vtkPlanePtr = vtkSmartPointer<vtkPlane>;
+using vtkAppendPolyDataPtr = vtkSmartPointer<vtkAppendPolyData>;
+using vtkPolyDataPtr = vtkSmartPointer<vtkPolyData>;
+using BlockRangeMap = std::map<long, std::array<double,2>>;
+
+namespace
+{
+// planes that share a normal are cut in a single pass, the implicit function
+// is evaluated once per point and each plane is a value of it
+struct PlaneGroup
+{
+  std::array<double,3> Origin;
+  std::array<double,3> Normal;
+  std::vector<double> Offsets;
+};
+
+void GroupPlanes(const std::vector<std::array<double,3>> &points,
+  const std::vector<std::array<double,3>> &normals,
+  std::vector<PlaneGroup> &groups)
+{
+  groups.clear();
+  size_t nPlanes = std::min(points.size(), normals.size());
+  for (size_t i = 0; i < nPlanes; ++i)
+    {
+    std::array<double,3> n = normals[i];
+    double len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    if (len <= 0.0)
+      continue;
+    for (int j = 0; j < 3; ++j)
+      n[j] /= len;
+
+    PlaneGroup *group = nullptr;
+    for (PlaneGroup &g : groups)
+      {
+      if ((std::fabs(g.Normal[0] - n[0]) < 1.0e-12) &&
+        (std::fabs(g.Normal[1] - n[1]) < 1.0e-12) &&
+        (std::fabs(g.Normal[2] - n[2]) < 1.0e-12))
+        {
+        group = &g;
+        break;
+        }
+      }
+
+    if (!group)
+      {
+      groups.push_back({points[i], n, {}});
+      group = &groups.back();
+      }
+
+    const std::array<double,3> &o = group->Origin;
+    group->Offsets.push_back(n[0]*(points[i][0] - o[0]) +
+      n[1]*(points[i][1] - o[1]) + n[2]*(points[i][2] - o[2]));
+    }
+}
+
+// true if any plane of the group passes through the box
+bool IntersectsBox(const PlaneGroup &g, const double *bounds)
+{
+  double c = 0.0;
+  double r = 0.0;
+  for (int j = 0; j < 3; ++j)
+    {
+    double mid = 0.5*(bounds[2*j] + bounds[2*j+1]);
+    double half = 0.5*(bounds[2*j+1] - bounds[2*j]);
+    c += g.Normal[j]*(mid - g.Origin[j]);
+    r += std::fabs(g.Normal[j])*half;
+    }
+
+  for (double off : g.Offsets)
+    {
+    if ((off >= c - r) && (off <= c + r))
+      return true;
+    }
+
+  return false;
+}
+
+// true if any of the values is in the range
+bool InRange(const double range[2], const std::vector<double> &vals)
+{
+  for (double v : vals)
+    {
+    if ((v >= range[0]) && (v <= range[1]))
+      return true;
+    }
+
+  return false;
+}
+
+// true if any of the values is in the range of the array
+bool InRange(vtkDataArray *array, const std::vector<double> &vals)
+{
+  if (!array)
+    return true;
+
+  double range[2];
+  array->GetRange(range, 0);
+
+  return InRange(range, vals);
+}
+
+// get the range of the named array on each block, by block id, from the
+// metadata. blocks without a valid range are left out, their range is
+// computed from the data
+void GetBlockRanges(const sensei::MeshMetadataPtr &md,
+  const std::string &arrayName, int arrayCen, BlockRangeMap &ranges)
+{
+  ranges.clear();
+
+  if (!md || !md->Flags.BlockArrayRangeSet() ||
+    (md->BlockArrayRange.size() != md->BlockIds.size()))
+    return;
+
+  std::vector<std::string>::const_iterator ait =
+    std::find(md->ArrayName.begin(), md->ArrayName.end(), arrayName);
+
+  if (ait == md->ArrayName.end())
+    return;
+
+  // the range of a multi-component array is not that of its first component
+  unsigned int ai = ait - md->ArrayName.begin();
+  if ((ai >= md->ArrayCentering.size()) || (md->ArrayCentering[ai] != arrayCen) ||
+    (ai >= md->ArrayComponents.size()) || (md->ArrayComponents[ai] != 1))
+    return;
+
+  unsigned int nBlocks = md->BlockIds.size();
+  for (unsigned int i = 0; i < nBlocks; ++i)
+    {
+    const std::vector<std::array<double,2>> &blockRange = md->BlockArrayRange[i];
+    if ((ai < blockRange.size()) && (blockRange[ai][0] <= blockRange[ai][1]))
+      ranges[md->BlockIds[i]] = blockRange[ai];
+    }
+}
+
+// --------------------------------------------------------------------------
+// get the global ids of the local blocks selected by a partitioner. the
+// metadata holds the local view
+template <typename partitioner_t>
+int GetActiveBlockIds(partitioner_t &part, const sensei::MeshMetadataPtr &md,
+  std::vector<int> &ids)
+{
+  std::vector<int> active;
+  if (part.GetActiveBlocks(md, active))
+    return -1;
+
+  ids.clear();
+  for (int i : active)
+    ids.push_back(md->BlockIds[i]);
+
+  return 0;
+}
+
+// move the extracted blocks of a batch into the output. the output takes
+// the batch's reference
+void AppendBlocks(vtkCompositeDataSet *batch, vtkCompositeDataSet *&output)
+{
+  if (!batch)
+    return;
+
+  if (!output)
+    {
+    output = batch;
+    return;
+    }
+
+  vtkMultiBlockDataSet *mbIn = dynamic_cast<vtkMultiBlockDataSet*>(batch);
+  vtkMultiBlockDataSet *mbOut = dynamic_cast<vtkMultiBlockDataSet*>(output);
+  if (mbIn && mbOut)
+    {
+    unsigned int nBlocks = mbIn->GetNumberOfBlocks();
+    if (mbOut->GetNumberOfBlocks() < nBlocks)
+      mbOut->SetNumberOfBlocks(nBlocks);
+
+    for (unsigned int i = 0; i < nBlocks; ++i)
+      {
+      vtkDataObject *block = mbIn->GetBlock(i);
+      if (block)
+        mbOut->SetBlock(i, block);
+      }
+    }
+
+  batch->Delete();
+}
+
+// an empty extract, for ranks that had no blocks to process
+vtkCompositeDataSet *NewEmptyExtract(const sensei::MeshMetadataPtr &md)
+{
+  vtkMultiBlockDataSet *mbds = vtkMultiBlockDataSet::New();
+  mbds->SetNumberOfBlocks(md->NumBlocks);
+  return mbds;
+}
+
+enum {RASTER_NONE=0, RASTER_RAW=1, RASTER_PNG=2, RASTER_HDF5=3};
+
+// a value sampled at global index I,J of the image's axes
+struct RasterPixel
+{
+  int I;
+  int J;
+  float Value;
+};
+
+// the pixels of one array on one plane sampled from the local blocks
+struct RasterImage
+{
+  RasterImage(int plane, int axis, double pos, int cen, const std::string &name) :
+    Plane(plane), Axis(axis), Position(pos), Centering(cen), ArrayName(name),
+    Extent{INT_MAX, INT_MIN, INT_MAX, INT_MIN} {}
+
+  int Plane;
+  int Axis;           // the axis the plane is normal to
+  double Position;    // the plane's coordinate on that axis
+  int Centering;
+  std::string ArrayName;
+  int Extent[4];      // of the pixels, i0, i1, j0, j1
+  std::vector<RasterPixel> Pixels;
+};
+
+// the axes of an image normal to the given axis, in increasing order
+void GetImageAxes(int axis, int &u, int &v)
+{
+  u = axis == 0 ? 1 : 0;
+  v = axis == 2 ? 1 : 2;
+}
+
+// get the axis a normal is along, or -1 if it is not along one
+int GetNormalAxis(const std::array<double,3> &n)
+{
+  double len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+  for (int a = 0; a < 3; ++a)
+    {
+    int u = 0, v = 0;
+    GetImageAxes(a, u, v);
+    if ((len > 0.0) && (std::fabs(n[u]) <= 1.0e-12*len) &&
+      (std::fabs(n[v]) <= 1.0e-12*len))
+      return a;
+    }
+  return -1;
+}
+
+// get the block's extent and the position of x along the axis in the
+// global index space of its points. returns -1 for blocks that are not
+// vtkImageData or vtkRectilinearGrid, 1 when x is outside of the block
+int GetIndexCoordinate(vtkDataSet *ds, int axis, double x, int ext[6],
+  double &t)
+{
+  if (vtkImageData *im = dynamic_cast<vtkImageData*>(ds))
+    {
+    im->GetExtent(ext);
+    double *origin = im->GetOrigin();
+    double *spacing = im->GetSpacing();
+    if (spacing[axis] == 0.0)
+      return 1;
+    t = (x - origin[axis])/spacing[axis];
+    }
+  else if (vtkRectilinearGrid *rg = dynamic_cast<vtkRectilinearGrid*>(ds))
+    {
+    rg->GetExtent(ext);
+    vtkDataArray *coords = axis == 0 ? rg->GetXCoordinates() :
+      (axis == 1 ? rg->GetYCoordinates() : rg->GetZCoordinates());
+    long n = coords ? coords->GetNumberOfTuples() : 0;
+    if (n < 1)
+      return 1;
+
+    // the coordinates increase, find the interval holding x
+    long lo = 0;
+    long hi = n - 1;
+    if ((x < coords->GetComponent(lo, 0)) || (x > coords->GetComponent(hi, 0)))
+      return 1;
+    while (hi - lo > 1)
+      {
+      long mid = (lo + hi)/2;
+      if (coords->GetComponent(mid, 0) <= x)
+        lo = mid;
+      else
+        hi = mid;
+      }
+    double x0 = coords->GetComponent(lo, 0);
+    double x1 = coords->GetComponent(hi, 0);
+    t = ext[2*axis] + lo + (x1 > x0 ? (x - x0)/(x1 - x0) : 0.0);
+    }
+  else
+    {
+    return -1;
+    }
+
+  return (t < ext[2*axis] - 0.5) || (t > ext[2*axis+1] + 0.5) ? 1 : 0;
+}
+
+// sample the image's array on the block's layer of points or cells
+// nearest its plane. a plane on the face between two cells takes the
+// values of one of them. returns -1 for blocks of unsupported type
+int RasterizeBlock(vtkDataSet *ds, RasterImage &img)
+{
+  int a = img.Axis;
+  int ext[6] = {0};
+  double t = 0.0;
+  int ierr = GetIndexCoordinate(ds, a, img.Position, ext, t);
+  if (ierr)
+    return ierr < 0 ? -1 : 0;
+
+  vtkDataArray *array = img.Centering == vtkDataObject::CELL ?
+    ds->GetCellData()->GetArray(img.ArrayName.c_str()) :
+    ds->GetPointData()->GetArray(img.ArrayName.c_str());
+  if (!array)
+    return 0;
+
+  // the dimensions, in points or cells, paired with the extent's lower
+  // corner
+  bool cells = img.Centering == vtkDataObject::CELL;
+  int dims[3] = {0};
+  for (int q = 0; q < 3; ++q)
+    {
+    dims[q] = ext[2*q+1] - ext[2*q] + (cells ? 0 : 1);
+    if (cells && (dims[q] < 1))
+      dims[q] = 1;
+    }
+
+  // the layer nearest the plane
+  int layer = 0;
+  if (cells)
+    {
+    layer = std::min(int(std::floor(t)), ext[2*a] + dims[a] - 1);
+    layer = std::max(layer, ext[2*a]);
+    }
+  else
+    {
+    layer = int(std::lround(t));
+    if ((layer < ext[2*a]) || (layer > ext[2*a+1]))
+      return 0;
+    }
+
+  int u = 0, v = 0;
+  GetImageAxes(a, u, v);
+
+  int nComps = array->GetNumberOfComponents();
+  int ijk[3] = {0};
+  ijk[a] = layer - ext[2*a];
+  for (int j = 0; j < dims[v]; ++j)
+    {
+    ijk[v] = j;
+    for (int i = 0; i < dims[u]; ++i)
+      {
+      ijk[u] = i;
+      vtkIdType id = ijk[0] + vtkIdType(dims[0])*(ijk[1] + vtkIdType(dims[1])*ijk[2]);
+
+      double val = 0.0;
+      if (nComps == 1)
+        {
+        val = array->GetComponent(id, 0);
+        }
+      else
+        {
+        for (int c = 0; c < nComps; ++c)
+          {
+          double vc = array->GetComponent(id, c);
+          val += vc*vc;
+          }
+        val = std::sqrt(val);
+        }
+
+      img.Pixels.push_back({ext[2*u] + i, ext[2*v] + j, float(val)});
+      }
+    }
+
+  img.Extent[0] = std::min(img.Extent[0], ext[2*u]);
+  img.Extent[1] = std::max(img.Extent[1], ext[2*u] + dims[u] - 1);
+  img.Extent[2] = std::min(img.Extent[2], ext[2*v]);
+  img.Extent[3] = std::max(img.Extent[3], ext[2*v] + dims[v] - 1);
+
+  return 0;
+}
+
+// sample the images on the blocks of a batch
+int RasterizeBlocks(vtkCompositeDataSet *input, std::vector<RasterImage> &images)
+{
+  vtkCompositeDataIterator *it = input->NewIterator();
+  for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+    {
+    vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+    if (!ds)
+      continue;
+
+    for (RasterImage &img : images)
+      {
+      if (RasterizeBlock(ds, img))
+        {
+        SENSEI_ERROR("Raster output requires vtkImageData or vtkRectilinearGrid"
+          " blocks, not " << ds->GetClassName())
+        it->Delete();
+        return -1;
+        }
+      }
+    }
+  it->Delete();
+  return 0;
+}
+
+// write an image on rank 0. values holds ni*nj values, i fastest
+int WriteImage(int format, const std::string &fileName, const RasterImage &img,
+  const int ext[4], double time, const std::vector<float> &values)
+{
+  int ni = ext[1] - ext[0] + 1;
+  int nj = ext[3] - ext[2] + 1;
+
+  if (format == RASTER_RAW)
+    {
+    std::ofstream ofs(fileName, std::ios::binary);
+    if (!ofs || !ofs.write(reinterpret_cast<const char*>(values.data()),
+      values.size()*sizeof(float)))
+      {
+      SENSEI_ERROR("Failed to write \"" << fileName << "\"")
+      return -1;
+      }
+    return 0;
+    }
+#if defined(ENABLE_VTK_RENDERING)
+  else if (format == RASTER_PNG)
+    {
+    // scale to the range of the pixels set, unset pixels are 0
+    float lo = std::numeric_limits<float>::max();
+    float hi = std::numeric_limits<float>::lowest();
+    for (float val : values)
+      {
+      if (!std::isnan(val))
+        {
+        lo = std::min(lo, val);
+        hi = std::max(hi, val);
+        }
+      }
+    float scale = hi > lo ? 65535.0f/(hi - lo) : 0.0f;
+
+    vtkImageData *im = vtkImageData::New();
+    im->SetDimensions(ni, nj, 1);
+    im->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+
+    unsigned short *pix = static_cast<vtkUnsignedShortArray*>(
+      im->GetPointData()->GetScalars())->GetPointer(0);
+    size_t nPix = values.size();
+    for (size_t q = 0; q < nPix; ++q)
+      pix[q] = std::isnan(values[q]) ? 0 :
+        static_cast<unsigned short>((values[q] - lo)*scale);
+
+    vtkPNGWriter *writer = vtkPNGWriter::New();
+    writer->SetFileName(fileName.c_str());
+    writer->SetInputData(im);
+    writer->Write();
+    writer->Delete();
+    im->Delete();
+    return 0;
+    }
+#endif
+#if defined(ENABLE_HDF5)
+  else if (format == RASTER_HDF5)
+    {
+    hid_t fh = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if (fh < 0)
+      {
+      SENSEI_ERROR("Failed to create \"" << fileName << "\"")
+      return -1;
+      }
+
+    hsize_t dims[2] = {hsize_t(nj), hsize_t(ni)};
+    hid_t space = H5Screate_simple(2, dims, nullptr);
+    hid_t dset = H5Dcreate2(fh, img.ArrayName.c_str(), H5T_NATIVE_FLOAT,
+      space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    herr_t ierr = dset < 0 ? -1 : H5Dwrite(dset, H5T_NATIVE_FLOAT, H5S_ALL,
+      H5S_ALL, H5P_DEFAULT, values.data());
+    H5Sclose(space);
+
+    if (dset >= 0)
+      {
+      // the extent, axis, position and time of the image
+      hsize_t n = 4;
+      space = H5Screate_simple(1, &n, nullptr);
+      hid_t attr = H5Acreate2(dset, "extent", H5T_NATIVE_INT, space,
+        H5P_DEFAULT, H5P_DEFAULT);
+      H5Awrite(attr, H5T_NATIVE_INT, ext);
+      H5Aclose(attr);
+      H5Sclose(space);
+
+      space = H5Screate(H5S_SCALAR);
+      attr = H5Acreate2(dset, "axis", H5T_NATIVE_INT, space, H5P_DEFAULT,
+        H5P_DEFAULT);
+      H5Awrite(attr, H5T_NATIVE_INT, &img.Axis);
+      H5Aclose(attr);
+
+      attr = H5Acreate2(dset, "position", H5T_NATIVE_DOUBLE, space,
+        H5P_DEFAULT, H5P_DEFAULT);
+      H5Awrite(attr, H5T_NATIVE_DOUBLE, &img.Position);
+      H5Aclose(attr);
+
+      attr = H5Acreate2(dset, "time", H5T_NATIVE_DOUBLE, space, H5P_DEFAULT,
+        H5P_DEFAULT);
+      H5Awrite(attr, H5T_NATIVE_DOUBLE, &time);
+      H5Aclose(attr);
+      H5Sclose(space);
+
+      H5Dclose(dset);
+      }
+    H5Fclose(fh);
+
+    if (ierr < 0)
+      {
+      SENSEI_ERROR("Failed to write \"" << fileName << "\"")
+      return -1;
+      }
+    return 0;
+    }
+#endif
+
+  (void)img;
+  (void)time;
+  SENSEI_ERROR("Invalid raster format " << format)
+  return -1;
+}
+
+// gather the pixels of each image to rank 0 and write one file per image
+int WriteImages(MPI_Comm comm, int format, const std::string &outputDir,
+  const std::string &meshName, long timeStep, double time,
+  std::vector<RasterImage> &images)
+{
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  // the images are collective, rank 0 keeps writing after a failure
+  int ierr = 0;
+  for (RasterImage &img : images)
+    {
+    // the image covers the blocks that the plane passes through
+    int ext[4] = {img.Extent[0], -img.Extent[1], img.Extent[2], -img.Extent[3]};
+    MPI_Allreduce(MPI_IN_PLACE, ext, 4, MPI_INT, MPI_MIN, comm);
+    ext[1] = -ext[1];
+    ext[3] = -ext[3];
+
+    if ((ext[0] > ext[1]) || (ext[2] > ext[3]))
+      {
+      if (rank == 0)
+        SENSEI_WARNING("Plane " << img.Plane << " does not intersect mesh \""
+          << meshName << "\"")
+      continue;
+      }
+
+    long long total = img.Pixels.size()*sizeof(RasterPixel);
+    MPI_Allreduce(MPI_IN_PLACE, &total, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    if (total > INT_MAX)
+      {
+      SENSEI_ERROR("Image of " << total << " bytes is too large to gather")
+      return -1;
+      }
+
+    int nBytes = img.Pixels.size()*sizeof(RasterPixel);
+    std::vector<int> counts(nRanks);
+    MPI_Gather(&nBytes, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+
+    std::vector<int> displs(nRanks, 0);
+    std::vector<RasterPixel> pixels;
+    if (rank == 0)
+      {
+      for (int r = 1; r < nRanks; ++r)
+        displs[r] = displs[r-1] + counts[r-1];
+      pixels.resize(total/sizeof(RasterPixel));
+      }
+
+    MPI_Gatherv(img.Pixels.data(), nBytes, MPI_BYTE, pixels.data(),
+      counts.data(), displs.data(), MPI_BYTE, 0, comm);
+
+    if (rank != 0)
+      continue;
+
+    long ni = ext[1] - ext[0] + 1;
+    long nj = ext[3] - ext[2] + 1;
+    std::vector<float> values(ni*nj, std::numeric_limits<float>::quiet_NaN());
+    for (const RasterPixel &p : pixels)
+      values[(p.J - ext[2])*ni + p.I - ext[0]] = p.Value;
+
+    std::ostringstream fileName;
+    fileName << outputDir << "/" << meshName << "_" << img.ArrayName << "_"
+      << img.Plane << "_" << timeStep;
+    if (format == RASTER_RAW)
+      fileName << "_" << ni << "x" << nj << ".raw";
+    else if (format == RASTER_PNG)
+      fileName << ".png";
+    else
+      fileName << ".h5";
+
+    if (WriteImage(format, fileName.str(), img, ext, time, values))
+      ierr = -1;
+    }
+
+  return ierr;
+}
+}
 
 namespace sensei
 {
@@ -36,7 +658,9 @@ namespace sensei
 struct SliceExtract::InternalsType
 {
   InternalsType() : Operation(OP_PLANAR_SLICE), NumIsoValues(0),
-    EnablePartitioner(1)
+    EnablePartitioner(1), NumThreads(1), BatchSize(0),
+    RasterFormat(RASTER_NONE), OutputDir("./"), Publish(0), Write(1),
+    Published(nullptr)
   {
     this->SlicePartitioner = PlanarSlicePartitioner::New();
     this->IsoValPartitioner = IsoSurfacePartitioner::New();
@@ -50,9 +674,17 @@ struct SliceExtract::InternalsType
   std::array<double,3> Normal;
   DataRequirements Requirements;
   int EnablePartitioner;
+  int NumThreads;
+  int BatchSize;
+  int RasterFormat;
+  std::string OutputDir;
   IsoSurfacePartitionerPtr IsoValPartitioner;
   PlanarSlicePartitionerPtr SlicePartitioner;
   VTKPosthocIOPtr Writer;
+  int Publish;
+  int Write;
+  PartialResultsDataAdaptor *Published;
+  PolyDataReducer Reducer;
 };
 
 
@@ -72,16 +704,29 @@ SliceExtract::~SliceExtract()
   delete this->Internals;
 }
 
+// --------------------------------------------------------------------------
+void SliceExtract::SetBatchSize(int val)
+{
+  this->Internals->BatchSize = val;
+}
+
 // --------------------------------------------------------------------------
 void SliceExtract::EnablePartitioner(int val)
 {
   this->Internals->EnablePartitioner = val;
 }
 
+// --------------------------------------------------------------------------
+void SliceExtract::SetNumberOfThreads(int val)
+{
+  this->Internals->NumThreads = std::max(1, val);
+}
+
 // --------------------------------------------------------------------------
 int SliceExtract::SetOperation(int op)
 {
-  if ((op != OP_PLANAR_SLICE) || (op != OP_ISO_SURFACE))
+  if ((op != OP_PLANAR_SLICE) && (op != OP_ISO_SURFACE) &&
+    (op != OP_SLICE_AND_ISO_SURFACE))
     {
     SENSEI_ERROR("Invalid operation " << op)
     return -1;
@@ -107,6 +752,10 @@ int SliceExtract::SetOperation(std::string opStr)
     {
     op = OP_ISO_SURFACE;
     }
+  else if (opStr == "slice_and_iso_surface")
+    {
+    op = OP_SLICE_AND_ISO_SURFACE;
+    }
   else
     {
     SENSEI_ERROR("invalid operation \"" << opStr << "\"")
@@ -146,9 +795,54 @@ void SliceExtract::SetVerbose(int val)
   this->Internals->IsoValPartitioner->SetVerbose(val);
 }
 
+// --------------------------------------------------------------------------
+void SliceExtract::SetPublish(int val)
+{
+  this->Internals->Publish = val;
+}
+
+// --------------------------------------------------------------------------
+void SliceExtract::SetWrite(int val)
+{
+  this->Internals->Write = val;
+}
+
+// --------------------------------------------------------------------------
+void SliceExtract::SetReducer(const PolyDataReducer &reducer)
+{
+  this->Internals->Reducer = reducer;
+}
+
+// --------------------------------------------------------------------------
+void SliceExtract::GetExtractMeshNames(std::vector<std::string> &names)
+{
+  names.clear();
+
+  int op = this->Internals->Operation;
+
+  if ((op == OP_PLANAR_SLICE) || (op == OP_SLICE_AND_ISO_SURFACE))
+    {
+    MeshRequirementsIterator mit =
+      this->Internals->Requirements.GetMeshRequirementsIterator();
+    for (; mit; ++mit)
+      names.push_back(mit.MeshName() + "_slice");
+    }
+
+  std::string meshName;
+  std::string arrayName;
+  int arrayCentering = 0;
+  std::vector<double> isoVals;
+
+  if (((op == OP_ISO_SURFACE) || (op == OP_SLICE_AND_ISO_SURFACE)) &&
+    !this->Internals->IsoValPartitioner->GetIsoValues(meshName,
+    arrayName, arrayCentering, isoVals))
+    names.push_back(meshName + "_" + arrayName + "_isos");
+}
+
 // --------------------------------------------------------------------------
 int SliceExtract::SetWriterOutputDir(const std::string &outputDir)
 {
+  this->Internals->OutputDir = outputDir;
   return this->Internals->Writer->SetOutputDir(outputDir);
 }
 
@@ -164,6 +858,37 @@ int SliceExtract::SetWriterWriter(const std::string &writer)
   return this->Internals->Writer->SetWriter(writer);
 }
 
+// --------------------------------------------------------------------------
+int SliceExtract::SetRasterFormat(const std::string &format)
+{
+  if (format.empty())
+    {
+    this->Internals->RasterFormat = RASTER_NONE;
+    }
+  else if (format == "raw")
+    {
+    this->Internals->RasterFormat = RASTER_RAW;
+    }
+#if defined(ENABLE_VTK_RENDERING)
+  else if (format == "png")
+    {
+    this->Internals->RasterFormat = RASTER_PNG;
+    }
+#endif
+#if defined(ENABLE_HDF5)
+  else if (format == "hdf5")
+    {
+    this->Internals->RasterFormat = RASTER_HDF5;
+    }
+#endif
+  else
+    {
+    SENSEI_ERROR("Invalid or disabled raster format \"" << format << "\"")
+    return -1;
+    }
+  return 0;
+}
+
 // --------------------------------------------------------------------------
 int SliceExtract::SetPoint(const std::array<double,3> &point)
 {
@@ -178,68 +903,336 @@ int SliceExtract::SetNormal(const std::array<double,3> &normal)
   return 0;
 }
 
-//-----------------------------------------------------------------------------
-int SliceExtract::SetDataRequirements(const DataRequirements &reqs)
-{
-  this->Internals->Requirements = reqs;
-  return 0;
-}
+// --------------------------------------------------------------------------
+int SliceExtract::SetPlanes(const std::vector<std::array<double,3>> &points,
+  const std::vector<std::array<double,3>> &normals)
+{
+  return this->Internals->SlicePartitioner->SetPlanes(points, normals);
+}
+
+//-----------------------------------------------------------------------------
+int SliceExtract::SetDataRequirements(const DataRequirements &reqs)
+{
+  this->Internals->Requirements = reqs;
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int SliceExtract::AddDataRequirement(const std::string &meshName,
+  int association, const std::vector<std::string> &arrays)
+{
+  this->Internals->Requirements.AddRequirement(meshName, association, arrays);
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+bool SliceExtract::Execute(DataAdaptor* dataAdaptor)
+{
+  TimeEvent<128> mark("SliceExtract::Execute");
+
+  // the extracts are published to the adaptor that serves them to the
+  // analyses that run next
+  this->Internals->Published = nullptr;
+  if (this->Internals->Publish)
+    {
+    this->Internals->Published = dynamic_cast<PartialResultsDataAdaptor*>(dataAdaptor);
+    if (!this->Internals->Published)
+      {
+      SENSEI_ERROR("Extracts can only be published when executed on a"
+        " PartialResultsDataAdaptor")
+      return false;
+      }
+    }
+
+  if (this->Internals->Operation == OP_PLANAR_SLICE)
+    {
+    return this->ExecuteSlice(dataAdaptor);
+    }
+  else if (this->Internals->Operation == OP_ISO_SURFACE)
+    {
+    return this->ExecuteIsoSurface(dataAdaptor);
+    }
+  else if (this->Internals->Operation == OP_SLICE_AND_ISO_SURFACE)
+    {
+    return this->ExecuteSliceAndIsoSurface(dataAdaptor);
+    }
+
+  SENSEI_ERROR("Invalid operation " << this->Internals->Operation)
+  return false;
+}
+
+// --------------------------------------------------------------------------
+bool SliceExtract::ExecuteIsoSurface(DataAdaptor* dataAdaptor)
+{
+  TimeEvent<128> mark("SliceExtract::ExecuteIsoSurface");
+
+  // get the mesh array and iso values
+  std::string meshName;
+  std::string arrayName;
+  int arrayCentering = vtkDataObject::POINT;
+  std::vector<double> isoVals;
+
+  if (this->Internals->IsoValPartitioner->GetIsoValues(meshName,
+    arrayName, arrayCentering, isoVals))
+    {
+    SENSEI_ERROR("Iso-values have not been provided")
+    return false;
+    }
+
+  // if we are runnigng in transit, set the partitioner that will pull
+  // only the blocks that intersect the slice plane
+  InTransitDataAdaptor *itDataAdaptor =
+    dynamic_cast<InTransitDataAdaptor*>(dataAdaptor);
+
+  bool repartition = this->Internals->EnablePartitioner && itDataAdaptor;
+  if (repartition)
+    itDataAdaptor->SetPartitioner(this->Internals->IsoValPartitioner);
+
+  // figure out what the simulation can provide
+  MeshMetadataFlags flags;
+  flags.SetBlockDecomp();
+  flags.SetBlockArrayRange();
+
+  MeshMetadataMap mdm;
+  if (mdm.Initialize(dataAdaptor, flags))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return false;
+    }
+
+  // get metadata
+  MeshMetadataPtr md;
+  if (mdm.GetMeshMetadata(meshName, md))
+    {
+    SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
+    return false;
+    }
+
+  // in situ, only the blocks whose range includes an iso value are
+  // constructed. in transit the partitioner has selected them
+  std::vector<int> blockIds;
+  if (!repartition && !VTKUtils::AMR(md) &&
+    GetActiveBlockIds(*this->Internals->IsoValPartitioner, md, blockIds))
+    {
+    SENSEI_ERROR("Failed to select the blocks of mesh \"" << meshName << "\"")
+    return false;
+    }
+
+  BlockStream stream;
+  stream.SetCommunicator(this->GetCommunicator());
+  stream.SetBatchSize(this->Internals->BatchSize);
+
+  BlockStream::ArrayMap arrays;
+  arrays[arrayCentering].push_back(arrayName);
+
+  // compute the iso-surfaces. blocks whose metadata range excludes the
+  // iso-values are skipped without touching their data
+  BlockRangeMap blockRanges;
+  GetBlockRanges(md, arrayName, arrayCentering, blockRanges);
+
+  vtkCompositeDataSet *isoMesh = nullptr;
+  BlockStream::Visitor extract = [&](vtkCompositeDataSet *batch) -> int
+    {
+    vtkCompositeDataSet *batchIso = nullptr;
+    if (this->IsoSurface(batch, arrayName, arrayCentering, isoVals,
+      blockRanges, batchIso))
+      return -1;
+
+    AppendBlocks(batchIso, isoMesh);
+    return 0;
+    };
+
+  if ((repartition || VTKUtils::AMR(md)) ?
+    stream.Visit(dataAdaptor, md, false, arrays, extract) :
+    stream.Visit(dataAdaptor, md, false, blockIds, arrays, extract))
+    {
+    SENSEI_ERROR("Failed to extract iso-surfaces from mesh \"" << meshName << "\"")
+    if (isoMesh)
+      isoMesh->Delete();
+    return false;
+    }
+
+  if (!isoMesh)
+    isoMesh = NewEmptyExtract(md);
+
+  // write or publish it
+  std::string isoMeshName  = meshName + "_" + arrayName + "_isos";
+  long timeStep = dataAdaptor->GetDataTimeStep();
+  double time = dataAdaptor->GetDataTime();
+  if (this->WriteExtract(timeStep, time, isoMeshName, isoMesh))
+    {
+    SENSEI_ERROR("Failed to write the extract")
+    return false;
+    }
+
+  isoMesh->Delete();
+
+  dataAdaptor->ReleaseData();
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool SliceExtract::ExecuteSlice(DataAdaptor* dataAdaptor)
+{
+  TimeEvent<128> mark("SliceExtract::ExecuteSlice");
+
+  if (this->Internals->RasterFormat != RASTER_NONE)
+    return this->ExecuteRaster(dataAdaptor);
+
+  // require the user to tell us one or more meshes to slice
+  if (this->Internals->Requirements.Empty())
+    {
+    SENSEI_ERROR("No mesh was specified")
+    return false;
+    }
+
+  // if we are runnigng in transit, set the partitioner that will pull
+  // only the blocks that intersect the slice plane
+  InTransitDataAdaptor *itDataAdaptor =
+    dynamic_cast<InTransitDataAdaptor*>(dataAdaptor);
+
+  bool repartition = this->Internals->EnablePartitioner && itDataAdaptor;
+  if (repartition)
+    itDataAdaptor->SetPartitioner(this->Internals->SlicePartitioner);
+
+  // figure out what the simulation can provide. in situ the block bounds
+  // are used to construct only the blocks that intersect the planes
+  MeshMetadataFlags flags;
+  flags.SetBlockDecomp();
+  if (!repartition)
+    flags.SetBlockBounds();
+
+  MeshMetadataMap mdm;
+  if (mdm.Initialize(dataAdaptor, flags))
+    {
+    SENSEI_ERROR("Failed to get metadata")
+    return false;
+    }
+
+  BlockStream stream;
+  stream.SetCommunicator(this->GetCommunicator());
+  stream.SetBatchSize(this->Internals->BatchSize);
+
+  // loop over requested meshes, pull the arrays, take slice,
+  // and finally write the result
+  MeshRequirementsIterator mit =
+    this->Internals->Requirements.GetMeshRequirementsIterator();
+
+  while (mit)
+    {
+    const std::string &meshName = mit.MeshName();
+    // get metadata
+    MeshMetadataPtr md;
+    if (mdm.GetMeshMetadata(meshName, md))
+      {
+      SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
+      return false;
+      }
+
+    // in situ, only the blocks intersecting the planes are constructed
+    std::vector<int> blockIds;
+    if (!repartition && !VTKUtils::AMR(md) &&
+      GetActiveBlockIds(*this->Internals->SlicePartitioner, md, blockIds))
+      {
+      SENSEI_ERROR("Failed to select the blocks of mesh \"" << meshName << "\"")
+      return false;
+      }
+
+    // the required arrays
+    BlockStream::ArrayMap arrays;
+
+    ArrayRequirementsIterator ait =
+      this->Internals->Requirements.GetArrayRequirementsIterator(meshName);
+
+    for (; ait; ++ait)
+      arrays[ait.Association()].push_back(ait.Array());
+
+    // compute the slices
+    std::vector<std::array<double,3>> points, normals;
+    this->Internals->SlicePartitioner->GetPlanes(points, normals);
+
+    vtkCompositeDataSet *sliceMesh = nullptr;
+    BlockStream::Visitor extract = [&](vtkCompositeDataSet *batch) -> int
+      {
+      vtkCompositeDataSet *batchSlice = nullptr;
+      if (this->Slice(batch, points, normals, batchSlice))
+        return -1;
+
+      AppendBlocks(batchSlice, sliceMesh);
+      return 0;
+      };
+
+    if ((repartition || VTKUtils::AMR(md)) ?
+      stream.Visit(dataAdaptor, md, mit.StructureOnly(), arrays, extract) :
+      stream.Visit(dataAdaptor, md, mit.StructureOnly(), blockIds, arrays, extract))
+      {
+      SENSEI_ERROR("Failed to slice mesh \"" << meshName << "\"")
+      if (sliceMesh)
+        sliceMesh->Delete();
+      return false;
+      }
+
+    if (!sliceMesh)
+      sliceMesh = NewEmptyExtract(md);
 
-//-----------------------------------------------------------------------------
-int SliceExtract::AddDataRequirement(const std::string &meshName,
-  int association, const std::vector<std::string> &arrays)
-{
-  this->Internals->Requirements.AddRequirement(meshName, association, arrays);
-  return 0;
-}
+    // write or publish it
+    std::string sliceMeshName  = meshName + "_slice";
+    long timeStep = dataAdaptor->GetDataTimeStep();
+    double time = dataAdaptor->GetDataTime();
+    if (this->WriteExtract(timeStep, time, sliceMeshName, sliceMesh))
+      {
+      SENSEI_ERROR("Failed to write the extract")
+      return false;
+      }
 
-// --------------------------------------------------------------------------
-bool SliceExtract::Execute(DataAdaptor* dataAdaptor)
-{
-  TimeEvent<128> mark("SliceExtract::Execute");
-  if (this->Internals->Operation == OP_PLANAR_SLICE)
-    {
-    return this->ExecuteSlice(dataAdaptor);
-    }
-  else if (this->Internals->Operation == OP_ISO_SURFACE)
-    {
-    return this->ExecuteIsoSurface(dataAdaptor);
+    sliceMesh->Delete();
+
+    ++mit;
     }
 
-  SENSEI_ERROR("Invalid operation " << this->Internals->Operation)
-  return false;
+  dataAdaptor->ReleaseData();
+
+  return true;
 }
 
 // --------------------------------------------------------------------------
-bool SliceExtract::ExecuteIsoSurface(DataAdaptor* dataAdaptor)
+bool SliceExtract::ExecuteSliceAndIsoSurface(DataAdaptor* dataAdaptor)
 {
-  TimeEvent<128> mark("SliceExtract::ExecuteIsoSurface");
+  TimeEvent<128> mark("SliceExtract::ExecuteSliceAndIsoSurface");
+
+  // the images are sampled from the blocks rather than the slices
+  if (this->Internals->RasterFormat != RASTER_NONE)
+    return this->ExecuteRaster(dataAdaptor) &&
+      this->ExecuteIsoSurface(dataAdaptor);
 
   // get the mesh array and iso values
-  std::string meshName;
-  std::string arrayName;
-  int arrayCentering = vtkDataObject::POINT;
+  std::string isoMeshName;
+  std::string isoArrayName;
+  int isoArrayCen = vtkDataObject::POINT;
   std::vector<double> isoVals;
 
-  if (this->Internals->IsoValPartitioner->GetIsoValues(meshName,
-    arrayName, arrayCentering, isoVals))
+  if (this->Internals->IsoValPartitioner->GetIsoValues(isoMeshName,
+    isoArrayName, isoArrayCen, isoVals))
     {
     SENSEI_ERROR("Iso-values have not been provided")
     return false;
     }
 
-  // if we are runnigng in transit, set the partitioner that will pull
-  // only the blocks that intersect the slice plane
-  InTransitDataAdaptor *itDataAdaptor =
-    dynamic_cast<InTransitDataAdaptor*>(dataAdaptor);
+  std::vector<std::array<double,3>> points, normals;
+  this->Internals->SlicePartitioner->GetPlanes(points, normals);
 
-  if (this->Internals->EnablePartitioner && itDataAdaptor)
-    itDataAdaptor->SetPartitioner(this->Internals->IsoValPartitioner);
+  // the partitioners each select only the blocks needed for one operation,
+  // in transit all blocks are kept. in situ the blocks needed by either
+  // operation are constructed
+  bool subset = !dynamic_cast<InTransitDataAdaptor*>(dataAdaptor);
 
   // figure out what the simulation can provide
   MeshMetadataFlags flags;
   flags.SetBlockDecomp();
   flags.SetBlockArrayRange();
+  if (subset)
+    flags.SetBlockBounds();
 
   MeshMetadataMap mdm;
   if (mdm.Initialize(dataAdaptor, flags))
@@ -248,67 +1241,133 @@ bool SliceExtract::ExecuteIsoSurface(DataAdaptor* dataAdaptor)
     return false;
     }
 
-  // get metadata
-  MeshMetadataPtr md;
-  if (mdm.GetMeshMetadata(meshName, md))
-    {
-    SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
-    return false;
-    }
+  // the meshes to slice and the mesh to contour are each fetched once
+  std::set<std::string> sliceMeshNames;
+  MeshRequirementsIterator mit =
+    this->Internals->Requirements.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    sliceMeshNames.insert(mit.MeshName());
 
-  // get the mesh
-  vtkCompositeDataSet *dobj = nullptr;
-  if (dataAdaptor->GetMesh(meshName, false, dobj))
-    {
-    SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
-    return false;
-    }
+  std::set<std::string> meshNames(sliceMeshNames);
+  meshNames.insert(isoMeshName);
 
-  // add the ghost cell arrays to the mesh
-  if ((md->NumGhostCells || VTKUtils::AMR(md)) &&
-    dataAdaptor->AddGhostCellsArray(dobj, meshName))
-    {
-    SENSEI_ERROR("Failed to get ghost cells for mesh \"" << meshName << "\"")
-    return false;
-    }
+  long timeStep = dataAdaptor->GetDataTimeStep();
+  double time = dataAdaptor->GetDataTime();
 
-  // add the ghost node arrays to the mesh
-  if (md->NumGhostNodes && dataAdaptor->AddGhostNodesArray(dobj, meshName))
-    {
-    SENSEI_ERROR("Failed to get ghost nodes for mesh \"" << meshName << "\"")
-    return false;
-    }
+  BlockStream stream;
+  stream.SetCommunicator(this->GetCommunicator());
+  stream.SetBatchSize(this->Internals->BatchSize);
 
-  // add the required arrays
-  if (dataAdaptor->AddArray(dobj, meshName, arrayCentering, arrayName))
+  for (const std::string &meshName : meshNames)
     {
-    SENSEI_ERROR("Failed to add "
-      << VTKUtils::GetAttributesName(arrayCentering)
-      << " data array \"" <<arrayName << "\" to mesh \""
-      << meshName << "\"")
-    return false;
-    }
+    bool slice = sliceMeshNames.count(meshName);
+    bool iso = meshName == isoMeshName;
 
-  // compute the iso-surfaces
-  vtkCompositeDataSet *isoMesh = nullptr;
-  if (this->IsoSurface(dobj, arrayName, arrayCentering, isoVals, isoMesh))
-    {
-    SENSEI_ERROR("Failed to extract slice")
-    return false;
-    }
+    // get metadata
+    MeshMetadataPtr md;
+    if (mdm.GetMeshMetadata(meshName, md))
+      {
+      SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
+      return false;
+      }
 
-  // write it to disk
-  std::string isoMeshName  = meshName + "_" + arrayName + "_isos";
-  long timeStep = dataAdaptor->GetDataTimeStep();
-  double time = dataAdaptor->GetDataTime();
-  if (this->WriteExtract(timeStep, time, isoMeshName, isoMesh))
-    {
-    SENSEI_ERROR("Failed to write the extract")
-    return false;
-    }
+    // in situ the blocks needed by either operation are constructed
+    std::vector<int> blockIds;
+    if (subset && !VTKUtils::AMR(md))
+      {
+      std::vector<int> sliceIds;
+      std::vector<int> isoIds;
+      if ((slice && GetActiveBlockIds(*this->Internals->SlicePartitioner,
+        md, sliceIds)) || (iso && GetActiveBlockIds(
+        *this->Internals->IsoValPartitioner, md, isoIds)))
+        {
+        SENSEI_ERROR("Failed to select the blocks of mesh \"" << meshName << "\"")
+        return false;
+        }
 
-  isoMesh->Delete();
-  dobj->Delete();
+      std::sort(sliceIds.begin(), sliceIds.end());
+      std::sort(isoIds.begin(), isoIds.end());
+      std::set_union(sliceIds.begin(), sliceIds.end(), isoIds.begin(),
+        isoIds.end(), std::back_inserter(blockIds));
+      }
+
+    // the required arrays
+    BlockStream::ArrayMap arrays;
+    if (slice)
+      {
+      ArrayRequirementsIterator ait =
+        this->Internals->Requirements.GetArrayRequirementsIterator(meshName);
+
+      for (; ait; ++ait)
+        arrays[ait.Association()].push_back(ait.Array());
+      }
+
+    if (iso)
+      {
+      std::vector<std::string> &isoArrays = arrays[isoArrayCen];
+      if (std::find(isoArrays.begin(), isoArrays.end(), isoArrayName) == isoArrays.end())
+        isoArrays.push_back(isoArrayName);
+      }
+
+    // compute the slices and iso-surfaces in one pass over the blocks
+    BlockRangeMap blockRanges;
+    if (iso)
+      GetBlockRanges(md, isoArrayName, isoArrayCen, blockRanges);
+
+    vtkCompositeDataSet *sliceMesh = nullptr;
+    vtkCompositeDataSet *isoMesh = nullptr;
+    BlockStream::Visitor extract = [&](vtkCompositeDataSet *batch) -> int
+      {
+      vtkCompositeDataSet *batchSlice = nullptr;
+      vtkCompositeDataSet *batchIso = nullptr;
+      if (this->Extract(batch, slice ? points : std::vector<std::array<double,3>>(),
+        normals, isoArrayName, isoArrayCen, iso ? isoVals : std::vector<double>(),
+        blockRanges, batchSlice, batchIso))
+        return -1;
+
+      AppendBlocks(batchSlice, sliceMesh);
+      AppendBlocks(batchIso, isoMesh);
+      return 0;
+      };
+
+    if ((subset && !VTKUtils::AMR(md)) ?
+      stream.Visit(dataAdaptor, md, false, blockIds, arrays, extract) :
+      stream.Visit(dataAdaptor, md, false, arrays, extract))
+      {
+      SENSEI_ERROR("Failed to extract slices and iso-surfaces")
+      if (sliceMesh)
+        sliceMesh->Delete();
+      if (isoMesh)
+        isoMesh->Delete();
+      return false;
+      }
+
+    if (slice && !sliceMesh)
+      sliceMesh = NewEmptyExtract(md);
+
+    if (iso && !isoMesh)
+      isoMesh = NewEmptyExtract(md);
+
+    // write or publish them
+    if (sliceMesh && this->WriteExtract(timeStep, time, meshName + "_slice", sliceMesh))
+      {
+      SENSEI_ERROR("Failed to write the slice extract")
+      return false;
+      }
+
+    if (isoMesh && this->WriteExtract(timeStep, time,
+      meshName + "_" + isoArrayName + "_isos", isoMesh))
+      {
+      SENSEI_ERROR("Failed to write the iso-surface extract")
+      return false;
+      }
+
+    if (sliceMesh)
+      sliceMesh->Delete();
+
+    if (isoMesh)
+      isoMesh->Delete();
+    }
 
   dataAdaptor->ReleaseData();
 
@@ -316,9 +1375,9 @@ bool SliceExtract::ExecuteIsoSurface(DataAdaptor* dataAdaptor)
 }
 
 // --------------------------------------------------------------------------
-bool SliceExtract::ExecuteSlice(DataAdaptor* dataAdaptor)
+bool SliceExtract::ExecuteRaster(DataAdaptor* dataAdaptor)
 {
-  TimeEvent<128> mark("SliceExtract::ExecuteSlice");
+  TimeEvent<128> mark("SliceExtract::ExecuteRaster");
 
   // require the user to tell us one or more meshes to slice
   if (this->Internals->Requirements.Empty())
@@ -327,17 +1386,36 @@ bool SliceExtract::ExecuteSlice(DataAdaptor* dataAdaptor)
     return false;
     }
 
+  // the planes must be normal to an axis
+  std::vector<std::array<double,3>> points, normals;
+  this->Internals->SlicePartitioner->GetPlanes(points, normals);
+
+  size_t nPlanes = std::min(points.size(), normals.size());
+  std::vector<int> axes(nPlanes);
+  for (size_t i = 0; i < nPlanes; ++i)
+    {
+    if ((axes[i] = GetNormalAxis(normals[i])) < 0)
+      {
+      SENSEI_ERROR("Raster output requires planes normal to an axis, plane "
+        << i << " has normal " << normals[i][0] << ", " << normals[i][1]
+        << ", " << normals[i][2])
+      return false;
+      }
+    }
+
   // if we are runnigng in transit, set the partitioner that will pull
   // only the blocks that intersect the slice plane
   InTransitDataAdaptor *itDataAdaptor =
     dynamic_cast<InTransitDataAdaptor*>(dataAdaptor);
 
-  if (this->Internals->EnablePartitioner && itDataAdaptor)
+  bool repartition = this->Internals->EnablePartitioner && itDataAdaptor;
+  if (repartition)
     itDataAdaptor->SetPartitioner(this->Internals->SlicePartitioner);
 
-  // figure out what the simulation can provide
   MeshMetadataFlags flags;
   flags.SetBlockDecomp();
+  if (!repartition)
+    flags.SetBlockBounds();
 
   MeshMetadataMap mdm;
   if (mdm.Initialize(dataAdaptor, flags))
@@ -346,15 +1424,20 @@ bool SliceExtract::ExecuteSlice(DataAdaptor* dataAdaptor)
     return false;
     }
 
-  // loop over requested meshes, pull the arrays, take slice,
-  // and finally write the result
+  BlockStream stream;
+  stream.SetCommunicator(this->GetCommunicator());
+  stream.SetBatchSize(this->Internals->BatchSize);
+
+  long timeStep = dataAdaptor->GetDataTimeStep();
+  double time = dataAdaptor->GetDataTime();
+
   MeshRequirementsIterator mit =
     this->Internals->Requirements.GetMeshRequirementsIterator();
 
-  while (mit)
+  for (; mit; ++mit)
     {
     const std::string &meshName = mit.MeshName();
-    // get metadata
+
     MeshMetadataPtr md;
     if (mdm.GetMeshMetadata(meshName, md))
       {
@@ -362,71 +1445,63 @@ bool SliceExtract::ExecuteSlice(DataAdaptor* dataAdaptor)
       return false;
       }
 
-    // get the mesh
-    vtkCompositeDataSet *dobj = nullptr;
-    if (dataAdaptor->GetMesh(meshName, mit.StructureOnly(), dobj))
+    if (VTKUtils::AMR(md))
       {
-      SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+      SENSEI_ERROR("Raster output is not supported for the AMR mesh \""
+        << meshName << "\"")
       return false;
       }
 
-    // add the ghost cell arrays to the mesh
-    if (md->NumGhostCells && dataAdaptor->AddGhostCellsArray(dobj, meshName))
+    // in situ, only the blocks intersecting the planes are constructed
+    std::vector<int> blockIds;
+    if (!repartition &&
+      GetActiveBlockIds(*this->Internals->SlicePartitioner, md, blockIds))
       {
-      SENSEI_ERROR("Failed to get ghost cells for mesh \"" << meshName << "\"")
+      SENSEI_ERROR("Failed to select the blocks of mesh \"" << meshName << "\"")
       return false;
       }
 
-    // add the ghost node arrays to the mesh
-    if (md->NumGhostNodes && dataAdaptor->AddGhostNodesArray(dobj, meshName))
-      {
-      SENSEI_ERROR("Failed to get ghost nodes for mesh \"" << meshName << "\"")
-      return false;
-      }
+    // an image per plane and required array
+    BlockStream::ArrayMap arrays;
+    std::vector<RasterImage> images;
 
-    // add the required arrays
     ArrayRequirementsIterator ait =
       this->Internals->Requirements.GetArrayRequirementsIterator(meshName);
 
-    while (ait)
+    for (; ait; ++ait)
       {
-      if (dataAdaptor->AddArray(dobj, meshName,
-         ait.Association(), ait.Array()))
-        {
-        SENSEI_ERROR("Failed to add "
-          << VTKUtils::GetAttributesName(ait.Association())
-          << " data array \"" << ait.Array() << "\" to mesh \""
-          << meshName << "\"")
-        return false;
-        }
-      ++ait;
+      arrays[ait.Association()].push_back(ait.Array());
+      for (size_t i = 0; i < nPlanes; ++i)
+        images.emplace_back(i, axes[i], points[i][axes[i]],
+          ait.Association(), ait.Array());
       }
 
-    // compute the slice
-    vtkCompositeDataSet *sliceMesh = nullptr;
-    std::array<double,3> point, normal;
-    this->Internals->SlicePartitioner->GetPoint(point);
-    this->Internals->SlicePartitioner->GetNormal(normal);
-    if (this->Slice(dobj, point, normal, sliceMesh))
+    if (images.empty())
       {
-      SENSEI_ERROR("Failed to extract slice")
+      SENSEI_ERROR("Raster output of mesh \"" << meshName
+        << "\" requires arrays and planes")
       return false;
       }
 
-    // write it to disk
-    std::string sliceMeshName  = meshName + "_slice";
-    long timeStep = dataAdaptor->GetDataTimeStep();
-    double time = dataAdaptor->GetDataTime();
-    if (this->WriteExtract(timeStep, time, sliceMeshName, sliceMesh))
+    BlockStream::Visitor rasterize = [&](vtkCompositeDataSet *batch) -> int
       {
-      SENSEI_ERROR("Failed to write the extract")
+      return RasterizeBlocks(batch, images);
+      };
+
+    if (repartition ?
+      stream.Visit(dataAdaptor, md, false, arrays, rasterize) :
+      stream.Visit(dataAdaptor, md, false, blockIds, arrays, rasterize))
+      {
+      SENSEI_ERROR("Failed to sample mesh \"" << meshName << "\"")
       return false;
       }
 
-    sliceMesh->Delete();
-    dobj->Delete();
-
-    ++mit;
+    if (WriteImages(this->GetCommunicator(), this->Internals->RasterFormat,
+      this->Internals->OutputDir, meshName + "_slice", timeStep, time, images))
+      {
+      SENSEI_ERROR("Failed to write the images of mesh \"" << meshName << "\"")
+      return false;
+      }
     }
 
   dataAdaptor->ReleaseData();
@@ -437,33 +1512,50 @@ bool SliceExtract::ExecuteSlice(DataAdaptor* dataAdaptor)
 // --------------------------------------------------------------------------
 int SliceExtract::IsoSurface(vtkCompositeDataSet *input,
   const std::string &arrayName, int arrayCen, const std::vector<double> &vals,
-  vtkCompositeDataSet *&output)
+  const BlockRangeMap &blockRanges, vtkCompositeDataSet *&output)
 {
   TimeEvent<128> mark("SliceExtract::IsoSurface");
-  // build pipeline
-  vtkContourFilterPtr contour = vtkContourFilterPtr::New();
-  contour->SetComputeScalars(1);
 
-  contour->SetInputArrayToProcess(0, 0, 0,
-    vtkDataObject::FIELD_ASSOCIATION_POINTS, arrayName.c_str());
+  vtkCompositeDataSet *sliceOutput = nullptr;
 
-  unsigned int nVals = vals.size();
-  contour->SetNumberOfContours(nVals);
-  for (unsigned int i = 0; i < nVals; ++i)
-    contour->SetValue(i, vals[i]);
+  return this->Extract(input, std::vector<std::array<double,3>>(),
+    std::vector<std::array<double,3>>(), arrayName, arrayCen, vals,
+    blockRanges, sliceOutput, output);
+}
 
-  // when processing cell data first convert to point data
-  vtkCellDataToPointDataPtr cdpd;
-  if (arrayCen == vtkDataObject::CELL)
-    {
-    cdpd = vtkCellDataToPointDataPtr::New();
-    cdpd->SetPassCellData(1);
-    /* in newer VTK one can select specific arrays to convert
-     * it is important not to convert vtkGhostType.
-    cdpd->SetProcessAllArrays(0);
-    cdpd->AddCellDataArray(arrayName.c_str());*/
-    contour->SetInputConnection(cdpd->GetOutputPort());
-    }
+// --------------------------------------------------------------------------
+int SliceExtract::Slice(vtkCompositeDataSet *input,
+  const std::vector<std::array<double,3>> &points,
+  const std::vector<std::array<double,3>> &normals,
+  vtkCompositeDataSet *&output)
+{
+  TimeEvent<128> mark("SliceExtract::Slice");
+
+  vtkCompositeDataSet *isoOutput = nullptr;
+
+  return this->Extract(input, points, normals, "", vtkDataObject::POINT,
+    std::vector<double>(), BlockRangeMap(), output, isoOutput);
+}
+
+// --------------------------------------------------------------------------
+int SliceExtract::Extract(vtkCompositeDataSet *input,
+  const std::vector<std::array<double,3>> &points,
+  const std::vector<std::array<double,3>> &normals,
+  const std::string &arrayName, int arrayCen, const std::vector<double> &vals,
+  const BlockRangeMap &blockRanges, vtkCompositeDataSet *&sliceOutput,
+  vtkCompositeDataSet *&isoOutput)
+{
+  TimeEvent<128> mark("SliceExtract::Extract");
+
+  sliceOutput = nullptr;
+  isoOutput = nullptr;
+
+  // group the planes, one pass per distinct normal
+  std::vector<PlaneGroup> groups;
+  GroupPlanes(points, normals, groups);
+
+  unsigned int nGroups = groups.size();
+  unsigned int nVals = vals.size();
 
   // allocate output
   vtkCompositeDataIterator *it = input->NewIterator();
@@ -473,16 +1565,15 @@ int SliceExtract::IsoSurface(vtkCompositeDataSet *input,
   for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
     ++nBlocks;
 
-  vtkMultiBlockDataSet *mbds = vtkMultiBlockDataSet::New();
-  mbds->SetNumberOfBlocks(nBlocks);
-
   // VTK's iterators for AMR datasets behave differently than for multiblock
   // datasets.  we are going to have to handle AMR data as a special case for
   // now.
   vtkUniformGridAMRDataIterator *amrIt = dynamic_cast<vtkUniformGridAMRDataIterator*>(it);
   vtkOverlappingAMR *amrMesh = dynamic_cast<vtkOverlappingAMR*>(input);
 
-  // process data
+  // collect the blocks
+  std::vector<long> bids;
+  std::vector<vtkDataObject*> blocks;
   it->SetSkipEmptyNodes(1);
   for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
     {
@@ -501,76 +1592,193 @@ int SliceExtract::IsoSurface(vtkCompositeDataSet *input,
       bid = it->GetCurrentFlatIndex() - 1;
       }
 
-    vtkDataObject *dobjIn = it->GetCurrentDataObject();
-
-    // run the pipeline on the block
-    if (arrayCen == vtkDataObject::CELL)
-      cdpd->SetInputData(dobjIn);
-    else
-      contour->SetInputData(dobjIn);
-    contour->SetOutput(nullptr);
-    contour->Update();
-
-    // save the extract
-    vtkDataObject *dobjOut = contour->GetOutput();
-    mbds->SetBlock(bid, dobjOut);
+    bids.push_back(bid);
+    blocks.push_back(it->GetCurrentDataObject());
     }
 
   it->Delete();
 
-  output = mbds;
+  long nLocal = blocks.size();
+  int nThreads = std::max(1, std::min<int>(this->Internals->NumThreads, nLocal));
 
-  return 0;
-}
+  // build the pipelines. VTK filters are not shared between threads, each
+  // thread gets its own
+  std::vector<std::vector<vtkCutterPtr>> slices(nThreads);
+  std::vector<vtkContourFilterPtr> contours(nThreads);
+  std::vector<vtkCellDataToPointDataPtr> cdpds(nThreads);
+  for (int t = 0; t < nThreads; ++t)
+    {
+    slices[t].resize(nGroups);
+    for (unsigned int i = 0; i < nGroups; ++i)
+      {
+      vtkPlanePtr plane = vtkPlanePtr::New();
+      plane->SetOrigin(groups[i].Origin.data());
+      plane->SetNormal(groups[i].Normal.data());
 
-// --------------------------------------------------------------------------
-int SliceExtract::Slice(vtkCompositeDataSet *input,
-  const std::array<double,3> &point, const std::array<double,3> &normal,
-  vtkCompositeDataSet *&output)
-{
-  TimeEvent<128> mark("SliceExtract::Slice");
+      vtkCutterPtr slice = vtkCutterPtr::New();
+      slice->SetCutFunction(plane.GetPointer());
 
-  // build pipeline
-  vtkCutterPtr slice = vtkCutterPtr::New();
+      unsigned int nOffsets = groups[i].Offsets.size();
+      slice->SetNumberOfContours(nOffsets);
+      for (unsigned int j = 0; j < nOffsets; ++j)
+        slice->SetValue(j, groups[i].Offsets[j]);
 
-  vtkPlanePtr plane = vtkPlanePtr::New();
-  plane->SetOrigin(const_cast<double*>(point.data()));
-  plane->SetNormal(const_cast<double*>(normal.data()));
+      slices[t][i] = slice;
+      }
 
-  slice->SetCutFunction(plane.GetPointer());
+    if (nVals)
+      {
+      vtkContourFilterPtr contour = vtkContourFilterPtr::New();
+      contour->SetComputeScalars(1);
 
-  // allocate output
-  vtkCompositeDataIterator *it = input->NewIterator();
-  it->SetSkipEmptyNodes(0);
+      contour->SetInputArrayToProcess(0, 0, 0,
+        vtkDataObject::FIELD_ASSOCIATION_POINTS, arrayName.c_str());
 
-  unsigned int nBlocks = 0;
-  for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
-    ++nBlocks;
+      contour->SetNumberOfContours(nVals);
+      for (unsigned int i = 0; i < nVals; ++i)
+        contour->SetValue(i, vals[i]);
 
-  vtkMultiBlockDataSet *mbds = vtkMultiBlockDataSet::New();
-  mbds->SetNumberOfBlocks(nBlocks);
+      // when processing cell data first convert to point data
+      if (arrayCen == vtkDataObject::CELL)
+        {
+        vtkCellDataToPointDataPtr cdpd = vtkCellDataToPointDataPtr::New();
+        cdpd->SetPassCellData(1);
+        /* in newer VTK one can select specific arrays to convert
+         * it is important not to convert vtkGhostType.
+        cdpd->SetProcessAllArrays(0);
+        cdpd->AddCellDataArray(arrayName.c_str());*/
+        contour->SetInputConnection(cdpd->GetOutputPort());
+        cdpds[t] = cdpd;
+        }
 
-  // process data
-  it->SetSkipEmptyNodes(1);
-  for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+      contours[t] = contour;
+      }
+    }
+
+  // process data. each block is visited once for all operations, the
+  // bounds and array range classify which operations produce output.
+  // results are placed by block and collected after the threads finish
+  std::vector<vtkSmartPointer<vtkDataObject>> sliceOut(nGroups ? nLocal : 0);
+  std::vector<vtkSmartPointer<vtkDataObject>> isoOut(nVals ? nLocal : 0);
+
+  VTKUtils::ParallelFunction process = [&](int thread, long bi) -> int
     {
-    // get the current block
-    unsigned int bid = it->GetCurrentFlatIndex() - 1;
-    vtkDataObject *dobjIn = it->GetCurrentDataObject();
+    vtkDataObject *dobjIn = blocks[bi];
+    vtkDataSet *dsIn = dynamic_cast<vtkDataSet*>(dobjIn);
+
+    if (nGroups)
+      {
+      double bounds[6] = {0.0, -1.0, 0.0, -1.0, 0.0, -1.0};
+      if (dsIn)
+        dsIn->GetBounds(bounds);
+
+      vtkAppendPolyDataPtr append;
+      vtkDataObject *dobjOut = nullptr;
+      for (unsigned int i = 0; i < nGroups; ++i)
+        {
+        if (dsIn && !IntersectsBox(groups[i], bounds))
+          continue;
+
+        // set up and run the pipeline
+        vtkCutter *slice = slices[thread][i];
+        slice->SetInputData(dobjIn);
+        slice->SetOutput(nullptr);
+        slice->Update();
+
+        if (!dobjOut)
+          {
+          dobjOut = slice->GetOutput();
+          continue;
+          }
+
+        // planes with different normals are merged into one extract
+        if (!append)
+          {
+          append = vtkAppendPolyDataPtr::New();
+          append->AddInputData(vtkPolyData::SafeDownCast(dobjOut));
+          }
+        append->AddInputData(slice->GetOutput());
+        }
+
+      if (append)
+        {
+        append->Update();
+        dobjOut = append->GetOutput();
+        }
+
+      // save the extract
+      if (dobjOut)
+        sliceOut[bi] = dobjOut;
+      else
+        sliceOut[bi] = vtkPolyDataPtr::New();
+      }
+
+    if (nVals)
+      {
+      // use the range from the metadata when the simulation provided it,
+      // otherwise compute it from the block's array
+      bool inRange = true;
+      BlockRangeMap::const_iterator rit = blockRanges.find(bids[bi]);
+      if (rit != blockRanges.end())
+        {
+        inRange = InRange(rit->second.data(), vals);
+        }
+      else if (dsIn)
+        {
+        vtkDataArray *array = arrayCen == vtkDataObject::CELL ?
+          dsIn->GetCellData()->GetArray(arrayName.c_str()) :
+          dsIn->GetPointData()->GetArray(arrayName.c_str());
+
+        inRange = InRange(array, vals);
+        }
+
+      if (!inRange)
+        {
+        // no iso-value in the block's range
+        isoOut[bi] = vtkPolyDataPtr::New();
+        return 0;
+        }
 
-    // set up and run the pipeline
-    slice->SetInputData(dobjIn);
-    slice->SetOutput(nullptr);
-    slice->Update();
+      // run the pipeline on the block
+      vtkContourFilter *contour = contours[thread];
+      if (arrayCen == vtkDataObject::CELL)
+        cdpds[thread]->SetInputData(dobjIn);
+      else
+        contour->SetInputData(dobjIn);
+      contour->SetOutput(nullptr);
+      contour->Update();
+
+      // save the extract
+      isoOut[bi] = contour->GetOutput();
+      }
+
+    return 0;
+    };
 
-    // save the extract
-    vtkDataObject *dobjOut = slice->GetOutput();
-    mbds->SetBlock(bid, dobjOut);
+  if (VTKUtils::ParallelFor(nLocal, nThreads, process) < 0)
+    {
+    SENSEI_ERROR("Failed to process the blocks")
+    return -1;
     }
 
-  it->Delete();
+  // collect the results
+  if (nGroups)
+    {
+    vtkMultiBlockDataSet *mbds = vtkMultiBlockDataSet::New();
+    mbds->SetNumberOfBlocks(nBlocks);
+    for (long i = 0; i < nLocal; ++i)
+      mbds->SetBlock(bids[i], sliceOut[i]);
+    sliceOutput = mbds;
+    }
 
-  output = mbds;
+  if (nVals)
+    {
+    vtkMultiBlockDataSet *mbds = vtkMultiBlockDataSet::New();
+    mbds->SetNumberOfBlocks(nBlocks);
+    for (long i = 0; i < nLocal; ++i)
+      mbds->SetBlock(bids[i], isoOut[i]);
+    isoOutput = mbds;
+    }
 
   return 0;
 }
@@ -581,6 +1789,26 @@ int SliceExtract::WriteExtract(long timeStep, double time,
 {
   TimeEvent<128> mark("SliceExtract::WriteExtract");
 
+  // reduce the extract before it is published and written
+  vtkSmartPointer<vtkCompositeDataSet> reduced;
+  if (this->Internals->Reducer.Enabled())
+    {
+    vtkCompositeDataSet *output = nullptr;
+    if (this->Internals->Reducer.Execute(this->GetCommunicator(), input, output))
+      {
+      SENSEI_ERROR("Failed to reduce the extract \"" << mesh << "\"")
+      return -1;
+      }
+    reduced.TakeReference(output);
+    input = output;
+    }
+
+  if (this->Internals->Published)
+    this->Internals->Published->SetPartialResult(mesh, input);
+
+  if (!this->Internals->Write)
+    return 0;
+
   VTKDataAdaptor *dataAdaptor = VTKDataAdaptor::New();
 
   dataAdaptor->SetDataObject(mesh, input);
@@ -603,7 +1831,7 @@ int SliceExtract::WriteExtract(long timeStep, double time,
 int SliceExtract::Finalize()
 {
   TimeEvent<128> mark("SliceExtract::Finalize");
-  if (this->Internals->Writer->Finalize())
+  if (this->Internals->Write && this->Internals->Writer->Finalize())
     {
     SENSEI_ERROR("Failed to finalize the writer")
     return -1;
@@ -6,17 +6,21 @@
 #include <vector>
 #include <array>
 #include <string>
+#include <map>
 
 
 class vtkCompositeDataSet;
 namespace pugi { class xml_node; }
-namespace sensei { class DataRequirements; }
+namespace sensei { class DataRequirements; class PolyDataReducer; }
 
 namespace sensei
 {
 
 /// @class SliceExtract
-/// Extract a slice defined by a point and a normal and writes it to disk
+/// Extract slices defined by points and normals, or iso-surfaces, and writes
+/// them to disk. Both may be extracted in one pass over the blocks. The
+/// extracts may instead, or also, be published as meshes for the analyses
+/// and transports that run after this one, see SetPublish.
 class SliceExtract : public AnalysisAdaptor
 {
 public:
@@ -27,13 +31,23 @@ public:
   // enable use of optimized partitioner
   void EnablePartitioner(int val);
 
+  // set the number of blocks fetched from the simulation at a time. a
+  // value less than 1, the default, fetches all of the needed blocks at
+  // once. see BlockStream.
+  void SetBatchSize(int val);
+
+  // set the number of threads processing the blocks of a rank. each thread
+  // runs its own VTK pipelines. the default is 1
+  void SetNumberOfThreads(int val);
+
   // set which operation will be used. Valid values are OP_ISO_SURFACE=0,
-  // OP_PLANAR_SLICE=1
-  enum {OP_ISO_SURFACE=0, OP_PLANAR_SLICE=1};
+  // OP_PLANAR_SLICE=1, OP_SLICE_AND_ISO_SURFACE=2. the latter fetches each
+  // mesh once and extracts the slices and iso-surfaces in one pass
+  enum {OP_ISO_SURFACE=0, OP_PLANAR_SLICE=1, OP_SLICE_AND_ISO_SURFACE=2};
   int SetOperation(int op);
 
   // set which operation will be used. Valid values are "planar_slice",
-  // "iso_surface"
+  // "iso_surface", "slice_and_iso_surface"
   int SetOperation(std::string op);
 
   // set the values to compute iso-surfaces for. if these aren't set the
@@ -53,11 +67,54 @@ public:
   int SetPoint(const std::array<double,3> &point);
   int SetNormal(const std::array<double,3> &normal);
 
+  // set the points and normals of any number of slice planes. planes that
+  // share a normal are extracted in a single pass.
+  int SetPlanes(const std::vector<std::array<double,3>> &points,
+    const std::vector<std::array<double,3>> &normals);
+
+  // when set, the extracts are published to the PartialResultsDataAdaptor
+  // the analysis is executed on, as meshes named as they are written, see
+  // GetExtractMeshNames. The analyses and transports that run after this
+  // one in the same step then process them in place of the full mesh, for
+  // instance to ship only a slice in transit. The extracts are passed by
+  // reference, not copied. This does not apply to the images written in
+  // raster mode. The default is not set
+  void SetPublish(int val);
+
+  // when not set, the extracts are not written to disk. The default is set
+  void SetWrite(int val);
+
+  // set how the extracts are reduced, merging points, decimating and
+  // quantizing, before they are written and published. see
+  // PolyDataReducer. The default does not reduce them
+  void SetReducer(const PolyDataReducer &reducer);
+
+  // get the names of the meshes the extracts are written and published as,
+  // <mesh>_slice for the slices and <mesh>_<array>_isos for the iso-surfaces
+  void GetExtractMeshNames(std::vector<std::string> &names);
+
   // set writer parameters
   int SetWriterOutputDir(const std::string &outputDir);
   int SetWriterMode(const std::string &mode);
   int SetWriterWriter(const std::string &writer);
 
+  // write the slices as images rather than polydata. Valid values are
+  // "raw", "png", "hdf5", or "" for polydata, the default. Each plane must
+  // be normal to an axis and the mesh made of vtkImageData or
+  // vtkRectilinearGrid blocks, whose extents give the global i,j,k index
+  // of their points. The required arrays are sampled on the layer of
+  // points, or cells, nearest the plane, the pixels are gathered to rank
+  // 0 and one image per plane, array and step is written to the output
+  // directory as <mesh>_slice_<array>_<plane>_<step>. raw files hold
+  // float32 values, i fastest, NaN where no block covered the pixel, and
+  // have the image size appended to their name. png files are 16 bit
+  // grayscale scaled to the image's range. hdf5 files hold a 2D float32
+  // dataset named by the array with the extent, the axis and the position
+  // as attributes. Multi-component arrays are written as their magnitude.
+  // With OP_SLICE_AND_ISO_SURFACE the images and the iso-surfaces are
+  // extracted in separate passes
+  int SetRasterFormat(const std::string &format);
+
   // data requirements tell the adaptor what mesh/arrays
   // to process
   int SetDataRequirements(const DataRequirements &reqs);
@@ -71,20 +128,41 @@ public:
   int Finalize() override;
 
 private:
+    // the range of the iso-surface array on each block, by block id
+    using BlockRangeMap = std::map<long, std::array<double,2>>;
 
     bool ExecuteSlice(DataAdaptor* dataAdaptor);
     bool ExecuteIsoSurface(DataAdaptor* dataAdaptor);
+    bool ExecuteSliceAndIsoSurface(DataAdaptor* dataAdaptor);
 
-    int Slice(vtkCompositeDataSet *input, const std::array<double,3> &point,
-      const std::array<double,3> &normal, vtkCompositeDataSet *&output);
+    int Slice(vtkCompositeDataSet *input,
+      const std::vector<std::array<double,3>> &points,
+      const std::vector<std::array<double,3>> &normals,
+      vtkCompositeDataSet *&output);
 
     int IsoSurface(vtkCompositeDataSet *input,
       const std::string &arrayName, int arrayCen,
-      const std::vector<double> &vals, vtkCompositeDataSet *&output);
+      const std::vector<double> &vals, const BlockRangeMap &blockRanges,
+      vtkCompositeDataSet *&output);
+
+    // extract slices and iso-surfaces in one pass over the blocks. an
+    // output is nullptr when there are no planes or no iso-values. blocks
+    // found in blockRanges are culled by that range, the range of the
+    // others is computed from their data
+    int Extract(vtkCompositeDataSet *input,
+      const std::vector<std::array<double,3>> &points,
+      const std::vector<std::array<double,3>> &normals,
+      const std::string &arrayName, int arrayCen,
+      const std::vector<double> &vals, const BlockRangeMap &blockRanges,
+      vtkCompositeDataSet *&sliceOutput, vtkCompositeDataSet *&isoOutput);
 
     int WriteExtract(long timeStep, double time, const std::string &mesh,
       vtkCompositeDataSet *input);
 
+    // sample the required arrays of the required meshes on the planes and
+    // write them as images. see SetRasterFormat
+    bool ExecuteRaster(DataAdaptor* dataAdaptor);
+
 protected:
   SliceExtract();
   ~SliceExtract();
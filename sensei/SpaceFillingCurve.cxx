@@ -0,0 +1,105 @@
+#include "SpaceFillingCurve.h"
+
+namespace sensei
+{
+namespace SpaceFillingCurve
+{
+
+// --------------------------------------------------------------------------
+int GetCurve(const std::string &name, int &curve)
+{
+  if (name == "morton")
+    curve = MORTON;
+  else if (name == "hilbert")
+    curve = HILBERT;
+  else
+    return -1;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+const char *GetCurveName(int curve)
+{
+  return curve == HILBERT ? "hilbert" : "morton";
+}
+
+// --------------------------------------------------------------------------
+uint64_t MortonIndex(const uint32_t x[3], int bits)
+{
+  uint64_t h = 0;
+  for (int b = bits - 1; b >= 0; --b)
+    {
+    for (int i = 0; i < 3; ++i)
+      h = (h << 1) | ((x[i] >> b) & 1u);
+    }
+
+  return h;
+}
+
+// --------------------------------------------------------------------------
+uint64_t HilbertIndex(uint32_t x[3], int bits)
+{
+  const int n = 3;
+  uint32_t m = 1u << (bits - 1);
+
+  // inverse undo
+  for (uint32_t q = m; q > 1; q >>= 1)
+    {
+    uint32_t p = q - 1;
+    for (int i = 0; i < n; ++i)
+      {
+      if (x[i] & q)
+        {
+        x[0] ^= p;
+        }
+      else
+        {
+        uint32_t t = (x[0] ^ x[i]) & p;
+        x[0] ^= t;
+        x[i] ^= t;
+        }
+      }
+    }
+
+  // gray encode
+  for (int i = 1; i < n; ++i)
+    x[i] ^= x[i-1];
+
+  uint32_t t = 0;
+  for (uint32_t q = m; q > 1; q >>= 1)
+    {
+    if (x[n-1] & q)
+      t ^= q - 1;
+    }
+
+  for (int i = 0; i < n; ++i)
+    x[i] ^= t;
+
+  // interleave the transposed bits
+  return MortonIndex(x, bits);
+}
+
+// --------------------------------------------------------------------------
+uint64_t GetIndex(int curve, int bits, const double p[3],
+  const double lo[3], const double hi[3])
+{
+  uint32_t maxCoord = (1u << bits) - 1;
+
+  uint32_t x[3] = {0u, 0u, 0u};
+  for (int j = 0; j < 3; ++j)
+    {
+    double dx = hi[j] - lo[j];
+    if (dx > 0.0)
+      {
+      double s = (p[j] - lo[j])/dx;
+      s = s < 0.0 ? 0.0 : (s > 1.0 ? 1.0 : s);
+      x[j] = uint32_t(s*maxCoord);
+      }
+    }
+
+  return curve == HILBERT ? HilbertIndex(x, bits) : MortonIndex(x, bits);
+}
+
+}
+}
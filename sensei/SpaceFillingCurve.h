@@ -0,0 +1,45 @@
+#ifndef sensei_SpaceFillingCurve_h
+#define sensei_SpaceFillingCurve_h
+
+#include <cstdint>
+#include <string>
+
+namespace sensei
+{
+
+/// indices of points along the Morton (Z order) and Hilbert curves through
+/// a 3D grid of 2^bits points per axis. points near each other in space
+/// are mostly near each other on the curves, the Hilbert curve more so.
+/// used to order blocks and points for locality.
+namespace SpaceFillingCurve
+{
+enum {MORTON=0, HILBERT=1};
+
+/// the most bits per axis, their indices fit in 63 bits
+constexpr int MaxBits = 21;
+
+/// get a curve from its name, morton or hilbert. returns zero if
+/// successful
+int GetCurve(const std::string &name, int &curve);
+
+/// the name of a curve
+const char *GetCurveName(int curve);
+
+/// the index of the integer coordinates x on the Morton curve. each
+/// coordinate is less than 2^bits
+uint64_t MortonIndex(const uint32_t x[3], int bits);
+
+/// the index of the integer coordinates x on the Hilbert curve, computed
+/// by Skilling's transpose algorithm. each coordinate is less than 2^bits.
+/// x is overwritten
+uint64_t HilbertIndex(uint32_t x[3], int bits);
+
+/// the index of the point p of the box lo, hi on a curve. the box is
+/// divided in 2^bits cells per axis, axes with no extent map to 0
+uint64_t GetIndex(int curve, int bits, const double p[3],
+  const double lo[3], const double hi[3]);
+}
+
+}
+
+#endif
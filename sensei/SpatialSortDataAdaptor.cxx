@@ -0,0 +1,1071 @@
+#include "SpatialSortDataAdaptor.h"
+#include "SpaceFillingCurve.h"
+#include "DataRequirements.h"
+#include "ArrayDispatch.h"
+#include "TaskRuntime.h"
+#include "STLUtils.h"
+#include "VTKUtils.h"
+#include "XMLUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCellArray.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSet.h>
+#include <vtkFieldData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTypeInt64Array.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnsignedLongLongArray.h>
+#include <vtkUnstructuredGrid.h>
+
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using vtkDataObjectPtr = vtkSmartPointer<vtkDataObject>;
+using vtkDataArrayPtr = vtkSmartPointer<vtkDataArray>;
+
+namespace sensei
+{
+
+namespace
+{
+// bits per axis of the curve indices, 48 bit indices are exact in the
+// double precision array ranges
+constexpr int sortBits = 16;
+
+// --------------------------------------------------------------------------
+void getLeaves(vtkDataObject *mesh, std::vector<vtkDataSet*> &blocks)
+{
+  blocks.clear();
+
+  if (vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(mesh))
+    {
+    vtkSmartPointer<vtkCompositeDataIterator> cdit;
+    cdit.TakeReference(cd->NewIterator());
+    cdit->SetSkipEmptyNodes(0);
+
+    for (cdit->InitTraversal(); !cdit->IsDoneWithTraversal(); cdit->GoToNextItem())
+      {
+      if (vtkDataSet *ds = dynamic_cast<vtkDataSet*>(cd->GetDataSet(cdit)))
+        blocks.push_back(ds);
+      }
+    }
+  else if (vtkDataSet *ds = dynamic_cast<vtkDataSet*>(mesh))
+    {
+    blocks.push_back(ds);
+    }
+}
+
+// permute the tuples of an array to a new array of the same type. the
+// contiguous path is spread over the threads, the generic path goes
+// through vtkDataArray's tuple API which is not thread safe
+struct PermuteKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    int nc = this->In->GetNumberOfComponents();
+    long nIds = this->Ids->size();
+    const vtkIdType *ids = this->Ids->data();
+
+    if (!vals)
+      {
+      for (long i = 0; i < nIds; ++i)
+        for (int c = 0; c < nc; ++c)
+          this->Out->SetComponent(i, c, this->In->GetComponent(ids[i], c));
+      return;
+      }
+
+    T *out = static_cast<T*>(this->Out->GetVoidPointer(0));
+
+    const long chunk = 65536;
+    long nChunks = (nIds + chunk - 1) / chunk;
+
+    TaskRuntime::ParallelFor(nChunks, -1, [&](int, long q) -> int
+      {
+      long i1 = std::min(nIds, (q + 1)*chunk);
+      for (long i = q*chunk; i < i1; ++i)
+        {
+        const T *src = vals + ids[i]*nc;
+        T *dest = out + i*nc;
+        for (int c = 0; c < nc; ++c)
+          dest[c] = src[c];
+        }
+      return 0;
+      });
+  }
+
+  vtkDataArray *In;
+  const std::vector<vtkIdType> *Ids;
+  vtkDataArray *Out;
+};
+
+// --------------------------------------------------------------------------
+vtkDataArray *permute(vtkDataArray *in, const std::vector<vtkIdType> &ids)
+{
+  vtkDataArray *out = vtkDataArray::CreateDataArray(in->GetDataType());
+  out->SetName(in->GetName());
+  out->SetNumberOfComponents(in->GetNumberOfComponents());
+  out->SetNumberOfTuples(ids.size());
+
+  PermuteKernel kernel{in, &ids, out};
+  ArrayDispatch::Execute(in, kernel);
+
+  return out;
+}
+
+// sort the keys on the threads. runs of the keys are sorted in parallel
+// and merged pairwise, the runs of a level being merged in parallel
+using KeyType = std::pair<uint64_t, vtkIdType>;
+
+void sortKeys(std::vector<KeyType> &keys)
+{
+  long n = keys.size();
+  long nRuns = std::min(long(TaskRuntime::GetNumberOfThreads()),
+    (n + 65535) / 65536);
+
+  if (nRuns < 2)
+    {
+    std::sort(keys.begin(), keys.end());
+    return;
+    }
+
+  std::vector<long> start(nRuns + 1);
+  for (long r = 0; r <= nRuns; ++r)
+    start[r] = n*r/nRuns;
+
+  TaskRuntime::ParallelFor(nRuns, -1, [&](int, long r) -> int
+    {
+    std::sort(keys.begin() + start[r], keys.begin() + start[r+1]);
+    return 0;
+    });
+
+  for (long w = 1; w < nRuns; w *= 2)
+    {
+    long nPairs = (nRuns + 2*w - 1) / (2*w);
+    TaskRuntime::ParallelFor(nPairs, -1, [&](int, long p) -> int
+      {
+      long r0 = 2*w*p;
+      long r1 = std::min(nRuns, r0 + w);
+      long r2 = std::min(nRuns, r0 + 2*w);
+      if (r1 < r2)
+        std::inplace_merge(keys.begin() + start[r0], keys.begin() + start[r1],
+          keys.begin() + start[r2]);
+      return 0;
+      });
+    }
+}
+
+// --------------------------------------------------------------------------
+vtkCellArray *renumberCells(vtkCellArray *ca, const std::vector<vtkIdType> &inv)
+{
+  vtkDataArray *offs = nullptr;
+  vtkDataArray *conn = nullptr;
+  if (VTKUtils::GetCellArrays(ca, false, offs, conn))
+    return nullptr;
+
+  long n = conn->GetNumberOfTuples();
+  const vtkTypeInt64 *pConn = static_cast<vtkTypeInt64Array*>(conn)->GetPointer(0);
+
+  vtkTypeInt64Array *newConn = vtkTypeInt64Array::New();
+  newConn->SetNumberOfTuples(n);
+  vtkTypeInt64 *pNewConn = newConn->GetPointer(0);
+
+  const long chunk = 65536;
+  TaskRuntime::ParallelFor((n + chunk - 1) / chunk, -1, [&](int, long q) -> int
+    {
+    long i1 = std::min(n, (q + 1)*chunk);
+    for (long i = q*chunk; i < i1; ++i)
+      pNewConn[i] = inv[pConn[i]];
+    return 0;
+    });
+
+  vtkCellArray *out = VTKUtils::NewCellArray(offs, newConn);
+
+  offs->Delete();
+  conn->Delete();
+  newConn->Delete();
+
+  return out;
+}
+
+// --------------------------------------------------------------------------
+vtkCellArray *newVertices(long nPoints)
+{
+  vtkDataArray *offs = nullptr;
+  vtkDataArray *conn = nullptr;
+  VTKUtils::NewCellArrays(false, nPoints, nPoints, offs, conn);
+
+  vtkTypeInt64 *pOffs = static_cast<vtkTypeInt64Array*>(offs)->GetPointer(0);
+  vtkTypeInt64 *pConn = static_cast<vtkTypeInt64Array*>(conn)->GetPointer(0);
+  for (long i = 0; i < nPoints; ++i)
+    {
+    pOffs[i] = i;
+    pConn[i] = i;
+    }
+  pOffs[nPoints] = nPoints;
+
+  vtkCellArray *out = VTKUtils::NewCellArray(offs, conn);
+
+  offs->Delete();
+  conn->Delete();
+
+  return out;
+}
+
+// when each point has a vertex of its own get the vertex of each point
+bool getVertexOrder(vtkCellArray *ca, long nPoints, std::vector<vtkIdType> &vert)
+{
+  if (!ca || (ca->GetNumberOfCells() != nPoints))
+    return false;
+
+  vtkDataArray *offs = nullptr;
+  vtkDataArray *conn = nullptr;
+  if (VTKUtils::GetCellArrays(ca, false, offs, conn))
+    return false;
+
+  bool ok = conn->GetNumberOfTuples() == nPoints;
+  if (ok)
+    {
+    const vtkTypeInt64 *pOffs = static_cast<vtkTypeInt64Array*>(offs)->GetPointer(0);
+    const vtkTypeInt64 *pConn = static_cast<vtkTypeInt64Array*>(conn)->GetPointer(0);
+
+    vert.assign(nPoints, -1);
+    for (long c = 0; ok && (c < nPoints); ++c)
+      {
+      vtkTypeInt64 p = pConn[c];
+      ok = (pOffs[c] == c) && (p >= 0) && (p < nPoints) && (vert[p] < 0);
+      if (ok)
+        vert[p] = c;
+      }
+    }
+
+  offs->Delete();
+  conn->Delete();
+
+  return ok;
+}
+}
+
+struct SpatialSortDataAdaptor::InternalsType
+{
+  InternalsType() : Data(nullptr) {}
+
+  // a source mesh, with the arrays added so far
+  struct SourceEntry
+  {
+    vtkDataObjectPtr Mesh;
+    std::set<std::pair<int, std::string>> Arrays;
+    bool GhostCells;
+    bool GhostNodes;
+  };
+
+  // a sorted mesh. the ids of the source points and cells of each block in
+  // the new order, the cell ids are empty when the cells keep their order,
+  // and the curve indices of the points
+  struct SortedEntry
+  {
+    vtkDataObjectPtr Mesh;
+    std::vector<std::vector<vtkIdType>> PointIds;
+    std::vector<std::vector<vtkIdType>> CellIds;
+    std::vector<vtkDataArrayPtr> Keys;
+  };
+
+  // get the source mesh
+  int GetSource(const std::string &meshName, SourceEntry *&entry);
+
+  // get the sorted structure of a mesh
+  int GetSorted(const std::string &meshName, SortedEntry *&entry);
+
+  // sort a block within the box lo, hi
+  int Sort(vtkDataSet *ds, int curve, const double lo[3],
+    const double hi[3], vtkDataSet *&sorted, std::vector<vtkIdType> &pointIds,
+    std::vector<vtkIdType> &cellIds, vtkDataArrayPtr &keys);
+
+  // permute an array of the source to the caller's copy of a sorted mesh
+  int Pass(const std::string &meshName, vtkDataObject *mesh,
+    int association, const std::string &arrayName);
+
+  // set the ranges of the curve indices, the last array of the metadata
+  int SetKeyRanges(MPI_Comm comm, const SortedEntry *entry,
+    MeshMetadataPtr &md);
+
+  DataAdaptor *Data;
+  std::map<std::string, int> Curves;
+  std::map<std::string, SourceEntry> Sources;
+  std::map<std::string, SortedEntry> Sorted;
+};
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::InternalsType::GetSource(
+  const std::string &meshName, SourceEntry *&entry)
+{
+  std::map<std::string, SourceEntry>::iterator it = this->Sources.find(meshName);
+  if (it == this->Sources.end())
+    {
+    vtkDataObject *dobj = nullptr;
+    if (this->Data->GetMesh(meshName, false, dobj))
+      {
+      SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    SourceEntry &newEntry = this->Sources[meshName];
+    newEntry.Mesh.TakeReference(dobj);
+    newEntry.GhostCells = false;
+    newEntry.GhostNodes = false;
+
+    it = this->Sources.find(meshName);
+    }
+
+  entry = &it->second;
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::InternalsType::Sort(vtkDataSet *ds, int curve,
+  const double lo[3], const double hi[3], vtkDataSet *&sorted,
+  std::vector<vtkIdType> &pointIds, std::vector<vtkIdType> &cellIds,
+  vtkDataArrayPtr &keys)
+{
+  sorted = nullptr;
+  pointIds.clear();
+  cellIds.clear();
+
+  vtkPolyData *pd = dynamic_cast<vtkPolyData*>(ds);
+  vtkUnstructuredGrid *ug = dynamic_cast<vtkUnstructuredGrid*>(ds);
+
+  if (!pd && !ug)
+    {
+    SENSEI_ERROR("Sorting " << ds->GetClassName() << " blocks is not supported")
+    return -1;
+    }
+
+  if (ug && ug->GetFaces())
+    {
+    SENSEI_ERROR("Sorting vtkUnstructuredGrid blocks with polyhedra is not supported")
+    return -1;
+    }
+
+  vtkPoints *pts = static_cast<vtkPointSet*>(ds)->GetPoints();
+  long nPoints = pts ? pts->GetNumberOfPoints() : 0;
+
+  // the curve index of each point
+  std::vector<KeyType> order(nPoints);
+
+  const long chunk = 65536;
+  TaskRuntime::ParallelFor((nPoints + chunk - 1) / chunk, -1,
+    [&](int, long q) -> int
+    {
+    long i1 = std::min(nPoints, (q + 1)*chunk);
+    for (long i = q*chunk; i < i1; ++i)
+      {
+      double p[3];
+      pts->GetPoint(i, p);
+      order[i] = KeyType(SpaceFillingCurve::GetIndex(curve, sortBits, p, lo, hi), i);
+      }
+    return 0;
+    });
+
+  sortKeys(order);
+
+  // the new order of the points, the new id of each source point, and
+  // their indices
+  pointIds.resize(nPoints);
+  std::vector<vtkIdType> inv(nPoints);
+
+  vtkUnsignedLongLongArray *ka = vtkUnsignedLongLongArray::New();
+  ka->SetName(GetKeyArrayName());
+  ka->SetNumberOfTuples(nPoints);
+  unsigned long long *pKeys = ka->GetPointer(0);
+
+  for (long i = 0; i < nPoints; ++i)
+    {
+    pointIds[i] = order[i].second;
+    inv[order[i].second] = i;
+    pKeys[i] = order[i].first;
+    }
+
+  keys.TakeReference(ka);
+
+  vtkPoints *newPts = vtkPoints::New();
+  if (pts)
+    {
+    vtkDataArray *coords = permute(pts->GetData(), pointIds);
+    newPts->SetData(coords);
+    coords->Delete();
+    }
+
+  // particles, a vertex per point. the vertices follow the points
+  std::vector<vtkIdType> vert;
+  long nCells = ds->GetNumberOfCells();
+  bool particles = (nCells == nPoints) && (nPoints > 0) &&
+    ((pd && (pd->GetNumberOfVerts() == nCells) &&
+      getVertexOrder(pd->GetVerts(), nPoints, vert)) ||
+    (ug && getVertexOrder(ug->GetCells(), nPoints, vert)));
+
+  if (particles)
+    {
+    cellIds.resize(nPoints);
+    for (long i = 0; i < nPoints; ++i)
+      cellIds[i] = vert[pointIds[i]];
+    }
+
+  if (pd)
+    {
+    vtkPolyData *pdo = vtkPolyData::New();
+    pdo->SetPoints(newPts);
+
+    if (particles)
+      {
+      vtkCellArray *verts = newVertices(nPoints);
+      pdo->SetVerts(verts);
+      verts->Delete();
+      }
+    else
+      {
+      vtkCellArray *cas[4] = {pd->GetVerts(), pd->GetLines(),
+        pd->GetPolys(), pd->GetStrips()};
+
+      for (int j = 0; j < 4; ++j)
+        {
+        if (!cas[j] || !cas[j]->GetNumberOfCells())
+          continue;
+
+        vtkCellArray *ca = renumberCells(cas[j], inv);
+        if (!ca)
+          {
+          SENSEI_ERROR("Failed to renumber the cells")
+          newPts->Delete();
+          pdo->Delete();
+          return -1;
+          }
+
+        if (j == 0)
+          pdo->SetVerts(ca);
+        else if (j == 1)
+          pdo->SetLines(ca);
+        else if (j == 2)
+          pdo->SetPolys(ca);
+        else
+          pdo->SetStrips(ca);
+
+        ca->Delete();
+        }
+      }
+
+    sorted = pdo;
+    }
+  else
+    {
+    vtkUnstructuredGrid *ugo = vtkUnstructuredGrid::New();
+    ugo->SetPoints(newPts);
+
+    if (nCells)
+      {
+      vtkCellArray *ca = particles ? newVertices(nPoints) :
+        renumberCells(ug->GetCells(), inv);
+
+      if (!ca)
+        {
+        SENSEI_ERROR("Failed to renumber the cells")
+        newPts->Delete();
+        ugo->Delete();
+        return -1;
+        }
+
+      if (particles)
+        {
+        ugo->SetCells(VTK_VERTEX, ca);
+        }
+      else
+        {
+        vtkUnsignedCharArray *types = vtkUnsignedCharArray::New();
+        types->DeepCopy(ug->GetCellTypesArray());
+        ugo->SetCells(types, ca);
+        types->Delete();
+        }
+
+      ca->Delete();
+      }
+
+    sorted = ugo;
+    }
+
+  newPts->Delete();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::InternalsType::GetSorted(
+  const std::string &meshName, SortedEntry *&entry)
+{
+  std::map<std::string, SortedEntry>::iterator it = this->Sorted.find(meshName);
+  if (it != this->Sorted.end())
+    {
+    entry = &it->second;
+    return 0;
+    }
+
+  TimeEvent<128> mark("SpatialSortDataAdaptor::Sort");
+
+  SourceEntry *source = nullptr;
+  if (this->GetSource(meshName, source))
+    return -1;
+
+  SortedEntry &newEntry = this->Sorted[meshName];
+  entry = &newEntry;
+
+  std::vector<vtkDataSet*> blocks;
+  getLeaves(source->Mesh, blocks);
+
+  // the box the curve passes through is that of all ranks' points, so that
+  // the indices of all blocks are comparable
+  double lo[3] = {std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+  double hi[3] = {std::numeric_limits<double>::lowest(),
+    std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+
+  for (vtkDataSet *ds : blocks)
+    {
+    if (!ds->GetNumberOfPoints())
+      continue;
+
+    double bounds[6];
+    ds->GetBounds(bounds);
+    for (int j = 0; j < 3; ++j)
+      {
+      lo[j] = std::min(lo[j], bounds[2*j]);
+      hi[j] = std::max(hi[j], bounds[2*j+1]);
+      }
+    }
+
+  MPI_Comm comm = this->Data->GetCommunicator();
+  MPI_Allreduce(MPI_IN_PLACE, lo, 3, MPI_DOUBLE, MPI_MIN, comm);
+  MPI_Allreduce(MPI_IN_PLACE, hi, 3, MPI_DOUBLE, MPI_MAX, comm);
+
+  // this rank has no data
+  if (!source->Mesh)
+    return 0;
+
+  int curve = this->Curves[meshName];
+
+  long nBlocks = blocks.size();
+  std::vector<vtkDataSet*> sorted(nBlocks, nullptr);
+  newEntry.PointIds.resize(nBlocks);
+  newEntry.CellIds.resize(nBlocks);
+  newEntry.Keys.resize(nBlocks);
+
+  // blocks are spread over the threads
+  int ierr = TaskRuntime::ParallelFor(nBlocks, -1, [&](int, long q) -> int
+    {
+    return this->Sort(blocks[q], curve, lo, hi, sorted[q],
+      newEntry.PointIds[q], newEntry.CellIds[q], newEntry.Keys[q]);
+    });
+
+  if (ierr)
+    {
+    for (vtkDataSet *ds : sorted)
+      if (ds)
+        ds->Delete();
+    SENSEI_ERROR("Failed to sort mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  vtkDataObject *mesh = source->Mesh;
+  if (vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(mesh))
+    {
+    vtkCompositeDataSet *cdo = cd->NewInstance();
+    cdo->CopyStructure(cd);
+    cdo->GetFieldData()->ShallowCopy(cd->GetFieldData());
+
+    vtkSmartPointer<vtkCompositeDataIterator> cdit;
+    cdit.TakeReference(cd->NewIterator());
+    cdit->SetSkipEmptyNodes(0);
+
+    long q = 0;
+    for (cdit->InitTraversal(); !cdit->IsDoneWithTraversal(); cdit->GoToNextItem())
+      {
+      if (dynamic_cast<vtkDataSet*>(cd->GetDataSet(cdit)))
+        {
+        sorted[q]->GetFieldData()->ShallowCopy(blocks[q]->GetFieldData());
+        cdo->SetDataSet(cdit, sorted[q]);
+        sorted[q]->Delete();
+        ++q;
+        }
+      }
+
+    newEntry.Mesh.TakeReference(cdo);
+    }
+  else
+    {
+    sorted[0]->GetFieldData()->ShallowCopy(blocks[0]->GetFieldData());
+    newEntry.Mesh.TakeReference(sorted[0]);
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::InternalsType::Pass(const std::string &meshName,
+  vtkDataObject *mesh, int association, const std::string &arrayName)
+{
+  SourceEntry *source = nullptr;
+  SortedEntry *entry = nullptr;
+  if (this->GetSource(meshName, source) || this->GetSorted(meshName, entry))
+    return -1;
+
+  std::vector<vtkDataSet*> blocks;
+  getLeaves(source->Mesh, blocks);
+
+  std::vector<vtkDataSet*> outBlocks;
+  getLeaves(mesh, outBlocks);
+
+  long nBlocks = blocks.size();
+  if (static_cast<long>(outBlocks.size()) != nBlocks)
+    {
+    SENSEI_ERROR("The mesh passed does not match mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  TimeEvent<128> mark("SpatialSortDataAdaptor::Permute");
+
+  for (long q = 0; q < nBlocks; ++q)
+    {
+    vtkFieldData *dsa = VTKUtils::GetAttributes(blocks[q], association);
+    vtkFieldData *dsaOut = VTKUtils::GetAttributes(outBlocks[q], association);
+    vtkDataArray *da = dsa ? dsa->GetArray(arrayName.c_str()) : nullptr;
+
+    if (!da || !dsaOut)
+      continue;
+
+    // field data, and cell arrays of cells that keep their order, are
+    // passed as they are
+    if ((association == vtkDataObject::FIELD) ||
+      ((association == vtkDataObject::CELL) && entry->CellIds[q].empty()))
+      {
+      dsaOut->AddArray(da);
+      continue;
+      }
+
+    const std::vector<vtkIdType> &ids = association == vtkDataObject::POINT ?
+      entry->PointIds[q] : entry->CellIds[q];
+
+    vtkDataArray *out = permute(da, ids);
+    dsaOut->AddArray(out);
+    out->Delete();
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::InternalsType::SetKeyRanges(MPI_Comm comm,
+  const SortedEntry *entry, MeshMetadataPtr &md)
+{
+  int j = md->ArrayName.size() - 1;
+  long nLocal = entry->Keys.size();
+
+  // the range of each local block, the points are in the order of the keys
+  std::vector<std::array<double,2>> ranges(nLocal);
+  for (long q = 0; q < nLocal; ++q)
+    {
+    STLUtils::InitializeRange(ranges[q]);
+
+    vtkUnsignedLongLongArray *keys =
+      static_cast<vtkUnsignedLongLongArray*>(entry->Keys[q].GetPointer());
+
+    long n = keys->GetNumberOfTuples();
+    if (n)
+      {
+      ranges[q][0] = keys->GetValue(0);
+      ranges[q][1] = keys->GetValue(n - 1);
+      }
+    }
+
+  if (md->GlobalView)
+    {
+    // the local blocks are those this rank owns, in order
+    int rank = 0;
+    MPI_Comm_rank(comm, &rank);
+
+    long nBlocks = md->BlockOwner.size();
+    std::vector<double> lo(nBlocks, std::numeric_limits<double>::max());
+    std::vector<double> hi(nBlocks, std::numeric_limits<double>::lowest());
+
+    for (long i = 0, q = 0; (i < nBlocks) && (q < nLocal); ++i)
+      {
+      if (md->BlockOwner[i] != rank)
+        continue;
+
+      lo[i] = ranges[q][0];
+      hi[i] = ranges[q][1];
+      ++q;
+      }
+
+    MPI_Allreduce(MPI_IN_PLACE, lo.data(), nBlocks, MPI_DOUBLE, MPI_MIN, comm);
+    MPI_Allreduce(MPI_IN_PLACE, hi.data(), nBlocks, MPI_DOUBLE, MPI_MAX, comm);
+
+    ranges.resize(nBlocks);
+    for (long i = 0; i < nBlocks; ++i)
+      ranges[i] = {{lo[i], hi[i]}};
+    }
+
+  if (md->BlockArrayRange.size() != ranges.size())
+    {
+    SENSEI_ERROR("The block array ranges of mesh \"" << md->MeshName
+      << "\" do not match its blocks")
+    return -1;
+    }
+
+  std::array<double,2> range;
+  STLUtils::InitializeRange(range);
+
+  long nBlocks = ranges.size();
+  for (long q = 0; q < nBlocks; ++q)
+    {
+    if (md->BlockArrayRange[q].size() == static_cast<size_t>(j + 1))
+      md->BlockArrayRange[q][j] = ranges[q];
+    STLUtils::ReduceRange(ranges[q], range);
+    }
+
+  if (md->ArrayRange.size() == static_cast<size_t>(j + 1))
+    md->ArrayRange[j] = range;
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+senseiNewMacro(SpatialSortDataAdaptor);
+
+//----------------------------------------------------------------------------
+SpatialSortDataAdaptor::SpatialSortDataAdaptor()
+{
+  this->Internals = new InternalsType;
+}
+
+//----------------------------------------------------------------------------
+SpatialSortDataAdaptor::~SpatialSortDataAdaptor()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+void SpatialSortDataAdaptor::SetDataAdaptor(DataAdaptor *data)
+{
+  if (this->Internals->Data == data)
+    return;
+
+  this->Clear();
+  this->Internals->Data = data;
+
+  if (data)
+    this->SetCommunicator(data->GetCommunicator());
+}
+
+//----------------------------------------------------------------------------
+DataAdaptor *SpatialSortDataAdaptor::GetDataAdaptor()
+{
+  return this->Internals->Data;
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::AddMesh(const std::string &meshName, int curve)
+{
+  if ((curve != SpaceFillingCurve::MORTON) &&
+    (curve != SpaceFillingCurve::HILBERT))
+    {
+    SENSEI_ERROR("Invalid curve " << curve << " for mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  this->Internals->Curves[meshName] = curve;
+
+  this->Clear();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::Initialize(const pugi::xml_node &node)
+{
+  std::string defCurve = node.attribute("curve").as_string("hilbert");
+
+  for (pugi::xml_node meshNode = node.child("mesh"); meshNode;
+    meshNode = meshNode.next_sibling("mesh"))
+    {
+    if (XMLUtils::RequireAttribute(meshNode, "name"))
+      return -1;
+
+    std::string curveStr = meshNode.attribute("curve").as_string(defCurve.c_str());
+    int curve = SpaceFillingCurve::HILBERT;
+    if (SpaceFillingCurve::GetCurve(curveStr, curve))
+      {
+      SENSEI_ERROR("Invalid curve \"" << curveStr << "\". The curve is one of"
+        " morton or hilbert")
+      return -1;
+      }
+
+    if (this->AddMesh(meshNode.attribute("name").as_string(), curve))
+      return -1;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void SpatialSortDataAdaptor::GetSourceRequirements(
+  const DataRequirements &reqs, DataRequirements &sourceReqs)
+{
+  sourceReqs.Clear();
+
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    const std::string &meshName = mit.MeshName();
+    bool sorted = this->Internals->Curves.count(meshName);
+
+    sourceReqs.AddRequirement(meshName, mit.StructureOnly());
+
+    ArrayRequirementsIterator ait = reqs.GetArrayRequirementsIterator(meshName);
+    for (; ait; ++ait)
+      {
+      if (sorted && (ait.Association() == vtkDataObject::POINT) &&
+        (ait.Array() == GetKeyArrayName()))
+        continue;
+
+      sourceReqs.AddRequirement(meshName, ait.Association(), ait.Array());
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void SpatialSortDataAdaptor::Clear()
+{
+  this->Internals->Sources.clear();
+  this->Internals->Sorted.clear();
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::GetNumberOfMeshes(unsigned int &numMeshes)
+{
+  return this->Internals->Data->GetNumberOfMeshes(numMeshes);
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::GetMeshMetadata(unsigned int id,
+  MeshMetadataPtr &metadata)
+{
+  if (this->Internals->Data->GetMeshMetadata(id, metadata))
+    return -1;
+
+  if (!this->Internals->Curves.count(metadata->MeshName))
+    return 0;
+
+  // list the curve indices
+  int nArrays = metadata->ArrayName.size();
+
+  metadata->ArrayName.push_back(GetKeyArrayName());
+  metadata->ArrayCentering.push_back(vtkDataObject::POINT);
+  metadata->ArrayType.push_back(VTK_UNSIGNED_LONG_LONG);
+  metadata->ArrayComponents.push_back(1);
+  metadata->NumArrays = metadata->ArrayName.size();
+
+  std::array<double,2> empty;
+  STLUtils::InitializeRange(empty);
+
+  if (metadata->ArrayRange.size() == static_cast<size_t>(nArrays))
+    metadata->ArrayRange.push_back(empty);
+
+  for (auto &bar : metadata->BlockArrayRange)
+    if (bar.size() == static_cast<size_t>(nArrays))
+      bar.push_back(empty);
+
+  if (!metadata->Flags.BlockArrayRangeSet())
+    return 0;
+
+  // the ranges tell which parts of the curve each block covers
+  InternalsType::SortedEntry *entry = nullptr;
+  if (this->Internals->GetSorted(metadata->MeshName, entry) ||
+    this->Internals->SetKeyRanges(this->GetCommunicator(), entry, metadata))
+    {
+    SENSEI_ERROR("Failed to get the curve indices of mesh \""
+      << metadata->MeshName << "\"")
+    return -1;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::GetMesh(const std::string &meshName,
+  bool structureOnly, vtkDataObject *&mesh)
+{
+  mesh = nullptr;
+
+  if (!this->Internals->Curves.count(meshName))
+    return this->Internals->Data->GetMesh(meshName, structureOnly, mesh);
+
+  InternalsType::SortedEntry *entry = nullptr;
+  if (this->Internals->GetSorted(meshName, entry))
+    return -1;
+
+  // this rank has no data
+  if (!entry->Mesh)
+    return 0;
+
+  // the caller gets a copy of the structure, the arrays are permuted to it
+  mesh = entry->Mesh->NewInstance();
+  mesh->ShallowCopy(entry->Mesh);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::AddArray(vtkDataObject* mesh,
+  const std::string &meshName, int association, const std::string &arrayName)
+{
+  if (!this->Internals->Curves.count(meshName))
+    return this->Internals->Data->AddArray(mesh, meshName, association, arrayName);
+
+  if (!mesh)
+    return 0;
+
+  // the curve indices
+  if ((association == vtkDataObject::POINT) && (arrayName == GetKeyArrayName()))
+    {
+    InternalsType::SortedEntry *entry = nullptr;
+    if (this->Internals->GetSorted(meshName, entry))
+      return -1;
+
+    std::vector<vtkDataSet*> outBlocks;
+    getLeaves(mesh, outBlocks);
+
+    long nBlocks = outBlocks.size();
+    if (static_cast<long>(entry->Keys.size()) != nBlocks)
+      {
+      SENSEI_ERROR("The mesh passed does not match mesh \"" << meshName << "\"")
+      return -1;
+      }
+
+    for (long q = 0; q < nBlocks; ++q)
+      outBlocks[q]->GetPointData()->AddArray(entry->Keys[q]);
+
+    return 0;
+    }
+
+  InternalsType::SourceEntry *source = nullptr;
+  if (this->Internals->GetSource(meshName, source))
+    return -1;
+
+  if (!source->Mesh)
+    return 0;
+
+  std::pair<int, std::string> key(association, arrayName);
+  if (!source->Arrays.count(key))
+    {
+    if (this->Internals->Data->AddArray(source->Mesh, meshName,
+      association, arrayName))
+      {
+      SENSEI_ERROR("Failed to add " << VTKUtils::GetAttributesName(association)
+        << " data array \"" << arrayName << "\" to mesh \"" << meshName << "\"")
+      return -1;
+      }
+    source->Arrays.insert(key);
+    }
+
+  return this->Internals->Pass(meshName, mesh, association, arrayName);
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::AddGhostCellsArray(vtkDataObject* mesh,
+  const std::string &meshName)
+{
+  if (!this->Internals->Curves.count(meshName))
+    return this->Internals->Data->AddGhostCellsArray(mesh, meshName);
+
+  InternalsType::SourceEntry *source = nullptr;
+  if (this->Internals->GetSource(meshName, source))
+    return -1;
+
+  if (!source->Mesh || !mesh)
+    return 0;
+
+  if (!source->GhostCells)
+    {
+    if (this->Internals->Data->AddGhostCellsArray(source->Mesh, meshName))
+      {
+      SENSEI_ERROR("Failed to add ghost cells to mesh \"" << meshName << "\"")
+      return -1;
+      }
+    source->GhostCells = true;
+    }
+
+  return this->Internals->Pass(meshName, mesh, vtkDataObject::CELL, "vtkGhostType");
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::AddGhostNodesArray(vtkDataObject* mesh,
+  const std::string &meshName)
+{
+  if (!this->Internals->Curves.count(meshName))
+    return this->Internals->Data->AddGhostNodesArray(mesh, meshName);
+
+  InternalsType::SourceEntry *source = nullptr;
+  if (this->Internals->GetSource(meshName, source))
+    return -1;
+
+  if (!source->Mesh || !mesh)
+    return 0;
+
+  if (!source->GhostNodes)
+    {
+    if (this->Internals->Data->AddGhostNodesArray(source->Mesh, meshName))
+      {
+      SENSEI_ERROR("Failed to add ghost nodes to mesh \"" << meshName << "\"")
+      return -1;
+      }
+    source->GhostNodes = true;
+    }
+
+  return this->Internals->Pass(meshName, mesh, vtkDataObject::POINT, "vtkGhostType");
+}
+
+//----------------------------------------------------------------------------
+double SpatialSortDataAdaptor::GetDataTime()
+{
+  return this->Internals->Data->GetDataTime();
+}
+
+//----------------------------------------------------------------------------
+long SpatialSortDataAdaptor::GetDataTimeStep()
+{
+  return this->Internals->Data->GetDataTimeStep();
+}
+
+//----------------------------------------------------------------------------
+int SpatialSortDataAdaptor::ReleaseData()
+{
+  this->Clear();
+  return this->Internals->Data ? this->Internals->Data->ReleaseData() : 0;
+}
+
+}
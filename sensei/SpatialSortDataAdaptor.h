@@ -0,0 +1,126 @@
+#ifndef sensei_SpatialSortDataAdaptor_h
+#define sensei_SpatialSortDataAdaptor_h
+
+#include "DataAdaptor.h"
+
+#include <string>
+
+class vtkDataObject;
+namespace pugi { class xml_node; }
+
+namespace sensei
+{
+class DataRequirements;
+
+/// @brief A DataAdaptor that serves another adaptor's particles and
+/// unstructured points ordered along a space filling curve.
+///
+/// Simulations hold their points in an order of their own, which writes
+/// with poor compression and makes spatial reads touch all of a block. A
+/// writer or transport given one of these in place of the simulation's
+/// adaptor writes the points of the configured meshes sorted by their
+/// index on the Morton or Hilbert curve through the mesh's bounding box,
+/// with the point arrays permuted alongside. The sort is made per block on
+/// the TaskRuntime's threads.
+///
+/// The blocks are vtkPolyData or vtkUnstructuredGrid, cells other than
+/// polyhedra are renumbered to the new point order. When each point has a
+/// vertex of its own the vertices, and the cell arrays, follow the points.
+/// Otherwise the cells keep their order.
+///
+/// The index of each point is served in the unsigned 64 bit point array
+/// named by GetKeyArrayName. The points of a block are in increasing order
+/// of it, and its range on each block, in the metadata's BlockArrayRange,
+/// tells a reader which parts of the curve the block covers. The indices
+/// use 16 bits per axis so that the ranges are exact in double precision.
+///
+/// The bounding box is reduced over the adaptor's communicator when a
+/// sorted mesh or its array ranges are first requested in a step, these
+/// calls are then collective. The sorted meshes are kept until Clear or
+/// ReleaseData is called. Meshes that are not configured are passed
+/// through.
+class SpatialSortDataAdaptor : public DataAdaptor
+{
+public:
+  static SpatialSortDataAdaptor *New();
+  senseiTypeMacro(SpatialSortDataAdaptor, DataAdaptor);
+
+  /// @brief Get the name of the point array holding the curve indices.
+  static const char *GetKeyArrayName() { return "sfc_key"; }
+
+  /// @brief Set the adaptor whose meshes are sorted.
+  ///
+  /// Setting a different adaptor clears the sorted meshes. This takes the
+  /// communicator of the wrapped adaptor.
+  void SetDataAdaptor(DataAdaptor *data);
+  DataAdaptor *GetDataAdaptor();
+
+  /// @brief Sort the points of a mesh.
+  ///
+  /// @param[in] meshName the mesh to sort
+  /// @param[in] curve SpaceFillingCurve::MORTON or HILBERT
+  /// @returns zero if successful
+  int AddMesh(const std::string &meshName, int curve);
+
+  /// @brief Configure from XML.
+  ///
+  ///   <sort curve="hilbert">
+  ///     <mesh name="particles"/>
+  ///     <mesh name="tracers" curve="morton"/>
+  ///   </sort>
+  ///
+  /// the curve is hilbert by default. returns zero if successful.
+  int Initialize(const pugi::xml_node &node);
+
+  /// @brief Map requirements on the served meshes to those of the wrapped
+  /// adaptor.
+  ///
+  /// The curve indices are computed here and are not asked of the wrapped
+  /// adaptor.
+  void GetSourceRequirements(const DataRequirements &reqs,
+    DataRequirements &sourceReqs);
+
+  /// @brief Release the sorted meshes.
+  void Clear();
+
+  // the meshes of the wrapped adaptor, the sorted meshes list the array of
+  // curve indices
+  int GetNumberOfMeshes(unsigned int &numMeshes) override;
+  int GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadata) override;
+
+  int GetMesh(const std::string &meshName, bool structureOnly,
+    vtkDataObject *&mesh) override;
+
+  using DataAdaptor::GetMesh;
+
+  int AddGhostNodesArray(vtkDataObject* mesh,
+    const std::string &meshName) override;
+
+  int AddGhostCellsArray(vtkDataObject* mesh,
+    const std::string &meshName) override;
+
+  int AddArray(vtkDataObject* mesh, const std::string &meshName,
+    int association, const std::string &arrayName) override;
+
+  // forwarded to the wrapped adaptor
+  double GetDataTime() override;
+  long GetDataTimeStep() override;
+
+  /// @brief Clears the sorted meshes and forwards to the wrapped adaptor.
+  int ReleaseData() override;
+
+protected:
+  SpatialSortDataAdaptor();
+  ~SpatialSortDataAdaptor();
+
+private:
+  SpatialSortDataAdaptor(const SpatialSortDataAdaptor&) = delete;
+  void operator=(const SpatialSortDataAdaptor&) = delete;
+
+  struct InternalsType;
+  InternalsType *Internals;
+};
+
+}
+
+#endif
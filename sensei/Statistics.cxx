@@ -0,0 +1,713 @@
+#include "Statistics.h"
+#include "ArrayDispatch.h"
+#include "DataAdaptor.h"
+#include "MeshMetadata.h"
+#include "PartialResultsDataAdaptor.h"
+#include "Profiler.h"
+#include "TaskRuntime.h"
+#include "VTKUtils.h"
+#include "Error.h"
+
+#include <vtkCellData.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+using Moments = sensei::Statistics::Moments;
+
+namespace
+{
+// values are summarized in runs of this size
+const long runSize = 512;
+
+// the moments of no values
+Moments emptyMoments()
+{
+  Moments m = {0.0, std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::lowest(), 0.0, 0.0, 0.0, 0.0, 0.0};
+  return m;
+}
+
+// merge the moments of b into a. see Pebay, "Formulas for robust, one-pass
+// parallel computation of covariances and arbitrary-order statistical
+// moments", SAND2008-6212
+void merge(Moments &a, const Moments &b)
+{
+  if (b.Count <= 0.0)
+    return;
+
+  if (a.Count <= 0.0)
+    {
+    a = b;
+    return;
+    }
+
+  double na = a.Count;
+  double nb = b.Count;
+  double n = na + nb;
+  double d = b.Mean - a.Mean;
+  double dn = d / n;
+  double dn2 = dn * dn;
+  double nab = na * nb;
+
+  double m2 = a.M2 + b.M2 + d * dn * nab;
+
+  double m3 = a.M3 + b.M3 + d * dn2 * nab * (na - nb) +
+    3.0 * dn * (na * b.M2 - nb * a.M2);
+
+  double m4 = a.M4 + b.M4 + d * dn2 * dn * nab * (na * na - nab + nb * nb) +
+    6.0 * dn2 * (na * na * b.M2 + nb * nb * a.M2) +
+    4.0 * dn * (na * b.M3 - nb * a.M3);
+
+  a.Count = n;
+  a.Min = std::min(a.Min, b.Min);
+  a.Max = std::max(a.Max, b.Max);
+  a.Mean += dn * nb;
+  a.M2 = m2;
+  a.M3 = m3;
+  a.M4 = m4;
+  a.SumSq += b.SumSq;
+}
+
+// the MPI_Op merging arrays of moments
+void mergeMoments(void *in, void *inout, int *len, MPI_Datatype *)
+{
+  const Moments *pin = static_cast<const Moments*>(in);
+  Moments *pinout = static_cast<Moments*>(inout);
+
+  for (int i = 0; i < *len; ++i)
+    {
+    Moments m = pin[i];
+    merge(m, pinout[i]);
+    pinout[i] = m;
+    }
+}
+
+// summarize a run of at most runSize values and merge it into m. the
+// run's mean is found first and the central moments about it in a second
+// pass over the run while it is in cache. both passes vectorize, ghost
+// values are weighted by zero rather than branched around
+template <typename T>
+void runMoments(const T *vals, const unsigned char *ghosts, long n,
+  Moments &m)
+{
+  double count = 0.0;
+  double sum = 0.0;
+  double lo = std::numeric_limits<double>::max();
+  double hi = std::numeric_limits<double>::lowest();
+
+  if (ghosts)
+    {
+    for (long i = 0; i < n; ++i)
+      {
+      double x = static_cast<double>(vals[i]);
+      double w = ghosts[i] == 0;
+      count += w;
+      sum += w * x;
+      lo = std::min(lo, ghosts[i] ? lo : x);
+      hi = std::max(hi, ghosts[i] ? hi : x);
+      }
+    }
+  else
+    {
+    for (long i = 0; i < n; ++i)
+      {
+      double x = static_cast<double>(vals[i]);
+      sum += x;
+      lo = std::min(lo, x);
+      hi = std::max(hi, x);
+      }
+    count = n;
+    }
+
+  if (count <= 0.0)
+    return;
+
+  double mean = sum / count;
+  double m2 = 0.0;
+  double m3 = 0.0;
+  double m4 = 0.0;
+  double sumSq = 0.0;
+
+  for (long i = 0; i < n; ++i)
+    {
+    double x = static_cast<double>(vals[i]);
+    double w = ghosts ? double(ghosts[i] == 0) : 1.0;
+    double d = x - mean;
+    double wd2 = w * d * d;
+    m2 += wd2;
+    m3 += wd2 * d;
+    m4 += wd2 * d * d;
+    sumSq += w * x * x;
+    }
+
+  Moments r = {count, lo, hi, mean, m2, m3, m4, sumSq};
+  merge(m, r);
+}
+
+// summarize the values [begin, end). values of arrays that are not stored
+// contiguously are copied a run at a time
+template <typename T>
+void spanMoments(vtkDataArray *da, const T *vals, const unsigned char *ghosts,
+  long begin, long end, Moments &m)
+{
+  double buffer[runSize];
+
+  for (long i0 = begin; i0 < end; i0 += runSize)
+    {
+    long n = std::min(runSize, end - i0);
+    const unsigned char *pg = ghosts ? ghosts + i0 : nullptr;
+
+    if (vals)
+      {
+      runMoments(vals + i0, pg, n, m);
+      }
+    else
+      {
+      for (long i = 0; i < n; ++i)
+        buffer[i] = da->GetComponent(i0 + i, 0);
+
+      runMoments(buffer, pg, n, m);
+      }
+    }
+}
+
+// summarize the n values of an array, splitting the work over the
+// requested number of threads. when the ghosts are given by an index range
+// only the spans of interior values are visited
+template <typename T>
+void arrayMoments(vtkDataArray *da, const T *vals, long n,
+  const unsigned char *ghosts, const sensei::VTKUtils::InteriorRange *interior,
+  int nThreads, Moments &m)
+{
+  auto summarize = [&](long start, long nLocal, Moments &tm)
+    {
+    if (!interior)
+      {
+      spanMoments(da, vals, ghosts, start, start + nLocal, tm);
+      return;
+      }
+
+    interior->ForEachSpan(start, start + nLocal,
+      [&](long begin, long end, bool isInterior)
+      {
+      if (isInterior)
+        spanMoments(da, vals, static_cast<const unsigned char*>(nullptr),
+          begin, end, tm);
+      });
+    };
+
+  // don't bother with threads for small arrays
+  const long minPerThread = 65536;
+  nThreads = std::max(1l, std::min(static_cast<long>(nThreads), n/minPerThread));
+
+  if (nThreads == 1)
+    {
+    summarize(0, n, m);
+    return;
+    }
+
+  std::vector<Moments> threadMoments(nThreads, emptyMoments());
+
+  long blockSize = n / nThreads;
+  long nLarge = n % nThreads;
+  sensei::TaskRuntime::ParallelFor(nThreads, nThreads,
+    [&](int, long i) -> int
+    {
+    long start = i*blockSize + (i < nLarge ? i : nLarge);
+    long nLocal = blockSize + (i < nLarge ? 1 : 0);
+
+    summarize(start, nLocal, threadMoments[i]);
+
+    return 0;
+    });
+
+  for (int i = 0; i < nThreads; ++i)
+    merge(m, threadMoments[i]);
+}
+
+// summarize the values of an array, see ArrayDispatch
+struct MomentsKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    arrayMoments(this->Array, vals, this->NumTuples, this->Ghosts,
+      this->Interior, this->Threads, *this->Result);
+  }
+
+  vtkDataArray *Array;
+  long NumTuples;
+  const unsigned char *Ghosts;
+  const sensei::VTKUtils::InteriorRange *Interior;
+  int Threads;
+  Moments *Result;
+};
+}
+
+namespace sensei
+{
+
+//-----------------------------------------------------------------------------
+double Statistics::Moments::GetVariance() const
+{
+  return this->Count > 0.0 ? this->M2 / this->Count : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+double Statistics::Moments::GetStdDev() const
+{
+  return std::sqrt(this->GetVariance());
+}
+
+//-----------------------------------------------------------------------------
+double Statistics::Moments::GetSkewness() const
+{
+  return this->M2 > 0.0 ?
+    std::sqrt(this->Count) * this->M3 / std::pow(this->M2, 1.5) : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+double Statistics::Moments::GetKurtosis() const
+{
+  return this->M2 > 0.0 ?
+    this->Count * this->M4 / (this->M2 * this->M2) - 3.0 : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+double Statistics::Moments::GetL2Norm() const
+{
+  return std::sqrt(this->SumSq);
+}
+
+//-----------------------------------------------------------------------------
+senseiNewMacro(Statistics);
+
+//-----------------------------------------------------------------------------
+Statistics::Statistics() : Threads(1), Asynchronous(false),
+  Phase(PartialResultsDataAdaptor::PHASE_ALL), PartialPrefix("statistics"),
+  Request(MPI_REQUEST_NULL), MomentsType(MPI_DATATYPE_NULL),
+  MergeOp(MPI_OP_NULL), PendingStep(0), PendingTime(0.0)
+{
+}
+
+//-----------------------------------------------------------------------------
+Statistics::~Statistics()
+{
+  this->FinishReduction();
+}
+
+//-----------------------------------------------------------------------------
+void Statistics::Initialize(const DataRequirements &reqs,
+  const std::string &fileName)
+{
+  this->FileName = fileName;
+
+  this->MeshNames.clear();
+  this->ArrayNames.clear();
+  this->Associations.clear();
+  this->Results.clear();
+
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    ArrayRequirementsIterator ait =
+      reqs.GetArrayRequirementsIterator(mit.MeshName());
+
+    for (; ait; ++ait)
+      {
+      this->MeshNames.push_back(mit.MeshName());
+      this->Associations.push_back(ait.Association());
+      this->ArrayNames.push_back(ait.Array());
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Statistics::SetNumberOfThreads(int nThreads)
+{
+  this->Threads = nThreads < 1 ? TaskRuntime::GetNumberOfThreads() : nThreads;
+}
+
+//-----------------------------------------------------------------------------
+void Statistics::SetAsynchronous(bool async)
+{
+  this->Asynchronous = async;
+}
+
+//-----------------------------------------------------------------------------
+void Statistics::SetPhase(int phase)
+{
+  this->Phase = phase;
+}
+
+//-----------------------------------------------------------------------------
+void Statistics::SetPartialPrefix(const std::string &prefix)
+{
+  this->PartialPrefix = prefix;
+}
+
+//-----------------------------------------------------------------------------
+const char *Statistics::GetGhostArrayName()
+{
+#if VTK_MAJOR_VERSION == 6 && VTK_MINOR_VERSION == 1
+    return "vtkGhostType";
+#else
+    return vtkDataSetAttributes::GhostArrayName();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+vtkDataArray* Statistics::GetArray(vtkDataObject* dobj, int association,
+  const std::string& arrayname)
+{
+  if (vtkFieldData* fd = dobj->GetAttributesAsFieldData(association))
+    {
+    return fd->GetArray(arrayname.c_str());
+    }
+  return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+bool Statistics::Execute(DataAdaptor* data)
+{
+  TimeEvent<128> mark("Statistics::Execute");
+
+  // complete the reduction of the last step, it was overlapped with the
+  // simulation
+  bool status = !this->FinishReduction();
+
+  if (this->Phase == PartialResultsDataAdaptor::PHASE_GLOBAL)
+    return this->ExecuteGlobal(data) && status;
+
+  unsigned int nArrays = this->ArrayNames.size();
+  std::vector<Moments> moments(nArrays, emptyMoments());
+
+  int step = data->GetDataTimeStep();
+  double time = data->GetDataTime();
+
+  // the moments need only the values of the arrays, these are viewed
+  // without making VTK objects when the simulation supports it. errors
+  // are reported but processing continues so that all ranks take part in
+  // the reduction below
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    std::vector<ArrayView> views;
+    if (data->GetArrayViews(this->MeshNames[i], this->Associations[i],
+      this->ArrayNames[i], views))
+      {
+      SENSEI_ERROR("Failed to get " << VTKUtils::GetAttributesName(this->Associations[i])
+        << " data array \"" << this->ArrayNames[i] << "\" on mesh \""
+        << this->MeshNames[i] << "\"")
+      status = false;
+      continue;
+      }
+
+    unsigned int nViews = views.size();
+    for (unsigned int j = 0; j < nViews; ++j)
+      {
+      const ArrayView &view = views[j];
+
+      if (view.NumComponents != 1)
+        {
+        SENSEI_ERROR("Array \"" << this->ArrayNames[i] << "\" has "
+          << view.NumComponents << " components. Statistics"
+          " of multi-component arrays are not supported")
+        status = false;
+        continue;
+        }
+
+      // the ghost zones of Cartesian blocks are described by index ranges
+      VTKUtils::InteriorRange interiorRange;
+      const VTKUtils::InteriorRange *interior = !view.Ghosts &&
+        !VTKUtils::GetInteriorRange(view, interiorRange) ? &interiorRange : nullptr;
+
+      MomentsKernel kernel{view.Array, view.NumTuples, view.Ghosts, interior,
+        this->Threads, &moments[i]};
+
+      if (ArrayDispatch::Execute(view, kernel))
+        {
+        SENSEI_ERROR("Unsupported type " << view.DataType << " of array \""
+          << this->ArrayNames[i] << "\" block " << view.BlockId)
+        status = false;
+        }
+      }
+    }
+
+  // publish the moments for the global phase
+  if (this->Phase == PartialResultsDataAdaptor::PHASE_LOCAL)
+    return !this->PublishMoments(data, moments) && status;
+
+  // reduce the moments of all arrays at once
+  this->LocalMoments.swap(moments);
+  this->StartReduction(step, time);
+
+  if (!this->Asynchronous && this->FinishReduction())
+    status = false;
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+int Statistics::PublishMoments(DataAdaptor* data,
+  const std::vector<Moments> &moments)
+{
+  TimeEvent<128> mark("Statistics::PublishMoments");
+
+  PartialResultsDataAdaptor *partials =
+    dynamic_cast<PartialResultsDataAdaptor*>(data);
+
+  if (!partials)
+    {
+    SENSEI_ERROR("The local phase of the statistics publishes its moments on"
+      " a PartialResultsDataAdaptor, but was given a " << data->GetClassName())
+    return -1;
+    }
+
+  const int nComps = sizeof(Moments)/sizeof(double);
+
+  unsigned int nArrays = moments.size();
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    vtkDoubleArray *da = vtkDoubleArray::New();
+    da->SetName("moments");
+    da->SetNumberOfComponents(nComps);
+    da->SetNumberOfTuples(1);
+    memcpy(da->GetPointer(0), &moments[i], sizeof(Moments));
+
+    vtkImageData *block = vtkImageData::New();
+    block->SetDimensions(2, 1, 1);
+    block->GetCellData()->AddArray(da);
+    da->Delete();
+
+    vtkCompositeDataSetPtr mesh =
+      VTKUtils::AsCompositeData(this->GetCommunicator(), block, true);
+
+    partials->SetPartialResult(PartialResultsDataAdaptor::GetMeshName(
+      this->PartialPrefix, this->MeshNames[i], this->ArrayNames[i]), mesh);
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+bool Statistics::ExecuteGlobal(DataAdaptor* data)
+{
+  TimeEvent<128> mark("Statistics::ExecuteGlobal");
+
+  unsigned int nArrays = this->ArrayNames.size();
+  std::vector<Moments> moments(nArrays, emptyMoments());
+
+  int step = data->GetDataTimeStep();
+  double time = data->GetDataTime();
+
+  const int nComps = sizeof(Moments)/sizeof(double);
+
+  // merge the moments of the blocks sent to this rank. errors are
+  // reported but processing continues so that all ranks take part in the
+  // reduction below
+  bool status = true;
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    std::string meshName = PartialResultsDataAdaptor::GetMeshName(
+      this->PartialPrefix, this->MeshNames[i], this->ArrayNames[i]);
+
+    vtkDataObject* dobj = nullptr;
+    if (data->GetMesh(meshName, true, dobj))
+      {
+      SENSEI_ERROR("Failed to get the partial result \"" << meshName << "\"")
+      status = false;
+      continue;
+      }
+
+    // this rank was not sent any of the blocks
+    if (!dobj)
+      continue;
+
+    vtkCompositeDataSetPtr mesh =
+      VTKUtils::AsCompositeData(this->GetCommunicator(), dobj, true);
+
+    if (data->AddArray(mesh, meshName, vtkDataObject::CELL, "moments"))
+      {
+      SENSEI_ERROR("Failed to add the moments of the partial result \""
+        << meshName << "\"")
+      status = false;
+      continue;
+      }
+
+    vtkSmartPointer<vtkCompositeDataIterator> iter;
+    iter.TakeReference(mesh->NewIterator());
+
+    for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
+      {
+      vtkDataArray *da = this->GetArray(iter->GetCurrentDataObject(),
+        vtkDataObject::CELL, "moments");
+
+      if (!da || (da->GetNumberOfComponents() != nComps) ||
+        (da->GetNumberOfTuples() < 1))
+        {
+        SENSEI_ERROR("Block " << iter->GetCurrentFlatIndex() - 1
+          << " of the partial result \"" << meshName << "\" has no moments")
+        status = false;
+        continue;
+        }
+
+      double vals[nComps];
+      da->GetTuple(0, vals);
+
+      Moments m;
+      memcpy(&m, vals, sizeof(Moments));
+
+      merge(moments[i], m);
+      }
+    }
+
+  this->LocalMoments.swap(moments);
+  this->StartReduction(step, time);
+
+  if (!this->Asynchronous && this->FinishReduction())
+    status = false;
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+void Statistics::StartReduction(int step, double time)
+{
+  TimeEvent<128> mark("Statistics::StartReduction");
+
+  MPI_Type_contiguous(sizeof(Moments)/sizeof(double), MPI_DOUBLE,
+    &this->MomentsType);
+  MPI_Type_commit(&this->MomentsType);
+
+  MPI_Op_create(mergeMoments, 1, &this->MergeOp);
+
+  unsigned int nArrays = this->LocalMoments.size();
+  this->Results.resize(nArrays);
+
+  MPI_Iallreduce(this->LocalMoments.data(), this->Results.data(), nArrays,
+    this->MomentsType, this->MergeOp, this->GetCommunicator(),
+    &this->Request);
+
+  this->PendingStep = step;
+  this->PendingTime = time;
+}
+
+//-----------------------------------------------------------------------------
+int Statistics::FinishReduction()
+{
+  if (this->Request == MPI_REQUEST_NULL)
+    return 0;
+
+  {
+  TimeEvent<128> mark("Statistics::FinishReduction::Wait");
+  MPI_Wait(&this->Request, MPI_STATUS_IGNORE);
+  }
+
+  MPI_Op_free(&this->MergeOp);
+  MPI_Type_free(&this->MomentsType);
+
+  return this->WriteResults(this->PendingStep, this->PendingTime);
+}
+
+//-----------------------------------------------------------------------------
+int Statistics::WriteResults(int step, double time)
+{
+  int rank = 0;
+  MPI_Comm_rank(this->GetCommunicator(), &rank);
+
+  if (rank != 0)
+    return 0;
+
+  unsigned int nArrays = this->Results.size();
+  for (unsigned int j = 0; j < nArrays; ++j)
+    {
+    const Moments &m = this->Results[j];
+    const std::string &meshName = this->MeshNames[j];
+    const std::string &arrayName = this->ArrayNames[j];
+
+    if (this->FileName.empty())
+      {
+      std::cout << "Statistics mesh \"" << meshName << "\" data array \""
+        << arrayName << "\" step " << step << " time " << time << std::endl
+        << "count : " << static_cast<long long>(m.Count) << std::endl
+        << "range : " << m.Min << " " << m.Max << std::endl
+        << "mean : " << m.Mean << std::endl
+        << "variance : " << m.GetVariance() << std::endl
+        << "std dev : " << m.GetStdDev() << std::endl
+        << "skewness : " << m.GetSkewness() << std::endl
+        << "kurtosis : " << m.GetKurtosis() << std::endl
+        << "l2 norm : " << m.GetL2Norm() << std::endl;
+      }
+    else
+      {
+      char fname[1024] = {'\0'};
+      snprintf(fname, 1024, "%s_%s_%s_%d_stats.txt", this->FileName.c_str(),
+        meshName.c_str(), arrayName.c_str(), step);
+
+      FILE *file = fopen(fname, "w");
+      if (!file)
+        {
+        char *estr = strerror(errno);
+        SENSEI_ERROR("Failed to open \"" << fname << "\""
+          << std::endl << estr)
+        return -1;
+        }
+
+      fprintf(file, "step : %d\n", step);
+      fprintf(file, "time : %0.6g\n", time);
+      fprintf(file, "count : %lld\n", static_cast<long long>(m.Count));
+      fprintf(file, "range : %0.6g %0.6g\n", m.Min, m.Max);
+      fprintf(file, "mean : %0.6g\n", m.Mean);
+      fprintf(file, "variance : %0.6g\n", m.GetVariance());
+      fprintf(file, "std dev : %0.6g\n", m.GetStdDev());
+      fprintf(file, "skewness : %0.6g\n", m.GetSkewness());
+      fprintf(file, "kurtosis : %0.6g\n", m.GetKurtosis());
+      fprintf(file, "l2 norm : %0.6g\n", m.GetL2Norm());
+      fclose(file);
+      }
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int Statistics::GetMoments(unsigned int id, Moments &moments)
+{
+  this->FinishReduction();
+
+  if (id >= this->Results.size())
+    return -1;
+
+  moments = this->Results[id];
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int Statistics::Finalize()
+{
+  int ierr = this->FinishReduction();
+  this->Results.clear();
+  return ierr;
+}
+
+}
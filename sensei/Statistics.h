@@ -0,0 +1,149 @@
+#ifndef sensei_Statistics_h
+#define sensei_Statistics_h
+
+#include "AnalysisAdaptor.h"
+#include "DataRequirements.h"
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+class vtkDataArray;
+class vtkDataObject;
+
+namespace sensei
+{
+
+/// @class Statistics
+/// @brief Computes the descriptive statistics of any number of arrays
+///
+/// The count, range, mean, variance, skewness, kurtosis and L2 norm of
+/// each array are found in a single threaded pass over its values. Each
+/// run of values is summarized by its central moments, computed about the
+/// run's own mean, and the summaries of runs, threads, blocks and ranks
+/// are merged pairwise, which stays accurate where sums of powers would
+/// cancel. All of the arrays are reduced in a single MPI_Allreduce with a
+/// user defined operation. Ghost values are skipped, using the interior
+/// range of Cartesian blocks where the metadata describes it. The moments
+/// are those of the population.
+///
+/// The reduction may be left in flight when Execute returns, overlapping
+/// it with the simulation. It is completed at the next Execute, at
+/// Finalize, or when the moments are requested.
+///
+/// The results are written by rank 0 to a file per array and step named
+/// <file>_<mesh>_<array>_<step>_stats.txt, or to cout when no file is
+/// given.
+///
+/// The statistics may be split between the simulation and an in transit
+/// end point, see SetPhase, so that moments rather than fields are
+/// shipped.
+class Statistics : public AnalysisAdaptor
+{
+public:
+  static Statistics* New();
+  senseiTypeMacro(Statistics, AnalysisAdaptor);
+
+  // compute the statistics of each of the arrays named in the requirements
+  void Initialize(const DataRequirements &reqs, const std::string &fileName);
+
+  // set the number of threads used to compute the local moments. the
+  // threads are those of the TaskRuntime, a value less than 1 uses all of
+  // them. the default is 1.
+  void SetNumberOfThreads(int nThreads);
+
+  // when set the reduction is posted and Execute returns without waiting
+  // for it, the results are written when it completes. the default is off.
+  void SetAsynchronous(bool async);
+
+  // split the statistics between the simulation and an end point. in the
+  // local phase, run by the simulation, the moments of each array are
+  // published each step on the PartialResultsDataAdaptor passed to
+  // Execute, and no MPI calls are made. each array's moments are a mesh
+  // with a single cell vtkImageData block per rank holding an 8 component
+  // "moments" array ordered as the members of Moments. in the global
+  // phase, run on the end point, the blocks are merged and the result is
+  // reduced and written as usual. the default,
+  // PartialResultsDataAdaptor::PHASE_ALL, does both in place.
+  void SetPhase(int phase);
+
+  // set the prefix of the names of the partial result meshes, see
+  // PartialResultsDataAdaptor::GetMeshName. the default is "statistics".
+  void SetPartialPrefix(const std::string &prefix);
+
+  bool Execute(DataAdaptor* data) override;
+
+  int Finalize() override;
+
+  // the moments of a set of values. M2, M3 and M4 are the sums of the
+  // second, third and fourth powers of the differences from the mean
+  struct Moments
+  {
+    double Count;
+    double Min;
+    double Max;
+    double Mean;
+    double M2;
+    double M3;
+    double M4;
+    double SumSq;
+
+    double GetVariance() const;
+    double GetStdDev() const;
+    double GetSkewness() const;
+    double GetKurtosis() const; // excess kurtosis
+    double GetL2Norm() const;
+  };
+
+  // return the last computed moments of the id'th array on all ranks.
+  // arrays are ordered by mesh name and association, then in the order
+  // given
+  int GetMoments(unsigned int id, Moments &moments);
+
+protected:
+  Statistics();
+  ~Statistics();
+
+  Statistics(const Statistics&) = delete;
+  void operator=(const Statistics&) = delete;
+
+  // merge the moments published by the local phase
+  bool ExecuteGlobal(DataAdaptor* data);
+
+  // publish the local moments of each array for the global phase
+  int PublishMoments(DataAdaptor* data, const std::vector<Moments> &moments);
+
+  // post the reduction of the local moments
+  void StartReduction(int step, double time);
+
+  // complete the reduction, if one is in flight, and write the results
+  int FinishReduction();
+
+  // write the results of the last step
+  int WriteResults(int step, double time);
+
+  static const char *GetGhostArrayName();
+  vtkDataArray* GetArray(vtkDataObject* dobj, int association,
+    const std::string& arrayname);
+
+  std::vector<std::string> MeshNames;  // mesh of each array
+  std::vector<std::string> ArrayNames;
+  std::vector<int> Associations;
+  std::string FileName;
+  int Threads;
+  bool Asynchronous;
+  int Phase;
+  std::string PartialPrefix;
+  std::vector<Moments> Results;
+
+  // the state of the reduction in flight
+  std::vector<Moments> LocalMoments;
+  MPI_Request Request;
+  MPI_Datatype MomentsType;
+  MPI_Op MergeOp;
+  int PendingStep;
+  double PendingTime;
+};
+
+}
+
+#endif
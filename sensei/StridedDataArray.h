@@ -0,0 +1,203 @@
+#ifndef sensei_StridedDataArray_h
+#define sensei_StridedDataArray_h
+
+#include <vtkGenericDataArray.h>
+#include <vtkAOSDataArrayTemplate.h>
+#include <vtkObjectFactory.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+namespace sensei
+{
+
+/// @class StridedDataArray
+/// @brief a vtkGenericDataArray that views strided values in place.
+///
+/// Simulations often store their data as arrays of structures, for
+/// instance a particle holding its id, position and velocity. A member of
+/// such a structure is a strided array. The components of a tuple are
+/// contiguous, and consecutive tuples are a fixed number of bytes apart.
+/// A data adaptor may return a StridedDataArray viewing the member from
+/// AddArray, or pass one to vtkPoints::SetData, instead of copying it.
+///
+/// The array does not own the memory it views. The memory must remain
+/// valid and unchanged until the data adaptor's ReleaseData is called.
+/// Values are read from and written to the structures.
+///
+/// VTK code that accesses the array through its value, tuple, or
+/// component API, or through vtkArrayDispatch, reads the structures
+/// directly. GetVoidPointer cannot return a pointer to strided values. It
+/// returns a contiguous copy instead. The copy is made on the first call
+/// and held by the array, and later writes do not update it. NewAOSArray
+/// returns a copy in the standard layout. When the array is resized, the
+/// values are copied into memory that the array owns, and the array no
+/// longer views the structures.
+template <typename ValueTypeT>
+class StridedDataArray :
+  public vtkGenericDataArray<StridedDataArray<ValueTypeT>, ValueTypeT>
+{
+  using GenericDataArrayType =
+    vtkGenericDataArray<StridedDataArray<ValueTypeT>, ValueTypeT>;
+
+public:
+  using SelfType = StridedDataArray<ValueTypeT>;
+  vtkTemplateTypeMacro(SelfType, GenericDataArrayType);
+  using ValueType = typename Superclass::ValueType;
+
+  static StridedDataArray *New()
+  { VTK_STANDARD_NEW_BODY(StridedDataArray<ValueTypeT>); }
+
+  /// View nTuples tuples of nComps components. The first component of the
+  /// first tuple is at base, and consecutive tuples are stride bytes apart.
+  void SetArray(ValueType *base, vtkIdType nTuples, int nComps,
+    vtkIdType stride)
+  {
+    this->Owned.reset();
+    this->Contiguous.reset();
+    this->Base = reinterpret_cast<unsigned char*>(base);
+    this->Stride = stride;
+    this->SetNumberOfComponents(nComps);
+    this->Size = nTuples*nComps;
+    this->MaxId = this->Size - 1;
+    this->Modified();
+  }
+
+  /// The number of bytes between consecutive tuples
+  vtkIdType GetStride() const { return this->Stride; }
+
+  /// returns a new standard layout array holding a copy of the values.
+  /// the caller takes the reference.
+  vtkAOSDataArrayTemplate<ValueType> *NewAOSArray() const
+  {
+    vtkAOSDataArrayTemplate<ValueType> *aos =
+      vtkAOSDataArrayTemplate<ValueType>::New();
+
+    aos->SetName(this->GetName());
+    aos->SetNumberOfComponents(this->NumberOfComponents);
+    aos->SetNumberOfTuples(this->GetNumberOfTuples());
+
+    this->CopyValues(aos->GetPointer(0));
+
+    return aos;
+  }
+
+  /// returns a contiguous copy of the values, see the class documentation
+  void *GetVoidPointer(vtkIdType valueIdx) override
+  {
+    std::lock_guard<std::mutex> lock(this->CopyMutex);
+    if (!this->Contiguous)
+      {
+      vtkIdType nValues = this->GetNumberOfValues();
+      this->Contiguous.reset(new ValueType[std::max(nValues, vtkIdType(1))]);
+      this->CopyValues(this->Contiguous.get());
+      }
+    return this->Contiguous.get() + valueIdx;
+  }
+
+  ValueType GetValue(vtkIdType valueIdx) const
+  {
+    vtkIdType nComps = this->NumberOfComponents;
+    return *this->Address(valueIdx/nComps, valueIdx%nComps);
+  }
+
+  void SetValue(vtkIdType valueIdx, ValueType value)
+  {
+    vtkIdType nComps = this->NumberOfComponents;
+    *this->Address(valueIdx/nComps, valueIdx%nComps) = value;
+  }
+
+  void GetTypedTuple(vtkIdType tupleIdx, ValueType *tuple) const
+  {
+    const ValueType *src = this->Address(tupleIdx, 0);
+    std::copy(src, src + this->NumberOfComponents, tuple);
+  }
+
+  void SetTypedTuple(vtkIdType tupleIdx, const ValueType *tuple)
+  {
+    std::copy(tuple, tuple + this->NumberOfComponents,
+      this->Address(tupleIdx, 0));
+  }
+
+  ValueType GetTypedComponent(vtkIdType tupleIdx, int comp) const
+  {
+    return *this->Address(tupleIdx, comp);
+  }
+
+  void SetTypedComponent(vtkIdType tupleIdx, int comp, ValueType value)
+  {
+    *this->Address(tupleIdx, comp) = value;
+  }
+
+protected:
+  StridedDataArray() : Base(nullptr), Stride(0) {}
+  ~StridedDataArray() {}
+
+  ValueType *Address(vtkIdType tupleIdx, int comp) const
+  {
+    return reinterpret_cast<ValueType*>(this->Base + tupleIdx*this->Stride) + comp;
+  }
+
+  // copy the values into the contiguous buffer dest
+  void CopyValues(ValueType *dest) const
+  {
+    vtkIdType nTuples = this->GetNumberOfTuples();
+    int nComps = this->NumberOfComponents;
+    for (vtkIdType i = 0; i < nTuples; ++i)
+      {
+      const ValueType *src = this->Address(i, 0);
+      std::copy(src, src + nComps, dest + i*nComps);
+      }
+  }
+
+  bool AllocateTuples(vtkIdType numTuples)
+  {
+    // the array now holds its own values, in the standard layout
+    vtkIdType nComps = this->NumberOfComponents;
+    vtkIdType nValues = numTuples*nComps;
+    this->Owned.reset(nValues ? new ValueType[nValues]() : nullptr);
+    this->Contiguous.reset();
+    this->Base = reinterpret_cast<unsigned char*>(this->Owned.get());
+    this->Stride = nComps*sizeof(ValueType);
+    return true;
+  }
+
+  bool ReallocateTuples(vtkIdType numTuples)
+  {
+    // keep the values that fit in the new size
+    vtkIdType nComps = this->NumberOfComponents;
+    vtkIdType nCopy = std::min(this->GetNumberOfTuples(), numTuples);
+
+    std::unique_ptr<ValueType[]> data(numTuples*nComps ?
+      new ValueType[numTuples*nComps]() : nullptr);
+
+    for (vtkIdType i = 0; i < nCopy; ++i)
+      {
+      const ValueType *src = this->Address(i, 0);
+      std::copy(src, src + nComps, data.get() + i*nComps);
+      }
+
+    this->Owned = std::move(data);
+    this->Contiguous.reset();
+    this->Base = reinterpret_cast<unsigned char*>(this->Owned.get());
+    this->Stride = nComps*sizeof(ValueType);
+    return true;
+  }
+
+  unsigned char *Base;
+  vtkIdType Stride;
+  std::unique_ptr<ValueType[]> Owned;
+  std::unique_ptr<ValueType[]> Contiguous;
+  std::mutex CopyMutex;
+
+private:
+  StridedDataArray(const StridedDataArray&) = delete;
+  void operator=(const StridedDataArray&) = delete;
+
+  friend class vtkGenericDataArray<StridedDataArray<ValueTypeT>, ValueTypeT>;
+};
+
+}
+
+#endif
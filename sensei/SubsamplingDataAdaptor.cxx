@@ -0,0 +1,1220 @@
+#include "SubsamplingDataAdaptor.h"
+#include "DataRequirements.h"
+#include "ArrayDispatch.h"
+#include "TaskRuntime.h"
+#include "Sampling.h"
+#include "VTKUtils.h"
+#include "Profiler.h"
+#include "XMLUtils.h"
+#include "Error.h"
+
+#include <vtkCellArray.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSet.h>
+#include <vtkFieldData.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkOverlappingAMR.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkRectilinearGrid.h>
+#include <vtkSmartPointer.h>
+#include <vtkStructuredGrid.h>
+#include <vtkUnstructuredGrid.h>
+
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using vtkDataObjectPtr = vtkSmartPointer<vtkDataObject>;
+
+namespace sensei
+{
+
+namespace
+{
+// the floor and ceiling of a/b for b > 0
+long floorDiv(long a, long b)
+{
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+long ceilDiv(long a, long b)
+{
+  return -floorDiv(-a, b);
+}
+
+// --------------------------------------------------------------------------
+void getLeaves(vtkDataObject *mesh, std::vector<vtkDataSet*> &blocks,
+  std::vector<unsigned int> *keys = nullptr)
+{
+  blocks.clear();
+
+  if (vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(mesh))
+    {
+    vtkSmartPointer<vtkCompositeDataIterator> cdit;
+    cdit.TakeReference(cd->NewIterator());
+    cdit->SetSkipEmptyNodes(0);
+
+    for (cdit->InitTraversal(); !cdit->IsDoneWithTraversal(); cdit->GoToNextItem())
+      {
+      if (vtkDataSet *ds = dynamic_cast<vtkDataSet*>(cd->GetDataSet(cdit)))
+        {
+        blocks.push_back(ds);
+        if (keys)
+          keys->push_back(cdit->GetCurrentFlatIndex());
+        }
+      }
+    }
+  else if (vtkDataSet *ds = dynamic_cast<vtkDataSet*>(mesh))
+    {
+    blocks.push_back(ds);
+    if (keys)
+      keys->push_back(0);
+    }
+}
+
+// gather the tuples ids of an array to a new array of the same type. the
+// contiguous path is spread over the threads, the generic path goes
+// through vtkDataArray's tuple API which is not thread safe
+struct GatherKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    int nc = this->In->GetNumberOfComponents();
+    long nIds = this->Ids->size();
+    const vtkIdType *ids = this->Ids->data();
+
+    if (!vals)
+      {
+      for (long i = 0; i < nIds; ++i)
+        for (int c = 0; c < nc; ++c)
+          this->Out->SetComponent(i, c, this->In->GetComponent(ids[i], c));
+      return;
+      }
+
+    T *out = static_cast<T*>(this->Out->GetVoidPointer(0));
+
+    const long chunk = 65536;
+    long nChunks = (nIds + chunk - 1) / chunk;
+
+    TaskRuntime::ParallelFor(nChunks, -1, [&](int, long q) -> int
+      {
+      long i1 = std::min(nIds, (q + 1)*chunk);
+      for (long i = q*chunk; i < i1; ++i)
+        {
+        const T *src = vals + ids[i]*nc;
+        T *dest = out + i*nc;
+        for (int c = 0; c < nc; ++c)
+          dest[c] = src[c];
+        }
+      return 0;
+      });
+  }
+
+  vtkDataArray *In;
+  const std::vector<vtkIdType> *Ids;
+  vtkDataArray *Out;
+};
+
+// --------------------------------------------------------------------------
+vtkDataArray *gather(vtkDataArray *in, const std::vector<vtkIdType> &ids)
+{
+  vtkDataArray *out = vtkDataArray::CreateDataArray(in->GetDataType());
+  out->SetName(in->GetName());
+  out->SetNumberOfComponents(in->GetNumberOfComponents());
+  out->SetNumberOfTuples(ids.size());
+
+  GatherKernel kernel{in, &ids, out};
+  ArrayDispatch::Execute(in, kernel);
+
+  return out;
+}
+
+// keep the entries of a per array metadata field that are flagged
+template <typename T>
+void selectEntries(const std::vector<bool> &keep, std::vector<T> &field)
+{
+  unsigned int nArrays = keep.size();
+  if (field.size() != nArrays)
+    return;
+
+  unsigned int j = 0;
+  for (unsigned int i = 0; i < nArrays; ++i)
+    if (keep[i])
+      field[j++] = field[i];
+
+  field.resize(j);
+}
+
+// the points kept in one direction of a Cartesian block whose points span
+// the global indices [a, b] are the multiples of the factor. a direction
+// one point thick is left as is
+void getKept(int a, int b, int factor, int &ka, int &kb, int &step)
+{
+  if (a == b)
+    {
+    ka = kb = a;
+    step = 1;
+    return;
+    }
+
+  ka = ceilDiv(a, factor);
+  kb = floorDiv(b, factor);
+  step = factor;
+}
+}
+
+struct SubsamplingDataAdaptor::InternalsType
+{
+  InternalsType() : Data(nullptr) {}
+
+  // the reduction of a mesh
+  struct MeshConfig
+  {
+    MeshConfig() : Factor(1), Mode(MODE_STRIDE), Seed(0) {}
+
+    int Factor;
+    int Mode;
+    unsigned long Seed;
+
+    // the factors of the arrays that have their own
+    std::map<std::pair<int, std::string>, int> ArrayFactors;
+  };
+
+  // a mesh as served, the reduction of the source mesh by a factor
+  struct Served
+  {
+    std::string Source;
+    int Factor;
+  };
+
+  // a source mesh at full resolution, with the arrays added so far
+  struct SourceEntry
+  {
+    vtkDataObjectPtr Mesh;
+    std::set<std::pair<int, std::string>> Arrays;
+    bool GhostCells;
+    bool GhostNodes;
+  };
+
+  // a reduced mesh, and the ids of the points and cells of each source
+  // block that it keeps
+  struct SampledEntry
+  {
+    vtkDataObjectPtr Mesh;
+    std::vector<std::vector<vtkIdType>> PointIds;
+    std::vector<std::vector<vtkIdType>> CellIds;
+  };
+
+  // get the mesh as served and its reduction. returns -1 if the name is
+  // not a served mesh
+  int GetServed(const std::string &meshName, Served &served);
+
+  // get the source mesh at full resolution
+  int GetSource(const std::string &sourceName, SourceEntry *&entry);
+
+  // get the reduced structure of a served mesh
+  int GetSampled(const std::string &meshName, SampledEntry *&entry);
+
+  // reduce a block. sets the kept point and cell ids
+  int Sample(vtkDataSet *ds, unsigned int key, const MeshConfig &config,
+    int factor, vtkDataSet *&sampled, std::vector<vtkIdType> &pointIds,
+    std::vector<vtkIdType> &cellIds);
+
+  // the ids of the particles kept
+  void SelectParticles(long nPoints, unsigned int key,
+    const MeshConfig &config, int factor, std::vector<vtkIdType> &ids);
+
+  // gather an array of the source to the caller's copy of a served mesh
+  int Pass(const std::string &meshName, vtkDataObject *mesh,
+    int association, const std::string &arrayName);
+
+  // the names of the meshes that serve the arrays with factors of their
+  // own, in order
+  void GetExtraMeshes(std::vector<std::pair<std::string, Served>> &extra);
+
+  // remove the arrays that are not served on the mesh from the metadata
+  void SelectArrays(const Served &served, MeshMetadataPtr &md);
+
+  // true if the array is served on the mesh
+  bool IsServed(const Served &served, int association,
+    const std::string &arrayName);
+
+  DataAdaptor *Data;
+  std::map<std::string, MeshConfig> Configs;
+  std::map<std::string, SourceEntry> Sources;
+  std::map<std::string, SampledEntry> Sampled;
+};
+
+//----------------------------------------------------------------------------
+void SubsamplingDataAdaptor::InternalsType::GetExtraMeshes(
+  std::vector<std::pair<std::string, Served>> &extra)
+{
+  extra.clear();
+  for (auto &it : this->Configs)
+    {
+    std::set<int> factors;
+    for (auto &at : it.second.ArrayFactors)
+      if (at.second != it.second.Factor)
+        factors.insert(at.second);
+
+    for (int factor : factors)
+      extra.emplace_back(GetMeshName(it.first, factor),
+        Served{it.first, factor});
+    }
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::InternalsType::GetServed(
+  const std::string &meshName, Served &served)
+{
+  std::vector<std::pair<std::string, Served>> extra;
+  this->GetExtraMeshes(extra);
+
+  for (auto &e : extra)
+    {
+    if (e.first == meshName)
+      {
+      served = e.second;
+      return 0;
+      }
+    }
+
+  std::map<std::string, MeshConfig>::iterator it = this->Configs.find(meshName);
+  served = Served{meshName, it == this->Configs.end() ? 1 : it->second.Factor};
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+bool SubsamplingDataAdaptor::InternalsType::IsServed(const Served &served,
+  int association, const std::string &arrayName)
+{
+  std::map<std::string, MeshConfig>::iterator it =
+    this->Configs.find(served.Source);
+
+  if (it == this->Configs.end())
+    return true;
+
+  auto at = it->second.ArrayFactors.find(std::make_pair(association, arrayName));
+  int factor = at == it->second.ArrayFactors.end() ?
+    it->second.Factor : at->second;
+
+  return factor == served.Factor;
+}
+
+//----------------------------------------------------------------------------
+void SubsamplingDataAdaptor::InternalsType::SelectArrays(const Served &served,
+  MeshMetadataPtr &md)
+{
+  unsigned int nArrays = md->ArrayName.size();
+  std::vector<bool> keep(nArrays);
+  for (unsigned int i = 0; i < nArrays; ++i)
+    keep[i] = this->IsServed(served, md->ArrayCentering[i], md->ArrayName[i]);
+
+  selectEntries(keep, md->ArrayName);
+  selectEntries(keep, md->ArrayCentering);
+  selectEntries(keep, md->ArrayComponents);
+  selectEntries(keep, md->ArrayType);
+  selectEntries(keep, md->ArrayRange);
+  for (auto &bar : md->BlockArrayRange)
+    selectEntries(keep, bar);
+
+  md->NumArrays = md->ArrayName.size();
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::InternalsType::GetSource(
+  const std::string &sourceName, SourceEntry *&entry)
+{
+  std::map<std::string, SourceEntry>::iterator it = this->Sources.find(sourceName);
+  if (it == this->Sources.end())
+    {
+    vtkDataObject *dobj = nullptr;
+    if (this->Data->GetMesh(sourceName, false, dobj))
+      {
+      SENSEI_ERROR("Failed to get mesh \"" << sourceName << "\"")
+      return -1;
+      }
+
+    SourceEntry &newEntry = this->Sources[sourceName];
+    newEntry.Mesh.TakeReference(dobj);
+    newEntry.GhostCells = false;
+    newEntry.GhostNodes = false;
+
+    it = this->Sources.find(sourceName);
+    }
+
+  entry = &it->second;
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void SubsamplingDataAdaptor::InternalsType::SelectParticles(long nPoints,
+  unsigned int key, const MeshConfig &config, int factor,
+  std::vector<vtkIdType> &ids)
+{
+  ids.clear();
+
+  // the draws of a block depend on the seed and its position only
+  unsigned long seed = config.Seed + 2654435761ul*key;
+
+  if (config.Mode == MODE_STRATIFIED)
+    {
+    std::vector<long> sample;
+    Sampling::GetSampleIds(nPoints, 1.0/factor, seed, sample);
+    ids.assign(sample.begin(), sample.end());
+    }
+  else if (config.Mode == MODE_RANDOM)
+    {
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<int> draw(0, factor - 1);
+    ids.reserve(nPoints/factor + 1);
+    for (long i = 0; i < nPoints; ++i)
+      if (draw(gen) == 0)
+        ids.push_back(i);
+    }
+  else
+    {
+    ids.reserve(nPoints/factor + 1);
+    for (long i = 0; i < nPoints; i += factor)
+      ids.push_back(i);
+    }
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::InternalsType::Sample(vtkDataSet *ds,
+  unsigned int key, const MeshConfig &config, int factor,
+  vtkDataSet *&sampled, std::vector<vtkIdType> &pointIds,
+  std::vector<vtkIdType> &cellIds)
+{
+  sampled = nullptr;
+  pointIds.clear();
+  cellIds.clear();
+
+  // Cartesian blocks
+  int ext[6] = {0, -1, 0, -1, 0, -1};
+  vtkImageData *im = dynamic_cast<vtkImageData*>(ds);
+  vtkRectilinearGrid *rg = dynamic_cast<vtkRectilinearGrid*>(ds);
+  vtkStructuredGrid *sg = dynamic_cast<vtkStructuredGrid*>(ds);
+
+  if (im)
+    im->GetExtent(ext);
+  else if (rg)
+    rg->GetExtent(ext);
+  else if (sg)
+    sg->GetExtent(ext);
+
+  if (im || rg || sg)
+    {
+    int newExt[6];
+    int step[3];
+    int n[3];     // points in the block
+    int nc[3];    // cells in the block
+    int nn[3];    // points kept
+    int nnc[3];   // cells kept
+    bool empty = false;
+    for (int d = 0; d < 3; ++d)
+      {
+      getKept(ext[2*d], ext[2*d+1], factor, newExt[2*d], newExt[2*d+1], step[d]);
+      n[d] = ext[2*d+1] - ext[2*d] + 1;
+      nc[d] = std::max(1, n[d] - 1);
+      nn[d] = newExt[2*d+1] - newExt[2*d] + 1;
+      nnc[d] = std::max(1, nn[d] - 1);
+      empty |= (n[d] < 1) || (nn[d] < 1);
+      }
+
+    // the block's extent lies between two kept planes, it has no points
+    if (empty)
+      {
+      for (int d = 0; d < 3; ++d)
+        {
+        newExt[2*d] = 0;
+        newExt[2*d+1] = -1;
+        }
+      }
+    else
+      {
+      // a kept point's index in the block in each direction
+      auto src = [&](int d, int i) -> long
+        { return long(i)*step[d] - ext[2*d]; };
+
+      pointIds.resize(long(nn[0])*nn[1]*nn[2]);
+      long q = 0;
+      for (int k = newExt[4]; k <= newExt[5]; ++k)
+        for (int j = newExt[2]; j <= newExt[3]; ++j)
+          for (int i = newExt[0]; i <= newExt[1]; ++i)
+            pointIds[q++] = src(0, i) + n[0]*(src(1, j) + n[1]*src(2, k));
+
+      // a kept cell takes the value of the cell at its first point
+      cellIds.resize(long(nnc[0])*nnc[1]*nnc[2]);
+      q = 0;
+      for (int k = 0; k < nnc[2]; ++k)
+        for (int j = 0; j < nnc[1]; ++j)
+          for (int i = 0; i < nnc[0]; ++i)
+            {
+            long ci = std::min(long(nc[0] - 1), src(0, newExt[0] + i));
+            long cj = std::min(long(nc[1] - 1), src(1, newExt[2] + j));
+            long ck = std::min(long(nc[2] - 1), src(2, newExt[4] + k));
+            cellIds[q++] = ci + nc[0]*(cj + nc[1]*ck);
+            }
+      }
+
+    if (im)
+      {
+      vtkImageData *imo = vtkImageData::New();
+      double spacing[3];
+      im->GetSpacing(spacing);
+      for (int d = 0; d < 3; ++d)
+        spacing[d] *= step[d];
+      imo->SetOrigin(im->GetOrigin());
+      imo->SetSpacing(spacing);
+      imo->SetExtent(newExt);
+      sampled = imo;
+      }
+    else if (rg)
+      {
+      vtkDataArray *coords[3] = {rg->GetXCoordinates(),
+        rg->GetYCoordinates(), rg->GetZCoordinates()};
+
+      vtkRectilinearGrid *rgo = vtkRectilinearGrid::New();
+      rgo->SetExtent(newExt);
+      for (int d = 0; d < 3; ++d)
+        {
+        std::vector<vtkIdType> ids;
+        for (int i = newExt[2*d]; !empty && (i <= newExt[2*d+1]); ++i)
+          ids.push_back(long(i)*step[d] - ext[2*d]);
+
+        vtkDataArray *c = gather(coords[d], ids);
+        if (d == 0)
+          rgo->SetXCoordinates(c);
+        else if (d == 1)
+          rgo->SetYCoordinates(c);
+        else
+          rgo->SetZCoordinates(c);
+        c->Delete();
+        }
+      sampled = rgo;
+      }
+    else
+      {
+      vtkStructuredGrid *sgo = vtkStructuredGrid::New();
+      sgo->SetExtent(newExt);
+      vtkPoints *pts = vtkPoints::New();
+      vtkDataArray *pd = gather(sg->GetPoints()->GetData(), pointIds);
+      pts->SetData(pd);
+      pd->Delete();
+      sgo->SetPoints(pts);
+      pts->Delete();
+      sampled = sgo;
+      }
+
+    return 0;
+    }
+
+  // particles, a vertex per point or no cells at all
+  vtkPolyData *pd = dynamic_cast<vtkPolyData*>(ds);
+  vtkUnstructuredGrid *ug = dynamic_cast<vtkUnstructuredGrid*>(ds);
+  if (pd || ug)
+    {
+    long nPoints = ds->GetNumberOfPoints();
+    long nCells = ds->GetNumberOfCells();
+    if (nCells && (nCells != nPoints))
+      {
+      SENSEI_ERROR("Subsampling " << ds->GetClassName() << " blocks is"
+        " supported for particles, with one vertex per point or no cells. The"
+        " block has " << nPoints << " points and " << nCells << " cells")
+      return -1;
+      }
+
+    this->SelectParticles(nPoints, key, config, factor, pointIds);
+    if (nCells)
+      cellIds = pointIds;
+
+    vtkPoints *pts = vtkPoints::New();
+    if (nPoints)
+      {
+      vtkDataArray *pda = gather(static_cast<vtkPointSet*>(ds)->GetPoints()->GetData(), pointIds);
+      pts->SetData(pda);
+      pda->Delete();
+      }
+
+    // the vertices of the kept particles
+    long nKept = pointIds.size();
+    vtkIdTypeArray *offs = nullptr;
+    vtkCellArray *verts = nullptr;
+    if (nCells)
+      {
+      vtkIdTypeArray *conn = vtkIdTypeArray::New();
+      conn->SetNumberOfTuples(nKept);
+      offs = vtkIdTypeArray::New();
+      offs->SetNumberOfTuples(nKept + 1);
+      for (long i = 0; i < nKept; ++i)
+        {
+        conn->SetValue(i, i);
+        offs->SetValue(i, i);
+        }
+      offs->SetValue(nKept, nKept);
+
+      verts = vtkCellArray::New();
+      verts->SetData(offs, conn);
+      conn->Delete();
+      offs->Delete();
+      }
+
+    if (pd)
+      {
+      vtkPolyData *pdo = vtkPolyData::New();
+      pdo->SetPoints(pts);
+      if (verts)
+        pdo->SetVerts(verts);
+      sampled = pdo;
+      }
+    else
+      {
+      vtkUnstructuredGrid *ugo = vtkUnstructuredGrid::New();
+      ugo->SetPoints(pts);
+      if (verts)
+        ugo->SetCells(VTK_VERTEX, verts);
+      sampled = ugo;
+      }
+
+    pts->Delete();
+    if (verts)
+      verts->Delete();
+
+    return 0;
+    }
+
+  SENSEI_ERROR("Subsampling " << ds->GetClassName() << " blocks is not supported")
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::InternalsType::GetSampled(
+  const std::string &meshName, SampledEntry *&entry)
+{
+  std::map<std::string, SampledEntry>::iterator it = this->Sampled.find(meshName);
+  if (it != this->Sampled.end())
+    {
+    entry = &it->second;
+    return 0;
+    }
+
+  TimeEvent<128> mark("SubsamplingDataAdaptor::Sample");
+
+  Served served;
+  this->GetServed(meshName, served);
+
+  SourceEntry *source = nullptr;
+  if (this->GetSource(served.Source, source))
+    return -1;
+
+  SampledEntry &newEntry = this->Sampled[meshName];
+  entry = &newEntry;
+
+  // this rank has no data
+  vtkDataObject *mesh = source->Mesh;
+  if (!mesh)
+    return 0;
+
+  if (dynamic_cast<vtkOverlappingAMR*>(mesh))
+    {
+    SENSEI_ERROR("Subsampling AMR mesh \"" << served.Source
+      << "\" is not supported")
+    return -1;
+    }
+
+  const MeshConfig &config = this->Configs[served.Source];
+
+  std::vector<vtkDataSet*> blocks;
+  std::vector<unsigned int> keys;
+  getLeaves(mesh, blocks, &keys);
+
+  long nBlocks = blocks.size();
+  std::vector<vtkDataSet*> sampled(nBlocks, nullptr);
+  newEntry.PointIds.resize(nBlocks);
+  newEntry.CellIds.resize(nBlocks);
+
+  // blocks are spread over the threads
+  int ierr = TaskRuntime::ParallelFor(nBlocks, -1, [&](int, long q) -> int
+    {
+    return this->Sample(blocks[q], keys[q], config, served.Factor,
+      sampled[q], newEntry.PointIds[q], newEntry.CellIds[q]);
+    });
+
+  if (ierr)
+    {
+    for (vtkDataSet *ds : sampled)
+      if (ds)
+        ds->Delete();
+    SENSEI_ERROR("Failed to subsample mesh \"" << served.Source << "\"")
+    return -1;
+    }
+
+  if (vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(mesh))
+    {
+    vtkCompositeDataSet *cdo = cd->NewInstance();
+    cdo->CopyStructure(cd);
+    cdo->GetFieldData()->ShallowCopy(cd->GetFieldData());
+
+    vtkSmartPointer<vtkCompositeDataIterator> cdit;
+    cdit.TakeReference(cd->NewIterator());
+    cdit->SetSkipEmptyNodes(0);
+
+    long q = 0;
+    for (cdit->InitTraversal(); !cdit->IsDoneWithTraversal(); cdit->GoToNextItem())
+      {
+      if (dynamic_cast<vtkDataSet*>(cd->GetDataSet(cdit)))
+        {
+        sampled[q]->GetFieldData()->ShallowCopy(blocks[q]->GetFieldData());
+        cdo->SetDataSet(cdit, sampled[q]);
+        sampled[q]->Delete();
+        ++q;
+        }
+      }
+
+    newEntry.Mesh.TakeReference(cdo);
+    }
+  else
+    {
+    sampled[0]->GetFieldData()->ShallowCopy(blocks[0]->GetFieldData());
+    newEntry.Mesh.TakeReference(sampled[0]);
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::InternalsType::Pass(const std::string &meshName,
+  vtkDataObject *mesh, int association, const std::string &arrayName)
+{
+  Served served;
+  this->GetServed(meshName, served);
+
+  SourceEntry *source = nullptr;
+  SampledEntry *entry = nullptr;
+  if (this->GetSource(served.Source, source) ||
+    this->GetSampled(meshName, entry))
+    return -1;
+
+  std::vector<vtkDataSet*> blocks;
+  getLeaves(source->Mesh, blocks);
+
+  std::vector<vtkDataSet*> outBlocks;
+  getLeaves(mesh, outBlocks);
+
+  long nBlocks = blocks.size();
+  if (static_cast<long>(outBlocks.size()) != nBlocks)
+    {
+    SENSEI_ERROR("The mesh passed does not match mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  TimeEvent<128> mark("SubsamplingDataAdaptor::Gather");
+
+  for (long q = 0; q < nBlocks; ++q)
+    {
+    vtkFieldData *dsa = VTKUtils::GetAttributes(blocks[q], association);
+    vtkFieldData *dsaOut = VTKUtils::GetAttributes(outBlocks[q], association);
+    vtkDataArray *da = dsa ? dsa->GetArray(arrayName.c_str()) : nullptr;
+
+    if (!da || !dsaOut)
+      continue;
+
+    // field data is not reduced
+    if (association == vtkDataObject::FIELD)
+      {
+      dsaOut->AddArray(da);
+      continue;
+      }
+
+    const std::vector<vtkIdType> &ids = association == vtkDataObject::POINT ?
+      entry->PointIds[q] : entry->CellIds[q];
+
+    vtkDataArray *out = gather(da, ids);
+    dsaOut->AddArray(out);
+    out->Delete();
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+senseiNewMacro(SubsamplingDataAdaptor);
+
+//----------------------------------------------------------------------------
+SubsamplingDataAdaptor::SubsamplingDataAdaptor()
+{
+  this->Internals = new InternalsType;
+}
+
+//----------------------------------------------------------------------------
+SubsamplingDataAdaptor::~SubsamplingDataAdaptor()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::GetMode(const std::string &name, int &mode)
+{
+  if (name.empty() || (name == "stride"))
+    mode = MODE_STRIDE;
+  else if (name == "random")
+    mode = MODE_RANDOM;
+  else if (name == "stratified")
+    mode = MODE_STRATIFIED;
+  else
+    return -1;
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+std::string SubsamplingDataAdaptor::GetMeshName(const std::string &meshName,
+  int factor)
+{
+  return meshName + "_sub" + std::to_string(factor);
+}
+
+//----------------------------------------------------------------------------
+void SubsamplingDataAdaptor::SetDataAdaptor(DataAdaptor *data)
+{
+  if (this->Internals->Data == data)
+    return;
+
+  this->Clear();
+  this->Internals->Data = data;
+
+  if (data)
+    this->SetCommunicator(data->GetCommunicator());
+}
+
+//----------------------------------------------------------------------------
+DataAdaptor *SubsamplingDataAdaptor::GetDataAdaptor()
+{
+  return this->Internals->Data;
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::SetFactor(const std::string &meshName,
+  int factor, int mode, unsigned long seed)
+{
+  if ((factor < 1) || (mode < MODE_STRIDE) || (mode > MODE_STRATIFIED))
+    {
+    SENSEI_ERROR("Invalid factor " << factor << " or mode " << mode
+      << " for mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  InternalsType::MeshConfig &config = this->Internals->Configs[meshName];
+  config.Factor = factor;
+  config.Mode = mode;
+  config.Seed = seed;
+
+  this->Clear();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::SetArrayFactor(const std::string &meshName,
+  int association, const std::string &arrayName, int factor)
+{
+  if (factor < 1)
+    {
+    SENSEI_ERROR("Invalid factor " << factor << " for array \""
+      << arrayName << "\" of mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  this->Internals->Configs[meshName].ArrayFactors[
+    std::make_pair(association, arrayName)] = factor;
+
+  this->Clear();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::Initialize(const pugi::xml_node &node)
+{
+  for (pugi::xml_node meshNode = node.child("mesh"); meshNode;
+    meshNode = meshNode.next_sibling("mesh"))
+    {
+    if (XMLUtils::RequireAttribute(meshNode, "name") ||
+      XMLUtils::RequireAttribute(meshNode, "factor"))
+      return -1;
+
+    std::string modeStr = meshNode.attribute("mode").as_string("stride");
+    int mode = MODE_STRIDE;
+    if (GetMode(modeStr, mode))
+      {
+      SENSEI_ERROR("Invalid mode \"" << modeStr << "\". The mode is one of"
+        " stride, random, or stratified")
+      return -1;
+      }
+
+    if (this->SetFactor(meshNode.attribute("name").as_string(),
+      meshNode.attribute("factor").as_int(1), mode,
+      meshNode.attribute("seed").as_ullong(0)))
+      return -1;
+    }
+
+  for (pugi::xml_node arrayNode = node.child("array"); arrayNode;
+    arrayNode = arrayNode.next_sibling("array"))
+    {
+    if (XMLUtils::RequireAttribute(arrayNode, "mesh") ||
+      XMLUtils::RequireAttribute(arrayNode, "name") ||
+      XMLUtils::RequireAttribute(arrayNode, "factor"))
+      return -1;
+
+    int association = vtkDataObject::POINT;
+    if (arrayNode.attribute("association") && VTKUtils::GetAssociation(
+      arrayNode.attribute("association").as_string(), association))
+      return -1;
+
+    if (this->SetArrayFactor(arrayNode.attribute("mesh").as_string(),
+      association, arrayNode.attribute("name").as_string(),
+      arrayNode.attribute("factor").as_int(1)))
+      return -1;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void SubsamplingDataAdaptor::GetSourceRequirements(
+  const DataRequirements &reqs, DataRequirements &sourceReqs)
+{
+  std::vector<std::pair<std::string, InternalsType::Served>> extra;
+  this->Internals->GetExtraMeshes(extra);
+
+  if (extra.empty())
+    {
+    sourceReqs = reqs;
+    return;
+    }
+
+  std::map<std::string, std::string> sources;
+  for (auto &e : extra)
+    sources[e.first] = e.second.Source;
+
+  sourceReqs.Clear();
+
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    auto it = sources.find(mit.MeshName());
+    std::string source = it == sources.end() ? mit.MeshName() : it->second;
+
+    sourceReqs.AddRequirement(source, mit.StructureOnly());
+
+    ArrayRequirementsIterator ait =
+      reqs.GetArrayRequirementsIterator(mit.MeshName());
+    for (; ait; ++ait)
+      sourceReqs.AddRequirement(source, ait.Association(), ait.Array());
+    }
+}
+
+//----------------------------------------------------------------------------
+void SubsamplingDataAdaptor::Clear()
+{
+  this->Internals->Sources.clear();
+  this->Internals->Sampled.clear();
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::GetNumberOfMeshes(unsigned int &numMeshes)
+{
+  if (this->Internals->Data->GetNumberOfMeshes(numMeshes))
+    return -1;
+
+  std::vector<std::pair<std::string, InternalsType::Served>> extra;
+  this->Internals->GetExtraMeshes(extra);
+
+  numMeshes += extra.size();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::GetMeshMetadata(unsigned int id,
+  MeshMetadataPtr &metadata)
+{
+  unsigned int nMeshes = 0;
+  if (this->Internals->Data->GetNumberOfMeshes(nMeshes))
+    return -1;
+
+  // the mesh as served and the id of the mesh it comes from
+  InternalsType::Served served;
+  std::string meshName;
+  unsigned int sourceId = id;
+
+  if (id >= nMeshes)
+    {
+    std::vector<std::pair<std::string, InternalsType::Served>> extra;
+    this->Internals->GetExtraMeshes(extra);
+
+    if (id - nMeshes >= extra.size())
+      {
+      SENSEI_ERROR("Index " << id << " out of bounds")
+      return -1;
+      }
+
+    meshName = extra[id - nMeshes].first;
+    served = extra[id - nMeshes].second;
+
+    MeshMetadataPtr smd;
+    for (sourceId = 0; sourceId < nMeshes; ++sourceId)
+      {
+      if (this->Internals->Data->GetCachedMeshMetadata(sourceId,
+        MeshMetadataFlags(), false, smd))
+        return -1;
+
+      if (smd->MeshName == served.Source)
+        break;
+      }
+
+    if (sourceId == nMeshes)
+      {
+      SENSEI_ERROR("No mesh \"" << served.Source << "\" for the arrays of \""
+        << meshName << "\"")
+      return -1;
+      }
+    }
+
+  if (this->Internals->Data->GetMeshMetadata(sourceId, metadata))
+    return -1;
+
+  if (id < nMeshes)
+    {
+    meshName = metadata->MeshName;
+    this->Internals->GetServed(meshName, served);
+    }
+
+  metadata->MeshName = meshName;
+
+  // arrays with a factor of their own are served by a mesh of their own
+  this->Internals->SelectArrays(served, metadata);
+
+  if (served.Factor == 1)
+    return 0;
+
+  // the structure is that of the reduced blocks
+  InternalsType::SampledEntry *entry = nullptr;
+  if (this->Internals->GetSampled(meshName, entry))
+    return -1;
+
+  MeshMetadataFlags flags = metadata->Flags;
+  flags.ClearBlockArrayRange();
+
+  MeshMetadataPtr smd = MeshMetadata::New(flags);
+  smd->MeshName = meshName;
+
+  vtkDataObject *mesh = entry->Mesh;
+  vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(mesh);
+  vtkDataSet *ds = dynamic_cast<vtkDataSet*>(mesh);
+
+  if ((cd && VTKUtils::GetMetadata(this->GetCommunicator(), cd, smd)) ||
+    (ds && VTKUtils::GetMetadata(this->GetCommunicator(), ds, smd)))
+    {
+    SENSEI_ERROR("Failed to get the metadata of mesh \"" << meshName << "\"")
+    return -1;
+    }
+
+  if (metadata->GlobalView)
+    smd->GlobalizeView(this->GetCommunicator());
+
+  metadata->MeshType = smd->MeshType;
+  metadata->BlockType = smd->BlockType;
+  metadata->NumBlocks = smd->NumBlocks;
+  metadata->NumBlocksLocal = smd->NumBlocksLocal;
+  metadata->Extent = smd->Extent;
+  metadata->Bounds = smd->Bounds;
+  metadata->CoordinateType = smd->CoordinateType;
+  metadata->NumPoints = smd->NumPoints;
+  metadata->NumCells = smd->NumCells;
+  metadata->CellArraySize = smd->CellArraySize;
+  metadata->BlockOwner = smd->BlockOwner;
+  metadata->BlockIds = smd->BlockIds;
+  metadata->BlockNumPoints = smd->BlockNumPoints;
+  metadata->BlockNumCells = smd->BlockNumCells;
+  metadata->BlockCellArraySize = smd->BlockCellArraySize;
+  metadata->BlockExtents = smd->BlockExtents;
+  metadata->BlockBounds = smd->BlockBounds;
+
+  // ghost layers of Cartesian meshes thin with the points
+  if ((metadata->BlockType == VTK_IMAGE_DATA) ||
+    (metadata->BlockType == VTK_UNIFORM_GRID) ||
+    (metadata->BlockType == VTK_RECTILINEAR_GRID) ||
+    (metadata->BlockType == VTK_STRUCTURED_GRID))
+    {
+    int k = served.Factor;
+    metadata->NumGhostCells = (metadata->NumGhostCells + k - 1) / k;
+    metadata->NumGhostNodes = (metadata->NumGhostNodes + k - 1) / k;
+    }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::GetMesh(const std::string &meshName,
+  bool structureOnly, vtkDataObject *&mesh)
+{
+  mesh = nullptr;
+
+  InternalsType::Served served;
+  this->Internals->GetServed(meshName, served);
+
+  if (served.Factor == 1)
+    return this->Internals->Data->GetMesh(meshName, structureOnly, mesh);
+
+  InternalsType::SampledEntry *entry = nullptr;
+  if (this->Internals->GetSampled(meshName, entry))
+    return -1;
+
+  // this rank has no data
+  if (!entry->Mesh)
+    return 0;
+
+  // the caller gets a copy of the structure, the arrays are gathered to it
+  mesh = entry->Mesh->NewInstance();
+  mesh->ShallowCopy(entry->Mesh);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::AddArray(vtkDataObject* mesh,
+  const std::string &meshName, int association, const std::string &arrayName)
+{
+  InternalsType::Served served;
+  this->Internals->GetServed(meshName, served);
+
+  if (!this->Internals->IsServed(served, association, arrayName))
+    {
+    SENSEI_ERROR("The " << VTKUtils::GetAttributesName(association)
+      << " data array \"" << arrayName << "\" is not served on mesh \""
+      << meshName << "\"")
+    return -1;
+    }
+
+  if (served.Factor == 1)
+    return this->Internals->Data->AddArray(mesh, meshName, association, arrayName);
+
+  InternalsType::SourceEntry *source = nullptr;
+  if (this->Internals->GetSource(served.Source, source))
+    return -1;
+
+  if (!source->Mesh || !mesh)
+    return 0;
+
+  std::pair<int, std::string> key(association, arrayName);
+  if (!source->Arrays.count(key))
+    {
+    if (this->Internals->Data->AddArray(source->Mesh, served.Source,
+      association, arrayName))
+      {
+      SENSEI_ERROR("Failed to add " << VTKUtils::GetAttributesName(association)
+        << " data array \"" << arrayName << "\" to mesh \"" << served.Source << "\"")
+      return -1;
+      }
+    source->Arrays.insert(key);
+    }
+
+  return this->Internals->Pass(meshName, mesh, association, arrayName);
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::AddGhostCellsArray(vtkDataObject* mesh,
+  const std::string &meshName)
+{
+  InternalsType::Served served;
+  this->Internals->GetServed(meshName, served);
+
+  if (served.Factor == 1)
+    return this->Internals->Data->AddGhostCellsArray(mesh, meshName);
+
+  InternalsType::SourceEntry *source = nullptr;
+  if (this->Internals->GetSource(served.Source, source))
+    return -1;
+
+  if (!source->Mesh || !mesh)
+    return 0;
+
+  if (!source->GhostCells)
+    {
+    if (this->Internals->Data->AddGhostCellsArray(source->Mesh, served.Source))
+      {
+      SENSEI_ERROR("Failed to add ghost cells to mesh \"" << served.Source << "\"")
+      return -1;
+      }
+    source->GhostCells = true;
+    }
+
+  return this->Internals->Pass(meshName, mesh, vtkDataObject::CELL, "vtkGhostType");
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::AddGhostNodesArray(vtkDataObject* mesh,
+  const std::string &meshName)
+{
+  InternalsType::Served served;
+  this->Internals->GetServed(meshName, served);
+
+  if (served.Factor == 1)
+    return this->Internals->Data->AddGhostNodesArray(mesh, meshName);
+
+  InternalsType::SourceEntry *source = nullptr;
+  if (this->Internals->GetSource(served.Source, source))
+    return -1;
+
+  if (!source->Mesh || !mesh)
+    return 0;
+
+  if (!source->GhostNodes)
+    {
+    if (this->Internals->Data->AddGhostNodesArray(source->Mesh, served.Source))
+      {
+      SENSEI_ERROR("Failed to add ghost nodes to mesh \"" << served.Source << "\"")
+      return -1;
+      }
+    source->GhostNodes = true;
+    }
+
+  return this->Internals->Pass(meshName, mesh, vtkDataObject::POINT, "vtkGhostType");
+}
+
+//----------------------------------------------------------------------------
+double SubsamplingDataAdaptor::GetDataTime()
+{
+  return this->Internals->Data->GetDataTime();
+}
+
+//----------------------------------------------------------------------------
+long SubsamplingDataAdaptor::GetDataTimeStep()
+{
+  return this->Internals->Data->GetDataTimeStep();
+}
+
+//----------------------------------------------------------------------------
+int SubsamplingDataAdaptor::ReleaseData()
+{
+  this->Clear();
+  return this->Internals->Data ? this->Internals->Data->ReleaseData() : 0;
+}
+
+}
@@ -0,0 +1,161 @@
+#ifndef sensei_SubsamplingDataAdaptor_h
+#define sensei_SubsamplingDataAdaptor_h
+
+#include "DataAdaptor.h"
+
+#include <string>
+
+class vtkDataObject;
+namespace pugi { class xml_node; }
+
+namespace sensei
+{
+class DataRequirements;
+
+/// @brief A DataAdaptor that serves reduced resolution copies of another
+/// adaptor's meshes.
+///
+/// Most visualization dumps need a fraction of the simulation's resolution.
+/// A writer or transport given one of these in place of the simulation's
+/// adaptor writes the subsampled meshes, the reduction being made in the
+/// same pass that copies the arrays for the write, on the TaskRuntime's
+/// threads.
+///
+/// The meshes are reduced by an integer factor.
+///
+///   Cartesian   vtkImageData, vtkRectilinearGrid and vtkStructuredGrid
+///               blocks keep the points whose global i, j, and k indices
+///               are multiples of the factor, their extents and spacing or
+///               coordinates are set accordingly, and cells keep the value
+///               of the cell at their first point. Directions in which the
+///               block is one point thick are left as they are. A factor of
+///               2 gives 1/8 of the points in 3D. Neighboring blocks stay
+///               connected when their shared boundary lies on a multiple
+///               of the factor.
+///   particles   vtkPolyData and vtkUnstructuredGrid blocks of points,
+///               with a vertex per point or no cells, keep 1 in factor of
+///               their points. MODE_STRIDE keeps every factor'th,
+///               MODE_RANDOM draws each with probability 1/factor, and
+///               MODE_STRATIFIED draws one at random from each run of
+///               factor points, see Sampling. The draws depend only on the
+///               seed and the block's position so that a point is kept, or
+///               not, in every step.
+///
+/// An array may be given a factor of its own. Since an array's values must
+/// lie on its mesh such arrays are served on a mesh of their own, named
+/// <mesh>_sub<factor>, see GetMeshName, and are not listed on the mesh
+/// itself. The metadata describes the reduced meshes. The array ranges are
+/// those of the full resolution arrays and bound those served.
+///
+/// The reduced meshes are kept until Clear or ReleaseData is called.
+/// Meshes that are not configured are passed through.
+class SubsamplingDataAdaptor : public DataAdaptor
+{
+public:
+  static SubsamplingDataAdaptor *New();
+  senseiTypeMacro(SubsamplingDataAdaptor, DataAdaptor);
+
+  /// the ways particles are selected
+  enum {MODE_STRIDE=0, MODE_RANDOM=1, MODE_STRATIFIED=2};
+
+  /// @brief Convert "stride", "random" or "stratified" to a mode.
+  ///
+  /// @returns zero if successful
+  static int GetMode(const std::string &name, int &mode);
+
+  /// @brief Get the name of the mesh that serves the arrays of a mesh
+  /// reduced by a factor of their own.
+  static std::string GetMeshName(const std::string &meshName, int factor);
+
+  /// @brief Set the adaptor whose meshes are reduced.
+  ///
+  /// Setting a different adaptor clears the reduced meshes. This takes the
+  /// communicator of the wrapped adaptor.
+  void SetDataAdaptor(DataAdaptor *data);
+  DataAdaptor *GetDataAdaptor();
+
+  /// @brief Reduce a mesh by a factor.
+  ///
+  /// @param[in] meshName the mesh to reduce
+  /// @param[in] factor the reduction, in each direction of Cartesian
+  ///                   meshes, 1 passes the mesh through
+  /// @param[in] mode the selection of particles
+  /// @param[in] seed the seed of the random modes
+  /// @returns zero if successful
+  int SetFactor(const std::string &meshName, int factor,
+    int mode = MODE_STRIDE, unsigned long seed = 0);
+
+  /// @brief Reduce an array by a factor of its own.
+  ///
+  /// The array is served on the mesh GetMeshName(meshName, factor), which
+  /// is reduced in the same way as the mesh. A factor equal to the mesh's
+  /// serves the array on the mesh.
+  ///
+  /// @returns zero if successful
+  int SetArrayFactor(const std::string &meshName, int association,
+    const std::string &arrayName, int factor);
+
+  /// @brief Configure from XML.
+  ///
+  ///   <subsample>
+  ///     <mesh name="mesh" factor="2"/>
+  ///     <mesh name="particles" factor="8" mode="stratified" seed="7"/>
+  ///     <array mesh="mesh" name="pressure" association="cell" factor="4"/>
+  ///   </subsample>
+  ///
+  /// mode is stride by default and seed 0. returns zero if successful.
+  int Initialize(const pugi::xml_node &node);
+
+  /// @brief Map requirements on the served meshes to those of the wrapped
+  /// adaptor.
+  ///
+  /// Requirements for the arrays of the meshes that serve arrays reduced
+  /// by a factor of their own become requirements for the mesh they come
+  /// from.
+  void GetSourceRequirements(const DataRequirements &reqs,
+    DataRequirements &sourceReqs);
+
+  /// @brief Release the reduced meshes.
+  void Clear();
+
+  // the meshes of the wrapped adaptor, reduced, followed by those serving
+  // the arrays with factors of their own
+  int GetNumberOfMeshes(unsigned int &numMeshes) override;
+  int GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadata) override;
+
+  int GetMesh(const std::string &meshName, bool structureOnly,
+    vtkDataObject *&mesh) override;
+
+  using DataAdaptor::GetMesh;
+
+  int AddGhostNodesArray(vtkDataObject* mesh,
+    const std::string &meshName) override;
+
+  int AddGhostCellsArray(vtkDataObject* mesh,
+    const std::string &meshName) override;
+
+  int AddArray(vtkDataObject* mesh, const std::string &meshName,
+    int association, const std::string &arrayName) override;
+
+  // forwarded to the wrapped adaptor
+  double GetDataTime() override;
+  long GetDataTimeStep() override;
+
+  /// @brief Clears the reduced meshes and forwards to the wrapped adaptor.
+  int ReleaseData() override;
+
+protected:
+  SubsamplingDataAdaptor();
+  ~SubsamplingDataAdaptor();
+
+private:
+  SubsamplingDataAdaptor(const SubsamplingDataAdaptor&) = delete;
+  void operator=(const SubsamplingDataAdaptor&) = delete;
+
+  struct InternalsType;
+  InternalsType *Internals;
+};
+
+}
+
+#endif
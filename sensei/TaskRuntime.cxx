@@ -0,0 +1,641 @@
+#include "TaskRuntime.h"
+#include "Error.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+using Task = std::function<void()>;
+
+// a worker and its deque. the owner pushes and pops at the back, thieves
+// take from the front
+struct Worker
+{
+  std::mutex Mutex;
+  std::deque<Task> Tasks;
+  std::thread Thread;
+};
+
+// the index of the calling thread's worker, -1 off the pool
+thread_local int workerId = -1;
+
+// --------------------------------------------------------------------------
+// parse a list of cores such as 0,4-7. returns zero if successful
+int ParseCoreList(const std::string &list, std::vector<int> &cores)
+{
+  std::istringstream iss(list);
+  std::string item;
+  while (std::getline(iss, item, ','))
+    {
+    if (item.find_first_not_of(" \t\n") == std::string::npos)
+      continue;
+
+    int first = 0;
+    int last = 0;
+    char dash = 0;
+    std::istringstream is(item);
+    if (!(is >> first))
+      return -1;
+
+    last = first;
+    if ((is >> dash) && ((dash != '-') || !(is >> last)))
+      return -1;
+
+    if ((first < 0) || (last < first))
+      return -1;
+
+    for (int i = first; i <= last; ++i)
+      cores.push_back(i);
+    }
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+// read a core list or a number from sysfs. returns zero if successful
+int ReadCoreList(int cpu, const char *file, std::vector<int> &cores)
+{
+  std::ostringstream path;
+  path << "/sys/devices/system/cpu/cpu" << cpu << "/topology/" << file;
+
+  std::ifstream ifs(path.str());
+  std::string list;
+  if (!std::getline(ifs, list))
+    return -1;
+
+  return ParseCoreList(list, cores);
+}
+
+// --------------------------------------------------------------------------
+// get the cores this process may run on
+void GetAllowedCores(std::vector<int> &cores)
+{
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+    for (int i = 0; i < CPU_SETSIZE; ++i)
+      {
+      if (CPU_ISSET(i, &allowed))
+        cores.push_back(i);
+      }
+    }
+#else
+  (void)cores;
+#endif
+}
+
+// --------------------------------------------------------------------------
+// get the cores of the given policy, of those the process may run on
+void GetPolicyCores(int affinity, const std::string &reserved,
+  std::vector<int> &cores)
+{
+  std::vector<int> allowed;
+  GetAllowedCores(allowed);
+
+  if (affinity == sensei::TaskRuntime::AFFINITY_RESERVED)
+    {
+    if (!reserved.empty())
+      {
+      std::vector<int> listed;
+      if (ParseCoreList(reserved, listed))
+        {
+        SENSEI_WARNING("Invalid list of reserved cores \"" << reserved << "\"")
+        return;
+        }
+
+      for (int core : listed)
+        {
+        if (std::find(allowed.begin(), allowed.end(), core) != allowed.end())
+          cores.push_back(core);
+        }
+      return;
+      }
+
+    // the last core of each socket, in the order of the sockets
+    std::vector<int> sockets;
+    for (int core : allowed)
+      {
+      std::vector<int> socket;
+      if (ReadCoreList(core, "physical_package_id", socket) || socket.empty())
+        socket.assign(1, 0);
+
+      std::vector<int>::iterator it =
+        std::find(sockets.begin(), sockets.end(), socket[0]);
+
+      if (it == sockets.end())
+        {
+        sockets.push_back(socket[0]);
+        cores.push_back(core);
+        }
+      else
+        {
+        cores[it - sockets.begin()] = core;
+        }
+      }
+    }
+  else if (affinity == sensei::TaskRuntime::AFFINITY_SMT)
+    {
+    // the hardware threads that are not the first of their core
+    for (int core : allowed)
+      {
+      std::vector<int> siblings;
+      if (!ReadCoreList(core, "thread_siblings_list", siblings) &&
+        !siblings.empty() && (siblings[0] != core))
+        cores.push_back(core);
+      }
+    }
+  else
+    {
+    cores.swap(allowed);
+    }
+}
+
+// --------------------------------------------------------------------------
+// bind the calling thread to the cores. returns zero if successful
+int BindCores(const std::vector<int> &cores)
+{
+#if defined(__linux__)
+  if (cores.empty())
+    return -1;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int core : cores)
+    CPU_SET(core, &set);
+
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) ? -1 : 0;
+#else
+  (void)cores;
+  return -1;
+#endif
+}
+
+// --------------------------------------------------------------------------
+// log the cpu the calling thread runs on
+void LogPlacement(const std::string &stage)
+{
+#if defined(__linux__)
+  int cpu = sched_getcpu();
+  if (cpu >= 0)
+    sensei::Profiler::LogCounter((stage + "::cpu").c_str(), cpu);
+#else
+  (void)stage;
+#endif
+}
+
+struct Pool
+{
+  Pool() : NumThreads(0), Affinity(sensei::TaskRuntime::AFFINITY_NONE),
+    Configured(false), Running(false), Stop(false), Pending(0), Next(0) {}
+
+  ~Pool() { this->Shutdown(); }
+
+  // apply the environment and the defaults
+  void Configure(int nThreads, int affinity, const std::string &reserved);
+
+  // start the workers if they are not running
+  void Start();
+
+  // stop the workers once the queued tasks have run
+  void Shutdown();
+
+  void Push(Task &&task);
+  bool Pop(int id, Task &task);
+  void Run(int id);
+
+  // binds the calling thread, the id'th worker, to a core
+  void Bind(int id);
+
+  std::mutex StateMutex;   // serializes Start, Shutdown, and Configure
+  int NumThreads;          // including the calling thread
+  int Affinity;
+  std::vector<int> Cores;  // of the affinity policy
+  bool Configured;
+  bool Running;
+
+  std::vector<std::unique_ptr<Worker>> Workers;
+  std::mutex WaitMutex;
+  std::condition_variable WakeUp;
+  bool Stop;
+  std::atomic<long> Pending;  // tasks in the deques
+  std::atomic<unsigned int> Next; // deque for tasks pushed off the pool
+};
+
+Pool &GetPool()
+{
+  static Pool pool;
+  return pool;
+}
+
+// --------------------------------------------------------------------------
+void Pool::Configure(int nThreads, int affinity, const std::string &reserved)
+{
+  const char *env = getenv("SENSEI_NUM_THREADS");
+  if (env)
+    nThreads = atoi(env);
+
+  env = getenv("SENSEI_THREAD_AFFINITY");
+  if (env && sensei::TaskRuntime::GetAffinity(env, affinity))
+    {
+    SENSEI_WARNING("Invalid SENSEI_THREAD_AFFINITY \"" << env
+      << "\". Use one of inherit, compact, scatter, reserved, or smt")
+    affinity = sensei::TaskRuntime::AFFINITY_NONE;
+    }
+
+  env = getenv("SENSEI_RESERVED_CORES");
+  std::string reservedCores = env ? env : reserved;
+
+  this->Cores.clear();
+  if (affinity != sensei::TaskRuntime::AFFINITY_NONE)
+    GetPolicyCores(affinity, reservedCores, this->Cores);
+
+  // the reserved and smt policies fall back to the OS when the node has
+  // no such cores, rather than piling the workers on a few of them
+  bool dedicated = (affinity == sensei::TaskRuntime::AFFINITY_RESERVED) ||
+    (affinity == sensei::TaskRuntime::AFFINITY_SMT);
+
+  if (dedicated && this->Cores.empty())
+    {
+    SENSEI_WARNING("No cores for the " << sensei::TaskRuntime::GetAffinityName(affinity)
+      << " affinity policy. The threads inherit the process' affinity")
+    affinity = sensei::TaskRuntime::AFFINITY_NONE;
+    }
+
+  // the calling thread belongs to the simulation, the workers get one
+  // core each of the dedicated ones
+  if (nThreads < 1)
+    nThreads = dedicated && !this->Cores.empty() ? this->Cores.size() + 1 :
+      std::max(1u, std::thread::hardware_concurrency());
+
+  this->NumThreads = nThreads;
+  this->Affinity = affinity;
+  this->Configured = true;
+}
+
+// --------------------------------------------------------------------------
+void Pool::Start()
+{
+  std::lock_guard<std::mutex> lock(this->StateMutex);
+
+  if (this->Running)
+    return;
+
+  if (!this->Configured)
+    this->Configure(0, sensei::TaskRuntime::AFFINITY_NONE, "");
+
+  this->Stop = false;
+
+  // the calling thread is one of the threads
+  int nWorkers = this->NumThreads - 1;
+  for (int i = 0; i < nWorkers; ++i)
+    this->Workers.emplace_back(new Worker);
+
+  for (int i = 0; i < nWorkers; ++i)
+    this->Workers[i]->Thread = std::thread(&Pool::Run, this, i);
+
+  this->Running = true;
+}
+
+// --------------------------------------------------------------------------
+void Pool::Shutdown()
+{
+  std::lock_guard<std::mutex> lock(this->StateMutex);
+
+  if (!this->Running)
+    return;
+
+  {
+  std::lock_guard<std::mutex> wlock(this->WaitMutex);
+  this->Stop = true;
+  }
+  this->WakeUp.notify_all();
+
+  unsigned int nWorkers = this->Workers.size();
+  for (unsigned int i = 0; i < nWorkers; ++i)
+    this->Workers[i]->Thread.join();
+
+  this->Workers.clear();
+  this->Running = false;
+}
+
+// --------------------------------------------------------------------------
+void Pool::Push(Task &&task)
+{
+  // with a single thread there are no workers, run it now
+  int nWorkers = this->Workers.size();
+  if (nWorkers == 0)
+    {
+    task();
+    return;
+    }
+
+  int id = workerId >= 0 ? workerId : this->Next++ % nWorkers;
+
+  Worker *w = this->Workers[id].get();
+  {
+  std::lock_guard<std::mutex> lock(w->Mutex);
+  w->Tasks.push_back(std::move(task));
+  }
+
+  ++this->Pending;
+
+  // the lock orders the notification after a waiting worker's test of
+  // Pending, otherwise it could miss it
+  {
+  std::lock_guard<std::mutex> lock(this->WaitMutex);
+  }
+  this->WakeUp.notify_one();
+}
+
+// --------------------------------------------------------------------------
+bool Pool::Pop(int id, Task &task)
+{
+  // look in our own deque first
+  Worker *w = this->Workers[id].get();
+  {
+  std::lock_guard<std::mutex> lock(w->Mutex);
+  if (!w->Tasks.empty())
+    {
+    task = std::move(w->Tasks.back());
+    w->Tasks.pop_back();
+    --this->Pending;
+    return true;
+    }
+  }
+
+  // steal, starting with our neighbor so that thieves spread out
+  int nWorkers = this->Workers.size();
+  for (int i = 1; i < nWorkers; ++i)
+    {
+    Worker *v = this->Workers[(id + i) % nWorkers].get();
+    std::lock_guard<std::mutex> lock(v->Mutex);
+    if (!v->Tasks.empty())
+      {
+      task = std::move(v->Tasks.front());
+      v->Tasks.pop_front();
+      --this->Pending;
+      return true;
+      }
+    }
+
+  return false;
+}
+
+// --------------------------------------------------------------------------
+void Pool::Run(int id)
+{
+  workerId = id;
+  this->Bind(id);
+  LogPlacement("TaskRuntime::Worker");
+
+  while (true)
+    {
+    Task task;
+    if (this->Pop(id, task))
+      {
+      task();
+      continue;
+      }
+
+    // sleep until there is work. the queued tasks are run before stopping
+    std::unique_lock<std::mutex> lock(this->WaitMutex);
+    if (this->Stop && (this->Pending.load() == 0))
+      break;
+
+    this->WakeUp.wait(lock, [this]()
+      { return this->Stop || (this->Pending.load() > 0); });
+    }
+
+  workerId = -1;
+}
+
+// --------------------------------------------------------------------------
+void Pool::Bind(int id)
+{
+  int nCores = this->Cores.size();
+  if ((this->Affinity == sensei::TaskRuntime::AFFINITY_NONE) || (nCores < 1))
+    return;
+
+  int core = 0;
+  if ((this->Affinity == sensei::TaskRuntime::AFFINITY_RESERVED) ||
+    (this->Affinity == sensei::TaskRuntime::AFFINITY_SMT))
+    {
+    // the calling thread is not on these cores, worker i gets the i'th
+    core = id % nCores;
+    }
+  else
+    {
+    if (nCores < 2)
+      return;
+
+    // the calling thread, usually on the first core, is thread 0
+    int thread = id + 1;
+    core = this->Affinity == sensei::TaskRuntime::AFFINITY_COMPACT ?
+      thread % nCores : (static_cast<long>(thread)*nCores/this->NumThreads) % nCores;
+    }
+
+  BindCores(std::vector<int>(1, this->Cores[core]));
+}
+
+// the state shared by the threads of a ParallelFor. helpers that start
+// after the items are exhausted find nothing to do and only touch this,
+// hence it is reference counted
+struct ForState
+{
+  ForState(long n, const sensei::TaskRuntime::ParallelFunction *func) :
+    N(n), Func(func), Next(0), Status(0), Active(0) {}
+
+  // claim and process items until they are exhausted or one fails
+  void Work(int thread)
+  {
+    long i;
+    while ((this->Status.load() == 0) && ((i = this->Next.fetch_add(1)) < this->N))
+      {
+      int ret = (*this->Func)(thread, i);
+      if (ret)
+        {
+        // keep an error over a request to stop
+        int ok = 0;
+        if (!this->Status.compare_exchange_strong(ok, ret) && (ret < 0))
+          this->Status.store(ret);
+        }
+      }
+  }
+
+  long N;
+  const sensei::TaskRuntime::ParallelFunction *Func;
+  std::atomic<long> Next;
+  std::atomic<int> Status;
+  std::atomic<int> Active;
+  std::mutex Mutex;
+  std::condition_variable Done;
+};
+}
+
+namespace sensei
+{
+
+// --------------------------------------------------------------------------
+int TaskRuntime::Initialize(int nThreads, int affinity,
+  const std::string &reservedCores)
+{
+  if ((affinity < AFFINITY_NONE) || (affinity > AFFINITY_SMT))
+    {
+    SENSEI_ERROR("Invalid affinity " << affinity)
+    return -1;
+    }
+
+  Pool &pool = GetPool();
+  pool.Shutdown();
+
+  std::lock_guard<std::mutex> lock(pool.StateMutex);
+  pool.Configure(nThreads, affinity, reservedCores);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+void TaskRuntime::BindThread(const char *stage)
+{
+  Pool &pool = GetPool();
+  {
+  std::lock_guard<std::mutex> lock(pool.StateMutex);
+  if (!pool.Configured)
+    pool.Configure(0, AFFINITY_NONE, "");
+
+  // the stage may use any of the dedicated cores and shares them with
+  // the workers
+  if ((pool.Affinity == AFFINITY_RESERVED) || (pool.Affinity == AFFINITY_SMT))
+    BindCores(pool.Cores);
+  }
+
+  LogPlacement(stage);
+}
+
+// --------------------------------------------------------------------------
+void TaskRuntime::Finalize()
+{
+  GetPool().Shutdown();
+}
+
+// --------------------------------------------------------------------------
+int TaskRuntime::GetNumberOfThreads()
+{
+  Pool &pool = GetPool();
+  std::lock_guard<std::mutex> lock(pool.StateMutex);
+  if (!pool.Configured)
+    pool.Configure(0, AFFINITY_NONE, "");
+  return pool.NumThreads;
+}
+
+// --------------------------------------------------------------------------
+const char *TaskRuntime::GetAffinityName(int affinity)
+{
+  switch (affinity)
+    {
+    case AFFINITY_NONE: return "inherit";
+    case AFFINITY_COMPACT: return "compact";
+    case AFFINITY_SCATTER: return "scatter";
+    case AFFINITY_RESERVED: return "reserved";
+    case AFFINITY_SMT: return "smt";
+    }
+  return "unknown";
+}
+
+// --------------------------------------------------------------------------
+int TaskRuntime::GetAffinity(const char *name, int &affinity)
+{
+  if ((strcmp(name, "inherit") == 0) || (strcmp(name, "none") == 0))
+    affinity = AFFINITY_NONE;
+  else if (strcmp(name, "compact") == 0)
+    affinity = AFFINITY_COMPACT;
+  else if (strcmp(name, "scatter") == 0)
+    affinity = AFFINITY_SCATTER;
+  else if (strcmp(name, "reserved") == 0)
+    affinity = AFFINITY_RESERVED;
+  else if (strcmp(name, "smt") == 0)
+    affinity = AFFINITY_SMT;
+  else
+    return -1;
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+void TaskRuntime::Submit(const std::function<void()> &task)
+{
+  Pool &pool = GetPool();
+  pool.Start();
+
+  Task t(task);
+  pool.Push(std::move(t));
+}
+
+// --------------------------------------------------------------------------
+int TaskRuntime::ParallelFor(long n, int maxThreads,
+  const ParallelFunction &func)
+{
+  int nThreads = GetNumberOfThreads();
+  if (maxThreads > 0)
+    nThreads = std::min(nThreads, maxThreads);
+  nThreads = std::max(1l, std::min(static_cast<long>(nThreads), n));
+
+  if (nThreads == 1)
+    {
+    for (long i = 0; i < n; ++i)
+      {
+      int ret = func(0, i);
+      if (ret)
+        return ret;
+      }
+    return 0;
+    }
+
+  std::shared_ptr<ForState> state(new ForState(n, &func));
+
+  Pool &pool = GetPool();
+  pool.Start();
+
+  for (int t = 1; t < nThreads; ++t)
+    {
+    pool.Push([state, t]()
+      {
+      // counted before claiming an item so that the caller, which has
+      // seen the items exhausted, waits for any helper that holds one
+      ++state->Active;
+      state->Work(t);
+      if (--state->Active == 0)
+        {
+        std::lock_guard<std::mutex> lock(state->Mutex);
+        state->Done.notify_all();
+        }
+      });
+    }
+
+  state->Work(0);
+
+  std::unique_lock<std::mutex> lock(state->Mutex);
+  state->Done.wait(lock, [&state]() { return state->Active.load() == 0; });
+
+  return state->Status.load();
+}
+
+}
@@ -0,0 +1,107 @@
+#ifndef sensei_TaskRuntime_h
+#define sensei_TaskRuntime_h
+
+#include <functional>
+#include <string>
+
+namespace sensei
+{
+
+/// @class TaskRuntime
+/// @brief the process wide pool of threads shared by SENSEI's analyses.
+///
+/// Analyses, writers and readers that parallelize their work on threads
+/// schedule it on this runtime rather than starting threads of their own.
+/// When several analyses each assume that the whole node is theirs the
+/// node is oversubscribed, with one pool the number of threads that do
+/// work is bounded by the configured size no matter how many analyses run.
+///
+/// The runtime is a work stealing pool. Each worker has a deque of tasks,
+/// tasks submitted from a worker go to its own deque and idle workers
+/// steal from the others. The workers are started on first use. The size
+/// and the binding of the workers to cores are set once, by Initialize,
+/// the threads, thread_affinity and reserved_cores attributes of
+/// ConfigurableAnalysis' sensei element, or the environment:
+///
+///   SENSEI_NUM_THREADS     : number of threads, including the calling
+///                            thread. default: hardware concurrency, or
+///                            one more than the number of cores of the
+///                            reserved and smt policies
+///   SENSEI_THREAD_AFFINITY : inherit, compact, scatter, reserved, or smt.
+///                            see the AFFINITY enum
+///   SENSEI_RESERVED_CORES  : the cores of the reserved policy, a list
+///                            such as 0,16-17. default: the last core of
+///                            each socket
+///
+/// The reserved and smt policies apply to the threads of asynchronous
+/// stages too, such as asynchronous analyses and writers, which call
+/// BindThread when they start. When the profiler is enabled each bound
+/// thread logs the cpu it runs on as a counter named <stage>::cpu, the
+/// workers as TaskRuntime::Worker::cpu.
+///
+/// Threads that block for long periods, such as those of asynchronous
+/// writers or of data adaptors issuing collectives on their own
+/// communicators, are not run on the pool since they would hold a worker
+/// and could deadlock when the pool is smaller than the number of them.
+class TaskRuntime
+{
+public:
+  /// how the workers are bound to the cores the process may run on.
+  /// AFFINITY_NONE (inherit) leaves them to the OS within the process'
+  /// mask, AFFINITY_COMPACT binds worker i to the i'th core after the
+  /// first, and AFFINITY_SCATTER spreads them evenly over the cores. These
+  /// keep the workers within the cores, and hence the NUMA domain, that the
+  /// launcher gave the rank. AFFINITY_RESERVED binds the workers to a set
+  /// of cores set aside for in situ work, so that they stay off the cores
+  /// of an OpenMP simulation. AFFINITY_SMT binds them to the second
+  /// hardware threads of the rank's cores, for simulations that run one
+  /// thread per core.
+  enum {AFFINITY_NONE=0, AFFINITY_COMPACT=1, AFFINITY_SCATTER=2,
+    AFFINITY_RESERVED=3, AFFINITY_SMT=4};
+
+  /// Set the number of threads and their affinity. nThreads includes the
+  /// calling thread, which takes part in ParallelFor, < 1 selects the
+  /// default. reservedCores lists the cores of AFFINITY_RESERVED, an
+  /// empty list selects the last core of each socket. The environment
+  /// variables override the arguments. If the workers are running they
+  /// are stopped, after their tasks complete, and restarted on next use.
+  /// returns zero if successful.
+  static int Initialize(int nThreads, int affinity = AFFINITY_NONE,
+    const std::string &reservedCores = "");
+
+  /// Bind the calling thread, the thread of an asynchronous stage, to the
+  /// cores of the reserved or smt policy. With other policies the thread
+  /// keeps the process' mask. The placement is logged as <stage>::cpu.
+  static void BindThread(const char *stage);
+
+  /// Stop the workers after the queued tasks complete.
+  static void Finalize();
+
+  /// get the number of threads, including the calling thread
+  static int GetNumberOfThreads();
+
+  /// get the affinity name from its enum, or the enum from its name.
+  /// GetAffinity returns zero if successful.
+  static const char *GetAffinityName(int affinity);
+  static int GetAffinity(const char *name, int &affinity);
+
+  /// run the task on a worker. the task must not throw
+  static void Submit(const std::function<void()> &task);
+
+  /// callback that processes item i on one of several threads. thread is
+  /// in [0, nThreads) and lets the callback keep per thread state. return
+  /// 0 for success, > zero to stop without error, < zero to stop with error
+  using ParallelFunction = std::function<int(int thread, long i)>;
+
+  /// Calls the function for items 0 through n-1 on at most maxThreads
+  /// threads, < 1 uses all of them. The calling thread takes part, hence
+  /// a ParallelFor may be nested in the task of another. Items are claimed
+  /// one at a time so that items of uneven cost balance. returns the first
+  /// non zero value returned by the function, negative values taking
+  /// precedence, or zero.
+  static int ParallelFor(long n, int maxThreads, const ParallelFunction &func);
+};
+
+}
+
+#endif
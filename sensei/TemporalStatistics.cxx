@@ -0,0 +1,760 @@
+#include "TemporalStatistics.h"
+#include "DataAdaptor.h"
+#include "PartialResultsDataAdaptor.h"
+#include "Profiler.h"
+#include "TaskRuntime.h"
+#include "TemporalWindow.h"
+#include "VTKUtils.h"
+#include "Error.h"
+
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataObject.h>
+#include <vtkDataSet.h>
+#include <vtkFieldData.h>
+#include <vtkFloatArray.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+// values are processed in ranges of this size
+const long rangeSize = 65536;
+
+// the number of statistics, in the order of their flags
+const int numStats = 5;
+
+// the running sums of the differences of the values of a block from those
+// of the step the sums were started at
+struct BlockSums
+{
+  int BlockId;
+  long NumValues;
+  std::vector<float> Ref;
+  std::vector<double> Sum;
+  std::vector<double> SumSq;
+};
+
+// the ranges of the statistics over the values of a part of a block
+struct StatRanges
+{
+  StatRanges()
+  {
+    for (int s = 0; s < numStats; ++s)
+      {
+      this->Min[s] = std::numeric_limits<double>::max();
+      this->Max[s] = std::numeric_limits<double>::lowest();
+      }
+  }
+
+  void Merge(const StatRanges &o)
+  {
+    for (int s = 0; s < numStats; ++s)
+      {
+      this->Min[s] = std::min(this->Min[s], o.Min[s]);
+      this->Max[s] = std::max(this->Max[s], o.Max[s]);
+      }
+  }
+
+  double Min[numStats];
+  double Max[numStats];
+};
+
+// get the values [begin, end) of a block lag steps back, in place when
+// stored as floats or decoded to the buffer
+const float *getValues(const sensei::TemporalWindow &history, int blockId,
+  unsigned int lag, long begin, long end, std::vector<float> &buffer)
+{
+  if (const float *vals = history.GetValues(blockId, lag))
+    return vals + begin;
+
+  buffer.resize(end - begin);
+  history.GetValues(blockId, lag, begin, end, buffer.data());
+  return buffer.data();
+}
+}
+
+namespace sensei
+{
+
+struct TemporalStatistics::InternalsType
+{
+  InternalsType() : Window(10), Stats(STAT_ALL),
+    Storage(TemporalWindow::STORAGE_FLOAT), Threads(1), Publish(0) {}
+
+  // the state of the statistics of an array
+  struct ArrayState
+  {
+    ArrayState() : Association(vtkDataObject::POINT), LastStep(-1),
+      LastTime(0.0), NumSummed(0) {}
+
+    std::string MeshName;
+    std::string ArrayName;
+    int Association;
+    TemporalWindowPtr History;
+
+    // the step the sums were last updated at, and the number of steps
+    // they cover
+    long LastStep;
+    double LastTime;
+    unsigned int NumSummed;
+    std::vector<BlockSums> Blocks;
+  };
+
+  // bring the running sums up to the latest step of the window
+  int UpdateSums(ArrayState &as, const std::vector<ArrayView> &views);
+
+  // compute the statistics of a block. when publishing, out holds an
+  // array for each statistic computed
+  void ComputeBlock(const ArrayState &as, const ArrayView &view,
+    const BlockSums &sums, float **out, StatRanges &ranges);
+
+  std::vector<ArrayState> Arrays;
+  unsigned int Window;
+  int Stats;
+  int Storage;
+  int Threads;
+  int Publish;
+  std::string FileName;
+};
+
+//-----------------------------------------------------------------------------
+int TemporalStatistics::InternalsType::UpdateSums(ArrayState &as,
+  const std::vector<ArrayView> &views)
+{
+  const TemporalWindow &history = *as.History;
+  unsigned int nHeld = history.GetNumberOfSteps();
+  unsigned int nViews = views.size();
+
+  // the sums are updated in place when they were made at the step before
+  // this one on the same blocks, and are otherwise started over
+  bool incremental = as.NumSummed && (nHeld > 1) &&
+    (history.GetTimeStep(1) == as.LastStep) &&
+    (history.GetTime(1) == as.LastTime) && (nViews == as.Blocks.size());
+
+  for (unsigned int i = 0; incremental && (i < nViews); ++i)
+    incremental = (as.Blocks[i].BlockId == views[i].BlockId) &&
+      (as.Blocks[i].NumValues == views[i].NumTuples);
+
+  // the step leaving the window, if it is full
+  unsigned int nSum = std::min(nHeld, this->Window);
+  bool remove = incremental && (as.NumSummed == this->Window);
+
+  if (!incremental)
+    {
+    as.Blocks.resize(nViews);
+    for (unsigned int i = 0; i < nViews; ++i)
+      {
+      BlockSums &bs = as.Blocks[i];
+      bs.BlockId = views[i].BlockId;
+      bs.NumValues = views[i].NumTuples;
+      bs.Ref.resize(bs.NumValues);
+      bs.Sum.assign(bs.NumValues, 0.0);
+      bs.SumSq.assign(bs.NumValues, 0.0);
+      }
+    }
+
+  for (unsigned int i = 0; i < nViews; ++i)
+    {
+    BlockSums &bs = as.Blocks[i];
+    int bid = bs.BlockId;
+
+    if (history.GetNumberOfValues(bid) != bs.NumValues)
+      {
+      SENSEI_ERROR("Block " << bid << " of \"" << as.ArrayName
+        << "\" is not held by the history")
+      as.NumSummed = 0;
+      return -1;
+      }
+
+    long nRanges = (bs.NumValues + rangeSize - 1)/rangeSize;
+    TaskRuntime::ParallelFor(nRanges, this->Threads,
+      [&](int, long r) -> int
+      {
+      long begin = r*rangeSize;
+      long end = std::min(bs.NumValues, begin + rangeSize);
+      long len = end - begin;
+
+      float *ref = bs.Ref.data() + begin;
+      double *sum = bs.Sum.data() + begin;
+      double *sumSq = bs.SumSq.data() + begin;
+
+      std::vector<float> buffer;
+
+      if (!incremental)
+        {
+        // the differences are taken from the latest values
+        const float *cur = getValues(history, bid, 0, begin, end, buffer);
+        std::copy(cur, cur + len, ref);
+
+        for (unsigned int lag = 1; lag < nSum; ++lag)
+          {
+          const float *vals = getValues(history, bid, lag, begin, end, buffer);
+          for (long k = 0; k < len; ++k)
+            {
+            double d = double(vals[k]) - double(ref[k]);
+            sum[k] += d;
+            sumSq[k] += d*d;
+            }
+          }
+        return 0;
+        }
+
+      const float *cur = getValues(history, bid, 0, begin, end, buffer);
+      for (long k = 0; k < len; ++k)
+        {
+        double d = double(cur[k]) - double(ref[k]);
+        sum[k] += d;
+        sumSq[k] += d*d;
+        }
+
+      if (remove)
+        {
+        const float *old = getValues(history, bid, this->Window, begin,
+          end, buffer);
+        for (long k = 0; k < len; ++k)
+          {
+          double d = double(old[k]) - double(ref[k]);
+          sum[k] -= d;
+          sumSq[k] -= d*d;
+          }
+        }
+
+      return 0;
+      });
+    }
+
+  as.NumSummed = incremental ?
+    std::min(as.NumSummed + 1, this->Window) : nSum;
+  as.LastStep = history.GetTimeStep(0);
+  as.LastTime = history.GetTime(0);
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void TemporalStatistics::InternalsType::ComputeBlock(const ArrayState &as,
+  const ArrayView &view, const BlockSums &sums, float **out,
+  StatRanges &ranges)
+{
+  const TemporalWindow &history = *as.History;
+  int bid = sums.BlockId;
+  int stats = this->Stats;
+  unsigned int nSum = as.NumSummed;
+  double n = nSum;
+
+  // the derivative is taken over the last two steps
+  unsigned int nHeld = history.GetNumberOfSteps();
+  double dt = 0.0;
+  if (nHeld > 1)
+    {
+    dt = history.GetTime(0) - history.GetTime(1);
+    if (dt == 0.0)
+      dt = history.GetTimeStep(0) - history.GetTimeStep(1);
+    }
+  double invDt = dt != 0.0 ? 1.0/dt : 0.0;
+
+  // the ghost zones of Cartesian blocks are described by index ranges
+  VTKUtils::InteriorRange interiorRange;
+  const VTKUtils::InteriorRange *interior = !view.Ghosts &&
+    !VTKUtils::GetInteriorRange(view, interiorRange) ? &interiorRange : nullptr;
+
+  long nRanges = (sums.NumValues + rangeSize - 1)/rangeSize;
+  std::vector<StatRanges> rangeResults(nRanges);
+
+  TaskRuntime::ParallelFor(nRanges, this->Threads,
+    [&](int, long r) -> int
+    {
+    long begin = r*rangeSize;
+    long end = std::min(sums.NumValues, begin + rangeSize);
+    long len = end - begin;
+
+    // the values that are not ghosts
+    std::vector<unsigned char> owned(len, 1);
+    if (view.Ghosts)
+      {
+      for (long k = 0; k < len; ++k)
+        owned[k] = !view.Ghosts[begin + k];
+      }
+    else if (interior)
+      {
+      interior->ForEachSpan(begin, end,
+        [&](long b, long e, bool isInterior)
+        {
+        if (!isInterior)
+          std::fill(owned.begin() + (b - begin), owned.begin() + (e - begin), 0);
+        });
+      }
+
+    std::vector<float> stat[numStats];
+    std::vector<float> buffer;
+
+    if (stats & (STAT_MEAN | STAT_VARIANCE))
+      {
+      const float *ref = sums.Ref.data() + begin;
+      const double *sum = sums.Sum.data() + begin;
+      const double *sumSq = sums.SumSq.data() + begin;
+
+      stat[0].resize(len);
+      stat[1].resize(len);
+      for (long k = 0; k < len; ++k)
+        {
+        double m = sum[k]/n;
+        stat[0][k] = ref[k] + m;
+        stat[1][k] = std::max(0.0, sumSq[k]/n - m*m);
+        }
+      }
+
+    if (stats & (STAT_MIN | STAT_MAX))
+      {
+      const float *cur = getValues(history, bid, 0, begin, end, buffer);
+      stat[2].assign(cur, cur + len);
+      stat[3].assign(cur, cur + len);
+      for (unsigned int lag = 1; lag < nSum; ++lag)
+        {
+        const float *vals = getValues(history, bid, lag, begin, end, buffer);
+        for (long k = 0; k < len; ++k)
+          {
+          stat[2][k] = std::min(stat[2][k], vals[k]);
+          stat[3][k] = std::max(stat[3][k], vals[k]);
+          }
+        }
+      }
+
+    if (stats & STAT_DERIVATIVE)
+      {
+      stat[4].assign(len, 0.0f);
+      if (nHeld > 1)
+        {
+        const float *cur = getValues(history, bid, 0, begin, end, buffer);
+        stat[4].assign(cur, cur + len);
+        const float *prev = getValues(history, bid, 1, begin, end, buffer);
+        for (long k = 0; k < len; ++k)
+          stat[4][k] = (stat[4][k] - prev[k])*invDt;
+        }
+      }
+
+    StatRanges &sr = rangeResults[r];
+    for (int s = 0, j = 0; s < numStats; ++s)
+      {
+      if (!(stats & (1 << s)))
+        continue;
+
+      const float *vals = stat[s].data();
+      for (long k = 0; k < len; ++k)
+        {
+        if (owned[k])
+          {
+          sr.Min[s] = std::min(sr.Min[s], double(vals[k]));
+          sr.Max[s] = std::max(sr.Max[s], double(vals[k]));
+          }
+        }
+
+      if (out)
+        std::copy(vals, vals + len, out[j] + begin);
+
+      ++j;
+      }
+
+    return 0;
+    });
+
+  for (long r = 0; r < nRanges; ++r)
+    ranges.Merge(rangeResults[r]);
+}
+
+//-----------------------------------------------------------------------------
+senseiNewMacro(TemporalStatistics);
+
+//-----------------------------------------------------------------------------
+TemporalStatistics::TemporalStatistics() : Internals(new InternalsType)
+{
+}
+
+//-----------------------------------------------------------------------------
+TemporalStatistics::~TemporalStatistics()
+{
+  delete this->Internals;
+}
+
+//-----------------------------------------------------------------------------
+int TemporalStatistics::GetStatistics(const std::string &names, int &stats)
+{
+  stats = 0;
+
+  std::istringstream iss(names);
+  std::string name;
+  while (std::getline(iss, name, ','))
+    {
+    name.erase(0, name.find_first_not_of(" \t"));
+    name.erase(name.find_last_not_of(" \t") + 1);
+
+    if (name == "all")
+      {
+      stats |= STAT_ALL;
+      continue;
+      }
+
+    int s = 0;
+    for (; s < numStats; ++s)
+      {
+      if (name == GetStatisticName(1 << s))
+        break;
+      }
+
+    if (s == numStats)
+      {
+      SENSEI_ERROR("Invalid statistic \"" << name << "\". Use mean,"
+        " variance, min, max, ddt or all")
+      return -1;
+      }
+
+    stats |= 1 << s;
+    }
+
+  if (!stats)
+    {
+    SENSEI_ERROR("No statistics were given")
+    return -1;
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+const char *TemporalStatistics::GetStatisticName(int stat)
+{
+  switch (stat)
+    {
+    case STAT_MEAN: return "mean";
+    case STAT_VARIANCE: return "variance";
+    case STAT_MIN: return "min";
+    case STAT_MAX: return "max";
+    case STAT_DERIVATIVE: return "ddt";
+    }
+  return "unknown";
+}
+
+//-----------------------------------------------------------------------------
+std::string TemporalStatistics::GetMeshName(const std::string &meshName)
+{
+  return meshName + "_temporal";
+}
+
+//-----------------------------------------------------------------------------
+void TemporalStatistics::Initialize(const DataRequirements &reqs,
+  unsigned int window, int stats, const std::string &fileName)
+{
+  this->Internals->Arrays.clear();
+
+  MeshRequirementsIterator mit = reqs.GetMeshRequirementsIterator();
+  for (; mit; ++mit)
+    {
+    ArrayRequirementsIterator ait =
+      reqs.GetArrayRequirementsIterator(mit.MeshName());
+    for (; ait; ++ait)
+      {
+      InternalsType::ArrayState as;
+      as.MeshName = mit.MeshName();
+      as.ArrayName = ait.Array();
+      as.Association = ait.Association();
+      this->Internals->Arrays.push_back(as);
+      }
+    }
+
+  this->Internals->Window = std::max(1u, window);
+  this->Internals->Stats = stats;
+  this->Internals->FileName = fileName;
+}
+
+//-----------------------------------------------------------------------------
+void TemporalStatistics::SetStorage(int storage)
+{
+  this->Internals->Storage = storage;
+}
+
+//-----------------------------------------------------------------------------
+void TemporalStatistics::SetNumberOfThreads(int nThreads)
+{
+  this->Internals->Threads = nThreads < 1 ?
+    TaskRuntime::GetNumberOfThreads() : nThreads;
+}
+
+//-----------------------------------------------------------------------------
+void TemporalStatistics::SetPublish(int val)
+{
+  this->Internals->Publish = val;
+}
+
+//-----------------------------------------------------------------------------
+void TemporalStatistics::GetPublishedMeshNames(std::vector<std::string> &names)
+{
+  names.clear();
+
+  unsigned int nArrays = this->Internals->Arrays.size();
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    std::string name = GetMeshName(this->Internals->Arrays[i].MeshName);
+    if (std::find(names.begin(), names.end(), name) == names.end())
+      names.push_back(name);
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool TemporalStatistics::Execute(DataAdaptor* data)
+{
+  TimeEvent<128> mark("TemporalStatistics::Execute");
+
+  InternalsType &internals = *this->Internals;
+
+  long step = data->GetDataTimeStep();
+  double time = data->GetDataTime();
+
+  // the fields are published to the adaptor that serves them to the
+  // analyses that run next
+  PartialResultsDataAdaptor *published = nullptr;
+  if (internals.Publish)
+    {
+    published = dynamic_cast<PartialResultsDataAdaptor*>(data);
+    if (!published)
+      {
+      SENSEI_ERROR("The fields can only be published when executed on a"
+        " PartialResultsDataAdaptor")
+      return false;
+      }
+    }
+
+  // the published mesh of each mesh, with its blocks by id
+  struct Output
+  {
+    vtkSmartPointer<vtkCompositeDataSet> Mesh;
+    std::map<int, vtkDataSet*> Blocks;
+  };
+  std::map<std::string, Output> outputs;
+
+  // the negated minimum and the maximum of each statistic of each array.
+  // errors are reported but processing continues so that all ranks take
+  // part in the reduction below
+  bool status = true;
+  unsigned int nArrays = internals.Arrays.size();
+  std::vector<double> ranges(2*numStats*nArrays,
+    std::numeric_limits<double>::lowest());
+
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    InternalsType::ArrayState &as = internals.Arrays[i];
+
+    std::vector<ArrayView> views;
+    if (data->GetArrayViews(as.MeshName, as.Association, as.ArrayName, views))
+      {
+      SENSEI_ERROR("Failed to get " << VTKUtils::GetAttributesName(as.Association)
+        << " data array \"" << as.ArrayName << "\" on mesh \""
+        << as.MeshName << "\"")
+      status = false;
+      continue;
+      }
+
+    // the history is shared with the other analyses of the array, this
+    // step is added unless one of them did so
+    if (!as.History)
+      as.History = TemporalWindow::GetWindow(as.MeshName, as.Association,
+        as.ArrayName, internals.Window + 1, internals.Storage);
+
+    if (as.History->Update(step, time, views) || internals.UpdateSums(as, views))
+      {
+      SENSEI_ERROR("Failed to update the history of \"" << as.ArrayName
+        << "\" on mesh \"" << as.MeshName << "\"")
+      status = false;
+      continue;
+      }
+
+    // make the published mesh from the structure of the mesh
+    Output *output = nullptr;
+    if (published)
+      {
+      output = &outputs[as.MeshName];
+      if (!output->Mesh)
+        {
+        vtkDataObject *dobj = nullptr;
+        if (data->GetMesh(as.MeshName, true, dobj))
+          {
+          SENSEI_ERROR("Failed to get mesh \"" << as.MeshName << "\"")
+          status = false;
+          continue;
+          }
+
+        if (!dobj)
+          {
+          output->Mesh.TakeReference(vtkMultiBlockDataSet::New());
+          }
+        else
+          {
+          vtkCompositeDataSetPtr mesh =
+            VTKUtils::AsCompositeData(this->GetCommunicator(), dobj, true);
+
+          output->Mesh.TakeReference(mesh->NewInstance());
+          output->Mesh->CopyStructure(mesh);
+
+          vtkSmartPointer<vtkCompositeDataIterator> it;
+          it.TakeReference(mesh->NewIterator());
+          for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+            {
+            vtkDataSet *ds = vtkDataSet::SafeDownCast(it->GetCurrentDataObject());
+            if (!ds)
+              continue;
+
+            vtkDataSet *block = ds->NewInstance();
+            block->CopyStructure(ds);
+            output->Mesh->SetDataSet(it, block);
+            output->Blocks[VTKUtils::GetBlockId(mesh, it)] = block;
+            block->Delete();
+            }
+          }
+        }
+      }
+
+    StatRanges arrayRanges;
+    unsigned int nViews = views.size();
+    for (unsigned int j = 0; j < nViews; ++j)
+      {
+      const ArrayView &view = views[j];
+
+      // the published arrays of the block
+      std::vector<float*> out;
+      if (output)
+        {
+        auto bit = output->Blocks.find(view.BlockId);
+        vtkDataSet *block = bit == output->Blocks.end() ? nullptr : bit->second;
+        vtkFieldData *fd = block ? block->GetAttributesAsFieldData(as.Association) : nullptr;
+
+        for (int s = 0; fd && (s < numStats); ++s)
+          {
+          if (!(internals.Stats & (1 << s)))
+            continue;
+
+          vtkFloatArray *fa = vtkFloatArray::New();
+          fa->SetName((as.ArrayName + "_" + GetStatisticName(1 << s)).c_str());
+          fa->SetNumberOfTuples(view.NumTuples);
+          fd->AddArray(fa);
+          fa->Delete();
+
+          out.push_back(fa->GetPointer(0));
+          }
+        }
+
+      internals.ComputeBlock(as, view, as.Blocks[j],
+        out.empty() ? nullptr : out.data(), arrayRanges);
+      }
+
+    for (int s = 0; s < numStats; ++s)
+      {
+      ranges[2*(numStats*i + s)] = -arrayRanges.Min[s];
+      ranges[2*(numStats*i + s) + 1] = arrayRanges.Max[s];
+      }
+    }
+
+  for (auto &output : outputs)
+    published->SetPartialResult(GetMeshName(output.first), output.second.Mesh);
+
+  // reduce the ranges of all arrays at once
+  MPI_Comm comm = this->GetCommunicator();
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  MPI_Reduce(rank ? ranges.data() : MPI_IN_PLACE, ranges.data(),
+    ranges.size(), MPI_DOUBLE, MPI_MAX, 0, comm);
+
+  if (this->WriteResults(step, time, ranges))
+    status = false;
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+int TemporalStatistics::WriteResults(long step, double time,
+  const std::vector<double> &ranges)
+{
+  int rank = 0;
+  MPI_Comm_rank(this->GetCommunicator(), &rank);
+
+  if (rank != 0)
+    return 0;
+
+  InternalsType &internals = *this->Internals;
+
+  unsigned int nArrays = internals.Arrays.size();
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    const InternalsType::ArrayState &as = internals.Arrays[i];
+
+    std::ostringstream oss;
+    oss << "step : " << step << std::endl
+      << "time : " << time << std::endl
+      << "window : " << as.NumSummed << std::endl;
+
+    for (int s = 0; s < numStats; ++s)
+      {
+      if (!(internals.Stats & (1 << s)))
+        continue;
+
+      double vmin = -ranges[2*(numStats*i + s)];
+      double vmax = ranges[2*(numStats*i + s) + 1];
+
+      oss << GetStatisticName(1 << s) << " range : ";
+      if (vmin <= vmax)
+        oss << vmin << " " << vmax << std::endl;
+      else
+        oss << "none" << std::endl;
+      }
+
+    if (internals.FileName.empty())
+      {
+      std::cout << "TemporalStatistics mesh \"" << as.MeshName
+        << "\" data array \"" << as.ArrayName << "\"" << std::endl
+        << oss.str();
+      }
+    else
+      {
+      char fname[1024] = {'\0'};
+      snprintf(fname, 1024, "%s_%s_%s_%ld_temporal.txt",
+        internals.FileName.c_str(), as.MeshName.c_str(),
+        as.ArrayName.c_str(), step);
+
+      FILE *file = fopen(fname, "w");
+      if (!file)
+        {
+        char *estr = strerror(errno);
+        SENSEI_ERROR("Failed to open \"" << fname << "\""
+          << std::endl << estr)
+        return -1;
+        }
+
+      fprintf(file, "%s", oss.str().c_str());
+      fclose(file);
+      }
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TemporalStatistics::Finalize()
+{
+  // release the histories
+  this->Internals->Arrays.clear();
+  return 0;
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef sensei_TemporalStatistics_h
+#define sensei_TemporalStatistics_h
+
+#include "AnalysisAdaptor.h"
+#include "DataRequirements.h"
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+namespace sensei
+{
+
+/// @class TemporalStatistics
+/// @brief Computes the statistics of arrays over a window of steps
+///
+/// For each cell or point of the arrays the mean, variance, minimum and
+/// maximum of its values over the last Window steps, and the time
+/// derivative of its value, are found from the TemporalWindow of the array,
+/// which is shared with the other analyses of its history such as
+/// Autocorrelation. The mean and variance are kept as running sums,
+/// updated each step with the value entering the window and the one
+/// leaving it. The sums are of the differences from the value of the step
+/// they were started at, which stays accurate where sums of powers would
+/// cancel, and are recomputed from the window when steps were missed. The
+/// minimum and maximum are found over the window. Until the window fills
+/// the statistics are those of the steps held. The derivative is the
+/// backward difference of the last two steps over the difference of their
+/// times, or of their step numbers when the times are the same, and zero
+/// in the first step. The variance is that of the population.
+///
+/// The range of each statistic over the values that are not ghosts is
+/// written by rank 0 to a file per array and step named
+/// <file>_<mesh>_<array>_<step>_temporal.txt, or to cout when no file is
+/// given.
+///
+/// The fields may be published, see SetPublish, as the arrays
+/// <array>_mean, <array>_variance, <array>_min, <array>_max and
+/// <array>_ddt of the mesh <mesh>_temporal, which has the structure of the
+/// mesh, for the analyses and transports that run after this one in the
+/// same step.
+class TemporalStatistics : public AnalysisAdaptor
+{
+public:
+  static TemporalStatistics* New();
+  senseiTypeMacro(TemporalStatistics, AnalysisAdaptor);
+
+  /// the statistics, combined with or
+  enum {STAT_MEAN = 1, STAT_VARIANCE = 2, STAT_MIN = 4, STAT_MAX = 8,
+    STAT_DERIVATIVE = 16, STAT_ALL = 31};
+
+  /// @brief Convert a comma separated list of "mean", "variance", "min",
+  /// "max" and "ddt", or "all", to a combination of statistics.
+  ///
+  /// @returns zero if successful
+  static int GetStatistics(const std::string &names, int &stats);
+
+  /// @brief Get the name of a statistic, as used in the array names.
+  static const char *GetStatisticName(int stat);
+
+  /// @brief Get the name of the mesh the fields of a mesh's arrays are
+  /// published as, <mesh>_temporal.
+  static std::string GetMeshName(const std::string &meshName);
+
+  // compute the statistics over window steps of each of the arrays named
+  // in the requirements. the results are written to files named from
+  // fileName, or to cout when it is empty
+  void Initialize(const DataRequirements &reqs, unsigned int window,
+    int stats, const std::string &fileName);
+
+  // set how the history is stored, one of the TemporalWindow storage
+  // modes. the default is TemporalWindow::STORAGE_FLOAT. must be called
+  // before the first Execute
+  void SetStorage(int storage);
+
+  // set the number of threads used to compute the statistics. the threads
+  // are those of the TaskRuntime, a value less than 1 uses all of them.
+  // the default is 1.
+  void SetNumberOfThreads(int nThreads);
+
+  // when set, the fields are published to the PartialResultsDataAdaptor
+  // the analysis is executed on, see GetPublishedMeshNames. the default is
+  // not set
+  void SetPublish(int val);
+
+  // get the names of the meshes the fields are published as
+  void GetPublishedMeshNames(std::vector<std::string> &names);
+
+  bool Execute(DataAdaptor* data) override;
+
+  int Finalize() override;
+
+protected:
+  TemporalStatistics();
+  ~TemporalStatistics();
+
+  TemporalStatistics(const TemporalStatistics&) = delete;
+  void operator=(const TemporalStatistics&) = delete;
+
+  // write the ranges of the statistics of the last step
+  int WriteResults(long step, double time,
+    const std::vector<double> &ranges);
+
+private:
+  struct InternalsType;
+  InternalsType *Internals;
+};
+
+}
+
+#endif
@@ -0,0 +1,505 @@
+#include "TemporalWindow.h"
+#include "ArrayDispatch.h"
+#include "Profiler.h"
+#include "TaskRuntime.h"
+#include "Error.h"
+
+#include <vtkDataArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+
+namespace
+{
+// values are encoded in ranges of this size
+const long rangeSize = 65536;
+
+// the size of a stored value
+size_t valueBytes(int storage)
+{
+  switch (storage)
+    {
+    case sensei::TemporalWindow::STORAGE_BFLOAT16:
+    case sensei::TemporalWindow::STORAGE_QUANTIZE16:
+      return 2;
+    case sensei::TemporalWindow::STORAGE_QUANTIZE8:
+      return 1;
+    }
+  return 4;
+}
+
+// keep the upper 16 bits of a float, rounded to nearest even
+uint16_t toBFloat16(float v)
+{
+  uint32_t bits = 0;
+  memcpy(&bits, &v, 4);
+
+  // keep NaN a NaN
+  if ((bits & 0x7fffffffu) > 0x7f800000u)
+    return static_cast<uint16_t>((bits >> 16) | 0x0040u);
+
+  bits += 0x7fffu + ((bits >> 16) & 1u);
+  return static_cast<uint16_t>(bits >> 16);
+}
+
+float fromBFloat16(uint16_t h)
+{
+  uint32_t bits = static_cast<uint32_t>(h) << 16;
+  float v = 0.0f;
+  memcpy(&v, &bits, 4);
+  return v;
+}
+
+// call f(begin, end) for ranges of [0, n) on the threads of the TaskRuntime
+template <typename F>
+void forEachRange(long n, F &&f)
+{
+  long nRanges = (n + rangeSize - 1)/rangeSize;
+  if (nRanges < 2)
+    {
+    f(0l, n);
+    return;
+    }
+
+  sensei::TaskRuntime::ParallelFor(nRanges, -1,
+    [&](int, long i) -> int
+    {
+    f(i*rangeSize, std::min(n, (i + 1)*rangeSize));
+    return 0;
+    });
+}
+
+// encode the values of a block, see ArrayDispatch
+struct StoreKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    vtkDataArray *da = this->Array;
+    long n = this->NumValues;
+    float *out32 = reinterpret_cast<float*>(this->Out);
+    uint16_t *out16 = reinterpret_cast<uint16_t*>(this->Out);
+    uint8_t *out8 = reinterpret_cast<uint8_t*>(this->Out);
+
+    if (this->Storage == sensei::TemporalWindow::STORAGE_FLOAT)
+      {
+      forEachRange(n, [&](long begin, long end)
+        {
+        for (long i = begin; i < end; ++i)
+          out32[i] = static_cast<float>(sensei::ArrayDispatch::GetValue(da, vals, i));
+        });
+      return;
+      }
+
+    if (this->Storage == sensei::TemporalWindow::STORAGE_BFLOAT16)
+      {
+      forEachRange(n, [&](long begin, long end)
+        {
+        for (long i = begin; i < end; ++i)
+          out16[i] = toBFloat16(static_cast<float>(
+            sensei::ArrayDispatch::GetValue(da, vals, i)));
+        });
+      return;
+      }
+
+    // the quantization spans the range of the finite values
+    long nRanges = (n + rangeSize - 1)/rangeSize;
+    std::vector<double> rmin(nRanges, std::numeric_limits<double>::max());
+    std::vector<double> rmax(nRanges, std::numeric_limits<double>::lowest());
+
+    forEachRange(n, [&](long begin, long end)
+      {
+      long r = begin/rangeSize;
+      for (long i = begin; i < end; ++i)
+        {
+        double v = sensei::ArrayDispatch::GetValue(da, vals, i);
+        if (std::isfinite(v))
+          {
+          rmin[r] = std::min(rmin[r], v);
+          rmax[r] = std::max(rmax[r], v);
+          }
+        }
+      });
+
+    double vmin = std::numeric_limits<double>::max();
+    double vmax = std::numeric_limits<double>::lowest();
+    for (long r = 0; r < nRanges; ++r)
+      {
+      vmin = std::min(vmin, rmin[r]);
+      vmax = std::max(vmax, rmax[r]);
+      }
+
+    if (vmin > vmax)
+      vmin = vmax = 0.0;
+
+    bool q16 = this->Storage == sensei::TemporalWindow::STORAGE_QUANTIZE16;
+    double levels = q16 ? 65535.0 : 255.0;
+    double scale = (vmax - vmin)/levels;
+    double invScale = scale > 0.0 ? 1.0/scale : 0.0;
+
+    this->Offset = static_cast<float>(vmin);
+    this->Scale = static_cast<float>(scale);
+
+    forEachRange(n, [&](long begin, long end)
+      {
+      for (long i = begin; i < end; ++i)
+        {
+        double v = sensei::ArrayDispatch::GetValue(da, vals, i);
+        double q = std::isfinite(v) ?
+          std::min(levels, std::max(0.0, std::round((v - vmin)*invScale))) : 0.0;
+        if (q16)
+          out16[i] = static_cast<uint16_t>(q);
+        else
+          out8[i] = static_cast<uint8_t>(q);
+        }
+      });
+  }
+
+  vtkDataArray *Array;
+  long NumValues;
+  int Storage;
+  unsigned char *Out;
+  float Offset;
+  float Scale;
+};
+}
+
+namespace sensei
+{
+
+//-----------------------------------------------------------------------------
+int TemporalWindow::GetStorage(const std::string &name, int &storage)
+{
+  if (name == "float")
+    storage = STORAGE_FLOAT;
+  else if (name == "bfloat16")
+    storage = STORAGE_BFLOAT16;
+  else if (name == "quantize16")
+    storage = STORAGE_QUANTIZE16;
+  else if (name == "quantize8")
+    storage = STORAGE_QUANTIZE8;
+  else
+    {
+    SENSEI_ERROR("Invalid storage \"" << name << "\". Use float, bfloat16,"
+      " quantize16 or quantize8")
+    return -1;
+    }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+const char *TemporalWindow::GetStorageName(int storage)
+{
+  switch (storage)
+    {
+    case STORAGE_FLOAT: return "float";
+    case STORAGE_BFLOAT16: return "bfloat16";
+    case STORAGE_QUANTIZE16: return "quantize16";
+    case STORAGE_QUANTIZE8: return "quantize8";
+    }
+  return "unknown";
+}
+
+//-----------------------------------------------------------------------------
+TemporalWindowPtr TemporalWindow::GetWindow(const std::string &meshName,
+  int association, const std::string &arrayName, unsigned int nSteps,
+  int storage)
+{
+  static std::mutex mutex;
+  static std::map<std::string, std::weak_ptr<TemporalWindow>> windows;
+
+  std::string key = meshName + "/" + std::to_string(association) + "/" +
+    arrayName + "/" + std::to_string(storage);
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::weak_ptr<TemporalWindow> &entry = windows[key];
+
+  TemporalWindowPtr window = entry.lock();
+  if (window)
+    {
+    window->SetCapacity(nSteps);
+    }
+  else
+    {
+    window = std::make_shared<TemporalWindow>(nSteps, storage);
+    entry = window;
+    }
+
+  return window;
+}
+
+//-----------------------------------------------------------------------------
+TemporalWindow::TemporalWindow(unsigned int capacity, int storage) :
+  Capacity(std::max(1u, capacity)), Storage(storage), Count(0), Head(0),
+  Steps(Capacity, 0), Times(Capacity, 0.0)
+{
+}
+
+//-----------------------------------------------------------------------------
+void TemporalWindow::SetCapacity(unsigned int nSteps)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  if (nSteps <= this->Capacity)
+    return;
+
+  // the steps held are moved to the front of the new ring, oldest first
+  unsigned int nHeld = this->GetNumberOfSteps();
+
+  std::vector<long> steps(nSteps, 0);
+  std::vector<double> times(nSteps, 0.0);
+  for (unsigned int lag = 0; lag < nHeld; ++lag)
+    {
+    unsigned int slot = this->GetSlot(lag);
+    steps[nHeld - 1 - lag] = this->Steps[slot];
+    times[nHeld - 1 - lag] = this->Times[slot];
+    }
+
+  unsigned int nBlocks = this->Blocks.size();
+  for (unsigned int i = 0; i < nBlocks; ++i)
+    {
+    std::vector<Snapshot> ring(nSteps);
+    for (unsigned int lag = 0; lag < nHeld; ++lag)
+      ring[nHeld - 1 - lag] = std::move(this->Blocks[i].Ring[this->GetSlot(lag)]);
+    this->Blocks[i].Ring.swap(ring);
+    }
+
+  this->Steps.swap(steps);
+  this->Times.swap(times);
+  this->Capacity = nSteps;
+  this->Count = nHeld;
+  this->Head = nHeld ? nHeld - 1 : 0;
+}
+
+//-----------------------------------------------------------------------------
+unsigned int TemporalWindow::GetSlot(unsigned int lag) const
+{
+  return (this->Head + this->Capacity - lag) % this->Capacity;
+}
+
+//-----------------------------------------------------------------------------
+unsigned int TemporalWindow::GetNumberOfSteps() const
+{
+  return std::min(this->Count, static_cast<unsigned long>(this->Capacity));
+}
+
+//-----------------------------------------------------------------------------
+long TemporalWindow::GetTimeStep(unsigned int lag) const
+{
+  return lag < this->GetNumberOfSteps() ? this->Steps[this->GetSlot(lag)] : -1;
+}
+
+//-----------------------------------------------------------------------------
+double TemporalWindow::GetTime(unsigned int lag) const
+{
+  return lag < this->GetNumberOfSteps() ? this->Times[this->GetSlot(lag)] : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+const TemporalWindow::Block *TemporalWindow::FindBlock(int blockId) const
+{
+  auto it = std::lower_bound(this->Blocks.begin(), this->Blocks.end(), blockId,
+    [](const Block &b, int id) -> bool { return b.BlockId < id; });
+
+  return (it != this->Blocks.end()) && (it->BlockId == blockId) ? &(*it) : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+long TemporalWindow::GetNumberOfValues(int blockId) const
+{
+  const Block *block = this->FindBlock(blockId);
+  return block ? block->NumValues : -1;
+}
+
+//-----------------------------------------------------------------------------
+const float *TemporalWindow::GetValues(int blockId, unsigned int lag) const
+{
+  const Block *block = this->FindBlock(blockId);
+
+  if (!block || (this->Storage != STORAGE_FLOAT) ||
+    (lag >= this->GetNumberOfSteps()))
+    return nullptr;
+
+  return reinterpret_cast<const float*>(block->Ring[this->GetSlot(lag)].Data.data());
+}
+
+//-----------------------------------------------------------------------------
+int TemporalWindow::GetValues(int blockId, unsigned int lag, long begin,
+  long end, float *values) const
+{
+  const Block *block = this->FindBlock(blockId);
+
+  if (!block || (lag >= this->GetNumberOfSteps()) || (begin < 0) ||
+    (end > block->NumValues))
+    {
+    SENSEI_ERROR("Block " << blockId << " values [" << begin << ", "
+      << end << ") " << lag << " steps back are not held")
+    return -1;
+    }
+
+  const Snapshot &snap = block->Ring[this->GetSlot(lag)];
+  const unsigned char *data = snap.Data.data();
+
+  switch (this->Storage)
+    {
+    case STORAGE_FLOAT:
+      memcpy(values, reinterpret_cast<const float*>(data) + begin,
+        (end - begin)*sizeof(float));
+      break;
+
+    case STORAGE_BFLOAT16:
+      {
+      const uint16_t *h = reinterpret_cast<const uint16_t*>(data);
+      for (long i = begin; i < end; ++i)
+        values[i - begin] = fromBFloat16(h[i]);
+      }
+      break;
+
+    case STORAGE_QUANTIZE16:
+      {
+      const uint16_t *q = reinterpret_cast<const uint16_t*>(data);
+      for (long i = begin; i < end; ++i)
+        values[i - begin] = snap.Offset + snap.Scale*q[i];
+      }
+      break;
+
+    case STORAGE_QUANTIZE8:
+      {
+      const uint8_t *q = reinterpret_cast<const uint8_t*>(data);
+      for (long i = begin; i < end; ++i)
+        values[i - begin] = snap.Offset + snap.Scale*q[i];
+      }
+      break;
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+long TemporalWindow::GetMemoryUse() const
+{
+  long nBytes = 0;
+  unsigned int nBlocks = this->Blocks.size();
+  for (unsigned int i = 0; i < nBlocks; ++i)
+    {
+    const std::vector<Snapshot> &ring = this->Blocks[i].Ring;
+    for (unsigned int j = 0; j < this->Capacity; ++j)
+      nBytes += ring[j].Data.capacity();
+    }
+  return nBytes;
+}
+
+//-----------------------------------------------------------------------------
+int TemporalWindow::Store(const ArrayView &view, Snapshot &snap)
+{
+  // the buffers of the slot are reused from the step it last held
+  snap.Data.resize(view.NumTuples*valueBytes(this->Storage));
+
+  StoreKernel kernel{view.Array, view.NumTuples, this->Storage,
+    snap.Data.data(), 0.0f, 0.0f};
+
+  if (ArrayDispatch::Execute(view, kernel))
+    {
+    SENSEI_ERROR("Unsupported type " << view.DataType << " of block "
+      << view.BlockId)
+    return -1;
+    }
+
+  snap.Offset = kernel.Offset;
+  snap.Scale = kernel.Scale;
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TemporalWindow::Update(long step, double time,
+  const std::vector<ArrayView> &views)
+{
+  TimeEvent<128> mark("TemporalWindow::Update");
+
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  // another analysis added this step
+  if (this->Count && (this->Steps[this->Head] == step) &&
+    (this->Times[this->Head] == time))
+    return 0;
+
+  unsigned int nViews = views.size();
+
+  std::vector<unsigned int> order(nViews);
+  for (unsigned int i = 0; i < nViews; ++i)
+    {
+    if (views[i].NumComponents != 1)
+      {
+      SENSEI_ERROR("Block " << views[i].BlockId << " has "
+        << views[i].NumComponents << " components. The history of"
+        " multi-component arrays is not supported")
+      return -1;
+      }
+    order[i] = i;
+    }
+
+  std::sort(order.begin(), order.end(),
+    [&views](unsigned int a, unsigned int b) -> bool
+    { return views[a].BlockId < views[b].BlockId; });
+
+  // the history is kept only as long as the blocks stay the same
+  bool same = nViews == this->Blocks.size();
+  for (unsigned int i = 0; same && (i < nViews); ++i)
+    {
+    const ArrayView &view = views[order[i]];
+    same = (this->Blocks[i].BlockId == view.BlockId) &&
+      (this->Blocks[i].NumValues == view.NumTuples);
+    }
+
+  if (!same)
+    {
+    if (this->Count)
+      {
+      SENSEI_WARNING("The blocks changed at step " << step
+        << ", the history is discarded")
+      }
+
+    this->Count = 0;
+    this->Blocks.assign(nViews, Block());
+    for (unsigned int i = 0; i < nViews; ++i)
+      {
+      this->Blocks[i].BlockId = views[order[i]].BlockId;
+      this->Blocks[i].NumValues = views[order[i]].NumTuples;
+      this->Blocks[i].Ring.resize(this->Capacity);
+      }
+    }
+
+  unsigned int slot = this->Count ? (this->Head + 1) % this->Capacity : 0;
+
+  // the blocks are copied in parallel, and the values of large blocks
+  int ierr = TaskRuntime::ParallelFor(nViews, -1,
+    [&](int, long i) -> int
+    {
+    return this->Store(views[order[i]], this->Blocks[i].Ring[slot]);
+    });
+
+  if (ierr)
+    {
+    // the oldest step may have been overwritten
+    this->Count = std::min(this->Count,
+      static_cast<unsigned long>(this->Capacity - 1));
+
+    SENSEI_ERROR("Failed to add step " << step)
+    return -1;
+    }
+
+  this->Head = slot;
+  this->Steps[slot] = step;
+  this->Times[slot] = time;
+  ++this->Count;
+
+  return 0;
+}
+
+}
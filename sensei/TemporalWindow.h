@@ -0,0 +1,185 @@
+#ifndef sensei_TemporalWindow_h
+#define sensei_TemporalWindow_h
+
+#include "ArrayView.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sensei
+{
+
+class TemporalWindow;
+using TemporalWindowPtr = std::shared_ptr<TemporalWindow>;
+
+/// @class TemporalWindow
+/// @brief The values of an array over the last steps of a simulation.
+///
+/// A ring buffer of snapshots of the blocks of an array, shared by the
+/// analyses that process the array's history, such as Autocorrelation and
+/// TemporalStatistics. The analyses get the window of their array with
+/// GetWindow and call Update with the array's values each step. The
+/// snapshot of a step is made by the first of them, the others find it
+/// in place, so that the history is held once however many analyses use
+/// it. The window holds as many steps as the analysis that needs the most
+/// asked for.
+///
+/// The snapshots may be stored at reduced precision to save memory.
+///
+///   STORAGE_FLOAT       32 bit floats, values of other types are converted
+///   STORAGE_BFLOAT16    the upper 16 bits of the floats, rounded to
+///                       nearest, which keeps the range of floats with 8
+///                       bits of mantissa
+///   STORAGE_QUANTIZE16  16 bit integers spanning the range of each
+///   STORAGE_QUANTIZE8   snapshot of a block, or 8 bit for a quarter of
+///                       the memory. Values that are not finite are stored
+///                       as the least value of the snapshot
+///
+/// Analyses sharing a window should execute at the same cadence, since
+/// the lags are counted in the steps of the window. The snapshots of
+/// arrays with a single component are kept. The blocks are identified by
+/// the BlockId of the views, a change in the set of blocks or in their
+/// size discards the history. The values of a step are valid until the
+/// next step is added.
+class TemporalWindow
+{
+public:
+  /// the ways snapshots are stored
+  enum {STORAGE_FLOAT = 0, STORAGE_BFLOAT16 = 1, STORAGE_QUANTIZE16 = 2,
+    STORAGE_QUANTIZE8 = 3};
+
+  /// @brief Convert "float", "bfloat16", "quantize16" or "quantize8" to a
+  /// storage mode.
+  ///
+  /// @returns zero if successful
+  static int GetStorage(const std::string &name, int &storage);
+
+  /// @brief Get the name of a storage mode.
+  static const char *GetStorageName(int storage);
+
+  /// @brief Get the window of an array.
+  ///
+  /// Analyses that ask for the window of the same array with the same
+  /// storage share it. The window is released when the last of them lets
+  /// go of it.
+  ///
+  /// @param[in] meshName the mesh the array is on
+  /// @param[in] association the array's centering
+  /// @param[in] arrayName the array
+  /// @param[in] nSteps the number of steps the caller needs, the
+  ///                   capacity grows to the largest asked for
+  /// @param[in] storage how the snapshots are stored
+  static TemporalWindowPtr GetWindow(const std::string &meshName,
+    int association, const std::string &arrayName, unsigned int nSteps,
+    int storage = STORAGE_FLOAT);
+
+  TemporalWindow(unsigned int capacity, int storage);
+
+  /// @brief Grow the window to hold nSteps steps.
+  ///
+  /// The steps held are kept. The window never shrinks, since other
+  /// analyses may depend on its capacity.
+  void SetCapacity(unsigned int nSteps);
+  unsigned int GetCapacity() const { return this->Capacity; }
+
+  int GetStorage() const { return this->Storage; }
+
+  /// @brief Add the values of a step.
+  ///
+  /// The views hold every block of the array on this rank. Nothing is done
+  /// when the step was already added by another analysis. The values are
+  /// copied on the threads of the TaskRuntime.
+  ///
+  /// @param[in] step the simulation's time step
+  /// @param[in] time the simulation time
+  /// @param[in] views the values of the blocks, see DataAdaptor::GetArrayViews
+  /// @returns zero if successful
+  int Update(long step, double time, const std::vector<ArrayView> &views);
+
+  /// @brief Get the number of steps held, the current one included.
+  unsigned int GetNumberOfSteps() const;
+
+  /// @brief Get the simulation time step of a step held.
+  ///
+  /// @param[in] lag the number of steps back, 0 is the latest
+  long GetTimeStep(unsigned int lag) const;
+
+  /// @brief Get the simulation time of a step held.
+  double GetTime(unsigned int lag) const;
+
+  /// @brief Get the number of values of a block, or -1 when the block is
+  /// not held.
+  long GetNumberOfValues(int blockId) const;
+
+  /// @brief Get the values of a block in place.
+  ///
+  /// @param[in] blockId the block
+  /// @param[in] lag the number of steps back, 0 is the latest
+  /// @returns the values, or null when the snapshots are not stored as
+  ///          floats or the step or block is not held
+  const float *GetValues(int blockId, unsigned int lag) const;
+
+  /// @brief Get the values [begin, end) of a block.
+  ///
+  /// The values are decoded from the snapshot's storage.
+  ///
+  /// @param[in] blockId the block
+  /// @param[in] lag the number of steps back, 0 is the latest
+  /// @param[in] begin the first value
+  /// @param[in] end one past the last value
+  /// @param[out] values end - begin values
+  /// @returns zero if successful
+  int GetValues(int blockId, unsigned int lag, long begin, long end,
+    float *values) const;
+
+  /// @brief Get the number of bytes held by the snapshots.
+  long GetMemoryUse() const;
+
+private:
+  TemporalWindow(const TemporalWindow&) = delete;
+  void operator=(const TemporalWindow&) = delete;
+
+  // the values of a block in one step. quantized values are
+  // Offset + q*Scale
+  struct Snapshot
+  {
+    Snapshot() : Offset(0.0f), Scale(0.0f) {}
+
+    std::vector<unsigned char> Data;
+    float Offset;
+    float Scale;
+  };
+
+  // the snapshots of a block, indexed by slot
+  struct Block
+  {
+    Block() : BlockId(0), NumValues(0) {}
+
+    int BlockId;
+    long NumValues;
+    std::vector<Snapshot> Ring;
+  };
+
+  // the slot of the step lag steps back
+  unsigned int GetSlot(unsigned int lag) const;
+
+  const Block *FindBlock(int blockId) const;
+
+  // encode the values of a view in a snapshot
+  int Store(const ArrayView &view, Snapshot &snap);
+
+  unsigned int Capacity;
+  int Storage;
+  unsigned long Count;       // the steps added
+  unsigned int Head;         // the slot of the latest step
+  std::vector<long> Steps;   // by slot
+  std::vector<double> Times;
+  std::vector<Block> Blocks; // ordered by block id
+  std::mutex Mutex;
+};
+
+}
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef sensei_TopK_h
+#define sensei_TopK_h
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace sensei
+{
+
+/// @class TopK
+/// @brief keeps the k largest values seen, and an item with each.
+///
+/// The values are held in a bounded min heap, the smallest kept value is
+/// at its front and a new value replaces it only when larger. Scanning n
+/// values costs O(n log k) in the worst case and close to O(n) when most
+/// values fall below the bound. Thread or block selections are combined
+/// with Merge and those of ranks with GlobalTopK, so the items must be
+/// trivially copyable.
+template <typename val_t, typename item_t>
+class TopK
+{
+public:
+  struct Candidate
+  {
+    val_t Value;
+    item_t Item;
+  };
+
+  TopK() : K(0) {}
+  explicit TopK(size_t k) : K(k) { this->Heap.reserve(k); }
+
+  /// set the number of values to keep. clears the values
+  void SetK(size_t k)
+  {
+    this->K = k;
+    this->Heap.clear();
+    this->Heap.reserve(k);
+  }
+
+  size_t GetK() const { return this->K; }
+
+  /// the number of values kept, at most k
+  size_t Size() const { return this->Heap.size(); }
+
+  /// the k'th largest value when k values are held, otherwise the lowest
+  /// value of the type. this bounds the k'th largest value of any set of
+  /// values containing these from below
+  val_t GetBound() const
+  {
+    return (this->K && (this->Heap.size() == this->K)) ?
+      this->Heap[0].Value : std::numeric_limits<val_t>::lowest();
+  }
+
+  /// keep the value if it is among the k largest seen
+  void Insert(val_t val, const item_t &item)
+  {
+    if (this->Heap.size() < this->K)
+      {
+      this->Heap.push_back(Candidate{val, item});
+      std::push_heap(this->Heap.begin(), this->Heap.end(), Greater);
+      }
+    else if (this->K && (val > this->Heap[0].Value))
+      {
+      std::pop_heap(this->Heap.begin(), this->Heap.end(), Greater);
+      this->Heap.back() = Candidate{val, item};
+      std::push_heap(this->Heap.begin(), this->Heap.end(), Greater);
+      }
+  }
+
+  /// keep the values of other that are among the k largest
+  void Merge(const TopK &other)
+  {
+    for (const Candidate &c : other.Heap)
+      this->Insert(c.Value, c.Item);
+  }
+
+  /// the kept values in no particular order
+  const std::vector<Candidate> &GetCandidates() const { return this->Heap; }
+
+  /// get the kept values, largest first
+  void GetSorted(std::vector<Candidate> &sorted) const
+  {
+    sorted = this->Heap;
+    std::sort(sorted.begin(), sorted.end(), Greater);
+  }
+
+  void Clear() { this->Heap.clear(); }
+
+private:
+  static bool Greater(const Candidate &a, const Candidate &b)
+  { return a.Value > b.Value; }
+
+  size_t K;
+  std::vector<Candidate> Heap;
+};
+
+/// @brief select the k largest values of each of a number of sets over all
+/// ranks.
+///
+/// local holds this rank's selection for each set, every rank passing the
+/// same number of sets and the same k for each. A rank holding k values of
+/// a set bounds the set's global k'th value from below, one MPI_Allreduce
+/// of the bounds of all of the sets gives thresholds that prune nearly all
+/// of the candidates without assuming anything about how the data is
+/// spread over the ranks, and only candidates at or above them are
+/// gathered to root for the final selection. On root result holds the k
+/// largest of each set, largest first, elsewhere it is empty. Collective.
+/// returns zero if successful.
+template <typename val_t, typename item_t>
+int GlobalTopK(MPI_Comm comm, int root,
+  const std::vector<TopK<val_t,item_t>> &local,
+  std::vector<std::vector<typename TopK<val_t,item_t>::Candidate>> &result)
+{
+  using Candidate = typename TopK<val_t,item_t>::Candidate;
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  int nSets = local.size();
+  result.clear();
+
+  // the bounds are reduced as doubles, the conversion keeps their order
+  std::vector<double> threshold(nSets);
+  for (int i = 0; i < nSets; ++i)
+    threshold[i] = static_cast<double>(local[i].GetBound());
+
+  MPI_Allreduce(MPI_IN_PLACE, threshold.data(), nSets, MPI_DOUBLE, MPI_MAX,
+    comm);
+
+  // pack the surviving candidates with the set they belong to
+  struct Packed
+  {
+    int Set;
+    Candidate Value;
+  };
+
+  std::vector<Packed> candidates;
+  for (int i = 0; i < nSets; ++i)
+    {
+    for (const Candidate &c : local[i].GetCandidates())
+      {
+      if (static_cast<double>(c.Value) >= threshold[i])
+        candidates.push_back(Packed{i, c});
+      }
+    }
+
+  // gather them on the root
+  MPI_Datatype packedType;
+  MPI_Type_contiguous(sizeof(Packed), MPI_BYTE, &packedType);
+  MPI_Type_commit(&packedType);
+
+  int nLocal = candidates.size();
+  std::vector<int> counts(nRanks, 0);
+  MPI_Gather(&nLocal, 1, MPI_INT, counts.data(), 1, MPI_INT, root, comm);
+
+  std::vector<int> displ(nRanks, 0);
+  int nTotal = 0;
+  for (int i = 0; i < nRanks; ++i)
+    {
+    displ[i] = nTotal;
+    nTotal += counts[i];
+    }
+
+  std::vector<Packed> all(rank == root ? nTotal : 0);
+
+  MPI_Gatherv(candidates.data(), nLocal, packedType, all.data(),
+    counts.data(), displ.data(), packedType, root, comm);
+
+  MPI_Type_free(&packedType);
+
+  if (rank != root)
+    return 0;
+
+  // select the k largest of the candidates
+  std::vector<TopK<val_t,item_t>> global(nSets);
+  for (int i = 0; i < nSets; ++i)
+    global[i].SetK(local[i].GetK());
+
+  for (const Packed &p : all)
+    global[p.Set].Insert(p.Value.Value, p.Value.Item);
+
+  result.resize(nSets);
+  for (int i = 0; i < nSets; ++i)
+    global[i].GetSorted(result[i]);
+
+  return 0;
+}
+
+}
+
+#endif
@@ -1,9 +1,11 @@
 #include "VTKAmrWriter.h"
 #include "senseiConfig.h"
 #include "DataAdaptor.h"
+#include "FileStager.h"
 #include "MeshMetadata.h"
 #include "MeshMetadataMap.h"
 #include "VTKUtils.h"
+#include "TaskRuntime.h"
 #include "Error.h"
 
 #include <vtkCompositeDataIterator.h>
@@ -13,6 +15,10 @@
 #include <vtkOverlappingAMR.h>
 #include <vtkCompositeDataPipeline.h>
 #include <vtkXMLPUniformGridAMRWriter.h>
+#include <vtkXMLDataObjectWriter.h>
+#include <vtkXMLDataElement.h>
+#include <vtkDataCompressor.h>
+#include <vtkDataSet.h>
 #include <vtkAlgorithm.h>
 #include <vtkMultiProcessController.h>
 #include <vtkMPIController.h>
@@ -23,6 +29,8 @@
 #include <sstream>
 #include <fstream>
 #include <cassert>
+#include <atomic>
+#include <iomanip>
 
 #include <mpi.h>
 
@@ -37,6 +45,141 @@ std::string getFileName(const std::string &outputDir,
   return fss.str();
 }
 
+// An AMR writer that defers writing the blocks. VTK's writer writes each
+// block as it walks the hierarchy. This writer records the blocks in the
+// order they appear in the .vthb index, and the caller writes them after
+// Write returns with WriteBlocks. The block files are named and written
+// just as VTK would.
+class vtkDeferredAMRWriter : public vtkXMLPUniformGridAMRWriter
+{
+public:
+  static vtkDeferredAMRWriter *New();
+  vtkTypeMacro(vtkDeferredAMRWriter, vtkXMLPUniformGridAMRWriter);
+
+  // write the recorded blocks using the given number of threads. the
+  // names of the files written are appended to fileNames
+  int WriteBlocks(int nThreads, std::vector<std::string> &fileNames);
+
+protected:
+  vtkDeferredAMRWriter() = default;
+  ~vtkDeferredAMRWriter() = default;
+
+  int WriteNonCompositeData(vtkDataObject *dObj, vtkXMLDataElement *datasetXML,
+    int &writerIdx, const char *fileName) override;
+
+private:
+  struct Block
+  {
+    vtkSmartPointer<vtkDataSet> Data;
+    std::string FileName;
+  };
+
+  std::vector<Block> Blocks;
+};
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkDeferredAMRWriter);
+
+//-----------------------------------------------------------------------------
+int vtkDeferredAMRWriter::WriteNonCompositeData(vtkDataObject *dObj,
+  vtkXMLDataElement *datasetXML, int &writerIdx, const char *fileName)
+{
+  // this mirrors vtkXMLCompositeDataWriter, blocks not held locally
+  // consume an index but write nothing
+  writerIdx++;
+
+  vtkDataSet *ds = vtkDataSet::SafeDownCast(dObj);
+  if (!ds)
+    return 0;
+
+  if (datasetXML)
+    datasetXML->SetAttribute("file", fileName);
+
+  // block file names are relative to the directory of the index
+  std::string path = this->GetFileName();
+  size_t slash = path.find_last_of('/');
+  path = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+  this->Blocks.push_back({ds, path + fileName});
+
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkDeferredAMRWriter::WriteBlocks(int nThreads,
+  std::vector<std::string> &fileNames)
+{
+  int nBlocks = this->Blocks.size();
+  nThreads = std::max(1, std::min(nThreads, nBlocks));
+
+  std::atomic<int> next(0);
+  std::atomic<int> nFailed(0);
+
+  // threads take the blocks in index order
+  auto writeBlocks = [&]()
+    {
+    int i = 0;
+    while ((i = next++) < nBlocks)
+      {
+      Block &block = this->Blocks[i];
+
+      vtkXMLWriter *writer =
+        vtkXMLDataObjectWriter::NewWriter(block.Data->GetDataObjectType());
+
+      if (!writer)
+        {
+        ++nFailed;
+        continue;
+        }
+
+      // the settings VTK passes on to its block writers. each writer gets
+      // its own compressor since they run concurrently
+      writer->SetByteOrder(this->GetByteOrder());
+      if (vtkDataCompressor *compressor = this->GetCompressor())
+        {
+        vtkDataCompressor *copy = compressor->NewInstance();
+        writer->SetCompressor(copy);
+        copy->Delete();
+        }
+      else
+        {
+        writer->SetCompressor(nullptr);
+        }
+      writer->SetBlockSize(this->GetBlockSize());
+      writer->SetDataMode(this->GetDataMode());
+      writer->SetEncodeAppendedData(this->GetEncodeAppendedData());
+      writer->SetHeaderType(this->GetHeaderType());
+      writer->SetIdType(this->GetIdType());
+
+      writer->SetInputData(block.Data);
+      writer->SetFileName(block.FileName.c_str());
+
+      if (!writer->Write())
+        ++nFailed;
+
+      writer->Delete();
+      }
+    };
+
+  // each thread of the process wide pool writes blocks until none remain
+  TaskRuntime::ParallelFor(nThreads, nThreads,
+    [&writeBlocks](int, long) -> int { writeBlocks(); return 0; });
+
+  for (const Block &block : this->Blocks)
+    fileNames.push_back(block.FileName);
+
+  this->Blocks.clear();
+
+  if (nFailed)
+    {
+    SENSEI_ERROR("Failed to write " << nFailed << " of " << nBlocks
+      << " blocks")
+    return -1;
+    }
+
+  return 0;
+}
+
 
 namespace sensei
 {
@@ -44,7 +187,8 @@ namespace sensei
 senseiNewMacro(VTKAmrWriter);
 
 //-----------------------------------------------------------------------------
-VTKAmrWriter::VTKAmrWriter() : OutputDir("./"), Mode(MODE_PARAVIEW)
+VTKAmrWriter::VTKAmrWriter() : OutputDir("./"), Mode(MODE_PARAVIEW),
+  NumberOfThreads(1)
 {}
 
 //-----------------------------------------------------------------------------
@@ -81,6 +225,27 @@ int VTKAmrWriter::SetOutputDir(const std::string &outputDir)
   return 0;
 }
 
+//-----------------------------------------------------------------------------
+int VTKAmrWriter::SetStaging(const std::string &stagingDir, double bandwidth,
+  double capacity, bool handOff)
+{
+  std::shared_ptr<FileStager> stager = std::make_shared<FileStager>();
+
+  if (stager->Initialize(this->GetCommunicator(), stagingDir,
+    this->OutputDir, "VTKAmrWriter"))
+    {
+    SENSEI_ERROR("Failed to initialize staging in \"" << stagingDir << "\"")
+    return -1;
+    }
+
+  stager->SetBandwidth(bandwidth);
+  stager->SetCapacity(capacity);
+  stager->SetHandOff(handOff);
+
+  this->Stager = stager;
+  return 0;
+}
+
 //-----------------------------------------------------------------------------
 int VTKAmrWriter::SetMode(int mode)
 {
@@ -121,6 +286,15 @@ int VTKAmrWriter::SetMode(std::string modeStr)
   return 0;
 }
 
+//-----------------------------------------------------------------------------
+void VTKAmrWriter::SetNumberOfThreads(int nThreads)
+{
+  if (nThreads < 1)
+    nThreads = TaskRuntime::GetNumberOfThreads();
+
+  this->NumberOfThreads = nThreads;
+}
+
 //-----------------------------------------------------------------------------
 int VTKAmrWriter::SetDataRequirements(const DataRequirements &reqs)
 {
@@ -210,15 +384,16 @@ bool VTKAmrWriter::Execute(DataAdaptor* dataAdaptor)
     ArrayRequirementsIterator ait =
       this->Requirements.GetArrayRequirementsIterator(meshName);
 
+    ait.SetMode(ArrayRequirementsIterator::MODE_ASSOCIATION);
+
     while (ait)
       {
-      if (dataAdaptor->AddArray(dobj, mit.MeshName(),
-         ait.Association(), ait.Array()))
+      if (dataAdaptor->AddArrays(dobj, mit.MeshName(),
+         ait.Association(), ait.Arrays()))
         {
         SENSEI_ERROR("Failed to add "
           << VTKUtils::GetAttributesName(ait.Association())
-          << " data array \"" << ait.Array() << "\" to mesh \""
-          << meshName << "\"")
+          << " data arrays to mesh \"" << meshName << "\"")
         return false;
         }
 
@@ -232,16 +407,42 @@ bool VTKAmrWriter::Execute(DataAdaptor* dataAdaptor)
       this->FileId[meshName] = 0;
       }
 
-    // write to disk
-    std::string fileName =
-      getFileName(this->OutputDir, meshName, this->FileId[meshName], ".vth");
+    // write to disk, or to the staging directory
+    std::string fileName = getFileName(this->Stager ?
+      this->Stager->GetStagingDir() : this->OutputDir, meshName,
+      this->FileId[meshName], ".vth");
+
+    // the blocks are written in a directory named for the index. staging
+    // directories are node local so each rank makes its own
+    if (this->Stager &&
+      FileStager::MakeDirectories(fileName.substr(0, fileName.find_last_of('.'))))
+      return false;
 
-    vtkXMLPUniformGridAMRWriter *w = vtkXMLPUniformGridAMRWriter::New();
+    vtkDeferredAMRWriter *w = vtkDeferredAMRWriter::New();
     w->SetInputData(dobj);
     w->SetFileName(fileName.c_str());
     w->Write();
+
+    std::vector<std::string> blockFiles;
+    int ierr = w->WriteBlocks(this->NumberOfThreads, blockFiles);
     w->Delete();
 
+    // the index is written by rank 0
+    if (this->Stager && !ierr)
+      {
+      if (rank == 0)
+        blockFiles.push_back(fileName);
+
+      for (const std::string &blockFile : blockFiles)
+        ierr |= this->Stager->Stage(blockFile);
+      }
+
+    if (ierr)
+      {
+      SENSEI_ERROR("Failed to write mesh \"" << meshName << "\"")
+      return false;
+      }
+
     // update file id
     this->FileId[meshName] += 1;
 
@@ -269,6 +470,16 @@ int VTKAmrWriter::Finalize()
   int rank = 0;
   MPI_Comm_rank(this->GetCommunicator(), &rank);
 
+  // the meta files are written after the drain so that, unless the drain
+  // is handed off, the files they name are in place
+  int ierr = 0;
+  if (this->Stager && this->Stager->Finalize())
+    {
+    SENSEI_ERROR("Failed to drain the staged files to \"" << this->OutputDir << "\"")
+    ierr = -1;
+    }
+  this->Stager = nullptr;
+
   // clean up VTK
   vtkMultiProcessController *controller =
     vtkMultiProcessController::GetGlobalController();
@@ -281,7 +492,7 @@ int VTKAmrWriter::Finalize()
 
   // rank 0 will write meta files
   if (rank != 0)
-    return 0;
+    return ierr;
 
   std::vector<std::string> meshNames;
   this->Requirements.GetRequiredMeshes(meshNames);
@@ -363,7 +574,7 @@ int VTKAmrWriter::Finalize()
       }
     }
 
-  return 0;
+  return ierr;
 }
 
 }
@@ -5,12 +5,16 @@
 #include "DataRequirements.h"
 
 #include <mpi.h>
+#include <map>
+#include <memory>
 #include <vector>
 #include <string>
 
 
 namespace sensei
 {
+class FileStager;
+
 /// @class VTKAmrWriter
 /// brief sensei::VTKAmrWriter is a AnalysisAdaptor that writes
 /// AMR data to disk. This can be useful for generating preview datasets
@@ -30,11 +34,24 @@ public:
   // Run time configuration
   int SetOutputDir(const std::string &outputDir);
 
+  // stage the files on node local storage and drain them to the output
+  // directory in the background, see VTKPosthocIO::SetStaging and
+  // FileStager. call after SetOutputDir.
+  int SetStaging(const std::string &stagingDir, double bandwidth = 0.0,
+    double capacity = 0.0, bool handOff = false);
+
   enum {MODE_PARAVIEW=0, MODE_VISIT=1};
   int SetMode(int mode);
 
   int SetMode(std::string mode);
 
+  // set the number of threads used to write the blocks. blocks are handed
+  // out in the order of the .vthb index and the files are the same as
+  // when written serially. the threads are those of the TaskRuntime, a
+  // value less than 1 uses all of them.
+  // the default is 1.
+  void SetNumberOfThreads(int nThreads);
+
   /// data requirements tell the adaptor what to push
   /// if none are given then all data is pushed.
   int SetDataRequirements(const DataRequirements &reqs);
@@ -60,6 +77,7 @@ private:
   std::string OutputDir;
   DataRequirements Requirements;
   int Mode;
+  int NumberOfThreads;
 
   template<typename T>
   using NameMap = std::map<std::string, T>;
@@ -68,6 +86,7 @@ private:
   NameMap<std::vector<long>> TimeStep;
   NameMap<long> FileId;
   NameMap<int> HaveBlockInfo;
+  std::shared_ptr<FileStager> Stager;
 #endif
 };
 
@@ -35,7 +35,10 @@ namespace sensei
 
 struct VTKDataAdaptor::InternalsType
 {
+  InternalsType() : NumThreads(1) {}
+
   MeshMapType MeshMap;
+  int NumThreads;
 };
 
 //----------------------------------------------------------------------------
@@ -60,6 +63,12 @@ void VTKDataAdaptor::SetDataObject(const std::string &meshName,
   this->Internals->MeshMap[meshName] = dobj;
 }
 
+//----------------------------------------------------------------------------
+void VTKDataAdaptor::SetNumberOfThreads(int nThreads)
+{
+  this->Internals->NumThreads = nThreads;
+}
+
 //----------------------------------------------------------------------------
 int VTKDataAdaptor::GetDataObject(const std::string &meshName,
   vtkDataObject *&mesh)
@@ -112,7 +121,8 @@ int VTKDataAdaptor::GetMeshMetadata(unsigned int id, MeshMetadataPtr &metadata)
   // multiblock and amr
   if (vtkCompositeDataSet *cd = dynamic_cast<vtkCompositeDataSet*>(dobj))
     {
-    if (VTKUtils::GetMetadata(this->GetCommunicator(), cd, metadata))
+    if (VTKUtils::GetMetadata(this->GetCommunicator(), cd, metadata,
+      this->Internals->NumThreads))
       {
       SENSEI_ERROR("Failed to get metadata for composite mesh \""
         << meshName << "\"")
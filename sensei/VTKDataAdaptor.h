@@ -45,6 +45,12 @@ public:
   /// @returns zero if the named mesh is present, non zero if it was not
   int GetDataObject(const std::string &meshName, vtkDataObject *&dobj);
 
+  /// @brief Set the number of threads used to generate block metadata
+  ///
+  /// The blocks of a composite dataset are spread over the threads when
+  /// computing metadata. The default is 1.
+  void SetNumberOfThreads(int nThreads);
+
   /// @breif Gets the number of meshes a simulation can provide
   ///
   /// The caller passes a reference to an integer variable in the first
@@ -0,0 +1,655 @@
+#include "VTKHDFWriter.h"
+#include "MeshMetadata.h"
+#include "VTKUtils.h"
+#include "Profiler.h"
+#include "Error.h"
+
+#include <vtkCellData.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSet.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdList.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPointSet.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+
+#include <hdf5.h>
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace sensei
+{
+
+struct VTKHDFWriter::InternalsType
+{
+  InternalsType() : Comm(MPI_COMM_NULL), Rank(0), File(-1), Collective(-1),
+    NumSteps(0), HaveGeometry(false), GeometryOffsets{0, 0, 0, 0},
+    NumParts(0) {}
+
+  // get the dataset, creating it on first use. datasets are 1D, or 2D
+  // with a column per component, and grow along the first dimension
+  hid_t GetDataset(const std::string &path, hid_t type, int nComps);
+
+  // append the local rows of a dataset at start, relative to its current
+  // end, of a total number of rows over all ranks. collective.
+  int Append(const std::string &path, hid_t type, int nComps,
+    const void *data, long long nLocal, long long start, long long total);
+
+  // the number of rows in the dataset
+  long long GetSize(const std::string &path) { return this->Size[path]; }
+
+  MPI_Comm Comm;
+  int Rank;
+  hid_t File;
+  hid_t Collective;
+  std::map<std::string, hid_t> Datasets;
+  std::map<std::string, long long> Size;
+  long NumSteps;
+  DataRequirements Precision;
+
+  // the part, point, cell and connectivity offsets of the last geometry
+  bool HaveGeometry;
+  long long GeometryOffsets[4];
+  long long NumParts;
+};
+
+namespace
+{
+// --------------------------------------------------------------------------
+hid_t GetHDF5Type(int vtkType)
+{
+  switch (vtkType)
+    {
+    case VTK_FLOAT: return H5T_NATIVE_FLOAT;
+    case VTK_DOUBLE: return H5T_NATIVE_DOUBLE;
+    case VTK_CHAR: return H5T_NATIVE_CHAR;
+    case VTK_SIGNED_CHAR: return H5T_NATIVE_SCHAR;
+    case VTK_UNSIGNED_CHAR: return H5T_NATIVE_UCHAR;
+    case VTK_SHORT: return H5T_NATIVE_SHORT;
+    case VTK_UNSIGNED_SHORT: return H5T_NATIVE_USHORT;
+    case VTK_INT: return H5T_NATIVE_INT;
+    case VTK_UNSIGNED_INT: return H5T_NATIVE_UINT;
+    case VTK_LONG: return H5T_NATIVE_LONG;
+    case VTK_UNSIGNED_LONG: return H5T_NATIVE_ULONG;
+    case VTK_LONG_LONG: return H5T_NATIVE_LLONG;
+    case VTK_UNSIGNED_LONG_LONG: return H5T_NATIVE_ULLONG;
+    case VTK_ID_TYPE:
+      return sizeof(vtkIdType) == 8 ? H5T_NATIVE_LLONG : H5T_NATIVE_INT;
+    }
+  return -1;
+}
+
+// --------------------------------------------------------------------------
+// write a string attribute, fixed length as ParaView expects
+int WriteStringAttribute(hid_t owner, const char *name, const char *value)
+{
+  hid_t type = H5Tcopy(H5T_C_S1);
+  H5Tset_size(type, strlen(value));
+  H5Tset_strpad(type, H5T_STR_NULLPAD);
+
+  hid_t space = H5Screate(H5S_SCALAR);
+  hid_t attr = H5Acreate(owner, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+  herr_t ierr = attr < 0 ? -1 : H5Awrite(attr, type, value);
+
+  if (attr >= 0)
+    H5Aclose(attr);
+  H5Sclose(space);
+  H5Tclose(type);
+
+  return ierr < 0 ? -1 : 0;
+}
+
+// --------------------------------------------------------------------------
+// get the global view metadata of an array. returns zero if found
+int GetArrayInfo(const MeshMetadataPtr &mmd, int assoc, const std::string &name,
+  int &type, int &nComps)
+{
+  unsigned int nArrays = mmd->ArrayName.size();
+  for (unsigned int i = 0; i < nArrays; ++i)
+    {
+    if ((mmd->ArrayName[i] == name) && (mmd->ArrayCentering[i] == assoc))
+      {
+      type = mmd->ArrayType[i];
+      nComps = mmd->ArrayComponents[i];
+      return 0;
+      }
+    }
+  return -1;
+}
+
+// --------------------------------------------------------------------------
+// pack an array of the blocks into a contiguous buffer of the given type.
+// blocks that lack the array are zero filled. returns zero if all blocks
+// had it
+int PackArray(const std::vector<vtkDataSet*> &blocks, int assoc,
+  const std::string &name, int type, int nComps, std::vector<char> &buf)
+{
+  int ierr = 0;
+
+  long long nTuples = 0;
+  unsigned int nBlocks = blocks.size();
+  for (unsigned int i = 0; i < nBlocks; ++i)
+    nTuples += assoc == vtkDataObject::POINT ? blocks[i]->GetNumberOfPoints() :
+      blocks[i]->GetNumberOfCells();
+
+  vtkSmartPointer<vtkDataArray> tmp;
+  tmp.TakeReference(vtkDataArray::CreateDataArray(type));
+  long long elemSize = tmp->GetDataTypeSize();
+
+  buf.assign(nTuples*nComps*elemSize, 0);
+
+  long long offset = 0;
+  for (unsigned int i = 0; i < nBlocks; ++i)
+    {
+    vtkDataSetAttributes *atts = assoc == vtkDataObject::POINT ?
+      static_cast<vtkDataSetAttributes*>(blocks[i]->GetPointData()) :
+      static_cast<vtkDataSetAttributes*>(blocks[i]->GetCellData());
+
+    long long n = assoc == vtkDataObject::POINT ?
+      blocks[i]->GetNumberOfPoints() : blocks[i]->GetNumberOfCells();
+
+    vtkDataArray *da = atts->GetArray(name.c_str());
+    if (!da || (da->GetNumberOfComponents() != nComps) ||
+      (da->GetNumberOfTuples() != n))
+      {
+      ierr = -1;
+      }
+    else if (n > 0)
+      {
+      // converts the type and the memory layout as needed
+      tmp->DeepCopy(da);
+      memcpy(buf.data() + offset*nComps*elemSize, tmp->GetVoidPointer(0),
+        n*nComps*elemSize);
+      }
+
+    offset += n;
+    }
+
+  return ierr;
+}
+}
+
+// --------------------------------------------------------------------------
+hid_t VTKHDFWriter::InternalsType::GetDataset(const std::string &path,
+  hid_t type, int nComps)
+{
+  std::map<std::string, hid_t>::iterator it = this->Datasets.find(path);
+  if (it != this->Datasets.end())
+    return it->second;
+
+  int nDims = nComps > 1 ? 2 : 1;
+  hsize_t dims[2] = {0, hsize_t(nComps)};
+  hsize_t maxDims[2] = {H5S_UNLIMITED, hsize_t(nComps)};
+  hsize_t chunk[2] = {hsize_t(nComps > 1 ? 16384 : 65536), hsize_t(nComps)};
+
+  hid_t space = H5Screate_simple(nDims, dims, maxDims);
+
+  hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(dcpl, nDims, chunk);
+
+  // the PointData, CellData and Steps groups are made as needed
+  hid_t lcpl = H5Pcreate(H5P_LINK_CREATE);
+  H5Pset_create_intermediate_group(lcpl, 1);
+
+  hid_t dset = H5Dcreate(this->File, ("/VTKHDF/" + path).c_str(), type,
+    space, lcpl, dcpl, H5P_DEFAULT);
+
+  H5Pclose(lcpl);
+  H5Pclose(dcpl);
+  H5Sclose(space);
+
+  if (dset < 0)
+    {
+    SENSEI_ERROR("Failed to create the dataset \"" << path << "\"")
+    return -1;
+    }
+
+  this->Datasets[path] = dset;
+  this->Size[path] = 0;
+
+  return dset;
+}
+
+// --------------------------------------------------------------------------
+int VTKHDFWriter::InternalsType::Append(const std::string &path, hid_t type,
+  int nComps, const void *data, long long nLocal, long long start,
+  long long total)
+{
+  hid_t dset = this->GetDataset(path, type, nComps);
+  if (dset < 0)
+    return -1;
+
+  long long size = this->Size[path];
+
+  int nDims = nComps > 1 ? 2 : 1;
+  hsize_t dims[2] = {hsize_t(size + total), hsize_t(nComps)};
+  if (H5Dset_extent(dset, dims) < 0)
+    {
+    SENSEI_ERROR("Failed to extend the dataset \"" << path << "\"")
+    return -1;
+    }
+
+  hid_t fileSpace = H5Dget_space(dset);
+
+  hsize_t one = 1;
+  hsize_t count[2] = {hsize_t(nLocal), hsize_t(nComps)};
+  hid_t memSpace = nLocal > 0 ? H5Screate_simple(nDims, count, nullptr) :
+    H5Screate_simple(1, &one, nullptr);
+
+  // ranks without rows take part in the collective with empty selections
+  if (nLocal > 0)
+    {
+    hsize_t offset[2] = {hsize_t(size + start), 0};
+    H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, nullptr, count,
+      nullptr);
+    }
+  else
+    {
+    H5Sselect_none(fileSpace);
+    H5Sselect_none(memSpace);
+    }
+
+  herr_t ierr = H5Dwrite(dset, type, memSpace, fileSpace, this->Collective,
+    data);
+
+  H5Sclose(memSpace);
+  H5Sclose(fileSpace);
+
+  if (ierr < 0)
+    {
+    SENSEI_ERROR("Failed to write the dataset \"" << path << "\"")
+    return -1;
+    }
+
+  this->Size[path] = size + total;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+VTKHDFWriter::VTKHDFWriter() : Internals(new InternalsType)
+{
+}
+
+// --------------------------------------------------------------------------
+VTKHDFWriter::~VTKHDFWriter()
+{
+  this->Close();
+  delete this->Internals;
+}
+
+// --------------------------------------------------------------------------
+long VTKHDFWriter::GetNumberOfSteps() const
+{
+  return this->Internals->NumSteps;
+}
+
+// --------------------------------------------------------------------------
+void VTKHDFWriter::SetArrayPrecision(const DataRequirements &reqs)
+{
+  this->Internals->Precision = reqs;
+}
+
+// --------------------------------------------------------------------------
+int VTKHDFWriter::Open(MPI_Comm comm, const std::string &fileName)
+{
+  TimeEvent<128> mark("VTKHDFWriter::Open");
+
+  this->Close();
+
+  InternalsType *internals = this->Internals;
+  internals->Comm = comm;
+  MPI_Comm_rank(comm, &internals->Rank);
+
+  hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+  H5Pset_fapl_mpio(fapl, comm, MPI_INFO_NULL);
+
+  // the metadata is written collectively too
+  H5Pset_coll_metadata_write(fapl, true);
+
+  internals->File = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+  H5Pclose(fapl);
+
+  if (internals->File < 0)
+    {
+    SENSEI_ERROR("Failed to create \"" << fileName << "\"")
+    return -1;
+    }
+
+  internals->Collective = H5Pcreate(H5P_DATASET_XFER);
+  H5Pset_dxpl_mpio(internals->Collective, H5FD_MPIO_COLLECTIVE);
+
+  hid_t root = H5Gcreate(internals->File, "/VTKHDF", H5P_DEFAULT,
+    H5P_DEFAULT, H5P_DEFAULT);
+
+  int version[2] = {2, 0};
+  hsize_t two = 2;
+  hid_t space = H5Screate_simple(1, &two, nullptr);
+  hid_t attr = H5Acreate(root, "Version", H5T_NATIVE_INT, space,
+    H5P_DEFAULT, H5P_DEFAULT);
+  herr_t ierr = H5Awrite(attr, H5T_NATIVE_INT, version);
+  H5Aclose(attr);
+  H5Sclose(space);
+
+  if ((ierr < 0) || WriteStringAttribute(root, "Type", "UnstructuredGrid"))
+    {
+    SENSEI_ERROR("Failed to write the VTKHDF header to \"" << fileName << "\"")
+    H5Gclose(root);
+    return -1;
+    }
+
+  // the number of steps is updated as they are written
+  hid_t steps = H5Gcreate(root, "Steps", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  long long nSteps = 0;
+  space = H5Screate(H5S_SCALAR);
+  attr = H5Acreate(steps, "NSteps", H5T_NATIVE_LLONG, space, H5P_DEFAULT,
+    H5P_DEFAULT);
+  H5Awrite(attr, H5T_NATIVE_LLONG, &nSteps);
+  H5Aclose(attr);
+  H5Sclose(space);
+  H5Gclose(steps);
+
+  H5Gclose(root);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int VTKHDFWriter::Close()
+{
+  InternalsType *internals = this->Internals;
+  if (internals->File < 0)
+    return 0;
+
+  std::map<std::string, hid_t>::iterator it = internals->Datasets.begin();
+  std::map<std::string, hid_t>::iterator end = internals->Datasets.end();
+  for (; it != end; ++it)
+    H5Dclose(it->second);
+
+  internals->Datasets.clear();
+  internals->Size.clear();
+
+  H5Pclose(internals->Collective);
+  H5Fclose(internals->File);
+
+  internals->Collective = -1;
+  internals->File = -1;
+  internals->NumSteps = 0;
+  internals->HaveGeometry = false;
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int VTKHDFWriter::WriteStep(vtkCompositeDataSet *cd,
+  const MeshMetadataPtr &mmd, const BlockStream::ArrayMap &arrays,
+  double time)
+{
+  TimeEvent<128> mark("VTKHDFWriter::WriteStep");
+
+  InternalsType *internals = this->Internals;
+  if (internals->File < 0)
+    {
+    SENSEI_ERROR("The file is not open")
+    return -1;
+    }
+
+  // errors are reported after the collectives so that no rank is left
+  // waiting
+  int ierr = 0;
+
+  // each local block is a partition
+  std::vector<vtkDataSet*> blocks;
+  if (cd)
+    {
+    vtkSmartPointer<vtkCompositeDataIterator> it;
+    it.TakeReference(cd->NewIterator());
+    it->SetSkipEmptyNodes(1);
+    for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+      {
+      vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+      if (ds)
+        blocks.push_back(ds);
+      }
+    }
+
+  long long nParts = blocks.size();
+  long long nPoints = 0;
+  long long nCells = 0;
+  long long nConn = 0;
+
+  std::vector<long long> partPoints(nParts);
+  std::vector<long long> partCells(nParts);
+  std::vector<long long> partConn(nParts);
+  for (long long i = 0; i < nParts; ++i)
+    {
+    partPoints[i] = blocks[i]->GetNumberOfPoints();
+    partCells[i] = blocks[i]->GetNumberOfCells();
+    nPoints += partPoints[i];
+    nCells += partCells[i];
+    }
+
+  // the geometry of a static mesh is written once
+  bool writeGeometry = !(mmd->StaticMesh && internals->HaveGeometry);
+
+  std::vector<double> points;
+  std::vector<unsigned char> types;
+  std::vector<long long> conn;
+  std::vector<long long> offsets;
+
+  if (writeGeometry)
+    {
+    points.resize(3*nPoints);
+    types.reserve(nCells);
+    offsets.reserve(nCells + nParts);
+
+    vtkNew<vtkIdList> ids;
+    vtkNew<vtkDoubleArray> pts;
+    long long p = 0;
+    for (long long i = 0; i < nParts; ++i)
+      {
+      vtkDataSet *ds = blocks[i];
+
+      // point sets are copied in bulk, others have implicit points
+      vtkPointSet *ps = dynamic_cast<vtkPointSet*>(ds);
+      if (ps && ps->GetPoints() && (partPoints[i] > 0))
+        {
+        pts->DeepCopy(ps->GetPoints()->GetData());
+        memcpy(points.data() + 3*p, pts->GetPointer(0),
+          3*partPoints[i]*sizeof(double));
+        }
+      else
+        {
+        for (long long j = 0; j < partPoints[i]; ++j)
+          ds->GetPoint(j, points.data() + 3*(p + j));
+        }
+      p += partPoints[i];
+
+      // the offsets of each partition start from zero
+      long long off = 0;
+      offsets.push_back(off);
+      for (long long j = 0; j < partCells[i]; ++j)
+        {
+        types.push_back(ds->GetCellType(j));
+        ds->GetCellPoints(j, ids.GetPointer());
+
+        vtkIdType nIds = ids->GetNumberOfIds();
+        for (vtkIdType k = 0; k < nIds; ++k)
+          conn.push_back(ids->GetId(k));
+
+        off += nIds;
+        offsets.push_back(off);
+        }
+
+      partConn[i] = off;
+      nConn += off;
+      }
+    }
+
+  // the position of the local rows and the total over all ranks, for
+  // each of parts, points, cells, connectivity and offsets
+  long long counts[5] = {nParts, nPoints, nCells, nConn,
+    (long long)offsets.size()};
+  long long starts[5] = {0, 0, 0, 0, 0};
+  long long totals[5] = {0, 0, 0, 0, 0};
+
+  MPI_Exscan(counts, starts, 5, MPI_LONG_LONG, MPI_SUM, internals->Comm);
+  MPI_Allreduce(counts, totals, 5, MPI_LONG_LONG, MPI_SUM, internals->Comm);
+
+  if (internals->Rank == 0)
+    memset(starts, 0, sizeof(starts));
+
+  if (writeGeometry)
+    {
+    internals->GeometryOffsets[0] = internals->GetSize("NumberOfPoints");
+    internals->GeometryOffsets[1] = internals->GetSize("Points");
+    internals->GeometryOffsets[2] = internals->GetSize("Types");
+    internals->GeometryOffsets[3] = internals->GetSize("Connectivity");
+    internals->NumParts = totals[0];
+
+    ierr |= internals->Append("NumberOfPoints", H5T_NATIVE_LLONG, 1,
+      partPoints.data(), nParts, starts[0], totals[0]);
+
+    ierr |= internals->Append("NumberOfCells", H5T_NATIVE_LLONG, 1,
+      partCells.data(), nParts, starts[0], totals[0]);
+
+    ierr |= internals->Append("NumberOfConnectivityIds", H5T_NATIVE_LLONG, 1,
+      partConn.data(), nParts, starts[0], totals[0]);
+
+    ierr |= internals->Append("Points", H5T_NATIVE_DOUBLE, 3,
+      points.data(), nPoints, starts[1], totals[1]);
+
+    ierr |= internals->Append("Types", H5T_NATIVE_UCHAR, 1,
+      types.data(), nCells, starts[2], totals[2]);
+
+    ierr |= internals->Append("Connectivity", H5T_NATIVE_LLONG, 1,
+      conn.data(), nConn, starts[3], totals[3]);
+
+    ierr |= internals->Append("Offsets", H5T_NATIVE_LLONG, 1,
+      offsets.data(), offsets.size(), starts[4], totals[4]);
+
+    internals->HaveGeometry = true;
+    }
+  else if (totals[0] != internals->NumParts)
+    {
+    SENSEI_ERROR("The partitioning of the static mesh \"" << mmd->MeshName
+      << "\" changed from " << internals->NumParts << " to " << totals[0]
+      << " blocks")
+    ierr = -1;
+    }
+
+  // the arrays, with the ghost arrays the data adaptor added
+  BlockStream::ArrayMap allArrays = arrays;
+  if (mmd->NumGhostCells || VTKUtils::AMR(mmd))
+    allArrays[vtkDataObject::CELL].push_back("vtkGhostType");
+  if (mmd->NumGhostNodes)
+    allArrays[vtkDataObject::POINT].push_back("vtkGhostType");
+
+  // the step's offsets, written by rank 0
+  std::vector<std::pair<std::string, long long>> stepOffsets;
+
+  BlockStream::ArrayMap::iterator ait = allArrays.begin();
+  BlockStream::ArrayMap::iterator aend = allArrays.end();
+  for (; ait != aend; ++ait)
+    {
+    int assoc = ait->first;
+    if ((assoc != vtkDataObject::POINT) && (assoc != vtkDataObject::CELL))
+      continue;
+
+    const char *group = assoc == vtkDataObject::POINT ? "PointData" : "CellData";
+    int ti = assoc == vtkDataObject::POINT ? 1 : 2;
+
+    unsigned int nArrays = ait->second.size();
+    for (unsigned int i = 0; i < nArrays; ++i)
+      {
+      const std::string &name = ait->second[i];
+
+      int type = VTK_UNSIGNED_CHAR;
+      int nComps = 1;
+      if ((name != "vtkGhostType") &&
+        GetArrayInfo(mmd, assoc, name, type, nComps))
+        {
+        // the metadata is the same on all ranks, as is this decision
+        SENSEI_ERROR("No " << group << " array named \"" << name
+          << "\" on mesh \"" << mmd->MeshName << "\"")
+        ierr = -1;
+        continue;
+        }
+
+      // arrays stored at reduced precision are converted as they are packed
+      if (name != "vtkGhostType")
+        type = VTKUtils::GetStorageType(type,
+          internals->Precision.GetArrayPrecision(mmd->MeshName, assoc, name));
+
+      hid_t h5Type = GetHDF5Type(type);
+      if (h5Type < 0)
+        {
+        SENSEI_ERROR("Array \"" << name << "\" has unsupported type " << type)
+        ierr = -1;
+        continue;
+        }
+
+      std::vector<char> buf;
+      if (PackArray(blocks, assoc, name, type, nComps, buf))
+        {
+        SENSEI_ERROR("Array \"" << name << "\" is missing or malformed on"
+          " some blocks of mesh \"" << mmd->MeshName << "\"")
+        ierr = -1;
+        }
+
+      std::string path = std::string(group) + "/" + name;
+      stepOffsets.push_back(std::make_pair(std::string("Steps/") + group +
+        "Offsets/" + name, internals->GetSize(path)));
+
+      ierr |= internals->Append(path, h5Type, nComps, buf.data(),
+        counts[ti], starts[ti], totals[ti]);
+      }
+    }
+
+  // the step's entry. a static mesh refers to the geometry written first
+  int nStep = internals->Rank == 0 ? 1 : 0;
+
+  ierr |= internals->Append("Steps/Values", H5T_NATIVE_DOUBLE, 1,
+    &time, nStep, 0, 1);
+
+  const char *geomOffsets[4] = {"Steps/PartOffsets", "Steps/PointOffsets",
+    "Steps/CellOffsets", "Steps/ConnectivityIdOffsets"};
+  for (int i = 0; i < 4; ++i)
+    ierr |= internals->Append(geomOffsets[i], H5T_NATIVE_LLONG, 1,
+      &internals->GeometryOffsets[i], nStep, 0, 1);
+
+  ierr |= internals->Append("Steps/NumberOfParts", H5T_NATIVE_LLONG, 1,
+    &internals->NumParts, nStep, 0, 1);
+
+  unsigned int nOffsets = stepOffsets.size();
+  for (unsigned int i = 0; i < nOffsets; ++i)
+    ierr |= internals->Append(stepOffsets[i].first, H5T_NATIVE_LLONG, 1,
+      &stepOffsets[i].second, nStep, 0, 1);
+
+  internals->NumSteps += 1;
+
+  long long nSteps = internals->NumSteps;
+  hid_t attr = H5Aopen_by_name(internals->File, "/VTKHDF/Steps", "NSteps",
+    H5P_DEFAULT, H5P_DEFAULT);
+  if ((attr < 0) || (H5Awrite(attr, H5T_NATIVE_LLONG, &nSteps) < 0))
+    {
+    SENSEI_ERROR("Failed to update the number of steps")
+    ierr = -1;
+    }
+  if (attr >= 0)
+    H5Aclose(attr);
+
+  // keep the file readable while the run progresses
+  H5Fflush(internals->File, H5F_SCOPE_GLOBAL);
+
+  return ierr ? -1 : 0;
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef sensei_VTKHDFWriter_h
+#define sensei_VTKHDFWriter_h
+
+#include "BlockStream.h"
+#include "MeshMetadata.h"
+#include "DataRequirements.h"
+
+#include <mpi.h>
+#include <string>
+
+class vtkCompositeDataSet;
+
+namespace sensei
+{
+
+/// @class VTKHDFWriter
+/// @brief appends the steps of a mesh to a single VTKHDF file.
+///
+/// Writing a file per block per step produces millions of small files on
+/// large runs. This writer instead puts every block of every step in one
+/// file per mesh, using the temporal UnstructuredGrid layout of VTKHDF 2.0
+/// which ParaView reads natively. Each local block is a partition, and all
+/// of the data is written with collective parallel HDF5 I/O. The offsets
+/// of each step are kept in the Steps group. When the metadata reports a
+/// static mesh the geometry is written with the first step and the later
+/// steps refer to it, only their arrays are appended.
+///
+/// VTKHDF image data holds a single piece, hence blocks of all dataset
+/// types are written as unstructured cells. The arrays are described by
+/// the global view of the metadata so that ranks without blocks agree on
+/// their types, ranks without data take part in the collectives.
+class VTKHDFWriter
+{
+public:
+  VTKHDFWriter();
+  ~VTKHDFWriter();
+
+  VTKHDFWriter(const VTKHDFWriter&) = delete;
+  void operator=(const VTKHDFWriter&) = delete;
+
+  /// create the file, replacing any existing one. collective. returns
+  /// zero if successful.
+  int Open(MPI_Comm comm, const std::string &fileName);
+
+  /// append a step. mmd must be a global view, the ghost arrays are
+  /// written when present. collective. returns zero if successful.
+  int WriteStep(vtkCompositeDataSet *cd, const MeshMetadataPtr &mmd,
+    const BlockStream::ArrayMap &arrays, double time);
+
+  /// close the file. collective. returns zero if successful.
+  int Close();
+
+  /// store the arrays at the precision given for each by reqs, see
+  /// DataRequirements::SetArrayPrecision. float16 is stored as float32,
+  /// VTK has no 16 bit type to read it into.
+  void SetArrayPrecision(const DataRequirements &reqs);
+
+  /// the number of steps written so far
+  long GetNumberOfSteps() const;
+
+  struct InternalsType;
+
+private:
+  InternalsType *Internals;
+};
+
+}
+
+#endif
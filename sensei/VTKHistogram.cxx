@@ -1,260 +1,794 @@
 #include "senseiConfig.h"
 #include "VTKHistogram.h"
+#include "ArrayDispatch.h"
 #include "Error.h"
+#include "Profiler.h"
+#include "Sampling.h"
+#include "TaskRuntime.h"
+#include "VTKUtils.h"
 
 #include <algorithm>
+#include <numeric>
+#include <memory>
 #include <vector>
+#include <limits>
+#include <cassert>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <errno.h>
 
+#include <vtkDataArray.h>
 #include <vtkSmartPointer.h>
 #include <vtkUnsignedCharArray.h>
-#ifdef ENABLE_VTK_GENERIC_ARRAYS
-#include <vtkAOSDataArrayTemplate.h>
-#include <vtkArrayDispatch.h>
-#include <vtkCompositeDataIterator.h>
-#include <vtkCompositeDataSet.h>
-#include <vtkDataArray.h>
-#include <vtkDataObject.h>
-#include <vtkFieldData.h>
-#include <vtkObjectFactory.h>
-#else
-#include <vtkDataArrayDispatcher.h>
-#include <vtkDataArrayTemplate.h>
-#endif
+
+namespace
+{
+// bins a contiguous run of values. the bin ids are computed in blocks
+// so that the compiler can vectorize the arithmetic, values at or beyond
+// the ends of the range are clamped into the first and last bins. ghost
+// values are masked out without branching.
+template <typename T>
+void binValues(const T *vals, const unsigned char *ghosts, long n,
+  double min, double width, int nBins, unsigned int *hist)
+{
+  const long blockSize = 512;
+  const double maxBin = nBins - 1;
+  int bins[blockSize];
+
+  for (long i0 = 0; i0 < n; i0 += blockSize)
+    {
+    long m = std::min(blockSize, n - i0);
+
+    const T *pv = vals + i0;
+    for (long i = 0; i < m; ++i)
+      {
+      double bin = (static_cast<double>(pv[i]) - min) / width;
+      bins[i] = static_cast<int>(std::min(std::max(0.0, bin), maxBin));
+      }
+
+    if (ghosts)
+      {
+      const unsigned char *pg = ghosts + i0;
+      for (long i = 0; i < m; ++i)
+        hist[bins[i]] += (pg[i] == 0);
+      }
+    else
+      {
+      for (long i = 0; i < m; ++i)
+        ++hist[bins[i]];
+      }
+    }
+}
+
+// bins the values, splitting the work over the requested number of
+// threads. each thread accumulates a private histogram, these are
+// summed into the result when all threads have completed.
+template <typename T>
+void histogram(const T *vals, const unsigned char *ghosts,
+  const sensei::VTKUtils::InteriorRange *interior, long n,
+  const double *range, int nBins, int nThreads, unsigned int *hist)
+{
+  double min = range[0];
+  double width = (range[1] - range[0]) / nBins;
+
+  // place everything in the first bin when the range is empty
+  if (!(width > 0.0))
+    width = std::numeric_limits<double>::infinity();
+
+  // bin the values [start, start + nLocal). when the ghosts are given by
+  // an index range only the spans of interior values are visited
+  auto binRange = [&](long start, long nLocal, unsigned int *h)
+    {
+    if (!interior)
+      {
+      binValues(vals + start, ghosts ? ghosts + start : nullptr, nLocal,
+        min, width, nBins, h);
+      return;
+      }
+
+    interior->ForEachSpan(start, start + nLocal,
+      [&](long begin, long end, bool isInterior)
+      {
+      if (isInterior)
+        binValues(vals + begin, static_cast<const unsigned char*>(nullptr),
+          end - begin, min, width, nBins, h);
+      });
+    };
+
+  // don't bother with threads for small arrays
+  const long minPerThread = 65536;
+  nThreads = std::max(1l, std::min(static_cast<long>(nThreads), n/minPerThread));
+
+  if (nThreads == 1)
+    {
+    binRange(0, n, hist);
+    return;
+    }
+
+  std::vector<std::vector<unsigned int>> threadHist(nThreads,
+    std::vector<unsigned int>(nBins, 0));
+
+  // the pieces are binned on the process wide pool
+  long blockSize = n / nThreads;
+  long nLarge = n % nThreads;
+  sensei::TaskRuntime::ParallelFor(nThreads, nThreads,
+    [&](int, long i) -> int
+    {
+    long start = i*blockSize + (i < nLarge ? i : nLarge);
+    long nLocal = blockSize + (i < nLarge ? 1 : 0);
+
+    binRange(start, nLocal, threadHist[i].data());
+
+    return 0;
+    });
+
+  for (int i = 0; i < nThreads; ++i)
+    {
+    const unsigned int *th = threadHist[i].data();
+    for (int j = 0; j < nBins; ++j)
+      hist[j] += th[j];
+    }
+}
+
+// accumulate the range of the values [begin, end) that are not ghosts
+template <typename T>
+void spanRange(vtkDataArray *da, const T *vals, const unsigned char *ghosts,
+  long begin, long end, double *range)
+{
+  double lo = range[0];
+  double hi = range[1];
+  for (long i = begin; i < end; ++i)
+    {
+    if (ghosts && ghosts[i])
+      continue;
+
+    double val = sensei::ArrayDispatch::GetValue(da, vals, i);
+    lo = std::min(lo, val);
+    hi = std::max(hi, val);
+    }
+  range[0] = lo;
+  range[1] = hi;
+}
+
+// accumulate the range of the values that are not ghosts, these are given
+// either by a mask or by the spans of interior values
+struct RangeKernel
+{
+  template <typename T>
+  void operator()(const T *vals)
+  {
+    if (!this->Interior)
+      {
+      spanRange(this->Array, vals, this->Ghosts, 0,
+        this->Array->GetNumberOfTuples(), this->Range);
+      return;
+      }
+
+    this->Interior->ForEachSpan(0, this->Array->GetNumberOfTuples(),
+      [&](long begin, long end, bool isInterior)
+      {
+      if (isInterior)
+        spanRange(this->Array, vals, static_cast<const unsigned char*>(nullptr),
+          begin, end, this->Range);
+      });
+  }
+
+  vtkDataArray *Array;
+  const unsigned char *Ghosts;
+  const sensei::VTKUtils::InteriorRange *Interior;
+  double *Range;
+};
+
+// accumulate the range of a stratified sample of the values
+void sampleRange(vtkDataArray *da, vtkUnsignedCharArray *ghostArray,
+  const sensei::VTKUtils::InteriorRange *interior, double fraction,
+  unsigned long seed, double *range)
+{
+  std::vector<long> ids;
+  sensei::Sampling::GetSampleIds(da->GetNumberOfTuples(), fraction, seed, ids);
+
+  const unsigned char *ghosts = ghostArray ? ghostArray->GetPointer(0) : nullptr;
+
+  for (long id : ids)
+    {
+    if ((ghosts && ghosts[id]) || (interior && !interior->IsInterior(id)))
+      continue;
+
+    double val = da->GetComponent(id, 0);
+    range[0] = std::min(range[0], val);
+    range[1] = std::max(range[1], val);
+    }
+}
+}
 
 namespace sensei
 {
 // Private worker for Histogram method. Computes the local Histogram on
-// array (passed to operator()). To be used with vtkArrayDispatch.
+// array. To be used with ArrayDispatch.
 //
 // Inputs:
 // range: Global range of data
 // bins: Number of Histogram bins
 // array: Local data.
+// ghost array: Optional. non-zero values mark elements that are skipped
+// interior: Optional. the elements that are not skipped, instead of a mask
+// threads: Number of threads to use.
+// fraction, seed: Optional. the sample of the values used, see Sample.
 //
 // Outputs:
-// Histogram: The Histogram of the local data.
-#ifdef ENABLE_VTK_GENERIC_ARRAYS
+// Histogram: The Histogram of the local data, or of the sample.
+// Estimate: The estimated counts of the local data when sampled.
 struct VTKHistogram::Internals
 {
+  vtkDataArray *Array;
+  vtkUnsignedCharArray* GhostArray;
+  const VTKUtils::InteriorRange *Interior;
   const double *Range;
   int Bins;
+  int Threads;
+  double Fraction;
+  unsigned long Seed;
   std::vector<unsigned int> Histogram;
+  std::vector<unsigned int> Result;
+  std::vector<double> Estimate;
+  double NumSamples;
+  std::vector<double> Lower;
+  std::vector<double> Upper;
+
+  Internals(const double *range, int bins, int threads, double fraction,
+    unsigned long seed) : Array(nullptr), GhostArray(NULL), Interior(nullptr), Range(range),
+    Bins(bins), Threads(threads), Fraction(fraction), Seed(seed),
+    Histogram(bins,0),
+    Estimate(fraction < 1.0 ? bins : 0, 0.0), NumSamples(0.0) {}
+
+  const unsigned char *GetGhosts()
+  {
+    return this->GhostArray ? this->GhostArray->GetPointer(0) : nullptr;
+  }
 
-  Internals(const double *range, int bins) :
-    Range(range), Bins(bins), Histogram(bins,0.0) {}
-
-  template <typename ArrayT>
-  void operator()(ArrayT *array)
+  // bin a stratified sample of the values. each sampled value stands for
+  // the values of its stratum in the estimated counts
+  void Sample(vtkDataArray *array)
   {
-    assert(array);
     assert(array->GetNumberOfComponents() == 1);
 
-    typedef typename ArrayT::ValueType ValueType;
+    long n = array->GetNumberOfTuples();
+    std::vector<long> ids;
+    Sampling::GetSampleIds(n, this->Fraction, this->Seed, ids);
 
-    ValueType width = static_cast<ValueType>((this->Range[1]
-      - this->Range[0]) / this->Bins);
+    if (ids.empty())
+      return;
 
-    ValueType min = static_cast<ValueType>(this->Range[0]);
-    vtkIdType numTuples = array->GetNumberOfTuples();
+    double weight = static_cast<double>(n) / ids.size();
+
+    double min = this->Range[0];
+    double width = (this->Range[1] - this->Range[0]) / this->Bins;
+    if (!(width > 0.0))
+      width = std::numeric_limits<double>::infinity();
 
-    // + 1 to store val == max. These will be moved to this last bin before
-    // returning (Avoids having to branch in the loop below);
-    this->Histogram.resize(this->Bins + 1, 0);
-    for (vtkIdType tIdx = 0; tIdx < numTuples; ++tIdx)
+    const double maxBin = this->Bins - 1;
+    const unsigned char *ghosts = this->GetGhosts();
+
+    for (long id : ids)
       {
-      int bin = static_cast<int>((array->GetComponent(tIdx, 0) - min) / width);
-      ++this->Histogram[bin];
-      }
+      if ((ghosts && ghosts[id]) ||
+        (this->Interior && !this->Interior->IsInterior(id)))
+        continue;
 
-    // Merge the last two bins (the last is only when val == max)
-    this->Histogram[this->Bins-1] += this->Histogram[this->Bins];
-    this->Histogram.resize(this->Bins);
-  }
-};
-#else
-struct VTKHistogram::Internals
-{
-  vtkUnsignedCharArray* GhostArray;
-  const double *Range;
-  int Bins;
-  std::vector<unsigned int> Histogram;
+      double bin = (array->GetComponent(id, 0) - min) / width;
+      int ibin = static_cast<int>(std::min(std::max(0.0, bin), maxBin));
 
-  Internals(const double *range, int bins) :
-    GhostArray(NULL), Range(range), Bins(bins), Histogram(bins,0.0) {}
+      this->Histogram[ibin] += 1;
+      this->Estimate[ibin] += weight;
+      this->NumSamples += 1.0;
+      }
+  }
 
+  // arrays with contiguous storage are processed in place
   template <typename T>
-  void operator()(const vtkDataArrayDispatcherPointer<T>& array)
+  void operator()(const T *vals)
   {
-    assert(array.NumberOfComponents == 1);
-
-    typedef T ValueType;
-    ValueType width = static_cast<ValueType>((this->Range[1] - this->Range[0]) / this->Bins);
-    ValueType min = static_cast<ValueType>(this->Range[0]);
-    vtkIdType numTuples = array.NumberOfTuples;
-
-    // + 1 to store val == max. These will be moved to this last bin before
-    // returning (Avoids having to branch in the loop below);
-    this->Histogram.resize(this->Bins + 1, 0);
-    if (this->GhostArray)
+    if (!vals)
       {
-      for (vtkIdType tIdx = 0; tIdx < numTuples; ++tIdx)
-        {
-        if (this->GhostArray->GetValue(tIdx) == 0)
-          {
-          int bin = static_cast<int>((array.RawPointer[tIdx] - min) / width);
-          ++this->Histogram[bin];
-          }
-        }
+      this->BinGeneric();
+      return;
       }
-    else
+
+    histogram(vals, this->GetGhosts(), this->Interior,
+      this->Array->GetNumberOfTuples(), this->Range, this->Bins,
+      this->Threads, this->Histogram.data());
+  }
+
+  // other layouts are accessed through the generic API
+  void BinGeneric()
+  {
+    vtkDataArray *array = this->Array;
+
+    double min = this->Range[0];
+    double width = (this->Range[1] - this->Range[0]) / this->Bins;
+    if (!(width > 0.0))
+      width = std::numeric_limits<double>::infinity();
+
+    const double maxBin = this->Bins - 1;
+    const unsigned char *ghosts = this->GetGhosts();
+
+    auto binSpan = [&](vtkIdType begin, vtkIdType end, bool isInterior)
       {
-      for (vtkIdType tIdx = 0; tIdx < numTuples; ++tIdx)
+      if (!isInterior)
+        return;
+
+      for (vtkIdType tIdx = begin; tIdx < end; ++tIdx)
         {
-        int bin = static_cast<int>((array.RawPointer[tIdx] - min) / width);
-        ++this->Histogram[bin];
+        double bin = (array->GetComponent(tIdx, 0) - min) / width;
+        int ibin = static_cast<int>(std::min(std::max(0.0, bin), maxBin));
+        this->Histogram[ibin] += (ghosts ? (ghosts[tIdx] == 0) : 1);
         }
-      }
+      };
 
-    // Merge the last two bins (the last is only when val == max)
-    this->Histogram[this->Bins-1] += this->Histogram[this->Bins];
-    this->Histogram.resize(this->Bins);
+    vtkIdType numTuples = array->GetNumberOfTuples();
+    if (this->Interior)
+      this->Interior->ForEachSpan(0, numTuples, binSpan);
+    else
+      binSpan(0, numTuples, true);
   }
 };
 
-// Compute array range by skipping ghost elements.
-class ComponentRangeWorker
+// --------------------------------------------------------------------------
+VTKHistogram::VTKHistogram() : SampleSeed(0), NumberOfSteps(1), Threads(1),
+  Pending(nullptr)
 {
-public:
-  ComponentRangeWorker(vtkUnsignedCharArray* ghostArray) :
-    GhostArray(ghostArray)
-    {
-    this->Range[0] = vtkTypeTraits<double>::Max();
-    this->Range[1] = vtkTypeTraits<double>::Min();
-    }
+  this->SetNumberOfArrays(1);
+}
 
-  template <typename T>
-  void operator()(const vtkDataArrayDispatcherPointer<T>& array)
+// --------------------------------------------------------------------------
+VTKHistogram::~VTKHistogram()
+{
+  this->ClearWorkers();
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::ClearWorkers()
+{
+  // the result of a reduction in flight is cached by the workers
+  this->FinishPostCompute();
+
+  unsigned int nWorkers = this->Workers.size();
+  for (unsigned int i = 0; i < nWorkers; ++i)
+    delete this->Workers[i];
+  this->Workers.clear();
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::SetNumberOfThreads(int nThreads)
+{
+  if (nThreads < 1)
+    nThreads = TaskRuntime::GetNumberOfThreads();
+  this->Threads = nThreads;
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::SetNumberOfArrays(unsigned int nArrays)
+{
+  this->ClearWorkers();
+
+  this->Range.resize(2*nArrays);
+  for (unsigned int i = 0; i < nArrays; ++i)
     {
-    assert(array.NumberOfComponents == 1);
-    vtkIdType numTuples = array.NumberOfTuples;
-    for (vtkIdType cc=0; cc < numTuples; cc++)
-      {
-      if (this->GhostArray->GetValue(cc) == 0)
-        {
-        this->Range[0] = std::min(this->Range[0], static_cast<double>(array.RawPointer[cc]));
-        this->Range[1] = std::max(this->Range[1], static_cast<double>(array.RawPointer[cc]));
-        }
-      }
+    this->Range[2*i] = VTK_DOUBLE_MAX;
+    this->Range[2*i+1] = VTK_DOUBLE_MIN;
     }
 
-  void GetRange(double r[2])
+  this->SampleFraction.assign(nArrays, 1.0);
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::SetSampleFraction(unsigned int id, double fraction)
+{
+  this->SampleFraction[id] = ((fraction > 0.0) && (fraction < 1.0)) ?
+    fraction : 1.0;
+
+  // bins kept across steps take the fraction of the step
+  if (id < this->Workers.size())
     {
-    std::copy(this->Range, this->Range+2, r);
+    Internals *worker = this->Workers[id];
+    worker->Fraction = this->SampleFraction[id];
+    if (worker->Fraction < 1.0)
+      worker->Estimate.resize(worker->Bins, 0.0);
     }
-private:
-  double Range[2];
-  vtkUnsignedCharArray* GhostArray;
-};
-#endif
+}
 
 // --------------------------------------------------------------------------
-VTKHistogram::VTKHistogram()
+void VTKHistogram::SetSampleSeed(unsigned long seed)
 {
-  this->Range[0] = VTK_DOUBLE_MAX;
-  this->Range[1] = VTK_DOUBLE_MIN;
-  this->Worker = NULL;
+  this->SampleSeed = seed;
+
+  unsigned int nWorkers = this->Workers.size();
+  for (unsigned int i = 0; i < nWorkers; ++i)
+    this->Workers[i]->Seed = seed;
 }
 
 // --------------------------------------------------------------------------
-VTKHistogram::~VTKHistogram()
+void VTKHistogram::SetNumberOfSteps(int nSteps)
+{
+  this->NumberOfSteps = std::max(1, nSteps);
+}
+
+// --------------------------------------------------------------------------
+unsigned int VTKHistogram::GetNumberOfArrays() const
 {
-  delete this->Worker;
+  return this->Range.size()/2;
 }
 
 // --------------------------------------------------------------------------
-void VTKHistogram::AddRange(vtkDataArray* da,
+void VTKHistogram::AddRange(unsigned int id, vtkDataArray* da,
   vtkUnsignedCharArray* ghostArray)
 {
-#ifdef ENABLE_VTK_GENERIC_ARRAYS
-  (void)ghostArray;
-  if (da)
+  double *range = this->Range.data() + 2*id;
+
+  if (da && (this->SampleFraction[id] < 1.0))
     {
-    double crange[2];
-    da->GetRange(crange);
-    this->Range[0] = std::min(this->Range[0], crange[0]);
-    this->Range[1] = std::max(this->Range[1], crange[1]);
+    sampleRange(da, ghostArray, nullptr, this->SampleFraction[id],
+      this->SampleSeed, range);
+    return;
     }
-#else
-  double crange[2] = { vtkTypeTraits<double>::Max(), vtkTypeTraits<double>::Min() };
+
   if (da && ghostArray)
     {
-    ComponentRangeWorker worker(ghostArray);
-    vtkDataArrayDispatcher<ComponentRangeWorker> dispatcher(worker);
-    dispatcher.Go(da);
-    worker.GetRange(crange);
+    RangeKernel kernel{da, ghostArray->GetPointer(0), nullptr, range};
+    ArrayDispatch::Execute(da, kernel);
     }
   else if (da)
     {
+    double crange[2];
     da->GetRange(crange);
+    range[0] = std::min(range[0], crange[0]);
+    range[1] = std::max(range[1], crange[1]);
+    }
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::AddRange(unsigned int id, vtkDataArray* da,
+  const VTKUtils::InteriorRange &interior)
+{
+  if (!da)
+    return;
+
+  double *range = this->Range.data() + 2*id;
+
+  if (this->SampleFraction[id] < 1.0)
+    {
+    sampleRange(da, nullptr, &interior, this->SampleFraction[id],
+      this->SampleSeed, range);
+    return;
     }
-  this->Range[0] = std::min(this->Range[0], crange[0]);
-  this->Range[1] = std::max(this->Range[1], crange[1]);
-#endif
+
+  RangeKernel kernel{da, nullptr, &interior, range};
+  ArrayDispatch::Execute(da, kernel);
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::AddRange(unsigned int id, const double crange[2])
+{
+  double *range = this->Range.data() + 2*id;
+  range[0] = std::min(range[0], crange[0]);
+  range[1] = std::max(range[1], crange[1]);
 }
 
 // --------------------------------------------------------------------------
-void VTKHistogram::Compute(vtkDataArray* da,
+void VTKHistogram::Compute(unsigned int id, vtkDataArray* da,
   vtkUnsignedCharArray* ghostArray)
 {
   if (da)
     {
-#ifdef ENABLE_VTK_GENERIC_ARRAYS
-    (void)ghostArray;
-    vtkArrayDispatch::Dispatch::Execute(da, *this->Worker);
-#else
-    this->Worker->GhostArray = ghostArray;
-    vtkDataArrayDispatcher<Internals> dispatcher(*this->Worker);
-    dispatcher.Go(da);
-    this->Worker->GhostArray = NULL;
-#endif
+    Internals *worker = this->Workers[id];
+    worker->Array = da;
+    worker->GhostArray = ghostArray;
+    if (worker->Fraction < 1.0)
+      {
+      worker->Sample(da);
+      }
+    else
+      {
+      assert(da->GetNumberOfComponents() == 1);
+      ArrayDispatch::Execute(da, *worker);
+      }
+    worker->Array = nullptr;
+    worker->GhostArray = NULL;
+    }
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::Compute(unsigned int id, vtkDataArray* da,
+  const VTKUtils::InteriorRange &interior)
+{
+  if (da)
+    {
+    Internals *worker = this->Workers[id];
+    worker->Interior = &interior;
+    this->Compute(id, da, static_cast<vtkUnsignedCharArray*>(nullptr));
+    worker->Interior = nullptr;
     }
 }
 
+// --------------------------------------------------------------------------
+void VTKHistogram::GetRange(unsigned int id, double range[2]) const
+{
+  range[0] = this->Range[2*id];
+  range[1] = this->Range[2*id+1];
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::AddHistogram(unsigned int id,
+  const std::vector<unsigned int> &hist)
+{
+  std::vector<unsigned int> &lHist = this->Workers[id]->Histogram;
+
+  size_t nBins = std::min(lHist.size(), hist.size());
+  for (size_t i = 0; i < nBins; ++i)
+    lHist[i] += hist[i];
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::GetLocalHistogram(unsigned int id,
+  std::vector<unsigned int> &hist) const
+{
+  hist = this->Workers[id]->Histogram;
+}
+
 // --------------------------------------------------------------------------
 void VTKHistogram::PreCompute(MPI_Comm comm, int bins)
 {
-  double g_range[2];
-  // Find the global max/min
-  MPI_Allreduce(&this->Range[0], &g_range[0], 1, MPI_DOUBLE, MPI_MIN, comm);
-  MPI_Allreduce(&this->Range[1], &g_range[1], 1, MPI_DOUBLE, MPI_MAX, comm);
-  this->Range[0] = g_range[0];
-  this->Range[1] = g_range[1];
-  this->Worker = new Internals(this->Range, bins);
+  // Find the global max/min of all arrays in a single reduction. the
+  // minimum is negated so that both can be found with MPI_MAX
+  unsigned int nArrays = this->GetNumberOfArrays();
+  unsigned int nVals = 2*nArrays;
+
+  std::vector<double> l_range(nVals);
+  for (unsigned int i = 0; i < nVals; i += 2)
+    {
+    l_range[i] = -this->Range[i];
+    l_range[i+1] = this->Range[i+1];
+    }
+
+  std::vector<double> g_range(nVals);
+  {
+  CollectiveEvent mark(comm, "VTKHistogram::PreCompute::Allreduce");
+  MPI_Allreduce(l_range.data(), g_range.data(), nVals,
+    MPI_DOUBLE, MPI_MAX, comm);
+  }
+
+  for (unsigned int i = 0; i < nVals; i += 2)
+    {
+    this->Range[i] = -g_range[i];
+    this->Range[i+1] = g_range[i+1];
+    }
+
+  this->PreCompute(bins);
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::SetRange(unsigned int id, const double range[2])
+{
+  this->Range[2*id] = range[0];
+  this->Range[2*id+1] = range[1];
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::PreCompute(int bins)
+{
+  unsigned int nArrays = this->GetNumberOfArrays();
+
+  this->ClearWorkers();
+  for (unsigned int i = 0; i < nArrays; ++i)
+    this->Workers.push_back(new Internals(this->Range.data() + 2*i,
+      bins, this->Threads, this->SampleFraction[i], this->SampleSeed));
 }
 
+// --------------------------------------------------------------------------
+void VTKHistogram::ClearBins()
+{
+  unsigned int nWorkers = this->Workers.size();
+  for (unsigned int i = 0; i < nWorkers; ++i)
+    {
+    Internals *worker = this->Workers[i];
+    std::fill(worker->Histogram.begin(), worker->Histogram.end(), 0u);
+    std::fill(worker->Estimate.begin(), worker->Estimate.end(), 0.0);
+    worker->NumSamples = 0.0;
+    }
+}
+
+// --------------------------------------------------------------------------
+// the state of a reduction of the bins in flight. the buffers must live
+// until it completes, and what is needed to write the result is copied so
+// that the histogram may be reconfigured in the meantime
+struct VTKHistogram::Reduction
+{
+  MPI_Comm Comm;
+  MPI_Request Request;
+  int Rank;
+  int Bins;
+  int Step;
+  double Time;
+  int NumberOfSteps;
+  bool Sampled;
+  std::vector<double> Range;
+  std::vector<double> SampleFraction;
+  std::vector<std::string> MeshNames;
+  std::vector<std::string> ArrayNames;
+  std::string FileName;
+  std::vector<unsigned int> LHist;
+  std::vector<unsigned int> GHists;
+  std::vector<double> LEst;
+  std::vector<double> GEst;
+};
+
 // --------------------------------------------------------------------------
 void VTKHistogram::PostCompute(MPI_Comm comm, int nBins, int step,
-  double time, const std::string &meshName, const std::string &arrayName,
-  const std::string &fileName)
+  double time, const std::vector<std::string> &meshNames,
+  const std::vector<std::string> &arrayNames, const std::string &fileName)
 {
-  std::vector<unsigned int> gHist(nBins, 0);
+  this->StartPostCompute(comm, nBins, step, time, meshNames,
+    arrayNames, fileName);
 
-  MPI_Reduce(&this->Worker->Histogram[0], &gHist[0],
-    nBins, MPI_UNSIGNED, MPI_SUM, 0, comm);
+  this->FinishPostCompute();
+}
 
-  int rank = 0;
-  MPI_Comm_rank(comm, &rank);
+// --------------------------------------------------------------------------
+void VTKHistogram::StartPostCompute(MPI_Comm comm, int nBins, int step,
+  double time, const std::vector<std::string> &meshNames,
+  const std::vector<std::string> &arrayNames, const std::string &fileName)
+{
+  TimeEvent<128> mark("VTKHistogram::StartPostCompute");
+
+  // only one reduction is in flight at a time
+  this->FinishPostCompute();
+
+  Reduction *red = new Reduction;
+  red->Comm = comm;
+  red->Request = MPI_REQUEST_NULL;
+  red->Rank = 0;
+  MPI_Comm_rank(comm, &red->Rank);
+  red->Bins = nBins;
+  red->Step = step;
+  red->Time = time;
+  red->NumberOfSteps = this->NumberOfSteps;
+  red->Range = this->Range;
+  red->SampleFraction = this->SampleFraction;
+  red->MeshNames = meshNames;
+  red->ArrayNames = arrayNames;
+  red->FileName = fileName;
+
+  // reduce the histograms of all arrays at once
+  unsigned int nArrays = this->GetNumberOfArrays();
+
+  // when any array is sampled the estimated counts and the number of
+  // samples of each array are reduced instead. the counts of the arrays
+  // that are not sampled are exact
+  red->Sampled = std::any_of(this->SampleFraction.begin(),
+    this->SampleFraction.end(), [](double f) { return f < 1.0; });
+
+  unsigned int nEst = nBins + 1;
+
+  if (red->Sampled)
+    {
+    red->LEst.resize(nArrays*nEst, 0.0);
+    for (unsigned int j = 0; j < nArrays; ++j)
+      {
+      Internals *worker = this->Workers[j];
+      double *est = red->LEst.data() + j*nEst;
+      if (worker->Fraction < 1.0)
+        {
+        std::copy(worker->Estimate.begin(), worker->Estimate.end(), est);
+        est[nBins] = worker->NumSamples;
+        }
+      else
+        {
+        std::copy(worker->Histogram.begin(), worker->Histogram.end(), est);
+        est[nBins] = std::accumulate(worker->Histogram.begin(),
+          worker->Histogram.end(), 0.0);
+        }
+      }
 
-  if (rank == 0)
+    red->GEst.resize(red->Rank == 0 ? nArrays*nEst : 0);
+
+    MPI_Ireduce(red->LEst.data(), red->GEst.data(), nArrays*nEst,
+      MPI_DOUBLE, MPI_SUM, 0, comm, &red->Request);
+    }
+  else
     {
+    red->LHist.resize(nArrays*nBins);
+    for (unsigned int j = 0; j < nArrays; ++j)
+      std::copy(this->Workers[j]->Histogram.begin(),
+        this->Workers[j]->Histogram.end(), red->LHist.begin() + j*nBins);
+
+    red->GHists.resize(red->Rank == 0 ? nArrays*nBins : 0);
+
+    MPI_Ireduce(red->LHist.data(), red->GHists.data(), nArrays*nBins,
+      MPI_UNSIGNED, MPI_SUM, 0, comm, &red->Request);
+    }
+
+  this->Pending = red;
+}
+
+// --------------------------------------------------------------------------
+bool VTKHistogram::PostComputePending() const
+{
+  return this->Pending != nullptr;
+}
+
+// --------------------------------------------------------------------------
+void VTKHistogram::FinishPostCompute()
+{
+  if (!this->Pending)
+    return;
+
+  std::unique_ptr<Reduction> red(this->Pending);
+  this->Pending = nullptr;
+
+  {
+  TimeEvent<128> mark("VTKHistogram::FinishPostCompute::Wait");
+  MPI_Wait(&red->Request, MPI_STATUS_IGNORE);
+  }
+
+  if (red->Rank != 0)
+    return;
+
+  TimeEvent<128> mark("VTKHistogram::FinishPostCompute::Write");
+
+  MPI_Comm comm = red->Comm;
+  int nBins = red->Bins;
+  int step = red->Step;
+  double time = red->Time;
+  const std::string &fileName = red->FileName;
+
+  unsigned int nArrays = red->SampleFraction.size();
+  unsigned int nEst = nBins + 1;
+  std::vector<double> &gEst = red->GEst;
+  std::vector<unsigned int> &gHists = red->GHists;
+
+  if (red->Sampled)
+    {
+    gHists.resize(nArrays*nBins);
+    for (unsigned int j = 0; j < nArrays; ++j)
+      for (int i = 0; i < nBins; ++i)
+        gHists[j*nBins + i] = std::llround(gEst[j*nEst + i]);
+    }
+
+  for (unsigned int j = 0; j < nArrays; ++j)
+    {
+    const double *range = red->Range.data() + 2*j;
+    const std::string &meshName = red->MeshNames[j];
+    const std::string &arrayName = red->ArrayNames[j];
+
+    std::vector<unsigned int> gHist(gHists.begin() + j*nBins,
+      gHists.begin() + (j+1)*nBins);
+
+    // the 95% bounds of the estimated counts
+    double fraction = red->SampleFraction[j];
+    double nSamples = 0.0;
+    std::vector<double> lower(gHist.begin(), gHist.end());
+    std::vector<double> upper(lower);
+    if (fraction < 1.0)
+      {
+      const double *est = gEst.data() + j*nEst;
+      nSamples = est[nBins];
+      double nValues = std::accumulate(est, est + nBins, 0.0);
+      for (int i = 0; (nValues > 0.0) && (i < nBins); ++i)
+        {
+        double bound = Sampling::GetCountBound(est[i]/nValues,
+          nSamples, nValues);
+        lower[i] = std::max(0.0, est[i] - bound);
+        upper[i] = est[i] + bound;
+        }
+      }
+
     // if there was an error range is initialized to [DOUBLE_MAX, DOUBLE_MIN]
-    if (this->Range[0] >= this->Range[1])
+    if (range[0] >= range[1])
       {
-      SENSEI_ERROR("Invalid histgram range ["
-        << this->Range[0] << " - " << this->Range[1] << "]")
+      SENSEI_ERROR("Invalid histgram range for mesh \"" << meshName
+        << "\" data array \"" << arrayName << "\" ["
+        << range[0] << " - " << range[1] << "]")
       MPI_Abort(comm, -1);
       return;
       }
@@ -266,17 +800,29 @@ void VTKHistogram::PostCompute(MPI_Comm comm, int nBins, int step,
       std::cout.precision(4);
 
       std::cout << "Histogram mesh \"" << meshName << "\" data array \""
-        << arrayName << "\" step " << step << " time " << time << std::endl;
+        << arrayName << "\" step " << step << " time " << time;
+      if (red->NumberOfSteps > 1)
+        std::cout << " accumulated over " << red->NumberOfSteps << " steps";
+      std::cout << std::endl;
 
-      double width = (this->Range[1] - this->Range[0]) / nBins;
+      double width = (range[1] - range[0]) / nBins;
       for (int i = 0; i < nBins; ++i)
         {
         const int wid = 15;
-        std::cout << std::scientific << std::setw(wid) << std::right << this->Range[0] + i*width
-          << " - " << std::setw(wid) << std::left << this->Range[0] + (i+1)*width
-          << ": " << std::fixed << gHist[i] << std::endl;
+        std::cout << std::scientific << std::setw(wid) << std::right << range[0] + i*width
+          << " - " << std::setw(wid) << std::left << range[0] + (i+1)*width
+          << ": " << std::fixed << gHist[i];
+        if (fraction < 1.0)
+          std::cout << " [" << std::llround(lower[i]) << " - "
+            << std::llround(upper[i]) << "]";
+        std::cout << std::endl;
         }
 
+      if (fraction < 1.0)
+        std::cout << "sampled " << fraction << " of the values, "
+          << nSamples << " samples, count 95% confidence bounds in []"
+          << std::endl;
+
       std::cout.precision(origPrec);
       }
     else
@@ -297,40 +843,83 @@ void VTKHistogram::PostCompute(MPI_Comm comm, int nBins, int step,
 
       fprintf(file, "step : %d\n", step);
       fprintf(file, "time : %0.6g\n", time);
+      if (red->NumberOfSteps > 1)
+        fprintf(file, "num steps : %d\n", red->NumberOfSteps);
       fprintf(file, "num bins : %d\n", nBins);
-      fprintf(file, "range : %0.6g %0.6g\n", this->Range[0], this->Range[1]);
+      fprintf(file, "range : %0.6g %0.6g\n", range[0], range[1]);
       fprintf(file, "bin edges : ");
-      double width = (this->Range[1] - this->Range[0]) / nBins;
+      double width = (range[1] - range[0]) / nBins;
       for (int i = 0; i < nBins + 1; ++i)
-        fprintf(file, "%0.6g ", this->Range[0] + i*width);
+        fprintf(file, "%0.6g ", range[0] + i*width);
       fprintf(file, "\n");
       fprintf(file, "counts : ");
       for (int i = 0; i < nBins; ++i)
         fprintf(file, "%d ", gHist[i]);
       fprintf(file, "\n");
+      if (fraction < 1.0)
+        {
+        fprintf(file, "sample fraction : %0.6g\n", fraction);
+        fprintf(file, "num samples : %0.0f\n", nSamples);
+        fprintf(file, "counts lower : ");
+        for (int i = 0; i < nBins; ++i)
+          fprintf(file, "%0.0f ", std::floor(lower[i]));
+        fprintf(file, "\n");
+        fprintf(file, "counts upper : ");
+        for (int i = 0; i < nBins; ++i)
+          fprintf(file, "%0.0f ", std::ceil(upper[i]));
+        fprintf(file, "\n");
+        }
       fclose(file);
       }
 
     // cache the last result, the simulation can access it
-    this->Worker->Histogram = gHist;
+    if (j < this->Workers.size())
+      {
+      this->Workers[j]->Result = gHist;
+      this->Workers[j]->Lower = lower;
+      this->Workers[j]->Upper = upper;
+      }
     }
 }
 
 // --------------------------------------------------------------------------
-int VTKHistogram::GetHistogram(MPI_Comm comm, double &min, double &max,
-  std::vector<unsigned int> &bins)
+int VTKHistogram::GetHistogram(MPI_Comm comm, unsigned int id,
+  double &min, double &max, std::vector<unsigned int> &bins)
 {
-  if (!this->Worker)
+  if (id >= this->Workers.size())
     return -1;
 
+  this->FinishPostCompute();
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  if (rank == 0)
+    {
+    min = this->Range[2*id];
+    max = this->Range[2*id+1];
+    bins = this->Workers[id]->Result;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int VTKHistogram::GetConfidenceBounds(MPI_Comm comm, unsigned int id,
+  std::vector<double> &lower, std::vector<double> &upper)
+{
+  if (id >= this->Workers.size())
+    return -1;
+
+  this->FinishPostCompute();
+
   int rank = 0;
   MPI_Comm_rank(comm, &rank);
 
   if (rank == 0)
     {
-    min = this->Range[0];
-    max = this->Range[1];
-    bins = this->Worker->Histogram;
+    lower = this->Workers[id]->Lower;
+    upper = this->Workers[id]->Upper;
     }
 
   return 0;
@@ -10,35 +10,141 @@ class vtkDataArray;
 
 namespace sensei
 {
+namespace VTKUtils { struct InteriorRange; }
 
+/// Computes the histograms of a number of arrays in parallel. The
+/// collective operations are shared, a single reduction computes the
+/// ranges and another computes the bins of all of the arrays. Arrays are
+/// identified by an index in [0, GetNumberOfArrays()).
+///
+/// Arrays may be sampled, in which case the range and counts come from a
+/// stratified sample of each block, the cost then follows the size of the
+/// sample, and the counts are estimates reported with their 95%
+/// confidence bounds.
+///
+/// The reduction of the bins may be left in flight by StartPostCompute,
+/// overlapping it with whatever the caller does next. It is completed, and
+/// the result written, by FinishPostCompute, or by any call that needs it.
 class VTKHistogram
 {
 public:
     VTKHistogram();
     ~VTKHistogram();
 
-    void AddRange(vtkDataArray* da, vtkUnsignedCharArray* ghostArray);
+    // set the number of threads used to compute the local histogram.
+    // the threads are those of the TaskRuntime, a value less than 1 uses
+    // all of them. the default is 1.
+    void SetNumberOfThreads(int nThreads);
 
-    // compute the global min and max
+    // set the number of arrays to compute histograms of. this must be
+    // called before any of the following methods. the default is 1.
+    void SetNumberOfArrays(unsigned int nArrays);
+    unsigned int GetNumberOfArrays() const;
+
+    // set the fraction, in (0, 1], of the values of the id'th array that
+    // are sampled. the default, 1, uses all of the values.
+    void SetSampleFraction(unsigned int id, double fraction);
+
+    // set the seed of the sample positions. the range and count passes
+    // see the same sample of a block when the seed is the same
+    void SetSampleSeed(unsigned long seed);
+
+    // accumulate the local range of the id'th array
+    void AddRange(unsigned int id, vtkDataArray* da,
+      vtkUnsignedCharArray* ghostArray);
+
+    // accumulate the local range of the id'th array on a Cartesian block
+    // whose ghost values are given by an index range rather than a mask
+    void AddRange(unsigned int id, vtkDataArray* da,
+      const VTKUtils::InteriorRange &interior);
+
+    // accumulate a known local range of the id'th array, for instance one
+    // supplied by the simulation in the mesh metadata
+    void AddRange(unsigned int id, const double range[2]);
+
+    // compute the global min and max of all arrays
     void PreCompute(MPI_Comm comm, int bins);
 
-    // do the local histgram calculation
-    void Compute(vtkDataArray* da, vtkUnsignedCharArray* ghostArray);
+    // set the range of the id'th array, for instance one fixed for the
+    // run, in place of the range found by PreCompute
+    void SetRange(unsigned int id, const double range[2]);
+
+    // prepare the bins over the ranges set by SetRange. this makes no MPI
+    // calls
+    void PreCompute(int bins);
+
+    // zero the local bins, keeping the ranges, so that the histograms of
+    // the steps that follow are accumulated from scratch
+    void ClearBins();
+
+    // set the number of steps accumulated in the bins that are reduced
+    // next, it is written with the result. the default is 1.
+    void SetNumberOfSteps(int nSteps);
+
+    // do the local histgram calculation of the id'th array
+    void Compute(unsigned int id, vtkDataArray* da,
+      vtkUnsignedCharArray* ghostArray);
 
-    // do the reduction, write the result to a file, or cout.
-    // the result is cached on rank 0.
+    // do the local histogram calculation of the id'th array on a Cartesian
+    // block, visiting the spans of interior values
+    void Compute(unsigned int id, vtkDataArray* da,
+      const VTKUtils::InteriorRange &interior);
+
+    // get the global range of the id'th array found by PreCompute
+    void GetRange(unsigned int id, double range[2]) const;
+
+    // accumulate a local histogram of the id'th array computed elsewhere,
+    // for instance on a device, over the range found by PreCompute
+    void AddHistogram(unsigned int id, const std::vector<unsigned int> &hist);
+
+    // get the local bins of the id'th array accumulated since they were
+    // last cleared, for instance to merge them elsewhere
+    void GetLocalHistogram(unsigned int id,
+      std::vector<unsigned int> &hist) const;
+
+    // do the reduction of all arrays, write the result to a file, or cout.
+    // the names of the mesh and array are indexed by array id. the result
+    // is cached on rank 0.
     void PostCompute(MPI_Comm comm, int nBins, int step, double time,
-      const std::string &meshName, const std::string &arrayName,
+      const std::vector<std::string> &meshNames,
+      const std::vector<std::string> &arrayNames,
       const std::string &fileName);
 
-    // return the last computed results on rank 0
-    int GetHistogram(MPI_Comm comm, double &min, double &max,
-      std::vector<unsigned int> &bins);
+    // post the reduction of PostCompute without waiting for it, the
+    // local bins may be cleared or recomputed in the meantime. the result
+    // is written when it completes
+    void StartPostCompute(MPI_Comm comm, int nBins, int step, double time,
+      const std::vector<std::string> &meshNames,
+      const std::vector<std::string> &arrayNames,
+      const std::string &fileName);
+
+    // complete a reduction left in flight by StartPostCompute and write
+    // its result. this does nothing when there is none
+    void FinishPostCompute();
+    bool PostComputePending() const;
+
+    // return the last computed results of the id'th array on rank 0
+    int GetHistogram(MPI_Comm comm, unsigned int id, double &min,
+      double &max, std::vector<unsigned int> &bins);
+
+    // return the 95% confidence bounds of the last computed counts of the
+    // id'th array on rank 0. the bounds of arrays that were not sampled
+    // are the counts
+    int GetConfidenceBounds(MPI_Comm comm, unsigned int id,
+      std::vector<double> &lower, std::vector<double> &upper);
 
 private:
-  double Range[2];
+  void ClearWorkers();
+
+  std::vector<double> Range;
+  std::vector<double> SampleFraction;
+  unsigned long SampleSeed;
+  int NumberOfSteps;
+  int Threads;
   struct Internals;
-  Internals *Worker;
+  std::vector<Internals*> Workers;
+  struct Reduction;
+  Reduction *Pending;
 };
 
 }
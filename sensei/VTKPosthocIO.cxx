@@ -1,19 +1,26 @@
 #include "VTKPosthocIO.h"
+#include "BlockStream.h"
 #include "senseiConfig.h"
 #include "DataAdaptor.h"
+#include "FileStager.h"
 #include "MeshMetadata.h"
 #include "MeshMetadataMap.h"
 #include "VTKUtils.h"
 #include "Error.h"
+#if defined(ENABLE_HDF5)
+#include "VTKHDFWriter.h"
+#endif
 
 #include <vtkCellData.h>
 #include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
 #include <vtkMultiBlockDataSet.h>
 #include <vtkUniformGridAMR.h>
 #include <vtkDataArray.h>
 #include <vtkDataArrayTemplate.h>
 #include <vtkDataObject.h>
 #include <vtkDataSetAttributes.h>
+#include <vtkFieldData.h>
 #include <vtkImageData.h>
 #include <vtkPolyData.h>
 #include <vtkRectilinearGrid.h>
@@ -35,11 +42,91 @@
 #include <vtkAlgorithm.h>
 #include <vtkCompositeDataPipeline.h>
 #include <vtkXMLDataSetWriter.h>
+#include <vtkXMLDataObjectWriter.h>
+#include <vtkXMLWriter.h>
 #include <vtkDataSetWriter.h>
 
 #include <mpi.h>
+#include <iomanip>
+#include <limits>
 
 
+//-----------------------------------------------------------------------------
+// returns a shallow copy of the mesh in which the arrays that the
+// requirements store at reduced precision are replaced by converted
+// copies, or the mesh itself when there are none. the caller takes the
+// reference
+static
+vtkCompositeDataSet *reducePrecision(vtkCompositeDataSet *cd,
+  const std::string &meshName, const sensei::BlockStream::ArrayMap &arrays,
+  const sensei::DataRequirements &reqs)
+{
+  // the arrays, by association, stored at reduced precision
+  std::map<int, std::vector<std::string>> reduced;
+  sensei::BlockStream::ArrayMap::const_iterator ait = arrays.begin();
+  for (; ait != arrays.end(); ++ait)
+    {
+    for (const std::string &name : ait->second)
+      {
+      if (reqs.GetArrayPrecision(meshName, ait->first, name) !=
+        sensei::DataRequirements::PRECISION_NATIVE)
+        reduced[ait->first].push_back(name);
+      }
+    }
+
+  if (reduced.empty())
+    {
+    cd->Register(nullptr);
+    return cd;
+    }
+
+  // the blocks belong to the data adaptor, they are not modified
+  vtkCompositeDataSet *out = cd->NewInstance();
+  out->CopyStructure(cd);
+
+  vtkSmartPointer<vtkCompositeDataIterator> it;
+  it.TakeReference(cd->NewIterator());
+  for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+    {
+    vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+    if (!ds)
+      continue;
+
+    vtkDataSet *dsOut = ds->NewInstance();
+    dsOut->ShallowCopy(ds);
+
+    std::map<int, std::vector<std::string>>::iterator rit = reduced.begin();
+    for (; rit != reduced.end(); ++rit)
+      {
+      vtkFieldData *atts = sensei::VTKUtils::GetAttributes(dsOut, rit->first);
+      if (!atts)
+        continue;
+
+      for (const std::string &name : rit->second)
+        {
+        vtkDataArray *da = atts->GetArray(name.c_str());
+        if (!da)
+          continue;
+
+        vtkDataArray *rda = sensei::VTKUtils::NewArrayOfType(da,
+          sensei::VTKUtils::GetStorageType(da->GetDataType(),
+          reqs.GetArrayPrecision(meshName, rit->first, name)));
+
+        if (rda)
+          {
+          atts->AddArray(rda);
+          rda->Delete();
+          }
+        }
+      }
+
+    out->SetDataSet(it, dsOut);
+    dsOut->Delete();
+    }
+
+  return out;
+}
+
 //-----------------------------------------------------------------------------
 static
 std::string getBlockExtension(vtkDataObject *dob)
@@ -89,6 +176,217 @@ std::string getBlockFileName(const std::string &outputDir,
   return oss.str();
 }
 
+//-----------------------------------------------------------------------------
+static
+std::string getBlockExtension(int blockType)
+{
+  switch (blockType)
+    {
+    case VTK_POLY_DATA:
+      return ".vtp";
+    case VTK_UNSTRUCTURED_GRID:
+      return ".vtu";
+    case VTK_IMAGE_DATA:
+    case VTK_UNIFORM_GRID:
+      return ".vti";
+    case VTK_RECTILINEAR_GRID:
+      return ".vtr";
+    case VTK_STRUCTURED_GRID:
+      return ".vts";
+    }
+
+  SENSEI_ERROR("Failed to determine file extension for block type "
+    << blockType)
+  return "";
+}
+
+//-----------------------------------------------------------------------------
+static
+void setCompressor(vtkXMLWriter *writer, int compressor)
+{
+  if (compressor == sensei::VTKPosthocIO::COMPRESSOR_ZLIB)
+    writer->SetCompressorTypeToZLib();
+  else if (compressor == sensei::VTKPosthocIO::COMPRESSOR_LZ4)
+    writer->SetCompressorTypeToLZ4();
+  else
+    writer->SetCompressorTypeToNone();
+}
+
+//-----------------------------------------------------------------------------
+// serialize a block as an appended binary VTK XML document
+static
+int serializeBlock(vtkDataSet *ds, int compressor, std::string &doc)
+{
+  vtkXMLWriter *writer =
+    vtkXMLDataObjectWriter::NewWriter(ds->GetDataObjectType());
+
+  if (!writer)
+    {
+    SENSEI_ERROR("No VTK XML writer for " << ds->GetClassName())
+    return -1;
+    }
+
+  writer->SetInputData(ds);
+  writer->SetDataModeToAppended();
+  writer->EncodeAppendedDataOff();
+  writer->SetHeaderTypeToUInt64();
+  setCompressor(writer, compressor);
+  writer->SetWriteToOutputString(1);
+  writer->Write();
+  doc = writer->GetOutputString();
+  writer->Delete();
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// get the value of the first occurrence of an attribute in [begin, end)
+static
+bool getAttribute(const std::string &doc, size_t begin, size_t end,
+  const char *name, size_t &valBegin, size_t &valEnd)
+{
+  std::string key = std::string(" ") + name + "=\"";
+  size_t at = doc.find(key, begin);
+  if ((at == std::string::npos) || (at >= end))
+    return false;
+
+  valBegin = at + key.size();
+  valEnd = doc.find('"', valBegin);
+  return valEnd != std::string::npos;
+}
+
+//-----------------------------------------------------------------------------
+// combine serialized blocks into one document with a piece per block. the
+// appended data of the blocks is concatenated and the offsets of each
+// piece's arrays are shifted to match. the structure outside of the pieces,
+// including field data, is taken from the first block.
+static
+int mergePieces(const std::vector<std::string> &docs, std::string &out)
+{
+  size_t nDocs = docs.size();
+
+  std::vector<std::string> pieces(nDocs);
+  std::vector<size_t> dataBegin(nDocs);
+  std::vector<size_t> dataEnd(nDocs);
+  size_t pieceBegin0 = 0;
+  size_t pieceEnd0 = 0;
+  size_t appended0 = 0;
+
+  int wholeExt[6] = {std::numeric_limits<int>::max(),
+    std::numeric_limits<int>::lowest(), std::numeric_limits<int>::max(),
+    std::numeric_limits<int>::lowest(), std::numeric_limits<int>::max(),
+    std::numeric_limits<int>::lowest()};
+
+  unsigned long long base = 0;
+  for (size_t i = 0; i < nDocs; ++i)
+    {
+    const std::string &doc = docs[i];
+
+    size_t appended = doc.rfind("<AppendedData");
+    size_t pieceBegin = doc.find("<Piece");
+    size_t pieceEnd = doc.rfind("</Piece>");
+
+    if ((appended == std::string::npos) || (pieceBegin == std::string::npos) ||
+      (pieceEnd == std::string::npos) || (pieceEnd > appended))
+      {
+      SENSEI_ERROR("Block " << i << " is not an appended VTK XML document")
+      return -1;
+      }
+
+    pieceEnd += 8;
+
+    dataBegin[i] = doc.find('_', appended) + 1;
+    dataEnd[i] = doc.rfind("</AppendedData>");
+
+    // image data can only be merged when the blocks share a geometry
+    const char *geom[2] = {"Origin", "Spacing"};
+    for (int j = 0; (i > 0) && (j < 2); ++j)
+      {
+      size_t vb, ve, v0b, v0e;
+      if (getAttribute(doc, 0, pieceBegin, geom[j], vb, ve) &&
+        getAttribute(docs[0], 0, pieceBegin0, geom[j], v0b, v0e) &&
+        doc.compare(vb, ve - vb, docs[0], v0b, v0e - v0b))
+        {
+        SENSEI_ERROR("Image blocks with different origin or spacing can not"
+          " be aggregated")
+        return -1;
+        }
+      }
+
+    // bound the piece extents
+    size_t eb, ee;
+    if (getAttribute(doc, pieceBegin, pieceEnd, "Extent", eb, ee))
+      {
+      std::istringstream iss(doc.substr(eb, ee - eb));
+      for (int j = 0; j < 6; ++j)
+        {
+        int ext = 0;
+        iss >> ext;
+        wholeExt[j] = j % 2 ? std::max(wholeExt[j], ext) :
+          std::min(wholeExt[j], ext);
+        }
+      }
+
+    // shift the array offsets
+    std::string &piece = pieces[i];
+    size_t pos = pieceBegin;
+    size_t vb, ve;
+    while (getAttribute(doc, pos, pieceEnd, "offset", vb, ve))
+      {
+      unsigned long long offset = std::stoull(doc.substr(vb, ve - vb));
+      piece.append(doc, pos, vb - pos);
+      piece.append(std::to_string(base + offset));
+      pos = ve;
+      }
+    piece.append(doc, pos, pieceEnd - pos);
+
+    base += dataEnd[i] - dataBegin[i];
+
+    if (i == 0)
+      {
+      pieceBegin0 = pieceBegin;
+      pieceEnd0 = pieceEnd;
+      appended0 = appended;
+      }
+    }
+
+  const std::string &doc0 = docs[0];
+
+  // the header, with the whole extent of structured data updated
+  size_t eb, ee;
+  if (getAttribute(doc0, 0, pieceBegin0, "WholeExtent", eb, ee))
+    {
+    std::ostringstream oss;
+    oss << wholeExt[0] << " " << wholeExt[1] << " " << wholeExt[2] << " "
+      << wholeExt[3] << " " << wholeExt[4] << " " << wholeExt[5];
+
+    out.assign(doc0, 0, eb);
+    out.append(oss.str());
+    out.append(doc0, ee, pieceBegin0 - ee);
+    }
+  else
+    {
+    out.assign(doc0, 0, pieceBegin0);
+    }
+
+  for (size_t i = 0; i < nDocs; ++i)
+    {
+    if (i)
+      out.append("\n    ");
+    out.append(pieces[i]);
+    }
+
+  out.append(doc0, pieceEnd0, appended0 - pieceEnd0);
+  out.append("<AppendedData encoding=\"raw\">\n   _");
+
+  for (size_t i = 0; i < nDocs; ++i)
+    out.append(docs[i], dataBegin[i], dataEnd[i] - dataBegin[i]);
+
+  out.append("\n  </AppendedData>\n</VTKFile>\n");
+
+  return 0;
+}
+
 namespace sensei
 {
 //-----------------------------------------------------------------------------
@@ -96,12 +394,19 @@ senseiNewMacro(VTKPosthocIO);
 
 //-----------------------------------------------------------------------------
 VTKPosthocIO::VTKPosthocIO() :
-  OutputDir("./"), Mode(MODE_PARAVIEW), Writer(WRITER_VTK_XML)
+  OutputDir("./"), Mode(MODE_PARAVIEW), Writer(WRITER_VTK_XML),
+  Compressor(COMPRESSOR_NONE), Aggregation(0),
+  AggregationComm(MPI_COMM_NULL), BatchSize(0)
 {}
 
 //-----------------------------------------------------------------------------
 VTKPosthocIO::~VTKPosthocIO()
-{}
+{
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+  if (!finalized && (this->AggregationComm != MPI_COMM_NULL))
+    MPI_Comm_free(&this->AggregationComm);
+}
 
 //-----------------------------------------------------------------------------
 int VTKPosthocIO::SetOutputDir(const std::string &outputDir)
@@ -126,15 +431,51 @@ int VTKPosthocIO::SetOutputDir(const std::string &outputDir)
   return 0;
 }
 
+//-----------------------------------------------------------------------------
+int VTKPosthocIO::SetStaging(const std::string &stagingDir, double bandwidth,
+  double capacity, bool handOff)
+{
+  std::shared_ptr<FileStager> stager = std::make_shared<FileStager>();
+
+  if (stager->Initialize(this->GetCommunicator(), stagingDir,
+    this->OutputDir, "VTKPosthocIO"))
+    {
+    SENSEI_ERROR("Failed to initialize staging in \"" << stagingDir << "\"")
+    return -1;
+    }
+
+  stager->SetBandwidth(bandwidth);
+  stager->SetCapacity(capacity);
+  stager->SetHandOff(handOff);
+
+  this->Stager = stager;
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+const std::string &VTKPosthocIO::GetWriteDir() const
+{
+  return this->Stager ? this->Stager->GetStagingDir() : this->OutputDir;
+}
+
 //-----------------------------------------------------------------------------
 int VTKPosthocIO::SetMode(int mode)
 {
-  if ((mode != VTKPosthocIO::MODE_VISIT) && (mode != VTKPosthocIO::MODE_PARAVIEW))
+  if ((mode != VTKPosthocIO::MODE_VISIT) && (mode != VTKPosthocIO::MODE_PARAVIEW) &&
+    (mode != VTKPosthocIO::MODE_VTKHDF))
     {
     SENSEI_ERROR("Invalid mode " << mode)
     return -1;
     }
 
+#if !defined(ENABLE_HDF5)
+  if (mode == VTKPosthocIO::MODE_VTKHDF)
+    {
+    SENSEI_ERROR("The vtkhdf mode requires HDF5, which is disabled in this build")
+    return -1;
+    }
+#endif
+
   this->Mode = mode;
   return 0;
 }
@@ -155,14 +496,17 @@ int VTKPosthocIO::SetMode(std::string modeStr)
     {
     mode = VTKPosthocIO::MODE_PARAVIEW;
     }
+  else if (modeStr == "vtkhdf")
+    {
+    mode = VTKPosthocIO::MODE_VTKHDF;
+    }
   else
     {
     SENSEI_ERROR("invalid mode \"" << modeStr << "\"")
     return -1;
     }
 
-  this->Mode = mode;
-  return 0;
+  return this->SetMode(mode);
 }
 
 //-----------------------------------------------------------------------------
@@ -205,6 +549,65 @@ int VTKPosthocIO::SetWriter(std::string writerStr)
   return 0;
 }
 
+//-----------------------------------------------------------------------------
+int VTKPosthocIO::SetCompressor(int compressor)
+{
+  if ((compressor != VTKPosthocIO::COMPRESSOR_NONE) &&
+    (compressor != VTKPosthocIO::COMPRESSOR_ZLIB) &&
+    (compressor != VTKPosthocIO::COMPRESSOR_LZ4))
+    {
+    SENSEI_ERROR("Invalid compressor " << compressor)
+    return -1;
+    }
+
+  this->Compressor = compressor;
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int VTKPosthocIO::SetCompressor(std::string compressorStr)
+{
+  unsigned int n = compressorStr.size();
+  for (unsigned int i = 0; i < n; ++i)
+    compressorStr[i] = tolower(compressorStr[i]);
+
+  int compressor = 0;
+  if ((compressorStr == "none") || (compressorStr == "raw"))
+    {
+    compressor = VTKPosthocIO::COMPRESSOR_NONE;
+    }
+  else if (compressorStr == "zlib")
+    {
+    compressor = VTKPosthocIO::COMPRESSOR_ZLIB;
+    }
+  else if (compressorStr == "lz4")
+    {
+    compressor = VTKPosthocIO::COMPRESSOR_LZ4;
+    }
+  else
+    {
+    SENSEI_ERROR("invalid compressor \"" << compressorStr << "\"")
+    return -1;
+    }
+
+  this->Compressor = compressor;
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int VTKPosthocIO::SetAggregation(int ranksPerAggregator)
+{
+  if (ranksPerAggregator < 0)
+    {
+    SENSEI_ERROR("Invalid number of ranks per aggregator "
+      << ranksPerAggregator)
+    return -1;
+    }
+
+  this->Aggregation = ranksPerAggregator;
+  return 0;
+}
+
 //-----------------------------------------------------------------------------
 void VTKPosthocIO::SetGhostArrayName(const std::string &name)
 {
@@ -219,7 +622,8 @@ std::string VTKPosthocIO::GetGhostArrayName()
     if (this->Mode == VTKPosthocIO::MODE_VISIT)
       return "avtGhostZones";
 
-    if (this->Mode == VTKPosthocIO::MODE_PARAVIEW)
+    if ((this->Mode == VTKPosthocIO::MODE_PARAVIEW) ||
+      (this->Mode == VTKPosthocIO::MODE_VTKHDF))
       return "vtkGhostType";
     }
 
@@ -278,179 +682,554 @@ bool VTKPosthocIO::Execute(DataAdaptor* dataAdaptor)
     {
     const std::string &meshName = mit.MeshName();
 
-    // get the metadta
+    // get a global view of the metadta
     MeshMetadataPtr mmd;
-    if (mdMap.GetMeshMetadata(meshName, mmd))
+    if (mdMap.GetGlobalMeshMetadata(meshName, mmd))
       {
       SENSEI_ERROR("Failed to get metadata for mesh \"" << meshName << "\"")
       return false;
       }
 
-    // generate a global view of the metadata.
-    if (!mmd->GlobalView)
-      mmd->GlobalizeView(this->GetCommunicator());
+    // add the required arrays
+    BlockStream::ArrayMap arrays;
+
+    ArrayRequirementsIterator ait =
+      this->Requirements.GetArrayRequirementsIterator(meshName);
+
+    ait.SetMode(ArrayRequirementsIterator::MODE_ASSOCIATION);
+
+    for (; ait; ++ait)
+      arrays[ait.Association()] = ait.Arrays();
+
+    // This class does not use VTK's parallel writers because at this
+    // time those writers gather some data to rank 0 and this results
+    // in OOM crashes when run with 45k cores on Cori.
+
+    // the blocks are fetched and written a batch at a time when a batch
+    // size is set. the aggregators and the VTKHDF writer need all of the
+    // local blocks at once
+    bool vtkhdf = this->Mode == VTKPosthocIO::MODE_VTKHDF;
+
+    BlockStream stream;
+    stream.SetCommunicator(this->GetCommunicator());
+    stream.SetBatchSize((this->Aggregation || vtkhdf) ? 0 : this->BatchSize);
 
-    // get the mesh
-    vtkDataObject* dobj = nullptr;
-    if (dataAdaptor->GetMesh(meshName, mit.StructureOnly(), dobj))
+    if (stream.Visit(dataAdaptor, mmd, mit.StructureOnly(), arrays,
+      [&](vtkCompositeDataSet *cd) -> int
+      {
+      // append the step to the mesh's file. the VTKHDF writer converts
+      // arrays stored at reduced precision as it packs them
+      if (vtkhdf)
+        return this->WriteVTKHDF(meshName, cd, mmd, arrays,
+          dataAdaptor->GetDataTime());
+
+      // the VTK writers write the arrays as they are, convert those stored
+      // at reduced precision
+      vtkSmartPointer<vtkCompositeDataSet> rcd;
+      rcd.TakeReference(reducePrecision(cd, meshName, arrays,
+        this->Requirements));
+
+      // write the blocks through the aggregators
+      if (this->Aggregation)
+        return this->WriteAggregate(meshName, rcd, mmd);
+
+      return this->WriteBlocks(meshName, rcd);
+      }))
       {
-      SENSEI_ERROR("Failed to get mesh \"" << meshName << "\"")
+      SENSEI_ERROR("Failed to write mesh \"" << meshName << "\"")
       return false;
       }
 
-    // add the ghost cell arrays to the mesh
-    if ((mmd->NumGhostCells || VTKUtils::AMR(mmd)) &&
-      dataAdaptor->AddGhostCellsArray(dobj, meshName))
+    // this is default initialized to 0 by definition of std::map. & we count
+    // empty steps
+    this->FileId[meshName] += 1;
+
+    // rank 0 keeps track of time info for meta file
+    int rank = 0;
+    MPI_Comm_rank(this->GetCommunicator(), &rank);
+
+    if (rank == 0)
       {
-      SENSEI_ERROR("Failed to get ghost cells for mesh \"" << meshName << "\"")
-      return false;
+      double time = dataAdaptor->GetDataTime();
+      this->Time[meshName].push_back(time);
+
+      long step = dataAdaptor->GetDataTimeStep();
+      this->TimeStep[meshName].push_back(step);
+
+      this->Metadata[meshName].push_back(mmd);
+
+      // keep the index current so that the output can be read while the
+      // run progresses
+      if (this->Aggregation && !vtkhdf && this->WriteAggregateIndex(meshName))
+        return false;
       }
 
-    // add the ghost node arrays to the mesh
-    if (mmd->NumGhostNodes && dataAdaptor->AddGhostNodesArray(dobj, meshName))
+    ++mit;
+    }
+
+  dataAdaptor->ReleaseData();
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int VTKPosthocIO::WriteBlocks(const std::string &meshName,
+  vtkCompositeDataSet *cd)
+{
+  vtkSmartPointer<vtkCompositeDataIterator> it;
+  it.TakeReference(cd->NewIterator());
+  it->SetSkipEmptyNodes(1);
+  it->InitTraversal();
+
+  // figure out block distribution, assume that it does not change, and
+  // that block types are homgeneous
+  if (!it->IsDoneWithTraversal() && !this->HaveBlockInfo[meshName])
+    {
+    this->BlockExt[meshName] = this->Writer == VTKPosthocIO::WRITER_VTK_LEGACY ?
+      ".vtk" : getBlockExtension(it->GetCurrentDataObject());
+
+    this->HaveBlockInfo[meshName] = 1;
+    }
+
+  // amr meshes indices start from 0 while multiblock starts at 1
+  long bidShift = 1;
+  if (dynamic_cast<vtkUniformGridAMR*>(cd))
+    bidShift = 0;
+
+  // write the blocks
+  for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+    {
+    vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+    if (!ds)
       {
-      SENSEI_ERROR("Failed to get ghost nodes for mesh \"" << meshName << "\"")
-      return false;
+      // this should never happen
+      SENSEI_ERROR("Block at " << it->GetCurrentFlatIndex() << " is null")
+      return -1;
       }
 
-    // add the required arrays
-    ArrayRequirementsIterator ait =
-      this->Requirements.GetArrayRequirementsIterator(meshName);
+    // skip writing blocks that have no data
+    if (ds->GetNumberOfCells() < 1)
+      continue;
 
-    while (ait)
+    long blockId = it->GetCurrentFlatIndex() - bidShift;
+    if (blockId < 0)
       {
-      if (dataAdaptor->AddArray(dobj, mit.MeshName(),
-         ait.Association(), ait.Array()))
-        {
-        SENSEI_ERROR("Failed to add "
-          << VTKUtils::GetAttributesName(ait.Association())
-          << " data array \"" << ait.Array() << "\" to mesh \""
-          << meshName << "\"")
-        return false;
-        }
-      ++ait;
+      // this should never happen
+      SENSEI_ERROR("Negative index! Dataset is " << cd->GetClassName())
+      return -1;
       }
 
-    // This class does not use VTK's parallel writers because at this
-    // time those writers gather some data to rank 0 and this results
-    // in OOM crashes when run with 45k cores on Cori.
+    std::string fileName =
+      getBlockFileName(this->GetWriteDir(), meshName, blockId,
+        this->FileId[meshName], this->BlockExt[meshName]);
+
+    vtkDataArray *ga = ds->GetCellData()->GetArray("vtkGhostType");
+    if (ga)
+      {
+      ga->SetName(this->GetGhostArrayName().c_str());
+      ds->UpdateCellGhostArrayCache();
+      }
+
+    if (this->Writer == VTKPosthocIO::WRITER_VTK_LEGACY)
+      {
+      vtkDataSetWriter *writer = vtkDataSetWriter::New();
+      writer->SetInputData(ds);
+      writer->SetFileName(fileName.c_str());
+      writer->SetFileTypeToBinary();
+      writer->Write();
+      writer->Delete();
+      }
+    else
+      {
+      vtkXMLDataSetWriter *writer = vtkXMLDataSetWriter::New();
+      writer->SetInputData(ds);
+      writer->SetDataModeToAppended();
+      writer->EncodeAppendedDataOff();
+      setCompressor(writer, this->Compressor);
+      writer->SetFileName(fileName.c_str());
+      writer->Write();
+      writer->Delete();
+      }
+
+    if (this->Stager && this->Stager->Stage(fileName))
+      return -1;
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int VTKPosthocIO::WriteAggregate(const std::string &meshName,
+  vtkCompositeDataSet *cd, const MeshMetadataPtr &mmd)
+{
+  if (this->Writer != VTKPosthocIO::WRITER_VTK_XML)
+    {
+    SENSEI_ERROR("Aggregation requires the VTK XML writer")
+    return -1;
+    }
+
+  MPI_Comm comm = this->GetCommunicator();
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
 
-    // make sure we have composite dataset if not create one
-    vtkCompositeDataSetPtr cd =
-      VTKUtils::AsCompositeData(this->GetCommunicator(), dobj, false);
+  // each group of consecutive ranks is served by its first rank
+  if (this->AggregationComm == MPI_COMM_NULL)
+    MPI_Comm_split(comm, rank/this->Aggregation, rank, &this->AggregationComm);
 
-    vtkCompositeDataIterator *it = cd->NewIterator();
-    it->SetSkipEmptyNodes(1);
-    it->InitTraversal();
+  MPI_Comm aggComm = this->AggregationComm;
 
-    // figure out block distribution, assume that it does not change, and
-    // that block types are homgeneous
-    if (!it->IsDoneWithTraversal() && !this->HaveBlockInfo[meshName])
+  int aggRank = 0;
+  int aggSize = 1;
+  MPI_Comm_rank(aggComm, &aggRank);
+  MPI_Comm_size(aggComm, &aggSize);
+
+  // errors are reported after the collectives so that no rank is left
+  // waiting
+  int ierr = 0;
+
+  // serialize the local blocks
+  std::vector<long long> sizes;
+  std::string local;
+
+  vtkCompositeDataIterator *it = cd->NewIterator();
+  it->SetSkipEmptyNodes(1);
+  for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+    {
+    vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
+
+    // skip writing blocks that have no data
+    if (!ds || (ds->GetNumberOfCells() < 1))
+      continue;
+
+    vtkDataArray *ga = ds->GetCellData()->GetArray("vtkGhostType");
+    if (ga)
       {
-      this->BlockExt[meshName] = this->Writer == VTKPosthocIO::WRITER_VTK_LEGACY ?
-        ".vtk" : getBlockExtension(it->GetCurrentDataObject());
+      ga->SetName(this->GetGhostArrayName().c_str());
+      ds->UpdateCellGhostArrayCache();
+      }
 
-      this->HaveBlockInfo[meshName] = 1;
+    std::string doc;
+    if (serializeBlock(ds, this->Compressor, doc))
+      {
+      ierr = -1;
+      continue;
       }
 
-    // amr meshes indices start from 0 while multiblock starts at 1
-    long bidShift = 1;
-    if (dynamic_cast<vtkUniformGridAMR*>(cd.GetPointer()))
-      bidShift = 0;
+    sizes.push_back(doc.size());
+    local.append(doc);
+    }
+  it->Delete();
+
+  // gather the block sizes
+  int nLocal = sizes.size();
+  std::vector<int> nBlocks(aggSize);
+  MPI_Gather(&nLocal, 1, MPI_INT, nBlocks.data(), 1, MPI_INT, 0, aggComm);
 
-    // write the blocks
-    for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextItem())
+  std::vector<int> blockDispls(aggSize, 0);
+  int nBlocksTotal = 0;
+  if (aggRank == 0)
+    {
+    for (int i = 0; i < aggSize; ++i)
       {
-      vtkDataSet *ds = dynamic_cast<vtkDataSet*>(it->GetCurrentDataObject());
-      if (!ds)
-        {
-        // this should never happen
-        SENSEI_ERROR("Block at " << it->GetCurrentFlatIndex() << " is null")
-        return false;
-        }
+      blockDispls[i] = nBlocksTotal;
+      nBlocksTotal += nBlocks[i];
+      }
+    }
 
-      // skip writing blocks that have no data
-      if (ds->GetNumberOfCells() < 1)
-        continue;
+  std::vector<long long> allSizes(nBlocksTotal);
+  MPI_Gatherv(sizes.data(), nLocal, MPI_LONG_LONG, allSizes.data(),
+    nBlocks.data(), blockDispls.data(), MPI_LONG_LONG, 0, aggComm);
 
-      long blockId = it->GetCurrentFlatIndex() - bidShift;
-      if (blockId < 0)
-        {
-        // this should never happen
-        SENSEI_ERROR("Negative index! Dataset is " << cd->GetClassName())
-        return false;
-        }
+  // gather the blocks. the group agrees on whether they fit in one message
+  std::vector<int> byteCounts(aggSize, 0);
+  std::vector<int> byteDispls(aggSize, 0);
+  int fits = 1;
+  if (aggRank == 0)
+    {
+    long long total = 0;
+    for (int i = 0; i < aggSize; ++i)
+      {
+      long long count = 0;
+      for (int j = 0; j < nBlocks[i]; ++j)
+        count += allSizes[blockDispls[i] + j];
+
+      fits = fits && (total + count <= std::numeric_limits<int>::max());
+      byteDispls[i] = fits ? total : 0;
+      byteCounts[i] = fits ? count : 0;
+      total += count;
+      }
+    }
 
-      std::string fileName =
-        getBlockFileName(this->OutputDir, meshName, blockId,
-          this->FileId[meshName], this->BlockExt[meshName]);
+  MPI_Bcast(&fits, 1, MPI_INT, 0, aggComm);
+  if (!fits)
+    {
+    SENSEI_ERROR("The blocks of an aggregator exceed 2 GiB, use fewer"
+      " ranks per aggregator")
+    return -1;
+    }
 
-      vtkDataArray *ga = ds->GetCellData()->GetArray("vtkGhostType");
-      if (ga)
-        {
-        ga->SetName(this->GetGhostArrayName().c_str());
-        ds->UpdateCellGhostArrayCache();
-        }
+  std::vector<char> all(aggRank == 0 ?
+    byteDispls[aggSize-1] + byteCounts[aggSize-1] : 0);
+
+  MPI_Gatherv(local.data(), local.size(), MPI_CHAR, all.data(),
+    byteCounts.data(), byteDispls.data(), MPI_CHAR, 0, aggComm);
+
+  local.clear();
+
+  // the aggregator writes the blocks as the pieces of one file
+  int wrote = 0;
+  if ((aggRank == 0) && nBlocksTotal)
+    {
+    std::vector<std::string> docs(nBlocksTotal);
+    for (int i = 0, pos = 0; i < nBlocksTotal; ++i)
+      {
+      docs[i].assign(all.data() + pos, allSizes[i]);
+      pos += allSizes[i];
+      }
+    all.clear();
+
+    std::string merged;
+    if (mergePieces(docs, merged))
+      {
+      ierr = -1;
+      }
+    else
+      {
+      std::string fileName = getBlockFileName(this->GetWriteDir(), meshName,
+        rank/this->Aggregation, this->FileId[meshName],
+        getBlockExtension(mmd->BlockType));
 
-      if (this->Writer == VTKPosthocIO::WRITER_VTK_LEGACY)
+      std::ofstream ofs(fileName, std::ios::binary);
+      if (!ofs.write(merged.data(), merged.size()))
         {
-        vtkDataSetWriter *writer = vtkDataSetWriter::New();
-        writer->SetInputData(ds);
-        writer->SetFileName(fileName.c_str());
-        writer->SetFileTypeToBinary();
-        writer->Write();
-        writer->Delete();
+        SENSEI_ERROR("Failed to write \"" << fileName << "\"")
+        ierr = -1;
         }
       else
         {
-        vtkXMLDataSetWriter *writer = vtkXMLDataSetWriter::New();
-        writer->SetInputData(ds);
-        writer->SetDataModeToAppended();
-        writer->EncodeAppendedDataOff();
-        writer->SetCompressorTypeToNone();
-        writer->SetFileName(fileName.c_str());
-        writer->Write();
-        writer->Delete();
+        ofs.close();
+        wrote = 1;
+        if (this->Stager && this->Stager->Stage(fileName))
+          ierr = -1;
         }
       }
-    it->Delete();
+    }
 
-    // this is default initialized to 0 by definition of std::map. & we count
-    // empty steps
-    this->FileId[meshName] += 1;
+  // rank 0 records which aggregators wrote a file for the index
+  int nRanks = 1;
+  MPI_Comm_size(comm, &nRanks);
 
-    // rank 0 keeps track of time info for meta file
-    int rank = 0;
-    MPI_Comm_rank(this->GetCommunicator(), &rank);
+  std::vector<int> wroteAll(rank == 0 ? nRanks : 0);
+  MPI_Gather(&wrote, 1, MPI_INT, wroteAll.data(), 1, MPI_INT, 0, comm);
 
-    if (rank == 0)
+  if (rank == 0)
+    {
+    std::vector<int> aggIds;
+    for (int i = 0; i < nRanks; ++i)
       {
-      double time = dataAdaptor->GetDataTime();
-      this->Time[meshName].push_back(time);
+      if (wroteAll[i])
+        aggIds.push_back(i/this->Aggregation);
+      }
+    this->Aggregators[meshName].push_back(aggIds);
 
-      long step = dataAdaptor->GetDataTimeStep();
-      this->TimeStep[meshName].push_back(step);
+    this->BlockExt[meshName] = getBlockExtension(mmd->BlockType);
+    this->HaveBlockInfo[meshName] = 1;
+    }
 
-      this->Metadata[meshName].push_back(mmd);
+  return ierr;
+}
+
+//-----------------------------------------------------------------------------
+int VTKPosthocIO::WriteAggregateIndex(const std::string &meshName)
+{
+  const std::vector<std::vector<int>> &aggs = this->Aggregators[meshName];
+  const std::vector<double> &times = this->Time[meshName];
+  const std::string &blockExt = this->BlockExt[meshName];
+  long nSteps = times.size();
+
+  if (this->Mode == VTKPosthocIO::MODE_PARAVIEW)
+    {
+    // rewrite the whole collection, it is small with aggregation
+    std::string pvdFileName = this->OutputDir + "/" + meshName + ".pvd";
+    ofstream pvdFile(pvdFileName);
+
+    if (!pvdFile)
+      {
+      SENSEI_ERROR("Failed to open " << pvdFileName << " for writing")
+      return -1;
       }
 
-    dobj->Delete();
+    pvdFile << "<?xml version=\"1.0\"?>" << endl
+      << "<VTKFile type=\"Collection\" version=\"0.1\""
+         " byte_order=\"LittleEndian\" compressor=\"\">" << endl
+      << "<Collection>" << endl;
 
-    ++mit;
+    for (long i = 0; i < nSteps; ++i)
+      {
+      long nFiles = aggs[i].size();
+      for (long k = 0; k < nFiles; ++k)
+        {
+        std::string fileName =
+          getBlockFileName("./", meshName, aggs[i][k], i, blockExt);
+
+        pvdFile << "<DataSet timestep=\"" << times[i]
+          << "\" group=\"\" part=\"" << k << "\" file=\"" << fileName
+          << "\"/>" << endl;
+        }
+      }
+
+    pvdFile << "</Collection>" << endl
+      << "</VTKFile>" << endl;
+
+    return 0;
     }
 
-  dataAdaptor->ReleaseData();
+  if (this->Mode != VTKPosthocIO::MODE_VISIT)
+    {
+    SENSEI_ERROR("Invalid mode \"" << this->Mode << "\"")
+    return -1;
+    }
 
-  return true;
+  // one .visit file for the series as long as every step has the same
+  // number of files, otherwise one per step
+  bool staticPrefix = true;
+  for (long i = 1; staticPrefix && (i < nSteps - 1); ++i)
+    staticPrefix = (aggs[i].size() == aggs[0].size());
+
+  bool staticMesh = staticPrefix && !aggs[0].empty() &&
+    (aggs[nSteps-1].size() == aggs[0].size());
+
+  if (staticMesh)
+    {
+    std::string visitFileName = this->OutputDir + "/" + meshName + ".visit";
+    ofstream visitFile(visitFileName);
+
+    if (!visitFile)
+      {
+      SENSEI_ERROR("Failed to open " << visitFileName << " for writing")
+      return -1;
+      }
+
+    visitFile << "!NBLOCKS " << aggs[0].size() << std::endl;
+
+    for (long i = 0; i < nSteps; ++i)
+      visitFile << "!TIME " << times[i] << std::endl;
+
+    for (long i = 0; i < nSteps; ++i)
+      {
+      long nFiles = aggs[i].size();
+      for (long k = 0; k < nFiles; ++k)
+        visitFile << getBlockFileName("./", meshName, aggs[i][k], i, blockExt)
+          << std::endl;
+      }
+
+    return 0;
+    }
+
+  // when the series stops being static the earlier steps need their own
+  // files as well
+  long first = staticPrefix ? 0 : nSteps - 1;
+  for (long i = first; i < nSteps; ++i)
+    {
+    long nFiles = aggs[i].size();
+    if (nFiles < 1)
+      continue;
+
+    std::ostringstream oss;
+    oss << this->OutputDir << "/" << meshName << "_"
+      <<  std::setw(5) << std::setfill('0') << i << ".visit";
+
+    std::string visitFileName = oss.str();
+
+    ofstream visitFile(visitFileName);
+    if (!visitFile)
+      {
+      SENSEI_ERROR("Failed to open \"" << visitFileName << "\" for writing")
+      return -1;
+      }
+
+    visitFile << "!NBLOCKS " << nFiles << std::endl;
+    visitFile << "!TIME " << times[i] << std::endl;
+
+    for (long k = 0; k < nFiles; ++k)
+      visitFile << getBlockFileName("./", meshName, aggs[i][k], i, blockExt)
+        << std::endl;
+    }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int VTKPosthocIO::WriteVTKHDF(const std::string &meshName,
+  vtkCompositeDataSet *cd, const MeshMetadataPtr &mmd,
+  const std::map<int, std::vector<std::string>> &arrays, double time)
+{
+#if defined(ENABLE_HDF5)
+  std::shared_ptr<VTKHDFWriter> &writer = this->HDFWriters[meshName];
+  if (!writer)
+    {
+    writer = std::make_shared<VTKHDFWriter>();
+    writer->SetArrayPrecision(this->Requirements);
+
+    std::string fileName = this->OutputDir + "/" + meshName + ".vtkhdf";
+    if (writer->Open(this->GetCommunicator(), fileName))
+      {
+      SENSEI_ERROR("Failed to open the VTKHDF file for mesh \""
+        << meshName << "\"")
+      writer = nullptr;
+      return -1;
+      }
+
+    this->HaveBlockInfo[meshName] = 1;
+    }
+
+  return writer->WriteStep(cd, mmd, arrays, time);
+#else
+  (void)meshName;
+  (void)cd;
+  (void)mmd;
+  (void)arrays;
+  (void)time;
+  SENSEI_ERROR("The vtkhdf mode requires HDF5, which is disabled in this build")
+  return -1;
+#endif
 }
 
 //-----------------------------------------------------------------------------
 int VTKPosthocIO::Finalize()
 {
+  // the index is written after the drain so that, unless the drain is
+  // handed off, the files it names are in place
+  int ierr = 0;
+  if (this->Stager && this->Stager->Finalize())
+    {
+    SENSEI_ERROR("Failed to drain the staged files to \"" << this->OutputDir << "\"")
+    ierr = -1;
+    }
+  this->Stager = nullptr;
+
+  if (this->WriteIndex())
+    ierr = -1;
+
+  return ierr;
+}
+
+//-----------------------------------------------------------------------------
+int VTKPosthocIO::WriteIndex()
+{
+  // the VTKHDF files hold the time series, there is no index
+  if (this->Mode == VTKPosthocIO::MODE_VTKHDF)
+    {
+    this->HDFWriters.clear();
+    return 0;
+    }
+
   int rank = 0;
   MPI_Comm_rank(this->GetCommunicator(), &rank);
 
-  if (rank != 0)
+  // the aggregated index is written as we go
+  if ((rank != 0) || this->Aggregation)
     return 0;
 
   int nRanks = 1;
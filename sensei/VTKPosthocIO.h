@@ -8,12 +8,18 @@
 #include <vtkSmartPointer.h>
 
 #include <mpi.h>
+#include <map>
+#include <memory>
 #include <vector>
 #include <string>
 
 
+class vtkCompositeDataSet;
+
 namespace sensei
 {
+class FileStager;
+class VTKHDFWriter;
 class VTKPosthocIO;
 using VTKPosthocIOPtr = vtkSmartPointer<VTKPosthocIO>;
 
@@ -27,6 +33,15 @@ using VTKPosthocIOPtr = vtkSmartPointer<VTKPosthocIO>;
 /// consisting of a list of meshes and the arrays to write from
 /// each mesh. File names are derived using the output directory,
 /// the mesh name, and the mode.
+///
+/// By default each rank writes a file per block. With aggregation enabled
+/// groups of ranks send their serialized blocks to an aggregator which
+/// writes them as the pieces of a single appended binary VTK XML file,
+/// and the index file is updated after each step.
+///
+/// In vtkhdf mode, available when SENSEI is built with HDF5, every block
+/// of every step is appended to a single file per mesh, mesh.vtkhdf, in
+/// the VTKHDF layout that ParaView reads. See VTKHDFWriter.
 class VTKPosthocIO : public AnalysisAdaptor
 {
 public:
@@ -36,7 +51,17 @@ public:
   // Run time configuration
   int SetOutputDir(const std::string &outputDir);
 
-  enum {MODE_PARAVIEW=0, MODE_VISIT=1};
+  // stage the files on node local storage, such as NVMe, DataWarp or
+  // tmpfs, and drain them to the output directory in the background. see
+  // FileStager. the drain is limited to bandwidth MB/s and the files
+  // staged but not drained to capacity MB, 0 does not limit them. with
+  // handOff Finalize does not wait for the drain, the remaining files are
+  // listed in the manifest for a stage out step. call after
+  // SetOutputDir. in vtkhdf mode the shared file is written in place.
+  int SetStaging(const std::string &stagingDir, double bandwidth = 0.0,
+    double capacity = 0.0, bool handOff = false);
+
+  enum {MODE_PARAVIEW=0, MODE_VISIT=1, MODE_VTKHDF=2};
   int SetMode(int mode);
   int SetMode(std::string mode);
 
@@ -46,6 +71,25 @@ public:
   int SetWriter(int writer);
   int SetWriter(std::string writer);
 
+  // sets the compressor used by the VTK XML writer. options are none,
+  // zlib and lz4.
+  enum {COMPRESSOR_NONE=0, COMPRESSOR_ZLIB=1, COMPRESSOR_LZ4=2};
+  int SetCompressor(int compressor);
+  int SetCompressor(std::string compressor);
+
+  // when greater than 0, each group of this many consecutive ranks writes
+  // its blocks to a single file. requires the XML writer and, for image
+  // data, that the blocks share origin and spacing. the default, 0,
+  // writes a file per block.
+  int SetAggregation(int ranksPerAggregator);
+
+  // set the number of blocks fetched from the simulation and written at a
+  // time, so that only a batch of blocks is held in memory. a value less
+  // than 1, the default, fetches the whole mesh. ignored when aggregating.
+  // see BlockStream.
+  void SetBatchSize(int batchSize) { this->BatchSize = batchSize; }
+  int GetBatchSize() const { return this->BatchSize; }
+
   // if set this overrrides the default of vtkGhostType
   // for ParaView and avtGhostZones for VisIt
   void SetGhostArrayName(const std::string &name);
@@ -71,11 +115,36 @@ protected:
 
 private:
 #if !defined(SWIG)
+  // serializes the local blocks and writes them through the aggregators
+  int WriteAggregate(const std::string &meshName, vtkCompositeDataSet *cd,
+    const MeshMetadataPtr &mmd);
+
+  // write each of the blocks to its own file
+  int WriteBlocks(const std::string &meshName, vtkCompositeDataSet *cd);
+
+  // write the .pvd or .visit index of the aggregated files written so far
+  int WriteAggregateIndex(const std::string &meshName);
+
+  // write the .pvd or .visit index of the files written
+  int WriteIndex();
+
+  // the directory files are written to, the staging directory if set
+  const std::string &GetWriteDir() const;
+
+  // append the local blocks to the mesh's VTKHDF file
+  int WriteVTKHDF(const std::string &meshName, vtkCompositeDataSet *cd,
+    const MeshMetadataPtr &mmd, const std::map<int, std::vector<std::string>> &arrays,
+    double time);
+
   std::string OutputDir;
   DataRequirements Requirements;
   int Mode;
   int Writer;
+  int Compressor;
+  int Aggregation;
+  MPI_Comm AggregationComm;
   std::string GhostArrayName;
+  int BatchSize;
 
   template<typename T>
   using NameMap = std::map<std::string, T>;
@@ -86,6 +155,9 @@ private:
   NameMap<std::string> BlockExt;
   NameMap<long> FileId;
   NameMap<int> HaveBlockInfo;
+  NameMap<std::vector<std::vector<int>>> Aggregators;
+  NameMap<std::shared_ptr<VTKHDFWriter>> HDFWriters;
+  std::shared_ptr<FileStager> Stager;
 #endif
 };
 
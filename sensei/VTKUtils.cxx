@@ -1,7 +1,12 @@
 #include "senseiConfig.h"
 #include "VTKUtils.h"
+#include "ArrayView.h"
 #include "MPIUtils.h"
 #include "MeshMetadata.h"
+#include "DataRequirements.h"
+#include "STLUtils.h"
+#include "Profiler.h"
+#include "TaskRuntime.h"
 #include "Error.h"
 
 
@@ -21,6 +26,8 @@
 #include <vtkCharArray.h>
 #include <vtkUnsignedCharArray.h>
 #include <vtkIdTypeArray.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
 #include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkStructuredPoints.h>
@@ -55,10 +62,16 @@
 #include <vtkSmartPointer.h>
 #include <vtkIntArray.h>
 #include <vtkVersionMacros.h>
+#if VTK_MAJOR_VERSION >= 9
+#include <vtkPartitionedDataSet.h>
+#endif
 #if ((VTK_VERSION_MAJOR >= 8) && (VTK_VERSION_MINOR >= 2))
 #include <vtkAOSDataArrayTemplate.h>
 #include <vtkSOADataArrayTemplate.h>
 #endif
+#if defined(ENABLE_VTK_GENERIC_ARRAYS)
+#include <vtkSOADataArrayTemplate.h>
+#endif
 #include <vtkXMLUnstructuredGridWriter.h>
 #include <vtkPoints.h>
 #include <vtkDoubleArray.h>
@@ -67,6 +80,8 @@
 
 #include <sstream>
 #include <functional>
+#include <algorithm>
+#include <limits>
 #include <mpi.h>
 
 using vtkDataObjectPtr = vtkSmartPointer<vtkDataObject>;
@@ -125,6 +140,416 @@ unsigned int Size(int vtkt)
   return 0;
 }
 
+//----------------------------------------------------------------------------
+int GetComponentPointers(vtkDataArray *da, std::vector<void*> &comps)
+{
+  comps.clear();
+#if defined(ENABLE_VTK_GENERIC_ARRAYS)
+  if (da && (da->GetArrayType() == vtkAbstractArray::SoADataArrayTemplate))
+    {
+    int nComps = da->GetNumberOfComponents();
+    switch (da->GetDataType())
+      {
+      vtkTemplateMacro(
+        vtkSOADataArrayTemplate<VTK_TT> *soa =
+          static_cast<vtkSOADataArrayTemplate<VTK_TT>*>(da);
+        comps.resize(nComps);
+        for (int i = 0; i < nComps; ++i)
+          comps[i] = soa->GetComponentArrayPointer(i);
+        return 0;
+        );
+      }
+    }
+#else
+  (void)da;
+#endif
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+vtkDataArray *NewSOAArray(int vtkt, int nComps, long nTuples,
+  std::vector<void*> &comps)
+{
+  comps.clear();
+#if defined(ENABLE_VTK_GENERIC_ARRAYS)
+  switch (vtkt)
+    {
+    vtkTemplateMacro(
+      vtkSOADataArrayTemplate<VTK_TT> *soa =
+        vtkSOADataArrayTemplate<VTK_TT>::New();
+      soa->SetNumberOfComponents(nComps);
+      soa->SetNumberOfTuples(nTuples);
+      comps.resize(nComps);
+      for (int i = 0; i < nComps; ++i)
+        comps[i] = soa->GetComponentArrayPointer(i);
+      return soa;
+      );
+    }
+#else
+  (void)vtkt;
+  (void)nComps;
+  (void)nTuples;
+#endif
+  return nullptr;
+}
+
+// --------------------------------------------------------------------------
+int GetStorageType(int vtkt, int precision)
+{
+  if ((vtkt == VTK_DOUBLE) && (precision != DataRequirements::PRECISION_NATIVE))
+    return VTK_FLOAT;
+  return vtkt;
+}
+
+// --------------------------------------------------------------------------
+template <typename dest_t>
+int ExportToType(vtkDataArray *da, dest_t *dest)
+{
+  long nTups = da->GetNumberOfTuples();
+  int nComps = da->GetNumberOfComponents();
+  long nVals = nTups*nComps;
+
+#if defined(ENABLE_VTK_GENERIC_ARRAYS)
+  if (da->HasStandardMemoryLayout())
+#endif
+    {
+    switch (da->GetDataType())
+      {
+      vtkTemplateMacro(
+        const VTK_TT *src = static_cast<const VTK_TT*>(da->GetVoidPointer(0));
+        for (long i = 0; i < nVals; ++i)
+          dest[i] = static_cast<dest_t>(src[i]);
+        return 0;
+        );
+      }
+    }
+
+  // other layouts are converted one component at a time
+  std::vector<void*> comps;
+  if (!GetComponentPointers(da, comps))
+    {
+    switch (da->GetDataType())
+      {
+      vtkTemplateMacro(
+        for (int j = 0; j < nComps; ++j)
+          {
+          const VTK_TT *src = static_cast<const VTK_TT*>(comps[j]);
+          for (long i = 0; i < nTups; ++i)
+            dest[i*nComps + j] = static_cast<dest_t>(src[i]);
+          }
+        return 0;
+        );
+      }
+    }
+
+  for (long i = 0; i < nTups; ++i)
+    for (int j = 0; j < nComps; ++j)
+      dest[i*nComps + j] = static_cast<dest_t>(da->GetComponent(i, j));
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int ExportToType(vtkDataArray *da, int vtkt, void *dest)
+{
+  if (da->GetDataType() == vtkt)
+    {
+    da->ExportToVoidPointer(dest);
+    return 0;
+    }
+
+  switch (vtkt)
+    {
+    vtkTemplateMacro(
+      return ExportToType(da, static_cast<VTK_TT*>(dest));
+      );
+    }
+
+  SENSEI_ERROR("Can't convert " << da->GetClassName() << " to VTK type " << vtkt)
+  return -1;
+}
+
+// --------------------------------------------------------------------------
+vtkDataArray *NewArrayOfType(vtkDataArray *da, int vtkt)
+{
+  if (da->GetDataType() == vtkt)
+    {
+    da->Register(nullptr);
+    return da;
+    }
+
+  vtkDataArray *out = vtkDataArray::CreateDataArray(vtkt);
+  out->SetName(da->GetName());
+  out->SetNumberOfComponents(da->GetNumberOfComponents());
+  out->SetNumberOfTuples(da->GetNumberOfTuples());
+
+  if (ExportToType(da, vtkt, out->GetVoidPointer(0)))
+    {
+    out->Delete();
+    return nullptr;
+    }
+
+  return out;
+}
+
+// --------------------------------------------------------------------------
+bool CellIndices32(const MeshMetadataPtr &md)
+{
+  // the cell array size bounds both the offsets and the point ids
+  long maxIndex = std::numeric_limits<vtkTypeInt32>::max();
+  for (int j = 0; j < md->NumBlocks; ++j)
+    {
+    if ((md->BlockNumPoints[j] > maxIndex) ||
+      (md->BlockCellArraySize[j] > maxIndex))
+      return false;
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void NewCellArrays(bool use32, long numCells, long connSize,
+  vtkDataArray *&offsets, vtkDataArray *&connectivity)
+{
+  if (use32)
+    {
+    offsets = vtkTypeInt32Array::New();
+    connectivity = vtkTypeInt32Array::New();
+    }
+  else
+    {
+    offsets = vtkTypeInt64Array::New();
+    connectivity = vtkTypeInt64Array::New();
+    }
+
+  offsets->SetNumberOfTuples(numCells + 1);
+  connectivity->SetNumberOfTuples(connSize);
+}
+
+#if VTK_MAJOR_VERSION < 9
+namespace
+{
+// --------------------------------------------------------------------------
+// split the legacy layout, each cell's size followed by its point ids
+template <typename index_t>
+void splitLegacyCells(const vtkIdType *cells, long numCells, index_t *offs,
+  index_t *conn)
+{
+  offs[0] = 0;
+  for (long i = 0; i < numCells; ++i)
+    {
+    vtkIdType n = *cells;
+    ++cells;
+    for (vtkIdType k = 0; k < n; ++k)
+      conn[offs[i] + k] = cells[k];
+    cells += n;
+    offs[i+1] = offs[i] + n;
+    }
+}
+
+// --------------------------------------------------------------------------
+template <typename index_t>
+void joinLegacyCells(const index_t *offs, const index_t *conn, long numCells,
+  vtkIdType *cells, vtkIdType *locs)
+{
+  for (long i = 0; i < numCells; ++i)
+    {
+    index_t n = offs[i+1] - offs[i];
+    if (locs)
+      locs[i] = offs[i] + i;
+    *cells = n;
+    ++cells;
+    for (index_t k = 0; k < n; ++k)
+      cells[k] = conn[offs[i] + k];
+    cells += n;
+    }
+}
+}
+#endif
+
+// --------------------------------------------------------------------------
+int GetCellArrays(vtkCellArray *ca, bool use32, vtkDataArray *&offsets,
+  vtkDataArray *&connectivity)
+{
+  offsets = nullptr;
+  connectivity = nullptr;
+
+  if (!ca)
+    return -1;
+
+#if VTK_MAJOR_VERSION >= 9
+  vtkDataArray *offs = ca->GetOffsetsArray();
+  vtkDataArray *conn = ca->GetConnectivityArray();
+
+  // pass the storage when it has the requested type
+  if (ca->IsStorage64Bit() != use32)
+    {
+    offs->Register(nullptr);
+    conn->Register(nullptr);
+    offsets = offs;
+    connectivity = conn;
+    return 0;
+    }
+
+  NewCellArrays(use32, ca->GetNumberOfCells(), conn->GetNumberOfTuples(),
+    offsets, connectivity);
+
+  offsets->DeepCopy(offs);
+  connectivity->DeepCopy(conn);
+#else
+  long numCells = ca->GetNumberOfCells();
+  long connSize = ca->GetNumberOfConnectivityEntries() - numCells;
+
+  NewCellArrays(use32, numCells, connSize, offsets, connectivity);
+
+  if (use32)
+    splitLegacyCells(ca->GetPointer(), numCells,
+      static_cast<vtkTypeInt32Array*>(offsets)->GetPointer(0),
+      static_cast<vtkTypeInt32Array*>(connectivity)->GetPointer(0));
+  else
+    splitLegacyCells(ca->GetPointer(), numCells,
+      static_cast<vtkTypeInt64Array*>(offsets)->GetPointer(0),
+      static_cast<vtkTypeInt64Array*>(connectivity)->GetPointer(0));
+#endif
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+#if VTK_MAJOR_VERSION < 9
+static vtkIdTypeArray *newLegacyCells(vtkDataArray *offsets,
+  vtkDataArray *connectivity, vtkIdTypeArray *locs)
+{
+  long numCells = offsets->GetNumberOfTuples() - 1;
+  long connSize = connectivity->GetNumberOfTuples();
+
+  vtkIdTypeArray *cells = vtkIdTypeArray::New();
+  cells->SetNumberOfTuples(numCells + connSize);
+
+  if (locs)
+    locs->SetNumberOfTuples(numCells);
+
+  vtkIdType *pLocs = locs ? locs->GetPointer(0) : nullptr;
+
+  if (offsets->GetDataType() == VTK_TYPE_INT32)
+    joinLegacyCells(static_cast<vtkTypeInt32Array*>(offsets)->GetPointer(0),
+      static_cast<vtkTypeInt32Array*>(connectivity)->GetPointer(0), numCells,
+      cells->GetPointer(0), pLocs);
+  else
+    joinLegacyCells(static_cast<vtkTypeInt64Array*>(offsets)->GetPointer(0),
+      static_cast<vtkTypeInt64Array*>(connectivity)->GetPointer(0), numCells,
+      cells->GetPointer(0), pLocs);
+
+  return cells;
+}
+#endif
+
+// --------------------------------------------------------------------------
+vtkCellArray *NewCellArray(vtkDataArray *offsets, vtkDataArray *connectivity)
+{
+  vtkCellArray *ca = vtkCellArray::New();
+#if VTK_MAJOR_VERSION >= 9
+  ca->SetData(offsets, connectivity);
+#else
+  vtkIdTypeArray *cells = newLegacyCells(offsets, connectivity, nullptr);
+  ca->SetCells(offsets->GetNumberOfTuples() - 1, cells);
+  cells->Delete();
+#endif
+  return ca;
+}
+
+// --------------------------------------------------------------------------
+int SetCells(vtkUnstructuredGrid *ug, vtkUnsignedCharArray *types,
+  vtkDataArray *offsets, vtkDataArray *connectivity)
+{
+  if (!ug || !types || !offsets || !connectivity ||
+    (offsets->GetNumberOfTuples() < 1))
+    return -1;
+
+#if VTK_MAJOR_VERSION >= 9
+  vtkCellArray *ca = NewCellArray(offsets, connectivity);
+  ug->SetCells(types, ca);
+  ca->Delete();
+#else
+  vtkIdTypeArray *locs = vtkIdTypeArray::New();
+  vtkIdTypeArray *cells = newLegacyCells(offsets, connectivity, locs);
+
+  vtkCellArray *ca = vtkCellArray::New();
+  ca->SetCells(offsets->GetNumberOfTuples() - 1, cells);
+  cells->Delete();
+
+  ug->SetCells(types, locs, ca);
+
+  locs->Delete();
+  ca->Delete();
+#endif
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+static int polydataCellKind(unsigned char type)
+{
+  switch (type)
+    {
+    case VTK_VERTEX:
+    case VTK_POLY_VERTEX:
+      return 0;
+    case VTK_LINE:
+    case VTK_POLY_LINE:
+      return 1;
+    case VTK_TRIANGLE_STRIP:
+      return 3;
+    }
+  return 2;
+}
+
+// --------------------------------------------------------------------------
+int SetPolydataCells(vtkPolyData *pd, const unsigned char *types,
+  const vtkIdType *cells, long numCells)
+{
+  if (!pd || (numCells && (!types || !cells)))
+    return -1;
+
+  // each kind of cell is a run of the cells
+  vtkCellArray *cas[4] = {nullptr};
+  const vtkIdType *pCells = cells;
+  long i = 0;
+  for (int q = 0; q < 4; ++q)
+    {
+    const vtkIdType *begin = pCells;
+    long n = 0;
+    while ((i < numCells) && (polydataCellKind(types[i]) == q))
+      {
+      pCells += pCells[0] + 1;
+      ++n;
+      ++i;
+      }
+
+    vtkIdTypeArray *ids = vtkIdTypeArray::New();
+    ids->SetNumberOfTuples(pCells - begin);
+    std::copy(begin, pCells, ids->GetPointer(0));
+
+    cas[q] = vtkCellArray::New();
+    cas[q]->SetCells(n, ids);
+    ids->Delete();
+    }
+
+  pd->SetVerts(cas[0]);
+  pd->SetLines(cas[1]);
+  pd->SetPolys(cas[2]);
+  pd->SetStrips(cas[3]);
+
+  for (int q = 0; q < 4; ++q)
+    cas[q]->Delete();
+
+  // cells out of order
+  if (i != numCells)
+    return -1;
+
+  pd->BuildCells();
+
+  return 0;
+}
+
 // --------------------------------------------------------------------------
 int IsLegacyDataObject(int code)
 {
@@ -507,6 +932,43 @@ int Apply(vtkDataObject *dobj, DatasetFunction &func)
   return 0;
 }
 
+//----------------------------------------------------------------------------
+int ParallelFor(long n, int nThreads, ParallelFunction &func)
+{
+  // the items are processed on the process wide pool, which bounds the
+  // number of threads in use when several analyses run at once
+  int ret = TaskRuntime::ParallelFor(n, std::max(1, nThreads), func);
+  if (ret < 0)
+    {
+    SENSEI_ERROR("Function failed in parallel for")
+    return -1;
+    }
+
+  return ret > 0 ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------
+int Apply(vtkDataObject *dobj, ThreadedDatasetFunction &func, int nThreads)
+{
+  // collect the leaves
+  std::vector<vtkDataSet*> leaves;
+  DatasetFunction collect = [&leaves](vtkDataSet *ds) -> int
+    {
+    leaves.push_back(ds);
+    return 0;
+    };
+
+  if (Apply(dobj, collect) < 0)
+    return -1;
+
+  ParallelFunction call = [&](int thread, long i) -> int
+    {
+    return func(thread, i, leaves[i]);
+    };
+
+  return ParallelFor(leaves.size(), nThreads, call) < 0 ? -1 : 0;
+}
+
 //----------------------------------------------------------------------------
 int GetGhostLayerMetadata(vtkDataObject *mesh,
   int &nGhostCellLayers, int &nGhostNodeLayers)
@@ -544,6 +1006,117 @@ int SetGhostLayerMetadata(vtkDataObject *mesh,
   return 0;
 }
 
+//----------------------------------------------------------------------------
+void GetInteriorRange(const int extent[6], const int domain[6],
+  int numGhosts, InteriorRange &range)
+{
+  // ghost layers are on the faces shared with a neighbor, those that are
+  // not on the domain boundary
+  for (int d = 0; d < 3; ++d)
+    {
+    long n = std::max(0, extent[2*d+1] - extent[2*d] + 1);
+
+    range.Dims[d] = n;
+    range.Begin[d] = extent[2*d] > domain[2*d] ? std::min(long(numGhosts), n) : 0;
+    range.End[d] = extent[2*d+1] < domain[2*d+1] ?
+      std::max(range.Begin[d], n - numGhosts) : n;
+    }
+}
+
+//----------------------------------------------------------------------------
+int GetInteriorRange(const MeshMetadataPtr &md, int i, int centering,
+  InteriorRange &range)
+{
+  if (!md->Flags.BlockExtentsSet() || !LogicallyCartesian(md) || AMR(md) ||
+    (i < 0) || (i >= int(md->BlockExtents.size())) ||
+    (md->Extent[0] > md->Extent[1]))
+    return -1;
+
+  // the extents are cell extents, points have one more layer in each
+  // direction that is not flat
+  std::array<int,6> extent = md->BlockExtents[i];
+  std::array<int,6> domain = md->Extent;
+  int numGhosts = md->NumGhostCells;
+
+  if (centering == vtkDataObject::POINT)
+    {
+    for (int d = 0; d < 3; ++d)
+      {
+      if (domain[2*d] != domain[2*d+1])
+        {
+        extent[2*d+1] += 1;
+        domain[2*d+1] += 1;
+        }
+      }
+    numGhosts = md->NumGhostNodes;
+    }
+  else if (centering != vtkDataObject::CELL)
+    {
+    return -1;
+    }
+
+  GetInteriorRange(extent.data(), domain.data(), numGhosts, range);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int GetInteriorRanges(const MeshMetadataPtr &md, InteriorRangeMap &ranges)
+{
+  ranges.clear();
+
+  unsigned int nBlocks = md->BlockIds.size();
+  for (unsigned int i = 0; i < nBlocks; ++i)
+    {
+    std::array<InteriorRange,2> &range = ranges[md->BlockIds[i]];
+    if (GetInteriorRange(md, i, vtkDataObject::POINT, range[vtkDataObject::POINT]) ||
+      GetInteriorRange(md, i, vtkDataObject::CELL, range[vtkDataObject::CELL]))
+      {
+      ranges.clear();
+      return -1;
+      }
+    }
+
+  return nBlocks ? 0 : -1;
+}
+
+//----------------------------------------------------------------------------
+int GetInteriorRange(const ArrayView &view, InteriorRange &range)
+{
+  if (!view.HasInterior())
+    return -1;
+
+  for (int d = 0; d < 3; ++d)
+    {
+    long n = std::max(0, view.Extent[2*d+1] - view.Extent[2*d] + 1);
+    range.Dims[d] = n;
+    range.Begin[d] = std::min(n, std::max(0l,
+      long(view.Interior[2*d] - view.Extent[2*d])));
+    range.End[d] = std::max(range.Begin[d], std::min(n,
+      long(view.Interior[2*d+1] - view.Extent[2*d] + 1)));
+    }
+
+  if (range.GetNumberOfValues() != view.NumTuples)
+    return -1;
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+const InteriorRange *FindInteriorRange(const InteriorRangeMap &ranges,
+  int blockId, int centering, vtkDataArray *da)
+{
+  if ((centering != vtkDataObject::POINT) && (centering != vtkDataObject::CELL))
+    return nullptr;
+
+  InteriorRangeMap::const_iterator it = ranges.find(blockId);
+  if ((it == ranges.end()) ||
+    (it->second[centering].GetNumberOfValues() != da->GetNumberOfTuples()))
+    return nullptr;
+
+  return &it->second[centering];
+}
+
 // --------------------------------------------------------------------------
 int GetArrayMetadata(vtkDataSetAttributes *dsa, int centering,
   std::vector<std::string> &arrayNames, std::vector<int> &arrayCen,
@@ -607,91 +1180,199 @@ int GetArrayMetadata(vtkDataSet *ds, MeshMetadataPtr &metadata)
 
 // --------------------------------------------------------------------------
 int GetBlockMetadata(int rank, int id, vtkDataSet *ds,
-  const MeshMetadataFlags &flags, std::vector<int> &blockOwner,
-  std::vector<int> &blockIds, std::vector<long> &blockPoints,
-  std::vector<long> &blockCells, std::vector<long> &blockCellArraySize,
-  std::vector<std::array<int,6>> &blockExtents,
-  std::vector<std::array<double,6>> &blockBounds,
-  std::vector<std::vector<std::array<double,2>>> &blockArrayRange)
+  MeshMetadataPtr &metadata, long q)
 {
   if (!ds)
     return -1;
 
+  const MeshMetadataFlags &flags = metadata->Flags;
+
   if (flags.BlockDecompSet())
     {
-    blockOwner.emplace_back(rank);
-    blockIds.emplace_back(id);
+    metadata->BlockOwner[q] = rank;
+    metadata->BlockIds[q] = id;
     }
 
   if (flags.BlockSizeSet())
     {
-    long nPts = ds->GetNumberOfPoints();
-    blockPoints.emplace_back(nPts);
-
-    long nCells = ds->GetNumberOfCells();
-    blockCells.emplace_back(nCells);
+    metadata->BlockNumPoints[q] = ds->GetNumberOfPoints();
+    metadata->BlockNumCells[q] = ds->GetNumberOfCells();
 
     long cellArraySize = 0;
 
+    // the size of the legacy layout, the point ids plus a count per cell.
+    // the allocated size may be larger
     if (vtkUnstructuredGrid *ug = dynamic_cast<vtkUnstructuredGrid*>(ds))
-      cellArraySize = ug->GetCells()->GetSize();
+      cellArraySize = ug->GetCells()->GetNumberOfConnectivityEntries();
     else if (vtkPolyData *pd = dynamic_cast<vtkPolyData*>(ds))
-      cellArraySize = pd->GetVerts()->GetSize() + pd->GetLines()->GetSize()
-        + pd->GetPolys()->GetSize() + pd->GetStrips()->GetSize();
+      cellArraySize = pd->GetVerts()->GetNumberOfConnectivityEntries() +
+        pd->GetLines()->GetNumberOfConnectivityEntries() +
+        pd->GetPolys()->GetNumberOfConnectivityEntries() +
+        pd->GetStrips()->GetNumberOfConnectivityEntries();
 
-    blockCellArraySize.emplace_back(cellArraySize);
+    metadata->BlockCellArraySize[q] = cellArraySize;
     }
 
   if (flags.BlockExtentsSet())
     {
-    std::array<int,6> ext;
+    int *ext = metadata->BlockExtents[q].data();
     if (vtkImageData *im = dynamic_cast<vtkImageData*>(ds))
       {
-      im->GetExtent(ext.data());
+      im->GetExtent(ext);
       }
     else if (vtkRectilinearGrid *rg = dynamic_cast<vtkRectilinearGrid*>(ds))
       {
-      rg->GetExtent(ext.data());
+      rg->GetExtent(ext);
       }
     else if (vtkStructuredGrid *sg = dynamic_cast<vtkStructuredGrid*>(ds))
       {
-      sg->GetExtent(ext.data());
+      sg->GetExtent(ext);
       }
-    blockExtents.emplace_back(std::move(ext));
 
     // TODO -- for AMR meshes extract blocvk level
     }
 
   if (flags.BlockBoundsSet())
     {
-    std::array<double,6> bounds;
-    ds->GetBounds(bounds.data());
-    blockBounds.emplace_back(std::move(bounds));
+    ds->GetBounds(metadata->BlockBounds[q].data());
     }
 
   if (flags.BlockArrayRangeSet())
     {
-    std::vector<std::array<double,2>> arrayRange;
+    std::vector<std::array<double,2>> &arrayRange = metadata->BlockArrayRange[q];
+    arrayRange.clear();
     GetArrayMetadata(ds->GetPointData(), arrayRange);
     GetArrayMetadata(ds->GetCellData(), arrayRange);
-    blockArrayRange.emplace_back(std::move(arrayRange));
     }
 
   return 0;
 }
 
 // --------------------------------------------------------------------------
-int GetBlockMetadata(int rank, int id, vtkDataSet *ds, MeshMetadataPtr metadata)
+// make room for nBlocks local blocks in each of the requested fields so
+// that the blocks can be processed in any order
+void ResizeBlockMetadata(MeshMetadataPtr &metadata, long nBlocks)
 {
-    return GetBlockMetadata(rank, id, ds, metadata->Flags,
-      metadata->BlockOwner, metadata->BlockIds, metadata->BlockNumPoints,
-      metadata->BlockNumCells, metadata->BlockCellArraySize,
-      metadata->BlockExtents, metadata->BlockBounds, metadata->BlockArrayRange);
+  const MeshMetadataFlags &flags = metadata->Flags;
+
+  if (flags.BlockDecompSet())
+    {
+    metadata->BlockOwner.resize(nBlocks);
+    metadata->BlockIds.resize(nBlocks);
+    }
+
+  if (flags.BlockSizeSet())
+    {
+    metadata->BlockNumPoints.resize(nBlocks);
+    metadata->BlockNumCells.resize(nBlocks);
+    metadata->BlockCellArraySize.resize(nBlocks);
+    }
+
+  if (flags.BlockExtentsSet())
+    metadata->BlockExtents.resize(nBlocks, std::array<int,6>({0,0,0,0,0,0}));
+
+  if (flags.BlockBoundsSet())
+    metadata->BlockBounds.resize(nBlocks);
+
+  if (flags.BlockArrayRangeSet())
+    metadata->BlockArrayRange.resize(nBlocks);
 }
 
 // --------------------------------------------------------------------------
-int GetMetadata(MPI_Comm comm, vtkCompositeDataSet *cd, MeshMetadataPtr metadata)
+// compute the local array ranges, and the global bounds and extents with a
+// single reduction. the flags decide what is reduced since they are the
+// same on all ranks. array ranges are local because ranks without blocks
+// do not know the number of arrays, they are made global by
+// MeshMetadata::GlobalizeView
+void ReduceMetadata(MPI_Comm comm, MeshMetadataPtr &metadata)
 {
+  const MeshMetadataFlags &flags = metadata->Flags;
+
+  if (flags.BlockArrayRangeSet())
+    STLUtils::ReduceRange(metadata->BlockArrayRange, metadata->ArrayRange);
+
+  int nVals = (flags.BlockBoundsSet() ? 6 : 0) +
+    (flags.BlockExtentsSet() ? 6 : 0);
+
+  if (nVals == 0)
+    return;
+
+  std::array<double,6> bounds;
+  std::array<int,6> extent;
+  STLUtils::ReduceRange(metadata->BlockBounds, bounds);
+  STLUtils::ReduceRange(metadata->BlockExtents, extent);
+
+  // pack, negating the lower bounds so we can use MPI_MAX. extents are
+  // exactly representable as doubles
+  std::array<double,12> vals;
+  int q = 0;
+  if (flags.BlockBoundsSet())
+    for (int i = 0; i < 6; ++i)
+      vals[q++] = i % 2 ? bounds[i] : -bounds[i];
+
+  if (flags.BlockExtentsSet())
+    for (int i = 0; i < 6; ++i)
+      vals[q++] = i % 2 ? extent[i] : -double(extent[i]);
+
+  MPI_Allreduce(MPI_IN_PLACE, vals.data(), nVals, MPI_DOUBLE, MPI_MAX, comm);
+
+  q = 0;
+  if (flags.BlockBoundsSet())
+    for (int i = 0; i < 6; ++i, ++q)
+      metadata->Bounds[i] = i % 2 ? vals[q] : -vals[q];
+
+  if (flags.BlockExtentsSet())
+    for (int i = 0; i < 6; ++i, ++q)
+      metadata->Extent[i] = i % 2 ? vals[q] : -vals[q];
+}
+
+#if VTK_MAJOR_VERSION >= 9
+namespace
+{
+// --------------------------------------------------------------------------
+// the global ids of the partitions, in order, or null if not recorded
+vtkIntArray *GetPartitionIds(vtkPartitionedDataSet *pds)
+{
+  return dynamic_cast<vtkIntArray*>(
+    pds->GetFieldData()->GetArray("senseiBlockIds"));
+}
+
+// --------------------------------------------------------------------------
+// record the global ids of the partitions
+void SetPartitionIds(vtkPartitionedDataSet *pds, const std::vector<int> &ids)
+{
+  vtkIntArray *pids = vtkIntArray::New();
+  pids->SetName("senseiBlockIds");
+  pids->SetNumberOfTuples(ids.size());
+  std::copy(ids.begin(), ids.end(), pids->GetPointer(0));
+
+  pds->GetFieldData()->AddArray(pids);
+  pids->Delete();
+}
+
+// --------------------------------------------------------------------------
+// the partition that holds the block with the given global id, or -1
+int FindPartition(vtkPartitionedDataSet *pds, int blockId)
+{
+  vtkIntArray *ids = GetPartitionIds(pds);
+  if (!ids)
+    return -1;
+
+  const int *first = ids->GetPointer(0);
+  const int *last = first + ids->GetNumberOfTuples();
+  const int *it = std::lower_bound(first, last, blockId);
+
+  return ((it != last) && (*it == blockId)) ? int(it - first) : -1;
+}
+}
+#endif
+
+// --------------------------------------------------------------------------
+int GetMetadata(MPI_Comm comm, vtkCompositeDataSet *cd,
+  MeshMetadataPtr metadata, int nThreads)
+{
+  TimeEvent<128> mark("VTKUtils::GetMetadata");
+
   int rank = 0;
   MPI_Comm_rank(comm, &rank);
 
@@ -714,9 +1395,30 @@ int GetMetadata(MPI_Comm comm, vtkCompositeDataSet *cd, MeshMetadataPtr metadata
       metadata->CoordinateType = ps->GetPoints()->GetData()->GetDataType();
     }
 
-  // get block metadata
+#if VTK_MAJOR_VERSION >= 9
+  // a partitioned dataset holds the local blocks only. those given without
+  // ids, as a simulation may, are numbered rank by rank
+  vtkPartitionedDataSet *pds = dynamic_cast<vtkPartitionedDataSet*>(cd);
+  if (pds && !GetPartitionIds(pds))
+    {
+    int numLocal = pds->GetNumberOfPartitions();
+    int firstId = 0;
+    MPI_Exscan(&numLocal, &firstId, 1, MPI_INT, MPI_SUM, comm);
+    if (rank == 0)
+      firstId = 0;
+
+    std::vector<int> ids(numLocal);
+    for (int i = 0; i < numLocal; ++i)
+      ids[i] = firstId + i;
+
+    SetPartitionIds(pds, ids);
+    }
+#endif
+
+  // find the local blocks
   int numBlocks = 0;
-  int numBlocksLocal = 0;
+  std::vector<vtkDataSet*> blocks;
+  std::vector<int> blockIds;
   cdit->SetSkipEmptyNodes(0);
 
   for (cdit->InitTraversal(); !cdit->IsDoneWithTraversal(); cdit->GoToNextItem())
@@ -724,33 +1426,53 @@ int GetMetadata(MPI_Comm comm, vtkCompositeDataSet *cd, MeshMetadataPtr metadata
     numBlocks += 1;
 
     vtkDataObject *dobj = cd->GetDataSet(cdit);
-    int bid = std::max(0, int(cdit->GetCurrentFlatIndex() - 1));
+    int bid = std::max(0, GetBlockId(cd, cdit));
 
     if (vtkDataSet *ds = dynamic_cast<vtkDataSet*>(dobj))
       {
-      numBlocksLocal += 1;
+      blocks.push_back(ds);
+      blockIds.push_back(bid);
+      }
+    }
+  cdit->Delete();
 
-      if (VTKUtils::GetBlockMetadata(rank, bid, ds, metadata))
-        {
-        SENSEI_ERROR("Failed to get block metadata for block "
-         << cdit->GetCurrentFlatIndex())
-        cdit->Delete();
-        return -1;
-        }
+  // get block metadata. all of the requested quantities are computed
+  // together in one visit to each block, blocks are spread over threads
+  long numBlocksLocal = blocks.size();
+  ResizeBlockMetadata(metadata, numBlocksLocal);
+
+  ParallelFunction blockMetadata = [&](int, long q) -> int
+    {
+    if (VTKUtils::GetBlockMetadata(rank, blockIds[q], blocks[q], metadata, q))
+      {
+      SENSEI_ERROR("Failed to get block metadata for block " << blockIds[q])
+      return -1;
       }
+    return 0;
+    };
+
+  if (ParallelFor(numBlocksLocal, nThreads, blockMetadata))
+    return -1;
+
+#if VTK_MAJOR_VERSION >= 9
+  // the blocks of the other ranks are not held, the count follows from
+  // the largest id. the mesh is described as a multiblock
+  if (pds)
+    {
+    vtkIntArray *ids = GetPartitionIds(pds);
+    numBlocks = ids->GetNumberOfTuples() ?
+      ids->GetValue(ids->GetNumberOfTuples() - 1) + 1 : 0;
+
+    MPI_Allreduce(MPI_IN_PLACE, &numBlocks, 1, MPI_INT, MPI_MAX, comm);
     }
+#endif
 
   // set block counts
   metadata->NumBlocks = numBlocks;
-  metadata->NumBlocksLocal = {numBlocksLocal};
-  cdit->Delete();
+  metadata->NumBlocksLocal = {int(numBlocksLocal)};
 
   // get global bounds and extents
-  if (metadata->Flags.BlockBoundsSet())
-    MPIUtils::GlobalBounds(comm, metadata->BlockBounds, metadata->Bounds);
-
-  if (metadata->Flags.BlockExtentsSet())
-    MPIUtils::GlobalBounds(comm, metadata->BlockExtents, metadata->Extent);
+  ReduceMetadata(comm, metadata);
 
   if (amrds)
     {
@@ -794,6 +1516,8 @@ int GetMetadata(MPI_Comm comm, vtkCompositeDataSet *cd, MeshMetadataPtr metadata
 // note: not intended for use on the blocks of a multiblock
 int GetMetadata(MPI_Comm comm, vtkDataSet *ds, MeshMetadataPtr metadata)
 {
+  TimeEvent<128> mark("VTKUtils::GetMetadata");
+
   int rank = 0;
   int nRanks = 1;
 
@@ -805,7 +1529,9 @@ int GetMetadata(MPI_Comm comm, vtkDataSet *ds, MeshMetadataPtr metadata)
 
   VTKUtils::GetArrayMetadata(ds, metadata);
 
-  if (VTKUtils::GetBlockMetadata(rank, 0, ds, metadata))
+  ResizeBlockMetadata(metadata, 1);
+
+  if (VTKUtils::GetBlockMetadata(rank, 0, ds, metadata, 0))
     {
     SENSEI_ERROR("Failed to get block metadata for block " << rank)
     return -1;
@@ -815,18 +1541,106 @@ int GetMetadata(MPI_Comm comm, vtkDataSet *ds, MeshMetadataPtr metadata)
   metadata->NumBlocksLocal = {1};
 
   // get global bounds and extents
-  if (metadata->Flags.BlockBoundsSet())
-    MPIUtils::GlobalBounds(comm, metadata->BlockBounds, metadata->Bounds);
+  ReduceMetadata(comm, metadata);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+vtkCompositeDataSet *NewLocalBlocks(int numBlocks,
+  const std::vector<int> &localIds, bool partitioned)
+{
+#if VTK_MAJOR_VERSION >= 9
+  if (partitioned)
+    {
+    // the partitions are ordered by id so that blocks are found by bisection
+    std::vector<int> ids(localIds);
+    std::sort(ids.begin(), ids.end());
+
+    vtkPartitionedDataSet *pds = vtkPartitionedDataSet::New();
+    pds->SetNumberOfPartitions(ids.size());
+    SetPartitionIds(pds, ids);
+
+    return pds;
+    }
+#else
+  if (partitioned)
+    SENSEI_WARNING("vtkPartitionedDataSet requires VTK 9, a multiblock is used")
+#endif
+
+  (void)localIds;
+
+  vtkMultiBlockDataSet *mb = vtkMultiBlockDataSet::New();
+  mb->SetNumberOfBlocks(numBlocks);
+
+  return mb;
+}
 
-  if (metadata->Flags.BlockExtentsSet())
-    MPIUtils::GlobalBounds(comm, metadata->BlockExtents, metadata->Extent);
+// --------------------------------------------------------------------------
+int SetLocalBlock(vtkCompositeDataSet *cd, int blockId, vtkDataObject *dobj)
+{
+#if VTK_MAJOR_VERSION >= 9
+  if (vtkPartitionedDataSet *pds = dynamic_cast<vtkPartitionedDataSet*>(cd))
+    {
+    int q = FindPartition(pds, blockId);
+    if (q < 0)
+      return -1;
 
+    pds->SetPartition(q, dobj);
+    return 0;
+    }
+#endif
+
+  vtkMultiBlockDataSet *mb = dynamic_cast<vtkMultiBlockDataSet*>(cd);
+  if (!mb || (blockId < 0) || (unsigned(blockId) >= mb->GetNumberOfBlocks()))
+    return -1;
+
+  mb->SetBlock(blockId, dobj);
   return 0;
 }
 
+// --------------------------------------------------------------------------
+vtkDataObject *GetLocalBlock(vtkCompositeDataSet *cd, int blockId)
+{
+#if VTK_MAJOR_VERSION >= 9
+  if (vtkPartitionedDataSet *pds = dynamic_cast<vtkPartitionedDataSet*>(cd))
+    {
+    int q = FindPartition(pds, blockId);
+    return q < 0 ? nullptr : pds->GetPartitionAsDataObject(q);
+    }
+#endif
+
+  vtkMultiBlockDataSet *mb = dynamic_cast<vtkMultiBlockDataSet*>(cd);
+  if (!mb || (blockId < 0) || (unsigned(blockId) >= mb->GetNumberOfBlocks()))
+    return nullptr;
+
+  return mb->GetBlock(blockId);
+}
+
+// --------------------------------------------------------------------------
+int GetBlockId(vtkCompositeDataSet *cd, vtkCompositeDataIterator *it)
+{
+  int q = int(it->GetCurrentFlatIndex()) - 1;
+
+#if VTK_MAJOR_VERSION >= 9
+  // the partitions are the children of the root, partition q has flat
+  // index q + 1
+  if (vtkPartitionedDataSet *pds = dynamic_cast<vtkPartitionedDataSet*>(cd))
+    {
+    vtkIntArray *ids = GetPartitionIds(pds);
+    if (ids && (q >= 0) && (q < ids->GetNumberOfTuples()))
+      return ids->GetValue(q);
+    }
+#else
+  (void)cd;
+#endif
+
+  return q;
+}
+
 // --------------------------------------------------------------------------
 vtkCompositeDataSetPtr AsCompositeData(MPI_Comm comm,
-  vtkDataObject *dobj, bool take)
+  vtkDataObject *dobj, bool take, bool partitioned)
 {
   // make sure we have composite dataset if not create one
   vtkCompositeDataSetPtr cd;
@@ -846,12 +1660,12 @@ vtkCompositeDataSetPtr AsCompositeData(MPI_Comm comm,
     MPI_Comm_rank(comm, &rank);
     MPI_Comm_size(comm, &nRanks);
 
-    vtkMultiBlockDataSet *mb = vtkMultiBlockDataSet::New();
-    mb->SetNumberOfBlocks(nRanks);
-    mb->SetBlock(rank, dobj);
+    vtkCompositeDataSet *lb = NewLocalBlocks(nRanks,
+      std::vector<int>(1, rank), partitioned);
+    SetLocalBlock(lb, rank, dobj);
     if (take)
       dobj->Delete();
-    cd.TakeReference(mb);
+    cd.TakeReference(lb);
     }
 
   return cd;
@@ -5,12 +5,21 @@
 
 class vtkDataSet;
 class vtkDataObject;
+class vtkDataArray;
 class vtkFieldData;
 class vtkDataSetAttributes;
 class vtkCompositeDataSet;
+class vtkCompositeDataIterator;
+class vtkCellArray;
+class vtkUnstructuredGrid;
+class vtkPolyData;
+class vtkUnsignedCharArray;
 
 #include <vtkSmartPointer.h>
+#include <algorithm>
+#include <array>
 #include <functional>
+#include <map>
 #include <vector>
 #include <mpi.h>
 
@@ -19,6 +28,8 @@ using vtkCompositeDataSetPtr = vtkSmartPointer<vtkCompositeDataSet>;
 namespace sensei
 {
 
+struct ArrayView;
+
 /// A collection of generally useful funcitons implementing
 /// common access patterns or operations on VTK data structures
 namespace VTKUtils
@@ -27,6 +38,68 @@ namespace VTKUtils
 /// given a VTK POD data type enum returns the size
 unsigned int Size(int vtkt);
 
+/// if the array stores each component in its own buffer, as
+/// vtkSOADataArrayTemplate does, get a pointer to each component's values.
+/// returns zero if successful, non zero if the array has another layout
+int GetComponentPointers(vtkDataArray *da, std::vector<void*> &comps);
+
+/// construct a vtkSOADataArrayTemplate of the given VTK type and size, and
+/// get a pointer to each component's values. returns nullptr if the type
+/// is not supported or VTK generic arrays are not enabled. the caller
+/// takes the reference
+vtkDataArray *NewSOAArray(int vtkt, int nComps, long nTuples,
+  std::vector<void*> &comps);
+
+/// get the type that an array of the given VTK type is stored as at the
+/// given precision, one of the DataRequirements::PRECISION_ values. double
+/// is stored as float at both reduced precisions and other types are not
+/// changed, VTK has no 16 bit floating point type
+int GetStorageType(int vtkt, int precision);
+
+/// copy an array's values, interleaving any structure of arrays, to a
+/// buffer of the given VTK type converting them in the same pass. the
+/// buffer must hold the array's values. returns zero if successful
+int ExportToType(vtkDataArray *da, int vtkt, void *dest);
+
+/// returns a copy of the array converted to the given VTK type, or the
+/// array itself if it already has that type. the caller takes the
+/// reference
+vtkDataArray *NewArrayOfType(vtkDataArray *da, int vtkt);
+
+/// returns true when the cells of every block of the mesh can be
+/// described by 32 bit offsets and point ids
+bool CellIndices32(const MeshMetadataPtr &md);
+
+/// get the cells as offsets, one per cell plus one, and connectivity, the
+/// point ids of the cells back to back, in VTK_TYPE_INT32 or
+/// VTK_TYPE_INT64 arrays. with VTK 9 the cell array's own storage is
+/// passed when it has the requested type, otherwise the indices are
+/// converted. the caller takes the references
+int GetCellArrays(vtkCellArray *ca, bool use32, vtkDataArray *&offsets,
+  vtkDataArray *&connectivity);
+
+/// allocate offsets and connectivity arrays for the given numbers of
+/// cells and point ids. the caller takes the references
+void NewCellArrays(bool use32, long numCells, long connSize,
+  vtkDataArray *&offsets, vtkDataArray *&connectivity);
+
+/// construct a cell array from offsets and connectivity. with VTK 9 the
+/// arrays become the cell array's storage as they are. the caller takes
+/// the reference
+vtkCellArray *NewCellArray(vtkDataArray *offsets, vtkDataArray *connectivity);
+
+/// set the cells of an unstructured grid from types, offsets and
+/// connectivity
+int SetCells(vtkUnstructuredGrid *ug, vtkUnsignedCharArray *types,
+  vtkDataArray *offsets, vtkDataArray *connectivity);
+
+/// set the verts, lines, polys and strips of a polydata from a cell type
+/// per cell and the cells in the legacy layout, each cell's size followed
+/// by its point ids. the cells must be ordered verts, lines, polys then
+/// strips, as the transport writers store them
+int SetPolydataCells(vtkPolyData *pd, const unsigned char *types,
+  const vtkIdType *cells, long numCells);
+
 /// given a VTK data object enum returns true if it a legacy object
 int IsLegacyDataObject(int code);
 
@@ -61,6 +134,30 @@ using DatasetFunction = std::function<int(vtkDataSet*)>;
 /// The function is called once for each leaf dataset
 int Apply(vtkDataObject *dobj, DatasetFunction &func);
 
+/// callback that processes one of a number of items on one of several
+/// threads. thread is in [0, nThreads) and lets the callback keep per thread
+/// state, such as a VTK pipeline. i is the item.
+/// return 0 for success, > zero to stop without error, < zero to stop with error
+using ParallelFunction = std::function<int(int thread, long i)>;
+
+/// Calls the function for items 0 through n-1, distributing them over
+/// at most nThreads threads of the TaskRuntime. Items are claimed one at a
+/// time so that blocks of uneven cost balance. The function must be safe to call concurrently for
+/// different items. With one thread, or one item, the calls are made on the
+/// calling thread in order.
+int ParallelFor(long n, int nThreads, ParallelFunction &func);
+
+/// callback that processes a leaf dataset on one of several threads.
+/// thread is in [0, nThreads), leaf is the position of the dataset in
+/// traversal order and may be used to place results without locking.
+/// return 0 for success, > zero to stop without error, < zero to stop with error
+using ThreadedDatasetFunction =
+  std::function<int(int thread, long leaf, vtkDataSet*)>;
+
+/// Applies the function to the leaves of the data object on nThreads
+/// threads. The leaves are collected first, then processed with ParallelFor.
+int Apply(vtkDataObject *dobj, ThreadedDatasetFunction &func, int nThreads);
+
 /// Store ghost layer metadata in the mesh
 int SetGhostLayerMetadata(vtkDataObject *mesh,
   int nGhostCellLayers, int nGhostNodeLayers);
@@ -70,17 +167,151 @@ int SetGhostLayerMetadata(vtkDataObject *mesh,
 int GetGhostLayerMetadata(vtkDataObject *mesh,
   int &nGhostCellLayers, int &nGhostNodeLayers);
 
+/// The values of a block of a Cartesian mesh that are not ghosts. The
+/// ghost layers of such a block lie on the faces it shares with its
+/// neighbors and are described by the block's extent, the domain's extent
+/// and the number of ghost layers. The interior is the box [Begin, End) of
+/// the block's Dims in each direction, the values are ordered x fastest.
+/// Kernels visit the contiguous spans of interior values rather than test
+/// a vtkGhostType mask per value, which then need not be made at all.
+struct InteriorRange
+{
+  InteriorRange() : Dims{0,0,0}, Begin{0,0,0}, End{0,0,0} {}
+
+  long Dims[3];
+  long Begin[3];
+  long End[3];
+
+  /// the number of values of the block, ghosts included
+  long GetNumberOfValues() const { return Dims[0]*Dims[1]*Dims[2]; }
+
+  /// true if the id'th value is not a ghost
+  bool IsInterior(long id) const
+  {
+    long i = id % Dims[0];
+    long j = (id / Dims[0]) % Dims[1];
+    long k = id / (Dims[0]*Dims[1]);
+    return (i >= Begin[0]) && (i < End[0]) && (j >= Begin[1]) &&
+      (j < End[1]) && (k >= Begin[2]) && (k < End[2]);
+  }
+
+  /// split the values [begin, end) into consecutive spans of interior or
+  /// of ghost values, and call f(spanBegin, spanEnd, interior) for each in
+  /// order. the spans cover the values, adjacent ghost spans are merged
+  template <typename F>
+  void ForEachSpan(long begin, long end, F &&f) const
+  {
+    long nxny = Dims[0]*Dims[1];
+    long ghostBegin = begin;
+    long id = begin;
+    while (id < end)
+      {
+      long i = id % Dims[0];
+      long j = (id / Dims[0]) % Dims[1];
+      long k = id / nxny;
+      long rowEnd = std::min(end, id - i + Dims[0]);
+
+      if ((j < Begin[1]) || (j >= End[1]) || (k < Begin[2]) ||
+        (k >= End[2]) || (i >= End[0]))
+        {
+        id = rowEnd;
+        }
+      else if (i < Begin[0])
+        {
+        id = std::min(rowEnd, id - i + Begin[0]);
+        }
+      else
+        {
+        if (ghostBegin < id)
+          f(ghostBegin, id, false);
+        long spanEnd = std::min(rowEnd, id - i + End[0]);
+        f(id, spanEnd, true);
+        id = ghostBegin = spanEnd;
+        }
+      }
+    if (ghostBegin < end)
+      f(ghostBegin, end, false);
+  }
+};
+
+/// get the interior range of a block from its extent, the extent of the
+/// domain in the same index space, and the number of ghost layers. the
+/// extents are inclusive, [i0, i1, j0, j1, k0, k1], and are either both
+/// cell or both point extents
+void GetInteriorRange(const int extent[6], const int domain[6],
+  int numGhosts, InteriorRange &range);
+
+/// get the interior range of the cells or points, as given by centering,
+/// of the i'th block described by the metadata. this needs the block
+/// extents and the mesh extent of a Cartesian mesh, AMR is not supported.
+/// returns zero if successful and non-zero if the metadata does not
+/// describe the ghost zones.
+int GetInteriorRange(const MeshMetadataPtr &md, int i, int centering,
+  InteriorRange &range);
+
+/// the interior ranges of the points and cells, indexed by centering, of
+/// the blocks of a mesh, by block id
+using InteriorRangeMap = std::map<int, std::array<InteriorRange,2>>;
+
+/// get the interior ranges of all of the blocks described by the metadata.
+/// returns zero if successful and non-zero if the metadata does not
+/// describe the ghost zones of every block
+int GetInteriorRanges(const MeshMetadataPtr &md, InteriorRangeMap &ranges);
+
+/// get the interior range of the values of a view from its extents. returns
+/// zero if successful and non-zero if the view does not describe them
+int GetInteriorRange(const ArrayView &view, InteriorRange &range);
+
+/// find the interior range of an array of the given centering on a block.
+/// returns nullptr if there is none or it does not match the array's size
+const InteriorRange *FindInteriorRange(const InteriorRangeMap &ranges,
+  int blockId, int centering, vtkDataArray *da);
+
 /// Get  metadata, note that data set variant is not meant to
-/// be used on blocks of a multi-block
+/// be used on blocks of a multi-block. The requested quantities are
+/// computed in one visit to each block, the blocks of a composite dataset
+/// are processed on nThreads threads, and the global bounds and extents
+/// are found with a single reduction.
 int GetMetadata(MPI_Comm comm, vtkDataSet *ds, MeshMetadataPtr);
-int GetMetadata(MPI_Comm comm, vtkCompositeDataSet *cd, MeshMetadataPtr);
+int GetMetadata(MPI_Comm comm, vtkCompositeDataSet *cd, MeshMetadataPtr,
+  int nThreads = 1);
 
 /// Given a data object ensure that it is a composite data set
 /// If it already is, then the call is a no-op, if it is not
-/// then it is converted to a multiblock. The flag take determines
-/// if the smart pointer takes ownership or adds a reference.
+/// then it is converted to a multiblock, or when partitioned is set to a
+/// vtkPartitionedDataSet of one partition, see NewLocalBlocks. The flag
+/// take determines if the smart pointer takes ownership or adds a
+/// reference.
 vtkCompositeDataSetPtr AsCompositeData(MPI_Comm comm,
-  vtkDataObject *dobj, bool take = true);
+  vtkDataObject *dobj, bool take = true, bool partitioned = false);
+
+/// Make the composite dataset that holds this rank's blocks of a mesh of
+/// numBlocks blocks, localIds being the global ids of the local blocks.
+/// By default it is a vtkMultiBlockDataSet with a slot for every block of
+/// the mesh, empty for blocks on other ranks. When partitioned is set it
+/// is a vtkPartitionedDataSet with a partition for each local block only,
+/// in order of id, and the global ids in its "senseiBlockIds" field data
+/// array. Iteration, metadata and Apply are then O(local blocks) rather
+/// than O(global blocks). Use GetBlockId, GetLocalBlock and SetLocalBlock
+/// rather than block indices to work with either. Partitioned requires
+/// VTK 9, with older versions a multiblock is made. The caller takes the
+/// reference.
+vtkCompositeDataSet *NewLocalBlocks(int numBlocks,
+  const std::vector<int> &localIds, bool partitioned);
+
+/// Set the block with the given global id in a composite dataset made by
+/// NewLocalBlocks. returns zero if successful, non zero if the block is
+/// not one of the local blocks
+int SetLocalBlock(vtkCompositeDataSet *cd, int blockId, vtkDataObject *dobj);
+
+/// Get the block with the given global id from a composite dataset made
+/// by NewLocalBlocks, or null if it is not a local block
+vtkDataObject *GetLocalBlock(vtkCompositeDataSet *cd, int blockId);
+
+/// Get the global id of the block at the iterator's position in cd. For
+/// a vtkPartitionedDataSet this is the recorded id of the partition, see
+/// NewLocalBlocks, otherwise it is the flat index less one
+int GetBlockId(vtkCompositeDataSet *cd, vtkCompositeDataIterator *it);
 
 /// Return true if the mesh or block type is AMR
 inline bool AMR(const MeshMetadataPtr &md)
@@ -3,14 +3,15 @@
 #include "CDFReducer.h"
 #include "CinemaHelper.h"
 #include "DataAdaptor.h"
+#include "QuantileSketch.h"
+#include "Sampling.h"
+#include "VTKmDataCache.h"
 #include <Profiler.h>
 #include <Error.h>
 
 #include <vtkDataSet.h>
 #include <vtkCellData.h>
 #include <vtkIntArray.h>
-#include <vtkSortDataArray.h>
-#include <vtkDoubleArray.h>
 #include <vtkImageData.h>
 #ifdef ENABLE_VTK_MPI
 #  include <vtkMPICommunicator.h>
@@ -28,8 +29,11 @@
 
 // --- vtkm ---
 #include <vtkm/Math.h>
+#include <vtkm/cont/Algorithm.h>
+#include <vtkm/cont/ArrayCopy.h>
 #include <vtkm/cont/ArrayHandle.h>
 #include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/cont/ArrayHandlePermutation.h>
 #include <vtkm/cont/DataSetBuilderUniform.h>
 
 #include <vtkm/filter/FilterDataSet.h>
@@ -42,6 +46,59 @@
 #include <vtkm/cont/serial/DeviceAdapterSerial.h>
 #include <vtkm/cont/tbb/DeviceAdapterTBB.h>
 
+namespace
+{
+// copy the values of a single component array as doubles
+template <typename T>
+void CopyValues(vtkDataArray* array, const T* values, std::vector<double>& out)
+{
+  vtkIdType n = array->GetNumberOfTuples();
+  out.resize(n);
+  if (values)
+  {
+    std::copy(values, values + n, out.begin());
+  }
+  else
+  {
+    for (vtkIdType i = 0; i < n; ++i)
+    {
+      out[i] = array->GetComponent(i, 0);
+    }
+  }
+}
+
+// copy the sampled values of a single component array as doubles
+template <typename T>
+void SampleValues(vtkDataArray* array, const T* values, const std::vector<long>& ids,
+  std::vector<double>& out)
+{
+  size_t n = ids.size();
+  out.resize(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    out[i] = values ? values[ids[i]] : array->GetComponent(ids[i], 0);
+  }
+}
+
+// summarize a single component array
+template <typename T>
+void SketchValues(vtkDataArray* array, const T* values, sensei::QuantileSketch& sketch)
+{
+  vtkIdType n = array->GetNumberOfTuples();
+  if (values)
+  {
+    sketch.Insert(values, n);
+  }
+  else
+  {
+    for (vtkIdType i = 0; i < n; ++i)
+    {
+      sketch.Insert(array->GetComponent(i, 0));
+    }
+  }
+}
+}
+
 namespace sensei
 {
 
@@ -52,8 +109,13 @@ senseiNewMacro(VTKmCDFAnalysis);
 VTKmCDFAnalysis::VTKmCDFAnalysis()
   : Communicator(MPI_COMM_WORLD)
   , Helper(nullptr)
+  , EncoderThreads(0)
   , NumberOfQuantiles(10)
   , RequestSize(10)
+  , Method(METHOD_EXACT)
+  , SketchSize(256)
+  , SampleFraction(1.0)
+  , ErrorBound(0.0)
 {
 }
 
@@ -94,6 +156,27 @@ void VTKmCDFAnalysis::Initialize(
   this->Helper->SetWorkingDirectory(workingDirectory);
   this->Helper->SetExportType("cdf");
   this->Helper->SetSampleSize(this->NumberOfQuantiles);
+  this->Helper->SetNumberOfEncoderThreads(this->EncoderThreads);
+}
+
+//-----------------------------------------------------------------------------
+void VTKmCDFAnalysis::SetNumberOfEncoderThreads(int n)
+{
+  this->EncoderThreads = n;
+  if (this->Helper)
+  {
+    this->Helper->SetNumberOfEncoderThreads(n);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int VTKmCDFAnalysis::Finalize()
+{
+  if (this->Helper)
+  {
+    this->Helper->Flush();
+  }
+  return 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -117,6 +200,7 @@ bool VTKmCDFAnalysis::Execute(DataAdaptor* data)
 
   // Now ask the mesh for the array:
   vtkDataArray* array = nullptr;
+  int blockId = 0;
 
   if (mesh && this->FieldAssoc == vtkm::cont::Field::Association::WHOLE_MESH)
   {
@@ -147,6 +231,7 @@ bool VTKmCDFAnalysis::Execute(DataAdaptor* data)
         array = dobj->GetFieldData()->GetArray(this->FieldName.c_str());
         if (array)
         {
+          blockId = i;
           break;
         }
       }
@@ -159,6 +244,7 @@ bool VTKmCDFAnalysis::Execute(DataAdaptor* data)
       {
         array = dataset->GetCellData()->GetArray(this->FieldName.c_str());
       }
+      blockId = i;
     }
   }
 
@@ -180,28 +266,212 @@ bool VTKmCDFAnalysis::Execute(DataAdaptor* data)
     return false;
   }
 
-  Profiler::StartEvent("VTKm CDF");
-  vtkNew<vtkDoubleArray> sorted;
-  sorted->DeepCopy(array);
-  vtkSortDataArray::SortArrayByComponent(sorted, 0);
+  // arrays with the standard layout are read in place, others through the
+  // vtkDataArray API
+  bool inPlace = array->HasStandardMemoryLayout();
+
+  // the sample, when one is taken. the fraction given by an error bound
+  // follows from the size of the whole field
+  long long nValues = array->GetNumberOfTuples();
+  double fraction = this->SampleFraction;
+  if (this->ErrorBound > 0.0)
+  {
+    long long nTotal = nValues;
+    MPI_Allreduce(MPI_IN_PLACE, &nTotal, 1, MPI_LONG_LONG, MPI_SUM, this->Communicator);
+    fraction = Sampling::GetFraction(Sampling::GetCDFSampleSize(this->ErrorBound), nTotal);
+  }
+
+  bool sampled = (fraction > 0.0) && (fraction < 1.0);
+  std::vector<long> sampleIds;
+  if (sampled)
+  {
+    Sampling::GetSampleIds(nValues, fraction, data->GetDataTimeStep(), sampleIds);
+  }
+
+  double* cdf = nullptr;
+  if (this->Method == METHOD_SKETCH)
+  {
+    Profiler::StartEvent("VTKm CDF sketch");
+    QuantileSketch sketch(this->SketchSize);
+    if (sampled)
+    {
+      std::vector<double> sample;
+      switch (array->GetDataType())
+      {
+        vtkTemplateMacro(
+          SampleValues(array, inPlace ? static_cast<VTK_TT*>(array->GetVoidPointer(0)) : nullptr,
+            sampleIds, sample););
+      }
+      sketch.Insert(sample.data(), sample.size());
+    }
+    else
+    {
+      switch (array->GetDataType())
+      {
+        vtkTemplateMacro(
+          SketchValues(array, inPlace ? static_cast<VTK_TT*>(array->GetVoidPointer(0)) : nullptr,
+            sketch););
+      }
+    }
+
+    if (this->MergeSketches(sketch))
+    {
+      Profiler::EndEvent("VTKm CDF sketch");
+      return false;
+    }
+    cdf = this->Quantiles.data();
+    Profiler::EndEvent("VTKm CDF sketch");
+  }
+  else
+  {
+    Profiler::StartEvent("VTKm CDF");
+    VTKmDataCache::Update(data);
+
+    // when an earlier analysis or the simulation left the field in the
+    // cache it is converted and sorted where it is, likely on the device,
+    // and only the sorted values come back
+    vtkm::cont::Field cached;
+    bool haveCached =
+      VTKmDataCache::GetField(this->MeshName, blockId, this->FieldName, this->FieldAssoc, cached);
+    if (haveCached && cached.GetData().IsType<vtkm::cont::ArrayHandle<vtkm::Float32>>())
+    {
+      vtkm::cont::ArrayHandle<vtkm::Float32> in;
+      cached.GetData().CopyTo(in);
+      vtkm::cont::ArrayHandle<vtkm::Float64> handle;
+      if (sampled)
+      {
+        // only the sampled values are gathered, where the field is
+        std::vector<vtkm::Id> ids(sampleIds.begin(), sampleIds.end());
+        vtkm::cont::ArrayHandle<vtkm::Id> idHandle;
+        vtkm::cont::ArrayCopy(vtkm::cont::make_ArrayHandle(ids), idHandle);
+        vtkm::cont::ArrayCopy(vtkm::cont::make_ArrayHandlePermutation(idHandle, in), handle);
+      }
+      else
+      {
+        vtkm::cont::ArrayCopy(in, handle);
+      }
+      vtkm::cont::Algorithm::Sort(handle);
+
+      vtkm::Id n = handle.GetNumberOfValues();
+      auto portal = handle.GetPortalConstControl();
+      this->Sorted.resize(n);
+      for (vtkm::Id i = 0; i < n; ++i)
+      {
+        this->Sorted[i] = portal.Get(i);
+      }
+    }
+    else
+    {
+      // a single conversion to double, then sort on the VTK-m device. the
+      // buffer is kept across steps
+      switch (array->GetDataType())
+      {
+        vtkTemplateMacro(
+          if (sampled)
+          {
+            SampleValues(array, inPlace ? static_cast<VTK_TT*>(array->GetVoidPointer(0)) : nullptr,
+              sampleIds, this->Sorted);
+          }
+          else
+          {
+            CopyValues(array, inPlace ? static_cast<VTK_TT*>(array->GetVoidPointer(0)) : nullptr,
+              this->Sorted);
+          });
+      }
+
+      auto handle = vtkm::cont::make_ArrayHandle(this->Sorted);
+      vtkm::cont::Algorithm::Sort(handle);
+      handle.SyncControlArray();
+    }
 
 #ifdef ENABLE_VTK_MPI
-  vtkNew<vtkMPIController> controller;
+    vtkNew<vtkMPIController> controller;
 #else
-  vtkNew<vtkMultiProcessController> controller;
+    vtkNew<vtkMultiProcessController> controller;
 #endif
-  CDFReducer reducer(controller);
-  reducer.SetBufferSize(this->RequestSize);
+    CDFReducer reducer(controller);
+    reducer.SetBufferSize(this->RequestSize);
+    reducer.SetVerbose(this->GetVerbose());
 
-  double* cdf = reducer.Compute(sorted->GetPointer(0), sorted->GetNumberOfTuples(), this->NumberOfQuantiles);
-  Profiler::EndEvent("VTKm CDF");
+    cdf = reducer.Compute(this->Sorted.data(), this->Sorted.size(), this->NumberOfQuantiles);
+    Profiler::EndEvent("VTKm CDF");
+  }
+
+  // the fraction is the same on all ranks, and so is the decision to sample
+  long long nSamples = sampleIds.size();
+  if (sampled)
+  {
+    MPI_Allreduce(MPI_IN_PLACE, &nSamples, 1, MPI_LONG_LONG, MPI_SUM, this->Communicator);
+  }
 
   Profiler::StartEvent("Cinema CDF export");
   this->Helper->WriteCDF(this->NumberOfQuantiles, cdf);
+  if (sampled)
+  {
+    this->Helper->AddCDFErrorBound(fraction, nSamples, Sampling::GetCDFBound(nSamples));
+  }
+  // the index refers to the step's CDF once it is written
+  this->Helper->Flush();
   this->Helper->WriteMetadata();
   Profiler::EndEvent("Cinema CDF export");
 
   return true;
 }
 
+//-----------------------------------------------------------------------------
+int VTKmCDFAnalysis::MergeSketches(QuantileSketch& sketch)
+{
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(this->Communicator, &rank);
+  MPI_Comm_size(this->Communicator, &nRanks);
+
+  // the sketches are small, gather them to rank 0 and merge there
+  std::vector<double> values;
+  std::vector<int> levels;
+  sketch.GetValues(values, levels);
+
+  int nLocal = values.size();
+  std::vector<int> counts(nRanks, 0);
+  MPI_Gather(&nLocal, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, this->Communicator);
+
+  std::vector<int> displ(nRanks, 0);
+  int nTotal = 0;
+  for (int i = 0; i < nRanks; ++i)
+  {
+    displ[i] = nTotal;
+    nTotal += counts[i];
+  }
+
+  std::vector<double> allValues(rank ? 0 : nTotal);
+  std::vector<int> allLevels(rank ? 0 : nTotal);
+
+  MPI_Gatherv(values.data(), nLocal, MPI_DOUBLE, allValues.data(), counts.data(),
+    displ.data(), MPI_DOUBLE, 0, this->Communicator);
+
+  MPI_Gatherv(levels.data(), nLocal, MPI_INT, allLevels.data(), counts.data(),
+    displ.data(), MPI_INT, 0, this->Communicator);
+
+  double range[2] = { -sketch.GetMin(), sketch.GetMax() };
+  MPI_Allreduce(MPI_IN_PLACE, range, 2, MPI_DOUBLE, MPI_MAX, this->Communicator);
+
+  this->Quantiles.assign(this->NumberOfQuantiles, 0.0);
+
+  if (rank == 0)
+  {
+    QuantileSketch merged(this->SketchSize);
+    merged.Merge(allValues, allLevels, -range[0], range[1]);
+
+    if (merged.GetCount() == 0.0)
+    {
+      SENSEI_ERROR("No values for the CDF of \"" << this->FieldName << "\"");
+      return -1;
+    }
+
+    merged.GetQuantiles(this->NumberOfQuantiles, this->Quantiles.data());
+  }
+
+  return 0;
+}
+
 }
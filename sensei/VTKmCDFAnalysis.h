@@ -4,10 +4,12 @@
 #include "AnalysisAdaptor.h"
 #include <vtkm/cont/Field.h>
 #include <mpi.h>
+#include <vector>
 
 namespace sensei
 {
 class CinemaHelper;
+class QuantileSketch;
 
 class VTKmCDFAnalysis : public AnalysisAdaptor
 {
@@ -24,21 +26,75 @@ public:
     int requestSize,
     MPI_Comm comm);
 
+  /// How the CDF is computed.
+  ///
+  /// METHOD_EXACT sorts each rank's values with VTK-m and locates the
+  /// quantiles exactly with the CDFReducer.
+  ///
+  /// METHOD_SKETCH summarizes each rank's values in a QuantileSketch of
+  /// constant size, without sorting them, and merges the sketches on rank
+  /// 0. The quantiles are approximate.
+  enum
+  {
+    METHOD_EXACT = 0,
+    METHOD_SKETCH = 1
+  };
+
+  void SetMethod(int method) { this->Method = method; }
+  int GetMethod() const { return this->Method; }
+
+  /// The values held by each compactor of the sketch. Larger sketches are
+  /// more accurate.
+  void SetSketchSize(int size) { this->SketchSize = size; }
+  int GetSketchSize() const { return this->SketchSize; }
+
+  /// The fraction, in (0, 1], of the values used. Each rank takes a
+  /// stratified sample of its values, the same fraction everywhere so that
+  /// the pooled sample stands for the whole field, and the CDF of the
+  /// sample is computed by either method. The 95% bound on the error of
+  /// the probabilities (Dvoretzky-Kiefer-Wolfowitz) is written in the
+  /// Cinema metadata. The default, 1, uses all of the values.
+  void SetSampleFraction(double fraction) { this->SampleFraction = fraction; }
+  double GetSampleFraction() const { return this->SampleFraction; }
+
+  /// The largest error of the probabilities of the CDF. When set the
+  /// sample size follows from the bound, independent of the size of the
+  /// field, and overrides the sample fraction. The default, 0, uses the
+  /// sample fraction.
+  void SetErrorBound(double bound) { this->ErrorBound = bound; }
+  double GetErrorBound() const { return this->ErrorBound; }
+
+  /// The number of threads writing the Cinema files in the background, see
+  /// CinemaHelper::SetNumberOfEncoderThreads. The files of a step are
+  /// complete when Execute returns. The default, 0, writes on the calling
+  /// thread.
+  void SetNumberOfEncoderThreads(int n);
+
   bool Execute(DataAdaptor* data) override;
 
-  int Finalize() override { return 0; }
+  int Finalize() override;
 
 protected:
   VTKmCDFAnalysis();
   ~VTKmCDFAnalysis();
 
+  // merge the sketches of all ranks, the quantiles are left on rank 0
+  int MergeSketches(QuantileSketch& sketch);
+
   std::string MeshName;
   std::string FieldName;
   vtkm::cont::Field::Association FieldAssoc;
   MPI_Comm Communicator;
   CinemaHelper* Helper;
+  int EncoderThreads;
   int NumberOfQuantiles;
   int RequestSize;
+  int Method;
+  int SketchSize;
+  double SampleFraction;
+  double ErrorBound;
+  std::vector<double> Sorted;
+  std::vector<double> Quantiles;
 
 private:
   VTKmCDFAnalysis(const VTKmCDFAnalysis&);
@@ -1,6 +1,7 @@
 #include "VTKmContourAnalysis.h"
 
 #include "DataAdaptor.h"
+#include "PolyDataReducer.h"
 #include "Profiler.h"
 #include "Error.h"
 
@@ -22,10 +23,9 @@
 #include <vtkImageData.h>
 #include <vtkStructuredGridConnectivity.h>
 #include <vtkStructuredExtent.h>
-#include <vtkExtractVOI.h>
-#include <vtkStructuredPointsWriter.h>
-#include <vtkStructuredPointsReader.h>
-#include <vtkStructuredPoints.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkPolyData.h>
 
 #include <sdiy/master.hpp>
 #include <sdiy/mpi.hpp>
@@ -34,172 +34,287 @@
 #include <vector>
 #include <sstream>
 #include <map>
+#include <cstring>
 
 
-namespace sensei
+namespace
+{
+// a neighbor of a local block. the point extents of the ghost regions
+// sent to it and received from it are computed once when the plan is
+// built
+struct GhostNeighbor
 {
+  sdiy::BlockID Id;
+  int SendExtent[6];
+  int RecvExtent[6];
+  std::vector<unsigned char> SendBuffer; // reused between steps
+};
 
-#if VTK_MAJOR_VERSION == 6 && VTK_MINOR_VERSION == 1
-VTKmContourAnalysis *VTKmContourAnalysis::New() { return new VTKmContourAnalysis; }
-#else
-vtkStandardNewMacro(VTKmContourAnalysis);
-#endif
+// a local block and the ghosted copy of it that is passed to the filters.
+// the ghosted copy and its arrays are reused while the plan is valid
+struct GhostBlock
+{
+  GhostBlock() : Data(nullptr) {}
 
-//-----------------------------------------------------------------------------
-VTKmContourAnalysis::VTKmContourAnalysis()
+  int Extent[6];
+  int GhostedExtent[6];
+  std::vector<GhostNeighbor> Neighbors;
+  vtkImageData *Data; // the simulation's block, set each step
+  vtkSmartPointer<vtkImageData> Ghosted;
+  std::vector<vtkDataArray*> Arrays; // the ghosted cell data arrays
+  std::vector<unsigned char> RecvBuffer; // reused between steps
+};
+
+// --------------------------------------------------------------------------
+// converts a point extent to the extent of its cells. a flat dimension
+// has one layer of cells, as in VTK
+void cellExtent(const int *pext, int *cext)
 {
+  for (int i = 0; i < 3; ++i)
+    {
+    cext[2*i] = pext[2*i];
+    cext[2*i+1] = std::max(pext[2*i], pext[2*i+1] - 1);
+    }
 }
 
-//-----------------------------------------------------------------------------
-VTKmContourAnalysis::~VTKmContourAnalysis()
+// --------------------------------------------------------------------------
+size_t numberOfCells(const int *cext)
 {
+  return size_t(cext[1] - cext[0] + 1)*size_t(cext[3] - cext[2] + 1)*
+    size_t(cext[5] - cext[4] + 1);
 }
 
-//-----------------------------------------------------------------------------
-void VTKmContourAnalysis::Initialize(const std::string& meshName,
-  const std::string& arrayName, double value, bool writeOutput)
+// --------------------------------------------------------------------------
+// copies the tuples of the cells in the cell extent ext between an array
+// laid out over the cell extent aext and a packed buffer
+void copyCells(unsigned char *array, const int *aext, const int *ext,
+  size_t tupleBytes, unsigned char *buffer, bool pack)
 {
-  this->MeshName = meshName;
-  this->ArrayName = arrayName;
-  this->Value = value;
-  this->WriteOutput = writeOutput;
+  size_t nx = aext[1] - aext[0] + 1;
+  size_t ny = aext[3] - aext[2] + 1;
+  size_t rowBytes = (ext[1] - ext[0] + 1)*tupleBytes;
+
+  for (int k = ext[4]; k <= ext[5]; ++k)
+    {
+    for (int j = ext[2]; j <= ext[3]; ++j)
+      {
+      size_t id = (size_t(k - aext[4])*ny + size_t(j - aext[2]))*nx +
+        size_t(ext[0] - aext[0]);
+
+      unsigned char *row = array + id*tupleBytes;
+
+      if (pack)
+        memcpy(buffer, row, rowBytes);
+      else
+        memcpy(row, buffer, rowBytes);
+
+      buffer += rowBytes;
+      }
+    }
 }
 
-struct Block
+// --------------------------------------------------------------------------
+// the bytes of a tuple summed over the ghosted arrays
+size_t tupleBytes(const GhostBlock *b)
 {
-  Block(int* extent, int gl, vtkImageData* data,  vtkImageData* ghosted,
-        vtkStructuredGridConnectivity* con)
-       : GhostLevels(gl), Data(data), GhostedData(ghosted), Connectivity(con), Neighbors(0)
-  {
-    memcpy(this->Extent, extent, 6*sizeof(int));
-  }
+  size_t n = 0;
+  for (size_t i = 0; i < b->Arrays.size(); ++i)
+    n += b->Arrays[i]->GetNumberOfComponents()*b->Arrays[i]->GetDataTypeSize();
+  return n;
+}
 
-  ~Block()
-  {
-    delete this->Neighbors;
-  }
+// --------------------------------------------------------------------------
+// packs the cells of the regions the neighbors need, array by array, and
+// enqueues them
+void SendGhosts(GhostBlock *b, const sdiy::Master::ProxyWithLink &cp)
+{
+  int cext[6];
+  cellExtent(b->Extent, cext);
 
-  int Extent[6];
-  int GhostLevels;
-  vtkImageData* Data;
-  vtkImageData* GhostedData;
-  vtkStructuredGridConnectivity* Connectivity;
-  std::map<vtkIdType, vtkStructuredNeighbor>* Neighbors;
-};
+  size_t nBytes = tupleBytes(b);
+  size_t nArrays = b->Arrays.size();
 
-void SendGhostRegion(Block* b, const sdiy::Master::ProxyWithLink& cp,
-  std::vector<int>& ext, sdiy::BlockID& target)
-{
-  vtkNew<vtkExtractVOI> evoi;
-  evoi->SetInputData(b->GhostedData);
-  evoi->SetVOI(&ext[0]);
-  evoi->Update();
+  vtkDataSetAttributes *cd = b->Data->GetCellData();
 
-  vtkNew<vtkStructuredPointsWriter> writer;
-  writer->SetWriteToOutputString(1);
-  writer->SetFileTypeToBinary();
-  writer->SetInputData(evoi->GetOutput());
-  writer->SetWriteExtent(true);
-  writer->Write();
+  size_t nNeighbors = b->Neighbors.size();
+  for (size_t i = 0; i < nNeighbors; ++i)
+    {
+    GhostNeighbor &n = b->Neighbors[i];
 
-  unsigned char* buffer = writer->GetBinaryOutputString();
-  int len = writer->GetOutputStringLength();
+    int sext[6];
+    cellExtent(n.SendExtent, sext);
+    size_t nCells = numberOfCells(sext);
 
-  std::vector<unsigned char> bufferv(buffer, buffer+len);
+    n.SendBuffer.resize(nCells*nBytes);
+    unsigned char *buf = n.SendBuffer.data();
 
-  cp.enqueue(target, bufferv);
-}
+    for (size_t j = 0; j < nArrays; ++j)
+      {
+      vtkDataArray *da = cd->GetArray(b->Arrays[j]->GetName());
+      size_t tb = da->GetNumberOfComponents()*da->GetDataTypeSize();
 
-void SendGhosts(Block* b,
-                const sdiy::Master::ProxyWithLink& cp,
-                void*)
-{
-  sdiy::Link*    l = cp.link();
-  for (int i = 0; i < l->size(); ++i)
-    {
-    vtkIdType neighborID = l->target(i).gid;
-    vtkStructuredNeighbor& ninfo = (*b->Neighbors)[neighborID];
-    const int* sExt = ninfo.OverlapExtent;
-    std::vector<int> sExtC(sExt, sExt+6);
-    vtkStructuredExtent::Clamp(&sExtC[0], b->Data->GetExtent());
-    SendGhostRegion(b, cp, sExtC, l->target(i));
-    }
+      copyCells(static_cast<unsigned char*>(da->GetVoidPointer(0)),
+        cext, sext, tb, buf, true);
 
+      buf += nCells*tb;
+      }
+
+    cp.enqueue(n.Id, n.SendBuffer.data(), n.SendBuffer.size());
+    }
 }
 
-void ReceiveGhosts(Block* b,
-                   const sdiy::Master::ProxyWithLink& cp,
-                   void*)
+// --------------------------------------------------------------------------
+// dequeues the regions sent by the neighbors and copies them into the
+// ghosted arrays
+void ReceiveGhosts(GhostBlock *b, const sdiy::Master::ProxyWithLink &cp)
 {
-  vtkNew<vtkStructuredPointsReader> reader;
+  int gext[6];
+  cellExtent(b->GhostedExtent, gext);
+
+  size_t nBytes = tupleBytes(b);
+  size_t nArrays = b->Arrays.size();
 
-  // gids of incoming neighbors in the link
   std::vector<int> in;
   cp.incoming(in);
 
-  for (unsigned int i = 0; i < in.size(); ++i)
+  size_t nIn = in.size();
+  for (size_t i = 0; i < nIn; ++i)
     {
-    std::vector<unsigned char> buffer;
-    cp.dequeue(in[i], buffer);
-    reader->SetInputString(reinterpret_cast<char*>(&buffer[0]), buffer.size());
-    reader->SetReadFromInputString(1);
-    reader->Update();
-
-    // Here we copy the ghost cells values to the output
-    // dataset. For now, we copy only cell data.
-    vtkImageData* ghosted = b->GhostedData;
-
-    vtkImageData* ghosts = reader->GetOutput();
-
-    // Extents are based on points so convert them
-    // to cell extents.
-    int gExt[6];
-    ghosted->GetExtent(gExt);
-    int recvExt[6];
-    ghosts->GetExtent(recvExt);
-    for (unsigned int i=0; i<3; i++)
+    std::vector<GhostNeighbor>::iterator nit = std::find_if(
+      b->Neighbors.begin(), b->Neighbors.end(),
+      [&](const GhostNeighbor &n) { return n.Id.gid == in[i]; });
+
+    if (nit == b->Neighbors.end())
+      continue;
+
+    int rext[6];
+    cellExtent(nit->RecvExtent, rext);
+    size_t nCells = numberOfCells(rext);
+
+    b->RecvBuffer.resize(nCells*nBytes);
+    cp.dequeue(in[i], b->RecvBuffer.data(), b->RecvBuffer.size());
+
+    unsigned char *buf = b->RecvBuffer.data();
+    for (size_t j = 0; j < nArrays; ++j)
       {
-      gExt[2*i+1]--;
-      recvExt[2*i+1]--;
-      }
+      vtkDataArray *da = b->Arrays[j];
+      size_t tb = da->GetNumberOfComponents()*da->GetDataTypeSize();
+
+      copyCells(static_cast<unsigned char*>(da->GetVoidPointer(0)),
+        gext, rext, tb, buf, false);
 
-    ghosted->GetCellData()->CopyStructuredData(
-      ghosts->GetCellData(), recvExt, gExt, false);
+      buf += nCells*tb;
+      }
     }
+}
+}
+
+namespace sensei
+{
+
+struct VTKmContourAnalysis::InternalsType
+{
+  InternalsType() : Controller(nullptr), Master(nullptr) {}
+
+  ~InternalsType()
+  {
+    this->ClearPlan();
+
+    if (this->Controller)
+      this->Controller->Delete();
+  }
+
+  void ClearPlan()
+  {
+    delete this->Master;
+    this->Master = nullptr;
+    this->Blocks.clear();
+    this->LocalExtents.clear();
+  }
+
+  int UpdatePlan(const std::vector<vtkImageData*> &datasets);
+  int UpdateGhostedBlocks();
+  vtkSmartPointer<vtkMultiBlockDataSet> ExchangeGhosts(vtkDataObject *mesh);
+
+  vtkMPIController *Controller;
+
+  // the plan. the neighbors and the regions exchanged with them depend
+  // only on the decomposition, they are computed once and reused until a
+  // block's extent changes
+  std::vector<int> LocalExtents;
+  std::vector<GhostBlock> Blocks;
+  sdiy::Master *Master;
+
+  // applied to the contours before they are written
+  PolyDataReducer Reducer;
+};
+
+#if VTK_MAJOR_VERSION == 6 && VTK_MINOR_VERSION == 1
+VTKmContourAnalysis *VTKmContourAnalysis::New() { return new VTKmContourAnalysis; }
+#else
+vtkStandardNewMacro(VTKmContourAnalysis);
+#endif
+
+//-----------------------------------------------------------------------------
+VTKmContourAnalysis::VTKmContourAnalysis() : Internals(new InternalsType)
+{
+}
 
+//-----------------------------------------------------------------------------
+VTKmContourAnalysis::~VTKmContourAnalysis()
+{
+  delete this->Internals;
 }
 
-// This method exchanges 2 layers of ghost cells between
-// blocks. A new set of datasets with ghost levels is
-// returned
-vtkSmartPointer<vtkMultiBlockDataSet> ExchangeGhosts(
-  vtkDataObject* mesh, vtkMPIController* contr)
+//-----------------------------------------------------------------------------
+void VTKmContourAnalysis::Initialize(const std::string& meshName,
+  const std::string& arrayName, double value, bool writeOutput)
 {
-  vtkMultiBlockDataSet* mb = vtkMultiBlockDataSet::SafeDownCast(
-    mesh);
-  if (!mb)
-    {
-    return nullptr;
-    }
+  this->MeshName = meshName;
+  this->ArrayName = arrayName;
+  this->Value = value;
+  this->WriteOutput = writeOutput;
+}
 
-  vtkSmartPointer<vtkCompositeDataIterator> iter;
-  iter.TakeReference(mb->NewIterator());
+//-----------------------------------------------------------------------------
+void VTKmContourAnalysis::SetReducer(const PolyDataReducer &reducer)
+{
+  this->Internals->Reducer = reducer;
+}
 
-  // Create a flat vector of datasets for simplicity.
-  std::vector<vtkSmartPointer<vtkImageData> > datasets;
-  iter->InitTraversal();
-  while (!iter->IsDoneWithTraversal())
+// --------------------------------------------------------------------------
+int VTKmContourAnalysis::InternalsType::UpdatePlan(
+  const std::vector<vtkImageData*> &datasets)
+{
+  vtkIdType nblocks = datasets.size();
+
+  std::vector<int> localExtents(nblocks*6);
+  for (vtkIdType i = 0; i < nblocks; ++i)
+    datasets[i]->GetExtent(&localExtents[i*6]);
+
+  // the plan is kept when no rank's blocks changed
+  int changed = (this->Master == nullptr) ||
+    (localExtents != this->LocalExtents) ? 1 : 0;
+
+  vtkMPIController *contr = this->Controller;
+  vtkMPICommunicator *vtkcomm = vtkMPICommunicator::SafeDownCast(
+    contr->GetCommunicator());
+  MPI_Comm comm = *vtkcomm->GetMPIComm()->GetHandle();
+
+  MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_MAX, comm);
+
+  if (!changed)
     {
-    vtkImageData* cur = vtkImageData::SafeDownCast(
-      iter->GetCurrentDataObject());
-    if (cur)
-      {
-      datasets.push_back(cur);
-      }
-    iter->GoToNextItem();
+    for (vtkIdType i = 0; i < nblocks; ++i)
+      this->Blocks[i].Data = datasets[i];
+    return 0;
     }
 
-  vtkIdType nblocks = datasets.size();
+  TimeEvent<128> mark("VTKmContourAnalysis::UpdatePlan");
+
+  this->ClearPlan();
+  this->LocalExtents = localExtents;
+
   int nranks = contr->GetNumberOfProcesses();
   int rank = contr->GetLocalProcessId();
 
@@ -223,14 +338,9 @@ vtkSmartPointer<vtkMultiBlockDataSet> ExchangeGhosts(
     recvLength[i] = allnblocks[i] * 6;
     }
   vtkIdType totnblocks = offsets[nranks - 1] + allnblocks[nranks - 1];
-  std::vector<int> localExtents(nblocks*6);
-  for(vtkIdType i=0; i<nblocks; i++)
-    {
-    datasets[i]->GetExtent(&localExtents[i*6]);
-    }
   std::vector<int> allExtents(totnblocks*6);
-  contr->AllGatherV(
-    &localExtents[0], &allExtents[0], nblocks*6, &recvLength[0], &extoffsets[0]);
+  contr->AllGatherV(localExtents.data(), allExtents.data(), nblocks*6,
+    recvLength.data(), extoffsets.data());
 
   // Figure out the overall extent of all blocks.
   int wholeExtent[6] = {VTK_INT_MAX, -VTK_INT_MAX,
@@ -281,91 +391,191 @@ vtkSmartPointer<vtkMultiBlockDataSet> ExchangeGhosts(
     }
   sgc->ComputeNeighbors();
 
-  // Allocate a new set of blocks that will contain the
-  // ghost cells. Also copy the information from input
-  // datasets.
-  std::vector<vtkSmartPointer<vtkImageData> > ghostedDatasets;
-  ghostedDatasets.resize(nblocks);
+  // the blocks must not move once they are added to the master
+  this->Master = new sdiy::Master(sdiy::mpi::communicator(comm));
+  this->Blocks.resize(nblocks);
+
   vtkIdType offset = offsets[rank];
-  for (vtkIdType id=0; id<nblocks; id++)
+  for (vtkIdType iblock=offset; iblock<offset+nblocks; iblock++)
     {
-    vtkImageData* dataset = datasets[id].GetPointer();
-    vtkImageData* ghosted = vtkImageData::New();
-    ghosted->SetExtent(&ghostedExtents[(id+offset)*6]);
-    vtkDataSetAttributes* cd = dataset->GetCellData();
-    vtkDataSetAttributes* gcd = ghosted->GetCellData();
-    gcd->CopyAllocate(cd, ghosted->GetNumberOfCells());
-
-    int numArrays = gcd->GetNumberOfArrays();
-
-    int ext[6], gExt[6];
-    dataset->GetExtent(ext);
-    ghosted->GetExtent(gExt);
-    for (int i=0; i<3; i++)
+    GhostBlock &b = this->Blocks[iblock - offset];
+    b.Data = datasets[iblock - offset];
+    memcpy(b.Extent, &allExtents[iblock*6], 6*sizeof(int));
+    memcpy(b.GhostedExtent, &ghostedExtents[iblock*6], 6*sizeof(int));
+
+    sdiy::Link* link = new sdiy::Link;
+
+    int nNeighbors = sgc->GetNumberOfNeighbors(iblock);
+    b.Neighbors.resize(nNeighbors);
+    for (int j=0; j<nNeighbors; j++)
       {
-      ext[2*i+1]--;
-      gExt[2*i+1]--;
+      vtkStructuredNeighbor neighborInfo = sgc->GetGridNeighbor(iblock, j);
+      vtkIdType id = neighborInfo.NeighborID;
+
+      GhostNeighbor &n = b.Neighbors[j];
+      n.Id.gid = id;
+      n.Id.proc = blockToRank[id];
+
+      // the part of this block that the neighbor needs
+      memcpy(n.SendExtent, neighborInfo.OverlapExtent, 6*sizeof(int));
+      vtkStructuredExtent::Clamp(n.SendExtent, b.Extent);
+
+      // the part of the neighbor that this block needs, as the neighbor
+      // computes it
+      int nn = sgc->GetNumberOfNeighbors(id);
+      for (int q = 0; q < nn; ++q)
+        {
+        vtkStructuredNeighbor back = sgc->GetGridNeighbor(id, q);
+        if (back.NeighborID == iblock)
+          {
+          memcpy(n.RecvExtent, back.OverlapExtent, 6*sizeof(int));
+          vtkStructuredExtent::Clamp(n.RecvExtent, &allExtents[id*6]);
+          break;
+          }
+        }
+
+      link->add_neighbor(n.Id);
       }
-    gcd->CopyStructuredData(cd, ext, gExt, false);
-    for (int i=0; i<numArrays; i++)
+
+    this->Master->add(iblock, &b, link);
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+int VTKmContourAnalysis::InternalsType::UpdateGhostedBlocks()
+{
+  size_t nblocks = this->Blocks.size();
+  for (size_t i = 0; i < nblocks; ++i)
+    {
+    GhostBlock &b = this->Blocks[i];
+    vtkDataSetAttributes *cd = b.Data->GetCellData();
+
+    // the arrays passed in by the simulation. the ghost array is
+    // generated below
+    std::vector<vtkDataArray*> arrays;
+    int nArrays = cd->GetNumberOfArrays();
+    for (int j = 0; j < nArrays; ++j)
       {
-      gcd->GetAbstractArray(i)->SetNumberOfTuples(ghosted->GetNumberOfCells());
+      vtkDataArray *da = cd->GetArray(j);
+      if (da && strcmp(da->GetName(), "vtkGhostType"))
+        arrays.push_back(da);
       }
-    ghostedDatasets[id].TakeReference(ghosted);
-    }
 
-  vtkMPICommunicator *vtkcomm = vtkMPICommunicator::SafeDownCast(
-    contr->GetCommunicator());
-  sdiy::mpi::communicator comm(*vtkcomm->GetMPIComm()->GetHandle());
+    // the ghosted block is kept while the arrays are the same
+    bool same = b.Ghosted && (arrays.size() == b.Arrays.size());
+    for (size_t j = 0; same && (j < arrays.size()); ++j)
+      {
+      same = (arrays[j]->GetDataType() == b.Arrays[j]->GetDataType()) &&
+        (arrays[j]->GetNumberOfComponents() == b.Arrays[j]->GetNumberOfComponents()) &&
+        !strcmp(arrays[j]->GetName(), b.Arrays[j]->GetName());
+      }
 
-  sdiy::Master master(comm);
+    if (!same)
+      {
+      b.Ghosted = vtkSmartPointer<vtkImageData>::New();
+      b.Ghosted->SetExtent(b.GhostedExtent);
+      b.Arrays.clear();
 
-  std::vector<Block> blocks;
-  blocks.reserve(nblocks);
+      vtkIdType nCells = b.Ghosted->GetNumberOfCells();
+      for (size_t j = 0; j < arrays.size(); ++j)
+        {
+        vtkDataArray *ga = vtkDataArray::CreateDataArray(arrays[j]->GetDataType());
+        ga->SetName(arrays[j]->GetName());
+        ga->SetNumberOfComponents(arrays[j]->GetNumberOfComponents());
+        ga->SetNumberOfTuples(nCells);
+        b.Ghosted->GetCellData()->AddArray(ga);
+        b.Arrays.push_back(ga);
+        ga->Delete();
+        }
 
-  // Setup the blocks for DIY.
-  for (vtkIdType iblock=offset; iblock<offset+nblocks; iblock++)
-    {
-    vtkIdType myBlock = iblock - offset;
-    blocks[myBlock] = Block(&localExtents[myBlock*6], nGhosts, datasets[myBlock], ghostedDatasets[myBlock], sgc.GetPointer());
+      // We need ghost cell information so that ghost cells
+      // can be ignored in post processing.
+      b.Ghosted->GenerateGhostArray(b.Extent, true);
+      }
 
-    sdiy::Link* link = new sdiy::Link;
+    // copy the block's own cells
+    int cext[6];
+    int gext[6];
+    cellExtent(b.Extent, cext);
+    cellExtent(b.GhostedExtent, gext);
 
-    std::map<vtkIdType, vtkStructuredNeighbor>* ns =
-      new std::map<vtkIdType, vtkStructuredNeighbor>;
-    blocks[myBlock].Neighbors = ns;
+    for (size_t j = 0; j < arrays.size(); ++j)
+      {
+      size_t tb = arrays[j]->GetNumberOfComponents()*arrays[j]->GetDataTypeSize();
+      size_t nCells = numberOfCells(cext);
 
-    int nNeighbors = sgc->GetNumberOfNeighbors(iblock);
-    for (int j=0; j<nNeighbors; j++)
+      std::vector<unsigned char> &tmp = b.RecvBuffer;
+      tmp.resize(nCells*tb);
+
+      copyCells(static_cast<unsigned char*>(arrays[j]->GetVoidPointer(0)),
+        cext, cext, tb, tmp.data(), true);
+
+      copyCells(static_cast<unsigned char*>(b.Arrays[j]->GetVoidPointer(0)),
+        gext, cext, tb, tmp.data(), false);
+
+      b.Arrays[j]->Modified();
+      }
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+// This method exchanges 2 layers of ghost cells between
+// blocks. The ghosted datasets are returned
+vtkSmartPointer<vtkMultiBlockDataSet>
+VTKmContourAnalysis::InternalsType::ExchangeGhosts(vtkDataObject* mesh)
+{
+  TimeEvent<128> mark("VTKmContourAnalysis::ExchangeGhosts");
+
+  vtkMultiBlockDataSet* mb = vtkMultiBlockDataSet::SafeDownCast(
+    mesh);
+  if (!mb)
+    {
+    return nullptr;
+    }
+
+  vtkSmartPointer<vtkCompositeDataIterator> iter;
+  iter.TakeReference(mb->NewIterator());
+
+  // Create a flat vector of datasets for simplicity.
+  std::vector<vtkImageData*> datasets;
+  iter->InitTraversal();
+  while (!iter->IsDoneWithTraversal())
+    {
+    vtkImageData* cur = vtkImageData::SafeDownCast(
+      iter->GetCurrentDataObject());
+    if (cur)
       {
-      vtkStructuredNeighbor neighborInfo =
-        sgc->GetGridNeighbor(iblock, j);
-      sdiy::BlockID  neighbor;
-      vtkIdType id = neighborInfo.NeighborID;
-      (*ns)[id] = neighborInfo;
-      neighbor.gid = id;
-      neighbor.proc = blockToRank[id];
-      link->add_neighbor(neighbor);
+      datasets.push_back(cur);
       }
-    master.add(iblock, &blocks[myBlock], link);
+    iter->GoToNextItem();
     }
 
+  if (this->UpdatePlan(datasets) || this->UpdateGhostedBlocks())
+    return nullptr;
+
   // Now exchange ghosts.
-  master.foreach<Block>(&SendGhosts);
-  master.exchange();
-  master.foreach<Block>(&ReceiveGhosts);
+  this->Master->foreach(&SendGhosts);
+  this->Master->exchange();
+  this->Master->foreach(&ReceiveGhosts);
 
   // Finalize the return data structure.
   vtkSmartPointer<vtkMultiBlockDataSet> ghosted =
     vtkSmartPointer<vtkMultiBlockDataSet>::New();
-  for (vtkIdType id=0; id<nblocks; id++)
+
+  size_t nblocks = this->Blocks.size();
+  for (size_t id = 0; id < nblocks; ++id)
     {
-    // We need ghost cell information so that ghost cells
-    // can be ignored in post processing.
-    ghostedDatasets[id]->GenerateGhostArray(datasets[id]->GetExtent(), true);
+    this->Blocks[id].Ghosted->Modified();
+    ghosted->SetBlock(id, this->Blocks[id].Ghosted);
 
-    ghosted->SetBlock(id, ghostedDatasets[id]);
+    // the simulation's block is only valid during this step
+    this->Blocks[id].Data = nullptr;
     }
+
   return ghosted;
 }
 
@@ -382,15 +592,23 @@ bool VTKmContourAnalysis::Execute(sensei::DataAdaptor* data)
     prev->Register(0);
     }
 
-  MPI_Comm comm = this->GetCommunicator();
-  vtkMPICommunicatorOpaqueComm ocomm(&comm);
-  vtkNew<vtkMPICommunicator> vtkComm;
-  vtkComm->InitializeExternal(&ocomm);
+  // the controller is made once and reused on later steps
+  if (!this->Internals->Controller)
+    {
+    MPI_Comm comm = this->GetCommunicator();
+    vtkMPICommunicatorOpaqueComm ocomm(&comm);
+    vtkNew<vtkMPICommunicator> vtkComm;
+    vtkComm->InitializeExternal(&ocomm);
+
+    vtkMPIController *con = vtkMPIController::New();
+    con->SetCommunicator(vtkComm.GetPointer());
+
+    this->Internals->Controller = con;
+    }
 
-  vtkNew<vtkMPIController> con;
-  con->SetCommunicator(vtkComm.GetPointer());
+  vtkMPIController *con = this->Internals->Controller;
 
-  vtkMultiProcessController::SetGlobalController(con.GetPointer());
+  vtkMultiProcessController::SetGlobalController(con);
 
   vtkDataObject* mesh = nullptr;
   if (data->GetMesh(this->MeshName, false, mesh))
@@ -408,7 +626,19 @@ bool VTKmContourAnalysis::Execute(sensei::DataAdaptor* data)
     }
 
   vtkSmartPointer<vtkMultiBlockDataSet> ghosted =
-    ExchangeGhosts(mesh, con.GetPointer());
+    this->Internals->ExchangeGhosts(mesh);
+
+  if (!ghosted)
+    {
+    SENSEI_ERROR("Failed to exchange ghost cells of mesh \""
+      << this->MeshName << "\"")
+    if (prev)
+      {
+      vtkMultiProcessController::SetGlobalController(prev);
+      prev->UnRegister(0);
+      }
+    return false;
+    }
 
   vtkNew<vtkmAverageToPoints> cell2Point;
   cell2Point->SetInputDataObject(0, ghosted.GetPointer());
@@ -448,11 +678,26 @@ bool VTKmContourAnalysis::Execute(sensei::DataAdaptor* data)
 
     if (this->WriteOutput)
       {
+      // reduce the contours before they are written
+      vtkSmartPointer<vtkCompositeDataSet> reduced = outputCD;
+      if (this->Internals->Reducer.Enabled())
+        {
+        vtkCompositeDataSet *rcd = nullptr;
+        if (this->Internals->Reducer.Execute(this->GetCommunicator(), outputCD, rcd))
+          {
+          SENSEI_ERROR("Failed to reduce the contours, they are written as is")
+          }
+        else
+          {
+          reduced.TakeReference(rcd);
+          }
+        }
+
       std::stringstream fname;
       fname << "contour" << data->GetDataTimeStep() << ".vtm";
 
       vtkNew<vtkXMLPMultiBlockDataWriter> writer;
-      writer->SetInputData(outputCD);
+      writer->SetInputData(reduced);
       writer->SetDataModeToAppended();
       writer->EncodeAppendedDataOff();
       writer->SetCompressorTypeToNone();
@@ -467,6 +712,11 @@ bool VTKmContourAnalysis::Execute(sensei::DataAdaptor* data)
     vtkMultiProcessController::SetGlobalController(prev);
     prev->UnRegister(0);
     }
+  else
+    {
+    // the cached controller must not outlive Finalize as the global one
+    vtkMultiProcessController::SetGlobalController(nullptr);
+    }
 
   return true;
 }
@@ -474,6 +724,8 @@ bool VTKmContourAnalysis::Execute(sensei::DataAdaptor* data)
 //-----------------------------------------------------------------------------
 int VTKmContourAnalysis::Finalize()
 {
+  delete this->Internals;
+  this->Internals = new InternalsType;
   return 0;
 }
 
@@ -9,6 +9,7 @@ class vtkDataArray;
 
 namespace sensei
 {
+class PolyDataReducer;
 
 /// @class VTKmContourAnalysis
 /// @brief sensei::VTKmContourAnalysis is a AnalysisAdaptor specialization for contouring.
@@ -22,6 +23,11 @@ public:
   void Initialize(const std::string& meshName, const std::string& arrayname,
     double value, bool writeOutput);
 
+  // set how the contours are reduced, merging points, decimating and
+  // quantizing, before they are written. see PolyDataReducer. The default
+  // does not reduce them
+  void SetReducer(const PolyDataReducer &reducer);
+
   bool Execute(sensei::DataAdaptor* data) override;
 
   int Finalize() override;
@@ -35,6 +41,10 @@ protected:
   double Value;
   bool WriteOutput;
 
+  // the controller and the ghost exchange plan, reused between steps
+  struct InternalsType;
+  InternalsType *Internals;
+
 private:
   VTKmContourAnalysis(const VTKmContourAnalysis&);
   void operator=(const VTKmContourAnalysis&);
@@ -0,0 +1,87 @@
+#include "VTKmDataCache.h"
+#include "DataAdaptor.h"
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace sensei
+{
+
+namespace
+{
+using Key = std::tuple<std::string, int, std::string, int>;
+
+struct CacheState
+{
+  CacheState() : Adaptor(nullptr), Step(-1) {}
+
+  DataAdaptor* Adaptor;
+  long Step;
+  std::map<Key, vtkm::cont::Field> Fields;
+  std::mutex Mutex;
+};
+
+CacheState& GetState()
+{
+  static CacheState state;
+  return state;
+}
+}
+
+//-----------------------------------------------------------------------------
+void VTKmDataCache::Update(DataAdaptor* data)
+{
+  CacheState& state = GetState();
+  long step = data ? data->GetDataTimeStep() : -1;
+
+  std::lock_guard<std::mutex> lock(state.Mutex);
+  if (data != state.Adaptor || step != state.Step)
+  {
+    state.Fields.clear();
+    state.Adaptor = data;
+    state.Step = step;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void VTKmDataCache::SetField(
+  const std::string& meshName, int blockId, const vtkm::cont::Field& field)
+{
+  CacheState& state = GetState();
+  Key key(meshName, blockId, field.GetName(), int(field.GetAssociation()));
+
+  std::lock_guard<std::mutex> lock(state.Mutex);
+  state.Fields[key] = field;
+}
+
+//-----------------------------------------------------------------------------
+bool VTKmDataCache::GetField(const std::string& meshName, int blockId,
+  const std::string& fieldName, vtkm::cont::Field::Association assoc, vtkm::cont::Field& field)
+{
+  CacheState& state = GetState();
+  Key key(meshName, blockId, fieldName, int(assoc));
+
+  std::lock_guard<std::mutex> lock(state.Mutex);
+  auto it = state.Fields.find(key);
+  if (it == state.Fields.end())
+  {
+    return false;
+  }
+
+  field = it->second;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void VTKmDataCache::Clear()
+{
+  CacheState& state = GetState();
+
+  std::lock_guard<std::mutex> lock(state.Mutex);
+  state.Fields.clear();
+  state.Adaptor = nullptr;
+  state.Step = -1;
+}
+
+}
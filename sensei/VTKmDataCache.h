@@ -0,0 +1,46 @@
+#ifndef sensei_VTKmDataCache_h
+#define sensei_VTKmDataCache_h
+
+#include <vtkm/cont/Field.h>
+
+#include <string>
+
+namespace sensei
+{
+class DataAdaptor;
+
+/// @class VTKmDataCache
+/// @brief shares VTK-m fields among the VTK-m analyses of a step.
+///
+/// An array handle keeps its copy of the data on the device once it is
+/// used there. Analyses that place the fields they convert in the cache let
+/// the analyses that follow in the same step find the copy already on the
+/// device instead of converting and transferring the array again. Fields are
+/// identified by mesh, block, name and association.
+///
+/// Simulations that compute with VTK-m may place their own fields in the
+/// cache before calling the analyses, data that lives on the device then
+/// reaches the analyses without a round trip through the host. The entries
+/// are released when the cache is updated for a different data adaptor or
+/// time step.
+class VTKmDataCache
+{
+public:
+  /// release the entries unless they were made for this step of this data
+  /// adaptor
+  static void Update(DataAdaptor* data);
+
+  /// add a field, replacing one with the same name and association
+  static void SetField(const std::string& meshName, int blockId, const vtkm::cont::Field& field);
+
+  /// get a field. returns false if it has not been added in this step
+  static bool GetField(const std::string& meshName, int blockId, const std::string& fieldName,
+    vtkm::cont::Field::Association assoc, vtkm::cont::Field& field);
+
+  /// release all entries
+  static void Clear();
+};
+
+}
+
+#endif
@@ -0,0 +1,575 @@
+#include "VTKmHistogramAnalysis.h"
+
+#include "DataAdaptor.h"
+#include "MeshMetadataMap.h"
+#include "VTKHistogram.h"
+#include "VTKmDataCache.h"
+#include "VTKUtils.h"
+#include <Profiler.h>
+#include <Error.h>
+
+#include <vtkCellData.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkDataSet.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+// --- vtkm ---
+#include <vtkm/Math.h>
+#include <vtkm/cont/Algorithm.h>
+#include <vtkm/cont/ArrayCopy.h>
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayHandleConstant.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/WorkletMapField.h>
+
+namespace
+{
+// the min, max, count, sum and sum of squares of a set of values
+using Statistics = vtkm::Vec<vtkm::Float64, 5>;
+
+VTKM_EXEC_CONT
+Statistics EmptyStatistics()
+{
+  return Statistics(vtkm::Infinity64(), vtkm::NegativeInfinity64(), 0.0, 0.0, 0.0);
+}
+
+struct CombineStatistics
+{
+  VTKM_EXEC_CONT
+  Statistics operator()(const Statistics& a, const Statistics& b) const
+  {
+    return Statistics(vtkm::Min(a[0], b[0]), vtkm::Max(a[1], b[1]), a[2] + b[2], a[3] + b[3],
+      a[4] + b[4]);
+  }
+};
+
+// the statistics of a contiguous chunk of values. working on chunks keeps
+// the temporary to one entry per chunk rather than one per value
+struct ChunkStatistics : public vtkm::worklet::WorkletMapField
+{
+  typedef void ControlSignature(FieldIn<> chunk, WholeArrayIn<> values, WholeArrayIn<> ghosts,
+    FieldOut<> stats);
+
+  typedef _4 ExecutionSignature(_1, _2, _3);
+
+  ChunkStatistics(vtkm::Id numberOfValues, vtkm::Id chunkSize)
+    : NumberOfValues(numberOfValues)
+    , ChunkSize(chunkSize)
+  {
+  }
+
+  template <typename ValuePortal, typename GhostPortal>
+  VTKM_EXEC Statistics operator()(
+    vtkm::Id chunk, const ValuePortal& values, const GhostPortal& ghosts) const
+  {
+    Statistics stats = EmptyStatistics();
+
+    vtkm::Id i0 = chunk * this->ChunkSize;
+    vtkm::Id i1 = vtkm::Min(i0 + this->ChunkSize, this->NumberOfValues);
+    for (vtkm::Id i = i0; i < i1; ++i)
+    {
+      if (ghosts.Get(i))
+      {
+        continue;
+      }
+
+      vtkm::Float64 value = static_cast<vtkm::Float64>(values.Get(i));
+      stats[0] = vtkm::Min(stats[0], value);
+      stats[1] = vtkm::Max(stats[1], value);
+      stats[2] += 1.0;
+      stats[3] += value;
+      stats[4] += value * value;
+    }
+
+    return stats;
+  }
+
+  vtkm::Id NumberOfValues;
+  vtkm::Id ChunkSize;
+};
+
+// count the values in each bin. values at or beyond the ends of the range
+// are clamped into the first and last bins, as in VTKHistogram
+struct BinValues : public vtkm::worklet::WorkletMapField
+{
+  typedef void ControlSignature(FieldIn<> values, FieldIn<> ghosts, AtomicArrayInOut<> hist);
+
+  typedef void ExecutionSignature(_1, _2, _3);
+
+  BinValues(vtkm::Float64 min, vtkm::Float64 width, vtkm::Id bins)
+    : Min(min)
+    , Width(width)
+    , MaxBin(static_cast<vtkm::Float64>(bins - 1))
+  {
+  }
+
+  template <typename T, typename AtomicArray>
+  VTKM_EXEC void operator()(const T& value, vtkm::UInt8 ghost, const AtomicArray& hist) const
+  {
+    if (ghost)
+    {
+      return;
+    }
+
+    vtkm::Float64 bin = (static_cast<vtkm::Float64>(value) - this->Min) / this->Width;
+    hist.Add(static_cast<vtkm::Id>(vtkm::Min(vtkm::Max(0.0, bin), this->MaxBin)), 1);
+  }
+
+  vtkm::Float64 Min;
+  vtkm::Float64 Width;
+  vtkm::Float64 MaxBin;
+};
+
+const vtkm::Id chunkSize = 4096;
+
+// compute the statistics of a block on the device
+template <typename GhostHandle>
+Statistics ComputeStatistics(
+  const vtkm::cont::ArrayHandle<vtkm::Float64>& values, const GhostHandle& ghosts)
+{
+  vtkm::Id n = values.GetNumberOfValues();
+  vtkm::Id nChunks = (n + chunkSize - 1) / chunkSize;
+
+  vtkm::cont::ArrayHandle<Statistics> chunks;
+  vtkm::worklet::DispatcherMapField<ChunkStatistics> dispatcher(ChunkStatistics(n, chunkSize));
+  dispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), vtkm::Id(1), nChunks),
+    values, ghosts, chunks);
+
+  return vtkm::cont::Algorithm::Reduce(chunks, EmptyStatistics(), CombineStatistics());
+}
+
+// bin a block on the device
+template <typename GhostHandle>
+void ComputeHistogram(const vtkm::cont::ArrayHandle<vtkm::Float64>& values,
+  const GhostHandle& ghosts, const double range[2], int bins,
+  vtkm::cont::ArrayHandle<vtkm::Int64>& hist)
+{
+  double width = (range[1] - range[0]) / bins;
+
+  // place everything in the first bin when the range is empty
+  if (!(width > 0.0))
+  {
+    width = std::numeric_limits<double>::infinity();
+  }
+
+  vtkm::worklet::DispatcherMapField<BinValues> dispatcher(BinValues(range[0], width, bins));
+  dispatcher.Invoke(values, ghosts, hist);
+}
+
+// copy the values of a single component array as doubles
+template <typename T>
+void CopyValues(vtkDataArray* array, const T* values, std::vector<double>& out)
+{
+  vtkIdType n = array->GetNumberOfTuples();
+  out.resize(n);
+  if (values)
+  {
+    std::copy(values, values + n, out.begin());
+  }
+  else
+  {
+    for (vtkIdType i = 0; i < n; ++i)
+    {
+      out[i] = array->GetComponent(i, 0);
+    }
+  }
+}
+}
+
+namespace sensei
+{
+
+//-----------------------------------------------------------------------------
+senseiNewMacro(VTKmHistogramAnalysis);
+
+//-----------------------------------------------------------------------------
+VTKmHistogramAnalysis::VTKmHistogramAnalysis()
+  : FieldAssoc(vtkm::cont::Field::Association::POINTS)
+  , Bins(10)
+  , Internals(nullptr)
+  , Count(0)
+  , Mean(0.0)
+  , StdDev(0.0)
+{
+}
+
+//-----------------------------------------------------------------------------
+VTKmHistogramAnalysis::~VTKmHistogramAnalysis()
+{
+  delete this->Internals;
+}
+
+//-----------------------------------------------------------------------------
+void VTKmHistogramAnalysis::Initialize(const std::string& meshName,
+  const std::string& fieldName, const std::string& fieldAssoc, int bins,
+  const std::string& fileName)
+{
+  this->MeshName = meshName;
+  this->FieldName = fieldName;
+  this->FieldAssoc = fieldAssoc == "cell" ?
+    vtkm::cont::Field::Association::CELL_SET :
+    vtkm::cont::Field::Association::POINTS;
+  this->Bins = bins;
+  this->FileName = fileName;
+}
+
+//-----------------------------------------------------------------------------
+int VTKmHistogramAnalysis::GetBlock(vtkDataObject* dobj, int blockId,
+  vtkm::cont::ArrayHandle<vtkm::Float64>& values,
+  vtkm::cont::ArrayHandle<vtkm::UInt8>& ghosts)
+{
+  values = vtkm::cont::ArrayHandle<vtkm::Float64>();
+  ghosts = vtkm::cont::ArrayHandle<vtkm::UInt8>();
+
+  vtkDataSet* ds = vtkDataSet::SafeDownCast(dobj);
+  if (!ds)
+  {
+    return 1;
+  }
+
+  vtkDataSetAttributes* dsa = this->FieldAssoc == vtkm::cont::Field::Association::POINTS ?
+    static_cast<vtkDataSetAttributes*>(ds->GetPointData()) :
+    static_cast<vtkDataSetAttributes*>(ds->GetCellData());
+
+  vtkUnsignedCharArray* ghostArray =
+    vtkUnsignedCharArray::SafeDownCast(dsa->GetArray("vtkGhostType"));
+  if (ghostArray)
+  {
+    ghosts = vtkm::cont::make_ArrayHandle(ghostArray->GetPointer(0),
+      ghostArray->GetNumberOfTuples());
+  }
+
+  // use the copy in the cache, it may already be on the device
+  vtkm::cont::Field cached;
+  bool haveCached =
+    VTKmDataCache::GetField(this->MeshName, blockId, this->FieldName, this->FieldAssoc, cached);
+  if (haveCached && cached.GetData().IsType<vtkm::cont::ArrayHandle<vtkm::Float64>>())
+  {
+    cached.GetData().CopyTo(values);
+  }
+  else if (haveCached && cached.GetData().IsType<vtkm::cont::ArrayHandle<vtkm::Float32>>())
+  {
+    vtkm::cont::ArrayHandle<vtkm::Float32> in;
+    cached.GetData().CopyTo(in);
+    vtkm::cont::ArrayCopy(in, values);
+  }
+  else if (this->ConvertArray(dsa->GetArray(this->FieldName.c_str()), blockId, values))
+  {
+    return -1;
+  }
+
+  vtkm::Id n = values.GetNumberOfValues();
+  if (!n)
+  {
+    return 1;
+  }
+
+  if (ghostArray && (ghostArray->GetNumberOfTuples() != n))
+  {
+    SENSEI_ERROR("The ghost array of block " << blockId << " has "
+      << ghostArray->GetNumberOfTuples() << " values, the array ""
+      << this->FieldName << "" has " << n);
+    return -1;
+  }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int VTKmHistogramAnalysis::ConvertArray(vtkDataArray* array, int blockId,
+  vtkm::cont::ArrayHandle<vtkm::Float64>& values)
+{
+  if (!array)
+  {
+    return 0;
+  }
+
+  if (array->GetNumberOfComponents() > 1)
+  {
+    SENSEI_ERROR("Cannot compute the histogram of multi-component array \""
+      << this->FieldName << "\"");
+    return -1;
+  }
+
+  // float and double arrays are wrapped and shared with the analyses that
+  // follow, others are converted on the host
+  vtkIdType n = array->GetNumberOfTuples();
+  vtkFloatArray* fa = vtkFloatArray::SafeDownCast(array);
+  vtkDoubleArray* da = vtkDoubleArray::SafeDownCast(array);
+  if (da)
+  {
+    values = vtkm::cont::make_ArrayHandle(da->GetPointer(0), n);
+    VTKmDataCache::SetField(this->MeshName, blockId,
+      vtkm::cont::Field(this->FieldName, this->FieldAssoc, values));
+  }
+  else if (fa)
+  {
+    vtkm::cont::ArrayHandle<vtkm::Float32> in = vtkm::cont::make_ArrayHandle(fa->GetPointer(0), n);
+    VTKmDataCache::SetField(this->MeshName, blockId,
+      vtkm::cont::Field(this->FieldName, this->FieldAssoc, in));
+    vtkm::cont::ArrayCopy(in, values);
+  }
+  else
+  {
+    if (blockId >= static_cast<int>(this->Buffers.size()))
+    {
+      this->Buffers.resize(blockId + 1);
+    }
+
+    std::vector<double>& buffer = this->Buffers[blockId];
+
+    bool inPlace = array->HasStandardMemoryLayout();
+    switch (array->GetDataType())
+    {
+      vtkTemplateMacro(
+        CopyValues(array, inPlace ? static_cast<VTK_TT*>(array->GetVoidPointer(0)) : nullptr,
+          buffer););
+    }
+
+    values = vtkm::cont::make_ArrayHandle(buffer);
+  }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+bool VTKmHistogramAnalysis::Execute(DataAdaptor* data)
+{
+  TimeEvent<128> mark("VTKmHistogramAnalysis::Execute");
+
+  MPI_Comm comm = this->GetCommunicator();
+
+  int step = data->GetDataTimeStep();
+  double time = data->GetDataTime();
+
+  VTKmDataCache::Update(data);
+
+  MeshMetadataFlags flags;
+  MeshMetadataMap mdMap;
+  MeshMetadataPtr mmd;
+  if (mdMap.Initialize(data, flags) || mdMap.GetMeshMetadata(this->MeshName, mmd))
+  {
+    SENSEI_ERROR("Failed to get metadata for mesh \"" << this->MeshName << "\"");
+    return false;
+  }
+
+  // errors are reported but processing continues so that all ranks take
+  // part in the reductions below
+  bool status = true;
+
+  vtkDataObject* dobj = nullptr;
+  if (data->GetMesh(this->MeshName, true, dobj))
+  {
+    SENSEI_ERROR("Failed to get mesh \"" << this->MeshName << "\"");
+    status = false;
+  }
+
+  int association = this->FieldAssoc == vtkm::cont::Field::Association::POINTS ?
+    vtkDataObject::POINT : vtkDataObject::CELL;
+
+  vtkCompositeDataSetPtr mesh;
+  if (dobj)
+  {
+    mesh = VTKUtils::AsCompositeData(comm, dobj, true);
+
+    if (((association == vtkDataObject::CELL) && (mmd->NumGhostCells || VTKUtils::AMR(mmd)) &&
+          data->AddGhostCellsArray(mesh, this->MeshName)) ||
+      ((association == vtkDataObject::POINT) && mmd->NumGhostNodes &&
+          data->AddGhostNodesArray(mesh, this->MeshName)))
+    {
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add ghosts.");
+      status = false;
+    }
+
+    if (data->AddArray(mesh, this->MeshName, association, this->FieldName))
+    {
+      SENSEI_ERROR(<< data->GetClassName() << " failed to add "
+        << VTKUtils::GetAttributesName(association) << " data array \""
+        << this->FieldName << "\"");
+      status = false;
+      mesh = nullptr;
+    }
+  }
+
+  // fetch the blocks onto the device, and compute their statistics there
+  Profiler::StartEvent("VTKm histogram statistics");
+
+  std::vector<vtkm::cont::ArrayHandle<vtkm::Float64>> values;
+  std::vector<vtkm::cont::ArrayHandle<vtkm::UInt8>> ghosts;
+  Statistics stats = EmptyStatistics();
+
+  if (mesh)
+  {
+    vtkSmartPointer<vtkCompositeDataIterator> iter;
+    iter.TakeReference(mesh->NewIterator());
+    iter->SetSkipEmptyNodes(0);
+
+    int blockId = 0;
+    for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem(), ++blockId)
+    {
+      vtkm::cont::ArrayHandle<vtkm::Float64> bv;
+      vtkm::cont::ArrayHandle<vtkm::UInt8> bg;
+
+      int ierr = this->GetBlock(iter->GetCurrentDataObject(), blockId, bv, bg);
+      if (ierr < 0)
+      {
+        status = false;
+      }
+      if (ierr)
+      {
+        continue;
+      }
+
+      Statistics bs = bg.GetNumberOfValues() ?
+        ComputeStatistics(bv, bg) :
+        ComputeStatistics(bv,
+          vtkm::cont::make_ArrayHandleConstant(vtkm::UInt8(0), bv.GetNumberOfValues()));
+
+      stats = CombineStatistics()(stats, bs);
+
+      values.push_back(bv);
+      ghosts.push_back(bg);
+    }
+  }
+
+  Profiler::EndEvent("VTKm histogram statistics");
+
+  // the range is reduced by VTKHistogram, the sums alongside it
+  delete this->Internals;
+  this->Internals = new VTKHistogram;
+
+  if (stats[2] > 0.0)
+  {
+    double range[2] = { stats[0], stats[1] };
+    this->Internals->AddRange(0, range);
+  }
+
+  this->Internals->PreCompute(comm, this->Bins);
+
+  double sums[3] = { stats[2], stats[3], stats[4] };
+  MPI_Allreduce(MPI_IN_PLACE, sums, 3, MPI_DOUBLE, MPI_SUM, comm);
+
+  this->Count = static_cast<long long>(sums[0]);
+  this->Mean = sums[0] > 0.0 ? sums[1] / sums[0] : 0.0;
+  this->StdDev = sums[0] > 0.0 ?
+    std::sqrt(std::max(0.0, sums[2] / sums[0] - this->Mean * this->Mean)) : 0.0;
+
+  // bin on the device, only the counts come back
+  Profiler::StartEvent("VTKm histogram");
+
+  double range[2];
+  this->Internals->GetRange(0, range);
+
+  vtkm::cont::ArrayHandle<vtkm::Int64> hist;
+  vtkm::cont::ArrayCopy(vtkm::cont::make_ArrayHandleConstant(vtkm::Int64(0), vtkm::Id(this->Bins)),
+    hist);
+
+  size_t nBlocks = values.size();
+  for (size_t i = 0; i < nBlocks; ++i)
+  {
+    if (ghosts[i].GetNumberOfValues())
+    {
+      ComputeHistogram(values[i], ghosts[i], range, this->Bins, hist);
+    }
+    else
+    {
+      ComputeHistogram(values[i],
+        vtkm::cont::make_ArrayHandleConstant(vtkm::UInt8(0), values[i].GetNumberOfValues()),
+        range, this->Bins, hist);
+    }
+  }
+
+  std::vector<unsigned int> lHist(this->Bins, 0);
+  auto portal = hist.GetPortalConstControl();
+  for (int i = 0; i < this->Bins; ++i)
+  {
+    lHist[i] = static_cast<unsigned int>(portal.Get(i));
+  }
+
+  this->Internals->AddHistogram(0, lHist);
+
+  Profiler::EndEvent("VTKm histogram");
+
+  std::vector<std::string> meshNames(1, this->MeshName);
+  std::vector<std::string> arrayNames(1, this->FieldName);
+  this->Internals->PostCompute(comm, this->Bins, step, time, meshNames, arrayNames, this->FileName);
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  if (rank == 0)
+  {
+    if (this->FileName.empty())
+    {
+      std::cout << "Statistics mesh \"" << this->MeshName << "\" data array \""
+        << this->FieldName << "\" step " << step << " time " << time << std::endl
+        << "count : " << this->Count << std::endl
+        << "range : " << range[0] << " " << range[1] << std::endl
+        << "mean : " << this->Mean << std::endl
+        << "std dev : " << this->StdDev << std::endl;
+    }
+    else
+    {
+      char fname[1024] = { '\0' };
+      snprintf(fname, 1024, "%s_%s_%s_%d_stats.txt", this->FileName.c_str(),
+        this->MeshName.c_str(), this->FieldName.c_str(), step);
+
+      FILE* file = fopen(fname, "w");
+      if (!file)
+      {
+        char* estr = strerror(errno);
+        SENSEI_ERROR("Failed to open \"" << fname << "\"" << std::endl << estr);
+        return false;
+      }
+
+      fprintf(file, "step : %d\n", step);
+      fprintf(file, "time : %0.6g\n", time);
+      fprintf(file, "count : %lld\n", this->Count);
+      fprintf(file, "range : %0.6g %0.6g\n", range[0], range[1]);
+      fprintf(file, "mean : %0.6g\n", this->Mean);
+      fprintf(file, "std dev : %0.6g\n", this->StdDev);
+      fclose(file);
+    }
+  }
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+int VTKmHistogramAnalysis::GetHistogram(double& min, double& max, std::vector<unsigned int>& bins)
+{
+  if (!this->Internals)
+  {
+    return -1;
+  }
+
+  return this->Internals->GetHistogram(this->GetCommunicator(), 0, min, max, bins);
+}
+
+//-----------------------------------------------------------------------------
+int VTKmHistogramAnalysis::GetStatistics(long long& count, double& mean, double& stdDev)
+{
+  count = this->Count;
+  mean = this->Mean;
+  stdDev = this->StdDev;
+  return 0;
+}
+
+}
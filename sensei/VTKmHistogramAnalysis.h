@@ -0,0 +1,86 @@
+#ifndef sensei_VTKmHistogramAnalysis_h
+#define sensei_VTKmHistogramAnalysis_h
+
+#include "AnalysisAdaptor.h"
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/Field.h>
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+class vtkDataObject;
+class vtkDataArray;
+
+namespace sensei
+{
+class VTKHistogram;
+
+/// @class VTKmHistogramAnalysis
+/// @brief the histogram and descriptive statistics of a field with VTK-m.
+///
+/// The range, count, mean and standard deviation of the field and its
+/// histogram are computed on the VTK-m device. Fields found in the
+/// VTKmDataCache, for instance placed there by a simulation computing on
+/// the GPU, are used where they are and only the per-block statistics and
+/// bin counts come back to the host. Other fields are wrapped, without a
+/// copy when they are float or double, and placed in the cache for the
+/// analyses that follow. Ghost values, marked by the vtkGhostType array,
+/// are skipped.
+///
+/// The local results are reduced as in VTKHistogram, and the histogram is
+/// written by VTKHistogram::PostCompute, so that the output is that of the
+/// Histogram analysis. The statistics are written next to it in a file
+/// named <file>_<mesh>_<array>_<step>_stats.txt or to cout.
+class VTKmHistogramAnalysis : public AnalysisAdaptor
+{
+public:
+  static VTKmHistogramAnalysis* New();
+  senseiTypeMacro(VTKmHistogramAnalysis, AnalysisAdaptor);
+
+  void Initialize(const std::string& meshName, const std::string& fieldName,
+    const std::string& fieldAssoc, int bins, const std::string& fileName);
+
+  bool Execute(DataAdaptor* data) override;
+
+  int Finalize() override { return 0; }
+
+  /// Get the results of the last step on rank 0.
+  int GetHistogram(double& min, double& max, std::vector<unsigned int>& bins);
+  int GetStatistics(long long& count, double& mean, double& stdDev);
+
+protected:
+  VTKmHistogramAnalysis();
+  ~VTKmHistogramAnalysis();
+
+  // get the values and ghost flags of a block on the device. returns 1
+  // when the block has no values and -1 on error
+  int GetBlock(vtkDataObject* dobj, int blockId,
+    vtkm::cont::ArrayHandle<vtkm::Float64>& values,
+    vtkm::cont::ArrayHandle<vtkm::UInt8>& ghosts);
+
+  // wrap or convert a VTK array, an empty handle is returned when there is
+  // no array
+  int ConvertArray(vtkDataArray* array, int blockId,
+    vtkm::cont::ArrayHandle<vtkm::Float64>& values);
+
+  std::string MeshName;
+  std::string FieldName;
+  vtkm::cont::Field::Association FieldAssoc;
+  int Bins;
+  std::string FileName;
+  VTKHistogram* Internals;
+  long long Count;
+  double Mean;
+  double StdDev;
+
+  // values converted on the host, kept across steps
+  std::vector<std::vector<double>> Buffers;
+
+private:
+  VTKmHistogramAnalysis(const VTKmHistogramAnalysis&);
+  void operator=(const VTKmHistogramAnalysis&);
+};
+
+}
+
+#endif
@@ -2,7 +2,9 @@
 
 #include "CinemaHelper.h"
 #include "DataAdaptor.h"
+#include "VTKmDataCache.h"
 #include <Profiler.h>
+#include <Error.h>
 
 #include <vtkCellData.h>
 #include <vtkFloatArray.h>
@@ -18,6 +20,7 @@
 #include <vtkSmartPointer.h>
 
 #include <algorithm>
+#include <sstream>
 #include <vector>
 
 // --- vtkm ---
@@ -184,12 +187,32 @@ public:
 };
 
 
+//-----------------------------------------------------------------------------
+// copy the values of a level back from VTK-m
+static void CopyLevel(const vtkm::cont::ArrayHandle<vtkm::Float32>& handle, const int* dimensions,
+  const std::string& name, vtkImageData* image)
+{
+  vtkm::Id size = handle.GetNumberOfValues();
+  auto portal = handle.GetPortalConstControl();
+  vtkNew<vtkFloatArray> dataArray;
+  dataArray->SetName(name.c_str());
+  dataArray->SetNumberOfTuples(size);
+  for (vtkm::Id i = 0; i < size; ++i)
+    {
+    dataArray->SetValue(i, portal.Get(i));
+    }
+
+  image->SetDimensions(dimensions[0], dimensions[1], dimensions[2]);
+  image->GetPointData()->SetScalars(dataArray);
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 senseiNewMacro(VTKmVolumeReductionAnalysis);
 
 //-----------------------------------------------------------------------------
-VTKmVolumeReductionAnalysis::VTKmVolumeReductionAnalysis() : Communicator(MPI_COMM_WORLD), Helper(NULL)
+VTKmVolumeReductionAnalysis::VTKmVolumeReductionAnalysis() : Communicator(MPI_COMM_WORLD), Helper(NULL),
+  EncoderThreads(0), Reduction(0), Pyramid(false)
 {
 }
 
@@ -227,6 +250,27 @@ void VTKmVolumeReductionAnalysis::Initialize(
   this->Helper = new CinemaHelper();
   this->Helper->SetWorkingDirectory(workingDirectory);
   this->Helper->SetExportType("vtk-volume");
+  this->Helper->SetNumberOfEncoderThreads(this->EncoderThreads);
+}
+
+//-----------------------------------------------------------------------------
+void VTKmVolumeReductionAnalysis::SetNumberOfEncoderThreads(int n)
+{
+  this->EncoderThreads = n;
+  if (this->Helper)
+    {
+    this->Helper->SetNumberOfEncoderThreads(n);
+    }
+}
+
+//-----------------------------------------------------------------------------
+int VTKmVolumeReductionAnalysis::Finalize()
+{
+  if (this->Helper)
+    {
+    this->Helper->Flush();
+    }
+  return 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -248,17 +292,24 @@ bool VTKmVolumeReductionAnalysis::Execute(DataAdaptor* data)
 
   vtkMultiBlockDataSet* blocks = vtkMultiBlockDataSet::SafeDownCast(mesh);
   vtkImageData* originalImageData = nullptr;
+  int blockId = -1;
   for(unsigned int i = 0; i < blocks->GetNumberOfBlocks(); i++)
     {
     vtkImageData* block = vtkImageData::SafeDownCast(blocks->GetBlock(i));
-    originalImageData = block ? block : originalImageData;
+    if (block)
+      {
+      originalImageData = block;
+      blockId = i;
+      }
     }
   if (originalImageData == nullptr) {
     return true;
   }
 
+  VTKmDataCache::Update(data);
+
   vtkNew<vtkImageData> outputDataSet;
-  if (this->Reduction > 0)
+  if (this->Reduction > 0 || this->Pyramid)
     {
     Profiler::StartEvent("VTKm reduction");
 
@@ -268,18 +319,57 @@ bool VTKmVolumeReductionAnalysis::Execute(DataAdaptor* data)
     dimensions[1]--; // cell data to point data
     dimensions[2]--; // cell data to point data
 
-    vtkNew<vtkFloatArray> dataArray;
-    dataArray->ShallowCopy(vtkFloatArray::SafeDownCast(originalImageData->GetCellData()->GetScalars()));
-    vtkm::cont::ArrayHandle<vtkm::Float32> vtkmArray;
-    for (int step = 0 ; step < this->Reduction; step++)
+    vtkFloatArray* inArray = vtkFloatArray::SafeDownCast(originalImageData->GetCellData()->GetScalars());
+    if (!inArray)
+      {
+      SENSEI_ERROR("The cell scalars of mesh \"" << this->MeshName << "\" are not float");
+      Profiler::EndEvent("VTKm reduction");
+      return false;
+      }
+    std::string arrayName = inArray->GetName() ? inArray->GetName() : this->FieldName;
+
+    // use the copy in the cache, it may already be on the device. otherwise
+    // wrap the array and share it with the analyses that follow
+    vtkm::cont::ArrayHandle<vtkm::Float32> handle;
+    vtkm::cont::Field cached;
+    if (VTKmDataCache::GetField(this->MeshName, blockId, arrayName, this->FieldAssoc, cached) &&
+      cached.GetData().IsType<vtkm::cont::ArrayHandle<vtkm::Float32>>())
+      {
+      cached.GetData().CopyTo(handle);
+      }
+    else
+      {
+      handle = vtkm::cont::make_ArrayHandle(inArray->GetPointer(0),
+        vtkm::Id(dimensions[0]) * dimensions[1] * dimensions[2]);
+      VTKmDataCache::SetField(this->MeshName, blockId,
+        vtkm::cont::Field(arrayName, this->FieldAssoc, handle));
+      }
+
+    // the levels are computed on the device, only the last comes back.
+    // a pyramid has all levels down to a single voxel in one dimension, each
+    // is written as soon as it is computed
+    int nLevels = this->Reduction;
+    if (this->Pyramid)
       {
-      // Data preparation
-      float* inFloat = dataArray->GetPointer(0);
-      int size = dimensions[0] * dimensions[1] * dimensions[2];
+      nLevels = 0;
+      while (((dimensions[0] >> nLevels) > 1) && ((dimensions[1] >> nLevels) > 1) &&
+        ((dimensions[2] >> nLevels) > 1))
+        {
+        ++nLevels;
+        }
 
+      Profiler::StartEvent("Cinema Volume export");
+      vtkNew<vtkImageData> level;
+      level->SetDimensions(dimensions[0], dimensions[1], dimensions[2]);
+      level->GetPointData()->SetScalars(inArray);
+      this->Helper->WriteVolume(level.GetPointer(), "volume_0");
+      Profiler::EndEvent("Cinema Volume export");
+      }
+
+    for (int step = 0 ; step < nLevels; step++)
+      {
       // --- vtk-m filtering ---
       // - create vtkm dataset
-      vtkm::cont::ArrayHandle<vtkm::Float32> handle = vtkm::cont::make_ArrayHandle(inFloat, size);
       vtkm::cont::DataSetBuilderUniform builder;
       vtkm::cont::DataSet dataset = builder.Create(vtkm::Id3(dimensions[0], dimensions[1], dimensions[2]));
       vtkm::cont::Field scalarField(this->FieldName, this->FieldAssoc, handle);
@@ -291,22 +381,34 @@ bool VTKmVolumeReductionAnalysis::Execute(DataAdaptor* data)
       filter.SetField(this->FieldAssoc, this->FieldName);
       auto rdata = filter.Execute(dataset, ImageReductionPolicy());
 
-      // - recover data from vtkm
-      rdata.GetField(this->FieldName, this->FieldAssoc).GetData().CopyTo(vtkmArray);
-      float* t = vtkmArray.GetStorage().GetArray();
+      // - the next level's input
+      vtkm::cont::ArrayHandle<vtkm::Float32> reduced;
+      rdata.GetField(this->FieldName, this->FieldAssoc).GetData().CopyTo(reduced);
+      handle = reduced;
 
-      // - rebuild regular vtkImageData
-      int newDims[3] = { int(dimensions[0] / 2), int(dimensions[1] / 2), int(dimensions[2] / 2) };
-      int reducedSize = newDims[0] * newDims[1] * newDims[2];
+      // Update dimensions
+      dimensions[0] /= 2;
+      dimensions[1] /= 2;
+      dimensions[2] /= 2;
+
+      if (this->Pyramid)
+        {
+        Profiler::StartEvent("Cinema Volume export");
+        vtkNew<vtkImageData> level;
+        CopyLevel(handle, dimensions, arrayName, level.GetPointer());
+
+        std::ostringstream levelName;
+        levelName << "volume_" << step + 1;
+        this->Helper->WriteVolume(level.GetPointer(), levelName.str());
+        Profiler::EndEvent("Cinema Volume export");
+        }
+      }
 
-      // Update dimensions and array
-      dimensions[0] = newDims[0];
-      dimensions[1] = newDims[1];
-      dimensions[2] = newDims[2];
-      dataArray->SetArray(t, reducedSize, 1);
+    // - recover data from vtkm
+    if (!this->Pyramid)
+      {
+      CopyLevel(handle, dimensions, arrayName, outputDataSet.GetPointer());
       }
-    outputDataSet->SetDimensions(dimensions[0], dimensions[1], dimensions[2]);
-    outputDataSet->GetPointData()->SetScalars(dataArray);
     Profiler::EndEvent("VTKm reduction");
     }
   else
@@ -323,7 +425,13 @@ bool VTKmVolumeReductionAnalysis::Execute(DataAdaptor* data)
   // -----------------------
 
   Profiler::StartEvent("Cinema Volume export");
-  this->Helper->WriteVolume(outputDataSet.GetPointer());
+  if (!this->Pyramid)
+    {
+    this->Helper->WriteVolume(outputDataSet.GetPointer());
+    }
+  // the levels written while the next ones were computed reference the
+  // simulation's array, they must be complete before returning
+  this->Helper->Flush();
   this->Helper->WriteMetadata();
   Profiler::EndEvent("Cinema Volume export");
 
@@ -23,9 +23,21 @@ public:
     int reductionFactor,
     MPI_Comm comm);
 
+  /// When set every level of the power of two pyramid, down to a single
+  /// voxel in one dimension, is computed in one pass and each is written as
+  /// soon as it is complete. The reduction factor is then ignored.
+  void SetPyramid(bool pyramid) { this->Pyramid = pyramid; }
+  bool GetPyramid() const { return this->Pyramid; }
+
+  /// The number of threads writing the Cinema files in the background, see
+  /// CinemaHelper::SetNumberOfEncoderThreads. The files of a step are
+  /// complete when Execute returns. The default, 0, writes on the calling
+  /// thread.
+  void SetNumberOfEncoderThreads(int n);
+
   bool Execute(DataAdaptor* data) override;
 
-  int Finalize() override { return 0; }
+  int Finalize() override;
 
 protected:
   VTKmVolumeReductionAnalysis();
@@ -36,7 +48,9 @@ protected:
   vtkm::cont::Field::Association FieldAssoc;
   MPI_Comm Communicator;
   CinemaHelper* Helper;
+  int EncoderThreads;
   int Reduction;
+  bool Pyramid;
 
 private:
   VTKmVolumeReductionAnalysis(const VTKmVolumeReductionAnalysis&);
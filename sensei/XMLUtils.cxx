@@ -1,8 +1,11 @@
 #include "XMLUtils.h"
 #include "Error.h"
+#include "BinaryStream.h"
+#include "Profiler.h"
 
 #include <pugixml.hpp>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <errno.h>
@@ -37,58 +40,79 @@ int RequireChild(const pugi::xml_node &node, const char *childName)
 }
 
 //----------------------------------------------------------------------------
-int Parse(MPI_Comm comm, const std::string &filename, pugi::xml_document &doc)
+int ReadFile(MPI_Comm comm, const std::string &filename,
+  std::vector<char> &contents)
 {
+  TimeEvent<128> mark("XMLUtils::ReadFile");
+
   int rank = 0;
   MPI_Comm_rank(comm, &rank);
 
-  unsigned long nbytes = 0;
-  char *buffer = nullptr;
+  // the stream holds a status flag followed by the file's contents. rank 0
+  // reads directly into the stream
+  BinaryStream bs;
   if (rank == 0)
     {
+    int status = -1;
+    long nbytes = 0;
+
     FILE *f = fopen(filename.c_str(), "rb");
     if (f)
       {
-      setvbuf(f, nullptr, _IONBF, 0);
       fseek(f, 0, SEEK_END);
       nbytes = ftell(f);
       fseek(f, 0, SEEK_SET);
-      buffer = static_cast<char*>(pugi::get_memory_allocation_function()(nbytes));
-      unsigned long nread = fread(buffer, 1, nbytes, f);
-      fclose(f);
-      if (nread == nbytes)
+
+      bs.Reserve(sizeof(int) + std::max(nbytes, 0l));
+      bs.Pack(status);
+
+      if ((nbytes >= 0) &&
+        (long(fread(bs.GetData() + sizeof(int), 1, nbytes, f)) == nbytes))
         {
-        MPI_Bcast(&nbytes, 1, MPI_UNSIGNED_LONG, 0, comm);
-        MPI_Bcast(buffer, nbytes, MPI_CHAR, 0, comm);
+        status = 0;
+        bs.SetWritePos(sizeof(int) + nbytes);
         }
       else
         {
         SENSEI_ERROR("read error on \""  << filename << "\"" << endl << strerror(errno))
-        nbytes = 0;
-        MPI_Bcast(&nbytes, 1, MPI_UNSIGNED_LONG, 0, comm);
-        return -1;
         }
+
+      fclose(f);
       }
     else
       {
       SENSEI_ERROR("failed to open \""  << filename << "\"" << endl << strerror(errno))
-      MPI_Bcast(&nbytes, 1, MPI_UNSIGNED_LONG, 0, comm);
-      return -1;
+      bs.Pack(status);
       }
+
+    *reinterpret_cast<int*>(bs.GetData()) = status;
     }
-  else
-    {
-    MPI_Bcast(&nbytes, 1, MPI_UNSIGNED_LONG, 0, comm);
-    if (!nbytes)
-      return -1;
-    buffer = static_cast<char*>(pugi::get_memory_allocation_function()(nbytes));
-    MPI_Bcast(buffer, nbytes, MPI_CHAR, 0, comm);
-    }
 
-  pugi::xml_parse_result result = doc.load_buffer_inplace_own(buffer, nbytes);
+  bs.Broadcast(comm, 0);
+
+  int status = -1;
+  if (bs.Size() >= sizeof(int))
+    bs.Unpack(status);
+
+  if (status)
+    return -1;
+
+  unsigned long nbytes = bs.Size() - sizeof(int);
+  contents.resize(nbytes + 1);
+  bs.Unpack(contents.data(), nbytes);
+  contents[nbytes] = '\0';
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int Parse(const char *text, size_t nBytes, const std::string &name,
+  pugi::xml_document &doc)
+{
+  pugi::xml_parse_result result = doc.load_buffer(text, nBytes);
   if (!result)
     {
-    SENSEI_ERROR("XML [" << filename << "] parsed with errors, attr value: ["
+    SENSEI_ERROR("XML [" << name << "] parsed with errors, attr value: ["
       << doc.child("node").attribute("attr").value() << "]" << endl
       << "Error description: " << result.description() << endl
       << "Error offset: " << result.offset << endl)
@@ -98,6 +122,19 @@ int Parse(MPI_Comm comm, const std::string &filename, pugi::xml_document &doc)
   return 0;
 }
 
+//----------------------------------------------------------------------------
+int Parse(MPI_Comm comm, const std::string &filename, pugi::xml_document &doc)
+{
+  TimeEvent<128> mark("XMLUtils::Parse");
+
+  std::vector<char> contents;
+  if (ReadFile(comm, filename, contents))
+    return -1;
+
+  // the null terminator is not part of the document
+  return Parse(contents.data(), contents.size() - 1, filename, doc);
+}
+
 }
 
 }
@@ -25,11 +25,24 @@ int RequireAttribute(const pugi::xml_node &node, const char *attributeName);
 // is returned and an error message is sent to stderr.
 int RequireChild(const pugi::xml_node &node, const char *childName);
 
+// Parallel collective read of a file. Rank 0 does the I/O and broadcasts the
+// contents to the other ranks in the communicator, so that the file system
+// sees a single reader however many ranks there are. The contents are
+// followed by a null character, which is included in the size of the vector.
+// return of 0 indicates success on all ranks.
+int ReadFile(MPI_Comm comm, const std::string &filename,
+  std::vector<char> &contents);
+
 // Parallel collective read, parse, and distribute the XML file. Rank 0 does
-// the I/O and parse and will broadcast to the other ranks in the communicator.
-// return of 0 indicates success.
+// the I/O and will broadcast to the other ranks in the communicator, each
+// rank parses from memory. return of 0 indicates success.
 int Parse(MPI_Comm comm, const std::string &filename, pugi::xml_document &doc);
 
+// Parse XML held in memory. the name is used in error messages.
+// return of 0 indicates success.
+int Parse(const char *text, size_t nBytes, const std::string &name,
+  pugi::xml_document &doc);
+
 
 // helper for string to numeric type conversions
 template <typename num_t> struct numeric_traits;
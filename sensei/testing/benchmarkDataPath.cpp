@@ -0,0 +1,492 @@
+#include "BinaryStream.h"
+#include "MeshMetadata.h"
+#include "MPIUtils.h"
+#include "VTKUtils.h"
+#include "VTKHistogram.h"
+#include "BlockPartitioner.h"
+#include "PlanarPartitioner.h"
+#include "HilbertPartitioner.h"
+#include "LocalityPartitioner.h"
+#include "PlanarSlicePartitioner.h"
+#include "Error.h"
+
+#include <vtkImageData.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkDoubleArray.h>
+#include <vtkCellData.h>
+
+#include <mpi.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Times the primitives that sit on SENSEI's data path: BinaryStream
+// pack/unpack, MeshMetadata serialization and GlobalizeView,
+// VTKUtils::GetMetadata, VTKHistogram binning, and the partitioners'
+// GetPartition. Each benchmark is run over a sweep of blocks per rank and
+// arrays per block. The time of each repetition is that of the slowest
+// rank, the minimum, mean and maximum over the repetitions are reported
+// on rank 0, one line per benchmark and parameter set.
+//
+// usage: benchmarkDataPath [-b blocks per rank list] [-a arrays list]
+//          [-n cells per block side] [-r repetitions] [-t threads]
+//          [-f name filter]
+//
+// lists are comma separated, e.g. -b 1,16,64
+
+struct Parameters
+{
+  Parameters() : BlocksPerRank{1, 16}, NumArrays{1, 4}, BlockSize(16),
+    NumReps(10), NumThreads(1) {}
+
+  std::vector<int> BlocksPerRank;
+  std::vector<int> NumArrays;
+  int BlockSize;
+  int NumReps;
+  int NumThreads;
+  std::string Filter;
+};
+
+// --------------------------------------------------------------------------
+int parseList(const char *str, std::vector<int> &vals)
+{
+  vals.clear();
+  std::istringstream iss(str);
+  std::string tok;
+  while (std::getline(iss, tok, ','))
+    {
+    int val = atoi(tok.c_str());
+    if (val < 1)
+      return -1;
+    vals.push_back(val);
+    }
+  return vals.empty() ? -1 : 0;
+}
+
+// --------------------------------------------------------------------------
+int parseArgs(int argc, char **argv, Parameters &params)
+{
+  for (int i = 1; i < argc; ++i)
+    {
+    bool hasVal = i + 1 < argc;
+    if (!strcmp(argv[i], "-b") && hasVal)
+      {
+      if (parseList(argv[++i], params.BlocksPerRank))
+        return -1;
+      }
+    else if (!strcmp(argv[i], "-a") && hasVal)
+      {
+      if (parseList(argv[++i], params.NumArrays))
+        return -1;
+      }
+    else if (!strcmp(argv[i], "-n") && hasVal)
+      {
+      params.BlockSize = std::max(1, atoi(argv[++i]));
+      }
+    else if (!strcmp(argv[i], "-r") && hasVal)
+      {
+      params.NumReps = std::max(1, atoi(argv[++i]));
+      }
+    else if (!strcmp(argv[i], "-t") && hasVal)
+      {
+      params.NumThreads = atoi(argv[++i]);
+      }
+    else if (!strcmp(argv[i], "-f") && hasVal)
+      {
+      params.Filter = argv[++i];
+      }
+    else
+      {
+      return -1;
+      }
+    }
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+// times func NumReps times after one untimed warm up call. bytes, when non
+// zero, is the amount of data processed per call on each rank and is used
+// to report a rate.
+int runBenchmark(MPI_Comm comm, const Parameters &params, const char *name,
+  int blocksPerRank, int numArrays, unsigned long bytes,
+  const std::function<int()> &func)
+{
+  if (!params.Filter.empty() && !strstr(name, params.Filter.c_str()))
+    return 0;
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  int ierr = func();
+
+  std::vector<double> times(params.NumReps);
+  for (int i = 0; i < params.NumReps; ++i)
+    {
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    ierr |= func();
+    times[i] = MPI_Wtime() - t0;
+    }
+
+  MPI_Allreduce(MPI_IN_PLACE, times.data(), params.NumReps,
+    MPI_DOUBLE, MPI_MAX, comm);
+
+  MPI_Allreduce(MPI_IN_PLACE, &ierr, 1, MPI_INT, MPI_MIN, comm);
+
+  if (ierr)
+    {
+    SENSEI_ERROR("Benchmark " << name << " failed")
+    return -1;
+    }
+
+  if (rank == 0)
+    {
+    double tMin = times[0];
+    double tMax = times[0];
+    double tSum = 0.0;
+    for (int i = 0; i < params.NumReps; ++i)
+      {
+      tMin = std::min(tMin, times[i]);
+      tMax = std::max(tMax, times[i]);
+      tSum += times[i];
+      }
+    double tMean = tSum/params.NumReps;
+
+    std::cout << std::left << std::setw(40) << name
+      << " ranks=" << nRanks << " blocks=" << blocksPerRank
+      << " arrays=" << numArrays << std::scientific << std::setprecision(3)
+      << " min=" << tMin << " mean=" << tMean << " max=" << tMax;
+
+    if (bytes)
+      std::cout << " MiB/s=" << std::fixed << std::setprecision(1)
+        << bytes/tMin/(1024.0*1024.0);
+
+    std::cout << std::endl;
+    }
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+// makes a multiblock with blocksPerRank local image data blocks. the
+// blocks tile a box, each holds numArrays cell centered arrays.
+vtkMultiBlockDataSet *newMesh(MPI_Comm comm, int blocksPerRank,
+  int numArrays, int blockSize)
+{
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nRanks);
+
+  int numBlocks = nRanks*blocksPerRank;
+  int nbx = int(std::ceil(std::cbrt(double(numBlocks))));
+  int nby = int(std::ceil(std::sqrt(double(numBlocks)/nbx)));
+
+  vtkMultiBlockDataSet *mb = vtkMultiBlockDataSet::New();
+  mb->SetNumberOfBlocks(numBlocks);
+
+  long nCells = long(blockSize)*blockSize*blockSize;
+
+  for (int q = 0; q < blocksPerRank; ++q)
+    {
+    int bid = rank*blocksPerRank + q;
+    int i = bid % nbx;
+    int j = (bid / nbx) % nby;
+    int k = bid / (nbx*nby);
+
+    vtkImageData *im = vtkImageData::New();
+    im->SetExtent(i*blockSize, (i + 1)*blockSize, j*blockSize,
+      (j + 1)*blockSize, k*blockSize, (k + 1)*blockSize);
+
+    for (int a = 0; a < numArrays; ++a)
+      {
+      std::ostringstream oss;
+      oss << "array_" << a;
+
+      vtkDoubleArray *da = vtkDoubleArray::New();
+      da->SetName(oss.str().c_str());
+      da->SetNumberOfTuples(nCells);
+
+      double *pda = da->GetPointer(0);
+      for (long c = 0; c < nCells; ++c)
+        pda[c] = std::sin(0.01*(c + bid*nCells) + a);
+
+      im->GetCellData()->AddArray(da);
+      da->Delete();
+      }
+
+    mb->SetBlock(bid, im);
+    im->Delete();
+    }
+
+  return mb;
+}
+
+// --------------------------------------------------------------------------
+int benchmarkBinaryStream(MPI_Comm comm, const Parameters &params,
+  int blocksPerRank, int numArrays)
+{
+  // the arrays of the local blocks, as BinaryStream sees them when a block
+  // is serialized
+  long nCells = long(params.BlockSize)*params.BlockSize*params.BlockSize;
+  std::vector<std::vector<double>> data(blocksPerRank*numArrays,
+    std::vector<double>(nCells, 1.0));
+
+  unsigned long nBytes = data.size()*nCells*sizeof(double);
+
+  sensei::BinaryStream bs;
+  bs.Reserve(nBytes + data.size()*sizeof(unsigned long));
+
+  int ierr = runBenchmark(comm, params, "BinaryStream::Pack",
+    blocksPerRank, numArrays, nBytes, [&]() -> int
+    {
+    bs.Clear();
+    for (size_t i = 0; i < data.size(); ++i)
+      bs.Pack(data[i]);
+    return 0;
+    });
+
+  std::vector<double> vals;
+  ierr |= runBenchmark(comm, params, "BinaryStream::Unpack",
+    blocksPerRank, numArrays, nBytes, [&]() -> int
+    {
+    bs.SetReadPos(0);
+    for (size_t i = 0; i < data.size(); ++i)
+      bs.Unpack(vals);
+    return vals.size() == size_t(nCells) ? 0 : -1;
+    });
+
+  return ierr;
+}
+
+// --------------------------------------------------------------------------
+int benchmarkMeshMetadata(MPI_Comm comm, const Parameters &params,
+  int blocksPerRank, int numArrays, vtkMultiBlockDataSet *mesh)
+{
+  sensei::MeshMetadataFlags flags;
+  flags.SetAll();
+
+  sensei::MeshMetadataPtr localMd = sensei::MeshMetadata::New(flags);
+  localMd->MeshName = "mesh";
+
+  int ierr = runBenchmark(comm, params, "VTKUtils::GetMetadata",
+    blocksPerRank, numArrays, 0, [&]() -> int
+    {
+    localMd = sensei::MeshMetadata::New(flags);
+    localMd->MeshName = "mesh";
+    return sensei::VTKUtils::GetMetadata(comm, mesh, localMd,
+      params.NumThreads);
+    });
+
+  sensei::MeshMetadataPtr md;
+  ierr |= runBenchmark(comm, params, "MeshMetadata::GlobalizeView",
+    blocksPerRank, numArrays, 0, [&]() -> int
+    {
+    md = localMd->NewCopy();
+    return md->GlobalizeView(comm);
+    });
+
+  sensei::MPIUtils::HierarchicalComm hcomm;
+  hcomm.Initialize(comm);
+
+  ierr |= runBenchmark(comm, params, "MeshMetadata::GlobalizeView(hier)",
+    blocksPerRank, numArrays, 0, [&]() -> int
+    {
+    sensei::MeshMetadataPtr hmd = localMd->NewCopy();
+    return hmd->GlobalizeView(hcomm);
+    });
+
+  // serialization of the global view, as done when metadata is shared
+  // between the sender and the receiver
+  const int encodings[] = {sensei::MeshMetadata::ENCODING_VERBATIM,
+    sensei::MeshMetadata::ENCODING_COMPACT};
+
+  const char *toNames[] = {"MeshMetadata::ToStream",
+    "MeshMetadata::ToStream(compact)"};
+
+  const char *fromNames[] = {"MeshMetadata::FromStream",
+    "MeshMetadata::FromStream(compact)"};
+
+  for (int i = 0; i < 2; ++i)
+    {
+    sensei::BinaryStream bs;
+    ierr |= runBenchmark(comm, params, toNames[i], blocksPerRank,
+      numArrays, 0, [&]() -> int
+      {
+      bs.Clear();
+      return md->ToStream(bs, encodings[i]);
+      });
+
+    ierr |= runBenchmark(comm, params, fromNames[i], blocksPerRank,
+      numArrays, bs.Size(), [&]() -> int
+      {
+      bs.SetReadPos(0);
+      sensei::MeshMetadataPtr rmd = sensei::MeshMetadata::New();
+      return rmd->FromStream(bs);
+      });
+    }
+
+  // the partitioners, from the global view
+  std::vector<std::pair<const char*, sensei::PartitionerPtr>> parts;
+
+  parts.emplace_back("BlockPartitioner::GetPartition",
+    sensei::BlockPartitioner::New());
+
+  sensei::PlanarPartitionerPtr planar = sensei::PlanarPartitioner::New();
+  planar->SetPlaneSize(2);
+  parts.emplace_back("PlanarPartitioner::GetPartition", planar);
+
+  parts.emplace_back("HilbertPartitioner::GetPartition",
+    sensei::HilbertPartitioner::New());
+
+  parts.emplace_back("LocalityPartitioner::GetPartition",
+    sensei::LocalityPartitioner::New());
+
+  sensei::PlanarSlicePartitionerPtr slice = sensei::PlanarSlicePartitioner::New();
+  slice->SetPoint({0.5*(md->Bounds[0] + md->Bounds[1]), 0.0, 0.0});
+  parts.emplace_back("PlanarSlicePartitioner::GetPartition", slice);
+
+  for (size_t i = 0; i < parts.size(); ++i)
+    {
+    sensei::PartitionerPtr part = parts[i].second;
+    ierr |= runBenchmark(comm, params, parts[i].first, blocksPerRank,
+      numArrays, 0, [&]() -> int
+      {
+      sensei::MeshMetadataPtr out;
+      return part->GetPartition(comm, md, out);
+      });
+    }
+
+  return ierr;
+}
+
+// --------------------------------------------------------------------------
+int benchmarkHistogram(MPI_Comm comm, const Parameters &params,
+  int blocksPerRank, int numArrays, vtkMultiBlockDataSet *mesh)
+{
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  const int nBins = 64;
+
+  std::vector<std::vector<vtkDataArray*>> arrays(numArrays);
+  for (int q = 0; q < blocksPerRank; ++q)
+    {
+    vtkImageData *im = static_cast<vtkImageData*>(
+      mesh->GetBlock(rank*blocksPerRank + q));
+
+    for (int a = 0; a < numArrays; ++a)
+      arrays[a].push_back(im->GetCellData()->GetArray(a));
+    }
+
+  unsigned long nBytes = 0;
+  for (int a = 0; a < numArrays; ++a)
+    for (int q = 0; q < blocksPerRank; ++q)
+      nBytes += arrays[a][q]->GetNumberOfTuples()*sizeof(double);
+
+  sensei::VTKHistogram hist;
+  hist.SetNumberOfThreads(params.NumThreads);
+
+  // ranges and bins of all arrays, including the two reductions
+  int ierr = runBenchmark(comm, params, "VTKHistogram::Compute",
+    blocksPerRank, numArrays, nBytes, [&]() -> int
+    {
+    hist.SetNumberOfArrays(numArrays);
+
+    for (int a = 0; a < numArrays; ++a)
+      for (int q = 0; q < blocksPerRank; ++q)
+        hist.AddRange(a, arrays[a][q], nullptr);
+
+    hist.PreCompute(comm, nBins);
+
+    for (int a = 0; a < numArrays; ++a)
+      for (int q = 0; q < blocksPerRank; ++q)
+        hist.Compute(a, arrays[a][q], nullptr);
+
+    return 0;
+    });
+
+  // check the counts add up
+  std::vector<std::string> meshNames(numArrays, "mesh");
+  std::vector<std::string> arrayNames(numArrays);
+  for (int a = 0; a < numArrays; ++a)
+    arrayNames[a] = arrays[a][0]->GetName();
+
+  hist.PostCompute(comm, nBins, 0, 0.0, meshNames, arrayNames,
+    "benchmarkDataPath_histogram");
+
+  double min = 0.0;
+  double max = 0.0;
+  std::vector<unsigned int> bins;
+  if (hist.GetHistogram(comm, 0, min, max, bins) == 0 && rank == 0)
+    {
+    int nRanks = 1;
+    MPI_Comm_size(comm, &nRanks);
+
+    unsigned long total = 0;
+    for (size_t i = 0; i < bins.size(); ++i)
+      total += bins[i];
+
+    if (total != nBytes/sizeof(double)/numArrays*nRanks)
+      {
+      SENSEI_ERROR("Histogram holds " << total << " values, expected "
+        << nBytes/sizeof(double)/numArrays*nRanks)
+      ierr = -1;
+      }
+    }
+
+  return ierr;
+}
+
+// --------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  MPI_Comm comm = MPI_COMM_WORLD;
+
+  Parameters params;
+  if (parseArgs(argc, argv, params))
+    {
+    std::cerr << "usage: benchmarkDataPath [-b blocks per rank list]"
+      " [-a arrays list] [-n cells per block side] [-r repetitions]"
+      " [-t threads] [-f name filter]" << std::endl;
+    MPI_Finalize();
+    return -1;
+    }
+
+  int ierr = 0;
+  for (size_t i = 0; i < params.BlocksPerRank.size(); ++i)
+    {
+    int blocksPerRank = params.BlocksPerRank[i];
+    for (size_t j = 0; j < params.NumArrays.size(); ++j)
+      {
+      int numArrays = params.NumArrays[j];
+
+      ierr |= benchmarkBinaryStream(comm, params, blocksPerRank, numArrays);
+
+      vtkMultiBlockDataSet *mesh = newMesh(comm, blocksPerRank,
+        numArrays, params.BlockSize);
+
+      ierr |= benchmarkMeshMetadata(comm, params, blocksPerRank,
+        numArrays, mesh);
+
+      ierr |= benchmarkHistogram(comm, params, blocksPerRank,
+        numArrays, mesh);
+
+      mesh->Delete();
+      }
+    }
+
+  MPI_Finalize();
+
+  return ierr ? -1 : 0;
+}
@@ -0,0 +1,186 @@
+#include <cmath>
+#include <vector>
+#include <mpi.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include "Error.h"
+#include "ConnectedComponents.h"
+#include "TaskRuntime.h"
+#include "VTKDataAdaptor.h"
+
+// each rank holds a 16 x 16 x 4 slab of unit cells stacked along z. a
+// column of value 1 runs through all of the slabs, a 3 x 3 x 2 box of
+// value 2 sits on rank 0, shifted by shift cells in x, and a single cell of
+// value 1, smaller than the minimum feature size, sits on rank 0 too
+const int gNx = 16;
+const int gNy = 16;
+const int gNz = 4;
+
+vtkImageData *newSlab(int rank, int shift)
+{
+  long nCells = gNx*gNy*gNz;
+
+  vtkDoubleArray *da = vtkDoubleArray::New();
+  da->SetNumberOfTuples(nCells);
+  da->SetName("data");
+
+  for (int k = 0; k < gNz; ++k)
+    for (int j = 0; j < gNy; ++j)
+      for (int i = 0; i < gNx; ++i)
+        {
+        double val = 0.0;
+
+        if ((i >= 2) && (i <= 3) && (j >= 2) && (j <= 3))
+          val = 1.0;
+        else if ((rank == 0) && (i >= 10 + shift) && (i <= 12 + shift) &&
+          (j >= 10) && (j <= 12) && (k <= 1))
+          val = 2.0;
+        else if ((rank == 0) && (i == 0) && (j == 14) && (k == 0))
+          val = 1.0;
+
+        *da->GetPointer(i + gNx*(j + gNy*k)) = val;
+        }
+
+  vtkImageData *im = vtkImageData::New();
+  im->SetExtent(0, gNx, 0, gNy, rank*gNz, (rank + 1)*gNz);
+  im->GetCellData()->AddArray(da);
+  da->Delete();
+
+  return im;
+}
+
+// find the feature of the given size
+const sensei::ConnectedComponents::Feature *
+getFeature(const std::vector<sensei::ConnectedComponents::Feature> &features,
+  long long cells)
+{
+  for (unsigned int i = 0; i < features.size(); ++i)
+    if (features[i].Cells == cells)
+      return &features[i];
+  return nullptr;
+}
+
+int validateFeature(const sensei::ConnectedComponents::Feature *f,
+  const char *name, const double centroid[3], double value)
+{
+  if (!f)
+    {
+    SENSEI_ERROR("The " << name << " was not found")
+    return -1;
+    }
+
+  if ((fabs(f->Volume - f->Cells) > 1.0e-9) ||
+    (fabs(f->Centroid[0] - centroid[0]) > 1.0e-9) ||
+    (fabs(f->Centroid[1] - centroid[1]) > 1.0e-9) ||
+    (fabs(f->Centroid[2] - centroid[2]) > 1.0e-9) ||
+    (fabs(f->Extreme - value) > 1.0e-9) ||
+    (fabs(f->Integral - value*f->Volume) > 1.0e-9))
+    {
+    SENSEI_ERROR("The " << name << " has volume " << f->Volume
+      << " centroid " << f->Centroid[0] << ", " << f->Centroid[1] << ", "
+      << f->Centroid[2] << " extreme " << f->Extreme << " integral "
+      << f->Integral)
+    return -1;
+    }
+
+  return 0;
+}
+
+int validate(const std::vector<sensei::ConnectedComponents::Feature> &features,
+  int step, int nRanks, int columnId, int boxId)
+{
+  if (features.size() != 2)
+    {
+    SENSEI_ERROR("Step " << step << " found " << features.size()
+      << " features, expected 2")
+    return -1;
+    }
+
+  // the column is joined across the ranks
+  const sensei::ConnectedComponents::Feature *column =
+    getFeature(features, 4LL*gNz*nRanks);
+  double columnCentroid[3] = {3.0, 3.0, 0.5*gNz*nRanks};
+
+  const sensei::ConnectedComponents::Feature *box = getFeature(features, 18);
+  double boxCentroid[3] = {11.5 + step, 11.5, 1.0};
+
+  if (validateFeature(column, "column", columnCentroid, 1.0) ||
+    validateFeature(box, "box", boxCentroid, 2.0))
+    return -1;
+
+  // the box moved by a cell, it overlaps its last position and is tracked
+  if ((step > 0) && ((column->Id != columnId) || (box->Id != boxId) ||
+    (box->Parents.size() != 1) || (box->Parents[0] != boxId)))
+    {
+    SENSEI_ERROR("The features were not tracked, ids " << column->Id << ", "
+      << box->Id << " expected " << columnId << ", " << boxId)
+    return -1;
+    }
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+
+  sensei::ConnectedComponents *analysisAdaptor =
+    sensei::ConnectedComponents::New();
+
+  analysisAdaptor->Initialize("mesh", "data", 0.5, false, 2, "");
+  analysisAdaptor->SetNumberOfThreads(2);
+
+  int testResult = 0;
+  int columnId = -1;
+  int boxId = -1;
+
+  for (int step = 0; step < 2; ++step)
+    {
+    vtkImageData *im = newSlab(rank, step);
+
+    sensei::VTKDataAdaptor *dataAdaptor = sensei::VTKDataAdaptor::New();
+    dataAdaptor->SetDataObject("mesh", im);
+    dataAdaptor->SetDataTimeStep(step);
+    im->Delete();
+
+    if (!analysisAdaptor->Execute(dataAdaptor))
+      {
+      SENSEI_ERROR("Failed to find the features of step " << step)
+      testResult = -1;
+      }
+
+    dataAdaptor->Delete();
+
+    std::vector<sensei::ConnectedComponents::Feature> features;
+    if ((rank == 0) && (testResult == 0) &&
+      (analysisAdaptor->GetFeatures(features) ||
+      validate(features, step, nRanks, columnId, boxId)))
+      {
+      SENSEI_ERROR("Validation of step " << step << " failed")
+      testResult = -1;
+      }
+
+    if ((rank == 0) && (testResult == 0))
+      {
+      columnId = getFeature(features, 4LL*gNz*nRanks)->Id;
+      boxId = getFeature(features, 18)->Id;
+      }
+    }
+
+  analysisAdaptor->Finalize();
+  analysisAdaptor->Delete();
+
+  MPI_Bcast(&testResult, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  sensei::TaskRuntime::Finalize();
+
+  MPI_Finalize();
+
+  return testResult;
+}
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <mpi.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include "Error.h"
+#include "DataRequirements.h"
+#include "Extremes.h"
+#include "TaskRuntime.h"
+#include "VTKDataAdaptor.h"
+
+// each rank holds a 10 x 10 x 10 slab of points stacked along z. the value
+// of point i of rank r is i*nRanks + r, so that the extremes are spread over
+// the ranks, and the first point of each rank is NaN
+const int gN = 10;
+
+int validate(const std::vector<double> &values,
+  const std::vector<sensei::Extremes::Location> &locations,
+  unsigned int k, bool smallest, int nRanks)
+{
+  // the expected values, NaNs are skipped
+  long nLocal = gN*gN*gN;
+  long nGlobal = nLocal*nRanks;
+  std::vector<double> expected;
+  for (long v = nRanks; v < nGlobal; ++v)
+    expected.push_back(v);
+
+  if (smallest)
+    std::sort(expected.begin(), expected.end());
+  else
+    std::sort(expected.begin(), expected.end(), std::greater<double>());
+
+  expected.resize(k);
+
+  if ((values.size() != k) || (locations.size() != k))
+    {
+    SENSEI_ERROR("Found " << values.size() << " values, expected " << k)
+    return -1;
+    }
+
+  for (unsigned int q = 0; q < k; ++q)
+    {
+    if (values[q] != expected[q])
+      {
+      SENSEI_ERROR("Value " << q << " is " << values[q] << " expected "
+        << expected[q])
+      return -1;
+      }
+
+    // the point the value came from
+    long v = expected[q];
+    int rank = v % nRanks;
+    long i = v / nRanks;
+    int ijk[3] = {int(i % gN), int((i / gN) % gN), int(i / (gN*gN) + rank*gN)};
+
+    const sensei::Extremes::Location &loc = locations[q];
+    if ((loc.Rank != rank) || (loc.Index != i) || (loc.IJK[0] != ijk[0]) ||
+      (loc.IJK[1] != ijk[1]) || (loc.IJK[2] != ijk[2]) ||
+      (fabs(loc.X[0] - ijk[0]) > 1.0e-12) || (fabs(loc.X[1] - ijk[1]) > 1.0e-12) ||
+      (fabs(loc.X[2] - ijk[2]) > 1.0e-12))
+      {
+      SENSEI_ERROR("Value " << values[q] << " located on rank " << loc.Rank
+        << " index " << loc.Index << " ijk " << loc.IJK[0] << ", " << loc.IJK[1]
+        << ", " << loc.IJK[2] << " expected rank " << rank << " index " << i
+        << " ijk " << ijk[0] << ", " << ijk[1] << ", " << ijk[2])
+      return -1;
+      }
+    }
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+
+  long nLocal = gN*gN*gN;
+
+  vtkDoubleArray *da = vtkDoubleArray::New();
+  da->SetNumberOfTuples(nLocal);
+  da->SetName("values");
+  for (long i = 0; i < nLocal; ++i)
+    *da->GetPointer(i) = i ? i*nRanks + rank :
+      std::numeric_limits<double>::quiet_NaN();
+
+  vtkImageData *im = vtkImageData::New();
+  im->SetExtent(0, gN - 1, 0, gN - 1, rank*gN, (rank + 1)*gN - 1);
+  im->GetPointData()->AddArray(da);
+  da->Delete();
+
+  sensei::VTKDataAdaptor *dataAdaptor = sensei::VTKDataAdaptor::New();
+  dataAdaptor->SetDataObject("mesh", im);
+  im->Delete();
+
+  sensei::DataRequirements reqs;
+  reqs.AddRequirement("mesh", vtkDataObject::POINT, "values");
+
+  int testResult = 0;
+
+  // k is larger than the number of values on a rank when there are many
+  // ranks, the candidates of several ranks are merged
+  unsigned int k = 25;
+  for (int smallest = 0; smallest < 2; ++smallest)
+    {
+    sensei::Extremes *analysisAdaptor = sensei::Extremes::New();
+    analysisAdaptor->Initialize(reqs, k, smallest, "");
+    analysisAdaptor->SetNumberOfThreads(2);
+
+    if (!analysisAdaptor->Execute(dataAdaptor))
+      {
+      SENSEI_ERROR("Failed to find the extremes")
+      testResult = -1;
+      }
+
+    std::vector<double> values;
+    std::vector<sensei::Extremes::Location> locations;
+    if ((rank == 0) && (testResult == 0) &&
+      (analysisAdaptor->GetExtremes(0, values, locations) ||
+      validate(values, locations, k, smallest, nRanks)))
+      {
+      SENSEI_ERROR("Validation of the " << (smallest ? "smallest" : "largest")
+        << " values failed")
+      testResult = -1;
+      }
+
+    analysisAdaptor->Finalize();
+    analysisAdaptor->Delete();
+    }
+
+  dataAdaptor->Delete();
+
+  MPI_Bcast(&testResult, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  sensei::TaskRuntime::Finalize();
+
+  MPI_Finalize();
+
+  return testResult;
+}
@@ -0,0 +1,165 @@
+#include <cmath>
+#include <vector>
+#include <mpi.h>
+#include <vtkDoubleArray.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPointData.h>
+#include "Error.h"
+#include "ParticleDeposition.h"
+#include "VTKDataAdaptor.h"
+
+// a 4 x 4 x 4 grid of unit cells. each rank places a particle at the
+// center of every cell moving along x with a speed equal to its rank,
+// plus one on the node at 2,2,2 and one outside of the grid
+const int gDims[3] = {4, 4, 4};
+const double gBounds[6] = {0.0, 4.0, 0.0, 4.0, 0.0, 4.0};
+
+vtkPolyData *newParticles(int rank)
+{
+  vtkPoints *pts = vtkPoints::New();
+  pts->SetDataTypeToDouble();
+
+  vtkDoubleArray *vel = vtkDoubleArray::New();
+  vel->SetName("velocity");
+  vel->SetNumberOfComponents(3);
+
+  for (int k = 0; k < gDims[2]; ++k)
+    for (int j = 0; j < gDims[1]; ++j)
+      for (int i = 0; i < gDims[0]; ++i)
+        {
+        pts->InsertNextPoint(i + 0.5, j + 0.5, k + 0.5);
+        vel->InsertNextTuple3(rank, 0.0, 0.0);
+        }
+
+  pts->InsertNextPoint(2.0, 2.0, 2.0);
+  vel->InsertNextTuple3(rank, 0.0, 0.0);
+
+  pts->InsertNextPoint(10.0, 10.0, 10.0);
+  vel->InsertNextTuple3(rank, 0.0, 0.0);
+
+  vtkPolyData *pd = vtkPolyData::New();
+  pd->SetPoints(pts);
+  pd->GetPointData()->AddArray(vel);
+  pts->Delete();
+  vel->Delete();
+
+  return pd;
+}
+
+int validate(int scheme, int nRanks, const std::vector<double> &density,
+  const std::vector<double> &velocity, const std::vector<double> &dispersion)
+{
+  long nCells = gDims[0]*gDims[1]*gDims[2];
+  if ((long(density.size()) != nCells) || (long(velocity.size()) != 3*nCells) ||
+    (long(dispersion.size()) != nCells))
+    {
+    SENSEI_ERROR("Wrong grid size " << density.size())
+    return -1;
+    }
+
+  double mass = 0.0;
+  for (int k = 0; k < gDims[2]; ++k)
+    for (int j = 0; j < gDims[1]; ++j)
+      for (int i = 0; i < gDims[0]; ++i)
+        {
+        long q = i + gDims[0]*(j + gDims[1]*k);
+
+        // the particle on the node is shared by the 8 cells around it with
+        // CIC, and given to the cell above it with NGP
+        bool nodeCell = (scheme == sensei::ParticleDeposition::SCHEME_CIC) ?
+          ((i == 1) || (i == 2)) && ((j == 1) || (j == 2)) && ((k == 1) || (k == 2)) :
+          (i == 2) && (j == 2) && (k == 2);
+
+        double nodeShare = (scheme == sensei::ParticleDeposition::SCHEME_CIC) ?
+          0.125 : 1.0;
+
+        double expected = nRanks*(1.0 + (nodeCell ? nodeShare : 0.0));
+        if (fabs(density[q] - expected) > 1.0e-12)
+          {
+          SENSEI_ERROR("Cell " << i << ", " << j << ", " << k << " density "
+            << density[q] << " expected " << expected)
+          return -1;
+          }
+
+        // all particles in a cell are weighted alike, the mean of the ranks
+        // and their variance
+        double meanVel = (nRanks - 1.0)/2.0;
+        double dispVel = (nRanks*nRanks - 1.0)/12.0;
+        if ((fabs(velocity[3*q] - meanVel) > 1.0e-12) ||
+          (fabs(velocity[3*q+1]) > 1.0e-12) || (fabs(velocity[3*q+2]) > 1.0e-12) ||
+          (fabs(dispersion[q] - dispVel) > 1.0e-12))
+          {
+          SENSEI_ERROR("Cell " << i << ", " << j << ", " << k << " velocity "
+            << velocity[3*q] << " dispersion " << dispersion[q] << " expected "
+            << meanVel << " and " << dispVel)
+          return -1;
+          }
+
+        mass += density[q];
+        }
+
+  // the particle outside of the grid is dropped
+  double expectedMass = nRanks*(nCells + 1.0);
+  if (fabs(mass - expectedMass) > 1.0e-9)
+    {
+    SENSEI_ERROR("Total mass " << mass << " expected " << expectedMass)
+    return -1;
+    }
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+
+  vtkPolyData *pd = newParticles(rank);
+
+  sensei::VTKDataAdaptor *dataAdaptor = sensei::VTKDataAdaptor::New();
+  dataAdaptor->SetDataObject("particles", pd);
+  pd->Delete();
+
+  int testResult = 0;
+
+  int schemes[2] = {sensei::ParticleDeposition::SCHEME_NGP,
+    sensei::ParticleDeposition::SCHEME_CIC};
+
+  for (int s = 0; s < 2; ++s)
+    {
+    sensei::ParticleDeposition *analysisAdaptor =
+      sensei::ParticleDeposition::New();
+
+    if (analysisAdaptor->Initialize("particles", "velocity", gDims, gBounds,
+      schemes[s], "") || !analysisAdaptor->Execute(dataAdaptor))
+      {
+      SENSEI_ERROR("Deposition failed")
+      testResult = -1;
+      }
+
+    std::vector<double> density, velocity, dispersion;
+    if ((rank == 0) && (testResult == 0) &&
+      (analysisAdaptor->GetGrid(density, velocity, dispersion) ||
+      validate(schemes[s], nRanks, density, velocity, dispersion)))
+      {
+      SENSEI_ERROR("Validation of scheme " << schemes[s] << " failed")
+      testResult = -1;
+      }
+
+    analysisAdaptor->Finalize();
+    analysisAdaptor->Delete();
+    }
+
+  dataAdaptor->Delete();
+
+  MPI_Bcast(&testResult, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  MPI_Finalize();
+
+  return testResult;
+}
@@ -0,0 +1,172 @@
+#include <cmath>
+#include <vector>
+#include <mpi.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include "Error.h"
+#include "ParticleIndex.h"
+#include "TaskRuntime.h"
+
+// the particles are the nodes of an L x L x L lattice with unit spacing.
+// particle g at i, j, k = g % L, (g / L) % L, g / L^2 is passed by rank
+// g % nRanks, so that most particles need to move to the rank whose
+// region holds them
+const int gL = 8;
+
+void getLatticePoint(long long g, double x[3])
+{
+  x[0] = g % gL;
+  x[1] = (g / gL) % gL;
+  x[2] = g / (gL*gL);
+}
+
+// the number of lattice nodes one unit from x
+long getLatticeNeighbors(const double *x)
+{
+  long n = 0;
+  for (int q = 0; q < 3; ++q)
+    n += (x[q] > 0.0 ? 1 : 0) + (x[q] < gL - 1.0 ? 1 : 0);
+  return n;
+}
+
+int validate(const sensei::ParticleIndex &index, int nRanks)
+{
+  long nLocal = index.GetNumberOfPoints();
+  long nGhosts = index.GetNumberOfGhosts();
+  const std::vector<double> &pts = index.GetPoints();
+  const std::vector<int> &srcRanks = index.GetSourceRanks();
+  const std::vector<long long> &srcIds = index.GetSourceIds();
+
+  // all particles are indexed once, and evenly. the reductions come first
+  // so that all ranks make them
+  long nTotal = nLocal;
+  MPI_Allreduce(MPI_IN_PLACE, &nTotal, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+  long nMax = nLocal;
+  MPI_Allreduce(MPI_IN_PLACE, &nMax, 1, MPI_LONG, MPI_MAX, MPI_COMM_WORLD);
+
+  if (nTotal != gL*gL*gL)
+    {
+    SENSEI_ERROR("Indexed " << nTotal << " particles, expected " << gL*gL*gL)
+    return -1;
+    }
+
+  if (nMax > 2*nTotal/nRanks)
+    {
+    SENSEI_ERROR("Unbalanced regions, " << nMax << " particles on one rank"
+      " of " << nTotal)
+    return -1;
+    }
+
+  if ((long(pts.size()) != 3*(nLocal + nGhosts)) ||
+    (long(srcRanks.size()) != nLocal + nGhosts) ||
+    (long(srcIds.size()) != nLocal + nGhosts))
+    {
+    SENSEI_ERROR("Inconsistent number of particles " << nLocal << " + "
+      << nGhosts << " with " << pts.size()/3 << " points")
+    return -1;
+    }
+
+  // the particles are those that were passed in and lie in the region
+  double bounds[6];
+  index.GetBounds(bounds);
+
+  for (long p = 0; p < nLocal + nGhosts; ++p)
+    {
+    double x[3];
+    getLatticePoint(srcIds[p]*nRanks + srcRanks[p], x);
+
+    const double *xp = pts.data() + 3*p;
+    if ((xp[0] != x[0]) || (xp[1] != x[1]) || (xp[2] != x[2]))
+      {
+      SENSEI_ERROR("Particle " << p << " from rank " << srcRanks[p] << " id "
+        << srcIds[p] << " at " << xp[0] << ", " << xp[1] << ", " << xp[2]
+        << " expected at " << x[0] << ", " << x[1] << ", " << x[2])
+      return -1;
+      }
+
+    if ((p < nLocal) && ((xp[0] < bounds[0]) || (xp[0] > bounds[1]) ||
+      (xp[1] < bounds[2]) || (xp[1] > bounds[3]) || (xp[2] < bounds[4]) ||
+      (xp[2] > bounds[5])))
+      {
+      SENSEI_ERROR("Particle " << p << " is outside of the region")
+      return -1;
+      }
+    }
+
+  // the ghosts cover the query radius, the counts are exact
+  std::vector<long> counts;
+  if (index.CountNeighbors(1.01, counts, 2) || (long(counts.size()) != nLocal))
+    {
+    SENSEI_ERROR("Failed to count the neighbors")
+    return -1;
+    }
+
+  for (long p = 0; p < nLocal; ++p)
+    {
+    long expected = getLatticeNeighbors(pts.data() + 3*p);
+    if (counts[p] != expected)
+      {
+      const double *xp = pts.data() + 3*p;
+      SENSEI_ERROR("Particle at " << xp[0] << ", " << xp[1] << ", " << xp[2]
+        << " has " << counts[p] << " neighbors, expected " << expected)
+      return -1;
+      }
+    }
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+
+  vtkPoints *pts = vtkPoints::New();
+  pts->SetDataTypeToDouble();
+
+  long long nGlobal = gL*gL*gL;
+  for (long long g = rank; g < nGlobal; g += nRanks)
+    {
+    double x[3];
+    getLatticePoint(g, x);
+    pts->InsertNextPoint(x);
+    }
+
+  vtkPolyData *pd = vtkPolyData::New();
+  pd->SetPoints(pts);
+  pts->Delete();
+
+  sensei::ParticleIndex index;
+  index.SetCommunicator(MPI_COMM_WORLD);
+  index.SetGhostRadius(1.01);
+
+  int testResult = 0;
+
+  if (index.Build(pd) || validate(index, nRanks))
+    {
+    SENSEI_ERROR("The first build failed")
+    testResult = -1;
+    }
+
+  // the particles did not move, the regions are kept
+  if (index.Build(pd) || !index.GetRegionsReused() || validate(index, nRanks))
+    {
+    SENSEI_ERROR("The second build failed")
+    testResult = -1;
+    }
+
+  pd->Delete();
+
+  MPI_Allreduce(MPI_IN_PLACE, &testResult, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+  sensei::TaskRuntime::Finalize();
+
+  MPI_Finalize();
+
+  return testResult;
+}
@@ -0,0 +1,146 @@
+#include <cmath>
+#include <vector>
+#include <mpi.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include "Error.h"
+#include "ParticleTracer.h"
+#include "TaskRuntime.h"
+#include "VTKDataAdaptor.h"
+
+// each rank holds a 4 x 4 x 4 block of unit cells, the blocks are side by
+// side along x. the velocity is 1 along x everywhere, so in periodic
+// bounds a particle is at its seed moved by the elapsed time and wrapped
+const int gN = 4;
+
+vtkImageData *newBlock(int rank)
+{
+  vtkImageData *im = vtkImageData::New();
+  im->SetExtent(rank*gN, (rank + 1)*gN, 0, gN, 0, gN);
+
+  long nPts = (gN + 1)*(gN + 1)*(gN + 1);
+
+  vtkDoubleArray *vel = vtkDoubleArray::New();
+  vel->SetName("velocity");
+  vel->SetNumberOfComponents(3);
+  vel->SetNumberOfTuples(nPts);
+  for (long i = 0; i < nPts; ++i)
+    {
+    double *v = vel->GetPointer(3*i);
+    v[0] = 1.0;
+    v[1] = 0.0;
+    v[2] = 0.0;
+    }
+
+  im->GetPointData()->AddArray(vel);
+  vel->Delete();
+
+  return im;
+}
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+
+  double length = gN*nRanks;
+
+  // seeds spread along x, none on a block boundary
+  long long nSeeds = 8;
+  std::vector<double> seeds;
+  for (long long i = 0; i < nSeeds; ++i)
+    {
+    seeds.push_back(0.25 + 0.5*i*nRanks);
+    seeds.push_back(0.5*gN);
+    seeds.push_back(0.5*gN);
+    }
+
+  sensei::ParticleTracer *analysisAdaptor = sensei::ParticleTracer::New();
+
+  int testResult = 0;
+
+  // two substeps per step, periodic, the pathlines are not written
+  if (analysisAdaptor->Initialize("mesh", "velocity", vtkDataObject::POINT,
+    seeds, 1.0, 2, true, 1000, ""))
+    {
+    SENSEI_ERROR("Failed to initialize the tracer")
+    testResult = -1;
+    }
+
+  analysisAdaptor->SetNumberOfThreads(2);
+
+  // the first step seeds the particles, each of the others moves them a
+  // unit along x
+  int nSteps = 7;
+  for (int step = 0; (testResult == 0) && (step < nSteps); ++step)
+    {
+    vtkImageData *im = newBlock(rank);
+
+    sensei::VTKDataAdaptor *dataAdaptor = sensei::VTKDataAdaptor::New();
+    dataAdaptor->SetDataObject("mesh", im);
+    dataAdaptor->SetDataTimeStep(step);
+    dataAdaptor->SetDataTime(step);
+    im->Delete();
+
+    if (!analysisAdaptor->Execute(dataAdaptor))
+      {
+      SENSEI_ERROR("Failed to advect the particles at step " << step)
+      testResult = -1;
+      }
+
+    dataAdaptor->Delete();
+    }
+
+  // each particle is on the rank whose block holds it, at the expected
+  // position
+  std::vector<long long> ids;
+  std::vector<double> x;
+  analysisAdaptor->GetParticles(ids, x);
+
+  long long nFound = ids.size();
+  long long idSum = 0;
+  for (long long i = 0; i < nFound; ++i)
+    {
+    long long id = ids[i];
+    idSum += id;
+
+    double t = (seeds[3*id] + nSteps - 1.0)/length;
+    double expected = (t - std::floor(t))*length;
+
+    const double *xp = x.data() + 3*i;
+    if ((fabs(xp[0] - expected) > 1.0e-9) || (fabs(xp[1] - 0.5*gN) > 1.0e-9) ||
+      (fabs(xp[2] - 0.5*gN) > 1.0e-9) || (xp[0] < rank*gN) ||
+      (xp[0] > (rank + 1)*gN))
+      {
+      SENSEI_ERROR("Particle " << id << " on rank " << rank << " is at " << xp[0]
+        << ", " << xp[1] << ", " << xp[2] << " expected at x " << expected)
+      testResult = -1;
+      }
+    }
+
+  // no particle was lost or duplicated
+  MPI_Allreduce(MPI_IN_PLACE, &nFound, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(MPI_IN_PLACE, &idSum, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+  if ((nFound != nSeeds) || (idSum != nSeeds*(nSeeds - 1)/2))
+    {
+    SENSEI_ERROR("Found " << nFound << " particles, expected " << nSeeds)
+    testResult = -1;
+    }
+
+  analysisAdaptor->Finalize();
+  analysisAdaptor->Delete();
+
+  MPI_Allreduce(MPI_IN_PLACE, &testResult, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+  sensei::TaskRuntime::Finalize();
+
+  MPI_Finalize();
+
+  return testResult;
+}
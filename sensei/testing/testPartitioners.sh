@@ -2,7 +2,7 @@
 
 if [[ $# < 13 ]]
 then
-  echo "testPartitioners.sh [mpiexec] [npflag] [writer nproc] [blocks x] [blocks y] [reader nproc] [src dir] [writer analysis xml] [reader analysis xml] [reader transport xml] [nits] [sync]"
+  echo "testPartitioners.sh [mpiexec] [npflag] [writer nproc] [blocks x] [blocks y] [reader nproc] [src dir] [writer analysis xml] [reader analysis xml] [reader transport xml] [nits] [sync] [min read steps]"
   exit 1
 fi
 
@@ -19,6 +19,7 @@ reader_analysis_xml=${10}
 reader_transport_xml=${11}
 nits=${12}
 sync_mode=${13}
+min_steps=${14:-0}
 delay=1
 maxDelay=30
 
@@ -65,11 +66,16 @@ then
     fi
   done
 fi
+# otherwise the two sides are started together. transports that connect
+# the two sides themselves, such as mpi, need this
 
-export PROFILER_ENABLE=2 TIMER_LOG_FILE=ReaderTimes.csv MEMPROF_LOG_FILE=ReaderMemProf.csv
+# partitioners that measure the analysis cost need event profiling on the
+# read side
+export PROFILER_ENABLE=${READER_PROFILER_ENABLE:-2} TIMER_LOG_FILE=ReaderTimes.csv MEMPROF_LOG_FILE=ReaderMemProf.csv
 
 ${mpiexec} ${npflag} ${nproc_read} ${python} ${srcdir}/testPartitionersRead.py \
-  "${srcdir}/${reader_analysis_xml}" "${srcdir}/${reader_transport_xml}"
+  "${srcdir}/${reader_analysis_xml}" "${srcdir}/${reader_transport_xml}" \
+  ${min_steps}
 
 test_stat=$?
 
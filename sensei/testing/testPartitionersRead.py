@@ -28,7 +28,7 @@ def display_decomp(da):
   status_message('SenderBlockOwner=%s'%(str(smd.BlockOwner)))
   status_message('ReceiverBlockOwner=%s'%(str(rmd.BlockOwner)))
 
-def run_endpoint(analysisXml, transportXml):
+def run_endpoint(analysisXml, transportXml, minSteps):
   # initialize the data adaptor
   status_message('initializing the transport layer')
 
@@ -76,6 +76,11 @@ def run_endpoint(analysisXml, transportXml):
   da.CloseStream()
 
   status_message('completed after processing %d steps'%(n_steps))
+
+  if n_steps < minSteps:
+    error_message('processed %d steps, expected at least %d'%(n_steps, minSteps))
+    return -1
+
   return 0
 
 if __name__ == '__main__':
@@ -83,16 +88,17 @@ if __name__ == '__main__':
   Profiler.Initialize()
 
   # process command line
-  if len(sys.argv) != 3:
+  if len(sys.argv) != 3 and len(sys.argv) != 4:
     if rank == 0:
-        error_message('usage error\ntestPartitionerRead.py [analysis xml] [transport xml]')
+        error_message('usage error\ntestPartitionerRead.py [analysis xml] [transport xml] [min steps]')
     sys.exit(-1)
 
   analysisXml = sys.argv[1]
   transportXml = sys.argv[2]
+  minSteps = int(sys.argv[3]) if len(sys.argv) > 3 else 0
 
   # write data
-  ierr = run_endpoint(analysisXml, transportXml)
+  ierr = run_endpoint(analysisXml, transportXml, minSteps)
   if ierr:
     error_message('read failed')
 
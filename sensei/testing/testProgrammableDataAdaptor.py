@@ -58,6 +58,15 @@ def addArray(mesh, meshName, assoc, arrayName):
     return
   raise RuntimeError('failed to add array')
 
+# batched add arrays callback, the arrays are returned and are added to
+# the mesh without a copy
+def addArrays(mesh, meshName, assoc, arrayNames):
+  sys.stderr.write('===addArrays\n')
+  if ((meshName == 'image') and (assoc == vtk.vtkDataObject.POINT) \
+    and (arrayNames == ['data'])):
+    return {'data' : data}
+  raise RuntimeError('failed to add arrays')
+
 # release data callback
 def releaseData():
   sys.stderr.write('===releaseData\n')
@@ -77,6 +86,18 @@ meshName = mmd.MeshName
 arrayName = mmd.ArrayName[0]
 arrayCen = mmd.ArrayCentering[0]
 
+# the zero copy view of the metadata should match the copy
+cenView = sensei.MetadataView(mmd, 'ArrayCentering')
+if list(cenView) != list(mmd.ArrayCentering):
+  sys.stderr.write('MetadataView mismatch %s != %s\n'%(str(cenView), \
+    str(list(mmd.ArrayCentering))))
+  sys.exit(-1)
+
+# the default data adaptor provides no device arrays
+if pda.GetDeviceArray(meshName, arrayCen, arrayName, 0) is not None:
+  sys.stderr.write('GetDeviceArray returned an array for host data\n')
+  sys.exit(-1)
+
 ha = sensei.Histogram.New()
 ha.Initialize(7, meshName, arrayCen, arrayName, '')
 ha.Execute(pda)
@@ -92,4 +113,26 @@ ha.Delete()
 pda.ReleaseData()
 pda.Delete()
 
+# the same using the batched callback
+pda = sensei.ProgrammableDataAdaptor.New()
+pda.SetGetNumberOfMeshesCallback(getNumMeshes)
+pda.SetGetMeshMetadataCallback(getMeshMetadata)
+pda.SetGetMeshCallback(getMesh)
+pda.SetAddArraysCallback(addArrays)
+pda.SetReleaseDataCallback(releaseData)
+
+ha = sensei.Histogram.New()
+ha.Initialize(7, meshName, arrayCen, arrayName, '')
+ha.Execute(pda)
+
+hmin,hmax,hist = ha.GetHistogram()
+
+if hist != baselineHist:
+  result = -1
+
+ha.Delete()
+
+pda.ReleaseData()
+pda.Delete()
+
 sys.exit(result)
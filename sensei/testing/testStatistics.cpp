@@ -0,0 +1,143 @@
+#include <cmath>
+#include <mpi.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include "Error.h"
+#include "DataRequirements.h"
+#include "Statistics.h"
+#include "TaskRuntime.h"
+#include "VTKDataAdaptor.h"
+
+// each rank holds a contiguous run of the sequence 0, 1, ..., N-1 whose
+// moments have closed forms
+int validateMoments(const sensei::Statistics::Moments &m, long n)
+{
+  double N = n;
+  double mean = (N - 1.0)/2.0;
+  double variance = (N*N - 1.0)/12.0;
+  double kurtosis = -6.0*(N*N + 1.0)/(5.0*(N*N - 1.0));
+  double l2 = sqrt((N - 1.0)*N*(2.0*N - 1.0)/6.0);
+
+  if (fabs(m.Count - N) > 0.0)
+    {
+    SENSEI_ERROR("Incorrect count " << m.Count << " expected " << N)
+    return -1;
+    }
+
+  if ((fabs(m.Min) > 0.0) || (fabs(m.Max - (N - 1.0)) > 0.0))
+    {
+    SENSEI_ERROR("Incorrect range " << m.Min << ", " << m.Max)
+    return -1;
+    }
+
+  if (fabs(m.Mean - mean) > 1.0e-9*mean)
+    {
+    SENSEI_ERROR("Incorrect mean " << m.Mean << " expected " << mean)
+    return -1;
+    }
+
+  if (fabs(m.GetVariance() - variance) > 1.0e-9*variance)
+    {
+    SENSEI_ERROR("Incorrect variance " << m.GetVariance()
+      << " expected " << variance)
+    return -1;
+    }
+
+  if (fabs(m.GetSkewness()) > 1.0e-9)
+    {
+    SENSEI_ERROR("Incorrect skewness " << m.GetSkewness() << " expected 0")
+    return -1;
+    }
+
+  if (fabs(m.GetKurtosis() - kurtosis) > 1.0e-9)
+    {
+    SENSEI_ERROR("Incorrect kurtosis " << m.GetKurtosis()
+      << " expected " << kurtosis)
+    return -1;
+    }
+
+  if (fabs(m.GetL2Norm() - l2) > 1.0e-9*l2)
+    {
+    SENSEI_ERROR("Incorrect L2 norm " << m.GetL2Norm() << " expected " << l2)
+    return -1;
+    }
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+
+  unsigned int nx = 10;
+  unsigned int ny = 10;
+  unsigned int nz = 10;
+  long nLocal = nx*ny*nz;
+  long start = rank*nLocal;
+
+  vtkDoubleArray *da = vtkDoubleArray::New();
+  da->SetNumberOfTuples(nLocal);
+  da->SetName("seq");
+  for (long i = 0; i < nLocal; ++i)
+    *da->GetPointer(i) = start + i;
+
+  vtkImageData *im = vtkImageData::New();
+  im->SetDimensions(nx, ny, nz);
+  im->GetPointData()->AddArray(da);
+  da->Delete();
+
+  sensei::VTKDataAdaptor *dataAdaptor = sensei::VTKDataAdaptor::New();
+  dataAdaptor->SetDataObject("mesh", im);
+  im->Delete();
+
+  sensei::DataRequirements reqs;
+  reqs.AddRequirement("mesh", vtkDataObject::POINT, "seq");
+
+  // the moments are found by two threads, whose partial results are merged
+  sensei::Statistics *analysisAdaptor = sensei::Statistics::New();
+  analysisAdaptor->Initialize(reqs, "");
+  analysisAdaptor->SetNumberOfThreads(2);
+
+  int testResult = analysisAdaptor->Execute(dataAdaptor) ? 0 : -1;
+
+  sensei::Statistics::Moments moments;
+  if (analysisAdaptor->GetMoments(0, moments))
+    {
+    SENSEI_ERROR("Failed to get the moments")
+    testResult = -1;
+    }
+  else if (validateMoments(moments, nLocal*nRanks))
+    {
+    testResult = -1;
+    }
+
+  // the reduction left in flight is completed when the moments are asked
+  // for
+  analysisAdaptor->SetAsynchronous(true);
+  dataAdaptor->SetDataTimeStep(1);
+
+  if (!analysisAdaptor->Execute(dataAdaptor) ||
+    analysisAdaptor->GetMoments(0, moments) ||
+    validateMoments(moments, nLocal*nRanks))
+    {
+    SENSEI_ERROR("Asynchronous reduction failed")
+    testResult = -1;
+    }
+
+  dataAdaptor->Delete();
+
+  analysisAdaptor->Finalize();
+  analysisAdaptor->Delete();
+
+  sensei::TaskRuntime::Finalize();
+
+  MPI_Finalize();
+
+  return testResult;
+}
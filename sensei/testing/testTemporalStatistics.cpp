@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include "Error.h"
+#include "DataRequirements.h"
+#include "PartialResultsDataAdaptor.h"
+#include "TaskRuntime.h"
+#include "TemporalStatistics.h"
+#include "TemporalWindow.h"
+#include "VTKDataAdaptor.h"
+
+// each rank holds a 10 x 10 x 10 block of points stacked along z. the value
+// of point i of rank r at step s is i + r + s^2, the statistics over a
+// window are known in closed form
+const int gN = 10;
+
+double getValue(long i, int rank, int step)
+{
+  return i + rank + double(step)*step;
+}
+
+vtkImageData *newBlock(int rank, int step)
+{
+  long nPts = gN*gN*gN;
+
+  vtkDoubleArray *da = vtkDoubleArray::New();
+  da->SetNumberOfTuples(nPts);
+  da->SetName("values");
+  for (long i = 0; i < nPts; ++i)
+    *da->GetPointer(i) = getValue(i, rank, step);
+
+  vtkImageData *im = vtkImageData::New();
+  im->SetExtent(0, gN - 1, 0, gN - 1, rank*gN, (rank + 1)*gN - 1);
+  im->GetPointData()->AddArray(da);
+  da->Delete();
+
+  return im;
+}
+
+// check the published fields of an analysis with the given window
+int validate(sensei::PartialResultsDataAdaptor *data, int rank, int step,
+  unsigned int window)
+{
+  int first = std::max(0, step - int(window) + 1);
+  int nHeld = step - first + 1;
+
+  const char *stats[5] = {"mean", "variance", "min", "max", "ddt"};
+
+  for (int s = 0; s < 5; ++s)
+    {
+    std::vector<sensei::ArrayView> views;
+    if (data->GetArrayViews(sensei::TemporalStatistics::GetMeshName("mesh"),
+      vtkDataObject::POINT, std::string("values_") + stats[s], views) ||
+      (views.size() != 1) || (views[0].DataType != VTK_FLOAT) ||
+      (views[0].NumTuples != gN*gN*gN))
+      {
+      SENSEI_ERROR("The " << stats[s] << " was not published")
+      return -1;
+      }
+
+    const float *vals = static_cast<const float*>(views[0].Data);
+    for (long i = 0; i < gN*gN*gN; ++i)
+      {
+      double mean = 0.0;
+      for (int q = first; q <= step; ++q)
+        mean += getValue(i, rank, q);
+      mean /= nHeld;
+
+      double var = 0.0;
+      for (int q = first; q <= step; ++q)
+        var += (getValue(i, rank, q) - mean)*(getValue(i, rank, q) - mean);
+      var /= nHeld;
+
+      double expected[5] = {mean, var, getValue(i, rank, first),
+        getValue(i, rank, step), step ? 2.0*step - 1.0 : 0.0};
+
+      if (fabs(vals[i] - expected[s]) > 1.0e-4*std::max(1.0, fabs(expected[s])))
+        {
+        SENSEI_ERROR("Step " << step << " window " << window << " point " << i
+          << " on rank " << rank << " " << stats[s] << " is " << vals[i]
+          << " expected " << expected[s])
+        return -1;
+        }
+      }
+    }
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  int rank = 0;
+  int nRanks = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+
+  sensei::DataRequirements reqs;
+  reqs.AddRequirement("mesh", vtkDataObject::POINT, "values");
+
+  // two analyses of different windows share the history of the array
+  unsigned int windows[2] = {3, 5};
+  sensei::TemporalStatistics *analysisAdaptor[2];
+  for (int a = 0; a < 2; ++a)
+    {
+    analysisAdaptor[a] = sensei::TemporalStatistics::New();
+    analysisAdaptor[a]->Initialize(reqs, windows[a],
+      sensei::TemporalStatistics::STAT_ALL, "");
+    analysisAdaptor[a]->SetNumberOfThreads(2);
+    analysisAdaptor[a]->SetPublish(1);
+    }
+
+  sensei::PartialResultsDataAdaptor *published =
+    sensei::PartialResultsDataAdaptor::New();
+
+  int testResult = 0;
+
+  // the first steps are taken before the windows fill
+  for (int step = 0; (testResult == 0) && (step < 8); ++step)
+    {
+    vtkImageData *im = newBlock(rank, step);
+
+    sensei::VTKDataAdaptor *dataAdaptor = sensei::VTKDataAdaptor::New();
+    dataAdaptor->SetDataObject("mesh", im);
+    dataAdaptor->SetDataTimeStep(step);
+    dataAdaptor->SetDataTime(step);
+    im->Delete();
+
+    published->SetDataAdaptor(dataAdaptor);
+
+    // each analysis replaces the fields published by the last one
+    for (int a = 0; a < 2; ++a)
+      {
+      if (!analysisAdaptor[a]->Execute(published))
+        {
+        SENSEI_ERROR("Failed to compute the statistics of step " << step)
+        testResult = -1;
+        }
+      else if (validate(published, rank, step, windows[a]))
+        {
+        testResult = -1;
+        }
+      }
+
+    published->SetDataAdaptor(nullptr);
+    dataAdaptor->Delete();
+
+    MPI_Allreduce(MPI_IN_PLACE, &testResult, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    }
+
+  // the history is held once, with room for the larger window
+  sensei::TemporalWindowPtr history = sensei::TemporalWindow::GetWindow("mesh",
+    vtkDataObject::POINT, "values", 1);
+
+  if ((history->GetCapacity() != windows[1] + 1) ||
+    (history->GetNumberOfSteps() != windows[1] + 1) ||
+    (history->GetTimeStep(0) != 7) || (history->GetNumberOfValues(rank) != gN*gN*gN))
+    {
+    SENSEI_ERROR("The history holds " << history->GetNumberOfSteps() << " of "
+      << history->GetCapacity() << " steps, expected " << windows[1] + 1)
+    testResult = -1;
+    }
+
+  history.reset();
+
+  for (int a = 0; a < 2; ++a)
+    {
+    analysisAdaptor[a]->Finalize();
+    analysisAdaptor[a]->Delete();
+    }
+
+  published->Delete();
+
+  MPI_Allreduce(MPI_IN_PLACE, &testResult, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+  sensei::TaskRuntime::Finalize();
+
+  MPI_Finalize();
+
+  return testResult;
+}